@@ -17,5 +17,6 @@ find_package(Asciidoc QUIET)
 find_package(DBLATEX QUIET)
 find_package(Ruby QUIET 1.8.7)
 find_package(HS QUIET)
+find_package(PCRE2 QUIET)
 find_package(SafeC QUIET)
 
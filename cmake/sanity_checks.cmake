@@ -17,6 +17,7 @@ test_big_endian(WORDS_BIGENDIAN)
 
 #check include files
 check_include_file_cxx("arpa/inet.h" HAVE_ARPA_INET_H)
+check_include_file_cxx("execinfo.h" HAVE_EXECINFO_H)
 check_include_file_cxx("fcntl.h" HAVE_FCNTL_H)
 check_include_file_cxx("inttypes.h" HAVE_INTTYPES_H)
 check_include_file_cxx("libintl.h" HAVE_LIBINTL_H)
@@ -180,6 +181,10 @@ if (HS_FOUND)
     check_library_exists (${HS_LIBRARIES} hs_scan "" HAVE_HYPERSCAN)
 endif()
 
+if (PCRE2_FOUND)
+    check_library_exists (${PCRE2_LIBRARIES} pcre2_jit_stack_create_8 "" HAVE_PCRE2)
+endif()
+
 if (DEFINED LIBLZMA_LIBRARIES)
     check_library_exists (${LIBLZMA_LIBRARIES} lzma_code "" HAVE_LZMA)
 endif()
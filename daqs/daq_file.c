@@ -30,6 +30,8 @@
 #include <string.h>
 #include <stdio.h>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/unistd.h>
@@ -41,6 +43,7 @@
 #define DAQ_NAME "file"
 #define DAQ_TYPE (DAQ_TYPE_FILE_CAPABLE|DAQ_TYPE_INTF_CAPABLE|DAQ_TYPE_MULTI_INSTANCE)
 #define FILE_BUF_SZ 16384
+#define FILE_WINDOW_MAX 65535  // packet dsize is 16 bits
 
 typedef struct {
     char* name;
@@ -53,6 +56,14 @@ typedef struct {
     unsigned snaplen;
 
     uint8_t* buf;
+    uint8_t* data;
+
+    // regular files are mapped and read in place
+    uint8_t* map;
+    size_t map_len;
+    size_t map_off;
+    unsigned window;
+
     char error[DAQ_ERRBUF_SIZE];
 
     DAQ_UsrHdr_t pci;
@@ -64,6 +75,27 @@ typedef struct {
 // file functions
 //-------------------------------------------------------------------------
 
+// private and writable because snort may modify packets in place; only the
+// touched pages get copied.  if the map fails we just fall back to read().
+static void file_map(FileImpl* impl)
+{
+    struct stat sb;
+
+    if ( fstat(impl->fid, &sb) || !S_ISREG(sb.st_mode) || sb.st_size <= 0 )
+        return;
+
+    void* map = mmap(NULL, sb.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, impl->fid, 0);
+
+    if ( map == MAP_FAILED )
+        return;
+
+    madvise(map, sb.st_size, MADV_SEQUENTIAL);
+
+    impl->map = (uint8_t*)map;
+    impl->map_len = sb.st_size;
+    impl->map_off = 0;
+}
+
 static int file_setup(FileImpl* impl)
 {
     if ( !strcmp(impl->name, "tty") )
@@ -77,21 +109,44 @@ static int file_setup(FileImpl* impl)
         return -1;
     }
     impl->start = 1;
+    impl->data = impl->buf;
 
+    file_map(impl);
     return 0;
 }
 
 static void file_cleanup(FileImpl* impl)
 {
+    if ( impl->map )
+        munmap(impl->map, impl->map_len);
+
+    impl->map = NULL;
+    impl->map_len = impl->map_off = 0;
+
     if ( impl->fid > STDIN_FILENO )
         close(impl->fid);
 
     impl->fid = -1;
 }
 
+static int file_next(FileImpl* impl)
+{
+    size_t n = impl->map_len - impl->map_off;
+
+    if ( n > impl->window )
+        n = impl->window;
+
+    if ( n )
+    {
+        impl->data = impl->map + impl->map_off;
+        impl->map_off += n;
+    }
+    return (int)n;
+}
+
 static int file_read(FileImpl* impl)
 {
-    int n = read(impl->fid, impl->buf, impl->snaplen);
+    int n = impl->map ? file_next(impl) : read(impl->fid, impl->buf, impl->snaplen);
 
     if ( !n )
     {
@@ -146,6 +201,10 @@ static void set_pkt_hdr(FileImpl* impl, DAQ_PktHdr_t* phdr, ssize_t len)
     else
         impl->pci.flags = 0;
 
+    // windows point into the map which stays put until the daq stops
+    if ( impl->map )
+        impl->pci.flags |= DAQ_USR_FLAG_MAPPED;
+
     phdr->priv_ptr = &impl->pci;
 }
 
@@ -159,7 +218,7 @@ static int file_daq_process(
         return n;
 
     set_pkt_hdr(impl, &hdr, n);
-    DAQ_Verdict verdict = cb(user, &hdr, impl->buf);
+    DAQ_Verdict verdict = cb(user, &hdr, impl->data);
 
     if ( verdict >= MAX_DAQ_VERDICT )
         verdict = DAQ_VERDICT_BLOCK;
@@ -187,6 +246,38 @@ static void file_daq_shutdown (void* handle)
 
 //-------------------------------------------------------------------------
 
+// window is the size of the pieces a mapped file is handed out in; larger
+// windows mean fewer packets per file and a first window that covers the
+// file type depth.  reads of unmapped files are still limited to snaplen.
+static int get_vars (
+    FileImpl* impl, const DAQ_Config_t* cfg, char* errBuf, size_t errMax
+) {
+    DAQ_Dict* entry;
+
+    for ( entry = cfg->values; entry; entry = entry->next)
+    {
+        if ( !strcmp(entry->key, "window") )
+        {
+            long n = entry->value ? strtol(entry->value, NULL, 0) : 0;
+
+            if ( n < 1 || n > FILE_WINDOW_MAX )
+            {
+                snprintf(errBuf, errMax, "%s: window must be 1:%d", DAQ_NAME, FILE_WINDOW_MAX);
+                return 0;
+            }
+            impl->window = (unsigned)n;
+        }
+        else
+        {
+            snprintf(errBuf, errMax, "%s: unknown var (%s)", DAQ_NAME, entry->key);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+//-------------------------------------------------------------------------
+
 static int file_daq_initialize (
     const DAQ_Config_t* cfg, void** handle, char* errBuf, size_t errMax)
 {
@@ -201,6 +292,13 @@ static int file_daq_initialize (
     impl->fid = -1;
     impl->start = impl->stop = 0;
     impl->snaplen = cfg->snaplen ? cfg->snaplen : FILE_BUF_SZ;
+    impl->window = impl->snaplen;
+
+    if ( !get_vars(impl, cfg, errBuf, errMax) )
+    {
+        free(impl);
+        return DAQ_ERROR;
+    }
 
     if ( cfg->name )
     {
@@ -320,7 +418,7 @@ static void file_daq_reset_stats (void* handle)
 static int file_daq_get_snaplen (void* handle)
 {
     FileImpl* impl = (FileImpl*)handle;
-    return impl->snaplen;
+    return impl->window > impl->snaplen ? impl->window : impl->snaplen;
 }
 
 static uint32_t file_daq_get_capabilities (void* handle)
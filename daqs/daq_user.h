@@ -30,6 +30,7 @@
 #define DAQ_USR_FLAG_TO_SERVER  0x01
 #define DAQ_USR_FLAG_START_FLOW 0x02
 #define DAQ_USR_FLAG_END_FLOW   0x04
+#define DAQ_USR_FLAG_MAPPED     0x08  /* data is valid until the daq stops */
 
 /* user-related DAQs set priv_ptr to this */
 typedef struct
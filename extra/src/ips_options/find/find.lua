@@ -60,6 +60,18 @@ function eval ()
     return (i and (i > 0))
 end
 
+-- to skip the call, take the context pointer once and read it in eval():
+--
+--     local ctx = ffi.cast("const struct SnortContext*", snort_context)
+--
+--     function eval ()
+--         local str = ffi.string(ctx.buffer.data + ctx.pos,
+--             ctx.buffer.len - ctx.pos)
+--         ...
+--     end
+--
+-- ctx.flow has service, ip_proto, sp, dp, and from_server
+
 -- plugin table is required
 plugin =
 {
@@ -57,6 +57,20 @@ function alert ()
         evt.gid, evt.sid, evt.rev, str))
 end
 
+-- with lualert = { batch = 64 } alert() is called once per 64 events or
+-- DAQ burst, whichever comes first; loop over the queued records instead:
+--
+--     function alert ()
+--         local n = ffi.C.get_alert_count()
+--         local a = ffi.C.get_alerts()
+--
+--         for i = 0, n - 1 do
+--             local evt = a[i].event
+--             print(string.format('%d:%d:%d %s',
+--                 evt.gid, evt.sid, evt.rev, ffi.string(evt.msg)))
+--         end
+--     end
+
 -- plugin table is required
 plugin =
 {
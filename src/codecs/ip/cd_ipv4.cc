@@ -625,6 +625,9 @@ static inline uint16_t IpId_Next()
     return id;
 }
 
+uint16_t ip::next_id()
+{ return IpId_Next(); }
+
 /******************************************************************
  ******************** E N C O D E R  ******************************
  ******************************************************************/
@@ -24,6 +24,14 @@
 #include <stdlib.h>
 #include <cstddef>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define CKSUM_SIMD
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define CKSUM_SIMD
+#endif
+
 #include <protocols/protocol_ids.h>
 
 namespace checksum
@@ -56,6 +64,12 @@ inline uint16_t icmp_cksum(const uint16_t* buf, std::size_t len, const Pseudohea
 inline uint16_t icmp_cksum(const uint16_t* buf, std::size_t len);
 inline uint16_t ip_cksum(const uint16_t* buf, std::size_t len);
 
+// incremental update (RFC 1624) of a checksum field when 16 bit words
+// covered by it change from old_val to new_val; all in network order.
+inline uint16_t cksum_update(uint16_t cksum, uint16_t old_val, uint16_t new_val);
+inline uint16_t cksum_update(
+    uint16_t cksum, const uint16_t* old_buf, const uint16_t* new_buf, std::size_t words);
+
 /*
  *  NOTE: Since multiple dynamic libraries use checksums, the choice
  *          is to either include all of the checksum details in a header,
@@ -89,10 +103,127 @@ struct Psuedoheader6Union
     };
 };
 
-inline uint16_t cksum_add(const uint16_t* buf, std::size_t len, uint32_t cksum)
+// sum 16 bit words a vector at a time.  the ones complement sum doesn't
+// depend on byte order so words are added as loaded and folded at the
+// end.  the 32 bit lanes are spilled before they can overflow.
+#ifdef CKSUM_SIMD
+const std::size_t simd_min = 64;     // bytes; below this the scalar loop wins
+const std::size_t simd_spill = 4096; // vectors per spill
+
+typedef uint64_t (* SumWords)(const uint16_t*, std::size_t words);
+
+#if defined(__x86_64__)
+inline uint64_t sum_sse2(const uint16_t* sp, std::size_t words)
+{
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t sum = 0;
+
+    while ( words >= 8 )
+    {
+        std::size_t n = words / 8 < simd_spill ? words / 8 : simd_spill;
+        __m128i acc = zero;
+
+        for ( std::size_t i = 0; i < n; ++i, sp += 8 )
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)sp);
+            acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+            acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        words -= 8 * n;
+    }
+    for ( ; words; --words )
+        sum += *sp++;
+
+    return sum;
+}
+
+__attribute__((target("avx2")))
+inline uint64_t sum_avx2(const uint16_t* sp, std::size_t words)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t sum = 0;
+
+    while ( words >= 16 )
+    {
+        std::size_t n = words / 16 < simd_spill ? words / 16 : simd_spill;
+        __m256i acc = zero;
+
+        for ( std::size_t i = 0; i < n; ++i, sp += 16 )
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)sp);
+            acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+            acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+        }
+        uint32_t lanes[8];
+        _mm256_storeu_si256((__m256i*)lanes, acc);
+
+        for ( auto l : lanes )
+            sum += l;
+
+        words -= 16 * n;
+    }
+    return sum + sum_sse2(sp, words);
+}
+
+inline SumWords pick_sum()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? sum_avx2 : sum_sse2;
+}
+
+#else
+inline uint64_t sum_neon(const uint16_t* sp, std::size_t words)
+{
+    uint64_t sum = 0;
+
+    while ( words >= 8 )
+    {
+        std::size_t n = words / 8 < simd_spill ? words / 8 : simd_spill;
+        uint32x4_t acc = vdupq_n_u32(0);
+
+        for ( std::size_t i = 0; i < n; ++i, sp += 8 )
+            acc = vpadalq_u16(acc, vld1q_u16(sp));
+
+        sum += vaddlvq_u32(acc);
+        words -= 8 * n;
+    }
+    for ( ; words; --words )
+        sum += *sp++;
+
+    return sum;
+}
+
+inline SumWords pick_sum()
+{ return sum_neon; }
+#endif
+
+// each plugin gets its own copy of this; the guarded static is set once
+inline uint64_t sum_words(const uint16_t* sp, std::size_t words)
+{
+    static const SumWords sum = pick_sum();
+    return sum(sp, words);
+}
+#endif
+
+inline uint16_t cksum_add(const uint16_t* buf, std::size_t len, uint32_t init)
 {
     const uint16_t* sp = buf;
     std::size_t n, sn;
+    uint64_t total = init;
+    uint32_t cksum = 0;
+
+#ifdef CKSUM_SIMD
+    if ( len >= simd_min )
+    {
+        std::size_t words = (len / 2) & ~(std::size_t)15;
+        total += sum_words(sp, words);
+        sp += words;
+        len -= 2 * words;
+    }
+#endif
 
     if (len > 1 )
     {
@@ -163,10 +294,12 @@ inline uint16_t cksum_add(const uint16_t* buf, std::size_t len, uint32_t cksum)
     if (len & 1)
         cksum += (*(unsigned char*)sp);
 
-    cksum  = (cksum >> 16) + (cksum & 0x0000ffff);
-    cksum += (cksum >> 16);
+    total += cksum;
+
+    while ( total >> 16 )
+        total = (total >> 16) + (total & 0x0000ffff);
 
-    return (uint16_t)(~cksum);
+    return (uint16_t)(~total);
 }
 
 inline void add_ipv4_pseudoheader(const Pseudoheader* const ph4,
@@ -342,6 +475,35 @@ inline uint16_t ip_cksum(const uint16_t* buf, std::size_t len)
 
 inline uint16_t cksum_add(const uint16_t* buf, std::size_t len)
 { return detail::cksum_add(buf, len, 0); }
+
+// HC' = ~(~HC + ~m + m')
+inline uint16_t cksum_update(uint16_t cksum, uint16_t old_val, uint16_t new_val)
+{
+    uint32_t sum = (uint16_t)~cksum;
+    sum += (uint16_t)~old_val;
+    sum += new_val;
+
+    sum = (sum >> 16) + (sum & 0xffff);
+    sum += (sum >> 16);
+
+    return (uint16_t)~sum;
+}
+
+inline uint16_t cksum_update(
+    uint16_t cksum, const uint16_t* old_buf, const uint16_t* new_buf, std::size_t words)
+{
+    uint64_t sum = (uint16_t)~cksum;
+
+    for ( std::size_t i = 0; i < words; ++i )
+    {
+        sum += (uint16_t)~old_buf[i];
+        sum += new_buf[i];
+    }
+    while ( sum >> 16 )
+        sum = (sum >> 16) + (sum & 0xffff);
+
+    return (uint16_t)~sum;
+}
 } // namespace checksum
 
 #endif  /* CODECS_CHECKSUM_H */
@@ -85,6 +85,9 @@ static void set_flags(
     if ( pci->flags & DAQ_USR_FLAG_START_FLOW )
         snort.decode_flags |= DECODE_SOF;
 
+    if ( pci->flags & DAQ_USR_FLAG_MAPPED )
+        snort.decode_flags |= DECODE_MAPPED;
+
     if ( pci->flags & DAQ_USR_FLAG_END_FLOW )
     {
         snort.decode_flags |= DECODE_EOF;
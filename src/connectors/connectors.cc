@@ -21,10 +21,14 @@
 #include "framework/connector.h"
 
 extern const BaseApi* file_connector;
+extern const BaseApi* shmem_connector;
+extern const BaseApi* tcp_connector;
 
 const BaseApi* connectors[] =
 {
     file_connector,
+    shmem_connector,
+    tcp_connector,
     nullptr
 };
 
@@ -43,12 +43,17 @@
 THREAD_LOCAL SimpleStats file_connector_stats;
 THREAD_LOCAL ProfileStats file_connector_perfstats;
 
+// big enough for any side channel message so handles rarely grow
+#define FC_MSG_CAPACITY (MAXIMUM_SC_MESSAGE_CONTENT + sizeof(SCMsgHdr))
+#define FC_MAX_FREE_HANDLES 16
+
 FileConnectorMsgHandle::FileConnectorMsgHandle(const uint32_t length)
 {
     DebugMessage(DEBUG_CONNECTORS,"FileConnectorMsgHandle::FileConnectorMsgHandle()\n");
 
+    capacity = length > FC_MSG_CAPACITY ? length : FC_MSG_CAPACITY;
     connector_msg.length = length;
-    connector_msg.data = new uint8_t[length];
+    connector_msg.data = new uint8_t[capacity];
 }
 
 FileConnectorMsgHandle::~FileConnectorMsgHandle()
@@ -56,6 +61,17 @@ FileConnectorMsgHandle::~FileConnectorMsgHandle()
     delete[] connector_msg.data;
 }
 
+void FileConnectorMsgHandle::resize(const uint32_t length)
+{
+    if ( length > capacity )
+    {
+        delete[] connector_msg.data;
+        connector_msg.data = new uint8_t[length];
+        capacity = length;
+    }
+    connector_msg.length = length;
+}
+
 FileConnectorCommon::FileConnectorCommon(FileConnectorConfig::FileConnectorConfigSet* conf)
 {
     config_set = (ConnectorConfig::ConfigSet*)conf;
@@ -79,12 +95,34 @@ FileConnector::FileConnector(FileConnectorConfig* file_connector_config)
 FileConnector::~FileConnector()
 {
     DebugMessage(DEBUG_CONNECTORS,"FileConnector::~FileConnector()\n");
+
+    for ( auto* h : free_handles )
+        delete h;
+}
+
+FileConnectorMsgHandle* FileConnector::get_handle(const uint32_t length)
+{
+    if ( free_handles.empty() )
+        return new FileConnectorMsgHandle(length);
+
+    FileConnectorMsgHandle* h = free_handles.back();
+    free_handles.pop_back();
+    h->resize(length);
+    return h;
+}
+
+void FileConnector::put_handle(FileConnectorMsgHandle* h)
+{
+    if ( free_handles.size() < FC_MAX_FREE_HANDLES )
+        free_handles.push_back(h);
+    else
+        delete h;
 }
 
 ConnectorMsgHandle* FileConnector::alloc_message(const uint32_t length, const uint8_t** data)
 {
     DebugMessage(DEBUG_CONNECTORS,"FileConnector::alloc_message()\n");
-    FileConnectorMsgHandle* msg = new FileConnectorMsgHandle(length);
+    FileConnectorMsgHandle* msg = get_handle(length);
 
     *data = (uint8_t*)msg->connector_msg.data;
 
@@ -94,8 +132,7 @@ ConnectorMsgHandle* FileConnector::alloc_message(const uint32_t length, const ui
 void FileConnector::discard_message(ConnectorMsgHandle* msg)
 {
     DebugMessage(DEBUG_CONNECTORS,"FileConnector::discard_message()\n");
-    FileConnectorMsgHandle* fmsg = (FileConnectorMsgHandle*)msg;
-    delete fmsg;
+    put_handle((FileConnectorMsgHandle*)msg);
 }
 
 bool FileConnector::transmit_message(ConnectorMsgHandle* msg)
@@ -128,54 +165,41 @@ bool FileConnector::transmit_message(ConnectorMsgHandle* msg)
         file.write( (const char*)fmsg->connector_msg.data, fmsg->connector_msg.length);
     }
 
-    delete fmsg;
+    put_handle(fmsg);
 
     return true;
 }
 
 ConnectorMsgHandle* FileConnector::receive_message_binary()
 {
-    uint8_t* buffer = new uint8_t[MAXIMUM_SC_MESSAGE_CONTENT+sizeof(SCMsgHdr)+
-        sizeof(FileConnectorMsgHdr)];
-    // The FileConnectorMsgHdr is at the beginning of the buffer
-    FileConnectorMsgHdr* fc_hdr = (FileConnectorMsgHdr*)buffer;
+    FileConnectorMsgHdr fc_hdr(0);
 
-    // Read the FileConnect and SC headers
-    file.read((char*)buffer, (sizeof(FileConnectorMsgHdr)+sizeof(SCMsgHdr)));
+    // Read the FileConnect header
+    file.read((char*)&fc_hdr, sizeof(fc_hdr));
 
     // If not present, then no message exists
-    if ( (unsigned)file.gcount() < (sizeof(FileConnectorMsgHdr)+sizeof(SCMsgHdr)) )
-    {
-        delete[] buffer;
+    if ( (unsigned)file.gcount() < sizeof(fc_hdr) or
+        fc_hdr.connector_msg_length < sizeof(SCMsgHdr) or
+        fc_hdr.connector_msg_length > FC_MSG_CAPACITY )
         return nullptr;
-    }
 
-    // Now read the SC message content
-    file.read((char*)(buffer+sizeof(FileConnectorMsgHdr)+sizeof(SCMsgHdr)),
-        (fc_hdr->connector_msg_length - sizeof(SCMsgHdr)));
+    // Read the SC header and content straight into the message
+    FileConnectorMsgHandle* handle = get_handle(fc_hdr.connector_msg_length);
+    file.read((char*)handle->connector_msg.data, fc_hdr.connector_msg_length);
 
     // If not present, then no valid message exists
-    if ( (unsigned)file.gcount() < (fc_hdr->connector_msg_length - sizeof(SCMsgHdr)) )
+    if ( (unsigned)file.gcount() < fc_hdr.connector_msg_length )
     {
-        delete[] buffer;
+        put_handle(handle);
         return nullptr;
     }
 
-    // The message is valid, make a ConnectorMsg to contain it.
-    FileConnectorMsgHandle* handle = new FileConnectorMsgHandle(fc_hdr->connector_msg_length);
-
-    // Copy the connector message into the new ConnectorMsg
-    memcpy(handle->connector_msg.data, (buffer+sizeof(FileConnectorMsgHdr)),
-        fc_hdr->connector_msg_length);
-    delete[] buffer;
-
     return handle;
 }
 
 ConnectorMsgHandle* FileConnector::receive_message_text()
 {
     char line_buffer[4*MAXIMUM_SC_MESSAGE_CONTENT];
-    char message[MAXIMUM_SC_MESSAGE_CONTENT];
     char* current = line_buffer;
     int length = 0;
     SCMsgHdr hdr;
@@ -192,19 +216,20 @@ ConnectorMsgHandle* FileConnector::receive_message_text()
 
     sscanf(line_buffer, "%hu:%" SCNu64 ".%" SCNu32, &hdr.port, &hdr.time_seconds, &hdr.time_u_seconds);
 
-    while ( (current = strchr(current,(int)',')) != nullptr )
+    // The content is decoded straight into the message
+    FileConnectorMsgHandle* handle = get_handle(FC_MSG_CAPACITY);
+    uint8_t* message = handle->connector_msg.data + sizeof(SCMsgHdr);
+
+    while ( (current = strchr(current,(int)',')) != nullptr and
+        length < MAXIMUM_SC_MESSAGE_CONTENT )
     {
         current += 1;   // step to the character after the comma
-        sscanf(current,"%hhx",(unsigned char*)&(message[length++]));
+        sscanf(current,"%hhx",&message[length++]);
     }
 
-    // The message is valid, make a ConnectorMsg to contain it.
-    FileConnectorMsgHandle* handle = new FileConnectorMsgHandle(length+sizeof(SCMsgHdr));
-
     // Copy the header
     memcpy(handle->connector_msg.data, &hdr, sizeof(SCMsgHdr));
-    // Copy the connector message into the new ConnectorMsg
-    memcpy((handle->connector_msg.data+sizeof(SCMsgHdr)), message, length);
+    handle->connector_msg.length = length + sizeof(SCMsgHdr);
 
     return handle;
 }
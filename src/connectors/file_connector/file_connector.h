@@ -22,6 +22,7 @@
 #define FILE_CONNECTOR_H
 
 #include <fstream>
+#include <vector>
 
 #include "file_connector_config.h"
 #include "framework/connector.h"
@@ -49,7 +50,12 @@ class FileConnectorMsgHandle : public ConnectorMsgHandle
 public:
     FileConnectorMsgHandle(const uint32_t length);
     ~FileConnectorMsgHandle();
+
+    // keeps the buffer unless it is too small
+    void resize(const uint32_t length);
+
     ConnectorMsg connector_msg;
+    uint32_t capacity;
 };
 
 class FileConnectorCommon : public ConnectorCommon
@@ -80,6 +86,12 @@ public:
 private:
     ConnectorMsgHandle* receive_message_binary();
     ConnectorMsgHandle* receive_message_text();
+
+    FileConnectorMsgHandle* get_handle(const uint32_t length);
+    void put_handle(FileConnectorMsgHandle*);
+
+    // released handles are reused for the next message
+    std::vector<FileConnectorMsgHandle*> free_handles;
 };
 
 #endif
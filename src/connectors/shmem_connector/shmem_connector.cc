@@ -0,0 +1,463 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// shmem_connector.cc
+
+#include "shmem_connector.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <string>
+
+#include "shmem_connector_module.h"
+#include "log/messages.h"
+#include "main/snort_debug.h"
+#include "utils/util.h"
+
+/* Globals ****************************************************************/
+
+THREAD_LOCAL ShmemConnectorStats shmem_connector_stats;
+THREAD_LOCAL ProfileStats shmem_connector_perfstats;
+
+// a blocked receive gives up after this long
+#define SHMEM_WAIT_NS 100000000
+
+//-------------------------------------------------------------------------
+// wakeups
+//
+// the futex is in the shared segment so it must not be process private.
+// elsewhere a blocked receive just sleeps once.
+//-------------------------------------------------------------------------
+
+#ifdef __linux__
+static void ring_wait(std::atomic<uint32_t>* w, uint32_t val)
+{
+    struct timespec ts = { 0, SHMEM_WAIT_NS };
+    syscall(SYS_futex, (uint32_t*)w, FUTEX_WAIT, val, &ts, nullptr, 0);
+}
+
+static void ring_wake(std::atomic<uint32_t>* w)
+{
+    syscall(SYS_futex, (uint32_t*)w, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+#else
+static void ring_wait(std::atomic<uint32_t>*, uint32_t)
+{
+    struct timespec ts = { 0, SHMEM_WAIT_NS };
+    nanosleep(&ts, nullptr);
+}
+
+static void ring_wake(std::atomic<uint32_t>*) { }
+#endif
+
+//-------------------------------------------------------------------------
+// class stuff
+//-------------------------------------------------------------------------
+
+ShmemConnectorMsgHandle::ShmemConnectorMsgHandle(const uint32_t length)
+{
+    slot = 0;
+    owned = true;
+    connector_msg.length = length;
+    connector_msg.data = new uint8_t[length];
+}
+
+ShmemConnectorMsgHandle::~ShmemConnectorMsgHandle()
+{
+    if ( owned )
+        delete[] connector_msg.data;
+}
+
+ShmemConnectorCommon::ShmemConnectorCommon(ShmemConnectorConfig::ShmemConnectorConfigSet* conf)
+{
+    config_set = (ConnectorConfig::ConfigSet*)conf;
+}
+
+ShmemConnectorCommon::~ShmemConnectorCommon()
+{
+    for ( auto conf : *config_set )
+        delete conf;
+
+    config_set->clear();
+    delete config_set;
+}
+
+ShmemConnector::ShmemConnector(ShmemConnectorConfig* shmem_connector_config)
+{
+    DebugMessage(DEBUG_CONNECTORS,"ShmemConnector::ShmemConnector()\n");
+    config = shmem_connector_config;
+}
+
+ShmemConnector::~ShmemConnector()
+{
+    DebugMessage(DEBUG_CONNECTORS,"ShmemConnector::~ShmemConnector()\n");
+
+    if ( !ring )
+        return;
+
+    munmap(ring, bytes);
+
+    // the receiver owns the segment; a restarted pair starts empty
+    if ( get_connector_direction() == Connector::CONN_RECEIVE )
+        shm_unlink(segment.c_str());
+}
+
+// both ends open or create the segment; whoever finds it new sets it up
+bool ShmemConnector::attach(const std::string& name)
+{
+    ShmemConnectorConfig* cfg = (ShmemConnectorConfig*)config;
+    uint32_t n = 2;
+
+    while ( n < cfg->slots )
+        n <<= 1;
+
+    stride = (offsetof(ShmemSlot, data) + cfg->size + 7) & ~(size_t)7;
+    bytes = sizeof(ShmemRing) + n * stride;
+
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+
+    if ( fd < 0 )
+    {
+        ErrorMessage("shmem_connector: can't open %s: %s\n", name.c_str(), get_error(errno));
+        return false;
+    }
+
+    struct stat st;
+    bool ok = !fstat(fd, &st) and
+        (st.st_size == (off_t)bytes or (!st.st_size and !ftruncate(fd, bytes)));
+
+    void* p = ok ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if ( p == MAP_FAILED )
+    {
+        ErrorMessage("shmem_connector: can't map %s\n", name.c_str());
+        return false;
+    }
+
+    ShmemRing* r = (ShmemRing*)p;
+
+    // a new segment is all zeros so the ring is already empty
+    if ( r->magic.load() != SHMEM_RING_MAGIC )
+    {
+        r->version = SHMEM_RING_VERSION;
+        r->slots = n;
+        r->size = cfg->size;
+        r->magic.store(SHMEM_RING_MAGIC);
+    }
+    else if ( r->version != SHMEM_RING_VERSION or r->slots != n or r->size != cfg->size )
+    {
+        ErrorMessage("shmem_connector: %s does not match the configured ring\n", name.c_str());
+        munmap(p, bytes);
+        return false;
+    }
+
+    ring = r;
+    slots = (uint8_t*)(ring + 1);
+    mask = n - 1;
+    segment = name;
+
+    if ( get_connector_direction() == Connector::CONN_TRANSMIT )
+        next = ring->head.load();
+    else
+        next = ring->tail.load();
+
+    handles.resize(n);
+    done.assign(n, 0);
+
+    for ( uint32_t i = 0; i < n; ++i )
+    {
+        handles[i].slot = i;
+        handles[i].connector_msg.data = get_slot(i)->data;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// transmit
+//-------------------------------------------------------------------------
+
+// make the finished slots at the head visible, in order
+void ShmemConnector::publish()
+{
+    uint32_t head = next;
+
+    while ( pending and done[next & mask] )
+    {
+        done[next & mask] = 0;
+        ++next;
+        --pending;
+    }
+
+    if ( next == head )
+        return;
+
+    // only wake a receiver that is waiting so bursts cost no system calls
+    ring->head.store(next);
+
+    if ( ring->waiting.load() )
+    {
+        ring->wake.fetch_add(1);
+        ring_wake(&ring->wake);
+        shmem_connector_stats.wakeups++;
+    }
+}
+
+ConnectorMsgHandle* ShmemConnector::alloc_message(const uint32_t length, const uint8_t** data)
+{
+    ShmemConnectorMsgHandle* h;
+    uint32_t n = next + pending;
+
+    if ( ring and length <= ring->size and
+        n - ring->tail.load(std::memory_order_acquire) <= mask )
+    {
+        h = &handles[n & mask];
+        h->connector_msg.length = length;
+        ++pending;
+    }
+    else
+        h = new ShmemConnectorMsgHandle(length);
+
+    *data = (uint8_t*)h->connector_msg.data;
+    return h;
+}
+
+void ShmemConnector::discard_message(ConnectorMsgHandle* msg)
+{
+    ShmemConnectorMsgHandle* h = (ShmemConnectorMsgHandle*)msg;
+
+    if ( h->owned )
+    {
+        delete h;
+        return;
+    }
+
+    done[h->slot] = 1;
+
+    if ( get_connector_direction() == Connector::CONN_RECEIVE )
+        release();
+
+    else
+    {
+        get_slot(h->slot)->length = 0;
+        publish();
+    }
+}
+
+bool ShmemConnector::transmit_message(ConnectorMsgHandle* msg)
+{
+    ShmemConnectorMsgHandle* h = (ShmemConnectorMsgHandle*)msg;
+
+    if ( !h->owned )
+    {
+        get_slot(h->slot)->length = h->connector_msg.length;
+        done[h->slot] = 1;
+        publish();
+        shmem_connector_stats.transmits++;
+        return true;
+    }
+
+    // built aside because the ring was full or it was too big; it is sent
+    // only if it fits now and nothing is ahead of it
+    uint32_t length = h->connector_msg.length;
+    bool ok = ring and !pending and length <= ring->size and
+        next - ring->tail.load(std::memory_order_acquire) <= mask;
+
+    if ( ok )
+    {
+        ShmemSlot* s = get_slot(next);
+        memcpy(s->data, h->connector_msg.data, length);
+        s->length = length;
+        done[next & mask] = 1;
+        ++pending;
+        publish();
+        shmem_connector_stats.transmits++;
+    }
+    else
+        shmem_connector_stats.drops++;
+
+    delete h;
+    return ok;
+}
+
+//-------------------------------------------------------------------------
+// receive
+//-------------------------------------------------------------------------
+
+// give the slots done at the tail back to the transmitter, in order
+void ShmemConnector::release()
+{
+    uint32_t tail = next;
+
+    while ( pending and done[next & mask] )
+    {
+        done[next & mask] = 0;
+        ++next;
+        --pending;
+    }
+
+    if ( next != tail )
+        ring->tail.store(next, std::memory_order_release);
+}
+
+// a blocking receive waits once for the transmitter
+ConnectorMsgHandle* ShmemConnector::receive_message(bool block)
+{
+    if ( !ring )
+        return nullptr;
+
+    while ( true )
+    {
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+        uint32_t n = next + pending;
+
+        while ( n != head )
+        {
+            ShmemSlot* s = get_slot(n);
+            uint32_t i = n & mask;
+            ++pending;
+            ++n;
+
+            // skip discards
+            if ( !s->length or s->length > ring->size )
+            {
+                done[i] = 1;
+                release();
+                continue;
+            }
+
+            ShmemConnectorMsgHandle* h = &handles[i];
+            h->connector_msg.length = s->length;
+            shmem_connector_stats.receives++;
+            return h;
+        }
+
+        if ( !block )
+            return nullptr;
+
+        uint32_t w = ring->wake.load();
+        ring->waiting.store(1);
+
+        if ( ring->head.load() == n )
+            ring_wait(&ring->wake, w);
+
+        ring->waiting.store(0);
+        block = false;
+    }
+}
+
+//-------------------------------------------------------------------------
+// api stuff
+//-------------------------------------------------------------------------
+
+static Module* mod_ctor()
+{
+    return new ShmemConnectorModule;
+}
+
+static void mod_dtor(Module* m)
+{
+    delete m;
+}
+
+// each packet thread pairs with the same instance of the other process
+static Connector* shmem_connector_tinit(ConnectorConfig* config)
+{
+    ShmemConnectorConfig* cfg = (ShmemConnectorConfig*)config;
+
+    if ( cfg->direction != Connector::CONN_TRANSMIT and
+        cfg->direction != Connector::CONN_RECEIVE )
+        return nullptr;
+
+    std::string segment = "/" SHMEM_CONNECTOR_NAME "_";
+    segment += cfg->name;
+    segment += "_";
+    segment += std::to_string(get_instance_id());
+
+    // if this fails the connector drops everything it is given
+    ShmemConnector* shmem_connector = new ShmemConnector(cfg);
+    shmem_connector->attach(segment);
+
+    DebugFormat(DEBUG_CONNECTORS,"shmem_connector:shmem_connector_tinit(): segment: %s\n",
+        segment.c_str());
+
+    return shmem_connector;
+}
+
+static void shmem_connector_tterm(Connector* connector)
+{
+    delete (ShmemConnector*)connector;
+}
+
+static ConnectorCommon* shmem_connector_ctor(Module* m)
+{
+    ShmemConnectorModule* mod = (ShmemConnectorModule*)m;
+    return new ShmemConnectorCommon(mod->get_and_clear_config());
+}
+
+static void shmem_connector_dtor(ConnectorCommon* c)
+{
+    delete (ShmemConnectorCommon*)c;
+}
+
+const ConnectorApi shmem_connector_api =
+{
+    {
+        PT_CONNECTOR,
+        sizeof(ConnectorApi),
+        CONNECTOR_API_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        SHMEM_CONNECTOR_NAME,
+        SHMEM_CONNECTOR_HELP,
+        mod_ctor,
+        mod_dtor
+    },
+    0,
+    nullptr,
+    nullptr,
+    shmem_connector_tinit,
+    shmem_connector_tterm,
+    shmem_connector_ctor,
+    shmem_connector_dtor
+};
+
+#ifdef BUILDING_SO
+SO_PUBLIC const BaseApi* snort_plugins[] =
+{
+    &shmem_connector_api.base,
+    nullptr
+};
+#else
+const BaseApi* shmem_connector = &shmem_connector_api.base;
+#endif
+
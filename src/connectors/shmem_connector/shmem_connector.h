@@ -0,0 +1,131 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// shmem_connector.h
+
+#ifndef SHMEM_CONNECTOR_H
+#define SHMEM_CONNECTOR_H
+
+// a single producer, single consumer ring of fixed size message slots in
+// a named shared memory segment.  messages are written and read in place.
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "shmem_connector_config.h"
+#include "framework/connector.h"
+#include "main/thread.h"
+#include "profiler/profiler.h"
+
+#define SHMEM_RING_MAGIC   0x53524e47  // SRNG
+#define SHMEM_RING_VERSION 1
+
+// the segment starts with this header followed by the slots.  head and
+// tail are free running counts of messages; each is written by one side
+// only and they are kept out of each other's cache line.
+struct ShmemRing
+{
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t size;
+
+    uint8_t pad1[48];
+    std::atomic<uint32_t> head;     // transmitter
+    uint8_t pad2[60];
+    std::atomic<uint32_t> tail;     // receiver
+    std::atomic<uint32_t> waiting;  // receiver is blocked or about to be
+    std::atomic<uint32_t> wake;     // futex bumped to wake the receiver
+    uint8_t pad3[52];
+};
+
+// a slot's length is 0 if the message was discarded before transmit
+struct ShmemSlot
+{
+    uint32_t length;
+    uint8_t data[4];
+};
+
+class ShmemConnectorMsgHandle : public ConnectorMsgHandle
+{
+public:
+    ShmemConnectorMsgHandle()
+    { slot = 0; owned = false; connector_msg.length = 0; connector_msg.data = nullptr; }
+
+    // messages that don't fit a slot are built aside
+    ShmemConnectorMsgHandle(const uint32_t length);
+    ~ShmemConnectorMsgHandle();
+
+    ConnectorMsg connector_msg;
+    uint32_t slot;
+    bool owned;
+};
+
+class ShmemConnectorCommon : public ConnectorCommon
+{
+public:
+    ShmemConnectorCommon(ShmemConnectorConfig::ShmemConnectorConfigSet*);
+    ~ShmemConnectorCommon();
+};
+
+class ShmemConnector : public Connector
+{
+public:
+    ShmemConnector(ShmemConnectorConfig*);
+    ~ShmemConnector();
+
+    bool attach(const std::string& segment);
+
+    ConnectorMsgHandle* alloc_message(const uint32_t, const uint8_t**) override;
+    void discard_message(ConnectorMsgHandle*) override;
+    bool transmit_message(ConnectorMsgHandle*) override;
+    ConnectorMsgHandle* receive_message(bool) override;
+
+    ConnectorMsg* get_connector_msg(ConnectorMsgHandle* handle) override
+    { return( &((ShmemConnectorMsgHandle*)handle)->connector_msg ); }
+
+    Direction get_connector_direction() override
+    { return( ((ShmemConnectorConfig*)config)->direction ); }
+
+    std::string segment;
+
+private:
+    ShmemSlot* get_slot(uint32_t n)
+    { return (ShmemSlot*)(slots + (n & mask) * stride); }
+
+    void publish();
+    void release();
+
+    ShmemRing* ring = nullptr;
+    uint8_t* slots = nullptr;
+    size_t bytes = 0;
+    size_t stride = 0;
+    uint32_t mask = 0;
+
+    // local view of the ring; pending slots are lent out but not yet
+    // transmitted or discarded
+    uint32_t next = 0;
+    uint32_t pending = 0;
+
+    std::vector<ShmemConnectorMsgHandle> handles;
+    std::vector<uint8_t> done;
+};
+
+#endif
+
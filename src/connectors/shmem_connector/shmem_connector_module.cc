@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// shmem_connector_module.cc
+
+#include "shmem_connector_module.h"
+
+#include "main/snort_debug.h"
+
+static const Parameter shmem_connector_params[] =
+{
+    { "connector", Parameter::PT_STRING, nullptr, nullptr,
+      "connector name" },
+
+    { "name", Parameter::PT_STRING, nullptr, nullptr,
+      "channel name; the same at both ends" },
+
+    { "direction", Parameter::PT_ENUM, "receive | transmit", nullptr,
+      "usage" },
+
+    { "slots", Parameter::PT_INT, "2:65536", "1024",
+      "number of messages the ring holds, rounded up to a power of 2" },
+
+    { "size", Parameter::PT_INT, "16:65536", "1040",
+      "largest message in bytes including the side channel header" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
+static const PegInfo shmem_connector_pegs[] =
+{
+    { "transmits", "messages written to the ring" },
+    { "receives", "messages read from the ring" },
+    { "drops", "messages dropped because the ring was full or they were too big" },
+    { "wakeups", "times the transmitter woke a waiting receiver" },
+    { nullptr, nullptr }
+};
+
+extern THREAD_LOCAL ShmemConnectorStats shmem_connector_stats;
+extern THREAD_LOCAL ProfileStats shmem_connector_perfstats;
+
+//-------------------------------------------------------------------------
+// shmem_connector module
+//-------------------------------------------------------------------------
+
+ShmemConnectorModule::ShmemConnectorModule() :
+    Module(SHMEM_CONNECTOR_NAME, SHMEM_CONNECTOR_HELP, shmem_connector_params)
+{
+    config = nullptr;
+    config_set = new ShmemConnectorConfig::ShmemConnectorConfigSet;
+}
+
+ShmemConnectorModule::~ShmemConnectorModule()
+{
+    delete config;
+    delete config_set;
+}
+
+ProfileStats* ShmemConnectorModule::get_profile() const
+{ return &shmem_connector_perfstats; }
+
+bool ShmemConnectorModule::set(const char*, Value& v, SnortConfig*)
+{
+    if ( v.is("connector") )
+        config->connector_name = v.get_string();
+
+    else if ( v.is("name") )
+        config->name = v.get_string();
+
+    else if ( v.is("direction") )
+    {
+        switch ( v.get_long() )
+        {
+        case 0:
+            config->direction = Connector::CONN_RECEIVE;
+            break;
+
+        case 1:
+            config->direction = Connector::CONN_TRANSMIT;
+            break;
+
+        default:
+            return false;
+        }
+    }
+
+    else if ( v.is("slots") )
+        config->slots = v.get_long();
+
+    else if ( v.is("size") )
+        config->size = v.get_long();
+
+    else
+        return false;
+
+    return true;
+}
+
+// clear my working config and hand-over the compiled list to the caller
+ShmemConnectorConfig::ShmemConnectorConfigSet* ShmemConnectorModule::get_and_clear_config()
+{
+    ShmemConnectorConfig::ShmemConnectorConfigSet* temp_config = config_set;
+    config = nullptr;
+    config_set = nullptr;
+    return temp_config;
+}
+
+bool ShmemConnectorModule::begin(const char*, int, SnortConfig*)
+{
+    if ( !config )
+        config = new ShmemConnectorConfig;
+
+    return true;
+}
+
+bool ShmemConnectorModule::end(const char*, int idx, SnortConfig*)
+{
+    if ( idx != 0 )
+    {
+        config_set->push_back(config);
+        config = nullptr;
+    }
+    return true;
+}
+
+const PegInfo* ShmemConnectorModule::get_pegs() const
+{ return shmem_connector_pegs; }
+
+PegCount* ShmemConnectorModule::get_counts() const
+{ return (PegCount*)&shmem_connector_stats; }
+
@@ -0,0 +1,177 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// shmem_connector_test.cc
+
+#include "connectors/shmem_connector/shmem_connector.h"
+#include "connectors/shmem_connector/shmem_connector_module.h"
+
+#include <string.h>
+
+#include "main/snort_debug.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+extern const BaseApi* shmem_connector;
+static ConnectorApi* sc_api = nullptr;
+
+static ShmemConnectorConfig tx_config;
+static ShmemConnectorConfig rx_config;
+
+void ErrorMessage(const char*, ...) { }
+
+const char* get_error(int) { return ""; }
+
+unsigned get_instance_id() { return 0; }
+
+void Debug::print(const char*, int, uint64_t, const char*, ...) { }
+
+ShmemConnectorModule::ShmemConnectorModule() :
+    Module("SC", "SC Help", nullptr)
+{ }
+
+ShmemConnectorModule::~ShmemConnectorModule() { }
+
+ShmemConnectorConfig::ShmemConnectorConfigSet* ShmemConnectorModule::get_and_clear_config()
+{ return new ShmemConnectorConfig::ShmemConnectorConfigSet; }
+
+ProfileStats* ShmemConnectorModule::get_profile() const { return nullptr; }
+
+bool ShmemConnectorModule::set(const char*, Value&, SnortConfig*) { return true; }
+
+bool ShmemConnectorModule::begin(const char*, int, SnortConfig*) { return true; }
+
+bool ShmemConnectorModule::end(const char*, int, SnortConfig*) { return true; }
+
+const PegInfo* ShmemConnectorModule::get_pegs() const { return nullptr; }
+
+PegCount* ShmemConnectorModule::get_counts() const { return nullptr; }
+
+static bool send(Connector* tx, const char* s, uint32_t len = 0)
+{
+    const uint8_t* data = nullptr;
+    uint32_t n = len ? len : strlen(s) + 1;
+    ConnectorMsgHandle* h = tx->alloc_message(n, &data);
+    memcpy((uint8_t*)data, s, strlen(s) + 1);
+    return tx->transmit_message(h);
+}
+
+TEST_GROUP(shmem_connector)
+{
+    Connector* tx = nullptr;
+    Connector* rx = nullptr;
+
+    void setup()
+    {
+        // FIXIT-L workaround for CppUTest mem leak detector issue
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+        sc_api = (ConnectorApi*)shmem_connector;
+
+        tx_config.direction = Connector::CONN_TRANSMIT;
+        tx_config.name = "test";
+        tx_config.slots = 3;
+        tx_config.size = 64;
+
+        rx_config.direction = Connector::CONN_RECEIVE;
+        rx_config.name = "test";
+        rx_config.slots = 3;
+        rx_config.size = 64;
+
+        tx = sc_api->tinit(&tx_config);
+        rx = sc_api->tinit(&rx_config);
+    }
+
+    void teardown()
+    {
+        sc_api->tterm(tx);
+        sc_api->tterm(rx);
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+TEST(shmem_connector, transmit_receive)
+{
+    CHECK(tx != nullptr);
+    CHECK(rx != nullptr);
+    CHECK(rx->receive_message(false) == nullptr);
+
+    CHECK(send(tx, "one"));
+    CHECK(send(tx, "two"));
+
+    ConnectorMsgHandle* h1 = rx->receive_message(false);
+    ConnectorMsgHandle* h2 = rx->receive_message(true);
+    CHECK(h1 != nullptr);
+    CHECK(h2 != nullptr);
+    CHECK(rx->receive_message(true) == nullptr);
+
+    STRCMP_EQUAL("one", (char*)rx->get_connector_msg(h1)->data);
+    STRCMP_EQUAL("two", (char*)rx->get_connector_msg(h2)->data);
+    CHECK(rx->get_connector_msg(h1)->length == 4);
+
+    // out of order release
+    rx->discard_message(h2);
+    rx->discard_message(h1);
+}
+
+TEST(shmem_connector, full)
+{
+    // slots round up to 4
+    CHECK(send(tx, "1"));
+    CHECK(send(tx, "2"));
+    CHECK(send(tx, "3"));
+    CHECK(send(tx, "4"));
+    CHECK_FALSE(send(tx, "5"));
+
+    ConnectorMsgHandle* h = rx->receive_message(false);
+    STRCMP_EQUAL("1", (char*)rx->get_connector_msg(h)->data);
+    rx->discard_message(h);
+
+    CHECK(send(tx, "6"));
+
+    for ( const char* s : { "2", "3", "4", "6" } )
+    {
+        h = rx->receive_message(false);
+        CHECK(h != nullptr);
+        STRCMP_EQUAL(s, (char*)rx->get_connector_msg(h)->data);
+        rx->discard_message(h);
+    }
+    CHECK(rx->receive_message(false) == nullptr);
+}
+
+TEST(shmem_connector, discard_oversize)
+{
+    const uint8_t* data = nullptr;
+    ConnectorMsgHandle* h = tx->alloc_message(8, &data);
+    tx->discard_message(h);
+
+    CHECK_FALSE(send(tx, "big", 65));
+    CHECK(send(tx, "ok"));
+
+    h = rx->receive_message(false);
+    CHECK(h != nullptr);
+    STRCMP_EQUAL("ok", (char*)rx->get_connector_msg(h)->data);
+    rx->discard_message(h);
+    CHECK(rx->receive_message(false) == nullptr);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
@@ -0,0 +1,620 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// tcp_connector.cc
+
+#include "tcp_connector.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "tcp_connector_module.h"
+#include "log/messages.h"
+#include "main/snort_debug.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* Globals ****************************************************************/
+
+THREAD_LOCAL TcpConnectorStats tcp_connector_stats;
+THREAD_LOCAL ProfileStats tcp_connector_perfstats;
+
+// how long the connector thread waits for something to do and how long a
+// blocking receive waits for a message
+#define TCP_POLL_MS 100
+
+//-------------------------------------------------------------------------
+// class stuff
+//-------------------------------------------------------------------------
+
+TcpConnectorMsgHandle::TcpConnectorMsgHandle(const uint32_t length)
+{
+    capacity = length;
+    buffer = new uint8_t[sizeof(TcpConnectorMsgHdr) + length];
+    connector_msg.length = length;
+    connector_msg.data = buffer + sizeof(TcpConnectorMsgHdr);
+}
+
+TcpConnectorMsgHandle::~TcpConnectorMsgHandle()
+{
+    delete[] buffer;
+}
+
+void TcpConnectorMsgHandle::resize(const uint32_t length)
+{
+    if ( length > capacity )
+    {
+        delete[] buffer;
+        capacity = length;
+        buffer = new uint8_t[sizeof(TcpConnectorMsgHdr) + length];
+        connector_msg.data = buffer + sizeof(TcpConnectorMsgHdr);
+    }
+    connector_msg.length = length;
+}
+
+TcpConnectorCommon::TcpConnectorCommon(TcpConnectorConfig::TcpConnectorConfigSet* conf)
+{
+    config_set = (ConnectorConfig::ConfigSet*)conf;
+}
+
+TcpConnectorCommon::~TcpConnectorCommon()
+{
+    for ( auto conf : *config_set )
+        delete conf;
+
+    config_set->clear();
+    delete config_set;
+}
+
+TcpConnector::TcpConnector(TcpConnectorConfig* tcp_connector_config, unsigned short port)
+{
+    DebugMessage(DEBUG_CONNECTORS,"TcpConnector::TcpConnector()\n");
+    config = tcp_connector_config;
+
+    const char* s = tcp_connector_config->address.c_str();
+    struct sockaddr_in* sin = (struct sockaddr_in*)&addr;
+    struct sockaddr_in6* sin6 = (struct sockaddr_in6*)&addr;
+    memset(&addr, 0, sizeof(addr));
+
+    if ( inet_pton(AF_INET, s, &sin->sin_addr) == 1 )
+    {
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(port);
+        addr_len = sizeof(*sin);
+    }
+    else if ( inet_pton(AF_INET6, s, &sin6->sin6_addr) == 1 )
+    {
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(port);
+        addr_len = sizeof(*sin6);
+    }
+    else
+    {
+        // without a thread the connector drops everything it is given
+        ErrorMessage("tcp_connector: invalid address %s\n", s);
+        return;
+    }
+
+    if ( get_connector_direction() == Connector::CONN_RECEIVE )
+        stream.resize(sizeof(TcpConnectorMsgHdr) + TCP_MAX_MSG_LEN);
+
+    batch.reserve(tcp_connector_config->batch);
+    iov.reserve(tcp_connector_config->batch);
+
+    io = new std::thread(&TcpConnector::run, this);
+}
+
+TcpConnector::~TcpConnector()
+{
+    DebugMessage(DEBUG_CONNECTORS,"TcpConnector::~TcpConnector()\n");
+
+    if ( io )
+    {
+        {
+            std::lock_guard<std::mutex> hold(lock);
+            stop = true;
+        }
+        ready.notify_all();
+        space.notify_all();
+        io->join();
+        delete io;
+    }
+
+    disconnect();
+
+    if ( listener >= 0 )
+        close(listener);
+
+    for ( auto h : queue )
+        delete h;
+
+    for ( auto h : free_handles )
+        delete h;
+}
+
+//-------------------------------------------------------------------------
+// queue - shared by the packet and connector threads
+//-------------------------------------------------------------------------
+
+// call with lock held
+TcpConnectorMsgHandle* TcpConnector::get_handle(uint32_t length)
+{
+    if ( free_handles.empty() )
+        return new TcpConnectorMsgHandle(length);
+
+    TcpConnectorMsgHandle* h = free_handles.back();
+    free_handles.pop_back();
+    h->resize(length);
+    return h;
+}
+
+// enough are kept for a full batch in flight
+void TcpConnector::put_handle(TcpConnectorMsgHandle* h)
+{
+    if ( free_handles.size() < ((TcpConnectorConfig*)config)->batch )
+        free_handles.push_back(h);
+    else
+        delete h;
+}
+
+// a full queue drops its oldest message or waits for the other thread;
+// waiting is only useful while there is a partner to push back on
+bool TcpConnector::make_room(std::unique_lock<std::mutex>& hold)
+{
+    TcpConnectorConfig* cfg = (TcpConnectorConfig*)config;
+
+    if ( queue.size() < cfg->queue_size )
+        return true;
+
+    if ( cfg->block and connected )
+    {
+        blocks++;
+        space.wait(hold, [this, cfg]()
+            { return stop or !connected or queue.size() < cfg->queue_size; });
+
+        if ( stop )
+            return false;
+
+        if ( queue.size() < cfg->queue_size )
+            return true;
+    }
+
+    put_handle(queue.front());
+    queue.pop_front();
+    drops++;
+    return true;
+}
+
+static inline void add_stat(PegCount& pc, std::atomic<PegCount>& n)
+{
+    if ( n.load(std::memory_order_relaxed) )
+        pc += n.exchange(0);
+}
+
+void TcpConnector::update_stats()
+{
+    add_stat(tcp_connector_stats.drops, drops);
+    add_stat(tcp_connector_stats.blocks, blocks);
+    add_stat(tcp_connector_stats.writes, writes);
+    add_stat(tcp_connector_stats.reads, reads);
+    add_stat(tcp_connector_stats.connects, connects);
+}
+
+//-------------------------------------------------------------------------
+// packet thread
+//-------------------------------------------------------------------------
+
+ConnectorMsgHandle* TcpConnector::alloc_message(const uint32_t length, const uint8_t** data)
+{
+    std::lock_guard<std::mutex> hold(lock);
+    TcpConnectorMsgHandle* h = get_handle(length);
+    *data = (uint8_t*)h->connector_msg.data;
+    return h;
+}
+
+void TcpConnector::discard_message(ConnectorMsgHandle* msg)
+{
+    std::lock_guard<std::mutex> hold(lock);
+    put_handle((TcpConnectorMsgHandle*)msg);
+}
+
+bool TcpConnector::transmit_message(ConnectorMsgHandle* msg)
+{
+    TcpConnectorMsgHandle* h = (TcpConnectorMsgHandle*)msg;
+    TcpConnectorMsgHdr* hdr = (TcpConnectorMsgHdr*)h->buffer;
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->version = TCP_FORMAT_VERSION;
+    hdr->length = htonl(h->connector_msg.length);
+
+    std::unique_lock<std::mutex> hold(lock);
+    bool ok = io and h->connector_msg.length <= TCP_MAX_MSG_LEN and make_room(hold);
+
+    if ( ok )
+    {
+        queue.push_back(h);
+        tcp_connector_stats.transmits++;
+    }
+    else
+    {
+        put_handle(h);
+        drops++;
+    }
+    hold.unlock();
+
+    // no system call unless the connector thread is idle
+    if ( ok )
+        ready.notify_one();
+
+    update_stats();
+    return ok;
+}
+
+ConnectorMsgHandle* TcpConnector::receive_message(bool block)
+{
+    std::unique_lock<std::mutex> hold(lock);
+
+    if ( queue.empty() and block and io )
+        ready.wait_for(hold, std::chrono::milliseconds(TCP_POLL_MS));
+
+    TcpConnectorMsgHandle* h = nullptr;
+
+    if ( !queue.empty() )
+    {
+        h = queue.front();
+        queue.pop_front();
+        tcp_connector_stats.receives++;
+    }
+    hold.unlock();
+
+    if ( h )
+        space.notify_one();
+
+    update_stats();
+    return h;
+}
+
+//-------------------------------------------------------------------------
+// connector thread
+//-------------------------------------------------------------------------
+
+bool TcpConnector::connect_partner()
+{
+    if ( ((TcpConnectorConfig*)config)->setup == TcpConnectorConfig::ANSWER )
+    {
+        if ( listener < 0 )
+        {
+            int on = 1;
+            listener = socket(addr.ss_family, SOCK_STREAM, 0);
+
+            if ( listener < 0 or
+                setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) or
+                bind(listener, (struct sockaddr*)&addr, addr_len) or listen(listener, 1) )
+            {
+                if ( listener >= 0 )
+                    close(listener);
+
+                listener = -1;
+                return false;
+            }
+        }
+
+        struct pollfd pfd = { listener, POLLIN, 0 };
+
+        if ( poll(&pfd, 1, TCP_POLL_MS) <= 0 )
+            return false;
+
+        fd = accept(listener, nullptr, nullptr);
+    }
+    else
+    {
+        fd = socket(addr.ss_family, SOCK_STREAM, 0);
+
+        if ( fd >= 0 and connect(fd, (struct sockaddr*)&addr, addr_len) )
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    if ( fd < 0 )
+        return false;
+
+    // writes are already coalesced
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    have = 0;
+    connected = true;
+    connects++;
+    return true;
+}
+
+// whatever was queued for a lost partner is dropped as the queue fills
+void TcpConnector::disconnect()
+{
+    if ( fd < 0 )
+        return;
+
+    close(fd);
+    fd = -1;
+
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        connected = false;
+    }
+    space.notify_all();
+}
+
+void TcpConnector::run()
+{
+    while ( !stop )
+    {
+        if ( fd < 0 and !connect_partner() )
+        {
+            // answer waits in poll unless it can't listen
+            if ( listener < 0 and !stop )
+                std::this_thread::sleep_for(std::chrono::milliseconds(TCP_POLL_MS));
+
+            continue;
+        }
+
+        if ( get_connector_direction() == Connector::CONN_TRANSMIT )
+            transmit_batch();
+        else
+            receive_stream();
+    }
+}
+
+// everything queued, up to batch, goes out in one system call
+void TcpConnector::transmit_batch()
+{
+    TcpConnectorConfig* cfg = (TcpConnectorConfig*)config;
+    {
+        std::unique_lock<std::mutex> hold(lock);
+        ready.wait_for(hold, std::chrono::milliseconds(TCP_POLL_MS),
+            [this]() { return stop or !queue.empty(); });
+
+        while ( !queue.empty() and batch.size() < cfg->batch )
+        {
+            batch.push_back(queue.front());
+            queue.pop_front();
+        }
+    }
+
+    if ( batch.empty() )
+        return;
+
+    space.notify_all();
+
+    for ( auto h : batch )
+    {
+        struct iovec v = { h->buffer, sizeof(TcpConnectorMsgHdr) + h->connector_msg.length };
+        iov.push_back(v);
+    }
+
+    size_t i = 0;
+
+    while ( i < iov.size() )
+    {
+        struct msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_iov = &iov[i];
+        mh.msg_iovlen = iov.size() - i;
+
+        ssize_t n = sendmsg(fd, &mh, MSG_NOSIGNAL);
+
+        if ( n < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+            break;
+        }
+        writes++;
+
+        while ( i < iov.size() and (size_t)n >= iov[i].iov_len )
+            n -= iov[i++].iov_len;
+
+        if ( n )
+        {
+            iov[i].iov_base = (uint8_t*)iov[i].iov_base + n;
+            iov[i].iov_len -= n;
+        }
+    }
+
+    if ( i < iov.size() )
+    {
+        drops += iov.size() - i;
+        disconnect();
+    }
+    iov.clear();
+
+    std::lock_guard<std::mutex> hold(lock);
+
+    for ( auto h : batch )
+        put_handle(h);
+
+    batch.clear();
+}
+
+// a read may carry many messages and end in the middle of one
+void TcpConnector::receive_stream()
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+
+    if ( poll(&pfd, 1, TCP_POLL_MS) <= 0 )
+        return;
+
+    ssize_t n = recv(fd, stream.data() + have, stream.size() - have, 0);
+
+    if ( n <= 0 )
+    {
+        if ( n < 0 and errno == EINTR )
+            return;
+
+        disconnect();
+        return;
+    }
+    reads++;
+    have += n;
+
+    uint32_t off = 0;
+    TcpConnectorMsgHdr hdr;
+
+    while ( have - off >= sizeof(hdr) )
+    {
+        memcpy(&hdr, stream.data() + off, sizeof(hdr));
+        uint32_t length = ntohl(hdr.length);
+
+        if ( hdr.version != TCP_FORMAT_VERSION or length > TCP_MAX_MSG_LEN )
+        {
+            ErrorMessage("tcp_connector: invalid message from partner\n");
+            disconnect();
+            return;
+        }
+
+        if ( have - off < sizeof(hdr) + length )
+            break;
+
+        deliver(stream.data() + off + sizeof(hdr), length);
+        off += sizeof(hdr) + length;
+
+        if ( stop )
+            return;
+    }
+
+    if ( off )
+    {
+        memmove(stream.data(), stream.data() + off, have - off);
+        have -= off;
+    }
+}
+
+void TcpConnector::deliver(const uint8_t* data, uint32_t length)
+{
+    std::unique_lock<std::mutex> hold(lock);
+
+    if ( !make_room(hold) )
+        return;
+
+    TcpConnectorMsgHandle* h = get_handle(length);
+    memcpy(h->connector_msg.data, data, length);
+    queue.push_back(h);
+    hold.unlock();
+
+    ready.notify_one();
+}
+
+//-------------------------------------------------------------------------
+// api stuff
+//-------------------------------------------------------------------------
+
+static Module* mod_ctor()
+{
+    return new TcpConnectorModule;
+}
+
+static void mod_dtor(Module* m)
+{
+    delete m;
+}
+
+// each packet thread has its own connection to the same instance of the
+// partner
+static Connector* tcp_connector_tinit(ConnectorConfig* config)
+{
+    TcpConnectorConfig* cfg = (TcpConnectorConfig*)config;
+
+    if ( cfg->direction != Connector::CONN_TRANSMIT and
+        cfg->direction != Connector::CONN_RECEIVE )
+        return nullptr;
+
+    unsigned port = cfg->base_port + get_instance_id();
+
+    if ( !cfg->base_port or port > 65535 )
+    {
+        ErrorMessage("tcp_connector: invalid port %u\n", port);
+        return nullptr;
+    }
+
+    TcpConnector* tcp_connector = new TcpConnector(cfg, (unsigned short)port);
+
+    DebugFormat(DEBUG_CONNECTORS,"tcp_connector:tcp_connector_tinit(): %s:%u\n",
+        cfg->address.c_str(), port);
+
+    return tcp_connector;
+}
+
+static void tcp_connector_tterm(Connector* connector)
+{
+    delete (TcpConnector*)connector;
+}
+
+static ConnectorCommon* tcp_connector_ctor(Module* m)
+{
+    TcpConnectorModule* mod = (TcpConnectorModule*)m;
+    return new TcpConnectorCommon(mod->get_and_clear_config());
+}
+
+static void tcp_connector_dtor(ConnectorCommon* c)
+{
+    delete (TcpConnectorCommon*)c;
+}
+
+const ConnectorApi tcp_connector_api =
+{
+    {
+        PT_CONNECTOR,
+        sizeof(ConnectorApi),
+        CONNECTOR_API_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        TCP_CONNECTOR_NAME,
+        TCP_CONNECTOR_HELP,
+        mod_ctor,
+        mod_dtor
+    },
+    0,
+    nullptr,
+    nullptr,
+    tcp_connector_tinit,
+    tcp_connector_tterm,
+    tcp_connector_ctor,
+    tcp_connector_dtor
+};
+
+#ifdef BUILDING_SO
+SO_PUBLIC const BaseApi* snort_plugins[] =
+{
+    &tcp_connector_api.base,
+    nullptr
+};
+#else
+const BaseApi* tcp_connector = &tcp_connector_api.base;
+#endif
+
@@ -0,0 +1,139 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// tcp_connector.h
+
+#ifndef TCP_CONNECTOR_H
+#define TCP_CONNECTOR_H
+
+// a simplex stream to an ha partner.  all socket i/o is done on a
+// connector thread so packet threads only queue and dequeue messages;
+// queued messages are coalesced into one write.
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tcp_connector_config.h"
+#include "framework/connector.h"
+#include "framework/counts.h"
+#include "main/thread.h"
+#include "profiler/profiler.h"
+
+#define TCP_FORMAT_VERSION 1
+
+// the most a partner may send in one message
+#define TCP_MAX_MSG_LEN 65536
+
+// every message on the wire is preceded by this
+struct TcpConnectorMsgHdr
+{
+    uint8_t version;
+    uint8_t reserved[3];
+    uint32_t length;  // network order; excludes this header
+};
+
+// the header is built in front of the data so each message is one iovec
+class TcpConnectorMsgHandle : public ConnectorMsgHandle
+{
+public:
+    TcpConnectorMsgHandle(const uint32_t length);
+    ~TcpConnectorMsgHandle();
+
+    void resize(const uint32_t length);
+
+    uint8_t* buffer;
+    uint32_t capacity;
+    ConnectorMsg connector_msg;
+};
+
+class TcpConnectorCommon : public ConnectorCommon
+{
+public:
+    TcpConnectorCommon(TcpConnectorConfig::TcpConnectorConfigSet*);
+    ~TcpConnectorCommon();
+};
+
+class TcpConnector : public Connector
+{
+public:
+    TcpConnector(TcpConnectorConfig*, unsigned short port);
+    ~TcpConnector();
+
+    ConnectorMsgHandle* alloc_message(const uint32_t, const uint8_t**) override;
+    void discard_message(ConnectorMsgHandle*) override;
+    bool transmit_message(ConnectorMsgHandle*) override;
+    ConnectorMsgHandle* receive_message(bool) override;
+
+    ConnectorMsg* get_connector_msg(ConnectorMsgHandle* handle) override
+    { return( &((TcpConnectorMsgHandle*)handle)->connector_msg ); }
+
+    Direction get_connector_direction() override
+    { return( ((TcpConnectorConfig*)config)->direction ); }
+
+private:
+    // connector thread
+    void run();
+    bool connect_partner();
+    void disconnect();
+    void transmit_batch();
+    void receive_stream();
+    void deliver(const uint8_t*, uint32_t);
+
+    // call with lock held
+    TcpConnectorMsgHandle* get_handle(uint32_t length);
+    void put_handle(TcpConnectorMsgHandle*);
+    bool make_room(std::unique_lock<std::mutex>&);
+
+    void update_stats();
+
+    struct sockaddr_storage addr;
+    socklen_t addr_len = 0;
+    int fd = -1;
+    int listener = -1;
+    std::vector<uint8_t> stream;  // partial receives
+    uint32_t have = 0;
+    std::vector<TcpConnectorMsgHandle*> batch;
+    std::vector<struct iovec> iov;
+
+    std::thread* io = nullptr;
+    std::atomic<bool> stop { false };
+    std::atomic<bool> connected { false };
+
+    std::mutex lock;
+    std::condition_variable ready;  // queue is no longer empty
+    std::condition_variable space;  // queue is no longer full
+    std::deque<TcpConnectorMsgHandle*> queue;
+    std::vector<TcpConnectorMsgHandle*> free_handles;
+
+    // counted on either thread and added to the packet thread's stats
+    std::atomic<PegCount> drops { 0 };
+    std::atomic<PegCount> blocks { 0 };
+    std::atomic<PegCount> writes { 0 };
+    std::atomic<PegCount> reads { 0 };
+    std::atomic<PegCount> connects { 0 };
+};
+
+#endif
+
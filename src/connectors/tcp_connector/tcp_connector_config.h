@@ -0,0 +1,53 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// tcp_connector_config.h
+
+#ifndef TCP_CONNECTOR_CONFIG_H
+#define TCP_CONNECTOR_CONFIG_H
+
+#include <string>
+#include <vector>
+
+#include "framework/connector.h"
+
+class TcpConnectorConfig : public ConnectorConfig
+{
+public:
+    enum Setup { CALL, ANSWER };
+
+    TcpConnectorConfig()
+    {
+        direction = Connector::CONN_UNDEFINED; setup = CALL;
+        base_port = 0; queue_size = 1024; batch = 64; block = false;
+    }
+
+    // instance i uses base_port + i on address
+    std::string address;
+    unsigned short base_port;
+    Setup setup;
+
+    unsigned queue_size;  // messages held for or from the connector thread
+    unsigned batch;       // most messages coalesced into one write
+    bool block;           // a full queue blocks instead of dropping the oldest
+
+    typedef std::vector<TcpConnectorConfig*> TcpConnectorConfigSet;
+};
+
+#endif
+
@@ -0,0 +1,167 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// tcp_connector_module.cc
+
+#include "tcp_connector_module.h"
+
+#include "main/snort_debug.h"
+
+static const Parameter tcp_connector_params[] =
+{
+    { "connector", Parameter::PT_STRING, nullptr, nullptr,
+      "connector name" },
+
+    { "address", Parameter::PT_STRING, nullptr, "127.0.0.1",
+      "ip4 or ip6 address to call or answer on" },
+
+    { "base_port", Parameter::PT_PORT, "1:", nullptr,
+      "port for instance 0; instance i uses base_port + i" },
+
+    { "setup", Parameter::PT_ENUM, "call | answer", "call",
+      "connect to the partner or wait for it to connect" },
+
+    { "direction", Parameter::PT_ENUM, "receive | transmit", nullptr,
+      "usage" },
+
+    { "queue_size", Parameter::PT_INT, "1:65536", "1024",
+      "most messages waiting for or from the connector thread" },
+
+    { "batch", Parameter::PT_INT, "1:1024", "64",
+      "most messages coalesced into one write" },
+
+    { "backpressure", Parameter::PT_ENUM, "drop_oldest | block", "drop_oldest",
+      "what a full queue does to the packet thread when the partner is connected" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
+static const PegInfo tcp_connector_pegs[] =
+{
+    { "transmits", "messages queued for transmit" },
+    { "receives", "messages received" },
+    { "drops", "messages dropped because a queue was full" },
+    { "blocks", "times a packet thread waited for queue space" },
+    { "writes", "socket writes" },
+    { "reads", "socket reads" },
+    { "connects", "connections established" },
+    { nullptr, nullptr }
+};
+
+extern THREAD_LOCAL TcpConnectorStats tcp_connector_stats;
+extern THREAD_LOCAL ProfileStats tcp_connector_perfstats;
+
+//-------------------------------------------------------------------------
+// tcp_connector module
+//-------------------------------------------------------------------------
+
+TcpConnectorModule::TcpConnectorModule() :
+    Module(TCP_CONNECTOR_NAME, TCP_CONNECTOR_HELP, tcp_connector_params)
+{
+    config = nullptr;
+    config_set = new TcpConnectorConfig::TcpConnectorConfigSet;
+}
+
+TcpConnectorModule::~TcpConnectorModule()
+{
+    delete config;
+    delete config_set;
+}
+
+ProfileStats* TcpConnectorModule::get_profile() const
+{ return &tcp_connector_perfstats; }
+
+bool TcpConnectorModule::set(const char*, Value& v, SnortConfig*)
+{
+    if ( v.is("connector") )
+        config->connector_name = v.get_string();
+
+    else if ( v.is("address") )
+        config->address = v.get_string();
+
+    else if ( v.is("base_port") )
+        config->base_port = v.get_long();
+
+    else if ( v.is("setup") )
+        config->setup = v.get_long() ? TcpConnectorConfig::ANSWER : TcpConnectorConfig::CALL;
+
+    else if ( v.is("direction") )
+    {
+        switch ( v.get_long() )
+        {
+        case 0:
+            config->direction = Connector::CONN_RECEIVE;
+            break;
+
+        case 1:
+            config->direction = Connector::CONN_TRANSMIT;
+            break;
+
+        default:
+            return false;
+        }
+    }
+
+    else if ( v.is("queue_size") )
+        config->queue_size = v.get_long();
+
+    else if ( v.is("batch") )
+        config->batch = v.get_long();
+
+    else if ( v.is("backpressure") )
+        config->block = v.get_long() == 1;
+
+    else
+        return false;
+
+    return true;
+}
+
+// clear my working config and hand-over the compiled list to the caller
+TcpConnectorConfig::TcpConnectorConfigSet* TcpConnectorModule::get_and_clear_config()
+{
+    TcpConnectorConfig::TcpConnectorConfigSet* temp_config = config_set;
+    config = nullptr;
+    config_set = nullptr;
+    return temp_config;
+}
+
+bool TcpConnectorModule::begin(const char*, int, SnortConfig*)
+{
+    if ( !config )
+        config = new TcpConnectorConfig;
+
+    return true;
+}
+
+bool TcpConnectorModule::end(const char*, int idx, SnortConfig*)
+{
+    if ( idx != 0 )
+    {
+        config_set->push_back(config);
+        config = nullptr;
+    }
+    return true;
+}
+
+const PegInfo* TcpConnectorModule::get_pegs() const
+{ return tcp_connector_pegs; }
+
+PegCount* TcpConnectorModule::get_counts() const
+{ return (PegCount*)&tcp_connector_stats; }
+
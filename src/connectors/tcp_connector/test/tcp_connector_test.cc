@@ -0,0 +1,171 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// tcp_connector_test.cc
+
+#include "connectors/tcp_connector/tcp_connector.h"
+#include "connectors/tcp_connector/tcp_connector_module.h"
+
+#include <string.h>
+
+#include "main/snort_debug.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+extern const BaseApi* tcp_connector;
+extern THREAD_LOCAL TcpConnectorStats tcp_connector_stats;
+static ConnectorApi* tc_api = nullptr;
+
+static TcpConnectorConfig tx_config;
+static TcpConnectorConfig rx_config;
+
+void ErrorMessage(const char*, ...) { }
+
+unsigned get_instance_id() { return 0; }
+
+void Debug::print(const char*, int, uint64_t, const char*, ...) { }
+
+TcpConnectorModule::TcpConnectorModule() :
+    Module("TC", "TC Help", nullptr)
+{ }
+
+TcpConnectorModule::~TcpConnectorModule() { }
+
+TcpConnectorConfig::TcpConnectorConfigSet* TcpConnectorModule::get_and_clear_config()
+{ return new TcpConnectorConfig::TcpConnectorConfigSet; }
+
+ProfileStats* TcpConnectorModule::get_profile() const { return nullptr; }
+
+bool TcpConnectorModule::set(const char*, Value&, SnortConfig*) { return true; }
+
+bool TcpConnectorModule::begin(const char*, int, SnortConfig*) { return true; }
+
+bool TcpConnectorModule::end(const char*, int, SnortConfig*) { return true; }
+
+const PegInfo* TcpConnectorModule::get_pegs() const { return nullptr; }
+
+PegCount* TcpConnectorModule::get_counts() const { return nullptr; }
+
+static bool send(Connector* tx, const char* s)
+{
+    const uint8_t* data = nullptr;
+    ConnectorMsgHandle* h = tx->alloc_message(strlen(s) + 1, &data);
+    memcpy((uint8_t*)data, s, strlen(s) + 1);
+    return tx->transmit_message(h);
+}
+
+// the partner may take a few polls to connect
+static ConnectorMsgHandle* receive(Connector* rx)
+{
+    ConnectorMsgHandle* h = nullptr;
+
+    for ( int i = 0; i < 50 and !h; ++i )
+        h = rx->receive_message(true);
+
+    return h;
+}
+
+TEST_GROUP(tcp_connector)
+{
+    void setup()
+    {
+        // FIXIT-L workaround for CppUTest mem leak detector issue
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+        tc_api = (ConnectorApi*)tcp_connector;
+
+        tx_config.direction = Connector::CONN_TRANSMIT;
+        tx_config.address = "127.0.0.1";
+        tx_config.base_port = 47123;
+        tx_config.setup = TcpConnectorConfig::CALL;
+        tx_config.queue_size = 2;
+
+        rx_config.direction = Connector::CONN_RECEIVE;
+        rx_config.address = "127.0.0.1";
+        rx_config.base_port = 47123;
+        rx_config.setup = TcpConnectorConfig::ANSWER;
+
+        memset(&tcp_connector_stats, 0, sizeof(tcp_connector_stats));
+    }
+
+    void teardown()
+    {
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+TEST(tcp_connector, bad_config)
+{
+    tx_config.base_port = 0;
+    CHECK(tc_api->tinit(&tx_config) == nullptr);
+
+    tx_config.base_port = 47123;
+    tx_config.direction = Connector::CONN_DUPLEX;
+    CHECK(tc_api->tinit(&tx_config) == nullptr);
+}
+
+TEST(tcp_connector, drop_oldest)
+{
+    // nobody answers so everything stays queued
+    Connector* tx = tc_api->tinit(&tx_config);
+    CHECK(tx != nullptr);
+
+    CHECK(send(tx, "1"));
+    CHECK(send(tx, "2"));
+    CHECK(send(tx, "3"));
+    CHECK(tcp_connector_stats.transmits == 3);
+    CHECK(tcp_connector_stats.drops == 1);
+
+    tc_api->tterm(tx);
+}
+
+TEST(tcp_connector, transmit_receive)
+{
+    tx_config.queue_size = 16;
+
+    Connector* rx = tc_api->tinit(&rx_config);
+    Connector* tx = tc_api->tinit(&tx_config);
+    CHECK(rx != nullptr);
+    CHECK(tx != nullptr);
+
+    CHECK(send(tx, "one"));
+    CHECK(send(tx, "two"));
+
+    ConnectorMsgHandle* h1 = receive(rx);
+    ConnectorMsgHandle* h2 = receive(rx);
+    CHECK(h1 != nullptr);
+    CHECK(h2 != nullptr);
+
+    STRCMP_EQUAL("one", (char*)rx->get_connector_msg(h1)->data);
+    STRCMP_EQUAL("two", (char*)rx->get_connector_msg(h2)->data);
+    CHECK(rx->get_connector_msg(h1)->length == 4);
+
+    rx->discard_message(h1);
+    rx->discard_message(h2);
+    CHECK(rx->receive_message(false) == nullptr);
+    CHECK(tcp_connector_stats.receives == 2);
+
+    tc_api->tterm(tx);
+    tc_api->tterm(rx);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
@@ -0,0 +1,143 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// deferred_work.cc
+
+#include "deferred_work.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <chrono>
+
+#include "main/thread.h"
+#include "time/clock_defs.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+#define MAX_DEFERRED 16
+
+struct DeferredNode
+{
+    DeferredHook hook;
+    void* arg;
+    bool more;
+};
+
+static THREAD_LOCAL DeferredNode s_nodes[MAX_DEFERRED];
+static THREAD_LOCAL unsigned s_count = 0;
+static THREAD_LOCAL unsigned s_next = 0;
+
+void DeferredWork::register_handler(DeferredHook hook, void* arg)
+{
+    if ( s_count < MAX_DEFERRED )
+        s_nodes[s_count++] = { hook, arg, true };
+}
+
+// each handler gets at least one call per pass so a budget of 0 still
+// makes progress.  the next call resumes with the handler after the last
+// one run so a slow handler can't starve the others.
+bool DeferredWork::execute(uint32_t usec)
+{
+    if ( !s_count )
+        return false;
+
+    hr_time end = hr_clock::now() + std::chrono::microseconds(usec);
+    unsigned idle = 0;
+
+    for ( unsigned i = 0; i < s_count; ++i )
+        s_nodes[i].more = true;
+
+    while ( idle < s_count )
+    {
+        DeferredNode& n = s_nodes[s_next];
+        s_next = (s_next + 1) % s_count;
+
+        if ( !n.more )
+        {
+            ++idle;
+            continue;
+        }
+
+        n.more = n.hook(n.arg);
+        idle = n.more ? 0 : idle + 1;
+
+        if ( hr_clock::now() >= end )
+            break;
+    }
+
+    for ( unsigned i = 0; i < s_count; ++i )
+        if ( s_nodes[i].more )
+            return true;
+
+    return false;
+}
+
+void DeferredWork::unregister_all()
+{ s_count = s_next = 0; }
+
+//--------------------------------------------------------------------------
+// tests
+//--------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+static unsigned s_calls1 = 0;
+static unsigned s_calls2 = 0;
+
+static bool dwh1(void* pv)
+{
+    s_calls1++;
+    return --*(unsigned*)pv > 0;
+}
+
+static bool dwh2(void*)
+{
+    s_calls2++;
+    return false;
+}
+
+TEST_CASE("deferred work", "[control]")
+{
+    unsigned backlog = 5;
+
+    DeferredWork::register_handler(dwh1, &backlog);
+    DeferredWork::register_handler(dwh2, nullptr);
+
+    SECTION("runs to completion")
+    {
+        CHECK(!DeferredWork::execute(1000000));
+        CHECK(backlog == 0);
+        CHECK(s_calls1 == 5);
+        CHECK(s_calls2 == 1);
+    }
+
+    SECTION("budget")
+    {
+        // a zero budget runs one handler per call
+        CHECK(DeferredWork::execute(0));
+        CHECK(DeferredWork::execute(0));
+        CHECK(s_calls1 + s_calls2 == 2);
+    }
+
+    DeferredWork::unregister_all();
+    s_calls1 = s_calls2 = 0;
+}
+#endif
+
@@ -0,0 +1,47 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// deferred_work.h
+
+#ifndef DEFERRED_WORK_H
+#define DEFERRED_WORK_H
+
+// Per packet thread housekeeping that runs on a time budget instead of to
+// completion.  Handlers do a small slice of work per call and return true
+// if there is more to do.  execute() calls them round robin until none
+// have more to do or the budget is spent, so a big backlog is spread over
+// many bursts instead of stalling one.
+
+#include <cstdint>
+
+using DeferredHook = bool (*)(void*);
+
+class DeferredWork
+{
+public:
+    // packet thread; call from thread init
+    static void register_handler(DeferredHook, void*);
+
+    // run handlers for up to usec microseconds; returns true if some
+    // handler still has work
+    static bool execute(uint32_t usec);
+
+    static void unregister_all();
+};
+
+#endif
+
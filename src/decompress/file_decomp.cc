@@ -24,6 +24,7 @@
 
 #include "file_decomp.h"
 #include "main/snort_types.h"
+#include "main/thread.h"
 #include "utils/util.h"
 #include "detection/detection_util.h"
 #include "decompress/file_decomp_pdf.h"
@@ -69,7 +70,13 @@ static struct sig_map_s
 #define SIG_CHR_INDEX_MASK  (0x07)
 #define SIG_CHR_INDEX_SHIFT (0)
 
-static uint8_t File_Decomp_Buffer[DECODE_BLEN];
+static THREAD_LOCAL uint8_t File_Decomp_Buffer[DECODE_BLEN];
+
+/* Idle inflate engines on this thread */
+#define MAX_CACHED_INFLATE (8)
+
+static THREAD_LOCAL z_stream* Inflate_Cache[MAX_CACHED_INFLATE];
+static THREAD_LOCAL unsigned Inflate_Cached = 0;
 
 void keep_decomp_lib() { }
 
@@ -326,6 +333,9 @@ fd_session_p_t File_Decomp_New()
     New_Session->Avail_Out = 0;
     New_Session->Next_Out = NULL;
 
+    /* No decompression engine attached yet */
+    memset(&New_Session->Decomp_State, 0, sizeof(New_Session->Decomp_State));
+
     return New_Session;
 }
 
@@ -416,6 +426,60 @@ void File_Decomp_Free(fd_session_p_t SessionPtr)
     delete SessionPtr;
 }
 
+z_stream* File_Decomp_Get_Inflate(int Window_Bits)
+{
+    while ( Inflate_Cached > 0 )
+    {
+        z_stream* z_s = Inflate_Cache[--Inflate_Cached];
+
+        if ( inflateReset2(z_s, Window_Bits) == Z_OK )
+            return( z_s );
+
+        inflateEnd(z_s);
+        delete z_s;
+    }
+
+    z_stream* z_s = new z_stream;
+
+    memset( (char*)z_s, 0, sizeof(z_stream));
+
+    z_s->zalloc = (alloc_func)NULL;
+    z_s->zfree = (free_func)NULL;
+
+    if ( inflateInit2(z_s, Window_Bits) != Z_OK )
+    {
+        delete z_s;
+        return( NULL );
+    }
+
+    return( z_s );
+}
+
+void File_Decomp_Put_Inflate(z_stream* z_s)
+{
+    if ( z_s == NULL )
+        return;
+
+    if ( Inflate_Cached < MAX_CACHED_INFLATE )
+    {
+        Inflate_Cache[Inflate_Cached++] = z_s;
+        return;
+    }
+
+    inflateEnd(z_s);
+    delete z_s;
+}
+
+void File_Decomp_Thread_Term()
+{
+    while ( Inflate_Cached > 0 )
+    {
+        z_stream* z_s = Inflate_Cache[--Inflate_Cached];
+        inflateEnd(z_s);
+        delete z_s;
+    }
+}
+
 void File_Decomp_Alert(fd_session_p_t SessionPtr, int Event)
 {
     if ( (SessionPtr != NULL) && (SessionPtr->Alert_Callback != NULL) &&
@@ -527,4 +591,41 @@ TEST_CASE("Process_Decompression-not_active", "[file_decomp]")
     REQUIRE(Process_Decompression(p_s) == File_Decomp_Error);
 }
 
+TEST_CASE("File_Decomp_Get_Inflate-reuse", "[file_decomp]")
+{
+    uint8_t data[64], comp[128], out[64];
+    uLongf comp_len = sizeof(comp);
+
+    for ( unsigned i = 0; i < sizeof(data); i++ )
+        data[i] = (uint8_t)i;
+
+    REQUIRE(compress(comp, &comp_len, data, sizeof(data)) == Z_OK);
+
+    z_stream* first = File_Decomp_Get_Inflate(47);
+    REQUIRE(first != NULL);
+
+    for ( int pass = 0; pass < 2; pass++ )
+    {
+        z_stream* z_s = File_Decomp_Get_Inflate(47);
+
+        // the engine returned below is handed out again
+        if ( pass )
+            CHECK(z_s == first);
+
+        z_s->next_in = comp;
+        z_s->avail_in = comp_len;
+        z_s->next_out = out;
+        z_s->avail_out = sizeof(out);
+
+        CHECK(inflate(z_s, Z_SYNC_FLUSH) == Z_STREAM_END);
+        CHECK(!memcmp(out, data, sizeof(data)));
+
+        File_Decomp_Put_Inflate(z_s);
+
+        if ( !pass )
+            File_Decomp_Put_Inflate(first);
+    }
+    File_Decomp_Thread_Term();
+}
+
 #endif
@@ -314,5 +314,14 @@ void SO_PUBLIC File_Decomp_Free(fd_session_p_t SessionPtr);
 
 /* Call the error alerting call-back function */
 void SO_PUBLIC File_Decomp_Alert(fd_session_p_t SessionPtr, int Event);
+
+/* Inflate engines are kept per thread and reused; a reset is much cheaper
+   than an init and end for every stream.  Get returns an engine ready for
+   the given window bits or NULL. */
+z_stream* SO_PUBLIC File_Decomp_Get_Inflate(int Window_Bits);
+void SO_PUBLIC File_Decomp_Put_Inflate(z_stream*);
+
+/* Release the cached engines when a packet thread exits */
+void SO_PUBLIC File_Decomp_Thread_Term();
 #endif
 
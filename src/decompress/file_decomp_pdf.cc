@@ -913,19 +913,11 @@ static fd_status_t Init_Stream(fd_session_p_t SessionPtr)
     {
     case FILE_COMPRESSION_TYPE_DEFLATE:
     {
-        int z_ret;
-
-        z_stream* z_s = &(StPtr->PDF_Decomp_State.Deflate.StreamDeflate);
-
-        memset( (char*)z_s, 0, sizeof(z_stream));
-
-        z_s->zalloc = (alloc_func)NULL;
-        z_s->zfree = (free_func)NULL;
-        SYNC_IN(z_s)
+        z_stream* z_s = File_Decomp_Get_Inflate(47);
 
-        z_ret = inflateInit2(z_s, 47);
+        StPtr->PDF_Decomp_State.Deflate.StreamDeflate = z_s;
 
-        if ( z_ret != Z_OK )
+        if ( z_s == NULL )
         {
             File_Decomp_Alert(SessionPtr, FILE_DECOMP_ERR_PDF_DEFL_FAILURE);
             return( File_Decomp_Error );
@@ -956,7 +948,10 @@ static fd_status_t Decomp_Stream(fd_session_p_t SessionPtr)
     case FILE_COMPRESSION_TYPE_DEFLATE:
     {
         int z_ret;
-        z_stream* z_s = &(StPtr->PDF_Decomp_State.Deflate.StreamDeflate);
+        z_stream* z_s = StPtr->PDF_Decomp_State.Deflate.StreamDeflate;
+
+        if ( z_s == NULL )
+            return( File_Decomp_Error );
 
         SYNC_IN(z_s)
 
@@ -1015,17 +1010,9 @@ fd_status_t File_Decomp_End_PDF(fd_session_p_t SessionPtr)
     {
     case FILE_COMPRESSION_TYPE_DEFLATE:
     {
-        int z_ret;
-        z_stream* z_s = &(StPtr->PDF_Decomp_State.Deflate.StreamDeflate);
-
-        z_ret = inflateEnd(z_s);
-
-        if ( z_ret != Z_OK )
-        {
-            File_Decomp_Alert(SessionPtr, FILE_DECOMP_ERR_PDF_DEFL_FAILURE);
-            return( File_Decomp_Error );
-        }
-
+        /* The engine goes back to the thread for the next stream */
+        File_Decomp_Put_Inflate(StPtr->PDF_Decomp_State.Deflate.StreamDeflate);
+        StPtr->PDF_Decomp_State.Deflate.StreamDeflate = NULL;
         break;
     }
     default:
@@ -62,7 +62,7 @@ typedef struct fd_PDF_Parse_s
 
 typedef struct fd_PDF_Deflate_s
 {
-    z_stream StreamDeflate;
+    z_stream* StreamDeflate;
 } fd_PDF_Deflate_t;
 
 typedef struct fd_PDF_s
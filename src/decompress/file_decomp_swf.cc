@@ -109,7 +109,10 @@ static fd_status_t Decomp(fd_session_p_t SessionPtr)
     case FILE_COMPRESSION_TYPE_ZLIB:
     {
         int z_ret;
-        z_stream* z_s = &(SessionPtr->Decomp_State.SWF.StreamZLIB);
+        z_stream* z_s = SessionPtr->Decomp_State.SWF.StreamZLIB;
+
+        if ( z_s == NULL )
+            return( File_Decomp_Error );
 
         SYNC_IN(z_s)
 
@@ -172,17 +175,8 @@ fd_status_t File_Decomp_End_SWF(fd_session_p_t SessionPtr)
     {
     case FILE_COMPRESSION_TYPE_ZLIB:
     {
-        int z_ret;
-        z_stream* z_s = &(SessionPtr->Decomp_State.SWF.StreamZLIB);
-
-        z_ret = inflateEnd(z_s);
-
-        if ( z_ret != Z_OK )
-        {
-            SessionPtr->Error_Event = FILE_DECOMP_ERR_SWF_ZLIB_FAILURE;
-            return( File_Decomp_DecompError );
-        }
-
+        File_Decomp_Put_Inflate(SessionPtr->Decomp_State.SWF.StreamZLIB);
+        SessionPtr->Decomp_State.SWF.StreamZLIB = NULL;
         break;
     }
 #ifdef HAVE_LZMA
@@ -216,23 +210,16 @@ fd_status_t File_Decomp_Init_SWF(fd_session_p_t SessionPtr)
     {
     case FILE_COMPRESSION_TYPE_ZLIB:
     {
-        int z_ret;
         z_stream* z_s;
 
         SessionPtr->Decomp_State.SWF.Header_Len =
             SWF_VER_LEN + SWF_UCL_LEN;
 
-        z_s = &(SessionPtr->Decomp_State.SWF.StreamZLIB);
+        z_s = File_Decomp_Get_Inflate(MAX_WBITS);
 
-        memset( (char*)z_s, 0, sizeof(z_stream));
+        SessionPtr->Decomp_State.SWF.StreamZLIB = z_s;
 
-        z_s->zalloc = (alloc_func)NULL;
-        z_s->zfree = (free_func)NULL;
-        SYNC_IN(z_s)
-
-        z_ret = inflateInit(z_s);
-
-        if ( z_ret != Z_OK )
+        if ( z_s == NULL )
         {
             SessionPtr->Error_Event = FILE_DECOMP_ERR_SWF_ZLIB_FAILURE;
             return( File_Decomp_DecompError );
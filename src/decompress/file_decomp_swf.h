@@ -64,7 +64,7 @@ typedef enum swf_states
 
 typedef struct fd_SWF_s
 {
-    z_stream StreamZLIB;
+    z_stream* StreamZLIB;
 #ifdef HAVE_LZMA
     lzma_stream StreamLZMA;
 #endif
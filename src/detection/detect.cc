@@ -37,6 +37,7 @@
 
 #include "detection_defines.h"
 #include "fp_detect.h"
+#include "header_match.h"
 #include "tag.h"
 
 #include "latency/packet_latency.h"
@@ -281,9 +282,16 @@ bool snort_detect(Packet* p)
     }
 }
 
+// use the compiled sets when we have them
+static inline bool rtn_ip_in(sfip_var_t* var, const IpSet* set, const sfip_t* ip, bool dst)
+{ return set ? ip_set_check(set, ip, dst) : sfvar_ip_in(var, ip); }
+
+static inline bool rtn_has_port(PortObject* po, const PortBitSet* set, uint16_t port)
+{ return set ? port_set_contains(set, port) : PortObjectHasPort(po, port); }
+
 static int CheckAddrPort(
-    sfip_var_t* rule_addr,
-    PortObject* po,
+    sfip_var_t* rule_addr, const IpSet* addr_set,
+    PortObject* po, const PortBitSet* port_set,
     Packet* p,
     uint32_t flags, int mode)
 {
@@ -344,7 +352,7 @@ static int CheckAddrPort(
 
     if (!(global_except_addr_flag)) /*modeled after Check{Src,Dst}IP function*/
     {
-        if (sfvar_ip_in(rule_addr, pkt_addr))
+        if (rtn_ip_in(rule_addr, addr_set, pkt_addr, !(mode & CHECK_SRC_IP)))
             ip_match = 1;
     }
     else
@@ -354,7 +362,7 @@ static int CheckAddrPort(
          * of the source addresses
          */
 
-        if (sfvar_ip_in(rule_addr, pkt_addr))
+        if (rtn_ip_in(rule_addr, addr_set, pkt_addr, !(mode & CHECK_SRC_IP)))
             return 0;
 
         ip_match=1;
@@ -384,7 +392,7 @@ bail:
     }
 
     /* check the packet port against the rule port */
-    if ( !PortObjectHasPort(po,pkt_port) )
+    if ( !rtn_has_port(po, port_set, pkt_port) )
     {
         /* if the exception flag isn't up, fail */
         if (!except_port_flag)
@@ -412,29 +420,29 @@ bail:
     return 1;
 }
 
-#define CHECK_ADDR_SRC_ARGS(x) (x)->src_portobject
-#define CHECK_ADDR_DST_ARGS(x) (x)->dst_portobject
+#define CHECK_ADDR_SRC_ARGS(x) (x)->sip, (x)->sip_set, (x)->src_portobject, (x)->src_port_set
+#define CHECK_ADDR_DST_ARGS(x) (x)->dip, (x)->dip_set, (x)->dst_portobject, (x)->dst_port_set
 
 int CheckBidirectional(Packet* p, RuleTreeNode* rtn_idx,
     RuleFpList*, int check_ports)
 {
     DebugMessage(DEBUG_DETECT, "Checking bidirectional rule...\n");
 
-    if (CheckAddrPort(rtn_idx->sip, CHECK_ADDR_SRC_ARGS(rtn_idx), p,
+    if (CheckAddrPort(CHECK_ADDR_SRC_ARGS(rtn_idx), p,
         rtn_idx->flags, CHECK_SRC_IP | (check_ports ? CHECK_SRC_PORT : 0)))
     {
         DebugMessage(DEBUG_DETECT, "   Src->Src check passed\n");
-        if (!CheckAddrPort(rtn_idx->dip, CHECK_ADDR_DST_ARGS(rtn_idx), p,
+        if (!CheckAddrPort(CHECK_ADDR_DST_ARGS(rtn_idx), p,
             rtn_idx->flags, CHECK_DST_IP | (check_ports ? CHECK_DST_PORT : 0)))
         {
             DebugMessage(DEBUG_DETECT,
                 "   Dst->Dst check failed, checking inverse combination\n");
-            if (CheckAddrPort(rtn_idx->dip, CHECK_ADDR_DST_ARGS(rtn_idx), p,
+            if (CheckAddrPort(CHECK_ADDR_DST_ARGS(rtn_idx), p,
                 rtn_idx->flags, (CHECK_SRC_IP | INVERSE | (check_ports ? CHECK_SRC_PORT : 0))))
             {
                 DebugMessage(DEBUG_DETECT,
                     "   Inverse Dst->Src check passed\n");
-                if (!CheckAddrPort(rtn_idx->sip, CHECK_ADDR_SRC_ARGS(rtn_idx), p,
+                if (!CheckAddrPort(CHECK_ADDR_SRC_ARGS(rtn_idx), p,
                     rtn_idx->flags, (CHECK_DST_IP | INVERSE | (check_ports ? CHECK_DST_PORT : 0))))
                 {
                     DebugMessage(DEBUG_DETECT,
@@ -462,13 +470,13 @@ int CheckBidirectional(Packet* p, RuleTreeNode* rtn_idx,
     {
         DebugMessage(DEBUG_DETECT,
             "   Src->Src check failed, trying inverse test\n");
-        if (CheckAddrPort(rtn_idx->dip, CHECK_ADDR_DST_ARGS(rtn_idx), p,
+        if (CheckAddrPort(CHECK_ADDR_DST_ARGS(rtn_idx), p,
             rtn_idx->flags, CHECK_SRC_IP | INVERSE | (check_ports ? CHECK_SRC_PORT : 0)))
         {
             DebugMessage(DEBUG_DETECT,
                 "   Dst->Src check passed\n");
 
-            if (!CheckAddrPort(rtn_idx->sip, CHECK_ADDR_SRC_ARGS(rtn_idx), p,
+            if (!CheckAddrPort(CHECK_ADDR_SRC_ARGS(rtn_idx), p,
                 rtn_idx->flags, CHECK_DST_IP | INVERSE | (check_ports ? CHECK_DST_PORT : 0)))
             {
                 DebugMessage(DEBUG_DETECT,
@@ -512,7 +520,7 @@ int CheckSrcIP(Packet* p, RuleTreeNode* rtn_idx, RuleFpList* fp_list, int check_
 
     if (!(rtn_idx->flags & EXCEPT_SRC_IP))
     {
-        if ( sfvar_ip_in(rtn_idx->sip, p->ptrs.ip_api.get_src()) )
+        if ( rtn_ip_in(rtn_idx->sip, rtn_idx->sip_set, p->ptrs.ip_api.get_src(), false) )
         {
             /* the packet matches this test, proceed to the next test */
             return fp_list->next->RuleHeadFunc(p, rtn_idx, fp_list->next, check_ports);
@@ -525,7 +533,7 @@ int CheckSrcIP(Packet* p, RuleTreeNode* rtn_idx, RuleFpList* fp_list, int check_
          */
         DebugMessage(DEBUG_DETECT,"  global exception flag, \n");
 
-        if ( sfvar_ip_in(rtn_idx->sip, p->ptrs.ip_api.get_src()) )
+        if ( rtn_ip_in(rtn_idx->sip, rtn_idx->sip_set, p->ptrs.ip_api.get_src(), false) )
             return 0;
 
         return fp_list->next->RuleHeadFunc(p, rtn_idx, fp_list->next, check_ports);
@@ -556,7 +564,7 @@ int CheckDstIP(Packet* p, RuleTreeNode* rtn_idx, RuleFpList* fp_list, int check_
 
     if (!(rtn_idx->flags & EXCEPT_DST_IP))
     {
-        if ( sfvar_ip_in(rtn_idx->dip, p->ptrs.ip_api.get_dst()) )
+        if ( rtn_ip_in(rtn_idx->dip, rtn_idx->dip_set, p->ptrs.ip_api.get_dst(), true) )
         {
             /* the packet matches this test, proceed to the next test */
             return fp_list->next->RuleHeadFunc(p, rtn_idx, fp_list->next, check_ports);
@@ -568,7 +576,7 @@ int CheckDstIP(Packet* p, RuleTreeNode* rtn_idx, RuleFpList* fp_list, int check_
          * of the source addresses */
         DebugMessage(DEBUG_DETECT,"  global exception flag, \n");
 
-        if ( sfvar_ip_in(rtn_idx->dip, p->ptrs.ip_api.get_dst()) )
+        if ( rtn_ip_in(rtn_idx->dip, rtn_idx->dip_set, p->ptrs.ip_api.get_dst(), true) )
             return 0;
 
         return fp_list->next->RuleHeadFunc(p, rtn_idx, fp_list->next, check_ports);
@@ -587,7 +595,7 @@ int CheckSrcPortEqual(Packet* p, RuleTreeNode* rtn_idx,
     {
         return fp_list->next->RuleHeadFunc(p, rtn_idx, fp_list->next, check_ports);
     }
-    if ( PortObjectHasPort(rtn_idx->src_portobject,p->ptrs.sp) )
+    if ( rtn_has_port(rtn_idx->src_portobject, rtn_idx->src_port_set, p->ptrs.sp) )
     {
         DebugMessage(DEBUG_DETECT, "  SP match!\n");
         return fp_list->next->RuleHeadFunc(p, rtn_idx, fp_list->next, check_ports);
@@ -610,7 +618,7 @@ int CheckSrcPortNotEq(Packet* p, RuleTreeNode* rtn_idx,
     {
         return fp_list->next->RuleHeadFunc(p, rtn_idx, fp_list->next, check_ports);
     }
-    if ( !PortObjectHasPort(rtn_idx->src_portobject,p->ptrs.sp) )
+    if ( !rtn_has_port(rtn_idx->src_portobject, rtn_idx->src_port_set, p->ptrs.sp) )
     {
         DebugMessage(DEBUG_DETECT, "  !SP match!\n");
         return fp_list->next->RuleHeadFunc(p, rtn_idx, fp_list->next, check_ports);
@@ -633,7 +641,7 @@ int CheckDstPortEqual(Packet* p, RuleTreeNode* rtn_idx,
     {
         return fp_list->next->RuleHeadFunc(p, rtn_idx, fp_list->next, check_ports);
     }
-    if ( PortObjectHasPort(rtn_idx->dst_portobject,p->ptrs.dp) )
+    if ( rtn_has_port(rtn_idx->dst_portobject, rtn_idx->dst_port_set, p->ptrs.dp) )
     {
         DebugMessage(DEBUG_DETECT, " DP match!\n");
         return fp_list->next->RuleHeadFunc(p, rtn_idx, fp_list->next, check_ports);
@@ -655,7 +663,7 @@ int CheckDstPortNotEq(Packet* p, RuleTreeNode* rtn_idx,
     {
         return fp_list->next->RuleHeadFunc(p, rtn_idx, fp_list->next, check_ports);
     }
-    if ( !PortObjectHasPort(rtn_idx->dst_portobject,p->ptrs.dp) )
+    if ( !rtn_has_port(rtn_idx->dst_portobject, rtn_idx->dst_port_set, p->ptrs.dp) )
     {
         DebugMessage(DEBUG_DETECT, " !DP match!\n");
         return fp_list->next->RuleHeadFunc(p, rtn_idx, fp_list->next, check_ports);
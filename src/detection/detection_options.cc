@@ -32,6 +32,9 @@
 #include "config.h"
 #endif
 
+#include <algorithm>
+#include <limits>
+
 #include "detection_defines.h"
 #include "detection_util.h"
 #include "treenodes.h"
@@ -389,19 +392,11 @@ int detection_option_node_evaluate(
     state.last_check.rebuild_flag = p->packet_flags & PKT_REBUILT_STREAM;
 
     // Save some stuff off for repeated pattern tests
-    bool try_again = false;
+    bool try_again = node->retry;
     PmdLastCheck* content_last = nullptr;
 
-    if ( node->option_type != RULE_OPTION_TYPE_LEAF_NODE )
-    {
-        IpsOption* opt = (IpsOption*)node->option_data;
-        try_again = opt->retry();
-
-        PatternMatchData* pmd = opt->get_pattern();
-
-        if ( pmd and pmd->last_check )
-            content_last = pmd->last_check + get_instance_id();
-    }
+    if ( node->last_check )
+        content_last = node->last_check + get_instance_id();
 
     // No, haven't evaluated this one before... Check it.
     do
@@ -546,6 +541,8 @@ int detection_option_node_evaluate(
             eval_data->flowbit_noalert = 1;
         }
 
+        state.passes++;
+
         // Back up byte_extract vars so they don't get overwritten between rules
         for ( int i = 0; i < NUM_BYTE_EXTRACT_VARS; ++i )
             GetByteExtractValue(&(tmp_byte_extract_vars[i]), (int8_t)i);
@@ -562,10 +559,12 @@ int detection_option_node_evaluate(
             // Passed, check the children.
             if ( node->num_children )
             {
+                // the array may be replaced by reordering while we work
+                detection_option_tree_node_t** children = node->children;
+
                 for ( int i = 0; i < node->num_children; ++i )
                 {
-                    detection_option_tree_node_t* child_node =
-                        node->children[i];
+                    detection_option_tree_node_t* child_node = children[i];
 
                     dot_node_state_t* child_state =
                         child_node->state + get_instance_id();
@@ -596,10 +595,7 @@ int detection_option_node_evaluate(
                                 // Check for an unbounded relative search.  If this
                                 // failed before, it's going to fail again so don't
                                 // go down this path again
-                                IpsOption* opt = (IpsOption*)node->option_data;
-                                PatternMatchData* pmd = opt->get_pattern();
-
-                                if ( pmd->unbounded() )
+                                if ( node->unbounded )
                                 {
                                     // Only increment result once. Should hit this
                                     // condition on first loop iteration
@@ -623,7 +619,7 @@ int detection_option_node_evaluate(
                     }
 
                     child_state->result = detection_option_node_evaluate(
-                        node->children[i], eval_data, cursor);
+                        child_node, eval_data, cursor);
 
                     if ( child_node->option_type == RULE_OPTION_TYPE_LEAF_NODE )
                         // Leaf node won't have any children but will return success
@@ -715,6 +711,7 @@ struct node_profile_stats
     uint64_t checks;
     uint64_t latency_timeouts;
     uint64_t latency_suspends;
+    CounterStats counters;
 };
 
 static void detection_option_node_update_otn_stats(detection_option_tree_node_t* node,
@@ -731,6 +728,7 @@ static void detection_option_node_update_otn_stats(detection_option_tree_node_t*
         node_stats.elapsed_match += node->state[i].elapsed_match;
         node_stats.elapsed_no_match += node->state[i].elapsed_no_match;
         node_stats.checks += node->state[i].checks;
+        node_stats.counters += node->state[i].counters;
     }
 
     if ( stats )
@@ -738,6 +736,8 @@ static void detection_option_node_update_otn_stats(detection_option_tree_node_t*
         local_stats.elapsed = stats->elapsed + node_stats.elapsed;
         local_stats.elapsed_match = stats->elapsed_match + node_stats.elapsed_match;
         local_stats.elapsed_no_match = stats->elapsed_no_match + node_stats.elapsed_no_match;
+        local_stats.counters = stats->counters;
+        local_stats.counters += node_stats.counters;
 
         if (node_stats.checks > stats->checks)
             local_stats.checks = node_stats.checks;
@@ -753,6 +753,7 @@ static void detection_option_node_update_otn_stats(detection_option_tree_node_t*
         local_stats.elapsed = node_stats.elapsed;
         local_stats.elapsed_match = node_stats.elapsed_match;
         local_stats.elapsed_no_match = node_stats.elapsed_no_match;
+        local_stats.counters = node_stats.counters;
         local_stats.checks = node_stats.checks;
         local_stats.latency_timeouts = timeouts;
         local_stats.latency_suspends = suspends;
@@ -770,6 +771,7 @@ static void detection_option_node_update_otn_stats(detection_option_tree_node_t*
         state.elapsed += local_stats.elapsed;
         state.elapsed_match += local_stats.elapsed_match;
         state.elapsed_no_match += local_stats.elapsed_no_match;
+        state.counters += local_stats.counters;
 
         if (local_stats.checks > state.checks)
             state.checks = local_stats.checks;
@@ -812,6 +814,62 @@ void detection_option_tree_update_otn_stats(SFXHASH* doth)
     }
 }
 
+// an evaluation that stops at a node costs every rule below it the time
+// along the path so far, so a rule's histogram is the sum of those on its
+// path.  path holds the merged histograms of the nodes above.
+static void detection_option_node_get_otn_histograms(
+    detection_option_tree_node_t* node, std::vector<LatencyHistogram*>& path,
+    OtnHistograms& hists)
+{
+    LatencyHistogram* merged = nullptr;
+
+    for ( unsigned i = 0; i < ThreadConfig::get_instance_max(); ++i )
+    {
+        if ( !node->state[i].hist )
+            continue;
+
+        if ( !merged )
+            merged = new LatencyHistogram;
+
+        merged->merge(*node->state[i].hist);
+    }
+
+    if ( merged )
+        path.push_back(merged);
+
+    if ( node->option_type == RULE_OPTION_TYPE_LEAF_NODE and !path.empty() )
+    {
+        auto& h = hists[(OptTreeNode*)node->option_data];
+
+        for ( auto* p : path )
+            h.merge(*p);
+    }
+
+    for ( int i = 0; i < node->num_children; ++i )
+        detection_option_node_get_otn_histograms(node->children[i], path, hists);
+
+    if ( merged )
+    {
+        path.pop_back();
+        delete merged;
+    }
+}
+
+void detection_option_tree_get_otn_histograms(SFXHASH* doth, OtnHistograms& hists)
+{
+    if ( !doth )
+        return;
+
+    std::vector<LatencyHistogram*> path;
+
+    for ( auto hnode = sfxhash_findfirst(doth); hnode; hnode = sfxhash_findnext(doth) )
+    {
+        auto* node = (detection_option_tree_node_t*)hnode->data;
+        assert(node);
+        detection_option_node_get_otn_histograms(node, path, hists);
+    }
+}
+
 
 detection_option_tree_root_t* new_root()
 {
@@ -819,6 +877,7 @@ detection_option_tree_root_t* new_root()
         snort_calloc(sizeof(detection_option_tree_root_t));
 
     p->latency_state = new RuleLatencyState[ThreadConfig::get_instance_max()]();
+    p->priority = std::numeric_limits<unsigned>::max();
 
     return p;
 }
@@ -860,8 +919,292 @@ void free_detection_option_tree(detection_option_tree_node_t* node)
     {
         free_detection_option_tree(node->children[i]);
     }
-    snort_free(node->children);
+    for ( unsigned i = 0; i < ThreadConfig::get_instance_max(); ++i )
+        delete node->state[i].hist;
+
     snort_free(node->state);
-    snort_free(node);
+
+    // flattened members are released with their head
+    if ( node->flat == DOT_HEAP )
+    {
+        snort_free(node->children);
+        snort_free(node);
+        return;
+    }
+    if ( node->reordered )
+        snort_free(node->children);
+
+    if ( node->flat == DOT_FLAT_HEAD )
+        snort_free(node);
+}
+
+//-------------------------------------------------------------------------
+// flattening
+//
+// trees are built incrementally from many small allocations scattered
+// across the whole rule set.  once complete, each tree is copied into one
+// block, breadth first per parent so that the children of a node are
+// adjacent to each other, followed by all of the children arrays.  the
+// per thread state arrays are moved, not copied.
+//-------------------------------------------------------------------------
+
+static void count_tree(detection_option_tree_node_t* node, unsigned& nodes, unsigned& kids)
+{
+    nodes++;
+    kids += node->num_children;
+
+    for ( int i = 0; i < node->num_children; ++i )
+        count_tree(node->children[i], nodes, kids);
+}
+
+static void set_hints(detection_option_tree_node_t* node)
+{
+    node->last_check = nullptr;
+    node->retry = false;
+    node->unbounded = false;
+
+    if ( node->option_type == RULE_OPTION_TYPE_LEAF_NODE )
+        return;
+
+    IpsOption* opt = (IpsOption*)node->option_data;
+    node->retry = opt->retry();
+
+    if ( PatternMatchData* pmd = opt->get_pattern() )
+    {
+        node->last_check = pmd->last_check;
+        node->unbounded = pmd->unbounded();
+    }
+}
+
+struct FlatBlock
+{
+    detection_option_tree_node_t* next_node;
+    detection_option_tree_node_t** next_kids;
+};
+
+static void flatten_node(
+    detection_option_tree_node_t* src, detection_option_tree_node_t* dst, FlatBlock& fb)
+{
+    *dst = *src;
+    dst->flat = DOT_FLAT_MEMBER;
+    set_hints(dst);
+
+    if ( !src->num_children )
+    {
+        dst->children = nullptr;
+        return;
+    }
+
+    detection_option_tree_node_t* first = fb.next_node;
+    fb.next_node += src->num_children;
+
+    dst->children = fb.next_kids;
+    fb.next_kids += src->num_children;
+
+    for ( int i = 0; i < src->num_children; ++i )
+        dst->children[i] = first + i;
+
+    for ( int i = 0; i < src->num_children; ++i )
+        flatten_node(src->children[i], first + i, fb);
+}
+
+// release the original tree except for the state moved to the copy
+static void free_tree_shell(detection_option_tree_node_t* node)
+{
+    for ( int i = 0; i < node->num_children; ++i )
+        free_tree_shell(node->children[i]);
+
+    if ( node->flat == DOT_HEAP )
+    {
+        snort_free(node->children);
+        snort_free(node);
+    }
+    else if ( node->flat == DOT_FLAT_HEAD )
+        snort_free(node);
 }
 
+detection_option_tree_node_t* flatten_detection_option_tree(detection_option_tree_node_t* root)
+{
+    unsigned nodes = 0, kids = 0;
+    count_tree(root, nodes, kids);
+
+    size_t size = nodes * sizeof(detection_option_tree_node_t) +
+        kids * sizeof(detection_option_tree_node_t*);
+
+    detection_option_tree_node_t* head = (detection_option_tree_node_t*)snort_calloc(size);
+
+    FlatBlock fb;
+    fb.next_node = head + 1;
+    fb.next_kids = (detection_option_tree_node_t**)(head + nodes);
+
+    flatten_node(root, head, fb);
+    head->flat = DOT_FLAT_HEAD;
+
+    assert(fb.next_node == head + nodes);
+    assert(fb.next_kids == (detection_option_tree_node_t**)(head + nodes) + kids);
+
+    free_tree_shell(root);
+    return head;
+}
+
+
+//-------------------------------------------------------------------------
+// adaptive reordering
+//
+// siblings are independent branches evaluated with the same cursor so
+// their order doesn't change the result, except for leaves (alert order),
+// contents (fixed by the fast pattern setup) and any branch that sets,
+// clears or toggles flowbits since a later sibling may test them.
+//
+// packet threads may be walking a children array at any time so a new
+// array is published with a single store and the old one is only freed
+// after all packet threads have been through a swap.
+//-------------------------------------------------------------------------
+
+// don't trust the numbers until a node has seen some traffic
+#define DOT_REORDER_MIN_CHECKS 1000
+
+static bool sets_flowbits(detection_option_tree_node_t* node)
+{
+    if ( node->option_type == RULE_OPTION_TYPE_FLOWBIT and
+        FlowBits_SetOperation(node->option_data) )
+        return true;
+
+    for ( int i = 0; i < node->num_children; ++i )
+        if ( sets_flowbits(node->children[i]) )
+            return true;
+
+    return false;
+}
+
+static bool can_reorder(detection_option_tree_node_t* node)
+{
+    if ( node->option_type == RULE_OPTION_TYPE_LEAF_NODE or
+        node->option_type == RULE_OPTION_TYPE_CONTENT )
+        return false;
+
+    return !sets_flowbits(node);
+}
+
+// average cost of one check scaled by the fraction that pass; nodes
+// without enough data sort last so they keep their relative order
+static double get_score(detection_option_tree_node_t* node)
+{
+    hr_duration elapsed = 0_ticks;
+    uint64_t checks = 0, passes = 0;
+
+    for ( unsigned i = 0; i < ThreadConfig::get_instance_max(); ++i )
+    {
+        elapsed += node->state[i].elapsed;
+        checks += node->state[i].checks;
+        passes += node->state[i].passes;
+    }
+
+    if ( checks < DOT_REORDER_MIN_CHECKS )
+        return std::numeric_limits<double>::max();
+
+    double cost = (double)elapsed.count() / checks;
+    double rate = (double)(passes + 1) / (checks + 1);
+
+    return cost * rate;
+}
+
+struct DotScore
+{
+    detection_option_tree_node_t* node;
+    double score;
+    bool movable;
+};
+
+static bool reorder_node(detection_option_tree_node_t* node, DotTrash& trash)
+{
+    bool changed = false;
+
+    if ( node->num_children > 1 )
+    {
+        std::vector<DotScore> kids;
+
+        for ( int i = 0; i < node->num_children; ++i )
+        {
+            detection_option_tree_node_t* child = node->children[i];
+            bool movable = can_reorder(child);
+            kids.push_back({ child, movable ? get_score(child) : 0.0, movable });
+        }
+
+        // only sort runs of movable siblings so fixed ones stay in place
+        auto it = kids.begin();
+
+        while ( it != kids.end() )
+        {
+            if ( !it->movable )
+            {
+                ++it;
+                continue;
+            }
+            auto end = it;
+
+            while ( end != kids.end() and end->movable )
+                ++end;
+
+            std::stable_sort(it, end,
+                [](const DotScore& l, const DotScore& r) { return l.score < r.score; });
+
+            it = end;
+        }
+
+        for ( int i = 0; i < node->num_children and !changed; ++i )
+            changed = (kids[i].node != node->children[i]);
+
+        if ( changed )
+        {
+            detection_option_tree_node_t** old = node->children;
+            detection_option_tree_node_t** now = (detection_option_tree_node_t**)
+                snort_calloc(node->num_children, sizeof(*now));
+
+            for ( int i = 0; i < node->num_children; ++i )
+                now[i] = kids[i].node;
+
+            __atomic_store_n(&node->children, now, __ATOMIC_RELEASE);
+
+            if ( node->flat == DOT_HEAP or node->reordered )
+                trash.push_back(old);
+
+            node->reordered = true;
+        }
+    }
+
+    for ( int i = 0; i < node->num_children; ++i )
+        changed = reorder_node(node->children[i], trash) or changed;
+
+    return changed;
+}
+
+DotTrash* detection_option_tree_reorder(SFXHASH* doth)
+{
+    if ( !doth )
+        return nullptr;
+
+    DotTrash* trash = new DotTrash;
+    bool changed = false;
+
+    for ( auto hnode = sfxhash_findfirst(doth); hnode; hnode = sfxhash_findnext(doth) )
+    {
+        auto* node = (detection_option_tree_node_t*)hnode->data;
+        changed = reorder_node(node, *trash) or changed;
+    }
+
+    if ( !changed )
+    {
+        delete trash;
+        return nullptr;
+    }
+    return trash;
+}
+
+void detection_option_tree_empty_trash(DotTrash* trash)
+{
+    for ( auto p : *trash )
+        snort_free(p);
+
+    delete trash;
+}
@@ -36,12 +36,19 @@
 #endif
 
 #include <sys/time.h>
+#include <unordered_map>
+#include <vector>
+
 #include "detection/rule_option_types.h"
 #include "main/snort_types.h"
 #include "latency/rule_latency_state.h"
+#include "profiler/counter_profiler_defs.h"
+#include "profiler/latency_histogram.h"
 #include "time/clock_defs.h"
 
+struct OptTreeNode;
 struct Packet;
+struct PmdLastCheck;
 struct SFXHASH;
 
 typedef int (* eval_func_t)(void* option_data, class Cursor&, Packet*);
@@ -64,11 +71,18 @@ struct dot_node_state_t
     hr_duration elapsed_match;
     hr_duration elapsed_no_match;
     uint64_t checks;
+    uint64_t passes;
     uint64_t disables;
 
     unsigned latency_timeouts;
     unsigned latency_suspends;
 
+    // allocated on first use when profiler.rules.histograms is set
+    LatencyHistogram* hist;
+
+    // hardware counts for this node only when profiler.counters is set
+    CounterStats counters;
+
     // FIXIT-L perf profiler stuff should be factored of the node state struct
     void update(hr_duration delta, bool match)
     {
@@ -93,13 +107,29 @@ struct detection_option_tree_node_t
     option_type_t option_type;
     detection_option_tree_node_t** children;
     dot_node_state_t* state;
+
+    // set by flatten_detection_option_tree() so eval needn't ask the option
+    PmdLastCheck* last_check;
+    bool retry;
+    bool unbounded;
+
+    // DOT_* allocation of this node and its children array
+    uint8_t flat;
+
+    // children array replaced by reordering and owned by this node
+    bool reordered;
 };
 
+#define DOT_HEAP        0  // node and children allocated separately
+#define DOT_FLAT_HEAD   1  // start of a flattened block holding the whole tree
+#define DOT_FLAT_MEMBER 2  // inside a flattened block
+
 struct detection_option_tree_root_t
 {
     int num_children;
     detection_option_tree_node_t** children;
     RuleLatencyState* latency_state;
+    unsigned priority;  // best (lowest) of the rules in the tree
 };
 
 struct detection_option_eval_data_t
@@ -126,11 +156,29 @@ void print_option_tree(detection_option_tree_node_t*, int level);
 #endif
 void detection_option_tree_update_otn_stats(SFXHASH*);
 
+// latency of each rule from the histograms along its paths
+typedef std::unordered_map<const OptTreeNode*, LatencyHistogram> OtnHistograms;
+void detection_option_tree_get_otn_histograms(SFXHASH*, OtnHistograms&);
+
 detection_option_tree_root_t* new_root();
 void free_detection_option_root(void** existing_tree);
 
 detection_option_tree_node_t* new_node(option_type_t, void*);
 void free_detection_option_tree(detection_option_tree_node_t*);
 
+// children arrays replaced by reordering; these may still be in use by
+// packet threads so they must not be freed until all have swapped
+typedef std::vector<detection_option_tree_node_t**> DotTrash;
+
+// sort reorderable siblings by observed cost x pass rate, cheapest and most
+// selective first.  call from the main thread only.  returns nullptr if no
+// tree changed.
+DotTrash* detection_option_tree_reorder(SFXHASH*);
+void detection_option_tree_empty_trash(DotTrash*);
+
+// relocate the tree into a single block with siblings adjacent; the given
+// tree is released and the flattened copy returned
+detection_option_tree_node_t* flatten_detection_option_tree(detection_option_tree_node_t*);
+
 #endif
 
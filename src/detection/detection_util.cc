@@ -29,6 +29,7 @@
 #include "utils/stats.h"
 
 THREAD_LOCAL DataPointer g_file_data;
+THREAD_LOCAL FastPatternHit g_fp_hit;
 
 #define LOG_CHARS 16
 
@@ -35,6 +35,8 @@
 
 #define DECODE_BLEN 65535
 
+struct PatternMatchData;
+
 struct DataPointer
 {
     uint8_t* data;
@@ -49,6 +51,19 @@ struct DataBuffer
 
 extern SO_PUBLIC THREAD_LOCAL DataPointer g_file_data;
 
+// where the fast pattern matcher found the pattern of the rule tree now
+// being evaluated.  end is just past the first hit in data or 0 if unknown.
+// content uses it to skip ahead on its first search.
+struct FastPatternHit
+{
+    const PatternMatchData* pmd;
+    const uint8_t* data;
+    unsigned size;
+    unsigned end;
+};
+
+extern THREAD_LOCAL FastPatternHit g_fp_hit;
+
 #define SetDetectLimit(pktPtr, altLen) \
 { \
     pktPtr->alt_dsize = altLen; \
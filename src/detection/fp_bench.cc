@@ -0,0 +1,399 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// fp_bench.cc
+
+#include "fp_bench.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "log/messages.h"
+#include "main/snort_config.h"
+#include "main/thread.h"
+#include "managers/mpse_manager.h"
+#include "ports/port_group.h"
+#include "time/clock_defs.h"
+#include "time/stopwatch.h"
+
+#ifdef HAVE_HYPERSCAN
+#include "search_engines/hyperscan.h"
+#endif
+
+#include "fp_config.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+#define s_capture_file "mpse_buffers"
+
+// each run over the corpus is short so repeat for steadier numbers
+#define BENCH_PASSES 10
+
+//-------------------------------------------------------------------------
+// capture
+//-------------------------------------------------------------------------
+
+static THREAD_LOCAL FILE* s_capture = nullptr;
+static THREAD_LOCAL unsigned s_captured[PM_TYPE_MAX];
+static THREAD_LOCAL bool s_capture_failed = false;
+
+// record: pm type (1 byte), length (4 bytes, host order), data
+void fp_capture_buffer(unsigned pm_type, const uint8_t* buf, unsigned len)
+{
+    if ( pm_type >= PM_TYPE_MAX or s_capture_failed )
+        return;
+
+    if ( s_captured[pm_type] >= snort_conf->fast_pattern_config->get_capture_buffers() )
+        return;
+
+    if ( !s_capture )
+    {
+        std::string file;
+        get_instance_file(file, s_capture_file);
+
+        if ( !(s_capture = fopen(file.c_str(), "wb")) )
+        {
+            WarningMessage("can't open %s for buffer capture\n", file.c_str());
+            s_capture_failed = true;
+            return;
+        }
+    }
+
+    uint8_t type = pm_type;
+    uint32_t size = len;
+
+    fwrite(&type, sizeof(type), 1, s_capture);
+    fwrite(&size, sizeof(size), 1, s_capture);
+    fwrite(buf, 1, len, s_capture);
+
+    s_captured[pm_type]++;
+}
+
+void fp_capture_term()
+{
+    if ( s_capture )
+    {
+        fclose(s_capture);
+        s_capture = nullptr;
+    }
+
+    for ( auto& n : s_captured )
+        n = 0;
+
+    s_capture_failed = false;
+}
+
+//-------------------------------------------------------------------------
+// pattern sets
+//-------------------------------------------------------------------------
+
+struct BenchPattern
+{
+    std::string pat;
+    Mpse::PatternDescriptor desc;
+};
+
+struct BenchSet
+{
+    unsigned pm_type;
+    std::vector<BenchPattern> pats;
+};
+
+// keyed by port group and pm type so each set matches one fp_create mpse
+typedef std::map<std::pair<const void*, unsigned>, BenchSet> BenchSets;
+
+static BenchSets s_sets;
+
+void fp_bench_add(
+    const void* group, unsigned pm_type, const char* pat, unsigned len,
+    const Mpse::PatternDescriptor& desc)
+{
+    BenchSet& set = s_sets[std::make_pair(group, pm_type)];
+    set.pm_type = pm_type;
+    set.pats.push_back({ std::string(pat, len), desc });
+}
+
+//-------------------------------------------------------------------------
+// corpus
+//-------------------------------------------------------------------------
+
+typedef std::vector<std::string> Buffers;
+
+static bool load_corpus(const char* file, Buffers* corpus)
+{
+    FILE* f = fopen(file, "rb");
+
+    if ( !f )
+        return false;
+
+    uint8_t type;
+    uint32_t size;
+
+    while ( fread(&type, sizeof(type), 1, f) == 1 and
+        fread(&size, sizeof(size), 1, f) == 1 )
+    {
+        std::string buf(size, '\0');
+
+        if ( size and fread(&buf[0], 1, size, f) != size )
+            break;
+
+        if ( type < PM_TYPE_MAX and size )
+            corpus[type].push_back(buf);
+    }
+    fclose(f);
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// bench
+//-------------------------------------------------------------------------
+
+// the trees are built by fp_create for detection; here there is nothing
+// to evaluate so matches are just counted
+static MpseAgent s_agent =
+{
+    [](SnortConfig*, void*, void** tree) { *tree = nullptr; return 0; },
+    [](void*, void** list) { *list = nullptr; return 0; },
+    [](void*) { },
+    [](void**) { },
+    [](void**) { }
+};
+
+static int bench_match(void*, void*, int, void* context, void*)
+{
+    ++*(uint64_t*)context;
+    return 0;
+}
+
+static size_t heap_used()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2().uordblks;
+#elif defined(__GLIBC__)
+    return (unsigned)mallinfo().uordblks;
+#else
+    return 0;
+#endif
+}
+
+struct BenchResult
+{
+    unsigned sets = 0;
+    unsigned failed = 0;
+    size_t memory = 0;
+    uint64_t bytes = 0;
+    uint64_t matches = 0;
+    hr_duration build = 0_ticks;
+    hr_duration search = 0_ticks;
+};
+
+static void bench_set(
+    SnortConfig* sc, const MpseApi* api, const BenchSet& set, const Buffers& bufs,
+    BenchResult& res)
+{
+    size_t heap = heap_used();
+    Stopwatch<hr_clock> sw;
+    sw.start();
+
+    Mpse* mpse = MpseManager::get_search_engine(sc, api, false, &s_agent);
+
+    if ( !mpse )
+    {
+        res.failed++;
+        return;
+    }
+
+    for ( auto& bp : set.pats )
+    {
+        mpse->add_pattern(
+            sc, (const uint8_t*)bp.pat.data(), bp.pat.size(), bp.desc, (void*)&bp);
+    }
+
+    if ( mpse->prep_patterns(sc) )
+    {
+        MpseManager::delete_search_engine(mpse);
+        res.failed++;
+        return;
+    }
+
+#ifdef HAVE_HYPERSCAN
+    // searches use per thread scratch cloned from the one built by prep
+    if ( !strcmp(api->base.name, "hyperscan") )
+    {
+        hyperscan_cleanup(sc);
+        hyperscan_setup(sc);
+    }
+#endif
+
+    sw.stop();
+    res.build += sw.get();
+
+    size_t used = heap_used();
+    res.memory += used > heap ? used - heap : 0;
+    res.sets++;
+
+    sw.reset();
+    sw.start();
+
+    for ( unsigned i = 0; i < BENCH_PASSES; ++i )
+    {
+        for ( auto& b : bufs )
+        {
+            int state = 0;
+            mpse->search((const uint8_t*)b.data(), b.size(), bench_match, &res.matches, &state);
+            res.bytes += b.size();
+        }
+    }
+
+    sw.stop();
+    res.search += sw.get();
+
+    MpseManager::delete_search_engine(mpse);
+}
+
+static void bench_engine(SnortConfig* sc, const MpseApi* api, const Buffers* corpus)
+{
+    BenchResult res;
+
+    MpseManager::start_search_engine(api);
+
+    for ( auto& it : s_sets )
+        bench_set(sc, api, it.second, corpus[it.second.pm_type], res);
+
+    MpseManager::stop_search_engine(api);
+
+    using secs = std::chrono::duration<double>;
+    using msecs = std::chrono::duration<double, std::milli>;
+
+    double search = secs(res.search).count();
+    double mbs = search > 0 ? res.bytes / search / 1.0e6 : 0.0;
+    double mps = search > 0 ? res.matches / search : 0.0;
+
+    LogMessage("%12.12s %6u %6u %12.1f %12.1f %10.1f %12.0f\n",
+        api->base.name, res.sets, res.failed, msecs(res.build).count(),
+        res.memory / 1024.0, mbs, mps);
+}
+
+void fp_bench_run(SnortConfig* sc)
+{
+    const char* file = sc->fast_pattern_config->get_bench_corpus();
+    Buffers corpus[PM_TYPE_MAX];
+
+    if ( !load_corpus(file, corpus) )
+    {
+        ParseError("can't read search engine bench corpus %s", file);
+        s_sets.clear();
+        return;
+    }
+
+    unsigned pats = 0;
+    uint64_t bufs = 0, bytes = 0;
+
+    for ( auto& it : s_sets )
+        pats += it.second.pats.size();
+
+    for ( auto& c : corpus )
+    {
+        bufs += c.size();
+
+        for ( auto& b : c )
+            bytes += b.size();
+    }
+
+    LogMessage("\n");
+    LogMessage("** Search Engine Benchmark --\n");
+    LogMessage("%u pattern sets, %u patterns, %" PRIu64 " buffers, %" PRIu64 " bytes, "
+        "%u passes\n", (unsigned)s_sets.size(), pats, bufs, bytes, BENCH_PASSES);
+
+    LogMessage("%12.12s %6.6s %6.6s %12.12s %12.12s %10.10s %12.12s\n",
+        "engine", "sets", "failed", "build (ms)", "memory (kb)", "MB/s", "matches/s");
+
+    std::vector<const MpseApi*> apis;
+    MpseManager::get_search_apis(apis);
+
+    // get the api again to init its stats
+    for ( auto* api : apis )
+        bench_engine(sc, MpseManager::get_search_api(api->base.name), corpus);
+
+    s_sets.clear();
+}
+
+#ifdef UNIT_TEST
+
+TEST_CASE("bench corpus", "[fp_bench]")
+{
+    char file[] = "/tmp/mpse_buffers_XXXXXX";
+    int fd = mkstemp(file);
+    REQUIRE(fd >= 0);
+
+    FILE* f = fdopen(fd, "wb");
+    REQUIRE(f);
+
+    const struct { uint8_t type; const char* data; } recs[] =
+    {
+        { PM_TYPE_PKT, "abc" }, { PM_TYPE_BODY, "hello" },
+        { PM_TYPE_MAX, "skip" }, { PM_TYPE_PKT, "" }, { PM_TYPE_PKT, "xyz" }
+    };
+
+    for ( auto& r : recs )
+    {
+        uint32_t size = strlen(r.data);
+        fwrite(&r.type, sizeof(r.type), 1, f);
+        fwrite(&size, sizeof(size), 1, f);
+        fwrite(r.data, 1, size, f);
+    }
+
+    // truncated record is dropped
+    uint8_t type = PM_TYPE_PKT;
+    uint32_t size = 100;
+    fwrite(&type, sizeof(type), 1, f);
+    fwrite(&size, sizeof(size), 1, f);
+    fwrite("short", 1, 5, f);
+    fclose(f);
+
+    Buffers corpus[PM_TYPE_MAX];
+    CHECK(load_corpus(file, corpus));
+    unlink(file);
+
+    REQUIRE(corpus[PM_TYPE_PKT].size() == 2);
+    CHECK(corpus[PM_TYPE_PKT][0] == "abc");
+    CHECK(corpus[PM_TYPE_PKT][1] == "xyz");
+
+    REQUIRE(corpus[PM_TYPE_BODY].size() == 1);
+    CHECK(corpus[PM_TYPE_BODY][0] == "hello");
+
+    CHECK(!load_corpus("/nonexistent/mpse_buffers", corpus));
+}
+
+#endif
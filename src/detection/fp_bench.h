@@ -0,0 +1,49 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// fp_bench.h
+
+#ifndef FP_BENCH_H
+#define FP_BENCH_H
+
+// search engine benchmark
+//
+// with search_engine.capture_buffers = N, packet threads write up to N of
+// the buffers they search per PmType to <log dir>/mpse_buffers.  the files
+// are just records so those from several threads or runs can be catenated.
+//
+// with search_engine.bench = <corpus file>, the fast pattern sets chosen by
+// fp_create for each port group are rebuilt with every registered search
+// engine and run over the corpus buffers of the same PmType.  build time,
+// memory, throughput, and match rate are logged and snort exits as with -T.
+
+#include "framework/mpse.h"
+
+struct SnortConfig;
+
+// main thread, while compiling port groups
+void fp_bench_add(
+    const void* group, unsigned pm_type, const char* pat, unsigned len,
+    const Mpse::PatternDescriptor&);
+
+void fp_bench_run(SnortConfig*);
+
+// packet threads
+void fp_capture_buffer(unsigned pm_type, const uint8_t*, unsigned len);
+void fp_capture_term();
+
+#endif
@@ -33,6 +33,7 @@
 #include "framework/mpse.h"
 #include "managers/mpse_manager.h"
 #include "log/messages.h"
+#include "utils/util.h"
 
 FastPatternConfig::FastPatternConfig()
 {
@@ -41,6 +42,8 @@ FastPatternConfig::FastPatternConfig()
     inspect_stream_insert = false;
     max_queue_events = 5;
     bleedover_port_limit = 1024;
+    auto_literal_max = 4;
+    auto_large_min = 1000;
 
     search_api = MpseManager::get_search_api("ac_bnfa");
     assert(search_api);
@@ -48,16 +51,57 @@ FastPatternConfig::FastPatternConfig()
 }
 
 FastPatternConfig::~FastPatternConfig()
-{ }
+{
+    if ( bench_corpus )
+        snort_free(bench_corpus);
+
+    if ( cache_dir )
+        snort_free(cache_dir);
+}
+
+void FastPatternConfig::set_bench_corpus(const char* file)
+{
+    if ( bench_corpus )
+        snort_free(bench_corpus);
+
+    bench_corpus = *file ? snort_strdup(file) : nullptr;
+}
+
+void FastPatternConfig::set_cache_dir(const char* dir)
+{
+    if ( cache_dir )
+        snort_free(cache_dir);
+
+    cache_dir = *dir ? snort_strdup(dir) : nullptr;
+}
 
+// auto keeps ac_bnfa as the default for mid sized groups and the global
+// start / setup / activate and adds the brute force literal engine for tiny
+// groups and hyperscan, when built, for large ones.
 bool FastPatternConfig::set_detect_search_method(const char* method)
 {
+    if ( !strcmp(method, "auto") )
+    {
+        search_api = MpseManager::get_search_api("ac_bnfa");
+        literal_api = MpseManager::get_search_api("literal");
+        large_api = MpseManager::get_search_api("hyperscan");
+
+        if ( !search_api or !literal_api )
+            return false;
+
+        auto_search = true;
+        trim = MpseManager::search_engine_trim(search_api);
+        return true;
+    }
+
     const MpseApi* api = MpseManager::get_search_api(method);
 
     if ( !api )
         return false;
 
     search_api = api;
+    literal_api = large_api = nullptr;
+    auto_search = false;
     trim = MpseManager::search_engine_trim(search_api);
     return true;
 }
@@ -91,6 +91,18 @@ public:
     bool get_split_any_any()
     { return split_any_any; }
 
+    void set_compile_threads(unsigned n)
+    { compile_threads = n; }
+
+    unsigned get_compile_threads()
+    { return compile_threads; }
+
+    void set_batch_search(bool enable)
+    { batch_search = enable; }
+
+    bool get_batch_search()
+    { return batch_search; }
+
     void set_single_rule_group()
     { portlists_flags |= PL_SINGLE_RULE_GROUP; }
 
@@ -124,6 +136,28 @@ public:
     const struct MpseApi* get_search_api()
     { return search_api; }
 
+    // search_method = auto picks one of these per port group
+    bool get_auto_search()
+    { return auto_search; }
+
+    const struct MpseApi* get_literal_api()
+    { return literal_api; }
+
+    const struct MpseApi* get_large_api()
+    { return large_api; }
+
+    void set_auto_literal_max(unsigned n)
+    { auto_literal_max = n; }
+
+    unsigned get_auto_literal_max()
+    { return auto_literal_max; }
+
+    void set_auto_large_min(unsigned n)
+    { auto_large_min = n; }
+
+    unsigned get_auto_large_min()
+    { return auto_large_min; }
+
     bool get_trim()
     { return trim; }
 
@@ -141,17 +175,43 @@ public:
     int get_max_pattern_len()
     { return max_pattern_len; }
 
+    void set_capture_buffers(unsigned n)
+    { capture_buffers = n; }
+
+    unsigned get_capture_buffers()
+    { return capture_buffers; }
+
+    void set_bench_corpus(const char*);
+
+    const char* get_bench_corpus()
+    { return bench_corpus; }
+
+    void set_cache_dir(const char*);
+
+    const char* get_cache_dir()
+    { return cache_dir; }
+
 private:
     const struct MpseApi* search_api;
+    const struct MpseApi* literal_api;
+    const struct MpseApi* large_api;
+    char* bench_corpus;
+    char* cache_dir;
 
+    bool auto_search;
     bool inspect_stream_insert;
     bool trim;
     bool split_any_any;
+    bool batch_search;
     bool debug_print_fast_pattern;
     bool debug;
 
     unsigned max_queue_events;
     unsigned bleedover_port_limit;
+    unsigned compile_threads;
+    unsigned auto_literal_max;
+    unsigned auto_large_min;
+    unsigned capture_buffers;
 
     int search_opt;
     int portlists_flags;
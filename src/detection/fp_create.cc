@@ -39,7 +39,15 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "main/snort.h"
 #include "main/snort_config.h"
+#include "main/thread_config.h"
 #include "hash/sfghash.h"
 #include "ips_options/ips_flow.h"
 #include "utils/util.h"
@@ -55,6 +63,7 @@
 #include "managers/mpse_manager.h"
 #include "target_based/snort_protocols.h"
 
+#include "fp_bench.h"
 #include "fp_config.h"
 #include "service_map.h"
 #include "rules.h"
@@ -67,6 +76,65 @@
 
 static unsigned mpse_count = 0;
 
+// state machines deferred for parallel compilation, in port group order
+static std::vector<Mpse*> s_tbd;
+
+// with search_method = auto, patterns for the current port group are held
+// until the group is complete so the engine can be chosen from the whole set
+struct AutoPattern
+{
+    const char* pattern;
+    int length;
+    Mpse::PatternDescriptor desc;
+    PMX* pmx;
+};
+
+struct AutoChoice
+{
+    const MpseApi* api;
+    unsigned pm_type;
+    unsigned count;
+    unsigned bytes;
+};
+
+static std::vector<AutoPattern> s_pending[PM_TYPE_MAX];
+static std::vector<AutoChoice> s_choices;
+
+// port groups that end up with the same fast patterns from the same rules
+// share one Mpse.  the set is the (otn, pmd) pairs added to the engine
+// since each pmx holds just those; the engine only differs by api.
+typedef std::vector<std::pair<const void*, const void*>> MpseRules;
+
+struct MpseKey
+{
+    const MpseApi* api;
+    MpseRules rules;
+
+    bool operator==(const MpseKey& k) const
+    { return api == k.api and rules == k.rules; }
+};
+
+struct MpseKeyHash
+{
+    size_t operator()(const MpseKey& k) const
+    {
+        std::hash<const void*> hash;
+        size_t h = hash(k.api);
+
+        for ( auto& r : k.rules )
+            h = (h * 31 + hash(r.first)) * 31 + hash(r.second);
+
+        return h;
+    }
+};
+
+static MpseRules s_group_rules[PM_TYPE_MAX];
+static std::unordered_map<MpseKey, Mpse*, MpseKeyHash> s_mpse_sets;
+static unsigned s_shared_count = 0;
+
+// references to a shared Mpse beyond the first; the last group deletes it
+static std::unordered_map<Mpse*, unsigned> s_mpse_refs;
+
 static void fpDeletePMX(void* data);
 
 static int fpGetFinalPattern(
@@ -89,6 +157,9 @@ static int finalize_detection_option_tree(SnortConfig* sc, detection_option_tree
     {
         detection_option_tree_node_t* node = root->children[i];
 
+        if ( node->flat == DOT_HEAP )
+            root->children[i] = node = flatten_detection_option_tree(node);
+
         if ( void* dup_node = add_detection_option_tree(sc, node) )
         {
             // FIXIT-L delete dup_node and keep original?
@@ -115,6 +186,9 @@ static int otn_create_tree(OptTreeNode* otn, void** existing_tree)
 
     detection_option_tree_root_t* root = (detection_option_tree_root_t*)*existing_tree;
 
+    if ( otn->sigInfo.priority < root->priority )
+        root->priority = otn->sigInfo.priority;
+
     OptFpList* opt_fp = otn->opt_func;
 
     if (!root->children)
@@ -550,6 +624,30 @@ static PatternMatchData* get_fp_content(OptTreeNode* otn, OptFpList*& next)
     return nullptr;
 }
 
+static Mpse* fpCreateMpse(
+    SnortConfig* sc, FastPatternConfig* fp, const MpseApi* api, unsigned pm_type)
+{
+    static MpseAgent agent =
+    {
+          pmx_create_tree, add_patrn_to_neg_list,
+          fpDeletePMX, free_detection_option_root, neg_list_free
+    };
+
+    Mpse* mpse = MpseManager::get_search_engine(sc, api, true, &agent);
+
+    if ( !mpse )
+    {
+        ParseError("Failed to create pattern matcher for %u", pm_type);
+        return nullptr;
+    }
+    mpse_count++;
+
+    if ( fp->get_search_opt() )
+        mpse->set_opt(1);
+
+    return mpse;
+}
+
 static int fpFinishPortGroupRule(
     SnortConfig* sc, PortGroup* pg,
     OptTreeNode* otn, PatternMatchData* pmd, FastPatternConfig* fp)
@@ -581,35 +679,126 @@ static int fpFinishPortGroupRule(
         if (fp->get_debug_print_fast_patterns())
             PrintFastPatternInfo(otn, pmd, pattern, pattern_length);
 
-        if ( !pg->mpse[pmd->pm_type] )
+        Mpse::PatternDescriptor desc(pmd->no_case, pmd->negated, pmd->literal);
+
+        if ( fp->get_bench_corpus() )
+            fp_bench_add(pg, pmd->pm_type, pattern, pattern_length, desc);
+
+        s_group_rules[pmd->pm_type].push_back({ otn, pmd });
+
+        if ( fp->get_auto_search() )
         {
-            static MpseAgent agent =
-            {
-                  pmx_create_tree, add_patrn_to_neg_list,
-                  fpDeletePMX, free_detection_option_root, neg_list_free
-            };
+            s_pending[pmd->pm_type].push_back({ pattern, pattern_length, desc, pmx });
+            return 0;
+        }
 
-            pg->mpse[pmd->pm_type] = MpseManager::get_search_engine(
-                sc, fp->get_search_api(), true, &agent);
+        if ( !pg->mpse[pmd->pm_type] )
+        {
+            pg->mpse[pmd->pm_type] = fpCreateMpse(sc, fp, fp->get_search_api(), pmd->pm_type);
 
             if ( !pg->mpse[pmd->pm_type] )
-            {
-                ParseError("Failed to create pattern matcher for %d", pmd->pm_type);
                 return -1;
-            }
-            mpse_count++;
-
-            if ( fp->get_search_opt() )
-                pg->mpse[pmd->pm_type]->set_opt(1);
         }
 
-        Mpse::PatternDescriptor desc(pmd->no_case, pmd->negated, pmd->literal);
         pg->mpse[pmd->pm_type]->add_pattern(sc, (uint8_t*)pattern, pattern_length, desc, pmx);
     }
 
     return 0;
 }
 
+// tiny sets don't justify a state machine; huge sets are faster with
+// hyperscan when it is available; everything else gets the default.
+// short patterns are kept off the literal engine since they match often
+// and each hit is rechecked against every pattern.
+static const MpseApi* fpSelectMpse(FastPatternConfig* fp, unsigned count, unsigned bytes)
+{
+    if ( count <= fp->get_auto_literal_max() and bytes >= 2 * count )
+        return fp->get_literal_api();
+
+    if ( fp->get_large_api() and count >= fp->get_auto_large_min() )
+        return fp->get_large_api();
+
+    return fp->get_search_api();
+}
+
+static void fpFinishAutoMpse(SnortConfig* sc, PortGroup* pg, FastPatternConfig* fp)
+{
+    for ( unsigned i = PM_TYPE_PKT; i < PM_TYPE_MAX; i++ )
+    {
+        std::vector<AutoPattern>& pats = s_pending[i];
+
+        if ( pats.empty() )
+            continue;
+
+        unsigned bytes = 0;
+
+        for ( auto& ap : pats )
+            bytes += ap.length;
+
+        const MpseApi* api = fpSelectMpse(fp, pats.size(), bytes);
+        pg->mpse[i] = fpCreateMpse(sc, fp, api, i);
+
+        if ( pg->mpse[i] )
+        {
+            for ( auto& ap : pats )
+                pg->mpse[i]->add_pattern(sc, (uint8_t*)ap.pattern, ap.length, ap.desc, ap.pmx);
+
+            s_choices.push_back({ api, i, (unsigned)pats.size(), bytes });
+        }
+        pats.clear();
+    }
+}
+
+// replace this group's engines with those of an earlier group that has
+// the same set of rules; the shared engines are already compiled
+static void fpShareMpse(PortGroup* pg, bool shared[PM_TYPE_MAX])
+{
+    for ( unsigned i = PM_TYPE_PKT; i < PM_TYPE_MAX; i++ )
+    {
+        MpseRules& rules = s_group_rules[i];
+        Mpse* mpse = pg->mpse[i];
+        shared[i] = false;
+
+        if ( !mpse or !mpse->get_pattern_count() or rules.empty() )
+        {
+            rules.clear();
+            continue;
+        }
+        std::sort(rules.begin(), rules.end());
+
+        MpseKey key { mpse->get_api(), MpseRules() };
+        key.rules.swap(rules);
+
+        auto it = s_mpse_sets.find(key);
+
+        if ( it == s_mpse_sets.end() )
+        {
+            s_mpse_sets.emplace(std::move(key), mpse);
+            continue;
+        }
+
+        // also frees the pmx of this copy
+        MpseManager::delete_search_engine(mpse);
+        mpse_count--;
+
+        pg->mpse[i] = it->second;
+        s_mpse_refs[it->second]++;
+        s_shared_count++;
+        shared[i] = true;
+    }
+}
+
+static void fpReleaseMpse(Mpse* mpse)
+{
+    auto it = s_mpse_refs.find(mpse);
+
+    if ( it == s_mpse_refs.end() )
+        MpseManager::delete_search_engine(mpse);
+
+    else if ( !--it->second )
+        s_mpse_refs.erase(it);
+}
+
 static int fpFinishPortGroup(
     SnortConfig* sc, PortGroup* pg, FastPatternConfig* fp)
 {
@@ -619,19 +808,34 @@ static int fpFinishPortGroup(
     if ((pg == NULL) || (fp == NULL))
         return -1;
 
+    if ( fp->get_auto_search() )
+        fpFinishAutoMpse(sc, pg, fp);
+
+    bool shared[PM_TYPE_MAX];
+    fpShareMpse(pg, shared);
+
     for (i = PM_TYPE_PKT; i < PM_TYPE_MAX; i++)
     {
         if (pg->mpse[i] != NULL)
         {
-            if (pg->mpse[i]->get_pattern_count() != 0)
+            if ( shared[i] )
+                rules = 1;
+
+            else if (pg->mpse[i]->get_pattern_count() != 0)
             {
-                if (pg->mpse[i]->prep_patterns(sc) != 0)
+                if ( fp->get_compile_threads() and pg->mpse[i]->can_build_async() )
+                    s_tbd.push_back(pg->mpse[i]);
+
+                else
                 {
-                    FatalError("Failed to compile port group patterns.\n");
-                }
+                    if (pg->mpse[i]->prep_patterns(sc) != 0)
+                    {
+                        FatalError("Failed to compile port group patterns.\n");
+                    }
 
-                if (fp->get_debug_mode())
-                    pg->mpse[i]->print_info();
+                    if (fp->get_debug_mode())
+                        pg->mpse[i]->print_info();
+                }
                 rules = 1;
             }
             else
@@ -668,6 +872,64 @@ static int fpFinishPortGroup(
     return 0;
 }
 
+// the state machines are independent so they are built by a pool of
+// threads.  the detection option trees are shared across port groups so
+// they are built afterwards on this thread in the original order which
+// keeps the result identical to a serial build.
+static void fpCompileMpse(SnortConfig* sc)
+{
+    FastPatternConfig* fp = sc->fast_pattern_config;
+    unsigned num = fp->get_compile_threads();
+
+    // a reload is built while the running config (snort_conf) is live so
+    // its cap keeps the compile off the packet cores
+    if ( Snort::is_reloading() and snort_conf and snort_conf != sc )
+    {
+        unsigned cap = snort_conf->thread_config->get_reload_compile_threads();
+
+        if ( cap and cap < num )
+            num = cap;
+    }
+
+    if ( s_tbd.size() < num )
+        num = s_tbd.size();
+
+    std::atomic<unsigned> next(0);
+    std::atomic<unsigned> errors(0);
+
+    auto worker = [&]()
+    {
+        unsigned i;
+
+        while ( (i = next++) < s_tbd.size() )
+        {
+            if ( s_tbd[i]->build_fsm(sc) )
+                errors++;
+        }
+    };
+
+    std::vector<std::thread> threads;
+
+    for ( unsigned i = 0; i < num; ++i )
+        threads.push_back(std::thread(worker));
+
+    for ( auto& t : threads )
+        t.join();
+
+    if ( errors )
+        FatalError("Failed to compile port group patterns.\n");
+
+    for ( auto* mpse : s_tbd )
+    {
+        if ( mpse->build_trees(sc) )
+            FatalError("Failed to compile port group patterns.\n");
+
+        if ( fp->get_debug_mode() )
+            mpse->print_info();
+    }
+    s_tbd.clear();
+}
+
 static int fpAddPortGroupRule(
     SnortConfig* sc, PortGroup* pg, OptTreeNode* otn, FastPatternConfig* fp)
 {
@@ -1040,7 +1302,7 @@ void fpDeletePortGroup(void* data)
     {
         if (pg->mpse[i] != NULL)
         {
-            MpseManager::delete_search_engine(pg->mpse[i]);
+            fpReleaseMpse(pg->mpse[i]);
             pg->mpse[i] = NULL;
         }
     }
@@ -1727,8 +1989,21 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
     }
 
     mpse_count = 0;
+    s_shared_count = 0;
+    s_choices.clear();
 
-    MpseManager::start_search_engine(fp->get_search_api());
+    std::vector<const MpseApi*> apis { fp->get_search_api() };
+
+    if ( fp->get_auto_search() )
+    {
+        apis.push_back(fp->get_literal_api());
+
+        if ( fp->get_large_api() )
+            apis.push_back(fp->get_large_api());
+    }
+
+    for ( auto* api : apis )
+        MpseManager::start_search_engine(api);
 
     /* Use PortObjects to create PortGroups */
     if (fp->get_debug_print_rule_group_build_details())
@@ -1764,22 +2039,34 @@ int fpCreateFastPacketDetection(SnortConfig* sc)
     if (fp->get_debug_print_rule_group_build_details())
         LogMessage("Service Based Rule Maps Done....\n");
 
+    if ( !s_tbd.empty() )
+        fpCompileMpse(sc);
+
+    s_mpse_sets.clear();
+
     fp_print_port_groups(port_tables);
     fp_print_service_groups(sc->spgmmTable);
 
     if ( mpse_count )
     {
-        LogLabel("search engine");
-        MpseManager::print_mpse_summary(fp->get_search_api());
+        for ( auto* api : apis )
+        {
+            LogLabel(apis.size() > 1 ? api->base.name : "search engine");
+            MpseManager::print_mpse_summary(api);
+        }
     }
 
+    if ( s_shared_count )
+        LogMessage("%25.25s: %-12u\n", "shared engines", s_shared_count);
+
     if ( fp->get_num_patterns_truncated() )
         LogMessage("%25.25s: %-12u\n", "truncated patterns", fp->get_num_patterns_truncated());
 
     if ( fp->get_num_patterns_trimmed() )
         LogMessage("%25.25s: %-12u\n", "prefix trims", fp->get_num_patterns_trimmed());
 
-    MpseManager::setup_search_engine(fp->get_search_api(), sc);
+    for ( auto* api : apis )
+        MpseManager::setup_search_engine(api, sc);
 
     return 0;
 }
@@ -1829,6 +2116,18 @@ void fpShowEventStats(SnortConfig* sc)
     LogMessage("\n");
     LogMessage("** UDP Event Stats --\n");
     prmShowEventStats(sc->prmUdpRTNX);
+
+    if ( s_choices.empty() )
+        return;
+
+    LogMessage("\n");
+    LogMessage("** Search Engine Selection --\n");
+
+    for ( auto& c : s_choices )
+    {
+        LogMessage("%8.8s: %-12s patterns %-6u avg len %u\n",
+            pm_type_strings[c.pm_type], c.api->base.name, c.count, c.bytes / c.count);
+    }
 }
 
 static const char* PatternRawToContent(const char* pattern, int pattern_len)
@@ -42,9 +42,13 @@
 
 #include <strings.h>
 
+#include <algorithm>
+
 #include "detect.h"
+#include "fp_bench.h"
 #include "fp_config.h"
 #include "fp_create.h"
+#include "header_match.h"
 #include "service_map.h"
 #include "detection_util.h"
 #include "detection_options.h"
@@ -54,6 +58,7 @@
 #include "rules.h"
 #include "treenodes.h"
 
+#include "latency/degrade.h"
 #include "latency/packet_latency.h"
 #include "latency/rule_latency.h"
 #include "main/snort_config.h"
@@ -114,11 +119,7 @@ static inline void InitMatchInfo(OTNX_MATCH_DATA* o)
     int i = 0;
 
     for (i = 0; i < o->iMatchInfoArraySize; i++)
-    {
         o->matchInfo[i].iMatchCount  = 0;
-        o->matchInfo[i].iMatchIndex  = 0;
-        o->matchInfo[i].iMatchMaxLen = 0;
-    }
 }
 
 // called by fpLogEvent(), which does the filtering etc.
@@ -236,6 +237,10 @@ int fpLogEvent(const RuleTreeNode* rtn, const OptTreeNode* otn, Packet* p)
 
     otn->state[get_instance_id()].alerts++;
 
+    // keep the flow from being cut at its inspection depth
+    if ( p->flow )
+        p->flow->set_session_flags(SSNFLAG_ALERTED);
+
     event_id++;
     action_execute((RuleType)action, p, otn, event_id);
     fpLogOther(p, rtn, otn, action);
@@ -243,6 +248,34 @@ int fpLogEvent(const RuleTreeNode* rtn, const OptTreeNode* otn, Packet* p)
     return 0;
 }
 
+// event ranking for the match queues.  these are strict orderings so that
+// repeated tests are stable; a true result means a ranks ahead of b.
+static inline bool rankByPriority(const OptTreeNode* a, const OptTreeNode* b)
+{
+    if ( a->sigInfo.priority != b->sigInfo.priority )
+        return a->sigInfo.priority < b->sigInfo.priority;
+
+    return a->sigInfo.id < b->sigInfo.id;
+}
+
+static inline bool rankByContentLength(const OptTreeNode* a, const OptTreeNode* b)
+{
+    if ( a->longestPatternLen != b->longestPatternLen )
+        return a->longestPatternLen > b->longestPatternLen;
+
+    return a->sigInfo.id > b->sigInfo.id;
+}
+
+typedef bool (*RankFunc)(const OptTreeNode*, const OptTreeNode*);
+
+static inline RankFunc get_rank_func()
+{
+    if ( snort_conf->event_queue_config->order == SNORT_EVENTQ_PRIORITY )
+        return rankByPriority;
+
+    return rankByContentLength;
+}
+
 /*
 **
 **  NAME
@@ -270,7 +303,7 @@ int fpLogEvent(const RuleTreeNode* rtn, const OptTreeNode* otn, Packet* p)
 **    int - 1 max_events variable hit, 0 successful.
 **
 */
-int fpAddMatch(OTNX_MATCH_DATA* omd_local, int pLen, const OptTreeNode* otn)
+int fpAddMatch(OTNX_MATCH_DATA* omd_local, int, const OptTreeNode* otn)
 {
     MATCH_INFO* pmi;
     int evalIndex;
@@ -287,17 +320,6 @@ int fpAddMatch(OTNX_MATCH_DATA* omd_local, int pLen, const OptTreeNode* otn)
     }
     pmi = &omd_local->matchInfo[evalIndex];
 
-    /*
-    **  If we hit the max number of unique events for any rule type alert,
-    **  log or pass, then we don't add it to the list.
-    */
-    if ( pmi->iMatchCount >= (int)snort_conf->fast_pattern_config->get_max_queue_events() ||
-        pmi->iMatchCount >= MAX_EVENT_MATCH)
-    {
-        pc.match_limit++;
-        return 1;
-    }
-
     /* Check that we are not storing the same otn again */
     for ( i=0; i< pmi->iMatchCount; i++ )
     {
@@ -308,34 +330,38 @@ int fpAddMatch(OTNX_MATCH_DATA* omd_local, int pLen, const OptTreeNode* otn)
         }
     }
 
-    /*
-    **  Add the event to the appropriate list
-    */
-    pmi->MatchArray[ pmi->iMatchCount ] = otn;
+    int max = (int)snort_conf->fast_pattern_config->get_max_queue_events();
+
+    if ( max > MAX_EVENT_MATCH )
+        max = MAX_EVENT_MATCH;
+
+    RankFunc rank = get_rank_func();
 
     /*
-    **  This means that we are adding a NC rule
-    **  and we only set the index to this rule
-    **  if there is no content rules in the
-    **  same array.
+    **  Add the event to the appropriate list.  Once the list is full it
+    **  becomes a heap of the best max events with the worst on top; a
+    **  better event replaces that one and the worse of the two is dropped.
     */
-    if (pLen > 0)
+    if ( pmi->iMatchCount < max )
     {
-        /*
-        **  Event Comparison Function
-        **  Here the largest content match is the
-        **  priority
-        */
-        if ( pmi->iMatchMaxLen < pLen )
-        {
-            pmi->iMatchMaxLen = pLen;
-            pmi->iMatchIndex  = pmi->iMatchCount;
-        }
+        pmi->MatchArray[ pmi->iMatchCount++ ] = otn;
+
+        if ( pmi->iMatchCount == max )
+            std::make_heap(pmi->MatchArray, pmi->MatchArray + max, rank);
+
+        return 0;
     }
 
-    pmi->iMatchCount++;
+    pc.match_limit++;
 
-    return 0;
+    if ( max <= 0 or !rank(otn, pmi->MatchArray[0]) )
+        return 1;
+
+    std::pop_heap(pmi->MatchArray, pmi->MatchArray + max, rank);
+    pmi->MatchArray[max - 1] = otn;
+    std::push_heap(pmi->MatchArray, pmi->MatchArray + max, rank);
+
+    return 1;
 }
 
 /*
@@ -400,6 +426,9 @@ static int detection_option_tree_evaluate(detection_option_tree_root_t* root,
     if ( RuleLatency::suspended() )
         return 0;
 
+    if ( Degrade::suspended(root->priority) )
+        return 0;
+
     Cursor c(eval_data->p);
     int rval = 0;
 
@@ -453,7 +482,9 @@ static int rule_tree_match(
         int ret = 0;
         {
             Profile rule_otn_eval_profile(ruleOTNEvalPerfStats);
+            g_fp_hit = { pmx->pmd, pomd->data, pomd->size, index > 0 ? (unsigned)index : 0 };
             ret = detection_option_tree_evaluate(root, &eval_data);
+            g_fp_hit.pmd = nullptr;
         }
 
         if ( ret )
@@ -516,60 +547,6 @@ static int rule_tree_match(
     return 0;
 }
 
-static int sortOrderByPriority(const void* e1, const void* e2)
-{
-    OptTreeNode* otn1;
-    OptTreeNode* otn2;
-
-    if (!e1 || !e2)
-        return 0;
-
-    otn1 = *(OptTreeNode**)e1;
-    otn2 = *(OptTreeNode**)e2;
-
-    if ( otn1->sigInfo.priority < otn2->sigInfo.priority )
-        return -1;
-
-    if ( otn1->sigInfo.priority > otn2->sigInfo.priority )
-        return +1;
-
-    /* This improves stability of repeated tests */
-    if ( otn1->sigInfo.id < otn2->sigInfo.id )
-        return -1;
-
-    if ( otn1->sigInfo.id > otn2->sigInfo.id )
-        return +1;
-
-    return 0;
-}
-
-static int sortOrderByContentLength(const void* e1, const void* e2)
-{
-    OptTreeNode* otn1;
-    OptTreeNode* otn2;
-
-    if (!e1 || !e2)
-        return 0;
-
-    otn1 = *(OptTreeNode**)e1;
-    otn2 = *(OptTreeNode**)e2;
-
-    if (otn1->longestPatternLen < otn2->longestPatternLen)
-        return +1;
-
-    if (otn1->longestPatternLen > otn2->longestPatternLen)
-        return -1;
-
-    /* This improves stability of repeated tests */
-    if ( otn1->sigInfo.id < otn2->sigInfo.id )
-        return +1;
-
-    if ( otn1->sigInfo.id > otn2->sigInfo.id )
-        return -1;
-
-    return 0;
-}
-
 /*
 **
 **  NAME
@@ -730,21 +707,18 @@ static inline int fpFinalSelectEvent(OTNX_MATCH_DATA* o, Packet* p)
              * built in drop/sdrop/reject comes before alert/pass/log as
              * part of the natural ordering....Jan '06..
              */
-            /* Sort the rules in this action group */
-            if (eq->order == SNORT_EVENTQ_PRIORITY)
-            {
-                qsort(o->matchInfo[i].MatchArray, o->matchInfo[i].iMatchCount,
-                    sizeof(void*), sortOrderByPriority);
-            }
-            else if (eq->order == SNORT_EVENTQ_CONTENT_LEN)
-            {
-                qsort(o->matchInfo[i].MatchArray, o->matchInfo[i].iMatchCount,
-                    sizeof(void*), sortOrderByContentLength);
-            }
+            /* Order the rules in this action group; a full group is
+             * already a heap so only the final heap sort is needed */
+            MATCH_INFO* pmi = o->matchInfo + i;
+            const OptTreeNode** first = pmi->MatchArray;
+            const OptTreeNode** last = first + pmi->iMatchCount;
+            RankFunc rank = get_rank_func();
+
+            if ( pmi->iMatchCount < (int)snort_conf->fast_pattern_config->get_max_queue_events()
+                and pmi->iMatchCount < MAX_EVENT_MATCH )
+                std::sort(first, last, rank);
             else
-            {
-                FatalError("fpdetect: Order function for event queue is invalid.\n");
-            }
+                std::sort_heap(first, last, rank);
 
             /* Process each event in the action (alert,drop,log,...) groups */
             for (j=0; j < o->matchInfo[i].iMatchCount; j++)
@@ -811,75 +785,158 @@ static inline int fpFinalSelectEvent(OTNX_MATCH_DATA* o, Packet* p)
     return 0;
 }
 
+// matches are queued for evaluation after the search so that each tree is
+// evaluated once per buffer.  duplicates are detected with a small open
+// addressing set of tree and context that is cleared in constant time by
+// bumping a generation number at the start of each search.  the queue
+// starts small and grows when searches overflow it.
 class MpseStash
 {
 public:
-    static const unsigned max = 32;
+    static const unsigned min_queue = 32;
+    static const unsigned max_queue = 256;
 
-    void init()
-    { count = flushed = 0; }
+    // stream searches may report offsets from the start of the stream
+    void init(bool offsets = true);
 
-    bool push(void* user, void* tree, int index, void* list);
-    bool process(MpseMatch, void*);
+    bool push(void* user, void* tree, int index, void* context, void* list);
+    bool process(MpseMatch);
+
+private:
+    bool seen(void* tree, void* context);
+    void next_gen();
 
 private:
+    static const unsigned set_size = 1024;  // power of 2 > 2 * max_queue
+    static const unsigned max_load = (set_size * 3) / 4;
+
     unsigned count;
     unsigned flushed;
+    unsigned capacity;
+    unsigned gen;
+    unsigned used;
+    bool offsets;
 
     struct Node {
         void* user;
         void* tree;
+        void* context;
         void* list;
         int index;
-    } queue[max];
+    } queue[max_queue];
+
+    struct Slot {
+        void* tree;
+        void* context;
+        unsigned gen;
+    } set[set_size];
 };
 
 static THREAD_LOCAL MpseStash stash;
 
-// uniquely insert into q, should splay elements for performance
-// return true if maxed out to trigger a flush
-bool MpseStash::push(void* user, void* tree, int index, void* list)
+void MpseStash::init(bool use_offsets)
 {
-    pmqs.tot_inq_inserts++;
+    if ( !capacity )
+        capacity = min_queue;
+
+    // the last search overflowed so give the next one more room
+    else if ( flushed and capacity < max_queue )
+    {
+        capacity *= 2;
+
+        if ( capacity > pmqs.max_inq_capacity )
+            pmqs.max_inq_capacity = capacity;
+    }
+
+    count = flushed = 0;
+    offsets = use_offsets;
+    next_gen();
+}
+
+// slots from prior generations are stale; on wrap clear them for real
+void MpseStash::next_gen()
+{
+    if ( !++gen )
+    {
+        memset(set, 0, sizeof(set));
+        gen = 1;
+    }
+    used = 0;
+}
 
-    for ( int i = (int)(count) - 1; i >= 0; --i )
+// return true if already queued in this search, otherwise remember it
+bool MpseStash::seen(void* tree, void* context)
+{
+    // a full set just stops deduping until the next search
+    if ( used >= max_load )
     {
-        if ( tree == queue[i].tree )
+        next_gen();
+        offsets = false;
+    }
+
+    uintptr_t h = ((uintptr_t)tree >> 4) ^ ((uintptr_t)context >> 6);
+    h ^= h >> 11;
+
+    for ( unsigned i = h & (set_size - 1); ; i = (i + 1) & (set_size - 1) )
+    {
+        Slot& slot = set[i];
+
+        if ( slot.gen != gen )
+        {
+            slot.tree = tree;
+            slot.context = context;
+            slot.gen = gen;
+            ++used;
             return false;
+        }
+        if ( slot.tree == tree and slot.context == context )
+            return true;
     }
+}
+
+// uniquely insert into q
+// return true if maxed out to trigger a flush
+bool MpseStash::push(void* user, void* tree, int index, void* context, void* list)
+{
+    pmqs.tot_inq_inserts++;
 
-    if ( count < max )
+    if ( seen(tree, context) )
     {
-        Node& node = queue[count++];
-        node.user = user;
-        node.tree = tree;
-        node.index = index;
-        node.list = list;
-        pmqs.tot_inq_uinserts++;
+        pmqs.tot_inq_dups++;
+        return false;
     }
 
-    if ( count == max )
+    Node& node = queue[count++];
+    node.user = user;
+    node.tree = tree;
+    // once dedup restarts a tree may come back with a later hit, which is
+    // no longer a valid lower bound for its content
+    node.index = offsets ? index : 0;
+    node.context = context;
+    node.list = list;
+    pmqs.tot_inq_uinserts++;
+
+    if ( count == capacity )
     {
         flushed++;
+        pmqs.tot_inq_flush++;
         return true;
     }
 
     return false;
 }
 
-bool MpseStash::process(MpseMatch match, void* context)
+bool MpseStash::process(MpseMatch match)
 {
     if ( count > pmqs.max_inq )
         pmqs.max_inq = count;
 
-    pmqs.tot_inq_flush += flushed;
-
     for ( unsigned i = 0; i < count; ++i )
     {
         Node& node = queue[i];
 
         // process a pattern - case is handled by otn processing
-        int res = match(node.user, node.tree, node.index, context, node.list);
+        int res = match(node.user, node.tree, node.index, node.context, node.list);
 
         if ( res > 0 )
         {
@@ -896,9 +953,9 @@ bool MpseStash::process(MpseMatch match, void* context)
 static int rule_tree_queue(
     void* user, void* tree, int index, void* context, void* list)
 {
-    if ( stash.push(user, tree, index, list) )
+    if ( stash.push(user, tree, index, context, list) )
     {
-        if ( stash.process(rule_tree_match, context) )
+        if ( stash.process(rule_tree_match) )
         {
             return 1;
         }
@@ -906,24 +963,153 @@ static int rule_tree_queue(
     return 0;
 }
 
-#define SEARCH_DATA(buf, len, cnt) \
+// when batch_search is enabled, fast pattern searches for a packet are
+// deferred until all rule groups have been selected.  the pending searches
+// are then grouped by state machine so each Mpse is searched once for all
+// of its buffers.  each search keeps a copy of the match data so that the
+// port group, buffer, and port checking are correct at evaluation time;
+// the copies share the packet's match info.
+class MpseBatch
+{
+public:
+    static const unsigned max = 16;
+
+    void init()
+    { count = 0; }
+
+    bool empty()
+    { return count == 0; }
+
+    bool full()
+    { return count == max; }
+
+    void add(Mpse*, const uint8_t* buf, unsigned len, const OTNX_MATCH_DATA*);
+    void flush();
+
+private:
+    unsigned count;
+
+    struct Item
+    {
+        Mpse* so;
+        OTNX_MATCH_DATA omd;
+    } items[max];
+};
+
+static THREAD_LOCAL MpseBatch batch;
+
+void MpseBatch::add(
+    Mpse* so, const uint8_t* buf, unsigned len, const OTNX_MATCH_DATA* omd)
+{
+    assert(count < max);
+    Item& item = items[count++];
+
+    item.so = so;
+    item.omd = *omd;
+    item.omd.data = buf;
+    item.omd.size = len;
+
+    pmqs.batched_searches++;
+}
+
+// all groups are submitted before any results are collected so engines
+// that offload can work on every state machine at once; the results are
+// then collected and evaluated in selection order.
+void MpseBatch::flush()
+{
+    Mpse::SearchItem group[max];
+    Mpse::SearchJob jobs[max];
+    Mpse* sos[max];
+    bool done[max] = { };
+    unsigned n = 0, num_jobs = 0;
+
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        if ( done[i] )
+            continue;
+
+        Mpse* so = items[i].so;
+        Mpse::SearchJob& job = jobs[num_jobs];
+
+        job.items = group + n;
+        job.count = 0;
+        job.match = rule_tree_queue;
+
+        // preserve the selection order within each group
+        for ( unsigned j = i; j < count; ++j )
+        {
+            if ( done[j] or items[j].so != so )
+                continue;
+
+            group[n].buf = items[j].omd.data;
+            group[n].len = items[j].omd.size;
+            group[n].context = &items[j].omd;
+            done[j] = true;
+            ++job.count;
+            ++n;
+        }
+
+        so->submit(job);
+        sos[num_jobs++] = so;
+
+        if ( so->can_async() )
+            pmqs.async_searches++;
+    }
+
+    for ( unsigned i = 0; i < num_jobs; ++i )
+    {
+        stash.init();
+
+        sos[i]->poll(jobs[i], true);
+
+        stash.process(rule_tree_match);
+        pmqs.batch_flushes++;
+    }
+    count = 0;
+}
+
+// ip rules temporarily move p->data to each ip layer so they can't be
+// deferred; stream searches depend on buffer order so they aren't either.
+// everything else is batched if so configured.
+#define SEARCH_DATA(buf, len, pmt, cnt, strm) \
     { \
         assert(so->get_pattern_count() > 0); \
-        int start_state = 0; \
         cnt++; \
-        omd->data = buf; omd->size = len; \
-        stash.init(); \
-        so->search(buf, len, rule_tree_queue, omd, &start_state); \
-        stash.process(rule_tree_match, omd); \
-        if ( PacketLatency::fastpath() ) \
-            return 1; \
+        if ( snort_conf->fast_pattern_config->get_capture_buffers() ) \
+            fp_capture_buffer(pmt, buf, len); \
+        if ( strm and p->flow and so->can_stream() ) \
+        { \
+            omd->data = buf; omd->size = len; \
+            stash.init(false); \
+            so->search_stream(p->flow, p->is_from_client(), buf, len, rule_tree_queue, omd); \
+            stash.process(rule_tree_match); \
+            if ( PacketLatency::fastpath() ) \
+                return 1; \
+        } \
+        else if ( snort_conf->fast_pattern_config->get_batch_search() and \
+            !(p->packet_flags & PKT_IP_RULE) ) \
+        { \
+            if ( batch.full() ) \
+                batch.flush(); \
+            batch.add(so, buf, len, omd); \
+        } \
+        else \
+        { \
+            int start_state = 0; \
+            omd->data = buf; omd->size = len; \
+            stash.init(); \
+            so->search(buf, len, rule_tree_queue, omd, &start_state); \
+            stash.process(rule_tree_match); \
+            if ( PacketLatency::fastpath() ) \
+                return 1; \
+        } \
     }
 
-#define SEARCH_BUFFER(ibt, pmt, cnt) \
+#define SEARCH_BUFFER(ibt, pmt, cnt, strm) \
     if ( gadget->get_fp_buf(ibt, p, buf) ) \
     { \
         if ( Mpse* so = port_group->mpse[pmt] ) \
-            SEARCH_DATA(buf.data, buf.len, cnt) \
+            SEARCH_DATA(buf.data, buf.len, pmt, cnt, strm) \
     }
 
 static int fp_search(
@@ -949,8 +1135,13 @@ static int fp_search(
             if ( IsLimitedDetect(p) && (p->alt_dsize < p->dsize) )
                 pattern_match_size = p->alt_dsize;
 
+            // reassembled pdus are consecutive so they can be streamed;
+            // limited detect truncates data and would break continuity
+            bool strm = (p->packet_flags & PKT_REBUILT_STREAM) and
+                (pattern_match_size == p->dsize);
+
             if ( pattern_match_size )
-                SEARCH_DATA(p->data, pattern_match_size, pc.pkt_searches);
+                SEARCH_DATA(p->data, pattern_match_size, PM_TYPE_PKT, pc.pkt_searches, strm);
 
             if ( pattern_match_size )
                 p->is_cooked() ?  pc.cooked_searches++ : pc.raw_searches++;
@@ -960,14 +1151,14 @@ static int fp_search(
     if ( (!user_mode or type == 1) and gadget )
     {
         // service searches PDU buffers and file
-        SEARCH_BUFFER(buf.IBT_KEY, PM_TYPE_KEY, pc.key_searches);
-        SEARCH_BUFFER(buf.IBT_HEADER, PM_TYPE_HEADER, pc.header_searches);
-        SEARCH_BUFFER(buf.IBT_BODY, PM_TYPE_BODY, pc.body_searches);
+        SEARCH_BUFFER(buf.IBT_KEY, PM_TYPE_KEY, pc.key_searches, false);
+        SEARCH_BUFFER(buf.IBT_HEADER, PM_TYPE_HEADER, pc.header_searches, false);
+        SEARCH_BUFFER(buf.IBT_BODY, PM_TYPE_BODY, pc.body_searches, true);
 
         // FIXIT-L PM_TYPE_ALT will never be set unless we add
         // norm_data keyword or telnet, rpc_decode, smtp keywords
         // until then we must use the standard packet mpse
-        SEARCH_BUFFER(buf.IBT_ALT, PM_TYPE_PKT, pc.alt_searches);
+        SEARCH_BUFFER(buf.IBT_ALT, PM_TYPE_PKT, pc.alt_searches, false);
     }
 
     if ( !user_mode or type > 0 )
@@ -978,7 +1169,7 @@ static int fp_search(
             // FIXIT-M file data should be obtained from
             // inspector gadget as is done with SEARCH_BUFFER
             if ( g_file_data.len )
-                SEARCH_DATA(g_file_data.data, g_file_data.len, pc.file_searches);
+                SEARCH_DATA(g_file_data.data, g_file_data.len, PM_TYPE_FILE, pc.file_searches, false);
         }
     }
     return 0;
@@ -1192,23 +1383,16 @@ static inline bool fpEvalHeaderSvc(Packet* p, OTNX_MATCH_DATA* omd, int proto)
 
     DebugFormat(DEBUG_ATTRIBUTE, "proto_ordinal=%d\n", proto_ordinal);
 
-    if (proto_ordinal > 0)
+    if ( proto_ordinal > 0 and (p->is_from_client() or p->is_from_server()) )
     {
-        if (p->is_from_server()) /* to cli */
-        {
-            DebugMessage(DEBUG_ATTRIBUTE, "pkt_from_server\n");
+        bool c2s = p->is_from_client();
+        sopg_table_t* sopg = snort_conf->sopgTable;
 
-            svc = snort_conf->sopgTable->get_port_group(proto, false, proto_ordinal);
-            file = snort_conf->sopgTable->get_port_group(proto, false, SNORT_PROTO_FILE);
-        }
+        DebugFormat(DEBUG_ATTRIBUTE, "pkt_from_%s\n", c2s ? "client" : "server");
 
-        if (p->is_from_client()) /* to srv */
-        {
-            DebugMessage(DEBUG_ATTRIBUTE, "pkt_from_client\n");
-
-            svc = snort_conf->sopgTable->get_port_group(proto, true, proto_ordinal);
-            file = snort_conf->sopgTable->get_port_group(proto, true, SNORT_PROTO_FILE);
-        }
+        // direct index by ordinal; no hashing per packet
+        svc = sopg->get_port_group(proto, c2s, proto_ordinal);
+        file = sopg->get_file_group(proto, c2s);
 
         DebugFormat(DEBUG_ATTRIBUTE,
             "fpEvalHeaderSvc:targetbased-ordinal-lookup: "
@@ -1296,6 +1480,8 @@ int fpEvalPacket(Packet* p)
 {
     OTNX_MATCH_DATA* omd = &t_omd;
     InitMatchInfo(omd);
+    batch.init();
+    header_sets_new_packet(snort_conf->header_sets);
 
     /* Run UDP rules against the UDP header of Teredo packets */
     // FIXIT-L udph is always inner; need to check for outer
@@ -1349,6 +1535,9 @@ int fpEvalPacket(Packet* p)
         break;
     }
 
+    if ( !batch.empty() )
+        batch.flush();
+
     return fpFinalSelectEvent(omd, p);
 }
 
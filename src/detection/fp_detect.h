@@ -66,16 +66,14 @@ int fpEvalRTN(RuleTreeNode* rtn, Packet* p, int check_ports);
 
 /*
 **  MATCH_INFO
-**  The events that are matched get held in this structure,
-**  and iMatchIndex gets set to the event that holds the
-**  highest priority.
+**  The events that are matched get held in this structure.  Once
+**  max_queue_events are held MatchArray is a heap with the lowest ranked
+**  event at the top so a better match can replace it in log time.
 */
 struct MATCH_INFO
 {
     const OptTreeNode* MatchArray[MAX_EVENT_MATCH];
     int iMatchCount;
-    int iMatchIndex;
-    int iMatchMaxLen;
 };
 
 /*
@@ -0,0 +1,529 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// header_match.cc
+
+#include "header_match.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "main/snort_config.h"
+#include "main/thread.h"
+#include "parser/parser.h"
+#include "ports/port_object.h"
+#include "sfip/sf_ip.h"
+#include "sfip/sf_ipvar.h"
+#include "sfip/sf_vartable.h"
+#include "treenodes.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+//-------------------------------------------------------------------------
+// address ranges
+//-------------------------------------------------------------------------
+
+// addresses are kept in host order; ip6 as (upper, lower) 64 bit halves
+typedef uint32_t Addr4;
+typedef std::pair<uint64_t, uint64_t> Addr6;
+
+static inline Addr4 next(Addr4 a)
+{ return a + 1; }
+
+static inline Addr4 prev(Addr4 a)
+{ return a - 1; }
+
+static inline Addr6 next(Addr6 a)
+{ return ++a.second ? a : Addr6(a.first + 1, 0); }
+
+static inline Addr6 prev(Addr6 a)
+{ return a.second-- ? a : Addr6(a.first - 1, a.second); }
+
+static inline bool is_max(Addr4 a)
+{ return a == 0xFFFFFFFF; }
+
+static inline bool is_max(const Addr6& a)
+{ return a.first == ~(uint64_t)0 and a.second == ~(uint64_t)0; }
+
+static inline Addr4 get_addr4(const sfip_t* ip)
+{ return ntohl(ip->ip32[0]); }
+
+static inline Addr6 get_addr6(const sfip_t* ip)
+{
+    return Addr6(
+        ((uint64_t)ntohl(ip->ip32[0]) << 32) | ntohl(ip->ip32[1]),
+        ((uint64_t)ntohl(ip->ip32[2]) << 32) | ntohl(ip->ip32[3]));
+}
+
+template<typename T>
+using Ranges = std::vector<std::pair<T, T>>;
+
+// sort and coalesce overlapping and adjacent ranges
+template<typename T>
+static void normalize(Ranges<T>& v)
+{
+    std::sort(v.begin(), v.end());
+    Ranges<T> out;
+
+    for ( const auto& r : v )
+    {
+        if ( !out.empty() and
+            (r.first <= out.back().second or
+            (!is_max(out.back().second) and r.first == next(out.back().second))) )
+        {
+            if ( out.back().second < r.second )
+                out.back().second = r.second;
+        }
+        else
+            out.push_back(r);
+    }
+    v.swap(out);
+}
+
+// remove the normalized neg ranges from the normalized pos ranges
+template<typename T>
+static void subtract(Ranges<T>& pos, const Ranges<T>& neg)
+{
+    Ranges<T> out;
+
+    for ( auto r : pos )
+    {
+        bool keep = true;
+
+        for ( const auto& n : neg )
+        {
+            if ( n.second < r.first or r.second < n.first )
+                continue;
+
+            if ( r.first < n.first )
+                out.push_back({ r.first, prev(n.first) });
+
+            if ( r.second <= n.second )
+            {
+                keep = false;
+                break;
+            }
+            r.first = next(n.second);
+        }
+        if ( keep )
+            out.push_back(r);
+    }
+    pos.swap(out);
+}
+
+template<typename T>
+static bool contains(const Ranges<T>& v, const T& a)
+{
+    auto it = std::upper_bound(v.begin(), v.end(), std::make_pair(a, a),
+        [](const std::pair<T, T>& x, const std::pair<T, T>& y)
+        { return x.first < y.first; });
+
+    return it != v.begin() and a <= (--it)->second;
+}
+
+// the ranges covered by a cidr node as sfip_fast_cont4/6() see it; a
+// network with host bits set matches nothing.
+static bool get_range4(const sfip_t* ip, std::pair<Addr4, Addr4>& r)
+{
+    unsigned bits = sfip_bits(ip);
+    Addr4 host = bits >= 32 ? 0 : (0xFFFFFFFF >> bits);
+    Addr4 net = get_addr4(ip);
+
+    if ( net & host )
+        return false;
+
+    r = { net, net | host };
+    return true;
+}
+
+static bool get_range6(const sfip_t* ip, std::pair<Addr6, Addr6>& r)
+{
+    unsigned bits = sfip_bits(ip);
+    Addr6 net = get_addr6(ip);
+    Addr6 host;
+
+    if ( bits >= 128 )
+        host = Addr6(0, 0);
+    else if ( bits >= 64 )
+        host = Addr6(0, ~(uint64_t)0 >> (bits - 64));
+    else
+        host = Addr6(~(uint64_t)0 >> bits, ~(uint64_t)0);
+
+    // only host bits in the last word compared are significant
+    unsigned word_bits = bits % 32;
+
+    if ( word_bits )
+    {
+        unsigned word = bits / 32;
+        uint32_t mask = 0xFFFFFFFF >> word_bits;
+
+        if ( ntohl(ip->ip32[word]) & mask )
+            return false;
+    }
+    net.first &= ~host.first;
+    net.second &= ~host.second;
+
+    r = { net, Addr6(net.first | host.first, net.second | host.second) };
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// compiled sets
+//-------------------------------------------------------------------------
+
+struct IpSet
+{
+    Ranges<Addr4> ip4;
+    Ranges<Addr6> ip6;
+
+    // position in the packet memo
+    unsigned index = 0;
+
+    bool operator<(const IpSet& rhs) const
+    { return ip4 < rhs.ip4 or (ip4 == rhs.ip4 and ip6 < rhs.ip6); }
+};
+
+struct HeaderSets
+{
+    std::set<IpSet> ip_sets;
+    std::unordered_set<PortBitSet> port_sets;
+
+    std::unordered_map<const sfip_var_t*, const IpSet*> ip_vars;
+    std::unordered_map<const PortObject*, const PortBitSet*> port_objs;
+};
+
+// the same result as sfvar_ip_in(): in some positive node and none of the
+// negated nodes of the address family.  unset nodes match everything.
+static void compile_ip_var(const sfip_var_t* var, IpSet& set)
+{
+    Ranges<Addr4> neg4;
+    Ranges<Addr6> neg6;
+    bool all = !var->head;
+
+    for ( const sfip_node_t* n = var->head; n and !all; n = n->next )
+    {
+        std::pair<Addr4, Addr4> r4;
+        std::pair<Addr6, Addr6> r6;
+
+        if ( !sfip_is_set(n->ip) )
+            all = true;
+
+        else if ( sfip_family(n->ip) == AF_INET and get_range4(n->ip, r4) )
+            set.ip4.push_back(r4);
+
+        else if ( sfip_family(n->ip) == AF_INET6 and get_range6(n->ip, r6) )
+            set.ip6.push_back(r6);
+    }
+
+    if ( all )
+    {
+        set.ip4 = { { 0, 0xFFFFFFFF } };
+        set.ip6 = { { Addr6(0, 0), Addr6(~(uint64_t)0, ~(uint64_t)0) } };
+    }
+
+    for ( const sfip_node_t* n = var->neg_head; n; n = n->next )
+    {
+        std::pair<Addr4, Addr4> r4;
+        std::pair<Addr6, Addr6> r6;
+
+        if ( sfip_family(n->ip) == AF_INET and get_range4(n->ip, r4) )
+            neg4.push_back(r4);
+
+        else if ( sfip_family(n->ip) == AF_INET6 and get_range6(n->ip, r6) )
+            neg6.push_back(r6);
+    }
+
+    normalize(set.ip4);
+    normalize(set.ip6);
+    normalize(neg4);
+    normalize(neg6);
+
+    subtract(set.ip4, neg4);
+    subtract(set.ip6, neg6);
+}
+
+static const IpSet* get_ip_set(HeaderSets* hs, const sfip_var_t* var)
+{
+    auto it = hs->ip_vars.find(var);
+
+    if ( it != hs->ip_vars.end() )
+        return it->second;
+
+    IpSet set;
+    compile_ip_var(var, set);
+
+    set.index = hs->ip_sets.size();
+    auto res = hs->ip_sets.insert(set);
+
+    const IpSet* ps = &*res.first;
+    hs->ip_vars[var] = ps;
+    return ps;
+}
+
+static const PortBitSet* get_port_set(HeaderSets* hs, PortObject* po)
+{
+    auto it = hs->port_objs.find(po);
+
+    if ( it != hs->port_objs.end() )
+        return it->second;
+
+    PortBitSet bits;
+    PortObjectHasPortBits(po, bits);
+
+    const PortBitSet* ps = &*hs->port_sets.insert(bits).first;
+    hs->port_objs[po] = ps;
+    return ps;
+}
+
+//-------------------------------------------------------------------------
+// lookups
+//-------------------------------------------------------------------------
+
+bool ip_set_contains(const IpSet* set, const sfip_t* ip)
+{
+    if ( !ip )
+        return false;
+
+    return ip->family == AF_INET ?
+        contains(set->ip4, get_addr4(ip)) : contains(set->ip6, get_addr6(ip));
+}
+
+// 2 bits per set (src and dst) for evaluated and for matched
+static THREAD_LOCAL uint64_t* s_memo_done = nullptr;
+static THREAD_LOCAL uint64_t* s_memo_match = nullptr;
+static THREAD_LOCAL unsigned s_memo_words = 0;
+
+bool ip_set_check(const IpSet* set, const sfip_t* ip, bool dst)
+{
+    unsigned bit = 2 * set->index + (dst ? 1 : 0);
+    unsigned word = bit / 64;
+    uint64_t mask = (uint64_t)1 << (bit % 64);
+
+    if ( word >= s_memo_words )
+        return ip_set_contains(set, ip);
+
+    if ( s_memo_done[word] & mask )
+        return s_memo_match[word] & mask;
+
+    bool match = ip_set_contains(set, ip);
+    s_memo_done[word] |= mask;
+
+    if ( match )
+        s_memo_match[word] |= mask;
+    else
+        s_memo_match[word] &= ~mask;
+
+    return match;
+}
+
+void header_sets_new_packet(const HeaderSets* hs)
+{
+    unsigned words = hs ? (2 * hs->ip_sets.size() + 63) / 64 : 0;
+
+    if ( words > s_memo_words )
+    {
+        // grows on reload as needed
+        header_sets_thread_term();
+        s_memo_done = new uint64_t[words];
+        s_memo_match = new uint64_t[words];
+        s_memo_words = words;
+    }
+    memset(s_memo_done, 0, s_memo_words * sizeof(*s_memo_done));
+}
+
+void header_sets_thread_term()
+{
+    delete[] s_memo_done;
+    delete[] s_memo_match;
+
+    s_memo_done = s_memo_match = nullptr;
+    s_memo_words = 0;
+}
+
+//-------------------------------------------------------------------------
+// api
+//-------------------------------------------------------------------------
+
+HeaderSets* header_sets_new()
+{ return new HeaderSets; }
+
+void header_sets_free(HeaderSets* hs)
+{ delete hs; }
+
+void header_sets_compile(SnortConfig* sc)
+{
+    if ( !sc->otn_map )
+        return;
+
+    if ( !sc->header_sets )
+        sc->header_sets = header_sets_new();
+
+    HeaderSets* hs = sc->header_sets;
+
+    for ( SFGHASH_NODE* node = sfghash_findfirst(sc->otn_map);
+        node;
+        node = sfghash_findnext(sc->otn_map) )
+    {
+        OptTreeNode* otn = (OptTreeNode*)node->data;
+
+        for ( PolicyId id = 0; id < otn->proto_node_num; ++id )
+        {
+            RuleTreeNode* rtn = getRtnFromOtn(otn, id);
+
+            if ( !rtn )
+                continue;
+
+            if ( rtn->sip )
+                rtn->sip_set = get_ip_set(hs, rtn->sip);
+
+            if ( rtn->dip )
+                rtn->dip_set = get_ip_set(hs, rtn->dip);
+
+            if ( rtn->src_portobject )
+                rtn->src_port_set = get_port_set(hs, rtn->src_portobject);
+
+            if ( rtn->dst_portobject )
+                rtn->dst_port_set = get_port_set(hs, rtn->dst_portobject);
+        }
+    }
+    // the lookup maps are only needed while compiling
+    hs->ip_vars.clear();
+    hs->port_objs.clear();
+}
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+static bool check(sfip_var_t* var, const char* addr)
+{
+    sfip_t ip;
+    REQUIRE(sfip_pton(addr, &ip) == SFIP_SUCCESS);
+
+    HeaderSets hs;
+    const IpSet* set = get_ip_set(&hs, var);
+
+    bool match = ip_set_contains(set, &ip);
+    CHECK(match == (sfvar_ip_in(var, &ip) != 0));
+
+    // and again from the memo
+    header_sets_new_packet(&hs);
+    CHECK(ip_set_check(set, &ip, false) == match);
+    CHECK(ip_set_check(set, &ip, false) == match);
+    header_sets_thread_term();
+
+    return match;
+}
+
+TEST_CASE("compiled ip sets", "[header_match]")
+{
+    vartable_t* table = sfvt_alloc_table();
+    sfip_var_t* var = sfvar_alloc(table,
+        "home [10.0.0.0/8,!10.1.0.0/16,192.168.1.1,2001:db8::/32,!2001:db8:1::/48]", nullptr);
+    REQUIRE(var);
+
+    CHECK(check(var, "10.0.0.1"));
+    CHECK(check(var, "10.255.255.255"));
+    CHECK(!check(var, "10.1.2.3"));
+    CHECK(check(var, "10.2.0.0"));
+    CHECK(check(var, "192.168.1.1"));
+    CHECK(!check(var, "192.168.1.2"));
+    CHECK(!check(var, "11.0.0.0"));
+    CHECK(check(var, "2001:db8::1"));
+    CHECK(!check(var, "2001:db8:1::1"));
+    CHECK(check(var, "2001:db8:2::1"));
+    CHECK(!check(var, "2001:db9::1"));
+
+    sfvar_free(var);
+    sfvt_free_table(table);
+}
+
+TEST_CASE("compiled negated ip sets", "[header_match]")
+{
+    vartable_t* table = sfvt_alloc_table();
+    sfip_var_t* var = sfvar_alloc(table, "away !192.168.0.0/16", nullptr);
+    REQUIRE(var);
+
+    CHECK(!check(var, "192.168.3.4"));
+    CHECK(check(var, "192.169.0.0"));
+    CHECK(check(var, "::1"));
+
+    sfvar_free(var);
+    sfvt_free_table(table);
+}
+
+TEST_CASE("ip set packet memo", "[header_match]")
+{
+    vartable_t* table = sfvt_alloc_table();
+    sfip_var_t* var = sfvar_alloc(table, "home 10.0.0.0/8", nullptr);
+    REQUIRE(var);
+
+    HeaderSets hs;
+    const IpSet* set = get_ip_set(&hs, var);
+
+    sfip_t in, out;
+    sfip_pton("10.1.2.3", &in);
+    sfip_pton("11.1.2.3", &out);
+
+    header_sets_new_packet(&hs);
+    CHECK(ip_set_check(set, &in, false));
+    CHECK(!ip_set_check(set, &out, true));
+
+    // same packet, so the results stand
+    CHECK(ip_set_check(set, &out, false));
+    CHECK(!ip_set_check(set, &in, true));
+
+    header_sets_new_packet(&hs);
+    CHECK(!ip_set_check(set, &out, false));
+    CHECK(ip_set_check(set, &in, true));
+
+    header_sets_thread_term();
+    sfvar_free(var);
+    sfvt_free_table(table);
+}
+
+TEST_CASE("compiled port sets", "[header_match]")
+{
+    PortObject* po = PortObjectNew();
+    PortObjectAddRange(po, 80, 90, 0);
+    PortObjectAddPort(po, 8080, 0);
+
+    HeaderSets hs;
+    const PortBitSet* ps = get_port_set(&hs, po);
+
+    for ( int i : { 0, 79, 80, 85, 90, 91, 8080, 65535 } )
+        CHECK(port_set_contains(ps, i) == (PortObjectHasPort(po, i) != 0));
+
+    PortObjectFree(po);
+}
+
+#endif
+
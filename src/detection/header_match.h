@@ -0,0 +1,63 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// header_match.h
+
+#ifndef HEADER_MATCH_H
+#define HEADER_MATCH_H
+
+// compiled rule header checks for fpEvalRTN()
+//
+// after the rules are parsed, the ip variables and port objects of each rtn
+// are reduced to sorted address ranges and port bitmaps.  each compiled set
+// is shared by all rtns with the same contents so $HOME_NET and friends are
+// only built once.  address lookups are a binary search.  each packet
+// thread also memoizes the result per set and direction until the next
+// packet, so the rtns behind the fast pattern hits of a packet that use the
+// same variable only search it once and then just test a bit.
+//
+// rtns without compiled sets (eg those generated at runtime) fall back to
+// sfvar_ip_in() and PortObjectHasPort().
+
+#include "framework/bits.h"
+
+struct sfip_t;
+struct SnortConfig;
+
+struct IpSet;
+struct HeaderSets;
+
+HeaderSets* header_sets_new();
+void header_sets_free(HeaderSets*);
+
+// sets the compiled checks of every rtn in sc->otn_map
+void header_sets_compile(SnortConfig*);
+
+bool ip_set_contains(const IpSet*, const sfip_t*);
+
+// memoized; ip must be the src (or dst) address of the current packet
+bool ip_set_check(const IpSet*, const sfip_t* ip, bool dst);
+
+// packet threads; clear the memo before evaluating each packet
+void header_sets_new_packet(const HeaderSets*);
+void header_sets_thread_term();
+
+inline bool port_set_contains(const PortBitSet* ps, uint16_t port)
+{ return ps->test(port); }
+
+#endif
+
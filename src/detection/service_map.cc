@@ -297,39 +297,24 @@ sopg_table_t::sopg_table_t()
     user_mode = false;
 }
 
-PortGroup* sopg_table_t::get_port_group(
-    int proto, bool c2s, int16_t proto_ordinal)
-{
-    assert(proto < SNORT_PROTO_MAX);
-
-    PortGroupVector& v = c2s ? to_srv[proto] : to_cli[proto];
-
-    if ( (unsigned)proto_ordinal >= v.size() )
-        return nullptr;
-
-    return v[proto_ordinal];
-}
-
+// called once the groups are built
 bool sopg_table_t::set_user_mode()
 {
-    PortGroupVector& v1 = to_srv[SNORT_PROTO_USER];
-
-    for ( unsigned i = 0; i < v1.size(); ++i )
+    for ( int i = SNORT_PROTO_IP; i < SNORT_PROTO_MAX; ++i )
     {
-        if ( v1[i] )
-        {
-            user_mode = true;
-            return true;
-        }
+        file_srv[i] = get_port_group(i, true, SNORT_PROTO_FILE);
+        file_cli[i] = get_port_group(i, false, SNORT_PROTO_FILE);
     }
-    v1 = to_cli[SNORT_PROTO_USER];
 
-    for ( unsigned i = 0; i < v1.size(); ++i )
+    for ( auto* v : { &to_srv[SNORT_PROTO_USER], &to_cli[SNORT_PROTO_USER] } )
     {
-        if ( v1[i] )
+        for ( auto* pg : *v )
         {
-            user_mode = true;
-            break;
+            if ( pg )
+            {
+                user_mode = true;
+                return true;
+            }
         }
     }
     return user_mode;
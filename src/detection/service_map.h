@@ -28,6 +28,8 @@
 //  for managing rule groups by service
 //  direction to client and to server are separate
 
+#include <assert.h>
+
 #include <vector>
 
 #include "detection/pcrm.h"
@@ -54,15 +56,33 @@ int fpCreateServiceMaps(struct SnortConfig*);
 //  Service/Protocol Oridinal To PortGroup table
 typedef std::vector<PortGroup*> PortGroupVector;
 
+// the vectors are sized to the protocol count when the table is built and
+// indexed directly by ordinal on every service packet.  the file groups
+// are searched with every service group so they are kept separately.
 struct sopg_table_t
 {
     sopg_table_t();
     bool set_user_mode();
-    PortGroup* get_port_group(int proto, bool c2s, int16_t proto_ordinal);
+
+    PortGroup* get_port_group(int proto, bool c2s, int16_t proto_ordinal)
+    {
+        assert(proto < SNORT_PROTO_MAX);
+        PortGroupVector& v = c2s ? to_srv[proto] : to_cli[proto];
+        return (unsigned)proto_ordinal < v.size() ? v[proto_ordinal] : nullptr;
+    }
+
+    PortGroup* get_file_group(int proto, bool c2s)
+    {
+        assert(proto < SNORT_PROTO_MAX);
+        return c2s ? file_srv[proto] : file_cli[proto];
+    }
 
     PortGroupVector to_srv[SNORT_PROTO_MAX];
     PortGroupVector to_cli[SNORT_PROTO_MAX];
 
+    PortGroup* file_srv[SNORT_PROTO_MAX] = { };
+    PortGroup* file_cli[SNORT_PROTO_MAX] = { };
+
     bool user_mode;
 };
 
@@ -36,10 +36,13 @@
 #include "log/log.h"
 #include "parser/parser.h"
 #include "events/event.h"
-#include "hash/sfxhash.h"
 #include "sfip/sfip_t.h"
 #include "sfip/sf_ip.h"
 
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
 /*  D E F I N E S  **************************************************/
 #define MAX_TAG_NODES   256
 
@@ -50,6 +53,13 @@
 #define TAG_PRUNE_QUANTUM   300
 #define TAG_MEMCAP          4194304  /* 4MB */
 
+/* expiry wheel; must span more than TAG_PRUNE_QUANTUM */
+#define TAG_WHEEL_SLOTS     64
+#define TAG_WHEEL_SHIFT     3        /* 8 seconds per slot */
+
+/* counters indexed by address hash for the fast negative check */
+#define TAG_FILTER_SIZE     1024
+
 #define GENERATOR_TAG       2
 #define TAG_LOG_PKT         1
 
@@ -96,15 +106,69 @@ struct TagNode
     struct timeval event_time;
 
     void* log_list;  // retain custom logging if any from triggering alert
+
+    /** table bookkeeping */
+    uint32_t hash;
+    unsigned wheel_slot;
+    TagNode* wheel_prev;
+    TagNode* wheel_next;
+};
+
+/**Open addressing table of TagNodes with linear probing.  Host tables
+ * are keyed on key.sip only, session tables on the whole key.  Nodes are
+ * also linked into an expiry wheel by last_access so pruning only looks
+ * at the slots that came due instead of walking all the nodes.  Moving a
+ * node on every access would cost more than it saves so nodes are left
+ * where they are and rechecked when their slot comes due.
+ */
+class TagTable
+{
+public:
+    TagTable(unsigned max_nodes, bool host);
+    ~TagTable();
+
+    TagNode* find(const tTagFlowKey&);
+    bool add(TagNode*);
+    void remove(TagNode*);
+    void clear();
+
+    // return number pruned
+    unsigned expire(uint32_t now);
+    unsigned evict(unsigned max);
+
+    // false if no node can match an address
+    bool may_have(const sfip_t*) const;
+
+    unsigned count() const
+    { return num_nodes; }
+
+private:
+    uint32_t hash_key(const tTagFlowKey&) const;
+    bool match(const TagNode*, const tTagFlowKey&) const;
+    void filter_update(const TagNode*, int);
+
+    void wheel_link(TagNode*);
+    void wheel_unlink(TagNode*);
+
+private:
+    TagNode** slots;
+    unsigned mask;
+    unsigned num_nodes;
+    unsigned max_nodes;
+    bool host;
+
+    TagNode* wheel[TAG_WHEEL_SLOTS];
+    uint32_t wheel_tick;
+
+    uint16_t filter[TAG_FILTER_SIZE];
 };
 
 /*  G L O B A L S  **************************************************/
-static THREAD_LOCAL SFXHASH* host_tag_cache_ptr = nullptr;
+static THREAD_LOCAL TagTable* host_tag_cache = nullptr;
 
 // FIXIT-M utilize Flow instead of separate cache
-static THREAD_LOCAL SFXHASH* ssn_tag_cache_ptr = nullptr;
+static THREAD_LOCAL TagTable* ssn_tag_cache = nullptr;
 
-static THREAD_LOCAL uint32_t last_prune_time = 0;
 static THREAD_LOCAL uint32_t tag_alloc_faults = 0;
 static THREAD_LOCAL uint32_t tag_memory_usage = 0;
 
@@ -117,75 +181,292 @@ static THREAD_LOCAL unsigned s_sessions = 0;
 static const unsigned s_max_sessions = 1;
 
 /*  P R O T O T Y P E S  ********************************************/
-static TagNode* TagAlloc(SFXHASH*);
-static void TagFree(SFXHASH*, TagNode*);
-static int TagFreeSessionNodeFunc(void* key, void* data);
-static int TagFreeHostNodeFunc(void* key, void* data);
+static TagNode* TagAlloc(uint32_t);
+static void TagFree(TagNode*);
 static int PruneTagCache(uint32_t, int);
-static int PruneTime(SFXHASH* tree, uint32_t thetime);
 static void TagSession(Packet*, TagData*, uint32_t, uint16_t, void*);
 static void TagHost(Packet*, TagData*, uint32_t, uint16_t, void*);
 static void AddTagNode(Packet*, TagData*, int, uint32_t, uint16_t, void*);
 static inline void SwapTag(TagNode*);
 
 /**Calculated memory needed per node insertion into respective cache. Its includes
- * memory needed for allocating TagNode, SFXHASH_NODE, and key size.
- *
- * @param hash - pointer to SFXHASH that should point to either ssn_tag_cache_ptr
- * or host_tag_cache_ptr.
+ * memory needed for allocating TagNode and its share of the table slots.
  *
  * @returns number of bytes needed
  */
-static inline unsigned int memory_per_node(
-    SFXHASH* hash
-    )
+static inline unsigned int memory_per_node()
+{
+    return sizeof(TagNode) + 2 * sizeof(TagNode*);
+}
+
+static inline uint32_t tag_filter_index(const sfip_t* ip)
+{
+    uint32_t h = ip->ip32[0] ^ ip->ip32[1] ^ ip->ip32[2] ^ ip->ip32[3];
+    return (h * 0x9e3779b1) >> 22;  // top 10 bits
+}
+
+//-------------------------------------------------------------------------
+// tag table
+//-------------------------------------------------------------------------
+
+TagTable::TagTable(unsigned max, bool h)
+{
+    unsigned sz = 2;
+
+    // keep the load factor under 1/2 when full
+    while ( sz < 2 * max )
+        sz <<= 1;
+
+    slots = (TagNode**)snort_calloc(sz, sizeof(TagNode*));
+    mask = sz - 1;
+    num_nodes = 0;
+    max_nodes = max;
+    host = h;
+
+    memset(wheel, 0, sizeof(wheel));
+    wheel_tick = 0;
+
+    memset(filter, 0, sizeof(filter));
+}
+
+TagTable::~TagTable()
+{
+    clear();
+    snort_free(slots);
+}
+
+uint32_t TagTable::hash_key(const tTagFlowKey& k) const
+{
+    const uint32_t* w = (const uint32_t*)&k;
+    unsigned n = host ? sizeof(k.sip) / 4 : sizeof(k) / 4;
+    uint32_t h = 2166136261;
+
+    for ( unsigned i = 0; i < n; ++i )
+        h = (h ^ w[i]) * 16777619;
+
+    return h ^ (h >> 15);
+}
+
+bool TagTable::match(const TagNode* tn, const tTagFlowKey& k) const
 {
-    if (hash == ssn_tag_cache_ptr)
+    if ( host )
+        return !memcmp(&tn->key.sip, &k.sip, sizeof(k.sip));
+
+    return !memcmp(&tn->key, &k, sizeof(k));
+}
+
+TagNode* TagTable::find(const tTagFlowKey& k)
+{
+    uint32_t h = hash_key(k);
+
+    for ( unsigned i = h & mask; slots[i]; i = (i + 1) & mask )
     {
-        return sizeof(tTagFlowKey)+sizeof(SFXHASH_NODE)+sizeof(TagNode);
+        if ( slots[i]->hash == h and match(slots[i], k) )
+            return slots[i];
     }
-    else if (hash == host_tag_cache_ptr)
+    return nullptr;
+}
+
+bool TagTable::add(TagNode* tn)
+{
+    if ( num_nodes >= max_nodes )
+        return false;
+
+    tn->hash = hash_key(tn->key);
+    unsigned i = tn->hash & mask;
+
+    while ( slots[i] )
+        i = (i + 1) & mask;
+
+    slots[i] = tn;
+    num_nodes++;
+
+    wheel_link(tn);
+    filter_update(tn, 1);
+    return true;
+}
+
+// backward shift deletion keeps probe sequences intact without tombstones
+void TagTable::remove(TagNode* tn)
+{
+    unsigned i = tn->hash & mask;
+
+    while ( slots[i] != tn )
+        i = (i + 1) & mask;
+
+    unsigned j = i;
+
+    while ( true )
     {
-        return sizeof(sfip_t)+sizeof(SFXHASH_NODE)+sizeof(TagNode);
+        j = (j + 1) & mask;
+
+        if ( !slots[j] )
+            break;
+
+        unsigned home = slots[j]->hash & mask;
+
+        // move j into the hole at i unless its home lies in (i, j]
+        if ( ((j - home) & mask) >= ((j - i) & mask) )
+        {
+            slots[i] = slots[j];
+            i = j;
+        }
     }
+    slots[i] = nullptr;
+    num_nodes--;
 
-    return 0;
+    wheel_unlink(tn);
+    filter_update(tn, -1);
+    TagFree(tn);
 }
 
+void TagTable::clear()
+{
+    for ( unsigned i = 0; i <= mask; ++i )
+    {
+        if ( slots[i] )
+        {
+            TagFree(slots[i]);
+            slots[i] = nullptr;
+        }
+    }
+    num_nodes = 0;
+    memset(wheel, 0, sizeof(wheel));
+    memset(filter, 0, sizeof(filter));
+}
+
+void TagTable::filter_update(const TagNode* tn, int inc)
+{
+    filter[tag_filter_index(&tn->key.sip)] += inc;
+
+    if ( !host )
+        filter[tag_filter_index(&tn->key.dip)] += inc;
+}
+
+bool TagTable::may_have(const sfip_t* ip) const
+{
+    return filter[tag_filter_index(ip)] != 0;
+}
+
+void TagTable::wheel_link(TagNode* tn)
+{
+    unsigned w = ((tn->last_access + TAG_PRUNE_QUANTUM) >> TAG_WHEEL_SHIFT) % TAG_WHEEL_SLOTS;
+
+    tn->wheel_slot = w;
+    tn->wheel_prev = nullptr;
+    tn->wheel_next = wheel[w];
+
+    if ( wheel[w] )
+        wheel[w]->wheel_prev = tn;
+
+    wheel[w] = tn;
+}
+
+void TagTable::wheel_unlink(TagNode* tn)
+{
+    if ( tn->wheel_next )
+        tn->wheel_next->wheel_prev = tn->wheel_prev;
+
+    if ( tn->wheel_prev )
+        tn->wheel_prev->wheel_next = tn->wheel_next;
+    else
+        wheel[tn->wheel_slot] = tn->wheel_next;
+}
+
+// visit the slots that came due since the last call; nodes accessed since
+// they were linked are moved to the slot for their new deadline
+unsigned TagTable::expire(uint32_t now)
+{
+    uint32_t tick = now >> TAG_WHEEL_SHIFT;
+    unsigned pruned = 0;
+
+    // idle or time went backwards; later slots are rechecked lazily
+    if ( !num_nodes or tick <= wheel_tick )
+    {
+        wheel_tick = tick;
+        return 0;
+    }
+
+    uint32_t start = wheel_tick + 1;
+
+    if ( tick - wheel_tick > TAG_WHEEL_SLOTS )
+        start = tick - TAG_WHEEL_SLOTS + 1;
+
+    for ( uint32_t t = start; t <= tick; ++t )
+    {
+        unsigned w = t % TAG_WHEEL_SLOTS;
+        TagNode* tn = wheel[w];
+        wheel[w] = nullptr;
+
+        while ( tn )
+        {
+            TagNode* next = tn->wheel_next;
+
+            if ( tn->last_access + TAG_PRUNE_QUANTUM < now )
+            {
+                tn->wheel_prev = tn->wheel_next = nullptr;
+                remove(tn);
+                pruned++;
+            }
+            else
+                wheel_link(tn);
+
+            tn = next;
+        }
+    }
+    wheel_tick = tick;
+    return pruned;
+}
+
+// drop up to max nodes starting with the ones due to expire soonest
+unsigned TagTable::evict(unsigned max)
+{
+    unsigned pruned = 0;
+
+    for ( unsigned t = 1; t <= TAG_WHEEL_SLOTS and pruned < max; ++t )
+    {
+        unsigned w = (wheel_tick + t) % TAG_WHEEL_SLOTS;
+
+        while ( wheel[w] and pruned < max )
+        {
+            remove(wheel[w]);
+            pruned++;
+        }
+    }
+    return pruned;
+}
+
+//-------------------------------------------------------------------------
+// tag node memory
+//-------------------------------------------------------------------------
+
 /** Allocate a TagNode
  *
  * Alocates a TagNode while guaranteeing that total memory usage remains within TAG_MEMCAP.
  * Least used nodes may be deleted from ssn_tag_cache and host_tag_cache to make space if
  * the limit is being exceeded.
  *
- * @param hash - pointer to SFXHASH that should point to either ssn_tag_cache_ptr
- * or host_tag_cache_ptr.
+ * @param now - packet time, which also drives the expiry wheel
  *
  * @returns a pointer to new TagNode or NULL if memory couldn't * be allocated
  */
-static TagNode* TagAlloc(
-    SFXHASH* hash
-    )
+static TagNode* TagAlloc(uint32_t now)
 {
     TagNode* tag_node = NULL;
 
-    if (tag_memory_usage + memory_per_node(hash) > TAG_MEMCAP)
+    if (tag_memory_usage + memory_per_node() > TAG_MEMCAP)
     {
         /* aggressively prune */
-        struct timeval tv;
-        struct timezone tz;
         int pruned_nodes = 0;
 
         tag_alloc_faults++;
 
-        gettimeofday(&tv, &tz);
-
-        pruned_nodes = PruneTagCache((uint32_t)tv.tv_sec, 0);
+        pruned_nodes = PruneTagCache(now, 0);
 
         if (pruned_nodes == 0)
         {
             /* if we can't prune due to time, just try to nuke
-             * 5 not so recently used nodes */
+             * 5 nodes that are closest to expiring */
             pruned_nodes = PruneTagCache(0, 5);
 
             /* unlikely to happen since memcap has been reached */
@@ -195,19 +476,16 @@ static TagNode* TagAlloc(
     }
 
     tag_node = (TagNode*)snort_calloc(sizeof(TagNode));
-    tag_memory_usage += memory_per_node(hash);
+    tag_memory_usage += memory_per_node();
 
     return tag_node;
 }
 
 /**Frees allocated TagNode.
  *
- * @param hash - pointer to SFXHASH that should point to either ssn_tag_cache_ptr
- * or host_tag_cache_ptr.
  * @param node - pointer to node to be freed
  */
 static void TagFree(
-    SFXHASH* hash,
     TagNode* node
     )
 {
@@ -218,37 +496,15 @@ static void TagFree(
         s_exclusive = false;
 
     snort_free((void*)node);
-    tag_memory_usage -= memory_per_node(hash);
-}
-
-/**Callback from session tag cache to free user data.
- * @param key - pointer to key to session tag
- * @param data - pointer to user data, to be freed.
- * @returns 0
- */
-static int TagFreeSessionNodeFunc(void*, void* data)
-{
-    TagFree(ssn_tag_cache_ptr, (TagNode*)data);
-    return 0;
-}
-
-/**Callback from host tag cache to free user data.
- * @param key - pointer to key to session tag
- * @param data - pointer to user data, to be freed.
- * @returns 0
- */
-static int TagFreeHostNodeFunc(void*, void* data)
-{
-    TagFree(host_tag_cache_ptr, (TagNode*)data);
-    return 0;
+    tag_memory_usage -= memory_per_node();
 }
 
 /**Reset all data structures and free all memory.
  */
 void TagCacheReset()
 {
-    sfxhash_make_empty(ssn_tag_cache_ptr);
-    sfxhash_make_empty(host_tag_cache_ptr);
+    ssn_tag_cache->clear();
+    host_tag_cache->clear();
 }
 
 /**
@@ -272,40 +528,19 @@ static inline void SwapTag(TagNode* np)
 
 void InitTag()
 {
-    unsigned int hashTableSize = TAG_MEMCAP/sizeof(TagNode);
-
-    ssn_tag_cache_ptr = sfxhash_new(
-        hashTableSize,                      /* number of hash buckets */
-        sizeof(tTagFlowKey),             /* size of the key we're going to use */
-        0,                                  /* size of the storage node */
-        0,                                  /* disable memcap*/
-        0,                                  /* use auto node recovery */
-        NULL,                               /* anr free function */
-        TagFreeSessionNodeFunc,             /* user free function */
-        0);                                 /* recycle node flag */
-
-    host_tag_cache_ptr = sfxhash_new(
-        hashTableSize,               /* number of hash buckets */
-        sizeof(sfip_t),            /* size of the key we're going to use */
-        0,                           /* size of the storage node */
-        0,                           /* disable memcap*/
-        0,                           /* use auto node recovery */
-        NULL,                        /* anr free function */
-        TagFreeHostNodeFunc,         /* user free function */
-        0);                          /* recycle node flag */
+    unsigned int max_nodes = TAG_MEMCAP / memory_per_node();
+
+    ssn_tag_cache = new TagTable(max_nodes, false);
+    host_tag_cache = new TagTable(max_nodes, true);
 }
 
 void CleanupTag()
 {
-    if (ssn_tag_cache_ptr)
-    {
-        sfxhash_delete(ssn_tag_cache_ptr);
-    }
+    delete ssn_tag_cache;
+    ssn_tag_cache = nullptr;
 
-    if (host_tag_cache_ptr)
-    {
-        sfxhash_delete(host_tag_cache_ptr);
-    }
+    delete host_tag_cache;
+    host_tag_cache = nullptr;
 }
 
 static void TagSession(Packet* p, TagData* tag, uint32_t time, uint16_t event_id, void* log_list)
@@ -342,7 +577,7 @@ static void AddTagNode(Packet* p, TagData* tag, int mode, uint32_t now,
 {
     TagNode* idx;  /* index pointer */
     TagNode* returned;
-    SFXHASH* tag_cache_ptr = NULL;
+    TagTable* tag_cache = NULL;
 
     DebugMessage(DEBUG_FLOW, "Adding new Tag Head\n");
 
@@ -360,14 +595,14 @@ static void AddTagNode(Packet* p, TagData* tag, int mode, uint32_t now,
     if (mode == TAG_SESSION)
     {
         DebugMessage(DEBUG_FLOW,"Session Tag!\n");
-        tag_cache_ptr = ssn_tag_cache_ptr;
+        tag_cache = ssn_tag_cache;
     }
     else
     {
         DebugMessage(DEBUG_FLOW,"Host Tag!\n");
-        tag_cache_ptr = host_tag_cache_ptr;
+        tag_cache = host_tag_cache;
     }
-    idx = TagAlloc(tag_cache_ptr);
+    idx = TagAlloc(now);
 
     /* If a TagNode couldn't be allocated, just write an error message
      * and return - won't be able to track this one. */
@@ -410,13 +645,13 @@ static void AddTagNode(Packet* p, TagData* tag, int mode, uint32_t now,
     }
 
     /* check for duplicates */
-    returned = (TagNode*)sfxhash_find(tag_cache_ptr, idx);
+    returned = tag_cache->find(idx->key);
 
     if (returned == NULL)
     {
         DebugMessage(DEBUG_FLOW,"Looking the other way!!\n");
         SwapTag(idx);
-        returned = (TagNode*)sfxhash_find(tag_cache_ptr, idx);
+        returned = tag_cache->find(idx->key);
         SwapTag(idx);
     }
 
@@ -431,12 +666,12 @@ static void AddTagNode(Packet* p, TagData* tag, int mode, uint32_t now,
             SwapTag(idx);
         }
 
-        if (sfxhash_add(tag_cache_ptr, idx, idx) != SFXHASH_OK)
+        if ( !tag_cache->add(idx) )
         {
             DebugMessage(DEBUG_FLOW,
-                "sfxhash_add failed, that's going to "
+                "tag table add failed, that's going to "
                 "make life difficult\n");
-            TagFree(tag_cache_ptr, idx);
+            TagFree(idx);
             return;
         }
     }
@@ -450,19 +685,19 @@ static void AddTagNode(Packet* p, TagData* tag, int mode, uint32_t now,
             returned->seconds += idx->seconds;
 
         /* get rid of the new tag since we are using an existing one */
-        TagFree(tag_cache_ptr, idx);
+        TagFree(idx);
     }
 }
 
 int CheckTagList(Packet* p, Event* event, void** log_list)
 {
-    TagNode idx;
+    tTagFlowKey key;
     TagNode* returned = NULL;
-    SFXHASH* taglist = NULL;
+    TagTable* taglist = NULL;
     char create_event = 1;
 
     /* check for active tags */
-    if (!sfxhash_count(host_tag_cache_ptr) && !sfxhash_count(ssn_tag_cache_ptr))
+    if (!host_tag_cache->count() && !ssn_tag_cache->count())
     {
         return 0;
     }
@@ -473,63 +708,81 @@ int CheckTagList(Packet* p, Event* event, void** log_list)
         return 0;
     }
 
+    /* expire what came due; this touches only the wheel slots whose
+     * time has passed so it is cheap enough to do on every packet */
+    PruneTagCache(p->pkth->ts.tv_sec, 0);
+
+    const sfip_t* src = p->ptrs.ip_api.get_src();
+    const sfip_t* dst = p->ptrs.ip_api.get_dst();
+
+    /* skip the lookups when no tag involves either address */
+    bool ssn_maybe = ssn_tag_cache->may_have(src) && ssn_tag_cache->may_have(dst);
+    bool host_maybe = host_tag_cache->may_have(src) || host_tag_cache->may_have(dst);
+
+    if ( !ssn_maybe && !host_maybe )
+        return 0;
+
     DebugFormat(DEBUG_FLOW,"Host Tags Active: %u   Session Tags Active: %u\n",
-        sfxhash_count(host_tag_cache_ptr), sfxhash_count(ssn_tag_cache_ptr));
+        host_tag_cache->count(), ssn_tag_cache->count());
 
     DebugMessage(DEBUG_FLOW, "[*] Checking session tag list (forward)...\n");
 
-    sfip_copy(idx.key.sip, p->ptrs.ip_api.get_src());
-    sfip_copy(idx.key.dip, p->ptrs.ip_api.get_dst());
-    idx.key.sp = p->ptrs.sp;
-    idx.key.dp = p->ptrs.dp;
+    sfip_copy(key.sip, src);
+    sfip_copy(key.dip, dst);
+    key.sp = p->ptrs.sp;
+    key.dp = p->ptrs.dp;
 
     /* check for session tags... */
-    returned = (TagNode*)sfxhash_find(ssn_tag_cache_ptr, &idx);
+    if ( ssn_maybe )
+        returned = ssn_tag_cache->find(key);
 
     if (returned == NULL)
     {
-        sfip_copy(idx.key.dip, p->ptrs.ip_api.get_src());
-        sfip_copy(idx.key.sip, p->ptrs.ip_api.get_dst());
-        idx.key.dp = p->ptrs.sp;
-        idx.key.sp = p->ptrs.dp;
+        sfip_copy(key.dip, src);
+        sfip_copy(key.sip, dst);
+        key.dp = p->ptrs.sp;
+        key.sp = p->ptrs.dp;
 
         DebugMessage(DEBUG_FLOW, "   Checking session tag list (reverse)...\n");
-        returned = (TagNode*)sfxhash_find(ssn_tag_cache_ptr, &idx);
+
+        if ( ssn_maybe )
+            returned = ssn_tag_cache->find(key);
 
         if (returned == NULL)
         {
             DebugMessage(DEBUG_FLOW, "   Checking host tag list "
                 "(forward)...\n");
 
-            returned = (TagNode*)sfxhash_find(host_tag_cache_ptr, &idx);
+            if ( host_tag_cache->may_have(dst) )
+                returned = host_tag_cache->find(key);
 
-            if (returned == NULL)
+            if (returned == NULL && host_tag_cache->may_have(src))
             {
                 /*
                 **  Only switch sip, because that's all we check for
                 **  the host tags.
                 */
-                sfip_copy(idx.key.sip, p->ptrs.ip_api.get_src());
+                sfip_copy(key.sip, src);
 
-                returned = (TagNode*)sfxhash_find(host_tag_cache_ptr, &idx);
+                returned = host_tag_cache->find(key);
             }
 
             if (returned != NULL)
             {
                 DebugMessage(DEBUG_FLOW,"   [*!*] Found host node\n");
-                taglist = host_tag_cache_ptr;
+                taglist = host_tag_cache;
             }
         }
         else
         {
             DebugMessage(DEBUG_FLOW,"   [*!*] Found session node\n");
-            taglist = ssn_tag_cache_ptr;
+            taglist = ssn_tag_cache;
         }
     }
     else
     {
         DebugMessage(DEBUG_FLOW,"   [*!*] Found session node\n");
-        taglist = ssn_tag_cache_ptr;
+        taglist = ssn_tag_cache;
     }
 
     if (returned != NULL)
@@ -597,21 +850,10 @@ int CheckTagList(Packet* p, Event* event, void** log_list)
             DebugMessage(DEBUG_FLOW,
                 "    Prune condition met for tag, removing from list\n");
 
-            if (sfxhash_remove(taglist, returned) != SFXHASH_OK)
-            {
-                LogMessage("WARNING: failed to remove tagNode from hash.\n");
-            }
+            taglist->remove(returned);
         }
     }
 
-    if ( (u_int)(p->pkth->ts.tv_sec) > last_prune_time + TAG_PRUNE_QUANTUM )
-    {
-        DebugMessage(DEBUG_FLOW,
-            "Exceeded Prune Quantum, pruning tag trees\n");
-        PruneTagCache(p->pkth->ts.tv_sec, 0);
-        last_prune_time = p->pkth->ts.tv_sec;
-    }
-
     if ( returned && create_event )
         return 1;
 
@@ -624,64 +866,15 @@ static int PruneTagCache(uint32_t thetime, int mustdie)
 
     if (mustdie == 0)
     {
-        if (sfxhash_count(ssn_tag_cache_ptr) != 0)
-        {
-            pruned = PruneTime(ssn_tag_cache_ptr, thetime);
-        }
-
-        if (sfxhash_count(host_tag_cache_ptr) != 0)
-        {
-            pruned += PruneTime(host_tag_cache_ptr, thetime);
-        }
+        pruned = ssn_tag_cache->expire(thetime);
+        pruned += host_tag_cache->expire(thetime);
     }
     else
     {
-        TagNode* lru_node = NULL;
-
-        while (pruned < mustdie &&
-            (sfxhash_count(ssn_tag_cache_ptr) > 0 || sfxhash_count(host_tag_cache_ptr) > 0))
-        {
-            if ((lru_node = (TagNode*)sfxhash_lru(ssn_tag_cache_ptr)) != NULL)
-            {
-                if (sfxhash_remove(ssn_tag_cache_ptr, lru_node) != SFXHASH_OK)
-                {
-                    LogMessage("WARNING: failed to remove tagNode from hash.\n");
-                }
-                pruned++;
-            }
-            if ((lru_node = (TagNode*)sfxhash_lru(host_tag_cache_ptr)) != NULL)
-            {
-                if (sfxhash_remove(host_tag_cache_ptr, lru_node) != SFXHASH_OK)
-                {
-                    LogMessage("WARNING: failed to remove tagNode from hash.\n");
-                }
-                pruned++;
-            }
-        }
-    }
+        pruned = ssn_tag_cache->evict(mustdie);
 
-    return pruned;
-}
-
-static int PruneTime(SFXHASH* tree, uint32_t thetime)
-{
-    int pruned = 0;
-    TagNode* lru_node = NULL;
-
-    while ((lru_node = (TagNode*)sfxhash_lru(tree)) != NULL)
-    {
-        if ((lru_node->last_access + TAG_PRUNE_QUANTUM) < thetime)
-        {
-            if (sfxhash_remove(tree, lru_node) != SFXHASH_OK)
-            {
-                LogMessage("WARNING: failed to remove tagNode from hash.\n");
-            }
-            pruned++;
-        }
-        else
-        {
-            break;
-        }
+        if ( pruned < mustdie )
+            pruned += host_tag_cache->evict(mustdie - pruned);
     }
 
     return pruned;
@@ -726,3 +919,98 @@ void SetTags(Packet* p, const OptTreeNode* otn, uint16_t event_id)
     }
 }
 
+
+#ifdef UNIT_TEST
+
+static TagNode* make_node(uint32_t a, uint32_t b, uint32_t now)
+{
+    TagNode* tn = TagAlloc(now);
+    tn->key.sip.family = tn->key.dip.family = AF_INET;
+    tn->key.sip.ip32[0] = a;
+    tn->key.dip.ip32[0] = b;
+    tn->key.sp = 1234;
+    tn->key.dp = 80;
+    tn->last_access = now;
+    return tn;
+}
+
+TEST_CASE("tag table add find remove", "[tag]")
+{
+    TagTable tt(256, false);
+    TagNode* nodes[200];
+
+    for ( unsigned i = 0; i < 200; ++i )
+    {
+        nodes[i] = make_node(i, i + 1000, 100);
+        CHECK(tt.add(nodes[i]));
+    }
+    CHECK(tt.count() == 200);
+
+    // remove every other one so probe chains get shifted
+    for ( unsigned i = 0; i < 200; i += 2 )
+        tt.remove(nodes[i]);
+
+    CHECK(tt.count() == 100);
+
+    for ( unsigned i = 0; i < 200; ++i )
+    {
+        TagNode* tn = make_node(i, i + 1000, 100);
+        CHECK((tt.find(tn->key) != nullptr) == ((i & 1) != 0));
+        TagFree(tn);
+    }
+}
+
+TEST_CASE("tag table filter", "[tag]")
+{
+    TagTable ssn(16, false);
+    TagTable host(16, true);
+
+    TagNode* tn = make_node(1, 2, 100);
+    sfip_t ip = tn->key.dip;
+    ssn.add(tn);
+    CHECK(ssn.may_have(&ip));
+
+    host.add(make_node(3, 4, 100));
+    ip.ip32[0] = 4;
+    CHECK(!host.may_have(&ip));
+    ip.ip32[0] = 3;
+    CHECK(host.may_have(&ip));
+
+    ssn.remove(tn);
+    CHECK(!ssn.may_have(&ip));
+}
+
+TEST_CASE("tag table expire", "[tag]")
+{
+    TagTable tt(16, false);
+    TagNode* stale = make_node(1, 2, 1000);
+    TagNode* live = make_node(3, 4, 1000);
+
+    tt.add(stale);
+    tt.add(live);
+    CHECK(tt.expire(1000) == 0);
+
+    // live was accessed later so it is only relinked when its slot is due
+    live->last_access = 1200;
+    CHECK(tt.expire(1000 + TAG_PRUNE_QUANTUM + 2 * (1 << TAG_WHEEL_SHIFT)) == 1);
+    CHECK(tt.count() == 1);
+    CHECK(tt.find(live->key) == live);
+
+    CHECK(tt.expire(1200 + TAG_PRUNE_QUANTUM + 2 * (1 << TAG_WHEEL_SHIFT)) == 1);
+    CHECK(tt.count() == 0);
+}
+
+TEST_CASE("tag table evict", "[tag]")
+{
+    TagTable tt(16, true);
+
+    for ( unsigned i = 0; i < 10; ++i )
+        tt.add(make_node(i, 0, 1000 + 10 * i));
+
+    CHECK(tt.evict(5) == 5);
+    CHECK(tt.count() == 5);
+    CHECK(tt.add(make_node(42, 0, 1000)));
+}
+
+#endif
+
@@ -29,7 +29,9 @@
 #include "main/snort_types.h"
 #include "detection/signature.h"
 #include "detection/rule_option_types.h"
+#include "framework/bits.h"
 #include "actions/actions.h"
+#include "profiler/counter_profiler_defs.h"
 #include "time/clock_defs.h"
 
 class IpsOption;
@@ -39,6 +41,7 @@ struct PortObject;
 struct OutputSet;
 struct TagData;
 struct sfip_var_t;
+struct IpSet;
 
 /* same as the rule header FP list */
 struct OptFpList
@@ -69,6 +72,8 @@ struct OtnState
     uint64_t latency_timeouts = 0;
     uint64_t latency_suspends = 0;
 
+    CounterStats counters = { 0, 0, 0, 0 };
+
     operator bool() const
     { return elapsed > 0_ticks || checks > 0; }
 };
@@ -149,6 +154,13 @@ struct RuleTreeNode
     PortObject* src_portobject;
     PortObject* dst_portobject;
 
+    /* compiled from the above by header_sets_compile() */
+    const IpSet* sip_set;
+    const IpSet* dip_set;
+
+    const PortBitSet* src_port_set;
+    const PortBitSet* dst_port_set;
+
     struct ListHead* listhead;
 
     int proto;
@@ -80,7 +80,7 @@ SF_EVENTQ* sfeventq_new(int max_nodes, int log_nodes, int event_size)
     eq = (SF_EVENTQ*)snort_calloc(sizeof(SF_EVENTQ));
 
     /* Initialize the memory for the nodes that we are going to use. */
-    eq->node_mem = (SF_EVENTQ_NODE*)snort_calloc(max_nodes, sizeof(SF_EVENTQ_NODE));
+    eq->node_mem = (void**)snort_calloc(max_nodes, sizeof(void*));
     eq->event_mem = (char*)snort_calloc(max_nodes + 1, event_size);
 
     eq->max_nodes = max_nodes;
@@ -143,7 +143,6 @@ void* sfeventq_event_alloc(SF_EVENTQ* eq)
 */
 void sfeventq_reset(SF_EVENTQ* eq)
 {
-    eq->head = NULL;
     eq->cur_nodes = 0;
     eq->cur_events = 0;
     eq->reserve_event = (char*)(&eq->event_mem[eq->max_nodes * eq->event_size]);
@@ -180,46 +179,14 @@ void sfeventq_free(SF_EVENTQ* eq)
     snort_free(eq);
 }
 
-/*
-**  NAME
-**    get_eventq_node::
-*/
-/**
-**  This function returns a ptr to the node to use.  We allocate the last
-**  event node if we have exhausted the event queue.  Before we allocate
-**  the last node, we determine if the incoming event has a higher
-**  priority than the last node.  If it does, we allocate the node, otherwise
-**  we drop it because it is lower priority.
-**
-**  If the last node is allocated, we have to point the reserve_event to
-**  the allocated event memory, since the reserved_event memory was used
-**  for the incoming event.
-**
-**  @return SF_EVENTQ_NODE *
-**
-**  @retval NULL resource exhaustion and event is lower priority than last node
-**  @retval !NULL ptr to node memory.
-*/
-static SF_EVENTQ_NODE* get_eventq_node(SF_EVENTQ* eq, void*)
-{
-    if (eq->cur_nodes >= eq->max_nodes)
-        return NULL;
-
-    /*
-    **  We grab the next node from the node memory.
-    */
-    return &eq->node_mem[eq->cur_nodes++];
-}
-
 /*
 **  NAME
 **    sfeventq_add:
 */
 /**
-**  Add this event to the queue using the supplied ordering
-**  function.  If the queue is exhausted, then we compare the
-**  event to be added with the last event, and decide whether
-**  it is a higher priority than the last node.
+**  Add this event to the end of the queue.  Events are already
+**  ranked by fpFinalSelectEvent() so once the queue is exhausted
+**  any further events are lower priority and are dropped.
 **
 **  @return integer
 **
@@ -228,42 +195,17 @@ static SF_EVENTQ_NODE* get_eventq_node(SF_EVENTQ* eq, void*)
 */
 int sfeventq_add(SF_EVENTQ* eq, void* event)
 {
-    SF_EVENTQ_NODE* node;
-
     if (!event)
         return -1;
 
     /*
-    **  If get_eventq_node() returns NULL, this means that
-    **  we have exhausted the eventq and the incoming event
-    **  is lower in priority then the last ranked event.
-    **  So we just drop it.
+    **  If the queue is full we have exhausted the eventq
+    **  so we just drop it.
     */
-    node = get_eventq_node(eq, event);
-    if (!node)
+    if (eq->cur_nodes >= eq->max_nodes)
         return -1;
 
-    node->event = event;
-    node->next  = NULL;
-    node->prev  = NULL;
-
-    /*
-    **  This is the first node
-    */
-    if (eq->cur_nodes == 1)
-    {
-        eq->head = eq->last = node;
-        return 0;
-    }
-
-    /*
-    **  This means we are the last node.
-    */
-    node->prev = eq->last;
-
-    eq->last->next = node;
-    eq->last = node;
-
+    eq->node_mem[eq->cur_nodes++] = event;
     return 0;
 }
 
@@ -283,24 +225,18 @@ int sfeventq_add(SF_EVENTQ* eq, void* event)
 */
 int sfeventq_action(SF_EVENTQ* eq, int (* action_func)(void*, void*), void* user)
 {
-    SF_EVENTQ_NODE* node;
-    int logged = 0;
-
     if (action_func == NULL)
         return -1;
 
-    if (eq->head == NULL)
+    if (eq->cur_nodes == 0)
         return 0;
 
-    for (node = eq->head; node != NULL; node = node->next)
-    {
-        if (logged >= eq->log_nodes)
-            return 1;
+    int n = eq->cur_nodes < eq->log_nodes ? eq->cur_nodes : eq->log_nodes;
 
-        if (action_func(node->event, user))
+    for (int i = 0; i < n; i++)
+    {
+        if (action_func(eq->node_mem[i], user))
             return -1;
-
-        logged++;
     }
 
     return 1;
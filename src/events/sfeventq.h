@@ -20,24 +20,14 @@
 #ifndef SFEVENTQ_H
 #define SFEVENTQ_H
 
-typedef struct s_SF_EVENTQ_NODE
-{
-    void* event;
-
-    struct s_SF_EVENTQ_NODE* prev;
-    struct s_SF_EVENTQ_NODE* next;
-}  SF_EVENTQ_NODE;
-
 typedef struct s_SF_EVENTQ
 {
     /*
-    **  Handles the actual ordering and memory
-    **  of the event queue and it's nodes.
+    **  Handles the actual ordering and memory of the event queue.
+    **  Events are kept in insertion order in a fixed array so there
+    **  are no links to chase when the queue is logged.
     */
-    SF_EVENTQ_NODE* head;
-    SF_EVENTQ_NODE* last;
-
-    SF_EVENTQ_NODE* node_mem;
+    void** node_mem;
     char* event_mem;
 
     /*
@@ -109,9 +109,10 @@ void FileCapture::stop()
     FileCaptureBlock* fileblock = head;
     while (fileblock)
     {
+        FileCaptureBlock* next = fileblock->next;
         if (file_mempool_free(file_mempool, fileblock) != FILE_MEM_SUCCESS)
             file_capture_stats.file_buffers_free_errors++;
-        fileblock = fileblock->next;
+        fileblock = next;
         file_capture_stats.file_buffers_freed_total++;
     }
 
@@ -426,9 +427,11 @@ void FileCapture::release_file()
 
     while (fileblock)
     {
+        /*once released the block may be reused by another thread*/
+        FileCaptureBlock* next = fileblock->next;
         if (file_mempool_release(file_mempool, fileblock) != FILE_MEM_SUCCESS)
             file_capture_stats.file_buffers_release_errors++;
-        fileblock = fileblock->next;
+        fileblock = next;
         file_capture_stats.file_buffers_released_total++;
     }
 
@@ -529,10 +532,18 @@ void FileCapture::print_mem_usage()
         LogCount("Max buffers can allocate", file_mempool->total);
         LogCount("Buffers in use", file_mempool_allocated(file_mempool));
         LogCount("Buffers in free list", file_mempool_freed(file_mempool));
-        LogCount("Buffers in release list", file_mempool_released(file_mempool));
+        LogCount("Buffers released", file_mempool_released(file_mempool));
+        LogCount("Buffer pool batches", file_mempool->stack_ops.load());
+        LogCount("Buffer pool contention", file_mempool_contention(file_mempool));
     }
 }
 
+void FileCapture::thread_term()
+{
+    if (file_mempool)
+        file_mempool_thread_term(file_mempool);
+}
+
 /*
  *  Release all file capture memory etc,
  *  this must be called when snort exits
@@ -83,6 +83,9 @@ public:
     // Log file capture mempool usage
     static void print_mem_usage();
 
+    // Return this packet thread's cached buffers to the pool
+    static void thread_term();
+
     // Exit file capture, release all file capture memory etc,
     // this must be called when snort exits
     static void exit();
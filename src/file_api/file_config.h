@@ -42,6 +42,7 @@ class FileConfig
 public:
     FileMagicRule* get_rule_from_id(uint32_t);
     void process_file_rule(FileMagicRule&);
+    void compile_file_rules();
     void process_file_policy_rule(FileRule&);
     bool process_file_magic(FileMagicData&);
     uint32_t find_file_type_id(const uint8_t* buf, int len, uint64_t file_offset, void** context);
@@ -50,6 +51,7 @@ public:
 
     int64_t file_type_depth = DEFAULT_FILE_TYPE_DEPTH;
     int64_t file_signature_depth = DEFAULT_FILE_SIGNATURE_DEPTH;
+    int64_t signature_threads = 0;
     int64_t file_block_timeout = DEFAULT_FILE_BLOCK_TIMEOUT;
     int64_t file_lookup_timeout = DEFAULT_FILE_LOOKUP_TIMEOUT;
     bool block_timeout_lookup = false;
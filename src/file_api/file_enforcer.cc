@@ -47,6 +47,8 @@ FileEnforcer::FileEnforcer()
         MAX_MEMORY_USED, 1, NULL, NULL, 1);
     if (!fileHash)
         FatalError("Failed to create the expected channel hash table.\n");
+
+    sfxhash_set_stats(fileHash, "file_enforcer");
 }
 
 FileEnforcer::~FileEnforcer()
@@ -161,6 +161,7 @@ bool FileFlows::file_process(FileContext* context, const uint8_t* file_data,
         return false;
 
     set_current_file_context(context);
+    context->set_stable_data(stable_data);
     file_stats.file_data_total += data_size;
 
     if ((!context->is_file_type_enabled()) and (!context->is_file_signature_enabled()))
@@ -272,6 +273,9 @@ void FileFlows::set_file_name(const uint8_t* fname, uint32_t name_size)
         context->print(std::cout);
 }
 
+// registered at startup so publishing is just an index
+static const unsigned file_event_id = DataBus::get_id("file_event");
+
 void FileFlows::log_file_event(FileContext* context, Flow* flow)
 {
     if ( context->get_file_name().length() )
@@ -280,16 +284,16 @@ void FileFlows::log_file_event(FileContext* context, Flow* flow)
         {
         case FILE_VERDICT_LOG:
             // Log file event through data bus
-            get_data_bus().publish("file_event", (const uint8_t*)"LOG", 3, flow);
+            get_data_bus().publish(file_event_id, (const uint8_t*)"LOG", 3, flow);
             break;
 
         case FILE_VERDICT_BLOCK:
             // can't block session inside a session
-            get_data_bus().publish( "file_event", (const uint8_t*)"BLOCK", 5, flow);
+            get_data_bus().publish(file_event_id, (const uint8_t*)"BLOCK", 5, flow);
             break;
 
         case FILE_VERDICT_REJECT:
-            get_data_bus().publish( "file_event", (const uint8_t*)"RESET", 5, flow);
+            get_data_bus().publish(file_event_id, (const uint8_t*)"RESET", 5, flow);
             break;
         default:
             break;
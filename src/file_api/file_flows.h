@@ -49,6 +49,10 @@ public:
 
     void set_file_name(const uint8_t* fname, uint32_t name_size);
 
+    // file data stays valid until the file is done; set per packet
+    void set_stable_data(bool b)
+    { stable_data = b; }
+
     // This is used when there is only one file per session
     bool file_process(const uint8_t* file_data, int data_size, FilePosition,
         bool upload, size_t file_index = 0);
@@ -70,6 +74,7 @@ private:
     FileContext* current_context = nullptr;
     uint32_t max_file_id = 0;
     Flow* flow = nullptr;
+    bool stable_data = false;
 };
 #endif
 
@@ -0,0 +1,229 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// file_hasher.cc
+
+#include "file_hasher.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <thread>
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+//-------------------------------------------------------------------------
+// pool
+//-------------------------------------------------------------------------
+
+static std::vector<std::thread*> s_workers;
+static std::mutex s_lock;
+static std::condition_variable s_ready;
+static std::deque<FileHasher*> s_queue;
+static bool s_stop = false;
+
+void FileHasher::start_pool(unsigned threads)
+{
+    s_stop = false;
+
+    for ( unsigned i = 0; i < threads; ++i )
+        s_workers.push_back(new std::thread(worker));
+}
+
+void FileHasher::stop_pool()
+{
+    {
+        std::lock_guard<std::mutex> g(s_lock);
+        s_stop = true;
+    }
+    s_ready.notify_all();
+
+    for ( auto t : s_workers )
+    {
+        t->join();
+        delete t;
+    }
+    s_workers.clear();
+}
+
+bool FileHasher::enabled()
+{ return !s_workers.empty(); }
+
+// hashers with work are queued once; the worker that takes one drains it
+void FileHasher::worker()
+{
+    while ( true )
+    {
+        FileHasher* fh;
+        {
+            std::unique_lock<std::mutex> g(s_lock);
+            s_ready.wait(g, [] { return s_stop or !s_queue.empty(); });
+
+            if ( s_queue.empty() )
+                return;
+
+            fh = s_queue.front();
+            s_queue.pop_front();
+        }
+        while ( fh->work() );
+    }
+}
+
+//-------------------------------------------------------------------------
+// hasher
+//-------------------------------------------------------------------------
+
+FileHasher::FileHasher()
+{
+    SHA256_Init(&ctx);
+    queued = false;
+}
+
+FileHasher::~FileHasher()
+{ wait(); }
+
+void FileHasher::update(const uint8_t* data, size_t len, bool stable)
+{
+    if ( !enabled() )
+    {
+        SHA256_Update(&ctx, data, len);
+        return;
+    }
+    bool post;
+    {
+        std::lock_guard<std::mutex> g(lock);
+        chunks.emplace_back();
+        Chunk& c = chunks.back();
+
+        if ( stable )
+        {
+            c.data = data;
+            c.len = len;
+        }
+        else
+        {
+            c.copy.assign(data, data + len);
+            c.data = c.copy.data();
+            c.len = len;
+        }
+        post = !queued;
+        queued = true;
+    }
+    if ( post )
+    {
+        {
+            std::lock_guard<std::mutex> g(s_lock);
+            s_queue.push_back(this);
+        }
+        s_ready.notify_one();
+    }
+}
+
+// hash one chunk; returns false when there is nothing left.  after that the
+// worker must not touch this since finish() or the dtor may proceed.
+bool FileHasher::work()
+{
+    Chunk c;
+    {
+        std::lock_guard<std::mutex> g(lock);
+
+        if ( chunks.empty() )
+        {
+            queued = false;
+            idle.notify_all();
+            return false;
+        }
+        c.data = chunks.front().data;
+        c.len = chunks.front().len;
+        c.copy.swap(chunks.front().copy);
+        chunks.pop_front();
+    }
+    SHA256_Update(&ctx, c.data, c.len);
+    return true;
+}
+
+void FileHasher::wait()
+{
+    std::unique_lock<std::mutex> g(lock);
+    idle.wait(g, [this] { return !queued; });
+}
+
+void FileHasher::finish(uint8_t* digest)
+{
+    wait();
+    SHA256_Final(digest, &ctx);
+}
+
+//-------------------------------------------------------------------------
+// tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+TEST_CASE("file hasher", "[file_api]")
+{
+    std::vector<uint8_t> data(100000);
+
+    for ( unsigned i = 0; i < data.size(); ++i )
+        data[i] = (uint8_t)(i * 7);
+
+    uint8_t expect[SHA256_HASH_SIZE];
+    sha256(data.data(), data.size(), expect);
+
+    FileHasher::start_pool(2);
+    CHECK(FileHasher::enabled());
+
+    FileHasher fh;
+
+    for ( unsigned off = 0; off < data.size(); off += 1460 )
+    {
+        size_t n = data.size() - off < 1460 ? data.size() - off : 1460;
+        fh.update(data.data() + off, n);
+    }
+
+    uint8_t digest[SHA256_HASH_SIZE];
+    fh.finish(digest);
+
+    CHECK(!memcmp(digest, expect, sizeof(digest)));
+
+    // stable data is hashed in place
+    FileHasher stable_fh;
+
+    for ( unsigned off = 0; off < data.size(); off += 65535 )
+    {
+        size_t n = data.size() - off < 65535 ? data.size() - off : 65535;
+        stable_fh.update(data.data() + off, n, true);
+    }
+    stable_fh.finish(digest);
+
+    CHECK(!memcmp(digest, expect, sizeof(digest)));
+
+    FileHasher::stop_pool();
+    CHECK(!FileHasher::enabled());
+
+    FileHasher inline_fh;
+    inline_fh.update(data.data(), data.size());
+    inline_fh.finish(digest);
+
+    CHECK(!memcmp(digest, expect, sizeof(digest)));
+}
+#endif
+
@@ -0,0 +1,79 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// file_hasher.h
+
+#ifndef FILE_HASHER_H
+#define FILE_HASHER_H
+
+// FileHasher computes a file's SHA-256 on a shared pool of worker threads
+// so large files don't stall the packet thread.  The packet buffers go away
+// when the packet is done so chunks are copied unless the caller says the
+// data is stable, as with mapped files, which must then stay valid until
+// finish() or the dtor returns.  A worker folds the chunks of one file into
+// its digest in order; finish() waits for whatever is still queued and then
+// finalizes on the calling thread.
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "hash/hashes.h"
+
+class FileHasher
+{
+public:
+    FileHasher();
+    ~FileHasher();
+
+    void update(const uint8_t*, size_t, bool stable = false);
+    void finish(uint8_t* digest);
+
+    // main thread; 0 threads leaves hashing on the packet threads
+    static void start_pool(unsigned threads);
+    static void stop_pool();
+    static bool enabled();
+
+private:
+    // copy is empty when data is stable
+    struct Chunk
+    {
+        const uint8_t* data;
+        size_t len;
+        std::vector<uint8_t> copy;
+    };
+
+    void wait();
+    bool work();
+
+    static void worker();
+
+private:
+    SHA256_CTX ctx;
+
+    std::mutex lock;
+    std::condition_variable idle;
+    std::deque<Chunk> chunks;
+
+    // set while the hasher is queued or a worker owns ctx
+    bool queued;
+};
+
+#endif
+
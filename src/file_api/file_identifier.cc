@@ -32,6 +32,8 @@
 #include <sys/types.h>
 
 #include <algorithm>
+#include <map>
+#include <unordered_map>
 
 #include "main/snort_types.h"
 #include "main/snort_debug.h"
@@ -317,6 +319,12 @@ void FileIdentifier::insert_file_rule(FileMagicRule& rule)
         return;
     }
 
+    if (!states.empty())
+    {
+        ParseError("file type: rule id %u added after rules were compiled", rule.id);
+        return;
+    }
+
     if (file_magic_rules[rule.id].id > 0)
     {
         ParseError("file type: duplicated rule id %u defined", rule.id);
@@ -330,6 +338,137 @@ void FileIdentifier::insert_file_rule(FileMagicRule& rule)
     update_trie(identifier_root, node);
 }
 
+/*
+ * Flatten the trie into a state table with byte class compression.
+ * Shared nodes become a single state.  Classes are refined one node at a
+ * time: two bytes stay in the same class only if they were together before
+ * and lead to the same state from this node.
+ */
+void FileIdentifier::compile()
+{
+    if (!identifier_root || !states.empty())
+        return;
+
+    std::vector<IdentifierNode*> nodes;
+    std::unordered_map<IdentifierNode*, uint32_t> ids;
+
+    ids[nullptr] = 0;
+    ids[identifier_root] = 1;
+    nodes.push_back(identifier_root);
+
+    for (unsigned n = 0; n < nodes.size(); n++)
+    {
+        for (int i = 0; i < MAX_BRANCH; i++)
+        {
+            IdentifierNode* next = nodes[n]->next[i];
+
+            if (ids.find(next) == ids.end())
+            {
+                ids[next] = nodes.size() + 1;
+                nodes.push_back(next);
+            }
+        }
+    }
+
+    memset(byte_class, 0, sizeof(byte_class));
+    num_classes = 1;
+
+    for (auto node : nodes)
+    {
+        std::map<std::pair<unsigned, uint32_t>, unsigned> split;
+
+        for (int i = 0; i < MAX_BRANCH; i++)
+        {
+            std::pair<unsigned, uint32_t> key(byte_class[i], ids[node->next[i]]);
+            auto it = split.find(key);
+
+            if (it == split.end())
+                it = split.insert(std::make_pair(key, (unsigned)split.size())).first;
+
+            byte_class[i] = it->second;
+        }
+        num_classes = split.size();
+    }
+
+    uint8_t rep[MAX_BRANCH];
+
+    for (int i = MAX_BRANCH - 1; i >= 0; i--)
+        rep[byte_class[i]] = i;
+
+    states.resize(nodes.size());
+    next_state.resize(nodes.size() * num_classes);
+
+    for (unsigned n = 0; n < nodes.size(); n++)
+    {
+        states[n].type_id = nodes[n]->type_id;
+        states[n].offset = nodes[n]->offset;
+
+        for (unsigned c = 0; c < num_classes; c++)
+            next_state[n * num_classes + c] = ids[nodes[n]->next[rep[c]]];
+    }
+
+    /*the trie is no longer needed*/
+    for (IDMemoryBlocks::iterator idMem = idMemoryBlocks.begin();
+            idMem != idMemoryBlocks.end(); idMem++)
+    {
+        snort_free(idMem->mem);
+    }
+    idMemoryBlocks.clear();
+    identifier_root = nullptr;
+
+    if (identifier_merge_hash != NULL)
+    {
+        sfghash_delete(identifier_merge_hash);
+        identifier_merge_hash = NULL;
+    }
+
+    memory_used = states.size() * sizeof(IdentifierState) +
+        next_state.size() * sizeof(uint32_t);
+}
+
+/*
+ * Same walk as the trie but over the state table.  Context is the
+ * current state index + 1.
+ */
+uint32_t FileIdentifier::find_compiled(const uint8_t* buf, int len, uint64_t file_offset,
+    void** context)
+{
+    uint32_t file_type_id = SNORT_FILE_TYPE_CONTINUE;
+    uint32_t s = (*context) ? (uint32_t)(uintptr_t)(*context) - 1 : 0;
+    uint64_t end = file_offset + len;
+
+    while (states[s].offset >= file_offset)
+    {
+        const IdentifierState& st = states[s];
+
+        if (st.type_id)
+            file_type_id = st.type_id;
+
+        if ( st.offset >= end )
+        {
+            *context = (void*)(uintptr_t)(s + 1);
+            if (file_type_id)
+                return file_type_id;
+            else
+                return SNORT_FILE_TYPE_CONTINUE;
+        }
+
+        uint32_t next = next_state[s * num_classes + byte_class[buf[st.offset - file_offset]]];
+
+        if (!next)
+            break;
+
+        s = next - 1;
+    }
+
+    *context = NULL;
+
+    if ( file_type_id == SNORT_FILE_TYPE_CONTINUE )
+        file_type_id = SNORT_FILE_TYPE_UNKNOWN;
+
+    return file_type_id;
+}
+
 /*
  * This is the main function to find file type
  * Find file type is to traverse the tries.
@@ -345,6 +484,9 @@ uint32_t FileIdentifier::find_file_type_id(const uint8_t* buf, int len, uint64_t
     if ( !buf || len <= 0 )
         return SNORT_FILE_TYPE_CONTINUE;
 
+    if (!states.empty())
+        return find_compiled(buf, len, file_offset, context);
+
     if (!(*context))
         *context = (void*)(identifier_root);
 
@@ -555,4 +697,67 @@ TEST_CASE ("FileIdRuleFirst", "[FileMagic]")
 
     CHECK(rc.find_file_type_id((const uint8_t *)data, strlen(data), 0, &context) == 1);
 }
+
+TEST_CASE ("FileIdRuleCompiled", "[FileMagic]")
+{
+    FileMagicData magic;
+
+    magic.content = "PDF";
+    magic.offset = 0;
+
+    FileMagicRule rule;
+
+    rule.type = "exe";
+    rule.file_magics.push_back(magic);
+    rule.id = 1;
+
+    FileIdentifier rc;
+    rc.insert_file_rule(rule);
+
+    magic.clear();
+    magic.content = "EXE";
+    magic.offset = 3;
+
+    rule.clear();
+    rule.type = "exe";
+    rule.file_magics.push_back(magic);
+    rule.id = 3;
+
+    rc.insert_file_rule(rule);
+
+    magic.clear();
+    magic.content = "MZ";
+    magic.offset = 0;
+
+    rule.clear();
+    rule.type = "msexe";
+    rule.file_magics.push_back(magic);
+    rule.id = 5;
+
+    rc.insert_file_rule(rule);
+
+    uint32_t before = rc.memory_usage();
+    rc.compile();
+    CHECK(rc.memory_usage() < before);
+
+    void *context = NULL;
+    CHECK(rc.find_file_type_id((const uint8_t *)"PDFEXE", 6, 0, &context) == 3);
+
+    context = NULL;
+    CHECK(rc.find_file_type_id((const uint8_t *)"PDFooo", 6, 0, &context) == 1);
+
+    context = NULL;
+    CHECK(rc.find_file_type_id((const uint8_t *)"MZxx", 4, 0, &context) == 5);
+
+    context = NULL;
+    CHECK(rc.find_file_type_id((const uint8_t *)"DDFxyz", 6, 0, &context) ==
+        SNORT_FILE_TYPE_UNKNOWN);
+
+    // split across calls
+    context = NULL;
+    CHECK(rc.find_file_type_id((const uint8_t *)"PD", 2, 0, &context) ==
+        SNORT_FILE_TYPE_CONTINUE);
+    CHECK(rc.find_file_type_id((const uint8_t *)"FE", 2, 2, &context) == 1);
+    CHECK(rc.find_file_type_id((const uint8_t *)"XE", 2, 4, &context) == 3);
+}
 #endif
@@ -25,8 +25,14 @@
 // File type identification is based on file magic. To improve the detection
 // performance, a trie is created to scan file data once. Currently, only the
 // most specific file type is returned.
+//
+// Once all rules are in, compile() flattens the trie into a table with one
+// row per node and one column per byte class.  Bytes that lead to the same
+// place from every node share a class so rows are usually much narrower
+// than 256 and the trie itself is released.
 
 #include <list>
+#include <vector>
 #include "file_lib.h"
 #include "hash/sfghash.h"
 
@@ -84,12 +90,19 @@ struct IDMemoryBlock
 
 typedef std::list<IDMemoryBlock >  IDMemoryBlocks;
 
+struct IdentifierState
+{
+    uint32_t type_id;
+    uint32_t offset;
+};
+
 class FileIdentifier
 {
 public:
     ~FileIdentifier();
     uint32_t memory_usage() {return memory_used;}
     void insert_file_rule(FileMagicRule& rule);
+    void compile();
     uint32_t find_file_type_id(const uint8_t* buf, int len, uint64_t offset, void** context);
     FileMagicRule* get_rule_from_id(uint32_t);
 private:
@@ -101,6 +114,7 @@ private:
     bool update_next(IdentifierNode* start, IdentifierNode** next_ptr, IdentifierNode* append);
     IdentifierNode* create_trie_from_magic(FileMagicRule& rule, uint32_t type_id);
     void update_trie(IdentifierNode* start, IdentifierNode* append);
+    uint32_t find_compiled(const uint8_t* buf, int len, uint64_t offset, void** context);
 
     /*properties*/
     IdentifierNode* identifier_root = nullptr; /*Root of magic tries*/
@@ -108,6 +122,12 @@ private:
     SFGHASH* identifier_merge_hash = nullptr;
     FileMagicRule file_magic_rules[FILE_ID_MAX + 1];
     IDMemoryBlocks idMemoryBlocks;
+
+    /*compiled form; next state is index + 1 or 0 for none*/
+    std::vector<IdentifierState> states;
+    std::vector<uint32_t> next_state;
+    uint8_t byte_class[MAX_BRANCH];
+    unsigned num_classes = 0;
 };
 
 #endif
@@ -39,6 +39,7 @@
 
 #include "file_identifier.h"
 #include "file_config.h"
+#include "file_hasher.h"
 #include "hash/hashes.h"
 #include "utils/util.h"
 #include "file_api/file_capture.h"
@@ -156,15 +157,15 @@ std::string FileInfo::sha_to_string (const uint8_t *sha256)
 FileContext::FileContext ()
 {
     file_type_context = nullptr;
-    file_signature_context = nullptr;
+    file_hasher = nullptr;
     file_config = nullptr;
     file_capture = nullptr;
 }
 
 FileContext::~FileContext ()
 {
-    if (file_signature_context)
-        snort_free(file_signature_context);
+    if (file_hasher)
+        delete file_hasher;
     if(file_capture)
         stop_file_capture();
 }
@@ -256,38 +257,27 @@ void FileContext::process_file_signature_sha256(const uint8_t* file_data, int si
         return;
     }
 
-    switch (position)
+    if (position == SNORT_FILE_POSITION_UNKNOWN)
+        return;
+
+    // a new file starts over; the hasher may still be busy with the old one
+    if ( position == SNORT_FILE_START or position == SNORT_FILE_FULL or
+        (position == SNORT_FILE_END and processed_bytes == 0) )
+    {
+        delete file_hasher;
+        file_hasher = nullptr;
+    }
+
+    if (!file_hasher)
+        file_hasher = new FileHasher;
+
+    file_hasher->update(file_data, data_size, stable_data);
+
+    if ( position == SNORT_FILE_END or position == SNORT_FILE_FULL )
     {
-    case SNORT_FILE_START:
-        file_signature_context = snort_calloc(sizeof(SHA256_CTX));
-        SHA256_Init((SHA256_CTX*)file_signature_context);
-        SHA256_Update((SHA256_CTX*)file_signature_context, file_data, data_size);
-        break;
-    case SNORT_FILE_MIDDLE:
-        if (!file_signature_context)
-            file_signature_context = snort_calloc(sizeof(SHA256_CTX));
-        SHA256_Update((SHA256_CTX*)file_signature_context, file_data, data_size);
-        break;
-    case SNORT_FILE_END:
-        if (!file_signature_context)
-            file_signature_context = snort_calloc(sizeof(SHA256_CTX));
-        if (processed_bytes == 0)
-            SHA256_Init((SHA256_CTX*)file_signature_context);
-        SHA256_Update((SHA256_CTX*)file_signature_context, file_data, data_size);
-        sha256 = new uint8_t[SHA256_HASH_SIZE];
-        SHA256_Final(sha256, (SHA256_CTX*)file_signature_context);
-        file_state.sig_state = FILE_SIG_DONE;
-        break;
-    case SNORT_FILE_FULL:
-        file_signature_context = snort_calloc(sizeof (SHA256_CTX));
-        SHA256_Init((SHA256_CTX*)file_signature_context);
-        SHA256_Update((SHA256_CTX*)file_signature_context, file_data, data_size);
         sha256 = new uint8_t[SHA256_HASH_SIZE];
-        SHA256_Final(sha256, (SHA256_CTX*)file_signature_context);
+        file_hasher->finish(sha256);
         file_state.sig_state = FILE_SIG_DONE;
-        break;
-    default:
-        break;
     }
 }
 
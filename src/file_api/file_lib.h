@@ -31,6 +31,8 @@
 #include "file_api/file_api.h"
 #include "flow/flow.h"
 
+class FileHasher;
+
 #define SNORT_FILE_TYPE_UNKNOWN          UINT16_MAX  /**/
 #define SNORT_FILE_TYPE_CONTINUE         0 /**/
 
@@ -94,6 +96,10 @@ public:
     void set_file_config(FileConfig* file_config);
     FileConfig*  get_file_config();
 
+    // the data passed to process_*() stays valid until the file is done
+    void set_stable_data(bool b)
+    { stable_data = b; }
+
     void print_file_sha256(std::ostream&);
     static void print_file_data(FILE* fp, const uint8_t* data, int len, int max_depth);
     void print(std::ostream&);
@@ -102,9 +108,10 @@ private:
     bool file_type_enabled = false;
     bool file_signature_enabled = false;
     bool file_capture_enabled = false;
+    bool stable_data = false;
     uint64_t processed_bytes = 0;
     void* file_type_context;
-    void* file_signature_context;
+    FileHasher* file_hasher;
     FileConfig* file_config;
     FileCapture *file_capture;
     FileState file_state = {FILE_CAPTURE_SUCCESS, FILE_SIG_PROCESSING};
@@ -31,6 +31,7 @@
 
 #include "file_mempool.h"
 #include "main/snort_debug.h"
+#include "main/thread.h"
 #include "utils/util.h"
 
 /*This magic is used for double free detection*/
@@ -38,31 +39,128 @@
 #define FREE_MAGIC    0x2525252525252525
 typedef uint64_t MagicType;
 
-#ifdef DEBUG_MSGS
-static inline void file_mempool_verify(FileMemPool* mempool)
+/*Per thread cache; half of it moves to or from the stack at a time*/
+#define FILE_MEM_CACHE  32
+#define FILE_MEM_BATCH  (FILE_MEM_CACHE / 2)
+
+struct FileMemCache
+{
+    FileMemPool* pool;
+    unsigned num;
+    void* objs[FILE_MEM_CACHE];
+};
+
+static THREAD_LOCAL FileMemCache mem_cache;
+
+static inline uint32_t obj_index(FileMemPool* mempool, void* obj)
 {
-    uint64_t free_size;
-    uint64_t release_size;
+    return ((char*)obj - (char*)mempool->datapool) / mempool->obj_size;
+}
 
-    free_size = cbuffer_used(mempool->free_list);
-    release_size = cbuffer_used(mempool->released_list);
+static inline void* index_obj(FileMemPool* mempool, uint32_t idx)
+{
+    return ((char*)mempool->datapool) + (idx * mempool->obj_size);
+}
 
-    if (free_size > cbuffer_size(mempool->free_list))
+static inline FileMemCache* get_cache(FileMemPool* mempool)
+{
+    /*a pool created after this cache was filled starts over*/
+    if (mem_cache.pool != mempool)
     {
-        ErrorMessage("%s(%d) file_mempool: failed to verify free list!\n",
-            __FILE__, __LINE__);
+        mem_cache.pool = mempool;
+        mem_cache.num = 0;
+    }
+    return &mem_cache;
+}
+
+/*
+ * Push n objects onto the free stack with one compare and swap.
+ * The objects are chained through the next array first.
+ */
+static void stack_push(FileMemPool* mempool, void** objs, unsigned n)
+{
+    uint32_t first = obj_index(mempool, objs[0]) + 1;
+    uint32_t last = first;
+
+    for (unsigned i = 1; i < n; i++)
+    {
+        uint32_t idx = obj_index(mempool, objs[i]) + 1;
+        mempool->next[last - 1].store(idx, std::memory_order_relaxed);
+        last = idx;
     }
 
-    if (release_size > cbuffer_size(mempool->released_list))
+    uint64_t old = mempool->head.load(std::memory_order_relaxed);
+
+    while (true)
     {
-        ErrorMessage("%s(%d) file_mempool: failed to verify release list!\n",
-            __FILE__, __LINE__);
+        mempool->next[last - 1].store((uint32_t)old, std::memory_order_relaxed);
+        uint64_t tag = (old >> 32) + 1;
+
+        if (mempool->head.compare_exchange_weak(old, (tag << 32) | first,
+            std::memory_order_release, std::memory_order_relaxed))
+            break;
+
+        mempool->retries.fetch_add(1, std::memory_order_relaxed);
     }
 
-    /* The free mempool and size of release mempool should be smaller than
-     * or equal to the size of mempool
-     */
-    if (free_size + release_size > mempool->total)
+    mempool->stacked.fetch_add(n, std::memory_order_relaxed);
+    mempool->stack_ops.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+ * Pop up to max objects from the free stack with one compare and swap.
+ * The walk may read links that a racing thread is changing; the tag in
+ * head makes the swap fail in that case and the walk is retried.
+ */
+static unsigned stack_pop(FileMemPool* mempool, void** objs, unsigned max)
+{
+    uint64_t old = mempool->head.load(std::memory_order_acquire);
+    uint32_t top;
+    unsigned n;
+
+    while (true)
+    {
+        top = (uint32_t)old;
+
+        if (!top)
+            return 0;
+
+        uint32_t idx = top;
+        n = 0;
+
+        while (idx && n < max)
+        {
+            n++;
+            idx = mempool->next[idx - 1].load(std::memory_order_relaxed);
+        }
+
+        uint64_t tag = (old >> 32) + 1;
+
+        if (mempool->head.compare_exchange_weak(old, (tag << 32) | idx,
+            std::memory_order_acquire, std::memory_order_acquire))
+            break;
+
+        mempool->retries.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /*the chain is ours now*/
+    uint32_t idx = top;
+
+    for (unsigned i = 0; i < n; i++)
+    {
+        objs[i] = index_obj(mempool, idx - 1);
+        idx = mempool->next[idx - 1].load(std::memory_order_relaxed);
+    }
+
+    mempool->stacked.fetch_sub(n, std::memory_order_relaxed);
+    mempool->stack_ops.fetch_add(1, std::memory_order_relaxed);
+    return n;
+}
+
+#ifdef DEBUG_MSGS
+static inline void file_mempool_verify(FileMemPool* mempool)
+{
+    if (mempool->stacked.load(std::memory_order_relaxed) > mempool->total)
     {
         ErrorMessage("%s(%d) file_mempool: failed to verify mempool size!\n",
             __FILE__, __LINE__);
@@ -81,8 +179,11 @@ static inline void file_mempool_free_pools(FileMemPool* mempool)
         mempool->datapool = NULL;
     }
 
-    cbuffer_free(mempool->free_list);
-    cbuffer_free(mempool->released_list);
+    if (mempool->next != NULL)
+    {
+        delete[] mempool->next;
+        mempool->next = NULL;
+    }
 }
 
 /* Function: int file_mempool_init(FileMemPool *FileMemPool,
@@ -103,7 +204,8 @@ int file_mempool_init(FileMemPool* mempool, uint64_t num_objects, size_t obj_siz
 {
     unsigned int i;
 
-    if ((mempool == NULL) || (num_objects < 1) || (obj_size < 1))
+    if ((mempool == NULL) || (num_objects < 1) || (obj_size < 1) ||
+        (num_objects >= UINT32_MAX))
         return FILE_MEM_FAIL;
 
     mempool->obj_size = obj_size;
@@ -111,41 +213,23 @@ int file_mempool_init(FileMemPool* mempool, uint64_t num_objects, size_t obj_siz
     // this is the basis pool that represents all the *data pointers in the list
     mempool->datapool = (void**)snort_calloc(num_objects, obj_size);
 
-    /* sets up the memory list */
-    mempool->free_list = cbuffer_init(num_objects);
-    if (!mempool->free_list)
-    {
-        ErrorMessage("%s(%d) file_mempool_init(): Failed to init free list\n",
-            __FILE__, __LINE__);
-        file_mempool_free_pools(mempool);
-        return FILE_MEM_FAIL;
-    }
-
-    mempool->released_list = cbuffer_init(num_objects);
-    if (!mempool->released_list)
-    {
-        ErrorMessage("%s(%d) file_mempool_init(): "
-            "Failed to init release list\n", __FILE__, __LINE__);
-        file_mempool_free_pools(mempool);
-        return FILE_MEM_FAIL;
-    }
+    /* sets up the free stack in address order */
+    mempool->next = new std::atomic<uint32_t>[num_objects];
 
     for (i=0; i<num_objects; i++)
     {
-        void* data = ((char*)mempool->datapool) + (i * mempool->obj_size);
-
-        if (cbuffer_write(mempool->free_list,  data))
-        {
-            ErrorMessage("%s(%d) file_mempool_init(): "
-                "Failed to add to free list\n",
-                __FILE__, __LINE__);
-            file_mempool_free_pools(mempool);
-            return FILE_MEM_FAIL;
-        }
+        void* data = index_obj(mempool, i);
+        mempool->next[i].store(i + 1 < num_objects ? i + 2 : 0, std::memory_order_relaxed);
         *(MagicType*)data = FREE_MAGIC;
-        mempool->total++;
     }
 
+    mempool->total = num_objects;
+    mempool->head.store(1, std::memory_order_relaxed);
+    mempool->stacked.store(num_objects, std::memory_order_relaxed);
+    mempool->released.store(0, std::memory_order_relaxed);
+    mempool->stack_ops.store(0, std::memory_order_relaxed);
+    mempool->retries.store(0, std::memory_order_relaxed);
+
     return FILE_MEM_SUCCESS;
 }
 
@@ -166,6 +250,9 @@ int file_mempool_destroy(FileMemPool* mempool)
 
     file_mempool_free_pools(mempool);
 
+    if (mem_cache.pool == mempool)
+        mem_cache.pool = nullptr;
+
     return FILE_MEM_SUCCESS;
 }
 
@@ -180,21 +267,23 @@ int file_mempool_destroy(FileMemPool* mempool)
 
 void* file_mempool_alloc(FileMemPool* mempool)
 {
-    void* b = NULL;
-
     if (mempool == NULL)
     {
         return NULL;
     }
 
-    if (cbuffer_read(mempool->free_list, &b))
+    FileMemCache* cache = get_cache(mempool);
+
+    if (!cache->num)
     {
-        if (cbuffer_read(mempool->released_list, &b))
-        {
+        cache->num = stack_pop(mempool, cache->objs, FILE_MEM_BATCH);
+
+        if (!cache->num)
             return NULL;
-        }
     }
 
+    void* b = cache->objs[--cache->num];
+
     if (*(MagicType*)b != FREE_MAGIC)
     {
         ErrorMessage("%s(%d) file_mempool_alloc(): Allocation errors! \n",
@@ -207,27 +296,20 @@ void* file_mempool_alloc(FileMemPool* mempool)
 }
 
 /*
- * Free a new object from the buffer
- * We use circular buffer to synchronize one reader and one writer
+ * Mark an object free
  *
  * Args:
- *   FileMemPool: pointer to a circular buffer struct
  *   void *obj  : memory object
  *
  * Return:
  *   FILE_MEM_SUCCESS
  *   FILE_MEM_FAIL
  */
-static inline int _file__mempool_remove(CircularBuffer* cb, void* obj)
+static inline int _file__mempool_remove(void* obj)
 {
     if (obj == NULL)
         return FILE_MEM_FAIL;
 
-    if (cbuffer_write(cb, obj))
-    {
-        return FILE_MEM_FAIL;
-    }
-
     if (*(MagicType*)obj == FREE_MAGIC)
     {
         DEBUG_WRAP(ErrorMessage("%s(%d) file_mempool_remove(): Double free! \n",
@@ -242,6 +324,8 @@ static inline int _file__mempool_remove(CircularBuffer* cb, void* obj)
 
 /*
  * Free a new object from the FileMemPool
+ * The object goes to this thread's cache; a full cache returns half
+ * of itself to the free stack.
  *
  * Args:
  *   FileMemPool: pointer to a FileMemPool struct
@@ -254,15 +338,23 @@ static inline int _file__mempool_remove(CircularBuffer* cb, void* obj)
 
 int file_mempool_free(FileMemPool* mempool, void* obj)
 {
-    int ret;
-
     assert(mempool);
 
-    ret = _file__mempool_remove(mempool->free_list, obj);
+    if (_file__mempool_remove(obj))
+        return FILE_MEM_FAIL;
+
+    FileMemCache* cache = get_cache(mempool);
+
+    if (cache->num == FILE_MEM_CACHE)
+    {
+        cache->num -= FILE_MEM_BATCH;
+        stack_push(mempool, cache->objs + cache->num, FILE_MEM_BATCH);
+    }
+    cache->objs[cache->num++] = obj;
 
     DEBUG_WRAP(file_mempool_verify(mempool); );
 
-    return ret;
+    return FILE_MEM_SUCCESS;
 }
 
 /*
@@ -281,36 +373,53 @@ int file_mempool_free(FileMemPool* mempool, void* obj)
 
 int file_mempool_release(FileMemPool* mempool, void* obj)
 {
-    int ret;
-
     if (mempool == NULL)
         return FILE_MEM_FAIL;
 
+    if (_file__mempool_remove(obj))
+        return FILE_MEM_FAIL;
+
     /*A writer that might from different thread*/
-    ret = _file__mempool_remove(mempool->released_list, obj);
+    stack_push(mempool, &obj, 1);
+    mempool->released.fetch_add(1, std::memory_order_relaxed);
 
     DEBUG_WRAP(file_mempool_verify(mempool); );
 
-    return ret;
+    return FILE_MEM_SUCCESS;
+}
+
+void file_mempool_thread_term(FileMemPool* mempool)
+{
+    if (mem_cache.pool != mempool)
+        return;
+
+    if (mem_cache.num)
+        stack_push(mempool, mem_cache.objs, mem_cache.num);
+
+    mem_cache.num = 0;
 }
 
 /* Returns number of elements allocated in current buffer*/
 uint64_t file_mempool_allocated(FileMemPool* mempool)
 {
-    uint64_t total_freed =
-        file_mempool_released(mempool) + file_mempool_freed(mempool);
-    return (mempool->total - total_freed);
+    return (mempool->total - file_mempool_freed(mempool));
 }
 
 /* Returns number of elements freed in current buffer*/
 uint64_t file_mempool_freed(FileMemPool* mempool)
 {
-    return (cbuffer_used(mempool->free_list));
+    return mempool->stacked.load(std::memory_order_relaxed);
 }
 
 /* Returns number of elements released in current buffer*/
 uint64_t file_mempool_released(FileMemPool* mempool)
 {
-    return (cbuffer_used(mempool->released_list));
+    return mempool->released.load(std::memory_order_relaxed);
+}
+
+/* Returns number of lost races for the free stack*/
+uint64_t file_mempool_contention(FileMemPool* mempool)
+{
+    return mempool->retries.load(std::memory_order_relaxed);
 }
 
@@ -23,13 +23,16 @@
 #define FILE_MEMPOOL_H
 
  //  This mempool implementation has very efficient alloc/free operations.
- //  In addition, it provides thread-safe alloc/free for one allocation/free
- //  thread and one release thread.
+ //  Free objects are kept on a lock-free stack shared by all threads and
+ //  each thread keeps a small cache in front of it so most alloc/free
+ //  calls touch no shared state.  Objects move between a cache and the
+ //  stack in batches with a single compare and swap.  Any thread may
+ //  release an object straight back to the stack.
  //  One more bonus: Double free detection is also added into this library
- //  This is a thread safe version of memory pool for one writer and one reader thread
+
+#include <atomic>
 
 #include "main/snort_types.h"
-#include "circular_buffer.h"
 
 #define FILE_MEM_SUCCESS    0  // FIXIT-L use bool
 #define FILE_MEM_FAIL      -1
@@ -39,10 +42,18 @@ typedef struct _FileMemPool
     void** datapool; /* memory buffer */
 
     uint64_t total;
-
-    CircularBuffer* free_list;
-    CircularBuffer* released_list;
     size_t obj_size;
+
+    /* index + 1 of the next free object; 0 ends the stack */
+    std::atomic<uint32_t>* next;
+
+    /* low 32 bits are the top index + 1, high 32 bits count updates */
+    std::atomic<uint64_t> head;
+
+    std::atomic<uint64_t> stacked;   /* objects on the free stack */
+    std::atomic<uint64_t> released;  /* objects returned by release */
+    std::atomic<uint64_t> stack_ops; /* stack push and pop batches */
+    std::atomic<uint64_t> retries;   /* failed compare and swaps */
 } FileMemPool;
 
 // This must be called before file mempool is used
@@ -58,7 +69,7 @@ int file_mempool_destroy(FileMemPool* mempool);
 // Returns: a pointer to the FileMemPool object on success, NULL on failure
 void* file_mempool_alloc(FileMemPool* mempool);
 
-// This must be called by the same thread calling file_mempool_alloc()
+// Returns obj to this thread's cache
 // Return: FILE_MEM_SUCCESS or FILE_MEM_FAIL
 int file_mempool_free(FileMemPool* mempool, void* obj);
 
@@ -66,14 +77,20 @@ int file_mempool_free(FileMemPool* mempool, void* obj);
 // Return: FILE_MEM_SUCCESS or FILE_MEM_FAIL
 int file_mempool_release(FileMemPool* mempool, void* obj);
 
-//Returns number of elements allocated in current buffer
+// Returns this thread's cached objects to the free stack
+void file_mempool_thread_term(FileMemPool* mempool);
+
+// Returns number of elements off the free stack, including thread caches
 uint64_t file_mempool_allocated(FileMemPool* mempool);
 
-// Returns number of elements freed in current buffer
+// Returns number of elements on the free stack
 uint64_t file_mempool_freed(FileMemPool* mempool);
 
-// Returns number of elements released in current buffer
+// Returns number of elements released so far
 uint64_t file_mempool_released(FileMemPool* mempool);
 
+// Returns number of times a thread lost a race for the free stack
+uint64_t file_mempool_contention(FileMemPool* mempool);
+
 #endif
 
@@ -39,6 +39,9 @@ bool FileIdModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("signature_depth") )
         fc.file_signature_depth = v.get_long();
 
+    else if ( v.is("signature_threads") )
+        fc.signature_threads = v.get_long();
+
     else if ( v.is("block_timeout") )
         fc.file_block_timeout = v.get_long();
 
@@ -182,7 +185,11 @@ bool FileIdModule::end(const char* fqn, int idx, SnortConfig* sc)
     FileConfig& fc = sc->file_config;
 
     if (!idx)
+    {
+        if ( !strcmp(fqn, "file_id") )
+            fc.compile_file_rules();
         return true;
+    }
 
     if ( !strcmp(fqn, "file_id.file_rules") )
     {
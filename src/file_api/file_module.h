@@ -116,6 +116,9 @@ static const Parameter file_id_params[] =
     { "signature_depth", Parameter::PT_INT, "0:", "10485760",
       "stop signature at this point" },
 
+    { "signature_threads", Parameter::PT_INT, "0:64", "0",
+      "compute signatures on this many helper threads (0 is inline)" },
+
     { "block_timeout", Parameter::PT_INT, "0:", "86400",
       "stop blocking after this many seconds" },
 
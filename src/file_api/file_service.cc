@@ -37,10 +37,12 @@
 #include "file_stats.h"
 #include "file_capture.h"
 #include "file_flows.h"
+#include "file_hasher.h"
 #include "file_enforcer.h"
 #include "file_lib.h"
 #include "file_config.h"
 
+#include "mime/decode_buffer.h"
 #include "mime/file_mime_config.h"
 #include "mime/file_mime_process.h"
 #include "main/snort_types.h"
@@ -74,6 +76,17 @@ void FileService::post_init()
     if ( file_capture_enabled)
         FileCapture::init_mempool(file_config.capture_memcap,
             file_config.capture_block_size);
+
+    if ( file_signature_enabled )
+        FileHasher::start_pool(file_config.signature_threads);
+}
+
+void FileService::thread_term()
+{
+    if ( file_capture_enabled )
+        FileCapture::thread_term();
+
+    DecodeBuffer::thread_term();
 }
 
 void FileService::close()
@@ -83,6 +96,7 @@ void FileService::close()
 
     MimeSession::exit();
     FileCapture::exit();
+    FileHasher::stop_pool();
 }
 
 void FileService::start_file_processing()
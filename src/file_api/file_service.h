@@ -39,6 +39,9 @@ public:
     // Called after permission is dropped
     static void post_init();
 
+    // Called when each packet thread exits
+    static void thread_term();
+
     // This must be called when snort exits
     static void close();
 
@@ -72,6 +72,11 @@ void RateFilter_Cleanup()
     SFRF_Delete();
 }
 
+void RateFilter_ThreadTerm()
+{
+    SFRF_ThreadTerm();
+}
+
 /*
  * Create and Add a Thresholding Event Object
  */
@@ -33,6 +33,7 @@ struct OptTreeNode;
 RateFilterConfig* RateFilter_ConfigNew();
 void RateFilter_ConfigFree(RateFilterConfig*);
 void RateFilter_Cleanup();
+void RateFilter_ThreadTerm();
 
 struct SnortConfig;
 int RateFilter_Create(SnortConfig* sc, RateFilterConfig*, tSFRFConfigNode*);
@@ -34,11 +34,14 @@
 
 #include "detection/rules.h"
 #include "detection/treenodes.h"
+#include "main/thread.h"
 #include "utils/util.h"
 #include "utils/sflsq.h"
 #include "hash/sfghash.h"
+#include "hash/sfhashfcn.h"
 #include "hash/sfxhash.h"
 #include "sfip/sf_ipvar.h"
+#include "filters/shared_counts.h"
 
 // Number of hash rows for gid 1 (rules)
 #define SFRF_GEN_ID_1_ROWS 4096
@@ -95,7 +98,12 @@ typedef struct
     time_t revertTime;
 } tSFRFTrackingNode;
 
-SFXHASH* rf_hash = NULL;
+// tracking nodes are per thread so the hash needs no lock; with more than
+// one packet thread the counts compared to the limit come from rf_counts
+// which all threads share.
+static THREAD_LOCAL SFXHASH* rf_hash = NULL;
+static SharedCounts* rf_counts = NULL;
+static unsigned rf_memcap = 0;
 
 // private methods ...
 static int _checkThreshold(
@@ -146,8 +154,12 @@ static void SFRF_New(unsigned nbytes)
         nbytes = SFRF_BYTES;
     }
     nrows = nbytes / (SFRF_BYTES);
+    rf_memcap = nbytes;
 
-    /* Create global hash table for all of the IP Nodes */
+    if ( !rf_counts )
+        rf_counts = SharedCounts::create(nrows);
+
+    /* Create this thread's hash table for all of the IP Nodes */
     rf_hash = sfxhash_new(
         nrows,  /* try one node per row - for speed */
         sizeof(tSFRFTrackingNodeKey), /* keys size */
@@ -157,9 +169,16 @@ static void SFRF_New(unsigned nbytes)
         0,         /* ANR callback - none */
         0,         /* user freemem callback - none */
         1);       /* Recycle nodes ?*/
+
+    if ( rf_hash )
+    {
+        sfxhash_set_hash_type(rf_hash, SFHASH_SIP);
+        sfxhash_set_open(rf_hash);
+        sfxhash_set_stats(rf_hash, "rate_filter");
+    }
 }
 
-void SFRF_Delete()
+void SFRF_ThreadTerm()
 {
     if ( !rf_hash )
         return;
@@ -168,10 +187,22 @@ void SFRF_Delete()
     rf_hash = NULL;
 }
 
+void SFRF_Delete()
+{
+    SFRF_ThreadTerm();
+
+    delete rf_counts;
+    rf_counts = NULL;
+    rf_memcap = 0;
+}
+
 void SFRF_Flush()
 {
     if ( rf_hash )
         sfxhash_make_empty(rf_hash);
+
+    if ( rf_counts )
+        rf_counts->clear();
 }
 
 static void SFRF_ConfigNodeFree(void* item)
@@ -370,12 +401,23 @@ static int SFRF_TestObject(
 {
     tSFRFTrackingNode* dynNode;
     int retValue = -1;
+    uint64_t shared = 0;
 
     dynNode = _getSFRFTrackingNode(ip, cfgNode->tid, curTime);
 
     if ( dynNode == NULL )
         return retValue;
 
+    if ( rf_counts )
+    {
+        tSFRFTrackingNodeKey key;
+        memset(&key, 0, sizeof(key));
+        key.ip = *ip;
+        key.tid = cfgNode->tid;
+        key.policyId = get_network_policy()->policy_id;
+        shared = SharedCounts::hash(&key, sizeof(key));
+    }
+
     if ( _checkSamplingPeriod(cfgNode, dynNode, curTime) != 0 )
     {
 #ifdef SFRF_DEBUG
@@ -387,7 +429,11 @@ static int SFRF_TestObject(
     switch (op)
     {
     case SFRF_COUNT_INCREMENT:
-        if ( (dynNode->count+1) != 0 )
+        if ( rf_counts )
+        {
+            dynNode->count = rf_counts->increment(shared, cfgNode->seconds, curTime);
+        }
+        else if ( (dynNode->count+1) != 0 )
         {
             dynNode->count++;
         }
@@ -396,13 +442,19 @@ static int SFRF_TestObject(
         if ( cfgNode->seconds == 0 )
         {
             // count can be decremented only for total count, and not for rate
-            if ( dynNode->count != 0 )
+            if ( rf_counts )
+            {
+                dynNode->count = rf_counts->decrement(shared);
+            }
+            else if ( dynNode->count != 0 )
             {
                 dynNode->count--;
             }
         }
         break;
     case SFRF_COUNT_RESET:
+        if ( rf_counts )
+            rf_counts->reset(shared, curTime);
         dynNode->count = 0;
         break;
     default:
@@ -417,7 +469,11 @@ static int SFRF_TestObject(
     // threshold would never be exceeded.
     if ( !cfgNode->seconds && dynNode->count > cfgNode->count )
         if ( cfgNode->newAction == RULE_TYPE__DROP )
+        {
+            if ( rf_counts )
+                rf_counts->decrement(shared);
             dynNode->count--;
+        }
 
 #ifdef SFRF_DEBUG
     printf("--SFRF_DEBUG: %d-%d-%d: %d Packet IP %s, op: %d, count %d, action %d\n",
@@ -802,6 +858,18 @@ static tSFRFTrackingNode* _getSFRFTrackingNode(
     key.tid = tid;
     key.policyId = get_network_policy()->policy_id;
 
+    // packet threads build their own table on first use
+    if ( !rf_hash )
+    {
+        if ( !rf_memcap )
+            return NULL;
+
+        SFRF_New(rf_memcap);
+
+        if ( !rf_hash )
+            return NULL;
+    }
+
     /*
      * Check for any Permanent sid objects for this gid or add this one ...
      */
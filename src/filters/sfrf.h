@@ -148,6 +148,7 @@ struct RateFilterConfig
  * Prototypes
  */
 void SFRF_Delete();
+void SFRF_ThreadTerm();
 void SFRF_Flush();
 int SFRF_ConfigAdd(struct SnortConfig*, RateFilterConfig*, tSFRFConfigNode*);
 
@@ -43,9 +43,11 @@
 #include "sfip/sf_ipvar.h"
 #include "utils/sflsq.h"
 #include "hash/sfghash.h"
+#include "hash/sfhashfcn.h"
 #include "hash/sfxhash.h"
 #include "utils/util.h"
 #include "utils/dyn_array.h"
+#include "filters/shared_counts.h"
 
 //  Debug Printing
 //#define THD_DEBUG
@@ -65,7 +67,7 @@ SFXHASH* sfthd_new_hash(unsigned nbytes, size_t key, size_t data)
     }
     nrows = nbytes / (size);
 
-    return sfxhash_new(
+    SFXHASH* hash = sfxhash_new(
         nrows,  /* try one node per row - for speed */
         key,    /* keys size */
         data,   /* data size */
@@ -74,6 +76,15 @@ SFXHASH* sfthd_new_hash(unsigned nbytes, size_t key, size_t data)
         0,      /* ANR callback - none */
         0,      /* user freemem callback - none */
         1);     /* Recycle nodes ?*/
+
+    // looked up for every event; probes stay within a group or two
+    if ( hash )
+    {
+        sfxhash_set_hash_type(hash, SFHASH_SIP);
+        sfxhash_set_open(hash);
+    }
+
+    return hash;
 }
 
 /*!
@@ -99,6 +110,9 @@ SFXHASH* sfthd_local_new(unsigned bytes)
         printf("Could not allocate the sfxhash table\n");
 #endif
 
+    if ( local_hash )
+        sfxhash_set_stats(local_hash, "threshold_local");
+
     return local_hash;
 }
 
@@ -114,6 +128,9 @@ SFXHASH* sfthd_global_new(unsigned bytes)
         printf("Could not allocate the sfxhash table\n");
 #endif
 
+    if ( global_hash )
+        sfxhash_set_stats(global_hash, "threshold_global");
+
     return global_hash;
 }
 
@@ -136,6 +153,9 @@ THD_STRUCT* sfthd_new(unsigned lbytes, unsigned gbytes)
         return NULL;
     }
 
+    thd->counts = SharedCounts::create(
+        lbytes / (sizeof(THD_IP_NODE_KEY) + sizeof(THD_IP_NODE)) + 1);
+
     if ( gbytes == 0 )
         return thd;
 
@@ -147,6 +167,7 @@ THD_STRUCT* sfthd_new(unsigned lbytes, unsigned gbytes)
         printf("Could not allocate the sfxhash table\n");
 #endif
         sfxhash_delete(thd->ip_nodes);
+        delete thd->counts;
         snort_free(thd);
         return NULL;
     }
@@ -248,6 +269,8 @@ void sfthd_free(THD_STRUCT* thd)
 
     if (thd->ip_gnodes != NULL)
         sfxhash_delete(thd->ip_gnodes);
+
+    delete thd->counts;
 #endif
 
     snort_free(thd);
@@ -841,6 +864,27 @@ static inline int sfthd_test_non_suppress(
     return 0;  /* should not get here, so log it just to be safe */
 }
 
+/*
+ *  Limits are the common event_filter and only need a count per window so
+ *  with several packet threads they are counted in the shared table instead
+ *  of the hash.  Returns the same values as sfthd_test_non_suppress().
+ */
+static inline int sfthd_test_shared_limit(
+    SharedCounts* counts,
+    THD_NODE* sfthd_node,
+    const void* key, size_t len,
+    time_t curtime)
+{
+    unsigned n = counts->increment(
+        SharedCounts::hash(key, len), sfthd_node->seconds, curtime);
+
+    if ( (int)n <= sfthd_node->count )
+        return 0;
+
+    sfthd_node->filtered++;
+    return -2;
+}
+
 /*!
  *
  *  Find/Test/Add an event against a single threshold object.
@@ -863,7 +907,8 @@ int sfthd_test_local(
     THD_NODE* sfthd_node,
     const sfip_t* sip,
     const sfip_t* dip,
-    time_t curtime)
+    time_t curtime,
+    SharedCounts* counts)
 {
     THD_IP_NODE_KEY key;
     THD_IP_NODE data,* sfthd_ip_node;
@@ -914,10 +959,14 @@ int sfthd_test_local(
     */
 
     /* Set up the key */
+    memset(&key, 0, sizeof(key));
     key.policyId = policy_id;
     key.ip = *ip;
     key.thd_id = sfthd_node->thd_id;
 
+    if ( counts and sfthd_node->type == THD_TYPE_LIMIT )
+        return sfthd_test_shared_limit(counts, sfthd_node, &key, sizeof(key), curtime);
+
     /* Set up a new data element */
     data.count  = 1;
     data.prev   = 0;
@@ -958,7 +1007,8 @@ static inline int sfthd_test_global(
     unsigned sig_id,     /* from current event */
     const sfip_t* sip,        /* " */
     const sfip_t* dip,        /* " */
-    time_t curtime)
+    time_t curtime,
+    SharedCounts* counts)
 {
     THD_IP_GNODE_KEY key;
     THD_IP_NODE data;
@@ -1006,11 +1056,15 @@ static inline int sfthd_test_global(
     */
 
     /* Set up the key */
+    memset(&key, 0, sizeof(key));
     key.ip = *ip;
     key.gen_id = sfthd_node->gen_id;
     key.sig_id = sig_id;
     key.policyId = policy_id;
 
+    if ( counts and sfthd_node->type == THD_TYPE_LIMIT )
+        return sfthd_test_shared_limit(counts, sfthd_node, &key, sizeof(key), curtime);
+
     /* Set up a new data element */
     data.count  = 1;
     data.prev  = 0;
@@ -1157,7 +1211,8 @@ int sfthd_test_threshold(
         /*
          *   Test SUPPRESSION and THRESHOLDING
          */
-        status = sfthd_test_local(thd->ip_nodes, sfthd_node, sip, dip, curtime);
+        status = sfthd_test_local(
+            thd->ip_nodes, sfthd_node, sip, dip, curtime, thd->counts);
 
         if ( status < 0 ) /* -1 == Don't log and stop looking */
         {
@@ -1199,7 +1254,7 @@ global_test:
     if ( g_thd_node )
     {
         status = sfthd_test_global(
-            thd->ip_gnodes, g_thd_node, sig_id, sip, dip, curtime);
+            thd->ip_gnodes, g_thd_node, sig_id, sip, dip, curtime, thd->counts);
 
         if ( status < 0 ) /* -1 == Don't log and stop looking */
         {
@@ -33,6 +33,8 @@
 #include "main/policy.h"
 #include "sfip/sfip_t.h"
 
+class SharedCounts;
+
 /*!
     Max GEN_ID value - Set this to the Max Used by Snort, this is used for the
     dimensions of the gen_id lookup array.
@@ -185,6 +187,7 @@ struct THD_STRUCT
 {
     SFXHASH* ip_nodes;   /* Global hash of active IP's key=THD_IP_NODE_KEY, data=THD_IP_NODE */
     SFXHASH* ip_gnodes;  /* Global hash of active IP's key=THD_IP_GNODE_KEY, data=THD_IP_GNODE */
+    SharedCounts* counts; /* limit counts shared by packet threads, if more than one */
 };
 
 struct ThresholdObjects
@@ -260,7 +263,8 @@ int sfthd_test_local(
     THD_NODE* sfthd_node,
     const sfip_t* sip,
     const sfip_t* dip,
-    time_t curtime);
+    time_t curtime,
+    SharedCounts* = nullptr);
 
 #ifdef THD_DEBUG
 int sfthd_show_objects(THD_STRUCT* thd);
@@ -0,0 +1,183 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// shared_counts.cc
+
+#include "shared_counts.h"
+
+#include "main/thread_config.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+static inline uint64_t pack(uint32_t tstart, uint32_t count)
+{ return ((uint64_t)tstart << 32) | count; }
+
+static inline uint32_t get_start(uint64_t b)
+{ return (uint32_t)(b >> 32); }
+
+static inline uint32_t get_count(uint64_t b)
+{ return (uint32_t)b; }
+
+SharedCounts::SharedCounts(unsigned rows)
+{
+    unsigned n = 1;
+
+    while ( n < rows )
+        n <<= 1;
+
+    buckets = new std::atomic<uint64_t>[n];
+    mask = n - 1;
+    clear();
+}
+
+SharedCounts::~SharedCounts()
+{
+    delete[] buckets;
+}
+
+SharedCounts* SharedCounts::create(unsigned rows)
+{
+    if ( ThreadConfig::get_instance_max() < 2 )
+        return nullptr;
+
+    return new SharedCounts(rows);
+}
+
+void SharedCounts::clear()
+{
+    for ( unsigned i = 0; i <= mask; ++i )
+        buckets[i].store(0, std::memory_order_relaxed);
+}
+
+// fnv-1a with a final mix so the low bits used for the index are good
+uint64_t SharedCounts::hash(const void* p, size_t n)
+{
+    const uint8_t* b = (const uint8_t*)p;
+    uint64_t h = 0xcbf29ce484222325ull;
+
+    for ( size_t i = 0; i < n; ++i )
+    {
+        h ^= b[i];
+        h *= 0x100000001b3ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+// a new window starts when the current one is over.  threads don't agree
+// exactly on the time so an event that looks older than the window start
+// is just counted in the current window.
+unsigned SharedCounts::increment(uint64_t key, unsigned seconds, time_t now)
+{
+    std::atomic<uint64_t>& b = buckets[key & mask];
+    uint64_t cur = b.load(std::memory_order_relaxed);
+    uint32_t t = (uint32_t)now;
+    uint64_t next;
+
+    do
+    {
+        uint32_t tstart = get_start(cur);
+        uint32_t count = get_count(cur);
+
+        if ( !tstart or (seconds and (int32_t)(t - tstart) >= (int32_t)seconds) )
+        {
+            tstart = t ? t : 1;
+            count = 0;
+        }
+        if ( count + 1 )
+            ++count;
+
+        next = pack(tstart, count);
+    }
+    while ( !b.compare_exchange_weak(cur, next, std::memory_order_relaxed) );
+
+    return get_count(next);
+}
+
+unsigned SharedCounts::decrement(uint64_t key)
+{
+    std::atomic<uint64_t>& b = buckets[key & mask];
+    uint64_t cur = b.load(std::memory_order_relaxed);
+    uint64_t next;
+
+    do
+    {
+        uint32_t count = get_count(cur);
+
+        if ( !count )
+            return 0;
+
+        next = pack(get_start(cur), count - 1);
+    }
+    while ( !b.compare_exchange_weak(cur, next, std::memory_order_relaxed) );
+
+    return get_count(next);
+}
+
+void SharedCounts::reset(uint64_t key, time_t now)
+{
+    uint32_t t = (uint32_t)now;
+    buckets[key & mask].store(pack(t ? t : 1, 0), std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+TEST_CASE("shared counts window", "[filters]")
+{
+    SharedCounts sc(100);
+    CHECK(sc.get_rows() == 128);
+
+    uint64_t k = SharedCounts::hash("key", 3);
+
+    CHECK(sc.increment(k, 2, 10) == 1);
+    CHECK(sc.increment(k, 2, 11) == 2);
+
+    // older time counts in the current window
+    CHECK(sc.increment(k, 2, 9) == 3);
+
+    // window over
+    CHECK(sc.increment(k, 2, 12) == 1);
+
+    sc.reset(k, 12);
+    CHECK(sc.increment(k, 2, 12) == 1);
+}
+
+TEST_CASE("shared counts total", "[filters]")
+{
+    SharedCounts sc(1);
+    uint64_t k = SharedCounts::hash("key", 3);
+
+    CHECK(sc.increment(k, 0, 10) == 1);
+    CHECK(sc.increment(k, 0, 1000) == 2);
+    CHECK(sc.decrement(k) == 1);
+    CHECK(sc.decrement(k) == 0);
+    CHECK(sc.decrement(k) == 0);
+
+    sc.clear();
+    CHECK(sc.increment(k, 0, 10) == 1);
+}
+
+#endif
+
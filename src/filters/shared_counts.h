@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// shared_counts.h
+
+#ifndef SHARED_COUNTS_H
+#define SHARED_COUNTS_H
+
+// Lock-free counts shared by all packet threads so rate_filter and
+// event_filter limits hold for the process instead of per thread.
+//
+// Each key hashes to one fixed 64 bit bucket that packs the start of the
+// current window (high half) and the count in it (low half) so every update
+// is a single CAS.  Colliding keys share a bucket which can only make a
+// limit trip early, never late.  There is no memory recovery to do.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>
+
+class SharedCounts
+{
+public:
+    SharedCounts(unsigned rows);  // rounded up to a power of 2
+    ~SharedCounts();
+
+    // seconds = 0 is a running total with no window.  these return the
+    // count after the update.
+    unsigned increment(uint64_t key, unsigned seconds, time_t now);
+    unsigned decrement(uint64_t key);
+    void reset(uint64_t key, time_t now);
+
+    void clear();
+
+    unsigned get_rows() const
+    { return mask + 1; }
+
+    static uint64_t hash(const void*, size_t);
+
+    // only worth it with more than one packet thread; a single thread gets
+    // exact tracking from the per-key hash
+    static SharedCounts* create(unsigned rows);
+
+private:
+    std::atomic<uint64_t>* buckets;
+    unsigned mask;
+};
+
+#endif
+
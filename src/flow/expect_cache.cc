@@ -34,6 +34,9 @@
 #define MAX_WAIT  300
 #define MAX_PRUNE   5
 
+// counting bloom filter with 2 probes; must be a power of 2
+#define FILTER_SIZE 4096
+
 struct ExpectFlow
 {
     struct ExpectFlow* next;
@@ -66,6 +69,7 @@ struct ExpectNode
     int direction = 0;
     unsigned count = 0;
     int16_t appId = 0;
+    uint32_t filter_hash = 0;
 
     ExpectFlow* head = nullptr;
     ExpectFlow* tail = nullptr;
@@ -99,6 +103,8 @@ struct ExpectKey
         const sfip_t *cliIP, uint16_t cliPort,
         const sfip_t *srvIP, uint16_t srvPort,
         PktType proto);
+
+    uint32_t filter_hash() const;
 };
 
 inline bool ExpectKey::set(
@@ -129,11 +135,52 @@ inline bool ExpectKey::set(
     return reverse;
 }
 
+// ports are excluded so both lookups in is_expected() hash the same
+inline uint32_t ExpectKey::filter_hash() const
+{
+    uint32_t h = 2166136261u ^ (uint32_t)protocol;
+
+    for ( unsigned i = 0; i < 4; ++i )
+    {
+        h = (h ^ ip1.ip32[i]) * 16777619u;
+        h = (h ^ ip2.ip32[i]) * 16777619u;
+    }
+    h ^= h >> 15;
+    h *= 0x2c1b3c6d;
+    h ^= h >> 12;
+    return h;
+}
+
 //-------------------------------------------------------------------------
 // private ExpectCache methods
 //-------------------------------------------------------------------------
 
 // Clean the hash table of at most MAX_PRUNE expired nodes
+inline void ExpectCache::filter_add(uint32_t h)
+{
+    ++filter[h & (FILTER_SIZE - 1)];
+    ++filter[(h >> 16) & (FILTER_SIZE - 1)];
+}
+
+inline void ExpectCache::filter_del(uint32_t h)
+{
+    assert(filter[h & (FILTER_SIZE - 1)] and filter[(h >> 16) & (FILTER_SIZE - 1)]);
+    --filter[h & (FILTER_SIZE - 1)];
+    --filter[(h >> 16) & (FILTER_SIZE - 1)];
+}
+
+inline bool ExpectCache::filter_test(uint32_t h)
+{
+    return filter[h & (FILTER_SIZE - 1)] and filter[(h >> 16) & (FILTER_SIZE - 1)];
+}
+
+// removes the current node
+inline void ExpectCache::remove(ExpectNode* node)
+{
+    filter_del(node->filter_hash);
+    hash_table->remove();
+}
+
 void ExpectCache::prune()
 {
     time_t now = packet_time();
@@ -145,7 +192,7 @@ void ExpectCache::prune()
         if ( !node || now <= node->expires )
             break;
 
-        hash_table->remove();
+        remove(node);
         ++prunes;
     }
 }
@@ -260,6 +307,7 @@ ExpectCache::ExpectCache (uint32_t max)
 {
     // -size forces use of abs(size) ie w/o bumping up
     hash_table = new ZHash(-MAX_HASH, sizeof(ExpectKey));
+    hash_table->set_stats("expect_cache");
 
     nodes = new ExpectNode[max];
 
@@ -282,6 +330,9 @@ ExpectCache::ExpectCache (uint32_t max)
 
     expects = realized = 0;
     prunes = overflows = 0;
+    probes = misses = 0;
+
+    filter = new uint32_t[FILTER_SIZE]();
 }
 
 ExpectCache::~ExpectCache ()
@@ -289,6 +340,7 @@ ExpectCache::~ExpectCache ()
     delete hash_table;
     delete[] nodes;
     delete[] pool;
+    delete[] filter;
 }
 
 /**Either expect or expect future session.
@@ -338,6 +390,8 @@ int ExpectCache::add_flow(
         node->direction = direction;
         node->head = node->tail = nullptr;
         node->count = 0;
+        node->filter_hash = hashKey.filter_hash();
+        filter_add(node->filter_hash);
         last = nullptr;
     }
     if ( !set_data(node, last, fd) )
@@ -360,6 +414,11 @@ bool ExpectCache::is_expected(Packet* p)
     ExpectKey key;
     bool reversed_key = key.set(dstIP, p->ptrs.dp, srcIP, p->ptrs.sp, p->type());
 
+    if ( !filter_test(key.filter_hash()) )
+        return false;
+
+    ++probes;
+
     uint16_t port1;
     uint16_t port2;
 
@@ -387,13 +446,16 @@ bool ExpectCache::is_expected(Packet* p)
         node = (ExpectNode*)hash_table->find(&key);
 
         if ( !node )
+        {
+            ++misses;
             return false;
+        }
     }
     // FIXIT-M X This should also include a lookup in the table for entries where both
     // src and dst ports are known.
     if ( !node->head || (p->pkth->ts.tv_sec > node->expires) )
     {
-        hash_table->remove();
+        remove(node);
         return false;
     }
     /* Make sure the packet direction is correct */
@@ -449,7 +511,7 @@ char ExpectCache::process_expected(Packet* p, Flow* lws)
     }
 
     if ( !node->count )
-        hash_table->remove();
+        remove(node);
 
     return retVal;
 }
@@ -59,6 +59,11 @@
 //    individual sessions, not all sessions to a given 3-tuple
 //    (this would make pruning a little harder unless we add linkage
 //    a la FlowCache)
+//
+// -- a counting bloom filter over the address pair and protocol of each
+//    node is checked before the hash table so most new flows, which are
+//    not expected, skip the table probes.  ports are left out since one
+//    is a wild card.
 //-------------------------------------------------------------------------
 
 #include "sfip/sfip_t.h"
@@ -86,8 +91,20 @@ public:
     unsigned long get_prunes() { return prunes; }
     unsigned long get_overflows() { return overflows; }
 
+    // probes = lookups that passed the filter
+    // misses = of those, lookups that found no node (false positives)
+    unsigned long get_probes() { return probes; }
+    unsigned long get_misses() { return misses; }
+
+    void reset_stats() { probes = misses = 0; }
+
 private:
     void prune();
+    void remove(struct ExpectNode*);
+
+    void filter_add(uint32_t);
+    void filter_del(uint32_t);
+    bool filter_test(uint32_t);
 
     struct ExpectNode* get_node(struct ExpectKey&, bool&);
     struct ExpectFlow* get_flow(ExpectNode*, uint32_t, int16_t);
@@ -101,6 +118,9 @@ private:
 
     unsigned long expects, realized;
     unsigned long prunes, overflows;
+    unsigned long probes, misses;
+
+    uint32_t* filter;
 };
 
 #endif
@@ -26,7 +26,7 @@
 #include "flow/ha.h"
 #include "flow/session.h"
 #include "ips_options/ips_flowbits.h"
-#include "utils/bitop.h"
+#include "utils/flowbit_set.h"
 #include "utils/util.h"
 #include "protocols/packet.h"
 #include "sfip/sf_ip.h"
@@ -62,7 +62,8 @@ void Flow::init(PktType type)
     pkt_type = type;
 
     // FIXIT-M getFlowbitSizeInBytes() should be attribute of ??? (or eliminate)
-    bitop = new BitOp(getFlowbitSizeInBytes());
+    // the dense bitmap is only allocated if this flow sets many bits
+    bitop = new FlowBitSet(getFlowbitSizeInBytes() << 3);
 
     if ( HighAvailabilityManager::active() )
     {
@@ -95,6 +96,9 @@ void Flow::term()
 
     if ( ha_state )
         delete ha_state;
+
+    if ( application_ids )
+        snort_free(application_ids);
 }
 
 void Flow::reset(bool do_cleanup)
@@ -130,9 +134,15 @@ void Flow::reset(bool do_cleanup)
     if ( data )
         clear_data();
 
-    constexpr size_t offset = offsetof(Flow, appDataList);
     // FIXIT-L need a struct to zero here to make future proof
-    memset((uint8_t*)this+offset, 0, sizeof(Flow)-offset);
+    constexpr size_t hot = offsetof(Flow, appDataList);
+    memset((uint8_t*)this+hot, 0, offsetof(Flow, key)-hot);
+
+    constexpr size_t cold = offsetof(Flow, data);
+    memset((uint8_t*)this+cold, 0, sizeof(Flow)-cold);
+
+    if ( application_ids )
+        memset(application_ids, 0, APP_PROTOID_MAX*sizeof(*application_ids));
 
     bitop->reset();
 
@@ -153,6 +163,8 @@ void Flow::restart(bool free_flow_data)
     session_state = STREAM_STATE_NONE;
     expire_time = 0;
     previous_ssn_state = ssn_state;
+
+    inspect_bytes[0] = inspect_bytes[1] = 0;
 }
 
 void Flow::clear(bool free_flow_data)
@@ -415,6 +427,9 @@ void Flow::set_ttl(Packet* p, bool client)
 void Flow::set_application_ids(AppId serviceAppId, AppId clientAppId,
         AppId payloadAppId, AppId miscAppId)
 {
+    if ( !application_ids )
+        application_ids = (AppId*)snort_calloc(APP_PROTOID_MAX, sizeof(*application_ids));
+
     application_ids[APP_PROTOID_SERVICE] = serviceAppId;
     application_ids[APP_PROTOID_CLIENT] = clientAppId;
     application_ids[APP_PROTOID_PAYLOAD] = payloadAppId;
@@ -424,6 +439,11 @@ void Flow::set_application_ids(AppId serviceAppId, AppId clientAppId,
 void Flow::get_application_ids(AppId& serviceAppId, AppId& clientAppId,
         AppId& payloadAppId, AppId& miscAppId)
 {
+    if ( !application_ids )
+    {
+        serviceAppId = clientAppId = payloadAppId = miscAppId = 0;
+        return;
+    }
     serviceAppId = application_ids[APP_PROTOID_SERVICE];
     clientAppId  = application_ids[APP_PROTOID_CLIENT];
     payloadAppId = application_ids[APP_PROTOID_PAYLOAD];
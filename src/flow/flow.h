@@ -29,7 +29,7 @@
 
 #include <assert.h>
 
-#include "utils/bitop.h"
+#include "utils/flowbit_set.h"
 #include "sfip/sfip_t.h"
 #include "flow/flow_key.h"
 #include "framework/inspector.h"
@@ -65,6 +65,9 @@
 #define SSNFLAG_CLIENT_SWAPPED      0x00400000
 
 #define SSNFLAG_PROXIED             0x01000000
+#define SSNFLAG_ALERTED             0x02000000 /* an event was logged */
+#define SSNFLAG_DEPTH_BYPASS        0x04000000 /* inspection depth reached */
+#define SSNFLAG_ELEPHANT            0x08000000 /* offloaded to the daq */
 #define SSNFLAG_NONE                0x00000000 /* nothing, an MT bag of chips */
 
 #define SSNFLAG_SEEN_BOTH (SSNFLAG_SEEN_SERVER | SSNFLAG_SEEN_CLIENT)
@@ -137,7 +140,7 @@ struct LwState
     char ignore_direction;
 };
 
-// this struct is organized by member size for compactness
+// this struct is organized by access frequency and then member size
 class SO_PUBLIC Flow
 {
 public:
@@ -291,59 +294,96 @@ public:
         return disable_inspect;
     }
 
+    // the binder sets a per direction byte budget; 0 means unlimited
+    void set_inspection_depth(uint32_t n)
+    { inspect_depth = n; }
+
+    bool depth_bypassed() const
+    { return (ssn_state.session_flags & SSNFLAG_DEPTH_BYPASS) != 0; }
+
+    bool is_elephant() const
+    { return (ssn_state.session_flags & SSNFLAG_ELEPHANT) != 0; }
+
+    void get_key(FlowKey& k) const
+    {
+        if ( key4 )
+            static_cast<const FlowKey4*>(key)->unpack(k);
+        else
+            k = *static_cast<const FlowKey*>(key);
+    }
+
 public:  // FIXIT-M privatize if possible
-    // these fields are const after initialization
-    const FlowKey* key;
-    class Session* session;
-    class BitOp* bitop;
-    class FlowHAState* ha_state;
-    uint8_t ip_proto; // FIXIT-M do we need both of these?
-    PktType pkt_type; // ^^
+    // the hot header is touched by every packet and fills the first two
+    // cache lines of a pooled flow; the rest is used at setup, binding,
+    // responses, and ha or is allocated on demand.
 
-    // these fields are always set; not zeroed
-    Flow* prev, * next;
-    Inspector* ssn_client;
-    Inspector* ssn_server;
+    // these fields are const after initialization or always set; not zeroed
+    class Session* session;
     long last_data_seen;
+    PktType pkt_type; // FIXIT-M do we need both of these?
+    uint8_t ip_proto; // ^^
+    bool key4;
 
-    // everything from here down is zeroed
+    // everything from here down to key is zeroed
     FlowData* appDataList;
     Inspector* clouseau;  // service identifier
     Inspector* gadget;    // service handler
-    Inspector* data;
-    const char* service;
+    uint64_t expire_time;
 
-    unsigned policy_id;
+    LwState ssn_state;
 
+    unsigned policy_id;
     FlowState flow_state;
 
-    sfip_t client_ip; // FIXIT-L family and bits should be changed to uint16_t
-    sfip_t server_ip; // or uint8_t to reduce sizeof from 24 to 20
-
-    uint64_t expire_time;
-
-    int32_t iface_in;
-    int32_t iface_out;
+    sfip_t client_ip;
+    sfip_t server_ip;
 
     uint16_t client_port;
     uint16_t server_port;
 
-    uint16_t ssn_policy;
     uint16_t session_state;
+    uint16_t ssn_policy;
+
+    bool disable_inspect;
+
+    // cold fields start here; these are const after initialization or
+    // always set; not zeroed
+    // key is held by the cache; it is a FlowKey4 if key4 else a FlowKey
+    const void* key;
+    class FlowBitSet* bitop;
+    class FlowHAState* ha_state;
+    Flow* prev, * next;
+    Inspector* ssn_client;
+    Inspector* ssn_server;
+
+    // FIXIT-L: if appid is only consumer of this move to appid
+    // allocated by the first set_application_ids()
+    AppId* application_ids;
+
+    // everything from here down is zeroed
+    Inspector* data;
+    const char* service;
+
+    int32_t iface_in;
+    int32_t iface_out;
 
     uint8_t  inner_client_ttl, inner_server_ttl;
     uint8_t  outer_client_ttl, outer_server_ttl;
 
     uint8_t  response_count;
-    bool disable_inspect;
-
-    // FIXIT-L: if appid is only consumer of this move to appid
-    AppId application_ids[APP_PROTOID_MAX];
 
-public:
-    LwState ssn_state;
     LwState previous_ssn_state;
+
+    long first_data_seen;
+
+    // counted only with a binder depth or network elephant thresholds
+    uint64_t inspect_bytes[2];  // client, server
+    uint32_t inspect_depth;
 };
 
+#define FLOW_HOT_SIZE 128
+
+static_assert(offsetof(Flow, key) <= FLOW_HOT_SIZE, "flow hot header is too large");
+
 #endif
 
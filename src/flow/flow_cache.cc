@@ -24,6 +24,8 @@
 #include "config.h"
 #endif
 
+#include "flow/flow_key.h"
+#include "flow/flow_pool.h"
 #include "hash/zhash.h"
 #include "helpers/flag_context.h"
 #include "ips_options/ips_flowbits.h"
@@ -37,8 +39,11 @@
 // FlowCache stuff
 //-------------------------------------------------------------------------
 
-FlowCache::FlowCache (const FlowConfig& cfg) : config(cfg)
+FlowCache::FlowCache (const FlowConfig& cfg, FlowPool* fp, const char* name) : config(cfg)
 {
+    pool = fp;
+    num_flows = 0;
+
     cleanup_flows = cfg.max_sessions * cfg.cleanup_pct / 100;
     if ( cleanup_flows == 0 )
         cleanup_flows = 1;
@@ -46,8 +51,26 @@ FlowCache::FlowCache (const FlowConfig& cfg) : config(cfg)
     assert(cleanup_flows <= cfg.max_sessions);
     assert(cleanup_flows > 0);
 
-    hash_table = new ZHash(config.max_sessions, sizeof(FlowKey));
-    hash_table->set_keyops(FlowKey::hash, FlowKey::compare);
+    // pruning is done in line with packet processing so the budget bounds
+    // the latency added to any one packet at the cost of pruning more often
+    prune_limit = cleanup_flows;
+
+    if ( cfg.prune_budget and cfg.prune_budget < prune_limit )
+        prune_limit = cfg.prune_budget;
+
+    hash_table = new ZHash(config.max_sessions, sizeof(FlowKey), config.hash_buckets);
+    hash_table->set_keyops(FlowKey::get_hash(config.hash_crc), FlowKey::compare);
+    hash_table->set_stats(name);
+
+    if ( config.compact_keys )
+    {
+        // stats for both tables are summed under the same name
+        hash_table4 = new ZHash(config.max_sessions, sizeof(FlowKey4), config.hash_buckets);
+        hash_table4->set_keyops(FlowKey4::get_hash(config.hash_crc), FlowKey4::compare);
+        hash_table4->set_stats(name);
+    }
+    else
+        hash_table4 = nullptr;
 
     uni_head = new Flow;
     uni_tail = new Flow;
@@ -66,26 +89,107 @@ FlowCache::~FlowCache ()
     while ( Flow* flow = (Flow*)hash_table->pop() )
         flow->term();
 
+    if ( hash_table4 )
+    {
+        while ( Flow* flow = (Flow*)hash_table4->pop() )
+            flow->term();
+    }
+
     delete uni_head;
     delete uni_tail;
 
     delete hash_table;
+    delete hash_table4;
 }
 
 void FlowCache::push(Flow* flow)
 {
-    void* key = hash_table->push(flow);
-    flow->key = (FlowKey*)key;
+    push(hash_table, flow);
+}
+
+void FlowCache::push(ZHash* table, Flow* flow)
+{
+    flow->key = table->push(flow);
+    flow->key4 = (table == hash_table4);
+}
+
+bool FlowCache::grow(ZHash* table)
+{
+    if ( num_flows >= config.max_sessions )
+        return false;
+
+    Flow* flow = pool->get();
+
+    if ( !flow )
+        return false;
+
+    push(table, flow);
+    ++num_flows;
+    return true;
+}
+
+// a free flow can only hold a key of its own table so when the other
+// table has one it is moved over with a new node
+bool FlowCache::move_free(ZHash* table)
+{
+    if ( !hash_table4 )
+        return false;
+
+    ZHash* other = (table == hash_table4) ? hash_table : hash_table4;
+    Flow* flow = (Flow*)other->pop();
+
+    if ( !flow )
+        return false;
+
+    push(table, flow);
+    return true;
+}
+
+// returns the table for the key and sets k to the key in its format
+ZHash* FlowCache::get_table(const FlowKey* key, FlowKey4& k4, const void*& k)
+{
+    if ( hash_table4 and key->is_ip4() )
+    {
+        k4.pack(*key);
+        k = &k4;
+        return hash_table4;
+    }
+    k = key;
+    return hash_table;
+}
+
+// the least recently used flow of either table
+Flow* FlowCache::oldest(ZHash*& table)
+{
+    table = hash_table;
+    auto flow = static_cast<Flow*>(hash_table->first());
+
+    if ( hash_table4 )
+    {
+        auto flow4 = static_cast<Flow*>(hash_table4->first());
+
+        if ( flow4 and (!flow or flow4->last_data_seen < flow->last_data_seen) )
+        {
+            table = hash_table4;
+            flow = flow4;
+        }
+    }
+    return flow;
 }
 
 unsigned FlowCache::get_count()
 {
-    return hash_table ? hash_table->get_count() : 0;
+    if ( !hash_table )
+        return 0;
+
+    return hash_table->get_count() + (hash_table4 ? hash_table4->get_count() : 0);
 }
 
 Flow* FlowCache::find(const FlowKey* key)
 {
-    Flow* flow = (Flow*)hash_table->find(key);
+    FlowKey4 k4;
+    const void* k;
+    Flow* flow = (Flow*)get_table(key, k4, k)->find(k);
 
     if ( flow )
     {
@@ -98,6 +202,50 @@ Flow* FlowCache::find(const FlowKey* key)
     return flow;
 }
 
+void FlowCache::find_batch(const FlowKey* const* keys, unsigned n, Flow** flows)
+{
+    if ( !hash_table4 )
+        hash_table->find_batch((const void* const*)keys, n, (void**)flows);
+
+    else
+    {
+        // consecutive keys of the same version are still found as a batch
+        const unsigned max_run = 16;
+        FlowKey4 k4[max_run];
+        const void* kp[max_run];
+        unsigned i = 0;
+
+        while ( i < n )
+        {
+            bool ip4 = keys[i]->is_ip4();
+            unsigned j = i;
+
+            while ( j < n and j - i < max_run and keys[j]->is_ip4() == ip4 )
+            {
+                if ( ip4 )
+                {
+                    k4[j - i].pack(*keys[j]);
+                    kp[j - i] = k4 + (j - i);
+                }
+                ++j;
+            }
+            if ( ip4 )
+                hash_table4->find_batch(kp, j - i, (void**)(flows + i));
+            else
+                hash_table->find_batch((const void* const*)(keys + i), j - i, (void**)(flows + i));
+
+            i = j;
+        }
+    }
+    time_t t = packet_time();
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        if ( flows[i] and flows[i]->last_data_seen < t )
+            flows[i]->last_data_seen = t;
+    }
+}
+
 // always prepend
 void FlowCache::link_uni(Flow* flow)
 {
@@ -127,19 +275,31 @@ void FlowCache::unlink_uni(Flow* flow)
 Flow* FlowCache::get(const FlowKey* key)
 {
     time_t timestamp = packet_time();
-    Flow* flow = (Flow*)hash_table->get(key);
+    FlowKey4 k4;
+    const void* k;
+    ZHash* table = get_table(key, k4, k);
+    Flow* flow = (Flow*)table->get(k);
 
     if ( !flow )
     {
-        if ( !prune_stale(timestamp, nullptr) )
+        // prune only at max_sessions or when the pool is exhausted; in the
+        // latter case this cache may be well below max_sessions so fall
+        // back to its oldest flow
+        if ( !grow(table) and !move_free(table) and !prune_stale(timestamp, nullptr) )
         {
-            if ( !prune_unis() )
-                prune_excess(nullptr);
+            if ( !prune_unis() and !prune_excess(nullptr) )
+                prune_one(PruneReason::EXCESS, true);
         }
 
-        flow = (Flow*)hash_table->get(key);
+        flow = (Flow*)table->get(k);
+
+        // the pruned flow may have been in the other table
+        if ( !flow and move_free(table) )
+            flow = (Flow*)table->get(k);
+
+        if ( !flow )
+            return nullptr;
 
-        assert(flow);
         flow->reset();
         link_uni(flow);
     }
@@ -161,7 +321,7 @@ int FlowCache::remove(Flow* flow)
     if ( flow->next )
         unlink_uni(flow);
 
-    return hash_table->remove(flow->key);
+    return (flow->key4 ? hash_table4 : hash_table)->remove(flow->key);
 }
 
 unsigned FlowCache::prune_stale(uint32_t thetime, const Flow* save_me)
@@ -169,9 +329,10 @@ unsigned FlowCache::prune_stale(uint32_t thetime, const Flow* save_me)
     ActiveSuspendContext act_susp;
 
     unsigned pruned = 0;
-    auto flow = static_cast<Flow*>(hash_table->first());
+    ZHash* table;
+    auto flow = oldest(table);
 
-    while ( flow and pruned <= cleanup_flows )
+    while ( flow and pruned < prune_limit )
     {
 #if 0
         // FIXIT-H this loops forever if 1 flow in cache
@@ -200,7 +361,7 @@ unsigned FlowCache::prune_stale(uint32_t thetime, const Flow* save_me)
         release(flow, PruneReason::TIMEOUT);
         ++pruned;
 
-        flow = static_cast<Flow*>(hash_table->first());
+        flow = oldest(table);
     }
 
     return pruned;
@@ -217,7 +378,7 @@ unsigned FlowCache::prune_unis()
     Flow* curr = uni_tail->prev;
     unsigned pruned = 0;
 
-    while ( (uni_count > max_uni) && curr && (pruned < cleanup_flows) )
+    while ( (uni_count > max_uni) && curr && (pruned < prune_limit) )
     {
         Flow* flow = curr;
         curr = curr->prev;
@@ -242,10 +403,11 @@ unsigned FlowCache::prune_excess(const Flow* save_me)
     unsigned pruned = 0;
     unsigned blocks = 0;
 
-    while ( hash_table->get_count() > max_cap and hash_table->get_count() > blocks )
+    while ( get_count() > max_cap and get_count() > blocks and pruned < prune_limit )
     {
-        auto flow = static_cast<Flow*>(hash_table->first());
-        assert(flow); // holds true because hash_table->get_count() > 0
+        ZHash* table;
+        auto flow = oldest(table);
+        assert(flow); // holds true because get_count() > 0
 
         if ( (save_me and flow == save_me) or flow->was_blocked() )
         {
@@ -256,7 +418,7 @@ unsigned FlowCache::prune_excess(const Flow* save_me)
 
             // FIXIT-M we should update last_data_seen upon touch to ensure
             // the hash_table LRU list remains sorted by time
-            if ( !hash_table->touch() )
+            if ( !table->touch() )
                 break;
         }
 
@@ -275,10 +437,11 @@ bool FlowCache::prune_one(PruneReason reason, bool do_cleanup)
 {
 
     // so we don't prune the current flow (assume current == MRU)
-    if ( hash_table->get_count() <= 1 )
+    if ( get_count() <= 1 )
         return false;
 
-    auto flow = static_cast<Flow*>(hash_table->first());
+    ZHash* table;
+    auto flow = oldest(table);
     assert(flow);
 
     flow->ssn_state.session_flags |= SSNFLAG_PRUNED;
@@ -297,14 +460,24 @@ bool FlowCache::prune_one(PruneReason reason, bool do_cleanup)
 }
 
 unsigned FlowCache::timeout(unsigned num_flows, time_t thetime)
+{
+    unsigned retired = timeout(hash_table, num_flows, thetime);
+
+    if ( hash_table4 and retired < num_flows )
+        retired += timeout(hash_table4, num_flows - retired, thetime);
+
+    return retired;
+}
+
+unsigned FlowCache::timeout(ZHash* table, unsigned num_flows, time_t thetime)
 {
     // FIXIT-H should Active be suspended here too?
     unsigned retired = 0;
 
-    auto flow = static_cast<Flow*>(hash_table->current());
+    auto flow = static_cast<Flow*>(table->current());
 
     if ( !flow )
-        flow = static_cast<Flow*>(hash_table->first());
+        flow = static_cast<Flow*>(table->first());
 
     while ( flow and retired < num_flows )
     {
@@ -317,7 +490,7 @@ unsigned FlowCache::timeout(unsigned num_flows, time_t thetime)
 
         ++retired;
 
-        flow = static_cast<Flow*>(hash_table->current());
+        flow = static_cast<Flow*>(table->current());
     }
 
     return retired;
@@ -331,7 +504,9 @@ unsigned FlowCache::purge()
 
     unsigned retired = 0;
 
-    while ( auto flow = static_cast<Flow*>(hash_table->first()) )
+    ZHash* table;
+
+    while ( auto flow = oldest(table) )
     {
         flow->ssn_state.session_flags |= SSNFLAG_PRUNED;
         release(flow, PruneReason::PURGE);
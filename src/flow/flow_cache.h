@@ -23,7 +23,9 @@
 #define FLOW_CACHE_H
 
 // there is a FlowCache instance for each protocol.
-// Flows are stored in a ZHash instance by FlowKey.
+// Flows are stored in a ZHash instance by FlowKey.  with compact_keys, ip4
+// flows are stored in a second ZHash by FlowKey4 instead.
+// Flows are drawn from the thread's FlowPool as needed up to max_sessions.
 
 #include <ctime>
 #include <type_traits>
@@ -32,18 +34,23 @@
 #include "prune_stats.h"
 
 class Flow;
+class FlowPool;
+class ZHash;
 struct FlowKey;
+struct FlowKey4;
 
 class FlowCache
 {
 public:
-    FlowCache(const FlowConfig&);
+    // name is used for the hash table stats
+    FlowCache(const FlowConfig&, FlowPool*, const char* name = "flow_cache");
 
     ~FlowCache();
 
     void push(Flow*);
 
     Flow* find(const FlowKey*);
+    void find_batch(const FlowKey* const*, unsigned n, Flow**);
     Flow* get(const FlowKey*);
 
     int release(Flow*, PruneReason = PruneReason::USER, bool do_cleanup = true);
@@ -72,16 +79,26 @@ public:
     void unlink_uni(Flow*);
 
 private:
+    void push(ZHash*, Flow*);
+    bool grow(ZHash*);
+    bool move_free(ZHash*);
+    ZHash* get_table(const FlowKey*, FlowKey4&, const void*&);
+    Flow* oldest(ZHash*&);
+    unsigned timeout(ZHash*, unsigned num_flows, time_t cur_time);
     void link_uni(Flow*);
     int remove(Flow*);
 
 private:
     const FlowConfig& config;
+    FlowPool* pool;
+    unsigned num_flows;  // drawn from the pool
     unsigned cleanup_flows;
+    unsigned prune_limit;  // per call
     unsigned uni_count;
     uint32_t flags;
 
-    class ZHash* hash_table;
+    ZHash* hash_table;
+    ZHash* hash_table4;  // null unless compact_keys
     Flow* uni_head, * uni_tail;
     PruneStats prune_stats;
 };
@@ -29,6 +29,10 @@ struct FlowConfig
     unsigned pruning_timeout = 0;
     unsigned nominal_timeout = 0;
     unsigned cleanup_pct = 0;
+    unsigned prune_budget = 0;
+    bool hash_buckets = true;
+    bool hash_crc = false;
+    bool compact_keys = false;
 };
 
 #endif
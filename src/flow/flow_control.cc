@@ -25,8 +25,11 @@
 #include <cassert>
 
 #include "detection/detect.h"
+#include "file_api/file_flows.h"
+#include "latency/degrade.h"
+#include "main/policy.h"
 #include "managers/inspector_manager.h"
-#include "memory/memory_cap.h"
+#include "memory/prune_handler.h"
 #include "packet_io/active.h"
 #include "protocols/icmp4.h"
 #include "protocols/icmp6.h"
@@ -34,10 +37,12 @@
 #include "protocols/udp.h"
 #include "protocols/vlan.h"
 #include "sfip/sf_ip.h"
+#include "utils/flowbit_set.h"
 
 #include "expect_cache.h"
 #include "flow_cache.h"
 #include "flow_config.h"
+#include "flow_pool.h"
 #include "session.h"
 
 FlowControl::FlowControl()
@@ -50,9 +55,8 @@ FlowControl::FlowControl()
     file_cache = nullptr;
     exp_cache = nullptr;
 
-    ip_mem = icmp_mem = nullptr;
-    tcp_mem = udp_mem = nullptr;
-    user_mem = file_mem = nullptr;
+    pool = nullptr;
+    udp_stateless = nullptr;
 
     get_ip = get_icmp = nullptr;
     get_tcp = get_udp = nullptr;
@@ -70,13 +74,7 @@ FlowControl::~FlowControl()
     delete user_cache;
     delete file_cache;
     delete exp_cache;
-
-    snort_free(ip_mem);
-    snort_free(icmp_mem);
-    snort_free(tcp_mem);
-    snort_free(udp_mem);
-    snort_free(user_mem);
-    snort_free(file_mem);
+    delete pool;
 }
 
 //-------------------------------------------------------------------------
@@ -89,6 +87,12 @@ static THREAD_LOCAL PegCount tcp_count = 0;
 static THREAD_LOCAL PegCount udp_count = 0;
 static THREAD_LOCAL PegCount user_count = 0;
 static THREAD_LOCAL PegCount file_count = 0;
+static THREAD_LOCAL PegCount udp_stateless_count = 0;
+static THREAD_LOCAL PegCount depth_bypass_count = 0;
+static THREAD_LOCAL PegCount depth_bypass_bytes = 0;
+static THREAD_LOCAL PegCount elephant_count = 0;
+static THREAD_LOCAL PegCount elephant_bytes = 0;
+static THREAD_LOCAL PegCount elephant_leaks = 0;
 
 uint32_t FlowControl::max_flows(PktType type)
 {
@@ -114,6 +118,30 @@ PegCount FlowControl::get_flows(PktType type)
     }
 }
 
+PegCount FlowControl::get_stateless_udp()
+{ return udp_stateless_count; }
+
+PegCount FlowControl::get_depth_bypasses()
+{ return depth_bypass_count; }
+
+PegCount FlowControl::get_depth_bypassed_bytes()
+{ return depth_bypass_bytes; }
+
+PegCount FlowControl::get_elephant_offloads()
+{ return elephant_count; }
+
+PegCount FlowControl::get_elephant_offloaded_bytes()
+{ return elephant_bytes; }
+
+PegCount FlowControl::get_elephant_leaked_bytes()
+{ return elephant_leaks; }
+
+PegCount FlowControl::get_expect_probes()
+{ return exp_cache ? exp_cache->get_probes() : 0; }
+
+PegCount FlowControl::get_expect_misses()
+{ return exp_cache ? exp_cache->get_misses() : 0; }
+
 PegCount FlowControl::get_total_prunes(PktType type) const
 {
     auto cache = get_cache(type);
@@ -131,6 +159,12 @@ void FlowControl::clear_counts()
     ip_count = icmp_count = 0;
     tcp_count = udp_count = 0;
     user_count = file_count = 0;
+    udp_stateless_count = 0;
+    depth_bypass_count = depth_bypass_bytes = 0;
+    elephant_count = elephant_bytes = elephant_leaks = 0;
+
+    if ( exp_cache )
+        exp_cache->reset_stats();
 
     FlowCache* cache;
 
@@ -196,6 +230,31 @@ Flow* FlowControl::find_flow(const FlowKey* key)
     return NULL;
 }
 
+// for a burst of packets; consecutive keys of the same type are looked up
+// together so their table rows are prefetched as one batch
+void FlowControl::find_flows(const FlowKey* const* keys, unsigned n, Flow** flows)
+{
+    unsigned i = 0;
+
+    while ( i < n )
+    {
+        PktType type = keys[i]->pkt_type;
+        unsigned j = i + 1;
+
+        while ( j < n and keys[j]->pkt_type == type )
+            ++j;
+
+        if ( FlowCache* cache = get_cache(type) )
+            cache->find_batch(keys + i, j - i, flows + i);
+        else
+        {
+            for ( unsigned k = i; k < j; ++k )
+                flows[k] = nullptr;
+        }
+        i = j;
+    }
+}
+
 Flow* FlowControl::new_flow(const FlowKey* key)
 {
     FlowCache* cache = get_cache(key->pkt_type);
@@ -263,42 +322,39 @@ bool FlowControl::prune_one(PruneReason reason, bool do_cleanup)
     return cache ? cache->prune_one(reason, do_cleanup) : false;
 }
 
-void FlowControl::timeout_flows(uint32_t flowCount, time_t cur_time)
+// returns the number of flows retired
+unsigned FlowControl::timeout_flows(uint32_t flowCount, time_t cur_time)
 {
+    unsigned retired = 0;
     Active::suspend();
 
     if ( ip_cache )
-        ip_cache->timeout(flowCount, cur_time);
+        retired += ip_cache->timeout(flowCount, cur_time);
 
     //if ( icmp_cache )
     //icmp_cache does not need cleaning
 
     if ( tcp_cache )
-        tcp_cache->timeout(flowCount, cur_time);
+        retired += tcp_cache->timeout(flowCount, cur_time);
 
     if ( udp_cache )
-        udp_cache->timeout(flowCount, cur_time);
+        retired += udp_cache->timeout(flowCount, cur_time);
 
     if ( user_cache )
-        user_cache->timeout(flowCount, cur_time);
+        retired += user_cache->timeout(flowCount, cur_time);
 
     if ( file_cache )
-        file_cache->timeout(flowCount, cur_time);
+        retired += file_cache->timeout(flowCount, cur_time);
 
     Active::resume();
+    return retired;
 }
 
+// pruning is spread across packets and starts with the cheapest state;
+// flows are pruned through the reclaimer registered by stream
 void FlowControl::preemptive_cleanup()
 {
-    DebugFormat(DEBUG_FLOW, "doing preemptive cleanup for packet of type %u",
-            (unsigned) last_pkt_type);
-
-    // FIXIT-H is there a possibility of this looping forever?
-    while ( memory::MemoryCap::over_threshold() )
-    {
-        if ( !prune_one(PruneReason::PREEMPTIVE, true) )
-            break;
-    }
+    memory::reclaim();
 }
 
 //-------------------------------------------------------------------------
@@ -449,6 +505,75 @@ static void init_roles(Packet* p, Flow* flow)
     }
 }
 
+// a flow may only leave inspection early if nothing may depend on later
+// data: an event was logged, flowbits are set, or files are in progress.
+// the flow is checked again on each packet until it can be cut.
+static bool can_bypass(Flow* flow)
+{
+    if ( flow->get_session_flags() & SSNFLAG_ALERTED )
+        return false;
+
+    if ( flow->bitop and !flow->bitop->empty() )
+        return false;
+
+    if ( flow->get_application_data(FileFlows::flow_id) )
+        return false;
+
+    return true;
+}
+
+// once either direction has used up the binder depth, or the degrade
+// depth under latency pressure, the flow stops detection and reassembly
+static bool check_depth(Flow* flow, unsigned dir, uint32_t depth)
+{
+    if ( flow->inspect_bytes[dir] <= depth )
+        return false;
+
+    flow->set_session_flags(SSNFLAG_DEPTH_BYPASS);
+    ++depth_bypass_count;
+    return true;
+}
+
+// elephants are checked by volume and by average rate since the first
+// packet; the rate needs at least a second of history so a burst at
+// setup doesn't count.  stopping inspection of both directions makes
+// the verdict whitelist so the daq handles the rest of the flow.
+static bool check_elephant(Flow* flow, Packet* p, const NetworkPolicy* np)
+{
+    uint64_t bytes = flow->inspect_bytes[0] + flow->inspect_bytes[1];
+    bool big = np->elephant_bytes and bytes > np->elephant_bytes;
+
+    if ( !big and np->elephant_rate )
+    {
+        long secs = p->pkth->ts.tv_sec - flow->first_data_seen;
+        big = secs > 0 and bytes / secs > np->elephant_rate;
+    }
+    if ( !big )
+        return false;
+
+    flow->set_session_flags(SSNFLAG_ELEPHANT);
+    ++elephant_count;
+    elephant_bytes += bytes;
+    return true;
+}
+
+static void check_bypass(Flow* flow, Packet* p, const NetworkPolicy* np, uint32_t depth)
+{
+    unsigned dir = p->is_from_server() ? 1 : 0;
+    flow->inspect_bytes[dir] += p->dsize;
+
+    if ( !can_bypass(flow) )
+        return;
+
+    bool cut = depth and check_depth(flow, dir, depth);
+
+    if ( !cut and (np->elephant_bytes or np->elephant_rate) )
+        cut = check_elephant(flow, p, np);
+
+    if ( cut )
+        stream.stop_inspection(flow, p, SSN_DIR_BOTH, -1, 0);
+}
+
 unsigned FlowControl::process(Flow* flow, Packet* p)
 {
     unsigned news = 0;
@@ -474,6 +599,7 @@ unsigned FlowControl::process(Flow* flow, Packet* p)
             (!flow->ssn_client || !flow->session->setup(p))) )
             flow->set_state(Flow::ALLOW);
 
+        flow->first_data_seen = p->pkth->ts.tv_sec;
         ++news;
     }
 
@@ -489,9 +615,28 @@ unsigned FlowControl::process(Flow* flow, Packet* p)
         assert(flow->ssn_client);
         assert(flow->ssn_server);
         flow->session->process(p);
+
+        if ( flow->flow_state == Flow::INSPECT )
+        {
+            const NetworkPolicy* np = get_network_policy();
+            uint32_t depth = flow->inspect_depth;
+            unsigned cap = Degrade::depth();
+
+            if ( cap and (!depth or cap < depth) )
+                depth = cap;
+
+            if ( depth or np->elephant_bytes or np->elephant_rate )
+                check_bypass(flow, p, np, depth);
+        }
         break;
 
     case Flow::ALLOW:
+        if ( flow->depth_bypassed() )
+            depth_bypass_bytes += p->dsize;
+
+        else if ( flow->is_elephant() )
+            elephant_leaks += p->dsize;
+
         if ( news )
             stream.stop_inspection(flow, p, SSN_DIR_BOTH, -1, 0);
         else
@@ -523,6 +668,21 @@ unsigned FlowControl::process(Flow* flow, Packet* p)
     return news;
 }
 
+//-------------------------------------------------------------------------
+// pool
+//-------------------------------------------------------------------------
+
+void FlowControl::init_pool(unsigned max_flows)
+{
+    assert(!pool);
+    pool = new FlowPool(max_flows);
+}
+
+unsigned FlowControl::get_allocated_flows()
+{
+    return pool ? pool->get_allocated() : 0;
+}
+
 //-------------------------------------------------------------------------
 // ip
 //-------------------------------------------------------------------------
@@ -530,15 +690,10 @@ unsigned FlowControl::process(Flow* flow, Packet* p)
 void FlowControl::init_ip(
     const FlowConfig& fc, InspectSsnFunc get_ssn)
 {
-    if ( !fc.max_sessions || !get_ssn )
+    if ( !fc.max_sessions || !get_ssn || !pool )
         return;
 
-    ip_cache = new FlowCache(fc);
-    ip_mem = (Flow*)snort_calloc(fc.max_sessions, sizeof(Flow));
-
-    for ( unsigned i = 0; i < fc.max_sessions; ++i )
-        ip_cache->push(ip_mem + i);
-
+    ip_cache = new FlowCache(fc, pool, "flow_cache_ip");
     get_ip = get_ssn;
 }
 
@@ -573,15 +728,10 @@ void FlowControl::process_ip(Packet* p)
 void FlowControl::init_icmp(
     const FlowConfig& fc, InspectSsnFunc get_ssn)
 {
-    if ( !fc.max_sessions || !get_ssn )
+    if ( !fc.max_sessions || !get_ssn || !pool )
         return;
 
-    icmp_cache = new FlowCache(fc);
-    icmp_mem = (Flow*)snort_calloc(fc.max_sessions, sizeof(Flow));
-
-    for ( unsigned i = 0; i < fc.max_sessions; ++i )
-        icmp_cache->push(icmp_mem + i);
-
+    icmp_cache = new FlowCache(fc, pool, "flow_cache_icmp");
     get_icmp = get_ssn;
 }
 
@@ -619,15 +769,10 @@ void FlowControl::process_icmp(Packet* p)
 void FlowControl::init_tcp(
     const FlowConfig& fc, InspectSsnFunc get_ssn)
 {
-    if ( !fc.max_sessions || !get_ssn )
+    if ( !fc.max_sessions || !get_ssn || !pool )
         return;
 
-    tcp_cache = new FlowCache(fc);
-    tcp_mem = (Flow*)snort_calloc(fc.max_sessions, sizeof(Flow));
-
-    for ( unsigned i = 0; i < fc.max_sessions; ++i )
-        tcp_cache->push(tcp_mem + i);
-
+    tcp_cache = new FlowCache(fc, pool, "flow_cache_tcp");
     get_tcp = get_ssn;
 }
 
@@ -662,23 +807,32 @@ void FlowControl::process_tcp(Packet* p)
 void FlowControl::init_udp(
     const FlowConfig& fc, InspectSsnFunc get_ssn)
 {
-    if ( !fc.max_sessions || !get_ssn )
+    if ( !fc.max_sessions || !get_ssn || !pool )
         return;
 
-    udp_cache = new FlowCache(fc);
-    udp_mem = (Flow*)snort_calloc(fc.max_sessions, sizeof(Flow));
-
-    for ( unsigned i = 0; i < fc.max_sessions; ++i )
-        udp_cache->push(udp_mem + i);
-
+    udp_cache = new FlowCache(fc, pool, "flow_cache_udp");
     get_udp = get_ssn;
 }
 
+void FlowControl::set_stateless_udp(const PortBitSet* ports)
+{
+    udp_stateless = ports;
+}
+
 void FlowControl::process_udp(Packet* p)
 {
     if ( !udp_cache )
         return;
 
+    // one shot exchanges like dns and ntp are inspected without a flow
+    // so they don't churn the cache
+    if ( udp_stateless and
+        (udp_stateless->test(p->ptrs.sp) or udp_stateless->test(p->ptrs.dp)) )
+    {
+        ++udp_stateless_count;
+        return;
+    }
+
     FlowKey key;
     set_key(&key, p);
     Flow* flow = udp_cache->get(&key);
@@ -705,15 +859,10 @@ void FlowControl::process_udp(Packet* p)
 void FlowControl::init_user(
     const FlowConfig& fc, InspectSsnFunc get_ssn)
 {
-    if ( !fc.max_sessions || !get_ssn )
+    if ( !fc.max_sessions || !get_ssn || !pool )
         return;
 
-    user_cache = new FlowCache(fc);
-    user_mem = (Flow*)snort_calloc(fc.max_sessions, sizeof(Flow));
-
-    for ( unsigned i = 0; i < fc.max_sessions; ++i )
-        user_cache->push(user_mem + i);
-
+    user_cache = new FlowCache(fc, pool, "flow_cache_user");
     get_user = get_ssn;
 }
 
@@ -748,15 +897,10 @@ void FlowControl::process_user(Packet* p)
 void FlowControl::init_file(
     const FlowConfig& fc, InspectSsnFunc get_ssn)
 {
-    if ( !fc.max_sessions || !get_ssn )
+    if ( !fc.max_sessions || !get_ssn || !pool )
         return;
 
-    file_cache = new FlowCache(fc);
-    file_mem = (Flow*)snort_calloc(fc.max_sessions, sizeof(Flow));
-
-    for ( unsigned i = 0; i < fc.max_sessions; ++i )
-        file_cache->push(file_mem + i);
-
+    file_cache = new FlowCache(fc, pool, "flow_cache_file");
     get_file = get_ssn;
 }
 
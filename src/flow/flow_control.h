@@ -29,12 +29,14 @@
 
 #include "flow/flow_config.h"
 #include "framework/counts.h"
+#include "framework/bits.h"
 #include "framework/decode_data.h"
 #include "framework/inspector.h"
 
 class Flow;
 class FlowData;
 class FlowCache;
+class FlowPool;
 struct FlowKey;
 struct Packet;
 struct sfip_t;
@@ -56,12 +58,15 @@ public:
     void process_file(Packet*);
 
     Flow* find_flow(const FlowKey*);
+    void find_flows(const FlowKey* const*, unsigned n, Flow**);
     Flow* new_flow(const FlowKey*);
 
+    void init_pool(unsigned max_flows);
     void init_ip(const FlowConfig&, InspectSsnFunc);
     void init_icmp(const FlowConfig&, InspectSsnFunc);
     void init_tcp(const FlowConfig&, InspectSsnFunc);
     void init_udp(const FlowConfig&, InspectSsnFunc);
+    void set_stateless_udp(const PortBitSet*);
     void init_user(const FlowConfig&, InspectSsnFunc);
     void init_file(const FlowConfig&, InspectSsnFunc);
     void init_exp(uint32_t max);
@@ -71,7 +76,7 @@ public:
     void purge_flows(PktType);
     void prune_flows(PktType, const Packet*);
     bool prune_one(PruneReason, bool do_cleanup);
-    void timeout_flows(uint32_t flowCount, time_t cur_time);
+    unsigned timeout_flows(uint32_t flowCount, time_t cur_time);
 
     char expected_flow(Flow*, Packet*);
     bool is_expected(Packet*);
@@ -87,8 +92,17 @@ public:
         PktType, int16_t appId, FlowData*);
 
     uint32_t max_flows(PktType);
+    unsigned get_allocated_flows();
 
     PegCount get_flows(PktType);
+    PegCount get_stateless_udp();
+    PegCount get_expect_probes();
+    PegCount get_expect_misses();
+    PegCount get_depth_bypasses();
+    PegCount get_depth_bypassed_bytes();
+    PegCount get_elephant_offloads();
+    PegCount get_elephant_offloaded_bytes();
+    PegCount get_elephant_leaked_bytes();
     PegCount get_total_prunes(PktType) const;
     PegCount get_prunes(PktType, PruneReason) const;
 
@@ -111,13 +125,8 @@ private:
     FlowCache* user_cache;
     FlowCache* file_cache;
 
-    // preallocated arrays
-    Flow* ip_mem;
-    Flow* icmp_mem;
-    Flow* tcp_mem;
-    Flow* udp_mem;
-    Flow* user_mem;
-    Flow* file_mem;
+    // shared by all caches
+    FlowPool* pool;
 
     InspectSsnFunc get_ip;
     InspectSsnFunc get_icmp;
@@ -126,6 +135,9 @@ private:
     InspectSsnFunc get_user;
     InspectSsnFunc get_file;
 
+    // udp packets to or from these ports get no flow
+    const PortBitSet* udp_stateless;
+
     class ExpectCache* exp_cache;
     PktType last_pkt_type;
 };
@@ -24,6 +24,11 @@
 #include "config.h"
 #endif
 
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define FLOW_KEY_CRC
+#endif
+
 #include "main/snort_config.h"
 #include "utils/util.h"
 #include "sfip/sf_ip.h"
@@ -289,6 +294,40 @@ uint32_t FlowKey::hash(SFHASHFCN*, unsigned char* d, int)
     return c;
 }
 
+#ifdef FLOW_KEY_CRC
+// the key is 6 words; two chains overlap the instruction latency and the
+// multiply spreads the result into the high bits that zhash uses for tags
+__attribute__((target("sse4.2")))
+static uint32_t hash_crc32c(SFHASHFCN*, unsigned char* d, int)
+{
+    const uint64_t* w = (const uint64_t*)d;
+
+    uint64_t a = _mm_crc32_u64(0, w[0]);
+    uint64_t b = _mm_crc32_u64(0x9E3779B9, w[1]);
+
+    a = _mm_crc32_u64(a, w[2]);
+    b = _mm_crc32_u64(b, w[3]);
+
+    a = _mm_crc32_u64(a, w[4]);
+    b = _mm_crc32_u64(b, w[5]);
+
+    return ((a << 32 | b) * 0x9E3779B97F4A7C15ull) >> 32;
+}
+#endif
+
+FlowKey::HashFunc FlowKey::get_hash(bool crc)
+{
+#ifdef FLOW_KEY_CRC
+    __builtin_cpu_init();
+
+    if ( crc and __builtin_cpu_supports("sse4.2") )
+        return hash_crc32c;
+#else
+    UNUSED(crc);
+#endif
+    return hash;
+}
+
 int FlowKey::compare(const void* s1, const void* s2, size_t)
 {
 #ifndef SPARCV9 /* ie, everything else, use 64bit comparisons */
@@ -385,3 +424,63 @@ int FlowKey::compare(const void* s1, const void* s2, size_t)
     return 0;
 }
 
+
+//-------------------------------------------------------------------------
+// compact ip4 key foo
+//-------------------------------------------------------------------------
+
+uint32_t FlowKey4::hash(SFHASHFCN*, unsigned char* d, int)
+{
+    uint32_t a,b,c;
+
+    a = *(uint32_t*)d;         /* IPv4 lo */
+    b = *(uint32_t*)(d+4);     /* IPv4 hi */
+    c = *(uint32_t*)(d+8);     /* port lo & port hi */
+
+    mix(a,b,c);
+
+    a += *(uint32_t*)(d+12);   /* vlan tag, packet type, & version */
+    b += *(uint32_t*)(d+16);   /* mpls label */
+    c += *(uint32_t*)(d+20);   /* address space id and 16bits of zero'd pad */
+
+    finalize(a,b,c);
+
+    return c;
+}
+
+#ifdef FLOW_KEY_CRC
+__attribute__((target("sse4.2")))
+static uint32_t hash4_crc32c(SFHASHFCN*, unsigned char* d, int)
+{
+    const uint64_t* w = (const uint64_t*)d;
+
+    uint64_t a = _mm_crc32_u64(0, w[0]);
+    uint64_t b = _mm_crc32_u64(0x9E3779B9, w[1]);
+
+    a = _mm_crc32_u64(a, w[2]);
+
+    return ((a << 32 | b) * 0x9E3779B97F4A7C15ull) >> 32;
+}
+#endif
+
+FlowKey::HashFunc FlowKey4::get_hash(bool crc)
+{
+#ifdef FLOW_KEY_CRC
+    __builtin_cpu_init();
+
+    if ( crc and __builtin_cpu_supports("sse4.2") )
+        return hash4_crc32c;
+#else
+    UNUSED(crc);
+#endif
+    return hash;
+}
+
+int FlowKey4::compare(const void* s1, const void* s2, size_t)
+{
+    const uint32_t* a = (const uint32_t*)s1;
+    const uint32_t* b = (const uint32_t*)s2;
+
+    return ((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) |
+        (a[3] ^ b[3]) | (a[4] ^ b[4]) | (a[5] ^ b[5])) != 0;
+}
@@ -23,6 +23,9 @@
 // FlowKey is used to store Flows in the caches.  the data members are
 // sequenced to avoid void space.
 
+#include <cstddef>
+#include <cstring>
+
 #include "main/snort_types.h"
 #include "hash/sfhashfcn.h"
 #include "framework/decode_data.h"
@@ -57,10 +60,18 @@ struct FlowKey
     void init_vlan(uint16_t);
     void init_address_space(uint16_t);
 
+    bool is_ip4() const
+    { return version == 4; }
+
     // XXX If this data structure changes size, compare must be updated!
     static uint32_t hash(SFHASHFCN* p, unsigned char* d, int);
     static int compare(const void* s1, const void* s2, size_t);
 
+    typedef uint32_t (* HashFunc)(SFHASHFCN*, unsigned char*, int);
+
+    // crc selects a crc32c hash when the cpu has one; otherwise hash()
+    static HashFunc get_hash(bool crc);
+
 private:
     void init4(
         IpProtocol,
@@ -75,5 +86,51 @@ private:
         uint32_t mplsId, bool order = true);
 };
 
+// FlowKey4 is the compact form of an ip4 FlowKey.  ip4 addresses are in
+// the first word of the FlowKey addresses and the rest are zero so they
+// are dropped; the remaining fields have the same layout.  this is also
+// the ip4 key format of HA messages.
+
+struct FlowKey4
+{
+    uint32_t   ip_l;
+    uint32_t   ip_h;
+    uint16_t   port_l;
+    uint16_t   port_h;
+    uint16_t   vlan_tag;
+    PktType    pkt_type;
+    uint8_t    version;
+    uint32_t   mplsLabel;
+    uint16_t   addressSpaceId;
+    uint16_t   addressSpaceIdPad1;
+
+    void pack(const FlowKey& k)
+    {
+        ip_l = k.ip_l[0];
+        ip_h = k.ip_h[0];
+        memcpy(&port_l, &k.port_l, sizeof(*this) - offsetof(FlowKey4, port_l));
+    }
+
+    void unpack(FlowKey& k) const
+    {
+        k.ip_l[0] = ip_l;
+        k.ip_l[1] = k.ip_l[2] = k.ip_l[3] = 0;
+        k.ip_h[0] = ip_h;
+        k.ip_h[1] = k.ip_h[2] = k.ip_h[3] = 0;
+        memcpy(&k.port_l, &port_l, sizeof(*this) - offsetof(FlowKey4, port_l));
+    }
+
+    static uint32_t hash(SFHASHFCN* p, unsigned char* d, int);
+    static int compare(const void* s1, const void* s2, size_t);
+
+    static FlowKey::HashFunc get_hash(bool crc);
+};
+
+static_assert(sizeof(FlowKey) == 48, "FlowKey::compare and hash assume this");
+static_assert(sizeof(FlowKey4) == 24, "FlowKey4::compare and hash assume this");
+static_assert(
+    sizeof(FlowKey) - offsetof(FlowKey, port_l) == sizeof(FlowKey4) - offsetof(FlowKey4, port_l),
+    "FlowKey4 trails FlowKey");
+
 #endif
 
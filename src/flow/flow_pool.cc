@@ -0,0 +1,76 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#include "flow/flow_pool.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "flow/flow.h"
+#include "utils/util.h"
+
+// big enough to amortize the allocation, small enough that an idle
+// protocol doesn't commit much
+#define FLOW_SLAB_SIZE 1024
+#define FLOW_LINE_SIZE 64
+
+// each flow starts on a cache line so the hot header never straddles one
+static const size_t flow_stride =
+    (sizeof(Flow) + FLOW_LINE_SIZE - 1) & ~(size_t)(FLOW_LINE_SIZE - 1);
+
+FlowPool::FlowPool(unsigned max_flows)
+{
+    next = nullptr;
+    left = 0;
+    allocated = 0;
+    max = max_flows;
+}
+
+FlowPool::~FlowPool()
+{
+    for ( auto* slab : slabs )
+        snort_free(slab);
+}
+
+Flow* FlowPool::get()
+{
+    if ( allocated >= max )
+        return nullptr;
+
+    if ( !left )
+    {
+        left = max - allocated;
+
+        if ( left > FLOW_SLAB_SIZE )
+            left = FLOW_SLAB_SIZE;
+
+        uint8_t* slab = (uint8_t*)snort_calloc(left * flow_stride + FLOW_LINE_SIZE - 1);
+        slabs.push_back(slab);
+
+        uintptr_t line = ((uintptr_t)slab + FLOW_LINE_SIZE - 1);
+        next = (uint8_t*)(line & ~(uintptr_t)(FLOW_LINE_SIZE - 1));
+    }
+
+    Flow* flow = (Flow*)next;
+    next += flow_stride;
+
+    ++allocated;
+    --left;
+    return flow;
+}
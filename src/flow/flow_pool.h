@@ -0,0 +1,57 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+#ifndef FLOW_POOL_H
+#define FLOW_POOL_H
+
+// there is one FlowPool per packet thread.  the protocol caches draw flows
+// from it as they need them, each up to its own max_sessions, so memory is
+// only committed for the flows actually used.  flows are allocated in
+// slabs and are not returned until the pool is deleted; a flow released
+// by a cache goes back on that cache's free list.
+
+#include <cstdint>
+#include <vector>
+
+class Flow;
+
+class FlowPool
+{
+public:
+    FlowPool(unsigned max_flows);
+    ~FlowPool();
+
+    // returns nullptr when max_flows have been allocated
+    Flow* get();
+
+    unsigned get_allocated() const
+    { return allocated; }
+
+    unsigned get_max() const
+    { return max; }
+
+private:
+    std::vector<uint8_t*> slabs;
+    uint8_t* next;
+    unsigned left;
+    unsigned allocated;
+    unsigned max;
+};
+
+#endif
+
@@ -34,15 +34,21 @@
 #include "stream/stream_api.h"
 #include "time/packet_time.h"
 
-static const uint8_t HA_MESSAGE_VERSION = 3;
+static const uint8_t HA_MESSAGE_VERSION = 5;
 
 // define message size and content constants.
 static const uint8_t KEY_SIZE_IP6 = sizeof(FlowKey);
 // ip4 key is smaller by 2*(ip6-addr-size - ip4-addr-size) or 2*(16 - 4) = 24
-static const uint8_t KEY_SIZE_IP4 = sizeof(FlowKey)-24;
+static const uint8_t KEY_SIZE_IP4 = sizeof(FlowKey4);
 
 static const suseconds_t USEC_PER_SEC = 1000000;
 
+// messages are coalesced into frames of up to this many bytes; a frame
+// is sent once it is full or HA_FRAME_USEC of packet time after its first
+// message, whichever comes first.
+static const uint16_t HA_FRAME_SIZE = 4096;
+static const suseconds_t HA_FRAME_USEC = 1000;
+
 enum
 {
     KEY_TYPE_IP6 = 1,
@@ -65,17 +71,12 @@ uint8_t s_handle_counter = 1; // stream client (index == 0) always exists
 // Entries [1] to [MAX_CLIENTS-1] contain the optional clients
 static THREAD_LOCAL ClientMap* s_client_map;
 
-static inline bool is_ip6_key(const FlowKey* key)
-{
-    return (key->ip_l[0] || key->ip_l[1] || key->ip_l[2] != htonl(0xFFFF) ||
-           key->ip_h[0] || key->ip_h[1] || key->ip_h[2] != htonl(0xFFFF));
-}
-
 FlowHAState::FlowHAState()
 {
     state = INITIAL_STATE;
     state |= (NEW | NEW_SESSION);
     pending = NONE_PENDING;
+    updates_since_full = FULL_REFRESH;
 
     // Set the initial upate time to now+min_session_lifetime
     packet_gettimeofday(&next_update);
@@ -155,6 +156,7 @@ void FlowHAState::reset()
 {
     state = INITIAL_STATE;
     pending = NONE_PENDING;
+    updates_since_full = FULL_REFRESH;
 }
 
 FlowHAClient::FlowHAClient(uint8_t length, bool session_client)
@@ -164,6 +166,7 @@ FlowHAClient::FlowHAClient(uint8_t length, bool session_client)
         return;
 
     header.length = length;
+    header.flags = 0;
 
     if ( session_client )
     {
@@ -211,33 +214,23 @@ static uint8_t write_flow_key(Flow* flow, HAMessage* msg)
 {
     HAMessageHeader* hdr = (HAMessageHeader*)msg->content();
     msg->cursor = (uint8_t*)hdr + sizeof(HAMessageHeader);
-    const FlowKey* key = flow->key;
-    assert(key);
+    assert(flow->key);
 
-    if (is_ip6_key(flow->key) )
+    // keys are sent in the form the cache stores them
+    if ( !flow->key4 )
     {
         hdr->key_type = KEY_TYPE_IP6;
-        memcpy(msg->cursor, key, KEY_SIZE_IP6);
+        memcpy(msg->cursor, flow->key, KEY_SIZE_IP6);
         msg->cursor += KEY_SIZE_IP6;
         return KEY_SIZE_IP6;
     }
-// FIXIT-H - remove the #ifdef COMPRESSED_KEY sections when the ip6/ip4 logic is implemented
-//   and the compressed key is available for use.  Until then all keys are IP6 and larger.
-#ifdef COMPRESSED_KEY
     else
     {
         hdr->key_type = KEY_TYPE_IP4;
-        memcpy(msg->cursor, &key->ip_l[3], sizeof(key->ip_l[3]));
-        msg->cursor += sizeof(key->ip_l[3]);
-        memcpy(msg->cursor, &key->ip_h[3], sizeof(key->ip_h[3]));
-        msg->cursor += sizeof(key->ip_h[3]);
-        memcpy(msg->cursor, ((uint8_t*)key) + 32, KEY_SIZE_IP4 - 8);
-        msg->cursor += KEY_SIZE_IP4 - 8;
-
+        memcpy(msg->cursor, flow->key, KEY_SIZE_IP4);
+        msg->cursor += KEY_SIZE_IP4;
         return KEY_SIZE_IP4;
     }
-#endif
-    return 0;
 }
 
 // Regardless of the message cursor, extract the key and
@@ -254,25 +247,14 @@ static uint8_t read_flow_key(FlowKey* key, HAMessage* msg)
         msg->cursor += KEY_SIZE_IP6;
         return KEY_SIZE_IP6;
     }
-#ifdef COMPRESSED_KEY
     else if ( hdr->key_type == KEY_TYPE_IP4 )
     {
-        /* Lower IPv4 address */
-        memcpy(&key->ip_l[3], msg->cursor, sizeof(key->ip_l[3]));
-        key->ip_l[0] = key->ip_l[1] = 0;
-        key->ip_l[2] = htonl(0xFFFF);
-        msg->cursor += sizeof(key->ip_l[3]);
-        /* Higher IPv4 address */
-        memcpy(&key->ip_h[3], msg->cursor, sizeof(key->ip_h[3]));
-        key->ip_h[0] = key->ip_h[1] = 0;
-        key->ip_h[2] = htonl(0xFFFF);
-        msg->cursor += sizeof(key->ip_h[3]);
-        /* The remainder of the key */
-        memcpy(((uint8_t*)key) + 32, msg->cursor, KEY_SIZE_IP4 - 8);
-        msg->cursor += KEY_SIZE_IP4 - 8;
+        FlowKey4 key4;
+        memcpy(&key4, msg->cursor, KEY_SIZE_IP4);
+        key4.unpack(*key);
+        msg->cursor += KEY_SIZE_IP4;
         return KEY_SIZE_IP4;
     }
-#endif
     else
         return 0;
 }
@@ -280,7 +262,7 @@ static uint8_t read_flow_key(FlowKey* key, HAMessage* msg)
 static inline uint8_t key_size(Flow* flow)
 {
     assert(flow->key);
-    return is_ip6_key(flow->key) ? KEY_SIZE_IP6 : KEY_SIZE_IP4;
+    return flow->key4 ? KEY_SIZE_IP4 : KEY_SIZE_IP6;
 }
 
 static uint16_t calculate_msg_header_length(Flow* flow)
@@ -290,7 +272,10 @@ static uint16_t calculate_msg_header_length(Flow* flow)
 
 // Calculate the UPDATE message content length based on the
 // set of active clients.  The Session client is always present.
-static uint16_t calculate_update_msg_content_length(Flow* flow)
+// Unless a full refresh is due, each client may contribute a delta;
+// its size is returned in delta_sizes (0 for a full update).
+static uint16_t calculate_update_msg_content_length(
+    Flow* flow, bool full, uint8_t* delta_sizes)
 {
     assert(s_client_map);
     assert((*s_client_map)[0]);
@@ -300,8 +285,11 @@ static uint16_t calculate_update_msg_content_length(Flow* flow)
     for (int i=0; i<s_handle_counter; i++)
         if ( (i==SESSION_HA_CLIENT_INDEX) || flow->ha_state->check_pending(1<<(i-1)) )
         {
-            assert((*s_client_map)[i]);
-            length += ((*s_client_map)[i]->get_message_size() + sizeof(HAClientHeader));
+            FlowHAClient* client = (*s_client_map)[i];
+            assert(client);
+            delta_sizes[i] = full ? 0 : client->get_delta_size(flow);
+            length += ((delta_sizes[i] ? delta_sizes[i] : client->get_message_size()) +
+                sizeof(HAClientHeader));
             DebugFormat(DEBUG_HA,
                 "HighAvailability::calculate_update_msg_content_length(): length: %d\n", length);
         }
@@ -320,22 +308,32 @@ static void write_msg_header(Flow* flow, HAEvent event, uint16_t content_length,
     write_flow_key(flow, msg);  // set cursor to just beyond key
 }
 
-static void write_update_msg_client( FlowHAClient* client, Flow* flow, HAMessage* msg)
+static void write_update_msg_client(
+    FlowHAClient* client, Flow* flow, uint8_t delta_size, HAMessage* msg)
 {
     assert(client);
     assert(msg);
 
+    if ( delta_size )
+    {
+        HAClientHeader header = client->header;
+        header.length = delta_size;
+        header.flags |= HAClientHeader::FLAG_DELTA;
+        client->place(msg,(uint8_t*)&header,(uint8_t)sizeof(header));
+        client->produce_delta(flow, msg);
+        return;
+    }
     client->place(msg,(uint8_t*)&(client->header),(uint8_t)sizeof(client->header));
     client->produce(flow, msg);
 }
 
-static void write_update_msg_content(Flow* flow, HAMessage* msg)
+static void write_update_msg_content(Flow* flow, const uint8_t* delta_sizes, HAMessage* msg)
 {
     assert(s_client_map);
 
     for ( int i=0; i<s_handle_counter; i++ )
         if ( (i==SESSION_HA_CLIENT_INDEX) || flow->ha_state->check_pending(1<<(i-1)) )
-            write_update_msg_client((*s_client_map)[i],flow, msg);
+            write_update_msg_client((*s_client_map)[i], flow, delta_sizes[i], msg);
 }
 
 static void consume_receive_delete_message(HAMessage* msg)
@@ -387,7 +385,17 @@ static void consume_receive_update_message(HAMessage* msg)
         // client is always the first segment of the message, the consume()
         // invocation for the session client will create the flow.  This
         // flow can in turn be used by subsequent FlowHAClient's.
-        if ( !(*s_client_map)[header->client]->consume(&flow,&key,msg) )
+        // Deltas only apply to flows we already have; the sender will
+        // follow up with a full refresh.
+        FlowHAClient* client = (*s_client_map)[header->client];
+        bool consumed;
+
+        if ( header->flags & HAClientHeader::FLAG_DELTA )
+            consumed = flow and client->consume_delta(flow, msg);
+        else
+            consumed = client->consume(&flow, &key, msg);
+
+        if ( !consumed )
         {
             ErrorMessage("Consuming HA Update message - error from client consume()\n");
             break;
@@ -395,6 +403,37 @@ static void consume_receive_update_message(HAMessage* msg)
     }
 }
 
+// Return the length of the frame message starting at buf or 0 if it is
+// malformed or truncated.
+static uint16_t frame_msg_length(const uint8_t* buf, uint32_t avail)
+{
+    if ( avail < sizeof(HAMessageHeader) )
+        return 0;
+
+    const HAMessageHeader* hdr = (const HAMessageHeader*)buf;
+    uint32_t len = sizeof(HAMessageHeader) + hdr->total_length;
+
+    if ( hdr->key_type == KEY_TYPE_IP6 )
+        len += KEY_SIZE_IP6;
+    else if ( hdr->key_type == KEY_TYPE_IP4 )
+        len += KEY_SIZE_IP4;
+    else
+        return 0;
+
+    return ( len <= avail ) ? (uint16_t)len : 0;
+}
+
+static bool frame_expired(const struct timeval& deadline)
+{
+    struct timeval pkt_time;
+
+    packet_gettimeofday(&pkt_time);
+
+    return ( ( pkt_time.tv_sec > deadline.tv_sec ) ||
+           ( ( pkt_time.tv_sec == deadline.tv_sec ) &&
+           ( pkt_time.tv_usec > deadline.tv_usec ) ) );
+}
+
 static void consume_receive_message(HAMessage* msg)
 {
     HAMessageHeader* hdr = (HAMessageHeader*)msg->content();
@@ -447,6 +486,9 @@ HighAvailability::HighAvailability(PortBitSet* ports, bool)
                 break;
             }
 
+    if ( sc )
+        frame = new uint8_t[HA_FRAME_SIZE];
+
     s_client_map = new ClientMap;
     for ( int i=0; i<MAX_CLIENTS; i++ )
         (*s_client_map)[i] = nullptr;
@@ -460,9 +502,11 @@ HighAvailability::~HighAvailability()
 
     if ( sc )
     {
+        flush();
         sc->unregister_receive_handler();
     }
 
+    delete[] frame;
     delete s_client_map;
 }
 
@@ -476,12 +520,70 @@ void HighAvailability::receive_handler(SCMessage* sc_msg)
     // SC received messages must have reference back to SideChannel object
     assert(sc_msg->sc);
 
-    HAMessage ha_msg(sc_msg);
-    consume_receive_message(&ha_msg);
+    // a frame holds one or more messages back to back
+    uint8_t* buf = sc_msg->content;
+    uint32_t avail = sc_msg->content_length;
+
+    while ( avail )
+    {
+        uint16_t len = frame_msg_length(buf, avail);
+
+        if ( !len )
+        {
+            ErrorMessage("Consuming HA frame - malformed message\n");
+            break;
+        }
+
+        HAMessage ha_msg(buf, len);
+        consume_receive_message(&ha_msg);
+
+        buf += len;
+        avail -= len;
+    }
 
     sc_msg->sc->discard_message(sc_msg);
 }
 
+// Return space for a len byte message in the current frame, sending the
+// frame first if the message doesn't fit.  Returns nullptr if the message
+// is too big for any frame.
+uint8_t* HighAvailability::reserve(uint16_t len)
+{
+    if ( len > HA_FRAME_SIZE )
+        return nullptr;
+
+    if ( frame_len + len > HA_FRAME_SIZE )
+        flush();
+
+    if ( !frame_len )
+    {
+        packet_gettimeofday(&frame_deadline);
+        frame_deadline.tv_usec += HA_FRAME_USEC;
+        if (frame_deadline.tv_usec >= USEC_PER_SEC)
+        {
+            frame_deadline.tv_usec -= USEC_PER_SEC;
+            frame_deadline.tv_sec++;
+        }
+    }
+
+    uint8_t* buf = frame + frame_len;
+    frame_len += len;
+    return buf;
+}
+
+void HighAvailability::flush()
+{
+    if ( !sc || !frame_len )
+        return;
+
+    SCMessage* sc_msg = sc->alloc_transmit_message((uint32_t)frame_len);
+    assert(sc_msg);
+
+    memcpy(sc_msg->content, frame, frame_len);
+    sc->transmit_message(sc_msg);
+    frame_len = 0;
+}
+
 void HighAvailability::process_update(Flow* flow, const DAQ_PktHdr_t* pkthdr)
 {
     DebugMessage(DEBUG_HA,"HighAvailability::process_update()\n");
@@ -500,21 +602,40 @@ void HighAvailability::process_update(Flow* flow, const DAQ_PktHdr_t* pkthdr)
             flow->ha_state->check_any(FlowHAState::NEW) ) )
         return;
 
+    const bool full = flow->ha_state->full_refresh_due();
+    uint8_t delta_sizes[MAX_CLIENTS];
+
     const uint16_t header_len = calculate_msg_header_length(flow);
-    const uint16_t content_len = calculate_update_msg_content_length(flow);
+    const uint16_t content_len = calculate_update_msg_content_length(flow, full, delta_sizes);
 
-    SCMessage* sc_msg = sc->alloc_transmit_message((uint32_t)(header_len+content_len));
-    assert(sc_msg);
-    HAMessage ha_msg(sc_msg);
+    const uint16_t msg_len = header_len + content_len;
+    SCMessage* sc_msg = nullptr;
+    uint8_t* buf = reserve(msg_len);
+
+    // oversize updates bypass the frame
+    if ( !buf )
+    {
+        sc_msg = sc->alloc_transmit_message((uint32_t)msg_len);
+        assert(sc_msg);
+        buf = sc_msg->content;
+    }
+
+    HAMessage ha_msg(buf, msg_len);
 
     write_msg_header(flow, HA_UPDATE_EVENT, content_len, &ha_msg);
-    write_update_msg_content(flow, &ha_msg);
-    sc->transmit_message(sc_msg);
+    write_update_msg_content(flow, delta_sizes, &ha_msg);
+
+    if ( sc_msg )
+        sc->transmit_message(sc_msg);
+
+    else if ( frame_expired(frame_deadline) )
+        flush();
 
     flow->ha_state->clear(FlowHAState::NEW | FlowHAState::MODIFIED |
         FlowHAState::MAJOR | FlowHAState::CRITICAL);
     flow->ha_state->clear_pending(ALL_CLIENTS);
     flow->ha_state->set_next_update();
+    flow->ha_state->count_update(full);
 }
 
 void HighAvailability::process_deletion(Flow* flow)
@@ -532,14 +653,16 @@ void HighAvailability::process_deletion(Flow* flow)
     if ( !sc )
         return;
 
-    const uint32_t msg_len = calculate_msg_header_length(flow);
-    SCMessage* sc_msg = sc->alloc_transmit_message(msg_len);
-    HAMessage ha_msg(sc_msg);
+    const uint16_t msg_len = calculate_msg_header_length(flow);
+    uint8_t* buf = reserve(msg_len);
+    assert(buf);
+    HAMessage ha_msg(buf, msg_len);
 
     // No content, only header+key
     write_msg_header(flow, HA_DELETE_EVENT, 0, &ha_msg);
 
-    sc->transmit_message(sc_msg);
+    if ( frame_expired(frame_deadline) )
+        flush();
 
     flow->ha_state->add(FlowHAState::DELETED);
 }
@@ -547,7 +670,12 @@ void HighAvailability::process_deletion(Flow* flow)
 void HighAvailability::process_receive()
 {
     if ( sc != nullptr )
+    {
+        if ( frame_len and frame_expired(frame_deadline) )
+            flush();
+
         sc->process(DISPATCH_ALL_RECEIVE);
+    }
 }
 
 // Called by the configuration parsing activity in the main thread.
@@ -615,6 +743,12 @@ void HighAvailabilityManager::process_receive()
         ha->process_receive();
 }
 
+void HighAvailabilityManager::flush()
+{
+    if ( ha != nullptr )
+        ha->flush();
+}
+
 // Called in the packet threads to determine whether or not HA is active
 bool HighAvailabilityManager::active()
 {
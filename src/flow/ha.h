@@ -76,14 +76,22 @@ public:
     void set_next_update();
     void reset();
 
+    // every FULL_REFRESH-th update (and the first) carries full client state
+    bool full_refresh_due()
+    { return updates_since_full >= FULL_REFRESH; }
+    void count_update(bool full)
+    { updates_since_full = full ? 1 : updates_since_full + 1; }
+
 private:
     static const uint8_t INITIAL_STATE = 0x00;
     static const uint16_t NONE_PENDING = 0x0000;
+    static const uint8_t FULL_REFRESH = 8;
 
     static struct timeval min_session_lifetime;
     static struct timeval min_sync_interval;
     uint8_t state;
     uint16_t pending;
+    uint8_t updates_since_full;
     struct timeval next_update;
 };
 
@@ -99,6 +107,8 @@ struct __attribute__((__packed__)) HAClientHeader
 {
     uint8_t client;
     uint8_t length;
+    uint8_t flags;
+    static const uint8_t FLAG_DELTA = 0x01; // content holds only changed fields
 };
 
 // Describe the message being produced or consumed.
@@ -106,17 +116,21 @@ class HAMessage
 {
 public:
     HAMessage(SCMessage* msg)
-    { sc_msg = msg; }
+    { buffer = msg->content; length = (uint16_t)msg->content_length; }
+    // one message within a multi-flow frame
+    HAMessage(uint8_t* buf, uint16_t len)
+    { buffer = buf; length = len; }
     ~HAMessage() { }
 
     uint8_t* content()
-    { return sc_msg->content; }
+    { return buffer; }
     uint16_t content_length()
-    { return sc_msg->content_length; }
+    { return length; }
     uint8_t* cursor;
 
 private:
-    SCMessage* sc_msg;
+    uint8_t* buffer;
+    uint16_t length;
 };
 
 // A FlowHAClient subclass for each producer/consumer of flow HA data
@@ -128,6 +142,13 @@ public:
     virtual bool produce(Flow*, HAMessage*) { return false; }
     virtual bool is_update_required(Flow*) { return false; }
     virtual bool is_delete_required(Flow*) { return false; }
+
+    // Clients that track which of their fields changed since the last
+    // update override these to send just those fields.  get_delta_size()
+    // returns 0 when a full update is required.
+    virtual uint8_t get_delta_size(Flow*) { return 0; }
+    virtual bool produce_delta(Flow*, HAMessage*) { return false; }
+    virtual bool consume_delta(Flow*, HAMessage*) { return false; }
     uint8_t get_message_size() { return header.length; }
     bool fit(HAMessage*, uint8_t);
     bool place(HAMessage*, uint8_t*, uint8_t);
@@ -151,10 +172,18 @@ public:
     void process_update(Flow*, const DAQ_PktHdr_t*);
     void process_deletion(Flow*);
     void process_receive();
+    void flush();
 
 private:
     void receive_handler(SCMessage*);
+    uint8_t* reserve(uint16_t);
     SideChannel* sc = nullptr;
+
+    // update and deletion messages are coalesced into one side channel
+    // frame which is sent when full, when stale, or at end of burst
+    uint8_t* frame = nullptr;
+    uint16_t frame_len = 0;
+    struct timeval frame_deadline = { 0, 0 };
 };
 
 // Top level management of HighAvailability components.
@@ -175,6 +204,8 @@ public:
     static void process_deletion(Flow*);
     // Look for and dispatch receive messages.
     static void process_receive();
+    // Send any coalesced messages now; call at the end of each burst.
+    static void flush();
 
 private:
     HighAvailabilityManager() = delete;
@@ -0,0 +1,64 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// flow_pool_test.cc
+// unit test main
+
+#include "flow/flow_pool.h"
+
+#include <set>
+
+#include "flow/flow.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+TEST_GROUP(flow_pool)
+{
+};
+
+TEST(flow_pool, empty)
+{
+    FlowPool pool(0);
+    CHECK(pool.get() == nullptr);
+    CHECK(pool.get_allocated() == 0);
+}
+
+TEST(flow_pool, cap)
+{
+    const unsigned max = 2500;  // spans partial slabs
+    FlowPool pool(max);
+    std::set<Flow*> flows;
+
+    for ( unsigned i = 0; i < max; ++i )
+    {
+        Flow* flow = pool.get();
+        CHECK(flow != nullptr);
+        CHECK(flow->key == nullptr);
+        flows.insert(flow);
+    }
+    CHECK(flows.size() == max);
+    CHECK(pool.get_allocated() == max);
+    CHECK(pool.get() == nullptr);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
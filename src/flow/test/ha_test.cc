@@ -28,7 +28,7 @@
 #include <CppUTest/CommandLineTestRunner.h>
 #include <CppUTest/TestHarness.h>
 
-#define MSG_SIZE 100
+#define MSG_SIZE 200
 #define TEST_KEY 0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47
 
 class StreamHAClient;
@@ -41,7 +41,7 @@ TEST_KEY
 static const uint8_t s_delete_message[] =
 {
     0x01,
-    0x03,
+    0x05,
     0x00,
     0x00,
     0x01,
@@ -51,16 +51,50 @@ TEST_KEY
 static const uint8_t s_update_stream_message[] =
 {
     0x02,
-    0x03,
+    0x05,
+    13,
     0x00,
+    0x01,
+TEST_KEY,
+    0x00,
+    10,
+    0x00,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9
+};
+
+static const uint8_t s_frame_message[] =
+{
+    0x01,
+    0x05,
+    0x00,
+    0x00,
+    0x01,
+TEST_KEY,
+    0x02,
+    0x05,
+    13,
     0x00,
     0x01,
 TEST_KEY,
     0x00,
     10,
+    0x00,
     0, 1, 2, 3, 4, 5, 6, 7, 8, 9
 };
 
+static const uint8_t s_update_delta_message[] =
+{
+    0x02,
+    0x05,
+    7,
+    0x00,
+    0x01,
+TEST_KEY,
+    0x00,
+    4,
+    0x01,
+    0, 1, 2, 3
+};
 
 static struct timeval s_packet_time = { 0, 0 };
 static uint8_t s_message[MSG_SIZE];
@@ -68,6 +102,8 @@ static SideChannel s_side_channel;
 static SCMessage s_sc_message;
 static SCMessage s_rec_sc_message;
 static bool s_stream_consume_called = false;
+static bool s_stream_consume_delta_called = false;
+static uint8_t s_stream_delta_size = 0;
 static bool s_other_consume_called = false;
 static bool s_get_session_called = false;
 static bool s_delete_session_called = false;
@@ -76,7 +112,9 @@ static bool s_stream_update_required = false;
 static bool s_other_update_required = false;
 static uint8_t* s_message_content = nullptr;
 static uint8_t s_message_length = 0;
+static unsigned s_transmit_count = 0;
 static Flow s_flow;
+static Flow s_other_flow;
 static FlowKey s_flowkey;
 static DAQ_PktHdr_t s_pkthdr;
 static StreamHAClient* s_ha_client;
@@ -100,6 +138,19 @@ public:
             *(msg->cursor)++ = i;
         return true;
     }
+    uint8_t get_delta_size(Flow*) { return s_stream_delta_size; }
+    bool produce_delta(Flow*, HAMessage* msg)
+    {
+        for ( uint8_t i=0; i<s_stream_delta_size; i++ )
+            *(msg->cursor)++ = i;
+        return true;
+    }
+    bool consume_delta(Flow*, HAMessage* msg)
+    {
+        s_stream_consume_delta_called = true;
+        msg->cursor = msg->content() + msg->content_length();
+        return true;
+    }
     uint8_t get_message_size() { return 10; }
     bool is_update_required(Flow*) { return s_stream_update_required; }
     bool fit(HAMessage*,uint8_t) { return true; }
@@ -196,6 +247,7 @@ bool SideChannel::process(int)
 bool SideChannel::transmit_message(SCMessage* msg)
 {
     s_transmit_message_called = true;
+    s_transmit_count++;
     s_message_content = msg->content;
     s_message_length = msg->content_length;
     return true; }
@@ -325,6 +377,7 @@ TEST_GROUP(high_availability_test)
         HighAvailabilityManager::thread_init();
         s_ha_client = new StreamHAClient;
         s_other_ha_client = new OtherHAClient;
+        memcpy((void*)s_flow.key, s_test_key, sizeof(s_test_key));
     }
 
     void teardown()
@@ -356,11 +409,72 @@ TEST(high_availability_test, receive_update_stream_only)
     CHECK(memcmp((const void*)&s_flowkey, (const void*)&s_test_key, sizeof(s_test_key)) == 0);
 }
 
+TEST(high_availability_test, receive_frame)
+{
+    s_delete_session_called = false;
+    s_stream_consume_called = false;
+    s_message_content = (uint8_t*)s_frame_message;
+    s_message_length = sizeof(s_frame_message);
+    HighAvailabilityManager::process_receive();
+    CHECK(s_delete_session_called == true);
+    CHECK(s_stream_consume_called == true);
+}
+
+TEST(high_availability_test, receive_update_delta)
+{
+    s_stream_consume_called = false;
+    s_stream_consume_delta_called = false;
+    s_message_content = (uint8_t*)s_update_delta_message;
+    s_message_length = sizeof(s_update_delta_message);
+    HighAvailabilityManager::process_receive();
+    CHECK(s_stream_consume_called == false);
+    CHECK(s_stream_consume_delta_called == true);
+}
+
+TEST(high_availability_test, transmit_update_delta)
+{
+    s_stream_update_required = true;
+    s_other_update_required = false;
+    s_stream_delta_size = 4;
+    s_flow.ha_state->reset();
+
+    // first update is always full
+    HighAvailabilityManager::process_update(&s_flow, &s_pkthdr);
+    HighAvailabilityManager::flush();
+    CHECK(s_message_length == sizeof(s_update_stream_message));
+
+    HighAvailabilityManager::process_update(&s_flow, &s_pkthdr);
+    HighAvailabilityManager::flush();
+    CHECK(s_message_length == sizeof(s_update_delta_message));
+    CHECK(s_message_content[sizeof(s_update_delta_message) - 5] == HAClientHeader::FLAG_DELTA);
+
+    s_stream_delta_size = 0;
+}
+
 TEST(high_availability_test, transmit_deletion)
 {
     s_transmit_message_called = false;
     HighAvailabilityManager::process_deletion(&s_flow);
+    CHECK(s_transmit_message_called == false);
+    HighAvailabilityManager::flush();
     CHECK(s_transmit_message_called == true);
+    CHECK(s_message_length == sizeof(s_delete_message));
+}
+
+TEST(high_availability_test, transmit_coalesced)
+{
+    memcpy((void*)s_other_flow.key, s_test_key, sizeof(s_test_key));
+    s_other_flow.ha_state->clear(FlowHAState::NEW);
+    s_flow.ha_state->clear(FlowHAState::NEW);
+
+    s_transmit_count = 0;
+    HighAvailabilityManager::process_deletion(&s_flow);
+    HighAvailabilityManager::process_deletion(&s_other_flow);
+    CHECK(s_transmit_count == 0);
+    HighAvailabilityManager::flush();
+    CHECK(s_transmit_count == 1);
+    CHECK(s_message_length == 2 * sizeof(s_delete_message));
+    s_flow.ha_state->clear(FlowHAState::DELETED);
 }
 
 TEST(high_availability_test, transmit_update_no_update)
@@ -369,6 +483,7 @@ TEST(high_availability_test, transmit_update_no_update)
     s_stream_update_required = false;
     s_other_update_required = false;
     HighAvailabilityManager::process_update(&s_flow, &s_pkthdr);
+    HighAvailabilityManager::flush();
     CHECK(s_transmit_message_called == false);
 }
 
@@ -378,6 +493,7 @@ TEST(high_availability_test, transmit_update_stream_only)
     s_stream_update_required = true;
     s_other_update_required = false;
     HighAvailabilityManager::process_update(&s_flow, &s_pkthdr);
+    HighAvailabilityManager::flush();
     CHECK(s_transmit_message_called == true);
 }
 
@@ -389,6 +505,7 @@ TEST(high_availability_test, transmit_update_both_update)
     CHECK(s_other_ha_client->handle == 1);
     s_flow.ha_state->set_pending(s_other_ha_client->handle);
     HighAvailabilityManager::process_update(&s_flow, &s_pkthdr);
+    HighAvailabilityManager::flush();
     CHECK(s_transmit_message_called == true);
 }
 
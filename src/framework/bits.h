@@ -28,5 +28,27 @@ typedef std::bitset<65536> PortBitSet;
 typedef std::bitset<4096> VlanBitSet;
 typedef std::bitset<256> ByteBitSet;
 
+// index of the first set bit at or after the given one, or N if none.
+// libstdc++ can do this a word at a time; otherwise test bit by bit.
+template<size_t N>
+inline size_t bits_find_next(const std::bitset<N>& bs, size_t bit)
+{
+#ifdef __GLIBCXX__
+    return bit ? bs._Find_next(bit - 1) : bs._Find_first();
+#else
+    while ( bit < N and !bs.test(bit) )
+        ++bit;
+    return bit < N ? bit : N;
+#endif
+}
+
+// call f(bit) for each set bit in ascending order
+template<size_t N, typename F>
+inline void bits_for_each(const std::bitset<N>& bs, F f)
+{
+    for ( size_t b = bits_find_next(bs, 0); b < N; b = bits_find_next(bs, b + 1) )
+        f(b);
+}
+
 #endif
 
@@ -20,6 +20,7 @@
 #include "framework/codec.h"
 #include "events/event_queue.h"
 #include "codecs/codec_module.h"
+#include "main/snort_config.h"
 #include "protocols/ipv6.h"
 
 EncState::EncState(const ip::IpApi& api, EncodeFlags f, IpProtocol pr,
@@ -80,8 +81,14 @@ void Codec::codec_event(const CodecData& codec, CodecSid sid)
     SnortEventqAdd(GID_DECODE, sid);
 }
 
+// the option walk only feeds decoder events so it's skipped when no rule
+// could fire.  the header length is checked by the caller so the next
+// layer is in bounds either way, it just isn't failed on bad options.
 bool Codec::CheckIPV6HopOptions(const RawData& raw, CodecData& codec)
 {
+    if ( !snort_conf->ip6_opt_checks )
+        return true;
+
     const ip::IP6Extension* const exthdr =
         reinterpret_cast<const ip::IP6Extension*>(raw.data);
 
@@ -64,6 +64,10 @@ public:
 
     virtual ~Connector() { }
 
+    // alloc_message() and receive_message() lend out connector owned
+    // buffers that are written or read in place and given back with
+    // transmit_message() or discard_message(); connectors should recycle
+    // them rather than allocate for each message
     virtual ConnectorMsgHandle* alloc_message(const uint32_t, const uint8_t**) = 0;
     virtual void discard_message(ConnectorMsgHandle*) = 0;
     virtual bool transmit_message(ConnectorMsgHandle*) = 0;
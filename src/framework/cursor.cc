@@ -40,7 +40,7 @@ void Cursor::reset(Packet* p)
 
     // FIXIT-M should this be converted to get_fp_buf()?
     if ( p->flow and p->flow->gadget and
-        p->flow->gadget->get_buf(buf.IBT_ALT, p, buf) )
+        p->flow->gadget->get_packet_buf(buf.IBT_ALT, p, buf) )
     {
         set("alt_data", buf.data, buf.len);
     }
@@ -18,12 +18,29 @@
 // data_bus.cc author Russ Combs <rucombs@cisco.com>
 
 #include "framework/data_bus.h"
+
+#include <map>
+#include <string>
+
 #include "main/policy.h"
 #include "protocols/packet.h"
 
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
 DataBus& get_data_bus()
 { return get_inspection_policy()->dbus; }
 
+// key ids start at 1 so that 0 is not found
+typedef std::map<std::string, unsigned> DataIds;
+
+static DataIds& get_ids()
+{
+    static DataIds ids { { PACKET_EVENT, PACKET_EVENT_ID } };
+    return ids;
+}
+
 class BufferEvent : public DataEvent
 {
 public:
@@ -55,39 +72,137 @@ DataBus::DataBus() { }
 
 DataBus::~DataBus()
 {
-    for ( auto& p : map )
-        for ( auto* h : p.second )
+    for ( auto& v : lists )
+        for ( auto* h : v )
             delete h;
 }
 
+unsigned DataBus::get_id(const char* key)
+{
+    DataIds& ids = get_ids();
+    auto it = ids.find(key);
+
+    if ( it != ids.end() )
+        return it->second;
+
+    unsigned id = ids.size() + 1;
+    ids[key] = id;
+    return id;
+}
+
+unsigned DataBus::find_id(const char* key)
+{
+    const DataIds& ids = get_ids();
+    auto it = ids.find(key);
+    return it == ids.end() ? 0 : it->second;
+}
+
 // add handler to list of handlers to be notified upon
 // publication of given event
-void DataBus::subscribe(const char* key, DataHandler* h)
+void DataBus::subscribe(unsigned id, DataHandler* h)
 {
-    DataList& v = map[key];
-    v.push_back(h);
+    if ( id >= lists.size() )
+        lists.resize(id + 1);
+
+    lists[id].push_back(h);
 }
 
+void DataBus::subscribe(const char* key, DataHandler* h)
+{ subscribe(get_id(key), h); }
+
 // notify subscribers of event
-void DataBus::publish(const char* key, DataEvent& e, Flow* f)
+void DataBus::publish(unsigned id, DataEvent& e, Flow* f)
 {
-    DataList& v = map[key];
+    if ( id >= lists.size() )
+        return;
 
-    for ( auto* h : v )
+    for ( auto* h : lists[id] )
         h->handle(e, f);
 }
 
-void DataBus::publish(const char* key, const uint8_t* buf, unsigned len, Flow* f)
+// the key is not registered here since this may be a packet thread
+void DataBus::publish(const char* key, DataEvent& e, Flow* f)
+{ publish(find_id(key), e, f); }
+
+void DataBus::publish(unsigned id, const uint8_t* buf, unsigned len, Flow* f)
 {
+    if ( !has_subscribers(id) )
+        return;
+
     BufferEvent e(buf, len);
-    publish(key, e, f);
+    publish(id, e, f);
 }
 
-void DataBus::publish(const char* key, Packet* p, Flow* f)
+void DataBus::publish(unsigned id, Packet* p, Flow* f)
 {
+    if ( !has_subscribers(id) )
+        return;
+
     PacketEvent e(p);
     if ( !f )
         f = p->flow;
-    publish(key, e, f);
+    publish(id, e, f);
 }
 
+void DataBus::publish(const char* key, const uint8_t* buf, unsigned len, Flow* f)
+{ publish(find_id(key), buf, len, f); }
+
+void DataBus::publish(const char* key, Packet* p, Flow* f)
+{ publish(find_id(key), p, f); }
+
+#ifdef UNIT_TEST
+
+class CountHandler : public DataHandler
+{
+public:
+    CountHandler(unsigned& n) : count(n) { }
+
+    void handle(DataEvent&, Flow*) override
+    { ++count; }
+
+    unsigned& count;
+};
+
+TEST_CASE("data bus ids", "[DataBus]")
+{
+    CHECK(DataBus::find_id(PACKET_EVENT) == PACKET_EVENT_ID);
+    CHECK(DataBus::find_id("data_bus.test") == 0);
+
+    unsigned id = DataBus::get_id("data_bus.test");
+    CHECK(id > PACKET_EVENT_ID);
+    CHECK(DataBus::get_id("data_bus.test") == id);
+    CHECK(DataBus::find_id("data_bus.test") == id);
+}
+
+TEST_CASE("data bus publish", "[DataBus]")
+{
+    unsigned pkts = 0, bufs = 0;
+    unsigned id = DataBus::get_id("data_bus.buffer");
+
+    DataBus bus;
+    CHECK(!bus.has_subscribers(PACKET_EVENT_ID));
+    CHECK(!bus.has_subscribers(id));
+
+    bus.subscribe(PACKET_EVENT, new CountHandler(pkts));
+    bus.subscribe(id, new CountHandler(bufs));
+    bus.subscribe("data_bus.buffer", new CountHandler(bufs));
+
+    CHECK(bus.has_subscribers(PACKET_EVENT_ID));
+    CHECK(bus.has_subscribers(id));
+
+    bus.publish(id, (const uint8_t*)"x", 1);
+    CHECK(bufs == 2);
+    CHECK(pkts == 0);
+
+    bus.publish("data_bus.buffer", (const uint8_t*)"x", 1);
+    CHECK(bufs == 4);
+
+    // unknown keys and ids are ignored
+    bus.publish("data_bus.none", (const uint8_t*)"x", 1);
+    bus.publish(id + 100, (const uint8_t*)"x", 1);
+    CHECK(bufs == 4);
+    CHECK(pkts == 0);
+}
+
+#endif
+
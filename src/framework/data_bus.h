@@ -27,13 +27,11 @@
 // at arbitrary points, eg when service is identified, or when a URI is
 // available, or when a flow clears.
 
-#include <map>
-#include <string>
 #include <vector>
 
-// FIXIT-P evaluate perf; focus is on correctness
+// handlers are kept by event id so publishing is an index into the list
 typedef std::vector<class DataHandler*> DataList;
-typedef std::map<std::string, DataList> DataMap;
+typedef std::vector<DataList> DataLists;
 
 #include "main/snort_types.h"
 
@@ -75,15 +73,32 @@ public:
     DataBus();
     ~DataBus();
 
+    // event keys are registered as ids on the main thread, eg when
+    // configuring; ids are the same for all buses
+    static unsigned get_id(const char* key);
+
+    // returns 0 for a key that was never registered
+    static unsigned find_id(const char* key);
+
     void subscribe(const char* key, DataHandler*);
+    void subscribe(unsigned id, DataHandler*);
+
+    // producers may skip building events nobody wants
+    bool has_subscribers(unsigned id) const
+    { return id < lists.size() and !lists[id].empty(); }
+
+    void publish(unsigned id, DataEvent&, Flow* = nullptr);
     void publish(const char* key, DataEvent&, Flow* = nullptr);
 
     // convenience methods
+    void publish(unsigned id, const uint8_t*, unsigned, Flow* = nullptr);
+    void publish(unsigned id, Packet*, Flow* = nullptr);
+
     void publish(const char* key, const uint8_t*, unsigned, Flow* = nullptr);
     void publish(const char* key, Packet*, Flow* = nullptr);
 
 private:
-    DataMap map;
+    DataLists lists;
 };
 
 // FIXIT-L this should be in snort_confg.h or similar but that
@@ -92,6 +107,7 @@ SO_PUBLIC DataBus& get_data_bus();
 
 // common data events
 #define PACKET_EVENT "detection.packet"
+#define PACKET_EVENT_ID 1  // always the first id
 
 #endif
 
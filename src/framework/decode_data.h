@@ -82,6 +82,7 @@ enum DecodeFlags : std::uint16_t
     DECODE_SOF =            0x0200,  // user - start of flow
     DECODE_EOF =            0x0400,  // user - end of flow
     DECODE_GTP =            0x0800,  // gtp encap
+    DECODE_MAPPED =         0x1000,  // user - data stays valid for the flow
 };
 
 // FIXIT-L make this an enum!!
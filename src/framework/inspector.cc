@@ -78,6 +78,43 @@ unsigned Inspector::get_buf_id(const char* key)
     return p[id] ? id+1 : 0;
 }
 
+// the last lookup of each well known buffer; owner and packet are null
+// when clear
+struct PacketBuf
+{
+    const Inspector* owner;
+    const Packet* pkt;
+    InspectionBuffer buf;
+    bool found;
+};
+
+static THREAD_LOCAL PacketBuf s_packet_bufs[InspectionBuffer::IBT_MAX];
+
+bool Inspector::get_packet_buf(InspectionBuffer::Type ibt, Packet* p, InspectionBuffer& b)
+{
+    if ( !cacheable(ibt) )
+        return get_buf(ibt, p, b);
+
+    PacketBuf& pb = s_packet_bufs[ibt];
+
+    if ( pb.owner != this or pb.pkt != p )
+    {
+        pb.found = get_buf(ibt, p, pb.buf);
+        pb.owner = this;
+        pb.pkt = p;
+    }
+
+    if ( pb.found )
+        b = pb.buf;
+
+    return pb.found;
+}
+
+void Inspector::clear_packet_bufs()
+{
+    memset(s_packet_bufs, 0, sizeof(s_packet_bufs));
+}
+
 bool Inspector::get_buf(const char* key, Packet* p, InspectionBuffer& b)
 {
     unsigned id = get_buf_id(key);
@@ -34,7 +34,7 @@ struct SnortConfig;
 typedef int16_t ServiceId;
 
 // this is the current version of the api
-#define INSAPI_VERSION ((BASE_API_VERSION << 16) | 0)
+#define INSAPI_VERSION ((BASE_API_VERSION << 16) | 1)
 
 struct InspectionBuffer
 {
@@ -64,6 +64,12 @@ public:
     virtual bool configure(SnortConfig*) { return true; }
     virtual void show(SnortConfig*) { }
 
+    // true if, on reload, the new config may keep using this instance when
+    // the module settings are unchanged.  a shared instance is not
+    // constructed or configured again so it must not depend on anything
+    // outside its own config or keep pointers into the old SnortConfig.
+    virtual bool can_share() { return false; }
+
     // packet thread functions
     // tinit, tterm called on default policy instance only
     virtual void tinit() { }   // allocate configurable thread local
@@ -111,6 +117,16 @@ public:
     virtual bool get_fp_buf(InspectionBuffer::Type ibt, Packet* p, InspectionBuffer& bf)
     { return get_buf(ibt, p, bf); }
 
+    // true if get_buf(ibt) returns the same buffer from eval() until
+    // clear() so that it may be fetched just once per packet
+    virtual bool cacheable(InspectionBuffer::Type)
+    { return false; }
+
+    // well known buffers for detection; cacheable ones come from a per
+    // packet cache that is cleared when the packet is done
+    bool get_packet_buf(InspectionBuffer::Type, Packet*, InspectionBuffer&);
+    static void clear_packet_bufs();
+
     // IT_SERVICE only
     virtual class StreamSplitter* get_splitter(bool to_server);
 
@@ -66,6 +66,83 @@ int Mpse::search_all(
     return _search(T, n, match, context, current_state);
 }
 
+int Mpse::search_batch(
+    const SearchItem* items, unsigned count, MpseMatch match)
+{
+    Profile profile(mpsePerfStats);
+
+    int ret = _search_batch(items, count, match);
+
+    if ( inc_global_counter )
+    {
+        for ( unsigned i = 0; i < count; ++i )
+            s_bcnt += items[i].len;
+    }
+    return ret;
+}
+
+int Mpse::_search_batch(
+    const SearchItem* items, unsigned count, MpseMatch match)
+{
+    int ret = 0;
+
+    for ( unsigned i = 0; i < count; ++i )
+    {
+        int start_state = 0;
+        ret += _search(items[i].buf, items[i].len, match, items[i].context, &start_state);
+    }
+    return ret;
+}
+
+void Mpse::submit(SearchJob& job)
+{
+    Profile profile(mpsePerfStats);
+
+    job.engine_data = nullptr;
+    _submit(job);
+
+    if ( inc_global_counter )
+    {
+        for ( unsigned i = 0; i < job.count; ++i )
+            s_bcnt += job.items[i].len;
+    }
+}
+
+bool Mpse::poll(SearchJob& job, bool wait)
+{
+    Profile profile(mpsePerfStats);
+    return _poll(job, wait);
+}
+
+void Mpse::_submit(SearchJob&)
+{ }
+
+bool Mpse::_poll(SearchJob& job, bool)
+{
+    _search_batch(job.items, job.count, job.match);
+    return true;
+}
+
+int Mpse::search_stream(
+    Flow* flow, bool c2s, const uint8_t* T, int n, MpseMatch match, void* context)
+{
+    Profile profile(mpsePerfStats);
+
+    int ret = _search_stream(flow, c2s, T, n, match, context);
+
+    if ( inc_global_counter )
+        s_bcnt += n;
+
+    return ret;
+}
+
+int Mpse::_search_stream(
+    Flow*, bool, const uint8_t* T, int n, MpseMatch match, void* context)
+{
+    int start_state = 0;
+    return _search(T, n, match, context, &start_state);
+}
+
 uint64_t Mpse::get_pattern_byte_count()
 {
     return s_bcnt;
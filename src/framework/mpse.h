@@ -41,6 +41,7 @@
 struct SnortConfig;
 struct MpseApi;
 struct ProfileStats;
+class Flow;
 
 class SO_PUBLIC Mpse
 {
@@ -67,12 +68,59 @@ public:
 
     virtual int prep_patterns(SnortConfig*) = 0;
 
+    // parallel compilation - engines that return true from can_build_async()
+    // split prep_patterns() into build_fsm(), which must not touch shared
+    // state and may run on any thread, and build_trees(), which is always
+    // called on the main thread after all state machines are built.
+    virtual bool can_build_async() { return false; }
+    virtual int build_fsm(SnortConfig*) { return -1; }
+    virtual int build_trees(SnortConfig*) { return -1; }
+
     int search(
         const uint8_t* T, int n, MpseMatch, void* context, int* current_state);
 
     virtual int search_all(
         const uint8_t* T, int n, MpseMatch, void* context, int* current_state);
 
+    // multi-buffer search - each buffer is searched from the start state
+    // and matches are reported with that buffer's context.  searching a
+    // batch back to back keeps the state machine hot in cache.
+    struct SearchItem
+    {
+        const uint8_t* buf;
+        int len;
+        void* context;
+    };
+
+    int search_batch(const SearchItem*, unsigned count, MpseMatch);
+
+    // asynchronous search - submit() hands a batch to the engine and poll()
+    // reports whether it is done.  matches are only delivered from poll(),
+    // always on the calling thread, so the caller can submit several jobs
+    // before collecting any results.  the items must remain valid until
+    // poll() returns true.  engines that can't offload search the whole
+    // batch in the first poll().
+    struct SearchJob
+    {
+        const SearchItem* items;
+        unsigned count;
+        MpseMatch match;
+        void* engine_data;  // for the engine's use between submit and poll
+    };
+
+    void submit(SearchJob&);
+    bool poll(SearchJob&, bool wait = true);
+
+    virtual bool can_async() { return false; }
+
+    // streaming search - engines that can keep scan state in the flow
+    // search consecutive buffers in each direction incrementally so that
+    // matches spanning buffer boundaries are found.  others just search().
+    int search_stream(
+        Flow*, bool c2s, const uint8_t* T, int n, MpseMatch, void* context);
+
+    virtual bool can_stream() { return false; }
+
     virtual void set_opt(int) { }
     virtual int print_info() { return 0; }
     virtual int get_pattern_count() { return 0; }
@@ -89,6 +137,16 @@ protected:
     virtual int _search(
         const uint8_t* T, int n, MpseMatch, void* context, int* current_state) = 0;
 
+    // override if the engine can do better than one _search() per item
+    virtual int _search_batch(const SearchItem*, unsigned count, MpseMatch);
+
+    virtual int _search_stream(
+        Flow*, bool c2s, const uint8_t* T, int n, MpseMatch, void* context);
+
+    // override both to offload; _poll() returns true when the job is done
+    virtual void _submit(SearchJob&);
+    virtual bool _poll(SearchJob&, bool wait);
+
 private:
     std::string method;
     bool inc_global_counter;
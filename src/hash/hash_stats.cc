@@ -0,0 +1,162 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// hash_stats.cc
+
+#include "hash_stats.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+#include "log/messages.h"
+#include "main/thread.h"
+#include "utils/stats.h"
+
+bool hash_stats_on = false;
+
+static std::mutex s_stats_mutex;
+static std::vector<HashStats*> s_live;
+static std::map<std::string, HashSummary> s_detached;
+
+static const char* s_bin_names[HASH_PROBE_BINS] =
+{ "0", "1", "2", "3-4", "5-8", "9-16", "17-32", "33+" };
+
+const char* hash_probe_bin_name(unsigned bin)
+{ return bin < HASH_PROBE_BINS ? s_bin_names[bin] : nullptr; }
+
+void hash_stats_enable(bool b)
+{ hash_stats_on = b; }
+
+HashStats* hash_stats_attach(const char* name, unsigned rows)
+{
+    HashStats* hs = new HashStats();
+
+    hs->name = name;
+    hs->packet_thread = is_packet_thread();
+    hs->instance = get_instance_id();
+    hs->rows = rows;
+
+    std::lock_guard<std::mutex> lock(s_stats_mutex);
+    s_live.push_back(hs);
+    return hs;
+}
+
+static void add(HashSummary& sum, const HashStats& hs)
+{
+    sum.tables++;
+    sum.hits += hs.hits;
+    sum.misses += hs.misses;
+    sum.inserts += hs.inserts;
+    sum.removes += hs.removes;
+    sum.evictions += hs.evictions;
+
+    for ( unsigned i = 0; i < HASH_PROBE_BINS; ++i )
+        sum.probes[i] += hs.probes[i];
+
+    sum.probe_total += hs.probe_total;
+
+    sum.rows += hs.rows;
+    sum.nodes += hs.nodes;
+    sum.peak_nodes += hs.peak_nodes;
+    sum.used_rows += hs.used_rows;
+}
+
+void hash_stats_detach(HashStats* hs)
+{
+    if ( !hs )
+        return;
+
+    std::lock_guard<std::mutex> lock(s_stats_mutex);
+
+    auto it = std::find(s_live.begin(), s_live.end(), hs);
+
+    if ( it != s_live.end() )
+        s_live.erase(it);
+
+    // the gauges are kept as they were when the table was deleted
+    add(s_detached[hs->name], *hs);
+    delete hs;
+}
+
+void hash_stats_summarize(std::vector<HashSummary>& v, bool packet_only)
+{
+    std::map<std::string, HashSummary> sums;
+    unsigned id = get_instance_id();
+
+    {
+        std::lock_guard<std::mutex> lock(s_stats_mutex);
+
+        if ( !packet_only )
+            sums = s_detached;
+
+        for ( const auto* hs : s_live )
+        {
+            if ( packet_only and (!hs->packet_thread or hs->instance != id) )
+                continue;
+
+            add(sums[hs->name], *hs);
+        }
+    }
+
+    v.clear();
+
+    for ( auto& it : sums )
+    {
+        it.second.name = it.first;
+        v.push_back(it.second);
+    }
+}
+
+void show_hash_stats()
+{
+    if ( !hash_stats_on )
+        return;
+
+    std::vector<HashSummary> sums;
+    hash_stats_summarize(sums, false);
+
+    if ( sums.empty() )
+        return;
+
+    LogLabel("Hash Table Statistics");
+
+    for ( const auto& s : sums )
+    {
+        LogLabel(s.name.c_str());
+        LogCount("tables", s.tables);
+        LogCount("rows", s.rows);
+        LogCount("nodes", s.nodes);
+        LogCount("peak_nodes", s.peak_nodes);
+        LogStat("load_factor", s.load_factor());
+        LogStat("peak_load_factor", s.peak_load_factor());
+        LogStat("row_occupancy", s.occupancy());
+        LogCount("hits", s.hits);
+        LogCount("misses", s.misses);
+        LogStat("hit_ratio", s.hit_ratio());
+        LogCount("inserts", s.inserts);
+        LogCount("removes", s.removes);
+        LogCount("evictions", s.evictions);
+        LogStat("avg_probes", s.avg_probes());
+
+        for ( unsigned i = 0; i < HASH_PROBE_BINS; ++i )
+        {
+            std::string label = std::string("probes_") + s_bin_names[i];
+            LogCount(label.c_str(), s.probes[i]);
+        }
+    }
+}
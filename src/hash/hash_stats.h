@@ -0,0 +1,179 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// hash_stats.h
+
+#ifndef HASH_STATS_H
+#define HASH_STATS_H
+
+// Opt-in health counters for SFXHASH and ZHash tables.  A table gets a
+// HashStats when its owner names it with sfxhash_set_stats() or
+// ZHash::set_stats(); tables with the same name are summed for reporting.
+// Nothing is counted until hash_stats_enable() is called so the cost for
+// a named table otherwise is one branch per operation.
+//
+// Probe lengths are the number of nodes compared per lookup, so a miss
+// in an empty row is 0.  Each table is updated only by the thread that
+// uses it; the gauges are racy snapshots when read from another thread.
+
+#include <string>
+#include <vector>
+
+#include "framework/counts.h"
+#include "main/snort_types.h"
+
+// 0, 1, 2, 3-4, 5-8, 9-16, 17-32, 33+
+#define HASH_PROBE_BINS 8
+
+struct HashStats
+{
+    const char* name;     // must be a literal or otherwise outlive the table
+    bool packet_thread;
+    unsigned instance;
+
+    PegCount hits;
+    PegCount misses;
+    PegCount inserts;
+    PegCount removes;
+    PegCount evictions;   // nodes recycled by automatic node recovery
+    PegCount probes[HASH_PROBE_BINS];
+    PegCount probe_total;
+
+    // gauges
+    unsigned rows;
+    unsigned nodes;
+    unsigned peak_nodes;
+    unsigned used_rows;   // rows with at least one node
+};
+
+extern SO_PUBLIC bool hash_stats_on;
+
+inline unsigned hash_probe_bin(unsigned n)
+{
+    if ( n < 3 )
+        return n;
+
+    unsigned bin = 3;
+
+    for ( unsigned lim = 4; n > lim and bin < HASH_PROBE_BINS - 1; lim <<= 1 )
+        ++bin;
+
+    return bin;
+}
+
+inline void hash_stats_lookup(HashStats* hs, unsigned probes, bool hit)
+{
+    if ( !hs or !hash_stats_on )
+        return;
+
+    if ( hit )
+        hs->hits++;
+    else
+        hs->misses++;
+
+    hs->probes[hash_probe_bin(probes)]++;
+    hs->probe_total += probes;
+}
+
+// call after a new node is linked into its row
+inline void hash_stats_insert(HashStats* hs, bool first_in_row, unsigned nodes)
+{
+    if ( !hs or !hash_stats_on )
+        return;
+
+    hs->inserts++;
+
+    if ( first_in_row )
+        hs->used_rows++;
+
+    hs->nodes = nodes;
+
+    if ( nodes > hs->peak_nodes )
+        hs->peak_nodes = nodes;
+}
+
+// call after a node is unlinked from its row
+inline void hash_stats_remove(
+    HashStats* hs, bool last_in_row, unsigned nodes, bool evicted = false)
+{
+    if ( !hs or !hash_stats_on )
+        return;
+
+    if ( evicted )
+        hs->evictions++;
+    else
+        hs->removes++;
+
+    if ( last_in_row and hs->used_rows )
+        hs->used_rows--;
+
+    hs->nodes = nodes;
+}
+
+// totals over the tables with the same name
+struct HashSummary
+{
+    std::string name;
+    unsigned tables = 0;
+
+    PegCount hits = 0;
+    PegCount misses = 0;
+    PegCount inserts = 0;
+    PegCount removes = 0;
+    PegCount evictions = 0;
+    PegCount probes[HASH_PROBE_BINS] = { };
+    PegCount probe_total = 0;
+
+    uint64_t rows = 0;
+    uint64_t nodes = 0;
+    uint64_t peak_nodes = 0;
+    uint64_t used_rows = 0;
+
+    double load_factor() const
+    { return rows ? (double)nodes / rows : 0.0; }
+
+    double peak_load_factor() const
+    { return rows ? (double)peak_nodes / rows : 0.0; }
+
+    double occupancy() const
+    { return rows ? (double)used_rows / rows : 0.0; }
+
+    double hit_ratio() const
+    { return hits + misses ? (double)hits / (hits + misses) : 0.0; }
+
+    double avg_probes() const
+    { return hits + misses ? (double)probe_total / (hits + misses) : 0.0; }
+};
+
+SO_PUBLIC void hash_stats_enable(bool);
+
+// main or packet thread; detach when the table is deleted so the counts
+// are kept for the final summary
+SO_PUBLIC HashStats* hash_stats_attach(const char* name, unsigned rows);
+SO_PUBLIC void hash_stats_detach(HashStats*);
+
+// sorted by name.  packet_only restricts the summary to live tables of
+// the calling packet thread; otherwise it includes all live and detached
+// tables.
+SO_PUBLIC void hash_stats_summarize(std::vector<HashSummary>&, bool packet_only);
+
+SO_PUBLIC const char* hash_probe_bin_name(unsigned bin);
+
+// final hash table statistics for the stats dump
+void show_hash_stats();
+
+#endif
@@ -0,0 +1,474 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// lru_cache_sharded.h
+
+#ifndef LRU_CACHE_SHARDED_H
+#define LRU_CACHE_SHARDED_H
+
+// LruCacheSharded -- LruCacheShared split into a power of 2 number of
+// sub-caches selected by key hash.  Each shard has its own lock, list and
+// map so threads only contend when they hit the same shard.  The maximum
+// size is divided evenly (rounded up) across the shards.
+//
+// In read-mostly mode find() only takes a shared lock and marks the entry
+// referenced instead of moving it to the front.  Pruning then gives
+// referenced entries at the tail a second chance (CLOCK) so recency is
+// approximate but lookups never block each other.
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "hash/lru_cache_shared.h"
+
+// reader / writer spin lock; waiting writers hold off new readers so a
+// steady stream of lookups can't starve inserts.
+class LruRwLock
+{
+public:
+    void lock()
+    {
+        writers.fetch_add(1, std::memory_order_relaxed);
+        int v = 0;
+
+        while ( !state.compare_exchange_weak(v, -1, std::memory_order_acquire) )
+        {
+            v = 0;
+            std::this_thread::yield();
+        }
+        writers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void unlock()
+    { state.store(0, std::memory_order_release); }
+
+    void lock_shared()
+    {
+        while ( true )
+        {
+            int v = state.load(std::memory_order_relaxed);
+
+            if ( v >= 0 and !writers.load(std::memory_order_relaxed) and
+                state.compare_exchange_weak(v, v + 1, std::memory_order_acquire) )
+                return;
+
+            std::this_thread::yield();
+        }
+    }
+
+    void unlock_shared()
+    { state.fetch_sub(1, std::memory_order_release); }
+
+private:
+    std::atomic<int> state { 0 };    // -1 = writer, else reader count
+    std::atomic<int> writers { 0 };
+};
+
+class LruSharedGuard
+{
+public:
+    LruSharedGuard(LruRwLock& l) : lock(l)
+    { lock.lock_shared(); }
+
+    ~LruSharedGuard()
+    { lock.unlock_shared(); }
+
+private:
+    LruRwLock& lock;
+};
+
+template<typename Key, typename Data, typename Hash>
+class LruCacheSharded
+{
+public:
+    LruCacheSharded() = delete;
+    LruCacheSharded(const LruCacheSharded& arg) = delete;
+    LruCacheSharded& operator=(const LruCacheSharded& arg) = delete;
+
+    LruCacheSharded(const size_t initial_size, unsigned num_shards = 16,
+        bool read_mostly = false);
+
+    size_t size();
+
+    size_t get_max_size()
+    { return max_size.load(std::memory_order_relaxed); }
+
+    unsigned get_shards() const
+    { return mask + 1; }
+
+    //  Switch between exact LRU and CLOCK recency.  Safe at any time; the
+    //  order built up so far is kept.
+    void set_read_mostly(bool b)
+    { read_mostly.store(b, std::memory_order_relaxed); }
+
+    bool get_read_mostly() const
+    { return read_mostly.load(std::memory_order_relaxed); }
+
+    //  Same semantics as LruCacheShared.
+    bool set_max_size(size_t newsize);
+    void insert(const Key& key, const Data& data);
+    bool find(const Key& key, Data& data, bool update=true);
+    bool remove(const Key& key);
+    bool remove(const Key& key, Data& data);
+    void clear();
+
+    //  Remove up to n of the least recently used entries, visiting the
+    //  shards round robin.  Returns the number removed.
+    size_t evict(size_t n);
+
+    //  Return all data shard by shard, each from most recently used to
+    //  least.  In read-mostly mode the order within a shard is approximate.
+    std::vector<std::pair<Key, Data> > get_all_data();
+
+    const PegInfo* get_pegs() const
+    { return lru_cache_shared_peg_names; }
+
+    //  Totals across all shards as of this call.
+    PegCount* get_counts();
+
+private:
+    struct Entry
+    {
+        Entry(const Key& k, const Data& d) : key(k), data(d), ref(false) { }
+
+        Key key;
+        Data data;
+        std::atomic<bool> ref;  // referenced since the hand last passed
+    };
+
+    using LruList = std::list<Entry>;
+    using LruListIter = typename LruList::iterator;
+    using LruMap  = std::unordered_map<Key, LruListIter, Hash>;
+    using LruMapIter = typename LruMap::iterator;
+
+    struct Shard
+    {
+        LruRwLock lock;
+        size_t max_size = 0;
+        size_t current_size = 0;
+        LruList list;
+        LruMap map;
+
+        //  updated under the lock except hits and misses which may be
+        //  bumped by several readers at once
+        LruCacheSharedStats stats;
+        std::atomic<PegCount> find_hits { 0 };
+        std::atomic<PegCount> find_misses { 0 };
+    };
+
+    Shard& get_shard(const Key& key)
+    {
+        uint64_t h = (uint64_t)Hash()(key) * 0x9E3779B97F4A7C15ull;
+        return shards[(h >> 32) & mask];
+    }
+
+    void erase_tail(Shard&);
+    void prune(Shard&);
+
+    std::unique_ptr<Shard[]> shards;
+    unsigned mask;
+
+    std::atomic<size_t> max_size;
+    std::atomic<bool> read_mostly;
+    std::atomic<PegCount> clears { 0 };
+    std::atomic<unsigned> hand { 0 };   // next shard to evict from
+
+    LruCacheSharedStats stats;  // sums returned by get_counts()
+};
+
+template<typename Key, typename Data, typename Hash>
+LruCacheSharded<Key, Data, Hash>::LruCacheSharded(
+    const size_t initial_size, unsigned num_shards, bool rm)
+{
+    unsigned n = 1;
+
+    while ( n < num_shards )
+        n <<= 1;
+
+    shards.reset(new Shard[n]);
+    mask = n - 1;
+    read_mostly.store(rm, std::memory_order_relaxed);
+    max_size.store(0, std::memory_order_relaxed);
+
+    if ( !set_max_size(initial_size) )
+        set_max_size(1);
+}
+
+template<typename Key, typename Data, typename Hash>
+size_t LruCacheSharded<Key, Data, Hash>::size()
+{
+    size_t sum = 0;
+
+    for ( unsigned i = 0; i <= mask; ++i )
+    {
+        LruSharedGuard guard(shards[i].lock);
+        sum += shards[i].current_size;
+    }
+    return sum;
+}
+
+template<typename Key, typename Data, typename Hash>
+void LruCacheSharded<Key, Data, Hash>::erase_tail(Shard& s)
+{
+    LruListIter list_iter = s.list.end();
+    list_iter--;
+    s.map.erase(list_iter->key);
+    s.list.erase(list_iter);
+}
+
+//  Make room for one more entry.  With CLOCK recency, referenced entries
+//  at the tail are cleared and moved to the front; after a full lap every
+//  bit is clear so this terminates.
+template<typename Key, typename Data, typename Hash>
+void LruCacheSharded<Key, Data, Hash>::prune(Shard& s)
+{
+    if ( read_mostly.load(std::memory_order_relaxed) )
+    {
+        for ( size_t n = 0; n < s.current_size; ++n )
+        {
+            LruListIter tail = s.list.end();
+            tail--;
+
+            if ( !tail->ref.load(std::memory_order_relaxed) )
+                break;
+
+            tail->ref.store(false, std::memory_order_relaxed);
+            s.list.splice(s.list.begin(), s.list, tail);
+        }
+    }
+    erase_tail(s);
+}
+
+template<typename Key, typename Data, typename Hash>
+bool LruCacheSharded<Key, Data, Hash>::set_max_size(size_t newsize)
+{
+    if ( newsize <= 0 )
+        return false;   //  Not allowed to set size to zero.
+
+    size_t per = (newsize + mask) / (mask + 1);
+
+    for ( unsigned i = 0; i <= mask; ++i )
+    {
+        Shard& s = shards[i];
+        std::lock_guard<LruRwLock> shard_lock(s.lock);
+
+        while ( s.current_size > per )
+        {
+            erase_tail(s);
+            s.current_size--;
+        }
+        s.max_size = per;
+    }
+
+    max_size.store(newsize, std::memory_order_relaxed);
+    return true;
+}
+
+template<typename Key, typename Data, typename Hash>
+void LruCacheSharded<Key, Data, Hash>::insert(const Key& key, const Data& data)
+{
+    Shard& s = get_shard(key);
+    std::lock_guard<LruRwLock> shard_lock(s.lock);
+
+    LruMapIter map_iter = s.map.find(key);
+
+    if ( map_iter != s.map.end() )
+    {
+        s.current_size--;
+        s.list.erase(map_iter->second);
+        s.map.erase(map_iter);
+        s.stats.replaces++;
+    }
+    else
+    {
+        s.stats.adds++;
+    }
+
+    if ( s.current_size >= s.max_size )
+    {
+        prune(s);
+        s.stats.prunes++;
+    }
+    else
+    {
+        s.current_size++;
+    }
+
+    s.list.emplace_front(key, data);
+    s.map[key] = s.list.begin();
+}
+
+template<typename Key, typename Data, typename Hash>
+bool LruCacheSharded<Key, Data, Hash>::find(const Key& key, Data& data, bool update)
+{
+    Shard& s = get_shard(key);
+
+    if ( read_mostly.load(std::memory_order_relaxed) )
+    {
+        LruSharedGuard guard(s.lock);
+        LruMapIter map_iter = s.map.find(key);
+
+        if ( map_iter == s.map.end() )
+        {
+            s.find_misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        Entry& e = *map_iter->second;
+        data = e.data;
+
+        //  Only write the bit when it changes to keep the line shared.
+        if ( update and !e.ref.load(std::memory_order_relaxed) )
+            e.ref.store(true, std::memory_order_relaxed);
+
+        s.find_hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::lock_guard<LruRwLock> shard_lock(s.lock);
+    LruMapIter map_iter = s.map.find(key);
+
+    if ( map_iter == s.map.end() )
+    {
+        s.find_misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    data = map_iter->second->data;
+
+    if ( update )
+        s.list.splice(s.list.begin(), s.list, map_iter->second);
+
+    s.find_hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+template<typename Key, typename Data, typename Hash>
+bool LruCacheSharded<Key, Data, Hash>::remove(const Key& key)
+{
+    Data data;
+    return remove(key, data);
+}
+
+template<typename Key, typename Data, typename Hash>
+bool LruCacheSharded<Key, Data, Hash>::remove(const Key& key, Data& data)
+{
+    Shard& s = get_shard(key);
+    std::lock_guard<LruRwLock> shard_lock(s.lock);
+
+    LruMapIter map_iter = s.map.find(key);
+
+    if ( map_iter == s.map.end() )
+        return false;   //  Key is not in LruCache.
+
+    data = map_iter->second->data;
+
+    s.current_size--;
+    s.list.erase(map_iter->second);
+    s.map.erase(map_iter);
+    s.stats.removes++;
+    return true;
+}
+
+template<typename Key, typename Data, typename Hash>
+void LruCacheSharded<Key, Data, Hash>::clear()
+{
+    for ( unsigned i = 0; i <= mask; ++i )
+    {
+        Shard& s = shards[i];
+        std::lock_guard<LruRwLock> shard_lock(s.lock);
+
+        s.map.clear();
+        s.list.clear();
+        s.current_size = 0;
+    }
+    clears.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<typename Key, typename Data, typename Hash>
+size_t LruCacheSharded<Key, Data, Hash>::evict(size_t n)
+{
+    size_t done = 0;
+    unsigned empty = 0;
+
+    //  stop after a full lap of empty shards
+    while ( done < n and empty <= mask )
+    {
+        Shard& s = shards[hand.fetch_add(1, std::memory_order_relaxed) & mask];
+        std::lock_guard<LruRwLock> shard_lock(s.lock);
+
+        if ( !s.current_size )
+        {
+            ++empty;
+            continue;
+        }
+
+        prune(s);
+        s.current_size--;
+        s.stats.prunes++;
+        ++done;
+        empty = 0;
+    }
+    return done;
+}
+
+template<typename Key, typename Data, typename Hash>
+std::vector<std::pair<Key, Data> > LruCacheSharded<Key, Data, Hash>::get_all_data()
+{
+    std::vector<std::pair<Key, Data> > vec;
+
+    for ( unsigned i = 0; i <= mask; ++i )
+    {
+        LruSharedGuard guard(shards[i].lock);
+
+        for ( auto& entry : shards[i].list )
+            vec.push_back(std::make_pair(entry.key, entry.data));
+    }
+    return vec;
+}
+
+template<typename Key, typename Data, typename Hash>
+PegCount* LruCacheSharded<Key, Data, Hash>::get_counts()
+{
+    LruCacheSharedStats sum;
+
+    for ( unsigned i = 0; i <= mask; ++i )
+    {
+        Shard& s = shards[i];
+        LruSharedGuard guard(s.lock);
+
+        sum.adds += s.stats.adds;
+        sum.replaces += s.stats.replaces;
+        sum.prunes += s.stats.prunes;
+        sum.removes += s.stats.removes;
+        sum.find_hits += s.find_hits.load(std::memory_order_relaxed);
+        sum.find_misses += s.find_misses.load(std::memory_order_relaxed);
+    }
+    sum.clears = clears.load(std::memory_order_relaxed);
+    stats = sum;
+
+    return (PegCount*)&stats;
+}
+
+#endif
+
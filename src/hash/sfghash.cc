@@ -568,6 +568,11 @@ int sfghash_set_keyops(SFGHASH* h,
     return -1;
 }
 
+SfHashType sfghash_set_hash_type(SFGHASH* h, SfHashType type)
+{
+    return sfhashfcn_set_type(h->sfhashfcn, type);
+}
+
 /*
 *
 *   Test Driver for Hashing
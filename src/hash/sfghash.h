@@ -31,6 +31,7 @@
 #include "main/snort_types.h"
 
 struct SFHASHFCN;
+enum SfHashType : uint8_t;
 
 #define SFGHASH_NOMEM    -2
 #define SFGHASH_ERR      -1
@@ -83,5 +84,8 @@ SO_PUBLIC int sfghash_set_keyops(SFGHASH*,
     unsigned (* hash_fcn)(SFHASHFCN* p, unsigned char* d, int n),
     int (* keycmp_fcn)(const void* s1, const void* s2, size_t n));
 
+// select the hash family while the table is empty; see sfhashfcn.h
+SO_PUBLIC SfHashType sfghash_set_hash_type(SFGHASH*, SfHashType);
+
 #endif
 
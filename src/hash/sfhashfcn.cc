@@ -31,6 +31,13 @@
 
 #include "sfhashfcn.h"
 
+#include <random>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define SFHASHFCN_CRC
+#endif
+
 #include "sfprimetable.h"
 #include "main/snort_types.h"
 #include "main/snort_config.h"
@@ -87,6 +94,126 @@ unsigned sfhashfcn_hash(SFHASHFCN* p, unsigned char* d, int n)
     return hash ^ p->hardener;
 }
 
+#ifdef SFHASHFCN_CRC
+__attribute__((target("sse4.2")))
+static unsigned sfhashfcn_hash_crc(SFHASHFCN* p, unsigned char* d, int n)
+{
+    uint64_t hash = p->seed;
+
+    for ( ; n >= 8; d += 8, n -= 8 )
+    {
+        uint64_t w;
+        memcpy(&w, d, sizeof(w));
+        hash = _mm_crc32_u64(hash, w);
+    }
+    if ( n >= 4 )
+    {
+        uint32_t w;
+        memcpy(&w, d, sizeof(w));
+        hash = _mm_crc32_u32(hash, w);
+        d += 4;
+        n -= 4;
+    }
+    while ( n-- )
+        hash = _mm_crc32_u8(hash, *d++);
+
+    return hash ^ p->hardener;
+}
+#endif
+
+//-------------------------------------------------------------------------
+// siphash-1-3: one compression round per 8 bytes and three to finish
+//-------------------------------------------------------------------------
+
+#define rotl64(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define sip_round(v0, v1, v2, v3) \
+{ \
+    v0 += v1; v1 = rotl64(v1, 13); v1 ^= v0; v0 = rotl64(v0, 32); \
+    v2 += v3; v3 = rotl64(v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = rotl64(v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = rotl64(v1, 17); v1 ^= v2; v2 = rotl64(v2, 32); \
+}
+
+static uint64_t siphash(
+    const uint64_t* key, const unsigned char* d, unsigned n, unsigned c, unsigned f)
+{
+    uint64_t v0 = key[0] ^ 0x736f6d6570736575ull;
+    uint64_t v1 = key[1] ^ 0x646f72616e646f6dull;
+    uint64_t v2 = key[0] ^ 0x6c7967656e657261ull;
+    uint64_t v3 = key[1] ^ 0x7465646279746573ull;
+
+    uint64_t b = (uint64_t)n << 56;
+
+    for ( ; n >= 8; d += 8, n -= 8 )
+    {
+        uint64_t m;
+        memcpy(&m, d, sizeof(m));
+
+        v3 ^= m;
+        for ( unsigned i = 0; i < c; ++i )
+            sip_round(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    for ( unsigned i = 0; i < n; ++i )
+        b |= (uint64_t)d[i] << (8 * i);
+
+    v3 ^= b;
+    for ( unsigned i = 0; i < c; ++i )
+        sip_round(v0, v1, v2, v3);
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    for ( unsigned i = 0; i < f; ++i )
+        sip_round(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+unsigned sfhashfcn_hash_sip(SFHASHFCN* p, unsigned char* d, int n)
+{
+    uint64_t h = siphash(p->sip_key, d, n, 1, 3);
+    return (unsigned)(h ^ (h >> 32));
+}
+
+SfHashType sfhashfcn_set_type(SFHASHFCN* p, SfHashType type)
+{
+    switch ( type )
+    {
+    case SFHASH_CRC:
+#ifdef SFHASHFCN_CRC
+        __builtin_cpu_init();
+
+        if ( __builtin_cpu_supports("sse4.2") )
+        {
+            p->hash_fcn = sfhashfcn_hash_crc;
+            return SFHASH_CRC;
+        }
+#endif
+        break;
+
+    case SFHASH_SIP:
+        if ( SnortConfig::static_hash() )
+        {
+            p->sip_key[0] = 0x0706050403020100ull;
+            p->sip_key[1] = 0x0f0e0d0c0b0a0908ull;
+        }
+        else
+        {
+            std::random_device rd;
+            p->sip_key[0] = (uint64_t)rd() << 32 | rd();
+            p->sip_key[1] = (uint64_t)rd() << 32 | rd();
+        }
+        p->hash_fcn = sfhashfcn_hash_sip;
+        return SFHASH_SIP;
+
+    case SFHASH_DEFAULT:
+        break;
+    }
+    p->hash_fcn = sfhashfcn_hash;
+    return SFHASH_DEFAULT;
+}
+
 /**
  * Make sfhashfcn use a separate set of opcodes for the backend.
  *
@@ -158,3 +285,41 @@ void mix_str(
     }
 }
 
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+
+TEST_CASE("siphash reference vectors", "[sfhashfcn]")
+{
+    // from the siphash paper; 2-4 uses the same code as 1-3
+    const uint64_t key[2] = { 0x0706050403020100ull, 0x0f0e0d0c0b0a0908ull };
+    unsigned char msg[15];
+
+    for ( unsigned i = 0; i < sizeof(msg); ++i )
+        msg[i] = i;
+
+    CHECK(siphash(key, msg, 0, 2, 4) == 0x726fdb47dd0e0e31ull);
+    CHECK(siphash(key, msg, 1, 2, 4) == 0x74f839c593dc67fdull);
+    CHECK(siphash(key, msg, 15, 2, 4) == 0xa129ca6149be45e5ull);
+}
+
+TEST_CASE("hash types", "[sfhashfcn]")
+{
+    SFHASHFCN* p = sfhashfcn_new(64);
+    unsigned char key[] = "abcdefghijklmnopqrstuvwxyz";
+
+    CHECK(sfhashfcn_set_type(p, SFHASH_SIP) == SFHASH_SIP);
+    unsigned h = p->hash_fcn(p, key, sizeof(key));
+    CHECK(h == p->hash_fcn(p, key, sizeof(key)));
+
+    SfHashType t = sfhashfcn_set_type(p, SFHASH_CRC);
+    CHECK((t == SFHASH_CRC or t == SFHASH_DEFAULT));
+    CHECK(p->hash_fcn(p, key, 24) != p->hash_fcn(p, key, 25));
+
+    CHECK(sfhashfcn_set_type(p, SFHASH_DEFAULT) == SFHASH_DEFAULT);
+    CHECK((p->hash_fcn == &sfhashfcn_hash));
+
+    sfhashfcn_free(p);
+}
+
+#endif
@@ -63,12 +63,29 @@ struct SFHASHFCN
     // FIXIT-H use types for these callbacks
     unsigned (* hash_fcn)(SFHASHFCN*, unsigned char* d, int n);
     int (* keycmp_fcn)(const void* s1, const void* s2, size_t n);
+    uint64_t sip_key[2];  // set by sfhashfcn_set_type(SFHASH_SIP)
+};
+
+// the hash family of a table; all are seeded per table unless
+// SnortConfig::static_hash().  the default is a multiply / add over each
+// byte.  crc is crc32c, 8 bytes per instruction, and falls back to the
+// default without sse4.2; it is fast but not keyed in any useful sense.
+// sip is siphash-1-3 for tables with keys an attacker can pick.
+enum SfHashType : uint8_t
+{
+    SFHASH_DEFAULT,
+    SFHASH_CRC,
+    SFHASH_SIP
 };
 
 SFHASHFCN* sfhashfcn_new(int nrows);
 void sfhashfcn_free(SFHASHFCN*);
 
 unsigned sfhashfcn_hash(SFHASHFCN*, unsigned char* d, int n);
+unsigned sfhashfcn_hash_sip(SFHASHFCN*, unsigned char* d, int n);
+
+// replaces the hash function, not the key compare; returns the type used
+SfHashType sfhashfcn_set_type(SFHASHFCN*, SfHashType);
 
 int sfhashfcn_set_keyops(
     SFHASHFCN*,
@@ -85,6 +85,13 @@
  *              this allows user to pass null for data, and set up the data area
  *              themselves after the call - this is much more flexible.
  *  8/31/2006: man - changed to use prime table lookup.
+ *
+ *  sfxhash_set_open() swaps the rows for an open addressed slot array.
+ *  Each slot has a control byte holding 7 bits of the hash so a group
+ *  of 16 slots is checked with one compare and mismatches rarely touch
+ *  the node.  Nodes are allocated and kept on the global list as before;
+ *  only the index changes.  ANR sweeps a clock hand over the slots and
+ *  takes the first node not found since the last sweep.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -95,6 +102,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#define SFXHASH_SIMD
+#endif
+
 #include "main/snort_types.h"
 #include "main/snort_debug.h"
 #include "utils/util.h"
@@ -102,6 +114,7 @@
 #include "sfxhash.h"
 #include "sfprimetable.h"
 #include "sfhashfcn.h"
+#include "hash_stats.h"
 
 /*
  * Implements SFXHASH as specialized hash container
@@ -279,6 +292,335 @@ void sfxhash_splaymode(SFXHASH* t, int n)
     t->splay = n;
 }
 
+void sfxhash_set_stats(SFXHASH* t, const char* name)
+{
+    hash_stats_detach(t->stats);
+    t->stats = hash_stats_attach(name, t->nrows);
+}
+
+static void sfxhash_gunlink_node(SFXHASH*, SFXHASH_NODE*);
+
+//-------------------------------------------------------------------------
+// open addressing
+//
+// slots are probed a group at a time, one group per step of a triangular
+// sequence, which visits every group when the count is a power of 2.  a
+// lookup ends at the first group with an empty slot.  removed nodes leave
+// a deleted slot unless their group already has an empty one.
+//-------------------------------------------------------------------------
+
+#define OA_GROUP 16
+#define OA_MIN_SLOTS 16
+
+#define OA_EMPTY   0x80
+#define OA_DELETED 0xFE  // anything with the high bit set is free
+
+static inline unsigned oa_mix(unsigned h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    return h;
+}
+
+static inline unsigned oa_hash(SFXHASH* t, const void* key)
+{
+    return oa_mix(t->sfhashfcn->hash_fcn(t->sfhashfcn, (unsigned char*)key, t->keysize));
+}
+
+// one bit for each control byte in the group equal to c
+static inline unsigned oa_match(const uint8_t* g, uint8_t c)
+{
+#ifdef SFXHASH_SIMD
+    __m128i v = _mm_loadu_si128((const __m128i*)g);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+#else
+    unsigned m = 0;
+
+    for ( unsigned i = 0; i < OA_GROUP; ++i )
+        if ( g[i] == c )
+            m |= 1 << i;
+
+    return m;
+#endif
+}
+
+// one bit for each empty or deleted slot in the group
+static inline unsigned oa_match_free(const uint8_t* g)
+{
+#ifdef SFXHASH_SIMD
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)g));
+#else
+    unsigned m = 0;
+
+    for ( unsigned i = 0; i < OA_GROUP; ++i )
+        if ( g[i] & 0x80 )
+            m |= 1 << i;
+
+    return m;
+#endif
+}
+
+static SFXHASH_NODE* oa_find(SFXHASH* t, const void* key, unsigned h, unsigned& probes)
+{
+    unsigned mask = t->nrows / OA_GROUP - 1;
+    unsigned g = (h >> 7) & mask;
+    uint8_t tag = h & 0x7f;
+
+    for ( unsigned i = 1; i <= mask + 1; ++i )
+    {
+        const uint8_t* ctrl = t->ctrl + g * OA_GROUP;
+
+        for ( unsigned m = oa_match(ctrl, tag); m; m &= m - 1 )
+        {
+            SFXHASH_NODE* hnode = t->slots[g * OA_GROUP + __builtin_ctz(m)];
+            probes++;
+
+            if ( !t->sfhashfcn->keycmp_fcn(hnode->key, key, t->keysize) )
+                return hnode;
+        }
+        if ( oa_match(ctrl, OA_EMPTY) )
+            break;
+
+        g = (g + i) & mask;
+    }
+    return nullptr;
+}
+
+// h must not be in the table; there must be a free slot
+static void oa_place(SFXHASH* t, SFXHASH_NODE* hnode, unsigned h)
+{
+    unsigned mask = t->nrows / OA_GROUP - 1;
+    unsigned g = (h >> 7) & mask;
+    unsigned m;
+
+    for ( unsigned i = 1; !(m = oa_match_free(t->ctrl + g * OA_GROUP)); ++i )
+        g = (g + i) & mask;
+
+    unsigned s = g * OA_GROUP + __builtin_ctz(m);
+
+    if ( t->ctrl[s] == OA_EMPTY )
+        t->nused++;
+
+    t->ctrl[s] = h & 0x7f;
+    t->slots[s] = hnode;
+    t->refs[s] = 1;
+    hnode->rindex = s;
+}
+
+static void oa_erase(SFXHASH* t, SFXHASH_NODE* hnode)
+{
+    unsigned s = hnode->rindex;
+
+    // no lookup goes past a group with an empty slot
+    if ( oa_match(t->ctrl + (s & ~(OA_GROUP - 1)), OA_EMPTY) )
+    {
+        t->ctrl[s] = OA_EMPTY;
+        t->nused--;
+    }
+    else
+        t->ctrl[s] = OA_DELETED;
+
+    t->slots[s] = nullptr;
+    t->refs[s] = 0;
+}
+
+static void oa_clear(SFXHASH* t)
+{
+    memset(t->ctrl, OA_EMPTY, t->nrows);
+    memset(t->refs, 0, t->nrows);
+    t->nused = 0;
+    t->hand = 0;
+}
+
+// the slot pointers, control bytes, and reference bits are one block
+static bool oa_alloc(SFXHASH* t, unsigned n)
+{
+    uint8_t* p = (uint8_t*)s_alloc(t, n * (sizeof(SFXHASH_NODE*) + 2));
+
+    if ( !p )
+        return false;
+
+    t->slots = (SFXHASH_NODE**)p;
+    t->ctrl = p + n * sizeof(SFXHASH_NODE*);
+    t->refs = t->ctrl + n;
+    t->nrows = n;
+    oa_clear(t);
+
+    if ( t->stats )
+        t->stats->rows = n;
+
+    return true;
+}
+
+// move the nodes to n new slots; false leaves the table as is
+static bool oa_resize(SFXHASH* t, unsigned n)
+{
+    SFXHASH_NODE** slots = t->slots;
+    uint8_t* ctrl = t->ctrl;
+    uint8_t* refs = t->refs;
+    unsigned nrows = t->nrows, nused = t->nused, hand = t->hand;
+    unsigned long used = t->mc.memused;
+
+    if ( !oa_alloc(t, n) )
+    {
+        t->slots = slots;
+        t->ctrl = ctrl;
+        t->refs = refs;
+        t->nrows = nrows;
+        t->nused = nused;
+        t->hand = hand;
+        return false;
+    }
+
+    for ( unsigned i = 0; i < nrows; ++i )
+    {
+        if ( ctrl[i] & 0x80 )
+            continue;
+
+        oa_place(t, slots[i], oa_hash(t, slots[i]->key));
+        t->refs[slots[i]->rindex] = refs[i];
+    }
+    s_free(t, slots);
+    t->overhead_bytes += t->mc.memused - used;
+    return true;
+}
+
+// drop the deleted slots without allocating; the reference bits are lost
+static void oa_rehash(SFXHASH* t)
+{
+    oa_clear(t);
+
+    for ( SFXHASH_NODE* hnode = t->ghead; hnode; hnode = hnode->gnext )
+        oa_place(t, hnode, oa_hash(t, hnode->key));
+
+    memset(t->refs, 0, t->nrows);
+}
+
+// keep the load at or below 7/8 to bound probes; when the memcap doesn't
+// allow growing, rehash only once enough deleted slots build up to pay
+// for it since that happens steadily when ANR is recycling nodes.
+// returns false if still at the limit.
+static bool oa_reserve(SFXHASH* t)
+{
+    if ( t->nused < t->nrows - t->nrows / 8 )
+        return true;
+
+    if ( t->count >= t->nrows / 2 and oa_resize(t, t->nrows * 2) )
+        return true;
+
+    if ( t->nused - t->count >= t->nrows / 16 )
+    {
+        oa_rehash(t);
+        return true;
+    }
+    return false;
+}
+
+static SFXHASH_NODE* oa_anr(SFXHASH*);
+static void sfxhash_release_node(SFXHASH*, SFXHASH_NODE*);
+
+// make room for one more node
+static bool oa_insert_room(SFXHASH* t)
+{
+    if ( oa_reserve(t) )
+        return true;
+
+    // recover a node rather than go over the limit
+    if ( t->anr_flag )
+    {
+        if ( SFXHASH_NODE* hnode = oa_anr(t) )
+        {
+            sfxhash_release_node(t, hnode);
+            return true;
+        }
+    }
+
+    if ( t->nused + 1 >= t->nrows and t->nused > t->count )
+        oa_rehash(t);
+
+    return t->count < t->nrows;
+}
+
+static SFXHASH_NODE* oa_anr(SFXHASH* t)
+{
+    // the first pass clears the reference bits so the second finds a node
+    // unless the user refuses them all
+    for ( unsigned i = 0; i < 2 * t->nrows; ++i )
+    {
+        unsigned s = t->hand;
+        t->hand = (s + 1) & (t->nrows - 1);
+
+        if ( t->ctrl[s] & 0x80 )
+            continue;
+
+        if ( t->refs[s] )
+        {
+            t->refs[s] = 0;
+            continue;
+        }
+        SFXHASH_NODE* hnode = t->slots[s];
+
+        if ( t->anrfree )
+        {
+            t->anr_tries++;
+
+            if ( t->anrfree(hnode->key, hnode->data) )
+                continue;
+        }
+        sfxhash_gunlink_node(t, hnode);
+        oa_erase(t, hnode);
+        t->count--;
+        t->anr_count++;
+        hash_stats_remove(t->stats, true, t->count, true);
+        return hnode;
+    }
+    return nullptr;
+}
+
+// load cnode with the first node at or after slot s
+static void oa_seek(SFXHASH* t, unsigned s)
+{
+    for ( t->crow = s; t->crow < t->nrows; t->crow++ )
+    {
+        if ( !(t->ctrl[t->crow] & 0x80) )
+        {
+            t->cnode = t->slots[t->crow];
+            return;
+        }
+    }
+    t->cnode = nullptr;
+}
+
+int sfxhash_set_open(SFXHASH* t)
+{
+    if ( t->slots )
+        return SFXHASH_OK;
+
+    if ( t->count )
+        return SFXHASH_ERR;
+
+    unsigned n = sfxhash_nearest_powerof2(t->nrows);
+
+    if ( n < OA_MIN_SLOTS )
+        n = OA_MIN_SLOTS;
+
+    unsigned long used = t->mc.memused;
+    SFXHASH_NODE** table = t->table;
+    unsigned nrows = t->nrows;
+
+    if ( !oa_alloc(t, n) )
+    {
+        t->nrows = nrows;
+        return SFXHASH_NOMEM;
+    }
+    s_free(t, table);
+    t->table = nullptr;
+
+    t->overhead_bytes += t->mc.memused - used;
+    return SFXHASH_OK;
+}
+
 /*!
  *  Free all nodes in the free list
  *
@@ -347,8 +689,24 @@ void sfxhash_delete(SFXHASH* h)
         s_free(h, h->table);
         h->table = 0;
     }
+    else if ( h->slots )
+    {
+        for ( i = 0; i < h->nrows; i++ )
+        {
+            if ( h->ctrl[i] & 0x80 )
+                continue;
+
+            if ( h->usrfree )
+                h->usrfree(h->slots[i]->key, h->slots[i]->data);
+
+            s_free(h, h->slots[i]);
+        }
+        s_free(h, h->slots);
+        h->slots = nullptr;
+    }
 
     sfxhash_delete_free_list(h);
+    hash_stats_detach(h->stats);
 
     snort_free(h);   /* free the table from general memory */
 }
@@ -371,6 +729,12 @@ int sfxhash_make_empty(SFXHASH* h)
 
     for (i = 0; i < h->nrows; i++)
     {
+        if ( h->slots )
+        {
+            if ( !(h->ctrl[i] & 0x80) && sfxhash_free_node(h, h->slots[i]) != SFXHASH_OK )
+                return -1;
+            continue;
+        }
         for (n = h->table[i]; n != NULL; n = tmp)
         {
             tmp = n->next;
@@ -381,6 +745,9 @@ int sfxhash_make_empty(SFXHASH* h)
         }
     }
 
+    if ( h->slots )
+        oa_clear(h);
+
     h->max_nodes = 0;
     h->crow = 0;
     h->cnode = NULL;
@@ -583,7 +950,10 @@ static SFXHASH_NODE* sfxhash_newnode(SFXHASH* t)
      *  Uses Automatic Node Recovery, to recycle the oldest node-based on access
      *  (Unlink and reuse the tail node)
      */
-    if ( !hnode && t->anr_flag && t->gtail )
+    if ( !hnode && t->anr_flag && t->gtail && t->slots )
+        hnode = oa_anr(t);
+
+    else if ( !hnode && t->anr_flag && t->gtail )
     {
         /* Find the oldes node the users willing to let go. */
         for (hnode = t->gtail; hnode; hnode = hnode->gprev )
@@ -606,6 +976,7 @@ static SFXHASH_NODE* sfxhash_newnode(SFXHASH* t)
             sfxhash_unlink_node(t, hnode);   /* unlink from the row list */
             t->count--;
             t->anr_count++; /* count # of ANR operations */
+            hash_stats_remove(t->stats, !t->table[hnode->rindex], t->count, true);
             break;
         }
     }
@@ -617,17 +988,16 @@ static SFXHASH_NODE* sfxhash_newnode(SFXHASH* t)
 
 /*
  *
- *  Find a Node based on the key, return the node and the index.
- *  The index is valid even if the return value is NULL, in which
- *  case the index is the corect row in which the node should be
- *  created.
+ *  Find a Node based on the key, return the node and the hash.
+ *  The hash is valid even if the return value is NULL so the
+ *  node can be linked with sfxhash_insert_node().
  *
  */
 
 #define hashsize(n) ((uint32_t)1<<(n))
 #define hashmask(n) (hashsize(n)-1)
 
-static SFXHASH_NODE* sfxhash_find_node_row(SFXHASH* t, const void* key, int* rindex)
+static SFXHASH_NODE* sfxhash_find_node_row(SFXHASH* t, const void* key, unsigned* phash)
 {
     unsigned hashkey;
     int index;
@@ -637,6 +1007,28 @@ static SFXHASH_NODE* sfxhash_find_node_row(SFXHASH* t, const void* key, int* rin
         (unsigned char*)key,
         t->keysize);
 
+    *phash = hashkey;
+    unsigned probes = 0;
+
+    if ( t->slots )
+    {
+        hnode = oa_find(t, key, oa_mix(hashkey), probes);
+
+        if ( hnode )
+        {
+            // the clock bit stands in for splaying
+            if ( t->splay > 0 )
+                t->refs[hnode->rindex] = 1;
+
+            t->find_success++;
+        }
+        else
+            t->find_fail++;
+
+        hash_stats_lookup(t->stats, probes, hnode != nullptr);
+        return hnode;
+    }
+
 /*     printf("hashkey: %u t->keysize: %d\n", hashkey, t->keysize);
        flowkey_fprint(stdout, key);
        printf("****\n"); */
@@ -645,24 +1037,66 @@ static SFXHASH_NODE* sfxhash_find_node_row(SFXHASH* t, const void* key, int* rin
     /* Modulus is slow. Switched to a table size that is a power of 2. */
     index  = hashkey & (t->nrows - 1);
 
-    *rindex = index;
-
     for ( hnode=t->table[index]; hnode; hnode=hnode->next )
     {
+        probes++;
+
         if ( !t->sfhashfcn->keycmp_fcn(hnode->key,key,t->keysize) )
         {
             if ( t->splay > 0 )
                 movetofront(t,hnode);
 
             t->find_success++;
+            hash_stats_lookup(t->stats, probes, true);
             return hnode;
         }
     }
 
     t->find_fail++;
+    hash_stats_lookup(t->stats, probes, false);
     return NULL;
 }
 
+/*
+ *  Link a new node into its row or slot and the global list.
+ *  Returns false if there is no room for it.
+ */
+static bool sfxhash_insert_node(SFXHASH* t, SFXHASH_NODE* hnode, unsigned hashkey)
+{
+    bool first_in_row = true;
+
+    if ( t->slots )
+    {
+        if ( !oa_insert_room(t) )
+            return false;
+
+        oa_place(t, hnode, oa_mix(hashkey));
+    }
+    else
+    {
+        hnode->rindex = hashkey & (t->nrows - 1);
+        first_in_row = !t->table[hnode->rindex];
+        sfxhash_link_node (t, hnode);
+    }
+
+    /* Link at the front of the global node list */
+    sfxhash_glink_node(t, hnode);
+
+    /* Track # active nodes */
+    t->count++;
+    hash_stats_insert(t->stats, first_in_row, t->count);
+
+    return true;
+}
+
+static void sfxhash_release_node(SFXHASH* t, SFXHASH_NODE* hnode)
+{
+    if ( t->recycle_nodes )
+        sfxhash_save_free_node(t, hnode);
+    else
+        s_free(t, hnode);
+}
+
 /*!
  * Add a key + data pair to the hash table
  *
@@ -683,11 +1117,11 @@ static SFXHASH_NODE* sfxhash_find_node_row(SFXHASH* t, const void* key, int* rin
  */
 static int sfxhash_add_ex(SFXHASH* t, const void* key, void* data, void** data_ptr)
 {
-    int index;
+    unsigned hashkey;
     SFXHASH_NODE* hnode;
 
     /* Enforce uniqueness: Check for the key in the table */
-    hnode = sfxhash_find_node_row(t, key, &index);
+    hnode = sfxhash_find_node_row(t, key, &hashkey);
 
     if ( hnode )
     {
@@ -712,9 +1146,6 @@ static int sfxhash_add_ex(SFXHASH* t, const void* key, void* data, void** data_p
     /* Copy the key */
     memcpy(hnode->key,key,t->keysize);
 
-    /* Save our table row index */
-    hnode->rindex = index;
-
     /* Copy the users data - or if datasize is zero set ptr to users data */
     if ( t->datasize )
     {
@@ -725,22 +1156,20 @@ static int sfxhash_add_ex(SFXHASH* t, const void* key, void* data, void** data_p
         {
             memcpy(hnode->data,data,t->datasize);
         }
-        if (data_ptr)
-            *data_ptr = hnode->data;
     }
     else
     {
         hnode->data = data;
     }
 
-    /* Link the node into the table row list */
-    sfxhash_link_node (t, hnode);
-
-    /* Link at the front of the global node list */
-    sfxhash_glink_node(t, hnode);
+    if ( !sfxhash_insert_node(t, hnode, hashkey) )
+    {
+        sfxhash_release_node(t, hnode);
+        return SFXHASH_NOMEM;
+    }
 
-    /* Track # active nodes */
-    t->count++;
+    if ( data_ptr and t->datasize )
+        *data_ptr = hnode->data;
 
     return SFXHASH_OK;
 }
@@ -769,11 +1198,11 @@ int sfxhash_add(SFXHASH* t, void* key, void* data)
  */
 SFXHASH_NODE* sfxhash_get_node(SFXHASH* t, const void* key)
 {
-    int index;
+    unsigned hashkey;
     SFXHASH_NODE* hnode;
 
     /* Enforce uniqueness: Check for the key in the table */
-    hnode = sfxhash_find_node_row(t, key, &index);
+    hnode = sfxhash_find_node_row(t, key, &hashkey);
 
     if ( hnode )
     {
@@ -797,9 +1226,6 @@ SFXHASH_NODE* sfxhash_get_node(SFXHASH* t, const void* key)
     /* Copy the key */
     memcpy(hnode->key,key,t->keysize);
 
-    /* Save our table row index */
-    hnode->rindex = index;
-
     /* Copy the users data - or if datasize is zero set ptr to users data */
     if ( t->datasize )
     {
@@ -811,14 +1237,11 @@ SFXHASH_NODE* sfxhash_get_node(SFXHASH* t, const void* key)
         hnode->data = NULL;
     }
 
-    /* Link the node into the table row list */
-    sfxhash_link_node (t, hnode);
-
-    /* Link at the front of the global node list */
-    sfxhash_glink_node(t, hnode);
-
-    /* Track # active nodes */
-    t->count++;
+    if ( !sfxhash_insert_node(t, hnode, hashkey) )
+    {
+        sfxhash_release_node(t, hnode);
+        return NULL;
+    }
 
     return hnode;
 }
@@ -835,9 +1258,9 @@ SFXHASH_NODE* sfxhash_get_node(SFXHASH* t, const void* key)
  */
 SFXHASH_NODE* sfxhash_find_node(SFXHASH* t, const void* key)
 {
-    int rindex;
+    unsigned hashkey;
 
-    return sfxhash_find_node_row(t, key, &rindex);
+    return sfxhash_find_node_row(t, key, &hashkey);
 }
 
 /*!
@@ -853,9 +1276,9 @@ SFXHASH_NODE* sfxhash_find_node(SFXHASH* t, const void* key)
 void* sfxhash_find(SFXHASH* t, void* key)
 {
     SFXHASH_NODE* hnode;
-    int rindex;
+    unsigned hashkey;
 
-    hnode = sfxhash_find_node_row(t, key, &rindex);
+    hnode = sfxhash_find_node_row(t, key, &hashkey);
 
     if ( hnode )
         return hnode->data;
@@ -1035,7 +1458,24 @@ unsigned sfxhash_maxdepth(SFXHASH* t)
 
     SFXHASH_NODE* hnode;
 
-    for ( i=0; i<t->nrows; i++ )
+    // for open addressing, the depth is the number of groups probed
+    for ( i=0; t->slots && i<t->nrows; i++ )
+    {
+        if ( t->ctrl[i] & 0x80 )
+            continue;
+
+        unsigned mask = t->nrows / OA_GROUP - 1;
+        unsigned g = (oa_hash(t, t->slots[i]->key) >> 7) & mask;
+        unsigned cur_depth = 1;
+
+        while ( g != i / OA_GROUP )
+            g = (g + cur_depth++) & mask;
+
+        if (cur_depth > max_depth)
+            max_depth = cur_depth;
+    }
+
+    for ( i=0; t->table && i<t->nrows; i++ )
     {
         unsigned cur_depth = 0;
 
@@ -1056,11 +1496,21 @@ unsigned sfxhash_maxdepth(SFXHASH* t)
  */
 int sfxhash_free_node(SFXHASH* t, SFXHASH_NODE* hnode)
 {
-    sfxhash_unlink_node(t, hnode);   /* unlink from the hash table row list */
+    bool last_in_row = true;
+
+    if ( t->slots )
+        oa_erase(t, hnode);
+
+    else
+    {
+        sfxhash_unlink_node(t, hnode);   /* unlink from the hash table row list */
+        last_in_row = !t->table[hnode->rindex];
+    }
 
     sfxhash_gunlink_node(t, hnode);   /* unlink from global-hash-node list */
 
     t->count--;
+    hash_stats_remove(t->stats, last_in_row, t->count);
 
     if ( t->usrfree )
     {
@@ -1098,6 +1548,13 @@ int sfxhash_remove(SFXHASH* t, void* key)
         (unsigned char*)key,
         t->keysize);
 
+    if ( t->slots )
+    {
+        unsigned probes = 0;
+        hnode = oa_find(t, key, oa_mix(hashkey), probes);
+        return hnode ? sfxhash_free_node(t, hnode) : SFXHASH_ERR;
+    }
+
 //    index = hashkey % t->nrows;
     /* Modulus is slow */
     index   = hashkey & (t->nrows - 1);
@@ -1121,6 +1578,12 @@ static void sfxhash_next(SFXHASH* t)
     if ( !t->cnode )
         return;
 
+    if ( t->slots )
+    {
+        oa_seek(t, t->crow + 1);
+        return;
+    }
+
     /* Next node in current node list */
     t->cnode = t->cnode->next;
     if ( t->cnode )
@@ -1156,6 +1619,14 @@ SFXHASH_NODE* sfxhash_findfirst(SFXHASH* t)
     if (!t)
         return NULL;
 
+    if ( t->slots )
+    {
+        oa_seek(t, 0);
+        n = t->cnode;
+        sfxhash_next(t);
+        return n;
+    }
+
     /* Start with 1st row */
     for ( t->crow=0; t->crow < t->nrows; t->crow++ )
     {
@@ -1219,6 +1690,11 @@ int sfxhash_set_keyops(SFXHASH* h,
     return -1;
 }
 
+SfHashType sfxhash_set_hash_type(SFXHASH* h, SfHashType type)
+{
+    return sfhashfcn_set_type(h->sfhashfcn, type);
+}
+
 int sfxhash_add_return_data_ptr(SFXHASH* t, const void* key, void** data)
 {
     if ( !t->datasize )
@@ -1229,6 +1705,101 @@ int sfxhash_add_return_data_ptr(SFXHASH* t, const void* key, void** data)
     return sfxhash_add_ex(t, key, NULL, data);
 }
 
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+
+static unsigned oa_keys_found(SFXHASH* t)
+{
+    unsigned n = 0;
+
+    for ( SFXHASH_NODE* hnode = sfxhash_findfirst(t); hnode; hnode = sfxhash_findnext(t) )
+        ++n;
+
+    return n;
+}
+
+TEST_CASE("sfxhash open addressing", "[sfxhash]")
+{
+    SFXHASH* t = sfxhash_new(16, sizeof(unsigned), sizeof(unsigned), 0, 0, nullptr, nullptr, 1);
+    REQUIRE(sfxhash_set_open(t) == SFXHASH_OK);
+
+    // grows past the initial slots
+    for ( unsigned k = 0; k < 1000; ++k )
+    {
+        unsigned d = k + 1;
+        CHECK(sfxhash_add(t, &k, &d) == SFXHASH_OK);
+    }
+    CHECK(t->count == 1000);
+    CHECK(t->nrows >= 1024);
+
+    unsigned k = 7;
+    CHECK(sfxhash_add(t, &k, &k) == SFXHASH_INTABLE);
+
+    for ( k = 0; k < 1000; k += 2 )
+        CHECK(sfxhash_remove(t, &k) == SFXHASH_OK);
+
+    for ( k = 0; k < 1000; ++k )
+    {
+        unsigned* d = (unsigned*)sfxhash_find(t, &k);
+
+        if ( k & 1 )
+        {
+            REQUIRE(d);
+            CHECK(*d == k + 1);
+        }
+        else
+            CHECK(!d);
+    }
+    CHECK(oa_keys_found(t) == 500);
+    CHECK(sfxhash_remove(t, &k) == SFXHASH_ERR);
+
+    CHECK(sfxhash_make_empty(t) == 0);
+    CHECK(oa_keys_found(t) == 0);
+
+    sfxhash_delete(t);
+}
+
+TEST_CASE("sfxhash open addressing anr", "[sfxhash]")
+{
+    SFXHASH* t = sfxhash_new(64, sizeof(unsigned), 64, 16384, 1, nullptr, nullptr, 1);
+    REQUIRE(sfxhash_set_open(t) == SFXHASH_OK);
+
+    unsigned k = 0;
+    CHECK(sfxhash_add(t, &k, nullptr) == SFXHASH_OK);
+    CHECK(sfxhash_set_open(t) == SFXHASH_OK);
+
+    // keep finding key 0 while filling well past the memcap
+    for ( k = 1; k < 5000; ++k )
+    {
+        unsigned z = 0;
+        CHECK(sfxhash_add(t, &k, nullptr) == SFXHASH_OK);
+        CHECK(sfxhash_find(t, &z));
+    }
+    CHECK(t->anr_count > 0);
+    CHECK(t->count < 5000);
+    CHECK(t->mc.memused <= t->mc.memcap);
+    CHECK(oa_keys_found(t) == t->count);
+
+    k = 4999;
+    CHECK(sfxhash_find(t, &k));
+
+    sfxhash_delete(t);
+}
+
+TEST_CASE("sfxhash set open", "[sfxhash]")
+{
+    SFXHASH* t = sfxhash_new(64, sizeof(unsigned), 0, 0, 0, nullptr, nullptr, 0);
+
+    unsigned k = 1;
+    CHECK(sfxhash_add(t, &k, nullptr) == SFXHASH_OK);
+    CHECK(sfxhash_set_open(t) == SFXHASH_ERR);
+    CHECK(sfxhash_find_node(t, &k));
+
+    sfxhash_delete(t);
+}
+
+#endif
+
 /*
  * -----------------------------------------------------------------------------------------
  *   Test Driver for Hashing
@@ -32,7 +32,9 @@
 #include "utils/sfmemcap.h"
 #include "main/snort_types.h"
 
+struct HashStats;
 struct SFHASHFCN;
+enum SfHashType : uint8_t;
 
 #define SFXHASH_NOMEM    -2
 #define SFXHASH_ERR      -1
@@ -44,7 +46,7 @@ struct SFXHASH_NODE
     struct SFXHASH_NODE* gnext, * gprev; // global node list - used for ageing nodes
     struct SFXHASH_NODE* next,  * prev;  // row node list
 
-    int rindex;  // row index of table this node belongs to.
+    int rindex;  // row index of table this node belongs to (slot if open addressing)
 
     void* key;  // Pointer to the key.
     void* data; // Pointer to the users data, this is not copied !
@@ -91,6 +93,16 @@ struct SFXHASH
 
     SFXHASH_FREE_FCN anrfree;
     SFXHASH_FREE_FCN usrfree;
+
+    HashStats* stats;        // null unless named with sfxhash_set_stats()
+
+    // open addressing, see sfxhash_set_open(); table is null when set and
+    // nrows is the number of slots
+    SFXHASH_NODE** slots;
+    uint8_t* ctrl;           // per slot: 7 bits of hash, empty, or deleted
+    uint8_t* refs;           // per slot: clock reference bit for anr
+    unsigned nused;          // full + deleted slots
+    unsigned hand;           // clock hand for anr
 };
 
 SO_PUBLIC int sfxhash_calcrows(int num);
@@ -153,6 +165,15 @@ SO_PUBLIC void sfxhash_gmovetofront(SFXHASH* t, SFXHASH_NODE* hnode);
 
 SO_PUBLIC void sfxhash_splaymode(SFXHASH* h, int mode);
 
+// replace the rows of chained nodes with an open addressed array probed
+// 16 slots at a time.  with anr, the node recovered is picked by a clock
+// sweep over recently found nodes instead of a strict lru list so finds
+// don't relink anything.  must be called while the table is empty.
+SO_PUBLIC int sfxhash_set_open(SFXHASH* h);
+
+// name must outlive the table; see hash_stats.h
+SO_PUBLIC void sfxhash_set_stats(SFXHASH* h, const char* name);
+
 SO_PUBLIC void* sfxhash_alloc(SFXHASH* t, unsigned nbytes);
 SO_PUBLIC void sfxhash_free(SFXHASH* t, void* p);
 SO_PUBLIC int sfxhash_free_node(SFXHASH* t, SFXHASH_NODE* node);
@@ -163,6 +184,9 @@ SO_PUBLIC int sfxhash_set_keyops(SFXHASH* h,
     unsigned (* hash_fcn)(SFHASHFCN* p, unsigned char* d, int n),
     int (* keycmp_fcn)(const void* s1, const void* s2, size_t n));
 
+// select the hash family while the table is empty; see sfhashfcn.h
+SO_PUBLIC SfHashType sfxhash_set_hash_type(SFXHASH* h, SfHashType);
+
 SO_PUBLIC SFXHASH_NODE* sfxhash_gfindfirst(SFXHASH* t);
 SO_PUBLIC SFXHASH_NODE* sfxhash_gfindnext(SFXHASH* t);
 SO_PUBLIC int sfxhash_add_return_data_ptr(SFXHASH* t, const void* key, void** data);
@@ -0,0 +1,236 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// lru_cache_sharded_test.cc
+// unit tests for LruCacheSharded class
+
+#include "hash/lru_cache_sharded.h"
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness.h>
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <string.h>
+
+//  Identity hash so the tests know which shard a key lands in.
+struct IntIdHash
+{
+    size_t operator()(int i) const
+    { return (size_t)i; }
+};
+
+TEST_GROUP(lru_cache_sharded)
+{
+};
+
+//  Test constructor, shard rounding and size split.
+TEST(lru_cache_sharded, constructor_test)
+{
+    LruCacheSharded<int, std::string, std::hash<int> > lru_cache(100, 5);
+
+    CHECK(lru_cache.get_shards() == 8);
+    CHECK(lru_cache.get_max_size() == 100);
+    CHECK(lru_cache.size() == 0);
+    CHECK(!lru_cache.get_read_mostly());
+
+    CHECK(!lru_cache.set_max_size(0));
+    CHECK(lru_cache.get_max_size() == 100);
+}
+
+//  With one shard the sharded cache must behave exactly like LruCacheShared.
+TEST(lru_cache_sharded, single_shard_lru_test)
+{
+    std::string data;
+    LruCacheSharded<int, std::string, std::hash<int> > lru_cache(5, 1);
+
+    for (int i = 0; i < 10; i++)
+        lru_cache.insert(i, std::to_string(i));
+
+    CHECK(5 == lru_cache.size());
+    CHECK(true == lru_cache.find(5, data));   //  5 becomes most recent
+    CHECK("5" == data);
+
+    lru_cache.insert(10, "10");                 //  prunes 6
+    CHECK(false == lru_cache.find(6, data));
+
+    auto vec = lru_cache.get_all_data();
+    CHECK(5 == vec.size());
+    CHECK((vec[0] == std::make_pair(10, std::string("10"))));
+    CHECK((vec[1] == std::make_pair(5, std::string("5"))));
+    CHECK((vec[2] == std::make_pair(9, std::string("9"))));
+    CHECK((vec[3] == std::make_pair(8, std::string("8"))));
+    CHECK((vec[4] == std::make_pair(7, std::string("7"))));
+}
+
+//  In read-mostly mode a referenced entry survives one pass of the hand.
+TEST(lru_cache_sharded, clock_test)
+{
+    std::string data;
+    LruCacheSharded<int, std::string, std::hash<int> > lru_cache(3, 1, true);
+
+    lru_cache.insert(0, "zero");
+    lru_cache.insert(1, "one");
+    lru_cache.insert(2, "two");
+
+    //  find does not reorder but marks 0 as referenced.
+    CHECK(true == lru_cache.find(0, data));
+    auto vec = lru_cache.get_all_data();
+    CHECK((vec[2] == std::make_pair(0, std::string("zero"))));
+
+    //  0 gets a second chance so 1 is pruned instead.
+    lru_cache.insert(3, "three");
+    CHECK(3 == lru_cache.size());
+    CHECK(true == lru_cache.find(0, data, false));
+    CHECK(false == lru_cache.find(1, data));
+
+    //  All referenced: the hand clears every bit then prunes the oldest.
+    lru_cache.find(2, data);
+    lru_cache.find(3, data);
+    lru_cache.find(0, data);
+    lru_cache.insert(4, "four");
+    CHECK(3 == lru_cache.size());
+    CHECK(false == lru_cache.find(2, data));
+}
+
+//  Each shard prunes independently once its share is used up.
+TEST(lru_cache_sharded, shard_prune_test)
+{
+    std::string data;
+    LruCacheSharded<int, std::string, IntIdHash> lru_cache(8, 4);
+
+    for (int i = 0; i < 100; i++)
+        lru_cache.insert(i, std::to_string(i));
+
+    CHECK(8 == lru_cache.size());
+
+    //  The newest key to land in each shard must still be there.
+    for (int i = 96; i < 100; i++)
+        CHECK(true == lru_cache.find(i, data));
+
+    CHECK(true == lru_cache.set_max_size(4));
+    CHECK(4 == lru_cache.size());
+
+    lru_cache.clear();
+    CHECK(0 == lru_cache.size());
+}
+
+//  Eviction takes the oldest entries and stops when every shard is empty.
+TEST(lru_cache_sharded, evict_test)
+{
+    std::string data;
+    LruCacheSharded<int, std::string, std::hash<int> > lru_cache(5, 1);
+
+    for (int i = 0; i < 5; i++)
+        lru_cache.insert(i, std::to_string(i));
+
+    CHECK(2 == lru_cache.evict(2));
+    CHECK(3 == lru_cache.size());
+    CHECK(false == lru_cache.find(0, data));
+    CHECK(false == lru_cache.find(1, data));
+    CHECK(true == lru_cache.find(2, data));
+
+    LruCacheSharded<int, std::string, IntIdHash> sharded(8, 4);
+
+    for (int i = 0; i < 6; i++)
+        sharded.insert(i, std::to_string(i));
+
+    CHECK(6 == sharded.evict(10));
+    CHECK(0 == sharded.size());
+    CHECK(0 == sharded.evict(1));
+}
+
+//  Statistics are summed across shards.
+TEST(lru_cache_sharded, stats_test)
+{
+    std::string data;
+    LruCacheSharded<int, std::string, std::hash<int> > lru_cache(5, 1);
+
+    for (int i = 0; i < 10; i++)
+        lru_cache.insert(i, std::to_string(i));
+
+    lru_cache.insert(8, "new-eight");
+    lru_cache.insert(9, "new-nine");
+
+    lru_cache.find(7, data);
+    lru_cache.find(8, data);
+    lru_cache.set_read_mostly(true);
+    lru_cache.find(9, data);
+
+    lru_cache.remove(7);
+    lru_cache.remove(8);
+    lru_cache.remove(9, data);
+    CHECK("new-nine" == data);
+
+    lru_cache.find(8, data);
+    lru_cache.find(9, data);
+    lru_cache.remove(100);
+    lru_cache.clear();
+
+    PegCount* stats = lru_cache.get_counts();
+
+    CHECK(stats[0] == 10);  //  adds
+    CHECK(stats[1] == 2);   //  replaces
+    CHECK(stats[2] == 5);   //  prunes
+    CHECK(stats[3] == 3);   //  find hits
+    CHECK(stats[4] == 2);   //  find misses
+    CHECK(stats[5] == 3);   //  removes
+    CHECK(stats[6] == 1);   //  clears
+
+    const PegInfo* pegs = lru_cache.get_pegs();
+    CHECK(!strcmp(pegs[0].name, "lru cache adds"));
+}
+
+//  Concurrent readers and writers must not lose or corrupt entries.
+TEST(lru_cache_sharded, threads_test)
+{
+    LruCacheSharded<int, int, std::hash<int> > lru_cache(1024, 8, true);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; t++)
+    {
+        threads.push_back(std::thread([&lru_cache, t]()
+        {
+            int data;
+
+            for (int i = 0; i < 10000; i++)
+            {
+                int key = (i * 7 + t) % 512;
+
+                if ( t == 0 )
+                    lru_cache.insert(key, key);
+
+                else if ( lru_cache.find(key, data) )
+                    CHECK(data == key);
+            }
+        }));
+    }
+
+    for (auto& t : threads)
+        t.join();
+
+    CHECK(lru_cache.size() <= 1024);
+}
+
+int main(int argc, char** argv)
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
+
@@ -23,7 +23,12 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <new>
+
+#include "hash_stats.h"
+#include "memory/memory_allocator.h"
 #include "sfhashfcn.h"
 #include "utils/util.h"
 
@@ -39,12 +44,39 @@ struct ZHashNode
     ZHashNode* next = nullptr;  // row list
     ZHashNode* prev = nullptr;  // row list
 
-    int rindex = 0;
+    int rindex = 0;        // row, or bucket << 3 | slot
+    unsigned hash = 0;     // for buckets
 
     void* key = nullptr;
     void* data = nullptr;
 };
 
+//-------------------------------------------------------------------------
+// buckets
+//
+// a lookup checks the tags of its home bucket, one cache line, and only
+// touches the nodes with matching tags.  a node that doesn't fit in its
+// home bucket goes in the next one with room and each bucket passed over
+// counts it as overflow so lookups know when to keep going.  overflow
+// saturates and then is never decremented.
+//-------------------------------------------------------------------------
+
+#define ZB_SLOTS 7
+#define ZB_LINE 64
+
+struct ZHashBucket
+{
+    uint8_t tags[ZB_SLOTS];  // 0 is empty
+    uint8_t overflow;
+    ZHashNode* nodes[ZB_SLOTS];
+};
+
+static_assert(sizeof(ZHashBucket) == ZB_LINE, "buckets are one cache line");
+
+// low bits pick the bucket
+static inline uint8_t zb_tag(unsigned hash)
+{ return 0x80 | (hash >> 25); }
+
 static inline ZHashNode* s_node_alloc(int keysize)
 {
     auto node = static_cast<ZHashNode*>(
@@ -181,7 +213,7 @@ void ZHash::unlink_node(ZHashNode* node)
 void ZHash::move_to_front(ZHashNode* node)
 {
     // move to front of row list
-    if ( table[node->rindex] != node )
+    if ( table and table[node->rindex] != node )
     {
         unlink_node(node);
         link_node(node);
@@ -195,30 +227,131 @@ void ZHash::move_to_front(ZHashNode* node)
     }
 }
 
-ZHashNode* ZHash::find_node_row(const void* key, int* rindex)
+ZHashNode* ZHash::find_node_row(const void* key, unsigned* hash)
 {
     unsigned hashkey = sfhashfcn->hash_fcn(
         sfhashfcn, (unsigned char*)key, keysize);
 
+    *hash = hashkey;
+
+    if ( buckets )
+        return find_in_bucket(key, hashkey);
+
     // Modulus is slow; use a table size that is a power of 2.
-    int index = hashkey & (nrows - 1);
+    return find_in_row(key, hashkey & (nrows - 1));
+}
 
-    *rindex = index;
+ZHashNode* ZHash::find_in_row(const void* key, int index)
+{
+    unsigned probes = 0;
 
     for ( ZHashNode* node=table[index]; node; node=node->next )  // UNINITUSE
     {
+        probes++;
+
         if ( !sfhashfcn->keycmp_fcn(node->key,key,keysize) )
         {
             move_to_front(node);
             find_success++;
+            hash_stats_lookup(stats, probes, true);
             return node;
         }
     }
 
     find_fail++;
+    hash_stats_lookup(stats, probes, false);
+    return nullptr;
+}
+
+ZHashNode* ZHash::find_in_bucket(const void* key, unsigned hash)
+{
+    unsigned mask = nrows - 1;
+    unsigned b = hash & mask;
+    uint8_t tag = zb_tag(hash);
+    unsigned probes = 0;
+
+    for ( unsigned i = 0; i < nrows; ++i )
+    {
+        const ZHashBucket& bkt = buckets[b];
+
+        for ( unsigned s = 0; s < ZB_SLOTS; ++s )
+        {
+            if ( bkt.tags[s] != tag )
+                continue;
+
+            ZHashNode* node = bkt.nodes[s];
+            probes++;
+
+            if ( !sfhashfcn->keycmp_fcn(node->key, key, keysize) )
+            {
+                move_to_front(node);
+                find_success++;
+                hash_stats_lookup(stats, probes, true);
+                return node;
+            }
+        }
+        if ( !bkt.overflow )
+            break;
+
+        b = (b + 1) & mask;
+    }
+
+    find_fail++;
+    hash_stats_lookup(stats, probes, false);
     return nullptr;
 }
 
+// there is always room since get() checks the count
+void ZHash::bucket_link(ZHashNode* node, unsigned hash)
+{
+    unsigned mask = nrows - 1;
+    unsigned b = hash & mask;
+
+    while ( true )
+    {
+        ZHashBucket& bkt = buckets[b];
+
+        for ( unsigned s = 0; s < ZB_SLOTS; ++s )
+        {
+            if ( bkt.tags[s] )
+                continue;
+
+            bkt.tags[s] = zb_tag(hash);
+            bkt.nodes[s] = node;
+            node->rindex = (b << 3) | s;
+            node->hash = hash;
+            return;
+        }
+        if ( bkt.overflow < UINT8_MAX )
+            bkt.overflow++;
+
+        b = (b + 1) & mask;
+    }
+}
+
+// returns true if the bucket is now empty
+bool ZHash::bucket_unlink(ZHashNode* node)
+{
+    unsigned mask = nrows - 1;
+    unsigned last = node->rindex >> 3;
+    ZHashBucket& bkt = buckets[last];
+
+    bkt.tags[node->rindex & 7] = 0;
+    bkt.nodes[node->rindex & 7] = nullptr;
+
+    for ( unsigned b = node->hash & mask; b != last; b = (b + 1) & mask )
+    {
+        if ( buckets[b].overflow < UINT8_MAX )
+            buckets[b].overflow--;
+    }
+
+    for ( unsigned s = 0; s < ZB_SLOTS; ++s )
+        if ( bkt.tags[s] )
+            return false;
+
+    return true;
+}
+
 int ZHash::nearest_powerof2(int rows)
 {
     rows -= 1;
@@ -234,7 +367,7 @@ int ZHash::nearest_powerof2(int rows)
 // public stuff
 //-------------------------------------------------------------------------
 
-ZHash::ZHash(int rows, int keysz)
+ZHash::ZHash(int rows, int keysz, bool use_buckets)
 {
     if ( rows > 0 )
     {
@@ -253,8 +386,34 @@ ZHash::ZHash(int rows, int keysz)
     /* this has a default hashing function */
     sfhashfcn = sfhashfcn_new(rows);
 
-    /* Allocate the array of node ptrs */
-    table = new ZHashNode*[rows]();
+    table = nullptr;
+    buckets = nullptr;
+    bucket_mem = nullptr;
+
+    if ( use_buckets )
+    {
+        // 7 slots per bucket keeps the load under 4/7
+        rows = nearest_powerof2((rows + 3) / 4);
+
+        // the extra line is for alignment
+        bucket_mem = memory::MemoryAllocator::allocate_large(
+            (rows + 1) * sizeof(ZHashBucket), "zhash buckets");
+
+        if ( !bucket_mem )
+            throw std::bad_alloc();
+
+        uintptr_t p = ((uintptr_t)bucket_mem + ZB_LINE - 1) & ~(uintptr_t)(ZB_LINE - 1);
+        buckets = (ZHashBucket*)p;
+    }
+    else
+    {
+        /* Allocate the array of node ptrs; big ones are flow tables */
+        table = static_cast<ZHashNode**>(memory::MemoryAllocator::allocate_large(
+            rows * sizeof(ZHashNode*), "zhash table"));
+
+        if ( !table )
+            throw std::bad_alloc();
+    }
 
     keysize = keysz;
     nrows = rows;
@@ -262,6 +421,7 @@ ZHash::ZHash(int rows, int keysz)
     fhead = cursor = nullptr;
     ghead = gtail = nullptr;
     count = find_success = find_fail = 0;
+    stats = nullptr;
 }
 
 ZHash::~ZHash()
@@ -280,9 +440,22 @@ ZHash::~ZHash()
                 s_node_free(onode);
             }
         }
-        delete[] table;
+        memory::MemoryAllocator::deallocate_large(table, nrows * sizeof(ZHashNode*));
+    }
+    else if ( buckets )
+    {
+        for ( unsigned i = 0; i < nrows; ++i )
+        {
+            for ( unsigned s = 0; s < ZB_SLOTS; ++s )
+            {
+                if ( buckets[i].tags[s] )
+                    s_node_free(buckets[i].nodes[s]);
+            }
+        }
+        memory::MemoryAllocator::deallocate_large(bucket_mem, (nrows + 1) * sizeof(ZHashBucket));
     }
     delete_free_list();
+    hash_stats_detach(stats);
 }
 
 void* ZHash::push(void* p)
@@ -311,32 +484,139 @@ void* ZHash::pop()
 
 void* ZHash::get(const void* key)
 {
-    int index = 0;
-    ZHashNode* node = find_node_row(key, &index);
+    unsigned hashkey = 0;
+    ZHashNode* node = find_node_row(key, &hashkey);
 
     if ( node )
         return node->data;
 
+    if ( buckets and count >= nrows * ZB_SLOTS )
+        return nullptr;
+
     node = get_free_node();
 
     if ( !node )
         return nullptr;
 
     memcpy(node->key,key,keysize);
+    bool first_in_row;
 
-    node->rindex = index;
-    link_node (node);
+    if ( buckets )
+    {
+        unsigned b = hashkey & (nrows - 1);
+        first_in_row = !buckets[b].tags[0];
+
+        for ( unsigned s = 1; s < ZB_SLOTS and first_in_row; ++s )
+            first_in_row = !buckets[b].tags[s];
+
+        bucket_link(node, hashkey);
+    }
+    else
+    {
+        int index = hashkey & (nrows - 1);
+        node->rindex = index;
+        first_in_row = !table[index];
+        link_node (node);
+    }
     glink_node(node);
 
     count++;
+    hash_stats_insert(stats, first_in_row, count);
 
     return node->data;
 }
 
+// rows are done in chunks so the prefetches are still in cache when used
+#define ZHASH_BATCH 16
+
+void ZHash::find_batch(const void* const* keys, unsigned n, void** data)
+{
+    int rows[ZHASH_BATCH];
+
+    if ( buckets )
+    {
+        unsigned hashes[ZHASH_BATCH];
+
+        while ( n )
+        {
+            unsigned m = n < ZHASH_BATCH ? n : ZHASH_BATCH;
+
+            for ( unsigned i = 0; i < m; ++i )
+            {
+                hashes[i] = sfhashfcn->hash_fcn(
+                    sfhashfcn, (unsigned char*)keys[i], keysize);
+
+                __builtin_prefetch(buckets + (hashes[i] & (nrows - 1)));
+            }
+
+            // the first node with a matching tag is almost always the one
+            for ( unsigned i = 0; i < m; ++i )
+            {
+                const ZHashBucket& bkt = buckets[hashes[i] & (nrows - 1)];
+                uint8_t tag = zb_tag(hashes[i]);
+
+                for ( unsigned s = 0; s < ZB_SLOTS; ++s )
+                {
+                    if ( bkt.tags[s] == tag )
+                    {
+                        __builtin_prefetch(bkt.nodes[s]);
+                        break;
+                    }
+                }
+            }
+
+            for ( unsigned i = 0; i < m; ++i )
+            {
+                ZHashNode* node = find_in_bucket(keys[i], hashes[i]);
+                data[i] = node ? node->data : nullptr;
+            }
+
+            keys += m;
+            data += m;
+            n -= m;
+        }
+        return;
+    }
+
+    while ( n )
+    {
+        unsigned m = n < ZHASH_BATCH ? n : ZHASH_BATCH;
+
+        for ( unsigned i = 0; i < m; ++i )
+        {
+            unsigned hashkey = sfhashfcn->hash_fcn(
+                sfhashfcn, (unsigned char*)keys[i], keysize);
+
+            rows[i] = hashkey & (nrows - 1);
+            __builtin_prefetch(table + rows[i]);
+        }
+
+        // the first node holds the key and the data pointer
+        for ( unsigned i = 0; i < m; ++i )
+        {
+            if ( ZHashNode* node = table[rows[i]] )
+            {
+                __builtin_prefetch(node);
+                __builtin_prefetch(node->data);
+            }
+        }
+
+        for ( unsigned i = 0; i < m; ++i )
+        {
+            ZHashNode* node = find_in_row(keys[i], rows[i]);
+            data[i] = node ? node->data : nullptr;
+        }
+
+        keys += m;
+        data += m;
+        n -= m;
+    }
+}
+
 void* ZHash::find(const void* key)
 {
-    int rindex = 0;
-    ZHashNode* node = find_node_row(key, &rindex);
+    unsigned hashkey = 0;
+    ZHashNode* node = find_node_row(key, &hashkey);
 
     if ( node )
         return node->data;
@@ -387,10 +667,19 @@ bool ZHash::remove(ZHashNode* node)
     if ( !node )
         return false;
 
-    unlink_node(node);
+    bool last_in_row;
+
+    if ( buckets )
+        last_in_row = bucket_unlink(node);
+    else
+    {
+        unlink_node(node);
+        last_in_row = !table[node->rindex];
+    }
     gunlink_node(node);
 
     count--;
+    hash_stats_remove(stats, last_in_row, count);
     save_free_node(node);
 
     return true;
@@ -405,11 +694,17 @@ bool ZHash::remove()
 
 bool ZHash::remove(const void* key)
 {
-    int row = 0;
-    ZHashNode* node = find_node_row(key, &row);
+    unsigned hashkey = 0;
+    ZHashNode* node = find_node_row(key, &hashkey);
     return remove(node);
 }
 
+void ZHash::set_stats(const char* name)
+{
+    hash_stats_detach(stats);
+    stats = hash_stats_attach(name, nrows);
+}
+
 int ZHash::set_keyops(
     unsigned (* hash_fcn)(SFHASHFCN* p, unsigned char* d, int n),
     int (* keycmp_fcn)(const void* s1, const void* s2, size_t n))
@@ -420,3 +715,73 @@ int ZHash::set_keyops(
     return -1;
 }
 
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+
+// every key lands in bucket 0 to exercise overflow
+static unsigned zb_same_hash(SFHASHFCN*, unsigned char* d, int)
+{ return *(unsigned*)d << 25; }
+
+static int zb_cmp(const void* s1, const void* s2, size_t n)
+{ return memcmp(s1, s2, n); }
+
+TEST_CASE("zhash buckets", "[zhash]")
+{
+    const unsigned max = 64;
+    ZHash t(max, sizeof(unsigned), true);
+    unsigned data[max];
+
+    for ( unsigned i = 0; i < max; ++i )
+        t.push(data + i);
+
+    SECTION("collisions overflow")
+    {
+        REQUIRE(!t.set_keyops(zb_same_hash, zb_cmp));
+
+        for ( unsigned k = 0; k < 20; ++k )
+            CHECK(t.get(&k));
+
+        CHECK(t.get_count() == 20);
+
+        for ( unsigned k = 0; k < 20; k += 2 )
+            CHECK(t.remove(&k));
+
+        for ( unsigned k = 0; k < 20; ++k )
+            CHECK((t.find(&k) != nullptr) == (k & 1));
+
+        unsigned k = 40;
+        CHECK(t.get(&k));
+        CHECK(t.find(&k));
+    }
+
+    SECTION("batch")
+    {
+        const void* keys[max];
+        void* found[max];
+        unsigned vals[max];
+
+        for ( unsigned k = 0; k < max; ++k )
+        {
+            vals[k] = k * 7919;
+            keys[k] = vals + k;
+
+            if ( k & 1 )
+                CHECK(t.get(keys[k]));
+        }
+        t.find_batch(keys, max, found);
+
+        for ( unsigned k = 0; k < max; ++k )
+            CHECK((found[k] != nullptr) == (k & 1));
+
+        // lru order is kept
+        CHECK(t.first() == found[1]);
+    }
+
+    while ( t.first() )
+        t.remove();
+
+    CHECK(t.get_count() == 0);
+}
+
+#endif
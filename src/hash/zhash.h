@@ -22,13 +22,17 @@
 
 #include <cstddef>
 
+struct HashStats;
 struct SFHASHFCN;
+struct ZHashBucket;
 struct ZHashNode;
 
 class ZHash
 {
 public:
-    ZHash(int nrows, int keysize);
+    // with buckets, nodes are indexed by cache line buckets of hash tags
+    // instead of rows of chained nodes; the table holds at most 7/4 nrows
+    ZHash(int nrows, int keysize, bool buckets = false);
     ~ZHash();
 
     void* push(void* p);
@@ -42,18 +46,30 @@ public:
     void* find(const void* key);
     void* get(const void* key);
 
+    // same as find() for each key but all rows are hashed and prefetched
+    // before any are searched so the cache misses overlap
+    void find_batch(const void* const* keys, unsigned n, void** data);
+
     bool remove(const void* key);
     bool remove();
 
     inline unsigned get_count() { return count; }
 
+    // name must outlive the table; see hash_stats.h
+    void set_stats(const char* name);
+
     int set_keyops(
         unsigned (* hash_fcn)(SFHASHFCN* p, unsigned char* d, int n),
         int (* keycmp_fcn)(const void* s1, const void* s2, size_t n));
 
 private:
     ZHashNode* get_free_node();
-    ZHashNode* find_node_row(const void*, int*);
+    ZHashNode* find_node_row(const void*, unsigned* hash);
+    ZHashNode* find_in_row(const void*, int);
+    ZHashNode* find_in_bucket(const void*, unsigned hash);
+
+    void bucket_link(ZHashNode*, unsigned hash);
+    bool bucket_unlink(ZHashNode*);
 
     void glink_node(ZHashNode*);
     void gunlink_node(ZHashNode*);
@@ -79,9 +95,14 @@ private:
     unsigned find_success;
 
     ZHashNode** table;
+    ZHashBucket* buckets;
+    void* bucket_mem;
+
     ZHashNode* ghead, * gtail;
     ZHashNode* fhead;
     ZHashNode* cursor;
+
+    HashStats* stats;
 };
 
 #endif
@@ -0,0 +1,331 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// atomic_ring.h
+
+#ifndef ATOMIC_RING_H
+#define ATOMIC_RING_H
+
+// Bounded lock-free rings for passing data between threads.
+//
+// SpscRing is for exactly one producer and one consumer thread.  MpscRing
+// allows any number of producers but still only one consumer.  Sizes are
+// rounded up to a power of 2 and all of them are usable.
+//
+// The reader and writer indices live on separate cache lines so the two
+// sides don't false share.  Each side keeps a private copy of the other's
+// index and only reloads it when the ring looks full or empty.
+
+#include <atomic>
+
+#define ATOMIC_RING_LINE 64
+
+inline unsigned atomic_ring_size(unsigned n)
+{
+    unsigned sz = 2;
+
+    while ( sz < n )
+        sz <<= 1;
+
+    return sz;
+}
+
+//-------------------------------------------------------------------------
+// single producer, single consumer
+//-------------------------------------------------------------------------
+
+template <typename T>
+class SpscRing
+{
+public:
+    SpscRing(unsigned size);
+    ~SpscRing();
+
+    // producer side; return false or the number written
+    bool put(const T&);
+    unsigned put(const T*, unsigned n);
+
+    // consumer side; return false or the number read
+    bool get(T&);
+    unsigned get(T*, unsigned n);
+
+    unsigned count() const;
+    bool empty() const
+    { return count() == 0; }
+    bool full() const
+    { return count() == mask + 1; }
+
+private:
+    T* store;
+    unsigned mask;
+
+    char pad0[ATOMIC_RING_LINE];
+
+    // consumer
+    std::atomic<unsigned> rx;
+    unsigned wx_cache;
+
+    char pad1[ATOMIC_RING_LINE];
+
+    // producer
+    std::atomic<unsigned> wx;
+    unsigned rx_cache;
+
+    char pad2[ATOMIC_RING_LINE];
+};
+
+template <typename T>
+SpscRing<T>::SpscRing(unsigned size)
+{
+    unsigned sz = atomic_ring_size(size);
+    store = new T[sz];
+    mask = sz - 1;
+    rx.store(0, std::memory_order_relaxed);
+    wx.store(0, std::memory_order_relaxed);
+    rx_cache = wx_cache = 0;
+}
+
+template <typename T>
+SpscRing<T>::~SpscRing()
+{
+    delete[] store;
+}
+
+template <typename T>
+unsigned SpscRing<T>::put(const T* v, unsigned n)
+{
+    unsigned w = wx.load(std::memory_order_relaxed);
+    unsigned avail = mask + 1 - (w - rx_cache);
+
+    if ( avail < n )
+    {
+        rx_cache = rx.load(std::memory_order_acquire);
+        avail = mask + 1 - (w - rx_cache);
+
+        if ( avail < n )
+            n = avail;
+    }
+
+    for ( unsigned i = 0; i < n; ++i )
+        store[(w + i) & mask] = v[i];
+
+    // publish the entries after they are written
+    wx.store(w + n, std::memory_order_release);
+    return n;
+}
+
+template <typename T>
+bool SpscRing<T>::put(const T& v)
+{
+    return put(&v, 1) == 1;
+}
+
+template <typename T>
+unsigned SpscRing<T>::get(T* v, unsigned n)
+{
+    unsigned r = rx.load(std::memory_order_relaxed);
+    unsigned avail = wx_cache - r;
+
+    if ( avail < n )
+    {
+        wx_cache = wx.load(std::memory_order_acquire);
+        avail = wx_cache - r;
+
+        if ( avail < n )
+            n = avail;
+    }
+
+    for ( unsigned i = 0; i < n; ++i )
+        v[i] = store[(r + i) & mask];
+
+    // release the slots after they are read
+    rx.store(r + n, std::memory_order_release);
+    return n;
+}
+
+template <typename T>
+bool SpscRing<T>::get(T& v)
+{
+    return get(&v, 1) == 1;
+}
+
+template <typename T>
+unsigned SpscRing<T>::count() const
+{
+    return wx.load(std::memory_order_acquire) - rx.load(std::memory_order_acquire);
+}
+
+//-------------------------------------------------------------------------
+// multiple producer, single consumer
+//
+// each slot carries a sequence number: pos when free for the producer
+// that claimed pos and pos + 1 once filled.  producers claim positions
+// with a CAS on wx and the consumer hands the slot back for the next lap.
+//-------------------------------------------------------------------------
+
+template <typename T>
+class MpscRing
+{
+public:
+    MpscRing(unsigned size);
+    ~MpscRing();
+
+    // any thread; return false or the number written
+    bool put(const T&);
+    unsigned put(const T*, unsigned n);
+
+    // consumer thread only; return false or the number read
+    bool get(T&);
+    unsigned get(T*, unsigned n);
+
+    // approximate when producers are active
+    unsigned count() const;
+    bool empty() const
+    { return count() == 0; }
+
+private:
+    struct Slot
+    {
+        std::atomic<unsigned> seq;
+        T data;
+    };
+
+    Slot* slots;
+    unsigned mask;
+
+    char pad0[ATOMIC_RING_LINE];
+
+    // consumer
+    std::atomic<unsigned> rx;
+
+    char pad1[ATOMIC_RING_LINE];
+
+    // producers
+    std::atomic<unsigned> wx;
+
+    char pad2[ATOMIC_RING_LINE];
+};
+
+template <typename T>
+MpscRing<T>::MpscRing(unsigned size)
+{
+    unsigned sz = atomic_ring_size(size);
+    slots = new Slot[sz];
+    mask = sz - 1;
+
+    for ( unsigned i = 0; i < sz; ++i )
+        slots[i].seq.store(i, std::memory_order_relaxed);
+
+    rx.store(0, std::memory_order_relaxed);
+    wx.store(0, std::memory_order_relaxed);
+}
+
+template <typename T>
+MpscRing<T>::~MpscRing()
+{
+    delete[] slots;
+}
+
+template <typename T>
+unsigned MpscRing<T>::put(const T* v, unsigned n)
+{
+    if ( !n )
+        return 0;
+
+    unsigned pos = wx.load(std::memory_order_relaxed);
+
+    // claim a run of up to n free slots starting at pos
+    while ( true )
+    {
+        int dif = (int)(slots[pos & mask].seq.load(std::memory_order_acquire) - pos);
+
+        if ( dif < 0 )
+            return 0;  // full
+
+        if ( dif > 0 )
+        {
+            pos = wx.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        unsigned k = 1;
+
+        while ( k < n and
+            slots[(pos + k) & mask].seq.load(std::memory_order_acquire) == pos + k )
+            ++k;
+
+        if ( wx.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed) )
+        {
+            n = k;
+            break;
+        }
+    }
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        Slot& s = slots[(pos + i) & mask];
+        s.data = v[i];
+        s.seq.store(pos + i + 1, std::memory_order_release);
+    }
+    return n;
+}
+
+template <typename T>
+bool MpscRing<T>::put(const T& v)
+{
+    return put(&v, 1) == 1;
+}
+
+template <typename T>
+unsigned MpscRing<T>::get(T* v, unsigned n)
+{
+    unsigned r = rx.load(std::memory_order_relaxed);
+    unsigned i = 0;
+
+    // stop at the first slot that isn't filled yet to preserve order
+    while ( i < n )
+    {
+        Slot& s = slots[(r + i) & mask];
+
+        if ( s.seq.load(std::memory_order_acquire) != r + i + 1 )
+            break;
+
+        v[i] = s.data;
+        s.seq.store(r + i + mask + 1, std::memory_order_release);
+        ++i;
+    }
+
+    rx.store(r + i, std::memory_order_relaxed);
+    return i;
+}
+
+template <typename T>
+bool MpscRing<T>::get(T& v)
+{
+    return get(&v, 1) == 1;
+}
+
+template <typename T>
+unsigned MpscRing<T>::count() const
+{
+    unsigned w = wx.load(std::memory_order_acquire);
+    unsigned r = rx.load(std::memory_order_acquire);
+    return w - r;
+}
+
+#endif
+
@@ -21,6 +21,12 @@
 #define RING_LOGIC_H
 
 // Logic for simple ring implementation
+//
+// safe for one reader and one writer on different threads (or a signal
+// handler): the writer publishes wx with release semantics after filling
+// the slot and the reader publishes rx after consuming it.
+
+#include <atomic>
 
 class RingLogic
 {
@@ -45,58 +51,60 @@ private:
 
 private:
     int sz;
-    volatile int rx;
-    volatile int wx;
+    std::atomic<int> rx;
+    std::atomic<int> wx;
 };
 
 inline RingLogic::RingLogic(int size)
 {
     sz = size;
-    rx = 0;
-    wx = 1;
+    rx.store(0, std::memory_order_relaxed);
+    wx.store(1, std::memory_order_relaxed);
 }
 
 inline int RingLogic::read()
 {
-    int nx = next(rx);
-    return ( nx == wx ) ? -1 : nx;
+    int nx = next(rx.load(std::memory_order_relaxed));
+    return ( nx == wx.load(std::memory_order_acquire) ) ? -1 : nx;
 }
 
 inline int RingLogic::write()
 {
-    int nx = next(wx);
-    return ( nx == rx ) ? -1 : wx;
+    int ix = wx.load(std::memory_order_relaxed);
+    return ( next(ix) == rx.load(std::memory_order_acquire) ) ? -1 : ix;
 }
 
 inline bool RingLogic::push()
 {
-    int nx = next(wx);
-    if ( nx == rx )
+    int nx = next(wx.load(std::memory_order_relaxed));
+    if ( nx == rx.load(std::memory_order_acquire) )
         return false;
-    wx = nx;
+    wx.store(nx, std::memory_order_release);
     return true;
 }
 
 inline bool RingLogic::pop()
 {
-    int nx = next(rx);
-    if ( nx == wx )
+    int nx = next(rx.load(std::memory_order_relaxed));
+    if ( nx == wx.load(std::memory_order_acquire) )
         return false;
-    rx = nx;
+    rx.store(nx, std::memory_order_release);
     return true;
 }
 
 inline int RingLogic::count()
 {
-    int c = wx - rx - 1;
+    int c = wx.load(std::memory_order_acquire) - rx.load(std::memory_order_acquire) - 1;
     if ( c < 0 )
         c += sz;
     return c;
 }
 
+// one slot is the read position and one is kept open to tell full from
+// empty so at most sz - 2 entries are queued
 inline bool RingLogic::full()
 {
-    return ( count() == sz );
+    return ( count() == sz - 2 );
 }
 
 inline bool RingLogic::empty()
@@ -22,25 +22,28 @@
 
 // used to make thread local, pointer-based config swaps by packet threads
 
+#include "detection/detection_options.h"
+
 struct SnortConfig;
-struct tTargetBasedConfig;
 
 class Swapper
 {
 public:
-    Swapper(SnortConfig*, tTargetBasedConfig*);
+    Swapper(SnortConfig*);
     Swapper(SnortConfig*, SnortConfig*);
-    Swapper(tTargetBasedConfig*, tTargetBasedConfig*);
+    Swapper(DotTrash*);
     ~Swapper();
 
     void apply();
 
+    bool is_reload() const
+    { return new_conf != nullptr; }
+
 private:
     SnortConfig* old_conf;
     SnortConfig* new_conf;
 
-    tTargetBasedConfig* old_attribs;
-    tTargetBasedConfig* new_attribs;
+    DotTrash* dot_trash;
 };
 
 #endif
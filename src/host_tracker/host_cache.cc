@@ -24,9 +24,10 @@
 #include <memory>
 
 #define LRU_CACHE_INITIAL_SIZE 65535
+#define LRU_CACHE_SHARDS 16
 
-LruCacheShared<HostIpKey, std::shared_ptr<HostTracker>, HashHostIpKey>
-    host_cache(LRU_CACHE_INITIAL_SIZE);
+LruCacheSharded<HostIpKey, std::shared_ptr<HostTracker>, HashHostIpKey>
+    host_cache(LRU_CACHE_INITIAL_SIZE, LRU_CACHE_SHARDS);
 
 void host_cache_add_host_tracker(HostTracker* ht)
 {
@@ -34,6 +35,12 @@ void host_cache_add_host_tracker(HostTracker* ht)
     host_cache.insert(ht->get_ip_addr().ip8, sptr);
 }
 
+unsigned host_cache_reclaim(bool)
+{
+    //  hosts are relearned from traffic so they go before any flow state
+    return host_cache.evict(8);
+}
+
 bool host_cache_add_service(sfip_t ipaddr, Protocol ipproto, Port port, const char* service)
 {
     HostIpKey ipkey(ipaddr.ip8);
@@ -26,7 +26,7 @@
 
 #include <functional>
 #include "host_tracker/host_tracker.h"
-#include "hash/lru_cache_shared.h"
+#include "hash/lru_cache_sharded.h"
 #include "main/snort_types.h"
 
 
@@ -64,10 +64,13 @@ struct HashHostIpKey
     }
 };
 
-extern LruCacheShared<HostIpKey, std::shared_ptr<HostTracker>, HashHostIpKey> host_cache;
+extern LruCacheSharded<HostIpKey, std::shared_ptr<HostTracker>, HashHostIpKey> host_cache;
 
 void host_cache_add_host_tracker(HostTracker*);
 
+//  Memory reclaimer; evicts a few of the oldest hosts.
+unsigned host_cache_reclaim(bool in_allocation);
+
 //  Insert a new service into host cache if it doesn't already exist.
 SO_PUBLIC bool host_cache_add_service(sfip_t, Protocol, Port, const char* service);
 
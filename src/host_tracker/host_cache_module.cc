@@ -21,19 +21,31 @@
 #include "host_cache_module.h"
 
 #include "host_cache.h"
+#include "memory/prune_handler.h"
 
 const Parameter HostCacheModule::host_cache_params[] =
 {
     { "size", Parameter::PT_INT, nullptr, nullptr,
       "size of host cache" },
 
+    { "read_mostly", Parameter::PT_BOOL, nullptr, "false",
+      "use approximate recency so lookups only take a shared lock" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
+HostCacheModule::HostCacheModule() :
+    Module("host_cache", host_cache_help, host_cache_params, true)
+{
+    memory::register_reclaimer("host_cache", memory::RECLAIM_CACHE, 1, host_cache_reclaim);
+}
+
 bool HostCacheModule::set(const char*, Value& v, SnortConfig*)
 {
     if ( v.is("size") )
         host_cache_size = v.get_long();
+    else if ( v.is("read_mostly") )
+        read_mostly = v.get_bool();
     else
         return false;
 
@@ -43,6 +55,7 @@ bool HostCacheModule::set(const char*, Value& v, SnortConfig*)
 bool HostCacheModule::begin(const char*, int, SnortConfig*)
 {
     host_cache_size = 0;
+    read_mostly = false;
     return true;
 }
 
@@ -53,6 +66,9 @@ bool HostCacheModule::end(const char* fqn, int, SnortConfig*)
         host_cache.set_max_size(host_cache_size);
     }
 
+    if ( !strcmp(fqn, "host_cache") )
+        host_cache.set_read_mostly(read_mostly);
+
     return true;
 }
 
@@ -32,9 +32,7 @@
 class HostCacheModule : public Module
 {
 public:
-    HostCacheModule() : Module("host_cache", host_cache_help, host_cache_params, true)
-    {
-    }
+    HostCacheModule();
 
     const PegInfo* get_pegs() const override;
     PegCount* get_counts() const override;
@@ -48,6 +46,7 @@ private:
     static const Parameter service_params[];
 
     uint32_t host_cache_size;
+    bool read_mostly;
 };
 
 #endif
@@ -21,6 +21,7 @@
 
 #include "host_tracker/host_cache_module.h"
 #include "host_tracker/host_cache.h"
+#include "memory/prune_handler.h"
 
 #include <CppUTest/CommandLineTestRunner.h>
 #include <CppUTest/TestHarness.h>
@@ -47,6 +48,11 @@ void show_stats(PegCount*, const PegInfo*, IndexVec&, const char*, FILE*)
 char* snort_strdup(const char* s)
 { return strdup(s); }
 
+namespace memory
+{
+void register_reclaimer(const char*, unsigned, unsigned, Reclaimer) { }
+}
+
 #define FRAG_POLICY 33
 #define STREAM_POLICY 100
 
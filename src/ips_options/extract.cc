@@ -33,6 +33,10 @@
 #include "utils/util.h"
 #include "utils/snort_bounds.h"
 
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
 #define TEXTLEN  (PARSELEN + 1)
 
 /**
@@ -187,6 +191,51 @@ int string_extract(int bytes_to_grab, int base, const uint8_t* ptr,
     return(parse_helper - byte_array);  /* Return the number of bytes actually extracted */
 }
 
+ByteLoader get_byte_loader(int endianess, unsigned bytes_to_grab)
+{
+    const bool little = (endianess == ENDIAN_LITTLE);
+
+    if ( !little and endianess != ENDIAN_BIG )
+        return nullptr;
+
+    switch ( bytes_to_grab )
+    {
+    case 1: return load_bytes<1, false>;
+    case 2: return little ? load_bytes<2, true> : load_bytes<2, false>;
+    case 3: return little ? load_bytes<3, true> : load_bytes<3, false>;
+    case 4: return little ? load_bytes<4, true> : load_bytes<4, false>;
+    }
+    return nullptr;
+}
+
+#ifdef UNIT_TEST
+TEST_CASE("byte loaders", "[extract]")
+{
+    const uint8_t buf[] = { 0x81, 0x02, 0xf3, 0x04, 0x55 };
+
+    for ( int e : { ENDIAN_BIG, ENDIAN_LITTLE } )
+    {
+        for ( unsigned n = 1; n <= 4; ++n )
+        {
+            ByteLoader load = get_byte_loader(e, n);
+            REQUIRE(load);
+
+            for ( unsigned off = 0; off + n <= sizeof(buf); ++off )
+            {
+                uint32_t v = 0;
+                CHECK(!byte_extract(e, n, buf + off, buf, buf + sizeof(buf), &v));
+                CHECK(load(buf + off) == v);
+                CHECK(bytes_in_bounds(n, buf + off, buf, buf + sizeof(buf)));
+            }
+            CHECK(!bytes_in_bounds(n, buf + sizeof(buf) - n + 1, buf, buf + sizeof(buf)));
+        }
+    }
+    CHECK(!get_byte_loader(ENDIAN_FUNC, 4));
+    CHECK(!get_byte_loader(ENDIAN_BIG, 5));
+    CHECK(!bytes_in_bounds(1, buf - 1, buf, buf + sizeof(buf)));
+}
+#endif
+
 #ifdef TEST_BYTE_EXTRACT
 #include <stdio.h>
 
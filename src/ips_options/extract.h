@@ -36,5 +36,29 @@ SO_PUBLIC int byte_extract(
     int endianess, int bytes_to_grab, const uint8_t* ptr,
     const uint8_t* start, const uint8_t* end, uint32_t* value);
 
+// binary loads specialized by size and byte order so options can pick one
+// at construction instead of branching on their config for each packet.
+// the caller checks bounds.
+template<unsigned N, bool little>
+inline uint32_t load_bytes(const uint8_t* ptr)
+{
+    uint32_t value = 0;
+
+    for ( unsigned i = 0; i < N; ++i )
+        value |= (uint32_t)ptr[i] << (little ? 8 * i : 8 * (N - 1 - i));
+
+    return value;
+}
+
+typedef uint32_t (* ByteLoader)(const uint8_t*);
+
+// null unless endianess is big or little and 1 to 4 bytes are grabbed
+SO_PUBLIC ByteLoader get_byte_loader(int endianess, unsigned bytes_to_grab);
+
+// same bounds as byte_extract()
+inline bool bytes_in_bounds(
+    unsigned bytes_to_grab, const uint8_t* ptr, const uint8_t* start, const uint8_t* end)
+{ return ptr >= start and ptr < end and (unsigned)(end - ptr) >= bytes_to_grab; }
+
 #endif
 
@@ -38,15 +38,31 @@
 #include "utils/util_unfold.h"
 #include "detection/detection_defines.h"
 #include "detection/detection_util.h"
+#include "detection/fp_detect.h"
 #include "framework/cursor.h"
 #include "framework/ips_option.h"
 #include "framework/parameter.h"
 #include "framework/module.h"
 #include "hash/sfhashfcn.h"
+#include "protocols/packet_manager.h"
 
 static THREAD_LOCAL uint8_t base64_decode_buf[DECODE_BLEN];
 static THREAD_LOCAL uint32_t base64_decode_size;
 
+// the last decode of the current packet; base64_decode_buf holds its
+// result so repeating it on the same region is free
+struct Base64Decoded
+{
+    uint64_t pkt;
+    const uint8_t* start;
+    unsigned size;
+    uint32_t bytes;
+    uint32_t decode_size;
+    int rval;
+};
+
+static THREAD_LOCAL Base64Decoded base64_last;
+
 static THREAD_LOCAL ProfileStats base64PerfStats;
 
 #define s_name "base64_decode"
@@ -149,6 +165,23 @@ int Base64DecodeOption::eval(Cursor& c, Packet*)
     start_ptr += idx->offset;
     size -= idx->offset;
 
+    Base64Decoded& last = base64_last;
+    uint64_t pkt = rule_eval_pkt_count + PacketManager::get_rebuilt_packet_count();
+
+    if ( last.pkt == pkt and last.start == start_ptr and last.size == size and
+        last.bytes == idx->bytes_to_decode )
+    {
+        base64_decode_size = last.decode_size;
+        return last.rval;
+    }
+
+    last.pkt = pkt;
+    last.start = start_ptr;
+    last.size = size;
+    last.bytes = idx->bytes_to_decode;
+    last.decode_size = 0;
+    last.rval = DETECTION_OPTION_NO_MATCH;
+
     uint8_t base64_buf[DECODE_BLEN];
     uint32_t base64_size = 0;
 
@@ -162,8 +195,13 @@ int Base64DecodeOption::eval(Cursor& c, Packet*)
 
     if (sf_base64decode(base64_buf, base64_size, (uint8_t*)base64_decode_buf,
         sizeof(base64_decode_buf), &base64_decode_size) != 0)
+    {
+        last.decode_size = base64_decode_size;
         return DETECTION_OPTION_NO_MATCH;
+    }
 
+    last.decode_size = base64_decode_size;
+    last.rval = DETECTION_OPTION_MATCH;
     return DETECTION_OPTION_MATCH;
 }
 
@@ -67,7 +67,11 @@ class ByteExtractOption : public IpsOption
 {
 public:
     ByteExtractOption(const ByteExtractData& c) : IpsOption(s_name, RULE_OPTION_TYPE_BUFFER_USE)
-    { config = c; }
+    {
+        config = c;
+        load = c.data_string_convert_flag ? nullptr :
+            get_byte_loader(c.endianess, c.bytes_to_grab);
+    }
 
     ~ByteExtractOption()
     { snort_free(config.name); }
@@ -85,6 +89,7 @@ public:
 
 private:
     ByteExtractData config;
+    ByteLoader load;  // null unless binary with fixed endianness
 };
 
 //-------------------------------------------------------------------------
@@ -164,33 +169,44 @@ int ByteExtractOption::eval(Cursor& c, Packet* p)
     if (ptr < start || ptr >= end)
         return DETECTION_OPTION_NO_MATCH;
 
-    int8_t endian = data->endianess;
-    if (data->endianess == ENDIAN_FUNC)
-    {
-        if (!p->endianness ||
-            !p->endianness->get_offset_endianness(ptr - p->data, endian))
-            return DETECTION_OPTION_NO_MATCH;
-    }
-
     // do the extraction
     int ret = 0;
     int bytes_read = 0;
+    int8_t endian = data->endianess;
 
-    if (data->data_string_convert_flag == 0)
+    if ( load )
     {
-        ret = byte_extract(endian, data->bytes_to_grab, ptr, start, end, value);
-        if (ret < 0)
+        if ( !bytes_in_bounds(data->bytes_to_grab, ptr, start, end) )
             return DETECTION_OPTION_NO_MATCH;
 
+        *value = load(ptr);
         bytes_read = data->bytes_to_grab;
     }
     else
     {
-        ret = string_extract(data->bytes_to_grab, data->base, ptr, start, end, value);
-        if (ret < 0)
-            return DETECTION_OPTION_NO_MATCH;
+        if (data->endianess == ENDIAN_FUNC)
+        {
+            if (!p->endianness ||
+                !p->endianness->get_offset_endianness(ptr - p->data, endian))
+                return DETECTION_OPTION_NO_MATCH;
+        }
+
+        if (data->data_string_convert_flag == 0)
+        {
+            ret = byte_extract(endian, data->bytes_to_grab, ptr, start, end, value);
+            if (ret < 0)
+                return DETECTION_OPTION_NO_MATCH;
 
-        bytes_read = ret;
+            bytes_read = data->bytes_to_grab;
+        }
+        else
+        {
+            ret = string_extract(data->bytes_to_grab, data->base, ptr, start, end, value);
+            if (ret < 0)
+                return DETECTION_OPTION_NO_MATCH;
+
+            bytes_read = ret;
+        }
     }
 
     /* mulitply */
@@ -114,7 +114,11 @@ class ByteJumpOption : public IpsOption
 {
 public:
     ByteJumpOption(const ByteJumpData& c) : IpsOption(s_name, RULE_OPTION_TYPE_BUFFER_USE)
-    { config = c; }
+    {
+        config = c;
+        load = c.data_string_convert_flag ? nullptr :
+            get_byte_loader(c.endianess, c.bytes_to_grab);
+    }
 
     ~ByteJumpOption() { }
 
@@ -131,6 +135,7 @@ public:
 
 private:
     ByteJumpData config;
+    ByteLoader load;  // null unless binary with fixed endianness
 };
 
 //-------------------------------------------------------------------------
@@ -224,34 +229,46 @@ int ByteJumpOption::eval(Cursor& c, Packet* p)
     uint32_t jump = 0;
     uint32_t payload_bytes_grabbed = 0;
     int8_t endian = bjd->endianess;
-    if (endian == ENDIAN_FUNC)
-    {
-        if (!p->endianness ||
-            !p->endianness->get_offset_endianness(base_ptr - p->data, endian))
-            return DETECTION_OPTION_NO_MATCH;
-    }
 
-    // Both of the extraction functions contain checks to ensure the data
-    // is inbounds and will return no match if it isn't
-    if ( !bjd->data_string_convert_flag )
+    if ( load )
     {
-        if ( byte_extract(
-            endian, bjd->bytes_to_grab,
-            base_ptr, start_ptr, end_ptr, &jump) )
+        if ( !bytes_in_bounds(bjd->bytes_to_grab, base_ptr, start_ptr, end_ptr) )
             return DETECTION_OPTION_NO_MATCH;
 
+        jump = load(base_ptr);
         payload_bytes_grabbed = bjd->bytes_to_grab;
     }
     else
     {
-        int32_t tmp = string_extract(
-            bjd->bytes_to_grab, bjd->base,
-            base_ptr, start_ptr, end_ptr, &jump);
+        if (endian == ENDIAN_FUNC)
+        {
+            if (!p->endianness ||
+                !p->endianness->get_offset_endianness(base_ptr - p->data, endian))
+                return DETECTION_OPTION_NO_MATCH;
+        }
 
-        if (tmp < 0)
-            return DETECTION_OPTION_NO_MATCH;
+        // Both of the extraction functions contain checks to ensure the data
+        // is inbounds and will return no match if it isn't
+        if ( !bjd->data_string_convert_flag )
+        {
+            if ( byte_extract(
+                endian, bjd->bytes_to_grab,
+                base_ptr, start_ptr, end_ptr, &jump) )
+                return DETECTION_OPTION_NO_MATCH;
 
-        payload_bytes_grabbed = tmp;
+            payload_bytes_grabbed = bjd->bytes_to_grab;
+        }
+        else
+        {
+            int32_t tmp = string_extract(
+                bjd->bytes_to_grab, bjd->base,
+                base_ptr, start_ptr, end_ptr, &jump);
+
+            if (tmp < 0)
+                return DETECTION_OPTION_NO_MATCH;
+
+            payload_bytes_grabbed = tmp;
+        }
     }
     // Negative offsets that put us outside the buffer should have been caught
     // in the extraction routines
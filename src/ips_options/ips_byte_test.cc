@@ -210,11 +210,59 @@ static inline bool byte_test_check(uint32_t op, uint32_t val, uint32_t cmp, bool
     return success;
 }
 
+// binary tests of 1, 2, or 4 bytes are specialized so the load and compare
+// are straight line code; anything else goes through the extract helpers
+typedef bool (* ByteTestFunc)(const uint8_t*, uint32_t cmp);
+
+template<unsigned N, bool little, uint32_t op>
+static bool binary_test(const uint8_t* ptr, uint32_t cmp)
+{ return byte_test_check(op, load_bytes<N, little>(ptr), cmp, false); }
+
+template<unsigned N, bool little>
+static ByteTestFunc get_binary_test(uint32_t op)
+{
+    switch ( op )
+    {
+    case CHECK_EQ: return binary_test<N, little, CHECK_EQ>;
+    case CHECK_NEQ: return binary_test<N, little, CHECK_NEQ>;
+    case CHECK_LT: return binary_test<N, little, CHECK_LT>;
+    case CHECK_GT: return binary_test<N, little, CHECK_GT>;
+    case CHECK_LTE: return binary_test<N, little, CHECK_LTE>;
+    case CHECK_GTE: return binary_test<N, little, CHECK_GTE>;
+    case CHECK_AND: return binary_test<N, little, CHECK_AND>;
+    case CHECK_XOR: return binary_test<N, little, CHECK_XOR>;
+    case CHECK_ALL: return binary_test<N, little, CHECK_ALL>;
+    case CHECK_GT0: return binary_test<N, little, CHECK_GT0>;
+    case CHECK_NONE: return binary_test<N, little, CHECK_NONE>;
+    }
+    return nullptr;
+}
+
+static ByteTestFunc get_binary_test(const ByteTestData& c)
+{
+    if ( c.data_string_convert_flag or
+        (c.endianess != ENDIAN_BIG and c.endianess != ENDIAN_LITTLE) )
+        return nullptr;
+
+    const bool little = (c.endianess == ENDIAN_LITTLE);
+
+    switch ( c.bytes_to_compare )
+    {
+    case 1:
+        return get_binary_test<1, false>(c.opcode);
+    case 2:
+        return little ? get_binary_test<2, true>(c.opcode) : get_binary_test<2, false>(c.opcode);
+    case 4:
+        return little ? get_binary_test<4, true>(c.opcode) : get_binary_test<4, false>(c.opcode);
+    }
+    return nullptr;
+}
+
 class ByteTestOption : public IpsOption
 {
 public:
     ByteTestOption(const ByteTestData& c) : IpsOption(s_name, RULE_OPTION_TYPE_BUFFER_USE)
-    { config = c; }
+    { config = c; test = get_binary_test(c); }
 
     ~ByteTestOption() { }
 
@@ -228,6 +276,7 @@ public:
 
 private:
     ByteTestData config;
+    ByteTestFunc test;
 };
 
 //-------------------------------------------------------------------------
@@ -322,6 +371,17 @@ int ByteTestOption::eval(Cursor& c, Packet* p)
     const uint8_t* start_ptr = btd->relative_flag ? c.start() : c.buffer();
     start_ptr += offset;
 
+    if ( test )
+    {
+        if ( !bytes_in_bounds(btd->bytes_to_compare, start_ptr, c.buffer(), c.endo()) )
+            return DETECTION_OPTION_NO_MATCH;
+
+        if ( test(start_ptr, cmp_value) != (btd->not_flag != 0) )
+            return DETECTION_OPTION_MATCH;
+
+        return DETECTION_OPTION_NO_MATCH;
+    }
+
     int8_t endian = btd->endianess;
     if (endian == ENDIAN_FUNC)
     {
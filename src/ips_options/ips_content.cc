@@ -32,6 +32,7 @@
 #include "main/snort_debug.h"
 #include "utils/boyer_moore.h"
 #include "utils/util.h"
+#include "utils/util_scan.h"
 #include "parser/parser.h"
 #include "parser/parse_utils.h"
 #include "hash/sfhashfcn.h"
@@ -66,8 +67,8 @@ struct ContentData
 
     unsigned match_delta;   /* Maximum distance we can jump to search for this pattern again. */
 
-    int* skip_stride;       /* B-M skip array */
-    int* shift_stride;      /* B-M shift array */
+    int* skip_stride;       /* B-M skip array, long patterns only */
+    int* shift_stride;      /* B-M shift array, long patterns only */
 
     void init();
     void setup_bm();
@@ -80,8 +81,15 @@ void ContentData::init()
     depth_var = BYTE_EXTRACT_NO_VAR;
 }
 
+// shorter patterns are found with scan_find(); its first / last byte
+// filter beats the B-M tables until the strides get long
+#define MAX_SCAN_PATTERN 64
+
 void ContentData::setup_bm()
 {
+    if ( pmd.pattern_size <= MAX_SCAN_PATTERN )
+        return;
+
     skip_stride = make_skip(pmd.pattern_buf, pmd.pattern_size);
     shift_stride = make_shift(pmd.pattern_buf, pmd.pattern_size);
 }
@@ -357,10 +365,35 @@ static int uniSearchReal(ContentData* cd, Cursor& c)
         return -1;
     }
 
+    // the fast pattern hit ends at least as far in as the first instance of
+    // this content so the search can start from there, less the pattern
+    if ( g_fp_hit.pmd == &cd->pmd and g_fp_hit.data == c.buffer() and
+        g_fp_hit.size == c.size() and g_fp_hit.end > cd->pmd.pattern_size )
+    {
+        int skip = (int)(g_fp_hit.end - cd->pmd.pattern_size) - pos;
+
+        if ( skip > 0 )
+        {
+            if ( skip > depth - (int)cd->pmd.pattern_size )
+                return 0;
+
+            pos += skip;
+            depth -= skip;
+        }
+    }
+
     const uint8_t* base = c.buffer() + pos;
     int found;
 
-    if ( cd->pmd.no_case )
+    if ( cd->pmd.pattern_size <= MAX_SCAN_PATTERN )
+    {
+        const uint8_t* at = scan_find(
+            base, base + depth, (const uint8_t*)cd->pmd.pattern_buf, cd->pmd.pattern_size,
+            cd->pmd.no_case);
+
+        found = at ? at - base : -1;
+    }
+    else if ( cd->pmd.no_case )
     {
         found = mSearchCI(
             (const char*)base, depth, cd->pmd.pattern_buf, cd->pmd.pattern_size,
@@ -58,7 +58,7 @@ using namespace std;
 #include "utils/util.h"
 #include "utils/stats.h"
 #include "utils/sflsq.h"
-#include "utils/bitop.h"
+#include "utils/flowbit_set.h"
 #include "hash/sfghash.h"
 #include "parser/mstring.h"
 #include "stream/stream_api.h"
@@ -138,7 +138,7 @@ typedef struct _FLOWBITS_GRP
     uint16_t max_id;
     char* name;
     uint32_t group_id;
-    BitOp* GrpBitOp;
+    FlowBitMask* GrpMask;  // only the words with group bits
 } FLOWBITS_GRP;
 
 static SFGHASH* flowbits_grp_hash = NULL;
@@ -269,59 +269,49 @@ int FlowBitsOption::eval(Cursor&, Packet* p)
 // helper methods
 //-------------------------------------------------------------------------
 
-static inline int clear_group_bit(BitOp* bitop, char* group)
+static inline FLOWBITS_GRP* get_group(FlowBitSet* bitop, char* group)
 {
     if ( !group )
-        return 0;
+        return nullptr;
 
     // FIXIT-M why is the hash lookup done at runtime for flowbits groups?
     // a pointer to flowbis_grp should be in flowbits config data
     // this *should* be safe but iff splay mode is disabled
     auto flowbits_grp = (FLOWBITS_GRP*)sfghash_find(flowbits_grp_hash, group);
 
-    if ( !flowbits_grp )
-        return 0;
+    if ( !flowbits_grp or !flowbits_grp->GrpMask )
+        return nullptr;
 
     if ( !bitop || (bitop->size() <= flowbits_grp->max_id) || !flowbits_grp->count )
-        return 0;
+        return nullptr;
 
-    auto GrpBitOp = flowbits_grp->GrpBitOp;
-
-    /* note, max_id is an index, not a count.
-     * Calculate max_bytes by adding 8 to max_id, then dividing by 8.  */
-    unsigned int max_bytes = (flowbits_grp->max_id + 8) >> 3;
-    for ( unsigned int i = 0; i < max_bytes; i++ )
-        bitop->get_buf_element(i) &= ~GrpBitOp->get_buf_element(i);
-
-    return 1;
+    return flowbits_grp;
 }
 
-static inline int toggle_group_bit(BitOp* bitop, char* group)
+static inline int clear_group_bit(FlowBitSet* bitop, char* group)
 {
-    if ( !group  )
-        return 0;
-
-    auto flowbits_grp = (FLOWBITS_GRP*)sfghash_find(flowbits_grp_hash, group);
+    auto flowbits_grp = get_group(bitop, group);
 
     if ( !flowbits_grp )
         return 0;
 
-    if ( !bitop || (bitop->size() <= flowbits_grp->max_id) || !flowbits_grp->count )
-        return 0;
+    bitop->clear(*flowbits_grp->GrpMask);
+    return 1;
+}
 
-    auto GrpBitOp = flowbits_grp->GrpBitOp;
+static inline int toggle_group_bit(FlowBitSet* bitop, char* group)
+{
+    auto flowbits_grp = get_group(bitop, group);
 
-    /* note, max_id is an index, not a count.
-     * Calculate max_bytes by adding 8 to max_id, then dividing by 8.  */
-    unsigned int max_bytes = (flowbits_grp->max_id + 8) >> 3;
-    for ( unsigned int i = 0; i < max_bytes; i++ )
-        bitop->get_buf_element(i) ^= GrpBitOp->get_buf_element(i);
+    if ( !flowbits_grp )
+        return 0;
 
+    bitop->toggle(*flowbits_grp->GrpMask);
     return 1;
 }
 
 static inline int set_xbits_to_group(
-    BitOp* bitop, uint16_t* ids, uint16_t num_ids, char* group)
+    FlowBitSet* bitop, uint16_t* ids, uint16_t num_ids, char* group)
 {
     unsigned int i;
     if (!clear_group_bit(bitop, group))
@@ -332,7 +322,7 @@ static inline int set_xbits_to_group(
 }
 
 static inline int is_set_flowbits(
-    BitOp* bitop, uint8_t eval, uint16_t* ids,
+    FlowBitSet* bitop, uint8_t eval, uint16_t* ids,
     uint16_t num_ids, char* group)
 {
     unsigned int i;
@@ -359,28 +349,15 @@ static inline int is_set_flowbits(
 
     case FLOWBITS_ALL:
         flowbits_grp = (FLOWBITS_GRP*)sfghash_find(flowbits_grp_hash, group);
-        if ( flowbits_grp == NULL )
+        if ( flowbits_grp == NULL or !flowbits_grp->GrpMask )
             return 0;
-        for ( i = 0; i <= (unsigned int)(flowbits_grp->max_id >>3); i++ )
-        {
-            uint8_t val = bitop->get_buf_element(i) & flowbits_grp->GrpBitOp->get_buf_element(i);
-
-            if ( val != flowbits_grp->GrpBitOp->get_buf_element(i) )
-                return 0;
-        }
-        return 1;
+        return bitop->all(*flowbits_grp->GrpMask);
 
     case FLOWBITS_ANY:
         flowbits_grp = (FLOWBITS_GRP*)sfghash_find(flowbits_grp_hash, group);
-        if ( flowbits_grp == NULL )
+        if ( flowbits_grp == NULL or !flowbits_grp->GrpMask )
             return 0;
-        for ( i = 0; i <= (unsigned int)(flowbits_grp->max_id >>3); i++ )
-        {
-            uint8_t val = bitop->get_buf_element(i) & flowbits_grp->GrpBitOp->get_buf_element(i);
-            if ( val )
-                return 1;
-        }
-        return 0;
+        return bitop->any(*flowbits_grp->GrpMask);
 
     default:
         return 0;
@@ -391,7 +368,7 @@ static int check_flowbits(
     uint8_t type, uint8_t evalType, uint16_t* ids, uint16_t num_ids, char* group, Packet* p)
 {
     int rval = DETECTION_OPTION_NO_MATCH;
-    BitOp* bitop;
+    FlowBitSet* bitop;
     Flowbits_eval eval = (Flowbits_eval)evalType;
     int result = 0;
     int i;
@@ -973,7 +950,7 @@ static void update_group(FLOWBITS_GRP* flowbits_grp, int id)
     if ( flowbits_grp->max_id < id )
         flowbits_grp->max_id = id;
 
-    flowbits_grp->GrpBitOp->set(id);
+    flowbits_grp->GrpMask->set(id);
 }
 
 static void init_groups()
@@ -981,15 +958,12 @@ static void init_groups()
     if ( !flowbits_hash or !flowbits_grp_hash )
         return;
 
-    unsigned size = getFlowbitSizeInBytes();
-
     for ( SFGHASH_NODE* n = sfghash_findfirst(flowbits_grp_hash);
         n != NULL;
         n= sfghash_findnext(flowbits_grp_hash) )
     {
         FLOWBITS_GRP* fbg = (FLOWBITS_GRP*)n->data;
-        fbg->GrpBitOp = new BitOp(size);
-        fbg->GrpBitOp->reset();
+        fbg->GrpMask = new FlowBitMask;
     }
 
     while ( !op_list.empty() )
@@ -1069,8 +1043,8 @@ static void FlowItemFree(void* d)
 static void FlowBitsGrpFree(void* d)
 {
     FLOWBITS_GRP* data = (FLOWBITS_GRP*)d;
-    if(data->GrpBitOp)
-        delete data->GrpBitOp;
+    if(data->GrpMask)
+        delete data->GrpMask;
     if (data->name)
         snort_free(data->name);
     snort_free(data);
@@ -35,8 +35,10 @@
 #include "profiler/profiler.h"
 #include "detection/detection_defines.h"
 #include "detection/detection_util.h"
+#include "detection/fp_detect.h"
 #include "framework/parameter.h"
 #include "framework/module.h"
+#include "protocols/packet_manager.h"
 
 enum HashPsIdx
 {
@@ -45,6 +47,32 @@ enum HashPsIdx
 
 static THREAD_LOCAL std::array<ProfileStats, HPI_MAX> hash_ps;
 
+//-------------------------------------------------------------------------
+// digests of the current packet
+//
+// rules in the same family usually hash the same region with different
+// expected values so the last few digests of each algorithm are kept until
+// the next packet.
+//-------------------------------------------------------------------------
+
+#define HASH_CACHE_SIZE 4
+
+struct HashCacheEntry
+{
+    uint64_t pkt;
+    const uint8_t* base;
+    unsigned length;
+    unsigned char digest[MAX_HASH_SIZE];
+};
+
+struct HashCache
+{
+    HashCacheEntry entry[HASH_CACHE_SIZE];
+    unsigned next;
+};
+
+static THREAD_LOCAL HashCache hash_cache[HPI_MAX];
+
 struct HashMatchData
 {
     std::string hash;
@@ -88,6 +116,8 @@ public:
     int match(Cursor&);
 
 private:
+    const unsigned char* get_digest(const uint8_t*);
+
     HashMatchData* config;
     HashFunc hashf;
     unsigned size;
@@ -143,6 +173,28 @@ bool HashOption::operator==(const IpsOption& ips) const
 // runtime functions
 //-------------------------------------------------------------------------
 
+const unsigned char* HashOption::get_digest(const uint8_t* base)
+{
+    HashCache& hc = hash_cache[idx];
+    uint64_t pkt = rule_eval_pkt_count + PacketManager::get_rebuilt_packet_count();
+
+    for ( auto& e : hc.entry )
+    {
+        if ( e.pkt == pkt and e.base == base and e.length == config->length )
+            return e.digest;
+    }
+
+    HashCacheEntry& e = hc.entry[hc.next];
+    hc.next = (hc.next + 1) % HASH_CACHE_SIZE;
+
+    hashf(base, config->length, e.digest);
+    e.pkt = pkt;
+    e.base = base;
+    e.length = config->length;
+
+    return e.digest;
+}
+
 int HashOption::match(Cursor& c)
 {
     int offset;
@@ -184,9 +236,8 @@ int HashOption::match(Cursor& c)
     }
 
     const uint8_t* base = c.buffer() + pos;
-    unsigned char buf[MAX_HASH_SIZE];
-    hashf(base, config->length, buf);
-    int found = memcmp(buf, config->hash.c_str(), size);
+    const unsigned char* digest = get_digest(base);
+    int found = memcmp(digest, config->hash.c_str(), size);
 
     if ( !found )
     {
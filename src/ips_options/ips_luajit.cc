@@ -38,13 +38,15 @@
 #include "log/messages.h"
 #include "profiler/profiler.h"
 #include "detection/detection_defines.h"
-
-static THREAD_LOCAL ProfileStats luaIpsPerfStats;
+#include "flow/flow.h"
+#include "protocols/packet.h"
 
 #define opt_eval "eval"
+#define opt_context "snort_context"
 
 static THREAD_LOCAL Cursor* cursor;
 static THREAD_LOCAL SnortBuffer buf;
+static THREAD_LOCAL const SnortContext* context;
 
 SO_PUBLIC const SnortBuffer* get_buffer()
 {
@@ -55,6 +57,44 @@ SO_PUBLIC const SnortBuffer* get_buffer()
     return &buf;
 }
 
+SO_PUBLIC const SnortContext* get_context()
+{
+    assert(context);
+    return context;
+}
+
+//-------------------------------------------------------------------------
+// stats
+//-------------------------------------------------------------------------
+
+// each script module gets its own slot in every thread; past the max they
+// share the last one
+#define MAX_LUA_SLOTS 64
+
+struct LuaJitCounts
+{
+    PegCount evals = 0;
+    PegCount matches = 0;
+    PegCount errors = 0;
+};
+
+struct LuaJitSlot
+{
+    LuaJitCounts counts;
+    ProfileStats profile;
+};
+
+static const PegInfo luajit_pegs[] =
+{
+    { "evals", "number of times eval() was called" },
+    { "matches", "number of times eval() returned true" },
+    { "errors", "number of times eval() failed" },
+    { nullptr, nullptr }
+};
+
+static THREAD_LOCAL LuaJitSlot lua_slots[MAX_LUA_SLOTS];
+static unsigned num_slots = 0;
+
 //-------------------------------------------------------------------------
 // module stuff
 //-------------------------------------------------------------------------
@@ -74,16 +114,23 @@ class LuaJitModule : public Module
 {
 public:
     LuaJitModule(const char* name) : Module(name, s_help, s_params)
-    { }
+    { slot = num_slots < MAX_LUA_SLOTS ? num_slots++ : MAX_LUA_SLOTS - 1; }
 
     bool begin(const char*, int, SnortConfig*) override;
     bool set(const char*, Value&, SnortConfig*) override;
 
+    const PegInfo* get_pegs() const override
+    { return luajit_pegs; }
+
+    PegCount* get_counts() const override
+    { return (PegCount*)&lua_slots[slot].counts; }
+
     ProfileStats* get_profile() const override
-    { return &luaIpsPerfStats; }
+    { return &lua_slots[slot].profile; }
 
 public:
     std::string args;
+    unsigned slot;
 };
 
 bool LuaJitModule::begin(const char*, int, SnortConfig*)
@@ -127,6 +174,12 @@ private:
 
     std::string config;
     std::vector<Lua::State> states;
+
+    // per thread; eval is held in the registry to skip the global lookup
+    // and contexts must not move once their addresses are given to lua
+    std::vector<int> evals;
+    std::vector<SnortContext> contexts;
+    unsigned slot;
 };
 
 LuaJitOption::LuaJitOption(
@@ -139,11 +192,29 @@ LuaJitOption::LuaJitOption(
     config += "}";
 
     unsigned max = ThreadConfig::get_instance_max();
+    contexts.resize(max);
+    slot = mod->slot;
 
     for ( unsigned i = 0; i < max; ++i )
     {
         states.emplace_back(true);
+        lua_State* L = states[i];
+
+        lua_pushlightuserdata(L, &contexts[i]);
+        lua_setglobal(L, opt_context);
+
         init_chunk(states[i], chunk, name, config);
+
+        lua_getglobal(L, opt_eval);
+
+        if ( lua_isfunction(L, -1) )
+            evals.push_back(luaL_ref(L, LUA_REGISTRYINDEX));
+        else
+        {
+            lua_pop(L, 1);
+            evals.push_back(LUA_NOREF);
+            ParseError("%s luajit eval() is not defined", name);
+        }
     }
 }
 
@@ -172,28 +243,51 @@ bool LuaJitOption::operator==(const IpsOption& ips) const
     return true;
 }
 
-int LuaJitOption::eval(Cursor& c, Packet*)
+static void set_context(const Cursor& c, const Packet* p, SnortContext& ctx)
 {
-    Profile profile(luaIpsPerfStats);
+    ctx.buffer.type = c.get_name();
+    ctx.buffer.data = c.buffer();
+    ctx.buffer.len = c.size();
+    ctx.pos = c.get_pos();
+
+    ctx.flow.service = (p->flow and p->flow->service) ? p->flow->service : "";
+    ctx.flow.ip_proto = (unsigned)p->get_ip_proto_next();
+    ctx.flow.sp = p->ptrs.sp;
+    ctx.flow.dp = p->ptrs.dp;
+    ctx.flow.from_server = p->is_from_server() ? 1 : 0;
+}
 
-    cursor = &c;
+int LuaJitOption::eval(Cursor& c, Packet* p)
+{
+    LuaJitSlot& ls = lua_slots[slot];
+    Profile profile(ls.profile);
+    ++ls.counts.evals;
 
-    lua_State* L = states[get_instance_id()];
+    unsigned id = get_instance_id();
+    lua_State* L = states[id];
+
+    cursor = &c;
+    set_context(c, p, contexts[id]);
+    context = &contexts[id];
 
     {
         Lua::ManageStack ms(L, 1);
 
-        lua_getglobal(L, opt_eval);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, evals[id]);
 
         if ( lua_pcall(L, 0, 1, 0) )
         {
             const char* err = lua_tostring(L, -1);
             ErrorMessage("%s\n", err);
+            ++ls.counts.errors;
             return DETECTION_OPTION_NO_MATCH;
         }
 
         if ( lua_toboolean(L, -1) )
+        {
+            ++ls.counts.matches;
             return DETECTION_OPTION_MATCH;
+        }
 
         return DETECTION_OPTION_NO_MATCH;
     }
@@ -26,7 +26,13 @@
 #endif
 
 #include <sys/types.h>
+
+#ifdef HAVE_PCRE2
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+#else
 #include <pcre.h>
+#endif
 
 #include "main/snort_types.h"
 #include "main/snort_debug.h"
@@ -44,6 +50,29 @@
 #include "framework/parameter.h"
 #include "framework/module.h"
 
+#ifdef HAVE_PCRE2
+#define RE_CASELESS       PCRE2_CASELESS
+#define RE_DOTALL         PCRE2_DOTALL
+#define RE_MULTILINE      PCRE2_MULTILINE
+#define RE_EXTENDED       PCRE2_EXTENDED
+#define RE_ANCHORED       PCRE2_ANCHORED
+#define RE_DOLLAR_ENDONLY PCRE2_DOLLAR_ENDONLY
+#define RE_UNGREEDY       PCRE2_UNGREEDY
+
+// depth was called recursion before 10.30
+#ifndef PCRE2_ERROR_DEPTHLIMIT
+#define PCRE2_ERROR_DEPTHLIMIT PCRE2_ERROR_RECURSIONLIMIT
+#define pcre2_set_depth_limit pcre2_set_recursion_limit
+#endif
+#else
+#define RE_CASELESS       PCRE_CASELESS
+#define RE_DOTALL         PCRE_DOTALL
+#define RE_MULTILINE      PCRE_MULTILINE
+#define RE_EXTENDED       PCRE_EXTENDED
+#define RE_ANCHORED       PCRE_ANCHORED
+#define RE_DOLLAR_ENDONLY PCRE_DOLLAR_ENDONLY
+#define RE_UNGREEDY       PCRE_UNGREEDY
+
 #ifndef PCRE_STUDY_JIT_COMPILE
 #define PCRE_STUDY_JIT_COMPILE 0
 #endif
@@ -57,6 +86,7 @@
 #define PCRE_STUDY_FLAGS PCRE_STUDY_JIT_COMPILE
 #define pcre_release(x) pcre_free_study(x)
 #endif
+#endif
 
 #define SNORT_PCRE_RELATIVE         0x00010 // relative to the end of the last match
 #define SNORT_PCRE_INVERT           0x00020 // invert detect
@@ -67,9 +97,14 @@
 
 struct PcreData
 {
+#ifdef HAVE_PCRE2
+    pcre2_code* re;     /* compiled regex */
+    bool jit;           /* jit compiled */
+#else
     pcre* re;           /* compiled regex */
     pcre_extra* pe;     /* studied regex foo */
     bool free_pe;
+#endif
     int options;        /* sp_pcre specfic options (relative & inverse) */
     char* expression;
 };
@@ -94,10 +129,82 @@ static int s_ovector_size = 0;
 
 static THREAD_LOCAL ProfileStats pcrePerfStats;
 
+struct PcreStats
+{
+    PegCount interpreted;
+    PegCount jit_stack_fallbacks;
+    PegCount limit_exceeded;
+};
+
+const PegInfo pcre_pegs[] =
+{
+    { "interpreted", "searches with expressions that could not be jit compiled" },
+    { "jit stack fallbacks", "searches retried in the interpreter after exhausting the jit stack" },
+    { "limit exceeded", "searches aborted by the match or recursion limit" },
+    { nullptr, nullptr }
+};
+
+static THREAD_LOCAL PcreStats pcre_stats;
+
+#ifdef HAVE_PCRE2
+// expressions that failed jit compilation since the last verify
+static unsigned s_jit_fails = 0;
+
+// per packet thread search state; the unlimited context is for expressions
+// with the O (override limits) flag
+static THREAD_LOCAL pcre2_match_data* s_match_data = nullptr;
+static THREAD_LOCAL pcre2_match_context* s_match_ctx = nullptr;
+static THREAD_LOCAL pcre2_match_context* s_nolimit_ctx = nullptr;
+static THREAD_LOCAL pcre2_jit_stack* s_jit_stack = nullptr;
+
+#define JIT_STACK_START (32 * 1024)
+#endif
+
 //-------------------------------------------------------------------------
 // implementation foo
 //-------------------------------------------------------------------------
 
+#ifdef HAVE_PCRE2
+static bool pcre2_build(const char* re, uint32_t compile_flags, PcreData* pcre_data)
+{
+    int errcode;
+    PCRE2_SIZE erroffset;
+
+    pcre_data->re = pcre2_compile(
+        (PCRE2_SPTR)re, PCRE2_ZERO_TERMINATED, compile_flags, &errcode, &erroffset, nullptr);
+
+    if ( !pcre_data->re )
+    {
+        PCRE2_UCHAR error[128];
+        pcre2_get_error_message(errcode, error, sizeof(error));
+
+        ParseError(": pcre compile of '%s' failed at offset "
+            "%zu : %s", re, (size_t)erroffset, (char*)error);
+        return false;
+    }
+
+    if ( !pcre2_jit_compile(pcre_data->re, PCRE2_JIT_COMPLETE) )
+        pcre_data->jit = true;
+    else
+        s_jit_fails++;
+
+    uint32_t captures = 0;
+    pcre2_pattern_info(pcre_data->re, PCRE2_INFO_CAPTURECOUNT, &captures);
+
+    if ( (int)captures > s_ovector_size )
+        s_ovector_size = captures;
+
+    uint32_t options = 0;
+    pcre2_pattern_info(pcre_data->re, PCRE2_INFO_ALLOPTIONS, &options);
+
+    // see pcre_check_anchored()
+    if ( (options & PCRE2_ANCHORED) && !(options & PCRE2_MULTILINE) )
+        pcre_data->options |= SNORT_PCRE_ANCHORED;
+
+    return true;
+}
+
+#else
 static void pcre_capture(
     const void* code, const void* extra)
 {
@@ -159,14 +266,13 @@ static void pcre_check_anchored(PcreData* pcre_data)
         pcre_data->options |= SNORT_PCRE_ANCHORED;
     }
 }
+#endif
 
 static void pcre_parse(const char* data, PcreData* pcre_data)
 {
-    const char* error;
     char* re, * free_me;
     char* opts;
     char delimit = '/';
-    int erroffset;
     int compile_flags = 0;
 
     if (data == NULL)
@@ -236,17 +342,17 @@ static void pcre_parse(const char* data, PcreData* pcre_data)
     {
         switch (*opts)
         {
-        case 'i':  compile_flags |= PCRE_CASELESS;            break;
-        case 's':  compile_flags |= PCRE_DOTALL;              break;
-        case 'm':  compile_flags |= PCRE_MULTILINE;           break;
-        case 'x':  compile_flags |= PCRE_EXTENDED;            break;
+        case 'i':  compile_flags |= RE_CASELESS;              break;
+        case 's':  compile_flags |= RE_DOTALL;                break;
+        case 'm':  compile_flags |= RE_MULTILINE;             break;
+        case 'x':  compile_flags |= RE_EXTENDED;              break;
 
         /*
          * these are pcre specific... don't work with perl
          */
-        case 'A':  compile_flags |= PCRE_ANCHORED;            break;
-        case 'E':  compile_flags |= PCRE_DOLLAR_ENDONLY;      break;
-        case 'G':  compile_flags |= PCRE_UNGREEDY;            break;
+        case 'A':  compile_flags |= RE_ANCHORED;              break;
+        case 'E':  compile_flags |= RE_DOLLAR_ENDONLY;        break;
+        case 'G':  compile_flags |= RE_UNGREEDY;              break;
 
         /*
          * these are snort specific don't work with pcre or perl
@@ -263,6 +369,14 @@ static void pcre_parse(const char* data, PcreData* pcre_data)
 
     /* now compile the re */
     DebugFormat(DEBUG_PATTERN_MATCH, "pcre: compiling %s\n", re);
+
+#ifdef HAVE_PCRE2
+    if ( !pcre2_build(re, compile_flags, pcre_data) )
+        return;
+#else
+    const char* error;
+    int erroffset;
+
     pcre_data->re = pcre_compile(re, compile_flags, &error, &erroffset, NULL);
 
     if (pcre_data->re == NULL)
@@ -343,6 +457,7 @@ static void pcre_parse(const char* data, PcreData* pcre_data)
 
     pcre_capture(pcre_data->re, pcre_data->pe);
     pcre_check_anchored(pcre_data);
+#endif
 
     snort_free(free_me);
     return;
@@ -391,6 +506,43 @@ static bool pcre_search(
 
     *found_offset = -1;
 
+#ifdef HAVE_PCRE2
+    pcre2_match_context* ctx = (pcre_data->options & SNORT_OVERRIDE_MATCH_LIMIT) ?
+        s_nolimit_ctx : s_match_ctx;
+
+    if ( !pcre_data->jit )
+        pcre_stats.interpreted++;
+
+    // we only need the end of the whole match so a single pair is enough;
+    // a return of 0 just means there wasn't room for the captures
+    result = pcre2_match(pcre_data->re, (PCRE2_SPTR)buf, len, start_offset, 0,
+        s_match_data, ctx);
+
+    if ( result == PCRE2_ERROR_JIT_STACKLIMIT )
+    {
+        pcre_stats.jit_stack_fallbacks++;
+        result = pcre2_match(pcre_data->re, (PCRE2_SPTR)buf, len, start_offset, PCRE2_NO_JIT,
+            s_match_data, ctx);
+    }
+
+    if ( result >= 0 )
+    {
+        matched = true;
+        *found_offset = (int)pcre2_get_ovector_pointer(s_match_data)[1];
+    }
+    else if ( result == PCRE2_ERROR_NOMATCH )
+    {
+        matched = false;
+    }
+    else
+    {
+        if ( result == PCRE2_ERROR_MATCHLIMIT or result == PCRE2_ERROR_DEPTHLIMIT )
+            pcre_stats.limit_exceeded++;
+
+        DebugFormat(DEBUG_PATTERN_MATCH, "pcre2_match error : %d \n", result);
+        return false;
+    }
+#else
     SnortState* ss = snort_conf->state + get_instance_id();
     assert(ss->pcre_ovector);
 
@@ -435,9 +587,13 @@ static bool pcre_search(
     }
     else
     {
+        if ( result == PCRE_ERROR_MATCHLIMIT or result == PCRE_ERROR_RECURSIONLIMIT )
+            pcre_stats.limit_exceeded++;
+
         DebugFormat(DEBUG_PATTERN_MATCH, "pcre_exec error : %d \n", result);
         return false;
     }
+#endif
 
     /* invert sense of match */
     if (pcre_data->options & SNORT_PCRE_INVERT)
@@ -491,6 +647,10 @@ PcreOption::~PcreOption()
     if ( config->expression )
         snort_free(config->expression);
 
+#ifdef HAVE_PCRE2
+    if ( config->re )
+        pcre2_code_free(config->re);
+#else
     if ( config->pe )
     {
         if ( config->free_pe )
@@ -501,6 +661,7 @@ PcreOption::~PcreOption()
 
     if ( config->re )
         free(config->re);  // external allocation
+#endif
 
     snort_free(config);
 }
@@ -687,6 +848,12 @@ public:
     bool begin(const char*, int, SnortConfig*) override;
     bool set(const char*, Value&, SnortConfig*) override;
 
+    const PegInfo* get_pegs() const override
+    { return pcre_pegs; }
+
+    PegCount* get_counts() const override
+    { return (PegCount*)&pcre_stats; }
+
     ProfileStats* get_profile() const override
     { return &pcrePerfStats; }
 
@@ -746,6 +913,44 @@ static void pcre_dtor(IpsOption* p)
     delete p;
 }
 
+#ifdef HAVE_PCRE2
+static void pcre_tinit(SnortConfig* sc)
+{
+    s_match_data = pcre2_match_data_create(1, nullptr);
+    s_match_ctx = pcre2_match_context_create(nullptr);
+    s_nolimit_ctx = pcre2_match_context_create(nullptr);
+
+    size_t max = (size_t)sc->pcre_jit_stack * 1024;
+    s_jit_stack = pcre2_jit_stack_create(JIT_STACK_START, max, nullptr);
+
+    if ( s_jit_stack )
+    {
+        pcre2_jit_stack_assign(s_match_ctx, nullptr, s_jit_stack);
+        pcre2_jit_stack_assign(s_nolimit_ctx, nullptr, s_jit_stack);
+    }
+
+    if ( sc->pcre_match_limit != -1 )
+        pcre2_set_match_limit(s_match_ctx, sc->pcre_match_limit);
+
+    if ( sc->pcre_match_limit_recursion != -1 )
+        pcre2_set_depth_limit(s_match_ctx, sc->pcre_match_limit_recursion);
+}
+
+static void pcre_tterm(SnortConfig*)
+{
+    pcre2_match_data_free(s_match_data);
+    pcre2_match_context_free(s_match_ctx);
+    pcre2_match_context_free(s_nolimit_ctx);
+
+    if ( s_jit_stack )
+        pcre2_jit_stack_free(s_jit_stack);
+
+    s_match_data = nullptr;
+    s_match_ctx = s_nolimit_ctx = nullptr;
+    s_jit_stack = nullptr;
+}
+#endif
+
 static void pcre_verify(SnortConfig* sc)
 {
     /* The pcre_fullinfo() function can be used to find out how many
@@ -761,6 +966,14 @@ static void pcre_verify(SnortConfig* sc)
 
     sc->pcre_ovector_size = s_ovector_size;
     s_ovector_size = 0;
+
+#ifdef HAVE_PCRE2
+    if ( s_jit_fails )
+    {
+        WarningMessage("pcre: %u expressions could not be jit compiled\n", s_jit_fails);
+        s_jit_fails = 0;
+    }
+#endif
 }
 
 static const IpsApi pcre_api =
@@ -781,8 +994,13 @@ static const IpsApi pcre_api =
     0, 0,
     nullptr,
     nullptr,
+#ifdef HAVE_PCRE2
+    pcre_tinit,
+    pcre_tterm,
+#else
     nullptr,
     nullptr,
+#endif
     pcre_ctor,
     pcre_dtor,
     pcre_verify
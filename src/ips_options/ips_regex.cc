@@ -23,7 +23,10 @@
 
 #include <assert.h>
 #include <string.h>
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <hs_compile.h>
 #include <hs_runtime.h>
@@ -32,12 +35,15 @@
 #include "framework/ips_option.h"
 #include "framework/module.h"
 #include "detection/detection_defines.h"
+#include "detection/fp_detect.h"
 #include "detection/pattern_match_data.h"
 #include "hash/sfhashfcn.h"
 #include "main/snort_config.h"
+#include "main/policy.h"
 #include "main/thread.h"
 #include "parser/parser.h"
 #include "profiler/profiler.h"
+#include "protocols/packet_manager.h"
 
 #define s_name "regex"
 
@@ -78,6 +84,104 @@ static hs_scratch_t* s_scratch = nullptr;
 static THREAD_LOCAL unsigned s_to = 0;
 static THREAD_LOCAL ProfileStats regex_perf_stats;
 
+//-------------------------------------------------------------------------
+// groups
+//
+// all regex options on the same buffer in the same ips policy are also
+// compiled into one database.  the first option evaluated on a buffer
+// scans it once from the start and caches the first match end for every
+// member; the rest just look up their entry.  this only works for
+// searches from the start of the buffer so relative and offset searches
+// still use the option's own database.
+//-------------------------------------------------------------------------
+
+struct RegexGroup
+{
+    std::vector<std::string> res;
+    std::vector<unsigned> flags;
+    hs_database_t* db = nullptr;
+    unsigned id;
+    unsigned size = 0;
+    unsigned refs = 0;
+
+    RegexGroup(unsigned i) : id(i) { }
+
+    ~RegexGroup()
+    {
+        if ( db )
+            hs_free_database(db);
+    }
+
+    unsigned add(const RegexConfig& c)
+    {
+        res.push_back(c.re);
+        flags.push_back(c.flags | HS_FLAG_SINGLEMATCH);
+        return size++;
+    }
+
+    bool compile();
+};
+
+bool RegexGroup::compile()
+{
+    std::vector<const char*> exprs;
+    std::vector<unsigned> ids;
+
+    for ( unsigned i = 0; i < res.size(); ++i )
+    {
+        exprs.push_back(res[i].c_str());
+        ids.push_back(i);
+    }
+
+    hs_compile_error_t* err = nullptr;
+
+    if ( hs_compile_multi(&exprs[0], &flags[0], &ids[0], exprs.size(), HS_MODE_BLOCK,
+        nullptr, &db, &err) or !db )
+    {
+        // members still work individually
+        hs_free_compile_error(err);
+        db = nullptr;
+        return false;
+    }
+    hs_alloc_scratch(db, &s_scratch);
+
+    // the expressions aren't needed once compiled
+    res.clear();
+    flags.clear();
+    return true;
+}
+
+// groups being built for the current configuration
+typedef std::pair<const IpsPolicy*, std::string> RegexGroupKey;
+static std::map<RegexGroupKey, RegexGroup*> s_groups;
+static unsigned s_group_ids = 0;
+
+// per packet thread results of the last scan for each group
+struct RegexHits
+{
+    uint64_t pkt = 0;
+    const uint8_t* buf = nullptr;
+    unsigned len = 0;
+    unsigned found = 0;
+    std::vector<unsigned> ends;
+};
+
+static THREAD_LOCAL std::vector<RegexHits>* s_hits = nullptr;
+
+static int hs_group_match(
+    unsigned int id, unsigned long long /*from*/, unsigned long long to,
+    unsigned int /*flags*/, void* context)
+{
+    RegexHits* hits = (RegexHits*)context;
+
+    if ( !hits->ends[id] )
+    {
+        hits->ends[id] = (unsigned)to;
+        hits->found++;
+    }
+    return hits->found == hits->ends.size() ? 1 : 0;
+}
+
 //-------------------------------------------------------------------------
 // option
 //-------------------------------------------------------------------------
@@ -104,8 +208,13 @@ public:
 
     int eval(Cursor&, Packet*) override;
 
+private:
+    unsigned group_eval(const uint8_t*, unsigned);
+
 private:
     RegexConfig config;
+    RegexGroup* group;
+    unsigned index;
 };
 
 RegexOption::RegexOption(const RegexConfig& c) :
@@ -123,12 +232,36 @@ RegexOption::RegexOption(const RegexConfig& c) :
     config.pmd.pattern_size = config.re.size();
     config.pmd.fp_length = config.pmd.pattern_size;
     config.pmd.fp_offset = 0;
+
+    const char* buf = get_buffer();
+    RegexGroupKey key(get_ips_policy(), buf ? buf : "");
+    auto it = s_groups.find(key);
+
+    if ( it == s_groups.end() )
+        it = s_groups.insert(std::make_pair(key, new RegexGroup(s_group_ids++))).first;
+
+    group = it->second;
+    group->refs++;
+    index = group->add(config);
 }
 
 RegexOption::~RegexOption()
 {
     if ( config.db )
         hs_free_database(config.db);
+
+    if ( !--group->refs )
+    {
+        for ( auto it = s_groups.begin(); it != s_groups.end(); ++it )
+        {
+            if ( it->second == group )
+            {
+                s_groups.erase(it);
+                break;
+            }
+        }
+        delete group;
+    }
 }
 
 uint32_t RegexOption::hash() const
@@ -168,6 +301,35 @@ static int hs_match(
     return 1;  // stop search
 }
 
+// returns the end of the first match or 0 if none
+unsigned RegexOption::group_eval(const uint8_t* buf, unsigned len)
+{
+    if ( !s_hits )
+        s_hits = new std::vector<RegexHits>;
+
+    if ( group->id >= s_hits->size() )
+        s_hits->resize(group->id + 1);
+
+    RegexHits& hits = (*s_hits)[group->id];
+    uint64_t pkt = rule_eval_pkt_count + PacketManager::get_rebuilt_packet_count();
+
+    if ( hits.pkt != pkt or hits.buf != buf or hits.len != len )
+    {
+        SnortState* ss = snort_conf->state + get_instance_id();
+        assert(ss->regex_scratch);
+
+        hits.pkt = pkt;
+        hits.buf = buf;
+        hits.len = len;
+        hits.found = 0;
+        hits.ends.assign(group->size, 0);
+
+        hs_scan(group->db, (const char*)buf, len, 0,
+            (hs_scratch_t*)ss->regex_scratch, hs_group_match, &hits);
+    }
+    return hits.ends[index];
+}
+
 int RegexOption::eval(Cursor& c, Packet*)
 {
     Profile profile(regex_perf_stats);
@@ -180,6 +342,17 @@ int RegexOption::eval(Cursor& c, Packet*)
     if ( pos > c.size() )
         return DETECTION_OPTION_NO_MATCH;
 
+    if ( !pos and group->db )
+    {
+        if ( unsigned to = group_eval(c.buffer(), c.size()) )
+        {
+            c.set_pos(to);
+            c.set_delta(to);
+            return DETECTION_OPTION_MATCH;
+        }
+        return DETECTION_OPTION_NO_MATCH;
+    }
+
     SnortState* ss = snort_conf->state + get_instance_id();
     assert(ss->regex_scratch);
 
@@ -356,6 +529,23 @@ static IpsOption* regex_ctor(Module* m, OptTreeNode*)
 static void regex_dtor(IpsOption* p)
 { delete p; }
 
+static void regex_verify(SnortConfig*)
+{
+    // a lone member gains nothing from its group
+    for ( auto& g : s_groups )
+    {
+        if ( g.second->refs > 1 )
+            g.second->compile();
+    }
+    s_groups.clear();
+}
+
+static void regex_tterm(SnortConfig*)
+{
+    delete s_hits;
+    s_hits = nullptr;
+}
+
 static void regex_pterm(SnortConfig*)
 {
     if ( s_scratch )
@@ -383,10 +573,10 @@ static const IpsApi regex_api =
     nullptr,
     regex_pterm,
     nullptr,
-    nullptr,
+    regex_tterm,
     regex_ctor,
     regex_dtor,
-    nullptr
+    regex_verify
 };
 
 const BaseApi* ips_regex = &regex_api.base;
@@ -22,7 +22,11 @@
 
 #include <string.h>
 #include <assert.h>
+#include <map>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <hs_compile.h>
 #include <hs_runtime.h>
@@ -31,12 +35,16 @@
 #include "framework/ips_option.h"
 #include "framework/module.h"
 #include "detection/detection_defines.h"
+#include "detection/fp_detect.h"
 #include "detection/pattern_match_data.h"
+#include "flow/flow.h"
 #include "hash/sfhashfcn.h"
 #include "main/snort_config.h"
+#include "main/policy.h"
 #include "main/thread.h"
 #include "parser/parser.h"
 #include "profiler/profiler.h"
+#include "protocols/packet_manager.h"
 #include "sd_credit_card.h"
 #include "log/obfuscator.h"
 
@@ -80,11 +88,12 @@ struct SdPatternConfig
     std::string pii;
     unsigned threshold = 1;
     bool obfuscate_pii = false;
+    bool cumulative = false;
     int (*validate)(const uint8_t* buf, unsigned long long buflen) = nullptr;
 
     inline bool operator==(const SdPatternConfig& rhs) const
     {
-        if ( pii == rhs.pii and threshold == rhs.threshold )
+        if ( pii == rhs.pii and threshold == rhs.threshold and cumulative == rhs.cumulative )
             return true;
         return false;
     }
@@ -92,6 +101,157 @@ struct SdPatternConfig
 
 static THREAD_LOCAL ProfileStats sd_pattern_perf_stats;
 
+//-------------------------------------------------------------------------
+// groups
+//
+// all sd_pattern options on the same buffer in the same ips policy are
+// also compiled into one database.  the first option evaluated on a
+// buffer scans it once and keeps the validated matches of every member;
+// the rest just take theirs.  a lone option or a group that fails to
+// compile uses the option's own database.
+//-------------------------------------------------------------------------
+
+struct SdMember
+{
+    int (*validate)(const uint8_t* buf, unsigned long long buflen);
+    bool obfuscate;
+};
+
+struct SdGroup
+{
+    std::vector<std::string> pii;
+    std::vector<SdMember> members;
+    hs_database_t* db = nullptr;
+    unsigned id;
+    unsigned refs = 0;
+
+    SdGroup(unsigned i) : id(i) { }
+
+    ~SdGroup()
+    {
+        if ( db )
+            hs_free_database(db);
+    }
+
+    unsigned add(const SdPatternConfig& c)
+    {
+        pii.push_back(c.pii);
+        members.push_back({ c.validate, c.obfuscate_pii });
+        return members.size() - 1;
+    }
+
+    bool compile();
+};
+
+bool SdGroup::compile()
+{
+    std::vector<const char*> exprs;
+    std::vector<unsigned> flags;
+    std::vector<unsigned> ids;
+
+    for ( unsigned i = 0; i < pii.size(); ++i )
+    {
+        exprs.push_back(pii[i].c_str());
+        flags.push_back(HS_FLAG_DOTALL|HS_FLAG_SOM_LEFTMOST);
+        ids.push_back(i);
+    }
+
+    hs_compile_error_t* err = nullptr;
+
+    if ( hs_compile_multi(&exprs[0], &flags[0], &ids[0], exprs.size(), HS_MODE_BLOCK,
+        nullptr, &db, &err) or !db )
+    {
+        // members still work individually
+        hs_free_compile_error(err);
+        db = nullptr;
+        return false;
+    }
+    hs_alloc_scratch(db, &s_scratch);
+
+    // the patterns aren't needed once compiled
+    pii.clear();
+    return true;
+}
+
+// groups being built for the current configuration
+typedef std::pair<const IpsPolicy*, std::string> SdGroupKey;
+static std::map<SdGroupKey, SdGroup*> s_groups;
+static unsigned s_group_ids = 0;
+
+// a match kept for a member that obfuscates; offsets are from the start
+// of the scan
+struct SdMatch
+{
+    unsigned index;
+    unsigned from;
+    unsigned len;
+};
+
+// per packet thread results of the last scan for each group
+struct SdHits
+{
+    uint64_t pkt = 0;
+    const uint8_t* buf = nullptr;
+    unsigned len = 0;
+    std::vector<unsigned> counts;
+    std::vector<SdMatch> matches;
+};
+
+static THREAD_LOCAL std::vector<SdHits>* s_hits = nullptr;
+
+struct SdScan
+{
+    const SdGroup* group;
+    SdHits* hits;
+};
+
+static int hs_group_match(
+    unsigned int id, unsigned long long from, unsigned long long to,
+    unsigned int /*flags*/, void* context)
+{
+    SdScan* scan = (SdScan*)context;
+    const SdMember& m = scan->group->members[id];
+    SdHits* hits = scan->hits;
+
+    if ( m.validate && m.validate(hits->buf + from, to - from) != 1 )
+        return 0;
+
+    hits->counts[id]++;
+
+    if ( m.obfuscate )
+        hits->matches.push_back({ id, (unsigned)from, (unsigned)(to - from) });
+
+    return 0;
+}
+
+//-------------------------------------------------------------------------
+// flow counts
+//-------------------------------------------------------------------------
+
+class SdFlowData : public FlowData
+{
+public:
+    SdFlowData() : FlowData(flow_id) { }
+
+    static void init()
+    { flow_id = FlowData::get_flow_id(); }
+
+    struct Count
+    {
+        uint64_t pkt = 0;
+        const uint8_t* buf = nullptr;
+        unsigned total = 0;
+    };
+
+    // by option
+    std::unordered_map<unsigned, Count> counts;
+
+    static unsigned flow_id;
+};
+
+unsigned SdFlowData::flow_id = 0;
+static unsigned s_option_ids = 0;
+
 //-------------------------------------------------------------------------
 // option
 //-------------------------------------------------------------------------
@@ -109,7 +269,13 @@ public:
 
 private:
     unsigned SdSearch(Cursor&, Packet*);
+    unsigned group_search(Cursor&, Packet*);
+    unsigned flow_count(Packet*, const uint8_t*, unsigned);
+
     const SdPatternConfig config;
+    SdGroup* group;
+    unsigned index;
+    unsigned id;
 };
 
 SdPatternOption::SdPatternOption(const SdPatternConfig& c) :
@@ -121,17 +287,42 @@ SdPatternOption::SdPatternOption(const SdPatternConfig& c) :
         ParseError("can't initialize sd_pattern for %s (%d) %p",
                 config.pii.c_str(), err, (void*)s_scratch);
     }
+
+    const char* buf = get_buffer();
+    SdGroupKey key(get_ips_policy(), buf ? buf : "");
+    auto it = s_groups.find(key);
+
+    if ( it == s_groups.end() )
+        it = s_groups.insert(std::make_pair(key, new SdGroup(s_group_ids++))).first;
+
+    group = it->second;
+    group->refs++;
+    index = group->add(config);
+    id = s_option_ids++;
 }
 
 SdPatternOption::~SdPatternOption()
 { 
     if ( config.db )
         hs_free_database(config.db);
+
+    if ( !--group->refs )
+    {
+        for ( auto it = s_groups.begin(); it != s_groups.end(); ++it )
+        {
+            if ( it->second == group )
+            {
+                s_groups.erase(it);
+                break;
+            }
+        }
+        delete group;
+    }
 }
 
 uint32_t SdPatternOption::hash() const
 {
-    uint32_t a = 0, b = 0, c = config.threshold;
+    uint32_t a = config.cumulative, b = 0, c = config.threshold;
     mix_str(a, b, c, config.pii.c_str());
     mix_str(a, b, c, get_name());
     finalize(a, b, c);
@@ -176,7 +367,7 @@ int hs_match(unsigned int /*id*/, unsigned long long from,
     assert(ctx->start);
 
     unsigned long long len = to - from;
-    if ( ctx->config.validate && ctx->config.validate(ctx->buf, len) != 1 )
+    if ( ctx->config.validate && ctx->config.validate(ctx->buf + from, len) != 1 )
         return 0;
 
     ctx->count++;
@@ -186,7 +377,7 @@ int hs_match(unsigned int /*id*/, unsigned long long from,
         if ( !ctx->packet->obfuscator )
             ctx->packet->obfuscator = new Obfuscator();
 
-        uint32_t off = ctx->buf - ctx->start;
+        uint32_t off = ctx->buf + from - ctx->start;
         // FIXIT-L Make configurable or don't show any PII partials (0 for user defined??) 
         len = len > 4 ? len - 4 : len;
         ctx->packet->obfuscator->push(off, len);
@@ -195,8 +386,85 @@ int hs_match(unsigned int /*id*/, unsigned long long from,
     return 0;
 }
 
+unsigned SdPatternOption::group_search(Cursor& c, Packet* p)
+{
+    if ( !s_hits )
+        s_hits = new std::vector<SdHits>;
+
+    if ( group->id >= s_hits->size() )
+        s_hits->resize(group->id + 1);
+
+    SdHits& hits = (*s_hits)[group->id];
+    uint64_t pkt = rule_eval_pkt_count + PacketManager::get_rebuilt_packet_count();
+
+    const uint8_t* buf = c.start();
+    unsigned len = c.length();
+
+    if ( hits.pkt != pkt or hits.buf != buf or hits.len != len )
+    {
+        SnortState* ss = snort_conf->state + get_instance_id();
+        assert(ss->sdpattern_scratch);
+
+        hits.pkt = pkt;
+        hits.buf = buf;
+        hits.len = len;
+        hits.counts.assign(group->members.size(), 0);
+        hits.matches.clear();
+
+        SdScan scan { group, &hits };
+
+        hs_error_t stat = hs_scan(group->db, (const char*)buf, len, 0,
+            (hs_scratch_t*)ss->sdpattern_scratch, hs_group_match, (void*)&scan);
+
+        if ( stat == HS_SCAN_TERMINATED )
+            ++s_stats.terminated;
+    }
+
+    if ( config.obfuscate_pii and hits.counts[index] )
+    {
+        if ( !p->obfuscator )
+            p->obfuscator = new Obfuscator();
+
+        const uint32_t off = buf - c.buffer();
+
+        for ( const auto& m : hits.matches )
+        {
+            // FIXIT-L Make configurable or don't show any PII partials (0 for user defined??)
+            if ( m.index == index )
+                p->obfuscator->push(off + m.from, m.len > 4 ? m.len - 4 : m.len);
+        }
+    }
+    return hits.counts[index];
+}
+
+// counts each buffer once no matter how often the option is evaluated
+unsigned SdPatternOption::flow_count(Packet* p, const uint8_t* buf, unsigned matches)
+{
+    SdFlowData* fd = (SdFlowData*)p->flow->get_application_data(SdFlowData::flow_id);
+
+    if ( !fd )
+    {
+        fd = new SdFlowData;
+        p->flow->set_application_data(fd);
+    }
+
+    SdFlowData::Count& n = fd->counts[id];
+    uint64_t pkt = rule_eval_pkt_count + PacketManager::get_rebuilt_packet_count();
+
+    if ( n.pkt != pkt or n.buf != buf )
+    {
+        n.pkt = pkt;
+        n.buf = buf;
+        n.total += matches;
+    }
+    return n.total;
+}
+
 unsigned SdPatternOption::SdSearch(Cursor& c, Packet* p)
 {
+    if ( group->db )
+        return group_search(c, p);
+
     const uint8_t* const start = c.buffer();
     const uint8_t* buf = c.start();
     unsigned int buflen = c.length();
@@ -222,6 +490,9 @@ int SdPatternOption::eval(Cursor& c, Packet* p)
 
     unsigned matches = SdSearch(c, p);
 
+    if ( config.cumulative and matches and p->flow )
+        matches = flow_count(p, c.start(), matches);
+
     if ( matches >= config.threshold )
         return DETECTION_OPTION_MATCH;
     else if ( matches == 0 )
@@ -244,6 +515,9 @@ static const Parameter s_params[] =
     { "threshold", Parameter::PT_INT, "1", nullptr,
       "number of matches before alerting" },
 
+    { "cumulative", Parameter::PT_IMPLIED, nullptr, nullptr,
+      "count matches in all buffers of the flow toward the threshold" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -291,6 +565,8 @@ bool SdPatternModule::set(const char*, Value& v, SnortConfig* sc)
     }
     else if ( v.is("threshold") )
         config.threshold = v.get_long();
+    else if ( v.is("cumulative") )
+        config.cumulative = true;
     else
         return false;
 
@@ -389,6 +665,26 @@ static void sd_pattern_dtor(IpsOption* p)
     delete p;
 }
 
+static void sd_pattern_pinit(SnortConfig*)
+{ SdFlowData::init(); }
+
+static void sd_pattern_verify(SnortConfig*)
+{
+    // a lone member gains nothing from its group
+    for ( auto& g : s_groups )
+    {
+        if ( g.second->refs > 1 )
+            g.second->compile();
+    }
+    s_groups.clear();
+}
+
+static void sd_pattern_tterm(SnortConfig*)
+{
+    delete s_hits;
+    s_hits = nullptr;
+}
+
 static const IpsApi sd_pattern_api =
 {
     {
@@ -405,13 +701,13 @@ static const IpsApi sd_pattern_api =
     },
     OPT_TYPE_DETECTION,
     0, 0,
+    sd_pattern_pinit,
     nullptr,
     nullptr,
-    nullptr,
-    nullptr,
+    sd_pattern_tterm,
     sd_pattern_ctor,
     sd_pattern_dtor,
-    nullptr
+    sd_pattern_verify
 };
 
 #ifdef BUILDING_SO
@@ -23,10 +23,19 @@
 
 #include <ctype.h>
 #include <stdio.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
 
 #define ISSUER_SIZE     4
-#define CC_COPY_BUF_LEN 20 /* 16 digits + 3 spaces/dashes + null */
-#define MIN_CC_BUF_LEN  15 /* 13 digits + 2 surrounding non-digits */
+#define CC_DIGITS       16
+#define MIN_CC_BUF_LEN  13 /* 13 digits */
 
 /* Check the Issuer Identification Number of a CC#. */
 static inline int CheckIssuers(const uint8_t *cardnum, uint32_t buflen)
@@ -56,34 +65,73 @@ static inline int CheckIssuers(const uint8_t *cardnum, uint32_t buflen)
     return 0;
 }
 
+// sum the Luhn digits of a 16 digit string right aligned with leading '0's
+// (which add nothing) so that every second digit from the right is at an
+// even index
+static inline int luhn_sum(const char* cc)
+{
+#ifdef __SSE2__
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i four = _mm_set1_epi8(4);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i even = _mm_set_epi8(0,-1,0,-1,0,-1,0,-1,0,-1,0,-1,0,-1,0,-1);
+
+    __m128i d = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)cc), zero);
+
+    // doubled d is 2d - 9 when d > 4
+    __m128i dd = _mm_add_epi8(d, d);
+    dd = _mm_sub_epi8(dd, _mm_and_si128(_mm_cmpgt_epi8(d, four), nine));
+    d = _mm_or_si128(_mm_and_si128(even, dd), _mm_andnot_si128(even, d));
+
+    __m128i s = _mm_sad_epu8(d, _mm_setzero_si128());
+    return _mm_cvtsi128_si32(s) + _mm_extract_epi16(s, 4);
+#else
+    int sum = 0;
+
+    for ( int i = 0; i < CC_DIGITS; ++i )
+    {
+        int val = cc[i] - '0';
+
+        if ( !(i & 1) )
+        {
+            val *= 2;
+            if (val > 9)
+                val -= 9;
+        }
+        sum += val;
+    }
+    return sum;
+#endif
+}
+
 /* This function takes a string representation of a credit card number and
- * checks that it's a valid number. The number may contain spaces or dashes.
+ * checks that it's a valid number. The number may contain spaces or dashes
+ * and may have a non-digit on either side.
  *
  * Returns: 1 on match, 0 otherwise.
  */
 int SdLuhnAlgorithm(const uint8_t *buf, unsigned long long buflen)
 {
-    int i, digits, alternate, sum, val;
-    char cc_digits[CC_COPY_BUF_LEN]; /* Normalized CC# string */
+    int digits;
+    char cc_digits[CC_DIGITS]; /* Normalized CC# string */
     uint32_t j;
 
     if (buf == NULL || buflen < MIN_CC_BUF_LEN)
         return 0;
 
-    /* Generally, the buffer has two non-digits, one on either side. Sometimes,
-     * when the buffer is pointing to the first line of the data, it might
-     * start with a digit, instead of a non-digit. Strip the non-digits
-     * only.
-     */
-    if (isdigit((int)buf[0]))
-        buflen -= 1;
-
-    else
+    /* Strip the surrounding non-digits, if any. */
+    if (!isdigit((int)buf[0]))
     {
         buf++;
-        buflen -= 2;
+        buflen--;
     }
 
+    if (buflen && !isdigit((int)buf[buflen-1]))
+        buflen--;
+
+    if (buflen < MIN_CC_BUF_LEN)
+        return 0;
+
     /* If the first digit is greater than 6, this isn't one of the major
        credit cards. */
     if (!isdigit((int)buf[0]) || buf[0] > '6')
@@ -93,11 +141,7 @@ int SdLuhnAlgorithm(const uint8_t *buf, unsigned long long buflen)
     if (CheckIssuers(buf, buflen) == 0)
         return 0;
 
-    /* Limit to 16 digits + spaces in between */
-    if (buflen >= CC_COPY_BUF_LEN)
-        buflen = CC_COPY_BUF_LEN - 1;
-
-    /* Copy the string into cc_digits, stripping out spaces & dashes. */
+    /* Count the digits, allowing spaces & dashes. */
     digits = 0;
     for (j = 0; j < buflen; j++)
     {
@@ -106,39 +150,59 @@ int SdLuhnAlgorithm(const uint8_t *buf, unsigned long long buflen)
             if (buf[j] == ' ' || buf[j] == '-')
                 continue;
             else
-                break;
+                return 0;
         }
-
-        cc_digits[digits++] = buf[j];
+        if ( ++digits > CC_DIGITS )
+            return 0;
     }
-    cc_digits[digits] = '\0';
 
-    /* Check if the string was too short, or we broke at an invalid character */
-    if (digits < 13 || digits > 16 || j < buflen)
+    if (digits < 13)
         return 0;
 
+    /* Copy the digits into cc_digits right aligned. */
+    memset(cc_digits, '0', CC_DIGITS - digits);
+    digits = CC_DIGITS;
+
+    for (j = buflen; j > 0; j--)
+    {
+        if (isdigit((int)buf[j-1]))
+            cc_digits[--digits] = buf[j-1];
+    }
+
     /* The Luhn algorithm:
         1) Starting at the right-most digit, double every second digit.
         2) Sum all the *individual* digits (i.e. 16 => 1+6)
         3) If the Sum mod 10 == 0, the CC# is valid.
      */
-    alternate = 0;
-    sum = 0;
-    for (i = digits - 1; i >= 0; i--)
-    {
-        val = cc_digits[i] - '0';
-        if (alternate)
-        {
-            val *= 2;
-            if (val > 9)
-                val -= 9;
-        }
-        alternate = !alternate;
-        sum += val;
-    }
-
-    if (sum % 10)
+    if (luhn_sum(cc_digits) % 10)
         return 0;
 
     return 1;
 }
+
+#ifdef UNIT_TEST
+
+static int luhn(const char* s)
+{ return SdLuhnAlgorithm((const uint8_t*)s, strlen(s)); }
+
+TEST_CASE("luhn", "[sd_pattern]")
+{
+    CHECK(luhn("4111111111111111"));
+    CHECK(luhn("4111 1111 1111 1111"));
+    CHECK(luhn("4111-1111-1111-1111"));
+    CHECK(luhn(" 4111111111111111 "));
+    CHECK(luhn(":4111111111111111"));
+    CHECK(luhn("378282246310005"));
+    CHECK(luhn("6011111111111117"));
+    CHECK(luhn("5105105105105100"));
+    CHECK(luhn("4222222222222"));
+
+    CHECK(!luhn("4111111111111112"));
+    CHECK(!luhn("378282246310006"));
+    CHECK(!luhn("7111111111111111"));
+    CHECK(!luhn("41111111111111110"));
+    CHECK(!luhn("411111111111"));
+    CHECK(!luhn("4111x1111 1111 1111"));
+}
+
+#endif
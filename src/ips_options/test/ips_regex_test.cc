@@ -26,9 +26,11 @@
 #include "framework/ips_option.h"
 #include "framework/module.h"
 #include "detection/detection_defines.h"
+#include "main/policy.h"
 #include "main/snort_config.h"
 #include "profiler/memory_profiler_defs.h"
 #include "protocols/packet.h"
+#include "protocols/packet_manager.h"
 
 // must appear after snort_config.h to avoid broken c++ map include
 #include <CppUTest/CommandLineTestRunner.h>
@@ -95,6 +97,14 @@ void show_stats(PegCount*, const PegInfo*, IndexVec&, const char*, FILE*) { }
 char* snort_strdup(const char* s)
 { return strdup(s); }
 
+IpsPolicy* get_ips_policy()
+{ return nullptr; }
+
+THREAD_LOCAL uint64_t rule_eval_pkt_count = 0;
+
+PegCount PacketManager::get_rebuilt_packet_count()
+{ return 0; }
+
 //-------------------------------------------------------------------------
 // helpers
 //-------------------------------------------------------------------------
@@ -355,6 +365,70 @@ TEST(ips_regex_option_relative, no_match)
     CHECK(!opt->retry());
 }
 
+//-------------------------------------------------------------------------
+// group tests
+//-------------------------------------------------------------------------
+
+TEST_GROUP(ips_regex_group)
+{
+    IpsOption* foo = nullptr;
+    IpsOption* stew = nullptr;
+    IpsOption* bar = nullptr;
+
+    void setup()
+    {
+        foo = get_option(" foo ");
+        stew = get_option("stew");
+        bar = get_option("bar");
+
+        IpsApi* api = (IpsApi*)ips_regex;
+        api->verify(snort_conf);
+        regex_setup(snort_conf);
+    }
+    void teardown()
+    {
+        IpsApi* api = (IpsApi*)ips_regex;
+        api->dtor(foo);
+        api->dtor(stew);
+        api->dtor(bar);
+        api->tterm(snort_conf);
+        regex_cleanup(snort_conf);
+        api->pterm(snort_conf);
+    }
+};
+
+TEST(ips_regex_group, match)
+{
+    Packet pkt;
+    pkt.data = (uint8_t*)"* foo stew *";
+    pkt.dsize = strlen((char*)pkt.data);
+
+    Cursor c1(&pkt);
+    CHECK(foo->eval(c1, &pkt) == DETECTION_OPTION_MATCH);
+    CHECK(!strcmp((char*)c1.start(), "stew *"));
+
+    Cursor c2(&pkt);
+    CHECK(stew->eval(c2, &pkt) == DETECTION_OPTION_MATCH);
+    CHECK(!strcmp((char*)c2.start(), " *"));
+
+    Cursor c3(&pkt);
+    CHECK(bar->eval(c3, &pkt) == DETECTION_OPTION_NO_MATCH);
+}
+
+TEST(ips_regex_group, delta)
+{
+    Packet pkt;
+    pkt.data = (uint8_t*)"* foo stew *";
+    pkt.dsize = strlen((char*)pkt.data);
+
+    // offset searches don't use the group
+    Cursor c(&pkt);
+    c.set_delta(3);
+
+    CHECK(foo->eval(c, &pkt) == DETECTION_OPTION_NO_MATCH);
+    CHECK(stew->eval(c, &pkt) == DETECTION_OPTION_MATCH);
+}
+
 //-------------------------------------------------------------------------
 // main
 //-------------------------------------------------------------------------
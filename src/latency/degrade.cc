@@ -0,0 +1,176 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// degrade.cc
+
+#include "degrade.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "log/messages.h"
+#include "main/snort_config.h"
+#include "latency_config.h"
+#include "latency_stats.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+THREAD_LOCAL unsigned degrade_tier = 0;
+
+// packets in a row past engage (positive) or disengage (negative)
+static THREAD_LOCAL int degrade_run = 0;
+
+static inline const DegradeConfig& get_config()
+{ return snort_conf->latency->degrade; }
+
+int Degrade::step(const DegradeConfig& config, unsigned load)
+{
+    if ( load >= config.engage and degrade_tier < config.tiers )
+    {
+        if ( degrade_run < 0 )
+            degrade_run = 0;
+
+        if ( (unsigned)++degrade_run < config.hold )
+            return 0;
+
+        ++degrade_tier;
+        degrade_run = 0;
+        return 1;
+    }
+    if ( load <= config.disengage and degrade_tier )
+    {
+        if ( degrade_run > 0 )
+            degrade_run = 0;
+
+        if ( (unsigned)-(--degrade_run) < config.hold )
+            return 0;
+
+        --degrade_tier;
+        degrade_run = 0;
+        return -1;
+    }
+    degrade_run = 0;
+    return 0;
+}
+
+void Degrade::update(unsigned load)
+{
+    const DegradeConfig& config = get_config();
+
+    if ( !config.enabled() )
+        return;
+
+    int change = step(config, load);
+
+    if ( change > 0 )
+    {
+        ++latency_stats.degrade_engages;
+        LogMessage("latency: degrade tier %u engaged at %u%% load\n", degrade_tier, load);
+    }
+    else if ( change < 0 )
+    {
+        ++latency_stats.degrade_disengages;
+        LogMessage("latency: degrade tier %u disengaged at %u%% load\n", degrade_tier + 1, load);
+    }
+}
+
+unsigned Degrade::max_pdu()
+{ return engaged(DEPTH) ? get_config().max_pdu : 0; }
+
+unsigned Degrade::depth()
+{ return engaged(DEPTH) ? get_config().depth : 0; }
+
+unsigned Degrade::get_priority()
+{ return get_config().priority; }
+
+void Degrade::tterm()
+{
+    degrade_tier = 0;
+    degrade_run = 0;
+}
+
+#ifdef UNIT_TEST
+
+TEST_CASE("degrade tiers", "[latency]")
+{
+    DegradeConfig config;
+    config.tiers = 2;
+    config.engage = 80;
+    config.disengage = 40;
+    config.hold = 3;
+
+    Degrade::tterm();
+
+    SECTION("engage needs a sustained load")
+    {
+        CHECK(Degrade::step(config, 90) == 0);
+        CHECK(Degrade::step(config, 90) == 0);
+        CHECK(Degrade::step(config, 60) == 0);
+        CHECK(Degrade::step(config, 90) == 0);
+        CHECK(Degrade::step(config, 90) == 0);
+        CHECK(Degrade::step(config, 90) == 1);
+        CHECK(Degrade::engaged(Degrade::APPID));
+        CHECK_FALSE(Degrade::engaged(Degrade::DEPTH));
+    }
+
+    SECTION("tiers stop at the configured limit")
+    {
+        for ( int i = 0; i < 10; ++i )
+            Degrade::step(config, 100);
+
+        CHECK(degrade_tier == 2);
+        CHECK_FALSE(Degrade::engaged(Degrade::RULES));
+    }
+
+    SECTION("loads between the thresholds hold the tier")
+    {
+        for ( int i = 0; i < 3; ++i )
+            Degrade::step(config, 100);
+
+        for ( int i = 0; i < 10; ++i )
+            CHECK(Degrade::step(config, 60) == 0);
+
+        CHECK(degrade_tier == 1);
+    }
+
+    SECTION("disengage one tier at a time")
+    {
+        for ( int i = 0; i < 6; ++i )
+            Degrade::step(config, 100);
+
+        CHECK(degrade_tier == 2);
+        CHECK(Degrade::step(config, 10) == 0);
+        CHECK(Degrade::step(config, 10) == 0);
+        CHECK(Degrade::step(config, 10) == -1);
+        CHECK(degrade_tier == 1);
+
+        for ( int i = 0; i < 3; ++i )
+            Degrade::step(config, 10);
+
+        CHECK(degrade_tier == 0);
+        CHECK(Degrade::step(config, 10) == 0);
+    }
+
+    Degrade::tterm();
+}
+
+#endif
+
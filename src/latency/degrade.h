@@ -0,0 +1,70 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// degrade.h
+
+#ifndef DEGRADE_H
+#define DEGRADE_H
+
+// Degrade trades inspection depth for throughput in steps while packet
+// latency stays high instead of leaving it all to fastpath.  Each tier
+// includes the ones below it:
+//
+// 1. skip appid payload detection
+// 2. cap pdus at max_pdu and inspect at most depth bytes per direction
+// 3. suspend rule trees whose best priority is priority or worse
+//
+// The tier is per packet thread and moves one step at a time after the
+// load has been held past engage or disengage for hold packets.
+
+#include "main/thread.h"
+
+struct DegradeConfig;
+
+extern THREAD_LOCAL unsigned degrade_tier;
+
+class Degrade
+{
+public:
+    enum Tier
+    { NONE, APPID, DEPTH, RULES, MAX };
+
+    // load is the percent of packet max_time in use
+    static void update(unsigned load);
+
+    static bool engaged(Tier t)
+    { return degrade_tier >= (unsigned)t; }
+
+    // these return 0 when there is no limit
+    static unsigned max_pdu();
+    static unsigned depth();
+
+    // rule trees with rules no better than this are suspended at tier 3
+    static unsigned get_priority();
+
+    static bool suspended(unsigned priority)
+    { return engaged(RULES) and priority >= get_priority(); }
+
+    // returns the change in tier: -1, 0, or 1
+    static int step(const DegradeConfig&, unsigned load);
+
+    static void tterm();
+};
+
+#endif
+
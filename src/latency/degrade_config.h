@@ -0,0 +1,41 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// degrade_config.h
+
+#ifndef DEGRADE_CONFIG_H
+#define DEGRADE_CONFIG_H
+
+#include <cstdint>
+
+struct DegradeConfig
+{
+    unsigned tiers = 0;       // highest tier used; 0 is disabled
+    unsigned engage = 90;     // load pct at or above which the next tier engages
+    unsigned disengage = 50;  // load pct at or below which the top tier disengages
+    unsigned hold = 10000;    // packets a threshold must be held before a change
+
+    uint32_t max_pdu = 4096;  // tier 2 pdu cap
+    uint32_t depth = 16384;   // tier 2 per direction inspection depth
+    unsigned priority = 3;    // tier 3 suspends rules with this number or more
+
+    bool enabled() const { return tiers > 0; }
+};
+
+#endif
+
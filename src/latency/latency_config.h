@@ -21,6 +21,7 @@
 #ifndef LATENCY_CONFIG_H
 #define LATENCY_CONFIG_H
 
+#include "degrade_config.h"
 #include "packet_latency_config.h"
 #include "rule_latency_config.h"
 
@@ -28,6 +29,7 @@ struct LatencyConfig
 {
     PacketLatencyConfig packet_latency;
     RuleLatencyConfig rule_latency;
+    DegradeConfig degrade;
 };
 
 #endif
@@ -71,6 +71,33 @@ static const Parameter s_rule_params[] =
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
+static const Parameter s_degrade_params[] =
+{
+    { "tiers", Parameter::PT_INT, "0:3", "0",
+        "highest tier to engage (1 skips appid payload detection, 2 also limits "
+        "pdus and depth, 3 also suspends low priority rules, 0 disables)" },
+
+    { "engage", Parameter::PT_INT, "1:100", "90",
+        "engage the next tier at this percent of packet max_time" },
+
+    { "disengage", Parameter::PT_INT, "0:99", "50",
+        "disengage the current tier at this percent of packet max_time" },
+
+    { "hold", Parameter::PT_INT, "1:", "10000",
+        "packets the load must stay past a threshold before the tier changes" },
+
+    { "max_pdu", Parameter::PT_INT, "0:65535", "4096",
+        "tier 2 maximum reassembled pdu size (0 is unlimited)" },
+
+    { "depth", Parameter::PT_INT, "0:", "16384",
+        "tier 2 payload bytes per direction to inspect (0 is unlimited)" },
+
+    { "priority", Parameter::PT_INT, "1:", "3",
+        "tier 3 suspends rules with this priority number or higher" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
 static const Parameter s_params[] =
 {
     { "packet", Parameter::PT_TABLE, s_packet_params, nullptr,
@@ -79,6 +106,9 @@ static const Parameter s_params[] =
     { "rule", Parameter::PT_TABLE, s_rule_params, nullptr,
       "rule latency" },
 
+    { "degrade", Parameter::PT_TABLE, s_degrade_params, nullptr,
+      "trade inspection depth for throughput under packet latency" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -100,6 +130,8 @@ static const PegInfo latency_pegs[] =
     { "total_rule_evals", "total rule evals monitored" },
     { "rule_eval_timeouts", "rule evals that timed out" },
     { "rule_tree_enables", "rule tree re-enables" },
+    { "degrade_engages", "degrade tiers engaged" },
+    { "degrade_disengages", "degrade tiers disengaged" },
     { nullptr, nullptr }
 };
 
@@ -159,6 +191,35 @@ static inline bool latency_set(Value& v, RuleLatencyConfig& config)
     return true;
 }
 
+static inline bool latency_set(Value& v, DegradeConfig& config)
+{
+    if ( v.is("tiers") )
+        config.tiers = v.get_long();
+
+    else if ( v.is("engage") )
+        config.engage = v.get_long();
+
+    else if ( v.is("disengage") )
+        config.disengage = v.get_long();
+
+    else if ( v.is("hold") )
+        config.hold = v.get_long();
+
+    else if ( v.is("max_pdu") )
+        config.max_pdu = v.get_long();
+
+    else if ( v.is("depth") )
+        config.depth = v.get_long();
+
+    else if ( v.is("priority") )
+        config.priority = v.get_long();
+
+    else
+        return false;
+
+    return true;
+}
+
 LatencyModule::LatencyModule() :
     Module(s_name, s_help, s_params)
 { }
@@ -167,6 +228,7 @@ bool LatencyModule::set(const char* fqn, Value& v, SnortConfig* sc)
 {
     const char* slp = "latency.packet";
     const char* slr = "latency.rule";
+    const char* sld = "latency.degrade";
 
     if ( !strncmp(fqn, slp, strlen(slp)) )
         return latency_set(v, sc->latency->packet_latency);
@@ -174,6 +236,9 @@ bool LatencyModule::set(const char* fqn, Value& v, SnortConfig* sc)
     else if ( !strncmp(fqn, slr, strlen(slr)) )
         return latency_set(v, sc->latency->rule_latency);
 
+    else if ( !strncmp(fqn, sld, strlen(sld)) )
+        return latency_set(v, sc->latency->degrade);
+
     return false;
 }
 
@@ -31,6 +31,8 @@ struct LatencyStats
     PegCount total_rule_evals;
     PegCount rule_eval_timeouts;
     PegCount rule_tree_enables;
+    PegCount degrade_engages;
+    PegCount degrade_disengages;
 };
 
 extern THREAD_LOCAL LatencyStats latency_stats;
@@ -29,6 +29,7 @@
 #include "protocols/packet.h"
 #include "sfip/sf_ip.h"
 #include "time/clock_defs.h"
+#include "degrade.h"
 #include "latency_config.h"
 #include "latency_timer.h"
 #include "latency_util.h"
@@ -112,7 +113,15 @@ public:
     bool pop(const Packet*);
     bool fastpath();
 
+    unsigned headroom() const
+    { return 100 - load / LOAD_WEIGHT; }
+
 private:
+    // moving average of the percent of max_time used per packet,
+    // scaled by LOAD_WEIGHT
+    static const unsigned LOAD_WEIGHT = 8;
+    unsigned load = 0;
+
     // FIXIT-L use custom struct instead of std::pair for better semantics
     // std::vector<std::pair<LatencyTimer<Clock>, bool>> contexts;
     std::vector<PacketTimer<Clock>> timers;
@@ -156,6 +165,16 @@ inline bool Impl<Clock>::pop(const Packet* p)
             event_handler.handle(e);
     }
 
+    using std::chrono::duration_cast;
+    auto max_time = duration_cast<typename Clock::duration>(config->max_time);
+
+    if ( max_time.count() > 0 )
+    {
+        auto used = timer.elapsed().count() * 100 / max_time.count();
+        unsigned pct = ( used > 100 ) ? 100 : (unsigned)used;
+        load = load - load / LOAD_WEIGHT + pct;
+    }
+
     timers.pop_back();
     return timed_out;
 }
@@ -208,6 +227,40 @@ static struct SnortLogHandler : public EventHandler
 
 static THREAD_LOCAL Impl<>* impl = nullptr;
 
+// only the outermost packet is timed; rebuilt packets are part of it
+static const unsigned max_observers = 4;
+
+static struct Observed
+{
+    struct
+    {
+        PacketLatency::Observer fn;
+        void* user;
+    } slots[max_observers];
+
+    unsigned count;
+    unsigned depth;
+    hr_duration::rep start;
+} THREAD_LOCAL observed;
+
+static inline void observe_push()
+{
+    if ( observed.count and !observed.depth++ )
+        observed.start = DefaultClock::now().time_since_epoch().count();
+}
+
+static inline void observe_pop(const Packet* p)
+{
+    if ( observed.count and observed.depth and !--observed.depth )
+    {
+        hr_duration::rep now = DefaultClock::now().time_since_epoch().count();
+        hr_duration d(now - observed.start);
+
+        for ( unsigned i = 0; i < observed.count; ++i )
+            observed.slots[i].fn(p, d, observed.slots[i].user);
+    }
+}
+
 static inline Impl<>& get_impl()
 {
     if ( !impl )
@@ -229,14 +282,21 @@ void PacketLatency::push()
         packet_latency::get_impl().push();
         ++latency_stats.total_packets;
     }
+    packet_latency::observe_push();
 }
 
 void PacketLatency::pop(const Packet* p)
 {
+    packet_latency::observe_pop(p);
+
     if ( packet_latency::config->enabled() )
     {
-        if ( packet_latency::get_impl().pop(p) )
+        auto& impl = packet_latency::get_impl();
+
+        if ( impl.pop(p) )
             ++latency_stats.packet_timeouts;
+
+        Degrade::update(100 - impl.headroom());
     }
 }
 
@@ -248,6 +308,46 @@ bool PacketLatency::fastpath()
     return false;
 }
 
+unsigned PacketLatency::headroom()
+{
+    if ( packet_latency::config->enabled() and packet_latency::impl )
+        return packet_latency::impl->headroom();
+
+    return 100;
+}
+
+bool PacketLatency::add_observer(Observer fn, void* user)
+{
+    using packet_latency::observed;
+
+    if ( observed.count >= packet_latency::max_observers )
+        return false;
+
+    observed.slots[observed.count].fn = fn;
+    observed.slots[observed.count].user = user;
+    observed.count++;
+    observed.depth = 0;
+    return true;
+}
+
+void PacketLatency::remove_observer(Observer fn, void* user)
+{
+    using packet_latency::observed;
+
+    for ( unsigned i = 0; i < observed.count; ++i )
+    {
+        if ( observed.slots[i].fn != fn or observed.slots[i].user != user )
+            continue;
+
+        for ( unsigned j = i + 1; j < observed.count; ++j )
+            observed.slots[j - 1] = observed.slots[j];
+
+        observed.count--;
+        observed.depth = 0;
+        return;
+    }
+}
+
 void PacketLatency::tterm()
 {
     using packet_latency::impl;
@@ -373,6 +473,28 @@ TEST_CASE ( "packet latency impl", "[latency]" )
             CHECK( log_handler.count == 0 );
         }
     }
+
+    SECTION( "headroom" )
+    {
+        CHECK( impl.headroom() == 100 );
+
+        for ( int i = 0; i < 64; ++i )
+        {
+            impl.push();
+            MockClock::inc(config.config.max_time + 1_ticks);
+            impl.pop(nullptr);
+        }
+
+        CHECK( impl.headroom() == 0 );
+
+        for ( int i = 0; i < 64; ++i )
+        {
+            impl.push();
+            impl.pop(nullptr);
+        }
+
+        CHECK( impl.headroom() == 100 );
+    }
 }
 
 #endif
@@ -23,6 +23,8 @@
 
 #include <cstdint>
 
+#include "time/clock_defs.h"
+
 struct Packet;
 
 class PacketLatency
@@ -32,8 +34,18 @@ public:
     static void pop(const Packet*);
     static bool fastpath();
 
+    // percent of max_time left over by recent packets; 100 if disabled
+    static unsigned headroom();
+
     static void tterm();
 
+    // the observer is called on this packet thread with the time taken by
+    // each packet from the wire, whether or not max_time is set; a few
+    // observers may be added per thread, add returns false when full
+    using Observer = void (*)(const Packet*, hr_duration, void*);
+    static bool add_observer(Observer, void*);
+    static void remove_observer(Observer, void*);
+
     class Context
     {
     public:
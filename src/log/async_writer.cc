@@ -0,0 +1,423 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// async_writer.cc
+
+#include "async_writer.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <string.h>
+
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+// enough iovecs for several full chunks per writev
+#define MAX_BATCH 64
+#define QUEUE_SIZE 1024
+#define IDLE_WAIT_MS 10
+
+//-------------------------------------------------------------------------
+// sink helpers
+//-------------------------------------------------------------------------
+
+int AsyncSink::write_all(int fd, const struct iovec* v, int n)
+{
+    iov.assign(v, v + n);
+    struct iovec* p = iov.data();
+
+    while ( n > 0 )
+    {
+        ssize_t len = writev(fd, p, n);
+
+        if ( len < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+
+            return errno;
+        }
+
+        // skip whatever was written; writev can stop short
+        while ( n > 0 and (size_t)len >= p->iov_len )
+        {
+            len -= p->iov_len;
+            ++p;
+            --n;
+        }
+        if ( n > 0 )
+        {
+            p->iov_base = (uint8_t*)p->iov_base + len;
+            p->iov_len -= len;
+        }
+    }
+    return 0;
+}
+
+//-------------------------------------------------------------------------
+// writer thread
+//-------------------------------------------------------------------------
+
+static MpscRing<void*>* s_queue = nullptr;
+static std::thread* s_thread = nullptr;
+static unsigned s_users = 0;
+static std::mutex s_users_lock;
+
+static std::mutex s_wait_lock;
+static std::condition_variable s_ready;
+static std::atomic<bool> s_stop(false);
+
+static inline uint64_t now_ms()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void AsyncWriter::start()
+{
+    std::lock_guard<std::mutex> g(s_users_lock);
+
+    if ( s_users++ )
+        return;
+
+    s_queue = new MpscRing<void*>(QUEUE_SIZE);
+    s_stop = false;
+    s_thread = new std::thread(writer);
+}
+
+void AsyncWriter::stop()
+{
+    std::lock_guard<std::mutex> g(s_users_lock);
+
+    if ( --s_users )
+        return;
+
+    s_stop = true;
+    s_ready.notify_one();
+
+    s_thread->join();
+    delete s_thread;
+    s_thread = nullptr;
+
+    delete s_queue;
+    s_queue = nullptr;
+}
+
+// runs of chunks from the same owner go out with one writev; a chunk
+// marked rotate starts a new run after the sink rotates
+void AsyncWriter::writer()
+{
+    void* batch[MAX_BATCH];
+    struct iovec iov[MAX_BATCH];
+
+    while ( true )
+    {
+        unsigned n = s_queue->get(batch, MAX_BATCH);
+
+        if ( !n )
+        {
+            if ( s_stop )
+                break;
+
+            std::unique_lock<std::mutex> g(s_wait_lock);
+            s_ready.wait_for(g, std::chrono::milliseconds(IDLE_WAIT_MS),
+                [] { return s_stop or !s_queue->empty(); });
+            continue;
+        }
+
+        unsigned i = 0;
+
+        while ( i < n )
+        {
+            Chunk* c = (Chunk*)batch[i];
+            AsyncWriter* w = c->owner;
+
+            if ( c->rotate )
+                w->sink->rotate();
+
+            unsigned j = i;
+            int k = 0;
+
+            do
+            {
+                c = (Chunk*)batch[j++];
+                iov[k].iov_base = c->data;
+                iov[k++].iov_len = c->len;
+            }
+            while ( j < n and ((Chunk*)batch[j])->owner == w and !((Chunk*)batch[j])->rotate );
+
+            w->sink->write(iov, k);
+
+            for ( ; i < j; ++i )
+            {
+                c = (Chunk*)batch[i];
+                c->len = 0;
+                c->rotate = false;
+
+                // can't fail; the ring holds all of the owner's chunks
+                w->free_chunks.put(c);
+                w->in_flight--;
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+// packet thread
+//-------------------------------------------------------------------------
+
+AsyncWriter::AsyncWriter(AsyncSink* s, unsigned size, unsigned num, unsigned ms) :
+    free_chunks(num)
+{
+    sink = s;
+    num_chunks = num;
+    chunk_size = size;
+    flush_ms = ms;
+
+    cur = nullptr;
+    cur_time = 0;
+    rotate_next = false;
+    stalls = 0;
+    in_flight = 0;
+
+    chunks = new Chunk[num_chunks];
+
+    for ( unsigned i = 0; i < num_chunks; ++i )
+    {
+        chunks[i] = { this, new uint8_t[chunk_size], 0, false };
+        free_chunks.put(chunks + i);
+    }
+
+    start();
+}
+
+AsyncWriter::~AsyncWriter()
+{
+    drain();
+    stop();
+
+    for ( unsigned i = 0; i < num_chunks; ++i )
+        delete[] chunks[i].data;
+
+    delete[] chunks;
+}
+
+AsyncWriter::Chunk* AsyncWriter::get_chunk()
+{
+    Chunk* c;
+
+    if ( free_chunks.get(c) )
+        return c;
+
+    ++stalls;
+
+    while ( !free_chunks.get(c) )
+        std::this_thread::yield();
+
+    return c;
+}
+
+void AsyncWriter::submit()
+{
+    cur->rotate = rotate_next;
+    rotate_next = false;
+
+    in_flight++;
+
+    while ( !s_queue->put(cur) )
+        std::this_thread::yield();
+
+    s_ready.notify_one();
+    cur = nullptr;
+}
+
+void AsyncWriter::put(const uint8_t* buf, unsigned len)
+{
+    put(buf, len, nullptr, 0);
+}
+
+void AsyncWriter::put(const uint8_t* hdr, unsigned hlen, const uint8_t* body, unsigned blen)
+{
+    unsigned len = hlen + blen;
+    assert(len <= chunk_size);
+
+    if ( cur and cur->len + len > chunk_size )
+        submit();
+
+    if ( !cur )
+    {
+        cur = get_chunk();
+        cur_time = now_ms();
+    }
+
+    memcpy(cur->data + cur->len, hdr, hlen);
+
+    if ( blen )
+        memcpy(cur->data + cur->len + hlen, body, blen);
+
+    cur->len += len;
+
+    tick();
+}
+
+void AsyncWriter::rotate()
+{
+    flush();
+    rotate_next = true;
+}
+
+void AsyncWriter::flush()
+{
+    if ( cur and cur->len )
+        submit();
+}
+
+void AsyncWriter::tick()
+{
+    if ( cur and cur->len and now_ms() - cur_time >= flush_ms )
+        submit();
+}
+
+void AsyncWriter::drain()
+{
+    flush();
+
+    while ( in_flight )
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+//-------------------------------------------------------------------------
+// tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+#include <string>
+#include <vector>
+
+class TestSink : public AsyncSink
+{
+public:
+    void write(const struct iovec* iov, int n) override
+    {
+        writes++;
+
+        for ( int i = 0; i < n; ++i )
+            files.back().append((const char*)iov[i].iov_base, iov[i].iov_len);
+    }
+
+    void rotate() override
+    { files.emplace_back(); }
+
+    std::vector<std::string> files { std::string() };
+    unsigned writes = 0;
+};
+
+TEST_CASE("async writer order", "[async_writer]")
+{
+    TestSink sink;
+    std::string expect;
+    {
+        AsyncWriter aw(&sink, 64, 2, 1000);
+
+        for ( unsigned i = 0; i < 1000; ++i )
+        {
+            std::string rec = std::to_string(i) + ";";
+            aw.put((const uint8_t*)rec.data(), rec.size());
+            expect += rec;
+        }
+    }
+    CHECK(sink.files.size() == 1);
+    CHECK(sink.files[0] == expect);
+    CHECK(sink.writes > 0);
+}
+
+TEST_CASE("async writer parts", "[async_writer]")
+{
+    TestSink sink;
+    {
+        AsyncWriter aw(&sink, 8, 2, 1000);
+        aw.put((const uint8_t*)"ab", 2, (const uint8_t*)"cdef", 4);
+        aw.put((const uint8_t*)"gh", 2, (const uint8_t*)"ij", 2);
+    }
+    CHECK(sink.files[0] == "abcdefghij");
+}
+
+TEST_CASE("async writer rotate", "[async_writer]")
+{
+    TestSink sink;
+    {
+        AsyncWriter aw(&sink, 64, 4, 1000);
+        aw.put((const uint8_t*)"abc", 3);
+        aw.rotate();
+        aw.put((const uint8_t*)"def", 3);
+        aw.put((const uint8_t*)"ghi", 3);
+        aw.rotate();
+        aw.drain();
+        CHECK(sink.files.size() == 2);
+    }
+    REQUIRE(sink.files.size() == 2);
+    CHECK(sink.files[0] == "abc");
+    CHECK(sink.files[1] == "defghi");
+}
+
+TEST_CASE("async writer threads", "[async_writer]")
+{
+    const unsigned num = 4;
+    TestSink sinks[num];
+    std::vector<std::thread> threads;
+
+    for ( unsigned t = 0; t < num; ++t )
+    {
+        threads.emplace_back([&sinks, t]
+        {
+            AsyncWriter aw(sinks + t, 128, 3, 0);
+            uint32_t v;
+
+            for ( v = 0; v < 20000; ++v )
+                aw.put((const uint8_t*)&v, sizeof(v));
+        });
+    }
+    for ( auto& t : threads )
+        t.join();
+
+    for ( unsigned t = 0; t < num; ++t )
+    {
+        const std::string& s = sinks[t].files[0];
+        REQUIRE(s.size() == 20000 * sizeof(uint32_t));
+
+        bool ok = true;
+
+        for ( uint32_t v = 0; v < 20000 and ok; ++v )
+            ok = !memcmp(s.data() + v * sizeof(v), &v, sizeof(v));
+
+        CHECK(ok);
+    }
+}
+
+#endif
+
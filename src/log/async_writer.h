@@ -0,0 +1,121 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// async_writer.h
+
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+// AsyncWriter moves log file I/O off the packet threads.  Each packet
+// thread copies whole records into its own chunks.  A full chunk, or one
+// older than flush_ms, is handed to a single shared writer thread over an
+// MpscRing.  The writer thread writes runs of chunks from the same owner
+// with one writev() and hands the chunks back over an SpscRing.  File
+// rotation is requested by the packet thread and done by the writer thread
+// before the next chunk is written, so records never straddle files.
+//
+// If the writer falls behind, a packet thread waits for a free chunk
+// rather than dropping records.
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "helpers/atomic_ring.h"
+
+// implemented by the log; called on the writer thread only
+class AsyncSink
+{
+public:
+    virtual ~AsyncSink() { }
+
+    virtual void write(const struct iovec*, int) = 0;
+    virtual void rotate() = 0;
+
+protected:
+    // writev everything, retrying on EINTR and short writes; returns 0 or
+    // the errno of the failed writev
+    int write_all(int fd, const struct iovec*, int);
+
+private:
+    std::vector<struct iovec> iov;
+};
+
+class AsyncWriter
+{
+public:
+    // chunk_size is the largest record that can be put
+    AsyncWriter(AsyncSink*, unsigned chunk_size, unsigned num_chunks, unsigned flush_ms);
+
+    // drains everything queued; the sink may be closed after this
+    ~AsyncWriter();
+
+    // owning packet thread only
+    void put(const uint8_t*, unsigned len);
+
+    // put one record from a header and a body without staging it
+    void put(const uint8_t* hdr, unsigned hlen, const uint8_t* body, unsigned blen);
+    void rotate();
+    void flush();
+
+    // hand off the current chunk if it is older than flush_ms
+    void tick();
+
+    // flush and wait for the writer thread to finish with all chunks
+    void drain();
+
+    uint64_t get_stalls() const
+    { return stalls; }
+
+private:
+    struct Chunk
+    {
+        AsyncWriter* owner;
+        uint8_t* data;
+        unsigned len;
+        bool rotate;
+    };
+
+    Chunk* get_chunk();
+    void submit();
+
+    static void writer();
+    static void start();
+    static void stop();
+
+private:
+    AsyncSink* sink;
+
+    Chunk* chunks;
+    unsigned num_chunks;
+    unsigned chunk_size;
+
+    Chunk* cur;
+    uint64_t cur_time;
+    unsigned flush_ms;
+    bool rotate_next;
+
+    uint64_t stalls;
+
+    SpscRing<Chunk*> free_chunks;  // writer thread -> owner
+    std::atomic<unsigned> in_flight;
+};
+
+#endif
+
@@ -790,8 +790,7 @@ static void LogICMPEmbeddedIP(TextLog* log, Packet* p)
     if (log == NULL || p == NULL)
         return;
 
-    // FIXIT-L -- Allocating a new Packet here is ridiculously excessive.
-    Packet* orig_p = new Packet;
+    Packet* orig_p = PacketManager::new_packet();
     Packet& op = *orig_p;
 
     if (!layer::set_api_ip_embed_icmp(p, op.ptrs.ip_api))
@@ -874,7 +873,7 @@ static void LogICMPEmbeddedIP(TextLog* log, Packet* p)
         TextLog_Puts(log, "** END OF DUMP");
     }
 
-    delete orig_p;
+    PacketManager::delete_packet(orig_p);
 }
 
 /*--------------------------------------------------------------------
@@ -1189,6 +1188,13 @@ void LogXrefs(TextLog* log, const Event* e, bool doNewLine)
  * payload stuff cloned from log.c
  *--------------------------------------------------------------------
  */
+static inline char printable(uint8_t b)
+{
+    return (b > 0x1F && b < 0x7F) ? (char)b : '.';
+}
+
+#define CHARS_PER_LINE 64
+
 /*--------------------------------------------------------------------
  * Function: SnortConfig::output_char_data(TextLog*, char*, int)
  *
@@ -1203,33 +1209,31 @@ void LogXrefs(TextLog* log, const Event* e, bool doNewLine)
  */
 static void LogCharData(TextLog* log, const char* data, int len)
 {
-    const char* pb = data;
-    const char* end = data + len;
-    int lineCount = 0;
+    const uint8_t* pb = (const uint8_t*)data;
+    const uint8_t* end = pb + len;
 
     if ( !data )
     {
         return;
     }
 
+    /* each full line is formatted in place and written at once */
+    char line[CHARS_PER_LINE + 2];
+
     while ( pb < end )
     {
-        if ( *pb > 0x1F && *pb < 0x7F)
-        {   /* printable */
-            TextLog_Putc(log, *pb);
-        }
-        else
-        {   /* not printable */
-            TextLog_Putc(log, '.');
-        }
+        int n = (end - pb < CHARS_PER_LINE) ? (int)(end - pb) : CHARS_PER_LINE;
 
-        if ( ++lineCount == 64 )
+        for ( int i = 0; i < n; i++ )
+            line[i] = printable(pb[i]);
+
+        if ( n == CHARS_PER_LINE )
         {
-            TextLog_Putc(log, ' ');
-            TextLog_NewLine(log);
-            lineCount = 0;
+            line[n++] = ' ';
+            line[n++] = '\n';
         }
-        pb++;
+        TextLog_Write(log, line, n);
+        pb += CHARS_PER_LINE;
     }
     /* slam a \n on the back */
     TextLog_Putc(log, ' ');
@@ -1256,23 +1260,108 @@ static const char SEPARATOR[] =
 /* middle:"41 02 43 04 45 06 47 08 49 0A 4B 0C 4D 0E 4F 0F 01 02 03 04  A.C.E.G.I.K.M.O....."
    at end:"41 02 43 04 45 06 47 08                                      A.C.E.G."*/
 
-static const char PAD3[] =
-          "                                                             ";
+/* hex column width including the space before the ascii */
+#define HEX_WIDTH (3*BYTES_PER_FRAME + 1)
 
-void LogNetData(TextLog* log, const uint8_t* data, const int len, Packet* p)
+/* offset prefix, hex, ascii, and newline */
+#define FRAME_LINE (16 + HEX_WIDTH + BYTES_PER_FRAME + 1)
+
+static const char hex_digit[] = "0123456789ABCDEF";
+
+/* same as "0x%04X: " */
+static int FormatOffset(char* out, unsigned offset)
 {
-    const uint8_t* pb = data;
-    const uint8_t* end = data + len;
+    int digits = 4;
+
+    while ( digits < 8 && (offset >> (4*digits)) )
+        digits++;
+
+    out[0] = '0';
+    out[1] = 'x';
+
+    for ( int i = 0; i < digits; i++ )
+        out[2+i] = hex_digit[(offset >> (4*(digits-1-i))) & 0x0F];
+
+    out[2+digits] = ':';
+    out[3+digits] = ' ';
+
+    return 4 + digits;
+}
+
+/* format one frame of n bytes into out and return the length.  bytes in
+   [ob_start, ob_end) are shown as X's. */
+static int FormatFrame(
+    char* out, const uint8_t* pb, int n, int ob_start, int ob_end)
+{
+    char* hex = out;
+    char* asc = out + HEX_WIDTH;
+
+    memset(out, ' ', HEX_WIDTH);
+
+    for ( int i = 0; i < n; i++ )
+    {
+        if ( i >= ob_start && i < ob_end )
+        {
+            hex[0] = hex[1] = 'X';
+            asc[i] = 'X';
+        }
+        else
+        {
+            hex[0] = hex_digit[pb[i] >> 4];
+            hex[1] = hex_digit[pb[i] & 0x0F];
+            asc[i] = printable(pb[i]);
+        }
+        hex += 3;
+    }
+    asc[n] = '\n';
+    return HEX_WIDTH + n + 1;
+}
+
+/* obfuscator blocks are blanked with '.' as the frames are formatted
+   instead of copying the whole buffer first */
+static const uint8_t* ApplyBlocks(
+    const uint8_t* pb, int off, int n, uint8_t* tmp,
+    Obfuscator::const_iterator& it, Obfuscator::const_iterator end)
+{
+    const uint8_t* src = pb;
+
+    while ( it != end && it->offset < (uint32_t)(off + n) )
+    {
+        size_t blk_end = it->offset + it->length;
+        long start = (long)it->offset - off;
+        long stop = (long)(blk_end < (size_t)(off + n) ? blk_end : (size_t)(off + n)) - off;
+
+        if ( start < 0 )
+            start = 0;
+
+        if ( stop > start )
+        {
+            if ( src == pb )
+            {
+                memcpy(tmp, pb, n);
+                src = tmp;
+            }
+            memset(tmp + start, '.', stop - start);
+        }
+
+        /* keep a block that runs into the next frame */
+        if ( blk_end > (size_t)(off + n) )
+            break;
+
+        ++it;
+    }
+    return src;
+}
 
+static void LogNetData(
+    TextLog* log, const uint8_t* data, const int len, Packet* p, const Obfuscator* ob)
+{
     const ProtocolIndex ipv4_idx = PacketManager::proto_idx(ProtocolId::IPIP);
     const ProtocolIndex ipv6_idx = PacketManager::proto_idx(ProtocolId::IPV6);
 
-    int offset = 0;
-    char conv[] = "0123456789ABCDEF";   /* xlation lookup table */
-    int ip_ob_start, ip_ob_end, byte_pos, char_pos;
+    int ip_ob_start, ip_ob_end;
     int i;
 
-    byte_pos = char_pos = 0;
     ip_ob_start = ip_ob_end = -1;
 
     if ( !len )
@@ -1294,7 +1383,7 @@ void LogNetData(TextLog* log, const uint8_t* data, const int len, Packet* p)
             }
         }
 
-        int ip_start = p->layers[i].start - data;
+        int ip_start = (i < num_layers) ? p->layers[i].start - data : -1;
 
         if (ip_start > 0 )
         {
@@ -1315,59 +1404,44 @@ void LogNetData(TextLog* log, const uint8_t* data, const int len, Packet* p)
     TextLog_Print(log, "%s%s\n", div, SEPARATOR+strlen(div));
 #endif
 
-    /* loop thru the whole buffer */
-    while ( pb < end )
+    const bool offsets = SnortConfig::verbose_byte_dump();
+
+    Obfuscator::const_iterator it, it_end;
+
+    if ( ob )
     {
-        if (SnortConfig::verbose_byte_dump())
-        {
-            TextLog_Print(log, "0x%04X: ", offset);
-            offset += BYTES_PER_FRAME;
-        }
-        /* process one frame
-           first print the binary as ascii hex */
-        for (i = 0; i < BYTES_PER_FRAME && pb+i < end; i++, byte_pos++)
-        {
-            if (SnortConfig::obfuscate() && ((byte_pos >= ip_ob_start) && (byte_pos < ip_ob_end)))
-            {
-                TextLog_Putc(log, 'X');
-                TextLog_Putc(log, 'X');
-                TextLog_Putc(log, ' ');
-            }
-            else
-            {
-                char b = pb[i];
-                TextLog_Putc(log, conv[(b & 0xFF) >> 4]);
-                TextLog_Putc(log, conv[(b & 0xFF) & 0x0F]);
-                TextLog_Putc(log, ' ');
-            }
-        }
-        /* print ' ' past end of packet and before ascii */
-        TextLog_Puts(log, PAD3+(3*i));
+        it = ob->begin();
+        it_end = ob->end();
+    }
 
-        /* then print the actual ascii chars
-           or a '.' for control chars */
-        for (i = 0; i < BYTES_PER_FRAME && pb+i < end; i++, char_pos++)
-        {
-            if (SnortConfig::obfuscate() && ((char_pos >= ip_ob_start) && (char_pos < ip_ob_end)))
-            {
-                TextLog_Putc(log, 'X');
-            }
-            else
-            {
-                char b = pb[i];
+    char line[FRAME_LINE];
+    uint8_t tmp[BYTES_PER_FRAME];
 
-                if ( b > 0x1F && b < 0x7F)
-                    TextLog_Putc(log, (char)(b & 0xFF));
-                else
-                    TextLog_Putc(log, '.');
-            }
-        }
-        pb += BYTES_PER_FRAME;
-        TextLog_NewLine(log);
+    /* loop thru the whole buffer a frame at a time; each frame is
+       formatted into one line and written with a single copy */
+    for ( int offset = 0; offset < len; offset += BYTES_PER_FRAME )
+    {
+        int n = (len - offset < BYTES_PER_FRAME) ? len - offset : BYTES_PER_FRAME;
+        const uint8_t* pb = data + offset;
+        int pos = 0;
+
+        if ( ob )
+            pb = ApplyBlocks(pb, offset, n, tmp, it, it_end);
+
+        if ( offsets )
+            pos = FormatOffset(line, offset);
+
+        pos += FormatFrame(line + pos, pb, n, ip_ob_start - offset, ip_ob_end - offset);
+        TextLog_Write(log, line, pos);
     }
     LogDiv(log);
 }
 
+void LogNetData(TextLog* log, const uint8_t* data, const int len, Packet* p)
+{
+    LogNetData(log, data, len, p, nullptr);
+}
+
 void LogDiv(TextLog* log)
 {
     TextLog_Print(log, "%s\n", SEPARATOR);
@@ -1481,13 +1555,7 @@ void LogPayload(TextLog* log, Packet* p)
         {
             if ( p->obfuscator )
             {
-                // FIXIT-P avoid string copy
-                std::string buf(p->data, p->data + p->dsize);
-
-                for ( const auto& b : *p->obfuscator )
-                    buf.replace(b.offset, b.length, b.length, '.');
-
-                LogNetData(log, (const uint8_t*)buf.c_str(), p->dsize, p);
+                LogNetData(log, p->data, p->dsize, p, p->obfuscator);
             }
             else
             {
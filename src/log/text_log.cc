@@ -218,24 +218,27 @@ bool TextLog_Write(TextLog* const txt, const char* str, int len)
 {
     int avail = TextLog_Avail(txt);
 
+    if ( len < 0 )
+        return false;
+
     if ( len >= avail )
     {
         TextLog_Flush(txt);
         avail = TextLog_Avail(txt);
     }
-    len = snprintf(txt->buf+txt->pos, avail, "%s", str);
 
+    /* str need not be terminated so callers can write formatted lines
+       straight from their own buffers */
     if ( len >= avail )
     {
+        memcpy(txt->buf+txt->pos, str, avail);
         txt->pos = txt->maxBuf - 1;
         txt->buf[txt->pos] = '\0';
         return false;
     }
-    else if ( len < 0 )
-    {
-        return false;
-    }
+    memcpy(txt->buf+txt->pos, str, len);
     txt->pos += len;
+    txt->buf[txt->pos] = '\0';
     return true;
 }
 
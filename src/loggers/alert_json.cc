@@ -0,0 +1,1134 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// alert_json.cc
+
+// alert_json writes one JSON object per line for each event.  The field
+// names are fixed at compile time along with their quoting, so an alert
+// is just a series of copies plus hand rolled integer and string encoding
+// into a per thread line buffer.  Nothing is allocated and nothing goes
+// through printf on the alert path except the timestamp.
+//
+// Fields that don't apply to the packet are left out of the object rather
+// than written as null or empty strings.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "main/snort_debug.h"
+#include "main/thread.h"
+#include "framework/logger.h"
+#include "framework/module.h"
+#include "control/deferred_work.h"
+#include "detection/signature.h"
+#include "events/event.h"
+#include "log/async_writer.h"
+#include "log/log.h"
+#include "log/messages.h"
+#include "log/text_log.h"
+#include "protocols/packet.h"
+#include "protocols/eth.h"
+#include "protocols/icmp4.h"
+#include "protocols/tcp.h"
+#include "protocols/udp.h"
+#include "packet_io/active.h"
+#include "packet_io/sfdaq.h"
+#include "sfip/sf_ip.h"
+#include "utils/stats.h"
+#include "utils/util.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+#define LOG_BUFFER (4*K_BYTES)
+
+// longest alert line; longer values are dropped a field at a time
+#define JSON_LINE (4*K_BYTES)
+
+// async mode chunks per packet thread
+#define JSON_ASYNC_CHUNKS 8
+
+#define S_NAME "alert_json"
+#define F_NAME S_NAME ".txt"
+
+using namespace std;
+
+//-------------------------------------------------------------------------
+// serializer
+//-------------------------------------------------------------------------
+
+class JsonBuffer
+{
+public:
+    void reset()
+    { pos = 0; over = false; }
+
+    bool overflow() const
+    { return over; }
+
+    // a field is written with mark() first and undone with rewind() if it
+    // doesn't fit or has nothing to say
+    unsigned mark() const
+    { return pos; }
+
+    void rewind(unsigned m)
+    { pos = m; over = false; }
+
+    const char* data() const
+    { return buf; }
+
+    unsigned size() const
+    { return pos; }
+
+    void put(char c)
+    {
+        if ( room(1) )
+            buf[pos++] = c;
+    }
+
+    void put(const char* s, unsigned n)
+    {
+        if ( room(n) )
+        {
+            memcpy(buf + pos, s, n);
+            pos += n;
+        }
+    }
+
+    // ends the object and terminates the line for TextLog
+    void close()
+    {
+        buf[pos++] = '}';
+        buf[pos++] = '\n';
+        buf[pos] = '\0';
+    }
+
+    void put_uint(uint64_t);
+    void put_hex(uint8_t);
+    void put_str(const char*);
+    void put_str(const char*, unsigned);
+
+private:
+    bool room(unsigned n)
+    {
+        // keep space to close the object
+        if ( pos + n + 3 <= sizeof(buf) )
+            return true;
+
+        over = true;
+        return false;
+    }
+
+private:
+    char buf[JSON_LINE];
+    unsigned pos = 0;
+    bool over = false;
+};
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+void JsonBuffer::put_uint(uint64_t u)
+{
+    char tmp[20];
+    unsigned i = sizeof(tmp);
+
+    do
+    {
+        tmp[--i] = '0' + (u % 10);
+        u /= 10;
+    }
+    while ( u );
+
+    put(tmp + i, sizeof(tmp) - i);
+}
+
+void JsonBuffer::put_hex(uint8_t b)
+{
+    char tmp[2] = { hex_digits[b >> 4], hex_digits[b & 0xF] };
+    put(tmp, sizeof(tmp));
+}
+
+void JsonBuffer::put_str(const char* s)
+{
+    if ( !s )
+        s = "";
+
+    put_str(s, strlen(s));
+}
+
+// escape per RFC 7159; bytes above 0x7F are passed through as is
+void JsonBuffer::put_str(const char* s, unsigned n)
+{
+    put('"');
+
+    const char* run = s;
+    const char* end = s + n;
+
+    for ( ; s < end; ++s )
+    {
+        uint8_t c = *s;
+
+        if ( c >= 0x20 and c != '"' and c != '\\' )
+            continue;
+
+        put(run, s - run);
+        run = s + 1;
+
+        switch ( c )
+        {
+        case '"':  put("\\\"", 2); break;
+        case '\\': put("\\\\", 2); break;
+        case '\b': put("\\b", 2); break;
+        case '\f': put("\\f", 2); break;
+        case '\n': put("\\n", 2); break;
+        case '\r': put("\\r", 2); break;
+        case '\t': put("\\t", 2); break;
+        default:
+            put("\\u00", 4);
+            put_hex(c);
+        }
+    }
+    put(run, s - run);
+    put('"');
+}
+
+static THREAD_LOCAL JsonBuffer* json_buf = nullptr;
+
+//-------------------------------------------------------------------------
+// field formatting functions
+//
+// each returns false if the field has no value for this alert
+//-------------------------------------------------------------------------
+
+struct Args
+{
+    Packet* pkt;
+    const char* msg;
+    Event* event;
+};
+
+static inline bool has_ip(const Args& a)
+{ return a.pkt->has_ip() or a.pkt->is_data(); }
+
+static inline bool has_ports(const Args& a)
+{ return a.pkt->proto_bits & (PROTO_BIT__TCP|PROTO_BIT__UDP); }
+
+static void put_addr(const sfip_t* ip)
+{
+    char addr[INET6_ADDRSTRLEN];
+    sfip_ntop(ip, addr, sizeof(addr));
+    json_buf->put_str(addr);
+}
+
+static void put_ap(const sfip_t* ip, bool ok, unsigned port)
+{
+    char addr[INET6_ADDRSTRLEN];
+    addr[0] = '\0';
+
+    if ( ok )
+        sfip_ntop(ip, addr, sizeof(addr));
+
+    unsigned len = strlen(addr);
+    json_buf->put('"');
+    json_buf->put(addr, len);
+    json_buf->put(':');
+    json_buf->put_uint(port);
+    json_buf->put('"');
+}
+
+static void put_mac(const uint8_t* mac)
+{
+    json_buf->put('"');
+
+    for ( int i = 0; i < 6; ++i )
+    {
+        if ( i )
+            json_buf->put(':');
+
+        json_buf->put_hex(mac[i]);
+    }
+    json_buf->put('"');
+}
+
+static bool ff_action(Args&)
+{
+    json_buf->put_str(Active::get_action_string());
+    return true;
+}
+
+static bool ff_class(Args& a)
+{
+    if ( !a.event or !a.event->sig_info->classType )
+        return false;
+
+    json_buf->put_str(a.event->sig_info->classType->type);
+    return true;
+}
+
+static bool ff_dir(Args& a)
+{
+    const char* dir;
+
+    if ( a.pkt->is_from_client() )
+        dir = "\"C2S\"";
+    else if ( a.pkt->is_from_server() )
+        dir = "\"S2C\"";
+    else
+        dir = "\"UNK\"";
+
+    json_buf->put(dir, 5);
+    return true;
+}
+
+static bool ff_dgm_len(Args& a)
+{
+    if ( a.pkt->has_ip() )
+        json_buf->put_uint(a.pkt->ptrs.ip_api.dgram_len());
+    else
+        json_buf->put_uint(a.pkt->dsize);
+    return true;
+}
+
+static bool ff_dst_addr(Args& a)
+{
+    if ( !has_ip(a) )
+        return false;
+
+    put_addr(a.pkt->ptrs.ip_api.get_dst());
+    return true;
+}
+
+static bool ff_dst_ap(Args& a)
+{
+    put_ap(a.pkt->ptrs.ip_api.get_dst(), has_ip(a), has_ports(a) ? a.pkt->ptrs.dp : 0);
+    return true;
+}
+
+static bool ff_dst_port(Args& a)
+{
+    if ( !has_ports(a) )
+        return false;
+
+    json_buf->put_uint(a.pkt->ptrs.dp);
+    return true;
+}
+
+static bool ff_eth_dst(Args& a)
+{
+    if ( !(a.pkt->proto_bits & PROTO_BIT__ETH) )
+        return false;
+
+    put_mac(layer::get_eth_layer(a.pkt)->ether_dst);
+    return true;
+}
+
+static bool ff_eth_len(Args& a)
+{
+    if ( !(a.pkt->proto_bits & PROTO_BIT__ETH) )
+        return false;
+
+    json_buf->put_uint(a.pkt->pkth->pktlen);
+    return true;
+}
+
+static bool ff_eth_src(Args& a)
+{
+    if ( !(a.pkt->proto_bits & PROTO_BIT__ETH) )
+        return false;
+
+    put_mac(layer::get_eth_layer(a.pkt)->ether_src);
+    return true;
+}
+
+static bool ff_eth_type(Args& a)
+{
+    if ( !(a.pkt->proto_bits & PROTO_BIT__ETH) )
+        return false;
+
+    json_buf->put_uint(ntohs(layer::get_eth_layer(a.pkt)->ether_type));
+    return true;
+}
+
+static bool ff_gid(Args& a)
+{
+    if ( !a.event )
+        return false;
+
+    json_buf->put_uint(a.event->sig_info->generator);
+    return true;
+}
+
+static bool ff_icmp_code(Args& a)
+{
+    if ( !a.pkt->ptrs.icmph )
+        return false;
+
+    json_buf->put_uint(a.pkt->ptrs.icmph->code);
+    return true;
+}
+
+static bool ff_icmp_id(Args& a)
+{
+    if ( !a.pkt->ptrs.icmph )
+        return false;
+
+    json_buf->put_uint(ntohs(a.pkt->ptrs.icmph->s_icmp_id));
+    return true;
+}
+
+static bool ff_icmp_seq(Args& a)
+{
+    if ( !a.pkt->ptrs.icmph )
+        return false;
+
+    json_buf->put_uint(ntohs(a.pkt->ptrs.icmph->s_icmp_seq));
+    return true;
+}
+
+static bool ff_icmp_type(Args& a)
+{
+    if ( !a.pkt->ptrs.icmph )
+        return false;
+
+    json_buf->put_uint(a.pkt->ptrs.icmph->type);
+    return true;
+}
+
+static bool ff_iface(Args&)
+{
+    json_buf->put_str(SFDAQ::get_interface_spec());
+    return true;
+}
+
+static bool ff_ip_id(Args& a)
+{
+    if ( !a.pkt->has_ip() )
+        return false;
+
+    json_buf->put_uint(a.pkt->ptrs.ip_api.id());
+    return true;
+}
+
+static bool ff_ip_len(Args& a)
+{
+    if ( !a.pkt->has_ip() )
+        return false;
+
+    json_buf->put_uint(a.pkt->ptrs.ip_api.pay_len());
+    return true;
+}
+
+static bool ff_msg(Args& a)
+{
+    json_buf->put_str(a.msg);
+    return true;
+}
+
+static bool ff_pkt_gen(Args& a)
+{
+    json_buf->put_str(a.pkt->get_pseudo_type());
+    return true;
+}
+
+static bool ff_pkt_num(Args&)
+{
+    json_buf->put_uint(pc.total_from_daq);
+    return true;
+}
+
+static bool ff_priority(Args& a)
+{
+    if ( !a.event )
+        return false;
+
+    json_buf->put_uint(a.event->sig_info->priority);
+    return true;
+}
+
+static bool ff_proto(Args& a)
+{
+    json_buf->put_str(a.pkt->get_type());
+    return true;
+}
+
+static bool ff_rev(Args& a)
+{
+    if ( !a.event )
+        return false;
+
+    json_buf->put_uint(a.event->sig_info->rev);
+    return true;
+}
+
+static bool ff_rule(Args& a)
+{
+    if ( !a.event )
+        return false;
+
+    json_buf->put('"');
+    json_buf->put_uint(a.event->sig_info->generator);
+    json_buf->put(':');
+    json_buf->put_uint(a.event->sig_info->id);
+    json_buf->put(':');
+    json_buf->put_uint(a.event->sig_info->rev);
+    json_buf->put('"');
+    return true;
+}
+
+static bool ff_seconds(Args& a)
+{
+    json_buf->put_uint(a.pkt->pkth->ts.tv_sec);
+    return true;
+}
+
+static bool ff_sid(Args& a)
+{
+    if ( !a.event )
+        return false;
+
+    json_buf->put_uint(a.event->sig_info->id);
+    return true;
+}
+
+static bool ff_src_addr(Args& a)
+{
+    if ( !has_ip(a) )
+        return false;
+
+    put_addr(a.pkt->ptrs.ip_api.get_src());
+    return true;
+}
+
+static bool ff_src_ap(Args& a)
+{
+    put_ap(a.pkt->ptrs.ip_api.get_src(), has_ip(a), has_ports(a) ? a.pkt->ptrs.sp : 0);
+    return true;
+}
+
+static bool ff_src_port(Args& a)
+{
+    if ( !has_ports(a) )
+        return false;
+
+    json_buf->put_uint(a.pkt->ptrs.sp);
+    return true;
+}
+
+static bool ff_tcp_ack(Args& a)
+{
+    if ( !a.pkt->ptrs.tcph )
+        return false;
+
+    json_buf->put_uint(ntohl(a.pkt->ptrs.tcph->th_ack));
+    return true;
+}
+
+static bool ff_tcp_flags(Args& a)
+{
+    if ( !a.pkt->ptrs.tcph )
+        return false;
+
+    char tcpFlags[9];
+    CreateTCPFlagString(a.pkt->ptrs.tcph, tcpFlags);
+    json_buf->put_str(tcpFlags);
+    return true;
+}
+
+static bool ff_tcp_len(Args& a)
+{
+    if ( !a.pkt->ptrs.tcph )
+        return false;
+
+    json_buf->put_uint(a.pkt->ptrs.tcph->off());
+    return true;
+}
+
+static bool ff_tcp_seq(Args& a)
+{
+    if ( !a.pkt->ptrs.tcph )
+        return false;
+
+    json_buf->put_uint(ntohl(a.pkt->ptrs.tcph->th_seq));
+    return true;
+}
+
+static bool ff_tcp_win(Args& a)
+{
+    if ( !a.pkt->ptrs.tcph )
+        return false;
+
+    json_buf->put_uint(ntohs(a.pkt->ptrs.tcph->th_win));
+    return true;
+}
+
+static bool ff_timestamp(Args& a)
+{
+    char timestamp[TIMEBUF_SIZE];
+    ts_print((struct timeval*)&a.pkt->pkth->ts, timestamp);
+    json_buf->put_str(timestamp);
+    return true;
+}
+
+static bool ff_tos(Args& a)
+{
+    if ( !a.pkt->has_ip() )
+        return false;
+
+    json_buf->put_uint(a.pkt->ptrs.ip_api.tos());
+    return true;
+}
+
+static bool ff_ttl(Args& a)
+{
+    if ( !a.pkt->has_ip() )
+        return false;
+
+    json_buf->put_uint(a.pkt->ptrs.ip_api.ttl());
+    return true;
+}
+
+static bool ff_udp_len(Args& a)
+{
+    if ( !a.pkt->ptrs.udph )
+        return false;
+
+    json_buf->put_uint(ntohs(a.pkt->ptrs.udph->uh_len));
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// field schema
+//
+// the table order must match json_range
+//-------------------------------------------------------------------------
+
+typedef bool (*JsonFunc)(Args&);
+
+struct JsonField
+{
+    const char* key;    // quoted name and colon
+    unsigned key_len;
+    JsonFunc func;
+};
+
+#define JSON_KEY(name) "\"" #name "\":"
+#define JSON_FIELD(name) { JSON_KEY(name), sizeof(JSON_KEY(name)) - 1, ff_ ## name }
+
+static const JsonField json_fields[] =
+{
+    JSON_FIELD(action), JSON_FIELD(class), JSON_FIELD(dir), JSON_FIELD(dgm_len),
+    JSON_FIELD(dst_addr), JSON_FIELD(dst_ap), JSON_FIELD(dst_port),
+    JSON_FIELD(eth_dst), JSON_FIELD(eth_len), JSON_FIELD(eth_src), JSON_FIELD(eth_type),
+    JSON_FIELD(gid), JSON_FIELD(icmp_code), JSON_FIELD(icmp_id), JSON_FIELD(icmp_seq),
+    JSON_FIELD(icmp_type), JSON_FIELD(iface), JSON_FIELD(ip_id), JSON_FIELD(ip_len),
+    JSON_FIELD(msg), JSON_FIELD(pkt_gen), JSON_FIELD(pkt_num), JSON_FIELD(priority),
+    JSON_FIELD(proto), JSON_FIELD(rev), JSON_FIELD(rule), JSON_FIELD(seconds),
+    JSON_FIELD(sid), JSON_FIELD(src_addr), JSON_FIELD(src_ap), JSON_FIELD(src_port),
+    JSON_FIELD(tcp_ack), JSON_FIELD(tcp_flags), JSON_FIELD(tcp_len), JSON_FIELD(tcp_seq),
+    JSON_FIELD(tcp_win), JSON_FIELD(timestamp), JSON_FIELD(tos), JSON_FIELD(ttl),
+    JSON_FIELD(udp_len)
+};
+
+#define json_range \
+    "action | class | dir | dgm_len | dst_addr | dst_ap | dst_port | " \
+    "eth_dst | eth_len | eth_src | eth_type | gid | " \
+    "icmp_code | icmp_id | icmp_seq | icmp_type | iface | " \
+    "ip_id | ip_len | msg | pkt_gen | pkt_num | priority | proto | " \
+    "rev | rule | seconds | sid | src_addr | src_ap | src_port | " \
+    "tcp_ack | tcp_flags | tcp_len | tcp_seq | tcp_win | " \
+    "timestamp | tos | ttl | udp_len"
+
+#define json_deflt \
+    "timestamp pkt_num proto pkt_gen dgm_len dir src_ap dst_ap rule action"
+
+static void serialize(const vector<const JsonField*>& fields, Args& a)
+{
+    json_buf->reset();
+    json_buf->put('{');
+
+    bool first = true;
+
+    for ( const JsonField* f : fields )
+    {
+        unsigned m = json_buf->mark();
+
+        if ( !first )
+            json_buf->put(',');
+
+        json_buf->put(f->key, f->key_len);
+
+        if ( !f->func(a) or json_buf->overflow() )
+        {
+            json_buf->rewind(m);
+            continue;
+        }
+        first = false;
+    }
+    json_buf->close();
+}
+
+//-------------------------------------------------------------------------
+// async output
+//
+// the file is opened and rolled by the writer thread so the full path is
+// resolved on the packet thread up front.  lines are whole records so
+// stdout can be shared by all packet threads in this mode.
+//-------------------------------------------------------------------------
+
+struct JsonContext
+{
+    AsyncWriter* writer;
+    AsyncSink* sink;
+    size_t size;
+    time_t roll_time;
+};
+
+static THREAD_LOCAL TextLog* json_log = nullptr;
+static THREAD_LOCAL JsonContext json_async;
+
+class JsonSink : public AsyncSink
+{
+public:
+    JsonSink(const char* path);
+    ~JsonSink();
+
+    void write(const struct iovec*, int) override;
+    void rotate() override;
+
+private:
+    void open();
+
+private:
+    string path;  // empty for stdout
+    int fd;
+};
+
+JsonSink::JsonSink(const char* s)
+{
+    if ( s )
+        path = s;
+
+    open();
+
+    if ( fd < 0 )
+        FatalError("%s: can't open %s: %s\n", S_NAME, path.c_str(), get_error(errno));
+}
+
+JsonSink::~JsonSink()
+{
+    if ( fd > STDOUT_FILENO )
+        ::close(fd);
+}
+
+void JsonSink::open()
+{
+    if ( path.empty() )
+        fd = STDOUT_FILENO;
+    else
+        fd = ::open(path.c_str(), O_WRONLY|O_CREAT|O_APPEND, 0666);
+}
+
+// same naming as RollAlertFile
+void JsonSink::rotate()
+{
+    if ( path.empty() )
+        return;
+
+    if ( fd >= 0 )
+        ::close(fd);
+
+    char newname[STD_BUF+1];
+    snprintf(newname, sizeof(newname), "%s.%lu", path.c_str(), (unsigned long)time(nullptr));
+
+    if ( rename(path.c_str(), newname) )
+        ErrorMessage("%s: can't roll %s: %s\n", S_NAME, path.c_str(), get_error(errno));
+
+    open();
+
+    if ( fd < 0 )
+        ErrorMessage("%s: can't open %s: %s\n", S_NAME, path.c_str(), get_error(errno));
+}
+
+void JsonSink::write(const struct iovec* v, int n)
+{
+    if ( fd < 0 )
+        return;
+
+    int err = write_all(fd, v, n);
+
+    // the lines are lost but logging goes on
+    if ( err )
+        ErrorMessage("%s: can't write %s: %s\n", S_NAME,
+            path.empty() ? "stdout" : path.c_str(), get_error(err));
+}
+
+static bool JsonTick(void*)
+{
+    if ( json_async.writer )
+        json_async.writer->tick();
+
+    return false;
+}
+
+//-------------------------------------------------------------------------
+// module stuff
+//-------------------------------------------------------------------------
+
+static const Parameter s_params[] =
+{
+    { "file", Parameter::PT_BOOL, nullptr, "false",
+      "output to " F_NAME " instead of stdout" },
+
+    { "fields", Parameter::PT_MULTI, json_range, json_deflt,
+      "selected fields will be output in given order left to right" },
+
+    { "limit", Parameter::PT_INT, "0:", "0",
+      "set limit (0 is unlimited)" },
+
+    { "units", Parameter::PT_ENUM, "B | K | M | G", "B",
+      "bytes | KB | MB | GB" },
+
+    { "async", Parameter::PT_BOOL, nullptr, "false",
+      "write files on a separate thread instead of the packet threads" },
+
+    { "flush_size", Parameter::PT_INT, "4096:16777216", "65536",
+      "with async, hand off buffered alerts at this many bytes" },
+
+    { "flush_ms", Parameter::PT_INT, "0:60000", "1000",
+      "with async, hand off buffered alerts after this many milliseconds" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
+#define s_help \
+    "output event in json format"
+
+class JsonModule : public Module
+{
+public:
+    JsonModule() : Module(S_NAME, s_help, s_params) { }
+
+    bool set(const char*, Value&, SnortConfig*) override;
+    bool begin(const char*, int, SnortConfig*) override;
+    bool end(const char*, int, SnortConfig*) override;
+
+private:
+    void set_fields(Value&);
+
+public:
+    bool file;
+    unsigned long limit;
+    unsigned units;
+    bool async;
+    unsigned flush_size;
+    unsigned flush_ms;
+    vector<const JsonField*> fields;
+};
+
+void JsonModule::set_fields(Value& v)
+{
+    string tok;
+    v.set_first_token();
+    fields.clear();
+
+    while ( v.get_next_token(tok) )
+        fields.push_back(json_fields + Parameter::index(json_range, tok.c_str()));
+}
+
+bool JsonModule::set(const char*, Value& v, SnortConfig*)
+{
+    if ( v.is("file") )
+        file = v.get_bool();
+
+    else if ( v.is("fields") )
+        set_fields(v);
+
+    else if ( v.is("limit") )
+        limit = v.get_long();
+
+    else if ( v.is("units") )
+        units = v.get_long();
+
+    else if ( v.is("async") )
+        async = v.get_bool();
+
+    else if ( v.is("flush_size") )
+        flush_size = v.get_long();
+
+    else if ( v.is("flush_ms") )
+        flush_ms = v.get_long();
+
+    else
+        return false;
+
+    return true;
+}
+
+bool JsonModule::begin(const char*, int, SnortConfig*)
+{
+    file = false;
+    limit = 0;
+    units = 0;
+    async = false;
+    flush_size = 65536;
+    flush_ms = 1000;
+
+    if ( fields.empty() )
+    {
+        Value v(json_deflt);
+        set_fields(v);
+    }
+    return true;
+}
+
+bool JsonModule::end(const char*, int, SnortConfig*)
+{
+    while ( units-- )
+        limit *= 1024;
+
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// logger stuff
+//-------------------------------------------------------------------------
+
+class JsonLogger : public Logger
+{
+public:
+    JsonLogger(JsonModule*);
+
+    void open() override;
+    void close() override;
+
+    void alert(Packet*, const char* msg, Event*) override;
+
+private:
+    void write_async();
+
+public:
+    string file;
+    unsigned long limit;
+    bool async;
+    unsigned flush_size;
+    unsigned flush_ms;
+    vector<const JsonField*> fields;
+};
+
+JsonLogger::JsonLogger(JsonModule* m)
+{
+    file = m->file ? F_NAME : "stdout";
+    limit = m->limit;
+    async = m->async;
+    flush_size = m->flush_size;
+    flush_ms = m->flush_ms;
+    fields = std::move(m->fields);
+}
+
+void JsonLogger::open()
+{
+    json_buf = new JsonBuffer;
+
+    if ( !async )
+    {
+        json_log = TextLog_Init(file.c_str(), LOG_BUFFER, limit);
+        return;
+    }
+
+    JsonSink* js;
+
+    if ( file == "stdout" )
+        js = new JsonSink(nullptr);
+    else
+    {
+        std::string name;
+        js = new JsonSink(get_instance_file(name, file.c_str()));
+    }
+
+    json_async.sink = js;
+    json_async.writer = new AsyncWriter(js, flush_size, JSON_ASYNC_CHUNKS, flush_ms);
+    json_async.size = 0;
+    json_async.roll_time = time(nullptr);
+
+    DeferredWork::register_handler(JsonTick, nullptr);
+}
+
+void JsonLogger::close()
+{
+    if ( json_async.writer )
+    {
+        // drains the queue so the file is ours again
+        delete json_async.writer;
+        json_async.writer = nullptr;
+
+        delete json_async.sink;
+        json_async.sink = nullptr;
+    }
+
+    if ( json_log )
+    {
+        TextLog_Term(json_log);
+        json_log = nullptr;
+    }
+
+    delete json_buf;
+    json_buf = nullptr;
+}
+
+// like TextLog, don't roll sooner than the file name discriminator
+void JsonLogger::write_async()
+{
+    unsigned len = json_buf->size();
+
+    if ( limit and json_async.size + len > limit )
+    {
+        time_t now = time(nullptr);
+
+        if ( now > json_async.roll_time )
+        {
+            json_async.writer->rotate();
+            json_async.roll_time = now;
+            json_async.size = 0;
+        }
+    }
+    json_async.writer->put((const uint8_t*)json_buf->data(), len);
+    json_async.size += len;
+}
+
+void JsonLogger::alert(Packet* p, const char* msg, Event* event)
+{
+    Args a = { p, msg, event };
+    serialize(fields, a);
+
+    if ( json_async.writer )
+        write_async();
+
+    else if ( json_log )
+    {
+        TextLog_Write(json_log, json_buf->data(), json_buf->size());
+        TextLog_Flush(json_log);
+    }
+}
+
+//-------------------------------------------------------------------------
+// api stuff
+//-------------------------------------------------------------------------
+
+static Module* mod_ctor()
+{ return new JsonModule; }
+
+static void mod_dtor(Module* m)
+{ delete m; }
+
+static Logger* json_ctor(SnortConfig*, Module* mod)
+{ return new JsonLogger((JsonModule*)mod); }
+
+static void json_dtor(Logger* p)
+{ delete p; }
+
+static LogApi json_api
+{
+    {
+        PT_LOGGER,
+        sizeof(LogApi),
+        LOGAPI_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        S_NAME,
+        s_help,
+        mod_ctor,
+        mod_dtor
+    },
+    OUTPUT_TYPE_FLAG__ALERT,
+    json_ctor,
+    json_dtor
+};
+
+#ifdef BUILDING_SO
+SO_PUBLIC const BaseApi* snort_plugins[] =
+{
+    &json_api.base,
+    nullptr
+};
+#else
+const BaseApi* alert_json = &json_api.base;
+#endif
+
+//-------------------------------------------------------------------------
+// tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+static string get_json(const JsonBuffer& jb)
+{ return string(jb.data(), jb.size()); }
+
+TEST_CASE("json uint", "[alert_json]")
+{
+    JsonBuffer* jb = new JsonBuffer;
+    jb->put_uint(0);
+    jb->put(' ');
+    jb->put_uint(1234567890);
+    jb->put(' ');
+    jb->put_uint(UINT64_MAX);
+    CHECK(get_json(*jb) == "0 1234567890 18446744073709551615");
+    delete jb;
+}
+
+TEST_CASE("json escape", "[alert_json]")
+{
+    JsonBuffer* jb = new JsonBuffer;
+    jb->put_str("a\"b\\c\n\x01z");
+    CHECK(get_json(*jb) == "\"a\\\"b\\\\c\\n\\u0001z\"");
+
+    jb->reset();
+    jb->put_str(nullptr);
+    CHECK(get_json(*jb) == "\"\"");
+    delete jb;
+}
+
+TEST_CASE("json overflow", "[alert_json]")
+{
+    JsonBuffer* jb = new JsonBuffer;
+    string big(JSON_LINE, 'x');
+
+    jb->put('{');
+    unsigned m = jb->mark();
+    jb->put_str(big.c_str());
+    CHECK(jb->overflow());
+
+    jb->rewind(m);
+    CHECK(!jb->overflow());
+    CHECK(jb->size() == 1);
+    delete jb;
+}
+
+#endif
+
@@ -49,47 +49,70 @@ static THREAD_LOCAL SnortEvent lua_event;
 static THREAD_LOCAL Packet* packet;
 static THREAD_LOCAL SnortPacket lua_packet;
 
-SO_PUBLIC const SnortEvent* get_event()
-{
-    assert(event);
+// set only while a batch is being handed to lua
+static THREAD_LOCAL const SnortAlert* alerts;
+static THREAD_LOCAL unsigned num_alerts;
 
-    lua_event.gid = event->sig_info->generator;
-    lua_event.sid = event->sig_info->id;
-    lua_event.rev = event->sig_info->rev;
+// everything referenced is static or rule data so records can be queued
+static void set_event(const Event* e, SnortEvent& se)
+{
+    se.gid = e->sig_info->generator;
+    se.sid = e->sig_info->id;
+    se.rev = e->sig_info->rev;
 
-    lua_event.event_id = event->event_id;
-    lua_event.event_ref = event->event_reference;
+    se.event_id = e->event_id;
+    se.event_ref = e->event_reference;
 
-    if ( event->sig_info->message )
-        lua_event.msg = event->sig_info->message;
+    if ( e->sig_info->message )
+        se.msg = e->sig_info->message;
     else
-        lua_event.msg = "";
+        se.msg = "";
 
-    lua_event.svc = event->sig_info->num_services ? event->sig_info->services[1].service : "n/a";
-
-    return &lua_event;
+    se.svc = e->sig_info->num_services ? e->sig_info->services[1].service : "n/a";
 }
 
-SO_PUBLIC const SnortPacket* get_packet()
+static void set_packet(const Packet* p, SnortPacket& sp)
 {
-    assert(packet);
-
-    switch ( packet->type() )
+    switch ( p->type() )
     {
-    case PktType::IP: lua_packet.type = "IP"; break;
-    case PktType::TCP: lua_packet.type = "TCP"; break;
-    case PktType::UDP: lua_packet.type = "UDP"; break;
-    case PktType::ICMP: lua_packet.type = "ICMP"; break;
-    default: lua_packet.type = "OTHER";
+    case PktType::IP: sp.type = "IP"; break;
+    case PktType::TCP: sp.type = "TCP"; break;
+    case PktType::UDP: sp.type = "UDP"; break;
+    case PktType::ICMP: sp.type = "ICMP"; break;
+    default: sp.type = "OTHER";
     }
 
-    lua_packet.num = pc.total_from_daq;
-    lua_packet.sp = packet->ptrs.sp;
-    lua_packet.dp = packet->ptrs.dp;
+    sp.num = pc.total_from_daq;
+    sp.sp = p->ptrs.sp;
+    sp.dp = p->ptrs.dp;
+}
+
+SO_PUBLIC const SnortEvent* get_event()
+{
+    if ( num_alerts )
+        return &alerts[num_alerts - 1].event;
 
+    assert(event);
+    set_event(event, lua_event);
+    return &lua_event;
+}
+
+SO_PUBLIC const SnortPacket* get_packet()
+{
+    if ( num_alerts )
+        return &alerts[num_alerts - 1].packet;
+
+    assert(packet);
+    set_packet(packet, lua_packet);
     return &lua_packet;
 }
 
+SO_PUBLIC const SnortAlert* get_alerts()
+{ return alerts; }
+
+SO_PUBLIC unsigned get_alert_count()
+{ return num_alerts; }
+
 //-------------------------------------------------------------------------
 // module stuff
 //-------------------------------------------------------------------------
@@ -99,6 +122,10 @@ static const Parameter s_params[] =
     { "args", Parameter::PT_STRING, nullptr, nullptr,
       "luajit logger arguments" },
 
+    { "batch", Parameter::PT_INT, "0:65535", "0",
+      "call alert() once per this many events or DAQ burst; get_alerts() "
+      "returns the array (0 calls once per event)" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -114,12 +141,21 @@ public:
     bool begin(const char*, int, SnortConfig*) override
     {
         args.clear();
+        batch = 0;
         return true;
     }
 
     bool set(const char*, Value& v, SnortConfig*) override
     {
-        args = v.get_string();
+        if ( v.is("args") )
+            args = v.get_string();
+
+        else if ( v.is("batch") )
+            batch = v.get_long();
+
+        else
+            return false;
+
         return true;
     }
 
@@ -128,6 +164,7 @@ public:
 
 public:
     std::string args;
+    unsigned batch = 0;
 };
 
 //-------------------------------------------------------------------------
@@ -141,12 +178,22 @@ public:
     ~LuaJitLogger();
 
     void alert(Packet*, const char*, Event*) override;
+    void flush() override;
+    void close() override;
 
     static const struct LogApi* get_api();
 
+private:
+    void call_alert(lua_State*);
+    void flush(unsigned);
+
 private:
     std::string config;
     std::vector<Lua::State> states;
+
+    // one queue per packet thread when batching
+    unsigned batch;
+    std::vector<std::vector<SnortAlert>> queues;
 };
 
 LuaJitLogger::LuaJitLogger(const char* name, std::string& chunk, LuaLogModule* mod)
@@ -157,6 +204,15 @@ LuaJitLogger::LuaJitLogger(const char* name, std::string& chunk, LuaLogModule* m
     config += "}";
 
     unsigned max = ThreadConfig::get_instance_max();
+    batch = mod->batch;
+
+    if ( batch )
+    {
+        queues.resize(max);
+
+        for ( auto& q : queues )
+            q.reserve(batch);
+    }
 
     // FIXIT-L might make more sense to have one instance with one lua state in
     // each thread instead of one instance with one lua state per thread (same
@@ -171,15 +227,8 @@ LuaJitLogger::LuaJitLogger(const char* name, std::string& chunk, LuaLogModule* m
 LuaJitLogger::~LuaJitLogger()
 { }
 
-void LuaJitLogger::alert(Packet* p, const char*, Event* e)
+void LuaJitLogger::call_alert(lua_State* L)
 {
-    Profile profile(luaLogPerfStats);
-
-    packet = p;
-    event = e;
-
-    lua_State* L = states[get_instance_id()];
-
     Lua::ManageStack ms(L, 1);
 
     lua_getglobal(L, "alert");
@@ -190,6 +239,57 @@ void LuaJitLogger::alert(Packet* p, const char*, Event* e)
     }
 }
 
+void LuaJitLogger::alert(Packet* p, const char*, Event* e)
+{
+    Profile profile(luaLogPerfStats);
+    unsigned id = get_instance_id();
+
+    if ( !batch )
+    {
+        packet = p;
+        event = e;
+        call_alert(states[id]);
+        return;
+    }
+
+    std::vector<SnortAlert>& q = queues[id];
+    q.emplace_back();
+    set_event(e, q.back().event);
+    set_packet(p, q.back().packet);
+
+    if ( q.size() >= batch )
+        flush(id);
+}
+
+void LuaJitLogger::flush(unsigned id)
+{
+    std::vector<SnortAlert>& q = queues[id];
+
+    if ( q.empty() )
+        return;
+
+    alerts = q.data();
+    num_alerts = q.size();
+
+    call_alert(states[id]);
+
+    alerts = nullptr;
+    num_alerts = 0;
+    q.clear();
+}
+
+void LuaJitLogger::flush()
+{
+    if ( batch )
+    {
+        Profile profile(luaLogPerfStats);
+        flush(get_instance_id());
+    }
+}
+
+void LuaJitLogger::close()
+{ flush(); }
+
 //-------------------------------------------------------------------------
 // api stuff
 //-------------------------------------------------------------------------
@@ -0,0 +1,449 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// alert_side_channel.cc
+
+// alert_side_channel exports events over a side channel so the same
+// connectors used for HA can carry alerts off box.  Each packet thread
+// packs fixed size binary records into a batch which is sent as one side
+// channel message when it is full, when it is older than flush_ms, or
+// when the thread shuts down.  Batches can be deflated first.
+//
+// message content:
+//
+//     <batch> ::= <AlertBatchHdr> <records>
+//     <records> ::= [<AlertRecord> <msg>]*  (deflated if flagged)
+//
+// all fields are in host order like SCMsgHdr.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <zlib.h>
+
+#include <chrono>
+
+#include "main/snort_debug.h"
+#include "main/thread.h"
+#include "framework/logger.h"
+#include "framework/module.h"
+#include "control/deferred_work.h"
+#include "detection/signature.h"
+#include "events/event.h"
+#include "log/messages.h"
+#include "packet_io/active.h"
+#include "protocols/packet.h"
+#include "side_channel/side_channel.h"
+#include "utils/util.h"
+
+#define S_NAME "alert_side_channel"
+
+#define s_help \
+    "output batches of events over a side channel"
+
+#define ALERT_BATCH_VERSION 1
+
+// AlertBatchHdr flags
+#define ALERT_BATCH_DEFLATE 0x01
+
+// AlertRecord flags
+#define ALERT_REC_DROPPED 0x01
+
+// longer messages are truncated
+#define ALERT_MAX_MSG 1024
+
+struct __attribute__((__packed__)) AlertBatchHdr
+{
+    uint8_t version;
+    uint8_t flags;
+    uint16_t count;
+    uint32_t length;     // of the records before any compression
+};
+
+struct __attribute__((__packed__)) AlertRecord
+{
+    uint16_t length;     // of this record including msg
+    uint16_t msg_len;
+
+    uint32_t gid;
+    uint32_t sid;
+    uint32_t rev;
+    uint32_t class_id;
+    uint32_t priority;
+    uint32_t event_id;
+    uint32_t event_ref;
+
+    uint64_t sec;
+    uint32_t usec;
+
+    uint8_t src[16];
+    uint8_t dst[16];
+    uint16_t sp;
+    uint16_t dp;
+
+    uint8_t ip_ver;      // 4, 6, or 0 if no ip
+    uint8_t ip_proto;
+    uint8_t flags;
+    uint8_t reserved;
+};
+
+#define ALERT_MAX_REC (sizeof(AlertRecord) + ALERT_MAX_MSG)
+
+//-------------------------------------------------------------------------
+// batch state
+//-------------------------------------------------------------------------
+
+struct AlertBatch
+{
+    SideChannel* sc;
+    bool sc_checked;
+
+    uint8_t* buf;        // records
+    uint32_t len;
+    uint16_t count;
+    uint64_t first_ms;   // when the first record was added
+
+    z_stream* zs;        // if compressing
+    uint8_t* zbuf;
+    uint32_t zbuf_len;
+};
+
+static THREAD_LOCAL AlertBatch batch;
+
+static inline uint64_t now_ms()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//-------------------------------------------------------------------------
+// module stuff
+//-------------------------------------------------------------------------
+
+static const Parameter s_params[] =
+{
+    { "port", Parameter::PT_INT, "0:65535", "0",
+      "side channel port to transmit on" },
+
+    { "batch_size", Parameter::PT_INT, "2048:1048576", "16384",
+      "send a batch once it holds this many bytes of records" },
+
+    { "flush_ms", Parameter::PT_INT, "0:60000", "100",
+      "send a partial batch once its first record is this many milliseconds old" },
+
+    { "compress", Parameter::PT_BOOL, nullptr, "false",
+      "deflate each batch before it is sent" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
+class SideChannelLogModule : public Module
+{
+public:
+    SideChannelLogModule() : Module(S_NAME, s_help, s_params) { }
+
+    bool set(const char*, Value&, SnortConfig*) override;
+    bool begin(const char*, int, SnortConfig*) override;
+
+public:
+    SCPort port;
+    unsigned batch_size;
+    unsigned flush_ms;
+    bool compress;
+};
+
+bool SideChannelLogModule::set(const char*, Value& v, SnortConfig*)
+{
+    if ( v.is("port") )
+        port = v.get_long();
+
+    else if ( v.is("batch_size") )
+        batch_size = v.get_long();
+
+    else if ( v.is("flush_ms") )
+        flush_ms = v.get_long();
+
+    else if ( v.is("compress") )
+        compress = v.get_bool();
+
+    else
+        return false;
+
+    return true;
+}
+
+bool SideChannelLogModule::begin(const char*, int, SnortConfig*)
+{
+    port = 0;
+    batch_size = 16384;
+    flush_ms = 100;
+    compress = false;
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// logger stuff
+//-------------------------------------------------------------------------
+
+class SideChannelLogger : public Logger
+{
+public:
+    SideChannelLogger(SideChannelLogModule*);
+
+    void open() override;
+    void close() override;
+
+    void alert(Packet*, const char* msg, Event*) override;
+
+    static bool tick(void*);
+
+private:
+    SideChannel* get_channel();
+    void flush();
+
+private:
+    SCPort port;
+    unsigned batch_size;
+    unsigned flush_ms;
+    bool compress;
+};
+
+SideChannelLogger::SideChannelLogger(SideChannelLogModule* m)
+{
+    port = m->port;
+    batch_size = m->batch_size;
+    flush_ms = m->flush_ms;
+    compress = m->compress;
+}
+
+void SideChannelLogger::open()
+{
+    // a record that doesn't fit is sent with the next batch
+    batch.buf = (uint8_t*)snort_alloc(batch_size + ALERT_MAX_REC);
+    batch.len = batch.count = 0;
+    batch.sc = nullptr;
+    batch.sc_checked = false;
+
+    if ( compress )
+    {
+        batch.zs = (z_stream*)snort_calloc(sizeof(z_stream));
+
+        if ( deflateInit(batch.zs, Z_BEST_SPEED) != Z_OK )
+            FatalError("%s: can't initialize zlib\n", S_NAME);
+
+        batch.zbuf_len = deflateBound(batch.zs, batch_size + ALERT_MAX_REC);
+        batch.zbuf = (uint8_t*)snort_alloc(batch.zbuf_len);
+    }
+    DeferredWork::register_handler(tick, this);
+}
+
+void SideChannelLogger::close()
+{
+    // side channels are torn down after the outputs are closed
+    flush();
+
+    if ( batch.zs )
+    {
+        deflateEnd(batch.zs);
+        snort_free(batch.zs);
+        snort_free(batch.zbuf);
+        batch.zs = nullptr;
+        batch.zbuf = nullptr;
+    }
+    snort_free(batch.buf);
+    batch.buf = nullptr;
+}
+
+// side channels are set up after the outputs are opened so the lookup is
+// done when the first batch is sent
+SideChannel* SideChannelLogger::get_channel()
+{
+    if ( batch.sc_checked )
+        return batch.sc;
+
+    batch.sc_checked = true;
+    SideChannel* sc = SideChannelManager::get_side_channel(port);
+
+    if ( !sc or !sc->connector_transmit )
+    {
+        if ( get_instance_id() == 0 )
+            ErrorMessage("%s: no transmit side channel on port %u\n", S_NAME, port);
+
+        return nullptr;
+    }
+    sc->set_default_port(port);
+    batch.sc = sc;
+    return sc;
+}
+
+void SideChannelLogger::flush()
+{
+    if ( !batch.count )
+        return;
+
+    SideChannel* sc = get_channel();
+
+    if ( !sc )
+    {
+        batch.len = batch.count = 0;
+        return;
+    }
+
+    AlertBatchHdr hdr;
+    hdr.version = ALERT_BATCH_VERSION;
+    hdr.flags = 0;
+    hdr.count = batch.count;
+    hdr.length = batch.len;
+
+    const uint8_t* body = batch.buf;
+    uint32_t body_len = batch.len;
+
+    if ( batch.zs )
+    {
+        z_stream* zs = batch.zs;
+        deflateReset(zs);
+
+        zs->next_in = batch.buf;
+        zs->avail_in = batch.len;
+        zs->next_out = batch.zbuf;
+        zs->avail_out = batch.zbuf_len;
+
+        // incompressible batches are sent as is
+        if ( deflate(zs, Z_FINISH) == Z_STREAM_END and zs->total_out < batch.len )
+        {
+            hdr.flags |= ALERT_BATCH_DEFLATE;
+            body = batch.zbuf;
+            body_len = zs->total_out;
+        }
+    }
+
+    SCMessage* msg = sc->alloc_transmit_message(sizeof(hdr) + body_len);
+    memcpy(msg->content, &hdr, sizeof(hdr));
+    memcpy(msg->content + sizeof(hdr), body, body_len);
+    sc->transmit_message(msg);
+
+    batch.len = batch.count = 0;
+}
+
+bool SideChannelLogger::tick(void* pv)
+{
+    SideChannelLogger* log = (SideChannelLogger*)pv;
+
+    if ( batch.count and now_ms() - batch.first_ms >= log->flush_ms )
+        log->flush();
+
+    return false;
+}
+
+void SideChannelLogger::alert(Packet* p, const char* msg, Event* event)
+{
+    if ( !msg )
+        msg = "";
+
+    uint16_t msg_len = strnlen(msg, ALERT_MAX_MSG);
+    AlertRecord* rec = (AlertRecord*)(batch.buf + batch.len);
+
+    memset(rec, 0, sizeof(*rec));
+    rec->length = sizeof(*rec) + msg_len;
+    rec->msg_len = msg_len;
+
+    if ( event )
+    {
+        const SigInfo* si = event->sig_info;
+        rec->gid = si->generator;
+        rec->sid = si->id;
+        rec->rev = si->rev;
+        rec->class_id = si->class_id;
+        rec->priority = si->priority;
+        rec->event_id = event->event_id;
+        rec->event_ref = event->event_reference;
+    }
+
+    rec->sec = p->pkth->ts.tv_sec;
+    rec->usec = p->pkth->ts.tv_usec;
+
+    if ( p->has_ip() )
+    {
+        const sfip_t* src = p->ptrs.ip_api.get_src();
+        const sfip_t* dst = p->ptrs.ip_api.get_dst();
+
+        rec->ip_ver = src->is_ip6() ? 6 : 4;
+        memcpy(rec->src, src->ip8, sizeof(rec->src));
+        memcpy(rec->dst, dst->ip8, sizeof(rec->dst));
+        rec->ip_proto = (uint8_t)p->get_ip_proto_next();
+    }
+
+    if ( p->proto_bits & (PROTO_BIT__TCP|PROTO_BIT__UDP) )
+    {
+        rec->sp = p->ptrs.sp;
+        rec->dp = p->ptrs.dp;
+    }
+
+    if ( Active::packet_was_dropped() )
+        rec->flags |= ALERT_REC_DROPPED;
+
+    memcpy(rec + 1, msg, msg_len);
+
+    if ( !batch.count++ )
+        batch.first_ms = now_ms();
+
+    batch.len += rec->length;
+
+    if ( batch.len >= batch_size or batch.count == UINT16_MAX or !flush_ms )
+        flush();
+}
+
+//-------------------------------------------------------------------------
+// api stuff
+//-------------------------------------------------------------------------
+
+static Module* mod_ctor()
+{ return new SideChannelLogModule; }
+
+static void mod_dtor(Module* m)
+{ delete m; }
+
+static Logger* sc_ctor(SnortConfig*, Module* mod)
+{ return new SideChannelLogger((SideChannelLogModule*)mod); }
+
+static void sc_dtor(Logger* p)
+{ delete p; }
+
+static LogApi sc_api
+{
+    {
+        PT_LOGGER,
+        sizeof(LogApi),
+        LOGAPI_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        S_NAME,
+        s_help,
+        mod_ctor,
+        mod_dtor
+    },
+    OUTPUT_TYPE_FLAG__ALERT,
+    sc_ctor,
+    sc_dtor
+};
+
+// linked statically since it depends on the side channel manager
+const BaseApi* alert_side_channel = &sc_api.base;
+
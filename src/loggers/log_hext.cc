@@ -70,35 +70,98 @@ static void log_header(const Packet* p)
         src, p->ptrs.sp, dst, p->ptrs.dp);
 }
 
-static void log_data(const uint8_t* p, unsigned n, unsigned width)
+// lines up to this wide are formatted whole and written with one copy;
+// wider ones are written in pieces of this many bytes
+#define MAX_LINE_BYTES 64
+
+static const char hex_digit[] = "0123456789ABCDEF";
+
+static inline char* put_hex(char* out, const uint8_t* p, unsigned n)
 {
-    string txt;
-    unsigned odx = 0, idx = 0;
+    for ( unsigned i = 0; i < n; i++ )
+    {
+        *out++ = hex_digit[p[i] >> 4];
+        *out++ = hex_digit[p[i] & 0x0F];
+        *out++ = ' ';
+    }
+    return out;
+}
 
-    TextLog_NewLine(hext_log);
+static inline char* put_text(char* out, const uint8_t* p, unsigned n)
+{
+    for ( unsigned i = 0; i < n; i++ )
+        *out++ = isprint(p[i]) ? p[i] : '.';
+
+    return out;
+}
+
+static inline char* put_pad(char* out, unsigned n)
+{
+    memset(out, ' ', 3*n);
+    return out + 3*n;
+}
+
+// x<hex> # <text>
+static void log_line(const uint8_t* p, unsigned n, unsigned width)
+{
+    char line[1 + 3*MAX_LINE_BYTES + 3 + MAX_LINE_BYTES + 1];
+    char* out = line;
+
+    *out++ = 'x';
+    out = put_hex(out, p, n);
+    out = put_pad(out, width - n);
+    memcpy(out, " # ", 3);
+    out = put_text(out + 3, p, n);
+    *out++ = '\n';
+
+    TextLog_Write(hext_log, line, out - line);
+}
 
-    for ( idx = 0; idx < n; idx++)
+static void log_wide_line(const uint8_t* p, unsigned n, unsigned width)
+{
+    char buf[3*MAX_LINE_BYTES];
+
+    TextLog_Putc(hext_log, 'x');
+
+    for ( unsigned i = 0; i < n; i += MAX_LINE_BYTES )
     {
-        if ( !odx )
-            TextLog_Putc(hext_log, 'x');
-
-        uint8_t byte = p[idx];
-        TextLog_Print(hext_log, "%2.02X ", byte);
-        txt += isprint(byte) ? byte : '.';
-
-        if ( ++odx == width )
-        {
-            TextLog_Print(hext_log, " # %s\n", txt.c_str());
-            txt.clear();
-            odx = 0;
-        }
+        unsigned k = std::min(n - i, (unsigned)MAX_LINE_BYTES);
+        TextLog_Write(hext_log, buf, put_hex(buf, p + i, k) - buf);
     }
-    if ( odx )
+    for ( unsigned i = n; i < width; i += MAX_LINE_BYTES )
     {
-        while ( odx++ < width )
-            TextLog_Print(hext_log, "   ");
+        unsigned k = std::min(width - i, (unsigned)MAX_LINE_BYTES);
+        TextLog_Write(hext_log, buf, put_pad(buf, k) - buf);
+    }
+    TextLog_Write(hext_log, " # ", 3);
+
+    for ( unsigned i = 0; i < n; i += MAX_LINE_BYTES )
+    {
+        unsigned k = std::min(n - i, (unsigned)MAX_LINE_BYTES);
+        TextLog_Write(hext_log, buf, put_text(buf, p + i, k) - buf);
+    }
+    TextLog_NewLine(hext_log);
+}
+
+static void log_data(const uint8_t* p, unsigned n, unsigned width)
+{
+    TextLog_NewLine(hext_log);
+
+    // unlimited width is one line of everything
+    if ( !width )
+        width = n;
+
+    while ( n )
+    {
+        unsigned k = std::min(n, width);
+
+        if ( width <= MAX_LINE_BYTES )
+            log_line(p, k, width);
+        else
+            log_wide_line(p, k, width);
 
-        TextLog_Print(hext_log, " # %s\n", txt.c_str());
+        p += k;
+        n -= k;
     }
 }
 
@@ -29,6 +29,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <time.h>
+#include <fcntl.h>
 #include <pcap.h>
 
 extern "C" {
@@ -41,6 +42,8 @@ extern "C" {
 #include "main/snort_config.h"
 #include "framework/logger.h"
 #include "framework/module.h"
+#include "control/deferred_work.h"
+#include "log/async_writer.h"
 #include "protocols/packet.h"
 #include "events/event.h"
 #include "parser/parser.h"
@@ -66,19 +69,38 @@ struct LtdConfig
 {
     string file;
     size_t limit;
+    bool async;
+    unsigned flush_size;
+    unsigned flush_ms;
 };
 
 struct LtdContext
 {
+    // set on the packet thread
+    char* base;
+    int dlt;
+    uint32_t snap_len;
+
+    // in async mode the writer thread owns these once writer is set
     char* file;
     pcap_dumper_t* dumpd;
     time_t lastTime;
+
+    // packet thread only
+    time_t roll_time;
     size_t size;
     int log_cnt;
+
+    AsyncWriter* writer;
+    AsyncSink* sink;
 };
 
 static THREAD_LOCAL LtdContext context;
 
+/* async mode chunks per packet thread */
+#define PCAP_ASYNC_CHUNKS 8
+
+static void TcpdumpInitLogFile(LtdContext&, bool no_timestamp);
 static void TcpdumpRollLogFile(LtdConfig*);
 
 #define S_NAME "log_pcap"
@@ -96,6 +118,15 @@ static const Parameter s_params[] =
     { "units", Parameter::PT_ENUM, "B | K | M | G", "B",
       "bytes | KB | MB | GB" },
 
+    { "async", Parameter::PT_BOOL, nullptr, "false",
+      "write and roll files on a separate thread instead of the packet threads" },
+
+    { "flush_size", Parameter::PT_INT, "1024:16777216", "262144",
+      "with async, hand off buffered packets at this many bytes (at least one max packet)" },
+
+    { "flush_ms", Parameter::PT_INT, "0:60000", "1000",
+      "with async, hand off buffered packets after this many milliseconds" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -114,6 +145,9 @@ public:
 public:
     unsigned limit;
     unsigned units;
+    bool async;
+    unsigned flush_size;
+    unsigned flush_ms;
 };
 
 bool TcpdumpModule::set(const char*, Value& v, SnortConfig*)
@@ -124,6 +158,15 @@ bool TcpdumpModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("units") )
         units = v.get_long();
 
+    else if ( v.is("async") )
+        async = v.get_bool();
+
+    else if ( v.is("flush_size") )
+        flush_size = v.get_long();
+
+    else if ( v.is("flush_ms") )
+        flush_ms = v.get_long();
+
     else
         return false;
 
@@ -134,6 +177,9 @@ bool TcpdumpModule::begin(const char*, int, SnortConfig*)
 {
     limit = 0;
     units = 0;
+    async = false;
+    flush_size = 262144;
+    flush_ms = 1000;
     return true;
 }
 
@@ -154,6 +200,30 @@ static inline size_t SizeOf(const DAQ_PktHdr_t* pkth)
     return PCAP_PKT_HDR_SZ + pkth->caplen;
 }
 
+// the on disk record header; pcap_pkthdr has a struct timeval
+struct PcapRecordHdr
+{
+    uint32_t sec;
+    uint32_t usec;
+    uint32_t caplen;
+    uint32_t len;
+};
+
+static void LogTcpdumpAsync(const DAQ_PktHdr_t* pkth, const uint8_t* pkt)
+{
+    PcapRecordHdr hdr;
+    hdr.sec = (uint32_t)pkth->ts.tv_sec;
+    hdr.usec = (uint32_t)pkth->ts.tv_usec;
+    hdr.caplen = pkth->caplen;
+    hdr.len = pkth->pktlen;
+
+    // the chunks are sized for snap_len packets
+    if ( hdr.caplen > context.snap_len )
+        hdr.caplen = context.snap_len;
+
+    context.writer->put((const uint8_t*)&hdr, sizeof(hdr), pkt, hdr.caplen);
+}
+
 static void LogTcpdumpSingle(
     LtdConfig* data, Packet* p, const char*, Event*)
 {
@@ -162,9 +232,16 @@ static void LogTcpdumpSingle(
     if ( data->limit && (context.size + dumpSize > data->limit) )
         TcpdumpRollLogFile(data);
 
-    pcap_dump((u_char*)context.dumpd,(struct pcap_pkthdr*)p->pkth,p->pkt);
     context.size += dumpSize;
 
+    if ( context.writer )
+    {
+        LogTcpdumpAsync(p->pkth, p->pkt);
+        return;
+    }
+
+    pcap_dump((u_char*)context.dumpd,(struct pcap_pkthdr*)p->pkth,p->pkt);
+
     if (!SnortConfig::line_buffered_logging())  // FIXIT-L misnomer
     {
         fflush( (FILE*)context.dumpd);
@@ -178,23 +255,17 @@ static void LogTcpdumpStream(
 // (take original packet headers and append reassembled data)
 }
 
-static void TcpdumpInitLogFile(LtdConfig*, bool no_timestamp)
+// the file name and link type depend on packet thread state so they are
+// set up here for any later rolls done on the writer thread
+static void TcpdumpSetupLogFile(LtdContext& ctx)
 {
     string file;
-    string filename;
-    char timestamp[16];
+    get_instance_file(file, F_NAME);
 
-    context.lastTime = time(NULL);
-    context.log_cnt = 0;
+    if ( ctx.base )
+        snort_free(ctx.base);
 
-    filename += F_NAME;
-    if(!no_timestamp)
-    {
-        snprintf(timestamp, sizeof(timestamp), ".%lu", context.lastTime);
-        filename += timestamp;
-    }
-
-    get_instance_file(file, filename.c_str());
+    ctx.base = snort_strdup(file.c_str());
 
     int dlt = SFDAQ::get_base_protocol();
 
@@ -203,47 +274,143 @@ static void TcpdumpInitLogFile(LtdConfig*, bool no_timestamp)
     if ( dlt == DLT_IPV4 || dlt == DLT_IPV6 )
         dlt = DLT_RAW;
 
+    ctx.dlt = dlt;
+    ctx.snap_len = SFDAQ::get_snap_len();
+}
+
+static void TcpdumpInitLogFile(LtdContext& ctx, bool no_timestamp)
+{
+    string file = ctx.base;
+    char timestamp[16];
+
+    time_t now = time(NULL);
+
+    // a delayed async roll must not reuse the last file name
+    ctx.lastTime = (now > ctx.lastTime) ? now : ctx.lastTime + 1;
+
+    if(!no_timestamp)
+    {
+        snprintf(timestamp, sizeof(timestamp), ".%lu", ctx.lastTime);
+        file += timestamp;
+    }
+
     pcap_t* pcap;
-    pcap = pcap_open_dead(dlt, SFDAQ::get_snap_len());
+    pcap = pcap_open_dead(ctx.dlt, ctx.snap_len);
 
     if ( !pcap )
         FatalError("%s: can't get pcap context\n", S_NAME);
 
-    context.dumpd = pcap ? pcap_dump_open(pcap, file.c_str()) : NULL;
+    ctx.dumpd = pcap ? pcap_dump_open(pcap, file.c_str()) : NULL;
 
-    if (context.dumpd == NULL)
+    if (ctx.dumpd == NULL)
     {
         FatalError("%s: can't open %s: %s\n",
             S_NAME, file.c_str(), pcap_geterr(pcap));
     }
     pcap_close(pcap);
 
-    context.file = snort_strdup(file.c_str());
-    context.size = PCAP_FILE_HDR_SZ;
+    ctx.file = snort_strdup(file.c_str());
+}
+
+static void TcpdumpCloseLogFile(LtdContext& ctx)
+{
+    if ( ctx.dumpd != NULL )
+    {
+        pcap_dump_close(ctx.dumpd);
+        ctx.dumpd = NULL;
+    }
+    if ( ctx.file )
+    {
+        snort_free(ctx.file);
+        ctx.file = nullptr;
+    }
 }
 
-static void TcpdumpRollLogFile(LtdConfig* data)
+static void TcpdumpRollLogFile(LtdConfig*)
 {
     time_t now = time(NULL);
 
     /* don't roll over any sooner than resolution
      * of filename discriminator
      */
-    if ( now <= context.lastTime )
+    if ( now <= context.roll_time )
         return;
 
-    /* close the output file */
-    if ( context.dumpd != NULL )
+    context.roll_time = now;
+    context.size = PCAP_FILE_HDR_SZ;
+
+    /* the writer thread opens the next file before the next packet */
+    if ( context.writer )
     {
-        pcap_dump_close(context.dumpd);
-        context.dumpd = NULL;
-        context.size = 0;
-        snort_free(context.file);
-        context.file = nullptr;
+        context.writer->rotate();
+        return;
     }
 
+    /* close the output file */
+    TcpdumpCloseLogFile(context);
+
     /* Have to add stamps now to distinguish files */
-    TcpdumpInitLogFile(data, false);
+    TcpdumpInitLogFile(context, false);
+    context.log_cnt = 0;
+}
+
+//-------------------------------------------------------------------------
+// async output
+//
+// the pcap header is written through the dumper when the file is opened;
+// packets are written directly to the file descriptor after that.  when a
+// limit is set the file's blocks are reserved up front without changing
+// its size so readers never see a padded file.
+//-------------------------------------------------------------------------
+
+class PcapSink : public AsyncSink
+{
+public:
+    PcapSink(LtdContext* c, size_t lim)
+    { ctx = c; limit = lim; }
+
+    void open();
+
+    void write(const struct iovec*, int) override;
+    void rotate() override;
+
+private:
+    LtdContext* ctx;
+    size_t limit;
+};
+
+void PcapSink::open()
+{
+    pcap_dump_flush(ctx->dumpd);
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    if ( limit )
+        (void)fallocate(fileno(pcap_dump_file(ctx->dumpd)), FALLOC_FL_KEEP_SIZE, 0, limit);
+#endif
+}
+
+void PcapSink::rotate()
+{
+    TcpdumpCloseLogFile(*ctx);
+    TcpdumpInitLogFile(*ctx, false);
+    open();
+}
+
+void PcapSink::write(const struct iovec* v, int n)
+{
+    int err = write_all(fileno(pcap_dump_file(ctx->dumpd)), v, n);
+
+    // same as pcap_dump; the packets are lost but logging goes on
+    if ( err )
+        ErrorMessage("%s: can't write %s: %s\n", S_NAME, ctx->file, get_error(err));
+}
+
+static bool TcpdumpTick(void*)
+{
+    if ( context.writer )
+        context.writer->tick();
+
+    return false;
 }
 
 static void SpoLogTcpdumpCleanup(LtdConfig*)
@@ -289,6 +456,11 @@ PcapLogger::PcapLogger(TcpdumpModule* m)
 {
     config = new LtdConfig;
     config->limit = m->limit;
+    config->async = m->async;
+    config->flush_ms = m->flush_ms;
+
+    // room for the largest packet the daq can deliver is checked at open
+    config->flush_size = m->flush_size;
 }
 
 PcapLogger::~PcapLogger()
@@ -298,25 +470,51 @@ PcapLogger::~PcapLogger()
 
 void PcapLogger::open()
 {
-    TcpdumpInitLogFile(config, SnortConfig::output_no_timestamp());
+    TcpdumpSetupLogFile(context);
+    TcpdumpInitLogFile(context, SnortConfig::output_no_timestamp());
+    context.roll_time = context.lastTime;
+    context.size = PCAP_FILE_HDR_SZ;
+    context.log_cnt = 0;
+
+    if ( !config->async or context.writer )
+        return;
+
+    unsigned max_rec = PCAP_PKT_HDR_SZ + context.snap_len;
+    unsigned chunk = config->flush_size > max_rec ? config->flush_size : max_rec;
+
+    PcapSink* ps = new PcapSink(&context, config->limit);
+    ps->open();
+
+    context.sink = ps;
+    context.writer = new AsyncWriter(ps, chunk, PCAP_ASYNC_CHUNKS, config->flush_ms);
+    DeferredWork::register_handler(TcpdumpTick, nullptr);
 }
 
 void PcapLogger::close()
 {
+    if ( context.writer )
+    {
+        // drains the queue so the file is ours again
+        delete context.writer;
+        context.writer = nullptr;
+
+        delete context.sink;
+        context.sink = nullptr;
+    }
+
     SpoLogTcpdumpCleanup(nullptr);
+    TcpdumpCloseLogFile(context);
 
-    if ( context.dumpd )
+    if ( context.base )
     {
-        pcap_dump_close(context.dumpd);
-        context.dumpd = nullptr;
+        snort_free(context.base);
+        context.base = nullptr;
     }
-    if ( context.file )
-        snort_free(context.file);
 }
 
 void PcapLogger::log(Packet* p, const char* msg, Event* event)
 {
-    if(!context.dumpd)
+    if(!context.dumpd && !context.writer)
         open();
 
     context.log_cnt++;
@@ -328,7 +526,7 @@ void PcapLogger::log(Packet* p, const char* msg, Event* event)
 
 void PcapLogger::reset()
 {
-    if(!context.dumpd)
+    if(!context.dumpd && !context.writer)
         open();
     else
         TcpdumpRollLogFile(config);
@@ -28,6 +28,9 @@
 // to ensure PacketManager::log_protocols() is built into Snort++
 extern const BaseApi* log_codecs;
 
+// depends on the side channel manager
+extern const BaseApi* alert_side_channel;
+
 #ifdef LINUX
 extern const BaseApi* alert_sf_socket;
 #endif
@@ -36,6 +39,7 @@ extern const BaseApi* alert_sf_socket;
 extern const BaseApi* alert_csv;
 extern const BaseApi* alert_fast;
 extern const BaseApi* alert_full;
+extern const BaseApi* alert_json;
 extern const BaseApi* alert_syslog;
 extern const BaseApi* log_hext;
 extern const BaseApi* log_pcap;
@@ -46,6 +50,7 @@ const BaseApi* loggers[] =
 {
     // loggers
     log_codecs,
+    alert_side_channel,
 
 #ifdef LINUX
     alert_sf_socket,
@@ -56,6 +61,7 @@ const BaseApi* loggers[] =
     alert_csv,
     alert_fast,
     alert_full,
+    alert_json,
     alert_syslog,
 
     // loggers
@@ -36,9 +36,12 @@
 #include <string.h>
 #include <errno.h>
 #include <time.h>
+#include <unistd.h>
 #include <netinet/in.h>
+#include <sys/uio.h>
 
 #include <string>
+#include <vector>
 
 #include "main/snort_types.h"
 #include "main/snort_debug.h"
@@ -60,6 +63,8 @@
 #include "protocols/vlan.h"
 #include "protocols/icmp4.h"
 #include "log/obfuscator.h"
+#include "log/async_writer.h"
+#include "control/deferred_work.h"
 #include "utils/safec.h"
 
 using namespace std;
@@ -74,6 +79,9 @@ typedef struct _Unified2Config
     int nostamp;
     int mpls_event_types;
     int vlan_event_types;
+    int async;
+    unsigned flush_size;
+    unsigned flush_ms;
 } Unified2Config;
 
 typedef struct _Unified2LogCallbackData
@@ -91,6 +99,10 @@ struct U2
     char filepath[STD_BUF];
     FILE* stream;
     unsigned int current;
+
+    // async mode only; the writer thread owns stream once this is set
+    AsyncWriter* writer;
+    AsyncSink* sink;
 };
 
 /* -------------------- Global Variables ----------------------*/
@@ -117,10 +129,14 @@ static THREAD_LOCAL uint8_t write_pkt_buffer[u2_buf_sz];
 /* use the size of the buffer we copy record data into */
 static THREAD_LOCAL char io_buffer[u2_buf_sz];
 
+/* async mode chunks per packet thread */
+#define U2_ASYNC_CHUNKS 8
+
 /* -------------------- Local Functions -----------------------*/
 
 /* Unified2 Output functions */
-static void Unified2InitFile(Unified2Config*);
+static void Unified2InitFile(U2&, Unified2Config*);
+static void Unified2ReopenFile(U2&, Unified2Config*);
 static inline void Unified2RotateFile(Unified2Config*);
 static void _Unified2LogPacketAlert(Packet*, const char*, Unified2Config*, Event*);
 static void Unified2Write(uint8_t*, uint32_t, Unified2Config*);
@@ -163,11 +179,12 @@ static int GetU2Flags(const Packet*, uint8_t* pimpact)
  *
  * Purpose: Initialize the unified2 output file
  *
- * Arguments: config => pointer to the plugin's reference data struct
+ * Arguments: u => the file state to (re)open
+ *            config => pointer to the plugin's reference data struct
  *
  * Returns: void function
  */
-static void Unified2InitFile(Unified2Config* config)
+static void Unified2InitFile(U2& u, Unified2Config* config)
 {
     char filepath[STD_BUF];
     char* fname_ptr;
@@ -178,12 +195,12 @@ static void Unified2InitFile(Unified2Config* config)
             "configuration data is NULL.\n", __FILE__, __LINE__);
     }
 
-    u2.timestamp = (uint32_t)time(NULL);
+    u.timestamp = (uint32_t)time(NULL);
 
     if (!config->nostamp)
     {
         if (SnortSnprintf(filepath, sizeof(filepath), "%s.%u",
-            u2.filepath, u2.timestamp) != SNORT_SNPRINTF_SUCCESS)
+            u.filepath, u.timestamp) != SNORT_SNPRINTF_SUCCESS)
         {
             FatalError("%s(%d) Failed to copy unified2 file path.\n",
                 __FILE__, __LINE__);
@@ -193,11 +210,11 @@ static void Unified2InitFile(Unified2Config* config)
     }
     else
     {
-        fname_ptr = u2.filepath;
+        fname_ptr = u.filepath;
     }
 
     // FIXIT-P should use open() instead of fopen()
-    if ((u2.stream = fopen(fname_ptr, "wb")) == NULL)
+    if ((u.stream = fopen(fname_ptr, "wb")) == NULL)
     {
         FatalError("%s(%d) Could not open %s: %s\n",
             __FILE__, __LINE__, fname_ptr, get_error(errno));
@@ -205,7 +222,7 @@ static void Unified2InitFile(Unified2Config* config)
 
     /* Set buffer to size of record buffer so the system doesn't flush
      * part of a record if it's greater than BUFSIZ */
-    if (setvbuf(u2.stream, io_buffer, _IOFBF, sizeof(io_buffer)) != 0)
+    if (setvbuf(u.stream, io_buffer, _IOFBF, sizeof(io_buffer)) != 0)
     {
         ErrorMessage("%s(%d) Could not set I/O buffer: %s. "
             "Using system default.\n",
@@ -215,8 +232,8 @@ static void Unified2InitFile(Unified2Config* config)
     /* If test mode, close and delete the file */
     if (SnortConfig::test_mode())  // FIXIT-L eliminate test check; should always remove if empty
     {
-        fclose(u2.stream);
-        u2.stream = NULL;
+        fclose(u.stream);
+        u.stream = NULL;
         if (unlink(fname_ptr) == -1)
         {
             ErrorMessage("%s(%d) Running in test mode so we want to remove "
@@ -226,11 +243,23 @@ static void Unified2InitFile(Unified2Config* config)
     }
 }
 
+static void Unified2ReopenFile(U2& u, Unified2Config* config)
+{
+    if ( u.stream )
+        fclose(u.stream);
+
+    Unified2InitFile(u, config);
+}
+
+// in async mode the writer thread rotates before the next record
 static inline void Unified2RotateFile(Unified2Config* config)
 {
-    fclose(u2.stream);
     u2.current = 0;
-    Unified2InitFile(config);
+
+    if ( u2.writer )
+        u2.writer->rotate();
+    else
+        Unified2ReopenFile(u2, config);
 }
 
 static void _AlertIP4_v2(Packet* p, const char*, Unified2Config* config, Event* event)
@@ -597,6 +626,13 @@ static void Unified2Write(uint8_t* buf, uint32_t buf_len, Unified2Config* config
     size_t fwcount = 0;
     int ffstatus = 0;
 
+    if ( u2.writer )
+    {
+        u2.writer->put(buf, buf_len);
+        u2.current += buf_len;
+        return;
+    }
+
     /* Nothing to write or nothing to write to */
     if ((buf == NULL) || (config == NULL) || (u2.stream == NULL))
         return;
@@ -744,6 +780,88 @@ static void Unified2Write(uint8_t* buf, uint32_t buf_len, Unified2Config* config
     u2.current += buf_len;
 }
 
+//-------------------------------------------------------------------------
+// async output
+//
+// the packet thread only fills chunks.  this runs on the writer thread and
+// mirrors the error handling above: retry interrupts a few times, start a
+// new file once on EIO, and fatal on anything else.
+//-------------------------------------------------------------------------
+
+class U2Sink : public AsyncSink
+{
+public:
+    U2Sink(U2* u, Unified2Config* c)
+    { ufile = u; config = c; }
+
+    void write(const struct iovec*, int) override;
+
+    void rotate() override
+    { Unified2ReopenFile(*ufile, config); }
+
+private:
+    U2* ufile;
+    Unified2Config* config;
+    std::vector<struct iovec> iov;
+};
+
+void U2Sink::write(const struct iovec* v, int n)
+{
+    iov.assign(v, v + n);
+
+    struct iovec* p = iov.data();
+    int max_retries = 3;
+    bool rotated = false;
+
+    while ( n > 0 and ufile->stream )
+    {
+        ssize_t len = writev(fileno(ufile->stream), p, n);
+
+        if ( len < 0 )
+        {
+            int error = errno;
+
+            if ( error == EINTR and max_retries-- > 0 )
+                continue;
+
+            ErrorMessage("%s(%d) Failed to write to unified2 file (%s): %s\n",
+                __FILE__, __LINE__, ufile->filepath, get_error(error));
+
+            if ( error == EIO and !rotated )
+            {
+                ErrorMessage("%s(%d) Unified2 file is possibly corrupt. "
+                    "Closing this unified2 file and creating "
+                    "a new one.\n", __FILE__, __LINE__);
+                rotate();
+                rotated = true;
+                continue;
+            }
+            FatalError("%s(%d) Cannot write to device.\n", __FILE__, __LINE__);
+        }
+
+        // skip whatever was written; writev can stop short
+        while ( n > 0 and (size_t)len >= p->iov_len )
+        {
+            len -= p->iov_len;
+            ++p;
+            --n;
+        }
+        if ( n > 0 )
+        {
+            p->iov_base = (uint8_t*)p->iov_base + len;
+            p->iov_len -= len;
+        }
+    }
+}
+
+static bool Unified2Tick(void*)
+{
+    if ( u2.writer )
+        u2.writer->tick();
+
+    return false;
+}
+
 //-------------------------------------------------------------------------
 // unified2 module
 //-------------------------------------------------------------------------
@@ -765,6 +883,15 @@ static const Parameter s_params[] =
     { "vlan_event_types", Parameter::PT_BOOL, nullptr, "false",
       "include vlan IDs in events" },
 
+    { "async", Parameter::PT_BOOL, nullptr, "false",
+      "write files on a separate thread instead of the packet threads" },
+
+    { "flush_size", Parameter::PT_INT, "1024:16777216", "262144",
+      "with async, hand off buffered records at this many bytes (at least one max record)" },
+
+    { "flush_ms", Parameter::PT_INT, "0:60000", "1000",
+      "with async, hand off buffered records after this many milliseconds" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -786,6 +913,9 @@ public:
     bool nostamp;
     bool mpls;
     bool vlan;
+    bool async;
+    unsigned flush_size;
+    unsigned flush_ms;
 };
 
 bool U2Module::set(const char*, Value& v, SnortConfig*)
@@ -805,6 +935,15 @@ bool U2Module::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("vlan_event_types") )
         vlan = v.get_bool();
 
+    else if ( v.is("async") )
+        async = v.get_bool();
+
+    else if ( v.is("flush_size") )
+        flush_size = v.get_long();
+
+    else if ( v.is("flush_ms") )
+        flush_ms = v.get_long();
+
     else
         return false;
 
@@ -817,6 +956,9 @@ bool U2Module::begin(const char*, int, SnortConfig*)
     units = 0;
     nostamp = SnortConfig::output_no_timestamp();
     mpls = vlan = false;
+    async = false;
+    flush_size = 262144;
+    flush_ms = 1000;
     return true;
 }
 
@@ -854,6 +996,12 @@ U2Logger::U2Logger(U2Module* m)
     config.nostamp = m->nostamp;
     config.mpls_event_types = m->mpls;
     config.vlan_event_types = m->vlan;
+    config.async = m->async;
+    config.flush_size = m->flush_size;
+    config.flush_ms = m->flush_ms;
+
+    if ( config.flush_size < u2_buf_sz )
+        config.flush_size = u2_buf_sz;
 }
 
 U2Logger::~U2Logger()
@@ -876,13 +1024,31 @@ void U2Logger::open()
     }
     u2.base_proto = htonl(SFDAQ::get_base_protocol());
 
-    Unified2InitFile(&config);
+    Unified2InitFile(u2, &config);
+
+    if ( config.async and u2.stream )
+    {
+        u2.sink = new U2Sink(&u2, &config);
+        u2.writer = new AsyncWriter(
+            u2.sink, config.flush_size, U2_ASYNC_CHUNKS, config.flush_ms);
+        DeferredWork::register_handler(Unified2Tick, nullptr);
+    }
 
     stream.reg_xtra_data_log(AlertExtraData, &config);
 }
 
 void U2Logger::close()
 {
+    if ( u2.writer )
+    {
+        // drains the queue so the stream is ours again
+        delete u2.writer;
+        u2.writer = nullptr;
+
+        delete u2.sink;
+        u2.sink = nullptr;
+    }
+
     if ( u2.stream )
         fclose(u2.stream);
 }
@@ -188,5 +188,18 @@ inline bool Stack<bool>::get(lua_State* L, int n)
 template<>
 inline constexpr int Stack<bool>::type()
 { return LUA_TBOOLEAN; }
+
+// double
+template<>
+inline void Stack<double>::push(lua_State* L, double v)
+{ lua_pushnumber(L, v); }
+
+template<>
+inline double Stack<double>::get(lua_State* L, int n)
+{ return lua_tonumber(L, n); }
+
+template<>
+inline constexpr int Stack<double>::type()
+{ return LUA_TNUMBER; }
 }
 #endif
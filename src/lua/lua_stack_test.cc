@@ -374,6 +374,45 @@ static void test_bool()
     lua_pop(L, 1);
 }
 
+static void test_double()
+{
+    bool b;
+    double v;
+
+    // Test get
+    lua_pushnumber(L, 0.5);
+    {
+        v = Lua::Stack<double>::get(L, -1);
+        CHECK(v == 0.5);
+    }
+    lua_pop(L, 1);
+
+    // Test push
+    Lua::Stack<double>::push(L, 2.25);
+    {
+        v = lua_tonumber(L, -1);
+        CHECK(v == 2.25);
+    }
+    lua_pop(L, 1);
+
+    // Test validate, integers are numbers too
+    lua_pushinteger(L, 3);
+    {
+        b = Lua::Stack<double>::validate(L, -1, v);
+        CHECK(b);
+        CHECK(v == 3.0);
+    }
+    lua_pop(L, 1);
+
+    // Test invalid
+    lua_pushnil(L);
+    {
+        b = Lua::Stack<double>::validate(L, -1, v);
+        CHECK(!b);
+    }
+    lua_pop(L, 1);
+}
+
 TEST_CASE("lua_stack", "[lua_stack]")
 {
     l_reset_lua_state(L);
@@ -398,5 +437,9 @@ TEST_CASE("lua_stack", "[lua_stack]")
     {
         test_bool();
     }
+    SECTION("double")
+    {
+        test_double();
+    }
     l_end_lua_state(L);
 }
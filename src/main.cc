@@ -37,6 +37,8 @@
 #include <netinet/in.h>
 #endif
 
+#include <chrono>
+#include <future>
 #include <string>
 #include <thread>
 using namespace std;
@@ -53,8 +55,11 @@ using namespace std;
 #include "managers/plugin_manager.h"
 #include "managers/inspector_manager.h"
 #include "memory/memory_cap.h"
+#include "profiler/memory_sampler.h"
+#include "profiler/profiler.h"
 #include "utils/util.h"
 #include "parser/parser.h"
+#include "packet_io/pcap_bench.h"
 #include "packet_io/trough.h"
 #include "packet_io/intf.h"
 #include "packet_io/sfdaq.h"
@@ -108,31 +113,28 @@ static bool use_shell(SnortConfig* sc)
 // swap foo
 //-------------------------------------------------------------------------
 
-Swapper::Swapper(SnortConfig* s, tTargetBasedConfig* t)
+// host attributes aren't swapped; see SFAT_Refresh()
+Swapper::Swapper(SnortConfig* s)
 {
     old_conf = nullptr;
     new_conf = s;
-
-    old_attribs = nullptr;
-    new_attribs = t;
+    dot_trash = nullptr;
 }
 
 Swapper::Swapper(SnortConfig* sold, SnortConfig* snew)
 {
     old_conf = sold;
     new_conf = snew;
-
-    old_attribs = nullptr;
-    new_attribs = nullptr;
+    dot_trash = nullptr;
 }
 
-Swapper::Swapper(tTargetBasedConfig* told, tTargetBasedConfig* tnew)
+// the trash is freed when the swap completes, once no packet thread can
+// still be walking the replaced arrays
+Swapper::Swapper(DotTrash* trash)
 {
     old_conf = nullptr;
     new_conf = nullptr;
-
-    old_attribs = told;
-    new_attribs = tnew;
+    dot_trash = trash;
 }
 
 Swapper::~Swapper()
@@ -140,8 +142,8 @@ Swapper::~Swapper()
     if ( old_conf )
         delete old_conf;
 
-    if ( old_attribs )
-        SFAT_Free(old_attribs);
+    if ( dot_trash )
+        detection_option_tree_empty_trash(dot_trash);
 }
 
 void Swapper::apply()
@@ -151,9 +153,6 @@ void Swapper::apply()
         snort_conf = new_conf;
         set_default_policy();
     }
-
-    if ( new_attribs )
-        SFAT_SetConfig(new_attribs);
 }
 
 //-------------------------------------------------------------------------
@@ -248,7 +247,8 @@ public:
 
     bool attentive();
     bool execute(AnalyzerCommand);
-    void swap(Swapper*);
+    bool queue(AnalyzerCommand);
+    void swap(Swapper*, unsigned epoch);
 
 private:
     std::thread* athread;
@@ -264,7 +264,7 @@ void Pig::start()
 {
     if (!athread)
     {
-        Swapper* ps = new Swapper(snort_conf, SFAT_GetConfig());
+        Swapper* ps = new Swapper(snort_conf);
         LogMessage("++ [%u] %s\n", idx, analyzer->get_source());
         athread = new std::thread(std::ref(*analyzer), ps);
     }
@@ -277,7 +277,7 @@ void Pig::stop()
         if (athread)
         {
             if (analyzer->get_state() != Analyzer::State::STOPPED)
-                execute(AC_STOP);
+                queue(AC_STOP);
 
             athread->join();
             delete athread;
@@ -293,7 +293,7 @@ void Pig::stop()
 
 bool Pig::attentive()
 {
-    return analyzer && athread && analyzer->get_current_command() == AC_NONE;
+    return analyzer && athread && !analyzer->busy();
 }
 
 bool Pig::execute(AnalyzerCommand ac)
@@ -301,39 +301,93 @@ bool Pig::execute(AnalyzerCommand ac)
     if (attentive())
     {
         DebugFormat(DEBUG_ANALYZER, "[%u] Executing command %s\n", idx, Analyzer::get_command_string(ac));
-        analyzer->execute(ac);
-        return true;
+        return analyzer->execute(ac);
     }
     return false;
 }
 
-void Pig::swap(Swapper* ps)
+bool Pig::queue(AnalyzerCommand ac)
+{
+    if (analyzer && athread)
+    {
+        DebugFormat(DEBUG_ANALYZER, "[%u] Queueing command %s\n", idx, Analyzer::get_command_string(ac));
+        return analyzer->execute(ac);
+    }
+    return false;
+}
+
+void Pig::swap(Swapper* ps, unsigned epoch)
 {
     if ( !analyzer )
         return;
 
-    analyzer->set_config(ps);
-    analyzer->execute(AC_SWAP);
+    analyzer->publish(ps, epoch);
 }
 
 static Pig* pigs = nullptr;
 static unsigned max_pigs = 0;
 
+// each swap gets a new epoch; the swapper is deleted by check_response()
+// once every pig has passed it
+static unsigned swap_epoch = 0;
+
+static void publish(Swapper* ps)
+{
+    swapper = ps;
+    ++swap_epoch;
+
+    for ( unsigned idx = 0; idx < max_pigs; ++idx )
+        pigs[idx].swap(swapper, swap_epoch);
+}
+
 //-------------------------------------------------------------------------
 // main commands
 //-------------------------------------------------------------------------
 
+// number of pigs yet to complete each broadcast command; the shell returns
+// right away and the completion is reported by check_commands()
+static unsigned outstanding[AC_MAX + 1] = { };
+
 static void broadcast(AnalyzerCommand ac)
 {
-    // FIXIT-H X - Broadcast should either wait for all pigs to be attentive
-    //              or queue commands for later processing.
+    // commands are queued so pigs busy with a prior command get this one next
     for (unsigned idx = 0; idx < max_pigs; ++idx)
-        pigs[idx].execute(ac);
+    {
+        if ( pigs[idx].queue(ac) )
+            outstanding[ac]++;
+    }
 }
 
 int main_dump_stats(lua_State*)
 {
-    DropStats();
+    // module counts are merged when threads exit so show a live snapshot
+    if ( max_pigs )
+        ModuleManager::dump_live_stats();
+    else
+        DropStats();
+    return 0;
+}
+
+// this only reads the counts so it doesn't stop or wait for the pigs
+int main_dump_stats_json(lua_State*)
+{
+    string s;
+    ModuleManager::get_live_stats_json(s);
+    s += "\n";
+    request.respond(s.c_str());
+    return 0;
+}
+
+// shows the sites by change since the last dump and takes a new snapshot
+int main_dump_heap(lua_State*)
+{
+    const ProfilerConfig* config = SnortConfig::get_profiler();
+
+    if ( !MemorySampler::show(config->memory.sites, true) )
+        request.respond("== memory sampling is off\n");
+    else
+        request.respond("== heap sites logged\n");
+
     return 0;
 }
 
@@ -344,9 +398,24 @@ int main_rotate_stats(lua_State*)
     return 0;
 }
 
+// the new config is built on a background thread with the reload
+// affinity and priority from process.reload so parsing and compiling
+// don't compete with the packet threads; check_reload() swaps it in
+static future<SnortConfig*> reload_build;
+static bool reload_building = false;
+
+static SnortConfig* build_reload(string fname)
+{
+    ThreadConfig* tc = snort_conf->thread_config;
+    tc->implement_thread_affinity(STHREAD_TYPE_RELOAD, 0);
+    tc->implement_reload_priority();
+
+    return Snort::get_reload_config(fname.empty() ? nullptr : fname.c_str());
+}
+
 int main_reload_config(lua_State* L)
 {
-    if ( swapper )
+    if ( swapper or reload_building )
     {
         request.respond("== reload pending; retry\n");
         return 0;
@@ -360,35 +429,25 @@ int main_reload_config(lua_State* L)
     }
 
     request.respond(".. reloading configuration\n");
-    SnortConfig* old = snort_conf;
-    SnortConfig* sc = Snort::get_reload_config(fname);
-
-    if ( !sc )
-    {
-        request.respond("== reload failed\n");
-        return 0;
-    }
-    request.respond(".. swapping configuration\n");
-    snort_conf = sc;
-    proc_stats.conf_reloads++;
-
-    swapper = new Swapper(old, sc);
-
-    for ( unsigned idx = 0; idx < max_pigs; ++idx )
-        pigs[idx].swap(swapper);
+    reload_build = async(launch::async, build_reload, string(fname ? fname : ""));
+    reload_building = true;
 
     return 0;
 }
 
+// packet threads pick up the new table on their own so this doesn't wait
+// for or block a config swap
 int main_reload_hosts(lua_State* L)
 {
-    if ( swapper )
+    Lua::ManageStack(L, 1);
+    const char* fname = luaL_checkstring(L, 1);
+
+    // the builder may be using the modules
+    if ( reload_building )
     {
         request.respond("== reload pending; retry\n");
         return 0;
     }
-    Lua::ManageStack(L, 1);
-    const char* fname = luaL_checkstring(L, 1);
 
     if ( fname and *fname )
         request.respond(".. reloading hosts table\n");
@@ -401,18 +460,12 @@ int main_reload_hosts(lua_State* L)
     Shell sh = Shell(fname);
     sh.configure(snort_conf);
 
-    tTargetBasedConfig* old = SFAT_GetConfig();
-    tTargetBasedConfig* tc = SFAT_Swap();
-
-    if ( !tc )
+    if ( !SFAT_Swap() )
     {
         request.respond("== reload failed\n");
         return 0;
     }
-    swapper = new Swapper(old, tc);
-
-    for ( unsigned idx = 0; idx < max_pigs; ++idx )
-        pigs[idx].swap(swapper);
+    request.respond("== hosts table published\n");
 
     return 0;
 }
@@ -547,6 +600,8 @@ static bool house_keeping()
 
     InspectorManager::empty_trash();
 
+    SFAT_Reclaim();
+
     return false;
 }
 
@@ -698,6 +753,29 @@ static bool service_users()
 
 #endif
 
+static bool check_commands()
+{
+    bool done = false;
+
+    for ( unsigned idx = 0; idx < max_pigs; ++idx )
+    {
+        AnalyzerCommand ac;
+
+        if ( !pigs[idx].analyzer )
+            continue;
+
+        while ( pigs[idx].analyzer->get_response(ac) )
+        {
+            if ( !outstanding[ac] or --outstanding[ac] )
+                continue;
+
+            LogMessage("== %s complete\n", Analyzer::get_command_string(ac));
+            done = true;
+        }
+    }
+    return done;
+}
+
 static bool check_response()
 {
     if ( !swapper )
@@ -709,13 +787,75 @@ static bool check_response()
             return false;
     }
 
+    bool reload = swapper->is_reload();
+
     delete swapper;
     swapper = nullptr;
 
-    LogMessage("== reload complete\n");
+    if ( reload )
+        LogMessage("== reload complete\n");
+
     return true;
 }
 
+// a reload is published only when it is complete and no other swap is
+// pending so that the packet threads see one swap at a time
+static bool check_reload()
+{
+    if ( !reload_building or swapper )
+        return false;
+
+    if ( reload_build.wait_for(chrono::seconds(0)) != future_status::ready )
+        return false;
+
+    reload_building = false;
+    SnortConfig* sc = reload_build.get();
+
+    if ( !sc )
+    {
+        LogMessage("== reload failed\n");
+        return true;
+    }
+    LogMessage(".. swapping configuration\n");
+    SnortConfig* old = snort_conf;
+    snort_conf = sc;
+    proc_stats.conf_reloads++;
+
+    publish(new Swapper(old, sc));
+
+    return true;
+}
+
+// a build still running at exit is finished and dropped so it doesn't
+// outlive the running config
+static void abort_reload()
+{
+    if ( !reload_building )
+        return;
+
+    reload_building = false;
+    delete reload_build.get();
+}
+
+static void reorder_rules(void*)
+{
+    if ( swapper or reload_building )
+        return;
+
+    for ( unsigned idx = 0; idx < max_pigs; ++idx )
+    {
+        if ( pigs[idx].analyzer and !pigs[idx].attentive() )
+            return;
+    }
+
+    DotTrash* trash = detection_option_tree_reorder(snort_conf->detection_option_tree_hash_table);
+
+    if ( !trash )
+        return;
+
+    publish(new Swapper(trash));
+}
+
 static void service_check()
 {
 #ifdef SHELL
@@ -726,6 +866,12 @@ static void service_check()
     if ( check_response() )
         return;
 
+    if ( check_reload() )
+        return;
+
+    if ( check_commands() )
+        return;
+
     if ( house_keeping() )
         return;
 
@@ -830,6 +976,12 @@ static void main_loop()
         for (swine = 0; swine < max_pigs; swine++)
             pigs[swine].prep(SFDAQ::get_input_spec(snort_conf, idx));
     }
+    // or when every pig replays its share of all the pcaps
+    else if (const char* src = PcapBench::get_split_source())
+    {
+        for (swine = 0; swine < max_pigs; swine++)
+            pigs[swine].prep(src);
+    }
 
     // Iterate over the drove, spawn them as allowed, and handle their deaths.
     // FIXIT-L X - If an exit has been requested, we might want to have some mechanism
@@ -926,7 +1078,14 @@ static void snort_main()
     if ( SnortConfig::log_verbose() )
         memory::MemoryCap::print();
 
+    MemorySampler::init(SnortConfig::get_profiler()->memory);
+
+    // main loop ticks are nominally 1 ms
+    if ( unsigned sec = snort_conf->reorder_interval )
+        Periodic::register_handler(reorder_rules, nullptr, 0, sec * 1000);
+
     main_loop();
+    abort_reload();
 
     for (unsigned idx = 0; idx < max_pigs; idx++)
     {
@@ -31,6 +31,8 @@ const char* get_prompt();
 
 // commands provided by the snort module
 int main_dump_stats(lua_State* = nullptr);
+int main_dump_stats_json(lua_State* = nullptr);
+int main_dump_heap(lua_State* = nullptr);
 int main_rotate_stats(lua_State* = nullptr);
 int main_reload_config(lua_State* = nullptr);
 int main_reload_hosts(lua_State* = nullptr);
@@ -25,12 +25,16 @@
 using namespace std;
 
 #include "snort.h"
+#include "snort_config.h"
 #include "snort_debug.h"
 #include "thread.h"
 #include "helpers/swapper.h"
 #include "log/messages.h"
 #include "memory/memory_cap.h"
+#include "packet_io/pcap_bench.h"
 #include "packet_io/sfdaq.h"
+#include "packet_io/sfdaq_config.h"
+#include "utils/stats.h"
 
 typedef DAQ_Verdict
 (* PacketCallback)(void*, const DAQ_PktHdr_t*, const uint8_t*);
@@ -92,23 +96,24 @@ const char* Analyzer::get_command_string(AnalyzerCommand ac)
 
         case AC_ROTATE:
             return "ROTATE";
-
-        case AC_SWAP:
-            return "SWAP";
     }
 
     return "UNRECOGNIZED";
 }
 
-Analyzer::Analyzer(unsigned i, const char* s)
+Analyzer::Analyzer(unsigned i, const char* s) : commands(16), responses(16)
 {
     state = State::NEW;
     count = 0;
     id = i;
     source = s;
     command = AC_NONE;
+    pending = 0;
     swap = nullptr;
+    target = 0;
+    passed = 0;
     daq_instance = nullptr;
+    bench = nullptr;
     privileged_start = false;
 }
 
@@ -125,8 +130,17 @@ void Analyzer::operator()(Swapper* ps)
         privileged_start = daq_instance->can_start_unprivileged();
         state = State::INITIALIZED;
 
+        if ( SnortConfig::pcap_bench_mode() )
+            bench = new PcapBench(source);
+
         analyze();
 
+        if ( bench )
+        {
+            bench->term();
+            delete bench;
+            bench = nullptr;
+        }
         Snort::thread_term();
     }
 
@@ -136,17 +150,70 @@ void Analyzer::operator()(Swapper* ps)
 
 /* Note: This will be called from the main thread.  Everything it does must be
     thread-safe in relation to interactions with the analyzer thread. */
-void Analyzer::execute(AnalyzerCommand ac)
+bool Analyzer::execute(AnalyzerCommand ac)
 {
-    /* Nobody should be sending a command while we are still processing one. */
-    assert(command == AC_NONE);
+    pending++;
 
-    command = ac;
+    if (!commands.put(ac))
+    {
+        pending--;
+        return false;
+    }
 
     /* Break out of the DAQ acquire loop so that the command will be processed.
         This is explicitly safe to call from another thread. */
     if (daq_instance)
         daq_instance->break_loop(0);
+
+    return true;
+}
+
+/* Note: This will be called from the main thread.  The epoch is stored before
+    the swapper is released so the packet thread sees the matching epoch. */
+void Analyzer::publish(Swapper* ps, unsigned epoch)
+{
+    target.store(epoch, std::memory_order_relaxed);
+    swap.store(ps, std::memory_order_release);
+
+    // only needed to wake a thread waiting in acquire on a quiet interface;
+    // busy threads pick up the config at the end of the current burst
+    if (daq_instance)
+        daq_instance->break_loop(0);
+}
+
+// Apply any newly published config between packets.  This is the only
+// place the packet thread touches the swapper so once passed is updated the
+// main thread may free whatever it replaced.
+void Analyzer::pick_up_config()
+{
+    Swapper* ps = swap.exchange(nullptr, std::memory_order_acquire);
+
+    if (!ps)
+        return;
+
+    ps->apply();
+    passed.store(target.load(std::memory_order_relaxed), std::memory_order_release);
+}
+
+// Handle everything queued so far.  Returns false if the analyzer should exit.
+bool Analyzer::handle_commands()
+{
+    AnalyzerCommand ac;
+
+    while (commands.get(ac))
+    {
+        command = ac;
+        bool ok = handle_command();
+
+        // the ring holds as many as can be queued so this won't drop unless
+        // the main thread stops collecting responses
+        responses.put(ac);
+        pending--;
+
+        if (!ok)
+            return false;
+    }
+    return true;
 }
 
 bool Analyzer::handle_command()
@@ -212,15 +279,6 @@ bool Analyzer::handle_command()
             command = AC_NONE;
             break;
 
-        case AC_SWAP:
-            if (swap)
-            {
-                swap->apply();
-                swap = nullptr;
-            }
-            command = AC_NONE;
-            break;
-
         default:
             command = AC_NONE;
             break;
@@ -230,11 +288,16 @@ bool Analyzer::handle_command()
 
 void Analyzer::analyze()
 {
+    const unsigned burst = snort_conf->daq_config->burst_size;
+
     // The main analyzer loop is terminated by a command returning false or an error during acquire
     while (true)
     {
-        if (!handle_command())
+        if (!handle_commands())
             break;
+
+        pick_up_config();
+
         // If we're not in the running state (usually either pre-start or paused),
         // just keep stalling until something else comes up.
         if (state != State::RUNNING)
@@ -243,14 +306,20 @@ void Analyzer::analyze()
             this_thread::sleep_for(ms);
             continue;
         }
-        if (daq_instance->acquire(0, main_func))
+        PegCount start = pc.total_from_daq;
+
+        // the bench replays from memory instead of reading from the daq
+        if (bench ? bench->replay(burst, main_func) : daq_instance->acquire(burst, main_func))
             break;
 
+        Snort::thread_burst();
+
         // FIXIT-L acquire(0) makes idle processing unlikely under high traffic
-        // because it won't return until no packets, signal, etc.  that means
-        // the idle processing may not be useful or that we need a hook to do
-        // things periodically even when traffic is available
-        Snort::thread_idle();
+        // because it won't return until no packets, signal, etc.  with a
+        // burst size we return after each burst and only idle when the
+        // burst comes up short
+        if (!burst || pc.total_from_daq - start < burst)
+            Snort::thread_idle();
     }
 }
 
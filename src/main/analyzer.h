@@ -22,8 +22,17 @@
 
 // Analyzer provides the packet acquisition and processing loop.  Since it
 // runs in a different thread, it also provides a command facility so that
-// to control the thread and swap configuration.
+// to control the thread.
+//
+// Configuration swaps don't go through the command queue.  The main thread
+// publishes a Swapper tagged with an epoch and the packet thread applies it
+// at the next burst boundary and then records the epoch as passed.  Once
+// every thread has passed the epoch nothing can reference the old config
+// and the main thread retires it.
+
+#include <atomic>
 
+#include "helpers/atomic_ring.h"
 #include "main/snort_types.h"
 
 enum AnalyzerCommand
@@ -35,10 +44,10 @@ enum AnalyzerCommand
     AC_PAUSE,
     AC_RESUME,
     AC_ROTATE,
-    AC_SWAP,
-    AC_MAX = AC_SWAP
+    AC_MAX = AC_ROTATE
 };
 
+class PcapBench;
 class Swapper;
 class SFDAQInstance;
 
@@ -62,29 +71,49 @@ public:
     uint64_t get_count() { return count; }
     const char* get_source() { return source; }
 
-    // FIXIT-M add asynchronous response too
     AnalyzerCommand get_current_command() { return command; }
-    void execute(AnalyzerCommand);
+    bool execute(AnalyzerCommand);
+    bool busy() { return pending > 0; }
+
+    // main thread; returns the next command the packet thread completed
+    bool get_response(AnalyzerCommand& ac) { return responses.get(ac); }
+
+    // main thread; ps is applied by the packet thread and owned by the caller
+    void publish(Swapper* ps, unsigned epoch);
+
+    bool swap_pending()
+    { return passed.load(std::memory_order_acquire) != target.load(std::memory_order_relaxed); }
 
-    void set_config(Swapper* ps) { swap = ps; }
-    bool swap_pending() { return command == AC_SWAP; }
     bool requires_privileged_start() { return privileged_start; }
 
     static const char* get_command_string(AnalyzerCommand ac);
 
 private:
     void analyze();
+    bool handle_commands();
     bool handle_command();
+    void pick_up_config();
 
 private:
+    // commands are queued by the main thread and drained here once per
+    // burst; completions go back the other way
+    SpscRing<AnalyzerCommand> commands;
+    SpscRing<AnalyzerCommand> responses;
+    std::atomic<unsigned> pending;
+
+    // config publication; see above
+    std::atomic<Swapper*> swap;
+    std::atomic<unsigned> target;
+    std::atomic<unsigned> passed;
+
     volatile State state;
     volatile AnalyzerCommand command;
     volatile bool privileged_start;
     uint64_t count;
     unsigned id;
     const char* source;
-    Swapper* swap;
     SFDAQInstance* daq_instance;
+    PcapBench* bench;
 };
 
 #endif
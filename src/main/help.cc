@@ -149,7 +149,7 @@ enum HelpType
 {
     HT_CFG, HT_CMD, HT_GID, HT_IPS, HT_MOD,
     HT_BUF, HT_LST, HT_PLG, HT_DDR, HT_DBR,
-    HT_HMO, HT_HPL, HT_DFL, HT_PEG
+    HT_HMO, HT_HPL, HT_DFL, HT_PEG, HT_MAN
 };
 
 NORETURN static void show_help(SnortConfig* sc, const char* val, HelpType ht)
@@ -203,6 +203,9 @@ NORETURN static void show_help(SnortConfig* sc, const char* val, HelpType ht)
     case HT_PEG:
         ModuleManager::show_pegs(val);
         break;
+    case HT_MAN:
+        PluginManager::dump_manifest();
+        break;
     }
     ModuleManager::term();
     PluginManager::release_plugins();
@@ -281,6 +284,11 @@ NORETURN void dump_dynamic_rules(SnortConfig* sc, const char* val)
     show_help(sc, val, HT_DDR);
 }
 
+NORETURN void dump_plugin_manifest(SnortConfig* sc, const char* val)
+{
+    show_help(sc, val, HT_MAN);
+}
+
 NORETURN void help_counts(SnortConfig* sc, const char* val)
 {
     show_help(sc, val, HT_PEG);
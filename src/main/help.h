@@ -51,6 +51,7 @@ void list_daqs(SnortConfig* sc);
 void dump_defaults(SnortConfig* sc, const char*);
 void dump_builtin_rules(SnortConfig* sc, const char*);
 void dump_dynamic_rules(SnortConfig* sc, const char*);
+void dump_plugin_manifest(SnortConfig* sc, const char*);
 void dump_rule_hex(SnortConfig* sc, const char*);
 void dump_rule_text(SnortConfig* sc, const char*);
 void dump_version(SnortConfig* sc);
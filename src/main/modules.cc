@@ -24,6 +24,8 @@
 #include "config.h"
 #endif
 
+#include <string>
+
 #include "snort_config.h"
 #include "snort_module.h"
 #include "thread_config.h"
@@ -78,6 +80,15 @@ static const Parameter detection_params[] =
     { "pcre_match_limit_recursion", Parameter::PT_INT, "-1:10000", "1500",
       "limit pcre stack consumption, -1 = max, 0 = off" },
 
+    { "pcre_jit_stack", Parameter::PT_INT, "32:1048576", "1024",
+      "maximum pcre2 jit stack per packet thread in KiB (pcre2 builds only)" },
+
+    { "reorder_interval", Parameter::PT_INT, "0:", "0",
+      "seconds between reordering rule option siblings by observed cost and pass rate, 0 = off" },
+
+    { "prefilter", Parameter::PT_BOOL, nullptr, "false",
+      "whitelist tcp and udp ports no rule, binding, or inspector can match" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 /* *INDENT-ON* */
@@ -109,6 +120,15 @@ bool DetectionModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("pcre_match_limit_recursion") )
         sc->pcre_match_limit_recursion = v.get_long();
 
+    else if ( v.is("pcre_jit_stack") )
+        sc->pcre_jit_stack = v.get_long();
+
+    else if ( v.is("reorder_interval") )
+        sc->reorder_interval = v.get_long();
+
+    else if ( v.is("prefilter") )
+        sc->port_prefilter = v.get_bool();
+
     else
         return false;
 
@@ -187,16 +207,44 @@ bool EventQueueModule::set(const char*, Value& v, SnortConfig* sc)
 //-------------------------------------------------------------------------
 
 function<const char*()> get_search_methods = []()
-{ return PluginManager::get_available_plugins(PT_SEARCH_ENGINE); };
+{
+    static std::string s;
+    s = PluginManager::get_available_plugins(PT_SEARCH_ENGINE);
+    s += " | auto";
+    return s.c_str();
+};
 
 static const Parameter search_engine_params[] =
 {
+    { "auto_large_min", Parameter::PT_INT, "1:", "1000",
+      "with search_method = auto, use hyperscan (if available) for groups with at least this many patterns" },
+
+    { "auto_literal_max", Parameter::PT_INT, "0:", "4",
+      "with search_method = auto, use brute force literal search for groups with at most this many patterns" },
+
+    { "batch_search", Parameter::PT_BOOL, nullptr, "false",
+      "defer fast pattern searches until all rule groups for a packet are selected "
+      "and search each state machine once for all its buffers" },
+
+    { "bench", Parameter::PT_STRING, nullptr, nullptr,
+      "run every search engine over the fast pattern sets and this corpus of captured buffers, then exit" },
+
     { "bleedover_port_limit", Parameter::PT_INT, "1:", "1024",
       "maximum ports in rule before demotion to any-any port group" },
 
     { "bleedover_warnings_enabled", Parameter::PT_BOOL, nullptr, "false",
       "print warning if a rule is demoted to any-any port group" },
 
+    { "cache_dir", Parameter::PT_STRING, nullptr, nullptr,
+      "directory for compiled state machine snapshots reused across restarts "
+      "when patterns and options are unchanged (ac_bnfa and hyperscan)" },
+
+    { "capture_buffers", Parameter::PT_INT, "0:", "0",
+      "write up to this many searched buffers per type and thread to mpse_buffers for bench" },
+
+    { "compile_threads", Parameter::PT_INT, "0:", "0",
+      "number of threads used to compile port group state machines (0 means main thread only)" },
+
     { "enable_single_rule_group", Parameter::PT_BOOL, nullptr, "false",
       "put all rules into one group" },
 
@@ -228,7 +276,7 @@ static const Parameter search_engine_params[] =
       "inspect reassembled payload - disabling is good for performance, bad for detection" },
 
     { "search_method", Parameter::PT_DYNAMIC, (void*)&get_search_methods, "ac_bnfa",
-      "set fast pattern algorithm - choose available search engine" },
+      "set fast pattern algorithm - choose available search engine or auto to choose per group" },
 
     { "split_any_any", Parameter::PT_BOOL, nullptr, "false",
       "evaluate any-any rules separately to save memory" },
@@ -250,8 +298,13 @@ const PegInfo mpse_pegs[] =
     { "total flushed", "fast pattern matches discarded due to overflow" },
     { "total inserts", "total fast pattern hits" },
     { "total unique", "total unique fast pattern hits" },
+    { "total dups", "duplicate fast pattern hits dropped before evaluation" },
+    { "max capacity", "maximum match queue capacity reached by adaptive sizing" },
     { "non-qualified events", "total non-qualified events" },
     { "qualified events", "total qualified events" },
+    { "batched searches", "fast pattern searches deferred to a batch" },
+    { "batch flushes", "multi-buffer searches performed for batches" },
+    { "async searches", "batch groups submitted to engines that search asynchronously" },
     { nullptr, nullptr }
 };
 
@@ -272,7 +325,18 @@ bool SearchEngineModule::set(const char*, Value& v, SnortConfig* sc)
 {
     FastPatternConfig* fp = sc->fast_pattern_config;
 
-    if ( v.is("bleedover_port_limit") )
+    if ( v.is("batch_search") )
+        fp->set_batch_search(v.get_bool());
+
+    else if ( v.is("bench") )
+    {
+        fp->set_bench_corpus(v.get_string());
+
+        if ( fp->get_bench_corpus() )
+            sc->run_flags |= RUN_FLAG__TEST;
+    }
+
+    else if ( v.is("bleedover_port_limit") )
         fp->set_bleed_over_port_limit(v.get_long());
 
     else if ( v.is("bleedover_warnings_enabled") )
@@ -280,6 +344,15 @@ bool SearchEngineModule::set(const char*, Value& v, SnortConfig* sc)
         if ( v.get_bool() )
             fp->set_bleed_over_warnings();  // FIXIT-L these should take arg
     }
+    else if ( v.is("cache_dir") )
+        fp->set_cache_dir(v.get_string());
+
+    else if ( v.is("capture_buffers") )
+        fp->set_capture_buffers(v.get_long());
+
+    else if ( v.is("compile_threads") )
+        fp->set_compile_threads(v.get_long());
+
     else if ( v.is("enable_single_rule_group") )
     {
         if ( v.get_bool() )
@@ -322,6 +395,12 @@ bool SearchEngineModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("inspect_stream_inserts") )
         fp->set_stream_insert(v.get_bool());
 
+    else if ( v.is("auto_large_min") )
+        fp->set_auto_large_min(v.get_long());
+
+    else if ( v.is("auto_literal_max") )
+        fp->set_auto_literal_max(v.get_long());
+
     else if ( v.is("search_method") )
     {
         if ( !fp->set_detect_search_method(v.get_string()) )
@@ -358,6 +437,12 @@ static const Parameter profiler_time_params[] =
     { "max_depth", Parameter::PT_INT, "-1:", "-1",
       "limit depth to max_depth (-1 = no limit)" },
 
+    { "sample", Parameter::PT_INT, "1:", "1",
+      "time only 1 in sample packets and scale up the results (1 = all packets)" },
+
+    { "sample_flows", Parameter::PT_BOOL, nullptr, "false",
+      "sample whole flows instead of individual packets" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -376,6 +461,12 @@ static const Parameter profiler_memory_params[] =
     { "max_depth", Parameter::PT_INT, "-1:", "-1",
       "limit depth to max_depth (-1 = no limit)" },
 
+    { "sample", Parameter::PT_INT, "0:", "0",
+      "record the call stack of about 1 in sample bytes allocated by packet threads (0 = off)" },
+
+    { "sites", Parameter::PT_INT, "0:", "10",
+      "number of sampled allocation sites to show by live bytes and by churn (0 = all)" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -389,8 +480,11 @@ static const Parameter profiler_rule_params[] =
 
     { "sort", Parameter::PT_ENUM,
       "none | checks | avg_check | total_time | matches | no_matches | "
-      "avg_match | avg_no_match",
-      "total_time", "sort by given field" },
+      "avg_match | avg_no_match | p99",
+      "total_time", "sort by given field (p99 requires histograms)" },
+
+    { "histograms", Parameter::PT_BOOL, nullptr, "false",
+      "keep per rule latency histograms and show p50, p99, p99.9 and max" },
 
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
@@ -406,6 +500,9 @@ static const Parameter profiler_params[] =  // FIXIT-L add help
     { "rules", Parameter::PT_TABLE, profiler_rule_params, nullptr,
       "rule time profiling" },
 
+    { "counters", Parameter::PT_BOOL, nullptr, "false",
+      "count cycles, instructions, cache and branch misses per module and rule (linux only)" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -419,6 +516,49 @@ static bool s_profiler_module_set_max_depth(T& config, Value& v)
 static bool s_profiler_module_set_max_depth(RuleProfilerConfig&, Value&)
 { return false; }
 
+template<typename T>
+static bool s_profiler_module_set_extra(T&, Value&)
+{ return false; }
+
+static bool s_profiler_module_set_extra(RuleProfilerConfig& config, Value& v)
+{
+    if ( v.is("histograms") )
+        config.histograms = v.get_bool();
+
+    else
+        return false;
+
+    return true;
+}
+
+static bool s_profiler_module_set_extra(TimeProfilerConfig& config, Value& v)
+{
+    if ( v.is("sample") )
+        config.sample = v.get_long();
+
+    else if ( v.is("sample_flows") )
+        config.sample_flows = v.get_bool();
+
+    else
+        return false;
+
+    return true;
+}
+
+static bool s_profiler_module_set_extra(MemoryProfilerConfig& config, Value& v)
+{
+    if ( v.is("sample") )
+        config.sample = v.get_long();
+
+    else if ( v.is("sites") )
+        config.sites = v.get_long();
+
+    else
+        return false;
+
+    return true;
+}
+
 template<typename T>
 static bool s_profiler_module_set(T& config, Value& v)
 {
@@ -435,7 +575,7 @@ static bool s_profiler_module_set(T& config, Value& v)
         return s_profiler_module_set_max_depth(config, v);
 
     else
-        return false;
+        return s_profiler_module_set_extra(config, v);
 
     return true;
 }
@@ -462,7 +602,13 @@ bool ProfilerModule::set(const char* fqn, Value& v, SnortConfig* sc)
     else if ( !strncmp(fqn, spr, strlen(spr)) )
         return s_profiler_module_set(sc->profiler->rule, v);
 
-    return false;
+    else if ( v.is("counters") )
+        sc->profiler->counters = v.get_bool();
+
+    else
+        return false;
+
+    return true;
 }
 
 //-------------------------------------------------------------------------
@@ -797,6 +943,9 @@ static const Parameter active_params[] =
     { "attempts", Parameter::PT_INT, "0:20", "0",
       "number of TCP packets sent per response (with varying sequence numbers)" },
 
+    { "burst_limit", Parameter::PT_INT, "0:65535", "0",
+      "maximum packets injected per DAQ burst (0 is unlimited; needs daq.burst)" },
+
     { "device", Parameter::PT_STRING, nullptr, nullptr,
       "use 'ip' for network layer responses or 'eth0' etc for link layer" },
 
@@ -827,6 +976,9 @@ bool ActiveModule::set(const char*, Value& v, SnortConfig* sc)
     if ( v.is("attempts") )
         sc->respond_attempts = v.get_long();
 
+    else if ( v.is("burst_limit") )
+        sc->respond_burst_limit = v.get_long();
+
     else if ( v.is("device") )
         sc->respond_device = v.get_string();
 
@@ -909,6 +1061,9 @@ bool PacketsModule::set(const char*, Value& v, SnortConfig* sc)
 
 static const Parameter attribute_table_params[] =
 {
+    { "lookup_table", Parameter::PT_ENUM, "dir | poptrie", "dir",
+      "host lookup structure; poptrie uses less memory for sparse or IPv6 heavy tables" },
+
     { "max_hosts", Parameter::PT_INT, "32:207551", "1024",
       "maximum number of hosts in attribute table" },
 
@@ -934,7 +1089,10 @@ public:
 
 bool AttributeTableModule::set(const char*, Value& v, SnortConfig* sc)
 {
-    if ( v.is("max_hosts") )
+    if ( v.is("lookup_table") )
+        sc->attribute_poptrie = v.get_long() == 1;
+
+    else if ( v.is("max_hosts") )
         sc->max_attribute_hosts = v.get_long();
 
     else if ( v.is("max_services_per_host") )
@@ -963,9 +1121,20 @@ static const Parameter network_params[] =
       "all | ip | noip | tcp | notcp | udp | noudp | icmp | noicmp | none", "none",
       "checksums to verify" },
 
+    { "checksum_offload", Parameter::PT_BOOL, nullptr, "false",
+      "skip tcp checksum verification when the daq reports the nic already did it" },
+
     { "decode_drops", Parameter::PT_BOOL, nullptr, "false",
       "enable dropping of packets by the decoder" },
 
+    { "elephant_bytes", Parameter::PT_INT, "0:", "0",
+      "offload flows with more payload than this to the daq if they have "
+      "no alerts, flowbits, or files (0 is disabled)" },
+
+    { "elephant_rate", Parameter::PT_INT, "0:", "0",
+      "offload flows with a payload rate above this many bytes per second "
+      "to the daq if they have no alerts, flowbits, or files (0 is disabled)" },
+
     { "id", Parameter::PT_INT, "0:65535", "0",
       "correlate unified2 events with configuration" },
 
@@ -1010,9 +1179,18 @@ bool NetworkModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("checksum_eval") )
         ConfigChecksumMode(sc, v.get_string());
 
+    else if ( v.is("checksum_offload") )
+        p->checksum_offload = v.get_bool();
+
     else if ( v.is("decode_drops") )
         p->decoder_drop = v.get_bool();
 
+    else if ( v.is("elephant_bytes") )
+        p->elephant_bytes = v.get_long();
+
+    else if ( v.is("elephant_rate") )
+        p->elephant_rate = v.get_long();
+
     else if ( v.is("id") )
         p->user_policy_id = v.get_long();
 
@@ -1112,6 +1290,23 @@ static const Parameter thread_pinning_params[] =
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
+static const Parameter reload_builder_params[] =
+{
+    { "cpuset", Parameter::PT_STRING, nullptr, nullptr,
+      "pin the reload builder to this cpuset, ideally away from the packet threads" },
+
+    { "nice", Parameter::PT_INT, "0:19", "10",
+      "nice value of the reload builder" },
+
+    { "idle", Parameter::PT_BOOL, nullptr, "false",
+      "run the reload builder as SCHED_IDLE instead of nice" },
+
+    { "compile_threads", Parameter::PT_INT, "0:", "0",
+      "maximum fast pattern compile threads during reload (0 means no cap)" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
 static const Parameter process_params[] =
 {
     { "chroot", Parameter::PT_STRING, nullptr, nullptr,
@@ -1120,6 +1315,9 @@ static const Parameter process_params[] =
     { "threads", Parameter::PT_LIST, thread_pinning_params, nullptr,
       "thread pinning parameters" },
 
+    { "reload", Parameter::PT_TABLE, reload_builder_params, nullptr,
+      "reload configs are built on a background thread with these settings" },
+
     { "daemon", Parameter::PT_BOOL, nullptr, "false",
       "fork as a daemon (same as -D)" },
 
@@ -1155,10 +1353,41 @@ public:
 private:
     int thread;
     CpuSet* cpuset;
+
+    int reload_nice;
+    bool reload_idle;
 };
 
-bool ProcessModule::set(const char*, Value& v, SnortConfig* sc)
+static const char* reload_builder = "process.reload";
+
+bool ProcessModule::set(const char* fqn, Value& v, SnortConfig* sc)
 {
+    if ( !strncmp(fqn, reload_builder, strlen(reload_builder)) )
+    {
+        if ( v.is("cpuset") )
+        {
+            CpuSet* cs = ThreadConfig::validate_cpuset_string(v.get_string());
+
+            if ( !cs )
+                return false;
+
+            sc->thread_config->set_thread_affinity(STHREAD_TYPE_RELOAD, 0, cs);
+        }
+        else if ( v.is("nice") )
+            reload_nice = v.get_long();
+
+        else if ( v.is("idle") )
+            reload_idle = v.get_bool();
+
+        else if ( v.is("compile_threads") )
+            sc->thread_config->set_reload_compile_threads(v.get_long());
+
+        else
+            return false;
+
+        return true;
+    }
+
     if ( v.is("daemon") )
     {
         if ( v.get_bool() )
@@ -1200,8 +1429,14 @@ bool ProcessModule::set(const char*, Value& v, SnortConfig* sc)
     return true;
 }
 
-bool ProcessModule::begin(const char*, int, SnortConfig*)
+bool ProcessModule::begin(const char* fqn, int, SnortConfig*)
 {
+    if ( !strcmp(fqn, reload_builder) )
+    {
+        reload_nice = 10;
+        reload_idle = false;
+        return true;
+    }
     thread = -1;
     cpuset = nullptr;
     return true;
@@ -1209,6 +1444,12 @@ bool ProcessModule::begin(const char*, int, SnortConfig*)
 
 bool ProcessModule::end(const char* fqn, int idx, SnortConfig* sc)
 {
+    if ( !strcmp(fqn, reload_builder) )
+    {
+        sc->thread_config->set_reload_priority(reload_nice, reload_idle);
+        return true;
+    }
+
     if ( !idx )
         return true;
 
@@ -79,7 +79,12 @@ public:
     uint32_t checksum_drop;
     uint32_t normal_mask;
 
+    // flows past either threshold are whitelisted by the daq
+    uint64_t elephant_bytes;
+    uint32_t elephant_rate;  // bytes per second
+
     bool decoder_drop;
+    bool checksum_offload;
 };
 
 //-------------------------------------------------------------------------
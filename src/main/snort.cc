@@ -35,11 +35,14 @@
 #include <netinet/in.h>
 #include <sys/stat.h>
 
+#include "control/deferred_work.h"
 #include "decompress/file_decomp.h"
 #include "detection/detect.h"
 #include "detection/detection_util.h"
+#include "detection/fp_bench.h"
 #include "detection/fp_config.h"
 #include "detection/fp_detect.h"
+#include "detection/header_match.h"
 #include "detection/tag.h"
 #include "file_api/file_service.h"
 #include "filters/detection_filter.h"
@@ -51,6 +54,7 @@
 #include "helpers/process.h"
 #include "host_tracker/host_cache.h"
 #include "ips_options/ips_flowbits.h"
+#include "latency/degrade.h"
 #include "latency/packet_latency.h"
 #include "latency/rule_latency.h"
 #include "managers/action_manager.h"
@@ -62,18 +66,21 @@
 #include "managers/mpse_manager.h"
 #include "managers/plugin_manager.h"
 #include "managers/script_manager.h"
+#include "memory/memory_cache.h"
 #include "packet_io/sfdaq.h"
 #include "packet_io/active.h"
 #include "packet_io/trough.h"
 #include "parser/cmd_line.h"
 #include "parser/parser.h"
 #include "perf_monitor/perf_monitor.h"
+#include "ports/port_prefilter.h"
 #include "profiler/profiler.h"
 #include "protocols/packet.h"
 #include "protocols/packet_manager.h"
 #include "side_channel/side_channel.h"
 #include "stream/stream.h"
 #include "target_based/sftarget_reader.h"
+#include "time/tsc_clock.h"
 #include "time/packet_time.h"
 #include "time/periodic.h"
 #include "utils/kmap.h"
@@ -196,6 +203,32 @@ static void show_source(const char* pcap)
         pcap, SFDAQ::get_snap_len());
 }
 
+// must follow InspectorManager::configure() so the binders are ready
+static void set_prefilter(SnortConfig* sc)
+{
+    if ( !sc->port_prefilter )
+        return;
+
+    PortPrefilter* pf = new PortPrefilter;
+    pf->add_rules((unsigned)PktType::TCP, sc->prmTcpRTNX);
+    pf->add_rules((unsigned)PktType::UDP, sc->prmUdpRTNX);
+
+    // the host table can put a service on any port
+    if ( SFAT_NumberOfHosts() )
+        pf->add_all((unsigned)PktType::ANY);
+    else
+        InspectorManager::get_prefilter(sc, *pf);
+
+    if ( pf->is_empty() )
+    {
+        LogMessage("port prefilter: every port is needed\n");
+        delete pf;
+        return;
+    }
+    pf->show();
+    sc->prefilter = pf;
+}
+
 //-------------------------------------------------------------------------
 // initialization
 //-------------------------------------------------------------------------
@@ -204,6 +237,9 @@ void Snort::init(int argc, char** argv)
 {
     init_signals();
 
+    // before anything takes timestamps
+    TscClock::init();
+
     ThreadConfig::init();
 
 #if defined(NOCOREFILE)
@@ -231,7 +267,7 @@ void Snort::init(int argc, char** argv)
 
     ModuleManager::init();
     ScriptManager::load_scripts(snort_cmd_line_conf->script_paths);
-    PluginManager::load_plugins(snort_cmd_line_conf->plugin_path);
+    PluginManager::load_plugins(snort_cmd_line_conf->plugin_path, true);
 
     if ( snort_conf->logging_flags & LOGGING_FLAG__SHOW_PLUGINS )
     {
@@ -278,6 +314,8 @@ void Snort::init(int argc, char** argv)
     else if ( SnortConfig::log_verbose() )
         InspectorManager::print_config(snort_conf);
 
+    set_prefilter(snort_conf);
+
     if (snort_conf->file_mask != 0)
         umask(snort_conf->file_mask);
     else
@@ -535,6 +573,8 @@ SnortConfig* Snort::get_reload_config(const char* fname)
         return NULL;
     }
 
+    set_prefilter(sc);
+
     FlowbitResetCounts();  // FIXIT-L updates global hash, put in sc
 
     if ((sc->file_mask != 0) && (sc->file_mask != snort_conf->file_mask))
@@ -599,14 +639,36 @@ void Snort::capture_packet()
     }
 }
 
+// housekeeping budgets; the idle budget just bounds the delay before we
+// go back to the DAQ
+#define BURST_WORK_USEC 25
+#define IDLE_WORK_USEC 10000
+
+// retire stale flows a handful at a time
+static bool timeout_flow_slice(void*)
+{
+    return flow_con and flow_con->timeout_flows(64, time(NULL)) > 0;
+}
+
 void Snort::thread_idle()
 {
-    if ( flow_con )
-        flow_con->timeout_flows(16384, time(NULL));
+    SFAT_Refresh();
+    DeferredWork::execute(IDLE_WORK_USEC);
     perf_monitor_idle_process();
     aux_counts.idle++;
 }
 
+// called after each DAQ burst to do work that can be amortized over
+// the packets in the burst
+void Snort::thread_burst()
+{
+    Active::end_burst();
+    EventManager::flush_outputs();
+    HighAvailabilityManager::flush();
+    SFAT_Refresh();
+    DeferredWork::execute(BURST_WORK_USEC);
+}
+
 void Snort::thread_rotate()
 {
     SetRotatePerfFileFlag();
@@ -619,6 +681,7 @@ void Snort::thread_rotate()
 bool Snort::thread_init_privileged(const char* intf)
 {
     show_source(intf);
+    SFAT_Refresh();
 
     snort_conf->thread_config->implement_thread_affinity(STHREAD_TYPE_PACKET, get_instance_id());
 
@@ -638,6 +701,7 @@ bool Snort::thread_init_privileged(const char* intf)
 void Snort::thread_init_unprivileged()
 {
     s_packet = new Packet(false);
+    Profiler::thread_init();
     CodecManager::thread_init(snort_conf);
 
     // this depends on instantiated daq capabilities
@@ -659,6 +723,8 @@ void Snort::thread_init_unprivileged()
     SideChannelManager::thread_init();
     HighAvailabilityManager::thread_init(); // must be before InspectorManager::thread_init();
     InspectorManager::thread_init(snort_conf);
+    ModuleManager::thread_register();
+    DeferredWork::register_handler(timeout_flow_slice, nullptr);
     HighAvailabilityManager::process_receive(); // in case there are HA messages waiting, process them first
 }
 
@@ -670,12 +736,18 @@ void Snort::thread_term()
     ModuleManager::accumulate(snort_conf);
     InspectorManager::thread_term(snort_conf);
     ActionManager::thread_term(snort_conf);
+    FileService::thread_term();
+    File_Decomp_Thread_Term();
 
     IpsManager::clear_options();
     EventManager::close_outputs();
+    DeferredWork::unregister_all();
     CodecManager::thread_term();
+    PacketManager::thread_term();
     HighAvailabilityManager::thread_term();
     SideChannelManager::thread_term();
+    SFAT_Release();
+    RateFilter_ThreadTerm();
 
     if ( s_packet )
     {
@@ -691,16 +763,23 @@ void Snort::thread_term()
 
     PacketLatency::tterm();
     RuleLatency::tterm();
+    Degrade::tterm();
 
     Profiler::consolidate_stats();
+    Profiler::thread_term();
 
     otnx_match_data_term();
+    header_sets_thread_term();
+    fp_capture_term();
     detection_filter_term();
     EventTrace_Term();
     CleanupTag();
 
     SnortEventqFree();
     Active::term();
+
+    // last so everything freed above is handed back
+    memory::CachingAllocator::thread_term();
 }
 
 void Snort::detect_rebuilt_packet(Packet* p)
@@ -738,6 +817,16 @@ DAQ_Verdict Snort::process_packet(
 
     set_policy(p);  // FIXIT-M should not need this here
 
+    // whitelist before any flow is created; decoder events are still logged
+    if ( snort_conf->prefilter and !is_frag and !(p->packet_flags & PKT_IGNORE) and
+        snort_conf->prefilter->skip(p) )
+    {
+        p->packet_flags |= PKT_IGNORE;
+        aux_counts.prefiltered++;
+        aux_counts.prefiltered_bytes += pkthdr->pktlen;
+        SnortEventqLog(p);
+    }
+
     /* just throw away the packet if we are configured to ignore this port */
     if ( !(p->packet_flags & PKT_IGNORE) )
     {
@@ -819,6 +908,7 @@ static DAQ_Verdict update_verdict(DAQ_Verdict verdict, int& inject)
 DAQ_Verdict Snort::packet_callback(
     void*, const DAQ_PktHdr_t* pkthdr, const uint8_t* pkt)
 {
+    Profiler::select_packet(snort_conf->profiler, pkthdr, pkt);
     Profile profile(totalPerfStats);
 
     pc.total_from_daq++;
@@ -23,8 +23,12 @@
 #include "config.h"
 #endif
 
+#include "codecs/codec_module.h"
+#include "detection/fp_bench.h"
 #include "detection/fp_config.h"
 #include "detection/fp_create.h"
+#include "detection/header_match.h"
+#include "detection/signature.h"
 #include "filters/detection_filter.h"
 #include "filters/rate_filter.h"
 #include "filters/sfrf.h"
@@ -40,6 +44,7 @@
 #include "packet_io/sfdaq_config.h"
 #include "parser/parser.h"
 #include "parser/vars.h"
+#include "ports/port_prefilter.h"
 #include "profiler/profiler.h"
 #include "sfip/sf_ip.h"
 #include "thread_config.h"
@@ -196,6 +201,7 @@ SnortConfig::~SnortConfig()
 
     FreeRuleLists(this);
     OtnLookupFree(otn_map);
+    header_sets_free(header_sets);
     PortTablesFree(port_tables);
 
     ThresholdConfigFree(threshold_config);
@@ -206,6 +212,7 @@ SnortConfig::~SnortConfig()
         EventQueueConfigFree(event_queue_config);
 
     fpDeleteFastPacketDetection(this);
+    delete prefilter;
 
     if (eth_dst )
         snort_free(eth_dst);
@@ -266,6 +273,10 @@ void SnortConfig::setup()
 
     SetRuleStates(this);
 
+    ip6_opt_checks =
+        OtnLookup(otn_map, GID_DECODE, DECODE_IPV6_BAD_OPT_TYPE) or
+        OtnLookup(otn_map, GID_DECODE, DECODE_IPV6_BAD_OPT_LEN);
+
     /* Need to do this after dynamic detection stuff is initialized, too */
     IpsManager::verify(this);
     ModuleManager::load_commands(this);
@@ -280,6 +291,11 @@ void SnortConfig::setup()
     sdpattern_setup(this);
     hyperscan_setup(this);
 #endif
+
+    // bench implies test mode so it's fine to rebuild any search engine
+    // state from here on
+    if ( fast_pattern_config->get_bench_corpus() )
+        fp_bench_run(this);
 }
 
 // merge in everything from the command line config
@@ -351,6 +367,12 @@ void SnortConfig::merge(SnortConfig* cmd_line)
     if (cmd_line->pkt_skip != 0)
         pkt_skip = cmd_line->pkt_skip;
 
+    if (cmd_line->pcap_bench != 0)
+        pcap_bench = cmd_line->pcap_bench;
+
+    if ( cmd_line->pcap_bench_split )
+        pcap_bench_split = cmd_line->pcap_bench_split;
+
     if (cmd_line->group_id != -1)
         group_id = cmd_line->group_id;
 
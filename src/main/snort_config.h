@@ -126,6 +126,7 @@ struct MemoryConfig;
 struct LatencyConfig;
 struct SFDAQConfig;
 class ThreadConfig;
+class PortPrefilter;
 
 SO_PUBLIC extern THREAD_LOCAL struct SnortConfig* snort_conf;
 
@@ -190,10 +191,14 @@ public:
     long int pcre_match_limit = 1500;
     long int pcre_match_limit_recursion = 1500;
     int pcre_ovector_size = 0;
+    unsigned pcre_jit_stack = 1024;  // KiB per packet thread
 
     int asn1_mem = 0;
     uint32_t run_flags = 0;
 
+    unsigned reorder_interval = 0;
+    bool port_prefilter = false;
+
     //------------------------------------------------------
     // process stuff
 
@@ -223,11 +228,15 @@ public:
     uint8_t max_ip6_extensions = 0;
     uint8_t max_ip_layers = 0;
 
+    // false when no rule uses the ip6 option checks so they can be skipped
+    bool ip6_opt_checks = true;
+
     //------------------------------------------------------
     // active stuff
     uint8_t respond_attempts = 0;
     uint8_t max_responses = 0;
     uint8_t min_interval = 0;
+    uint16_t respond_burst_limit = 0;
     uint8_t* eth_dst = nullptr;
 
     std::string respond_device;
@@ -238,6 +247,7 @@ public:
     uint32_t max_attribute_hosts = 0;
     uint32_t max_attribute_services_per_host = 0;
     uint32_t max_metadata_services = 0;
+    bool attribute_poptrie = false;
 
     //------------------------------------------------------
     // packet module stuff
@@ -247,6 +257,9 @@ public:
     uint64_t pkt_cnt = 0;           /* -n */
     uint64_t pkt_skip = 0;
 
+    unsigned pcap_bench = 0;        /* --pcap-bench seconds */
+    bool pcap_bench_split = false;  /* --pcap-bench-split */
+
     std::string bpf_file;          /* -F or config bpf_file */
 
     //------------------------------------------------------
@@ -285,6 +298,7 @@ public:
     struct ClassType* classifications = nullptr;
     struct ReferenceSystemNode* references = nullptr;
     struct SFGHASH* otn_map = nullptr;
+    struct HeaderSets* header_sets = nullptr;
 
     struct DetectionFilterConfig* detection_filter_config = nullptr;
 
@@ -314,6 +328,9 @@ public:
     srmm_table_t* spgmmTable = nullptr;  /* srvc port_group map master table */
     sopg_table_t* sopgTable = nullptr;   /* service-oridnal to port_group table */
 
+    // tcp and udp ports nothing cares about are whitelisted after decode
+    PortPrefilter* prefilter = nullptr;
+
     SFXHASH* detection_option_hash_table = nullptr;
     SFXHASH* detection_option_tree_hash_table = nullptr;
 
@@ -396,6 +413,9 @@ public:
     static bool read_mode()
     { return snort_conf->run_flags & RUN_FLAG__READ; }
 
+    static bool pcap_bench_mode()
+    { return snort_conf->pcap_bench != 0; }
+
     static bool inline_mode()
     { return ::get_ips_policy()->policy_mode == POLICY_MODE__INLINE; }
 
@@ -459,6 +479,10 @@ public:
     static bool tcp_checksum_drops()
     { return ::get_network_policy()->checksum_drop & CHECKSUM_FLAG__TCP; }
 
+    // trust the daq when it says the hardware verified the tcp checksum
+    static bool tcp_checksum_offload()
+    { return ::get_network_policy()->checksum_offload; }
+
     static bool icmp_checksums()
     { return ::get_network_policy()->checksum_eval & CHECKSUM_FLAG__ICMP; }
 
@@ -556,6 +580,9 @@ public:
     static uint32_t get_max_services_per_host()
     { return snort_conf->max_attribute_services_per_host; }
 
+    static bool get_attribute_poptrie()
+    { return snort_conf->attribute_poptrie; }
+
     static int get_uid()
     { return snort_conf->user_id; }
 
@@ -70,6 +70,10 @@ static const Command snort_cmds[] =
 {
     { "show_plugins", main_dump_plugins, nullptr, "show available plugins" },
     { "dump_stats", main_dump_stats, nullptr, "show summary statistics" },
+    { "dump_stats_json", main_dump_stats_json, nullptr,
+      "show live module counts and profile totals as json" },
+    { "dump_heap", main_dump_heap, nullptr,
+      "show sampled allocation sites and their changes since the last dump" },
     { "rotate_stats", main_rotate_stats, nullptr, "roll perfmonitor log files" },
     { "reload_config", main_reload_config, s_reload, "load new configuration" },
     { "reload_hosts", main_reload_hosts, s_reload, "load a new hosts table" },
@@ -291,6 +295,9 @@ static const Parameter s_params[] =
     { "--dump-defaults", Parameter::PT_STRING, "(optional)", nullptr,
       "[<module prefix>] output module defaults in Lua format" },
 
+    { "--dump-plugin-manifest", Parameter::PT_IMPLIED, nullptr, nullptr,
+      "output a plugins.manifest for the dynamic plugins found in --plugin-path" },
+
     { "--dump-version", Parameter::PT_IMPLIED, nullptr, nullptr,
       "output the version, the whole version, and only the version" },
 
@@ -372,12 +379,21 @@ static const Parameter s_params[] =
     { "--pcap-list", Parameter::PT_STRING, nullptr, nullptr,
       "<list> a space separated list of pcaps to read - read mode is implied" },
 
+    { "--pcap-bench", Parameter::PT_INT, "1:", nullptr,
+      "<seconds> replay the pcaps from memory at full speed for the given time and report throughput" },
+
+    { "--pcap-bench-split", Parameter::PT_IMPLIED, nullptr, nullptr,
+      "with --pcap-bench, split the flows in all pcaps across all packet threads" },
+
     { "--pcap-dir", Parameter::PT_STRING, nullptr, nullptr,
       "<dir> a directory to recurse to look for pcaps - read mode is implied" },
 
     { "--pcap-filter", Parameter::PT_STRING, nullptr, nullptr,
       "<filter> filter to apply when getting pcaps from file or directory" },
 
+    { "--pcap-largest-first", Parameter::PT_IMPLIED, nullptr, nullptr,
+      "read the largest pcaps first to balance work across packet threads" },
+
     { "--pcap-loop", Parameter::PT_INT, "-1:", nullptr,
       "<count> read all pcaps <count> times;  0 will read until Snort is terminated" },
 
@@ -704,6 +720,9 @@ bool SnortModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("--dump-defaults") )
         dump_defaults(sc, v.get_string());
 
+    else if ( v.is("--dump-plugin-manifest") )
+        dump_plugin_manifest(sc, v.get_string());
+
     else if ( v.is("--dump-version") )
         dump_version(sc);
 
@@ -778,6 +797,12 @@ bool SnortModule::set(const char*, Value& v, SnortConfig* sc)
         Trough::add_source(Trough::SOURCE_FILE_LIST, v.get_string());
         sc->run_flags |= RUN_FLAG__READ;
     }
+    else if ( v.is("--pcap-bench") )
+        sc->pcap_bench = v.get_long();
+
+    else if ( v.is("--pcap-bench-split") )
+        sc->pcap_bench_split = true;
+
     else if ( v.is("--pcap-dir") )
     {
         Trough::add_source(Trough::SOURCE_DIR, v.get_string());
@@ -786,6 +811,9 @@ bool SnortModule::set(const char*, Value& v, SnortConfig* sc)
     else if ( v.is("--pcap-filter") )
         Trough::set_filter(v.get_string());
 
+    else if ( v.is("--pcap-largest-first") )
+        Trough::set_largest_first(true);
+
     else if ( v.is("--pcap-loop") )
         Trough::set_loop_count(v.get_long());
 
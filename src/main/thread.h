@@ -39,7 +39,8 @@
 enum SThreadType
 {
     STHREAD_TYPE_PACKET,
-    STHREAD_TYPE_MAIN
+    STHREAD_TYPE_MAIN,
+    STHREAD_TYPE_RELOAD  // affinity only; the reload builder runs as main
 };
 
 void set_instance_id(unsigned);
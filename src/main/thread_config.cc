@@ -20,6 +20,9 @@
 #include "thread_config.h"
 
 #include <hwloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
 
 #include "utils/util.h"
 
@@ -162,9 +165,55 @@ void ThreadConfig::implement_thread_affinity(SThreadType type, unsigned id)
                 id, type, s, get_error(errno), errno);
     }
 
+    // Allocate this thread's memory from the NUMA node(s) local to its
+    // pinned CPUs so flows, segments, and scratch aren't left on the
+    // main thread's node.  Only done for explicit affinity since the
+    // process cpuset spans all nodes anyway.
+    if (iter != thread_affinity.end() && topology_support->membind->set_thisthread_membind)
+    {
+        if (hwloc_set_membind(topology, desired_cpuset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_THREAD))
+        {
+            WarningMessage("Failed to bind memory of thread %u (type %u) to %s: %s (%d)\n",
+                id, type, s, get_error(errno), errno);
+        }
+        else
+            LogMessage("Binding memory of thread %u (type %u) to the nodes of %s.\n", id, type, s);
+    }
+
     free(s);
 }
 
+// threads the builder starts, such as the compile workers, inherit this
+// along with its affinity
+void ThreadConfig::implement_reload_priority()
+{
+#ifdef SCHED_IDLE
+    if ( reload_idle )
+    {
+        struct sched_param param = { };
+
+        if ( !pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) )
+        {
+            LogMessage("Running reload builder as SCHED_IDLE.\n");
+            return;
+        }
+        WarningMessage("Failed to run reload builder as SCHED_IDLE: %s (%d)\n",
+            get_error(errno), errno);
+    }
+#endif
+
+    if ( !reload_nice )
+        return;
+
+    // on linux this applies to the calling thread only
+    if ( setpriority(PRIO_PROCESS, gettid(), reload_nice) )
+    {
+        WarningMessage("Failed to set reload builder nice to %d: %s (%d)\n",
+            reload_nice, get_error(errno), errno);
+    }
+    else
+        LogMessage("Running reload builder at nice %d.\n", reload_nice);
+}
 
 // -----------------------------------------------------------------------------
 // unit tests
@@ -38,6 +38,20 @@ public:
     ~ThreadConfig();
     void set_thread_affinity(SThreadType, unsigned id, CpuSet*);
     void implement_thread_affinity(SThreadType, unsigned id);
+
+    // the reload builder runs at this nice value or as SCHED_IDLE and
+    // caps the fast pattern compile threads of the config it builds
+    void set_reload_priority(int nice, bool idle)
+    { reload_nice = nice; reload_idle = idle; }
+
+    void implement_reload_priority();
+
+    void set_reload_compile_threads(unsigned n)
+    { reload_compile_threads = n; }
+
+    unsigned get_reload_compile_threads() const
+    { return reload_compile_threads; }
+
 private:
     struct TypeIdPair
     {
@@ -56,6 +70,10 @@ private:
         }
     };
     std::map<TypeIdPair, CpuSet*, TypeIdPairComparer> thread_affinity;
+
+    int reload_nice = 10;
+    bool reload_idle = false;
+    unsigned reload_compile_threads = 0;  // 0 is no cap
 };
 
 #endif
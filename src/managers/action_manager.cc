@@ -29,6 +29,7 @@ using namespace std;
 #include "main/snort_debug.h"
 #include "utils/util.h"
 #include "managers/module_manager.h"
+#include "managers/plugin_manager.h"
 #include "framework/ips_action.h"
 #include "parser/parser.h"
 #include "log/messages.h"
@@ -104,6 +105,9 @@ RuleType ActionManager::get_action_type(const char* s)
         if ( !strcmp(p.api->base.name, s) )
             return p.api->type;
     }
+    if ( PluginManager::load_plugin(s) )
+        return get_action_type(s);
+
     return RULE_TYPE__NONE;
 }
 
@@ -22,9 +22,12 @@
 #include <assert.h>
 #include <algorithm>
 #include <list>
+#include <map>
 #include <vector>
 
 #include "module_manager.h"
+#include "plugin_manager.h"
+#include "main/snort.h"
 #include "main/snort_config.h"
 #include "main/thread_config.h"
 #include "flow/flow.h"
@@ -33,6 +36,7 @@
 #include "detection/detection_util.h"
 #include "log/messages.h"
 #include "packet_io/active.h"
+#include "ports/port_prefilter.h"
 #include "target_based/snort_protocols.h"
 #include "binder/bind_module.h"
 
@@ -95,8 +99,11 @@ struct PHInstance
     PHClass& pp_class;
     Inspector* handler;
     string name;
+    string digest;  // module settings; see ModuleManager::get_digest()
+    bool shared;    // handler carried over from the prior config
 
     PHInstance(PHClass&, Module* = nullptr);
+    PHInstance(PHClass&, Inspector*);
     ~PHInstance();
 
     static bool comp(PHInstance* a, PHInstance* b)
@@ -108,6 +115,7 @@ struct PHInstance
 
 PHInstance::PHInstance(PHClass& p, Module* mod) : pp_class(p)
 {
+    shared = false;
     handler = p.api.ctor(mod);
 
     if ( handler )
@@ -120,6 +128,13 @@ PHInstance::PHInstance(PHClass& p, Module* mod) : pp_class(p)
     }
 }
 
+PHInstance::PHInstance(PHClass& p, Inspector* ins) : pp_class(p)
+{
+    shared = true;
+    handler = ins;
+    handler->add_ref();
+}
+
 PHInstance::~PHInstance()
 {
     if ( handler )
@@ -134,6 +149,10 @@ typedef list<Inspector*> PHList;
 static PHGlobalList s_handlers;
 static PHList s_trash;
 static PHList s_trash2;
+
+// inspectors shared by more than one config; the count is the number of
+// configs beyond the first.  only the last config deleted trashes them.
+static map<Inspector*, unsigned> s_shared;
 static THREAD_LOCAL bool s_clear = false;
 
 struct FrameworkConfig
@@ -159,6 +178,39 @@ struct PHVector
     { vec[num++] = p; }
 };
 
+// packet types are single bits; index 0 is PktType::NONE
+#define PH_PKT_TYPES 8
+
+// the instances of a list that take each packet type, in list order, so
+// that execute() doesn't visit (or check the proto bits of) the others
+struct PHChains
+{
+    PHVector chain[PH_PKT_TYPES];
+
+    void build(const PHVector&);
+
+    const PHVector& get(PktType t) const
+    {
+        unsigned b = to_utype(t);
+        return chain[b ? __builtin_ctz(b) + 1 : 0];
+    }
+};
+
+void PHChains::build(const PHVector& v)
+{
+    for ( unsigned i = 0; i < PH_PKT_TYPES; ++i )
+    {
+        unsigned bit = i ? 1 << (i - 1) : 0;
+        chain[i].alloc(v.num);
+
+        for ( unsigned j = 0; j < v.num; ++j )
+        {
+            if ( bit & v.vec[j]->pp_class.api.proto_bits )
+                chain[i].add(v.vec[j]);
+        }
+    }
+}
+
 struct FrameworkPolicy
 {
     PHInstanceList ilist;
@@ -170,6 +222,11 @@ struct FrameworkPolicy
     PHVector service;
     PHVector probe;
 
+    PHChains packet_chains;
+    PHChains network_chains;
+    PHChains session_chains;
+    PHChains probe_chains;
+
     Inspector* binder;
     Inspector* wizard;
 
@@ -226,6 +283,10 @@ void FrameworkPolicy::vectorize()
             break;
         }
     }
+    packet_chains.build(packet);
+    network_chains.build(network);
+    session_chains.build(session);
+    probe_chains.build(probe);
 }
 
 //-------------------------------------------------------------------------
@@ -244,6 +305,9 @@ static const InspectApi* get_plugin(const char* keyword)
         if ( !strcmp(p->api.base.name, keyword) )
             return &p->api;
 
+    if ( PluginManager::load_plugin(keyword) )
+        return get_plugin(keyword);
+
     return nullptr;
 }
 
@@ -337,7 +401,14 @@ void InspectorManager::delete_policy(InspectionPolicy* pi)
 {
     for ( auto* p : pi->framework_policy->ilist )
     {
-        if ( p->handler->get_api()->type == IT_PASSIVE )
+        auto it = s_shared.find(p->handler);
+
+        if ( it != s_shared.end() )
+        {
+            if ( !--it->second )
+                s_shared.erase(it);
+        }
+        else if ( p->handler->get_api()->type == IT_PASSIVE )
             s_trash2.push_back(p->handler);
         else
             s_trash.push_back(p->handler);
@@ -366,14 +437,57 @@ static PHInstance* get_instance(
     return nullptr;
 }
 
+// on reload, find the running instance in the same policy that was
+// configured exactly like the new one will be
+static PHInstance* get_reusable(
+    SnortConfig* sc, PHClass* ppc, const char* keyword, const char* name, const string& digest)
+{
+    if ( !Snort::is_reloading() or digest.empty() or !snort_conf or sc == snort_conf )
+        return nullptr;
+
+    auto& pv = sc->policy_map->inspection_policy;
+    auto& old_pv = snort_conf->policy_map->inspection_policy;
+    InspectionPolicy* pi = get_inspection_policy();
+    unsigned idx = 0;
+
+    while ( idx < pv.size() and pv[idx] != pi )
+        ++idx;
+
+    if ( idx >= pv.size() or idx >= old_pv.size() or !old_pv[idx]->framework_policy )
+        return nullptr;
+
+    PHInstance* p = get_instance(old_pv[idx]->framework_policy, keyword);
+
+    if ( !p or &p->pp_class.api != &ppc->api or p->digest != digest )
+        return nullptr;
+
+    if ( p->name != (name ? name : "") or !p->handler->can_share() )
+        return nullptr;
+
+    return p;
+}
+
 static PHInstance* get_new(
-    PHClass* ppc, FrameworkPolicy* fp, const char* keyword, Module* mod)
+    PHClass* ppc, FrameworkPolicy* fp, const char* keyword, Module* mod,
+    PHInstance* old = nullptr)
 {
     PHInstance* p = get_instance(fp, keyword);
 
     if ( p )
         return p;
 
+    if ( old )
+    {
+        // the module built a new config for the ctor; release it the same way
+        if ( Inspector* ins = ppc->api.ctor(mod) )
+            ppc->api.dtor(ins);
+
+        p = new PHInstance(*ppc, old->handler);
+        ++s_shared[p->handler];
+        fp->ilist.push_back(p);
+        return p;
+    }
+
     p = new PHInstance(*ppc, mod);
 
     if ( !p->handler )
@@ -580,13 +694,23 @@ void InspectorManager::instantiate(
         if ( name )
             keyword = name;
 
-        PHInstance* ppi = get_new(ppc, fp, keyword, mod);
+        const string& digest = ModuleManager::get_digest();
+        PHInstance* old = get_reusable(sc, ppc, keyword, name, digest);
+        PHInstance* ppi = get_new(ppc, fp, keyword, mod, old);
 
         if ( !ppi )
             ParseError("can't instantiate inspector: '%s'.", keyword);
 
-        else if ( name )
-            ppi->set_name(name);
+        else
+        {
+            if ( name )
+                ppi->set_name(name);
+
+            ppi->digest = digest;
+
+            if ( ppi->shared )
+                LogMessage("	%s unchanged; reusing instance\n", keyword);
+        }
     }
 }
 
@@ -651,8 +775,12 @@ static bool configure(SnortConfig* sc, FrameworkPolicy* fp)
 {
     bool ok = true;
 
+    // shared instances were configured when first instantiated
     for ( auto* p : fp->ilist )
-        ok = p->handler->configure(sc) && ok;
+    {
+        if ( !p->shared )
+            ok = p->handler->configure(sc) && ok;
+    }
 
     sort(fp->ilist.begin(), fp->ilist.end(), PHInstance::comp);
     fp->vectorize();
@@ -704,6 +832,25 @@ bool InspectorManager::configure(SnortConfig* sc)
     return ok;
 }
 
+// inspectors that see raw packets need everything.  the rest only see
+// flows the binders send them.
+void InspectorManager::get_prefilter(SnortConfig* sc, PortPrefilter& pf)
+{
+    for ( auto* p : sc->policy_map->inspection_policy )
+    {
+        FrameworkPolicy* fp = p->framework_policy;
+
+        if ( fp->packet.num or fp->network.num or fp->probe.num )
+        {
+            pf.add_all((unsigned)PktType::ANY);
+            return;
+        }
+
+        if ( fp->binder )
+            fp->binder->exec(BINDER_EXEC_PREFILTER, &pf);
+    }
+}
+
 void InspectorManager::print_config(SnortConfig* sc)
 {
     InspectionPolicy* pi = get_inspection_policy();
@@ -719,24 +866,19 @@ void InspectorManager::print_config(SnortConfig* sc)
 // packet handling
 //-------------------------------------------------------------------------
 
-static inline void execute(
-    Packet* p, PHInstance** prep, unsigned num)
+// the chain only has instances that take this packet type and never
+// has service inspectors, which need a flow
+static inline void execute(Packet* p, const PHChains& chains)
 {
-    for ( unsigned i = 0; i < num; ++i, ++prep )
+    const PHVector& v = chains.get(p->type());
+    PHInstance** prep = v.vec;
+
+    for ( unsigned i = 0; i < v.num; ++i, ++prep )
     {
         if ( p->packet_flags & PKT_PASS_RULE )
             break;
 
-        PHClass& ppc = (*prep)->pp_class;
-
-        // FIXIT-P these checks can eventually be optimized
-        // but they are required to ensure that session and app
-        // handlers aren't called w/o a session pointer
-        if ( !p->flow && (ppc.api.type == IT_SERVICE) )
-            break;
-
-        if ( (unsigned)p->type() & ppc.api.proto_bits )
-            (*prep)->handler->eval(p);
+        (*prep)->handler->eval(p);
     }
 }
 
@@ -763,7 +905,7 @@ bool InspectorManager::full_inspection(FrameworkPolicy* fp, Packet* p)
     Flow* flow = p->flow;
 
     if ( !flow->service )
-        ::execute(p, fp->network.vec, fp->network.num);
+        ::execute(p, fp->network_chains);
 
     else if ( flow->clouseau and !p->is_cooked() )
         bumble(p);
@@ -790,10 +932,16 @@ void InspectorManager::execute(Packet* p)
 
     // FIXIT-M blocked flows should not be normalized
     if ( !p->is_cooked() )
-        ::execute(p, fp->packet.vec, fp->packet.num);
+    {
+        ::execute(p, fp->packet_chains);
+
+        // eg reputation decided before any flow was set up
+        if ( p->disable_inspect )
+            return;
+    }
 
     if ( !p->has_paf_payload() )
-        ::execute(p, fp->session.vec, fp->session.num);
+        ::execute(p, fp->session_chains);
 
     if( p->disable_inspect )
         return;
@@ -801,7 +949,7 @@ void InspectorManager::execute(Packet* p)
     Flow* flow = p->flow;
 
     if ( !flow )
-        ::execute(p, fp->network.vec, fp->network.num);
+        ::execute(p, fp->network_chains);
 
     else if ( flow->full_inspection() )
     {
@@ -809,11 +957,13 @@ void InspectorManager::execute(Packet* p)
             return;
     }
 
-    ::execute(p, fp->probe.vec, fp->probe.num);
+    ::execute(p, fp->probe_chains);
 }
 
 void InspectorManager::clear(Packet* p)
 {
+    Inspector::clear_packet_bufs();
+
     if ( !s_clear )
         return;
 
@@ -40,6 +40,7 @@ struct Packet;
 struct FrameworkPolicy;
 struct SnortConfig;
 struct InspectionPolicy;
+class PortPrefilter;
 
 //-------------------------------------------------------------------------
 
@@ -74,6 +75,7 @@ public:
 
     static bool configure(SnortConfig*);
     static void print_config(SnortConfig*);
+    static void get_prefilter(SnortConfig*, PortPrefilter&);
 
     static void thread_init(SnortConfig*);
     static void thread_stop(SnortConfig*);
@@ -164,6 +164,9 @@ static Option* get_opt(const char* keyword)
         if ( !strcasecmp(p->api->base.name, keyword) )
             return p;
 
+    if ( PluginManager::load_plugin(keyword) )
+        return get_opt(keyword);
+
     return nullptr;
 }
 
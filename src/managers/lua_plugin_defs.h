@@ -32,6 +32,28 @@ struct SnortBuffer
 extern "C"
 const struct SnortBuffer* get_buffer();
 
+struct SnortFlow
+{
+    const char* service;  // "" until known
+    unsigned ip_proto;
+    unsigned sp;
+    unsigned dp;
+    unsigned from_server;
+};
+
+// ips options are also given the global snort_context, a pointer to this
+// that is filled in before each eval() so it can be read as cdata with
+// ffi.cast("const struct SnortContext*", snort_context)
+struct SnortContext
+{
+    struct SnortBuffer buffer;  // the whole buffer
+    unsigned pos;               // cursor offset into buffer
+    struct SnortFlow flow;
+};
+
+extern "C"
+const struct SnortContext* get_context();
+
 struct SnortEvent
 {
     unsigned gid;
@@ -60,4 +82,18 @@ struct SnortPacket
 extern "C"
 const struct SnortPacket* get_packet();
 
+// loggers configured with a batch get the queued alerts in one call;
+// get_event() and get_packet() then return the latest
+struct SnortAlert
+{
+    struct SnortEvent event;
+    struct SnortPacket packet;
+};
+
+extern "C"
+const struct SnortAlert* get_alerts();
+
+extern "C"
+unsigned get_alert_count();
+
 #endif
@@ -20,12 +20,18 @@
 #include "module_manager.h"
 
 #include <assert.h>
+#include <sys/stat.h>
+#include <time.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <list>
+#include <map>
 #include <mutex>
 #include <string>
 #include <sstream>
+#include <vector>
 #include <lua.hpp>
 
 #include "plugin_manager.h"
@@ -34,6 +40,7 @@
 #include "main/shell.h"
 #include "main/snort_types.h"
 #include "main/snort.h"
+#include "main/thread.h"
 #include "framework/base_api.h"
 #include "framework/module.h"
 #include "parser/parser.h"
@@ -65,6 +72,10 @@ static string s_current;
 static string s_name;
 static string s_type;
 
+// everything set in the current top-level table; on reload an inspector
+// with the same digest as before may be reused
+static string s_digest;
+
 // for callbacks from Lua
 static SnortConfig* s_config = nullptr;
 
@@ -173,6 +184,9 @@ static ModHook* get_hook(const char* s)
         if ( !strcmp(p->mod->get_name(), s) )
             return p;
 
+    if ( PluginManager::load_plugin(s) )
+        return get_hook(s);
+
     return nullptr;
 }
 
@@ -679,6 +693,13 @@ SO_PUBLIC bool open_table(const char* s, int idx)
         }
     }
 
+    if ( top_level(s) and !idx )
+        s_digest.clear();
+
+    s_digest += "{";
+    s_digest += s;
+    s_digest += ":" + to_string(idx);
+
     if ( s_current != key )
     {
         if ( fqn != orig )
@@ -707,6 +728,8 @@ SO_PUBLIC void close_table(const char* s, int idx)
     string key = fqn;
     set_top(key);
 
+    s_digest += "}";
+
     if ( ModHook* h = get_hook(key.c_str()) )
     {
         if ( !end(h->mod, nullptr, s, idx) )
@@ -720,11 +743,23 @@ SO_PUBLIC void close_table(const char* s, int idx)
     }
     s_name.clear();
     s_type.clear();
+
+    if ( !idx && (key == s) )
+        s_digest.clear();
+}
+
+static void add_digest(const char* fqn, const char* val)
+{
+    s_digest += fqn;
+    s_digest += "=";
+    s_digest += val;
+    s_digest += ";";
 }
 
 SO_PUBLIC bool set_bool(const char* fqn, bool b)
 {
     //printf("bool %s %d\n", fqn, b);
+    add_digest(fqn, b ? "true" : "false");
     Value v(b);
     return set_value(fqn, v);
 }
@@ -732,6 +767,9 @@ SO_PUBLIC bool set_bool(const char* fqn, bool b)
 SO_PUBLIC bool set_number(const char* fqn, double d)
 {
     //printf("real %s %f\n", fqn, d);
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.17g", d);
+    add_digest(fqn, buf);
     Value v(d);
     return set_value(fqn, v);
 }
@@ -739,6 +777,14 @@ SO_PUBLIC bool set_number(const char* fqn, double d)
 SO_PUBLIC bool set_string(const char* fqn, const char* s)
 {
     //printf("string %s %s\n", fqn, s);
+    add_digest(fqn, s);
+
+    // a file may change without its name changing
+    struct stat fs;
+
+    if ( !stat(s, &fs) and S_ISREG(fs.st_mode) )
+        s_digest += to_string(fs.st_size) + "@" + to_string(fs.st_mtime) + ";";
+
     Value v(s);
     return set_value(fqn, v);
 }
@@ -785,11 +831,8 @@ void ModuleManager::add_module(Module* m, const BaseApi* b)
 
 Module* ModuleManager::get_module(const char* s)
 {
-    for ( auto p : s_modules )
-        if ( !strcmp(p->mod->get_name(), s) )
-            return p->mod;
-
-    return nullptr;
+    ModHook* h = get_hook(s);
+    return h ? h->mod : nullptr;
 }
 
 Module* ModuleManager::get_default_module(const char* s, SnortConfig* sc)
@@ -807,6 +850,9 @@ Module* ModuleManager::get_default_module(const char* s, SnortConfig* sc)
 const char* ModuleManager::get_current_module()
 { return s_current.c_str(); }
 
+const std::string& ModuleManager::get_digest()
+{ return s_digest; }
+
 list<Module*> ModuleManager::get_all_modules()
 {
     list<Module*> ret;
@@ -1240,11 +1286,249 @@ void ModuleManager::dump_stats(SnortConfig*, const char* skip)
     }
 }
 
+// counts published by running packet threads.  the main thread reads them
+// with relaxed loads so a snapshot never stops or slows the packet threads.
+// a snapshot may be a few increments behind and pegs aren't consistent
+// with each other, which is fine for monitoring.
+struct LiveCounts
+{
+    unsigned thread;
+    Module* mod;
+    const PegCount* counts;
+};
+
+// profile stats are thread local too; these are the running threads'
+struct LiveProfile
+{
+    unsigned thread;
+    const char* name;
+    const ProfileStats* stats;
+};
+
+static mutex stats_mutex;
+static vector<LiveCounts> s_live;
+static vector<LiveProfile> s_live_profiles;
+
+void ModuleManager::thread_register()
+{
+    unsigned id = get_instance_id();
+    stats_mutex.lock();
+
+    for ( auto p : s_modules )
+    {
+        const PegCount* pc = p->mod->get_counts();
+
+        if ( pc and p->mod->num_counts > 0 )
+            s_live.push_back({ id, p->mod, pc });
+
+        const ProfileStats* ps = p->mod->get_profile();
+
+        if ( ps )
+        {
+            s_live_profiles.push_back({ id, p->mod->get_name(), ps });
+            continue;
+        }
+
+        unsigned i = 0;
+        const char* name, * parent;
+
+        while ( (ps = p->mod->get_profile(i++, name, parent)) )
+            s_live_profiles.push_back({ id, name, ps });
+    }
+    stats_mutex.unlock();
+}
+
+void ModuleManager::dump_live_stats(const char* skip)
+{
+    vector<PegCount> snap;
+    stats_mutex.lock();
+
+    for ( auto p : s_modules )
+    {
+        Module* m = p->mod;
+
+        if ( m->num_counts <= 0 or (skip and strstr(skip, m->get_name())) )
+            continue;
+
+        snap = m->counts;
+
+        for ( const auto& lc : s_live )
+        {
+            if ( lc.mod != m )
+                continue;
+
+            for ( int i = 0; i < m->num_counts; ++i )
+            {
+                PegCount v = __atomic_load_n(lc.counts + i, __ATOMIC_RELAXED);
+
+                if ( m->global_stats() )
+                    snap[i] = v;
+                else
+                    snap[i] += v;
+            }
+        }
+        ::show_stats(&snap[0], m->get_pegs(), m->num_counts, m->get_name());
+    }
+    stats_mutex.unlock();
+}
+
+static void json_counts(
+    string& s, const PegInfo* pegs, const PegCount* pc, int n)
+{
+    s += '{';
+
+    for ( int i = 0; i < n; ++i )
+    {
+        if ( i )
+            s += ',';
+
+        s += '"';
+        s += pegs[i].name;
+        s += "\":";
+        s += to_string(pc[i]);
+    }
+    s += '}';
+}
+
+// like dump_live_stats() but also per thread and with the profiler totals
+// so it can be polled by monitoring without touching the packet threads
+void ModuleManager::get_live_stats_json(string& s)
+{
+    vector<PegCount> snap, thread;
+    vector<unsigned> ids;
+
+    stats_mutex.lock();
+
+    for ( const auto& lc : s_live )
+        if ( find(ids.begin(), ids.end(), lc.thread) == ids.end() )
+            ids.push_back(lc.thread);
+
+    s = "{\"time\":";
+    s += to_string(time(nullptr));
+    s += ",\"threads\":";
+    s += to_string(ids.size());
+    s += ",\"modules\":{";
+
+    bool first = true;
+
+    for ( auto p : s_modules )
+    {
+        Module* m = p->mod;
+
+        if ( m->num_counts <= 0 )
+            continue;
+
+        snap = m->counts;
+        string per;
+
+        for ( const auto& lc : s_live )
+        {
+            if ( lc.mod != m )
+                continue;
+
+            thread.resize(m->num_counts);
+
+            for ( int i = 0; i < m->num_counts; ++i )
+            {
+                thread[i] = __atomic_load_n(lc.counts + i, __ATOMIC_RELAXED);
+
+                if ( m->global_stats() )
+                    snap[i] = thread[i];
+                else
+                    snap[i] += thread[i];
+            }
+
+            if ( m->global_stats() )
+                continue;
+
+            per += per.empty() ? "" : ",";
+            per += '"';
+            per += to_string(lc.thread);
+            per += "\":";
+            json_counts(per, m->get_pegs(), &thread[0], m->num_counts);
+        }
+
+        s += first ? "\"" : ",\"";
+        s += m->get_name();
+        s += "\":{\"total\":";
+        json_counts(s, m->get_pegs(), &snap[0], m->num_counts);
+        s += ",\"threads\":{";
+        s += per;
+        s += "}}";
+        first = false;
+    }
+
+    s += "},\"profile\":{";
+
+    // running threads only; totals from exited threads are in the profiler
+    map<string, pair<uint64_t, hr_duration>> prof;
+    vector<string> order;
+
+    for ( const auto& lp : s_live_profiles )
+    {
+        hr_duration elapsed;
+        __atomic_load(&lp.stats->time.elapsed, &elapsed, __ATOMIC_RELAXED);
+        uint64_t checks = __atomic_load_n(&lp.stats->time.checks, __ATOMIC_RELAXED);
+
+        auto it = prof.find(lp.name);
+
+        if ( it == prof.end() )
+        {
+            order.push_back(lp.name);
+            prof[lp.name] = { checks, elapsed };
+        }
+        else
+        {
+            it->second.first += checks;
+            it->second.second += elapsed;
+        }
+    }
+    stats_mutex.unlock();
+
+    first = true;
+
+    for ( const auto& name : order )
+    {
+        const auto& v = prof[name];
+
+        if ( !v.first )
+            continue;
+
+        s += first ? "\"" : ",\"";
+        s += name;
+        s += "\":{\"checks\":";
+        s += to_string(v.first);
+        s += ",\"usecs\":";
+        s += to_string(
+            chrono::duration_cast<chrono::microseconds>(v.second).count());
+        s += '}';
+        first = false;
+    }
+    s += "}}";
+}
+
 void ModuleManager::accumulate(SnortConfig*)
 {
-    static mutex stats_mutex;
+    unsigned id = get_instance_id();
     stats_mutex.lock();
 
+    // withdraw in the same critical section so nothing is counted twice
+    for ( auto it = s_live.begin(); it != s_live.end(); )
+    {
+        if ( it->thread == id )
+            it = s_live.erase(it);
+        else
+            ++it;
+    }
+
+    for ( auto it = s_live_profiles.begin(); it != s_live_profiles.end(); )
+    {
+        if ( it->thread == id )
+            it = s_live_profiles.erase(it);
+        else
+            ++it;
+    }
+
     for ( auto p : s_modules )
         p->mod->sum_stats();
 
@@ -40,6 +40,9 @@ public:
     static Module* get_module(const char*);
     static Module* get_default_module(const char*, SnortConfig*);
     static const char* get_current_module();
+
+    // the settings of the table being instantiated; empty otherwise
+    static const std::string& get_digest();
     static std::list<Module*> get_all_modules();
 
     static void list_modules(const char* = nullptr);
@@ -65,6 +68,15 @@ public:
     static unsigned get_errors();
 
     static void dump_stats(SnortConfig*, const char* skip = nullptr);
+
+    // packet threads publish their counts so the main thread can show
+    // totals while they run; accumulate() withdraws them
+    static void thread_register();
+    static void dump_live_stats(const char* skip = nullptr);
+
+    // the same snapshot as JSON with per thread counts and profile totals
+    static void get_live_stats_json(std::string&);
+
     static void accumulate(SnortConfig*);
     static void reset_stats(SnortConfig*);
 };
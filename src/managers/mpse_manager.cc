@@ -23,6 +23,7 @@
 using namespace std;
 
 #include "module_manager.h"
+#include "plugin_manager.h"
 #include "main/snort_types.h"
 #include "main/snort_config.h"
 #include "main/snort_debug.h"
@@ -71,6 +72,9 @@ static const MpseApi* get_api(const char* keyword)
         if ( !strcasecmp(p->base.name, keyword) )
             return p;
 
+    if ( PluginManager::load_plugin(keyword) )
+        return get_api(keyword);
+
     return nullptr;
 }
 
@@ -84,6 +88,12 @@ const MpseApi* MpseManager::get_search_api(const char* name)
     return api;
 }
 
+void MpseManager::get_search_apis(std::vector<const MpseApi*>& apis)
+{
+    for ( auto* p : s_engines )
+        apis.push_back(p);
+}
+
 Mpse* MpseManager::get_search_engine(
     SnortConfig* sc, const MpseApi* api, bool use_gc, const MpseAgent* agent)
 {
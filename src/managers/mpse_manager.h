@@ -28,6 +28,8 @@
 # include "config.h"
 #endif
 
+#include <vector>
+
 #include "main/snort_types.h"
 #include "framework/base_api.h"
 
@@ -68,6 +70,7 @@ public:
 
     static void instantiate(const MpseApi*, Module*, SnortConfig*);
     static const MpseApi* get_search_api(const char* type);
+    static void get_search_apis(std::vector<const MpseApi*>&);
     static void delete_search_engine(Mpse*);
 
     static Mpse* get_search_engine(const char*);
@@ -27,7 +27,11 @@
 #include <sys/stat.h>
 #include <dlfcn.h>
 
+#include <chrono>
+#include <fstream>
 #include <map>
+#include <set>
+#include <sstream>
 #include <vector>
 #include <iostream>
 using namespace std;
@@ -146,6 +150,7 @@ struct Plugin
 {
     string source;
     string key;
+    string name;
 
     const BaseApi* api;
     void* handle;
@@ -154,7 +159,11 @@ struct Plugin
     { clear(); }
 
     void clear()
-    { source.clear(); key.clear(); api = nullptr; handle = nullptr; }
+    { source.clear(); key.clear(); name.clear(); api = nullptr; handle = nullptr; }
+
+    // listed in a manifest but its library isn't loaded yet
+    bool pending() const
+    { return !api and !source.empty(); }
 };
 
 typedef map<string, Plugin> PlugMap;
@@ -172,6 +181,40 @@ struct RefCount
 typedef map<void*, RefCount> RefMap;
 static RefMap ref_map;
 
+// how long each library took to load
+struct LibLoad
+{
+    string file;
+    unsigned plugins;
+    unsigned usecs;
+    bool lazy;
+};
+
+static vector<LibLoad> lib_loads;
+static bool show_loads = false;
+
+// upper bound on the plugins still to be loaded; skips the lookups if none
+static unsigned num_pending = 0;
+
+// the plugin types that are only needed when named in the config or rules
+static bool lazy_type(PlugType pt)
+{
+    switch ( pt )
+    {
+    case PT_INSPECTOR:
+    case PT_IPS_ACTION:
+    case PT_IPS_OPTION:
+    case PT_SEARCH_ENGINE:
+    case PT_LOGGER:
+    case PT_CONNECTOR:
+        return true;
+
+    default:
+        break;
+    }
+    return false;
+}
+
 static void set_key(string& key, Symbol* sym, const char* name)
 {
     key = sym->name;
@@ -244,6 +287,7 @@ static bool register_plugin(
     }
 
     p.key = key;
+    p.name = api->name;
     p.api = api;
     p.handle = handle;
     p.source = file;
@@ -254,22 +298,44 @@ static bool register_plugin(
     return true;
 }
 
-static void load_list(
-    const BaseApi** api, void* handle = nullptr, const char* file = "static")
+// with wanted, only the plugins pending from this file are registered
+static unsigned load_list(
+    const BaseApi** api, void* handle = nullptr, const char* file = "static",
+    vector<Plugin*>* wanted = nullptr)
 {
-    bool keep = false;
+    unsigned keep = 0;
 
     while ( *api )
     {
-        keep = register_plugin(*api, handle, file) || keep;
+        if ( wanted )
+        {
+            string key;
+            set_key(key, symbols + ((*api)->type < PT_MAX ? (*api)->type : 0), (*api)->name);
+            auto it = plug_map.find(key);
+
+            if ( (*api)->type < PT_MAX and it != plug_map.end() and
+                it->second.pending() and it->second.source == file and
+                register_plugin(*api, handle, file) )
+            {
+                wanted->push_back(&it->second);
+                ++keep;
+            }
+        }
+        else if ( register_plugin(*api, handle, file) )
+            ++keep;
+
         //printf("loaded %s\n", (*api)->name);
         ++api;
     }
     if ( handle && !keep )
         dlclose(handle);
+
+    return keep;
 }
 
-static bool load_lib(const char* file)
+// plugins are linked when loaded (RTLD_NOW) even when loaded on demand so
+// that a missing symbol is a startup warning and not a crash while running
+static bool load_lib(const char* file, vector<Plugin*>* wanted = nullptr)
 {
     struct stat fs;
     void* handle;
@@ -277,6 +343,8 @@ static bool load_lib(const char* file)
     if ( stat(file, &fs) || !(fs.st_mode & S_IFREG) )
         return false;
 
+    auto start = chrono::steady_clock::now();
+
     if ( !(handle = dlopen(file, RTLD_NOW|RTLD_LOCAL)) )
     {
         if ( const char* err = dlerror() )
@@ -293,10 +361,110 @@ static bool load_lib(const char* file)
         dlclose(handle);
         return false;
     }
-    load_list(api, handle, file);
+    unsigned n = load_list(api, handle, file, wanted);
+
+    auto usecs = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - start).count();
+
+    lib_loads.push_back({ file, n, (unsigned)usecs, wanted != nullptr });
+
+    if ( wanted and show_loads )
+        LogMessage("loaded %s on demand: %u plugins, %u usecs\n", file, n, (unsigned)usecs);
+
     return true;
 }
 
+//-------------------------------------------------------------------------
+// manifests
+//
+// a plugin directory may have a plugins.manifest with lines like:
+//
+//     <type> <name> <library>
+//
+// where library is relative to the directory.  a library whose plugins are
+// all of a lazy_type() isn't loaded until one of its plugins is needed.
+// generate a manifest with --dump-plugin-manifest.
+//-------------------------------------------------------------------------
+
+#define MANIFEST "plugins.manifest"
+
+// returns the libraries deferred
+static set<string> read_manifest(const char* dir)
+{
+    set<string> deferred;
+    string path = dir;
+    path += "/" MANIFEST;
+
+    ifstream ifs(path);
+
+    if ( !ifs )
+        return deferred;
+
+    map<string, vector<pair<PlugType, string>>> libs;
+    set<string> eager;
+    string line;
+
+    while ( getline(ifs, line) )
+    {
+        if ( line.empty() or line[0] == '#' )
+            continue;
+
+        istringstream ss(line);
+        string type, name, file;
+
+        if ( !(ss >> type >> name >> file) )
+        {
+            ParseWarning(WARN_PLUGINS, "%s: bad line '%s'", path.c_str(), line.c_str());
+            continue;
+        }
+        file = string(dir) + "/" + file;
+        PlugType pt = PluginManager::get_type(type.c_str());
+
+        if ( pt >= PT_MAX or !lazy_type(pt) )
+            eager.insert(file);
+        else
+            libs[file].push_back({ pt, name });
+    }
+
+    for ( auto& lib : libs )
+    {
+        if ( eager.count(lib.first) )
+            continue;
+
+        for ( auto& e : lib.second )
+        {
+            string key;
+            set_key(key, symbols + e.first, e.second.c_str());
+            Plugin& p = plug_map[key];
+
+            // the loaded builtins win
+            if ( p.api )
+                continue;
+
+            p.key = key;
+            p.name = e.second;
+            p.source = lib.first;
+            ++num_pending;
+        }
+        deferred.insert(lib.first);
+    }
+    return deferred;
+}
+
+static void drop_pending(const string& file)
+{
+    for ( auto it = plug_map.begin(); it != plug_map.end(); )
+    {
+        if ( it->second.pending() and it->second.source == file )
+        {
+            ParseWarning(WARN_PLUGINS, "%s not found in %s", it->first.c_str(), file.c_str());
+            it = plug_map.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
 static void add_plugin(Plugin& p)
 {
     if ( p.api->mod_ctor )
@@ -352,7 +520,7 @@ static void add_plugin(Plugin& p)
     }
 }
 
-static void load_plugins(const std::string& paths)
+static void load_plugins(const std::string& paths, bool lazy)
 {
     const char* t = paths.c_str();
     vector<char> buf(t, t+strlen(t)+1);
@@ -362,12 +530,19 @@ static void load_plugins(const std::string& paths)
 
     while ( s )
     {
+        set<string> deferred;
+
+        if ( lazy )
+            deferred = read_manifest(s);
+
         Directory d(s, lib_pattern);
         const char* f;
 
         while ( (f = d.next()) )
-            load_lib(f);
-
+        {
+            if ( !deferred.count(f) )
+                load_lib(f);
+        }
         s = strtok_r(nullptr, ":", &last);
     }
 }
@@ -377,7 +552,66 @@ static void add_plugins()
     PlugMap::iterator it;
 
     for ( it = plug_map.begin(); it != plug_map.end(); ++it )
-        add_plugin(it->second);
+    {
+        if ( it->second.api )
+            add_plugin(it->second);
+    }
+}
+
+// load the deferred library providing plugins with this name, if any
+static bool load_pending(const char* name)
+{
+    if ( !num_pending )
+        return false;
+
+    set<string> files;
+
+    for ( auto& it : plug_map )
+    {
+        if ( it.second.pending() and !strcasecmp(it.second.name.c_str(), name) )
+            files.insert(it.second.source);
+    }
+
+    bool loaded = false;
+
+    for ( auto& file : files )
+    {
+        vector<Plugin*> added;
+        load_lib(file.c_str(), &added);
+
+        for ( auto* p : added )
+            add_plugin(*p);
+
+        drop_pending(file);
+        loaded = loaded or !added.empty();
+    }
+    if ( !files.empty() )
+    {
+        num_pending = 0;
+
+        for ( auto& it : plug_map )
+        {
+            if ( it.second.pending() )
+                ++num_pending;
+        }
+    }
+    return loaded;
+}
+
+static void load_all_pending()
+{
+    if ( !num_pending )
+        return;
+
+    set<string> names;
+
+    for ( auto& it : plug_map )
+    {
+        if ( it.second.pending() )
+            names.insert(it.second.name);
+    }
+    for ( auto& n : names )
+        load_pending(n.c_str());
 }
 
 static void unload_plugins()
@@ -400,7 +634,7 @@ static void unload_plugins()
 // framework methods
 //-------------------------------------------------------------------------
 
-void PluginManager::load_plugins(const std::string& paths)
+void PluginManager::load_plugins(const std::string& paths, bool lazy)
 {
     // builtins
     load_list(codecs);
@@ -419,7 +653,7 @@ void PluginManager::load_plugins(const std::string& paths)
 
     // dynamic plugins
     if ( !paths.empty() )
-        ::load_plugins(paths);
+        ::load_plugins(paths, lazy);
 
     // script plugins
     // FIXIT-L need path to script for --list-plugins
@@ -428,8 +662,12 @@ void PluginManager::load_plugins(const std::string& paths)
     add_plugins();
 }
 
+bool PluginManager::load_plugin(const char* name)
+{ return ::load_pending(name); }
+
 void PluginManager::list_plugins()
 {
+    load_all_pending();
     PlugMap::iterator it;
 
     for ( it = plug_map.begin(); it != plug_map.end(); ++it )
@@ -445,6 +683,7 @@ void PluginManager::list_plugins()
 
 void PluginManager::show_plugins()
 {
+    load_all_pending();
     PlugMap::iterator it;
 
     for ( it = plug_map.begin(); it != plug_map.end(); ++it )
@@ -457,8 +696,48 @@ void PluginManager::show_plugins()
     }
 }
 
+void PluginManager::dump_manifest()
+{
+    load_all_pending();
+
+    cout << "# generated by snort --dump-plugin-manifest" << endl;
+
+    for ( auto& it : plug_map )
+    {
+        if ( !it.second.handle )
+            continue;
+
+        const string& file = it.second.source;
+        size_t pos = file.find_last_of('/');
+
+        cout << get_type_name(it.second.api->type) << " ";
+        cout << it.second.api->name << " ";
+        cout << (pos == string::npos ? file : file.substr(pos + 1)) << endl;
+    }
+}
+
 void PluginManager::dump_plugins()
 {
+    if ( !lib_loads.empty() )
+    {
+        LogMessage("plugin libraries:\n");
+
+        for ( auto& l : lib_loads )
+            LogMessage("    %s: %u plugins, %u usecs%s\n",
+                l.file.c_str(), l.plugins, l.usecs, l.lazy ? " (on demand)" : "");
+    }
+    unsigned pending = 0;
+
+    for ( auto& it : plug_map )
+    {
+        if ( it.second.pending() )
+            ++pending;
+    }
+    if ( pending )
+        LogMessage("plugins deferred: %u\n", pending);
+
+    show_loads = true;
+
     CodecManager::dump_plugins();
     InspectorManager::dump_plugins();
     MpseManager::dump_plugins();
@@ -491,7 +770,14 @@ const BaseApi* PluginManager::get_api(PlugType type, const char* name)
     string key;
     set_key(key, symbols+type, name);
 
-    const PlugMap::iterator it = plug_map.find(key);
+    PlugMap::iterator it = plug_map.find(key);
+
+    if ( it != plug_map.end() and it->second.pending() )
+    {
+        // stale manifest entries are dropped by the load
+        ::load_pending(name);
+        it = plug_map.find(key);
+    }
 
     if ( it != plug_map.end() )
         return it->second.api;
@@ -499,9 +785,27 @@ const BaseApi* PluginManager::get_api(PlugType type, const char* name)
     return nullptr;
 }
 
+const char* PluginManager::get_source(PlugType type, const char* name)
+{
+    if ( type >= PT_MAX )
+        return nullptr;
+
+    string key;
+    set_key(key, symbols+type, name);
+
+    const PlugMap::iterator it = plug_map.find(key);
+
+    if ( it == plug_map.end() or !it->second.handle )
+        return nullptr;
+
+    return it->second.source.c_str();
+}
+
 #ifdef PIGLET
 PlugType PluginManager::get_type_from_name(std::string name)
 {
+    load_all_pending();
+
     for ( auto it = plug_map.begin(); it != plug_map.end(); ++it )
     {
         const auto* api = it->second.api;
@@ -577,14 +881,17 @@ const char* PluginManager::get_available_plugins(PlugType t)
     for ( auto it = plug_map.begin(); it != plug_map.end(); ++it )
     {
         const auto* api = it->second.api;
+        const string& key = it->first;
 
-        if ( t != api->type )
+        // pending plugins are available too but only known by key
+        if ( api ? t != api->type : key.compare(0, strlen(symbols[t].name) + 2,
+            string(symbols[t].name) + "::") )
             continue;
 
         if ( !s.empty() )
             s += " | ";
 
-        s += api->name;
+        s += it->second.name;
     }
     return s.c_str();
 }
@@ -44,7 +44,14 @@ class PluginManager
 {
 public:
     // plugin methods
-    static void load_plugins(const std::string& lib_paths);
+    // with lazy, libraries listed in a plugins.manifest are loaded only
+    // when one of their plugins is looked up
+    static void load_plugins(const std::string& lib_paths, bool lazy = false);
+
+    // loads the pending plugins with this name; returns false if none
+    static bool load_plugin(const char* name);
+
+    static void dump_manifest();
     static void list_plugins();
     static void show_plugins();
     static void dump_plugins();
@@ -54,6 +61,9 @@ public:
     static const char* get_type_name(PlugType);
 
     static const BaseApi* get_api(PlugType, const char* name);
+
+    // the library the plugin was loaded from or nullptr if static
+    static const char* get_source(PlugType, const char* name);
 #ifdef PIGLET
     static PlugType get_type_from_name(std::string);
 #endif
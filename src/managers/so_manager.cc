@@ -32,10 +32,17 @@
 #include <unistd.h>
 #include <zlib.h>
 
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <list>
 #include <iomanip>
 #include <iostream>
+#include <map>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 using namespace std;
 
 #include "plugin_manager.h"
@@ -61,6 +68,7 @@ void SoManager::add_plugin(const SoApi* api)
 
 void SoManager::release_plugins()
 {
+    clear_prefetch(false);
     s_rules.clear();
 }
 
@@ -119,7 +127,8 @@ static const uint8_t* compress(const string& text, unsigned& len)
 
 // FIXIT-L make this into a general utility for one shot decompress
 // and add class for stream decompress
-static const char* expand(const uint8_t* data, unsigned len)
+// buf must have max_rule bytes
+static const char* expand(const uint8_t* data, unsigned len, uint8_t* buf = so_buf)
 {
     z_stream stream;
 
@@ -135,7 +144,7 @@ static const char* expand(const uint8_t* data, unsigned len)
     stream.next_in = (Bytef*)data;
     stream.avail_in = (uInt)len;
 
-    stream.next_out = (Bytef*)so_buf;
+    stream.next_out = (Bytef*)buf;
     stream.avail_out = (uInt)(max_rule - 1);
 
     int ret = inflate(&stream, Z_FINISH);
@@ -149,9 +158,9 @@ static const char* expand(const uint8_t* data, unsigned len)
         return nullptr;
 
     assert(stream.total_out < max_rule);
-    so_buf[stream.total_out] = '\0';
+    buf[stream.total_out] = '\0';
 
-    return (char*)so_buf;
+    return (char*)buf;
 }
 
 //-------------------------------------------------------------------------
@@ -179,7 +188,7 @@ static void strvrt(const string& text, string& data)
     data.append(1, (char)key);
 }
 
-static const char* revert(const uint8_t* data, unsigned len)
+static const char* revert(const uint8_t* data, unsigned len, uint8_t* buf = so_buf)
 {
     if ( !len )
         return (char*)data;
@@ -190,7 +199,71 @@ static const char* revert(const uint8_t* data, unsigned len)
     for ( unsigned i = 0; i < len; i++ )
         s[i] ^= key;
 
-    return expand((uint8_t*)s.c_str(), s.size());
+    return expand((uint8_t*)s.c_str(), s.size(), buf);
+}
+
+// FIXIT-L this approach won't tolerate spaces and might get
+// fooled by matching content (should it precede this)
+static const char* find_so_options(const char* rule, const char* soid)
+{
+    char opt[32];
+    snprintf(opt, sizeof(opt), "soid:%s;", soid);
+    const char* s = strstr(rule, opt);
+
+    return s ? s + strlen(opt) : nullptr;
+}
+
+//-------------------------------------------------------------------------
+// prefetch
+//
+// the rules are expanded by helper threads while the rules files are
+// parsed.  each result is stored by its index in s_rules so the parse
+// gets exactly what the serial expansion would give.
+//-------------------------------------------------------------------------
+
+struct SoText
+{
+    const SoApi* api;
+    string opts;
+    bool ok;
+    unsigned usecs;
+};
+
+static vector<SoText> so_texts;
+static unordered_map<string, unsigned> so_index;
+static vector<future<void>> so_workers;
+static chrono::steady_clock::time_point so_start;
+
+static void expand_worker(unsigned first, unsigned step)
+{
+    vector<uint8_t> buf(max_rule);
+
+    for ( unsigned i = first; i < so_texts.size(); i += step )
+    {
+        SoText& t = so_texts[i];
+        auto start = chrono::steady_clock::now();
+
+        const char* rule = revert(t.api->rule, t.api->length, buf.data());
+        const char* opts = rule ? find_so_options(rule, t.api->base.name) : nullptr;
+
+        if ( opts )
+            t.opts = opts;
+
+        t.ok = opts != nullptr;
+        t.usecs = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - start).count();
+    }
+}
+
+static const SoText* get_so_text(const char* soid)
+{
+    auto it = so_index.find(soid);
+
+    if ( it == so_index.end() )
+        return nullptr;
+
+    so_workers[it->second % so_workers.size()].wait();
+    return &so_texts[it->second];
 }
 
 //-------------------------------------------------------------------------
@@ -206,6 +279,12 @@ static const SoApi* get_so_api(const char* soid)
 
 const char* SoManager::get_so_options(const char* soid)
 {
+    if ( !so_workers.empty() )
+    {
+        const SoText* t = get_so_text(soid);
+        return (t and t->ok) ? t->opts.c_str() : nullptr;
+    }
+
     const SoApi* api = get_so_api(soid);
 
     if ( !api )
@@ -216,13 +295,64 @@ const char* SoManager::get_so_options(const char* soid)
     if ( !rule )
         return nullptr;
 
-    // FIXIT-L this approach won't tolerate spaces and might get
-    // fooled by matching content (should it precede this)
-    char opt[32];
-    snprintf(opt, sizeof(opt), "soid:%s;", soid);
-    const char* s = strstr(rule, opt);
+    return find_so_options(rule, soid);
+}
 
-    return s ? s + strlen(opt) : nullptr;
+void SoManager::prefetch_rules()
+{
+    if ( s_rules.empty() or !so_workers.empty() )
+        return;
+
+    so_start = chrono::steady_clock::now();
+
+    for ( auto* p : s_rules )
+    {
+        // first one wins, as with get_so_api()
+        if ( so_index.find(p->base.name) == so_index.end() )
+            so_index[p->base.name] = so_texts.size();
+
+        so_texts.push_back({ p, string(), false, 0 });
+    }
+
+    unsigned max = std::max(thread::hardware_concurrency(), 1u);
+    unsigned n = std::min(max, (unsigned)so_texts.size());
+
+    for ( unsigned i = 0; i < n; ++i )
+        so_workers.push_back(async(launch::async, expand_worker, i, n));
+}
+
+void SoManager::clear_prefetch(bool show)
+{
+    if ( so_workers.empty() )
+        return;
+
+    for ( auto& f : so_workers )
+        f.wait();
+
+    if ( show )
+    {
+        auto usecs = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - so_start).count();
+
+        LogMessage("so rules: %u expanded by %u threads in %u usecs\n",
+            (unsigned)so_texts.size(), (unsigned)so_workers.size(), (unsigned)usecs);
+
+        map<string, pair<unsigned, unsigned>> libs;
+
+        for ( auto& t : so_texts )
+        {
+            const char* src = PluginManager::get_source(PT_SO_RULE, t.api->base.name);
+            auto& lib = libs[src ? src : "static"];
+            ++lib.first;
+            lib.second += t.usecs;
+        }
+        for ( auto& lib : libs )
+            LogMessage("    %s: %u rules, %u usecs\n",
+                lib.first.c_str(), lib.second.first, lib.second.second);
+    }
+    so_workers.clear();
+    so_texts.clear();
+    so_index.clear();
 }
 
 SoEvalFunc SoManager::get_so_eval(const char* soid, const char* so, void** data)
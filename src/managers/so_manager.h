@@ -46,6 +46,11 @@ public:
     static SoEvalFunc get_so_eval(const char* soid, const char* so, void** data);
     static void delete_so_data(const char* soid, void*);
 
+    // expand the text of all so rules on helper threads so it is ready
+    // for get_so_options(); clear when the rules are parsed
+    static void prefetch_rules();
+    static void clear_prefetch(bool show);
+
     static void rule_to_hex(const char* file);
     static void rule_to_text(const char* file);
     static void dump_rule_stubs(const char*);
@@ -20,7 +20,17 @@
 
 #include "memory_allocator.h"
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/mman.h>
+
 #include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include "log/messages.h"
 
 namespace memory
 {
@@ -32,4 +42,106 @@ void* MemoryAllocator::allocate(size_t n)
 void MemoryAllocator::deallocate(void* p)
 { free(p); }
 
+// -----------------------------------------------------------------------------
+// large allocations
+// -----------------------------------------------------------------------------
+
+namespace
+{
+
+const size_t HUGE_PAGE_2M = 2 * 1024 * 1024;
+const size_t HUGE_PAGE_1G = 1024 * 1024 * 1024;
+
+bool use_huge_pages = false;
+
+// log the backing used once per user
+const unsigned MAX_USERS = 16;
+
+std::mutex log_mutex;
+const char* logged[MAX_USERS];
+unsigned num_logged = 0;
+
+void log_backing(const char* who, size_t n, const char* how)
+{
+    std::lock_guard<std::mutex> lock(log_mutex);
+
+    for ( unsigned i = 0; i < num_logged; ++i )
+        if ( !strcmp(logged[i], who) )
+            return;
+
+    if ( num_logged < MAX_USERS )
+        logged[num_logged++] = who;
+
+    LogMessage("memory: %s (%zu bytes) using %s\n", who, n, how);
+}
+
+inline size_t round_up(size_t n, size_t page)
+{ return (n + page - 1) & ~(page - 1); }
+
+void* map(size_t n, int flags)
+{
+    void* p = mmap(nullptr, n, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|flags, -1, 0);
+    return p == MAP_FAILED ? nullptr : p;
+}
+
+} // namespace
+
+void MemoryAllocator::set_huge_pages(bool b)
+{ use_huge_pages = b; }
+
+void* MemoryAllocator::allocate_large(size_t n, const char* who)
+{
+    if ( n < HUGE_PAGE_2M )
+        return calloc(1, n);
+
+    size_t len = round_up(n, HUGE_PAGE_2M);
+    void* p;
+
+    if ( use_huge_pages )
+    {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_1GB)
+        if ( len % HUGE_PAGE_1G == 0 and (p = map(len, MAP_HUGETLB|MAP_HUGE_1GB)) )
+        {
+            log_backing(who, n, "1G huge pages");
+            return p;
+        }
+#endif
+#ifdef MAP_HUGETLB
+        if ( (p = map(len, MAP_HUGETLB)) )
+        {
+            log_backing(who, n, "2M huge pages");
+            return p;
+        }
+#endif
+    }
+
+    if ( !(p = map(len, 0)) )
+        return nullptr;
+
+#ifdef MADV_HUGEPAGE
+    // no reserved huge pages so let the kernel promote these if it can
+    if ( use_huge_pages and !madvise(p, len, MADV_HUGEPAGE) )
+    {
+        log_backing(who, n, "transparent huge pages");
+        return p;
+    }
+#endif
+
+    if ( use_huge_pages )
+        log_backing(who, n, "normal pages");
+
+    return p;
+}
+
+void MemoryAllocator::deallocate_large(void* p, size_t n)
+{
+    if ( !p )
+        return;
+
+    if ( n < HUGE_PAGE_2M )
+        free(p);
+    else
+        munmap(p, round_up(n, HUGE_PAGE_2M));
+}
+
 } // namespace memory
@@ -30,6 +30,19 @@ struct MemoryAllocator
 {
     static void* allocate(size_t);
     static void deallocate(void*);
+
+    static void deallocate(void* p, size_t)
+    { deallocate(p); }
+
+    // zeroed memory for large, long lived tables.  anything of at least
+    // a huge page is mapped directly and, if enabled, backed by huge pages.
+    // who names the user in the log.  the size must be passed back to
+    // deallocate_large().  these bypass the memory cap.
+    static void* allocate_large(size_t, const char* who);
+    static void deallocate_large(void*, size_t);
+
+    // call from main thread
+    static void set_huge_pages(bool);
 };
 
 } // namespace memory
@@ -0,0 +1,332 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// memory_cache.cc
+
+#include "memory_cache.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cassert>
+#include <mutex>
+
+#include "main/thread.h"
+
+#include "memory_allocator.h"
+
+#ifdef UNIT_TEST
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "catch/catch.hpp"
+#endif
+
+namespace memory
+{
+
+namespace
+{
+
+// classes are multiples of 16 bytes so every object keeps malloc's
+// alignment; the sizes passed in include the Metadata header
+const size_t CLASS_GRAIN = 16;
+const unsigned NUM_CLASSES = CachingAllocator::MAX_SMALL / CLASS_GRAIN;
+
+// slabs are carved into objects of a single class when the central list
+// runs dry; the transfer batch is about 8K worth of objects
+const size_t SLAB_SIZE = 64 * 1024;
+const size_t BATCH_BYTES = 8 * 1024;
+
+struct Node
+{
+    Node* next;
+};
+
+// per thread; must be POD for THREAD_LOCAL
+struct FreeList
+{
+    Node* head;
+    unsigned count;
+};
+
+struct CentralList
+{
+    std::mutex lock;
+    Node* head = nullptr;
+    unsigned count = 0;
+};
+
+THREAD_LOCAL FreeList s_cache[NUM_CLASSES];
+CentralList s_central[NUM_CLASSES];
+
+inline unsigned class_index(size_t n)
+{ return (unsigned)((n - 1) / CLASS_GRAIN); }
+
+inline size_t class_size(unsigned i)
+{ return (i + 1) * CLASS_GRAIN; }
+
+inline unsigned batch_size(unsigned i)
+{
+    size_t n = BATCH_BYTES / class_size(i);
+    return n < 8 ? 8 : (n > 64 ? 64 : (unsigned)n);
+}
+
+// call with the central lock held
+bool carve(unsigned i, CentralList& c)
+{
+    char* slab = static_cast<char*>(MemoryAllocator::allocate(SLAB_SIZE));
+
+    if ( !slab )
+        return false;
+
+    size_t size = class_size(i);
+    unsigned n = SLAB_SIZE / size;
+
+    for ( unsigned k = 0; k < n; ++k )
+    {
+        Node* node = reinterpret_cast<Node*>(slab + k * size);
+        node->next = (k + 1 < n) ? reinterpret_cast<Node*>(slab + (k + 1) * size) : c.head;
+    }
+    c.head = reinterpret_cast<Node*>(slab);
+    c.count += n;
+    return true;
+}
+
+// move up to a batch from the central list to this thread
+bool refill(unsigned i, FreeList& fl)
+{
+    CentralList& c = s_central[i];
+    std::lock_guard<std::mutex> lock(c.lock);
+
+    if ( !c.head and !carve(i, c) )
+        return false;
+
+    unsigned batch = batch_size(i);
+    Node* first = c.head;
+    Node* last = first;
+    unsigned n = 1;
+
+    while ( n < batch and last->next )
+    {
+        last = last->next;
+        ++n;
+    }
+    c.head = last->next;
+    c.count -= n;
+
+    last->next = fl.head;
+    fl.head = first;
+    fl.count += n;
+    return true;
+}
+
+// move the first n cached objects back to the central list
+void release(unsigned i, FreeList& fl, unsigned n)
+{
+    assert(n and n <= fl.count);
+
+    Node* first = fl.head;
+    Node* last = first;
+
+    for ( unsigned k = 1; k < n; ++k )
+        last = last->next;
+
+    fl.head = last->next;
+    fl.count -= n;
+
+    CentralList& c = s_central[i];
+    std::lock_guard<std::mutex> lock(c.lock);
+
+    last->next = c.head;
+    c.head = first;
+    c.count += n;
+}
+
+} // namespace
+
+void* CachingAllocator::allocate(size_t n)
+{
+    if ( !n or n > MAX_SMALL )
+        return MemoryAllocator::allocate(n);
+
+    unsigned i = class_index(n);
+    FreeList& fl = s_cache[i];
+
+    if ( !fl.head and !refill(i, fl) )
+        return nullptr;
+
+    Node* node = fl.head;
+    fl.head = node->next;
+    fl.count--;
+    return node;
+}
+
+void CachingAllocator::deallocate(void* p, size_t n)
+{
+    if ( !n or n > MAX_SMALL )
+    {
+        MemoryAllocator::deallocate(p);
+        return;
+    }
+
+    unsigned i = class_index(n);
+    FreeList& fl = s_cache[i];
+
+    Node* node = static_cast<Node*>(p);
+    node->next = fl.head;
+    fl.head = node;
+
+    // keep a batch on hand so alternating alloc / free doesn't thrash
+    unsigned batch = batch_size(i);
+
+    if ( ++fl.count >= 2 * batch )
+        release(i, fl, batch);
+}
+
+void CachingAllocator::thread_term()
+{
+    for ( unsigned i = 0; i < NUM_CLASSES; ++i )
+    {
+        FreeList& fl = s_cache[i];
+
+        if ( fl.count )
+            release(i, fl, fl.count);
+    }
+}
+
+} // namespace memory
+
+#ifdef UNIT_TEST
+
+using memory::CachingAllocator;
+
+TEST_CASE( "caching allocator size classes", "[memory]" )
+{
+    SECTION( "reuse" )
+    {
+        void* p = CachingAllocator::allocate(40);
+        REQUIRE( p );
+        CachingAllocator::deallocate(p, 40);
+
+        // same class, most recently freed first
+        void* q = CachingAllocator::allocate(48);
+        CHECK( q == p );
+        CachingAllocator::deallocate(q, 48);
+    }
+
+    SECTION( "distinct classes" )
+    {
+        void* p = CachingAllocator::allocate(16);
+        void* q = CachingAllocator::allocate(17);
+        REQUIRE( p );
+        REQUIRE( q );
+        CHECK( p != q );
+        CHECK( ((uintptr_t)q & 0xF) == 0 );
+
+        CachingAllocator::deallocate(p, 16);
+        CachingAllocator::deallocate(q, 17);
+    }
+
+    SECTION( "large" )
+    {
+        void* p = CachingAllocator::allocate(CachingAllocator::MAX_SMALL + 1);
+        REQUIRE( p );
+        memset(p, 0xA5, CachingAllocator::MAX_SMALL + 1);
+        CachingAllocator::deallocate(p, CachingAllocator::MAX_SMALL + 1);
+    }
+
+    SECTION( "batches" )
+    {
+        // enough to span several slabs and transfers
+        const unsigned num = 5000;
+        const size_t sz = 200;
+        std::vector<char*> v;
+
+        for ( unsigned i = 0; i < num; ++i )
+        {
+            char* p = static_cast<char*>(CachingAllocator::allocate(sz));
+            REQUIRE( p );
+            memset(p, (char)i, sz);
+            v.push_back(p);
+        }
+
+        bool intact = true;
+
+        for ( unsigned i = 0; i < num; ++i )
+            for ( size_t k = 0; k < sz; ++k )
+                intact = intact and v[i][k] == (char)i;
+
+        CHECK( intact );
+
+        for ( auto p : v )
+            CachingAllocator::deallocate(p, sz);
+
+        CachingAllocator::thread_term();
+
+        char* p = static_cast<char*>(CachingAllocator::allocate(sz));
+        CHECK( p );
+        CachingAllocator::deallocate(p, sz);
+    }
+}
+
+TEST_CASE( "caching allocator threads", "[memory]" )
+{
+    const unsigned num = 2000;
+
+    // objects freed on another thread go to that thread's cache
+    std::vector<void*> shared;
+
+    for ( unsigned i = 0; i < num; ++i )
+        shared.push_back(CachingAllocator::allocate(64));
+
+    auto work = [](std::vector<void*>* give)
+    {
+        std::vector<void*> mine;
+
+        for ( unsigned r = 0; r < 10; ++r )
+        {
+            for ( unsigned i = 0; i < num; ++i )
+                mine.push_back(CachingAllocator::allocate(64 + (i % 4) * 16));
+
+            for ( unsigned i = 0; i < num; ++i )
+                CachingAllocator::deallocate(mine[i], 64 + (i % 4) * 16);
+
+            mine.clear();
+        }
+
+        if ( give )
+            for ( auto p : *give )
+                CachingAllocator::deallocate(p, 64);
+
+        CachingAllocator::thread_term();
+    };
+
+    std::thread t1(work, &shared);
+    std::thread t2(work, nullptr);
+    t1.join();
+    t2.join();
+
+    void* p = CachingAllocator::allocate(64);
+    CHECK( p );
+    CachingAllocator::deallocate(p, 64);
+}
+
+#endif
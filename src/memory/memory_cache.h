@@ -0,0 +1,50 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// memory_cache.h
+
+#ifndef MEMORY_CACHE_H
+#define MEMORY_CACHE_H
+
+// size class allocator for the small, short lived objects that dominate
+// the packet path.  each thread keeps a free list per class and moves
+// objects to and from a locked central pool in batches; the central pool
+// is refilled by carving slabs from the system allocator.  anything over
+// MAX_SMALL goes straight to MemoryAllocator.  slabs are never returned.
+
+#include <cstddef>
+
+namespace memory
+{
+
+struct CachingAllocator
+{
+    static void* allocate(size_t);
+
+    // the size must be the one passed to allocate()
+    static void deallocate(void*, size_t);
+
+    // return this thread's cached objects to the central pool
+    static void thread_term();
+
+    static const size_t MAX_SMALL = 1024;
+};
+
+} // namespace memory
+
+#endif
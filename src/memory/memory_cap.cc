@@ -32,6 +32,7 @@
 #include "main/thread.h"
 #include "profiler/memory_profiler_active_context.h"
 
+#include "memory_allocator.h"
 #include "memory_config.h"
 #include "memory_module.h"
 #include "prune_handler.h"
@@ -119,6 +120,7 @@ inline size_t calculate_threshold(size_t cap, size_t threshold)
 
 size_t MemoryCap::thread_cap = 0;
 size_t MemoryCap::preemptive_threshold = 0;
+size_t MemoryCap::target_threshold = 0;
 
 // -----------------------------------------------------------------------------
 // public interface
@@ -148,6 +150,18 @@ void MemoryCap::update_deallocations(size_t n)
     mp_active_context.update_deallocs(n);
 }
 
+void MemoryCap::track_allocations(size_t n)
+{ s_tracker.allocate(n); }
+
+void MemoryCap::track_deallocations(size_t n)
+{ s_tracker.deallocate(n); }
+
+void MemoryCap::profile_allocations(size_t n)
+{ mp_active_context.update_allocs(n); }
+
+void MemoryCap::profile_deallocations(size_t n)
+{ mp_active_context.update_deallocs(n); }
+
 bool MemoryCap::over_threshold()
 {
     if ( !preemptive_threshold )
@@ -156,6 +170,18 @@ bool MemoryCap::over_threshold()
     return s_tracker.used() >= preemptive_threshold;
 }
 
+bool MemoryCap::under_target()
+{ return s_tracker.used() <= target_threshold; }
+
+unsigned MemoryCap::pressure()
+{
+    if ( !thread_cap )
+        return 0;
+
+    auto used = s_tracker.used();
+    return ( used >= thread_cap ) ? 100 : (unsigned)(used * 100 / thread_cap);
+}
+
 // FIXIT-L this should not be called while the packet threads are running.
 // once reload is implemented for the memory manager, the configuration
 // model will need to be updated
@@ -166,9 +192,11 @@ void MemoryCap::calculate(unsigned num_threads)
 
     assert(!is_packet_thread());
 
+    MemoryAllocator::set_huge_pages(config.huge_pages);
+
     if ( !config.cap )
     {
-        thread_cap = preemptive_threshold = 0;
+        thread_cap = preemptive_threshold = target_threshold = 0;
         return;
     }
 
@@ -193,6 +221,10 @@ void MemoryCap::calculate(unsigned num_threads)
         preemptive_threshold = memory::calculate_threshold(thread_cap, config.threshold);
         DebugFormat(DEBUG_MEMORY,
             "per-thread pre-emptive action threshold set to %zu\n", preemptive_threshold);
+
+        // the target can't be above the threshold
+        target_threshold = ( config.target and config.target < config.threshold ) ?
+            memory::calculate_threshold(thread_cap, config.target) : preemptive_threshold;
     }
 }
 
@@ -204,8 +236,11 @@ void MemoryCap::print()
     LogMessage("    global cap: %zu\n", config.cap);
     LogMessage("    global preemptive threshold percent: %zu\n", config.threshold);
     LogMessage("    cap type: %s\n", config.soft? "soft" : "hard");
+    LogMessage("    huge pages: %s\n", config.huge_pages ? "enabled" : "disabled");
     LogMessage("    thread cap: %zu\n", thread_cap);
     LogMessage("    preemptive threshold: %zu\n", preemptive_threshold);
+    LogMessage("    prune target: %zu\n", target_threshold);
+    LogMessage("    prune budget: %u\n", config.prune_budget);
     LogMessage("    main thread usage: %zu\n", s_tracker.used());
     LogMessage("\n");
 }
@@ -244,6 +279,38 @@ struct HandlerSpy
         modifier(n), tracker(&trk) { }
 };
 
+// a cap of limit bytes that records what it was charged
+struct CapSpy
+{
+    static bool free_space(size_t n)
+    { ++checks; return tracked + n <= limit; }
+
+    static void track_allocations(size_t n)
+    { tracked += n; }
+
+    static void track_deallocations(size_t n)
+    { tracked -= n; }
+
+    static void profile_allocations(size_t n)
+    { profiled += n; }
+
+    static void profile_deallocations(size_t n)
+    { profiled -= n; }
+
+    static void reset(size_t n)
+    { limit = n; tracked = profiled = checks = 0; }
+
+    static size_t limit;
+    static size_t tracked;
+    static size_t profiled;
+    static unsigned checks;
+};
+
+size_t CapSpy::limit = 0;
+size_t CapSpy::tracked = 0;
+size_t CapSpy::profiled = 0;
+unsigned CapSpy::checks = 0;
+
 } // namespace t_memory_cap
 
 TEST_CASE( "memory cap free space", "[memory]" )
@@ -295,4 +362,63 @@ TEST_CASE( "memory cap free space", "[memory]" )
     }
 }
 
+TEST_CASE( "memory cap batches", "[memory]" )
+{
+    using namespace t_memory_cap;
+    using Cap = memory::BatchedCap<CapSpy>;
+    const size_t batch = Cap::BATCH;
+
+    Cap::credit = Cap::reserve = 0;
+
+    SECTION( "charges in batches" )
+    {
+        CapSpy::reset(1024 * 1024);
+
+        for ( unsigned i = 0; i < 100; ++i )
+        {
+            REQUIRE( Cap::free_space(100) );
+            Cap::update_allocations(100);
+        }
+
+        CHECK( CapSpy::profiled == 10000 );
+        CHECK( CapSpy::tracked == 100 + batch );
+        CHECK( CapSpy::checks == 1 );
+
+        for ( unsigned i = 0; i < 100; ++i )
+            Cap::update_deallocations(100);
+
+        // the credit stays below 2 batches
+        CHECK( CapSpy::profiled == 0 );
+        CHECK( CapSpy::tracked == 100 + batch );
+        CHECK( Cap::credit == 100 + batch );
+
+        for ( unsigned i = 0; i < 400; ++i )
+        {
+            REQUIRE( Cap::free_space(100) );
+            Cap::update_allocations(100);
+        }
+        for ( unsigned i = 0; i < 400; ++i )
+            Cap::update_deallocations(100);
+
+        CHECK( CapSpy::profiled == 0 );
+        CHECK( Cap::credit <= 2 * batch );
+        CHECK( CapSpy::tracked == Cap::credit );
+    }
+
+    SECTION( "near the cap" )
+    {
+        CapSpy::reset(batch / 2);
+
+        REQUIRE( Cap::free_space(100) );
+        Cap::update_allocations(100);
+        CHECK( CapSpy::tracked == 100 );
+        CHECK( Cap::credit == 0 );
+
+        CHECK_FALSE( Cap::free_space(batch) );
+        CHECK( CapSpy::tracked == 100 );
+    }
+
+    Cap::credit = Cap::reserve = 0;
+}
+
 #endif
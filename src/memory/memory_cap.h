@@ -23,6 +23,8 @@
 
 #include <cstddef>
 
+#include "main/thread.h"
+
 namespace memory
 {
 
@@ -33,8 +35,20 @@ public:
     static void update_allocations(size_t);
     static void update_deallocations(size_t);
 
+    // update_* is track_* plus profile_*; BatchedCap calls them separately
+    static void track_allocations(size_t);
+    static void track_deallocations(size_t);
+    static void profile_allocations(size_t);
+    static void profile_deallocations(size_t);
+
     static bool over_threshold();
 
+    // true once usage is back down to the target after crossing the threshold
+    static bool under_target();
+
+    // percent of the thread cap in use; 0 if there is no cap
+    static unsigned pressure();
+
     // call from main thread
     static void calculate(unsigned num_threads);
 
@@ -44,8 +58,95 @@ public:
 private:
     static size_t thread_cap;
     static size_t preemptive_threshold;
+    static size_t target_threshold;
 };
 
+// charges the underlying cap in chunks of BATCH bytes instead of on every
+// call.  each thread holds a credit of bytes charged but not yet in use;
+// allocations draw it down and deallocations build it back up until the
+// excess is returned.  the cap is therefore exceeded by at most BATCH per
+// thread and the tracker reads high by at most 2 * BATCH.  the memory
+// profiler is still updated on every call.
+template<typename Cap>
+struct BatchedCap
+{
+    static bool free_space(size_t);
+    static void update_allocations(size_t);
+    static void update_deallocations(size_t);
+
+    static const size_t BATCH = 16 * 1024;
+
+    // bytes charged to Cap but not in use
+    static THREAD_LOCAL size_t credit;
+
+    // the charge approved by the last free_space()
+    static THREAD_LOCAL size_t reserve;
+};
+
+template<typename Cap>
+bool BatchedCap<Cap>::free_space(size_t n)
+{
+    if ( n <= credit )
+    {
+        reserve = 0;
+        return true;
+    }
+
+    // try for a full batch, then settle for what is needed near the cap
+    size_t need = n - credit;
+
+    if ( Cap::free_space(need + BATCH) )
+        reserve = need + BATCH;
+
+    else if ( Cap::free_space(need) )
+        reserve = need;
+
+    else
+        return false;
+
+    return true;
+}
+
+template<typename Cap>
+void BatchedCap<Cap>::update_allocations(size_t n)
+{
+    Cap::profile_allocations(n);
+
+    if ( reserve )
+    {
+        Cap::track_allocations(reserve);
+        credit += reserve;
+        reserve = 0;
+    }
+
+    // free_space() may have been bypassed
+    if ( n > credit )
+    {
+        Cap::track_allocations(n - credit);
+        credit = n;
+    }
+    credit -= n;
+}
+
+template<typename Cap>
+void BatchedCap<Cap>::update_deallocations(size_t n)
+{
+    Cap::profile_deallocations(n);
+    credit += n;
+
+    if ( credit > 2 * BATCH )
+    {
+        Cap::track_deallocations(credit - BATCH);
+        credit = BATCH;
+    }
+}
+
+template<typename Cap>
+THREAD_LOCAL size_t BatchedCap<Cap>::credit = 0;
+
+template<typename Cap>
+THREAD_LOCAL size_t BatchedCap<Cap>::reserve = 0;
+
 } // namespace memory
 
 #endif
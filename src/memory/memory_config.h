@@ -28,6 +28,9 @@ struct MemoryConfig
     size_t cap = 0;
     bool soft = false;
     size_t threshold = 0;
+    size_t target = 0;
+    unsigned prune_budget = 16;
+    bool huge_pages = false;
 
     constexpr MemoryConfig() = default;
 };
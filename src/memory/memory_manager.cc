@@ -27,8 +27,10 @@
 #include <cassert>
 
 #include "main/thread.h"
+#include "profiler/memory_sampler.h"
 
 #include "memory_allocator.h"
+#include "memory_cache.h"
 #include "memory_cap.h"
 
 #ifdef UNIT_TEST
@@ -52,6 +54,7 @@ struct Metadata
     size_t total_size() const;
     void* payload_offset();
     bool valid() const;
+    bool sampled() const;
 
     Metadata(size_t = 0);
 
@@ -63,6 +66,9 @@ struct Metadata
     static Metadata* extract(void*);
 
     static size_t SANITY_CHECK_VALUE;
+
+    // sanity of allocations tracked by the memory sampler
+    static size_t SAMPLED_CHECK_VALUE;
 };
 
 inline size_t Metadata::total_size() const
@@ -72,7 +78,10 @@ inline void* Metadata::payload_offset()
 { return this + 1; }
 
 inline bool Metadata::valid() const
-{ return sanity == SANITY_CHECK_VALUE; }
+{ return sanity == SANITY_CHECK_VALUE or sanity == SAMPLED_CHECK_VALUE; }
+
+inline bool Metadata::sampled() const
+{ return sanity == SAMPLED_CHECK_VALUE; }
 
 inline Metadata::Metadata(size_t n) :
     sanity(SANITY_CHECK_VALUE), payload_size(n)
@@ -109,6 +118,7 @@ Metadata* Metadata::extract(void* p)
 }
 
 size_t Metadata::SANITY_CHECK_VALUE = 0xabcdef;
+size_t Metadata::SAMPLED_CHECK_VALUE = 0xabcdee;
 
 // -----------------------------------------------------------------------------
 // the meat
@@ -132,7 +142,7 @@ private:
     bool& flag;
 };
 
-template<typename Allocator = MemoryAllocator, typename Cap = MemoryCap>
+template<typename Allocator = CachingAllocator, typename Cap = BatchedCap<MemoryCap>>
 struct Interface
 {
     static void* allocate(size_t);
@@ -156,7 +166,12 @@ void* Interface<Allocator, Cap>::allocate(size_t n)
         return nullptr;
 
     Cap::update_allocations(meta->total_size());
-    return meta->payload_offset();
+    auto p = meta->payload_offset();
+
+    if ( MemorySampler::due(n) and MemorySampler::record(p, n) )
+        meta->sanity = Metadata::SAMPLED_CHECK_VALUE;
+
+    return p;
 }
 
 template<typename Allocator, typename Cap>
@@ -168,8 +183,13 @@ void Interface<Allocator, Cap>::deallocate(void* p)
     auto meta = Metadata::extract(p);
     assert(meta);
 
-    Cap::update_deallocations(meta->total_size());
-    Allocator::deallocate(meta);
+    // before the memory can be reused and sampled again
+    if ( meta->sampled() )
+        MemorySampler::forget(p);
+
+    auto n = meta->total_size();
+    Cap::update_deallocations(n);
+    Allocator::deallocate(meta, n);
 }
 
 template<typename Allocator, typename Cap>
@@ -227,8 +247,8 @@ struct AllocatorSpy
     static void* allocate(size_t n)
     { allocate_called = true; allocate_arg = n; return pool; }
 
-    static void deallocate(void* p)
-    { deallocate_called = true; deallocate_arg = p; }
+    static void deallocate(void* p, size_t n)
+    { deallocate_called = true; deallocate_arg = p; deallocate_size = n; }
 
     static void reset()
     {
@@ -237,6 +257,7 @@ struct AllocatorSpy
         allocate_arg = 0;
         deallocate_called = false;
         deallocate_arg = nullptr;
+        deallocate_size = 0;
     }
 
     static void* pool;
@@ -244,6 +265,7 @@ struct AllocatorSpy
     static size_t allocate_arg;
     static bool deallocate_called;
     static void* deallocate_arg;
+    static size_t deallocate_size;
 };
 
 void* AllocatorSpy::pool = nullptr;
@@ -251,6 +273,7 @@ bool AllocatorSpy::allocate_called = false;
 size_t AllocatorSpy::allocate_arg = 0;
 bool AllocatorSpy::deallocate_called = false;
 void* AllocatorSpy::deallocate_arg = nullptr;
+size_t AllocatorSpy::deallocate_size = 0;
 
 struct CapSpy
 {
@@ -427,6 +450,7 @@ TEST_CASE( "memory manager interface", "[memory]" )
 
             CHECK( AllocatorSpy::deallocate_called );
             CHECK( AllocatorSpy::deallocate_arg == (void*)pool );
+            CHECK( AllocatorSpy::deallocate_size == memory::Metadata::calculate_total_size(n) );
             CHECK( CapSpy::update_deallocations_called );
             CHECK( CapSpy::update_deallocations_arg == memory::Metadata::calculate_total_size(n) );
         }
@@ -36,9 +36,19 @@ static const Parameter s_params[] =
     { "cap", Parameter::PT_INT, "0:", "0",
         "set the per-packet-thread cap on memory (bytes, 0 to disable)" },
 
+    { "huge_pages", Parameter::PT_BOOL, nullptr, "false",
+        "back large tables such as the flow hash with huge pages when available" },
+
     { "soft", Parameter::PT_BOOL, nullptr, "false",
         "always succeed in allocating memory, even if above the cap" },
 
+    { "prune_budget", Parameter::PT_INT, "1:", "16",
+        "maximum pruning work per packet once over the threshold" },
+
+    { "target", Parameter::PT_INT, "0:100", "0",
+        "once over the threshold, prune back down to this percent of the "
+        "per-packet-thread cap (0 to use the threshold)" },
+
     { "threshold", Parameter::PT_INT, "0:", "0",
         "set the per-packet-thread threshold for preemptive cleanup actions "
         "(percent, 0 to disable)" },
@@ -59,9 +69,18 @@ bool MemoryModule::set(const char*, Value& v, SnortConfig* sc)
     if ( v.is("cap") )
         sc->memory->cap = v.get_long();
 
+    else if ( v.is("huge_pages") )
+        sc->memory->huge_pages = v.get_bool();
+
+    else if ( v.is("prune_budget") )
+        sc->memory->prune_budget = v.get_long();
+
     else if ( v.is("soft") )
         sc->memory->soft = v.get_bool();
 
+    else if ( v.is("target") )
+        sc->memory->target = v.get_long();
+
     else if ( v.is("threshold") )
         sc->memory->threshold = v.get_long();
 
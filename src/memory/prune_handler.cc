@@ -20,18 +20,195 @@
 
 #include "prune_handler.h"
 
-#include "flow/flow_cache.h"
-#include "flow/flow_control.h"
-#include "stream/stream.h"
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstring>
+#include <vector>
+
+#include "main/snort_config.h"
+#include "main/thread.h"
+
+#include "memory_cap.h"
+#include "memory_config.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
 
 namespace memory
 {
 
+namespace
+{
+
+struct ReclaimEntry
+{
+    const char* name;
+    unsigned priority;
+    unsigned cost;
+    Reclaimer reclaim;
+};
+
+// sorted by priority; only changed before the packet threads start
+std::vector<ReclaimEntry> s_reclaimers;
+
+THREAD_LOCAL bool s_reclaiming = false;
+
+// work down the list until the target is reached or the budget is spent.
+// returns false if more is needed on a later call.
+template<typename Cap>
+bool reclaim_some(const std::vector<ReclaimEntry>& list, unsigned budget)
+{
+    unsigned spent = 0;
+
+    for ( const auto& r : list )
+    {
+        while ( !Cap::under_target() )
+        {
+            // always make some progress even if the cost exceeds the budget
+            if ( spent and spent + r.cost > budget )
+                return false;
+
+            spent += r.cost;
+
+            if ( !r.reclaim(false) )
+                break;
+        }
+
+        if ( Cap::under_target() )
+            return true;
+    }
+
+    // nothing left to give
+    return true;
+}
+
+} // namespace
+
+void register_reclaimer(const char* name, unsigned priority, unsigned cost, Reclaimer f)
+{
+    for ( const auto& r : s_reclaimers )
+        if ( !strcmp(r.name, name) )
+            return;
+
+    auto it = s_reclaimers.begin();
+
+    while ( it != s_reclaimers.end() and it->priority <= priority )
+        ++it;
+
+    s_reclaimers.insert(it, { name, priority, cost, f });
+}
+
 void prune_handler()
 {
-    // assert(flow_con);
-    if ( flow_con )
-        flow_con->prune_one(PruneReason::MEMCAP, false);
+    for ( const auto& r : s_reclaimers )
+        if ( r.reclaim(true) )
+            return;
+}
+
+void reclaim()
+{
+    if ( !s_reclaiming )
+    {
+        if ( !MemoryCap::over_threshold() )
+            return;
+
+        s_reclaiming = true;
+    }
+
+    if ( reclaim_some<MemoryCap>(s_reclaimers, snort_conf->memory->prune_budget) )
+        s_reclaiming = false;
 }
 
 } // namespace memory
+
+#ifdef UNIT_TEST
+
+namespace t_prune_handler
+{
+
+struct MockCap
+{
+    static bool under_target()
+    { return used <= target; }
+
+    static size_t used;
+    static size_t target;
+};
+
+size_t MockCap::used = 0;
+size_t MockCap::target = 0;
+
+// each holds count items of 10 bytes; calls records the order of calls
+static unsigned counts[2];
+static std::vector<unsigned> calls;
+
+template<unsigned N>
+unsigned take(bool)
+{
+    calls.push_back(N);
+
+    if ( !counts[N] )
+        return 0;
+
+    counts[N]--;
+    MockCap::used -= 10;
+    return 1;
+}
+
+} // namespace t_prune_handler
+
+TEST_CASE( "memory reclaim", "[memory]" )
+{
+    using namespace t_prune_handler;
+
+    std::vector<memory::ReclaimEntry> list =
+    {
+        { "low", memory::RECLAIM_CACHE, 1, take<0> },
+        { "high", memory::RECLAIM_FLOW, 4, take<1> },
+    };
+
+    calls.clear();
+    counts[0] = 3;
+    counts[1] = 100;
+    MockCap::target = 1000;
+
+    SECTION( "low priority first" )
+    {
+        MockCap::used = 1020;
+        CHECK( memory::reclaim_some<MockCap>(list, 16) );
+        CHECK( calls == std::vector<unsigned>({ 0, 0 }) );
+        CHECK( counts[0] == 1 );
+        CHECK( counts[1] == 100 );
+    }
+
+    SECTION( "incremental" )
+    {
+        MockCap::used = 1100;
+
+        // 3 from low, 1 miss, then 2 from high and out of budget
+        CHECK_FALSE( memory::reclaim_some<MockCap>(list, 12) );
+        CHECK( calls == std::vector<unsigned>({ 0, 0, 0, 0, 1, 1 }) );
+        CHECK( MockCap::used == 1050 );
+
+        calls.clear();
+        CHECK_FALSE( memory::reclaim_some<MockCap>(list, 12) );
+        CHECK( MockCap::used == 1030 );
+
+        CHECK( memory::reclaim_some<MockCap>(list, 100) );
+        CHECK( MockCap::used == 1000 );
+        CHECK( counts[1] == 93 );
+    }
+
+    SECTION( "exhausted" )
+    {
+        counts[1] = 1;
+        MockCap::used = 2000;
+        CHECK( memory::reclaim_some<MockCap>(list, 1000) );
+        CHECK( MockCap::used == 1960 );
+    }
+}
+
+#endif
@@ -24,10 +24,31 @@
 namespace memory
 {
 
+// a reclaimer releases some of its subsystem's state on the calling thread
+// and returns the number of items released, 0 if it has nothing left.
+// in_allocation is true when called from the cap to make room for an
+// allocation in progress; the reclaimer must not allocate then.
+typedef unsigned (*Reclaimer)(bool in_allocation);
+
+// lower priorities are reclaimed first so they should hold the state that
+// is cheapest to lose
+const unsigned RECLAIM_CACHE = 10;   // state that can be learned again
+const unsigned RECLAIM_FLOW = 100;   // live sessions
+
+// call from main thread before the packet threads start.  cost is the work
+// charged against the per packet budget each time the reclaimer is called.
+// registering a name again is a no-op.
+void register_reclaimer(const char* name, unsigned priority, unsigned cost, Reclaimer);
+
+// called by the cap when an allocation would exceed it; releases one item
+// from the lowest priority reclaimer that has any
 void prune_handler();
 
-}
+// call once per packet.  after usage crosses the threshold this spends up
+// to the configured budget per call until usage is back under the target.
+void reclaim();
 
+}
 
 #endif
 
@@ -18,14 +18,34 @@
 //--------------------------------------------------------------------------
 // decode_b64.cc author Bhagyashree Bantwal <bbantwal@sourcefire.com>
 
+//
+// runs of pure base64 are decoded 16 or 32 characters at a time with the
+// pshufb range lookup from Mula and Lemire.  a block holding anything else,
+// including '=', falls back to the byte loop which handles skipping and
+// termination.
+
 #include "decode_b64.h"
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define B64_SIMD
+#endif
+
 #include "utils/util.h"
-#include "utils/util_unfold.h"
 
 #include "decode_base.h"
 #include "decode_buffer.h"
 
+#ifdef UNIT_TEST
+#include <string.h>
+#include <string>
+#include "catch/catch.hpp"
+#endif
+
+static int base64_decode(const uint8_t* inbuf, uint32_t inbuf_size,
+    uint8_t* outbuf, uint32_t outbuf_size, uint32_t* bytes_written,
+    uint8_t* group, uint32_t* group_len, uint32_t max_chars, uint32_t* chars_read);
+
 void B64Decode::reset_decode_state()
 {
     reset_decoded_bytes();
@@ -35,37 +55,21 @@ void B64Decode::reset_decode_state()
 DecodeResult B64Decode::decode_data(const uint8_t* start, const uint8_t* end)
 {
     uint32_t act_encode_size = 0, act_decode_size = 0;
-    uint32_t i = 0;
 
-    if (!buffer->check_restore_buffer())
+    if (!buffer->check_buffer())
     {
         reset_decode_state();
         return DECODE_EXCEEDED;
     }
 
-    uint32_t encode_avail = buffer->get_encode_avail() - buffer->get_prev_encoded_bytes();
+    /* The packet is decoded in place.  Only an incomplete group of 4 encoded chars is
+     * carried to the next packet.  This happens when base64 data is spanned across packets*/
+    uint32_t carry_size = buffer->get_prev_encoded_bytes();
+    uint32_t encode_avail = buffer->get_encode_avail() - carry_size;
 
-    if (sf_strip_CRLF(start, (end-start), buffer->get_encode_buff() + buffer->get_prev_encoded_bytes(),
-        encode_avail, &act_encode_size) != 0)
-    {
-        reset_decode_state();
-        return DECODE_FAIL;
-    }
-
-    act_encode_size = act_encode_size + buffer->get_prev_encoded_bytes();
-
-    i = (act_encode_size)%4;
-
-    /* Encoded data should be in multiples of 4. Then we need to wait for the remainder encoded data to
-     * successfully decode the base64 data. This happens when base64 data is spanned across packets*/
-    if (i)
-    {
-        act_encode_size = act_encode_size - i;
-        buffer->save_buffer(buffer->get_encode_buff() + act_encode_size, i);
-    }
-
-    if (sf_base64decode(buffer->get_encode_buff(), act_encode_size,
-        buffer->get_decode_buff(), buffer->get_decode_avail(), &act_decode_size) != 0)
+    if (base64_decode(start, (end-start), buffer->get_decode_buff(), buffer->get_decode_avail(),
+        &act_decode_size, buffer->get_carry(), &carry_size, buffer->get_encode_avail(),
+        &act_encode_size) != 0)
     {
         reset_decode_state();
         return DECODE_FAIL;
@@ -76,6 +80,9 @@ DecodeResult B64Decode::decode_data(const uint8_t* start, const uint8_t* end)
         return DECODE_FAIL;
     }
 
+    act_encode_size -= carry_size;
+    buffer->save_buffer(buffer->get_carry(), carry_size);
+
     decoded_bytes = act_decode_size;
     decodePtr = buffer->get_decode_buff();
     buffer->update_buffer(act_encode_size, act_decode_size);
@@ -114,6 +121,141 @@ uint8_t sf_decode64tab[256] =
     100,100,100,100,100,100,100,100,100,100,100,100,100,100,100,100
 };
 
+//-------------------------------------------------------------------------
+// block decode
+//
+// each returns the number of input characters consumed, a multiple of the
+// block size, and stops at the first block that isn't all alphabet.  out
+// must have room for the decoded bytes plus 4 scratch bytes.
+//-------------------------------------------------------------------------
+
+typedef uint32_t (* b64_block_f)(const uint8_t*, uint32_t, uint8_t*, uint32_t);
+
+static uint32_t b64_block_none(const uint8_t*, uint32_t, uint8_t*, uint32_t)
+{ return 0; }
+
+#ifdef B64_SIMD
+__attribute__((target("ssse3")))
+static uint32_t b64_block_ssse3(
+    const uint8_t* in, uint32_t in_len, uint8_t* out, uint32_t out_len)
+{
+    const __m128i lut_lo = _mm_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i pack = _mm_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m128i mask_2f = _mm_set1_epi8(0x2f);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+
+    uint32_t done = 0;
+
+    while ( in_len - done >= 16 and out_len >= 16 )
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + done));
+        __m128i hi = _mm_and_si128(_mm_srli_epi32(v, 4), nibble);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, _mm_and_si128(v, nibble));
+
+        __m128i bad = _mm_and_si128(lo, _mm_shuffle_epi8(lut_hi, hi));
+
+        if ( _mm_movemask_epi8(_mm_cmpgt_epi8(bad, _mm_setzero_si128())) )
+            break;
+
+        __m128i roll = _mm_shuffle_epi8(lut_roll,
+            _mm_add_epi8(_mm_cmpeq_epi8(v, mask_2f), hi));
+        v = _mm_add_epi8(v, roll);
+
+        v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+        v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+        v = _mm_shuffle_epi8(v, pack);
+
+        _mm_storeu_si128((__m128i*)out, v);
+        out += 12;
+        out_len -= 12;
+        done += 16;
+    }
+    return done;
+}
+
+__attribute__((target("avx2")))
+static uint32_t b64_block_avx2(
+    const uint8_t* in, uint32_t in_len, uint8_t* out, uint32_t out_len)
+{
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pack = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+
+    uint32_t done = 0;
+
+    // the second lane is stored at out + 12 and writes 4 scratch bytes
+    while ( in_len - done >= 32 and out_len >= 28 )
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(in + done));
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi32(v, 4), nibble);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(v, nibble));
+
+        if ( !_mm256_testz_si256(lo, _mm256_shuffle_epi8(lut_hi, hi)) )
+            break;
+
+        __m256i roll = _mm256_shuffle_epi8(lut_roll,
+            _mm256_add_epi8(_mm256_cmpeq_epi8(v, mask_2f), hi));
+        v = _mm256_add_epi8(v, roll);
+
+        v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+        v = _mm256_shuffle_epi8(v, pack);
+
+        _mm_storeu_si128((__m128i*)out, _mm256_castsi256_si128(v));
+        _mm_storeu_si128((__m128i*)(out + 12), _mm256_extracti128_si256(v, 1));
+        out += 24;
+        out_len -= 24;
+        done += 32;
+    }
+    return done + b64_block_ssse3(in + done, in_len - done, out, out_len);
+}
+#endif
+
+static uint32_t b64_block_init(const uint8_t*, uint32_t, uint8_t*, uint32_t);
+
+// every thread resolves to the same function so the race is benign
+static b64_block_f b64_block = b64_block_init;
+
+static uint32_t b64_block_init(
+    const uint8_t* in, uint32_t in_len, uint8_t* out, uint32_t out_len)
+{
+#ifdef B64_SIMD
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports("avx2") )
+        b64_block = b64_block_avx2;
+    else if ( __builtin_cpu_supports("ssse3") )
+        b64_block = b64_block_ssse3;
+    else
+#endif
+        b64_block = b64_block_none;
+
+    return b64_block(in, in_len, out, out_len);
+}
+
 /* base64decode assumes the input data terminates with '=' and/or at the end of the input buffer
  * at inbuf_size.  If extra characters exist within inbuf before inbuf_size is reached, it will
  * happily decode what it can and skip over what it can't.  This is consistent with other decoders
@@ -121,10 +263,15 @@ uint8_t sf_decode64tab[256] =
  * data is valid up until the point you care about.  Note base64 data does NOT have to end with
  * '=' and won't if the number of bytes of input data is evenly divisible by 3.
 */
-int sf_base64decode(uint8_t* inbuf, uint32_t inbuf_size, uint8_t* outbuf, uint32_t outbuf_size,
-    uint32_t* bytes_written)
+// group holds group_len chars of an incomplete group from the previous call
+// and returns the incomplete group left at the end of inbuf.  chars_read
+// counts all the base64 chars taken including those of the incomplete
+// groups, up to max_chars.
+static int base64_decode(const uint8_t* inbuf, uint32_t inbuf_size,
+    uint8_t* outbuf, uint32_t outbuf_size, uint32_t* bytes_written,
+    uint8_t* group, uint32_t* group_len, uint32_t max_chars, uint32_t* chars_read)
 {
-    uint8_t* cursor, * endofinbuf;
+    const uint8_t* cursor, * endofinbuf, * retry_block;
     uint8_t* outbuf_ptr;
     uint8_t base64data[4], * base64data_ptr; /* temporary holder for current base64 chunk */
     uint8_t tableval_a, tableval_b, tableval_c, tableval_d;
@@ -133,22 +280,56 @@ int sf_base64decode(uint8_t* inbuf, uint32_t inbuf_size, uint8_t* outbuf, uint32
     uint32_t max_base64_chars; /* The max number of decoded base64 chars that fit into outbuf */
 
     int error = 0;
+    bool stopped = false;
 
     /* This algorithm will waste up to 4 bytes but we really don't care.
        At the end we're going to copy the exact number of bytes requested. */
     max_base64_chars = (outbuf_size / 3) * 4 + 4; /* 4 base64 bytes gives 3 data bytes, plus
                                                     an extra 4 to take care of any rounding */
+    if (max_base64_chars > max_chars)
+        max_base64_chars = max_chars;
 
     base64data_ptr = base64data;
     endofinbuf = inbuf + inbuf_size;
 
     /* Strip non-base64 chars from inbuf and decode */
     n = 0;
+
+    while (n < *group_len and n < 3)
+        *base64data_ptr++ = group[n++];
+
     *bytes_written = 0;
     cursor = inbuf;
     outbuf_ptr = outbuf;
+    retry_block = inbuf;
     while ((cursor < endofinbuf) && (n < max_base64_chars))
     {
+        /* At a group boundary try to take whole blocks at once.  Blocks
+           stop short of the output end so the byte loop still does any
+           truncation and padding. */
+        if ((base64data_ptr == base64data) && (cursor >= retry_block))
+        {
+            uint32_t in_len = endofinbuf - cursor;
+            uint32_t in_max = max_base64_chars - n;
+            uint32_t used;
+
+            if (in_len > in_max)
+                in_len = in_max;
+
+            used = b64_block(cursor, in_len, outbuf_ptr, outbuf_size - *bytes_written);
+
+            if (used)
+            {
+                cursor += used;
+                n += used;
+                outbuf_ptr += used / 4 * 3;
+                *bytes_written += used / 4 * 3;
+                continue;
+            }
+            /* Let the byte loop get past whatever stopped the block */
+            retry_block = cursor + 32;
+        }
+
         if (sf_decode64tab[*cursor] != 100)
         {
             *base64data_ptr++ = *cursor;
@@ -161,6 +342,7 @@ int sf_base64decode(uint8_t* inbuf, uint32_t inbuf_size, uint8_t* outbuf, uint32
                 {
                     /* Error in input data */
                     error = 1;
+                    stopped = true;
                     break;
                 }
 
@@ -183,6 +365,7 @@ int sf_base64decode(uint8_t* inbuf, uint32_t inbuf_size, uint8_t* outbuf, uint32
                 }
                 else
                 {
+                    stopped = true;
                     break;
                 }
 
@@ -193,6 +376,7 @@ int sf_base64decode(uint8_t* inbuf, uint32_t inbuf_size, uint8_t* outbuf, uint32
                 }
                 else
                 {
+                    stopped = true;
                     break;
                 }
 
@@ -203,9 +387,82 @@ int sf_base64decode(uint8_t* inbuf, uint32_t inbuf_size, uint8_t* outbuf, uint32
         cursor++;
     }
 
+    /* Keep what we have of the group only if the data may continue */
+    if (stopped or cursor < endofinbuf)
+        *group_len = 0;
+    else
+    {
+        *group_len = base64data_ptr - base64data;
+        for (uint32_t i = 0; i < *group_len; ++i)
+            group[i] = base64data[i];
+    }
+
+    *chars_read = n;
+
     if (error)
         return(-1);
     else
         return(0);
 }
 
+int sf_base64decode(uint8_t* inbuf, uint32_t inbuf_size, uint8_t* outbuf, uint32_t outbuf_size,
+    uint32_t* bytes_written)
+{
+    uint32_t group_len = 0, chars_read;
+
+    return base64_decode(inbuf, inbuf_size, outbuf, outbuf_size, bytes_written,
+        nullptr, &group_len, UINT32_MAX, &chars_read);
+}
+
+
+#ifdef UNIT_TEST
+TEST_CASE("base64 blocks", "[mime]")
+{
+    // 64 characters takes the block path, the rest the byte loop
+    uint8_t in[] =
+        "VGhlIHF1aWNrIGJyb3duIGZveCBqdW1wcyBvdmVyIHRoZSBsYXp5IGRvZyBhZ2Fp"
+        "bi4 -g\r\nTw==";
+    const char* expect = "The quick brown fox jumps over the lazy dog again. O";
+
+    uint8_t out[64];
+    uint32_t n = 0;
+
+    REQUIRE(sf_base64decode(in, sizeof(in) - 1, out, sizeof(out), &n) == 0);
+    CHECK(n == strlen(expect));
+    CHECK(!memcmp(out, expect, n));
+
+    // output limit is exact even when blocks could run past it
+    REQUIRE(sf_base64decode(in, sizeof(in) - 1, out, 10, &n) == 0);
+    CHECK(n == 10);
+    CHECK(!memcmp(out, expect, n));
+
+    uint8_t bad[] = "VGhl=GhlVGhlVGhlVGhlVGhlVGhlVGhlVGhl";
+    CHECK(sf_base64decode(bad, sizeof(bad) - 1, out, sizeof(out), &n) == -1);
+}
+
+TEST_CASE("base64 across packets", "[mime]")
+{
+    // groups split by line breaks and packet boundaries
+    const char* pkts[] = { "VGhlIHF1a", "WNr\r\nIGJy", "b", "3duIGZveA==" };
+    std::string got;
+
+    B64Decode b64(0);
+
+    for ( auto pkt : pkts )
+    {
+        const uint8_t* s = (const uint8_t*)pkt;
+        REQUIRE(b64.decode_data(s, s + strlen(pkt)) == DECODE_SUCCESS);
+
+        uint8_t* buf = nullptr;
+        uint32_t size = 0;
+
+        if ( b64.get_decoded_data(&buf, &size) )
+            got.append((char*)buf, size);
+
+        b64.reset_decoded_bytes();
+    }
+    CHECK(got == "The quick brown fox");
+    DecodeBuffer::thread_term();
+}
+#endif
+
@@ -18,16 +18,44 @@
 //--------------------------------------------------------------------------
 // decode_buffer.cc author Bhagyashree Bantwal <bbantwal@sourcefire.com>
 
+#include <string.h>
+
 #include "decode_buffer.h"
+#include "main/thread.h"
 #include "utils/util.h"
 
+static THREAD_LOCAL uint8_t* encode_chunk = nullptr;
+static THREAD_LOCAL uint8_t* decode_chunk = nullptr;
+
+uint8_t* DecodeBuffer::get_encode_buff()
+{
+    if (!encode_chunk)
+        encode_chunk = (uint8_t*)snort_alloc(DECODE_CHUNK_SIZE);
+    return encode_chunk;
+}
+
+uint8_t* DecodeBuffer::get_decode_buff()
+{
+    if (!decode_chunk)
+        decode_chunk = (uint8_t*)snort_alloc(DECODE_CHUNK_SIZE);
+    return decode_chunk;
+}
+
+void DecodeBuffer::thread_term()
+{
+    if (encode_chunk)
+        snort_free(encode_chunk);
+    if (decode_chunk)
+        snort_free(decode_chunk);
+    encode_chunk = decode_chunk = nullptr;
+}
+
 void DecodeBuffer::reset()
 {
     prev_encoded_bytes = 0;
-    prev_encoded_buf = nullptr;
 }
 
-bool DecodeBuffer::check_restore_buffer()
+bool DecodeBuffer::check_buffer()
 {
     // 1. Stop decoding when we have reached either the decode depth or encode depth.
     // 2. Stop decoding when we are out of memory
@@ -36,31 +64,27 @@ bool DecodeBuffer::check_restore_buffer()
 
     uint32_t encode_avail =  get_encode_avail();
 
-    if (encode_avail ==0 || decode_avail ==0 ||
-        (!encodeBuf) || (!decodeBuf))
+    if (encode_avail ==0 || decode_avail ==0 || code_depth < 0)
     {
         return false;
     }
 
-    /*The non decoded encoded data in the previous packet is required for successful decoding
-     * in case of data spanned across packets*/
-
-    if ( !prev_encoded_bytes )
-        return true;
-
     if (prev_encoded_bytes > encode_avail)
         prev_encoded_bytes = encode_avail;
 
+    return true;
+}
 
-    uint32_t prev_bytes = prev_encoded_bytes;
+bool DecodeBuffer::check_restore_buffer()
+{
+    if (!check_buffer())
+        return false;
 
-    uint32_t i = 0;
-    while (prev_bytes)
-    {
-        encodeBuf[i] = prev_encoded_buf[i];
-        i++;
-        prev_bytes--;
-    }
+    /*The non decoded encoded data in the previous packet is required for successful decoding
+     * in case of data spanned across packets*/
+
+    if ( prev_encoded_bytes )
+        memcpy(get_encode_buff(), carry, prev_encoded_bytes);
 
     return true;
 }
@@ -101,21 +125,6 @@ DecodeBuffer::DecodeBuffer(int max_depth)
     code_depth = max_depth;
     encode_bytes_read = decode_bytes_read = 0;
     prev_encoded_bytes = 0;
-    prev_encoded_buf = nullptr;
-
-    if (max_depth < 0)
-        return;
-
-    encodeBuf = (uint8_t*)snort_calloc(buf_size);
-    decodeBuf = (uint8_t*)snort_calloc(buf_size);
-}
-
-DecodeBuffer::~DecodeBuffer()
-{
-    if (encodeBuf)
-        snort_free(encodeBuf);
-    if (decodeBuf)
-        snort_free(decodeBuf);
 }
 
 void DecodeBuffer::update_buffer(uint32_t act_encode_size, uint32_t act_decode_size)
@@ -124,8 +133,12 @@ void DecodeBuffer::update_buffer(uint32_t act_encode_size, uint32_t act_decode_s
     decode_bytes_read += act_decode_size;
 }
 
-void DecodeBuffer::save_buffer(uint8_t* buff, uint32_t buff_size)
+void DecodeBuffer::save_buffer(const uint8_t* buff, uint32_t buff_size)
 {
+    if (buff_size > sizeof(carry))
+        buff_size = sizeof(carry);
+
+    // buff may already be the carry
+    memmove(carry, buff, buff_size);
     prev_encoded_bytes = buff_size;
-    prev_encoded_buf = buff;
 }
@@ -21,39 +21,52 @@
 #define DECODE_BUFFER_H
 
 // Manage decode/encode buffers
+//
+// The encode staging and decode output buffers are shared by all sessions
+// on a packet thread since decoded data is consumed (file processing and
+// file_data) before the next packet is decoded.  Each session only keeps
+// the few encoded bytes that must carry over to its next packet.
 
 #include <stdlib.h>
 #include "main/snort_types.h"
 
+#define DECODE_CHUNK_SIZE 65536
+#define DECODE_CARRY_SIZE 128
+
 class DecodeBuffer
 {
 public:
     DecodeBuffer(int max_depth);
-    ~DecodeBuffer();
+
+    // Make sure decoding can continue (depths not reached)
+    bool check_buffer();
 
     // Make sure buffer is available and restore the buffer saved
     bool check_restore_buffer();
 
-    // Save buffer for future use (restore)
-    void save_buffer(uint8_t* buff, uint32_t buff_size);
+    // Save buffer for future use (restore); anything beyond the carry
+    // size only remains once a depth is reached and is dropped
+    void save_buffer(const uint8_t* buff, uint32_t buff_size);
 
     // Move forward buffer pointer
     void update_buffer(uint32_t act_encode_size, uint32_t act_decode_size);
 
     void reset();
-    uint8_t* get_decode_buff() {return decodeBuf;}
-    uint8_t* get_encode_buff() {return encodeBuf;}
+    uint8_t* get_decode_buff();
+    uint8_t* get_encode_buff();
+    uint8_t* get_carry() {return carry;}
     uint32_t get_decode_bytes_read() {return decode_bytes_read;}
     uint32_t get_decode_avail();
     uint32_t get_encode_avail();
     uint32_t get_prev_encoded_bytes() {return prev_encoded_bytes;}
 
+    // release this thread's staging and output buffers
+    static void thread_term();
+
 private:
     uint32_t buf_size;
     uint32_t prev_encoded_bytes;
-    uint8_t* prev_encoded_buf;
-    uint8_t* encodeBuf = nullptr;
-    uint8_t* decodeBuf = nullptr;
+    uint8_t carry[DECODE_CARRY_SIZE];
     uint32_t encode_bytes_read;
     uint32_t decode_bytes_read;
     int code_depth;
@@ -18,8 +18,18 @@
 //--------------------------------------------------------------------------
 // decode_qp.cc author Bhagyashree Bantwal <bbantwal@sourcefire.com>
 
+//
+// most quoted-printable text is plain printable characters.  those runs are
+// checked and copied 16 bytes at a time; '=' and anything that gets dropped
+// go through the byte loop.
+
 #include "decode_qp.h"
 
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#define QP_SIMD
+#endif
+
 #include "utils/util.h"
 #include "utils/util_unfold.h"
 
@@ -91,6 +101,27 @@ QPDecode::~QPDecode()
 
 }
 
+#ifdef QP_SIMD
+// true if all 16 bytes are copied as is: printable except '=', or tab, cr, lf
+static inline bool qp_plain16(const char* src)
+{
+    __m128i v = _mm_loadu_si128((const __m128i*)src);
+
+    __m128i ok = _mm_and_si128(
+        _mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f)),
+        _mm_andnot_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f)),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('='))),
+            _mm_set1_epi8(-1)));
+
+    ok = _mm_or_si128(ok, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')))));
+
+    return _mm_movemask_epi8(ok) == 0xffff;
+}
+#endif
+
 int sf_qpdecode(char* src, uint32_t slen, char* dst, uint32_t dlen, uint32_t* bytes_read,
     uint32_t* bytes_copied)
 {
@@ -102,8 +133,27 @@ int sf_qpdecode(char* src, uint32_t slen, char* dst, uint32_t dlen, uint32_t* by
     *bytes_read = 0;
     *bytes_copied = 0;
 
+#ifdef QP_SIMD
+    uint32_t retry_block = 0;
+#endif
+
     while ( (*bytes_read < slen) && (*bytes_copied < dlen))
     {
+#ifdef QP_SIMD
+        if ( (*bytes_read >= retry_block) && (slen - *bytes_read >= 16) &&
+            (dlen - *bytes_copied >= 16) )
+        {
+            if ( qp_plain16(src + *bytes_read) )
+            {
+                _mm_storeu_si128((__m128i*)(dst + *bytes_copied),
+                    _mm_loadu_si128((const __m128i*)(src + *bytes_read)));
+                *bytes_read += 16;
+                *bytes_copied += 16;
+                continue;
+            }
+            retry_block = *bytes_read + 16;
+        }
+#endif
         ch = src[*bytes_read];
         *bytes_read += 1;
         if ( ch == '=' )
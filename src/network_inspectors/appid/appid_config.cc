@@ -73,6 +73,7 @@ AppIdModuleConfig::~AppIdModuleConfig()
     snort_free((void*)conf_file);
     snort_free((void*)app_stats_filename);
     snort_free((void*)app_detector_dir);
+    snort_free((void*)lua_cache_dir);
     snort_free((void*)thirdparty_appid_dir);
     pAppidActiveConfig = nullptr;
 
@@ -83,12 +83,18 @@ public:
     unsigned long app_stats_period = 0;
     unsigned long app_stats_rollover_size = 0;
     unsigned long app_stats_rollover_time = 0;
+    bool app_stats_compact = false;
     const char* app_detector_dir = nullptr;
+    const char* lua_cache_dir = nullptr;
     const char* thirdparty_appid_dir = nullptr;
     uint32_t instance_id = 0;
     uint32_t memcap = 0;
     bool debug = false;
     bool dump_ports = false;
+    uint32_t learn_cache_size = 0;
+    uint32_t learn_cache_ttl = 0;
+    uint32_t learn_cache_verify = 0;
+    uint32_t detection_packet_budget = 0;
 
     // FIXIT - configs below not set from appid preproc config...
     uint32_t disable_safe_search = 0;
@@ -214,17 +214,11 @@ void AppIdData::appSharedDataDelete()
 		snort_free(*(void**)&rna_service_subtype->version);
 		snort_free(rna_service_subtype);
 	}
-	if (candidate_service_list)
-	{
-		sflist_free(candidate_service_list);
-		candidate_service_list = nullptr;
-	}
+	delete candidate_service_list;
+	candidate_service_list = nullptr;
 
-	if (candidate_client_list)
-	{
-		sflist_free(candidate_client_list);
-		candidate_client_list = nullptr;
-	}
+	delete candidate_client_list;
+	candidate_client_list = nullptr;
 	snort_free(username);
 	snort_free(netbiosDomain);
 	snort_free(payloadVersion);
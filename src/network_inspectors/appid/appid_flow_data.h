@@ -28,6 +28,7 @@
 #include <ctime>
 
 #include "protocols/packet.h"
+#include "utils/intrusive_list.h"
 #include "utils/sflsq.h"
 
 #include "appid.h"
@@ -64,6 +65,77 @@ struct RNAServiceElement;
 struct RNAServiceSubtype;
 struct RNAClientAppModule;
 
+#define MAX_CANDIDATE_SERVICES 10
+#define MAX_CANDIDATE_CLIENTS 10
+
+// Detectors still being tried on a session.  The nodes are part of the
+// list so adding a candidate doesn't allocate; there is room for max.
+template<typename T, unsigned max>
+class CandidateList
+{
+public:
+    struct Node
+    {
+        const T* item;
+        IntrusiveLink<Node> link;
+        Node* spare_next;
+    };
+
+    CandidateList()
+    {
+        for ( auto& n : nodes )
+            spare.push(&n);
+    }
+
+    unsigned count() const
+    { return list.size(); }
+
+    Node* first() const
+    { return list.front(); }
+
+    // fetch the next before removing the current node
+    static Node* next(const Node* n)
+    { return List::next(n); }
+
+    bool contains(const T* t) const
+    {
+        for ( Node* n = list.front(); n; n = List::next(n) )
+            if ( n->item == t )
+                return true;
+
+        return false;
+    }
+
+    // false if full
+    bool add(const T* t)
+    {
+        Node* n = spare.pop();
+
+        if ( !n )
+            return false;
+
+        n->item = t;
+        list.push_back(n);
+        return true;
+    }
+
+    void remove(Node* n)
+    {
+        list.remove(n);
+        spare.push(n);
+    }
+
+private:
+    typedef IntrusiveList<Node, &Node::link> List;
+
+    List list;
+    IntrusiveQueue<Node, &Node::spare_next> spare;
+    Node nodes[max];
+};
+
+typedef CandidateList<RNAServiceElement, MAX_CANDIDATE_SERVICES> ServiceCandidates;
+typedef CandidateList<RNAClientAppModule, MAX_CANDIDATE_CLIENTS> ClientCandidates;
+
 enum RNA_INSPECTION_STATE
 {
     RNA_STATE_NONE = 0,
@@ -113,6 +185,7 @@ struct CommonAppIdData
 #define SCAN_HTTP_VENDOR_FLAG       (1<<6)
 #define SCAN_HTTP_XWORKINGWITH_FLAG (1<<7)
 #define SCAN_HTTP_CONTENT_TYPE_FLAG (1<<8)
+#define SCAN_LEARNED_FLAG           (1<<9)
 
 struct fflow_info
 {
@@ -237,7 +310,7 @@ public:
     RNAServiceSubtype* subtype = nullptr;
     AppIdServiceIDState* id_state = nullptr;
     char* netbios_name = nullptr;
-    SF_LIST* candidate_service_list = nullptr;
+    ServiceCandidates* candidate_service_list = nullptr;
     unsigned int num_candidate_services_tried = 0;
     int got_incompatible_services = 0;
 
@@ -248,7 +321,7 @@ public:
     /**RNAClientAppModule for identifying client detector*/
     const RNAClientAppModule* clientData = nullptr;
     RNA_INSPECTION_STATE rnaClientState = RNA_STATE_NONE;
-    SF_LIST* candidate_client_list = nullptr;
+    ClientCandidates* candidate_client_list = nullptr;
     unsigned int num_candidate_clients_tried = 0;
     bool tried_reverse_service = false;
 
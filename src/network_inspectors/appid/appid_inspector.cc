@@ -26,7 +26,9 @@
 #endif
 
 #include "profiler/profiler.h"
+#include "appid_stats.h"
 #include "fw_appid.h"
+#include "learned_app_cache.h"
 
 //-------------------------------------------------------------------------
 // class stuff
@@ -74,6 +76,11 @@ void AppIdInspector::show(SnortConfig*)
         config->app_stats_rollover_size);
     LogMessage("    appStats Rollover time: %lu secs\n",
         config->app_stats_rollover_time);
+    LogMessage("    appStats Compact:       %s\n",
+        config->app_stats_compact ? "yes" : "no");
+    if ( config->learn_cache_size )
+        LogMessage("    Learned Cache:          %u servers, %u secs\n",
+            config->learn_cache_size, config->learn_cache_ttl);
     LogMessage("\n");
 }
 
@@ -83,6 +90,7 @@ void AppIdInspector::eval(Packet* pkt)
 
     appid_stats.packets++;
     fwAppIdSearch(pkt);
+    appIdStatsIdleFlush();
 }
 
 //-------------------------------------------------------------------------
@@ -104,6 +112,12 @@ static void appid_inspector_init()
     AppIdData::init();
 }
 
+static void appid_inspector_tterm()
+{
+    learnedAppCacheFini();
+    appIdStatsThreadTerm();
+}
+
 static Inspector* appid_inspector_ctor(Module* m)
 {
     AppIdModule* mod = (AppIdModule*)m;
@@ -136,7 +150,7 @@ const InspectApi appid_inspector_api =
     appid_inspector_init, // pinit
     nullptr, // pterm
     nullptr, // tinit
-    nullptr, // tterm
+    appid_inspector_tterm, // tterm
     appid_inspector_ctor,
     appid_inspector_dtor,
     nullptr, // ssn
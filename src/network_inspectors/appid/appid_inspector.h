@@ -35,6 +35,7 @@ public:
     ~AppIdInspector();
 
     bool configure(SnortConfig*) override;
+    bool can_share() override { return true; }
     void show(SnortConfig*) override;
     void eval(Packet*) override;
 
@@ -66,6 +66,13 @@ const PegInfo appid_pegs[] =
     { "ssl_flows", "count of ssl flows discovered by appid" },
     { "telnet_flows", "count of telnet flows discovered by appid" },
     { "timbuktu_flows", "count of timbuktu flows discovered by appid" },
+    { "learned_hits", "count of flows identified from the learned cache" },
+    { "learned_adds", "count of new or changed learned cache entries" },
+    { "learned_expired", "count of learned cache entries that timed out" },
+    { "service_candidate_runs", "count of service detector calls from candidate lists" },
+    { "client_candidate_runs", "count of client detector calls from candidate lists" },
+    { "budget_exhausted", "count of flows that stopped detection at the packet budget" },
+    { "degraded_packets", "count of packets skipped by payload detection under latency" },
     { nullptr, nullptr }
 };
 
@@ -85,8 +92,12 @@ static const Parameter s_params[] =
       "max file size for AppId stats before rolling over the log file" },
     { "app_stats_rollover_time", Parameter::PT_INT, "0:", "86400",
       "max time period for collection AppId stats before rolling over the log file" },
+    { "app_stats_compact", Parameter::PT_BOOL, nullptr, "false",
+      "log AppId statistics records with app ids instead of app names" },
     { "app_detector_dir", Parameter::PT_STRING, nullptr, nullptr,
       "directory to load AppId detectors from" },
+    { "lua_cache_dir", Parameter::PT_STRING, nullptr, nullptr,
+      "directory to keep compiled lua detectors in across restarts" },
     { "instance_id", Parameter::PT_INT, "0:", "0",
       "instance id - need more details for what this is" },
     { "debug", Parameter::PT_BOOL, nullptr, "false",
@@ -95,6 +106,14 @@ static const Parameter s_params[] =
       "enable dump of AppId port information" },
     { "thirdparty_appid_dir", Parameter::PT_STRING, nullptr, nullptr,
       "directory to load thirdparty AppId detectors from" },
+    { "learn_cache_size", Parameter::PT_INT, "0:", "0",
+      "max servers per thread to remember detected apps for, 0 disables" },
+    { "learn_cache_ttl", Parameter::PT_INT, "1:", "300",
+      "seconds a learned server entry is used before detection runs again" },
+    { "learn_cache_verify", Parameter::PT_INT, "0:", "16",
+      "run full detection on every nth learned hit to confirm it, 0 never" },
+    { "detection_packet_budget", Parameter::PT_INT, "0:65535", "0",
+      "stop service and client detection on flows still undetected after this many packets, 0 never" },
 
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
@@ -144,8 +163,12 @@ bool AppIdModule::set(const char*, Value& v, SnortConfig*)
         config->app_stats_rollover_size = v.get_long();
     else if ( v.is("app_stats_rollover_time") )
         config->app_stats_rollover_time = v.get_long();
+    else if ( v.is("app_stats_compact") )
+        config->app_stats_compact = v.get_bool();
     else if ( v.is("app_detector_dir") )
         config->app_detector_dir = snort_strdup(v.get_string());
+    else if ( v.is("lua_cache_dir") )
+        config->lua_cache_dir = snort_strdup(v.get_string());
     else if ( v.is("thirdparty_appid_dir") )
         config->thirdparty_appid_dir = snort_strdup(v.get_string());
     else if ( v.is("instance_id") )
@@ -154,6 +177,14 @@ bool AppIdModule::set(const char*, Value& v, SnortConfig*)
         config->debug = v.get_bool();
     else if ( v.is("dump_ports") )
         config->dump_ports = v.get_bool();
+    else if ( v.is("learn_cache_size") )
+        config->learn_cache_size = v.get_long();
+    else if ( v.is("learn_cache_ttl") )
+        config->learn_cache_ttl = v.get_long();
+    else if ( v.is("learn_cache_verify") )
+        config->learn_cache_verify = v.get_long();
+    else if ( v.is("detection_packet_budget") )
+        config->detection_packet_budget = v.get_long();
     else
         return false;
 
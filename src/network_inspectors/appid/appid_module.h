@@ -67,6 +67,13 @@ struct AppIdStats
     PegCount ssl_flows;
     PegCount telnet_flows;
     PegCount timbuktu_flows;
+    PegCount learned_hits;
+    PegCount learned_adds;
+    PegCount learned_expired;
+    PegCount service_candidate_runs;
+    PegCount client_candidate_runs;
+    PegCount budget_exhausted;
+    PegCount degraded_packets;
 };
 
 extern THREAD_LOCAL AppIdStats appid_stats;
@@ -25,9 +25,14 @@
 #include <cstdio>
 #include <ctime>
 #include <cstdint>
+#include <mutex>
+#include <vector>
 
 #include "log/messages.h"
 #include "log/unified2.h"
+#include "main/thread.h"
+#include "time/packet_time.h"
+#include "time/periodic.h"
 #include "utils/sflsq.h"
 #include "utils/util.h"
 
@@ -45,9 +50,8 @@
 #define UNIFIED2_IDS_EVENT_APPSTAT 1
 #endif
 
-static time_t bucketStart;
-static time_t bucketInterval;
-static time_t bucketEnd;
+// an app stats record names the app unless compact output is selected
+#define UNIFIED2_IDS_EVENT_APPSTAT_COMPACT 2
 
 struct AppIdStatRecord
 {
@@ -87,7 +91,18 @@ struct StatsBucket
     uint32_t appRecordCnt;
 };
 
-static SF_LIST* currBuckets;
+// each packet thread fills its own buckets, keyed by the first packet time
+// of the sessions, and hands the list over when its period ends by packet
+// time.  the main thread merges the lists and writes the log each period.
+static time_t bucketInterval;
+static THREAD_LOCAL time_t threadBucketEnd;
+static THREAD_LOCAL SF_LIST* currBuckets;
+
+static std::mutex pendingMutex;
+static std::vector<SF_LIST*> pendingBuckets;
+
+// main thread only
+static time_t bucketEnd;
 static SF_LIST* logBuckets;
 
 static const char* appFilePath;
@@ -103,39 +118,127 @@ Serial_Unified2_Header header;
 static size_t rollSize;
 static time_t rollPeriod;
 static bool enableAppStats;
+static bool compactStats;
 
-static void endStats2Period(void);
-static void startStats2Period(time_t startTime);
-static struct StatsBucket* getStatsBucket(time_t startTime);
+static void appIdStatsRoll(void*);
+static struct StatsBucket* getStatsBucket(SF_LIST*& buckets, time_t startTime);
 static void dumpStats2(void);
 
 static void deleteRecord(void* record)
 { snort_free(record); }
 
-static inline time_t get_time()
+static inline time_t get_bucket_time(time_t t)
 {
-    auto now = time(nullptr);
-    return now - (now % bucketInterval);
+    return t - (t % bucketInterval);
 }
 
-void appIdStatsUpdate(AppIdData* session)
+static void addStatRecord(StatsBucket* bucket, uint32_t app_id,
+    uint32_t initiatorBytes, uint32_t responderBytes)
 {
-    if ( !enableAppStats )
+    AppIdStatRecord* record = (AppIdStatRecord*)fwAvlLookup(app_id, bucket->appsTree);
+    if ( !record )
+    {
+        record = (AppIdStatRecord*)snort_calloc(sizeof(struct AppIdStatRecord));
+        if (fwAvlInsert(app_id, record, bucket->appsTree) == 0)
+        {
+            record->app_id = app_id;
+            bucket->appRecordCnt += 1;
+#ifdef DEBUG_STATS
+            fprintf(SF_DEBUG_FILE, "New App: %u Count %u\n", record->app_id,
+                bucket->appRecordCnt);
+#endif
+        }
+        else
+        {
+            // FIXIT-M really? we just silently ignore an allocation failure?
+            snort_free(record);
+            record = nullptr;
+        }
+    }
+
+    if (record)
+    {
+        record->initiatorBytes += initiatorBytes;
+        record->responderBytes += responderBytes;
+    }
+}
+
+static void freeBuckets(SF_LIST* buckets)
+{
+    while (auto bucket = (StatsBucket*)sflist_remove_head(buckets))
+    {
+        fwAvlDeleteTree(bucket->appsTree, deleteRecord);
+        snort_free(bucket);
+    }
+    snort_free(buckets);
+}
+
+// packet thread: give the current buckets to the main thread
+static void handoffBuckets()
+{
+    if ( !currBuckets )
+        return;
+
+    if ( !currBuckets->count )
         return;
 
-    time_t now = get_time();
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    pendingBuckets.push_back(currBuckets);
+    currBuckets = nullptr;
+}
+
+// main thread: fold the handed off buckets into the log buckets
+static void mergePending()
+{
+    std::vector<SF_LIST*> lists;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        lists.swap(pendingBuckets);
+    }
 
-    if (now >= bucketEnd)
+    for ( auto list : lists )
     {
-        endStats2Period();
-        dumpStats2();
-        startStats2Period(now);
+        if ( !logBuckets or !logBuckets->count )
+        {
+            if ( logBuckets )
+                snort_free(logBuckets);
+            logBuckets = list;
+            continue;
+        }
+
+        SF_LNODE* lNode = nullptr;
+
+        for (auto bucket = (StatsBucket*)sflist_first(list, &lNode); lNode && bucket;
+            bucket = (StatsBucket*)sflist_next(&lNode))
+        {
+            StatsBucket* log = getStatsBucket(logBuckets, bucket->startTime);
+            if ( !log )
+                continue;
+
+            log->totalStats.txByteCnt += bucket->totalStats.txByteCnt;
+            log->totalStats.rxByteCnt += bucket->totalStats.rxByteCnt;
+
+            for (auto node = fwAvlFirst(bucket->appsTree); node; node = fwAvlNext(node))
+            {
+                auto record = (AppIdStatRecord*)node->data;
+                addStatRecord(log, record->app_id, record->initiatorBytes,
+                    record->responderBytes);
+            }
+        }
+        freeBuckets(list);
     }
+}
 
-    time_t bucketTime = session->stats.firstPktsecond -
-        (session->stats.firstPktsecond % bucketInterval);
+void appIdStatsUpdate(AppIdData* session)
+{
+    if ( !enableAppStats )
+        return;
 
-    StatsBucket* bucket = getStatsBucket(bucketTime);
+    appIdStatsIdleFlush();
+
+    time_t bucketTime = get_bucket_time(session->stats.firstPktsecond);
+
+    StatsBucket* bucket = getStatsBucket(currBuckets, bucketTime);
     if ( !bucket )
         return;
 
@@ -145,66 +248,16 @@ void appIdStatsUpdate(AppIdData* session)
     const uint32_t web_app_id = pickPayloadId(session);
     if (web_app_id > APP_ID_NONE)
     {
-        const uint32_t app_id = web_app_id;
-        AppIdStatRecord* record = (AppIdStatRecord*)fwAvlLookup(app_id, bucket->appsTree);
-        if ( !record )
-        {
-            record = (AppIdStatRecord*)snort_calloc(sizeof(struct AppIdStatRecord));
-            if (fwAvlInsert(app_id, record, bucket->appsTree) == 0)
-            {
-                record->app_id = app_id;
-                bucket->appRecordCnt += 1;
-#ifdef DEBUG_STATS
-                fprintf(SF_DEBUG_FILE, "New App: %u Count %u\n", record->app_id,
-                    bucket->appRecordCnt);
-#endif
-            }
-            else
-            {
-                // FIXIT-M really? we just silently ignore an allocation failure?
-                snort_free(record);
-                record = nullptr;
-            }
-        }
-
-        if (record)
-        {
-            record->initiatorBytes += session->stats.initiatorBytes;
-            record->responderBytes += session->stats.responderBytes;
-        }
+        addStatRecord(bucket, web_app_id, session->stats.initiatorBytes,
+            session->stats.responderBytes);
     }
 
     const uint32_t service_app_id = pickServiceAppId(session);
     if ((service_app_id) &&
         (service_app_id != web_app_id))
     {
-        const uint32_t app_id = service_app_id;
-        AppIdStatRecord* record = (AppIdStatRecord*)fwAvlLookup(app_id, bucket->appsTree);
-        if ( !record )
-        {
-            record = (AppIdStatRecord*)snort_calloc(sizeof(struct AppIdStatRecord));
-            if (fwAvlInsert(app_id, record, bucket->appsTree) == 0)
-            {
-                record->app_id = app_id;
-                bucket->appRecordCnt += 1;
-#ifdef DEBUG_STATS
-                fprintf(SF_DEBUG_FILE, "New App: %u Count %u\n", record->app_id,
-                    bucket->appRecordCnt);
-#endif
-            }
-            else
-            {
-                // FIXIT-M really? don't ignore insert failure? add a stat here
-                snort_free(record);
-                record = nullptr;
-            }
-        }
-
-        if (record)
-        {
-            record->initiatorBytes += session->stats.initiatorBytes;
-            record->responderBytes += session->stats.responderBytes;
-        }
+        addStatRecord(bucket, service_app_id, session->stats.initiatorBytes,
+            session->stats.responderBytes);
     }
 
     const uint32_t client_app_id = pickClientAppId(session);
@@ -212,34 +265,8 @@ void appIdStatsUpdate(AppIdData* session)
         && client_app_id != service_app_id
         && client_app_id != web_app_id)
     {
-        const uint32_t app_id = client_app_id;
-
-        AppIdStatRecord* record = (AppIdStatRecord*)fwAvlLookup(app_id, bucket->appsTree);
-        if ( !record )
-        {
-            record = (AppIdStatRecord*)snort_calloc(sizeof(struct AppIdStatRecord));
-            if (fwAvlInsert(app_id, record, bucket->appsTree) == 0)
-            {
-                record->app_id = app_id;
-                bucket->appRecordCnt += 1;
-#ifdef DEBUG_STATS
-                fprintf(SF_DEBUG_FILE, "New App: %u Count %u\n", record->app_id,
-                    bucket->appRecordCnt);
-#endif
-            }
-            else
-            {
-                // FIXIT-M really? we just silently ignore an allocation failure?
-                snort_free(record);
-                record = nullptr;
-            }
-        }
-
-        if (record)
-        {
-            record->initiatorBytes += session->stats.initiatorBytes;
-            record->responderBytes += session->stats.responderBytes;
-        }
+        addStatRecord(bucket, client_app_id, session->stats.initiatorBytes,
+            session->stats.responderBytes);
     }
 }
 
@@ -253,10 +280,19 @@ void appIdStatsInit(AppIdModuleConfig* config)
         rollPeriod = config->app_stats_rollover_time;
         rollSize = config->app_stats_rollover_size;
         bucketInterval = config->app_stats_period;
+        compactStats = config->app_stats_compact;
 
-        time_t now = get_time();
-        startStats2Period(now);
+        time_t now = time(nullptr);
+        bucketEnd = get_bucket_time(now) + bucketInterval;
         appfp = nullptr;
+
+        // main loop ticks are nominally 1 ms
+        static bool registered = false;
+        if ( !registered )
+        {
+            Periodic::register_handler(appIdStatsRoll, nullptr, 0, 1000);
+            registered = true;
+        }
     }
     else
         enableAppStats = false;
@@ -287,47 +323,61 @@ void appIdStatsIdleFlush()
     if (!enableAppStats)
         return;
 
-    time_t now = get_time();
-    if (now >= bucketEnd)
+    time_t now = packet_time();
+    if (now >= threadBucketEnd)
     {
-        endStats2Period();
-        dumpStats2();
-        startStats2Period(now);
+        handoffBuckets();
+        threadBucketEnd = get_bucket_time(now) + bucketInterval;
     }
 }
 
-static void startStats2Period(time_t startTime)
+void appIdStatsThreadTerm()
 {
-    bucketStart = startTime;
-    bucketEnd = bucketStart + bucketInterval;
+    if (!enableAppStats)
+        return;
+
+    handoffBuckets();
+
+    if (currBuckets)
+    {
+        snort_free(currBuckets);
+        currBuckets = nullptr;
+    }
 }
 
-static void endStats2Period(void)
+static void appIdStatsRoll(void*)
 {
-    SF_LIST* bucketList = logBuckets;
-    logBuckets = currBuckets;
-    currBuckets = bucketList;
+    if (!enableAppStats)
+        return;
+
+    time_t now = time(nullptr);
+    if (now < bucketEnd)
+        return;
+
+    mergePending();
+    dumpStats2();
+    bucketEnd = get_bucket_time(now) + bucketInterval;
 }
 
-static StatsBucket* getStatsBucket(time_t startTime)
+static StatsBucket* getStatsBucket(SF_LIST*& buckets, time_t startTime)
 {
     StatsBucket* bucket = nullptr;
 
-    if ( !currBuckets )
+    if ( !buckets )
     {
-        currBuckets = sflist_new();
+        buckets = sflist_new();
 #       ifdef DEBUG_STATS
         fprintf(SF_DEBUG_FILE, "New Stats Bucket List\n");
 #       endif
     }
 
-    if ( !currBuckets )
+    if ( !buckets )
         return nullptr;
 
     SF_LNODE* lNode = nullptr;
     StatsBucket* lBucket = nullptr;
 
-    for ( lBucket = (StatsBucket*)sflist_first(currBuckets, &lNode); lNode && lBucket;
+    for ( lBucket = (StatsBucket*)sflist_first(buckets, &lNode); lNode && lBucket;
         lBucket = (StatsBucket*)sflist_next(&lNode) )
     {
         if (startTime == lBucket->startTime)
@@ -340,7 +390,7 @@ static StatsBucket* getStatsBucket(time_t startTime)
             bucket = (StatsBucket*)snort_calloc(sizeof(StatsBucket));
             bucket->startTime = startTime;
             bucket->appsTree = fwAvlInit();
-            sflist_add_before(currBuckets, lNode, bucket);
+            sflist_add_before(buckets, lNode, bucket);
 
 #ifdef DEBUG_STATS
             fprintf(SF_DEBUG_FILE, "New Bucket Time: %u before %u\n",
@@ -355,7 +405,7 @@ static StatsBucket* getStatsBucket(time_t startTime)
         bucket = (StatsBucket*)snort_calloc(sizeof(StatsBucket));
         bucket->startTime = startTime;
         bucket->appsTree = fwAvlInit();
-        sflist_add_tail(currBuckets, bucket);
+        sflist_add_tail(buckets, bucket);
 
 #ifdef DEBUG_STATS
         fprintf(SF_DEBUG_FILE, "New Bucket Time: %u at tail\n", bucket->startTime);
@@ -374,6 +424,8 @@ static void dumpStats2()
     struct AppIdStatRecord* record;
     size_t buffSize;
     time_t currTime = time(nullptr);
+    size_t recSize = compactStats ? sizeof(struct AppIdStatRecord) :
+        sizeof(struct AppIdStatOutputRecord);
 
     if (logBuckets == nullptr)
         return;
@@ -382,9 +434,9 @@ static void dumpStats2()
     {
         if (bucket->appRecordCnt)
         {
-            buffSize = ( bucket->appRecordCnt * sizeof(struct AppIdStatOutputRecord) ) +
-                ( 4 * sizeof(uint32_t) );
-            header.type = UNIFIED2_IDS_EVENT_APPSTAT;
+            buffSize = ( bucket->appRecordCnt * recSize ) + ( 4 * sizeof(uint32_t) );
+            header.type = compactStats ? UNIFIED2_IDS_EVENT_APPSTAT_COMPACT :
+                UNIFIED2_IDS_EVENT_APPSTAT;
             header.length = buffSize - ( 2 * sizeof(uint32_t));
             buffer = (uint8_t*)snort_calloc(buffSize);
 #           ifdef DEBUG_STATS
@@ -405,13 +457,22 @@ static void dumpStats2()
 
             for (node = fwAvlFirst(bucket->appsTree); node != nullptr; node = fwAvlNext(node))
             {
+                record = (struct AppIdStatRecord*)node->data;
+
+                if (compactStats)
+                {
+                    *buffPtr++ = htonl(record->app_id);
+                    *buffPtr++ = htonl(record->initiatorBytes);
+                    *buffPtr++ = htonl(record->responderBytes);
+                    continue;
+                }
+
                 struct AppIdStatOutputRecord* recBuffPtr;
                 const char* appName;
                 bool cooked_client = false;
                 AppId app_id;
                 char tmpBuff[MAX_EVENT_APPNAME_LEN];
 
-                record = (struct AppIdStatRecord*)node->data;
                 app_id = record->app_id;
 
                 recBuffPtr = (struct AppIdStatOutputRecord*) buffPtr;
@@ -502,23 +563,16 @@ void appIdStatsFini()
         return;
 
     /*flush the last stats period. */
-    endStats2Period();
+    appIdStatsThreadTerm();
+    mergePending();
     dumpStats2();
 
-    if (!currBuckets)
-        return;
-
-    while (auto bucket = (StatsBucket*)sflist_remove_head(currBuckets))
+    if (logBuckets)
     {
-        fwAvlDeleteTree(bucket->appsTree, deleteRecord);
-        snort_free(bucket);
+        freeBuckets(logBuckets);
+        logBuckets = nullptr;
     }
 
-    snort_free(currBuckets);
-
-    if (logBuckets)
-        snort_free(logBuckets);
-
     appIdStatsCloseFiles();
 }
 
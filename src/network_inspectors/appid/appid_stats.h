@@ -29,6 +29,7 @@ void appIdStatsUpdate(AppIdData*);
 void appIdStatsInit(AppIdModuleConfig* config);
 void appIdStatsReinit();
 void appIdStatsIdleFlush();
+void appIdStatsThreadTerm();
 void appIdStatsFini();
 
 #endif
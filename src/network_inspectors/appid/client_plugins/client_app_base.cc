@@ -60,7 +60,6 @@
 /* If this is greater than 1, more than 1 client detector can be searched for
  * and tried per flow based on pattern (if a valid detector doesn't
  * already exist). */
-#define MAX_CANDIDATE_CLIENTS 10
 
 static void* client_app_flowdata_get(AppIdData* flowp, unsigned client_id);
 static int client_app_flowdata_add(AppIdData* flowp, void* data, unsigned client_id, AppIdFreeFCN
@@ -182,7 +181,7 @@ const RNAClientAppModule* ClientAppGetClientAppModule(RNAClientAppFCN fcn, struc
     return nullptr;
 }
 
-void add_pattern_data(SearchTool* st, const RNAClientAppModule* li, int position,
+void add_pattern_data(PatternTenant* st, const RNAClientAppModule* li, int position,
         const uint8_t* const pattern, unsigned size, unsigned nocase,
         int* count, ClientAppConfig* pClientAppConfig)
 {
@@ -209,7 +208,7 @@ static void clientCreatePattern(IpProtocol proto, const uint8_t* const pattern,
     if (proto == IpProtocol::TCP)
     {
         if (!pClientAppConfig->tcp_patterns)
-            pClientAppConfig->tcp_patterns = new SearchTool("ac_full");
+            pClientAppConfig->tcp_patterns = new PatternTenant(pClientAppConfig->tcp_index);
         count = &pClientAppConfig->tcp_pattern_count;
         add_pattern_data(pClientAppConfig->tcp_patterns, li, position, pattern, size,
             nocase, count, pClientAppConfig);
@@ -217,7 +216,7 @@ static void clientCreatePattern(IpProtocol proto, const uint8_t* const pattern,
     else if (proto == IpProtocol::UDP)
     {
         if (!pClientAppConfig->udp_patterns)
-            pClientAppConfig->udp_patterns = new SearchTool("ac_full");
+            pClientAppConfig->udp_patterns = new PatternTenant(pClientAppConfig->udp_index);
         count = &pClientAppConfig->udp_pattern_count;
         add_pattern_data(pClientAppConfig->udp_patterns, li, position, pattern, size,
             nocase, count, pClientAppConfig);
@@ -629,14 +628,12 @@ void ClientAppInit(AppIdConfig* pConfig)
 
 void ClientAppFinalize(AppIdConfig* pConfig)
 {
-    if (pConfig->clientAppConfig.enabled)
-    {
-        if ( pConfig->clientAppConfig.tcp_patterns )
-            pConfig->clientAppConfig.tcp_patterns->prep();
+    // pattern client detector patterns were added by portPatternFinalize()
+    if ( pConfig->clientAppConfig.tcp_index )
+        pConfig->clientAppConfig.tcp_index->prep();
 
-        if ( pConfig->clientAppConfig.udp_patterns )
-            pConfig->clientAppConfig.udp_patterns->prep();
-    }
+    if ( pConfig->clientAppConfig.udp_index )
+        pConfig->clientAppConfig.udp_index->prep();
 }
 
 struct ClientAppMatch
@@ -702,6 +699,11 @@ void CleanupClientApp(AppIdConfig* pConfig )
         match_free_list = match->next;
         snort_free(match);
     }
+
+    delete pConfig->clientAppConfig.tcp_index;
+    pConfig->clientAppConfig.tcp_index = nullptr;
+    delete pConfig->clientAppConfig.udp_index;
+    pConfig->clientAppConfig.udp_index = nullptr;
 }
 
 /*
@@ -783,7 +785,7 @@ static ClientAppMatch* BuildClientPatternList(const Packet* pkt, IpProtocol prot
     const ClientAppConfig* pClientAppConfig)
 {
     ClientAppMatch* match_list = nullptr;
-    SearchTool* patterns;
+    PatternTenant* patterns;
 
     if (protocol == IpProtocol::TCP)
         patterns = pClientAppConfig->tcp_patterns;
@@ -890,8 +892,7 @@ static void ClientAppID(Packet* p, const int /*direction*/, AppIdData* flowp, co
     }
     else
     {
-        flowp->candidate_client_list = (SF_LIST*) snort_calloc(sizeof(SF_LIST));
-        sflist_init(flowp->candidate_client_list);
+        flowp->candidate_client_list = new ClientCandidates;
         flowp->num_candidate_clients_tried = 0;
     }
 
@@ -901,14 +902,9 @@ static void ClientAppID(Packet* p, const int /*direction*/, AppIdData* flowp, co
         const RNAClientAppModule* tmp = GetNextFromClientPatternList(&match_list);
         if (tmp != nullptr)
         {
-            SF_LNODE* cursor;
-
-            client = (RNAClientAppModule*)sflist_first(flowp->candidate_client_list, &cursor);
-            while (client && (client != tmp))
-                client = (RNAClientAppModule*)sflist_next(&cursor);
-            if (client == nullptr)
+            if (!flowp->candidate_client_list->contains(tmp))
             {
-                sflist_add_tail(flowp->candidate_client_list, (void*)tmp);
+                flowp->candidate_client_list->add(tmp);
                 flowp->num_candidate_clients_tried++;
 #ifdef CLIENT_APP_DEBUG
                 _dpd.logMsg("Using %s from pattern match", tmp ? tmp->name : \ n ",ULL");
@@ -922,7 +918,7 @@ static void ClientAppID(Packet* p, const int /*direction*/, AppIdData* flowp, co
     }
     FreeClientPatternList(&match_list);
 
-    if (sflist_count(flowp->candidate_client_list) == 0)
+    if (flowp->candidate_client_list->count() == 0)
     {
         client = nullptr;
         switch (p->ptrs.dp)
@@ -936,7 +932,7 @@ static void ClientAppID(Packet* p, const int /*direction*/, AppIdData* flowp, co
         }
         if (client != nullptr)
         {
-            sflist_add_tail(flowp->candidate_client_list, (void*)client);
+            flowp->candidate_client_list->add(client);
             flowp->num_candidate_clients_tried++;
         }
     }
@@ -24,6 +24,7 @@
 
 #include "utils/sflsq.h"
 #include "search_engines/search_tool.h"
+#include "util/pattern_index.h"
 
 struct RNAClientAppModule;
 struct RNAClientAppRecord;
@@ -42,10 +43,14 @@ struct ClientAppConfig
     int enabled;
     SF_LIST module_configs;
     ClientPatternData* pattern_data_list;
-    SearchTool* tcp_patterns;
+    PatternTenant* tcp_patterns;
     int tcp_pattern_count;
-    SearchTool* udp_patterns;
+    PatternTenant* udp_patterns;
     int udp_pattern_count;
+
+    // initiator payload engines shared with the pattern client detector
+    PatternIndex* tcp_index = nullptr;
+    PatternIndex* udp_index = nullptr;
 };
 
 #endif
@@ -173,6 +173,58 @@ struct MatchedPatterns
     MatchedPatterns* next;
 };
 
+// the matches from one scan are kept in found order.  the first few come
+// from a local pool so a typical header costs no allocations.
+#define MATCH_POOL_SIZE 16
+
+struct MatchedPatternList
+{
+    MatchedPatterns* head = nullptr;
+    MatchedPatterns** tail = &head;
+    MatchedPatterns pool[MATCH_POOL_SIZE];
+    unsigned used = 0;
+
+    ~MatchedPatternList();
+    void append(DetectorHTTPPattern*, int index);
+};
+
+void MatchedPatternList::append(DetectorHTTPPattern* target, int index)
+{
+    MatchedPatterns* cm;
+
+    if ( used < MATCH_POOL_SIZE )
+        cm = pool + used++;
+    else
+        cm = (MatchedPatterns*)snort_alloc(sizeof(MatchedPatterns));
+
+    cm->mpattern = target;
+    cm->index = index;
+    cm->next = nullptr;
+    *tail = cm;
+    tail = &cm->next;
+}
+
+MatchedPatternList::~MatchedPatternList()
+{
+    MatchedPatterns* mp = head;
+
+    while ( mp )
+    {
+        MatchedPatterns* tmp = mp;
+        mp = mp->next;
+
+        if ( tmp < pool or tmp >= pool + MATCH_POOL_SIZE )
+            snort_free(tmp);
+    }
+}
+
+// a single pattern picked from a scan
+struct BestMatch
+{
+    DetectorHTTPPattern* mpattern = nullptr;
+    int index = 0;
+};
+
 static DetectorHTTPPattern content_type_patterns[] =
 {
     { SINGLE, 0, APP_ID_QUICKTIME, 0,
@@ -331,21 +383,29 @@ static HeaderPattern header_patterns[] =
     { HTTP_ID_LEN, (uint8_t*)HTTP_HEADER_LF, HTTP_HEADER_LF_SIZE }
 };
 
+// the longest pattern wins; of equal ones the last found does
 static int content_pattern_match(void* id, void*, int index, void* data, void*)
 {
-    MatchedPatterns* cm;
-    MatchedPatterns** matches = (MatchedPatterns**)data;
+    BestMatch* best = (BestMatch*)data;
     DetectorHTTPPattern* target = (DetectorHTTPPattern*)id;
 
-    cm = (MatchedPatterns*)snort_calloc(sizeof(MatchedPatterns));
-    cm->mpattern = target;
-    cm->index = index;
-    cm->next = *matches;
-    *matches = cm;
-
+    if ( !best->mpattern or target->pattern_size >= best->mpattern->pattern_size )
+    {
+        best->mpattern = target;
+        best->index = index;
+    }
     return 0;
 }
 
+// only the first match is used so stop there
+static int first_pattern_match(void* id, void*, int index, void* data, void*)
+{
+    BestMatch* best = (BestMatch*)data;
+    best->mpattern = (DetectorHTTPPattern*)id;
+    best->index = index;
+    return 1;
+}
+
 static int chp_pattern_match(void* id, void*, int index, void* data, void*)
 {
     MatchedCHPAction* new_match;
@@ -458,30 +518,13 @@ static int chp_key_pattern_match(void* id, void*, int index, void* data, void*)
 
 static int http_pattern_match(void* id, void*, int index, void* data, void*)
 {
-    MatchedPatterns* cm = nullptr;
-    MatchedPatterns** tmp;
-    MatchedPatterns** matches = (MatchedPatterns**)data;
+    MatchedPatternList* matches = (MatchedPatternList*)data;
     DetectorHTTPPattern* target = (DetectorHTTPPattern*)id;
 
-    /* make sure we haven't already seen this pattern */
-    for (tmp = matches;
-        *tmp;
-        tmp = &(*tmp)->next)
-    {
-        cm = *tmp;
-    }
-
-    if (!*tmp)
-    {
-        cm = (MatchedPatterns*)snort_calloc(sizeof(MatchedPatterns));
-        cm->mpattern = target;
-        cm->index = index;
-        cm->next = nullptr;
-        *tmp = cm;
-    }
+    matches->append(target, index);
 
     /* if its one of the host patterns, return after first match*/
-    if (cm->mpattern->seq == SINGLE)
+    if (target->seq == SINGLE)
         return 1;
     else
         return 0;
@@ -729,18 +772,6 @@ void http_detector_clean(DetectorHttpConfig* pHttpConfig)
     destroyHosUrlPatternList(&pHttpConfig->hosUrlPatternsList);
 }
 
-static inline void FreeMatchStructures(MatchedPatterns* mp)
-{
-    MatchedPatterns* tmp;
-
-    while (mp)
-    {
-        tmp = mp;
-        mp = mp->next;
-        snort_free(tmp);
-    }
-}
-
 static void rewriteCHP(const char* buf, int bs, int start,
     int psize, char* adata, char** outbuf,
     int insert)
@@ -1471,7 +1502,7 @@ void identifyUserAgent(const uint8_t* start, int size, AppId* serviceAppId, AppI
     int dominant_pattern_detected;
     int longest_misc_match;
     const uint8_t* end;
-    MatchedPatterns* mp = nullptr;
+    MatchedPatternList matches;
     MatchedPatterns* tmp;
     DetectorHTTPPattern* match;
     uint8_t* buffPtr;
@@ -1481,9 +1512,9 @@ void identifyUserAgent(const uint8_t* start, int size, AppId* serviceAppId, AppI
 
     // FIXIT-H
     pHttpConfig->client_agent_matcher->find_all((const char*)start, size, &http_pattern_match,
-        false, (void*)&mp);
+        false, (void*)&matches);
 
-    if (mp)
+    if (matches.head)
     {
         end = start + size;
         temp_ver[0] = 0;
@@ -1497,7 +1528,7 @@ void identifyUserAgent(const uint8_t* start, int size, AppId* serviceAppId, AppI
         i = 0;
         *ClientAppId = APP_ID_NONE;
         *serviceAppId = APP_ID_HTTP;
-        for (tmp = mp; tmp; tmp = tmp->next)
+        for (tmp = matches.head; tmp; tmp = tmp->next)
         {
             match = (DetectorHTTPPattern*)tmp->mpattern;
             switch (match->client_app)
@@ -1787,7 +1818,6 @@ void identifyUserAgent(const uint8_t* start, int size, AppId* serviceAppId, AppI
 
 done:
     optionallyReplaceWithStrdup(version,temp_ver);
-    FreeMatchStructures(mp);
 }
 
 int geAppidByViaPattern(const uint8_t* data, unsigned size, char** version,
@@ -1796,24 +1826,24 @@ int geAppidByViaPattern(const uint8_t* data, unsigned size, char** version,
     unsigned i;
     const uint8_t* data_ptr;
     const uint8_t* end = data + size;
-    MatchedPatterns* mp = nullptr;
+    BestMatch mp;
     DetectorHTTPPattern* match = nullptr;
     char temp_ver[MAX_VERSION_SIZE];
 
     if (pHttpConfig->via_matcher)
     {
         // FIXIT-H
-        pHttpConfig->via_matcher->find_all((const char*)data, size, &http_pattern_match,
+        pHttpConfig->via_matcher->find_all((const char*)data, size, &first_pattern_match,
             false, (void*)&mp);
     }
 
-    if (mp)
+    if (mp.mpattern)
     {
-        match = (DetectorHTTPPattern*)mp->mpattern;
+        match = mp.mpattern;
         switch (match->service_id)
         {
         case APP_ID_SQUID:
-            data_ptr = (uint8_t*)data + mp->index + match->pattern_size;
+            data_ptr = (uint8_t*)data + mp.index + match->pattern_size;
             if (*data_ptr == '/')
             {
                 data_ptr++;
@@ -1829,11 +1859,9 @@ int geAppidByViaPattern(const uint8_t* data, unsigned size, char** version,
                 i = 0;
             temp_ver[i] = 0;
             optionallyReplaceWithStrdup(version,temp_ver);
-            FreeMatchStructures(mp);
             return APP_ID_SQUID;
 
         default:
-            FreeMatchStructures(mp);
             return APP_ID_NONE;
         }
     }
@@ -1871,9 +1899,7 @@ AppId scan_header_x_working_with(const uint8_t* data, uint32_t size, char** vers
 
 AppId geAppidByContentType(const uint8_t* data, int size, const DetectorHttpConfig* pHttpConfig)
 {
-    MatchedPatterns* mp = nullptr;
-    DetectorHTTPPattern* match;
-    AppId payloadId;
+    BestMatch mp;
 
     if (pHttpConfig->content_type_matcher)
     {
@@ -1882,15 +1908,10 @@ AppId geAppidByContentType(const uint8_t* data, int size, const DetectorHttpConf
             &content_pattern_match, false, (void*)&mp);
     }
 
-    if (!mp)
+    if (!mp.mpattern)
         return APP_ID_NONE;
 
-    match = mp->mpattern;
-    payloadId = match->appId;
-
-    FreeMatchStructures(mp);
-
-    return payloadId;
+    return mp.mpattern->appId;
 }
 
 static int http_header_pattern_match(void* id, void*, int index, void* data, void*)
@@ -23,6 +23,7 @@
 #include "app_info_table.h"
 #include "client_plugins/client_app_api.h"
 #include "service_plugins/service_api.h"
+#include "util/pattern_index.h"
 
 #include "log/messages.h"
 #include "main/snort_debug.h"
@@ -233,6 +234,14 @@ static void RegisterPattern(SearchTool** patterns, Pattern* pattern)
     (*patterns)->add((char*)pattern->data, pattern->length, pattern, false);
 }
 
+static void RegisterPattern(PatternTenant** patterns, PatternIndex*& index, Pattern* pattern)
+{
+    if (!*patterns)
+        *patterns = new PatternTenant(index);
+
+    (*patterns)->add((char*)pattern->data, pattern->length, pattern, false);
+}
+
 // Creates unique subset of services registered on ports, and then creates pattern trees.
 static void createServicePatternTrees(AppIdConfig* pConfig)
 {
@@ -297,9 +306,11 @@ static void createClientPatternTrees( AppIdConfig* pConfig )
         for (pattern = ps->pattern; pattern; pattern = pattern->next)
         {
             if (ps->proto == IpProtocol::TCP)
-                RegisterPattern(&pConfig->clientPortPattern->tcp_patterns, pattern);
+                RegisterPattern(&pConfig->clientPortPattern->tcp_patterns,
+                    pConfig->clientAppConfig.tcp_index, pattern);
             else
-                RegisterPattern(&pConfig->clientPortPattern->udp_patterns, pattern);
+                RegisterPattern(&pConfig->clientPortPattern->udp_patterns,
+                    pConfig->clientAppConfig.udp_index, pattern);
         }
     }
 }
@@ -327,7 +338,8 @@ void registerServicePatterns( AppIdConfig* pConfig )
                         iniServiceApi->RegisterPattern(&service_validate, IpProtocol::TCP,
                             pattern->data, pattern->length,
                             pattern->offset, "pattern", iniServiceApi->pAppidConfig);
-                        RegisterPattern(&pConfig->servicePortPattern->tcp_patterns, pattern);
+                        RegisterPattern(&pConfig->servicePortPattern->tcp_patterns,
+                            pConfig->serviceConfig.tcp_index, pattern);
                     }
                     else
                     {
@@ -335,7 +347,8 @@ void registerServicePatterns( AppIdConfig* pConfig )
                         iniServiceApi->RegisterPattern(&service_validate, IpProtocol::UDP,
                             pattern->data, pattern->length,
                             pattern->offset, "pattern", iniServiceApi->pAppidConfig);
-                        RegisterPattern(&pConfig->servicePortPattern->udp_patterns, pattern);
+                        RegisterPattern(&pConfig->servicePortPattern->udp_patterns,
+                            pConfig->serviceConfig.udp_index, pattern);
                     }
                 }
             }
@@ -374,14 +387,16 @@ void registerClientPatterns( AppIdConfig* pConfig )
                     iniClientApi->RegisterPattern(&client_validate, IpProtocol::TCP, pattern->data,
                         pattern->length,
                         pattern->offset, iniClientApi->pAppidConfig);
-                    RegisterPattern(&pConfig->clientPortPattern->tcp_patterns, pattern);
+                    RegisterPattern(&pConfig->clientPortPattern->tcp_patterns,
+                        pConfig->clientAppConfig.tcp_index, pattern);
                 }
                 else
                 {
                     DebugFormat(DEBUG_LOG,"Adding pattern with length %u\n",pattern->length);
                     iniClientApi->RegisterPattern(&client_validate, IpProtocol::UDP, pattern->data,
                         pattern->length, pattern->offset, iniClientApi->pAppidConfig);
-                    RegisterPattern(&pConfig->clientPortPattern->udp_patterns, pattern);
+                    RegisterPattern(&pConfig->clientPortPattern->udp_patterns,
+                        pConfig->clientAppConfig.udp_index, pattern);
                 }
             }
             ps->count++;
@@ -561,6 +576,7 @@ static int csdPatternTreeSearch(const uint8_t* data, uint16_t size, IpProtocol p
     Packet* pkt, const RNAServiceElement** serviceData, bool isClient, const AppIdConfig* pConfig)
 {
     SearchTool* patternTree = nullptr;
+    PatternTenant* patterns = nullptr;
     PatternService* ps;
     PServiceMatch* matches = nullptr;
     PServiceMatch* sm;
@@ -580,19 +596,20 @@ static int csdPatternTreeSearch(const uint8_t* data, uint16_t size, IpProtocol p
             patternTree = pConfig->servicePortPattern->tcpPortPatternTree[pkt->ptrs.sp];
     }
 
-    if (!patternTree)
+    if (patternTree)
+        patternTree->find_all((char*)data, size, &pattern_match, false, (void*)&matches);
+
+    else
     {
         if (protocol == IpProtocol::UDP)
-            patternTree = (isClient) ? pConfig->clientPortPattern->udp_patterns :
+            patterns = (isClient) ? pConfig->clientPortPattern->udp_patterns :
                 pConfig->servicePortPattern->udp_patterns;
         else
-            patternTree = (isClient) ? pConfig->clientPortPattern->tcp_patterns :
+            patterns = (isClient) ? pConfig->clientPortPattern->tcp_patterns :
                 pConfig->servicePortPattern->tcp_patterns;
-    }
 
-    if (patternTree)
-    {
-        patternTree->find_all((char*)data, size, &pattern_match, false, (void*)&matches);
+        if (patterns)
+            patterns->find_all((char*)data, size, &pattern_match, false, (void*)&matches);
     }
 
     if (matches == nullptr)
@@ -68,12 +68,14 @@ struct PatternService
 };
 
 class SearchTool;
+class PatternTenant;
+
 struct ServicePortPattern
 {
     PortPatternNode* luaInjectedPatterns;
     PatternService* servicePortPattern;
-    SearchTool* tcp_patterns;
-    SearchTool* udp_patterns;
+    PatternTenant* tcp_patterns;
+    PatternTenant* udp_patterns;
     SearchTool* tcpPortPatternTree[65536];
     SearchTool* udpPortPatternTree[65536];
 };
@@ -82,8 +84,8 @@ struct ClientPortPattern
 {
     PortPatternNode* luaInjectedPatterns;
     PatternService* servicePortPattern;
-    SearchTool* tcp_patterns;
-    SearchTool* udp_patterns;
+    PatternTenant* tcp_patterns;
+    PatternTenant* udp_patterns;
 };
 
 #endif
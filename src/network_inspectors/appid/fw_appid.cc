@@ -21,17 +21,20 @@
 
 #include "fw_appid.h"
 
+#include "latency/degrade.h"
 #include "log/messages.h"
 #include "profiler/profiler.h"
 #include "protocols/tcp.h"
 #include "target_based/snort_protocols.h"
 #include "utils/util.h"
 
+#include "appid_module.h"
 #include "appid_stats.h"
 #include "app_forecast.h"
 #include "app_info_table.h"
 
 #include "host_port_app_cache.h"
+#include "learned_app_cache.h"
 #include "lua_detector_module.h"
 #include "client_plugins/client_app_base.h"
 #include "detector_plugins/detector_http.h"
@@ -42,6 +45,7 @@
 #include "util/common_util.h"
 #include "util/ip_funcs.h"
 #include "util/network_set.h"
+#include "util/pattern_index.h"
 #include "time/packet_time.h"
 #include "sfip/sf_ip.h"
 #include "stream/stream_api.h"
@@ -362,7 +366,9 @@ static inline bool fwAppIdDebugCheck(Flow* flow, AppIdData* session, volatile in
     if (debug_flag)
     {
         assert(flow);
-        const FlowKey* key = flow->key;
+        FlowKey flow_key;
+        flow->get_key(flow_key);
+        const FlowKey* key = &flow_key;
 
         if (((info->protocol == PktType::NONE) || info->protocol == key->pkt_type) &&
             (((!info->sport || info->sport == key->port_l) &&
@@ -1914,38 +1920,39 @@ static inline int RunClientDetectors(AppIdData* session,
                 session->clientData->name ? session->clientData->name : "UNKNOWN", ret);
     }
     else if (    (session->candidate_client_list != nullptr)
-        && (sflist_count(session->candidate_client_list) > 0) )
+        && (session->candidate_client_list->count() > 0) )
     {
-        SF_LNODE* node;
-        RNAClientAppModule* client;
+        ClientCandidates::Node* node;
+        const RNAClientAppModule* client;
 
         ret = CLIENT_APP_INPROCESS;
-        (void)sflist_first(session->candidate_client_list, &node);
+        node = session->candidate_client_list->first();
         while (node != nullptr)
         {
             int result;
-            SF_LNODE* node_tmp;
+            ClientCandidates::Node* node_tmp;
 
-            client = (RNAClientAppModule*)node->ndata;
+            client = node->item;
             result = client->validate(p->data, p->dsize, direction,
                 session, p, client->userData, pConfig);
+            appid_stats.client_candidate_runs++;
             if (app_id_debug_session_flag)
                 LogMessage("AppIdDbg %s %s client detector returned %d\n", app_id_debug_session,
                     client->name ? client->name : "UNKNOWN", result);
 
             node_tmp = node;
-            sflist_next(&node);
+            node = ClientCandidates::next(node);
             if (result == CLIENT_APP_SUCCESS)
             {
                 ret = CLIENT_APP_SUCCESS;
                 session->clientData = client;
-                sflist_free(session->candidate_client_list);
+                delete session->candidate_client_list;
                 session->candidate_client_list = nullptr;
                 break;    /* done */
             }
             else if (result != CLIENT_APP_INPROCESS)    /* fail */
             {
-                sflist_remove_node(session->candidate_client_list, node_tmp);
+                session->candidate_client_list->remove(node_tmp);
             }
         }
     }
@@ -1953,6 +1960,51 @@ static inline int RunClientDetectors(AppIdData* session,
     return ret;
 }
 
+/* Give up on detectors that haven't concluded within the packet budget so
+ * long lived unknown flows stop running candidate lists on every packet. */
+static inline void checkDetectionBudget(AppIdData* session, const AppIdConfig* pConfig)
+{
+    unsigned budget = pConfig->mod_config->detection_packet_budget;
+
+    if (!budget || session->session_packet_count <= budget ||
+        getAppIdFlag(session, APPID_SESSION_HTTP_SESSION))
+        return;
+
+    bool stopped = false;
+
+    if (session->rnaServiceState != RNA_STATE_FINISHED &&
+        !getAppIdFlag(session, APPID_SESSION_SERVICE_DETECTED))
+    {
+        session->rnaServiceState = RNA_STATE_FINISHED;
+        setAppIdFlag(session, APPID_SESSION_SERVICE_DETECTED);
+
+        delete session->candidate_service_list;
+        session->candidate_service_list = nullptr;
+        if (session->id_state)
+            session->id_state->searching = false;
+        stopped = true;
+    }
+
+    if (session->rnaClientState != RNA_STATE_FINISHED &&
+        !getAppIdFlag(session, APPID_SESSION_CLIENT_DETECTED))
+    {
+        session->rnaClientState = RNA_STATE_FINISHED;
+        setAppIdFlag(session, APPID_SESSION_CLIENT_DETECTED);
+
+        delete session->candidate_client_list;
+        session->candidate_client_list = nullptr;
+        stopped = true;
+    }
+
+    if (stopped)
+    {
+        appid_stats.budget_exhausted++;
+
+        if (app_id_debug_session_flag)
+            LogMessage("AppIdDbg %s detection budget exhausted\n", app_id_debug_session);
+    }
+}
+
 static inline void getOffsetsFromRebuilt(Packet* pkt, httpSession* hsession)
 {
 // size of "GET /\r\n\r\n"
@@ -2214,6 +2266,8 @@ void fwAppIdSearch(Packet* p)
     bool is_rebuilt;
     bool is_http2;
 
+    // packet buffers are reused so forget the last payload scan
+    PatternIndex::clear_scan();
     app_id_raw_packet_count++;
 
     if (!p->flow)
@@ -2447,6 +2501,7 @@ void fwAppIdSearch(Packet* p)
     if (!(session->scan_flags & SCAN_HOST_PORT_FLAG))
     {
         HostPortVal* hv;
+        LearnedAppVal* lv;
 
         session->scan_flags |= SCAN_HOST_PORT_FLAG;
         if (direction == APP_ID_FROM_INITIATOR)
@@ -2481,6 +2536,30 @@ void fwAppIdSearch(Packet* p)
                     thirdparty_appid_module->session_delete(session->tpsession, 1);
                 session->tpsession = nullptr;
             }
+            session->scan_flags |= SCAN_LEARNED_FLAG;
+        }
+        else if (pConfig->mod_config->learn_cache_size &&
+            (lv = learnedAppCacheFind(ip, port, protocol, pConfig->mod_config)))
+        {
+            session->serviceAppId = lv->serviceAppId;
+            synchAppIdWithSnortId(lv->serviceAppId, p, session, pConfig);
+            session->rnaServiceState = RNA_STATE_FINISHED;
+            setAppIdFlag(session, APPID_SESSION_SERVICE_DETECTED);
+
+            if (lv->ClientAppId > APP_ID_NONE)
+            {
+                session->ClientAppId = lv->ClientAppId;
+                session->rnaClientState = RNA_STATE_FINISHED;
+                setAppIdFlag(session, APPID_SESSION_CLIENT_DETECTED);
+            }
+            if (thirdparty_appid_module)
+                thirdparty_appid_module->session_delete(session->tpsession, 1);
+            session->tpsession = nullptr;
+            session->scan_flags |= SCAN_LEARNED_FLAG;
+
+            if (app_id_debug_session_flag)
+                LogMessage("AppIdDbg %s learned service %d client %d\n", app_id_debug_session,
+                    lv->serviceAppId, lv->ClientAppId);
         }
     }
 
@@ -2782,8 +2861,15 @@ void fwAppIdSearch(Packet* p)
         else if (getAppIdFlag(session, APPID_SESSION_SSL_SESSION) && session->tsession)
             ExamineSslMetadata(p, session, pConfig);
     }
+    else if (p->dsize && Degrade::engaged(Degrade::APPID))
+    {
+        // under latency pressure payload detection waits for the load to drop
+        appid_stats.degraded_packets++;
+    }
     else if (protocol != IpProtocol::TCP || !p->dsize || (p->packet_flags & PKT_STREAM_ORDER_OK))
     {
+        checkDetectionBudget(session, pConfig);
+
         /*** Start of service discovery. ***/
         if (session->rnaServiceState != RNA_STATE_FINISHED)
         {
@@ -3000,7 +3086,7 @@ void fwAppIdSearch(Packet* p)
                 isTpAppidDiscoveryDone = true;
                 if (session->candidate_client_list != nullptr)
                 {
-                    if (sflist_count(session->candidate_client_list) > 0)
+                    if (session->candidate_client_list->count() > 0)
                     {
                         int ret = 0;
                         if (direction == APP_ID_FROM_INITIATOR)
@@ -3049,6 +3135,21 @@ void fwAppIdSearch(Packet* p)
     serviceAppId = pickServiceAppId(session);
     payloadAppId = pickPayloadId(session);
 
+    /* Remember servers whose verdict doesn't depend on the payload. */
+    if (pConfig->mod_config->learn_cache_size && !(session->scan_flags & SCAN_LEARNED_FLAG) &&
+        serviceAppId > APP_ID_NONE && payloadAppId <= APP_ID_NONE &&
+        session->rnaServiceState == RNA_STATE_FINISHED &&
+        session->rnaClientState == RNA_STATE_FINISHED &&
+        getAppIdFlag(session, APPID_SESSION_SERVICE_DETECTED | APPID_SESSION_NOT_A_SERVICE |
+        APPID_SESSION_CONTINUE | APPID_SESSION_HTTP_SESSION | APPID_SESSION_SSL_SESSION |
+        APPID_SESSION_DECRYPTED) == APPID_SESSION_SERVICE_DETECTED &&
+        sfip_is_set(&session->service_ip))
+    {
+        session->scan_flags |= SCAN_LEARNED_FLAG;
+        learnedAppCacheAdd(&session->service_ip, session->service_port, protocol,
+            serviceAppId, pickClientAppId(session), pConfig->mod_config);
+    }
+
     if (serviceAppId > APP_ID_NONE)
     {
         if (getAppIdFlag(session, APPID_SESSION_DECRYPTED))
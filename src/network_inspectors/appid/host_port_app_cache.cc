@@ -32,7 +32,10 @@ void hostPortAppCacheInit(AppIdConfig* pConfig)
         2048, sizeof(HostPortKey), sizeof(HostPortVal), 0, 0, nullptr, nullptr, 0);
 
     if ( hash )
+    {
+        sfxhash_set_stats(hash, "appid_host_port");
         pConfig->hostPortCache = hash;
+    }
 
     else
         ErrorMessage("failed to allocate HostPort map");
@@ -0,0 +1,145 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// learned_app_cache.cc
+
+#include "learned_app_cache.h"
+
+#include "hash/sfxhash.h"
+#include "log/messages.h"
+#include "main/thread.h"
+#include "sfip/sf_ip.h"
+#include "time/packet_time.h"
+
+#include "appid_config.h"
+#include "appid_module.h"
+
+#define HASH_NUM_ROWS (1024)
+
+struct LearnedAppKey
+{
+    sfip_t ip;
+    uint16_t port;
+    IpProtocol proto;
+};
+
+static THREAD_LOCAL SFXHASH* learned_cache = nullptr;
+
+static void make_key(LearnedAppKey& key, const sfip_t* ip, uint16_t port, IpProtocol proto)
+{
+    // the key is hashed as raw bytes so the padding must be zeroed too
+    memset(&key, 0, sizeof(key));
+    sfip_copy(key.ip, ip);
+    key.port = port;
+    key.proto = proto;
+}
+
+static SFXHASH* get_cache(const AppIdModuleConfig* mod_config)
+{
+    if ( !learned_cache )
+    {
+        // lru entries are recycled once the table is full
+        learned_cache = sfxhash_new(HASH_NUM_ROWS, sizeof(LearnedAppKey),
+            sizeof(LearnedAppVal), 0, 1, nullptr, nullptr, 1);
+
+        if ( !learned_cache )
+        {
+            ErrorMessage("learnedAppCache: Failed to allocate learned cache!");
+            return nullptr;
+        }
+        sfxhash_set_max_nodes(learned_cache, mod_config->learn_cache_size);
+        sfxhash_set_stats(learned_cache, "appid_learned_app");
+    }
+    return learned_cache;
+}
+
+LearnedAppVal* learnedAppCacheFind(
+    const sfip_t* ip, uint16_t port, IpProtocol proto, const AppIdModuleConfig* mod_config)
+{
+    SFXHASH* cache = get_cache(mod_config);
+
+    if ( !cache )
+        return nullptr;
+
+    LearnedAppKey key;
+    make_key(key, ip, port, proto);
+
+    LearnedAppVal* val = (LearnedAppVal*)sfxhash_find(cache, &key);
+
+    if ( !val )
+        return nullptr;
+
+    if ( packet_time() >= val->expires )
+    {
+        sfxhash_remove(cache, &key);
+        appid_stats.learned_expired++;
+        return nullptr;
+    }
+
+    // let the detectors confirm the verdict now and then
+    if ( mod_config->learn_cache_verify and
+        !(++val->hits % mod_config->learn_cache_verify) )
+        return nullptr;
+
+    appid_stats.learned_hits++;
+    return val;
+}
+
+void learnedAppCacheAdd(
+    const sfip_t* ip, uint16_t port, IpProtocol proto, AppId service, AppId client,
+    const AppIdModuleConfig* mod_config)
+{
+    SFXHASH* cache = get_cache(mod_config);
+
+    if ( !cache )
+        return;
+
+    LearnedAppKey key;
+    make_key(key, ip, port, proto);
+
+    SFXHASH_NODE* node = sfxhash_find_node(cache, &key);
+
+    if ( !node )
+    {
+        if ( !(node = sfxhash_get_node(cache, &key)) )
+            return;
+
+        memset(node->data, 0, sizeof(LearnedAppVal));
+    }
+
+    LearnedAppVal* val = (LearnedAppVal*)node->data;
+
+    if ( val->serviceAppId != service or val->ClientAppId != client )
+    {
+        val->serviceAppId = service;
+        val->ClientAppId = client;
+        val->hits = 0;
+        appid_stats.learned_adds++;
+    }
+    val->expires = packet_time() + mod_config->learn_cache_ttl;
+}
+
+void learnedAppCacheFini()
+{
+    if ( learned_cache )
+    {
+        sfxhash_delete(learned_cache);
+        learned_cache = nullptr;
+    }
+}
+
@@ -0,0 +1,54 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// learned_app_cache.h
+
+#ifndef LEARNED_APP_CACHE_H
+#define LEARNED_APP_CACHE_H
+
+// per thread cache of the service and client ids detected for a server.
+// unlike the host port cache these entries are learned from traffic, so
+// they expire and every so often a hit is passed over to have the full
+// detectors run again and refresh the entry.
+
+#include "sfip/sfip_t.h"
+#include "appid_api.h"
+
+class AppIdModuleConfig;
+enum class IpProtocol : uint8_t;
+
+struct LearnedAppVal
+{
+    AppId serviceAppId;
+    AppId ClientAppId;
+    time_t expires;
+    uint32_t hits;
+};
+
+// returns nullptr on a miss, an expired entry, or a verification hit
+LearnedAppVal* learnedAppCacheFind(
+    const sfip_t*, uint16_t port, IpProtocol, const AppIdModuleConfig*);
+
+void learnedAppCacheAdd(
+    const sfip_t*, uint16_t port, IpProtocol, AppId service, AppId client,
+    const AppIdModuleConfig*);
+
+void learnedAppCacheFini();
+
+#endif
+
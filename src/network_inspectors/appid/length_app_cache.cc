@@ -42,6 +42,8 @@ void lengthAppCacheInit(AppIdConfig* pConfig)
     {
         ErrorMessage("lengthAppCache: Failed to allocate length cache!");
     }
+    else
+        sfxhash_set_stats(pConfig->lengthCache, "appid_length");
 }
 
 void lengthAppCacheFini(AppIdConfig* pConfig)
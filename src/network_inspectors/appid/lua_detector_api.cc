@@ -38,6 +38,7 @@
 #include "fw_appid.h"
 #include "host_port_app_cache.h"
 #include "http_common.h"
+#include "lua_detector_ffi.h"
 #include "lua_detector_flow_api.h"
 #include "lua_detector_module.h"
 #include "lua_detector_util.h"
@@ -300,6 +301,53 @@ static int service_analyzePayload(lua_State* L)
     return 0;
 }
 
+static THREAD_LOCAL AppIdDetectorPacket ffi_packet;
+
+SO_PUBLIC const AppIdDetectorPacket* appid_detector_packet()
+{
+    return &ffi_packet;
+}
+
+static void set_ffi_packet(const uint8_t* data, uint16_t size, int dir, const Packet* p)
+{
+    ffi_packet.data = data;
+    ffi_packet.size = size;
+    ffi_packet.dir = dir;
+
+    const sfip_t* sip = p->ptrs.ip_api.get_src();
+    const sfip_t* dip = p->ptrs.ip_api.get_dst();
+
+    ffi_packet.src_ip = sip ? sip->ip32 : nullptr;
+    ffi_packet.dst_ip = dip ? dip->ip32 : nullptr;
+    ffi_packet.family = sip ? sip->family : 0;
+    ffi_packet.src_port = p->ptrs.sp;
+    ffi_packet.dst_port = p->ptrs.dp;
+    ffi_packet.proto = to_utype(p->get_ip_proto_next());
+}
+
+static void clear_ffi_packet()
+{
+    memset(&ffi_packet, 0, sizeof(ffi_packet));
+}
+
+// push the validator, looking it up by name only on the first call
+static bool push_validator(lua_State* L, int& ref, const std::string& fn)
+{
+    if ( !ref )
+    {
+        lua_getglobal(L, fn.c_str());
+
+        if ( !lua_isfunction(L, -1) )
+        {
+            lua_pop(L, 1);
+            return false;
+        }
+        ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+    lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+    return true;
+}
+
 // Design notes: Due to following two design limitations:
 //  a. lua validate functions, known only at runtime, can not be wrapped inside unique
 //     C functions at runtime and
@@ -336,14 +384,15 @@ int validateAnyService(ServiceValidationArgs* args)
     /*Note: Some frequently used header fields may be extracted and stored in detector for
       better performance. */
 
-    if ( detector->packageInfo.server.validateFunctionName.empty() || !lua_checkstack(L, 1) )
+    if ( detector->packageInfo.server.validateFunctionName.empty() || !lua_checkstack(L, 1) ||
+        !push_validator(L, detector->serverValidateRef,
+        detector->packageInfo.server.validateFunctionName) )
     {
         ErrorMessage("server %s: invalid LUA %s\n", serverName.c_str(), lua_tostring(L, -1));
         detector->validateParams.pkt = nullptr;
         return SERVICE_ENULL;
     }
-
-    lua_getglobal(L, detector->packageInfo.server.validateFunctionName.c_str());
+    set_ffi_packet(args->data, args->size, args->dir, args->pkt);
 
     DebugFormat(DEBUG_APPID, "server %s: Lua Memory usage %d\n",serverName.c_str(), lua_gc(L,
         LUA_GCCOUNT, 0));
@@ -358,11 +407,13 @@ int validateAnyService(ServiceValidationArgs* args)
           by other detectors or future packets by the same detector. */
         ErrorMessage("server %s: error validating %s\n", serverName.c_str(), lua_tostring(L, -1));
         detector->validateParams.pkt = nullptr;
+        clear_ffi_packet();
         return SERVICE_ENULL;
     }
+    clear_ffi_packet();
 
     /**detectorFlows must be destroyed after each packet is processed.*/
-    sflist_static_free_all(&allocatedFlowList, freeDetectorFlow);
+    allocatedFlowList.clear(freeDetectorFlow);
 
     /* retrieve result */
     if ( !lua_isnumber(L, -1) )
@@ -541,6 +592,12 @@ static int service_setValidator(lua_State* L)
 
     ud->packageInfo.server.validateFunctionName = pValidator;
 
+    if ( ud->serverValidateRef )
+    {
+        luaL_unref(L, LUA_REGISTRYINDEX, ud->serverValidateRef);
+        ud->serverValidateRef = 0;
+    }
+
     lua_pushnumber(L, 0);
     return 1;
 }
@@ -978,14 +1035,15 @@ CLIENT_APP_RETCODE validateAnyClientApp(
     validateFn = detector->packageInfo.client.validateFunctionName.c_str();
     clientName = detector->name.c_str();
 
-    if ((!validateFn) || !(lua_checkstack(myLuaState, 1)))
+    if ((!validateFn) || !(lua_checkstack(myLuaState, 1)) ||
+        !push_validator(myLuaState, detector->clientValidateRef,
+        detector->packageInfo.client.validateFunctionName))
     {
         ErrorMessage("client %s: invalid LUA %s\n",clientName, lua_tostring(myLuaState, -1));
         detector->validateParams.pkt = nullptr;
         return CLIENT_APP_ENULL;
     }
-
-    lua_getglobal(myLuaState, validateFn);
+    set_ffi_packet(data, size, dir, pkt);
 
     DebugFormat(DEBUG_APPID,"client %s: Lua Memory usage %d\n",clientName, lua_gc(myLuaState,
         LUA_GCCOUNT,0));
@@ -995,11 +1053,13 @@ CLIENT_APP_RETCODE validateAnyClientApp(
     {
         ErrorMessage("client %s: error validating %s\n",clientName, lua_tostring(myLuaState, -1));
         detector->validateParams.pkt = nullptr;
+        clear_ffi_packet();
         return (CLIENT_APP_RETCODE)SERVICE_ENULL;
     }
+    clear_ffi_packet();
 
     /**detectorFlows must be destroyed after each packet is processed.*/
-    sflist_static_free_all(&allocatedFlowList, freeDetectorFlow);
+    allocatedFlowList.clear(freeDetectorFlow);
 
     /* retrieve result */
     if (!lua_isnumber(myLuaState, -1))
@@ -3386,6 +3446,12 @@ Detector::~Detector()
     if ( detectorUserDataRef != LUA_REFNIL )
         luaL_unref(myLuaState, LUA_REGISTRYINDEX, detectorUserDataRef);
 
+    if ( serverValidateRef )
+        luaL_unref(myLuaState, LUA_REGISTRYINDEX, serverValidateRef);
+
+    if ( clientValidateRef )
+        luaL_unref(myLuaState, LUA_REGISTRYINDEX, clientValidateRef);
+
     delete[] validatorBuffer;
 }
 
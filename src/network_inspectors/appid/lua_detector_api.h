@@ -107,6 +107,11 @@ struct Detector
     /**Reference to lua userdata. This is a key into LUA_REGISTRYINDEX */
     int detectorUserDataRef;
 
+    /**validate functions, resolved on first use. 0 until then since
+     * registry refs are always positive. */
+    int serverValidateRef = 0;
+    int clientValidateRef = 0;
+
     std::string name; // lua file name is used as detector name
 
     /**Package information retrieved from detector lua file.
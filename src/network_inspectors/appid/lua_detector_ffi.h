@@ -0,0 +1,55 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// lua_detector_ffi.h
+
+#ifndef LUA_DETECTOR_FFI_H
+#define LUA_DETECTOR_FFI_H
+
+// zero copy view of the packet being validated for lua detectors.  the
+// detectors get this through luajit ffi instead of the Detector methods
+// so reading the payload doesn't go through the lua stack:
+//
+//     local pkt = ffi.C.appid_detector_packet()
+//     if pkt.size > 4 and pkt.data[0] == 0x16 then ...
+//
+// the view is only valid while a validator is running.
+// keep LUA_DETECTOR_FFI_DEFS in lua_detector_module.cc in sync with this.
+
+#include <stdint.h>
+
+struct AppIdDetectorPacket
+{
+    const uint8_t* data;
+    unsigned size;
+    int dir;
+
+    // flow key
+    const uint32_t* src_ip;  // 4 words, ipv4 uses the first
+    const uint32_t* dst_ip;
+    uint16_t family;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t proto;
+};
+
+extern "C"
+const struct AppIdDetectorPacket* appid_detector_packet();
+
+#endif
+
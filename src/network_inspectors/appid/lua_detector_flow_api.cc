@@ -223,7 +223,7 @@ static int DetectorFlow_new(lua_State* L)
     lua_pushvalue(L, -1);
     detector_flow->userDataRef = luaL_ref(L, LUA_REGISTRYINDEX);
 
-    sflist_add_tail(&allocatedFlowList, detector_flow);
+    allocatedFlowList.push_back(detector_flow);
 
     detector_flow->pFlow = AppIdEarlySessionCreate((AppIdData*)detector_flow,
         detector_ud->validateParams.pkt,
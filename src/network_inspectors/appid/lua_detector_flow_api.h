@@ -25,6 +25,8 @@
 // This module supports API towards Lua detectors for performing specific operations on a flow object.
 // The flow object on Lua side is a userData.
 
+#include "utils/intrusive_list.h"
+
 struct lua_State;
 class AppIdData;
 
@@ -34,6 +36,7 @@ struct DetectorFlow
     lua_State* myLuaState;
     AppIdData* pFlow;
     int userDataRef;
+    IntrusiveLink<DetectorFlow> link;
 };
 
 int DetectorFlow_register(lua_State*);
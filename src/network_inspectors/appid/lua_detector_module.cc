@@ -25,6 +25,12 @@
 
 #include <list>
 #include <algorithm>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <glob.h>
 #include <lua.hpp>
 #include <openssl/md5.h>
@@ -58,7 +64,7 @@
 // during loading, we don't need to use synchronization measures to access it.
 static std::list<Detector*> allocatedDetectorList;
 
-SF_LIST allocatedFlowList;  /*list of flows allocated. */
+DetectorFlowList allocatedFlowList;  /*list of flows allocated. */
 static uint32_t gLuaTrackerSize = 0;
 static unsigned gNumDetectors = 0;
 static unsigned gNumActiveDetectors;
@@ -162,6 +168,19 @@ static inline bool get_lua_field(
     return result;
 }
 
+// declares the packet view from lua_detector_ffi.h so detectors can use
+// ffi.C.appid_detector_packet() without any setup of their own
+#define LUA_DETECTOR_FFI_DEFS \
+    "ffi = require('ffi')\n" \
+    "ffi.cdef[[\n" \
+    "struct AppIdDetectorPacket {\n" \
+    "    const uint8_t* data; unsigned size; int dir;\n" \
+    "    const uint32_t* src_ip; const uint32_t* dst_ip;\n" \
+    "    uint16_t family; uint16_t src_port; uint16_t dst_port; uint8_t proto;\n" \
+    "};\n" \
+    "const struct AppIdDetectorPacket* appid_detector_packet();\n" \
+    "]]\n"
+
 static lua_State* createLuaState()
 {
     // FIXIT-H J should obtain lua states from lua state factory
@@ -197,6 +216,12 @@ static lua_State* createLuaState()
     DetectorFlow_register(L);
     lua_pop(L, 1);
 
+    if ( luaL_dostring(L, LUA_DETECTOR_FFI_DEFS) )
+    {
+        ErrorMessage("Could not declare the lua detector ffi api: %s\n", lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+
 #ifdef REMOVED_WHILE_NOT_IN_USE
     /*The garbage-collector pause controls how long the collector waits before
       starting a new cycle. Larger values make the collector less aggressive.
@@ -592,38 +617,19 @@ static inline void setLuaTrackerSize(lua_State* L, uint32_t numTrackers)
     lua_pop(L, 1);
 }
 
-static void luaCustomLoad( char* detectorName, char* validator, unsigned int validatorLen,
+// L has already run the validator chunk
+static void luaCustomLoad( char* detectorName, char* validator, lua_State* L,
         unsigned char* const digest, AppIdConfig* pConfig, bool isCustom)
 {
     Detector* detector;
     RNAClientAppModule* cam = nullptr;
 
-    lua_State* L = createLuaState();
-    if ( !L )
-    {
-        ErrorMessage("can not create new luaState");
-        snort_free(validator);
-        return;
-    }
-
-    if ( luaL_loadbuffer(L, validator, validatorLen, "<buffer>") ||
-        lua_pcall(L, 0, 0, 0) )
-    {
-        ErrorMessage("cannot run validator %s, error: %s\n",
-            detectorName, lua_tostring(L, -1));
-
-        lua_close(L);
-        snort_free(validator);
-
-        return;
-    }
-
     detector = createDetector(L, detectorName);
     if ( !detector )
     {
         ErrorMessage("cannot allocate detector %s\n", detectorName);
         lua_close(L);
-        snort_free(validator);
+        delete[] validator;
 
         return;
     }
@@ -673,7 +679,7 @@ static void luaCustomLoad( char* detectorName, char* validator, unsigned int val
 
 void LuaDetectorModuleManager::luaModuleInit()
 {
-    sflist_init(&allocatedFlowList);
+    allocatedFlowList.clear();
     allocatedDetectorList.clear();
 }
 
@@ -698,10 +704,232 @@ static inline uint32_t calculateLuaTrackerSize(u_int64_t rnaMemory, uint32_t num
     return (numTrackers > LUA_TRACKERS_MAX) ? LUA_TRACKERS_MAX : numTrackers;
 }
 
+//-------------------------------------------------------------------------
+// detector files are read, hashed and run in their own lua states by
+// helper threads.  creating and registering the detectors from those
+// states stays serial and in glob order.
+//
+// compiled chunks are cached by the md5 of the source, in memory and in
+// lua_cache_dir if configured, so only new or changed detectors are
+// compiled.
+//-------------------------------------------------------------------------
+
+struct LuaDetectorFile
+{
+    const char* path;
+    char name[LUA_DETECTOR_FILENAME_MAX];
+    unsigned char digest[16];
+    uint8_t* validator = nullptr;
+    long validator_len = 0;
+    lua_State* L = nullptr;
+    Detector* loaded = nullptr;
+};
+
+static std::unordered_map<std::string, std::string> chunk_cache;
+static std::mutex chunk_mutex;
+
+static int dump_chunk(lua_State*, const void* p, size_t sz, void* ud)
+{
+    ((std::string*)ud)->append((const char*)p, sz);
+    return 0;
+}
+
+static std::string chunk_file(const char* dir, const unsigned char* digest)
+{
+    std::string f = dir;
+    f += "/";
+
+    for ( unsigned i = 0; i < 16; ++i )
+    {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02x", digest[i]);
+        f += hex;
+    }
+    return f + ".luac";
+}
+
+static bool get_chunk(const char* dir, const std::string& key, std::string& chunk)
+{
+    {
+        std::lock_guard<std::mutex> lock(chunk_mutex);
+        auto it = chunk_cache.find(key);
+
+        if ( it != chunk_cache.end() )
+        {
+            chunk = it->second;
+            return true;
+        }
+    }
+
+    if ( !dir )
+        return false;
+
+    FILE* file = fopen(chunk_file(dir, (const unsigned char*)key.data()).c_str(), "rb");
+
+    if ( !file )
+        return false;
+
+    char buf[4096];
+    size_t n;
+
+    while ( (n = fread(buf, 1, sizeof(buf), file)) > 0 )
+        chunk.append(buf, n);
+
+    fclose(file);
+    return !chunk.empty();
+}
+
+static void put_chunk(const char* dir, const std::string& key, const std::string& chunk)
+{
+    {
+        std::lock_guard<std::mutex> lock(chunk_mutex);
+        chunk_cache[key] = chunk;
+    }
+
+    if ( !dir )
+        return;
+
+    // the cache is only an optimization so failures are ignored
+    std::string f = chunk_file(dir, (const unsigned char*)key.data());
+    std::string tmp = f + ".tmp";
+
+    if ( FILE* file = fopen(tmp.c_str(), "wb") )
+    {
+        bool ok = fwrite(chunk.data(), chunk.size(), 1, file) == 1;
+        ok = !fclose(file) and ok;
+
+        if ( !ok or rename(tmp.c_str(), f.c_str()) )
+            remove(tmp.c_str());
+    }
+}
+
+static bool read_detector(LuaDetectorFile& df)
+{
+    FILE* file;
+
+    if ((file = fopen(df.path, "r")) == nullptr)
+    {
+        ErrorMessage("Unable to read lua detector '%s'\n", df.path);
+        return false;
+    }
+
+    /*Load lua file as a detector. */
+    if (fseek(file, 0, SEEK_END))
+    {
+        ErrorMessage("Unable to seek lua detector '%s'\n", df.path);
+        fclose(file);
+        return false;
+    }
+
+    df.validator_len = ftell(file);
+
+    if (df.validator_len == -1)
+    {
+        ErrorMessage("Unable to return offset on lua detector '%s'\n", df.path);
+        fclose(file);
+        return false;
+    }
+    if (fseek(file, 0, SEEK_SET))
+    {
+        ErrorMessage("Unable to seek lua detector '%s'\n", df.path);
+        fclose(file);
+        return false;
+    }
+
+    df.validator = new uint8_t[df.validator_len + 1]();
+
+    if (fread(df.validator, df.validator_len, 1, file) == 0)
+    {
+        ErrorMessage("Failed to read lua detector %s\n", df.path);
+        delete[] df.validator;
+        df.validator = nullptr;
+        fclose(file);
+        return false;
+    }
+
+    fclose(file);
+    df.validator[df.validator_len] = '\0';
+
+    MD5CONTEXT context;
+    MD5INIT(&context);
+    MD5UPDATE(&context, df.validator, df.validator_len);
+    MD5FINAL(df.digest, &context);
+
+    return true;
+}
+
+// runs on a helper thread; only reads allocatedDetectorList
+static void prepare_detector(LuaDetectorFile& df, const char* cache_dir)
+{
+    if ( !read_detector(df) )
+        return;
+
+    // FIXIT-H J this finds the wrong detector -- it should be find_last_of
+    auto it = std::find_if(
+        allocatedDetectorList.begin(),
+        allocatedDetectorList.end(),
+        [&df](const Detector* d) {
+        return d->name == df.name;
+    });
+
+    if ( it != allocatedDetectorList.end() and
+        !memcmp(df.digest, (*it)->digest, sizeof(df.digest)) )
+    {
+        df.loaded = *it;
+        return;
+    }
+
+    lua_State* L = createLuaState();
+    if ( !L )
+    {
+        ErrorMessage("can not create new luaState");
+        return;
+    }
+
+    std::string key((const char*)df.digest, sizeof(df.digest));
+    std::string chunk;
+    int rc = -1;
+
+    if ( get_chunk(cache_dir, key, chunk) )
+    {
+        // a stale or damaged chunk is replaced from the source
+        if ( (rc = luaL_loadbuffer(L, chunk.data(), chunk.size(), "<buffer>")) )
+        {
+            lua_pop(L, 1);
+            chunk.clear();
+        }
+    }
+
+    if ( rc )
+    {
+        rc = luaL_loadbuffer(L, (char*)df.validator, df.validator_len, "<buffer>");
+
+        if ( !rc and !lua_dump(L, dump_chunk, &chunk) )
+            put_chunk(cache_dir, key, chunk);
+    }
+
+    if ( rc || lua_pcall(L, 0, 0, 0) )
+    {
+        ErrorMessage("cannot run validator %s, error: %s\n",
+            df.name, lua_tostring(L, -1));
+
+        lua_close(L);
+        return;
+    }
+
+    df.L = L;
+}
+
+static void prepare_worker(
+    std::vector<LuaDetectorFile>* files, unsigned first, unsigned step, const char* cache_dir)
+{
+    for ( unsigned i = first; i < files->size(); i += step )
+        prepare_detector((*files)[i], cache_dir);
+}
+
 static void loadCustomLuaModules(char* path, AppIdConfig* pConfig, bool isCustom)
 {
     unsigned n;
-    FILE* file;
     char pattern[PATH_MAX];
     snprintf(pattern, sizeof(pattern), "%s/*", path);
 
@@ -714,12 +942,10 @@ static void loadCustomLuaModules(char* path, AppIdConfig* pConfig, bool isCustom
         return;
     }
 
-    // Open each RNA detector file and gather detector information from it
+    std::vector<LuaDetectorFile> files(globs.gl_pathc);
+
     for (n = 0; n < globs.gl_pathc; n++)
     {
-        unsigned char digest[16];
-        MD5CONTEXT context;
-        char detectorName[LUA_DETECTOR_FILENAME_MAX];
         char* basename;
 
         basename = strrchr(globs.gl_pathv[n], '/');
@@ -729,71 +955,37 @@ static void loadCustomLuaModules(char* path, AppIdConfig* pConfig, bool isCustom
         }
         basename++;
 
-        snprintf(detectorName, LUA_DETECTOR_FILENAME_MAX, "%s_%s", (isCustom ? "custom" : "cisco"),
-            basename);
-
-        if ((file = fopen(globs.gl_pathv[n], "r")) == nullptr)
-        {
-            ErrorMessage("Unable to read lua detector '%s'\n",globs.gl_pathv[n]);
-            continue;
-        }
-
-        /*Load lua file as a detector. */
-        if (fseek(file, 0, SEEK_END))
-        {
-            ErrorMessage("Unable to seek lua detector '%s'\n",globs.gl_pathv[n]);
-            continue;
-        }
-
-        auto validatorBufferLen = ftell(file);
-
-        if (validatorBufferLen == -1)
-        {
-            ErrorMessage("Unable to return offset on lua detector '%s'\n",globs.gl_pathv[n]);
-            continue;
-        }
-        if (fseek(file, 0, SEEK_SET))
-        {
-            ErrorMessage("Unable to seek lua detector '%s'\n",globs.gl_pathv[n]);
-            continue;
-        }
-
-        auto validatorBuffer = new uint8_t[validatorBufferLen + 1]();
-
-        if (fread(validatorBuffer, validatorBufferLen, 1, file) == 0)
-        {
-            ErrorMessage("Failed to read lua detector %s\n",globs.gl_pathv[n]);
-            delete[] validatorBuffer;
-            continue;
-        }
+        files[n].path = globs.gl_pathv[n];
+        snprintf(files[n].name, LUA_DETECTOR_FILENAME_MAX, "%s_%s",
+            (isCustom ? "custom" : "cisco"), basename);
+    }
 
-        validatorBuffer[validatorBufferLen] = '\0';
+    // Open each RNA detector file and gather detector information from it
+    const char* cache_dir = pConfig->mod_config->lua_cache_dir;
+    unsigned max = std::max(std::thread::hardware_concurrency(), 1u);
+    unsigned num = std::min(max, (unsigned)files.size());
+    std::vector<std::future<void>> workers;
 
-        MD5INIT(&context);
-        MD5UPDATE(&context, validatorBuffer, validatorBufferLen);
-        MD5FINAL(digest, &context);
+    for ( unsigned i = 0; i < num; ++i )
+        workers.push_back(std::async(std::launch::async, prepare_worker, &files, i, num,
+            cache_dir));
 
-        // FIXIT-H J this finds the wrong detector -- it should be find_last_of
-        auto it = std::find_if(
-            allocatedDetectorList.begin(),
-            allocatedDetectorList.end(),
-            [&detectorName](const Detector* d) {
-            return d->name == detectorName;
-        });
+    for ( auto& w : workers )
+        w.wait();
 
-        if ( it != allocatedDetectorList.end() )
+    for ( auto& df : files )
+    {
+        if ( df.loaded )
         {
-            Detector* detector = *it;
-            if ( !memcmp(digest, detector->digest, sizeof(digest)) )
-            {
-                detector->isActive = true;
-                detector->pAppidNewConfig = pConfig;
-                delete[] validatorBuffer;
-            }
+            df.loaded->isActive = true;
+            df.loaded->pAppidNewConfig = pConfig;
+            delete[] df.validator;
         }
+        else if ( df.L )
+            luaCustomLoad(df.name, (char*)df.validator, df.L, df.digest, pConfig, isCustom);
 
-        luaCustomLoad(detectorName, (char*)validatorBuffer, validatorBufferLen, digest, pConfig,
-            isCustom);
+        else
+            delete[] df.validator;
     }
 
     globfree(&globs);
@@ -935,7 +1127,7 @@ void LuaDetectorModuleManager::luaModuleFini()
 
     /*flow can be freed during garbage collection */
 
-    sflist_static_free_all(&allocatedFlowList, freeDetectorFlow);
+    allocatedFlowList.clear(freeDetectorFlow);
     allocatedDetectorList.clear();
 }
 
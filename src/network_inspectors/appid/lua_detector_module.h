@@ -24,7 +24,9 @@
 
 #include <string>
 
-#include "utils/sflsq.h"
+#include "utils/intrusive_list.h"
+
+#include "lua_detector_flow_api.h"
 
 class AppIdConfig;
 
@@ -64,7 +66,9 @@ void RNAPndDumpLuaStats();
 void luaDetectorsUnload(AppIdConfig*);
 void luaDetectorsSetTrackerSize();
 
-extern SF_LIST allocatedFlowList;
+// detector flows created by the current packet; freed when it is done
+typedef IntrusiveList<DetectorFlow, &DetectorFlow::link> DetectorFlowList;
+extern DetectorFlowList allocatedFlowList;
 
 #endif
 
@@ -54,10 +54,12 @@
 #include "service_tftp.h"
 #include "appid_flow_data.h"
 #include "appid_config.h"
+#include "appid_module.h"
 #include "fw_appid.h"
 #include "lua_detector_api.h"
 #include "lua_detector_module.h"
 #include "util/ip_funcs.h"
+#include "util/pattern_index.h"
 #include "detector_plugins/detector_dns.h"
 #include "detector_plugins/detector_pattern.h"
 #include "detector_plugins/detector_sip.h"
@@ -80,7 +82,6 @@
 /* If this is greater than 1, more than 1 service detector can be searched for
  * and tried per flow based on port/pattern (if a valid detector doesn't
  * already exist). */
-#define MAX_CANDIDATE_SERVICES 10
 
 static void* service_flowdata_get(AppIdData* flow, unsigned service_id);
 static int service_flowdata_add(AppIdData* flow, void* data, unsigned service_id, AppIdFreeFCN
@@ -446,7 +447,8 @@ static void ServiceRegisterPattern(RNAServiceValidationFCN fcn,
     int position, struct Detector* userdata, int provides_user,
     const char* name, ServiceConfig* pServiceConfig)
 {
-    SearchTool** patterns;
+    PatternTenant** patterns;
+    PatternIndex** index;
     ServicePatternData** pd_list;
     int* count;
     ServicePatternData* pd;
@@ -456,6 +458,7 @@ static void ServiceRegisterPattern(RNAServiceValidationFCN fcn,
     if ((IpProtocol)proto == IpProtocol::TCP)
     {
         patterns = &pServiceConfig->tcp_patterns;
+        index = &pServiceConfig->tcp_index;
         pd_list = &pServiceConfig->tcp_pattern_data;
 
         count = &pServiceConfig->tcp_pattern_count;
@@ -464,6 +467,7 @@ static void ServiceRegisterPattern(RNAServiceValidationFCN fcn,
     else if ((IpProtocol)proto == IpProtocol::UDP)
     {
         patterns = &pServiceConfig->udp_patterns;
+        index = &pServiceConfig->udp_index;
         pd_list = &pServiceConfig->udp_pattern_data;
 
         count = &pServiceConfig->udp_pattern_count;
@@ -494,7 +498,7 @@ static void ServiceRegisterPattern(RNAServiceValidationFCN fcn,
 
     if (!(*patterns))
     {
-        *patterns = new SearchTool("ac_full");
+        *patterns = new PatternTenant(*index);
         if (!(*patterns))
         {
             ErrorMessage("Error initializing the pattern table for protocol %u\n",(unsigned)proto);
@@ -810,10 +814,11 @@ void ServiceInit(AppIdConfig*)
 
 void ServiceFinalize(AppIdConfig* pConfig)
 {
-    if (pConfig->serviceConfig.tcp_patterns)
-        pConfig->serviceConfig.tcp_patterns->prep();
-    if (pConfig->serviceConfig.udp_patterns)
-        pConfig->serviceConfig.udp_patterns->prep();
+    // pattern service detector patterns were added by portPatternFinalize()
+    if (pConfig->serviceConfig.tcp_index)
+        pConfig->serviceConfig.tcp_index->prep();
+    if (pConfig->serviceConfig.udp_index)
+        pConfig->serviceConfig.udp_index->prep();
 }
 
 void UnconfigureServices(AppIdConfig* pConfig)
@@ -973,6 +978,11 @@ void CleanupServices(AppIdConfig* pConfig)
     }
 
     CleanServicePortPatternList(pConfig);
+
+    delete pConfig->serviceConfig.tcp_index;
+    pConfig->serviceConfig.tcp_index = nullptr;
+    delete pConfig->serviceConfig.udp_index;
+    pConfig->serviceConfig.udp_index = nullptr;
 }
 
 static int AppIdPatternPrecedence(const void* a, const void* b)
@@ -998,7 +1008,7 @@ static int AppIdPatternPrecedence(const void* a, const void* b)
 static inline RNAServiceElement* AppIdGetServiceByPattern(const Packet* pkt, IpProtocol proto,
     const int, AppIdServiceIDState* id_state, const ServiceConfig* pServiceConfig)
 {
-    SearchTool* patterns = nullptr;
+    PatternTenant* patterns = nullptr;
     ServiceMatch* match_list;
     ServiceMatch* sm;
     uint32_t count;
@@ -1586,7 +1596,7 @@ int AppIdServiceIncompatibleData(AppIdData* flow, const Packet* pkt, int dir,
         && (flow->candidate_service_list != nullptr)
         && (flow->id_state != nullptr) )
     {
-        if (sflist_count(flow->candidate_service_list) != 0)
+        if (flow->candidate_service_list->count() != 0)
         {
             return SERVICE_SUCCESS;
         }
@@ -1715,7 +1725,7 @@ int AppIdServiceFailService(AppIdData* flow, const Packet* pkt, int dir,
         && (flow->candidate_service_list != nullptr)
         && (flow->id_state != nullptr) )
     {
-        if (sflist_count(flow->candidate_service_list) != 0)
+        if (flow->candidate_service_list->count() != 0)
             return SERVICE_SUCCESS;
         else if ( (flow->num_candidate_services_tried >= MAX_CANDIDATE_SERVICES)
             || (flow->id_state->state == SERVICE_ID_BRUTE_FORCE) )
@@ -2197,8 +2207,7 @@ int AppIdDiscoverService(Packet* p, const int dir, AppIdData* rnaData,
     {
         if (rnaData->candidate_service_list == nullptr)
         {
-            rnaData->candidate_service_list = (SF_LIST*)snort_calloc(sizeof(SF_LIST));
-            sflist_init(rnaData->candidate_service_list);
+            rnaData->candidate_service_list = new ServiceCandidates;
             rnaData->num_candidate_services_tried = 0;
 
             /* This is our first time in for this session, and we're about to
@@ -2222,15 +2231,10 @@ int AppIdDiscoverService(Packet* p, const int dir, AppIdData* rnaData,
                     id_state);
                 if (tmp != nullptr)
                 {
-                    SF_LNODE* iter = nullptr;
                     /* Add to list (if not already there). */
-                    service = (RNAServiceElement*)sflist_first(rnaData->candidate_service_list,
-                        &iter);
-                    while (service && (service != tmp))
-                        service = (RNAServiceElement*)sflist_next(&iter);
-                    if (service == nullptr)
+                    if (!rnaData->candidate_service_list->contains(tmp))
                     {
-                        sflist_add_tail(rnaData->candidate_service_list, (void*)tmp);
+                        rnaData->candidate_service_list->add(tmp);
                         rnaData->num_candidate_services_tried++;
                     }
                 }
@@ -2243,14 +2247,15 @@ int AppIdDiscoverService(Packet* p, const int dir, AppIdData* rnaData,
 
         /* Run all of the detectors that we currently have. */
         ret = SERVICE_INPROCESS;
-        SF_LNODE* iter;
-        service = (RNAServiceElement*)sflist_first(rnaData->candidate_service_list, &iter);
-        while (service)
+        ServiceCandidates::Node* node = rnaData->candidate_service_list->first();
+        while (node)
         {
             int result;
+            service = node->item;
 
             args.userdata = service->userdata;
             result = service->validate(&args);
+            appid_stats.service_candidate_runs++;
             if (result == SERVICE_NOT_COMPATIBLE)
                 rnaData->got_incompatible_services = 1;
             if (app_id_debug_session_flag)
@@ -2261,23 +2266,23 @@ int AppIdDiscoverService(Packet* p, const int dir, AppIdData* rnaData,
             {
                 ret = SERVICE_SUCCESS;
                 rnaData->serviceData = service;
-                sflist_free(rnaData->candidate_service_list);
+                delete rnaData->candidate_service_list;
                 rnaData->candidate_service_list = nullptr;
                 break;    /* done */
             }
             else if (result != SERVICE_INPROCESS)    /* fail */
             {
-                sflist_remove_node(rnaData->candidate_service_list, iter);
-                service = (RNAServiceElement*)sflist_first(rnaData->candidate_service_list, &iter);
+                rnaData->candidate_service_list->remove(node);
+                node = rnaData->candidate_service_list->first();
             }
             else
-                service = (RNAServiceElement*)sflist_next(&iter);
+                node = ServiceCandidates::next(node);
         }
 
         /* If we tried everything and found nothing, then fail. */
         if (ret != SERVICE_SUCCESS)
         {
-            if (    (sflist_count(rnaData->candidate_service_list) == 0)
+            if (    (rnaData->candidate_service_list->count() == 0)
                 && (    (rnaData->num_candidate_services_tried >= MAX_CANDIDATE_SERVICES)
                 || (id_state->state == SERVICE_ID_BRUTE_FORCE) ) )
             {
@@ -34,6 +34,8 @@
 struct RNAServiceElement;
 struct RNAServiceValidationModule;
 class SearchTool;
+class PatternIndex;
+class PatternTenant;
 
 struct SSLCertPattern
 {
@@ -98,12 +100,16 @@ struct ServiceConfig
     SF_LIST* udp_services[RNA_SERVICE_MAX_PORT];
     SF_LIST* udp_reversed_services[RNA_SERVICE_MAX_PORT];
 
-    SearchTool* tcp_patterns;
+    PatternTenant* tcp_patterns;
     ServicePatternData* tcp_pattern_data;
     int tcp_pattern_count;
-    SearchTool* udp_patterns;
+    PatternTenant* udp_patterns;
     ServicePatternData* udp_pattern_data;
     int udp_pattern_count;
+
+    // responder payload engines shared with the pattern service detector
+    PatternIndex* tcp_index = nullptr;
+    PatternIndex* udp_index = nullptr;
 };
 
 #endif
@@ -21,6 +21,7 @@
 
 #include "service_state.h"
 
+#include "hash/sfhashfcn.h"
 #include "hash/sfxhash.h"
 #include "log/messages.h"
 #include "service_plugins/service_base.h"
@@ -60,6 +61,9 @@ int AppIdServiceStateInit(unsigned long memcap)
         ErrorMessage("Failed to allocate a hash table");
         return -1;
     }
+    sfxhash_set_hash_type(serviceStateCache4, SFHASH_SIP);
+    sfxhash_set_stats(serviceStateCache4, "appid_service_state4");
+
     serviceStateCache6 = sfxhash_new(SERVICE_STATE_CACHE_ROWS,
         sizeof(AppIdServiceStateKey6),
         sizeof(AppIdServiceIDState),
@@ -73,6 +77,8 @@ int AppIdServiceStateInit(unsigned long memcap)
         ErrorMessage("Failed to allocate a hash table");
         return -1;
     }
+    sfxhash_set_hash_type(serviceStateCache6, SFHASH_SIP);
+    sfxhash_set_stats(serviceStateCache6, "appid_service_state6");
     return 0;
 }
 
@@ -0,0 +1,144 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// pattern_index.cc author Sourcefire Inc.
+
+#include "pattern_index.h"
+
+#include "main/thread.h"
+#include "search_engines/search_tool.h"
+
+// hits of the last buffer scanned on this thread.  if the scan overflows
+// the hits, each tenant runs the engine again for its own.
+#define MAX_SCAN_HITS 256
+
+struct ScanHit
+{
+    const void* owner;
+    int index;
+};
+
+static THREAD_LOCAL const PatternIndex* scan_index = nullptr;
+static THREAD_LOCAL const char* scan_data = nullptr;
+static THREAD_LOCAL unsigned scan_len = 0;
+static THREAD_LOCAL unsigned scan_hits = 0;
+static THREAD_LOCAL ScanHit scan_hit[MAX_SCAN_HITS];
+
+static int record_hit(void* id, void*, int index, void*, void*)
+{
+    if ( scan_hits < MAX_SCAN_HITS )
+        scan_hit[scan_hits] = { id, index };
+
+    ++scan_hits;
+    return 0;
+}
+
+struct TenantScan
+{
+    const PatternTenant* tenant;
+    MpseMatch match;
+    void* user_data;
+    int count;
+};
+
+struct PatternOwner
+{
+    const PatternTenant* tenant;
+    void* id;
+};
+
+static int tenant_hit(void* id, void* tree, int index, void* data, void* neg)
+{
+    auto owner = (const PatternOwner*)id;
+    auto ts = (TenantScan*)data;
+
+    if ( owner->tenant != ts->tenant )
+        return 0;
+
+    ++ts->count;
+    return ts->match(owner->id, tree, index, ts->user_data, neg);
+}
+
+PatternIndex::PatternIndex()
+{ tool = new SearchTool("ac_full"); }
+
+PatternIndex::~PatternIndex()
+{
+    if ( scan_index == this )
+        clear_scan();
+
+    delete tool;
+
+    for ( auto o : owners )
+        delete o;
+}
+
+void PatternIndex::prep()
+{ tool->prep(); }
+
+void PatternIndex::clear_scan()
+{
+    scan_index = nullptr;
+    scan_data = nullptr;
+    scan_len = scan_hits = 0;
+}
+
+void PatternIndex::add(
+    const PatternTenant* tenant, const char* pat, unsigned len, void* id, bool no_case)
+{
+    PatternOwner* o = new PatternOwner { tenant, id };
+    owners.push_back(o);
+    tool->add(pat, len, o, no_case);
+}
+
+int PatternIndex::search(
+    const PatternTenant* tenant, const char* s, unsigned len, MpseMatch match, void* user_data)
+{
+    TenantScan ts { tenant, match, user_data, 0 };
+
+    if ( scan_index != this or scan_data != s or scan_len != len )
+    {
+        scan_index = this;
+        scan_data = s;
+        scan_len = len;
+        scan_hits = 0;
+        tool->find_all(s, len, record_hit);
+    }
+
+    if ( scan_hits > MAX_SCAN_HITS )
+    {
+        tool->find_all(s, len, tenant_hit, false, &ts);
+        return ts.count;
+    }
+
+    for ( unsigned i = 0; i < scan_hits; ++i )
+    {
+        if ( tenant_hit((void*)scan_hit[i].owner, nullptr, scan_hit[i].index, &ts, nullptr) )
+            break;
+    }
+    return ts.count;
+}
+
+PatternTenant::PatternTenant(PatternIndex*& pi)
+{
+    if ( !pi )
+        pi = new PatternIndex;
+
+    index = pi;
+}
+
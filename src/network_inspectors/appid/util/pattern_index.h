@@ -0,0 +1,86 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// pattern_index.h author Sourcefire Inc.
+
+#ifndef PATTERN_INDEX_H
+#define PATTERN_INDEX_H
+
+// A PatternIndex is one search engine shared by the detector families that
+// scan the same buffer, such as the service and pattern service detectors
+// on tcp payload.  Each family adds its patterns through its own
+// PatternTenant, which it uses like a SearchTool.  The first tenant to
+// search a buffer runs the engine once and keeps the hits; the other
+// tenants replay theirs from that scan.
+
+#include <stdint.h>
+#include <vector>
+
+#include "search_engines/search_common.h"
+
+class SearchTool;
+class PatternTenant;
+struct PatternOwner;
+
+class PatternIndex
+{
+public:
+    PatternIndex();
+    ~PatternIndex();
+
+    // the engine is compiled once after all tenants have added patterns
+    void prep();
+
+    // forget the last scan; call once per packet before searching
+    static void clear_scan();
+
+private:
+    friend class PatternTenant;
+
+    void add(const PatternTenant*, const char*, unsigned, void*, bool);
+    int search(const PatternTenant*, const char*, unsigned, MpseMatch, void*);
+
+    SearchTool* tool;
+    std::vector<PatternOwner*> owners;
+};
+
+class PatternTenant
+{
+public:
+    // creates *pi on first use
+    PatternTenant(PatternIndex*& pi);
+
+    void add(const char* pattern, unsigned len, void* s_context, bool no_case = true)
+    { index->add(this, pattern, len, s_context, no_case); }
+
+    void add(const uint8_t* pattern, unsigned len, void* s_context, bool no_case = true)
+    { index->add(this, (const char*)pattern, len, s_context, no_case); }
+
+    // see PatternIndex::prep()
+    void prep() { }
+
+    int find_all(const char* s, unsigned s_len, MpseMatch match,
+        bool = false, void* user_data = nullptr)
+    { return index->search(this, s, s_len, match, user_data); }
+
+private:
+    PatternIndex* index;
+};
+
+#endif
+
@@ -29,7 +29,7 @@
 #define ARPSPOOF_ARP_CACHE_OVERWRITE_ATTACK_STR \
     "attempted ARP cache overwrite attack"
 
-THREAD_LOCAL SimpleStats asstats;
+THREAD_LOCAL ArpStats asstats;
 
 //-------------------------------------------------------------------------
 // arp_spoof stuff
@@ -51,6 +51,9 @@ static const Parameter s_params[] =
     { "hosts", Parameter::PT_LIST, arp_spoof_hosts_params, nullptr,
       "configure ARP cache overwrite attacks" },
 
+    { "learn", Parameter::PT_INT, "0:1048576", "0",
+      "track up to this many IP-MAC bindings of unconfigured hosts per packet thread" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -71,6 +74,17 @@ static const RuleMap s_rules[] =
     { 0, nullptr }
 };
 
+static const PegInfo arp_pegs[] =
+{
+    { "packets", "total packets" },
+    { "lookups", "configured host lookups" },
+    { "hits", "lookups that found a configured host" },
+    { "learned", "bindings added to the learned table" },
+    { "changes", "learned bindings seen with a different MAC" },
+    { "evictions", "learned bindings replaced by another host" },
+    { nullptr, nullptr }
+};
+
 //-------------------------------------------------------------------------
 // arp_spoof module
 //-------------------------------------------------------------------------
@@ -101,6 +115,9 @@ bool ArpSpoofModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("mac") )
         v.get_mac(host.mac_addr);
 
+    else if ( v.is("learn") )
+        config->learn = v.get_long();
+
     else
         return false;
 
@@ -120,6 +137,7 @@ bool ArpSpoofModule::begin(const char*, int, SnortConfig*)
     {
         config = new ArpSpoofConfig;
         config->check_overwrite = false;
+        config->learn = 0;
     }
     memset(&host, 0, sizeof(host));
     return true;
@@ -136,7 +154,7 @@ bool ArpSpoofModule::end(const char*, int idx, SnortConfig*)
 }
 
 const PegInfo* ArpSpoofModule::get_pegs() const
-{ return simple_pegs; }
+{ return arp_pegs; }
 
 PegCount* ArpSpoofModule::get_counts() const
 { return (PegCount*)&asstats; }
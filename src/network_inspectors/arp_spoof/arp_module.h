@@ -36,7 +36,17 @@
 #define ARPSPOOF_ETHERFRAME_ARP_MISMATCH_DST  3
 #define ARPSPOOF_ARP_CACHE_OVERWRITE_ATTACK   4
 
-extern THREAD_LOCAL SimpleStats asstats;
+struct ArpStats
+{
+    PegCount total_packets;
+    PegCount lookups;
+    PegCount hits;
+    PegCount learned;
+    PegCount changes;
+    PegCount evictions;
+};
+
+extern THREAD_LOCAL ArpStats asstats;
 extern THREAD_LOCAL ProfileStats arpPerfStats;
 
 struct IPMacEntry
@@ -45,11 +55,13 @@ struct IPMacEntry
     uint8_t mac_addr[6];
 };
 
+// sorted by address for lookup
 typedef std::vector<IPMacEntry> IPMacEntryList;
 
 struct ArpSpoofConfig
 {
     bool check_overwrite;
+    unsigned learn;  // max bindings tracked per packet thread; 0 for none
 
     IPMacEntryList ipmel;
 };
@@ -51,8 +51,7 @@
  * hosts/devices on the **same layer 2 segment** !!
  *
  * Bugs:
- * This is a proof of concept ONLY.  It is clearly not complete.  Also, the
- * lookup function LookupIPMacEntryByIP is in need of optimization.  The
+ * This is a proof of concept ONLY.  It is clearly not complete.  The
  * arpspoof_detect_host functionality may false alarm in redundant environments.
  * Also, see the comment above pertaining to Linux systems.
  *
@@ -73,6 +72,7 @@
 #endif
 
 #include <assert.h>
+#include <algorithm>
 #include <sys/types.h>
 #include <stdlib.h>
 #include <string.h>
@@ -101,15 +101,75 @@ THREAD_LOCAL ProfileStats arpPerfStats;
 // implementation stuff
 //-------------------------------------------------------------------------
 
+static bool ip_less(const IPMacEntry& a, const IPMacEntry& b)
+{ return a.ipv4_addr < b.ipv4_addr; }
+
+// the list is sorted; the first configured entry for an address wins
 static IPMacEntry* LookupIPMacEntryByIP(
     IPMacEntryList& ipmel, uint32_t ipv4_addr)
 {
-    for ( auto& p : ipmel )
+    IPMacEntry key;
+    key.ipv4_addr = ipv4_addr;
+
+    auto p = std::lower_bound(ipmel.begin(), ipmel.end(), key, ip_less);
+
+    if ( p != ipmel.end() and p->ipv4_addr == ipv4_addr )
+        return &*p;
+
+    return nullptr;
+}
+
+//-------------------------------------------------------------------------
+// learned bindings
+//
+// a direct mapped table so memory is fixed; a host that hashes to a used
+// slot replaces it.
+//-------------------------------------------------------------------------
+
+struct ArpBinding
+{
+    uint32_t ipv4_addr;
+    uint8_t mac_addr[6];
+    bool used;
+};
+
+static THREAD_LOCAL ArpBinding* learned = nullptr;
+static THREAD_LOCAL unsigned learned_mask = 0;
+
+static inline unsigned learned_slot(uint32_t ipv4_addr)
+{
+    uint32_t h = ipv4_addr;
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return h & learned_mask;
+}
+
+static void learn_binding(uint32_t ipv4_addr, const uint8_t* mac)
+{
+    // probes have no sender address
+    if ( !ipv4_addr )
+        return;
+
+    ArpBinding& b = learned[learned_slot(ipv4_addr)];
+
+    if ( b.used and b.ipv4_addr == ipv4_addr )
     {
-        if (p.ipv4_addr == ipv4_addr)
-            return &p;
+        if ( memcmp(b.mac_addr, mac, 6) )
+        {
+            memcpy(b.mac_addr, mac, 6);
+            ++asstats.changes;
+        }
+        return;
     }
-    return nullptr;
+
+    if ( b.used )
+        ++asstats.evictions;
+
+    b.ipv4_addr = ipv4_addr;
+    memcpy(b.mac_addr, mac, 6);
+    b.used = true;
+    ++asstats.learned;
 }
 
 #ifdef DEBUG_MSGS
@@ -152,6 +212,9 @@ public:
     void show(SnortConfig*) override;
     void eval(Packet*) override;
 
+    void tinit() override;
+    void tterm() override;
+
 private:
     ArpSpoofConfig* config;
 };
@@ -159,6 +222,7 @@ private:
 ArpSpoof::ArpSpoof(ArpSpoofModule* mod)
 {
     config = mod->get_config();
+    std::stable_sort(config->ipmel.begin(), config->ipmel.end(), ip_less);
 }
 
 ArpSpoof::~ArpSpoof ()
@@ -166,6 +230,26 @@ ArpSpoof::~ArpSpoof ()
     delete config;
 }
 
+void ArpSpoof::tinit()
+{
+    if ( !config->learn )
+        return;
+
+    unsigned n = 1;
+
+    while ( n < config->learn )
+        n <<= 1;
+
+    learned = (ArpBinding*)snort_calloc(n, sizeof(*learned));
+    learned_mask = n - 1;
+}
+
+void ArpSpoof::tterm()
+{
+    snort_free(learned);
+    learned = nullptr;
+}
+
 void ArpSpoof::show(SnortConfig*)
 {
     LogMessage("arpspoof configured\n");
@@ -237,13 +321,24 @@ void ArpSpoof::eval(Packet* p)
         break;
     }
 
+    IPMacEntry* ipme = nullptr;
+
+    if ( config->check_overwrite )
+    {
+        ++asstats.lookups;
+        ipme = LookupIPMacEntryByIP(config->ipmel, ah->arp_spa32);
+    }
+
+    if ( !ipme and learned )
+        learn_binding(ah->arp_spa32, ah->arp_sha);
+
     /* return if the overwrite list hasn't been initialized */
     if (!config->check_overwrite)
         return;
 
-    IPMacEntry* ipme = LookupIPMacEntryByIP(config->ipmel, ah->arp_spa32);
     if ( ipme )
     {
+        ++asstats.hits;
         DebugFormat(DEBUG_INSPECTOR,
             "MODNAME: LookupIPMacEntryByIP returned %p\n", (void*) ipme);
 
@@ -101,6 +101,10 @@ static const Parameter binder_use_params[] =
     { "name", Parameter::PT_STRING, nullptr, nullptr,
       "symbol name (defaults to type)" },
 
+    { "depth", Parameter::PT_INT, "0:", "0",
+      "stop inspecting a flow after this many bytes in either direction if it "
+      "has no alerts, flowbits, or files (0 is unlimited)" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -193,6 +197,9 @@ bool BinderModule::set(const char* fqn, Value& v, SnortConfig*)
 
         work->use.type = v.get_string();
     }
+    else if ( v.is("depth") )
+        work->use.depth = v.get_long();
+
     else
         return false;
 
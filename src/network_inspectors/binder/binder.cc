@@ -17,6 +17,8 @@
 //--------------------------------------------------------------------------
 // binder.cc author Russ Combs <rucombs@cisco.com>
 
+#include <string>
+#include <unordered_map>
 #include <vector>
 using namespace std;
 
@@ -38,6 +40,7 @@ using namespace std;
 #include "main/snort_config.h"
 #include "main/policy.h"
 #include "parser/parser.h"
+#include "ports/port_prefilter.h"
 #include "target_based/sftarget_data.h"
 #include "target_based/snort_protocols.h"
 #include "target_based/sftarget_reader.h"
@@ -45,6 +48,12 @@ using namespace std;
 
 THREAD_LOCAL ProfileStats bindPerfStats;
 
+// one bit per PktType up to FILE
+#define BIND_PROTOS 7
+
+// bindings on more ports than this are checked for any port
+#define BIND_MAX_INDEX_PORTS 1024
+
 // FIXIT-P these lookups should be optimized when the dust settles
 #define INS_IP   "stream_ip"
 #define INS_ICMP "stream_icmp"
@@ -70,6 +79,7 @@ Binding::Binding()
     when.role = BindWhen::BR_EITHER;
 
     use.index = 0;
+    use.depth = 0;
     use.action = BindUse::BA_INSPECT;
 
     use.what = BindUse::BW_NONE;
@@ -132,8 +142,9 @@ bool Binding::check_iface(const Flow* flow) const
 
 bool Binding::check_vlan(const Flow* flow) const
 {
-    unsigned v = flow->key->vlan_tag;
-    return when.vlans.test(v);
+    FlowKey key;
+    flow->get_key(key);
+    return when.vlans.test(key.vlan_tag);
 }
 
 bool Binding::check_port(const Flow* flow) const
@@ -232,12 +243,15 @@ struct Stuff
     Inspector* gadget;
     Inspector* data;
 
+    unsigned depth;
+
     Stuff()
     {
         action = BindUse::BA_INSPECT;
         client = server = nullptr;
         wizard = gadget = nullptr;
         data = nullptr;
+        depth = 0;
     }
 
     bool update(Binding*);
@@ -249,6 +263,10 @@ struct Stuff
 
 bool Stuff::update(Binding* pb)
 {
+    // the first binding with a depth sets it
+    if ( !depth )
+        depth = pb->use.depth;
+
     if ( pb->use.action != BindUse::BA_INSPECT )
     {
         action = pb->use.action;
@@ -302,6 +320,7 @@ bool Stuff::apply_action(Flow* flow)
         break;
     }
     flow->set_state(Flow::INSPECT);
+    flow->set_inspection_depth(depth);
     return true;
 }
 
@@ -400,12 +419,24 @@ private:
     void apply(const Stuff&, Flow*);
 
     void set_binding(SnortConfig*, Binding*);
+    void index_bindings();
+    void get_prefilter(PortPrefilter&);
+    bool use_binding(Flow*, Stuff&, Binding*);
     void get_bindings(Flow*, Stuff&);
     void apply(Flow*, Stuff&);
-    Inspector* find_gadget(Flow*);
 
 private:
     vector<Binding*> bindings;
+
+    // candidate bindings for a flow as indices in bindings order.  flows
+    // with a service can only match bindings for that service; the rest
+    // are split by protocol and, if the port set is small, server port.
+    // check_all() is still applied to every candidate.
+    typedef vector<unsigned> BindList;
+
+    unordered_map<string, BindList> svc_bindings;
+    unordered_map<uint32_t, BindList> port_bindings;
+    BindList proto_bindings[BIND_PROTOS];
 };
 
 Binder::Binder(vector<Binding*>& v)
@@ -431,6 +462,7 @@ bool Binder::configure(SnortConfig* sc)
         if ( !pb->use.index )
             set_binding(sc, pb);
     }
+    index_bindings();
     return true;
 }
 
@@ -450,10 +482,23 @@ void Binder::eval(Packet* p)
     ++bstats.packets;
 }
 
-int Binder::exec(int, void* pv)
+int Binder::exec(int id, void* pv)
 {
+    if ( id == BINDER_EXEC_PREFILTER )
+    {
+        get_prefilter(*(PortPrefilter*)pv);
+        return 0;
+    }
+
     Flow* flow = (Flow*)pv;
-    Inspector* ins = find_gadget(flow);
+
+    Stuff stuff;
+    get_bindings(flow, stuff);
+    Inspector* ins = stuff.gadget;
+
+    // service bindings can change the depth set at flow start
+    if ( stuff.depth )
+        flow->set_inspection_depth(stuff.depth);
 
     if ( ins )
     {
@@ -489,6 +534,10 @@ void Binder::set_binding(SnortConfig*, Binding* pb)
     if ( pb->use.action != BindUse::BA_INSPECT )
         return;
 
+    // a binding may only set the depth
+    if ( pb->use.depth and pb->use.name.empty() and pb->use.svc.empty() )
+        return;
+
     const char* key;
     if ( pb->use.svc.empty() )
         key = pb->use.name.c_str();
@@ -513,46 +562,130 @@ void Binder::set_binding(SnortConfig*, Binding* pb)
         ParseError("can't bind %s", key);
 }
 
-// FIXIT-P this is a simple linear search until functionality is nailed
-// down.  performance should be the focus of the next iteration.
-void Binder::get_bindings(Flow* flow, Stuff& stuff)
+// blocking and inspecting bindings need their ports.  service bindings
+// are skipped since a service is only found on a flow that some other
+// binding (or the host table) already sent to an inspector.
+void Binder::get_prefilter(PortPrefilter& pf)
 {
-    Binding* pb;
-    unsigned i, sz = bindings.size();
+    for ( const auto* pb : bindings )
+    {
+        if ( !pb->when.svc.empty() )
+            continue;
 
-    for ( i = 0; i < sz; i++ )
+        if ( pb->use.action == BindUse::BA_ALLOW )
+            continue;
+
+        if ( pb->use.action == BindUse::BA_INSPECT and
+            (pb->use.what == BindUse::BW_NONE or pb->use.what == BindUse::BW_STREAM) )
+            continue;
+
+        pf.add_ports(pb->when.protos, pb->when.ports);
+    }
+}
+
+void Binder::index_bindings()
+{
+    for ( unsigned i = 0; i < bindings.size(); ++i )
     {
-        pb = bindings[i];
+        const BindWhen& when = bindings[i]->when;
 
-        if ( !pb->check_all(flow) )
+        if ( !when.svc.empty() )
+        {
+            svc_bindings[when.svc].push_back(i);
             continue;
+        }
 
-        if ( !pb->use.index )
+        bool by_port = when.ports.count() <= BIND_MAX_INDEX_PORTS;
+
+        for ( unsigned b = 0; b < BIND_PROTOS; ++b )
         {
-            if ( stuff.update(pb) )
-                return;
-            else
+            if ( !(when.protos & (1u << b)) )
+                continue;
+
+            if ( !by_port )
+            {
+                proto_bindings[b].push_back(i);
                 continue;
+            }
+
+            bits_for_each(when.ports, [&](size_t port)
+                { port_bindings[(b << 16) | port].push_back(i); });
         }
+    }
+}
 
-        set_policies(snort_conf, pb->use.index - 1);
-        flow->policy_id = pb->use.index - 1;
+// return true if the search is done
+bool Binder::use_binding(Flow* flow, Stuff& stuff, Binding* pb)
+{
+    if ( !pb->check_all(flow) )
+        return false;
 
-        Binder* sub = (Binder*)InspectorManager::get_binder();
+    if ( !pb->use.index )
+        return stuff.update(pb);
 
-        if ( sub )
-        {
-            sub->get_bindings(flow, stuff);
+    set_policies(snort_conf, pb->use.index - 1);
+    flow->policy_id = pb->use.index - 1;
+
+    Binder* sub = (Binder*)InspectorManager::get_binder();
+
+    if ( !sub )
+        return false;
+
+    sub->get_bindings(flow, stuff);
+    return true;
+}
+
+void Binder::get_bindings(Flow* flow, Stuff& stuff)
+{
+    if ( flow->service )
+    {
+        auto it = svc_bindings.find(flow->service);
+
+        if ( it == svc_bindings.end() )
             return;
+
+        for ( auto i : it->second )
+        {
+            if ( use_binding(flow, stuff, bindings[i]) )
+                return;
         }
+        return;
     }
-}
 
-Inspector* Binder::find_gadget(Flow* flow)
-{
-    Stuff stuff;
-    get_bindings(flow, stuff);
-    return stuff.gadget;
+    unsigned type = (unsigned)flow->pkt_type;
+    unsigned b = type ? __builtin_ctz(type) : BIND_PROTOS;
+
+    if ( b >= BIND_PROTOS or (type & (type - 1)) )
+    {
+        // not a single protocol so fall back to checking everything
+        for ( auto* pb : bindings )
+        {
+            if ( use_binding(flow, stuff, pb) )
+                return;
+        }
+        return;
+    }
+
+    static const BindList none;
+    const BindList& any = proto_bindings[b];
+    auto it = port_bindings.find((b << 16) | flow->server_port);
+    const BindList& port = (it == port_bindings.end()) ? none : it->second;
+
+    // merge the two lists to keep the configured order
+    unsigned i = 0, j = 0;
+
+    while ( i < any.size() or j < port.size() )
+    {
+        unsigned k;
+
+        if ( j == port.size() or (i < any.size() and any[i] < port[j]) )
+            k = any[i++];
+        else
+            k = port[j++];
+
+        if ( use_binding(flow, stuff, bindings[k]) )
+            return;
+    }
 }
 
 void Binder::apply(Flow* flow, Stuff& stuff)
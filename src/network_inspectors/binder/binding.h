@@ -56,6 +56,7 @@ struct BindUse
 
     Action action;
     unsigned index;
+    unsigned depth;
     What what;
     void* object;
 };
@@ -399,6 +399,15 @@ static inline void NopDaOpt(uint8_t* opt, uint8_t len)
 static inline int Norm_TCPOptions(NormalizerConfig* config, const NormMode mode,
     uint8_t* opts, size_t len, const tcp::TCPHdr* h, uint8_t validated_len, int changes)
 {
+    unsigned cond = 0;
+
+    if ( h->th_flags & TH_SYN )
+        cond |= NORM_TCP_OPT_SYN;
+
+    if ( h->th_flags & TH_ACK )
+        cond |= NORM_TCP_OPT_ACK;
+
+    const uint8_t* actions = config->tcp_opt_actions[cond];
     size_t i = 0;
 
     while ( (i < len) &&
@@ -413,28 +422,23 @@ static inline int Norm_TCPOptions(NormalizerConfig* config, const NormMode mode,
         if ( i + olen > len)
             break;
 
-        switch ( static_cast<tcp::TcpOptCode>(opts[i]) )
+        switch ( actions[opts[i]] )
         {
-        case tcp::TcpOptCode::NOP:
+        case NORM_TCP_OPT_KEEP:
             break;
 
-        case tcp::TcpOptCode::MAXSEG:
-        case tcp::TcpOptCode::WSCALE:
-            if ( !(h->th_flags & TH_SYN) )
+        case NORM_TCP_OPT_NOP_SYN:
+            if ( mode == NORM_MODE_ON )
             {
-                if ( mode == NORM_MODE_ON )
-                {
-                    NopDaOpt(opts+i, olen);
-                    changes++;
-                }
-                normStats[PC_TCP_SYN_OPT][mode]++;
+                NopDaOpt(opts+i, olen);
+                changes++;
             }
+            normStats[PC_TCP_SYN_OPT][mode]++;
             break;
 
-        case tcp::TcpOptCode::TIMESTAMP:
-            if ( !(h->th_flags & TH_ACK) &&
-                // use memcmp because opts have arbitrary alignment
-                memcmp(opts+i+TS_ECR_OFFSET, MAX_EOL_PAD, TS_ECR_LENGTH) )
+        case NORM_TCP_OPT_TS_ECR:
+            // use memcmp because opts have arbitrary alignment
+            if ( memcmp(opts+i+TS_ECR_OFFSET, MAX_EOL_PAD, TS_ECR_LENGTH) )
             {
                 if ( mode == NORM_MODE_ON )
                 {
@@ -446,16 +450,14 @@ static inline int Norm_TCPOptions(NormalizerConfig* config, const NormMode mode,
             }
             break;
 
-        default:
-            if ( !Norm_TcpIsOptional(config, opts[i]) )
+        case NORM_TCP_OPT_NOP:
+            if ( mode == NORM_MODE_ON )
             {
-                if ( mode == NORM_MODE_ON )
-                {
-                    NopDaOpt(opts+i, olen);
-                    changes++;
-                }
-                normStats[PC_TCP_OPT][mode]++;
+                NopDaOpt(opts+i, olen);
+                changes++;
             }
+            normStats[PC_TCP_OPT][mode]++;
+            break;
         }
         i += olen;
     }
@@ -622,6 +624,36 @@ NormPegs Norm_GetCounts(unsigned& c)
 
 //-----------------------------------------------------------------------
 
+// the action for one option kind under one set of conditions; EOL ends
+// the scan before any lookup
+static NormTcpOptAction Norm_TcpOptAction(
+    const NormalizerConfig* nc, unsigned cond, uint8_t kind)
+{
+    switch ( static_cast<tcp::TcpOptCode>(kind) )
+    {
+    case tcp::TcpOptCode::EOL:
+    case tcp::TcpOptCode::NOP:
+        return NORM_TCP_OPT_KEEP;
+
+    case tcp::TcpOptCode::MAXSEG:
+    case tcp::TcpOptCode::WSCALE:
+        return (cond & NORM_TCP_OPT_SYN) ? NORM_TCP_OPT_KEEP : NORM_TCP_OPT_NOP_SYN;
+
+    case tcp::TcpOptCode::TIMESTAMP:
+        return (cond & NORM_TCP_OPT_ACK) ? NORM_TCP_OPT_KEEP : NORM_TCP_OPT_TS_ECR;
+
+    default:
+        return Norm_TcpIsOptional(nc, kind) ? NORM_TCP_OPT_KEEP : NORM_TCP_OPT_NOP;
+    }
+}
+
+static void Norm_TcpCompileOptions(NormalizerConfig* nc)
+{
+    for ( unsigned cond = 0; cond < NORM_TCP_OPT_CONDS; ++cond )
+        for ( unsigned kind = 0; kind < 256; ++kind )
+            nc->tcp_opt_actions[cond][kind] = Norm_TcpOptAction(nc, cond, (uint8_t)kind);
+}
+
 int Norm_SetConfig(NormalizerConfig* nc)
 {
     if ( !nc->normalizer_flags )
@@ -649,6 +681,7 @@ int Norm_SetConfig(NormalizerConfig* nc)
     if ( Norm_IsEnabled(nc, (NormFlags)NORM_TCP_ANY) )
     {
         nc->normalizers[PacketManager::proto_idx(ProtocolId::TCP)] = Norm_TCP;
+        Norm_TcpCompileOptions(nc);
     }
     return 0;
 }
@@ -33,10 +33,26 @@ typedef int (* NormalFunc)( // FIXIT-L why is this exposed?
 
 extern const PegInfo norm_names[];
 
+// what Norm_TCP does with each tcp option; compiled per config by
+// Norm_SetConfig() from the flags and allowed options and indexed by
+// the segment's SYN and ACK bits (the conditions that matter) and kind
+enum NormTcpOptAction : uint8_t
+{
+    NORM_TCP_OPT_KEEP,
+    NORM_TCP_OPT_NOP_SYN,   // SYN only option on a non-SYN segment
+    NORM_TCP_OPT_NOP,       // not allowed
+    NORM_TCP_OPT_TS_ECR     // TSecr must be zero without ACK
+};
+
+#define NORM_TCP_OPT_SYN  0x1
+#define NORM_TCP_OPT_ACK  0x2
+#define NORM_TCP_OPT_CONDS 4
+
 struct NormalizerConfig
 {
     uint32_t normalizer_flags;
     uint8_t normalizer_options[32];
+    uint8_t tcp_opt_actions[NORM_TCP_OPT_CONDS][256];
 
     // these must be in the same order PROTO_IDs are defined!
     // if entry is NULL, proto doesn't have normalization or it is disabled
@@ -0,0 +1,454 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// capture_filter.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "capture_filter.h"
+
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+#define ETH_IP4  0x0800
+#define ETH_ARP  0x0806
+#define ETH_RARP 0x8035
+#define ETH_IP6  0x86dd
+
+// offsets into an ethernet frame, as the compiled bpf uses them
+#define OFF_ETHER    12
+#define OFF_IP4_HLEN 14
+#define OFF_IP4_FRAG 20
+#define OFF_IP4_PROTO 23
+#define OFF_IP4_SRC  26
+#define OFF_IP4_DST  30
+#define OFF_ARP_SPA  28
+#define OFF_ARP_TPA  38
+#define OFF_IP6_NEXT 20
+#define OFF_IP6_SRC  22
+#define OFF_IP6_DST  38
+#define OFF_IP6_PORTS 54
+
+//-------------------------------------------------------------------------
+// compile
+//-------------------------------------------------------------------------
+
+static bool get_port(const std::string& s, uint16_t& port)
+{
+    if ( s.empty() or s.size() > 5 or s.find_first_not_of("0123456789") != std::string::npos )
+        return false;
+
+    unsigned long n = strtoul(s.c_str(), nullptr, 10);
+
+    if ( n > 65535 )
+        return false;
+
+    port = (uint16_t)n;
+    return true;
+}
+
+static bool set_proto(const std::string& s, CaptureTerm& t)
+{
+    t.ether = 0;
+    t.proto = 0;
+
+    if ( s == "ip" )
+        t.ether = ETH_IP4;
+    else if ( s == "ip6" )
+        t.ether = ETH_IP6;
+    else if ( s == "arp" )
+        t.ether = ETH_ARP;
+    else if ( s == "icmp" )
+    { t.ether = ETH_IP4; t.proto = IPPROTO_ICMP; }
+    else if ( s == "icmp6" )
+    { t.ether = ETH_IP6; t.proto = IPPROTO_ICMPV6; }
+    else if ( s == "tcp" )
+        t.proto = IPPROTO_TCP;
+    else if ( s == "udp" )
+        t.proto = IPPROTO_UDP;
+    else if ( s == "sctp" )
+        t.proto = IPPROTO_SCTP;
+    else
+        return false;
+
+    return true;
+}
+
+// [ip | ip6] [src | dst] host <addr>
+// [tcp | udp | sctp] [src | dst] port <number>
+// ip | ip6 | arp | icmp | icmp6 | tcp | udp | sctp
+static bool get_term(const std::vector<std::string>& tok, unsigned& i, CaptureTerm& t)
+{
+    memset(&t, 0, sizeof(t));
+    t.dir = CaptureTerm::EITHER;
+
+    std::string qual;
+
+    if ( set_proto(tok[i], t) )
+    {
+        qual = tok[i++];
+
+        if ( i == tok.size() or tok[i] == "and" or tok[i] == "&&" )
+        {
+            t.type = CaptureTerm::PROTO;
+            return true;
+        }
+    }
+
+    if ( tok[i] == "src" or tok[i] == "dst" )
+    {
+        t.dir = tok[i++] == "src" ? CaptureTerm::SRC : CaptureTerm::DST;
+
+        if ( i == tok.size() )
+            return false;
+    }
+
+    if ( i + 1 >= tok.size() )
+        return false;
+
+    if ( tok[i] == "host" )
+    {
+        if ( !qual.empty() and qual != "ip" and qual != "ip6" )
+            return false;
+
+        const char* s = tok[i + 1].c_str();
+
+        if ( qual != "ip6" and inet_pton(AF_INET, s, t.addr) == 1 )
+        {
+            t.family = 4;
+            t.arp = qual.empty();
+        }
+        else if ( qual != "ip" and inet_pton(AF_INET6, s, t.addr) == 1 )
+            t.family = 6;
+
+        else
+            return false;
+
+        t.type = CaptureTerm::HOST;
+    }
+    else if ( tok[i] == "port" )
+    {
+        if ( !qual.empty() and qual != "tcp" and qual != "udp" and qual != "sctp" )
+            return false;
+
+        if ( !get_port(tok[i + 1], t.port) )
+            return false;
+
+        t.type = CaptureTerm::PORT;
+    }
+    else
+        return false;
+
+    i += 2;
+    return true;
+}
+
+bool CaptureFilter::compile(const char* s)
+{
+    clear();
+
+    std::vector<std::string> tok;
+    std::stringstream ss(s);
+    std::string w;
+
+    while ( ss >> w )
+        tok.push_back(w);
+
+    unsigned i = 0;
+
+    while ( i < tok.size() )
+    {
+        if ( num_terms == CAP_MAX_TERMS or !get_term(tok, i, terms[num_terms]) )
+        {
+            clear();
+            return false;
+        }
+        ++num_terms;
+
+        if ( i == tok.size() )
+            break;
+
+        if ( (tok[i] != "and" and tok[i] != "&&") or ++i == tok.size() )
+        {
+            clear();
+            return false;
+        }
+    }
+    set = true;
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// match
+//
+// a load past the end of the capture makes bpf reject the packet so each
+// term tests in the same order as the compiled code and stops there.
+//-------------------------------------------------------------------------
+
+namespace
+{
+struct Frame
+{
+    const uint8_t* pkt;
+    uint32_t len;
+    bool short_load;
+
+    bool has(uint32_t off, uint32_t n)
+    {
+        if ( off + n <= len )
+            return true;
+
+        short_load = true;
+        return false;
+    }
+
+    bool get8(uint32_t off, uint8_t& v)
+    {
+        if ( !has(off, 1) )
+            return false;
+
+        v = pkt[off];
+        return true;
+    }
+
+    bool get16(uint32_t off, uint16_t& v)
+    {
+        if ( !has(off, 2) )
+            return false;
+
+        v = (pkt[off] << 8) | pkt[off + 1];
+        return true;
+    }
+
+    bool same(uint32_t off, const uint8_t* a, uint32_t n)
+    { return has(off, n) and !memcmp(pkt + off, a, n); }
+};
+}
+
+static bool match_addr(Frame& f, const CaptureTerm& t, uint32_t src, uint32_t dst, uint32_t n)
+{
+    if ( (t.dir & CaptureTerm::SRC) and f.same(src, t.addr, n) )
+        return true;
+
+    if ( f.short_load )
+        return false;
+
+    return (t.dir & CaptureTerm::DST) and f.same(dst, t.addr, n);
+}
+
+static bool match_port(Frame& f, const CaptureTerm& t, uint32_t src)
+{
+    uint16_t port;
+
+    if ( (t.dir & CaptureTerm::SRC) and f.get16(src, port) and port == t.port )
+        return true;
+
+    if ( f.short_load )
+        return false;
+
+    return (t.dir & CaptureTerm::DST) and f.get16(src + 2, port) and port == t.port;
+}
+
+static inline bool port_proto(const CaptureTerm& t, uint8_t p)
+{
+    if ( t.proto )
+        return p == t.proto;
+
+    return p == IPPROTO_TCP or p == IPPROTO_UDP or p == IPPROTO_SCTP;
+}
+
+static bool match_term(Frame& f, const CaptureTerm& t)
+{
+    uint16_t ether;
+    uint8_t p;
+
+    if ( !f.get16(OFF_ETHER, ether) )
+        return false;
+
+    switch ( t.type )
+    {
+    case CaptureTerm::PROTO:
+        if ( t.ether )
+            return ether == t.ether and (!t.proto or
+                (f.get8(ether == ETH_IP4 ? OFF_IP4_PROTO : OFF_IP6_NEXT, p) and p == t.proto));
+
+        if ( ether == ETH_IP4 )
+            return f.get8(OFF_IP4_PROTO, p) and p == t.proto;
+
+        return ether == ETH_IP6 and f.get8(OFF_IP6_NEXT, p) and p == t.proto;
+
+    case CaptureTerm::HOST:
+        if ( t.family == 6 )
+            return ether == ETH_IP6 and match_addr(f, t, OFF_IP6_SRC, OFF_IP6_DST, 16);
+
+        if ( ether == ETH_IP4 )
+            return match_addr(f, t, OFF_IP4_SRC, OFF_IP4_DST, 4);
+
+        return t.arp and (ether == ETH_ARP or ether == ETH_RARP) and
+            match_addr(f, t, OFF_ARP_SPA, OFF_ARP_TPA, 4);
+
+    case CaptureTerm::PORT:
+        if ( ether == ETH_IP4 )
+        {
+            uint16_t frag;
+            uint8_t hlen;
+
+            // only the first fragment has ports
+            if ( !f.get8(OFF_IP4_PROTO, p) or !port_proto(t, p) or
+                !f.get16(OFF_IP4_FRAG, frag) or (frag & 0x1fff) or
+                !f.get8(OFF_IP4_HLEN, hlen) )
+                return false;
+
+            return match_port(f, t, OFF_IP4_HLEN + 4 * (hlen & 0xf));
+        }
+        return ether == ETH_IP6 and f.get8(OFF_IP6_NEXT, p) and port_proto(t, p) and
+            match_port(f, t, OFF_IP6_PORTS);
+    }
+    return false;
+}
+
+bool CaptureFilter::match(const uint8_t* pkt, uint32_t len) const
+{
+    Frame f = { pkt, len, false };
+
+    for ( unsigned i = 0; i < num_terms; ++i )
+        if ( !match_term(f, terms[i]) )
+            return false;
+
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+// ethernet + ip4 10.1.2.3 -> 10.4.5.6 + tcp 1234 -> 80
+static const uint8_t tcp4[] =
+    "\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x08\x00"
+    "\x45\x00\x00\x28\x00\x01\x40\x00\x40\x06\x00\x00\x0a\x01\x02\x03"
+    "\x0a\x04\x05\x06"
+    "\x04\xd2\x00\x50";
+
+// ethernet + ip6 ::1 -> ::2 + udp 53 -> 5353
+static const uint8_t udp6[] =
+    "\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x86\xdd"
+    "\x60\x00\x00\x00\x00\x08\x11\x40"
+    "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x01"
+    "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x02"
+    "\x00\x35\x14\xe9";
+
+// ethernet + arp request 10.1.2.3 -> 10.4.5.6
+static const uint8_t arp[] =
+    "\xff\xff\xff\xff\xff\xff\x06\x07\x08\x09\x0a\x0b\x08\x06"
+    "\x00\x01\x08\x00\x06\x04\x00\x01\x06\x07\x08\x09\x0a\x0b\x0a\x01"
+    "\x02\x03\x00\x00\x00\x00\x00\x00\x0a\x04\x05\x06";
+
+static bool check(const char* s, const uint8_t* pkt, uint32_t len)
+{
+    CaptureFilter f;
+    REQUIRE(f.compile(s));
+    return f.match(pkt, len);
+}
+
+TEST_CASE("capture filter shapes", "[PacketCapture]")
+{
+    CaptureFilter f;
+
+    CHECK(f.compile(""));
+    CHECK(f.num_terms == 0);
+    CHECK(f.compile("tcp"));
+    CHECK(f.compile("ip host 10.1.2.3"));
+    CHECK(f.compile("src host ::1 and udp dst port 53"));
+    CHECK(f.compile("tcp && port 80"));
+
+    CHECK(!f.compile("host"));
+    CHECK(!f.compile("host www.example.com"));
+    CHECK(!f.compile("port http"));
+    CHECK(!f.compile("ip6 host 10.1.2.3"));
+    CHECK(!f.compile("tcp host 10.1.2.3"));
+    CHECK(!f.compile("port 80 or port 443"));
+    CHECK(!f.compile("not tcp"));
+    CHECK(!f.compile("tcp and"));
+    CHECK(!f.compile("port 65536"));
+    CHECK(!f.set);
+}
+
+TEST_CASE("capture filter match", "[PacketCapture]")
+{
+    const uint32_t t4 = sizeof(tcp4) - 1;
+    const uint32_t u6 = sizeof(udp6) - 1;
+    const uint32_t a4 = sizeof(arp) - 1;
+
+    CHECK(check("", tcp4, t4));
+    CHECK(check("tcp", tcp4, t4));
+    CHECK(!check("udp", tcp4, t4));
+    CHECK(check("udp", udp6, u6));
+    CHECK(!check("ip", udp6, u6));
+    CHECK(check("ip6", udp6, u6));
+    CHECK(check("arp", arp, a4));
+
+    CHECK(check("host 10.4.5.6", tcp4, t4));
+    CHECK(check("src host 10.1.2.3", tcp4, t4));
+    CHECK(!check("dst host 10.1.2.3", tcp4, t4));
+    CHECK(check("host 10.1.2.3", arp, a4));
+    CHECK(!check("ip host 10.1.2.3", arp, a4));
+    CHECK(check("host ::2", udp6, u6));
+    CHECK(!check("src host ::2", udp6, u6));
+
+    CHECK(check("port 80", tcp4, t4));
+    CHECK(check("tcp src port 1234", tcp4, t4));
+    CHECK(!check("udp port 80", tcp4, t4));
+    CHECK(check("udp dst port 5353", udp6, u6));
+    CHECK(!check("port 80", arp, a4));
+
+    CHECK(check("ip and host 10.1.2.3 and tcp dst port 80", tcp4, t4));
+    CHECK(!check("ip and host 10.1.2.3 and tcp dst port 81", tcp4, t4));
+}
+
+TEST_CASE("capture filter bounds", "[PacketCapture]")
+{
+    // a matching source returns before the destination is loaded
+    CHECK(check("host 10.1.2.3", tcp4, 30));
+    CHECK(!check("host 10.4.5.6", tcp4, 33));
+    CHECK(check("host 10.4.5.6", tcp4, 34));
+    CHECK(!check("tcp", tcp4, 23));
+    CHECK(!check("port 80", tcp4, 37));
+    CHECK(check("", nullptr, 0));
+
+    // no more ports after the first fragment
+    uint8_t frag[sizeof(tcp4)];
+    memcpy(frag, tcp4, sizeof(frag));
+    frag[21] = 0x10;
+    CHECK(!check("port 80", frag, sizeof(frag) - 1));
+}
+
+#endif
+
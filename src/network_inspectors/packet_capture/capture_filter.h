@@ -0,0 +1,64 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// capture_filter.h
+
+#ifndef CAPTURE_FILTER_H
+#define CAPTURE_FILTER_H
+
+// matches the bpf filters most troubleshooting uses - host, port, and
+// protocol terms and'ed together - on ethernet frames without running the
+// bpf interpreter.  results are the same as the compiled bpf, including
+// rejecting packets too short for a load.
+
+#include <stdint.h>
+
+#define CAP_MAX_TERMS 8
+
+struct CaptureTerm
+{
+    enum Type : uint8_t { PROTO, HOST, PORT };
+    enum Dir : uint8_t { SRC = 1, DST = 2, EITHER = 3 };
+
+    Type type;
+    Dir dir;
+    uint8_t family;   // 4 or 6 for hosts
+    uint8_t proto;    // ip protocol; 0 for any of tcp, udp, sctp
+    uint16_t ether;   // ethertype for protocols; 0 for ip or ip6
+    uint16_t port;
+    bool arp;         // an unqualified ip4 host also matches arp and rarp
+    uint8_t addr[16];
+};
+
+// no constructors so it can be thread local
+struct CaptureFilter
+{
+    // false if the filter isn't one of the supported shapes
+    bool compile(const char*);
+    bool match(const uint8_t* pkt, uint32_t len) const;
+
+    void clear()
+    { num_terms = 0; set = false; }
+
+    CaptureTerm terms[CAP_MAX_TERMS];
+    unsigned num_terms;
+    bool set;
+};
+
+#endif
+
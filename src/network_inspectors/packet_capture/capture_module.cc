@@ -35,6 +35,7 @@ const PegInfo cap_names[] =
 {
     { "processed", "packets processed against filter" },
     { "captured", "packets matching dumped after matching filter" },
+    { "dropped", "matching packets dropped because the writer fell behind" },
     { nullptr, nullptr }
 };
 
@@ -46,6 +47,9 @@ static const Parameter s_capture[] =
     { "filter", Parameter::PT_STRING, nullptr, nullptr,
       "bpf filter to use for packet dump" },
 
+    { "snaplen", Parameter::PT_INT, "1:65535", "65535",
+      "most bytes of each packet to dump" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -73,7 +77,10 @@ static int disable(lua_State*)
 
 CaptureModule::CaptureModule() :
     Module(CAPTURE_NAME, CAPTURE_HELP, s_capture)
-{ config.enabled = false; }
+{
+    config.enabled = false;
+    config.snaplen = 65535;
+}
 
 bool CaptureModule::set(const char*, Value& v, SnortConfig*)
 {
@@ -83,6 +90,9 @@ bool CaptureModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("filter") )
         config.filter = v.get_string();
 
+    else if ( v.is("snaplen") )
+        config.snaplen = v.get_long();
+
     else
         return false;
 
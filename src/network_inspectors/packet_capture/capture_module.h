@@ -29,6 +29,7 @@
 struct CaptureConfig
 {
     bool enabled;
+    unsigned snaplen;
     std::string filter;
 };
 
@@ -36,6 +37,7 @@ struct CaptureStats
 {
     PegCount checked;
     PegCount matched;
+    PegCount dropped;
 };
 
 class CaptureModule : public Module
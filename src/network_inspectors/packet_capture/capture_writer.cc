@@ -0,0 +1,140 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// capture_writer.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "capture_writer.h"
+
+#include <string.h>
+
+// a buffer is handed off when it is this full or a second of packet time
+// has passed since its first packet; packets are dropped if the writer
+// still has the other buffer when this one is out of room
+#define CAP_BATCH_BYTES  (256 * 1024)
+#define CAP_BUFFER_BYTES (1024 * 1024)
+#define CAP_BATCH_SECS   1
+
+// records are a pcap header followed by the truncated packet
+static inline size_t record_size(uint32_t caplen)
+{ return (sizeof(pcap_pkthdr) + caplen + 7) & ~(size_t)7; }
+
+CaptureWriter::CaptureWriter(pcap_dumper_t* d)
+{
+    dumper = d;
+    fill.data = new uint8_t[CAP_BUFFER_BYTES];
+    fill.used = 0;
+    full.data = new uint8_t[CAP_BUFFER_BYTES];
+    full.used = 0;
+    thread = new std::thread(&CaptureWriter::run, this);
+}
+
+// whatever was buffered is written before returning
+CaptureWriter::~CaptureWriter()
+{
+    {
+        std::unique_lock<std::mutex> hold(lock);
+        cond.wait(hold, [this]() { return !pending; });
+
+        if ( fill.used )
+        {
+            std::swap(fill, full);
+            pending = true;
+        }
+        stop = true;
+    }
+    cond.notify_all();
+    thread->join();
+    delete thread;
+
+    delete[] fill.data;
+    delete[] full.data;
+}
+
+bool CaptureWriter::hand_off()
+{
+    {
+        std::lock_guard<std::mutex> hold(lock);
+
+        if ( pending )
+            return false;
+
+        std::swap(fill, full);
+        pending = true;
+    }
+    cond.notify_all();
+    return true;
+}
+
+bool CaptureWriter::write(const DAQ_PktHdr_t* pkth, const uint8_t* pkt, uint32_t snaplen)
+{
+    uint32_t caplen = pkth->caplen < snaplen ? pkth->caplen : snaplen;
+    size_t size = record_size(caplen);
+
+    if ( fill.used + size > CAP_BUFFER_BYTES and !hand_off() )
+        return false;
+
+    if ( !fill.used )
+        fill_start = pkth->ts.tv_sec;
+
+    pcap_pkthdr hdr;
+    hdr.ts = pkth->ts;
+    hdr.caplen = caplen;
+    hdr.len = pkth->pktlen;
+
+    memcpy(fill.data + fill.used, &hdr, sizeof(hdr));
+    memcpy(fill.data + fill.used + sizeof(hdr), pkt, caplen);
+    fill.used += size;
+
+    if ( fill.used >= CAP_BATCH_BYTES or pkth->ts.tv_sec - fill_start >= CAP_BATCH_SECS )
+        hand_off();
+
+    return true;
+}
+
+void CaptureWriter::run()
+{
+    std::unique_lock<std::mutex> hold(lock);
+
+    while ( true )
+    {
+        cond.wait(hold, [this]() { return stop or pending; });
+
+        if ( !pending )
+            break;
+
+        hold.unlock();
+
+        for ( size_t off = 0; off < full.used; )
+        {
+            pcap_pkthdr* hdr = (pcap_pkthdr*)(full.data + off);
+            pcap_dump((unsigned char*)dumper, hdr, full.data + off + sizeof(*hdr));
+            off += record_size(hdr->caplen);
+        }
+        pcap_dump_flush(dumper);
+        full.used = 0;
+
+        hold.lock();
+        pending = false;
+        cond.notify_all();
+    }
+}
+
@@ -0,0 +1,70 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// capture_writer.h
+
+#ifndef CAPTURE_WRITER_H
+#define CAPTURE_WRITER_H
+
+// packets are copied, truncated to the snap length, into a buffer owned
+// by the packet thread.  full buffers are swapped with a writer thread
+// that does the dumping so the packet thread never waits on the file.
+
+#include <daq.h>
+#include <pcap/pcap.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "main/snort_types.h"
+
+struct CaptureBuffer
+{
+    uint8_t* data;
+    size_t used;
+};
+
+class CaptureWriter
+{
+public:
+    CaptureWriter(pcap_dumper_t*);
+    ~CaptureWriter();
+
+    // false if the packet was dropped because the writer is behind
+    bool write(const DAQ_PktHdr_t*, const uint8_t*, uint32_t snaplen);
+
+private:
+    bool hand_off();
+    void run();
+
+    pcap_dumper_t* dumper;
+    CaptureBuffer fill;        // packet thread only
+    long fill_start = 0;       // packet time of first in fill
+
+    std::mutex lock;
+    std::condition_variable cond;
+    CaptureBuffer full;        // writer thread while pending
+    bool pending = false;
+    bool stop = false;
+
+    std::thread* thread;
+};
+
+#endif
+
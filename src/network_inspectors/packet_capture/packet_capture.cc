@@ -23,6 +23,8 @@
 #endif
 
 #include "packet_capture.h"
+#include "capture_filter.h"
+#include "capture_writer.h"
 
 #include <pcap/pcap.h>
 #include <sfbpf.h>
@@ -39,8 +41,6 @@
 #endif
 
 #define FILE_NAME "packet_capture.pcap"
-#define SNAP_LEN 65535
-
 using namespace std;
 
 static CaptureConfig config;
@@ -48,6 +48,8 @@ static CaptureConfig config;
 static THREAD_LOCAL pcap_t* pcap = nullptr;
 static THREAD_LOCAL pcap_dumper_t* dumper = nullptr;
 static THREAD_LOCAL struct sfbpf_program bpf;
+static THREAD_LOCAL CaptureFilter filter;
+static THREAD_LOCAL CaptureWriter* writer = nullptr;
 
 static inline bool capture_initialized()
 { return dumper != nullptr; }
@@ -99,8 +101,15 @@ void PacketCapture::eval(Packet* p)
             if ( !capture_init() )
                 return;
 
-        if ( !bpf.bf_insns || sfbpf_filter(bpf.bf_insns, p->pkt,
-                p->pkth->caplen, p->pkth->pktlen) )
+        bool match;
+
+        if ( filter.set )
+            match = filter.match(p->pkt, p->pkth->caplen);
+        else
+            match = !bpf.bf_insns || sfbpf_filter(bpf.bf_insns, p->pkt,
+                p->pkth->caplen, p->pkth->pktlen);
+
+        if ( match )
         {
             write_packet(p);
             cap_count_stats.matched++;
@@ -112,29 +121,44 @@ void PacketCapture::eval(Packet* p)
         capture_term();
 }
 
+// common filter shapes are matched directly instead of interpreted
+static bool filter_init()
+{
+    if ( filter.compile(config.filter.c_str()) )
+        return true;
+
+    if ( sfbpf_compile(config.snaplen, DLT_EN10MB, &bpf,
+        config.filter.c_str(), 1, 0) < 0 )
+    {
+        WarningMessage("Unable to compile BPF filter\n");
+        return false;
+    }
+
+    if ( !sfbpf_validate(bpf.bf_insns, bpf.bf_len) )
+    {
+        WarningMessage("Unable to validate BPF filter\n");
+        return false;
+    }
+    return true;
+}
+
 bool PacketCapture::capture_init()
 {
-    if ( sfbpf_compile(SNAP_LEN, DLT_EN10MB, &bpf,
-        config.filter.c_str(), 1, 0) >= 0 )
+    if ( filter_init() )
     {
-        if ( sfbpf_validate(bpf.bf_insns, bpf.bf_len) )
-        {
-            string fname;
-            get_instance_file(fname, FILE_NAME);
+        string fname;
+        get_instance_file(fname, FILE_NAME);
 
-            pcap = pcap_open_dead(DLT_EN10MB, SNAP_LEN);
-            dumper = open_dump(pcap, fname.c_str());
+        pcap = pcap_open_dead(DLT_EN10MB, config.snaplen);
+        dumper = open_dump(pcap, fname.c_str());
 
-            if ( dumper )
-                return true;
-            else
-                WarningMessage("Could not initialize dump file\n");
+        if ( dumper )
+        {
+            writer = new CaptureWriter(dumper);
+            return true;
         }
-        else
-            WarningMessage("Unable to validate BPF filter\n");
+        WarningMessage("Could not initialize dump file\n");
     }
-    else
-        WarningMessage("Unable to compile BPF filter\n");
 
     packet_capture_disable();
     capture_term();
@@ -146,6 +170,12 @@ pcap_dumper_t* PacketCapture::open_dump(pcap_t* pcap, const char* fname)
 
 void PacketCapture::capture_term()
 {
+    // drain the writer before closing its file
+    if ( writer )
+    {
+        delete writer;
+        writer = nullptr;
+    }
     if ( dumper )
     {
         pcap_dump_close(dumper);
@@ -157,13 +187,13 @@ void PacketCapture::capture_term()
         pcap = nullptr;
     }
     sfbpf_freecode(&bpf);
+    filter.clear();
 }
 
 void PacketCapture::write_packet(Packet* p)
 {
-    //DAQ_PktHdr_t is compatible with pcap_pkthdr
-    pcap_dump((unsigned char*)dumper, (pcap_pkthdr*)p->pkth, p->pkt);
-    pcap_dump_flush(dumper);
+    if ( !writer->write(p->pkth, p->pkt, config.snaplen) )
+        cap_count_stats.dropped++;
 }
 
 //-------------------------------------------------------------------------
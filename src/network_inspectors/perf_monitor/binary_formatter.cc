@@ -0,0 +1,218 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// binary_formatter.cc
+
+#include "binary_formatter.h"
+
+#include <cstring>
+
+#ifdef UNIT_TEST
+#include <cstdio>
+
+#include "catch/catch.hpp"
+#include "utils/util.h"
+#endif
+
+using namespace std;
+
+template <typename T>
+static inline void put(vector<uint8_t>& buf, T v)
+{
+    size_t n = buf.size();
+    buf.resize(n + sizeof(v));
+    memcpy(&buf[n], &v, sizeof(v));
+}
+
+static inline void put(vector<uint8_t>& buf, const void* p, size_t len)
+{
+    const uint8_t* b = (const uint8_t*)p;
+    buf.insert(buf.end(), b, b + len);
+}
+
+void BinaryFormatter::finalize_fields()
+{
+    uint32_t fields = 0;
+
+    for( auto& section : types )
+        fields += section.size();
+
+    put(schema, PERF_BIN_MAGIC, 8);
+    put(schema, (uint32_t)PERF_BIN_VERSION);
+    put(schema, fields);
+
+    for( unsigned i = 0; i < section_names.size(); i++ )
+    {
+        for( unsigned j = 0; j < field_names[i].size(); j++ )
+        {
+            string name = section_names[i] + "." + field_names[i][j];
+
+            put(schema, (uint8_t)types[i][j]);
+            put(schema, (uint16_t)name.size());
+            put(schema, name.c_str(), name.size());
+        }
+    }
+    section_names.clear();
+    field_names.clear();
+}
+
+void BinaryFormatter::init_output(FILE* fh)
+{
+    fwrite(schema.data(), schema.size(), 1, fh);
+    fflush(fh);
+}
+
+void BinaryFormatter::write(FILE* fh, time_t timestamp)
+{
+    record.clear();
+    put(record, (uint32_t)0);
+    put(record, (uint64_t)timestamp);
+
+    for( unsigned i = 0; i < values.size(); i++ )
+        for( unsigned j = 0; j < values[i].size(); j++ )
+            if( types[i][j] == FT_PEG_COUNT )
+                put(record, (uint64_t)*values[i][j].pc);
+
+    for( unsigned i = 0; i < values.size(); i++ )
+    {
+        for( unsigned j = 0; j < values[i].size(); j++ )
+        {
+            switch( types[i][j] )
+            {
+                case FT_PEG_COUNT:
+                    break;
+
+                case FT_STRING:
+                {
+                    const char* s = values[i][j].s ? values[i][j].s : "";
+                    uint16_t len = strnlen(s, UINT16_MAX);
+                    put(record, len);
+                    put(record, s, len);
+                    break;
+                }
+
+                case FT_IDX_PEG_COUNT:
+                {
+                    auto& ipc = *values[i][j].ipc;
+                    size_t count_at = record.size();
+                    uint32_t count = 0;
+
+                    put(record, count);
+
+                    for( unsigned k = 0; k < ipc.size(); k++ )
+                    {
+                        if( ipc[k] )
+                        {
+                            put(record, (uint32_t)k);
+                            put(record, (uint64_t)ipc[k]);
+                            count++;
+                        }
+                    }
+                    memcpy(&record[count_at], &count, sizeof(count));
+                    break;
+                }
+            }
+        }
+    }
+
+    uint32_t len = record.size() - sizeof(len);
+    memcpy(&record[0], &len, sizeof(len));
+
+    fwrite(record.data(), record.size(), 1, fh);
+    fflush(fh);
+}
+
+#ifdef UNIT_TEST
+
+template <typename T>
+static T get(const uint8_t*& p)
+{
+    T v;
+    memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return v;
+}
+
+TEST_CASE("binary output", "[BinaryFormatter]")
+{
+    PegCount one = 0, two = 1;
+    char five[32] = "hello";
+    std::vector<PegCount> kvp;
+
+    FILE* fh = tmpfile();
+    BinaryFormatter f;
+
+    f.register_section("name");
+    f.register_field("one", &one);
+    f.register_field("five", five);
+    f.register_section("other");
+    f.register_field("two", &two);
+    f.register_field("kvp", &kvp);
+    f.finalize_fields();
+    f.init_output(fh);
+
+    kvp.push_back(0);
+    kvp.push_back(60);
+
+    f.write(fh, (time_t)1234567890);
+
+    auto size = ftell(fh);
+    uint8_t* fake_file = (uint8_t*)snort_alloc(size);
+
+    rewind(fh);
+    CHECK(fread(fake_file, size, 1, fh) == 1);
+
+    const uint8_t* p = fake_file;
+
+    CHECK(!memcmp(p, PERF_BIN_MAGIC, 8));
+    p += 8;
+    CHECK(get<uint32_t>(p) == PERF_BIN_VERSION);
+    CHECK(get<uint32_t>(p) == 4);
+
+    const char* names[] = { "name.one", "name.five", "other.two", "other.kvp" };
+    const uint8_t ftypes[] = { FT_PEG_COUNT, FT_STRING, FT_PEG_COUNT, FT_IDX_PEG_COUNT };
+
+    for( unsigned i = 0; i < 4; i++ )
+    {
+        CHECK(get<uint8_t>(p) == ftypes[i]);
+        uint16_t len = get<uint16_t>(p);
+        CHECK(len == strlen(names[i]));
+        CHECK(!memcmp(p, names[i], len));
+        p += len;
+    }
+
+    const uint8_t* rec = p;
+    uint32_t len = get<uint32_t>(p);
+    CHECK(len == size - (rec - fake_file) - sizeof(len));
+    CHECK(get<uint64_t>(p) == 1234567890);
+    CHECK(get<uint64_t>(p) == 0);
+    CHECK(get<uint64_t>(p) == 1);
+    CHECK(get<uint16_t>(p) == 5);
+    CHECK(!memcmp(p, "hello", 5));
+    p += 5;
+    CHECK(get<uint32_t>(p) == 1);
+    CHECK(get<uint32_t>(p) == 1);
+    CHECK(get<uint64_t>(p) == 60);
+    CHECK(p == fake_file + size);
+
+    snort_free(fake_file);
+    fclose(fh);
+}
+
+#endif
+
@@ -0,0 +1,59 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// binary_formatter.h
+
+#ifndef BINARY_FORMATTER_H
+#define BINARY_FORMATTER_H
+
+// BinaryFormatter writes a schema once per file followed by one record per
+// write.  All values are in host byte order.
+//
+// schema:  "SNPERFBN" magic, uint32 version, uint32 field count, then for
+//          each field a uint8 FormatterType, uint16 name length, and the
+//          name as section.field
+//
+// record:  uint32 length of the rest of the record, uint64 timestamp,
+//          a uint64 for each peg count field in schema order, then for
+//          each string field a uint16 length and the bytes, and for each
+//          indexed field a uint32 count and count (uint32 index, uint64
+//          value) pairs for the nonzero entries
+//
+// The peg counts are at fixed offsets so readers can pull a column without
+// parsing the variable part.  tools/perf_decode converts files to CSV.
+
+#include "perf_formatter.h"
+
+#define PERF_BIN_MAGIC "SNPERFBN"
+#define PERF_BIN_VERSION 1
+
+class BinaryFormatter : public PerfFormatter
+{
+public:
+    BinaryFormatter() : PerfFormatter() {}
+    void finalize_fields() override;
+    void init_output(FILE*) override;
+    void write(FILE*, time_t) override;
+
+private:
+    std::vector<uint8_t> schema;
+    std::vector<uint8_t> record;
+};
+
+#endif
+
@@ -21,11 +21,19 @@
 #include "flow_ip_tracker.h"
 #include "perf_module.h"
 
+#include <algorithm>
+#include <vector>
+
+#include "hash/sfhashfcn.h"
 #include "sfip/sf_ip.h"
 #include "utils/util.h"
 
 #define FLIP_FILE (PERF_NAME "_flow_ip.csv")
 
+// count-min sketch dimensions; cols must be a power of 2
+#define FLIP_SKETCH_ROWS 4
+#define FLIP_SKETCH_COLS 1024
+
 struct FlowStateKey
 {
     sfip_t ipA;
@@ -34,8 +42,92 @@ struct FlowStateKey
 
 THREAD_LOCAL FlowIPTracker* perf_flow_ip;
 
+static uint64_t flip_hash(const void* key)
+{
+    const uint32_t* w = (const uint32_t*)key;
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+
+    for ( unsigned i = 0; i < sizeof(FlowStateKey) / sizeof(*w); ++i )
+    {
+        h = (h ^ w[i]) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+    }
+    return h;
+}
+
+// conservative update: only the counters at the current minimum are
+// raised which keeps the overestimate from colliding pairs down
+uint64_t FlowIPTracker::sketch_add(const void* key, uint64_t weight)
+{
+    uint64_t h = flip_hash(key);
+    uint32_t h1 = (uint32_t)h;
+    uint32_t h2 = (uint32_t)(h >> 32) | 1;
+
+    uint64_t* cell[FLIP_SKETCH_ROWS];
+    uint64_t est = UINT64_MAX;
+
+    for ( unsigned i = 0; i < FLIP_SKETCH_ROWS; ++i )
+    {
+        unsigned col = (h1 + i * h2) & (FLIP_SKETCH_COLS - 1);
+        cell[i] = sketch + i * FLIP_SKETCH_COLS + col;
+
+        if ( *cell[i] < est )
+            est = *cell[i];
+    }
+    est += weight;
+
+    for ( unsigned i = 0; i < FLIP_SKETCH_ROWS; ++i )
+    {
+        if ( *cell[i] < est )
+            *cell[i] = est;
+    }
+    return est;
+}
+
+// a pair that isn't in the table gets in once its estimate beats the
+// lightest tracked pair, which is evicted.  the stats of an admitted
+// pair only count from the time it was admitted.
+FlowStateValue* FlowIPTracker::admit(const void* key, uint64_t est)
+{
+    if ( sfxhash_count(ipMap) >= config->flowip_top )
+    {
+        if ( est <= top_min )
+            return nullptr;
+
+        SFXHASH_NODE* lightest = nullptr;
+        uint64_t min = UINT64_MAX;
+
+        for ( auto node = sfxhash_ghead(ipMap); node; node = sfxhash_gnext(node) )
+        {
+            FlowStateValue* v = (FlowStateValue*)node->data;
+
+            if ( v->weight < min )
+            {
+                min = v->weight;
+                lightest = node;
+            }
+        }
+        top_min = min;
+
+        if ( !lightest or est <= min )
+            return nullptr;
+
+        sfxhash_free_node(ipMap, lightest);
+    }
+
+    SFXHASH_NODE* node = sfxhash_get_node(ipMap, key);
+
+    if ( !node )
+        return nullptr;
+
+    FlowStateValue* value = (FlowStateValue*)node->data;
+    memset(value, 0, sizeof(*value));
+    value->weight = est;
+    return value;
+}
+
 FlowStateValue* FlowIPTracker::find_stats(const sfip_t* src_addr, const sfip_t* dst_addr,
-    int* swapped)
+    int* swapped, uint64_t weight)
 {
     SFXHASH_NODE* node;
     FlowStateKey key;
@@ -55,6 +147,19 @@ FlowStateValue* FlowIPTracker::find_stats(const sfip_t* src_addr, const sfip_t*
     }
 
     value = (FlowStateValue*)sfxhash_find(ipMap, &key);
+
+    if ( config->flowip_top )
+    {
+        uint64_t est = sketch_add(&key, weight);
+
+        if ( value )
+            value->weight = est;
+        else
+            value = admit(&key, est);
+
+        return value;
+    }
+
     if (!value)
     {
         node = sfxhash_get_node(ipMap, &key);
@@ -108,6 +213,10 @@ FlowIPTracker::FlowIPTracker(PerfConfig* perf) : PerfTracker(perf,
         &stats.state_changes[SFS_STATE_TCP_CLOSED]);
     formatter->register_field("udp_created", (PegCount*)
         &stats.state_changes[SFS_STATE_UDP_CREATED]);
+
+    if ( config->flowip_top )
+        formatter->register_field("weight", &stats.weight);
+
     formatter->finalize_fields();
 }
 
@@ -118,6 +227,8 @@ FlowIPTracker::~FlowIPTracker()
         sfxhash_delete(ipMap);
         ipMap = nullptr;
     }
+    if ( sketch )
+        snort_free(sketch);
 }
 
 void FlowIPTracker::reset()
@@ -126,17 +237,31 @@ void FlowIPTracker::reset()
 
     if (first)
     {
+        // in top mode eviction is done here by weight instead of by age
         ipMap = sfxhash_new(1021, sizeof(FlowStateKey), sizeof(FlowStateValue),
-            perfmon_config->flowip_memcap, 1, nullptr, nullptr, 1);
+            perfmon_config->flowip_memcap, !config->flowip_top, nullptr, nullptr, 1);
 
         if (!ipMap)
             // FIXIT-M FlowIp allocations should all occur at thread init
             FatalError("Unable to allocate memory for FlowIP stats\n");
 
+        sfxhash_set_hash_type(ipMap, SFHASH_SIP);
+        sfxhash_set_stats(ipMap, "perf_monitor_flow_ip");
+
+        if ( config->flowip_top )
+            sketch = (uint64_t*)snort_calloc(
+                FLIP_SKETCH_ROWS * FLIP_SKETCH_COLS, sizeof(*sketch));
+
         first = false;
     }
     else
+    {
         sfxhash_make_empty(ipMap);
+
+        if ( sketch )
+            memset(sketch, 0, FLIP_SKETCH_ROWS * FLIP_SKETCH_COLS * sizeof(*sketch));
+    }
+    top_min = 0;
 }
 
 void FlowIPTracker::update(Packet* p)
@@ -155,7 +280,14 @@ void FlowIPTracker::update(Packet* p)
         else if (p->ptrs.udph)
             type = SFS_TYPE_UDP;
 
-        FlowStateValue* value = find_stats(src_addr, dst_addr, &swapped);
+        uint64_t weight = 0;
+
+        if ( config->flowip_rank == FLOWIP_RANK_BYTES )
+            weight = len;
+        else if ( config->flowip_rank == FLOWIP_RANK_PACKETS )
+            weight = 1;
+
+        FlowStateValue* value = find_stats(src_addr, dst_addr, &swapped, weight);
         if (!value)
             return;
 
@@ -178,7 +310,17 @@ void FlowIPTracker::update(Packet* p)
 
 void FlowIPTracker::process(bool)
 {
+    std::vector<SFXHASH_NODE*> nodes;
+
     for (auto node = sfxhash_findfirst(ipMap); node; node = sfxhash_findnext(ipMap))
+        nodes.push_back(node);
+
+    // heaviest first
+    if ( config->flowip_top )
+        std::sort(nodes.begin(), nodes.end(), [](SFXHASH_NODE* a, SFXHASH_NODE* b)
+            { return ((FlowStateValue*)a->data)->weight > ((FlowStateValue*)b->data)->weight; });
+
+    for ( auto node : nodes )
     {
         FlowStateKey* key = (FlowStateKey*)node->key;
         FlowStateValue* cur_stats = (FlowStateValue*)node->data;
@@ -197,8 +339,13 @@ void FlowIPTracker::process(bool)
 int FlowIPTracker::update_state(const sfip_t* src_addr, const sfip_t* dst_addr, FlowState state)
 {
     int swapped;
+    uint64_t weight = 0;
+
+    if ( config->flowip_rank == FLOWIP_RANK_SESSIONS and
+        (state == SFS_STATE_TCP_ESTABLISHED or state == SFS_STATE_UDP_CREATED) )
+        weight = 1;
 
-    FlowStateValue* value = find_stats(src_addr, dst_addr, &swapped);
+    FlowStateValue* value = find_stats(src_addr, dst_addr, &swapped, weight);
     if (!value)
         return 1;
 
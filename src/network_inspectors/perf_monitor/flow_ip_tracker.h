@@ -54,6 +54,7 @@ struct FlowStateValue
     uint64_t total_packets;
     uint64_t total_bytes;
     uint32_t state_changes[SFS_STATE_MAX];
+    uint64_t weight;    // rank estimate when flow_ip_top is set
 };
 
 class FlowIPTracker : public PerfTracker
@@ -73,7 +74,15 @@ private:
     SFXHASH* ipMap;
     char ip_a[41], ip_b[41];
 
-    FlowStateValue* find_stats(const sfip_t* src_addr, const sfip_t* dst_addr, int* swapped);
+    // with flow_ip_top, ipMap holds only the heaviest pairs and a
+    // count-min sketch estimates the weight of everything else
+    uint64_t* sketch = nullptr;
+    uint64_t top_min = 0;   // lower bound on the lightest pair in ipMap
+
+    FlowStateValue* find_stats(const sfip_t* src_addr, const sfip_t* dst_addr, int* swapped,
+        uint64_t weight);
+    FlowStateValue* admit(const void* key, uint64_t estimate);
+    uint64_t sketch_add(const void* key, uint64_t weight);
     void write_stats();
     void display_stats();
 };
@@ -0,0 +1,241 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// hash_tracker.cc
+
+#include "hash_tracker.h"
+#include "perf_module.h"
+
+#include <string.h>
+
+#include <string>
+
+#include "main/thread.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+#define HASH_FILE (PERF_NAME "_hash.csv")
+
+// the names given to tables in this tree; the last is the catch all
+static const char* table_names[] =
+{
+    "flow_cache",
+    "flow_cache_ip",
+    "flow_cache_icmp",
+    "flow_cache_tcp",
+    "flow_cache_udp",
+    "flow_cache_user",
+    "flow_cache_file",
+    "expect_cache",
+    "rate_filter",
+    "threshold_local",
+    "threshold_global",
+    "file_enforcer",
+    "perf_monitor_flow_ip",
+    "appid_service_state4",
+    "appid_service_state6",
+    "appid_host_port",
+    "appid_learned_app",
+    "appid_length",
+    "other"
+};
+
+static const unsigned num_names = sizeof(table_names) / sizeof(table_names[0]);
+
+static unsigned get_index(const std::string& name)
+{
+    for ( unsigned i = 0; i < num_names - 1; ++i )
+        if ( name == table_names[i] )
+            return i;
+
+    return num_names - 1;
+}
+
+HashTracker::HashTracker(PerfConfig* perf) : PerfTracker(perf,
+    perf->output == PERF_FILE ? HASH_FILE : nullptr)
+{
+    sections.resize(num_names);
+
+    for ( unsigned i = 0; i < num_names; ++i )
+    {
+        Section& s = sections[i];
+
+        formatter->register_section(std::string("hash_") + table_names[i]);
+        formatter->register_field("tables", &s.tables);
+        formatter->register_field("rows", &s.rows);
+        formatter->register_field("nodes", &s.nodes);
+        formatter->register_field("peak_nodes", &s.peak_nodes);
+        formatter->register_field("load_pct", &s.load_pct);
+        formatter->register_field("occupancy_pct", &s.occupancy_pct);
+        formatter->register_field("hits", &s.hits);
+        formatter->register_field("misses", &s.misses);
+        formatter->register_field("inserts", &s.inserts);
+        formatter->register_field("removes", &s.removes);
+        formatter->register_field("evictions", &s.evictions);
+
+        for ( unsigned j = 0; j < HASH_PROBE_BINS; ++j )
+            formatter->register_field(
+                std::string("probes_") + hash_probe_bin_name(j), &s.probes[j]);
+    }
+    formatter->finalize_fields();
+}
+
+void HashTracker::reset()
+{
+    std::vector<HashSummary> sums;
+    hash_stats_summarize(sums, true);
+
+    for ( auto& s : sections )
+        s.clear();
+
+    for ( const auto& sum : sums )
+    {
+        Section& s = sections[get_index(sum.name)];
+        s.last.hits += sum.hits;
+        s.last.misses += sum.misses;
+        s.last.inserts += sum.inserts;
+        s.last.removes += sum.removes;
+        s.last.evictions += sum.evictions;
+
+        for ( unsigned j = 0; j < HASH_PROBE_BINS; ++j )
+            s.last.probes[j] += sum.probes[j];
+    }
+}
+
+void HashTracker::Section::clear()
+{
+    tables = rows = nodes = peak_nodes = load_pct = occupancy_pct = 0;
+    hits = misses = inserts = removes = evictions = 0;
+    memset(probes, 0, sizeof(probes));
+    last = HashSummary();
+}
+
+// cur is the total of all the summaries for this section
+void HashTracker::update(Section& s, const HashSummary& cur)
+{
+    s.tables = cur.tables;
+    s.rows = cur.rows;
+    s.nodes = cur.nodes;
+    s.peak_nodes = cur.peak_nodes;
+    s.load_pct = cur.rows ? cur.nodes * 100 / cur.rows : 0;
+    s.occupancy_pct = cur.rows ? cur.used_rows * 100 / cur.rows : 0;
+
+    s.hits = cur.hits - s.last.hits;
+    s.misses = cur.misses - s.last.misses;
+    s.inserts = cur.inserts - s.last.inserts;
+    s.removes = cur.removes - s.last.removes;
+    s.evictions = cur.evictions - s.last.evictions;
+
+    for ( unsigned j = 0; j < HASH_PROBE_BINS; ++j )
+        s.probes[j] = cur.probes[j] - s.last.probes[j];
+
+    s.last = cur;
+}
+
+void HashTracker::process(bool)
+{
+    std::vector<HashSummary> sums;
+    hash_stats_summarize(sums, true);
+
+    std::vector<HashSummary> totals(num_names);
+
+    for ( const auto& sum : sums )
+    {
+        HashSummary& t = totals[get_index(sum.name)];
+
+        t.tables += sum.tables;
+        t.hits += sum.hits;
+        t.misses += sum.misses;
+        t.inserts += sum.inserts;
+        t.removes += sum.removes;
+        t.evictions += sum.evictions;
+
+        for ( unsigned j = 0; j < HASH_PROBE_BINS; ++j )
+            t.probes[j] += sum.probes[j];
+
+        t.rows += sum.rows;
+        t.nodes += sum.nodes;
+        t.peak_nodes += sum.peak_nodes;
+        t.used_rows += sum.used_rows;
+    }
+
+    for ( unsigned i = 0; i < num_names; ++i )
+        update(sections[i], totals[i]);
+
+    write();
+}
+
+#ifdef UNIT_TEST
+
+class MockHashTracker : public HashTracker
+{
+public:
+    PerfFormatter* output;
+
+    MockHashTracker(PerfConfig* config) : HashTracker(config)
+    { output = formatter; }
+};
+
+TEST_CASE("hash table health", "[HashTracker]")
+{
+    PerfConfig config;
+    config.format = PERF_MOCK;
+
+    MockHashTracker tracker(&config);
+    MockFormatter* formatter = (MockFormatter*)tracker.output;
+
+    // the tracker only reports tables of its own packet thread
+    set_thread_type(STHREAD_TYPE_PACKET);
+    hash_stats_enable(true);
+    HashStats* hs = hash_stats_attach("expect_cache", 10);
+
+    tracker.reset();
+
+    hash_stats_lookup(hs, 0, false);
+    hash_stats_insert(hs, true, 1);
+    hash_stats_lookup(hs, 1, true);
+    hash_stats_insert(hs, false, 2);
+
+    tracker.process(false);
+
+    CHECK(*formatter->public_values["hash_expect_cache.tables"].pc == 1);
+    CHECK(*formatter->public_values["hash_expect_cache.rows"].pc == 10);
+    CHECK(*formatter->public_values["hash_expect_cache.nodes"].pc == 2);
+    CHECK(*formatter->public_values["hash_expect_cache.load_pct"].pc == 20);
+    CHECK(*formatter->public_values["hash_expect_cache.occupancy_pct"].pc == 10);
+    CHECK(*formatter->public_values["hash_expect_cache.hits"].pc == 1);
+    CHECK(*formatter->public_values["hash_expect_cache.misses"].pc == 1);
+    CHECK(*formatter->public_values["hash_expect_cache.probes_0"].pc == 1);
+    CHECK(*formatter->public_values["hash_expect_cache.probes_1"].pc == 1);
+    CHECK(*formatter->public_values["hash_other.tables"].pc == 0);
+
+    // counts are per interval
+    hash_stats_lookup(hs, 1, true);
+    tracker.process(false);
+
+    CHECK(*formatter->public_values["hash_expect_cache.hits"].pc == 1);
+    CHECK(*formatter->public_values["hash_expect_cache.misses"].pc == 0);
+    CHECK(*formatter->public_values["hash_expect_cache.nodes"].pc == 2);
+
+    hash_stats_detach(hs);
+    hash_stats_enable(false);
+    set_thread_type(STHREAD_TYPE_MAIN);
+}
+
+#endif
@@ -0,0 +1,69 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// hash_tracker.h
+
+#ifndef HASH_TRACKER_H
+#define HASH_TRACKER_H
+
+// HashTracker reports the health of the named SFXHASH and ZHash tables
+// owned by this packet thread each interval: size, load, row occupancy,
+// lookup hits and misses, inserts, removes, evictions and the probe length
+// histogram.  Counts are for the interval; the sizes are as of the report.
+// Sections are fixed when the tracker is built so tables with names not
+// in the list are reported together as hash_other.
+
+#include <vector>
+
+#include "hash/hash_stats.h"
+#include "perf_tracker.h"
+
+class HashTracker : public PerfTracker
+{
+public:
+    HashTracker(PerfConfig*);
+
+    void reset() override;
+    void process(bool) override;
+
+protected:
+    struct Section
+    {
+        PegCount tables;
+        PegCount rows;
+        PegCount nodes;
+        PegCount peak_nodes;
+        PegCount load_pct;
+        PegCount occupancy_pct;
+        PegCount hits;
+        PegCount misses;
+        PegCount inserts;
+        PegCount removes;
+        PegCount evictions;
+        PegCount probes[HASH_PROBE_BINS];
+
+        HashSummary last;
+
+        void clear();
+    };
+
+    void update(Section&, const HashSummary&);
+
+    std::vector<Section> sections;
+};
+
+#endif
@@ -0,0 +1,206 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// latency_tracker.cc
+
+#include "latency_tracker.h"
+#include "perf_module.h"
+
+#include <chrono>
+
+#include "flow/flow.h"
+#include "latency/packet_latency.h"
+#include "main/policy.h"
+#include "main/snort_config.h"
+#include "protocols/packet.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+#define LATENCY_FILE (PERF_NAME "_latency.csv")
+
+static const char* proto_names[] = { "tcp", "udp", "icmp", "other" };
+
+static void observe(const Packet* p, hr_duration d, void* user)
+{ ((LatencyTracker*)user)->record(p, d); }
+
+static PegCount to_nsecs(hr_duration d)
+{ return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count(); }
+
+void LatencyTracker::Section::add_fields(PerfFormatter* f, const std::string& name)
+{
+    f->register_section(name);
+    f->register_field("packets", &packets);
+    f->register_field("p50_ns", &p50);
+    f->register_field("p90_ns", &p90);
+    f->register_field("p99_ns", &p99);
+    f->register_field("p99_9_ns", &p99_9);
+    f->register_field("max_ns", &max);
+}
+
+void LatencyTracker::Section::summarize()
+{
+    packets = hist.count();
+    p50 = to_nsecs(hist.percentile(50.0));
+    p90 = to_nsecs(hist.percentile(90.0));
+    p99 = to_nsecs(hist.percentile(99.0));
+    p99_9 = to_nsecs(hist.percentile(99.9));
+    max = to_nsecs(hist.max());
+}
+
+void LatencyTracker::Section::clear()
+{
+    hist.reset();
+    packets = p50 = p90 = p99 = p99_9 = max = 0;
+}
+
+LatencyTracker::LatencyTracker(PerfConfig* perf) : PerfTracker(perf,
+    perf->output == PERF_FILE ? LATENCY_FILE : nullptr)
+{
+    unsigned num_policies = 1;
+
+    if ( snort_conf and snort_conf->policy_map->shells.size() > 1 )
+        num_policies = snort_conf->policy_map->shells.size();
+
+    policies.resize(num_policies);
+    buckets.resize(LatencyHistogram::BUCKETS);
+
+    all.add_fields(formatter, "latency");
+    formatter->register_field("buckets", &buckets);
+
+    for ( unsigned i = 0; i < LT_MAX; ++i )
+        protos[i].add_fields(formatter, std::string("latency_") + proto_names[i]);
+
+    for ( unsigned i = 0; i < num_policies; ++i )
+        policies[i].add_fields(formatter, "latency_policy_" + std::to_string(i));
+
+    formatter->finalize_fields();
+
+    PacketLatency::add_observer(observe, this);
+}
+
+LatencyTracker::~LatencyTracker()
+{
+    PacketLatency::remove_observer(observe, this);
+}
+
+void LatencyTracker::record(const Packet* p, hr_duration d)
+{
+    all.hist.add(d);
+
+    Proto proto = LT_OTHER;
+
+    if ( p->ptrs.tcph )
+        proto = LT_TCP;
+
+    else if ( p->ptrs.udph )
+        proto = LT_UDP;
+
+    else if ( p->ptrs.icmph )
+        proto = LT_ICMP;
+
+    protos[proto].hist.add(d);
+
+    unsigned policy = p->flow ? p->flow->policy_id : 0;
+
+    if ( policy < policies.size() )
+        policies[policy].hist.add(d);
+}
+
+void LatencyTracker::reset()
+{
+    all.clear();
+
+    for ( auto& s : protos )
+        s.clear();
+
+    for ( auto& s : policies )
+        s.clear();
+
+    for ( auto& b : buckets )
+        b = 0;
+}
+
+void LatencyTracker::process(bool)
+{
+    all.summarize();
+
+    for ( unsigned i = 0; i < LatencyHistogram::BUCKETS; ++i )
+        buckets[i] = all.hist.bucket(i);
+
+    for ( auto& s : protos )
+        s.summarize();
+
+    for ( auto& s : policies )
+        s.summarize();
+
+    write();
+
+    // the last values stay in place for the formatter until the next one
+    all.hist.reset();
+
+    for ( auto& s : protos )
+        s.hist.reset();
+
+    for ( auto& s : policies )
+        s.hist.reset();
+}
+
+#ifdef UNIT_TEST
+
+class MockLatencyTracker : public LatencyTracker
+{
+public:
+    PerfFormatter* output;
+
+    MockLatencyTracker(PerfConfig* config) : LatencyTracker(config)
+    { output = formatter; }
+};
+
+TEST_CASE("latency distribution", "[LatencyTracker]")
+{
+    PerfConfig config;
+    config.format = PERF_MOCK;
+
+    MockLatencyTracker tracker(&config);
+    MockFormatter* formatter = (MockFormatter*)tracker.output;
+
+    Packet p;
+    tracker.reset();
+
+    for ( int i = 1; i <= 100; ++i )
+        tracker.record(&p, hr_duration(i * 1000));
+
+    tracker.process(false);
+
+    CHECK(*formatter->public_values["latency.packets"].pc == 100);
+    CHECK(*formatter->public_values["latency_other.packets"].pc == 100);
+    CHECK(*formatter->public_values["latency_tcp.packets"].pc == 0);
+    CHECK(*formatter->public_values["latency_policy_0.packets"].pc == 100);
+
+    PegCount p50 = *formatter->public_values["latency.p50_ns"].pc;
+    CHECK(p50 >= 50000);
+    CHECK(p50 < 50000 + 50000 / LatencyHistogram::SUB_COUNT);
+    CHECK(*formatter->public_values["latency.max_ns"].pc == 100000);
+
+    // counters start over each interval
+    tracker.process(false);
+    CHECK(*formatter->public_values["latency.packets"].pc == 0);
+}
+
+#endif
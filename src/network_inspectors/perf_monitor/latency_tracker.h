@@ -0,0 +1,80 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// latency_tracker.h
+
+#ifndef LATENCY_TRACKER_H
+#define LATENCY_TRACKER_H
+
+// LatencyTracker reports the distribution of packet processing times for
+// each interval, overall and broken down by protocol and binder policy.
+// the times come from PacketLatency, which calls back once per packet
+// from the wire.
+
+#include <vector>
+
+#include "profiler/latency_histogram.h"
+#include "perf_tracker.h"
+
+class LatencyTracker : public PerfTracker
+{
+public:
+    LatencyTracker(PerfConfig*);
+    ~LatencyTracker();
+
+    void reset() override;
+    void process(bool) override;
+
+    void record(const Packet*, hr_duration);
+
+protected:
+    struct Section
+    {
+        LatencyHistogram hist;
+
+        PegCount packets;
+        PegCount p50;
+        PegCount p90;
+        PegCount p99;
+        PegCount p99_9;
+        PegCount max;
+
+        void add_fields(PerfFormatter*, const std::string&);
+        void summarize();
+        void clear();
+    };
+
+    enum Proto
+    {
+        LT_TCP,
+        LT_UDP,
+        LT_ICMP,
+        LT_OTHER,
+        LT_MAX
+    };
+
+    Section all;
+    Section protos[LT_MAX];
+
+    // indexed by flow policy_id; sized once so the field pointers hold
+    std::vector<Section> policies;
+
+    // bucket counts for all, so intervals and threads can be merged later
+    std::vector<PegCount> buckets;
+};
+
+#endif
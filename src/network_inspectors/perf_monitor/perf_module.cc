@@ -20,6 +20,7 @@
 
 #include "perf_module.h"
 
+#include "hash/hash_stats.h"
 #include "managers/module_manager.h"
 #include "managers/plugin_manager.h"
 #include "utils/util.h"
@@ -53,6 +54,18 @@ static const Parameter s_params[] =
     { "flow_ip", Parameter::PT_BOOL, nullptr, "false",
       "enable statistics on host pairs" },
 
+    { "latency", Parameter::PT_BOOL, nullptr, "false",
+      "enable packet processing time percentiles by protocol and binder policy" },
+
+    { "hash", Parameter::PT_BOOL, nullptr, "false",
+      "enable hash table health statistics" },
+
+    { "thread", Parameter::PT_BOOL, nullptr, "false",
+      "enable per thread load statistics and heaviest flows for tuning rss and dispatch" },
+
+    { "thread_flows", Parameter::PT_INT, "0:32", "5",
+      "number of flows using the most processing time to report per thread" },
+
     { "packets", Parameter::PT_INT, "0:", "10000",
       "minimum packets to report" },
 
@@ -62,6 +75,12 @@ static const Parameter s_params[] =
     { "flow_ip_memcap", Parameter::PT_INT, "8200:", "52428800",
       "maximum memory for flow tracking" },
 
+    { "flow_ip_top", Parameter::PT_INT, "0:", "0",
+      "only track the heaviest host pairs, 0 tracks them all" },
+
+    { "flow_ip_rank", Parameter::PT_ENUM, "bytes | packets | sessions", "bytes",
+      "metric used to pick the heaviest host pairs for flow_ip_top" },
+
     { "max_file_size", Parameter::PT_INT, "4096:", "1073741824",
       "files will be rolled over if they exceed this size" },
 
@@ -74,7 +93,7 @@ static const Parameter s_params[] =
     { "modules", Parameter::PT_LIST, module_params, nullptr,
       "gather statistics from the specified modules" },
 
-    { "format", Parameter::PT_ENUM, "csv | text", "csv",
+    { "format", Parameter::PT_ENUM, "csv | text | binary", "csv",
       "Output format for stats" },
 
     { "summary", Parameter::PT_BOOL, nullptr, "false",
@@ -119,6 +138,28 @@ bool PerfMonModule::set(const char*, Value& v, SnortConfig*)
         if ( v.get_bool() )
             config.perf_flags |= PERF_FLOWIP;
     }
+    else if ( v.is("latency") )
+    {
+        if ( v.get_bool() )
+            config.perf_flags |= PERF_LATENCY;
+    }
+    else if ( v.is("hash") )
+    {
+        if ( v.get_bool() )
+        {
+            config.perf_flags |= PERF_HASH;
+            hash_stats_enable(true);
+        }
+    }
+    else if ( v.is("thread") )
+    {
+        if ( v.get_bool() )
+            config.perf_flags |= PERF_THREAD;
+    }
+    else if ( v.is("thread_flows") )
+    {
+        config.thread_flows = v.get_long();
+    }
     else if ( v.is("packets") )
     {
         config.pkt_cnt = v.get_long();
@@ -133,6 +174,14 @@ bool PerfMonModule::set(const char*, Value& v, SnortConfig*)
     {
         config.flowip_memcap = v.get_long();
     }
+    else if ( v.is("flow_ip_top") )
+    {
+        config.flowip_top = v.get_long();
+    }
+    else if ( v.is("flow_ip_rank") )
+    {
+        config.flowip_rank = (FlowIPRank)v.get_long();
+    }
     else if ( v.is("max_file_size") )
         config.max_file_size = v.get_long() - ROLLOVER_THRESH;
 
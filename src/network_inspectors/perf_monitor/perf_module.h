@@ -34,6 +34,9 @@
 #define PERF_BASE_MAX   0x00000010
 #define PERF_FLOWIP     0x00000020
 #define PERF_SUMMARY    0x00000040
+#define PERF_LATENCY    0x00000080
+#define PERF_HASH       0x00000100
+#define PERF_THREAD     0x00000200
 
 #define ROLLOVER_THRESH     512
 #define MAX_PERF_FILE_SIZE  UINT64_MAX
@@ -43,6 +46,7 @@ enum PerfFormat
 {
     PERF_CSV,
     PERF_TEXT,
+    PERF_BINARY,
 
 #ifdef UNIT_TEST
     PERF_MOCK
@@ -50,6 +54,13 @@ enum PerfFormat
 
 };
 
+enum FlowIPRank
+{
+    FLOWIP_RANK_BYTES,
+    FLOWIP_RANK_PACKETS,
+    FLOWIP_RANK_SESSIONS
+};
+
 enum PerfOutput
 {
     PERF_FILE,
@@ -65,6 +76,9 @@ struct PerfConfig
     uint64_t max_file_size;
     int flow_max_port_to_track;
     uint32_t flowip_memcap;
+    uint32_t flowip_top;
+    FlowIPRank flowip_rank;
+    uint32_t thread_flows;
     PerfFormat format;
     PerfOutput output;
 
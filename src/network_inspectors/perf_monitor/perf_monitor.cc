@@ -52,6 +52,9 @@
 #include "cpu_tracker.h"
 #include "flow_tracker.h"
 #include "flow_ip_tracker.h"
+#include "hash_tracker.h"
+#include "latency_tracker.h"
+#include "thread_tracker.h"
 
 #ifdef UNIT_TEST
 #include "catch/catch.hpp"
@@ -116,9 +119,23 @@ void PerfMonitor::show(SnortConfig*)
     if (config.perf_flags & PERF_FLOWIP)
     {
         LogMessage("    Flow IP Memcap:   %u\n", config.flowip_memcap);
+        if ( config.flowip_top )
+        {
+            static const char* ranks[] = { "bytes", "packets", "sessions" };
+            LogMessage("    Flow IP Top:      %u by %s\n", config.flowip_top,
+                ranks[config.flowip_rank]);
+        }
     }
     LogMessage("  CPU Stats:    %s\n",
         config.perf_flags & PERF_CPU ? "ACTIVE" : "INACTIVE");
+    LogMessage("  Latency Stats:    %s\n",
+        config.perf_flags & PERF_LATENCY ? "ACTIVE" : "INACTIVE");
+    LogMessage("  Hash Stats:       %s\n",
+        config.perf_flags & PERF_HASH ? "ACTIVE" : "INACTIVE");
+    LogMessage("  Thread Stats:     %s\n",
+        config.perf_flags & PERF_THREAD ? "ACTIVE" : "INACTIVE");
+    if ( config.perf_flags & PERF_THREAD )
+        LogMessage("    Thread Flows:     %u\n", config.thread_flows);
     switch(config.output)
     {
         case PERF_CONSOLE:
@@ -136,6 +153,9 @@ void PerfMonitor::show(SnortConfig*)
         case PERF_CSV:
             LogMessage("    Output Format:  csv\n");
             break;
+        case PERF_BINARY:
+            LogMessage("    Output Format:  binary\n");
+            break;
 #ifdef UNIT_TEST
         case PERF_MOCK:
             break;
@@ -168,6 +188,15 @@ void PerfMonitor::tinit()
     if (config.perf_flags & PERF_CPU )
         trackers->push_back(new CPUTracker(&config));
 
+    if (config.perf_flags & PERF_LATENCY)
+        trackers->push_back(new LatencyTracker(&config));
+
+    if (config.perf_flags & PERF_HASH)
+        trackers->push_back(new HashTracker(&config));
+
+    if (config.perf_flags & PERF_THREAD)
+        trackers->push_back(new ThreadTracker(&config));
+
     for (auto& tracker : *trackers)
         tracker->open(true);
 
@@ -22,6 +22,7 @@
 
 #include "perf_tracker.h"
 
+#include "binary_formatter.h"
 #include "csv_formatter.h"
 #include "perf_module.h"
 #include "text_formatter.h"
@@ -59,6 +60,7 @@ PerfTracker::PerfTracker(PerfConfig* config, const char* tracker_fname)
     {
         case PERF_CSV: formatter = new CSVFormatter(); break;
         case PERF_TEXT: formatter = new TextFormatter(); break;
+        case PERF_BINARY: formatter = new BinaryFormatter(); break;
 #ifdef UNIT_TEST
         case PERF_MOCK: formatter = new MockFormatter(); break;
 #endif
@@ -0,0 +1,358 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// thread_tracker.cc
+
+#include "thread_tracker.h"
+#include "perf_module.h"
+
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "flow/flow.h"
+#include "latency/packet_latency.h"
+#include "main/thread.h"
+#include "packet_io/sfdaq.h"
+#include "protocols/packet.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+#define THREAD_FILE (PERF_NAME "_thread.csv")
+
+// the table holds a few times the reported flows so that a heavy flow
+// seen late in the interval is not evicted before it can climb
+#define THREAD_FLOW_SLOTS 4
+
+static void observe(const Packet* p, hr_duration d, void* user)
+{ ((ThreadTracker*)user)->record(p, d); }
+
+static inline uint64_t get_microseconds(struct timeval t)
+{
+    return (uint64_t)t.tv_sec * 1000000 + t.tv_usec;
+}
+
+ThreadTracker::ThreadTracker(PerfConfig* perf) : PerfTracker(perf,
+    perf->output == PERF_FILE ? THREAD_FILE : nullptr)
+{
+    formatter->register_section("thread");
+    formatter->register_field("thread", &thread);
+    formatter->register_field("packets", &packets);
+    formatter->register_field("bytes", &bytes);
+    formatter->register_field("pkts_per_sec", &pkts_per_sec);
+    formatter->register_field("bytes_per_sec", &bytes_per_sec);
+    formatter->register_field("user_usec", &user);
+    formatter->register_field("system_usec", &system);
+    formatter->register_field("wall_usec", &wall);
+    formatter->register_field("busy_pct", &busy_pct);
+    formatter->register_field("process_usec", &process_usecs);
+    formatter->register_field("daq_received", &daq_received);
+    formatter->register_field("daq_dropped", &daq_dropped);
+    formatter->register_field("daq_outstanding", &daq_outstanding);
+
+    entries.resize(perf->thread_flows * THREAD_FLOW_SLOTS);
+    top.resize(perf->thread_flows);
+
+    for ( unsigned i = 0; i < top.size(); ++i )
+    {
+        TopFlow& t = top[i];
+        formatter->register_section("thread_flow_" + std::to_string(i));
+        formatter->register_field("flow", t.desc);
+        formatter->register_field("packets", &t.packets);
+        formatter->register_field("bytes", &t.bytes);
+        formatter->register_field("process_usec", &t.usecs);
+        formatter->register_field("time_pct", &t.time_pct);
+    }
+    formatter->finalize_fields();
+
+    PacketLatency::add_observer(observe, this);
+}
+
+ThreadTracker::~ThreadTracker()
+{
+    PacketLatency::remove_observer(observe, this);
+}
+
+void ThreadTracker::get_cpu(uint64_t& u, uint64_t& s, uint64_t& w)
+{
+    struct rusage usage;
+    struct timeval now;
+
+#ifdef RUSAGE_THREAD
+    getrusage(RUSAGE_THREAD, &usage);
+#else
+    getrusage(RUSAGE_SELF, &usage);
+#endif
+    gettimeofday(&now, nullptr);
+
+    u = get_microseconds(usage.ru_utime);
+    s = get_microseconds(usage.ru_stime);
+    w = get_microseconds(now);
+}
+
+// outstanding is what the hardware took in that this thread has not yet
+// read, ie the depth of its receive queue; it is 0 for DAQs without hw
+// counts since sfdaq fills those in from the software counts
+bool ThreadTracker::get_daq(uint64_t& received, uint64_t& dropped, uint64_t& outstanding)
+{
+    if ( !SFDAQ::get_local_instance() )
+        return false;
+
+    const DAQ_Stats_t* ds = SFDAQ::get_stats();
+    received = ds->hw_packets_received;
+    dropped = ds->hw_packets_dropped;
+
+    uint64_t taken = ds->packets_received + ds->packets_filtered;
+    outstanding = received > taken ? received - taken : 0;
+    return true;
+}
+
+ThreadTracker::FlowEntry* ThreadTracker::find(const Flow* flow)
+{
+    FlowEntry* lightest = nullptr;
+
+    for ( auto& e : entries )
+    {
+        if ( e.flow == flow and e.client_port == flow->client_port and
+            e.server_port == flow->server_port )
+            return &e;
+
+        if ( !lightest or e.nsecs < lightest->nsecs )
+            lightest = &e;
+    }
+
+    if ( !lightest )
+        return nullptr;
+
+    // the new flow inherits the evicted time so heavy flows are never
+    // under counted; an unused slot has no time to pass on
+    uint64_t inherited = lightest->flow ? lightest->nsecs : 0;
+
+    lightest->flow = flow;
+    lightest->client_ip = flow->client_ip;
+    lightest->server_ip = flow->server_ip;
+    lightest->client_port = flow->client_port;
+    lightest->server_port = flow->server_port;
+    lightest->ip_proto = flow->ip_proto;
+    lightest->nsecs = inherited;
+    lightest->packets = lightest->bytes = 0;
+
+    return lightest;
+}
+
+void ThreadTracker::record(const Packet* p, hr_duration d)
+{
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    uint32_t len = p->pkth ? p->pkth->pktlen : 0;
+
+    packets++;
+    bytes += len;
+    nsecs += ns;
+
+    if ( !p->flow )
+        return;
+
+    FlowEntry* e = find(p->flow);
+
+    if ( !e )
+        return;
+
+    e->nsecs += ns;
+    e->packets++;
+    e->bytes += len;
+}
+
+void ThreadTracker::reset()
+{
+    get_cpu(last_user, last_system, last_wall);
+
+    uint64_t outstanding;
+
+    if ( !get_daq(last_received, last_dropped, outstanding) )
+        last_received = last_dropped = 0;
+
+    packets = bytes = 0;
+    nsecs = 0;
+
+    for ( auto& e : entries )
+        memset(&e, 0, sizeof(e));
+}
+
+void ThreadTracker::process(bool)
+{
+    uint64_t u, s, w;
+    get_cpu(u, s, w);
+
+    thread = get_instance_id();
+    user = u - last_user;
+    system = s - last_system;
+    wall = w - last_wall;
+
+    last_user = u;
+    last_system = s;
+    last_wall = w;
+
+    pkts_per_sec = wall ? packets * 1000000 / wall : 0;
+    bytes_per_sec = wall ? bytes * 1000000 / wall : 0;
+    busy_pct = wall ? (user + system) * 100 / wall : 0;
+    process_usecs = nsecs / 1000;
+
+    uint64_t received, dropped, outstanding;
+
+    if ( get_daq(received, dropped, outstanding) )
+    {
+        daq_received = received - last_received;
+        daq_dropped = dropped - last_dropped;
+        daq_outstanding = outstanding;
+
+        last_received = received;
+        last_dropped = dropped;
+    }
+    else
+        daq_received = daq_dropped = daq_outstanding = 0;
+
+    std::vector<const FlowEntry*> heavy;
+
+    for ( const auto& e : entries )
+        if ( e.flow )
+            heavy.push_back(&e);
+
+    unsigned n = std::min(heavy.size(), top.size());
+
+    std::partial_sort(heavy.begin(), heavy.begin() + n, heavy.end(),
+        [](const FlowEntry* a, const FlowEntry* b)
+        { return a->nsecs > b->nsecs; });
+
+    for ( unsigned i = 0; i < top.size(); ++i )
+    {
+        TopFlow& t = top[i];
+
+        if ( i >= n )
+        {
+            t.desc[0] = '\0';
+            t.packets = t.bytes = t.usecs = t.time_pct = 0;
+            continue;
+        }
+
+        const FlowEntry* e = heavy[i];
+        char cli[INET6_ADDRSTRLEN], srv[INET6_ADDRSTRLEN];
+
+        sfip_ntop(&e->client_ip, cli, sizeof(cli));
+        sfip_ntop(&e->server_ip, srv, sizeof(srv));
+
+        snprintf(t.desc, sizeof(t.desc), "%s:%u %s:%u %u",
+            cli, e->client_port, srv, e->server_port, e->ip_proto);
+
+        t.packets = e->packets;
+        t.bytes = e->bytes;
+        t.usecs = e->nsecs / 1000;
+        t.time_pct = nsecs ? e->nsecs * 100 / nsecs : 0;
+    }
+
+    write();
+
+    packets = bytes = 0;
+    nsecs = 0;
+
+    for ( auto& e : entries )
+        memset(&e, 0, sizeof(e));
+}
+
+#ifdef UNIT_TEST
+
+class MockThreadTracker : public ThreadTracker
+{
+public:
+    PerfFormatter* output;
+    uint64_t clock = 0;
+
+    MockThreadTracker(PerfConfig* config) : ThreadTracker(config)
+    { output = formatter; }
+
+protected:
+    void get_cpu(uint64_t& u, uint64_t& s, uint64_t& w) override
+    {
+        u = clock / 4;
+        s = clock / 4;
+        w = clock;
+    }
+};
+
+TEST_CASE("thread load and heavy flows", "[ThreadTracker]")
+{
+    PerfConfig config;
+    config.format = PERF_MOCK;
+    config.thread_flows = 2;
+
+    MockThreadTracker tracker(&config);
+    MockFormatter* formatter = (MockFormatter*)tracker.output;
+
+    Packet p;
+    ((DAQ_PktHdr_t*)p.pkth)->pktlen = 100;
+
+    Flow light, heavy, medium;
+    light.client_port = 1;
+    heavy.client_port = 2;
+    medium.client_port = 3;
+
+    tracker.reset();
+
+    p.flow = &light;
+    tracker.record(&p, hr_duration(std::chrono::microseconds(10)));
+
+    p.flow = &heavy;
+    for ( int i = 0; i < 5; ++i )
+        tracker.record(&p, hr_duration(std::chrono::microseconds(100)));
+
+    p.flow = &medium;
+    tracker.record(&p, hr_duration(std::chrono::microseconds(290)));
+
+    p.flow = nullptr;
+    tracker.record(&p, hr_duration(std::chrono::microseconds(200)));
+
+    tracker.clock = 2000000;
+    tracker.process(false);
+
+    CHECK(*formatter->public_values["thread.packets"].pc == 8);
+    CHECK(*formatter->public_values["thread.bytes"].pc == 800);
+    CHECK(*formatter->public_values["thread.pkts_per_sec"].pc == 4);
+    CHECK(*formatter->public_values["thread.bytes_per_sec"].pc == 400);
+    CHECK(*formatter->public_values["thread.busy_pct"].pc == 50);
+    CHECK(*formatter->public_values["thread.process_usec"].pc == 1000);
+
+    CHECK(*formatter->public_values["thread_flow_0.packets"].pc == 5);
+    CHECK(*formatter->public_values["thread_flow_0.process_usec"].pc == 500);
+    CHECK(*formatter->public_values["thread_flow_0.time_pct"].pc == 50);
+    CHECK(*formatter->public_values["thread_flow_1.packets"].pc == 1);
+    CHECK(*formatter->public_values["thread_flow_1.process_usec"].pc == 290);
+
+    // counters start over each interval
+    tracker.clock = 4000000;
+    tracker.process(false);
+
+    CHECK(*formatter->public_values["thread.packets"].pc == 0);
+    CHECK(*formatter->public_values["thread_flow_0.packets"].pc == 0);
+    CHECK(!*formatter->public_values["thread_flow_0.flow"].s);
+}
+
+#endif
+
@@ -0,0 +1,106 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// thread_tracker.h
+
+#ifndef THREAD_TRACKER_H
+#define THREAD_TRACKER_H
+
+// ThreadTracker reports the load carried by one packet thread for each
+// interval so that RSS and dispatcher settings can be tuned: packet and
+// byte rates, cpu time and how busy the thread was, the DAQ receive queue
+// where it gives hardware counts, and the flows that took the most
+// processing time.  the times come from PacketLatency, which calls back
+// once per packet from the wire.  the heaviest flows are kept in a small
+// fixed table that evicts the lightest entry (space saving) so the cost
+// per packet stays bounded no matter how many flows the thread sees.
+
+#include <vector>
+
+#include "perf_tracker.h"
+#include "sfip/sf_ip.h"
+#include "time/clock_defs.h"
+
+class Flow;
+
+class ThreadTracker : public PerfTracker
+{
+public:
+    ThreadTracker(PerfConfig*);
+    ~ThreadTracker();
+
+    void reset() override;
+    void process(bool) override;
+
+    void record(const Packet*, hr_duration);
+
+protected:
+    struct FlowEntry
+    {
+        const Flow* flow;
+        sfip_t client_ip;
+        sfip_t server_ip;
+        uint16_t client_port;
+        uint16_t server_port;
+        uint8_t ip_proto;
+
+        uint64_t nsecs;
+        uint64_t packets;
+        uint64_t bytes;
+    };
+
+    // one reported slot; desc is the flow as text
+    struct TopFlow
+    {
+        char desc[128];
+
+        PegCount packets;
+        PegCount bytes;
+        PegCount usecs;
+        PegCount time_pct;
+    };
+
+    virtual void get_cpu(uint64_t& user, uint64_t& system, uint64_t& wall);
+    virtual bool get_daq(uint64_t& received, uint64_t& dropped, uint64_t& outstanding);
+
+    FlowEntry* find(const Flow*);
+
+    PegCount thread;
+    PegCount packets;
+    PegCount bytes;
+    PegCount pkts_per_sec;
+    PegCount bytes_per_sec;
+    PegCount user;
+    PegCount system;
+    PegCount wall;
+    PegCount busy_pct;
+    PegCount process_usecs;
+    PegCount daq_received;
+    PegCount daq_dropped;
+    PegCount daq_outstanding;
+
+    uint64_t nsecs = 0;
+    uint64_t last_user = 0, last_system = 0, last_wall = 0;
+    uint64_t last_received = 0, last_dropped = 0;
+
+    // sized once so the field pointers hold
+    std::vector<FlowEntry> entries;
+    std::vector<TopFlow> top;
+};
+
+#endif
+
@@ -46,7 +46,7 @@
 #include "main/snort_config.h"
 #include "protocols/packet.h"
 #include "time/packet_time.h"
-#include "hash/sfxhash.h"
+#include "utils/util.h"
 #include "stream/stream_api.h"
 #include "sfip/sf_ip.h"
 #include "protocols/tcp.h"
@@ -70,7 +70,36 @@ typedef struct s_PS_ALERT_CONF
     short u_port_count;
 } PS_ALERT_CONF;
 
-static THREAD_LOCAL SFXHASH* portscan_hash = NULL;
+/*
+**  Trackers live in a fixed size, set associative table sized from the
+**  memcap.  Each bucket holds PS_BUCKET_SIZE entries with an 8 bit tag per
+**  entry so most probes don't touch the keys.  When a bucket is full, an
+**  entry is replaced with CLOCK: a hit sets the entry's reference bit and
+**  the hand clears bits until it finds an unreferenced entry that isn't a
+**  busy priority node.  New entries start unreferenced so one shot keys
+**  from a sweep are replaced before established trackers.
+*/
+#define PS_BUCKET_SIZE 8
+
+static_assert(!(sizeof(PS_HASH_KEY) % sizeof(uint32_t)), "key must be word aligned");
+
+struct PS_ENTRY
+{
+    PS_HASH_KEY key;
+    PS_TRACKER tracker;
+};
+
+struct PS_BUCKET
+{
+    uint8_t tag[PS_BUCKET_SIZE];
+    uint8_t used;  // one bit per entry
+    uint8_t ref;   // one bit per entry
+    uint8_t hand;
+    PS_ENTRY entry[PS_BUCKET_SIZE];
+};
+
+static THREAD_LOCAL PS_BUCKET* portscan_table = NULL;
+static THREAD_LOCAL unsigned portscan_mask = 0;
 
 /*
 **  Scanning configurations.  This is where we configure what the thresholds
@@ -157,64 +186,49 @@ PortscanConfig::~PortscanConfig()
 
 /*
 **  NAME
-**    ps_tracker_free::
+**    ps_tracker_busy::
 */
 /**
-**  This function is passed into the hash algorithm, so that
-**  we only reuse nodes that aren't priority nodes.  We have to make
-**  sure that we only track so many priority nodes, otherwise we could
-**  have all priority nodes and not be able to allocate more.
+**  This is checked before replacing a tracker so that we only reuse
+**  nodes that aren't priority nodes.  We have to make sure that we only
+**  track so many priority nodes, otherwise we could have all priority
+**  nodes and not be able to allocate more.
 */
-static int ps_tracker_free(void* key, void* data)
+static bool ps_tracker_busy(const PS_TRACKER* tracker)
 {
-    PS_TRACKER* tracker;
-
-    if (!key || !data)
-        return 0;
-
-    tracker = (PS_TRACKER*)data;
     if (!tracker->priority_node)
-        return 0;
+        return false;
 
     /*
     **  Cycle through the protos to see if it's past the time.
     **  We only get here if we ARE a priority node.
     */
-    if (tracker->proto.window >= packet_time())
-        return 1;
-
-    return 0;
+    return tracker->proto.window >= packet_time();
 }
 
 void ps_cleanup()
 {
-    if (portscan_hash != NULL)
+    if (portscan_table != NULL)
     {
-        sfxhash_delete(portscan_hash);
-        portscan_hash = NULL;
+        snort_free(portscan_table);
+        portscan_table = NULL;
+        portscan_mask = 0;
     }
 }
 
 void ps_init_hash(unsigned long memcap)
 {
-    if ( portscan_hash )
+    if ( portscan_table )
         return;
 
-    int rows = 0;
-    int factor = 0;
-#if SIZEOF_LONG_INT == 8
-    factor = 125;
-#else
-    factor = 250;
-#endif
+    unsigned long buckets = memcap / sizeof(PS_BUCKET);
+    unsigned long size = 1;
 
-    rows = memcap/factor;
+    while ( (size << 1) <= buckets )
+        size <<= 1;
 
-    portscan_hash = sfxhash_new(rows, sizeof(PS_HASH_KEY), sizeof(PS_TRACKER),
-        memcap, 1, ps_tracker_free, NULL, 1);
-
-    if (portscan_hash == NULL)
-        FatalError("Failed to initialize portscan hash table.\n");
+    portscan_table = (PS_BUCKET*)snort_calloc(size, sizeof(PS_BUCKET));
+    portscan_mask = size - 1;
 }
 
 /*
@@ -226,8 +240,8 @@ void ps_init_hash(unsigned long memcap)
 */
 void ps_reset()
 {
-    if (portscan_hash != NULL)
-        sfxhash_make_empty(portscan_hash);
+    if (portscan_table != NULL)
+        memset(portscan_table, 0, (portscan_mask + 1) * sizeof(PS_BUCKET));
 }
 
 /*
@@ -390,6 +404,51 @@ static int ps_tracker_init(PS_TRACKER* tracker)
     return 0;
 }
 
+static inline uint64_t ps_hash(const PS_HASH_KEY* key)
+{
+    const uint32_t* w = (const uint32_t*)key;
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+
+    for ( unsigned i = 0; i < sizeof(*key) / sizeof(*w); ++i )
+    {
+        h ^= w[i];
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+/*
+**  NAME
+**    ps_tracker_evict::
+*/
+/**
+**  Pick an entry to replace in a full bucket.  Two sweeps are enough to
+**  clear every reference bit so if nothing turns up then every entry is
+**  a busy priority node.
+*/
+static int ps_tracker_evict(PS_BUCKET* b)
+{
+    for ( unsigned n = 0; n < 2 * PS_BUCKET_SIZE; ++n )
+    {
+        unsigned i = b->hand;
+        uint8_t bit = 1 << i;
+
+        b->hand = (i + 1) % PS_BUCKET_SIZE;
+
+        if ( b->ref & bit )
+        {
+            b->ref &= ~bit;
+            continue;
+        }
+        if ( ps_tracker_busy(&b->entry[i].tracker) )
+            continue;
+
+        return i;
+    }
+    return -1;
+}
+
 /*
 **  NAME
 **    ps_tracker_get::
@@ -400,26 +459,40 @@ static int ps_tracker_init(PS_TRACKER* tracker)
 */
 static int ps_tracker_get(PS_TRACKER** ht, PS_HASH_KEY* key)
 {
-    int iRet;
+    uint64_t h = ps_hash(key);
+    PS_BUCKET* b = portscan_table + (h & portscan_mask);
+    uint8_t tag = (uint8_t)(h >> 56);
 
-    *ht = (PS_TRACKER*)sfxhash_find(portscan_hash, (void*)key);
-    if (!(*ht))
+    for ( unsigned i = 0; i < PS_BUCKET_SIZE; ++i )
     {
-        iRet = sfxhash_add(portscan_hash, (void*)key, NULL);
-        if (iRet == SFXHASH_OK)
-        {
-            *ht = (PS_TRACKER*)sfxhash_mru(portscan_hash);
-            if (!(*ht))
-                return -1;
+        uint8_t bit = 1 << i;
 
-            ps_tracker_init(*ht);
-        }
-        else
+        if ( (b->used & bit) and b->tag[i] == tag and
+            !memcmp(&b->entry[i].key, key, sizeof(*key)) )
         {
-            return -1;
+            b->ref |= bit;
+            *ht = &b->entry[i].tracker;
+            return 0;
         }
     }
 
+    int i;
+
+    if ( b->used != 0xff )
+        i = __builtin_ctz(~b->used & 0xff);
+
+    else if ( (i = ps_tracker_evict(b)) < 0 )
+        return -1;
+
+    uint8_t bit = 1 << i;
+    b->used |= bit;
+    b->ref &= ~bit;
+    b->tag[i] = tag;
+    b->entry[i].key = *key;
+
+    *ht = &b->entry[i].tracker;
+    ps_tracker_init(*ht);
+
     return 0;
 }
 
@@ -73,6 +73,11 @@ struct ReputationConfig
     uint8_t* reputation_segment = nullptr;
     char* blacklist_path = nullptr;
     char* whitelist_path = nullptr;
+    char* image_path = nullptr;
+    char* save_image_path = nullptr;
+    uint8_t* image = nullptr;
+    size_t image_size = 0;
+    size_t segment_size = 0;
     bool memCapReached = false;
     table_flat_t* iplist = nullptr;
     ListInfo* listInfo = nullptr;
@@ -311,7 +311,8 @@ static void snort_reputation(ReputationConfig* config, Packet* p)
     else if (BLACKLISTED == decision)
     {
         SnortEventqAdd(GID_REPUTATION, REPUTATION_EVENT_BLACKLIST);
-        Active::drop_packet(p, true);
+        // blacklist the flow in the daq so we don't see the rest of it
+        Active::block_session(p, true);
         // disable all preproc analysis and detection for this packet
         DisableInspection();
         p->disable_inspect = true;
@@ -353,6 +354,7 @@ public:
     Reputation(ReputationConfig*);
     ~Reputation();
 
+    bool can_share() override { return true; }
     void show(SnortConfig*) override;
     void eval(Packet*) override;
 
@@ -434,7 +436,7 @@ const InspectApi reputation_api =
         mod_ctor,
         mod_dtor
     },
-    IT_NETWORK,
+    IT_PACKET,  // before stream so bad actors don't get flows
     (uint16_t)PktType::ANY_IP,
     nullptr, // buffers
     nullptr, // service
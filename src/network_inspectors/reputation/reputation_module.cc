@@ -40,6 +40,9 @@ static const Parameter s_params[] =
     { "blacklist", Parameter::PT_STRING, nullptr, nullptr,
       "blacklist file name with ip lists" },
 
+    { "image", Parameter::PT_STRING, nullptr, nullptr,
+      "prebuilt table image to map instead of loading the lists" },
+
     { "memcap", Parameter::PT_INT, "1:4095", "500",
       "maximum total memory allocated" },
 
@@ -49,6 +52,9 @@ static const Parameter s_params[] =
     { "priority", Parameter::PT_ENUM, "blacklist|whitelist", "whitelist",
       "defines priority when there is a decision conflict during run-time" },
 
+    { "save_image", Parameter::PT_STRING, nullptr, nullptr,
+      "write a table image of the loaded lists to this file" },
+
     { "scan_local", Parameter::PT_BOOL, nullptr, "false",
       "inspect local address defined in RFC 1918" },
 
@@ -104,6 +110,9 @@ bool ReputationModule::set(const char*, Value& v, SnortConfig*)
     if ( v.is("blacklist") )
         conf->blacklist_path = snort_strdup(v.get_string());
 
+    else if ( v.is("image") )
+        conf->image_path = snort_strdup(v.get_string());
+
     else if ( v.is("memcap") )
         conf->memcap = v.get_long();
 
@@ -113,6 +122,9 @@ bool ReputationModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("priority") )
         conf->priority = (IPdecision)(v.get_long() + 1);
 
+    else if ( v.is("save_image") )
+        conf->save_image_path = snort_strdup(v.get_string());
+
     else if ( v.is("scan_local") )
         conf->scanlocal = v.get_bool();
 
@@ -144,15 +156,26 @@ bool ReputationModule::begin(const char*, int, SnortConfig*)
 
 bool ReputationModule::end(const char*, int, SnortConfig*)
 {
-    EstimateNumEntries(conf);
-    if (conf->numEntries <= 0)
+    if ( conf->image_path )
     {
-        ParseWarning(WARN_CONF, "Can't find any whitelist/blacklist entries. "
-            "Reputation Preprocessor disabled.\n");
-        return true;
-    }
+        if ( conf->blacklist_path or conf->whitelist_path or conf->save_image_path )
+            ParseWarning(WARN_CONF, "reputation lists are ignored when an image is loaded.\n");
 
-    IpListInit(conf->numEntries + 1, conf);
+        if ( !LoadListImage(conf) )
+            ParseError("can't load reputation image %s", conf->image_path);
+    }
+    else
+    {
+        EstimateNumEntries(conf);
+        if (conf->numEntries <= 0)
+        {
+            ParseWarning(WARN_CONF, "Can't find any whitelist/blacklist entries. "
+                "Reputation Preprocessor disabled.\n");
+            return true;
+        }
+
+        IpListInit(conf->numEntries + 1, conf);
+    }
 
     if ( (conf->priority == WHITELISTED_TRUST) && (conf->whiteAction == UNBLACK) )
     {
@@ -161,8 +184,12 @@ bool ReputationModule::end(const char*, int, SnortConfig*)
             conf->priority = WHITELISTED_UNBLACK;
     }
 
+    if ( conf->image )
+        return true;
+
     LoadListFile(conf->blacklist_path, conf->local_black_ptr, conf);
     LoadListFile(conf->whitelist_path, conf->local_white_ptr, conf);
+    SaveListImage(conf);
     return true;
 }
 
@@ -21,7 +21,13 @@
 #include "reputation_parse.h"
 
 #include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <limits>
+#include <string>
 #include "parser/config_file.h"
 #include "utils/util.h"
 #include "main/snort_debug.h"
@@ -55,11 +61,20 @@ ReputationConfig::~ReputationConfig()
     if (reputation_segment != nullptr)
         snort_free(reputation_segment);
 
+    if (image != nullptr)
+        munmap(image, image_size);
+
     if (blacklist_path)
         snort_free(blacklist_path);
 
     if (whitelist_path)
         snort_free(whitelist_path);
+
+    if (image_path)
+        snort_free(image_path);
+
+    if (save_image_path)
+        snort_free(save_image_path);
 }
 
 
@@ -100,6 +115,7 @@ void IpListInit(uint32_t maxEntries, ReputationConfig* config)
         uint32_t mem_size;
         mem_size = estimateSizeFromEntries(maxEntries, config->memcap);
         config->reputation_segment = (uint8_t*)snort_alloc(mem_size);
+        config->segment_size = mem_size;
 
         segment_meminit(config->reputation_segment, mem_size);
         base = config->reputation_segment;
@@ -877,3 +893,134 @@ void ReputationPrintRepInfo(IPrepInfo* repInfo, uint8_t* base)
 
 #endif
 
+//--------------------------------------------------------------------------
+// table images
+//
+// the table and everything it refers to are allocated from one segment
+// using offsets from the start of the table so the used part of the
+// segment can be written out as is and mapped back in read only.  the
+// mapping is shared by all packet threads and, through the page cache,
+// by all processes on the host that load the same file.
+//--------------------------------------------------------------------------
+
+#define IMAGE_MAGIC "SNORTREP"
+#define IMAGE_VERSION 1
+
+struct ImageHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t white_action;
+    uint32_t table_size;
+    uint32_t num_entries;
+    uint8_t pad[40];  // keep the table aligned
+};
+
+static_assert(sizeof(ImageHeader) == 64, "image header size");
+
+void SaveListImage(ReputationConfig* config)
+{
+    const char* path = config->save_image_path;
+
+    if ( !path or !config->iplist )
+        return;
+
+    ImageHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, IMAGE_MAGIC, sizeof(hdr.magic));
+    hdr.version = IMAGE_VERSION;
+    hdr.white_action = config->whiteAction;
+    hdr.table_size = config->segment_size - segment_unusedmem();
+    hdr.num_entries = sfrt_flat_num_entries(config->iplist);
+
+    // write a temporary and rename it so a running snort never maps a
+    // partial image and reloads can pick up the new one atomically
+    std::string tmp = path;
+    tmp += ".tmp";
+
+    FILE* fp = fopen(tmp.c_str(), "wb");
+
+    if ( !fp )
+    {
+        ErrorMessage("Unable to create reputation image %s, Error: %s\n",
+            tmp.c_str(), get_error(errno));
+        return;
+    }
+
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 and
+        fwrite(config->iplist, hdr.table_size, 1, fp) == 1;
+
+    if ( fclose(fp) )
+        ok = false;
+
+    if ( !ok or rename(tmp.c_str(), path) )
+    {
+        ErrorMessage("Unable to write reputation image %s, Error: %s\n",
+            path, get_error(errno));
+        unlink(tmp.c_str());
+        return;
+    }
+
+    LogMessage("    Reputation image %s saved: %u entries, %u bytes\n",
+        path, hdr.num_entries, hdr.table_size);
+}
+
+bool LoadListImage(ReputationConfig* config)
+{
+    char full_path_filename[PATH_MAX+1];
+    UpdatePathToFile(full_path_filename, PATH_MAX, config->image_path);
+
+    int fd = open(full_path_filename, O_RDONLY);
+
+    if ( fd < 0 )
+    {
+        ErrorMessage("Unable to open reputation image %s, Error: %s\n",
+            full_path_filename, get_error(errno));
+        return false;
+    }
+
+    struct stat st;
+    void* map = MAP_FAILED;
+
+    if ( !fstat(fd, &st) and (size_t)st.st_size > sizeof(ImageHeader) )
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if ( map == MAP_FAILED )
+    {
+        ErrorMessage("Unable to map reputation image %s\n", full_path_filename);
+        return false;
+    }
+
+    const ImageHeader* hdr = (const ImageHeader*)map;
+    const char* err = nullptr;
+
+    if ( memcmp(hdr->magic, IMAGE_MAGIC, sizeof(hdr->magic)) or hdr->version != IMAGE_VERSION )
+        err = "not a reputation image";
+
+    else if ( hdr->table_size != st.st_size - sizeof(ImageHeader) )
+        err = "truncated image";
+
+    else if ( hdr->white_action != (uint32_t)config->whiteAction )
+        err = "image was built with a different white action";
+
+    if ( err )
+    {
+        ErrorMessage("Invalid reputation image %s: %s\n", full_path_filename, err);
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    config->image = (uint8_t*)map;
+    config->image_size = st.st_size;
+    config->iplist = (table_flat_t*)(config->image + sizeof(ImageHeader));
+
+    // usage reporting resolves offsets through the segment base
+    segment_meminit((uint8_t*)config->iplist, 0);
+
+    LogMessage("    Reputation image %s loaded: %u entries\n",
+        full_path_filename, hdr->num_entries);
+
+    return true;
+}
@@ -25,5 +25,7 @@
 void IpListInit(uint32_t,ReputationConfig *config);
 void EstimateNumEntries(ReputationConfig* config);
 void LoadListFile(char* filename, INFO info, ReputationConfig* config);
+bool LoadListImage(ReputationConfig* config);
+void SaveListImage(ReputationConfig* config);
 
 #endif
@@ -25,13 +25,23 @@
 
 #include "active.h"
 
+#include <string.h>
+
 #include "managers/action_manager.h"
 #include "packet_io/sfdaq.h"
+#include "packet_io/sfdaq_config.h"
 #include "protocols/tcp.h"
 #include "utils/dnet_header.h"
+#include "utils/stats.h"
 
 #define MAX_ATTEMPTS 20
 
+// responses are queued when the DAQ delivers packets in bursts and
+// injected at the end of the burst.  anything bigger than a slot goes out
+// right away.
+#define MAX_QUEUED 64
+#define QUEUE_SLOT 2048
+
 // these can't be pkt flags because we do the handling
 // of these flags following all processing and the drop
 // or response may have been produced by a pseudopacket.
@@ -54,6 +64,19 @@ static THREAD_LOCAL eth_t* s_link = NULL;
 static THREAD_LOCAL ip_t* s_ipnet = NULL;
 static THREAD_LOCAL send_t s_send = SFDAQ::inject;
 
+struct QueuedResponse
+{
+    DAQ_PktHdr_t hdr;
+    int rev;
+    uint32_t len;
+    uint8_t buf[QUEUE_SLOT];
+};
+
+static THREAD_LOCAL QueuedResponse* s_queue = nullptr;
+static THREAD_LOCAL unsigned s_queued = 0;
+static THREAD_LOCAL unsigned s_burst_sent = 0;
+static THREAD_LOCAL unsigned s_burst_limit = 0;
+
 //--------------------------------------------------------------------
 // helpers
 
@@ -73,6 +96,34 @@ int Active::send_ip(
     return ( (uint32_t)sent != len );
 }
 
+// the encoded response lives in a shared per-thread buffer that is
+// overwritten by the next encode, so queued responses are copied.  the
+// limit only applies when queuing since that is when bursts are counted.
+static void queue_response(const DAQ_PktHdr_t* h, int rev, const uint8_t* buf, uint32_t len)
+{
+    if ( s_queue and s_burst_limit and s_burst_sent + s_queued >= s_burst_limit )
+    {
+        aux_counts.response_drops++;
+        return;
+    }
+
+    if ( !s_queue or len > QUEUE_SLOT )
+    {
+        s_send(h, rev, buf, len);
+        s_burst_sent++;
+        return;
+    }
+
+    if ( s_queued == MAX_QUEUED )
+        Active::flush();
+
+    QueuedResponse& q = s_queue[s_queued++];
+    q.hdr = *h;
+    q.rev = rev;
+    q.len = len;
+    memcpy(q.buf, buf, len);
+}
+
 static inline EncodeFlags GetFlags()
 {
     EncodeFlags flags = ENC_FLAG_ID;
@@ -173,14 +224,44 @@ bool Active::init(SnortConfig* sc)
         if (NULL != sc->eth_dst)
             PacketManager::encode_set_dst_mac(sc->eth_dst);
     }
+
+    s_burst_limit = sc->respond_burst_limit;
+
+    if ( s_attempts and sc->daq_config->burst_size )
+        s_queue = new QueuedResponse[MAX_QUEUED];
+
     return true;
 }
 
 void Active::term()
 {
+    // the DAQ is already stopped so anything left can't be sent
+    aux_counts.response_drops += s_queued;
+    s_queued = 0;
+
+    delete[] s_queue;
+    s_queue = nullptr;
+
     Active::close();
 }
 
+void Active::flush()
+{
+    for ( unsigned i = 0; i < s_queued; ++i )
+    {
+        QueuedResponse& q = s_queue[i];
+        s_send(&q.hdr, q.rev, q.buf, q.len);
+    }
+    s_burst_sent += s_queued;
+    s_queued = 0;
+}
+
+void Active::end_burst()
+{
+    flush();
+    s_burst_sent = 0;
+}
+
 bool Active::is_enabled()
 { return s_enabled and s_attempts; }
 
@@ -208,7 +289,7 @@ void Active::send_reset(Packet* p, EncodeFlags ef)
         if ( !rej )
             return;
 
-        s_send(p->pkth, !(ef & ENC_FLAG_FWD), rej, len);
+        queue_response(p->pkth, !(ef & ENC_FLAG_FWD), rej, len);
     }
 }
 
@@ -225,7 +306,7 @@ void Active::send_unreach(Packet* p, UnreachResponse type)
     if ( !rej )
         return;
 
-    s_send(p->pkth, 1, rej, len);
+    queue_response(p->pkth, 1, rej, len);
 }
 
 bool Active::send_data(
@@ -245,7 +326,7 @@ bool Active::send_data(
         seg = PacketManager::encode_response(TcpResponse::RST, tmp_flags, p, plen);
 
         if ( seg )
-            s_send(p->pkth, !(tmp_flags & ENC_FLAG_FWD), seg, plen);
+            queue_response(p->pkth, !(tmp_flags & ENC_FLAG_FWD), seg, plen);
     }
     flags |= ENC_FLAG_SEQ;
 
@@ -264,7 +345,7 @@ bool Active::send_data(
             if ( !seg )
                 return false;
 
-            s_send(p->pkth, !(flags & ENC_FLAG_FWD), seg, plen);
+            queue_response(p->pkth, !(flags & ENC_FLAG_FWD), seg, plen);
 
             buf += toSend;
             sent += toSend;
@@ -278,7 +359,7 @@ bool Active::send_data(
     if ( !seg )
         return false;
 
-    s_send(p->pkth, !(flags & ENC_FLAG_FWD), seg, plen);
+    queue_response(p->pkth, !(flags & ENC_FLAG_FWD), seg, plen);
 
 
     if (flags & ENC_FLAG_RST_CLNT)
@@ -289,7 +370,7 @@ bool Active::send_data(
         seg = PacketManager::encode_response(TcpResponse::RST, flags, p, plen);
 
         if ( seg )
-            s_send(p->pkth, !(flags & ENC_FLAG_FWD), seg, plen);
+            queue_response(p->pkth, !(flags & ENC_FLAG_FWD), seg, plen);
     }
 
     return true;
@@ -311,7 +392,7 @@ void Active::inject_data(
     if ( !seg )
         return;
 
-    s_send(p->pkth, !(flags & ENC_FLAG_FWD), seg, plen);
+    queue_response(p->pkth, !(flags & ENC_FLAG_FWD), seg, plen);
 }
 
 //--------------------------------------------------------------------
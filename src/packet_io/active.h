@@ -53,6 +53,12 @@ public:
 
     static void kill_session(Packet*, EncodeFlags = ENC_FLAG_FWD);
 
+    // inject any queued responses
+    static void flush();
+
+    // flush and restart the per burst response limit
+    static void end_burst();
+
     static void send_reset(Packet*, EncodeFlags);
     static void send_unreach(Packet*, UnreachResponse);
     static bool send_data(Packet*, EncodeFlags, const uint8_t* buf, uint32_t len);
@@ -0,0 +1,601 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// flow_hash.cc
+
+#include "flow_hash.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <daq.h>
+#include <sfbpf_dlt.h>
+
+#include "packet_io/sfdaq.h"
+#include "protocols/protocol_ids.h"
+#include "protocols/teredo.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+//-------------------------------------------------------------------------
+// pre-decode
+//-------------------------------------------------------------------------
+
+// not in ProtocolId since no codec decodes it
+static constexpr uint16_t ETHERTYPE_8021AD = 0x88a8;
+
+// the default udp ports of the gtp and teredo codecs
+static constexpr uint16_t GTP_U_PORT = 2152;
+static constexpr uint16_t GTP_V0_PORT = 3386;
+
+// bounds the number of headers followed, including vlan tags and mpls
+// labels, so a crafted packet can't keep us busy
+static constexpr unsigned MAX_LAYERS = 32;
+
+namespace
+{
+struct FlowKey
+{
+    const uint8_t* src;
+    const uint8_t* dst;
+    const uint8_t* ports;  // null when not hashed
+    unsigned alen;
+    uint8_t proto;
+};
+
+class PreDecoder
+{
+public:
+    PreDecoder(const uint8_t* pkt, unsigned len) : end(pkt + len)
+    { key.src = nullptr; }
+
+    bool decode(int dlt, const uint8_t*);
+
+    FlowKey key;
+
+private:
+    bool eth(const uint8_t*);
+    bool ether_type(uint16_t, const uint8_t*);
+    bool mpls(const uint8_t*);
+    bool ip4(const uint8_t*);
+    bool ip6(const uint8_t*);
+    bool ip_next(uint8_t proto, const uint8_t*);
+    bool gre(const uint8_t*);
+    bool udp(const uint8_t*);
+    bool gtp(const uint8_t*);
+    bool teredo(const uint8_t*);
+    bool inner_ip(const uint8_t*);
+
+    bool fits(const uint8_t* p, unsigned n)
+    { return p <= end and (unsigned)(end - p) >= n; }
+
+    bool more()
+    { return ++layers <= MAX_LAYERS; }
+
+private:
+    const uint8_t* end;
+    unsigned layers = 0;
+};
+}
+
+// each step returns true if it got as far as an ip header.  the key is
+// overwritten by each ip header found so it ends up with the innermost.
+bool PreDecoder::decode(int dlt, const uint8_t* p)
+{
+    if ( dlt == DLT_EN10MB )
+        return eth(p);
+
+    if ( dlt == DLT_RAW )
+        return inner_ip(p);
+
+    return false;
+}
+
+bool PreDecoder::eth(const uint8_t* p)
+{
+    if ( !fits(p, 14) )
+        return false;
+
+    return ether_type((p[12] << 8) | p[13], p + 14);
+}
+
+bool PreDecoder::ether_type(uint16_t type, const uint8_t* p)
+{
+    if ( !more() )
+        return false;
+
+    switch ( type )
+    {
+    case to_utype(ProtocolId::ETHERTYPE_IPV4):
+        return ip4(p);
+
+    case to_utype(ProtocolId::ETHERTYPE_IPV6):
+        return ip6(p);
+
+    case to_utype(ProtocolId::ETHERTYPE_8021Q):
+    case ETHERTYPE_8021AD:
+        if ( !fits(p, 4) )
+            return false;
+        return ether_type((p[2] << 8) | p[3], p + 4);
+
+    case to_utype(ProtocolId::ETHERTYPE_MPLS_UNICAST):
+    case to_utype(ProtocolId::ETHERTYPE_MPLS_MULTICAST):
+        return mpls(p);
+
+    case to_utype(ProtocolId::ETHERTYPE_TRANS_ETHER_BRIDGING):
+        return eth(p);
+
+    case to_utype(ProtocolId::ETHERTYPE_ERSPAN_TYPE2):
+        // version 1 header
+        return fits(p, 8) and (p[0] >> 4) == 1 and eth(p + 8);
+
+    case to_utype(ProtocolId::ETHERTYPE_ERSPAN_TYPE3):
+        // same header size as the erspan3 codec
+        return fits(p, 20) and (p[0] >> 4) == 2 and eth(p + 20);
+    }
+    return false;
+}
+
+// the payload type isn't in the label stack so guess from the first
+// nibble like the mpls codec does by default
+bool PreDecoder::mpls(const uint8_t* p)
+{
+    do
+    {
+        if ( !fits(p, 4) or !more() )
+            return false;
+        p += 4;
+    }
+    while ( !(p[-2] & 0x01) );  // bottom of stack
+
+    return inner_ip(p);
+}
+
+bool PreDecoder::inner_ip(const uint8_t* p)
+{
+    if ( !fits(p, 1) )
+        return false;
+
+    if ( (p[0] >> 4) == 4 )
+        return ip4(p);
+
+    if ( (p[0] >> 4) == 6 )
+        return ip6(p);
+
+    return false;
+}
+
+bool PreDecoder::ip4(const uint8_t* p)
+{
+    if ( !fits(p, 20) or (p[0] >> 4) != 4 )
+        return false;
+
+    unsigned hlen = (p[0] & 0xf) * 4;
+
+    if ( hlen < 20 or !fits(p, hlen) )
+        return false;
+
+    key.src = p + 12;
+    key.dst = p + 16;
+    key.alen = 4;
+    key.proto = p[9];
+    key.ports = nullptr;
+
+    // only the first fragment has the next header
+    if ( (p[6] & 0x3f) or p[7] )
+        return true;
+
+    ip_next(p[9], p + hlen);
+    return true;
+}
+
+bool PreDecoder::ip6(const uint8_t* p)
+{
+    if ( !fits(p, 40) or (p[0] >> 4) != 6 )
+        return false;
+
+    key.src = p + 8;
+    key.dst = p + 24;
+    key.alen = 16;
+    key.proto = p[6];
+    key.ports = nullptr;
+
+    uint8_t next = p[6];
+    p += 40;
+
+    while ( more() )
+    {
+        switch ( next )
+        {
+        case to_utype(IpProtocol::HOPOPTS):
+        case to_utype(IpProtocol::ROUTING):
+        case to_utype(IpProtocol::DSTOPTS):
+            if ( !fits(p, 8) )
+                return true;
+            next = p[0];
+            p += (p[1] + 1) * 8;
+            break;
+
+        case to_utype(IpProtocol::FRAGMENT):
+            key.proto = next;
+            return true;
+
+        default:
+            key.proto = next;
+            ip_next(next, p);
+            return true;
+        }
+    }
+    return true;
+}
+
+// the caller already has an ip header in the key so a bad inner header
+// just leaves the outer one in place
+bool PreDecoder::ip_next(uint8_t proto, const uint8_t* p)
+{
+    if ( !more() )
+        return false;
+
+    switch ( proto )
+    {
+    case to_utype(IpProtocol::TCP):
+        if ( fits(p, 4) )
+            key.ports = p;
+        return true;
+
+    case to_utype(IpProtocol::UDP):
+        return udp(p);
+
+    case to_utype(IpProtocol::IPIP):
+        return ip4(p);
+
+    case to_utype(IpProtocol::IPV6):
+        return ip6(p);
+
+    case to_utype(IpProtocol::GRE):
+        return gre(p);
+
+    case 132:  // sctp
+        if ( fits(p, 4) )
+            key.ports = p;
+        return true;
+    }
+    return true;
+}
+
+bool PreDecoder::udp(const uint8_t* p)
+{
+    if ( !fits(p, 8) )
+        return true;
+
+    key.ports = p;
+
+    uint16_t sp = (p[0] << 8) | p[1];
+    uint16_t dp = (p[2] << 8) | p[3];
+
+    // a tunnel only replaces the key if an inner ip header is found
+    FlowKey outer = key;
+    bool inner = false;
+
+    if ( sp == GTP_U_PORT or dp == GTP_U_PORT or sp == GTP_V0_PORT or dp == GTP_V0_PORT )
+        inner = gtp(p + 8);
+
+    else if ( teredo::is_teredo_port(sp) or teredo::is_teredo_port(dp) )
+        inner = teredo(p + 8);
+
+    if ( !inner )
+        key = outer;
+
+    return true;
+}
+
+// only g-pdus (message type 255) carry user traffic
+bool PreDecoder::gtp(const uint8_t* p)
+{
+    if ( !fits(p, 8) or p[1] != 0xff )
+        return false;
+
+    switch ( p[0] >> 5 )
+    {
+    case 0:
+        return fits(p, 20) and inner_ip(p + 20);
+
+    case 1:
+        break;
+
+    default:
+        return false;
+    }
+
+    if ( !(p[0] & 0x07) )
+        return inner_ip(p + 8);
+
+    // sequence, n-pdu and next extension type follow when any flag is set
+    if ( !fits(p, 12) )
+        return false;
+
+    uint8_t next = p[11];
+    p += 12;
+
+    while ( next )
+    {
+        if ( !fits(p, 4) or !p[0] or !more() )
+            return false;
+
+        unsigned len = p[0] * 4;
+
+        if ( !fits(p, len) )
+            return false;
+
+        next = p[len - 1];
+        p += len;
+    }
+    return inner_ip(p);
+}
+
+// skip the optional authentication and origin indicators
+bool PreDecoder::teredo(const uint8_t* p)
+{
+    if ( fits(p, 4) and p[0] == 0 and p[1] == teredo::INDICATOR_AUTH )
+    {
+        // id and auth lengths, id, auth, 8 byte nonce, confirmation byte
+        unsigned len = 4 + p[2] + p[3] + 9;
+
+        if ( !fits(p, len) )
+            return false;
+        p += len;
+    }
+    if ( fits(p, 2) and p[0] == 0 and p[1] == teredo::INDICATOR_ORIGIN )
+        p += teredo::INDICATOR_ORIGIN_LEN;
+
+    return ip6(p);
+}
+
+bool PreDecoder::gre(const uint8_t* p)
+{
+    FlowKey outer = key;
+
+    if ( !fits(p, 4) )
+        return true;
+
+    // version 0 without routing; pptp is left with the outer header
+    if ( (p[0] & 0x40) or (p[1] & 0x07) )
+        return true;
+
+    unsigned len = 4;
+
+    if ( p[0] & 0x80 )  // checksum
+        len += 4;
+
+    if ( p[0] & 0x20 )  // key
+        len += 4;
+
+    if ( p[0] & 0x10 )  // sequence
+        len += 4;
+
+    if ( !fits(p, len) or !ether_type((p[2] << 8) | p[3], p + len) )
+        key = outer;
+
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// hash
+//-------------------------------------------------------------------------
+
+static inline uint32_t hash_bytes(uint32_t h, const uint8_t* p, unsigned n)
+{
+    // FNV-1a
+    while ( n-- )
+        h = (h ^ *p++) * 16777619;
+
+    return h;
+}
+
+// hash each endpoint separately so both directions of a flow get the
+// same value
+bool get_flow_hash(int dlt, const uint8_t* pkt, unsigned len, uint32_t& hash)
+{
+    PreDecoder pd(pkt, len);
+    pd.decode(dlt, pkt);
+
+    const FlowKey& key = pd.key;
+
+    if ( !key.src )
+        return false;
+
+    uint32_t a = hash_bytes(2166136261, key.src, key.alen);
+    uint32_t b = hash_bytes(2166136261, key.dst, key.alen);
+
+    if ( key.ports )
+    {
+        a = hash_bytes(a, key.ports, 2);
+        b = hash_bytes(b, key.ports + 2, 2);
+    }
+
+    // fmix32 from murmur3 so the low bits are usable for the modulus
+    hash = (a ^ b) + key.proto;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+
+    return true;
+}
+
+bool get_flow_hash(const DAQ_PktHdr_t* pkth, const uint8_t* pkt, uint32_t& hash)
+{ return get_flow_hash(SFDAQ::get_base_protocol(), pkt, pkth->caplen, hash); }
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+static void append(Bytes& b, std::initializer_list<uint8_t> l)
+{ b.insert(b.end(), l); }
+
+static Bytes eth_hdr(uint16_t type)
+{
+    Bytes b(12, 0);
+    append(b, { (uint8_t)(type >> 8), (uint8_t)type });
+    return b;
+}
+
+static void ip4_hdr(Bytes& b, uint8_t proto, uint8_t src, uint8_t dst)
+{
+    append(b, { 0x45, 0, 0, 0, 0, 0, 0, 0, 64, proto, 0, 0 });
+    append(b, { 10, 0, 0, src, 10, 0, 0, dst });
+}
+
+static void udp_hdr(Bytes& b, uint16_t sp, uint16_t dp)
+{
+    append(b, { (uint8_t)(sp >> 8), (uint8_t)sp, (uint8_t)(dp >> 8), (uint8_t)dp, 0, 0, 0, 0 });
+}
+
+static uint32_t hash_of(const Bytes& b, int dlt = DLT_EN10MB)
+{
+    uint32_t h = 0;
+    CHECK(get_flow_hash(dlt, b.data(), b.size(), h));
+    return h;
+}
+
+// outer 1.1 -> 1.2 udp tunnel carrying 10.0.0.src:sp -> 10.0.0.dst:dp
+static Bytes gtp_pkt(uint8_t src, uint8_t dst, uint16_t sp, uint16_t dp, bool flags = false)
+{
+    Bytes b = eth_hdr(0x0800);
+    ip4_hdr(b, 17, 1, 2);
+    udp_hdr(b, 40000, GTP_U_PORT);
+
+    if ( flags )
+        append(b, { 0x32, 0xff, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0x85, 1, 0, 0, 0 });
+    else
+        append(b, { 0x30, 0xff, 0, 0, 0, 0, 0, 1 });
+
+    ip4_hdr(b, 6, src, dst);
+    udp_hdr(b, sp, dp);  // tcp ports are in the same place
+    return b;
+}
+
+TEST_CASE("flow hash symmetric", "[flow_hash]")
+{
+    Bytes ab = eth_hdr(0x0800);
+    ip4_hdr(ab, 6, 1, 2);
+    udp_hdr(ab, 1234, 80);
+
+    Bytes ba = eth_hdr(0x0800);
+    ip4_hdr(ba, 6, 2, 1);
+    udp_hdr(ba, 80, 1234);
+
+    CHECK(hash_of(ab) == hash_of(ba));
+
+    Bytes raw(ab.begin() + 14, ab.end());
+    CHECK(hash_of(raw, DLT_RAW) == hash_of(ab));
+}
+
+TEST_CASE("flow hash gtp", "[flow_hash]")
+{
+    // same tunnel, different inner flows
+    CHECK(hash_of(gtp_pkt(3, 4, 1000, 80)) != hash_of(gtp_pkt(5, 6, 1000, 80)));
+    CHECK(hash_of(gtp_pkt(3, 4, 1000, 80)) == hash_of(gtp_pkt(4, 3, 80, 1000)));
+    CHECK(hash_of(gtp_pkt(3, 4, 1000, 80, true)) == hash_of(gtp_pkt(3, 4, 1000, 80)));
+
+    // the inner flow without the tunnel
+    Bytes b = eth_hdr(0x0800);
+    ip4_hdr(b, 6, 3, 4);
+    udp_hdr(b, 1000, 80);
+    CHECK(hash_of(b) == hash_of(gtp_pkt(3, 4, 1000, 80)));
+
+    // truncated inner header falls back to the outer
+    Bytes t = gtp_pkt(3, 4, 1000, 80);
+    t.resize(t.size() - 20);
+
+    Bytes o = eth_hdr(0x0800);
+    ip4_hdr(o, 17, 1, 2);
+    udp_hdr(o, 40000, GTP_U_PORT);
+    CHECK(hash_of(t) == hash_of(o));
+}
+
+TEST_CASE("flow hash gre erspan mpls vlan", "[flow_hash]")
+{
+    Bytes inner;
+    ip4_hdr(inner, 17, 7, 8);
+    udp_hdr(inner, 53, 5353);
+
+    Bytes plain = eth_hdr(0x0800);
+    plain.insert(plain.end(), inner.begin(), inner.end());
+    uint32_t h = hash_of(plain);
+
+    Bytes gre = eth_hdr(0x0800);
+    ip4_hdr(gre, 47, 1, 2);
+    append(gre, { 0x20, 0, 0x08, 0, 0, 0, 0, 9 });  // key
+    gre.insert(gre.end(), inner.begin(), inner.end());
+    CHECK(hash_of(gre) == h);
+
+    Bytes span = eth_hdr(0x0800);
+    ip4_hdr(span, 47, 1, 2);
+    append(span, { 0x10, 0, 0x88, 0xbe, 0, 0, 0, 1 });  // sequence
+    append(span, { 0x10, 0, 0, 1, 0, 0, 0, 0 });
+    span.insert(span.end(), plain.begin(), plain.end());
+    CHECK(hash_of(span) == h);
+
+    Bytes mpls = eth_hdr(0x8100);
+    append(mpls, { 0, 5, 0x88, 0x47 });
+    append(mpls, { 0, 1, 0, 64, 0, 2, 1, 64 });
+    mpls.insert(mpls.end(), inner.begin(), inner.end());
+    CHECK(hash_of(mpls) == h);
+}
+
+TEST_CASE("flow hash ip6 and teredo", "[flow_hash]")
+{
+    Bytes ip6 = { 0x60, 0, 0, 0, 0, 8, 17, 64 };
+    for ( unsigned i = 0; i < 32; ++i )
+        ip6.push_back(i);
+    udp_hdr(ip6, 1111, 2222);
+
+    Bytes plain = eth_hdr(0x86dd);
+    plain.insert(plain.end(), ip6.begin(), ip6.end());
+    uint32_t h = hash_of(plain);
+
+    Bytes ter = eth_hdr(0x0800);
+    ip4_hdr(ter, 17, 1, 2);
+    udp_hdr(ter, 3544, 50000);
+    append(ter, { 0, 0, 1, 2, 3, 4, 5, 6 });  // origin indicator
+    ter.insert(ter.end(), ip6.begin(), ip6.end());
+    CHECK(hash_of(ter) == h);
+
+    Bytes frag = eth_hdr(0x86dd);
+    frag.insert(frag.end(), ip6.begin(), ip6.begin() + 40);
+    frag[14 + 6] = 44;
+    append(frag, { 17, 0, 0, 1, 0, 0, 0, 1 });
+    CHECK(hash_of(frag) != h);
+
+    uint32_t x;
+    Bytes arp = eth_hdr(0x0806);
+    CHECK(!get_flow_hash(DLT_EN10MB, arp.data(), arp.size(), x));
+}
+
+#endif
+
@@ -0,0 +1,41 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// flow_hash.h
+
+#ifndef FLOW_HASH_H
+#define FLOW_HASH_H
+
+// symmetric flow hash for spreading packets over threads ahead of decode.
+// a minimal pre-decode follows vlan, mpls, gre, erspan, ip in ip, gtp-u
+// and teredo down to the innermost ip header so tunneled flows aren't all
+// hashed by their tunnel endpoints.  if an inner header is truncated or
+// unrecognized the last good ip header is used instead.
+
+#include <cstdint>
+
+struct _daq_pkthdr;
+
+// same value for both directions of a flow; false if the packet
+// couldn't be placed in a flow.  fragments are hashed without ports.
+bool get_flow_hash(int dlt, const uint8_t* pkt, unsigned len, uint32_t& hash);
+
+// uses the base protocol of the local DAQ instance
+bool get_flow_hash(const _daq_pkthdr*, const uint8_t*, uint32_t& hash);
+
+#endif
+
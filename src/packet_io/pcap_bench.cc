@@ -0,0 +1,337 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// pcap_bench.cc
+
+#include "pcap_bench.h"
+
+#include <pcap.h>
+#include <string.h>
+
+#include <mutex>
+
+#include "log/messages.h"
+#include "main/snort_config.h"
+#include "main/thread.h"
+#include "main/thread_config.h"
+#include "packet_io/flow_hash.h"
+#include "packet_io/sfdaq.h"
+#include "packet_io/trough.h"
+#include "profiler/profiler.h"
+#include "time/clock_defs.h"
+#include "utils/stats.h"
+
+using namespace std::chrono;
+
+// split mode only; filled before any packet thread starts
+static std::vector<std::string> s_sources;
+
+// totals by packet thread; a thread may replay several pcaps in turn
+struct BenchTotals
+{
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    steady_clock::duration elapsed = steady_clock::duration::zero();
+};
+
+static std::mutex s_stats_mutex;
+static std::vector<BenchTotals> s_totals;
+
+//-------------------------------------------------------------------------
+// packet thread
+//-------------------------------------------------------------------------
+
+PcapBench::PcapBench(const char* s) : source(s)
+{
+    span = shift = 0;
+    next = 0;
+    loaded = false;
+    packets = bytes = 0;
+}
+
+bool PcapBench::load(const char* file, unsigned id, unsigned max)
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    pcap_t* pcap = pcap_open_offline(file, errbuf);
+
+    if ( !pcap )
+    {
+        ErrorMessage("pcap bench: can't open %s: %s\n", file, errbuf);
+        return false;
+    }
+
+    if ( pcap_datalink(pcap) != SFDAQ::get_base_protocol() )
+    {
+        ErrorMessage("pcap bench: %s doesn't have the same link type as %s\n",
+            file, source.c_str());
+        pcap_close(pcap);
+        return false;
+    }
+
+    struct pcap_pkthdr* ph;
+    const u_char* pkt;
+    unsigned unhashed = 0;
+    int ret;
+
+    while ( (ret = pcap_next_ex(pcap, &ph, &pkt)) == 1 )
+    {
+        Record r;
+        memset(&r.hdr, 0, sizeof(r.hdr));
+
+        r.hdr.ts = ph->ts;
+        r.hdr.caplen = ph->caplen;
+        r.hdr.pktlen = ph->len;
+        r.hdr.ingress_index = r.hdr.egress_index = DAQ_PKTHDR_UNKNOWN;
+        r.hdr.ingress_group = r.hdr.egress_group = DAQ_PKTHDR_UNKNOWN;
+
+        if ( max > 1 )
+        {
+            uint32_t hash;
+
+            // packets that can't be placed in a flow are dealt round robin
+            if ( !get_flow_hash(&r.hdr, pkt, hash) )
+                hash = unhashed++;
+
+            if ( hash % max != id )
+                continue;
+        }
+        r.offset = data.size();
+        data.insert(data.end(), pkt, pkt + ph->caplen);
+        pkts.push_back(r);
+
+        if ( ph->caplen > scratch.size() )
+            scratch.resize(ph->caplen);
+    }
+
+    if ( ret == -1 )
+        ErrorMessage("pcap bench: can't read %s: %s\n", file, pcap_geterr(pcap));
+
+    pcap_close(pcap);
+    return ret != -1;
+}
+
+bool PcapBench::load()
+{
+    loaded = true;
+
+    if ( s_sources.empty() )
+    {
+        if ( !load(source.c_str(), 0, 1) )
+            return false;
+    }
+    else
+    {
+        unsigned id = get_instance_id();
+        unsigned max = ThreadConfig::get_instance_max();
+
+        for ( const auto& s : s_sources )
+            if ( !load(s.c_str(), id, max) )
+                return false;
+    }
+
+    if ( pkts.empty() )
+    {
+        ErrorMessage("pcap bench: no packets to replay from %s\n", source.c_str());
+        return false;
+    }
+
+    time_t lo = pkts[0].hdr.ts.tv_sec, hi = lo;
+
+    for ( const auto& r : pkts )
+    {
+        if ( r.hdr.ts.tv_sec < lo )
+            lo = r.hdr.ts.tv_sec;
+
+        else if ( r.hdr.ts.tv_sec > hi )
+            hi = r.hdr.ts.tv_sec;
+    }
+    span = hi - lo + 1;
+
+    LogMessage("pcap bench: replaying %zu packets (%zu bytes) from memory for %u seconds\n",
+        pkts.size(), data.size(), snort_conf->pcap_bench);
+
+    start = end = steady_clock::now();
+    deadline = start + seconds(snort_conf->pcap_bench);
+    return true;
+}
+
+int PcapBench::replay(unsigned burst, DAQ_Analysis_Func_t callback)
+{
+    if ( !loaded and !load() )
+        return -1;
+
+    if ( !burst )
+        burst = 256;
+
+    for ( unsigned i = 0; i < burst; ++i )
+    {
+        const Record& r = pkts[next];
+        DAQ_PktHdr_t hdr = r.hdr;
+
+        hdr.ts.tv_sec += shift;
+        memcpy(scratch.data(), data.data() + r.offset, hdr.caplen);
+
+        callback(nullptr, &hdr, scratch.data());
+
+        packets++;
+        bytes += hdr.pktlen;
+
+        if ( ++next == pkts.size() )
+        {
+            next = 0;
+            shift += span;
+        }
+    }
+    end = steady_clock::now();
+    return end >= deadline;
+}
+
+void PcapBench::term()
+{
+    if ( !packets )
+        return;
+
+    std::lock_guard<std::mutex> lock(s_stats_mutex);
+
+    unsigned id = get_instance_id();
+
+    if ( id >= s_totals.size() )
+        s_totals.resize(id + 1);
+
+    BenchTotals& bt = s_totals[id];
+    bt.packets += packets;
+    bt.bytes += bytes;
+    bt.elapsed += end - start;
+}
+
+//-------------------------------------------------------------------------
+// main thread
+//-------------------------------------------------------------------------
+
+const char* PcapBench::get_split_source()
+{
+    if ( !snort_conf->pcap_bench or !snort_conf->pcap_bench_split )
+        return nullptr;
+
+    if ( s_sources.empty() )
+    {
+        while ( const char* s = Trough::get_next() )
+            s_sources.push_back(s);
+
+        if ( s_sources.empty() )
+            return nullptr;
+    }
+    return s_sources[0].c_str();
+}
+
+// these are inclusive so time spent on rebuilt packets inside stream is
+// also counted under detection.  inspectors is whatever is left of total.
+static const char* stream_nodes[] =
+{
+    "stream_tcp", "stream_udp", "stream_ip", "stream_icmp", "stream_user", "stream_file"
+};
+
+static hr_duration get_elapsed(const char* name)
+{
+    const ProfileStats* ps = Profiler::get_stats(name);
+    return ps ? ps->time.elapsed : 0_ticks;
+}
+
+static void show_stage(const char* name, hr_duration t, uint64_t pkts, hr_duration total)
+{
+    if ( t < 0_ticks )
+        t = 0_ticks;
+
+    double ns = (double)t.count() / pkts;
+    double pct = 100.0 * t.count() / total.count();
+
+    if ( double cpn = TscClock::cycles_per_ns() )
+        LogMessage("%25.25s: %10.1f ns/pkt %10.1f cycles/pkt %7.3f%%\n",
+            name, ns, ns * cpn, pct);
+    else
+        LogMessage("%25.25s: %10.1f ns/pkt %7.3f%%\n", name, ns, pct);
+}
+
+static void show_stages()
+{
+    const ProfileStats* ps = Profiler::get_stats("total");
+
+    // profiler sampling means there may be fewer timed packets than replayed
+    if ( !ps or !ps->time.checks or ps->time.elapsed <= 0_ticks )
+        return;
+
+    hr_duration total = ps->time.elapsed;
+    uint64_t pkts = ps->time.checks;
+
+    hr_duration stream = 0_ticks;
+
+    for ( auto s : stream_nodes )
+        stream += get_elapsed(s);
+
+    hr_duration flow = get_elapsed("stream") - stream;
+    hr_duration decode = get_elapsed("decode");
+    hr_duration detect = get_elapsed("detect");
+    hr_duration logging = get_elapsed("eventq");
+    hr_duration inspect = total - decode - flow - stream - detect - logging;
+
+    LogLabel(" stages");
+    show_stage("decode", decode, pkts, total);
+    show_stage("flow", flow, pkts, total);
+    show_stage("stream", stream, pkts, total);
+    show_stage("inspectors", inspect, pkts, total);
+    show_stage("detection", detect, pkts, total);
+    show_stage("logging", logging, pkts, total);
+    show_stage("total", total, pkts, total);
+}
+
+// threads run concurrently so their rates add up
+void PcapBench::show_stats()
+{
+    uint64_t packets = 0, bytes = 0;
+    double secs = 0.0, pps = 0.0, bps = 0.0;
+    unsigned threads = 0;
+
+    for ( const auto& bt : s_totals )
+    {
+        double t = duration_cast<duration<double>>(bt.elapsed).count();
+
+        if ( !bt.packets or t <= 0.0 )
+            continue;
+
+        threads++;
+        packets += bt.packets;
+        bytes += bt.bytes;
+        pps += bt.packets / t;
+        bps += 8.0 * bt.bytes / t;
+
+        if ( t > secs )
+            secs = t;
+    }
+
+    if ( !threads )
+        return;
+
+    LogLabel("pcap bench");
+    LogMessage("%25.25s: %.3f\n", "seconds", secs);
+    LogMessage("%25.25s: %u\n", "threads", threads);
+    LogCount("packets", packets);
+    LogCount("bytes", bytes);
+    LogMessage("%25.25s: %.0f\n", "pkts/sec", pps);
+    LogMessage("%25.25s: %.3f\n", "Gbits/sec", bps / 1.0e9);
+
+    show_stages();
+}
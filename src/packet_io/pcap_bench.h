@@ -0,0 +1,86 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// pcap_bench.h
+
+#ifndef PCAP_BENCH_H
+#define PCAP_BENCH_H
+
+// PcapBench replays pcaps from memory at full speed for --pcap-bench
+// seconds so throughput can be measured without disk or DAQ overhead.
+// Each packet thread loads its source after its DAQ instance is started
+// and before the clock starts.  With --pcap-bench-split every thread loads
+// all the pcaps and keeps just the flows that hash to it.
+//
+// Timestamps are shifted forward by the capture span on every lap so
+// timeouts see the traffic repeat rather than go back in time.
+
+#include <daq.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+class PcapBench
+{
+public:
+    PcapBench(const char* source);
+
+    // packet thread; like SFDAQInstance::acquire(), returns nonzero when
+    // done, either because the duration is up or the load failed
+    int replay(unsigned burst, DAQ_Analysis_Func_t);
+
+    // packet thread; adds this thread's totals to the report
+    void term();
+
+    // main thread; null unless splitting.  otherwise the trough is drained
+    // into the list every thread loads and the first is returned to prep
+    // all the pigs with.
+    static const char* get_split_source();
+
+    static void show_stats();
+
+private:
+    struct Record
+    {
+        DAQ_PktHdr_t hdr;
+        size_t offset;
+    };
+
+    bool load();
+    bool load(const char* file, unsigned id, unsigned max);
+
+private:
+    std::string source;
+    std::vector<Record> pkts;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> scratch;  // snort may rewrite the packet
+
+    time_t span;   // capture span in seconds, rounded up
+    time_t shift;  // added to timestamps on the current lap
+
+    size_t next;
+    bool loaded;
+
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point deadline;
+    std::chrono::steady_clock::time_point end;
+    uint64_t packets;
+    uint64_t bytes;
+};
+
+#endif
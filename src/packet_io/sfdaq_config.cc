@@ -70,6 +70,7 @@ SFDAQConfig::SFDAQConfig()
 {
     mru_size = -1;
     timeout = DEFAULT_PKT_TIMEOUT;
+    burst_size = 0;
 }
 
 SFDAQConfig::~SFDAQConfig()
@@ -121,6 +122,11 @@ void SFDAQConfig::set_mru_size(int mru_size_value)
     mru_size = mru_size_value;
 }
 
+void SFDAQConfig::set_burst_size(unsigned burst_size_value)
+{
+    burst_size = burst_size_value;
+}
+
 void SFDAQConfig::set_variable(const char* varkvp, int instance_id)
 {
     if (instance_id >= 0)
@@ -159,6 +165,9 @@ void SFDAQConfig::overlay(const SFDAQConfig* other)
     if (other->mru_size != -1)
         mru_size = other->mru_size;
 
+    if (other->burst_size)
+        burst_size = other->burst_size;
+
     for (auto oit = other->instances.begin(); oit != other->instances.end(); oit++)
     {
         SFDAQInstanceConfig* oic = oit->second;
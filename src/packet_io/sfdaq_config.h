@@ -47,6 +47,7 @@ struct SFDAQConfig
     void set_input_spec(const char*, int instance_id = -1);
     void set_module_name(const char*);
     void set_mru_size(int);
+    void set_burst_size(unsigned);
     void set_variable(const char* varkvp, int instance_id = -1);
 
     void overlay(const SFDAQConfig*);
@@ -59,6 +60,7 @@ struct SFDAQConfig
     std::vector<std::pair<std::string, std::string>> variables;
     int mru_size;
     unsigned int timeout;
+    unsigned int burst_size;
     std::unordered_map<unsigned, SFDAQInstanceConfig*> instances;
 };
 
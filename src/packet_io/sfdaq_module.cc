@@ -58,6 +58,7 @@ static const Parameter s_params[] =
     { "instances", Parameter::PT_LIST, instance_params, nullptr, "DAQ instance overrides" },
     { "snaplen", Parameter::PT_INT, "0:65535", nullptr, "set snap length (same as -s)" },
     { "no_promisc", Parameter::PT_BOOL, nullptr, "false", "whether to put DAQ device into promiscuous mode" },
+    { "burst", Parameter::PT_INT, "0:", "0", "maximum packets per acquire call; 0 is unlimited" },
 
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
@@ -113,6 +114,10 @@ bool SFDAQModule::set(const char* fqn, Value& v, SnortConfig* sc)
     {
         v.update_mask(sc->run_flags, RUN_FLAG__NO_PROMISCUOUS);
     }
+    else if (!strcmp(fqn, "daq.burst"))
+    {
+        config->set_burst_size(v.get_long());
+    }
     else if (!strcmp(fqn, "daq.instances.id"))
     {
         instance_id = v.get_long();
@@ -56,6 +56,9 @@ TEST_CASE("Kitchen Sink", "[SFDAQModule]")
     Value no_promisc(true);
     CHECK(sfdm.set("daq.no_promisc", no_promisc, &sc));
 
+    Value burst(static_cast<double>(32));
+    CHECK(sfdm.set("daq.burst", burst, &sc));
+
     CHECK(sfdm.begin("daq.instances", 1, &sc));
     CHECK_FALSE(sfdm.end("daq.instances", 1, &sc));
 
@@ -95,6 +98,7 @@ TEST_CASE("Kitchen Sink", "[SFDAQModule]")
     CHECK(cfg->variables[2].second == "world");
 
     CHECK(cfg->mru_size == 6666);
+    CHECK(cfg->burst_size == 32);
 
     REQUIRE(cfg->instances.size() == 1);
     for (auto it : cfg->instances)
@@ -133,6 +137,7 @@ TEST_CASE("Kitchen Sink", "[SFDAQModule]")
     CHECK(cfg->variables[0].first == "cli_global_variable");
     CHECK(cfg->variables[0].second == "abc");
     CHECK(cfg->mru_size == 3333);
+    CHECK(cfg->burst_size == 32);
     REQUIRE(cfg->instances.size() == 2);
     for (auto it : cfg->instances)
     {
@@ -20,7 +20,10 @@
 #include "trough.h"
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <fnmatch.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <fstream>
@@ -33,6 +36,7 @@ std::vector<std::string> Trough::pcap_queue;
 std::string Trough::pcap_filter;
 std::vector<std::string>::const_iterator Trough::pcap_queue_iter;
 long Trough::pcap_loop_count = 0;
+bool Trough::pcap_largest_first = false;
 unsigned Trough::file_count = 0;
 
 int Trough::get_pcaps(std::vector<struct PcapReadObject> &pol)
@@ -221,6 +225,9 @@ void Trough::setup()
         /* free pcap list used to get params */
         pcap_object_list.clear();
 
+        if (pcap_largest_first)
+            sort_by_size();
+
         pcap_queue_iter = pcap_queue.cbegin();
     }
     pcap_filter.clear();
@@ -232,6 +239,59 @@ void Trough::cleanup()
     pcap_queue.clear();
 }
 
+/* Files are handed to whichever analyzer frees up first so starting the
+    biggest ones first keeps a large file from being the last one standing. */
+void Trough::sort_by_size()
+{
+    std::vector<std::pair<off_t, std::string>> sized;
+    sized.reserve(pcap_queue.size());
+
+    for (const std::string& pcap : pcap_queue)
+    {
+        struct stat sb;
+        off_t size = 0;
+
+        if (stat(pcap.c_str(), &sb) == 0 && S_ISREG(sb.st_mode))
+            size = sb.st_size;
+
+        sized.push_back(std::make_pair(size, pcap));
+    }
+
+    std::stable_sort(sized.begin(), sized.end(),
+        [](const std::pair<off_t, std::string>& a, const std::pair<off_t, std::string>& b)
+        { return a.first > b.first; });
+
+    pcap_queue.clear();
+
+    for (auto& sp : sized)
+        pcap_queue.push_back(sp.second);
+}
+
+/* Ask the kernel to start reading the head of the next file while the
+    current one is processed.  Only regular files; opening a fifo here would
+    consume its writer. */
+#define PCAP_READAHEAD (16 * 1024 * 1024)
+
+void Trough::read_ahead(const std::string& pcap)
+{
+#ifdef POSIX_FADV_WILLNEED
+    struct stat sb;
+
+    if (stat(pcap.c_str(), &sb) != 0 || !S_ISREG(sb.st_mode))
+        return;
+
+    int fd = open(pcap.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        return;
+
+    posix_fadvise(fd, 0, PCAP_READAHEAD, POSIX_FADV_WILLNEED);
+    close(fd);
+#else
+    UNUSED(pcap);
+#endif
+}
+
 const char* Trough::get_next()
 {
     const char* pcap = NULL;
@@ -249,6 +309,9 @@ const char* Trough::get_next()
         pcap_queue_iter = pcap_queue.cbegin();
     }
 
+    if (pcap_queue_iter != pcap_queue.cend())
+        read_ahead(*pcap_queue_iter);
+
     file_count++;
     return pcap;
 }
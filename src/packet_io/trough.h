@@ -39,6 +39,10 @@ public:
     {
         pcap_loop_count = c;
     }
+    static void set_largest_first(bool b)
+    {
+        pcap_largest_first = b;
+    }
     static void set_filter(const char *f);
     static void add_source(SourceType type, const char *list);
     static void setup();
@@ -66,11 +70,14 @@ private:
     };
 
     static int get_pcaps(std::vector<struct PcapReadObject> &pol);
+    static void sort_by_size();
+    static void read_ahead(const std::string&);
     static std::vector<struct PcapReadObject> pcap_object_list;
     static std::vector<std::string> pcap_queue;
     static std::vector<std::string>::const_iterator pcap_queue_iter;
     static std::string pcap_filter;
     static long pcap_loop_count;
+    static bool pcap_largest_first;
     static unsigned file_count;
 };
 
@@ -118,28 +118,29 @@ void inc_parse_position()
     ++loc.line;
 }
 
-void parse_include(SnortConfig* sc, const char* arg)
+std::string get_include_path(const char* arg)
 {
     struct stat file_stat;  /* for include path testing */
-    char* fname = snort_strdup(arg);
+    std::string fname = arg;
 
     /* Stat the file.  If that fails, make it relative to the directory
      * that the top level snort configuration file was in */
-    if ( stat(fname, &file_stat) == -1 && fname[0] != '/' )
+    if ( stat(arg, &file_stat) == -1 && arg[0] != '/' )
     {
-        const char* snort_conf_dir = get_snort_conf_dir();
-
-        int path_len = strlen(snort_conf_dir) + strlen(arg) + 1;
-        snort_free(fname);
-
-        fname = (char*)snort_calloc(path_len);
-        snprintf(fname, path_len, "%s%s", snort_conf_dir, arg);
+        fname = get_snort_conf_dir();
+        fname += arg;
     }
+    return fname;
+}
+
+void parse_include(SnortConfig* sc, const char* arg)
+{
+    std::string path = get_include_path(arg);
+    const char* fname = path.c_str();
 
     push_parse_location(fname);
     ParseConfigFile(sc, fname);
     pop_parse_location();
-    snort_free((char*)fname);
 }
 
 void ParseIpVar(SnortConfig* sc, const char* var, const char* val)
@@ -280,15 +281,7 @@ void ParseConfigFile(SnortConfig* sc, const char* fname)
     if ( !fname )
         return;
 
-    std::ifstream fs(fname, std::ios_base::binary);
-
-    if ( !fs )
-    {
-        ParseError("unable to open rules file '%s': %s",
-            fname, get_error(errno));
-        return;
-    }
-    parse_stream(fs, sc);
+    parse_rule_file(fname, sc);
 }
 
 void ParseConfigString(SnortConfig* sc, const char* s)
@@ -20,6 +20,8 @@
 #ifndef PARSE_CONF_H
 #define PARSE_CONF_H
 
+#include <string>
+
 #include "detection/rules.h"
 
 void parse_conf_init();
@@ -33,6 +35,9 @@ void ParseConfigString(SnortConfig*, const char* str);
 
 void parse_include(SnortConfig*, const char*);
 
+// the include file name relative to the config dir if not found as is
+std::string get_include_path(const char*);
+
 void AddRuleState(SnortConfig*, const RuleState&);
 void add_service_to_otn(SnortConfig*, OptTreeNode*, const char*);
 
@@ -96,6 +96,7 @@ static int detect_rule_count = 0;
 static int builtin_rule_count = 0;
 static int so_rule_count = 0;
 static int head_count = 0;          /* number of header blocks (chain heads?) */
+static int shared_count = 0;        /* number of rules shared across policies */
 static int otn_count = 0;           /* number of chains */
 static int rule_proto = 0;
 
@@ -755,11 +756,11 @@ static int TestHeader(RuleTreeNode* rule, RuleTreeNode* rtn)
 
 /**returns matched header node.
 */
+// identical headers are shared by all policies.  the rtn holds only the
+// header; whether a rule is in a policy is given by its otn proto_nodes.
 static RuleTreeNode* findHeadNode(
-    SnortConfig* sc, RuleTreeNode* testNode,
-    PolicyId policyId)
+    SnortConfig* sc, RuleTreeNode* testNode)
 {
-    RuleTreeNode* rtn;
     OptTreeNode* otn;
     SFGHASH_NODE* hashNode;
 
@@ -768,10 +769,14 @@ static RuleTreeNode* findHeadNode(
         hashNode = sfghash_findnext(sc->otn_map))
     {
         otn = (OptTreeNode*)hashNode->data;
-        rtn = getRtnFromOtn(otn, policyId);
 
-        if (TestHeader(rtn, testNode))
-            return rtn;
+        for ( unsigned i = 0; i < otn->proto_node_num; ++i )
+        {
+            RuleTreeNode* rtn = otn->proto_nodes[i];
+
+            if (TestHeader(rtn, testNode))
+                return rtn;
+        }
     }
 
     return NULL;
@@ -1006,8 +1011,7 @@ static void SetupRTNFuncList(RuleTreeNode* rtn)
 static RuleTreeNode* ProcessHeadNode(
     SnortConfig* sc, RuleTreeNode* test_node, ListHead* list)
 {
-    RuleTreeNode* rtn = findHeadNode(
-        sc, test_node, get_ips_policy()->policy_id);
+    RuleTreeNode* rtn = findHeadNode(sc, test_node);
 
     /* if it doesn't match any of the existing nodes, make a new node and
      * stick it at the end of the list */
@@ -1040,6 +1044,67 @@ static RuleTreeNode* ProcessHeadNode(
     return rtn;
 }
 
+static bool same_string(const char* a, const char* b)
+{
+    if ( !a or !b )
+        return a == b;
+
+    return !strcmp(a, b);
+}
+
+// a rule repeated in another policy with the same revision, ports, and
+// options can keep the existing otn.  option data is deduplicated as it
+// is parsed so identical options have identical pointers.  the leaf node
+// is not yet appended to the new otn.
+static bool is_same_rule(
+    OptTreeNode* otn_cur, OptTreeNode* otn_new, RuleTreeNode* rtn_new)
+{
+    const SigInfo& a = otn_cur->sigInfo;
+    const SigInfo& b = otn_new->sigInfo;
+
+    if ( a.rev != b.rev or a.class_id != b.class_id or a.priority != b.priority
+        or a.num_services != b.num_services or !same_string(a.message, b.message) )
+        return false;
+
+    for ( unsigned i = 0; i < a.num_services; ++i )
+    {
+        if ( !same_string(a.services[i].service, b.services[i].service) )
+            return false;
+    }
+
+    if ( otn_cur->soid or otn_new->soid or otn_cur->agent or otn_new->agent
+        or otn_cur->detection_filter or otn_new->detection_filter
+        or otn_cur->tag or otn_new->tag or otn_cur->enabled != otn_new->enabled )
+        return false;
+
+    OptFpList* x = otn_cur->opt_func;
+    OptFpList* y = otn_new->opt_func;
+
+    while ( x and x->type != RULE_OPTION_TYPE_LEAF_NODE and y )
+    {
+        if ( x->ips_opt != y->ips_opt or x->OptTestFunc != y->OptTestFunc
+            or x->type != y->type or x->isRelative != y->isRelative )
+            return false;
+
+        x = x->next;
+        y = y->next;
+    }
+
+    if ( y or (x and x->type != RULE_OPTION_TYPE_LEAF_NODE) )
+        return false;
+
+    // the port tables only got the ports of the existing headers
+    for ( unsigned i = 0; i < otn_cur->proto_node_num; ++i )
+    {
+        RuleTreeNode* rtn = otn_cur->proto_nodes[i];
+
+        if ( rtn and rtn->src_portobject == rtn_new->src_portobject
+            and rtn->dst_portobject == rtn_new->dst_portobject )
+            return true;
+    }
+    return false;
+}
+
 /****************************************************************************
  *
  * Function: mergeDuplicateOtn()
@@ -1080,6 +1145,16 @@ static int mergeDuplicateOtn(
         return 0;
     }
 
+    if ( !rtn_cur and is_same_rule(otn_cur, otn_new, rtn_new) )
+    {
+        // same rule in another policy; share the otn and keep the rtn
+        deleteRtnFromOtn(otn_new);
+        OtnFree(otn_new);
+        addRtnToOtn(otn_cur, rtn_new);
+        shared_count++;
+        return 0;
+    }
+
     if ( otn_new->sigInfo.rev < otn_cur->sigInfo.rev )
     {
         //current OTN is newer version. Keep current and discard the new one.
@@ -1230,6 +1305,7 @@ void parse_rule_init()
     builtin_rule_count = 0;
     so_rule_count = 0;
     head_count = 0;
+    shared_count = 0;
     otn_count = 0;
     rule_proto = 0;
 
@@ -1255,6 +1331,7 @@ void parse_rule_print()
     LogCount("so rules", so_rule_count);
     LogCount("option chains", otn_count);
     LogCount("chain headers", head_count);
+    LogCount("shared rules", shared_count);
 
     unsigned ip = ipCnt.src + ipCnt.dst + ipCnt.any + ipCnt.both + ipCnt.nfp;
     unsigned icmp = icmpCnt.src + icmpCnt.dst + icmpCnt.any + icmpCnt.both + icmpCnt.nfp;
@@ -20,12 +20,21 @@
 #include "parse_stream.h"
 
 #include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <atomic>
+#include <fstream>
+#include <future>
 #include <istream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 using namespace std;
 
 #include "parser.h"
@@ -34,11 +43,9 @@ using namespace std;
 #include "detection/treenodes.h"
 #include "log/messages.h"
 #include "managers/ips_manager.h"
+#include "utils/util.h"
 
-static unsigned chars = 0, tokens = 0;
-static unsigned lines = 1, comments = 0;
-static unsigned keys = 0, rules = 0;
-static unsigned lists = 0, strings = 0;
+static unsigned tokens = 0, rules = 0;
 
 enum TokenType
 {
@@ -47,6 +54,7 @@ enum TokenType
     TT_STRING,
     TT_LIST,
     TT_LITERAL,
+    TT_WARNING,  // deferred lexer warning, text is the message
     TT_MAX
 };
 
@@ -54,7 +62,7 @@ enum TokenType
 #ifdef TRACER
 static const char* const toks[TT_MAX] =
 {
-    "none", "punct", "string", "list", "literal"
+    "none", "punct", "string", "list", "literal", "warning"
 };
 #endif
 
@@ -83,14 +91,63 @@ static uint8_t to_hex(char c)
         return 10 + c - 'a';
 }
 
-static TokenType get_token(
-    istream& is, string& s, const char* punct, int esc)
+//-------------------------------------------------------------------------
+// the lexer has no side effects so rule files can be tokenized on other
+// threads.  line counts and warnings are recorded with the tokens and
+// applied when the tokens are parsed.
+//-------------------------------------------------------------------------
+
+struct RuleToken
+{
+    TokenType type;
+    unsigned lines;  // parse position increments before this token
+    string text;
+};
+
+typedef vector<RuleToken> RuleTokens;
+
+class Lexer
+{
+public:
+    Lexer(istream& s, RuleTokens& v) : is(s), out(v) { }
+
+    TokenType get_token(string&, const char* punct, int esc);
+
+    unsigned take_lines()
+    { unsigned n = incs; incs = 0; return n; }
+
+private:
+    void warn(const char*, ...) __attribute__((format (printf, 2, 3)));
+
+private:
+    istream& is;
+    RuleTokens& out;
+
+    int prev = EOF;
+    int pos = 0;
+    unsigned incs = 0;
+
+    unsigned chars = 0, lines = 1, comments = 0;
+    unsigned keys = 0, lists = 0, strings = 0;
+};
+
+void Lexer::warn(const char* fmt, ...)
+{
+    char buf[256];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    out.push_back({ TT_WARNING, take_lines(), buf });
+}
+
+TokenType Lexer::get_token(string& s, const char* punct, int esc)
 {
-    static int prev = EOF;
     int c, list = 0, state = 0;
     s.clear();
     bool inc = true;
-    static int pos = 0;
     uint8_t hex = 0;
 
     if ( prev != EOF )
@@ -117,7 +174,7 @@ static TokenType get_token(
             pos = 0;
 
             if ( inc )
-                inc_parse_position();
+                ++incs;
             else
                 inc = true;
         }
@@ -208,7 +265,7 @@ static TokenType get_token(
             else if ( c == '\\' )
                 state = (esc > 0) ? 4 : 16;
             else if ( c == '\n' )
-                ParseWarning(WARN_RULES, "line break in string on line %u\n", lines-1);
+                warn("line break in string on line %u\n", lines-1);
             else
                 s += c;
             break;
@@ -223,7 +280,7 @@ static TokenType get_token(
             break;
         case 5:  // unquoted escape
             if ( c != '\n' && c != '\r' )
-                ParseWarning(WARN_RULES, "invalid escape on line %u\n", lines);
+                warn("invalid escape on line %u\n", lines);
             state = 0;
             break;
         case 6:  // token
@@ -315,7 +372,7 @@ static TokenType get_token(
                 state = 11;
             else if ( c == '\n' )
             {
-                ParseWarning(WARN_RULES, "line break in commented string on line %u\n", lines-1);
+                warn("line break in commented string on line %u\n", lines-1);
                 state = 11;
             }
             break;
@@ -327,8 +384,7 @@ static TokenType get_token(
             }
             else
             {
-                ParseWarning(WARN_RULES, "\\x used with no following hex digits on line %u\n",
-                        lines-1);
+                warn("\\x used with no following hex digits on line %u\n", lines-1);
                 s += c;
                 state = 3;
             }
@@ -450,7 +506,7 @@ static const State fsm[] =
     { 16, 14, TT_PUNCT,   FSM_NOP, ":",        ";" },
 };
 
-static const State* get_state(int num, TokenType type, const string& tok)
+static const State* find_state(int num, TokenType type, const string& tok)
 {
     const unsigned sz = sizeof(fsm)/sizeof(fsm[0]);
 
@@ -466,6 +522,14 @@ static const State* get_state(int num, TokenType type, const string& tok)
             return s;
         }
     }
+    return nullptr;
+}
+
+static const State* get_state(int num, TokenType type, const string& tok)
+{
+    if ( const State* s = find_state(num, type, tok) )
+        return s;
+
     ParseError("syntax error");
     return fsm;
 }
@@ -624,74 +688,216 @@ static int get_escape(const string& s)
     return 1;      // escape, option goes to "
 }
 
-// parse_body() is called at the end of a stub rule to parse the detection
-// options in an so rule.  similar to parse_stream() except we start in a
-// different state.
-static void parse_body(const char* extra, RuleParseState& rps, struct SnortConfig* sc)
-{
-    stringstream is(extra);
+//-------------------------------------------------------------------------
+// tokenizing
+//-------------------------------------------------------------------------
 
-    string tok;
+// the lexer needs the fsm state for punctuation and escaping so this runs
+// it without any actions.  stops after END like the parser.
+static void tokenize(
+    istream& is, RuleTokens& v, int num, const char* punct, bool prefetch)
+{
+    Lexer lex(is, v);
+    string tok, key;
     TokenType type;
     int esc = 1;
 
-    int num = 8;
-    const char* punct = "(:,;)";
-
-    while ( (type = get_token(is, tok, punct, esc)) )
+    while ( (type = lex.get_token(tok, punct, esc)) )
     {
-        ++tokens;
-        const State* s = get_state(num, type, tok);
+        const State* s = find_state(num, type, tok);
 
-#ifdef TRACER
-        printf("%d: %s = '%s' -> %s\n",
-            num, toks[type], tok.c_str(), acts[s->action]);
-#endif
-        exec(s->action, tok, rps, sc);
+        if ( !s )
+            s = fsm;
+
+        v.push_back({ type, lex.take_lines(), tok });
+
+        if ( s->action == FSM_ACT and tok == "END" )
+            break;
+
+        if ( s->action == FSM_KEY )
+            key = tok;
+
+        else if ( prefetch and s->action == FSM_INC )
+            prefetch_rule_file(get_include_path(tok.c_str()).c_str());
 
         num = s->next;
-        esc = get_escape(rps.key);
+        esc = get_escape(key);
 
         if ( s->punct )
             punct = s->punct;
     }
+    v.push_back({ TT_NONE, lex.take_lines(), "" });
 }
 
-void parse_stream(istream& is, struct SnortConfig* sc)
+// the tokens are parsed in order on the main thread so ips options,
+// sid / gid registration and rule states are handled exactly as before.
+// returns the final fsm state.
+static int parse_tokens(
+    RuleTokens& v, int num, RuleParseState& rps, SnortConfig* sc)
 {
-    string tok;
-    TokenType type;
-    int esc = 1;
+    for ( auto& tok : v )
+    {
+        for ( unsigned i = 0; i < tok.lines; ++i )
+            inc_parse_position();
 
-    int num = 0;
-    const char* punct = fsm[0].punct;
-    RuleParseState rps;
+        if ( tok.type == TT_WARNING )
+        {
+            ParseWarning(WARN_RULES, "%s", tok.text.c_str());
+            continue;
+        }
+
+        if ( tok.type == TT_NONE )
+            break;
 
-    while ( (type = get_token(is, tok, punct, esc)) )
-    {
         ++tokens;
-        const State* s = get_state(num, type, tok);
+        const State* s = get_state(num, tok.type, tok.text);
 
 #ifdef TRACER
         printf("%d: %s = '%s' -> %s\n",
-            num, toks[type], tok.c_str(), acts[s->action]);
+            num, toks[tok.type], tok.text.c_str(), acts[s->action]);
 #endif
 
-        if ( exec(s->action, tok, rps, sc) )
+        if ( exec(s->action, tok.text, rps, sc) )
             break;
 
         num = s->next;
-        esc = get_escape(rps.key);
+    }
+    return num;
+}
 
-        if ( s->punct )
-            punct = s->punct;
+//-------------------------------------------------------------------------
+// prefetch
+//
+// include files are read and tokenized by helper threads as soon as the
+// include is seen so that by the time the parser gets to them the tokens
+// are ready.  a file that is included more than once or after all the
+// helpers are busy is just tokenized by the parser.
+//-------------------------------------------------------------------------
+
+struct RuleFile
+{
+    RuleTokens toks;
+    int err = 0;
+};
+
+static mutex prefetch_mutex;
+static map<string, future<RuleFile*>> prefetched;
+static atomic<unsigned> prefetch_busy(0);
+
+static RuleFile* load_rule_file(string fname, bool prefetch)
+{
+    RuleFile* rf = new RuleFile;
+    ifstream fs(fname, ios_base::binary);
+
+    if ( fs )
+        tokenize(fs, rf->toks, 0, fsm[0].punct, prefetch);
+    else
+        rf->err = errno;
+
+    return rf;
+}
+
+static RuleFile* prefetch_worker(string fname)
+{
+    RuleFile* rf = load_rule_file(fname, true);
+    --prefetch_busy;
+    return rf;
+}
+
+void prefetch_rule_file(const char* fname)
+{
+    unsigned max = thread::hardware_concurrency();
+
+    if ( !fname or !*fname or max < 2 )
+        return;
+
+    lock_guard<mutex> lock(prefetch_mutex);
+
+    if ( prefetched.find(fname) != prefetched.end() or prefetch_busy >= max )
+        return;
+
+    ++prefetch_busy;
+    prefetched[fname] = async(launch::async, prefetch_worker, string(fname));
+}
+
+void clear_rule_prefetch()
+{
+    // files prefetched but never parsed; wait for the helpers first
+    while ( true )
+    {
+        future<RuleFile*> f;
+        {
+            lock_guard<mutex> lock(prefetch_mutex);
+
+            if ( prefetched.empty() )
+                break;
+
+            f = move(prefetched.begin()->second);
+            prefetched.erase(prefetched.begin());
+        }
+        delete f.get();
     }
-    if ( num )
-        ParseError("incomplete rule");
+}
+
+static RuleFile* get_rule_file(const char* fname)
+{
+    future<RuleFile*> f;
+    {
+        lock_guard<mutex> lock(prefetch_mutex);
+        auto it = prefetched.find(fname);
 
-    //printf("chars = %d, tokens = %d\n", chars, tokens);
-    //printf("lines = %d, comments = %d\n", lines, comments);
-    //printf("rules = %d, keys = %d\n", rules, keys);
-    //printf("lists = %d, strings = %d\n", lists, strings);
+        if ( it != prefetched.end() )
+        {
+            f = move(it->second);
+            prefetched.erase(it);
+        }
+    }
+    if ( f.valid() )
+        return f.get();
+
+    return load_rule_file(fname, true);
+}
+
+//-------------------------------------------------------------------------
+// parsing
+//-------------------------------------------------------------------------
+
+// parse_body() is called at the end of a stub rule to parse the detection
+// options in an so rule.  similar to parse_stream() except we start in a
+// different state.
+static void parse_body(const char* extra, RuleParseState& rps, struct SnortConfig* sc)
+{
+    stringstream is(extra);
+    RuleTokens v;
+
+    tokenize(is, v, 8, "(:,;)", false);
+    parse_tokens(v, 8, rps, sc);
+}
+
+void parse_stream(istream& is, struct SnortConfig* sc)
+{
+    RuleTokens v;
+    RuleParseState rps;
+
+    tokenize(is, v, 0, fsm[0].punct, true);
+
+    if ( parse_tokens(v, 0, rps, sc) )
+        ParseError("incomplete rule");
 }
 
+void parse_rule_file(const char* fname, struct SnortConfig* sc)
+{
+    RuleFile* rf = get_rule_file(fname);
+
+    if ( rf->err )
+        ParseError("unable to open rules file '%s': %s", fname, get_error(rf->err));
+
+    else
+    {
+        RuleParseState rps;
+
+        if ( parse_tokens(rf->toks, 0, rps, sc) )
+            ParseError("incomplete rule");
+    }
+    delete rf;
+}
@@ -24,5 +24,14 @@
 
 void parse_stream(std::istream&, struct SnortConfig*);
 
+// like parse_stream() but uses the tokens from prefetch_rule_file() if
+// they are available
+void parse_rule_file(const char* fname, struct SnortConfig*);
+
+// start reading and tokenizing a rules file and the files it includes on
+// helper threads.  all parsing is still done by the caller in order.
+void prefetch_rule_file(const char* fname);
+void clear_rule_prefetch();
+
 #endif
 
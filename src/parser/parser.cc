@@ -62,6 +62,7 @@
 #include "detection/rules.h"
 #include "detection/detect.h"
 #include "detection/fp_config.h"
+#include "detection/header_match.h"
 #include "detection/tag.h"
 #include "detection/sfrim.h"
 #include "protocols/packet.h"
@@ -78,6 +79,7 @@
 #include "actions/actions.h"
 #include "managers/event_manager.h"
 #include "managers/module_manager.h"
+#include "managers/so_manager.h"
 #include "target_based/snort_protocols.h"
 
 static struct rule_index_map_t* ruleIndexMap = nullptr;
@@ -623,6 +625,12 @@ void SetRuleStates(SnortConfig* sc)
 
 void ParseRules(SnortConfig* sc)
 {
+    // start tokenizing the rules files so they are ready when we get there
+    for ( auto p : sc->policy_map->ips_policy )
+        prefetch_rule_file(p->include.c_str());
+
+    SoManager::prefetch_rules();
+
     for ( unsigned idx = 0; idx < sc->policy_map->ips_policy.size(); ++idx )
     {
         set_policies(sc, idx);
@@ -657,12 +665,17 @@ void ParseRules(SnortConfig* sc)
             pop_parse_location();
         }
     }
+    clear_rule_prefetch();
+    SoManager::clear_prefetch(sc->logging_flags & LOGGING_FLAG__SHOW_PLUGINS);
     IntegrityCheckRules(sc);
     /*FindMaxSegSize();*/
 
     /* Compile/Finish and Print the PortList Tables */
     PortTablesFinish(sc->port_tables, sc->fast_pattern_config);
 
+    /* Compile the rule header checks */
+    header_sets_compile(sc);
+
     parse_rule_print();
 }
 
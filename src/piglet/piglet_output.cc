@@ -23,6 +23,7 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <inttypes.h>
 #include <stdio.h>
 
 #include "piglet_runner.h"
@@ -72,6 +73,22 @@ static inline const char* get_result_long(Piglet::Test::Result result)
     }
 }
 
+static inline void print_bench(const Piglet::Test& t, const char* indent)
+{
+    const auto& b = t.bench;
+
+    if ( !b.ops )
+        return;
+
+    printf("%sbench: %" PRIu64 " ops in %.3f s, %.0f ops/sec, %.1f ns/op",
+        indent, b.ops, b.elapsed, b.ops_per_sec(), b.ns_per_op());
+
+    if ( b.track_allocs )
+        printf(", %.2f allocs/op", b.allocs_per_op());
+
+    printf("\n");
+}
+
 namespace Piglet
 {
 // -----------------------------------------------------------------------------
@@ -100,6 +117,8 @@ const struct Output unit_test_output =
             t.chunk->filename.c_str(), get_result_short(t.result),
             t.type.c_str(), t.name.c_str(), i, get_result_long(t.result)
         );
+
+        print_bench(t, "");
     }
 };
 
@@ -160,6 +179,7 @@ const struct Output pretty_output =  // FIXIT-L don't want to include this
         }
 
         printf("\n");
+        print_bench(t, "    ");
 
         if ( t.result != Test::PASSED )
         {
@@ -205,6 +225,7 @@ const struct Output verbose_output =
         for ( auto msg : t.messages )
             printf("    %s\n", msg.c_str());
 
+        print_bench(t, "    ");
         printf("  %s\n", get_result_long(t.result));
     }
 };
@@ -19,12 +19,15 @@
 
 #include "piglet_runner.h"
 
+#include <chrono>
 #include <string>
 #include <assert.h>
 #include <lua.hpp>
 
 #include "lua/lua_table.h"
 #include "lua/lua_util.h"
+#include "main/snort_config.h"
+#include "profiler/profiler.h"
 #include "piglet_api.h"
 #include "piglet_manager.h"
 #include "piglet_output.h"
@@ -82,14 +85,14 @@ static bool configure_test(lua_State* L, Test& t)
     Lua::Table table(L, -1);
     table.get_field("description", t.description);
     table.get_field("use_defaults", t.use_defaults);
+    table.get_field("iterations", t.bench.iterations);
+    table.get_field("duration", t.bench.duration);
 
     return false;
 }
 
-static bool run_test(lua_State* L, Test& t)
+static bool get_test_function(lua_State* L, Test& t)
 {
-    Lua::ManageStack ms(L, 2);
-
     lua_getglobal(L, "plugin");
     if ( !lua_istable(L, -1) )
     {
@@ -104,16 +107,102 @@ static bool run_test(lua_State* L, Test& t)
         return true;
     }
 
+    return false;
+}
+
+// calls plugin.test which must be on top of the stack and leaves it there
+static bool call_test_function(lua_State* L, Test& t, bool& passed)
+{
+    lua_pushvalue(L, -1);
+
     if ( lua_pcall(L, 0, 1, 0) )
     {
         t.set_error(lua_tostring(L, -1));
+        lua_pop(L, 1);
         return true;
     }
 
-    if ( lua_toboolean(L, -1) )
-        t.result = Test::PASSED;
-    else
+    passed = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+
+    return false;
+}
+
+static bool run_test(lua_State* L, Test& t)
+{
+    Lua::ManageStack ms(L, 2);
+
+    if ( get_test_function(L, t) )
+        return true;
+
+    bool passed;
+
+    if ( call_test_function(L, t, passed) )
+        return true;
+
+    t.result = passed ? Test::PASSED : Test::FAILED;
+    return false;
+}
+
+// the first call is the functional test and warms up the plugin; the
+// rest are timed.  a failure stops the bench and fails the test.
+static bool run_bench(lua_State* L, Test& t)
+{
+    using Clock = std::chrono::steady_clock;
+    using std::chrono::duration;
+
+    if ( run_test(L, t) )
+        return true;
+
+    if ( t.result != Test::PASSED )
+        return false;
+
+    Lua::ManageStack ms(L, 2);
+
+    if ( get_test_function(L, t) )
+        return true;
+
+    Bench& b = t.bench;
+    const auto* profiler = SnortConfig::get_profiler();
+    b.track_allocs = profiler and profiler->memory.show;
+
+    MemoryTracker tracker;
+    bool passed = true;
+
+    auto start = Clock::now();
+    auto limit = start + duration<double>(b.duration);
+
+    {
+        MemoryContext mc(tracker);
+
+        while ( !b.iterations or b.ops < b.iterations )
+        {
+            if ( call_test_function(L, t, passed) )
+                break;
+
+            if ( !passed )
+                break;
+
+            ++b.ops;
+
+            if ( b.duration > 0.0 and Clock::now() >= limit )
+                break;
+        }
+    }
+
+    b.elapsed = duration<double>(Clock::now() - start).count();
+
+    if ( b.track_allocs )
+        b.allocs = tracker.stats.startup.allocs + tracker.stats.runtime.allocs;
+
+    if ( t.result == Test::ERROR )
+        return true;
+
+    if ( !passed )
+    {
         t.result = Test::FAILED;
+        t.messages.push_back("bench failed after " + std::to_string(b.ops) + " iterations");
+    }
 
     return false;
 }
@@ -145,6 +234,11 @@ void Runner::run(const struct Output& output, Test& t, unsigned i)
     {
         if ( p->setup() )
             t.set_error("environment setup failed");
+        else if ( t.bench.enabled() )
+        {
+            if ( run_bench(state.get_ptr(), t) )
+                t.set_error("bench function error");
+        }
         else if ( run_test(state.get_ptr(), t) )
             t.set_error("test function error");
 
@@ -23,6 +23,7 @@
 // Miscellaneous data objects used for the piglet test harness
 
 #include <chrono>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -67,6 +68,36 @@ struct Chunk
         filename { f }, target { t }, buffer { b } { }
 };
 
+// -------------------------------------------------------------------------
+// Bench
+// -------------------------------------------------------------------------
+// set plugin.iterations and / or plugin.duration (seconds) to call the test
+// function repeatedly; it stops at whichever limit is reached first
+struct Bench
+{
+    unsigned iterations = 0;
+    double duration = 0.0;
+
+    uint64_t ops = 0;
+    double elapsed = 0.0;  // seconds
+
+    // counted only when the memory profiler is shown
+    bool track_allocs = false;
+    uint64_t allocs = 0;
+
+    inline bool enabled() const
+    { return iterations or duration > 0.0; }
+
+    inline double ops_per_sec() const
+    { return elapsed > 0.0 ? ops / elapsed : 0.0; }
+
+    inline double ns_per_op() const
+    { return ops ? elapsed * 1.0e9 / ops : 0.0; }
+
+    inline double allocs_per_op() const
+    { return ops ? (double)allocs / ops : 0.0; }
+};
+
 // -------------------------------------------------------------------------
 // Test
 // -------------------------------------------------------------------------
@@ -90,6 +121,8 @@ struct Test
     std::string description;
     bool use_defaults = false;
 
+    Bench bench;
+
     std::vector<std::string> messages;
 
     inline void set_error(std::string s)
@@ -447,6 +447,37 @@ int PortObjectHasPort(PortObject* po, int port)
     return 0;
 }
 
+/*
+ * Set the ports for which PortObjectHasPort() returns true
+ */
+void PortObjectHasPortBits(PortObject* po, PortBitSet& bits)
+{
+    PortObjectItem* poi;
+    SF_LNODE* cursor;
+
+    bits.reset();
+
+    if ( !po )
+        return;
+
+    for (poi=(PortObjectItem*)sflist_first(po->item_list, &cursor);
+        poi != 0;
+        poi=(PortObjectItem*)sflist_next(&cursor) )
+    {
+        if ( poi->any() )
+            return;
+
+        if ( poi->negate )
+        {
+            bits.set();
+            return;
+        }
+
+        for ( int i = poi->lport; i <= poi->hport; i++ )
+            bits.set(i);
+    }
+}
+
 void PortObjectToggle(PortObject* po)
 {
     PortObjectItem* poi;
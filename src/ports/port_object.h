@@ -68,6 +68,7 @@ int PortObjectEqual(PortObject* poa, PortObject* bob);
 
 int PortObjectPortCount(PortObject*);
 int PortObjectHasPort(PortObject*, int port);
+void PortObjectHasPortBits(PortObject*, PortBitSet&);
 int PortObjectIsPureNot(PortObject*);
 int PortObjectHasAny(PortObject*);
 
@@ -0,0 +1,147 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// port_prefilter.cc
+
+#include "port_prefilter.h"
+
+#include "detection/pcrm.h"
+#include "framework/decode_data.h"
+#include "log/messages.h"
+#include "protocols/layer.h"
+#include "protocols/packet.h"
+
+static bool has_tcp(unsigned protos)
+{ return protos & ((unsigned)PktType::TCP | (unsigned)PktType::PDU | (unsigned)PktType::FILE); }
+
+static bool has_udp(unsigned protos)
+{ return protos & ((unsigned)PktType::UDP | (unsigned)PktType::PDU | (unsigned)PktType::FILE); }
+
+// rules and bindings see the innermost ip layer but the daq whitelists
+// the outer flow so tunneled traffic is never skipped
+static bool is_tunneled(const Packet* p)
+{
+    unsigned ip_layers = 0;
+
+    for ( unsigned i = 0; i < p->num_layers; ++i )
+    {
+        switch ( p->layers[i].prot_id )
+        {
+        case ProtocolId::ETHERTYPE_IPV4:
+        case ProtocolId::ETHERTYPE_IPV6:
+        case ProtocolId::IPIP:
+        case ProtocolId::IPV6:
+            if ( ++ip_layers > 1 )
+                return true;
+            break;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+static void show_ports(const char* proto, bool all, const PortBitSet& ports)
+{
+    if ( all )
+    {
+        LogMessage("    %s: all ports\n", proto);
+        return;
+    }
+    LogMessage("    %s: %zu ports\n", proto, ports.count());
+}
+
+PortPrefilter::PortPrefilter()
+{
+    all_tcp = all_udp = false;
+}
+
+// src and dst groups are checked against both ports of a packet so both
+// directions of a flow get the same result
+void PortPrefilter::add_rules(unsigned protos, const PORT_RULE_MAP* prm)
+{
+    if ( !prm )
+        return;
+
+    if ( prm->prmGeneric and prm->prmGeneric->rule_count )
+    {
+        add_all(protos);
+        return;
+    }
+
+    PortBitSet ports;
+
+    for ( int i = 0; i < MAX_PORTS; ++i )
+    {
+        if ( prm->prmSrcPort[i] or prm->prmDstPort[i] )
+            ports.set(i);
+    }
+    add_ports(protos, ports);
+}
+
+void PortPrefilter::add_ports(unsigned protos, const PortBitSet& ports)
+{
+    if ( has_tcp(protos) )
+        tcp |= ports;
+
+    if ( has_udp(protos) )
+        udp |= ports;
+}
+
+void PortPrefilter::add_all(unsigned protos)
+{
+    if ( has_tcp(protos) )
+        all_tcp = true;
+
+    if ( has_udp(protos) )
+        all_udp = true;
+}
+
+bool PortPrefilter::skip(const Packet* p) const
+{
+    const PortBitSet* ports;
+
+    if ( p->is_tcp() )
+    {
+        if ( all_tcp )
+            return false;
+        ports = &tcp;
+    }
+    else if ( p->is_udp() )
+    {
+        if ( all_udp )
+            return false;
+        ports = &udp;
+    }
+    else
+        return false;
+
+    // fragments must still get to defrag
+    if ( p->is_fragment() or is_tunneled(p) )
+        return false;
+
+    return !ports->test(p->ptrs.sp) and !ports->test(p->ptrs.dp);
+}
+
+void PortPrefilter::show() const
+{
+    LogMessage("port prefilter:\n");
+    show_ports("tcp", all_tcp, tcp);
+    show_ports("udp", all_udp, udp);
+}
+
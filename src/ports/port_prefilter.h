@@ -0,0 +1,67 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// port_prefilter.h
+
+#ifndef PORT_PREFILTER_H
+#define PORT_PREFILTER_H
+
+// the prefilter is the set of tcp and udp ports that any rule, binding, or
+// inspector of any policy could care about.  it is derived from the
+// compiled port rule maps and the binder once the inspectors are
+// configured.  packets on other ports are whitelisted right after decode
+// so they never get a flow.  it is built per config so reload refreshes
+// it.  anything that might need every packet sets all for the protocol.
+
+#include "framework/bits.h"
+
+struct Packet;
+struct PORT_RULE_MAP;
+
+// Inspector::exec() id used to ask the binder for the ports it binds
+#define BINDER_EXEC_PREFILTER 1
+
+class PortPrefilter
+{
+public:
+    PortPrefilter();
+
+    // protos are PktType bits; pdu and file apply to both tcp and udp
+    void add_rules(unsigned protos, const PORT_RULE_MAP*);
+    void add_ports(unsigned protos, const PortBitSet&);
+    void add_all(unsigned protos);
+
+    // true if the packet can't match anything
+    bool skip(const Packet*) const;
+
+    // true if nothing can be skipped
+    bool is_empty() const
+    { return all_tcp and all_udp; }
+
+    void show() const;
+
+private:
+    PortBitSet tcp;
+    PortBitSet udp;
+
+    bool all_tcp;
+    bool all_udp;
+};
+
+#endif
+
@@ -28,7 +28,9 @@
 #include <sys/types.h>
 #include <ctype.h>
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #include "port_item.h"
 #include "port_object.h"
@@ -583,6 +585,52 @@ static int _po2_include_po_rules(PortObject2* po2, PortObject* po)
     return 0;
 }
 
+/*
+ * Port object edges for the compile sweep.  Each range of ports an input
+ * object touches contributes a start edge at its low port and a stop edge
+ * just past its high port.  Between two consecutive edges the set of
+ * objects touching a port can't change, so each such segment is merged
+ * once instead of once per port.
+ */
+struct PortEdge
+{
+    int port;
+    unsigned idx;   /* index of the port object in pt_polist */
+    bool start;
+
+    bool operator<(const PortEdge& rhs) const
+    { return port < rhs.port; }
+};
+
+/*
+ * Add the edges of the ports 'po' touches, in the same terms as
+ * PortObjectHasPort(): an any item ends the list and a negated item
+ * touches every port.
+ */
+static void PortObjectAddEdges(PortObject* po, unsigned idx, std::vector<PortEdge>& edges)
+{
+    PortObjectItem* poi;
+    SF_LNODE* cursor;
+
+    for (poi=(PortObjectItem*)sflist_first(po->item_list, &cursor);
+        poi != 0;
+        poi=(PortObjectItem*)sflist_next(&cursor) )
+    {
+        if ( poi->any() )
+            return;
+
+        if ( poi->negate )
+        {
+            edges.push_back({ 0, idx, true });
+            return;
+        }
+        edges.push_back({ poi->lport, idx, true });
+
+        if ( poi->hport < SFPO_MAX_PORTS - 1 )
+            edges.push_back({ poi->hport + 1, idx, false });
+    }
+}
+
 static int PortTableCompileMergePortObjects(PortTable* p)
 {
     SFGHASH* mhash;
@@ -627,53 +675,96 @@ static int PortTableCompileMergePortObjects(PortTable* p)
     p->pt_plx_list = plx_list;
 
     /*
-     *  For each port, merge rules from all port objects that touch the port
-     *  into an optimal object, that may be shared with other ports.
+     *  For each segment of ports touched by the same port objects, merge
+     *  rules from those objects into an optimal object, that may be shared
+     *  with other segments.  Touching sets are kept as bitsets over the
+     *  input object list so equal neighbors are detected without a merge.
      */
+    std::vector<PortObject*> polist;
+    std::vector<PortEdge> edges;
+    PortObject* po;
+    SF_LNODE* lpos;
+
+    for (po=(PortObject*)sflist_first(p->pt_polist,&lpos);
+        po;
+        po=(PortObject*)sflist_next(&lpos) )
+    {
+        PortObjectAddEdges(po, polist.size(), edges);
+        polist.push_back(po);
+    }
+    std::stable_sort(edges.begin(), edges.end());
+
+    const unsigned words = (polist.size() + 63) / 64;
+    std::vector<uint64_t> cur_set(words), last_set(words);
+    std::vector<unsigned> depth(polist.size());
+    unsigned active = 0;
+
+    PortObject2* last_po = nullptr;
     int id = PO_INIT_ID;
 
-    for ( int i = 0; i < SFPO_MAX_PORTS; i++ )
+    memset(p->pt_port_object, 0, sizeof(p->pt_port_object));
+
+    for ( unsigned e = 0; e < edges.size(); )
     {
-        /* Build a list of port objects touching port 'i' */
-        int pol_cnt = 0;
-        PortObject* po;
-        SF_LNODE* lpos;
-
-        for (po=(PortObject*)sflist_first(p->pt_polist,&lpos);
-            po;
-            po=(PortObject*)sflist_next(&lpos) )
+        int lport = edges[e].port;
+
+        /* items of one object may overlap so track depth */
+        for ( ; e < edges.size() and edges[e].port == lport; ++e )
         {
-            if ( PortObjectHasPort (po, i) )
+            unsigned idx = edges[e].idx;
+
+            if ( edges[e].start )
             {
-                if ( pol_cnt < SFPO_MAX_LPORTS )
+                if ( !depth[idx]++ )
                 {
-                    pol[ pol_cnt++ ] = po;
+                    cur_set[idx / 64] |= (uint64_t)1 << (idx % 64);
+                    ++active;
                 }
             }
+            else if ( !--depth[idx] )
+            {
+                cur_set[idx / 64] &= ~((uint64_t)1 << (idx % 64));
+                --active;
+            }
         }
-        p->pt_port_object[i] = 0;
+        int hport = e < edges.size() ? edges[e].port : SFPO_MAX_PORTS;
 
-        if ( !pol_cnt )
+        if ( !active )
         {
-            //port not contained in any PortObject
+            //ports not contained in any PortObject
             continue;
         }
 
-        DEBUG_WRAP(DebugFormat(DEBUG_PORTLISTS,"*** merging list for port[%d] \n",i); fflush(
-            stdout); );
-
-        /* merge the rules into an optimal port object */
-        p->pt_port_object[i] =
-            PortTableCompileMergePortObjectList2(mhash, mhashx, plx_list, pol, pol_cnt, p->pt_lrc);
-        if ( !p->pt_port_object[i] )
+        if ( !last_po or cur_set != last_set )
         {
-            FatalError(" Could not merge PorObjectList on port %d\n",i);
+            /* Build a list of port objects touching this segment */
+            int pol_cnt = 0;
+
+            for ( unsigned idx = 0; idx < polist.size() and pol_cnt < SFPO_MAX_LPORTS; ++idx )
+            {
+                if ( cur_set[idx / 64] & ((uint64_t)1 << (idx % 64)) )
+                    pol[ pol_cnt++ ] = polist[idx];
+            }
+
+            DebugFormat(DEBUG_PORTLISTS,"*** merging list for ports[%d:%d] \n",
+                lport, hport - 1);
+
+            /* merge the rules into an optimal port object */
+            last_po =
+                PortTableCompileMergePortObjectList2(mhash, mhashx, plx_list, pol, pol_cnt, p->pt_lrc);
+            if ( !last_po )
+            {
+                FatalError(" Could not merge PorObjectList on port %d\n",lport);
+            }
+            last_set = cur_set;
         }
 
-        /* give the new compiled port object an id of its own */
-        p->pt_port_object[i]->id = id++;
+        for ( int i = lport; i < hport; i++ )
+            p->pt_port_object[i] = last_po;
 
-        DEBUG_WRAP(DebugMessage(DEBUG_PORTLISTS,"\n"); fflush(stdout); );
+        /* give the compiled port object the id of the last port it was merged for */
+        id += hport - lport;
+        last_po->id = id - 1;
     }
 
     /*
@@ -736,11 +827,7 @@ static int PortTableCompileMergePortObjects(PortTable* p)
             continue;
         }
 
-        PortBitSet parray;
-
-        /* Convert the port_list bits to a char array */
-        for ( int i = 0; i < SFPO_MAX_PORTS; i++ )
-            parray[ i ] = po->port_list->test(i);
+        PortBitSet parray = *po->port_list;
 
         /* Release bit buffer for each port object */
         if ( po->port_list )
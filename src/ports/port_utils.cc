@@ -144,11 +144,9 @@ SF_LIST* PortObjectItemListFromBits(const PortBitSet& parray, int n)
     if ( !plist )
         return 0;
 
-    for (int i = 0; i < n; i++)
+    // skip the gaps between ranges a word at a time
+    for (int i = bits_find_next(parray, 0); i < n; i = bits_find_next(parray, i + 1))
     {
-        if ( parray[i] == 0 )
-            continue;
-
         int lport, hport;
 
         /* Either a port or the start of a range */
@@ -0,0 +1,462 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// counter_profiler.cc
+
+#include "counter_profiler.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+
+#include "log/messages.h"
+#include "utils/util.h"
+
+#include "profiler_nodes.h"
+#include "profiler_printer.h"
+#include "profiler_stats_table.h"
+#include "profiler_tree_builder.h"
+#include "time_profiler_defs.h"
+#include "counter_profiler_defs.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+THREAD_LOCAL bool hw_counters_active = false;
+
+// -----------------------------------------------------------------------------
+// perf events
+// -----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+#define NUM_HW_COUNTERS 4
+
+static const uint64_t s_events[NUM_HW_COUNTERS] =
+{
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,     // last level cache
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+// the events are opened as one group so they are scheduled together.  if
+// every mmap page allows rdpmc the counters are read directly, otherwise
+// the group is read with one read() of the leader.
+struct HwCounters
+{
+    int fd[NUM_HW_COUNTERS];
+    perf_event_mmap_page* page[NUM_HW_COUNTERS];
+    size_t page_size;
+    bool rdpmc;
+};
+
+static THREAD_LOCAL HwCounters* s_counters = nullptr;
+
+static int perf_event_open(perf_event_attr* attr, int group_fd)
+{ return syscall(__NR_perf_event_open, attr, 0, -1, group_fd, 0); }
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t rdpmc(uint32_t idx)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("rdpmc" : "=a" (lo), "=d" (hi) : "c" (idx));
+    return (uint64_t)hi << 32 | lo;
+}
+
+// the kernel bumps lock whenever it updates the page so retry until
+// index, offset, and the counter were all read under one sequence
+static inline uint64_t read_mmap_counter(const perf_event_mmap_page* pc)
+{
+    uint32_t seq;
+    uint64_t count;
+
+    do
+    {
+        seq = pc->lock;
+        __asm__ volatile("" ::: "memory");
+
+        uint32_t idx = pc->index;
+        count = pc->offset;
+
+        if ( idx )
+        {
+            unsigned shift = 64 - pc->pmc_width;
+            int64_t pmc = rdpmc(idx - 1) << shift;
+            count += pmc >> shift;
+        }
+        __asm__ volatile("" ::: "memory");
+    }
+    while ( pc->lock != seq );
+
+    return count;
+}
+#endif
+
+static bool read_group(const HwCounters& hc, uint64_t* v)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if ( hc.rdpmc )
+    {
+        for ( unsigned i = 0; i < NUM_HW_COUNTERS; ++i )
+            v[i] = read_mmap_counter(hc.page[i]);
+
+        return true;
+    }
+#endif
+
+    // PERF_FORMAT_GROUP: nr followed by the values in open order
+    uint64_t buf[NUM_HW_COUNTERS + 1];
+
+    if ( read(hc.fd[0], buf, sizeof(buf)) != (ssize_t)sizeof(buf) )
+        return false;
+
+    memcpy(v, buf + 1, sizeof(buf) - sizeof(buf[0]));
+    return true;
+}
+
+static void close_group(HwCounters* hc)
+{
+    for ( unsigned i = 0; i < NUM_HW_COUNTERS; ++i )
+    {
+        if ( hc->page[i] )
+            munmap(hc->page[i], hc->page_size);
+
+        if ( hc->fd[i] >= 0 )
+            close(hc->fd[i]);
+    }
+    delete hc;
+}
+
+static HwCounters* open_group()
+{
+    HwCounters* hc = new HwCounters;
+    hc->page_size = sysconf(_SC_PAGESIZE);
+    hc->rdpmc = true;
+
+    for ( unsigned i = 0; i < NUM_HW_COUNTERS; ++i )
+    {
+        hc->fd[i] = -1;
+        hc->page[i] = nullptr;
+    }
+
+    for ( unsigned i = 0; i < NUM_HW_COUNTERS; ++i )
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = s_events[i];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        hc->fd[i] = perf_event_open(&attr, i ? hc->fd[0] : -1);
+
+        if ( hc->fd[i] < 0 )
+        {
+            WarningMessage("profiler: hardware counters unavailable: %s\n",
+                get_error(errno));
+            close_group(hc);
+            return nullptr;
+        }
+
+        void* p = mmap(nullptr, hc->page_size, PROT_READ, MAP_SHARED, hc->fd[i], 0);
+
+        if ( p == MAP_FAILED )
+            hc->rdpmc = false;
+        else
+        {
+            hc->page[i] = (perf_event_mmap_page*)p;
+
+            if ( !hc->page[i]->cap_user_rdpmc )
+                hc->rdpmc = false;
+        }
+    }
+    return hc;
+}
+
+void open_hw_counters()
+{
+    if ( s_counters )
+        return;
+
+    s_counters = open_group();
+    hw_counters_active = s_counters != nullptr;
+}
+
+void close_hw_counters()
+{
+    if ( !s_counters )
+        return;
+
+    close_group(s_counters);
+    s_counters = nullptr;
+    hw_counters_active = false;
+}
+
+void read_hw_counters(CounterStats& c)
+{
+    uint64_t v[NUM_HW_COUNTERS];
+
+    if ( !s_counters or !read_group(*s_counters, v) )
+    {
+        c.reset();
+        return;
+    }
+
+    c.cycles = v[0];
+    c.instructions = v[1];
+    c.llc_misses = v[2];
+    c.branch_misses = v[3];
+}
+
+#else
+
+void open_hw_counters()
+{ WarningMessage("profiler: hardware counters are only supported on Linux\n"); }
+
+void close_hw_counters() { }
+
+void read_hw_counters(CounterStats& c)
+{ c.reset(); }
+
+#endif
+
+// -----------------------------------------------------------------------------
+// show statistics
+// -----------------------------------------------------------------------------
+
+#define s_counter_table_title "Module Counter Statistics"
+
+namespace counter_stats
+{
+
+static const StatsTable::Field fields[] =
+{
+    { "#", 5, ' ', 0, std::ios_base::left },
+    { "module", 20, ' ', 0, std::ios_base::fmtflags() },
+    { "layer", 6, ' ', 0, std::ios_base::fmtflags() },
+    { "cycles", 14, ' ', 0, std::ios_base::fmtflags() },
+    { "instructions", 14, ' ', 0, std::ios_base::fmtflags() },
+    { "ipc", 6, ' ', 2, std::ios_base::fmtflags() },
+    { "llc/ki", 8, ' ', 2, std::ios_base::fmtflags() },
+    { "br miss/ki", 11, ' ', 2, std::ios_base::fmtflags() },
+    { "%/caller", 10, ' ', 2, std::ios_base::fmtflags() },
+    { "%/total", 9, ' ', 2, std::ios_base::fmtflags() },
+    { nullptr, 0, '\0', 0, std::ios_base::fmtflags() }
+};
+
+// misses per thousand instructions
+static inline double per_ki(uint64_t n, uint64_t instructions)
+{ return instructions ? double(n) * 1000.0 / double(instructions) : 0.0; }
+
+struct View
+{
+    std::string name;
+    CounterStats stats;
+    CounterStats caller_stats;
+
+    double ipc() const
+    { return stats.cycles ? double(stats.instructions) / double(stats.cycles) : 0.0; }
+
+    double llc_mpki() const
+    { return per_ki(stats.llc_misses, stats.instructions); }
+
+    double branch_mpki() const
+    { return per_ki(stats.branch_misses, stats.instructions); }
+
+    double pct_of(const CounterStats& o) const
+    {
+        if ( !o.cycles )
+            return 0.0;
+
+        return double(stats.cycles) / double(o.cycles) * 100.0;
+    }
+
+    double pct_caller() const
+    { return pct_of(caller_stats); }
+
+    bool operator==(const View& rhs) const
+    { return name == rhs.name; }
+
+    bool operator!=(const View& rhs) const
+    { return !(*this == rhs); }
+
+    const CounterStats& get_stats() const
+    { return stats; }
+
+    View(const ProfilerNode& node, const View* parent = nullptr) :
+        name(node.name), stats(node.get_stats().counters)
+    {
+        if ( parent )
+            caller_stats = parent->stats;
+        else
+            caller_stats.reset();
+    }
+};
+
+static const ProfilerSorter<View> sorter =
+{
+    "cycles",
+    [](const View& lhs, const View& rhs)
+    { return lhs.stats.cycles >= rhs.stats.cycles; }
+};
+
+static bool include_fn(const ProfilerNode& node)
+{ return node.get_stats().counters; }
+
+static void print_fn(StatsTable& t, const View& v)
+{
+    t << v.stats.cycles;
+    t << v.stats.instructions;
+    t << v.ipc();
+    t << v.llc_mpki();
+    t << v.branch_mpki();
+}
+
+} // namespace counter_stats
+
+// the modules table limits apply here too; counts are only taken on
+// sampled packets and aren't scaled since the ratios are what matter
+void show_counter_profiler_stats(ProfilerNodeMap& nodes, const TimeProfilerConfig& config)
+{
+    ProfilerBuilder<counter_stats::View> builder(counter_stats::include_fn);
+    auto root = builder.build(nodes.get_root());
+
+    if ( root.children.empty() && !root.view.stats )
+        return;
+
+    ProfilerPrinter<counter_stats::View> printer(
+        counter_stats::fields, counter_stats::print_fn, counter_stats::sorter);
+
+    printer.print_table(s_counter_table_title, root, config.count, config.max_depth);
+}
+
+#ifdef UNIT_TEST
+
+static inline CounterStats make_counter_stats(
+    uint64_t cycles, uint64_t instructions, uint64_t llc, uint64_t branch)
+{
+    CounterStats c;
+    c.cycles = cycles;
+    c.instructions = instructions;
+    c.llc_misses = llc;
+    c.branch_misses = branch;
+    return c;
+}
+
+TEST_CASE( "counter stats", "[profiler][counter_profiler]" )
+{
+    auto a = make_counter_stats(10, 20, 3, 4);
+    auto b = make_counter_stats(1, 2, 1, 1);
+
+    SECTION( "+=" )
+    {
+        a += b;
+        CHECK( a.cycles == 11 );
+        CHECK( a.instructions == 22 );
+        CHECK( a.llc_misses == 4 );
+        CHECK( a.branch_misses == 5 );
+    }
+
+    SECTION( "-=" )
+    {
+        a -= b;
+        CHECK( a.cycles == 9 );
+        CHECK( a.instructions == 18 );
+        CHECK( a.llc_misses == 2 );
+        CHECK( a.branch_misses == 3 );
+    }
+
+    SECTION( "reset" )
+    {
+        CHECK( a );
+        a.reset();
+        CHECK_FALSE( a );
+    }
+}
+
+TEST_CASE( "counter profiler view", "[profiler][counter_profiler]" )
+{
+    ProfileStats the_stats;
+    ProfilerNode node("foo");
+
+    the_stats.counters = make_counter_stats(2000, 3000, 6, 30);
+    node.set_stats(the_stats);
+
+    SECTION( "no parent" )
+    {
+        counter_stats::View view(node);
+
+        CHECK( view.ipc() == 1.5 );
+        CHECK( view.llc_mpki() == 2.0 );
+        CHECK( view.branch_mpki() == 10.0 );
+        CHECK( view.pct_caller() == 0.0 );
+        CHECK( view.pct_of(make_counter_stats(8000, 0, 0, 0)) == 25.0 );
+    }
+
+    SECTION( "parent set" )
+    {
+        counter_stats::View parent(node);
+        parent.stats.cycles = 4000;
+
+        counter_stats::View child(node, &parent);
+        CHECK( child.pct_caller() == 50.0 );
+    }
+
+    SECTION( "zero division" )
+    {
+        the_stats.counters.reset();
+        node.set_stats(the_stats);
+
+        counter_stats::View view(node);
+        CHECK( view.ipc() == 0.0 );
+        CHECK( view.llc_mpki() == 0.0 );
+        CHECK( view.branch_mpki() == 0.0 );
+    }
+}
+
+TEST_CASE( "counter context", "[profiler][counter_profiler]" )
+{
+    // no counters open so contexts must leave the stats alone
+    CounterStats stats;
+    stats.reset();
+    TimeProfilerStats time;
+    time.ref_count = 1;
+
+    {
+        CounterContext ctx(stats, time);
+        CounterExclude ex(&stats);
+    }
+
+    CHECK_FALSE( stats );
+}
+
+#endif
@@ -0,0 +1,33 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// counter_profiler.h
+
+#ifndef COUNTER_PROFILER_H
+#define COUNTER_PROFILER_H
+
+class ProfilerNodeMap;
+struct TimeProfilerConfig;
+
+// call from packet threads; open is a no-op where perf events aren't
+// available and hw_counters_active stays false
+void open_hw_counters();
+void close_hw_counters();
+
+void show_counter_profiler_stats(ProfilerNodeMap&, const TimeProfilerConfig&);
+
+#endif
@@ -0,0 +1,130 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// counter_profiler_defs.h
+
+#ifndef COUNTER_PROFILER_DEFS_H
+#define COUNTER_PROFILER_DEFS_H
+
+// hardware event counts for profiler.counters.  the counters are opened
+// per packet thread with perf_event_open and read from user space where
+// the kernel allows it.
+
+#include "main/snort_types.h"
+#include "main/thread.h"
+#include "time_profiler_defs.h"
+
+struct CounterStats
+{
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t llc_misses;
+    uint64_t branch_misses;
+
+    void reset()
+    { cycles = instructions = llc_misses = branch_misses = 0; }
+
+    operator bool() const
+    { return cycles or instructions; }
+};
+
+inline CounterStats& operator+=(CounterStats& lhs, const CounterStats& rhs)
+{
+    lhs.cycles += rhs.cycles;
+    lhs.instructions += rhs.instructions;
+    lhs.llc_misses += rhs.llc_misses;
+    lhs.branch_misses += rhs.branch_misses;
+    return lhs;
+}
+
+// unsigned wrap is fine here; excluded counts are always inside a context
+// that added at least as much
+inline CounterStats& operator-=(CounterStats& lhs, const CounterStats& rhs)
+{
+    lhs.cycles -= rhs.cycles;
+    lhs.instructions -= rhs.instructions;
+    lhs.llc_misses -= rhs.llc_misses;
+    lhs.branch_misses -= rhs.branch_misses;
+    return lhs;
+}
+
+// true when this thread has its counters open
+extern THREAD_LOCAL bool hw_counters_active;
+
+SO_PUBLIC void read_hw_counters(CounterStats&);
+
+// adds the counts since construction to stats; only the outermost context
+// for the stats counts, so construct it after the TimeContext has entered
+class CounterContext
+{
+public:
+    CounterContext(CounterStats& stats, const TimeProfilerStats& time) : stats(stats)
+    {
+        active = hw_counters_active and time_profiler_sampled and time.ref_count == 1;
+
+        if ( active )
+            read_hw_counters(start);
+    }
+
+    ~CounterContext()
+    {
+        if ( !active )
+            return;
+
+        CounterStats end;
+        read_hw_counters(end);
+        end -= start;
+        stats += end;
+    }
+
+private:
+    CounterStats& stats;
+    CounterStats start;
+    bool active;
+};
+
+class CounterExclude
+{
+public:
+    CounterExclude(CounterStats* stats) : stats(stats)
+    {
+        if ( stats and hw_counters_active and time_profiler_sampled )
+            read_hw_counters(start);
+        else
+            this->stats = nullptr;
+    }
+
+    CounterExclude(const CounterExclude&) = delete;
+    CounterExclude& operator=(const CounterExclude&) = delete;
+
+    ~CounterExclude()
+    {
+        if ( !stats )
+            return;
+
+        CounterStats end;
+        read_hw_counters(end);
+        end -= start;
+        *stats -= end;
+    }
+
+private:
+    CounterStats* stats;
+    CounterStats start;
+};
+
+#endif
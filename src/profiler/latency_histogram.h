@@ -0,0 +1,133 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// latency_histogram.h
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+// log-linear histogram of elapsed times, HDR style.  each power of 2 is
+// split into SUB_COUNT linear buckets so the error in any percentile is
+// at most 1 / SUB_COUNT of the value.  values below 2 * SUB_COUNT ticks
+// are exact and values of 2^MAX_BITS ticks or more go in the last bucket.
+
+#include <cstdint>
+#include <cstring>
+
+#include "time/clock_defs.h"
+
+class LatencyHistogram
+{
+public:
+    static constexpr unsigned SUB_BITS = 3;
+    static constexpr unsigned SUB_COUNT = 1 << SUB_BITS;
+    static constexpr unsigned MAX_BITS = 36;
+    static constexpr unsigned BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+    LatencyHistogram()
+    { reset(); }
+
+    void add(hr_duration d)
+    {
+        uint64_t v = d.count() > 0 ? d.count() : 0;
+        ++counts[index(v)];
+        ++total;
+
+        if ( v > most )
+            most = v;
+    }
+
+    void merge(const LatencyHistogram& rhs)
+    {
+        for ( unsigned i = 0; i < BUCKETS; ++i )
+            counts[i] += rhs.counts[i];
+
+        total += rhs.total;
+
+        if ( rhs.most > most )
+            most = rhs.most;
+    }
+
+    void reset()
+    {
+        memset(counts, 0, sizeof(counts));
+        total = most = 0;
+    }
+
+    uint64_t count() const
+    { return total; }
+
+    uint64_t bucket(unsigned idx) const
+    { return counts[idx]; }
+
+    hr_duration max() const
+    { return hr_duration(most); }
+
+    // smallest value at or above pct percent of the samples (pct <= 100)
+    hr_duration percentile(double pct) const
+    {
+        uint64_t target = uint64_t(total * pct / 100.0 + 0.5);
+        uint64_t sum = 0;
+
+        if ( !target )
+            target = 1;
+
+        for ( unsigned i = 0; i < BUCKETS; ++i )
+        {
+            sum += counts[i];
+
+            if ( sum >= target )
+            {
+                uint64_t v = upper(i);
+                return hr_duration(v < most ? v : most);
+            }
+        }
+        return max();
+    }
+
+    static unsigned index(uint64_t v)
+    {
+        if ( v < SUB_COUNT )
+            return v;
+
+        unsigned msb = 63 - __builtin_clzll(v);
+
+        if ( msb >= MAX_BITS )
+            return BUCKETS - 1;
+
+        unsigned shift = msb - SUB_BITS;
+        return (shift + 1) * SUB_COUNT + (unsigned)(v >> shift) - SUB_COUNT;
+    }
+
+    // largest value that goes in the given bucket
+    static uint64_t upper(unsigned idx)
+    {
+        if ( idx < SUB_COUNT )
+            return idx;
+
+        unsigned shift = idx / SUB_COUNT - 1;
+        uint64_t sub = idx % SUB_COUNT + SUB_COUNT;
+        return ((sub + 1) << shift) - 1;
+    }
+
+private:
+    uint64_t counts[BUCKETS];
+    uint64_t total;
+    uint64_t most;
+};
+
+#endif
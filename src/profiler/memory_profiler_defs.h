@@ -38,6 +38,10 @@ struct MemoryProfilerConfig
     bool show = false;
     unsigned count = 0;
     int max_depth = -1;
+
+    // record a stack for about 1 in sample bytes allocated (0 = off)
+    unsigned sample = 0;
+    unsigned sites = 10;
 };
 
 class SO_PUBLIC MemoryContext
@@ -0,0 +1,477 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// memory_sampler.cc
+
+#include "memory_sampler.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#endif
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "log/messages.h"
+
+#include "memory_profiler_defs.h"
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+// record() is called from inside operator new and samples may be freed at
+// any time, so the tables come from calloc() and are never freed.
+#define MAX_FRAMES 16
+#define SKIP_FRAMES 2     // record() and the allocator
+#define MAX_SITES 4096    // power of 2
+#define MAX_LIVE 65536    // power of 2
+
+struct SampleSite
+{
+    uint64_t hash;
+    void* frames[MAX_FRAMES];
+    unsigned depth;
+
+    uint64_t live;        // estimated bytes in use
+    uint64_t count;       // sampled allocations in use
+    uint64_t allocated;   // estimated bytes allocated
+
+    // as of the last snapshot
+    uint64_t last_live;
+    uint64_t last_allocated;
+};
+
+struct LiveSample
+{
+    const void* ptr;
+    uint64_t weight;
+    unsigned site;
+};
+
+static std::mutex s_mutex;
+static size_t s_rate = 0;
+static unsigned s_snapshots = 0;
+
+// site 0 takes the allocations of sites that don't fit
+static SampleSite* s_sites = nullptr;
+static unsigned s_num_sites = 0;
+static unsigned* s_site_slots = nullptr;  // 2 * MAX_SITES; 0 is empty
+
+static LiveSample* s_live = nullptr;      // MAX_LIVE; null ptr is empty
+static unsigned s_num_live = 0;
+
+THREAD_LOCAL size_t memory_sample_left = SIZE_MAX;
+static THREAD_LOCAL uint64_t t_seed = 0;
+
+//-------------------------------------------------------------------------
+// sampling
+//-------------------------------------------------------------------------
+
+// exponential gaps with mean s_rate give every byte the same chance of
+// being sampled regardless of the allocation pattern
+static size_t next_gap()
+{
+    // xorshift64*
+    t_seed ^= t_seed >> 12;
+    t_seed ^= t_seed << 25;
+    t_seed ^= t_seed >> 27;
+    uint64_t r = t_seed * 0x2545F4914F6CDD1DULL;
+
+    // u is in (0, 1]
+    double u = double((r >> 11) + 1) / double(1ULL << 53);
+    double gap = -std::log(u) * s_rate;
+
+    return gap < 1.0 ? 1 : size_t(gap);
+}
+
+// a sample stands for n / p bytes where p is the chance that an allocation
+// of n bytes contains a sampled byte
+static uint64_t get_weight(size_t n)
+{
+    double p = 1.0 - std::exp(-double(n) / double(s_rate));
+    return p > 0.0 ? uint64_t(n / p) : s_rate;
+}
+
+static uint64_t hash_frames(void* const* frames, unsigned depth)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    for ( unsigned i = 0; i < depth; ++i )
+    {
+        h ^= (uint64_t)(uintptr_t)frames[i];
+        h *= 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    return h ? h : 1;
+}
+
+static unsigned get_site(uint64_t hash, void* const* frames, unsigned depth)
+{
+    const unsigned mask = 2 * MAX_SITES - 1;
+
+    for ( unsigned i = hash & mask; ; i = (i + 1) & mask )
+    {
+        unsigned id = s_site_slots[i];
+
+        if ( id and s_sites[id].hash == hash )
+            return id;
+
+        if ( id )
+            continue;
+
+        if ( s_num_sites == MAX_SITES )
+            return 0;
+
+        id = s_num_sites++;
+        SampleSite& s = s_sites[id];
+        s.hash = hash;
+        s.depth = depth;
+        memcpy(s.frames, frames, depth * sizeof(*frames));
+        s_site_slots[i] = id;
+        return id;
+    }
+}
+
+static unsigned live_home(const void* p)
+{
+    uint64_t h = (uint64_t)(uintptr_t)p * 0x9E3779B97F4A7C15ULL;
+    return (h >> 32) & (MAX_LIVE - 1);
+}
+
+static bool add_live(const void* p, uint64_t weight, unsigned site)
+{
+    // keep the probes short
+    if ( s_num_live >= MAX_LIVE / 4 * 3 )
+        return false;
+
+    unsigned i = live_home(p);
+
+    while ( s_live[i].ptr )
+        i = (i + 1) & (MAX_LIVE - 1);
+
+    s_live[i] = { p, weight, site };
+    ++s_num_live;
+    return true;
+}
+
+static unsigned find_live(const void* p)
+{
+    for ( unsigned i = live_home(p); s_live[i].ptr; i = (i + 1) & (MAX_LIVE - 1) )
+    {
+        if ( s_live[i].ptr == p )
+            return i;
+    }
+    return MAX_LIVE;
+}
+
+// shift the following entries back so no probe sequence is broken
+static void remove_live(unsigned i)
+{
+    unsigned j = i;
+
+    while ( true )
+    {
+        s_live[i].ptr = nullptr;
+        unsigned k;
+
+        do
+        {
+            j = (j + 1) & (MAX_LIVE - 1);
+
+            if ( !s_live[j].ptr )
+            {
+                --s_num_live;
+                return;
+            }
+            k = live_home(s_live[j].ptr);
+        }
+        while ( i <= j ? (i < k and k <= j) : (i < k or k <= j) );
+
+        s_live[i] = s_live[j];
+        i = j;
+    }
+}
+
+void MemorySampler::init(const MemoryProfilerConfig& config)
+{
+    if ( !config.sample or s_rate )
+        return;
+
+    s_sites = (SampleSite*)calloc(MAX_SITES, sizeof(*s_sites));
+    s_site_slots = (unsigned*)calloc(2 * MAX_SITES, sizeof(*s_site_slots));
+    s_live = (LiveSample*)calloc(MAX_LIVE, sizeof(*s_live));
+
+    if ( !s_sites or !s_site_slots or !s_live )
+    {
+        WarningMessage("memory sampling disabled: can't allocate site tables\n");
+        free(s_sites);
+        free(s_site_slots);
+        free(s_live);
+        s_sites = nullptr;
+        s_site_slots = nullptr;
+        s_live = nullptr;
+        return;
+    }
+    s_num_sites = 1;
+    s_rate = config.sample;
+}
+
+void MemorySampler::thread_init()
+{
+    if ( !s_rate )
+        return;
+
+    t_seed = 0x9E3779B97F4A7C15ULL * (get_instance_id() + 1);
+    memory_sample_left = next_gap();
+}
+
+bool MemorySampler::record(const void* p, size_t n)
+{
+    if ( !s_rate )
+    {
+        memory_sample_left = SIZE_MAX;
+        return false;
+    }
+    memory_sample_left = next_gap();
+
+    void* frames[MAX_FRAMES + SKIP_FRAMES];
+    int depth = 0;
+
+#ifdef HAVE_EXECINFO_H
+    depth = backtrace(frames, MAX_FRAMES + SKIP_FRAMES);
+#endif
+
+    int skip = std::min(depth, SKIP_FRAMES);
+    void* const* top = frames + skip;
+    unsigned num = depth - skip;
+
+    uint64_t hash = hash_frames(top, num);
+    uint64_t weight = get_weight(n);
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    unsigned id = get_site(hash, top, num);
+    SampleSite& s = s_sites[id];
+    s.allocated += weight;
+
+    if ( !add_live(p, weight, id) )
+        return false;
+
+    s.live += weight;
+    ++s.count;
+    return true;
+}
+
+void MemorySampler::forget(const void* p)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    unsigned i = find_live(p);
+
+    if ( i == MAX_LIVE )
+        return;
+
+    SampleSite& s = s_sites[s_live[i].site];
+    s.live -= s_live[i].weight;
+    --s.count;
+
+    remove_live(i);
+}
+
+//-------------------------------------------------------------------------
+// reporting
+//-------------------------------------------------------------------------
+
+static int64_t live_change(const SampleSite& s)
+{ return (int64_t)(s.live - s.last_live); }
+
+static uint64_t churn(const SampleSite& s)
+{ return s.allocated - s.last_allocated; }
+
+static void show_site(unsigned rank, const SampleSite& s)
+{
+    LogMessage("%4u: live %" PRIu64 " (%+" PRId64 ") in %" PRIu64 " allocations, "
+        "churn %" PRIu64 "\n", rank, s.live, live_change(s), s.count, churn(s));
+
+    if ( !s.depth )
+    {
+        LogMessage("        %s\n", s.hash == 1 ? "(no stack)" : "(other sites)");
+        return;
+    }
+
+#ifdef HAVE_EXECINFO_H
+    char** names = backtrace_symbols(s.frames, s.depth);
+
+    for ( unsigned i = 0; i < s.depth; ++i )
+    {
+        if ( names )
+            LogMessage("        %s\n", names[i]);
+        else
+            LogMessage("        %p\n", s.frames[i]);
+    }
+    free(names);
+#endif
+}
+
+template<typename Compare>
+static void show_top(std::vector<SampleSite>& sites, unsigned count, Compare cmp)
+{
+    unsigned n = (count and count < sites.size()) ? count : sites.size();
+    std::partial_sort(sites.begin(), sites.begin() + n, sites.end(), cmp);
+
+    for ( unsigned i = 0; i < n; ++i )
+        show_site(i + 1, sites[i]);
+}
+
+bool MemorySampler::show(unsigned count, bool snapshot)
+{
+    if ( !s_rate )
+        return false;
+
+    // reserve before locking since the copy can't allocate under the lock
+    std::vector<SampleSite> sites;
+    sites.reserve(MAX_SITES);
+
+    unsigned num_live, snaps;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+
+        for ( unsigned i = 0; i < s_num_sites; ++i )
+        {
+            if ( s_sites[i].allocated )
+                sites.push_back(s_sites[i]);
+        }
+        num_live = s_num_live;
+        snaps = s_snapshots;
+
+        if ( snapshot )
+        {
+            for ( unsigned i = 0; i < s_num_sites; ++i )
+            {
+                s_sites[i].last_live = s_sites[i].live;
+                s_sites[i].last_allocated = s_sites[i].allocated;
+            }
+            ++s_snapshots;
+        }
+    }
+
+    LogMessage("--------------------------------------------------\n");
+    LogMessage("memory allocation sites (1 in %zu bytes sampled)\n", s_rate);
+    LogMessage("    sites: %zu\n", sites.size());
+    LogMessage("    live samples: %u\n", num_live);
+
+    if ( snaps )
+        LogMessage("    changes and churn are since snapshot %u\n", snaps);
+
+    LogMessage("top sites by live bytes:\n");
+    show_top(sites, count, [](const SampleSite& a, const SampleSite& b)
+        { return a.live > b.live; });
+
+    LogMessage("top sites by churn:\n");
+    show_top(sites, count, [](const SampleSite& a, const SampleSite& b)
+        { return churn(a) > churn(b); });
+
+    return true;
+}
+
+#ifdef UNIT_TEST
+
+TEST_CASE( "memory sampler", "[profiler][memory_sampler]" )
+{
+    MemoryProfilerConfig config;
+    config.sample = 64;
+
+    MemorySampler::init(config);
+    MemorySampler::thread_init();
+
+    CHECK( memory_sample_left > 0 );
+    CHECK( memory_sample_left != SIZE_MAX );
+
+    SECTION( "gaps" )
+    {
+        uint64_t total = 0;
+
+        for ( unsigned i = 0; i < 10000; ++i )
+            total += next_gap();
+
+        // the mean is about the rate
+        CHECK( total / 10000 > 48 );
+        CHECK( total / 10000 < 80 );
+    }
+
+    SECTION( "weight" )
+    {
+        CHECK( get_weight(1) >= 64 );
+        CHECK( get_weight(64 * 1024) == 64 * 1024 );
+    }
+
+    SECTION( "record and forget" )
+    {
+        char buf[8];
+        unsigned live = s_num_live;
+
+        for ( unsigned i = 0; i < 8; ++i )
+            CHECK( MemorySampler::record(buf + i, 100) );
+
+        CHECK( s_num_live == live + 8 );
+
+        unsigned id = s_live[find_live(buf)].site;
+        CHECK( s_sites[id].count >= 8 );
+
+        for ( unsigned i = 0; i < 8; ++i )
+            CHECK( find_live(buf + i) != MAX_LIVE );
+
+        // removing from the middle of a run keeps the rest reachable
+        for ( unsigned i = 0; i < 8; i += 2 )
+            MemorySampler::forget(buf + i);
+
+        for ( unsigned i = 1; i < 8; i += 2 )
+            CHECK( find_live(buf + i) != MAX_LIVE );
+
+        for ( unsigned i = 1; i < 8; i += 2 )
+            MemorySampler::forget(buf + i);
+
+        CHECK( s_num_live == live );
+        CHECK( find_live(buf) == MAX_LIVE );
+    }
+
+    SECTION( "snapshot" )
+    {
+        char buf[1];
+        CHECK( MemorySampler::record(buf, 100) );
+        CHECK( MemorySampler::show(1, true) );
+
+        unsigned id = s_live[find_live(buf)].site;
+        CHECK( live_change(s_sites[id]) == 0 );
+        CHECK( churn(s_sites[id]) == 0 );
+
+        MemorySampler::forget(buf);
+        CHECK( live_change(s_sites[id]) < 0 );
+    }
+}
+
+#endif
@@ -0,0 +1,69 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// memory_sampler.h
+
+#ifndef MEMORY_SAMPLER_H
+#define MEMORY_SAMPLER_H
+
+// MemorySampler records about 1 in sample bytes allocated on packet threads
+// with the call stack of the allocation.  the sampled allocations that are
+// still live are attributed to their sites so the top sites by live bytes
+// and by churn can be shown at exit or from the shell, each with the change
+// since the previous shell dump.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "main/thread.h"
+
+struct MemoryProfilerConfig;
+
+// bytes left until the next sample; SIZE_MAX when sampling is off
+extern THREAD_LOCAL size_t memory_sample_left;
+
+class MemorySampler
+{
+public:
+    // call from main thread after configuration
+    static void init(const MemoryProfilerConfig&);
+
+    // call from packet threads at start
+    static void thread_init();
+
+    // called for every allocation so keep it cheap
+    static bool due(size_t n)
+    {
+        if ( n < memory_sample_left )
+        {
+            memory_sample_left -= n;
+            return false;
+        }
+        return true;
+    }
+
+    // call when due(); returns true if the allocation is tracked and
+    // forget() must be called when it is freed
+    static bool record(const void*, size_t);
+    static void forget(const void*);
+
+    // log the top count sites; returns false if sampling is off
+    static bool show(unsigned count, bool snapshot);
+};
+
+#endif
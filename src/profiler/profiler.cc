@@ -31,8 +31,10 @@
 #include "main/snort_config.h"
 
 #include "profiler_nodes.h"
+#include "counter_profiler.h"
 #include "memory_context.h"
 #include "memory_profiler.h"
+#include "memory_sampler.h"
 #include "time_profiler.h"
 #include "rule_profiler.h"
 
@@ -70,16 +72,37 @@ void Profiler::register_module(const char* n, const char* pn, get_profile_stats_
     s_profiler_nodes.register_node(n, pn, fn);
 }
 
+void Profiler::thread_init()
+{
+    const auto* config = SnortConfig::get_profiler();
+
+    if ( config and config->counters )
+        open_hw_counters();
+
+    MemorySampler::thread_init();
+}
+
+void Profiler::thread_term()
+{ close_hw_counters(); }
+
 void Profiler::consolidate_stats()
 {
     s_profiler_nodes.accumulate_nodes();
     MemoryProfiler::consolidate_fallthrough_stats();
+    consolidate_time_profiler_samples();
+}
+
+void Profiler::sample_packet(
+    const TimeProfilerConfig& config, const _daq_pkthdr* pkth, const uint8_t* pkt)
+{
+    select_time_profiler_packet(config, pkth, pkt);
 }
 
 void Profiler::reset_stats()
 {
     s_profiler_nodes.reset_nodes();
     reset_rule_profiler_stats();
+    reset_time_profiler_samples();
 }
 
 void Profiler::show_stats()
@@ -88,8 +111,19 @@ void Profiler::show_stats()
     assert(config);
 
     show_time_profiler_stats(s_profiler_nodes, config->time);
+
+    if ( config->counters )
+        show_counter_profiler_stats(s_profiler_nodes, config->time);
+
     show_memory_profiler_stats(s_profiler_nodes, config->memory);
-    show_rule_profiler_stats(config->rule);
+    MemorySampler::show(config->memory.sites, false);
+    show_rule_profiler_stats(config->rule, config->counters);
+}
+
+const ProfileStats* Profiler::get_stats(const char* name)
+{
+    const ProfilerNode* node = s_profiler_nodes.find(name);
+    return node ? &node->get_stats() : nullptr;
 }
 
 #ifdef UNIT_TEST
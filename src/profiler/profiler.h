@@ -24,6 +24,7 @@
 #include "profiler_defs.h"
 
 class Module;
+struct _daq_pkthdr;
 
 class Profiler
 {
@@ -32,11 +33,30 @@ public:
     static void register_module(const char*, const char*, Module*);
     static void register_module(const char*, const char*, get_profile_stats_fn);
 
+    // call from packet threads, at start and end
+    static void thread_init();
+    static void thread_term();
+
     // FIXIT-L do we need to call on main thread?
     // call from packet threads, just before thread termination
     static void consolidate_stats();
+
+    // call from packet threads at the start of each packet
+    static void select_packet(const ProfilerConfig* config, const _daq_pkthdr* pkth,
+        const uint8_t* pkt)
+    {
+        if ( config->time.sample > 1 or !time_profiler_sampled )
+            sample_packet(config->time, pkth, pkt);
+    }
+
     static void reset_stats();
     static void show_stats();
+
+    // main thread, after consolidation; null if name isn't registered
+    static const ProfileStats* get_stats(const char* name);
+
+private:
+    static void sample_packet(const TimeProfilerConfig&, const _daq_pkthdr*, const uint8_t*);
 };
 
 
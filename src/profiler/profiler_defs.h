@@ -22,6 +22,7 @@
 #define PROFILER_DEFS_H
 
 #include "main/snort_types.h"
+#include "counter_profiler_defs.h"
 #include "memory_defs.h"
 #include "memory_profiler_defs.h"
 #include "rule_profiler_defs.h"
@@ -34,17 +35,22 @@ struct ProfilerConfig
     TimeProfilerConfig time;
     RuleProfilerConfig rule;
     MemoryProfilerConfig memory;
+
+    // hardware counters for modules and rules
+    bool counters = false;
 };
 
 struct SO_PUBLIC ProfileStats
 {
     TimeProfilerStats time;
     MemoryTracker memory;
+    CounterStats counters;
 
     void reset()
     {
         time.reset();
         memory.reset();
+        counters.reset();
     }
 
     bool operator==(const ProfileStats&) const;
@@ -53,9 +59,9 @@ struct SO_PUBLIC ProfileStats
 
     ProfileStats& operator+=(const ProfileStats&);
 
-    constexpr ProfileStats() : time(), memory() { }
+    constexpr ProfileStats() : time(), memory(), counters() { }
     constexpr ProfileStats(TimeProfilerStats time, MemoryTracker memory) :
-        time(time), memory(memory) { }
+        time(time), memory(memory), counters() { }
 };
 
 inline bool ProfileStats::operator==(const ProfileStats& rhs) const
@@ -65,6 +71,7 @@ inline ProfileStats& ProfileStats::operator+=(const ProfileStats& rhs)
 {
     time += rhs.time;
     memory.stats += rhs.memory.stats;
+    counters += rhs.counters;
 
     return *this;
 }
@@ -73,22 +80,26 @@ class ProfileContext
 {
 public:
     ProfileContext(ProfileStats& stats) :
-        time(stats.time), memory(stats.memory) { }
+        time(stats.time), memory(stats.memory), counters(stats.counters, stats.time) { }
 
 private:
     TimeContext time;
     MemoryContext memory;
+    CounterContext counters;
 };
 
 class SO_PUBLIC ProfileExclude
 {
 public:
-    ProfileExclude(ProfileStats& stats) : ProfileExclude(stats.time, stats.memory) { }
-    ProfileExclude(TimeProfilerStats& time, MemoryTracker&) : time(time), memory() { }
+    ProfileExclude(ProfileStats& stats) :
+        time(stats.time), memory(), counters(&stats.counters) { }
+    ProfileExclude(TimeProfilerStats& time, MemoryTracker&) :
+        time(time), memory(), counters(nullptr) { }
 
 private:
     TimeExclude time;
     MemoryExclude memory;
+    CounterExclude counters;
 };
 
 using get_profile_stats_fn = ProfileStats* (*)(const char*);
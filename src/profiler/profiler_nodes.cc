@@ -143,6 +143,12 @@ void ProfilerNodeMap::reset_nodes()
 const ProfilerNode& ProfilerNodeMap::get_root()
 { return get_node(ROOT_NODE); }
 
+const ProfilerNode* ProfilerNodeMap::find(const std::string& key) const
+{
+    auto it = nodes.find(key);
+    return it == nodes.end() ? nullptr : &it->second;
+}
+
 ProfilerNode& ProfilerNodeMap::get_node(std::string key)
 {
     auto node = nodes.emplace(key, key);
@@ -360,6 +366,19 @@ TEST_CASE( "profiler node map", "[profiler]" )
     {
         CHECK( tree.get_root().name == ROOT_NODE );
     }
+
+    SECTION( "find" )
+    {
+        ProfileStats stats;
+        SpyModule m("foo", &stats, false);
+
+        tree.register_node("foo", nullptr, &m);
+
+        const ProfilerNode* node = tree.find("foo");
+        REQUIRE( node );
+        CHECK( node->name == "foo" );
+        CHECK_FALSE( tree.find("bar") );
+    }
 }
 
 #endif
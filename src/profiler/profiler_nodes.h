@@ -94,6 +94,9 @@ public:
 
     const ProfilerNode& get_root();
 
+    // null if there is no such node
+    const ProfilerNode* find(const std::string&) const;
+
 private:
     ProfilerNode& get_node(std::string);
 
@@ -38,6 +38,7 @@
 #include "parser/parser.h"
 #include "target_based/snort_protocols.h"
 
+#include "latency_histogram.h"
 #include "profiler_printer.h"
 #include "profiler_stats_table.h"
 #include "rule_profiler_defs.h"
@@ -48,6 +49,8 @@
 
 #define s_rule_table_title "Rule Profile Statistics"
 
+THREAD_LOCAL hr_duration::rep rule_path_ticks = 0;
+
 static inline OtnState& operator+=(OtnState& lhs, const OtnState& rhs)
 {
     lhs.elapsed += rhs.elapsed;
@@ -55,6 +58,7 @@ static inline OtnState& operator+=(OtnState& lhs, const OtnState& rhs)
     lhs.checks += rhs.checks;
     lhs.matches += rhs.matches;
     lhs.alerts += rhs.alerts;
+    lhs.counters += rhs.counters;
     return lhs;
 }
 
@@ -79,11 +83,62 @@ static const StatsTable::Field fields[] =
     { nullptr, 0, '\0', 0, std::ios_base::fmtflags() }
 };
 
+// appended with histograms; percentiles are in us
+static const StatsTable::Field hist_fields[] =
+{
+    { "p50", 9, '\0', 1, std::ios_base::fmtflags() },
+    { "p99", 9, '\0', 1, std::ios_base::fmtflags() },
+    { "p99.9", 9, '\0', 1, std::ios_base::fmtflags() },
+    { "max", 10, '\0', 1, std::ios_base::fmtflags() },
+    { nullptr, 0, '\0', 0, std::ios_base::fmtflags() }
+};
+
+// appended with hardware counters; misses are per thousand instructions
+static const StatsTable::Field counter_fields[] =
+{
+    { "ipc", 6, '\0', 2, std::ios_base::fmtflags() },
+    { "llc/ki", 8, '\0', 2, std::ios_base::fmtflags() },
+    { "br miss/ki", 11, '\0', 2, std::ios_base::fmtflags() },
+    { nullptr, 0, '\0', 0, std::ios_base::fmtflags() }
+};
+
+struct Columns
+{
+    bool histograms;
+    bool counters;
+    std::vector<StatsTable::Field> fields;
+
+    Columns(bool h, bool c) : histograms(h), counters(c)
+    {
+        append(rule_stats::fields);
+
+        if ( histograms )
+            append(hist_fields);
+
+        if ( counters )
+            append(counter_fields);
+
+        fields.push_back({ nullptr, 0, '\0', 0, std::ios_base::fmtflags() });
+    }
+
+private:
+    void append(const StatsTable::Field* f)
+    {
+        while ( f->name )
+            fields.push_back(*f++);
+    }
+};
+
 struct View
 {
     OtnState state;
     SigInfo sig_info;
 
+    hr_duration p50 = 0_ticks;
+    hr_duration p99 = 0_ticks;
+    hr_duration p999 = 0_ticks;
+    hr_duration max = 0_ticks;
+
     hr_duration elapsed() const
     { return state.elapsed; }
 
@@ -128,6 +183,26 @@ struct View
     hr_duration avg_check() const
     { return time_per(elapsed(), checks()); }
 
+    double ipc() const
+    {
+        const auto& c = state.counters;
+        return c.cycles ? double(c.instructions) / double(c.cycles) : 0.0;
+    }
+
+    double per_ki(uint64_t n) const
+    {
+        const auto& c = state.counters;
+        return c.instructions ? double(n) * 1000.0 / double(c.instructions) : 0.0;
+    }
+
+    void set_percentiles(const LatencyHistogram& h)
+    {
+        p50 = h.percentile(50.0);
+        p99 = h.percentile(99.0);
+        p999 = h.percentile(99.9);
+        max = h.max();
+    }
+
     View(const OtnState& otn_state, const SigInfo* si = nullptr) :
         state(otn_state)
     {
@@ -174,6 +249,11 @@ static const ProfilerSorter<View> sorters[] =
         "avg_no_match",
         [](const View& lhs, const View& rhs)
         { return lhs.avg_no_match() >= rhs.avg_no_match(); }
+    },
+    {
+        "p99",
+        [](const View& lhs, const View& rhs)
+        { return lhs.p99 >= rhs.p99; }
     }
 };
 
@@ -183,13 +263,19 @@ static void consolidate_otn_states(OtnState* states)
         states[0] += states[i];
 }
 
-static std::vector<View> build_entries()
+static std::vector<View> build_entries(bool histograms)
 {
     assert(snort_conf);
 
     detection_option_tree_update_otn_stats(snort_conf->detection_option_tree_hash_table);
     auto* otn_map = snort_conf->otn_map;
 
+    OtnHistograms hists;
+
+    if ( histograms )
+        detection_option_tree_get_otn_histograms(
+            snort_conf->detection_option_tree_hash_table, hists);
+
     std::vector<View> entries;
 
     for ( auto* h = sfghash_findfirst(otn_map); h; h = sfghash_findnext(otn_map) )
@@ -207,13 +293,21 @@ static std::vector<View> build_entries()
 
         // FIXIT-L should we assert(otn->sigInfo)?
         entries.emplace_back(state, &otn->sigInfo);
+
+        auto it = hists.find(otn);
+
+        if ( it != hists.end() )
+            entries.back().set_percentiles(it->second);
     }
 
     return entries;
 }
 
+static double to_usecs(hr_duration d)
+{ return std::chrono::duration<double, std::micro>(d).count(); }
+
 // FIXIT-L logic duplicated from ProfilerPrinter
-static void print_single_entry(const View& v, unsigned n)
+static void print_single_entry(const View& v, unsigned n, const Columns& cols)
 {
     using std::chrono::duration_cast;
     using std::chrono::microseconds;
@@ -221,7 +315,7 @@ static void print_single_entry(const View& v, unsigned n)
     std::ostringstream ss;
 
     {
-        StatsTable table(fields, ss);
+        StatsTable table(cols.fields.data(), ss);
 
         table << StatsTable::ROW;
 
@@ -242,18 +336,34 @@ static void print_single_entry(const View& v, unsigned n)
 
         table << v.timeouts();
         table << v.suspends();
+
+        if ( cols.histograms )
+        {
+            table << to_usecs(v.p50);
+            table << to_usecs(v.p99);
+            table << to_usecs(v.p999);
+            table << to_usecs(v.max);
+        }
+
+        if ( cols.counters )
+        {
+            table << v.ipc();
+            table << v.per_ki(v.state.counters.llc_misses);
+            table << v.per_ki(v.state.counters.branch_misses);
+        }
     }
 
     LogMessage("%s", ss.str().c_str());
 }
 
 // FIXIT-L logic duplicated from ProfilerPrinter
-static void print_entries(std::vector<View>& entries, ProfilerSorter<View> sort, unsigned count)
+static void print_entries(
+    std::vector<View>& entries, ProfilerSorter<View> sort, unsigned count, const Columns& cols)
 {
     std::ostringstream ss;
 
     {
-        StatsTable table(fields, ss);
+        StatsTable table(cols.fields.data(), ss);
 
         table << StatsTable::SEP;
 
@@ -280,17 +390,17 @@ static void print_entries(std::vector<View>& entries, ProfilerSorter<View> sort,
         std::partial_sort(entries.begin(), entries.begin() + count, entries.end(), sort);
 
     for ( unsigned i = 0; i < count; ++i )
-        print_single_entry(entries[i], i + 1);
+        print_single_entry(entries[i], i + 1, cols);
 }
 
 }
 
-void show_rule_profiler_stats(const RuleProfilerConfig& config)
+void show_rule_profiler_stats(const RuleProfilerConfig& config, bool counters)
 {
     if ( !config.show )
         return;
 
-    auto entries = rule_stats::build_entries();
+    auto entries = rule_stats::build_entries(config.histograms);
 
     // if there aren't any eval'd rules, don't sort or print
     if ( entries.empty() )
@@ -299,7 +409,8 @@ void show_rule_profiler_stats(const RuleProfilerConfig& config)
     auto sort = rule_stats::sorters[config.sort];
 
     // FIXIT-L do we eventually want to be able print rule totals, too?
-    print_entries(entries, sort, config.count);
+    rule_stats::Columns cols(config.histograms, counters);
+    print_entries(entries, sort, config.count, cols);
 }
 
 void reset_rule_profiler_stats()
@@ -331,7 +442,34 @@ void RuleContext::stop(bool match)
         return;
 
     finished = true;
-    stats.update(sw.get(), match);
+
+    if ( sw.active() )
+        count();
+
+    hr_duration delta = sw.get();
+    stats.update(delta, match);
+
+    if ( !descended and snort_conf and snort_conf->profiler->rule.histograms )
+    {
+        if ( !stats.hist )
+            stats.hist = new LatencyHistogram;
+
+        stats.hist->add(hr_duration(path) + delta);
+    }
+
+    // siblings start from the same place
+    rule_path_ticks = path;
+}
+
+void RuleContext::count()
+{
+    if ( !hw_counters_active )
+        return;
+
+    CounterStats end;
+    read_hw_counters(end);
+    end -= counts;
+    stats.counters += end;
 }
 
 #ifdef UNIT_TEST
@@ -748,4 +886,112 @@ TEST_CASE( "rule pause", "[profiler][rule_profiler]" )
     CHECK( ctx.active() );
 }
 
+TEST_CASE( "rule path time", "[profiler][rule_profiler]" )
+{
+    dot_node_state_t parent_stats, child_stats;
+    REQUIRE( rule_path_ticks == 0 );
+
+    {
+        RuleContext parent(parent_stats);
+        avoid_optimization();
+
+        RulePause pause(parent);
+        auto above = rule_path_ticks;
+        CHECK( above > 0 );
+
+        {
+            RuleContext child(child_stats);
+            avoid_optimization();
+
+            RulePause child_pause(child);
+            CHECK( rule_path_ticks > above );
+        }
+        CHECK( rule_path_ticks == above );  // restored for the next sibling
+    }
+    CHECK( rule_path_ticks == 0 );
+}
+
+TEST_CASE( "latency histogram", "[profiler][rule_profiler]" )
+{
+    using H = LatencyHistogram;
+    LatencyHistogram h;
+
+    SECTION( "buckets" )
+    {
+        for ( uint64_t v : { 0ul, 7ul, 15ul, 16ul, 17ul, 1000ul, 123456789ul } )
+        {
+            unsigned i = H::index(v);
+            CHECK( v <= H::upper(i) );
+
+            if ( i )
+                CHECK( v > H::upper(i - 1) );
+        }
+        CHECK( H::index(uint64_t(1) << 40) == H::BUCKETS - 1 );
+    }
+
+    SECTION( "percentiles" )
+    {
+        for ( int i = 1; i <= 1000; ++i )
+            h.add(hr_duration(i * 100));
+
+        CHECK( h.count() == 1000 );
+        CHECK( h.max() == hr_duration(100000) );
+
+        auto p50 = h.percentile(50.0).count();
+        auto p99 = h.percentile(99.0).count();
+
+        CHECK( p50 >= 50000 );
+        CHECK( p50 < 50000 + 50000 / H::SUB_COUNT );
+        CHECK( p99 >= 99000 );
+        CHECK( h.percentile(100.0) == h.max() );
+    }
+
+    SECTION( "merge" )
+    {
+        LatencyHistogram g;
+        h.add(10_ticks);
+        g.add(5000_ticks);
+        h.merge(g);
+
+        CHECK( h.count() == 2 );
+        CHECK( h.max() == 5000_ticks );
+        CHECK( h.percentile(50.0) == 10_ticks );
+    }
+
+    SECTION( "empty" )
+    {
+        CHECK( h.percentile(99.0) == 0_ticks );
+    }
+}
+
+TEST_CASE( "rule profiler columns", "[profiler][rule_profiler]" )
+{
+    auto width = [](const rule_stats::Columns& c)
+    { return c.fields.size(); };
+
+    rule_stats::Columns base(false, false);
+    rule_stats::Columns hist(true, false);
+    rule_stats::Columns both(true, true);
+
+    CHECK( width(base) == 14 );
+    CHECK( width(hist) == 18 );
+    CHECK( width(both) == 21 );
+    CHECK( both.fields.back().name == nullptr );
+    CHECK( std::string(both.fields[17].name) == "ipc" );
+}
+
+TEST_CASE( "rule counters", "[profiler][rule_profiler]" )
+{
+    OtnState a;
+    OtnState b;
+    a.counters = { 100, 300, 3, 6 };
+    b.counters = { 100, 100, 1, 2 };
+    a += b;
+
+    rule_stats::View v(a);
+    CHECK( v.ipc() == 2.0 );
+    CHECK( v.per_ki(v.state.counters.llc_misses) == 10.0 );
+    CHECK( v.per_ki(v.state.counters.branch_misses) == 20.0 );
+}
+
 #endif
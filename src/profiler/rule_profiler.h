@@ -23,7 +23,7 @@
 
 struct RuleProfilerConfig;
 
-void show_rule_profiler_stats(const RuleProfilerConfig&);
+void show_rule_profiler_stats(const RuleProfilerConfig&, bool counters = false);
 void reset_rule_profiler_stats();
 
 #endif
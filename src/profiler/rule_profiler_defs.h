@@ -22,6 +22,8 @@
 #define RULE_PROFILER_DEFS_H
 
 #include "detection/treenodes.h"
+#include "main/thread.h"
+#include "counter_profiler_defs.h"
 #include "time_profiler_defs.h"
 
 struct dot_node_state_t;
@@ -37,28 +39,46 @@ struct RuleProfilerConfig
         SORT_MATCHES,
         SORT_NO_MATCHES,
         SORT_AVG_MATCH,
-        SORT_AVG_NO_MATCH
+        SORT_AVG_NO_MATCH,
+        SORT_P99
     } sort = SORT_TOTAL_TIME;
 
     bool show = false;
     unsigned count = 0;
+
+    // keep per rule latency histograms and show percentiles
+    bool histograms = false;
 };
 
+// ticks spent in the detection option tree nodes above the one starting;
+// each path ends at the node that doesn't descend, which records the total
+extern THREAD_LOCAL hr_duration::rep rule_path_ticks;
+
 class RuleContext
 {
 public:
     RuleContext(dot_node_state_t& stats) :
-        stats(stats)
+        stats(stats), path(rule_path_ticks)
     { start(); }
 
     ~RuleContext()
     { stop(); }
 
     void start()
-    { sw.start(); }
+    {
+        sw.start();
+
+        if ( hw_counters_active )
+            read_hw_counters(counts);
+    }
 
     void pause()
-    { sw.stop(); }
+    {
+        sw.stop();
+        rule_path_ticks = path + sw.get().count();
+        descended = true;
+        count();
+    }
 
     void stop(bool = false);
 
@@ -66,9 +86,15 @@ public:
     { return sw.active(); }
 
 private:
+    // add the hardware counts since start() to the node
+    void count();
+
     dot_node_state_t& stats;
     Stopwatch<hr_clock> sw;
+    CounterStats counts;
+    hr_duration::rep path;
     bool finished = false;
+    bool descended = false;
 };
 
 class RulePause
@@ -24,10 +24,16 @@
 #include "config.h"
 #endif
 
+#include <daq.h>
+
 #include <chrono>
 #include <iostream>
+#include <mutex>
 #include <string>
 
+#include "log/messages.h"
+#include "packet_io/flow_hash.h"
+
 #include "profiler_nodes.h"
 #include "profiler_tree_builder.h"
 #include "profiler_printer.h"
@@ -40,6 +46,71 @@
 
 #define s_time_table_title "Module Profile Statistics"
 
+THREAD_LOCAL bool time_profiler_sampled = true;
+
+//-------------------------------------------------------------------------
+// sampling
+//-------------------------------------------------------------------------
+
+struct TimeSamples
+{
+    uint64_t packets;
+    uint64_t sampled;
+    unsigned countdown;
+};
+
+static THREAD_LOCAL TimeSamples t_samples;
+
+static std::mutex s_samples_mutex;
+static TimeSamples s_samples;
+
+void select_time_profiler_packet(
+    const TimeProfilerConfig& config, const DAQ_PktHdr_t* pkth, const uint8_t* pkt)
+{
+    if ( config.sample <= 1 )
+    {
+        time_profiler_sampled = true;
+        return;
+    }
+
+    uint32_t hash;
+    t_samples.packets++;
+
+    if ( config.sample_flows and get_flow_hash(pkth, pkt, hash) )
+        time_profiler_sampled = !(hash % config.sample);
+
+    // countdown starts at 0 so the first packet is sampled
+    else if ( !t_samples.countdown-- )
+    {
+        t_samples.countdown = config.sample - 1;
+        time_profiler_sampled = true;
+    }
+    else
+        time_profiler_sampled = false;
+
+    if ( time_profiler_sampled )
+        t_samples.sampled++;
+}
+
+void consolidate_time_profiler_samples()
+{
+    std::lock_guard<std::mutex> lock(s_samples_mutex);
+    s_samples.packets += t_samples.packets;
+    s_samples.sampled += t_samples.sampled;
+    t_samples = { 0, 0, 0 };
+}
+
+void reset_time_profiler_samples()
+{
+    std::lock_guard<std::mutex> lock(s_samples_mutex);
+    s_samples = { 0, 0, 0 };
+    t_samples = { 0, 0, 0 };
+}
+
+//-------------------------------------------------------------------------
+// report
+//-------------------------------------------------------------------------
+
 namespace time_stats
 {
 
@@ -137,6 +208,23 @@ static void print_fn(StatsTable& t, const View& v)
     t << duration_cast<microseconds>(v.avg_check()).count();
 }
 
+static void scale(TimeProfilerStats& stats, double factor)
+{
+    stats.elapsed = hr_duration(hr_duration::rep(stats.elapsed.count() * factor));
+    stats.checks = uint64_t(stats.checks * factor);
+}
+
+// estimate the totals from the sampled packets; averages and percentages
+// are unchanged
+static void scale(ProfilerBuilder<View>::Entry& entry, double factor)
+{
+    scale(entry.view.stats, factor);
+    scale(entry.view.caller_stats, factor);
+
+    for ( auto& child : entry.children )
+        scale(child, factor);
+}
+
 } // namespace time_stats
 
 void show_time_profiler_stats(ProfilerNodeMap& nodes, const TimeProfilerConfig& config)
@@ -150,6 +238,14 @@ void show_time_profiler_stats(ProfilerNodeMap& nodes, const TimeProfilerConfig&
     if ( root.children.empty() && !root.view.stats )
         return;
 
+    if ( s_samples.sampled and s_samples.packets > s_samples.sampled )
+    {
+        LogMessage("time profiler sampled %" PRIu64 " of %" PRIu64 " packets\n",
+            s_samples.sampled, s_samples.packets);
+
+        time_stats::scale(root, double(s_samples.packets) / double(s_samples.sampled));
+    }
+
     const auto& sorter = time_stats::sorters[config.sort];
 
     ProfilerPrinter<time_stats::View> printer(time_stats::fields, time_stats::print_fn, sorter);
@@ -538,4 +634,66 @@ TEST_CASE( "time context exclude", "[profiler][time_profiler]" )
     CHECK( stats.elapsed < hr_duration::max() );
 }
 
+TEST_CASE( "time profiler sampling", "[profiler][time_profiler]" )
+{
+    TimeProfilerConfig config;
+    config.sample = 4;
+
+    reset_time_profiler_samples();
+
+    SECTION( "1 in n packets" )
+    {
+        unsigned n = 0;
+
+        for ( int i = 0; i < 16; ++i )
+        {
+            select_time_profiler_packet(config, nullptr, nullptr);
+
+            if ( time_profiler_sampled )
+                ++n;
+        }
+        CHECK( n == 4 );
+    }
+
+    SECTION( "unsampled context" )
+    {
+        TimeProfilerStats stats;
+
+        select_time_profiler_packet(config, nullptr, nullptr);
+        select_time_profiler_packet(config, nullptr, nullptr);
+        REQUIRE_FALSE( time_profiler_sampled );
+
+        {
+            TimeContext ctx(stats);
+            CHECK_FALSE( ctx.active() );
+            CHECK( stats.ref_count == 0 );
+        }
+        CHECK_FALSE( stats );
+    }
+
+    SECTION( "disabled" )
+    {
+        config.sample = 1;
+        select_time_profiler_packet(config, nullptr, nullptr);
+        CHECK( time_profiler_sampled );
+    }
+
+    SECTION( "scale" )
+    {
+        ProfilerNode node("foo");
+        ProfileStats ps;
+        ps.time = { 10_ticks, 2 };
+        node.set_stats(ps);
+
+        ProfilerBuilder<time_stats::View>::Entry entry(node);
+        time_stats::scale(entry, 4.0);
+
+        CHECK( entry.view.stats == TimeProfilerStats(40_ticks, 8) );
+        CHECK( entry.view.avg_check() == 5_ticks );
+    }
+
+    reset_time_profiler_samples();
+    time_profiler_sampled = true;
+}
+
 #endif
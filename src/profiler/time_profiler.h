@@ -21,9 +21,18 @@
 #ifndef TIME_PROFILER_H
 #define TIME_PROFILER_H
 
+#include <cstdint>
+
 class ProfilerNodeMap;
 struct TimeProfilerConfig;
+struct _daq_pkthdr;
 
 void show_time_profiler_stats(ProfilerNodeMap&, const TimeProfilerConfig&);
 
+// call from packet threads
+void select_time_profiler_packet(const TimeProfilerConfig&, const _daq_pkthdr*, const uint8_t*);
+void consolidate_time_profiler_samples();
+
+void reset_time_profiler_samples();
+
 #endif
@@ -22,6 +22,7 @@
 #define TIME_PROFILER_DEFS_H
 
 #include "main/snort_types.h"
+#include "main/thread.h"
 #include "time/clock_defs.h"
 #include "time/stopwatch.h"
 
@@ -38,8 +39,16 @@ struct TimeProfilerConfig
     bool show = false;
     unsigned count = 0;
     int max_depth = -1;
+
+    // time 1 in sample packets (or flows) and scale up the report
+    unsigned sample = 1;
+    bool sample_flows = false;
 };
 
+// false while the current packet was not selected for sampling; contexts
+// created then leave the clock and their stats alone
+extern THREAD_LOCAL bool time_profiler_sampled;
+
 struct SO_PUBLIC TimeProfilerStats
 {
     hr_duration elapsed;
@@ -88,7 +97,10 @@ public:
     TimeContext(TimeProfilerStats& stats) :
         stats(stats)
     {
-        if ( stats.enter() )
+        if ( !time_profiler_sampled )
+            stopped_once = true;
+
+        else if ( stats.enter() )
             sw.start();
     }
 
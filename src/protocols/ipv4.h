@@ -160,6 +160,10 @@ inline bool isPrivateIP(uint32_t addr)
     }
     return false;
 }
+
+// the next id from the ipv4 codec's shuffled pool, in network order, for
+// headers built outside the codec.  packet threads only.
+uint16_t next_id();
 } /* namespace ip */
 
 /* tcpdump shows us the way to cross platform compatibility */
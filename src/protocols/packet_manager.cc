@@ -38,6 +38,9 @@
 #include "protocols/eth.h"
 #include "protocols/icmp4.h"
 #include "protocols/icmp6.h"
+#include "protocols/ipv4.h"
+#include "protocols/ipv6.h"
+#include "protocols/tcp.h"
 #include "profiler/profiler.h"
 #include "parser/parser.h"
 
@@ -82,6 +85,12 @@ static THREAD_LOCAL std::array<uint8_t, Codec::PKT_MAX> s_pkt {
 };
 static THREAD_LOCAL uint8_t* dst_mac = nullptr;
 
+// Packet Pool
+#define PKT_POOL_MAX 8
+
+static THREAD_LOCAL Packet* pkt_pool[PKT_POOL_MAX];
+static THREAD_LOCAL unsigned pkt_pool_cnt = 0;
+
 //-------------------------------------------------------------------------
 // Private helper functions
 //-------------------------------------------------------------------------
@@ -141,6 +150,15 @@ void PacketManager::decode(
 {
     Profile profile(decodePerfStats);
 
+    // the codecs write through Packet so the compiler can't keep any of
+    // these in registers across the virtual calls unless we take them here;
+    // the per layer bookkeeping below is then straight line for the usual
+    // eth / vlan / ip / tcp or udp stacks.
+    auto& stats = s_stats;
+    const auto& codecs = CodecManager::s_protocols;
+    const auto& proto_map = CodecManager::s_proto_map;
+    const uint8_t max_layers = CodecManager::max_layers;
+
     DecodeData unsure_encap_ptrs;
 
     ProtocolIndex mapped_prot = CodecManager::grinder;
@@ -158,14 +176,14 @@ void PacketManager::decode(
     p->pkt = pkt;
     layer::set_packet_pointer(p);
 
-    s_stats[total_processed]++;
+    stats[total_processed]++;
 
     // loop until the protocol id is no longer valid
-    while (CodecManager::s_protocols[mapped_prot]->decode(raw, codec_data, p->ptrs))
+    while (codecs[mapped_prot]->decode(raw, codec_data, p->ptrs))
     {
         DebugFormat(DEBUG_DECODE, "Codec %s (protocol_id: %hu:"
             "ip header starts at: %p, length is %d\n",
-            CodecManager::s_protocols[mapped_prot]->get_name(),
+            codecs[mapped_prot]->get_name(),
             static_cast<uint16_t>(codec_data.next_prot_id), pkt, codec_data.lyr_len);
 
         /*
@@ -179,7 +197,7 @@ void PacketManager::decode(
             codec_data.codec_flags &= ~CODEC_SAVE_LAYER;
             unsure_encap_ptrs = p->ptrs;
         }
-        else
+        else if (codec_data.codec_flags & CODEC_UNSURE_ENCAP)
         {
             codec_data.codec_flags &= ~CODEC_UNSURE_ENCAP;
         }
@@ -209,14 +227,14 @@ void PacketManager::decode(
 
         // If we have reached the MAX_LAYERS, we keep decoding
         // but no longer keep track of the layers.
-        if ( p->num_layers == CodecManager::max_layers )
+        if ( p->num_layers == max_layers )
             SnortEventqAdd(GID_DECODE, DECODE_TOO_MANY_LAYERS);
         else
             push_layer(p, prev_prot_id, raw.data, codec_data.lyr_len);
 
         // internal statistics and record keeping
-        s_stats[mapped_prot + stat_offset]++; // add correct decode for previous layer
-        mapped_prot = CodecManager::s_proto_map[to_utype(codec_data.next_prot_id)];
+        stats[mapped_prot + stat_offset]++; // add correct decode for previous layer
+        mapped_prot = proto_map[to_utype(codec_data.next_prot_id)];
         prev_prot_id = codec_data.next_prot_id;
 
         // set for next call
@@ -233,10 +251,10 @@ void PacketManager::decode(
 
     DebugFormat(DEBUG_DECODE, "Codec %s (protocol_id: %hu: ip header"
         " starts at: %p, length is %lu\n",
-        CodecManager::s_protocols[mapped_prot]->get_name(),
+        codecs[mapped_prot]->get_name(),
         static_cast<uint16_t>(prev_prot_id), pkt, (unsigned long)codec_data.lyr_len);
 
-    s_stats[mapped_prot + stat_offset]++;
+    stats[mapped_prot + stat_offset]++;
 
     // if the final protocol ID is not the default codec, a Codec failed
     if (prev_prot_id != ProtocolId::FINISHED_DECODE)
@@ -273,13 +291,13 @@ void PacketManager::decode(
             }
 
             // if the codec exists, it failed
-            if (CodecManager::s_proto_map[to_utype(prev_prot_id)])
+            if (proto_map[to_utype(prev_prot_id)])
             {
-                s_stats[discards]++;
+                stats[discards]++;
             }
             else
             {
-                s_stats[other_codecs]++;
+                stats[other_codecs]++;
 
                 if ( (to_utype(ProtocolId::MIN_UNASSIGNED_IP_PROTO) <= to_utype(prev_prot_id)) &&
                     (to_utype(prev_prot_id) <= std::numeric_limits<uint8_t>::max()) &&
@@ -356,6 +374,200 @@ static inline uint8_t GetTTL(const Packet* const p, bool forward)
     return ttl;
 }
 
+static inline EncodeFlags get_encode_flags(const Packet* p, EncodeFlags flags, uint8_t& ttl)
+{
+    ttl = GetTTL(p, (flags & ENC_FLAG_FWD));
+
+    if ( ttl )
+        flags |=  ENC_FLAG_TTL;
+
+    if ( SFDAQ::forwarding_packet(p->pkth) )
+        flags |= ENC_FLAG_INLINE;
+
+    return flags;
+}
+
+//-------------------------------------------------------------------------
+// response templates
+//
+// a tcp response without payload on a plain eth / vlan / ip / tcp stack
+// comes out the same for every packet of a flow except for the sequence
+// numbers and the ip id.  the first encode saves the result and later
+// responses with the same key only patch those fields and update the
+// checksums incrementally instead of going through the codecs.
+//-------------------------------------------------------------------------
+
+#define TPL_MAX_VLAN 2
+#define TPL_KEY_MAX (eth::ETH_HEADER_LEN + TPL_MAX_VLAN * 4 + 38 + 4)
+#define TPL_PKT_MAX (eth::ETH_HEADER_LEN + ip::IP6_HEADER_LEN + tcp::TCP_MIN_HEADER_LEN)
+
+struct EncodeTemplate
+{
+    // key
+    EncodeFlags flags;
+    const uint8_t* mac;
+    uint8_t ttl;
+    uint8_t key_len;
+    uint8_t key[TPL_KEY_MAX];
+
+    // response
+    bool ip4;
+    uint8_t len;
+    uint8_t pkt[TPL_PKT_MAX];
+};
+
+// indexed by ENC_FLAG_FWD since a blocked session is reset both ways
+static THREAD_LOCAL EncodeTemplate s_templates[2];
+
+// the input fields the codecs copy into a tcp response.  the key is empty
+// if the stack is anything but eth, up to 2 vlan tags, ip4 or ip6 without
+// extension headers, and tcp.
+static unsigned get_template_key(const Packet* p, uint8_t* key)
+{
+    const Layer* lyrs = p->layers;
+    const int n = p->num_layers;
+
+    if ( n < 3 or n > TPL_MAX_VLAN + 3 or lyrs[0].prot_id != ProtocolId::ETHERNET_802_3 )
+        return 0;
+
+    const Layer& tl = lyrs[n - 1];
+    const Layer& il = lyrs[n - 2];
+
+    if ( lyrs[0].length != eth::ETH_HEADER_LEN or tl.prot_id != ProtocolId::TCP )
+        return 0;
+
+    uint8_t* k = key;
+    memcpy(k, lyrs[0].start, eth::ETH_HEADER_LEN);
+    k += eth::ETH_HEADER_LEN;
+
+    for ( int i = 1; i < n - 2; ++i )
+    {
+        if ( lyrs[i].prot_id != ProtocolId::ETHERTYPE_8021Q or lyrs[i].length != 4 )
+            return 0;
+
+        memcpy(k, lyrs[i].start, 4);
+        k += 4;
+    }
+
+    if ( il.prot_id == ProtocolId::ETHERTYPE_IPV4 )
+    {
+        const ip::IP4Hdr* h = reinterpret_cast<const ip::IP4Hdr*>(il.start);
+        *k++ = h->ip_tos;
+        *k++ = h->ip_ttl;
+        *k++ = to_utype(h->ip_proto);
+        memcpy(k, &h->ip_src, 8);  // and ip_dst
+        k += 8;
+    }
+    else if ( il.prot_id == ProtocolId::ETHERTYPE_IPV6 )
+    {
+        const ip::IP6Hdr* h = reinterpret_cast<const ip::IP6Hdr*>(il.start);
+        memcpy(k, &h->ip6_vtf, 4);
+        k += 4;
+        *k++ = to_utype(h->ip6_next);
+        *k++ = h->ip6_hoplim;
+        memcpy(k, &h->ip6_src, 32);  // and ip6_dst
+        k += 32;
+    }
+    else
+        return 0;
+
+    memcpy(k, tl.start, 4);  // ports
+    k += 4;
+
+    return k - key;
+}
+
+static void save_template(
+    EncodeTemplate& t, const uint8_t* key, unsigned key_len, EncodeFlags flags, uint8_t ttl,
+    const Packet* p, const uint8_t* pkt, uint32_t len)
+{
+    const bool ip4 = p->layers[p->num_layers - 2].prot_id == ProtocolId::ETHERTYPE_IPV4;
+    const unsigned hdr_len = (ip4 ? ip::IP4_HEADER_LEN : ip::IP6_HEADER_LEN) +
+        tcp::TCP_MIN_HEADER_LEN;
+
+    t.len = 0;
+
+    if ( len > sizeof(t.pkt) or len < hdr_len or (pkt[len - hdr_len] >> 4) != (ip4 ? 4 : 6) )
+        return;
+
+    t.flags = flags;
+    t.mac = dst_mac;
+    t.ttl = ttl;
+    t.key_len = key_len;
+    memcpy(t.key, key, key_len);
+
+    t.ip4 = ip4;
+    t.len = len;
+    memcpy(t.pkt, pkt, len);
+}
+
+static inline bool match_template(
+    const EncodeTemplate& t, const uint8_t* key, unsigned key_len, EncodeFlags flags, uint8_t ttl)
+{
+    return t.len and t.flags == flags and t.mac == dst_mac and t.ttl == ttl and
+        t.key_len == key_len and !memcmp(t.key, key, key_len);
+}
+
+static inline void set_word(uint8_t* pkt, unsigned off, uint16_t val, uint16_t& sum)
+{
+    uint16_t old;
+    memcpy(&old, pkt + off, sizeof(old));
+    memcpy(pkt + off, &val, sizeof(val));
+    sum = checksum::cksum_update(sum, old, val);
+}
+
+static void patch_template(EncodeTemplate& t, const Packet* p, EncodeFlags flags)
+{
+    const tcp::TCPHdr* hi =
+        reinterpret_cast<const tcp::TCPHdr*>(p->layers[p->num_layers - 1].start);
+
+    // sequence numbers as set by TcpCodec::encode()
+    const uint32_t ctl = (hi->th_flags & TH_SYN) ? 1 : 0;
+    uint32_t seq, ack;
+
+    if ( flags & ENC_FLAG_FWD )
+    {
+        seq = ntohl(hi->th_seq);
+
+        if ( !(flags & ENC_FLAG_INLINE) )
+            seq += p->dsize + ctl;
+
+        ack = ntohl(hi->th_ack);
+    }
+    else
+    {
+        seq = ntohl(hi->th_ack);
+        ack = ntohl(hi->th_seq) + p->dsize + ctl;
+    }
+
+    if ( flags & ENC_FLAG_SEQ )
+        seq += (flags & ENC_FLAG_VAL);
+
+    const uint32_t nums[2] = { htonl(seq), htonl(ack) };
+    uint16_t words[4];
+    memcpy(words, nums, sizeof(words));
+
+    uint8_t* tcph = t.pkt + t.len - tcp::TCP_MIN_HEADER_LEN;
+    uint16_t sum;
+
+    // th_ack follows th_seq
+    memcpy(&sum, tcph + offsetof(tcp::TCPHdr, th_sum), sizeof(sum));
+
+    for ( unsigned i = 0; i < 4; ++i )
+        set_word(tcph, offsetof(tcp::TCPHdr, th_seq) + 2 * i, words[i], sum);
+
+    memcpy(tcph + offsetof(tcp::TCPHdr, th_sum), &sum, sizeof(sum));
+
+    if ( !t.ip4 )
+        return;
+
+    uint8_t* iph = tcph - ip::IP4_HEADER_LEN;
+
+    memcpy(&sum, iph + offsetof(ip::IP4Hdr, ip_csum), sizeof(sum));
+    set_word(iph, offsetof(ip::IP4Hdr, ip_id), ip::next_id(), sum);
+    memcpy(iph + offsetof(ip::IP4Hdr, ip_csum), &sum, sizeof(sum));
+}
+
 bool PacketManager::encode(const Packet* p,
     EncodeFlags flags,
     uint8_t lyr_start,
@@ -365,14 +577,8 @@ bool PacketManager::encode(const Packet* p,
     if ( encode_pkt )
         p = encode_pkt;
 
-    uint8_t ttl = GetTTL(p, (flags & ENC_FLAG_FWD));
-    if ( ttl )
-        flags |=  ENC_FLAG_TTL;
-    else
-        ttl = 0;
-
-    if ( SFDAQ::forwarding_packet(p->pkth) )
-        flags |= ENC_FLAG_INLINE;
+    uint8_t ttl;
+    flags = get_encode_flags(p, flags, ttl);
 
     ip::IpApi tmp_api;
     EncState enc(tmp_api, flags, next_prot, ttl, p->dsize);
@@ -454,10 +660,33 @@ const uint8_t* PacketManager::encode_response(
         break;
     }
 
+    uint8_t key[TPL_KEY_MAX];
+    unsigned key_len = 0;
+    EncodeFlags tpl_flags = 0;
+    uint8_t ttl = 0;
+
+    if ( !(flags & ENC_FLAG_PAY) and !encode_pkt and (key_len = get_template_key(p, key)) )
+    {
+        EncodeTemplate& t = s_templates[(flags & ENC_FLAG_FWD) ? 1 : 0];
+        tpl_flags = get_encode_flags(p, flags, ttl);
+
+        if ( match_template(t, key, key_len, tpl_flags, ttl) )
+        {
+            patch_template(t, p, tpl_flags);
+            len = t.len;
+            return t.pkt;
+        }
+    }
+
     // FIXIT-M check flags if we should skip something
     if (encode(p, flags, p->num_layers-1, IpProtocol::PROTO_NOT_SET, buf))
     {
         len = buf.size();
+
+        if ( key_len and !buf.off )
+            save_template(s_templates[(flags & ENC_FLAG_FWD) ? 1 : 0],
+                key, key_len, tpl_flags, ttl, p, buf.data(), len);
+
         return buf.data() + buf.off;
     }
 
@@ -599,6 +828,7 @@ const uint8_t* PacketManager::encode_reject(UnreachResponse type,
     }
 }
 
+// resets c so callers don't need to
 static void set_hdr(
     const Packet* p, Packet* c, const DAQ_PktHdr_t* phdr, uint32_t opaque)
 {
@@ -630,7 +860,6 @@ int PacketManager::format_tcp(
     EncodeFlags, const Packet* p, Packet* c, PseudoPacketType type,
     const DAQ_PktHdr_t* phdr, uint32_t opaque)
 {
-    c->reset();
     DAQ_PktHdr_t* pkth = (DAQ_PktHdr_t*)c->pkth;
     set_hdr(p, c, phdr, opaque);
 
@@ -660,7 +889,6 @@ int PacketManager::encode_format(
     if ( num_layers <= 0 )
         return -1;
 
-    c->reset();
     set_hdr(p, c, phdr, opaque);
 
     if ( f & ENC_FLAG_NET )
@@ -835,6 +1063,30 @@ uint64_t PacketManager::get_rebuilt_packet_count()
 void PacketManager::encode_set_pkt(Packet* p)
 { encode_pkt = p; }
 
+Packet* PacketManager::new_packet()
+{
+    if ( !pkt_pool_cnt )
+        return new Packet();
+
+    Packet* p = pkt_pool[--pkt_pool_cnt];
+    p->reset();
+    return p;
+}
+
+void PacketManager::delete_packet(Packet* p)
+{
+    if ( pkt_pool_cnt < PKT_POOL_MAX )
+        pkt_pool[pkt_pool_cnt++] = p;
+    else
+        delete p;
+}
+
+void PacketManager::thread_term()
+{
+    while ( pkt_pool_cnt )
+        delete pkt_pool[--pkt_pool_cnt];
+}
+
 uint16_t PacketManager::encode_get_max_payload(const Packet* p)
 {
     if ( !p->num_layers )
@@ -115,6 +115,17 @@ public:
     static void encode_reset()
     { encode_set_pkt(NULL); }
 
+    // get a scratch packet from this thread's pool.  pooled packets keep
+    // their layer array and data buffer; only the fields zeroed by
+    // Packet::reset() are cleared on reuse.
+    static Packet* new_packet();
+
+    // return a packet obtained with new_packet()
+    static void delete_packet(Packet*);
+
+    // free the pool.  call from the packet thread when it terminates.
+    static void thread_term();
+
     // print codec information.  MUST be called after thread_term.
     static void dump_stats();
 
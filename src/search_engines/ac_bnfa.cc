@@ -31,6 +31,7 @@
 #include "main/snort_debug.h"
 #include "main/snort_types.h"
 #include "main/snort_config.h"
+#include "detection/fp_config.h"
 #include "utils/util.h"
 #include "profiler/profiler.h"
 #include "framework/mpse.h"
@@ -43,13 +44,18 @@ class AcBnfaMpse : public Mpse
 {
 private:
     bnfa_struct_t* obj;
+    bool simd;
 
 public:
-    AcBnfaMpse(SnortConfig*, bool use_gc, const MpseAgent* agent)
-        : Mpse("ac_bnfa", use_gc)
+    AcBnfaMpse(SnortConfig* sc, bool use_gc, const MpseAgent* agent, bool vec = false)
+        : Mpse(vec ? "ac_bnfa_simd" : "ac_bnfa", use_gc)
     {
+        simd = vec;
         obj=bnfaNew(agent);
         if ( obj ) obj->bnfaMethod = 1;
+
+        if ( obj and sc and sc->fast_pattern_config )
+            bnfaSetCacheDir(obj, sc->fast_pattern_config->get_cache_dir());
     }
 
     ~AcBnfaMpse()
@@ -76,11 +82,29 @@ public:
         return bnfaCompile(sc, obj);
     }
 
+    bool can_build_async() override
+    { return true; }
+
+    int build_fsm(SnortConfig*) override
+    {
+        return bnfaCompileFsm(obj);
+    }
+
+    int build_trees(SnortConfig* sc) override
+    {
+        bnfaCompileTrees(sc, obj);
+        return 0;
+    }
+
     int _search(
         const uint8_t* T, int n, MpseMatch match,
         void* context, int* current_state) override
     {
         /* return is actually the state */
+        if ( simd )
+            return _bnfa_search_csparse_nfa_skip(
+                obj, T, n, match, context, 0 /* start-state */, current_state);
+
         return _bnfa_search_csparse_nfa(
             obj, T, n, match, context, 0 /* start-state */, current_state);
     }
@@ -152,3 +176,48 @@ static const MpseApi bnfa_api =
 
 const BaseApi* se_ac_bnfa = &bnfa_api.base;
 
+//-------------------------------------------------------------------------
+// "ac_bnfa_simd"
+//-------------------------------------------------------------------------
+
+static Mpse* bnfa_simd_ctor(
+    SnortConfig* sc, class Module*, bool use_gc, const MpseAgent* agent)
+{
+    return new AcBnfaMpse(sc, use_gc, agent, true);
+}
+
+static void bnfa_simd_init()
+{
+    bnfa_init();
+    const char* kernel = bnfa_init_simd();
+    DebugFormat(DEBUG_PATTERN_MATCH, "ac_bnfa_simd using %s prefilter\n", kernel);
+    UNUSED(kernel);
+}
+
+static const MpseApi bnfa_simd_api =
+{
+    {
+        PT_SEARCH_ENGINE,
+        sizeof(MpseApi),
+        SEAPI_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        "ac_bnfa_simd",
+        "Aho-Corasick Binary NFA with SIMD root state prefilter MPSE",
+        nullptr,
+        nullptr
+    },
+    false,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    bnfa_simd_ctor,
+    bnfa_dtor,
+    bnfa_simd_init,
+    bnfa_print,
+};
+
+const BaseApi* se_ac_bnfa_simd = &bnfa_simd_api.base;
+
@@ -145,15 +145,31 @@
 #include "config.h"
 #endif
 
+#include <fcntl.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BNFA_SIMD
+#endif
 
 #include "search_common.h"
+#include "hash/hashes.h"
+#include "log/messages.h"
 #include "main/snort_types.h"
 #include "main/snort_debug.h"
 #include "utils/stats.h"
@@ -898,6 +914,7 @@ static int _bnfa_conv_list_to_csparse_array(bnfa_struct_t* bnfa)
         return -1;
     }
     bnfa->bnfaTransList = ps;
+    bnfa->bnfaTransWords = nps;
 
     /*
        State Index list for pi - we need an array of bnfa_state_t items of size 'NumStates'
@@ -1214,6 +1231,11 @@ void bnfaSetOpt(bnfa_struct_t* p, int flag)
     p->bnfaOpt=flag;
 }
 
+void bnfaSetCacheDir(bnfa_struct_t* p, const char* dir)
+{
+    p->bnfaCacheDir = (dir and *dir) ? dir : nullptr;
+}
+
 void bnfaSetCase(bnfa_struct_t* p, int flag)
 {
     if ( flag == BNFA_PER_PAT_CASE )
@@ -1224,6 +1246,374 @@ void bnfaSetCase(bnfa_struct_t* p, int flag)
         p->bnfaCaseMode = flag;
 }
 
+/*
+*   Shared transition lists
+*
+*   The compiled transition list depends only on the patterns and the
+*   build options so port groups with identical patterns share one copy.
+*   This includes unchanged groups across a reload since the old config is
+*   still live while the new one is built; the old instances just drop
+*   their references when the old config is deleted after the swap.  The
+*   match lists hold the detection option trees of each config and are
+*   always rebuilt from the instance's own patterns.
+*/
+struct bnfa_fsm_t
+{
+    std::string key;
+    bnfa_state_t* trans_list;
+    unsigned trans_words;
+    int num_states;
+    int num_trans;
+    int match_states;
+
+    // (state, pattern index) for each match list entry in list order
+    std::vector<std::pair<unsigned, unsigned>> matches;
+
+    uint8_t start_set[BNFA_MAX_ALPHABET_SIZE / 8];
+    uint8_t start_lo[16];
+    uint8_t start_hi[16];
+    unsigned start_count;
+
+    unsigned refs;
+
+    // set if trans_list is in a mapped snapshot instead of the heap
+    void* map;
+    size_t map_size;
+};
+
+static std::unordered_map<std::string, bnfa_fsm_t*> s_fsms;
+static std::mutex s_fsm_mutex;
+
+static std::string bnfa_fsm_key(bnfa_struct_t* bnfa)
+{
+    int opts[] =
+    {
+        bnfa->bnfaOpt, bnfa->bnfaCaseMode, bnfa->bnfaAlphabetSize,
+        bnfa->bnfaForceFullZeroState
+    };
+    std::string key((const char*)opts, sizeof(opts));
+
+    for ( bnfa_pattern_t* p = bnfa->bnfaPatterns; p; p = p->next )
+    {
+        key.append((const char*)&p->n, sizeof(p->n));
+        key.append((const char*)p->casepatrn, p->n);
+    }
+    return key;
+}
+
+static bool bnfa_fsm_adopt(bnfa_struct_t* bnfa, const std::string& key)
+{
+    bnfa_fsm_t* fsm;
+    {
+        std::lock_guard<std::mutex> lock(s_fsm_mutex);
+        auto it = s_fsms.find(key);
+
+        if ( it == s_fsms.end() )
+            return false;
+
+        fsm = it->second;
+        fsm->refs++;
+    }
+
+    std::vector<bnfa_pattern_t*> pats;
+
+    for ( bnfa_pattern_t* p = bnfa->bnfaPatterns; p; p = p->next )
+    {
+        pats.push_back(p);
+        bnfa->bnfaMaxStates += p->n;
+    }
+    bnfa->bnfaMaxStates++;
+
+    bnfa->bnfaNumStates = fsm->num_states;
+    bnfa->bnfaNumTrans = fsm->num_trans;
+    bnfa->bnfaMatchStates = fsm->match_states;
+
+    bnfa->bnfaMatchList = (bnfa_match_node_t**)BNFA_MALLOC(
+        sizeof(void*) * bnfa->bnfaNumStates, bnfa->matchlist_memory);
+
+    // prepend in reverse to restore the original list order
+    for ( auto it = fsm->matches.rbegin(); it != fsm->matches.rend(); ++it )
+    {
+        bnfa_match_node_t* pmn = (bnfa_match_node_t*)BNFA_MALLOC(
+            sizeof(bnfa_match_node_t), bnfa->matchlist_memory);
+
+        pmn->data = pats[it->second];
+        pmn->next = bnfa->bnfaMatchList[it->first];
+        bnfa->bnfaMatchList[it->first] = pmn;
+    }
+
+    memcpy(bnfa->bnfaStartSet, fsm->start_set, sizeof(bnfa->bnfaStartSet));
+    memcpy(bnfa->bnfaStartLo, fsm->start_lo, sizeof(bnfa->bnfaStartLo));
+    memcpy(bnfa->bnfaStartHi, fsm->start_hi, sizeof(bnfa->bnfaStartHi));
+    bnfa->bnfaStartCount = fsm->start_count;
+
+    bnfa->bnfaTransList = fsm->trans_list;
+    bnfa->bnfaTransWords = fsm->trans_words;
+    bnfa->bnfaFsm = fsm;
+    bnfa->bnfaShared = 1;
+    return true;
+}
+
+static void bnfa_fsm_publish(bnfa_struct_t* bnfa, const std::string& key)
+{
+    bnfa_fsm_t* fsm = new bnfa_fsm_t;
+
+    fsm->map = nullptr;
+    fsm->map_size = 0;
+    fsm->trans_list = bnfa->bnfaTransList;
+    fsm->trans_words = bnfa->bnfaTransWords;
+    fsm->num_states = bnfa->bnfaNumStates;
+    fsm->num_trans = bnfa->bnfaNumTrans;
+    fsm->match_states = bnfa->bnfaMatchStates;
+
+    std::unordered_map<void*, unsigned> index;
+    unsigned n = 0;
+
+    for ( bnfa_pattern_t* p = bnfa->bnfaPatterns; p; p = p->next )
+        index[p] = n++;
+
+    for ( int i = 0; i < bnfa->bnfaNumStates; i++ )
+    {
+        for ( bnfa_match_node_t* mn = bnfa->bnfaMatchList[i]; mn; mn = mn->next )
+            fsm->matches.push_back(std::make_pair((unsigned)i, index[mn->data]));
+    }
+
+    memcpy(fsm->start_set, bnfa->bnfaStartSet, sizeof(fsm->start_set));
+    memcpy(fsm->start_lo, bnfa->bnfaStartLo, sizeof(fsm->start_lo));
+    memcpy(fsm->start_hi, bnfa->bnfaStartHi, sizeof(fsm->start_hi));
+    fsm->start_count = bnfa->bnfaStartCount;
+
+    fsm->refs = 1;
+    bnfa->bnfaFsm = fsm;
+
+    std::lock_guard<std::mutex> lock(s_fsm_mutex);
+
+    // another thread may have built the same patterns meanwhile; both
+    // copies are valid and only the first is shared
+    if ( s_fsms.find(key) == s_fsms.end() )
+    {
+        fsm->key = key;
+        s_fsms[fsm->key] = fsm;
+    }
+}
+
+/*
+*   Compiled fsm snapshots
+*
+*   The shared fsm is position independent so it can be saved to disk and
+*   loaded by the next process with the same patterns and options.  The
+*   file is named by a hash of the key and also holds the key itself so a
+*   collision can't hand back the wrong machine.  The layout is native
+*   endian and word size; the version changes whenever it or the fsm
+*   construction changes.
+*
+*   The transition list, which is nearly all of the fsm, is aligned in the
+*   file and used in place from a read only shared mapping.  Processes on
+*   one host with the same patterns and cache_dir therefore share one copy
+*   through the page cache: the first to start compiles and saves it and
+*   the rest just map it.
+*/
+#define BNFA_CACHE_MAGIC   0x41464e42  // "BNFA"
+#define BNFA_CACHE_VERSION 2
+#define BNFA_CACHE_ALIGN   64
+
+struct bnfa_cache_hdr_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t key_len;
+    uint32_t trans_words;
+    int32_t num_states;
+    int32_t num_trans;
+    int32_t match_states;
+    uint32_t start_count;
+    uint32_t num_matches;
+};
+
+static std::string bnfa_fsm_file(const char* dir, const std::string& key)
+{
+    uint8_t digest[SHA256_HASH_SIZE];
+    sha256((const unsigned char*)key.data(), key.size(), digest);
+
+    std::string file = dir;
+    file += "/";
+
+    for ( unsigned i = 0; i < sizeof(digest); ++i )
+    {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02x", digest[i]);
+        file += hex;
+    }
+    return file + ".bnfa";
+}
+
+// offset of the transition list in the file
+static size_t bnfa_trans_offset(size_t key_len)
+{
+    size_t off = sizeof(bnfa_cache_hdr_t) + key_len +
+        sizeof(bnfa_fsm_t::start_set) + sizeof(bnfa_fsm_t::start_lo) +
+        sizeof(bnfa_fsm_t::start_hi);
+
+    return (off + BNFA_CACHE_ALIGN - 1) & ~(size_t)(BNFA_CACHE_ALIGN - 1);
+}
+
+// if found, the snapshot is published unreferenced for bnfa_fsm_adopt()
+static bool bnfa_fsm_load(const std::string& file, const std::string& key)
+{
+    int fd = open(file.c_str(), O_RDONLY);
+
+    if ( fd < 0 )
+        return false;
+
+    struct stat st;
+    void* map = MAP_FAILED;
+
+    if ( !fstat(fd, &st) and (size_t)st.st_size > sizeof(bnfa_cache_hdr_t) )
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if ( map == MAP_FAILED )
+        return false;
+
+    const uint8_t* base = (const uint8_t*)map;
+    size_t size = st.st_size;
+    const bnfa_cache_hdr_t* hdr = (const bnfa_cache_hdr_t*)base;
+
+    size_t trans_off = bnfa_trans_offset(hdr->key_len);
+    size_t match_off = trans_off + (size_t)hdr->trans_words * sizeof(bnfa_state_t);
+
+    if ( hdr->magic != BNFA_CACHE_MAGIC or hdr->version != BNFA_CACHE_VERSION or
+        hdr->key_len != key.size() or hdr->num_states <= 0 or
+        hdr->trans_words > BNFA_SPARSE_MAX_STATE or
+        match_off + (size_t)hdr->num_matches * 2 * sizeof(uint32_t) != size or
+        memcmp(base + sizeof(*hdr), key.data(), key.size()) )
+    {
+        munmap(map, size);
+        return false;
+    }
+
+    bnfa_fsm_t* fsm = new bnfa_fsm_t;
+    fsm->trans_words = hdr->trans_words;
+    fsm->num_states = hdr->num_states;
+    fsm->num_trans = hdr->num_trans;
+    fsm->match_states = hdr->match_states;
+    fsm->start_count = hdr->start_count;
+
+    const uint8_t* p = base + sizeof(*hdr) + hdr->key_len;
+    memcpy(fsm->start_set, p, sizeof(fsm->start_set));
+    p += sizeof(fsm->start_set);
+    memcpy(fsm->start_lo, p, sizeof(fsm->start_lo));
+    p += sizeof(fsm->start_lo);
+    memcpy(fsm->start_hi, p, sizeof(fsm->start_hi));
+
+    // the search never writes the transition list so it stays shared
+    fsm->trans_list = (bnfa_state_t*)(base + trans_off);
+    fsm->map = map;
+    fsm->map_size = size;
+
+    const uint32_t* v = (const uint32_t*)(base + match_off);
+    fsm->matches.resize(hdr->num_matches);
+
+    for ( auto& m : fsm->matches )
+    {
+        if ( (int)v[0] >= hdr->num_states )
+        {
+            munmap(map, size);
+            delete fsm;
+            return false;
+        }
+        m.first = v[0];
+        m.second = v[1];
+        v += 2;
+    }
+
+    fsm->refs = 0;
+
+    std::lock_guard<std::mutex> lock(s_fsm_mutex);
+
+    if ( s_fsms.find(key) != s_fsms.end() )
+    {
+        munmap(map, size);
+        delete fsm;
+        return true;
+    }
+    fsm->key = key;
+    s_fsms[fsm->key] = fsm;
+    return true;
+}
+
+// failure to save is not fatal; the fsm is just compiled next time
+static void bnfa_fsm_save(
+    const std::string& file, const std::string& key, const bnfa_fsm_t* fsm)
+{
+    bnfa_cache_hdr_t hdr;
+    hdr.magic = BNFA_CACHE_MAGIC;
+    hdr.version = BNFA_CACHE_VERSION;
+    hdr.key_len = key.size();
+    hdr.trans_words = fsm->trans_words;
+    hdr.num_states = fsm->num_states;
+    hdr.num_trans = fsm->num_trans;
+    hdr.match_states = fsm->match_states;
+    hdr.start_count = fsm->start_count;
+    hdr.num_matches = fsm->matches.size();
+
+    // write to a temporary and rename so readers never see a partial file
+    std::string tmp = file + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+
+    if ( !f )
+    {
+        WarningMessage("ac_bnfa: can't write cache file %s\n", file.c_str());
+        return;
+    }
+
+    bool ok =
+        fwrite(&hdr, sizeof(hdr), 1, f) == 1 and
+        fwrite(key.data(), 1, key.size(), f) == key.size() and
+        fwrite(fsm->start_set, sizeof(fsm->start_set), 1, f) == 1 and
+        fwrite(fsm->start_lo, sizeof(fsm->start_lo), 1, f) == 1 and
+        fwrite(fsm->start_hi, sizeof(fsm->start_hi), 1, f) == 1;
+
+    // pad so the transition list can be used in place when mapped
+    static const uint8_t zeros[BNFA_CACHE_ALIGN] = { };
+    size_t pad = bnfa_trans_offset(key.size()) - (sizeof(hdr) + key.size() +
+        sizeof(fsm->start_set) + sizeof(fsm->start_lo) + sizeof(fsm->start_hi));
+
+    ok = ok and
+        fwrite(zeros, 1, pad, f) == pad and
+        fwrite(fsm->trans_list, sizeof(bnfa_state_t), fsm->trans_words, f) == fsm->trans_words;
+
+    for ( const auto& m : fsm->matches )
+    {
+        uint32_t v[2] = { m.first, m.second };
+
+        if ( !ok or !(ok = (fwrite(v, sizeof(v), 1, f) == 1)) )
+            break;
+    }
+
+    if ( fclose(f) or !ok or rename(tmp.c_str(), file.c_str()) )
+        remove(tmp.c_str());
+}
+
+static void bnfa_fsm_release(bnfa_fsm_t* fsm)
+{
+    std::lock_guard<std::mutex> lock(s_fsm_mutex);
+
+    if ( --fsm->refs )
+        return;
+
+    if ( !fsm->key.empty() )
+        s_fsms.erase(fsm->key);
+
+    if ( fsm->map )
+        munmap(fsm->map, fsm->map_size);
+    else
+        snort_free(fsm->trans_list);
+
+    delete fsm;
+}
+
 /*
 *   Fee all memory
 */
@@ -1281,6 +1671,12 @@ void bnfaFree(bnfa_struct_t* bnfa)
         BNFA_FREE(ipatrn,sizeof(bnfa_pattern_t),bnfa->pat_memory);
     }
 
+    if ( bnfa->bnfaFsm )
+    {
+        bnfa_fsm_release(bnfa->bnfaFsm);
+        bnfa->bnfaTransList = nullptr;
+    }
+
     /* Free arrays */
     BNFA_FREE(bnfa->bnfaFailState,bnfa->bnfaNumStates*sizeof(bnfa_state_t),bnfa->failstate_memory);
     BNFA_FREE(bnfa->bnfaMatchList,bnfa->bnfaNumStates*sizeof(bnfa_pattern_t*),
@@ -1331,6 +1727,40 @@ int bnfaAddPattern(
     return 0;
 }
 
+/*
+*   Build the prefilter of raw input bytes that leave the root state.
+*   The root state is always stored in full format so its row is just
+*   indexed by the case translated byte.  The nibble tables are for the
+*   simd kernels: bit h of lo[l] is set if byte (h<<4)|l is in the set
+*   and hi[l] is the same for bytes with the high bit set.
+*/
+static void bnfaBuildStartSet(bnfa_struct_t* bnfa)
+{
+    bnfa_state_t* root = bnfa->bnfaTransList + 2;
+
+    memset(bnfa->bnfaStartSet, 0, sizeof(bnfa->bnfaStartSet));
+    memset(bnfa->bnfaStartLo, 0, sizeof(bnfa->bnfaStartLo));
+    memset(bnfa->bnfaStartHi, 0, sizeof(bnfa->bnfaStartHi));
+    bnfa->bnfaStartCount = 0;
+
+    if ( !bnfa->bnfaTransList or !bnfa->bnfaForceFullZeroState )
+        return;
+
+    for ( unsigned c = 0; c < BNFA_MAX_ALPHABET_SIZE; ++c )
+    {
+        if ( !(root[xlatcase[c]] & BNFA_SPARSE_MAX_STATE) )
+            continue;
+
+        bnfa->bnfaStartSet[c >> 3] |= (1 << (c & 7));
+        bnfa->bnfaStartCount++;
+
+        if ( c & 0x80 )
+            bnfa->bnfaStartHi[c & 0x0f] |= (1 << ((c >> 4) & 7));
+        else
+            bnfa->bnfaStartLo[c & 0x0f] |= (1 << ((c >> 4) & 7));
+    }
+}
+
 /*
 *   Compile the patterns into an nfa state machine
 */
@@ -1456,7 +1886,7 @@ static inline int _bnfaCompile(bnfa_struct_t* bnfa)
 
     bnfa->bnfaMatchStates = cntMatchStates;
 
-    bnfaAccumInfo(bnfa);
+    bnfaBuildStartSet(bnfa);
 
     return 0;
 }
@@ -1464,15 +1894,59 @@ static inline int _bnfaCompile(bnfa_struct_t* bnfa)
 int bnfaCompile(
     SnortConfig* sc, bnfa_struct_t* bnfa)
 {
-    if ( int rval = _bnfaCompile (bnfa) )
+    if ( int rval = bnfaCompileFsm(bnfa) )
         return rval;
 
-    if ( bnfa->agent )
-        bnfaBuildMatchStateTrees(sc, bnfa);
+    bnfaCompileTrees(sc, bnfa);
+    return 0;
+}
+
+// the fsm touches only the given bnfa and the shared fsm table, which is
+// locked, so it can be built on any thread
+int bnfaCompileFsm(bnfa_struct_t* bnfa)
+{
+    if ( bnfa->bnfaFormat != BNFA_SPARSE )
+        return _bnfaCompile(bnfa);
+
+    std::string key = bnfa_fsm_key(bnfa);
+
+    if ( bnfa_fsm_adopt(bnfa, key) )
+        return 0;
+
+    std::string file;
+
+    if ( bnfa->bnfaCacheDir )
+    {
+        file = bnfa_fsm_file(bnfa->bnfaCacheDir, key);
+
+        if ( bnfa_fsm_load(file, key) and bnfa_fsm_adopt(bnfa, key) )
+        {
+            bnfa->bnfaShared = 0;
+            bnfa->bnfaCached = 1;
+            return 0;
+        }
+    }
+
+    if ( int rval = _bnfaCompile(bnfa) )
+        return rval;
+
+    bnfa_fsm_publish(bnfa, key);
+
+    if ( !file.empty() )
+        bnfa_fsm_save(file, key, bnfa->bnfaFsm);
 
     return 0;
 }
 
+// the summary and detection option trees are shared; main thread only
+void bnfaCompileTrees(SnortConfig* sc, bnfa_struct_t* bnfa)
+{
+    bnfaAccumInfo(bnfa);
+
+    if ( bnfa->agent )
+        bnfaBuildMatchStateTrees(sc, bnfa);
+}
+
 #ifdef ALLOW_NFA_FULL
 
 /*
@@ -1908,6 +2382,220 @@ unsigned _bnfa_search_csparse_nfa(
     return nfound;
 }
 
+/*
+*   Root state prefilter kernels
+*
+*   In the root state, a byte that has no transition leaves us in the root
+*   state and the root is never a match state, so such bytes can be skipped
+*   without changing the result.  These return the first byte in [T, end)
+*   that starts a pattern or end if there is none.  The vector versions use
+*   the nibble tables built by bnfaBuildStartSet() with pshufb lookups.
+*/
+typedef const uint8_t* (* bnfa_skip_f)(const bnfa_struct_t*, const uint8_t*, const uint8_t*);
+
+static const uint8_t* bnfa_skip_scalar(
+    const bnfa_struct_t* bnfa, const uint8_t* T, const uint8_t* end)
+{
+    const uint8_t* set = bnfa->bnfaStartSet;
+
+    while ( T < end and !(set[*T >> 3] & (1 << (*T & 7))) )
+        T++;
+
+    return T;
+}
+
+#ifdef BNFA_SIMD
+__attribute__((target("ssse3")))
+static const uint8_t* bnfa_skip_ssse3(
+    const bnfa_struct_t* bnfa, const uint8_t* T, const uint8_t* end)
+{
+    const __m128i lo = _mm_loadu_si128((const __m128i*)bnfa->bnfaStartLo);
+    const __m128i hi = _mm_loadu_si128((const __m128i*)bnfa->bnfaStartHi);
+    const __m128i bits = _mm_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i top = _mm_set1_epi8((char)0x80);
+    const __m128i low3 = _mm_set1_epi8(0x07);
+    const __m128i zero = _mm_setzero_si128();
+
+    while ( end - T >= 16 )
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)T);
+        __m128i m = _mm_or_si128(
+            _mm_shuffle_epi8(lo, v), _mm_shuffle_epi8(hi, _mm_xor_si128(v, top)));
+        __m128i b = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(v, 4), low3));
+        unsigned miss = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(m, b), zero));
+
+        if ( miss != 0xffff )
+            return T + __builtin_ctz(~miss);
+
+        T += 16;
+    }
+    return bnfa_skip_scalar(bnfa, T, end);
+}
+
+__attribute__((target("avx2")))
+static const uint8_t* bnfa_skip_avx2(
+    const bnfa_struct_t* bnfa, const uint8_t* T, const uint8_t* end)
+{
+    const __m256i lo = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)bnfa->bnfaStartLo));
+    const __m256i hi = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)bnfa->bnfaStartHi));
+    const __m256i bits = _mm256_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i top = _mm256_set1_epi8((char)0x80);
+    const __m256i low3 = _mm256_set1_epi8(0x07);
+    const __m256i zero = _mm256_setzero_si256();
+
+    while ( end - T >= 32 )
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)T);
+        __m256i m = _mm256_or_si256(
+            _mm256_shuffle_epi8(lo, v), _mm256_shuffle_epi8(hi, _mm256_xor_si256(v, top)));
+        __m256i b = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), low3));
+        unsigned miss = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(m, b), zero));
+
+        if ( miss != 0xffffffff )
+            return T + __builtin_ctz(~miss);
+
+        T += 32;
+    }
+    return bnfa_skip_ssse3(bnfa, T, end);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static const uint8_t* bnfa_skip_avx512(
+    const bnfa_struct_t* bnfa, const uint8_t* T, const uint8_t* end)
+{
+    const __m512i lo = _mm512_broadcast_i32x4(
+        _mm_loadu_si128((const __m128i*)bnfa->bnfaStartLo));
+    const __m512i hi = _mm512_broadcast_i32x4(
+        _mm_loadu_si128((const __m128i*)bnfa->bnfaStartHi));
+    const __m512i bits = _mm512_broadcast_i32x4(_mm_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128));
+    const __m512i top = _mm512_set1_epi8((char)0x80);
+    const __m512i low3 = _mm512_set1_epi8(0x07);
+
+    while ( end - T >= 64 )
+    {
+        __m512i v = _mm512_loadu_si512((const void*)T);
+        __m512i m = _mm512_or_si512(
+            _mm512_shuffle_epi8(lo, v), _mm512_shuffle_epi8(hi, _mm512_xor_si512(v, top)));
+        __m512i b = _mm512_shuffle_epi8(bits, _mm512_and_si512(_mm512_srli_epi16(v, 4), low3));
+        __mmask64 hit = _mm512_test_epi8_mask(m, b);
+
+        if ( hit )
+            return T + __builtin_ctzll(hit);
+
+        T += 64;
+    }
+    return bnfa_skip_avx2(bnfa, T, end);
+}
+#endif
+
+static bnfa_skip_f bnfa_skip = bnfa_skip_scalar;
+
+const char* bnfa_init_simd()
+{
+#ifdef BNFA_SIMD
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports("avx512bw") )
+    {
+        bnfa_skip = bnfa_skip_avx512;
+        return "avx512";
+    }
+    if ( __builtin_cpu_supports("avx2") )
+    {
+        bnfa_skip = bnfa_skip_avx2;
+        return "avx2";
+    }
+    if ( __builtin_cpu_supports("ssse3") )
+    {
+        bnfa_skip = bnfa_skip_ssse3;
+        return "ssse3";
+    }
+#endif
+    bnfa_skip = bnfa_skip_scalar;
+    return "scalar";
+}
+
+// when most bytes start a pattern the prefilter just adds overhead
+#define BNFA_SKIP_MAX_START 96
+
+unsigned _bnfa_search_csparse_nfa_skip(
+    bnfa_struct_t* bnfa, const uint8_t* Tx, int n, MpseMatch match,
+    void* context, unsigned sindex, int* current_state)
+{
+    if ( bnfa->bnfaStartCount > BNFA_SKIP_MAX_START )
+        return _bnfa_search_csparse_nfa(bnfa, Tx, n, match, context, sindex, current_state);
+
+    bnfa_match_node_t* mlist;
+    const uint8_t* Tend;
+    const uint8_t* T;
+    uint8_t Tchar;
+    unsigned index;
+    bnfa_match_node_t** MatchList = bnfa->bnfaMatchList;
+    bnfa_pattern_t* patrn;
+    bnfa_state_t* transList = bnfa->bnfaTransList;
+    unsigned nfound = 0;
+    unsigned last_match=LAST_STATE_INIT;
+    unsigned last_match_saved=LAST_STATE_INIT;
+    int res;
+
+    T    = Tx;
+    Tend = T + n;
+
+    for (; T<Tend; T++)
+    {
+        if ( !sindex )
+        {
+            T = bnfa_skip(bnfa, T, Tend);
+
+            if ( T == Tend )
+                break;
+        }
+
+        Tchar = xlatcase[ *T ];
+
+        /* Transition to next state index */
+        sindex = _bnfa_get_next_state_csparse_nfa(transList,sindex,Tchar);
+
+        /* Log matches in this state - if any */
+        if ( sindex && (transList[sindex+1] & BNFA_SPARSE_MATCH_BIT) )
+        {
+            if ( sindex == last_match )
+                continue;
+
+            last_match_saved = last_match;
+            last_match = sindex;
+
+            mlist = MatchList[ transList[sindex] ];
+            if ( !mlist )
+                return nfound;
+
+            patrn = (bnfa_pattern_t*)mlist->data;
+            index = T - Tx + 1;
+            nfound++;
+
+            res = match(patrn->userdata, mlist->rule_option_tree, index,
+                context, mlist->neg_list);
+            if ( res > 0 )
+            {
+                *current_state = sindex;
+                return nfound;
+            }
+            else if ( res < 0 )
+            {
+                last_match = last_match_saved;
+            }
+        }
+    }
+    *current_state = sindex;
+    return nfound;
+}
+
 #ifdef BNFA_MAIN
 /*
  * Case specific search, global to all patterns
@@ -2053,6 +2741,8 @@ int bnfaPatternCount(bnfa_struct_t* p)
  */
 static bnfa_struct_t summary;
 static int summary_cnt = 0;
+static int summary_shared = 0;
+static int summary_cached = 0;
 
 static void bnfaPrintInfoEx(bnfa_struct_t* p)
 {
@@ -2070,6 +2760,8 @@ static void bnfaPrintInfoEx(bnfa_struct_t* p)
     LogCount("pattern chars", p->bnfaMaxStates);
     LogCount("num states", p->bnfaNumStates);
     LogCount("num match states", p->bnfaMatchStates);
+    LogCount("shared fsms", summary_shared);
+    LogCount("cached fsms", summary_cached);
 
     double scale;
 
@@ -2102,6 +2794,8 @@ void bnfaPrintSummary()
 void bnfaInitSummary()
 {
     summary_cnt=0;
+    summary_shared=0;
+    summary_cached=0;
     memset(&summary,0,sizeof(bnfa_struct_t));
 }
 
@@ -2110,6 +2804,8 @@ void bnfaAccumInfo(bnfa_struct_t* p)
     bnfa_struct_t* px = &summary;
 
     summary_cnt++;
+    summary_shared += p->bnfaShared;
+    summary_cached += p->bnfaCached;
 
     px->bnfaAlphabetSize  = p->bnfaAlphabetSize;
     px->bnfaPatternCnt   += p->bnfaPatternCnt;
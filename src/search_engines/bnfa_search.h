@@ -142,6 +142,22 @@ struct bnfa_struct_t
 
     int bnfaForceFullZeroState;
 
+    // prefilter of bytes that leave the root state; see bnfaBuildStartSet()
+    uint8_t bnfaStartSet[BNFA_MAX_ALPHABET_SIZE / 8];
+    uint8_t bnfaStartLo[16];
+    uint8_t bnfaStartHi[16];
+    unsigned bnfaStartCount;
+
+    // transition list shared with other instances built from the same
+    // patterns; see bnfaCompileFsm()
+    struct bnfa_fsm_t* bnfaFsm;
+    int bnfaShared;
+    unsigned bnfaTransWords;
+
+    // directory for compiled fsm snapshots or null; see bnfaSetCacheDir()
+    const char* bnfaCacheDir;
+    int bnfaCached;
+
     int bnfa_memory;
     int pat_memory;
     int list_memory;
@@ -160,6 +176,10 @@ bnfa_struct_t* bnfaNew(const MpseAgent*);
 
 void bnfaSetOpt(bnfa_struct_t* p, int flag);
 void bnfaSetCase(bnfa_struct_t* p, int flag);
+
+// load the compiled fsm from dir if a snapshot for the same patterns and
+// options is there, else save one after compiling.  dir must outlive p.
+void bnfaSetCacheDir(bnfa_struct_t* p, const char* dir);
 void bnfaFree(bnfa_struct_t* pstruct);
 
 int bnfaAddPattern(
@@ -167,11 +187,22 @@ int bnfaAddPattern(
     bool nocase, bool negative, void* userdata);
 
 int bnfaCompile(struct SnortConfig*, bnfa_struct_t*);
+int bnfaCompileFsm(bnfa_struct_t*);
+void bnfaCompileTrees(struct SnortConfig*, bnfa_struct_t*);
 
 unsigned _bnfa_search_csparse_nfa(
     bnfa_struct_t * pstruct, const uint8_t* t, int tlen, MpseMatch,
     void* context, unsigned sindex, int* current_state);
 
+// same as above but uses the best available simd prefilter to skip bytes
+// that can't leave the root state
+unsigned _bnfa_search_csparse_nfa_skip(
+    bnfa_struct_t * pstruct, const uint8_t* t, int tlen, MpseMatch,
+    void* context, unsigned sindex, int* current_state);
+
+// select the prefilter kernel by cpu features; returns the kernel name
+const char* bnfa_init_simd();
+
 int bnfaPatternCount(bnfa_struct_t* p);
 
 void bnfaPrint(bnfa_struct_t* pstruct);   /* prints the nfa states-verbose!! */
@@ -24,17 +24,46 @@
 #include <ctype.h>
 #include <string.h>
 
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include <hs_compile.h>
 #include <hs_runtime.h>
 
+#include "detection/fp_config.h"
+#include "flow/flow.h"
+#include "framework/module.h"
 #include "framework/mpse.h"
+#include "hash/hashes.h"
 #include "log/messages.h"
 #include "main/snort_config.h"
 #include "utils/stats.h"
 
+#define s_name "hyperscan"
+#define s_help "intel hyperscan-based mpse with regex support"
+
+struct HyperscanConfig
+{
+    std::string cache_dir;
+    bool stream = false;
+};
+
+struct HyperscanStats
+{
+    PegCount streams;
+    PegCount stream_scans;
+};
+
+// databases may be compiled on several threads at once
+static std::atomic<uint64_t> cache_hits(0);
+static std::atomic<uint64_t> cache_misses(0);
+
+static THREAD_LOCAL HyperscanStats hs_stats;
+
 struct Pattern
 {
     std::string pat;
@@ -91,6 +120,120 @@ typedef std::vector<Pattern> PatternVector;
 // a prototype that is large enough for all uses.
 
 static hs_scratch_t* s_scratch = nullptr;
+static std::mutex s_scratch_mutex;
+
+//-------------------------------------------------------------------------
+// module
+//-------------------------------------------------------------------------
+
+static const Parameter s_params[] =
+{
+    { "cache_dir", Parameter::PT_STRING, nullptr, nullptr,
+      "directory for serialized pattern databases; reused when patterns, flags, "
+      "hyperscan version and cpu features have not changed" },
+
+    { "stream", Parameter::PT_BOOL, nullptr, "false",
+      "also compile streaming databases to search consecutive stream and body "
+      "buffers incrementally" },
+
+    { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
+};
+
+static const PegInfo hs_pegs[] =
+{
+    { "streams", "hyperscan streams opened" },
+    { "stream scans", "incremental searches of stream buffers" },
+    { nullptr, nullptr }
+};
+
+class HyperscanModule : public Module
+{
+public:
+    HyperscanModule() : Module(s_name, s_help, s_params) { }
+
+    bool set(const char*, Value&, SnortConfig*) override;
+
+    const PegInfo* get_pegs() const override
+    { return hs_pegs; }
+
+    PegCount* get_counts() const override
+    { return (PegCount*)&hs_stats; }
+
+    const HyperscanConfig& get_config() const
+    { return config; }
+
+private:
+    HyperscanConfig config;
+};
+
+bool HyperscanModule::set(const char*, Value& v, SnortConfig*)
+{
+    if ( v.is("cache_dir") )
+        config.cache_dir = v.get_string();
+
+    else if ( v.is("stream") )
+        config.stream = v.get_bool();
+
+    else
+        return false;
+
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// flow data
+//-------------------------------------------------------------------------
+
+// streams are keyed by the mpse instance and direction.  the instance id
+// is never reused so a stream opened against a database freed by reload
+// is never scanned again; closing without a callback just frees it.
+
+class HyperscanFlowData : public FlowData
+{
+public:
+    HyperscanFlowData() : FlowData(flow_id) { }
+    ~HyperscanFlowData();
+
+    hs_stream_t** get_stream(unsigned instance, bool c2s);
+
+    static void init()
+    {
+        if ( !flow_id )
+            flow_id = FlowData::get_flow_id();
+    }
+
+public:
+    static unsigned flow_id;
+
+private:
+    struct Stream
+    {
+        unsigned instance;
+        bool c2s;
+        hs_stream_t* hs;
+    };
+    std::vector<Stream> streams;
+};
+
+unsigned HyperscanFlowData::flow_id = 0;
+
+HyperscanFlowData::~HyperscanFlowData()
+{
+    for ( auto& s : streams )
+        hs_close_stream(s.hs, nullptr, nullptr, nullptr);
+}
+
+hs_stream_t** HyperscanFlowData::get_stream(unsigned instance, bool c2s)
+{
+    for ( auto& s : streams )
+    {
+        if ( s.instance == instance and s.c2s == c2s )
+            return &s.hs;
+    }
+    Stream s = { instance, c2s, nullptr };
+    streams.push_back(s);
+    return &streams.back().hs;
+}
 
 //-------------------------------------------------------------------------
 // mpse
@@ -99,10 +242,19 @@ static hs_scratch_t* s_scratch = nullptr;
 class HyperscanMpse : public Mpse
 {
 public:
-    HyperscanMpse(SnortConfig*, bool use_gc, const MpseAgent* a)
+    HyperscanMpse(SnortConfig* sc, const HyperscanConfig* c, bool use_gc, const MpseAgent* a)
         : Mpse("hyperscan", use_gc)
     {
+        if ( c )
+            config = *c;
+
+        // search_engine.cache_dir is the default for all engines
+        if ( config.cache_dir.empty() and sc and sc->fast_pattern_config and
+            sc->fast_pattern_config->get_cache_dir() )
+            config.cache_dir = sc->fast_pattern_config->get_cache_dir();
+
         agent = a;
+        instance = ++next_instance;
         ++instances;
     }
 
@@ -111,6 +263,9 @@ public:
         if ( hs_db )
             hs_free_database(hs_db);
 
+        if ( hs_stream_db )
+            hs_free_database(hs_stream_db);
+
         user_dtor();
     }
 
@@ -126,8 +281,19 @@ public:
 
     int prep_patterns(SnortConfig*) override;
 
+    bool can_build_async() override
+    { return true; }
+
+    int build_fsm(SnortConfig*) override;
+    int build_trees(SnortConfig*) override;
+
     int _search(const uint8_t*, int, MpseMatch, void*, int*) override;
 
+    int _search_stream(Flow*, bool, const uint8_t*, int, MpseMatch, void*) override;
+
+    bool can_stream() override
+    { return hs_stream_db != nullptr; }
+
     int get_pattern_count() override
     { return pvector.size(); }
 
@@ -141,19 +307,30 @@ private:
     void user_ctor(SnortConfig*);
     void user_dtor();
 
+    bool compile(unsigned mode, hs_database_t**);
+    std::string get_cache_file(unsigned mode);
+    bool load_cache(const std::string&, hs_database_t**);
+    void save_cache(const std::string&, const hs_database_t*);
+
+    HyperscanConfig config;
     const MpseAgent* agent;
     PatternVector pvector;
 
     hs_database_t* hs_db = nullptr;
+    hs_database_t* hs_stream_db = nullptr;
+    unsigned instance;
 
     MpseMatch match_cb = nullptr;
     void* match_ctx = nullptr;
 
+    static unsigned next_instance;
+
 public:
     static uint64_t instances;
     static uint64_t patterns;
 };
 
+unsigned HyperscanMpse::next_instance = 0;
 uint64_t HyperscanMpse::instances = 0;
 uint64_t HyperscanMpse::patterns = 0;
 
@@ -193,8 +370,101 @@ void HyperscanMpse::user_dtor()
     }
 }
 
-int HyperscanMpse::prep_patterns(SnortConfig* sc)
+// the cache key covers everything that affects the compiled database:
+// the library version, target platform, mode, and each pattern with its
+// flags in id order.
+std::string HyperscanMpse::get_cache_file(unsigned mode)
 {
+    hs_platform_info_t plat;
+    memset(&plat, 0, sizeof(plat));
+    hs_populate_platform(&plat);
+
+    std::ostringstream key;
+    key << hs_version() << '|' << plat.tune << '|' << plat.cpu_features << '|' << mode;
+
+    for ( auto& p : pvector )
+        key << '|' << p.no_case << ':' << p.pat.size() << ':' << p.pat;
+
+    std::string k = key.str();
+    uint8_t digest[SHA256_HASH_SIZE];
+    sha256((const unsigned char*)k.c_str(), k.size(), digest);
+
+    std::string file = config.cache_dir + "/";
+
+    for ( unsigned i = 0; i < sizeof(digest); ++i )
+    {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02x", digest[i]);
+        file += hex;
+    }
+    return file + ".hsdb";
+}
+
+bool HyperscanMpse::load_cache(const std::string& file, hs_database_t** db)
+{
+    std::ifstream fs(file, std::ios_base::binary);
+
+    if ( !fs )
+        return false;
+
+    std::string bytes((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+
+    if ( bytes.empty() )
+        return false;
+
+    if ( hs_deserialize_database(bytes.data(), bytes.size(), db) != HS_SUCCESS )
+    {
+        *db = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// failure to save is not fatal; the database is just compiled next time
+void HyperscanMpse::save_cache(const std::string& file, const hs_database_t* db)
+{
+    char* bytes = nullptr;
+    size_t len = 0;
+
+    if ( hs_serialize_database(db, &bytes, &len) != HS_SUCCESS )
+        return;
+
+    // write to a temporary and rename so readers never see a partial file
+    std::string tmp = file + ".tmp";
+    std::ofstream fs(tmp, std::ios_base::binary | std::ios_base::trunc);
+
+    if ( fs.write(bytes, len) )
+    {
+        fs.close();
+
+        if ( rename(tmp.c_str(), file.c_str()) )
+            remove(tmp.c_str());
+    }
+    else
+    {
+        fs.close();
+        remove(tmp.c_str());
+        WarningMessage("hyperscan: can't write cache file %s\n", file.c_str());
+    }
+    free(bytes);
+}
+
+bool HyperscanMpse::compile(unsigned mode, hs_database_t** db)
+{
+    std::string file;
+
+    if ( !config.cache_dir.empty() )
+    {
+        file = get_cache_file(mode);
+
+        if ( load_cache(file, db) )
+        {
+            ++cache_hits;
+            return true;
+        }
+        ++cache_misses;
+    }
+
     hs_compile_error_t* errptr = nullptr;
     std::vector<const char*> pats;
     std::vector<unsigned> flags;
@@ -209,21 +479,65 @@ int HyperscanMpse::prep_patterns(SnortConfig* sc)
         ids.push_back(id++);
     }
 
-    if ( hs_compile_multi(&pats[0], &flags[0], &ids[0], pvector.size(), HS_MODE_BLOCK,
-            nullptr, &hs_db, &errptr) or !hs_db )
+    if ( hs_compile_multi(&pats[0], &flags[0], &ids[0], pvector.size(), mode,
+            nullptr, db, &errptr) or !*db )
     {
         // FIXIT-L emit data from errptr
         ParseError("can't compile pattern database '%s'", "hs_compile_multi");
         hs_free_compile_error(errptr);
+        return false;
+    }
+
+    if ( !file.empty() )
+        save_cache(file, *db);
+
+    return true;
+}
+
+int HyperscanMpse::prep_patterns(SnortConfig* sc)
+{
+    if ( int ret = build_fsm(sc) )
+        return ret;
+
+    return build_trees(sc);
+}
+
+int HyperscanMpse::build_fsm(SnortConfig*)
+{
+    if ( pvector.empty() or !compile(HS_MODE_BLOCK, &hs_db) )
+    {
+        if ( pvector.empty() )
+            ParseError("can't compile pattern database '%s'", "hs_compile_multi");
         return -1;
     }
 
+    std::lock_guard<std::mutex> lock(s_scratch_mutex);
+
     if ( hs_error_t err = hs_alloc_scratch(hs_db, &s_scratch) )
     {
         ParseError("can't allocate search scratch space (%d)", err);
         return -2;
     }
 
+    if ( config.stream )
+    {
+        if ( !compile(HS_MODE_STREAM, &hs_stream_db) )
+            return -1;
+
+        if ( hs_error_t err = hs_alloc_scratch(hs_stream_db, &s_scratch) )
+        {
+            ParseError("can't allocate search scratch space (%d)", err);
+            return -2;
+        }
+    }
+    return 0;
+}
+
+int HyperscanMpse::build_trees(SnortConfig* sc)
+{
+    if ( hs_stream_db )
+        HyperscanFlowData::init();
+
     user_ctor(sc);
     return 0;
 }
@@ -262,6 +576,52 @@ int HyperscanMpse::_search(
     return 0;
 }
 
+// the stream is opened on the first buffer in each direction and scanned
+// incrementally after that.  offsets reported to the match callback are
+// relative to the stream so they are only good for ordering hits.
+int HyperscanMpse::_search_stream(
+    Flow* flow, bool c2s, const uint8_t* buf, int n, MpseMatch mf, void* pv)
+{
+    if ( !hs_stream_db or !flow )
+    {
+        int state = 0;
+        return _search(buf, n, mf, pv, &state);
+    }
+
+    HyperscanFlowData* fd = (HyperscanFlowData*)
+        flow->get_application_data(HyperscanFlowData::flow_id);
+
+    if ( !fd )
+    {
+        fd = new HyperscanFlowData;
+        flow->set_application_data(fd);
+    }
+
+    hs_stream_t** hs = fd->get_stream(instance, c2s);
+
+    if ( !*hs )
+    {
+        if ( hs_open_stream(hs_stream_db, 0, hs) != HS_SUCCESS )
+        {
+            int state = 0;
+            return _search(buf, n, mf, pv, &state);
+        }
+        hs_stats.streams++;
+    }
+
+    match_cb = mf;
+    match_ctx = pv;
+
+    SnortState* ss = snort_conf->state + get_instance_id();
+    assert(ss->hyperscan_scratch);
+
+    hs_scan_stream(*hs, (const char*)buf, n, 0, (hs_scratch_t*)ss->hyperscan_scratch,
+        HyperscanMpse::match, this);
+
+    hs_stats.stream_scans++;
+    return 0;
+}
+
 //-------------------------------------------------------------------------
 // public methods
 //-------------------------------------------------------------------------
@@ -302,10 +662,17 @@ void hyperscan_cleanup(SnortConfig* sc)
 // api
 //-------------------------------------------------------------------------
 
+static Module* mod_ctor()
+{ return new HyperscanModule; }
+
+static void mod_dtor(Module* p)
+{ delete p; }
+
 static Mpse* hs_ctor(
-    SnortConfig* sc, class Module*, bool use_gc, const MpseAgent* a)
+    SnortConfig* sc, class Module* m, bool use_gc, const MpseAgent* a)
 {
-    return new HyperscanMpse(sc, use_gc, a);
+    const HyperscanConfig* c = m ? &((HyperscanModule*)m)->get_config() : nullptr;
+    return new HyperscanMpse(sc, c, use_gc, a);
 }
 
 static void hs_dtor(Mpse* p)
@@ -317,12 +684,15 @@ static void hs_init()
 {
     HyperscanMpse::instances = 0;
     HyperscanMpse::patterns = 0;
+    cache_hits = cache_misses = 0;
 }
 
 static void hs_print()
 {
     LogCount("instances", HyperscanMpse::instances);
     LogCount("patterns", HyperscanMpse::patterns);
+    LogCount("cache hits", cache_hits);
+    LogCount("cache misses", cache_misses);
 }
 
 static const MpseApi hs_api =
@@ -334,10 +704,10 @@ static const MpseApi hs_api =
         0,
         API_RESERVED,
         API_OPTIONS,
-        "hyperscan",
-        "intel hyperscan-based mpse with regex support",
-        nullptr,
-        nullptr
+        s_name,
+        s_help,
+        mod_ctor,
+        mod_dtor
     },
     false,
     nullptr,  // activate
@@ -0,0 +1,265 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// literal.cc - brute force search for a handful of patterns
+//
+// a state machine for 1 or 2 patterns costs far more memory than the
+// patterns themselves.  this just keeps the patterns and checks each one
+// at every position that starts with one of their first bytes.  like
+// ac_bnfa, all matching is case insensitive and the rule trees sort out
+// case sensitive patterns.
+
+#include <ctype.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "framework/mpse.h"
+#include "log/messages.h"
+#include "main/snort_types.h"
+#include "utils/stats.h"
+
+#define s_name "literal"
+
+#define s_help \
+    "brute force search (lowest memory, for very small pattern sets)"
+
+//-------------------------------------------------------------------------
+// literal
+//-------------------------------------------------------------------------
+
+struct LiteralPattern
+{
+    std::string pat;    // upper case
+    void* user;         // first user for the match callback
+    void* tree = nullptr;
+    void* neg_list = nullptr;
+
+    std::vector<void*> users;
+    std::vector<bool> negated;
+};
+
+class LiteralMpse : public Mpse
+{
+public:
+    LiteralMpse(SnortConfig*, bool use_gc, const MpseAgent* a)
+        : Mpse(s_name, use_gc)
+    {
+        agent = a;
+        memset(first, 0, sizeof(first));
+        instances++;
+    }
+
+    ~LiteralMpse();
+
+    int add_pattern(
+        SnortConfig*, const uint8_t* P, unsigned m,
+        const PatternDescriptor& desc, void* user) override;
+
+    int prep_patterns(SnortConfig*) override;
+
+    int _search(const uint8_t*, int, MpseMatch, void*, int*) override;
+
+    int get_pattern_count() override
+    { return pats.size(); }
+
+    int print_info() override
+    {
+        LogMessage("literal: %u unique patterns\n", (unsigned)pats.size());
+        return 0;
+    }
+
+public:
+    static uint64_t instances;
+    static uint64_t patterns;
+
+private:
+    const MpseAgent* agent;
+    std::vector<LiteralPattern> pats;
+    bool first[256];
+};
+
+uint64_t LiteralMpse::instances = 0;
+uint64_t LiteralMpse::patterns = 0;
+
+LiteralMpse::~LiteralMpse()
+{
+    if ( !agent )
+        return;
+
+    for ( auto& p : pats )
+    {
+        if ( p.tree )
+            agent->tree_free(&p.tree);
+
+        if ( p.neg_list )
+            agent->list_free(&p.neg_list);
+
+        for ( auto u : p.users )
+            agent->user_free(u);
+    }
+}
+
+int LiteralMpse::add_pattern(
+    SnortConfig*, const uint8_t* P, unsigned m, const PatternDescriptor& desc, void* user)
+{
+    if ( !m )
+        return -1;
+
+    std::string s((const char*)P, m);
+
+    for ( auto& c : s )
+        c = toupper((uint8_t)c);
+
+    LiteralPattern* lp = nullptr;
+
+    for ( auto& p : pats )
+    {
+        if ( p.pat == s )
+        {
+            lp = &p;
+            break;
+        }
+    }
+
+    if ( !lp )
+    {
+        pats.push_back(LiteralPattern());
+        lp = &pats.back();
+        lp->pat = s;
+        lp->user = user;
+    }
+    lp->users.push_back(user);
+    lp->negated.push_back(desc.negated);
+
+    patterns++;
+    return 0;
+}
+
+int LiteralMpse::prep_patterns(SnortConfig* sc)
+{
+    for ( auto& p : pats )
+    {
+        uint8_t c = p.pat[0];
+        first[c] = first[tolower(c)] = true;
+
+        if ( !agent )
+            continue;
+
+        for ( unsigned i = 0; i < p.users.size(); ++i )
+        {
+            if ( p.negated[i] )
+                agent->negate_list(p.users[i], &p.neg_list);
+            else
+                agent->build_tree(sc, p.users[i], &p.tree);
+        }
+        agent->build_tree(sc, nullptr, &p.tree);
+    }
+    return 0;
+}
+
+int LiteralMpse::_search(
+    const uint8_t* T, int n, MpseMatch match, void* context, int* current_state)
+{
+    int nfound = 0;
+    *current_state = 0;
+
+    for ( int i = 0; i < n; ++i )
+    {
+        if ( !first[T[i]] )
+            continue;
+
+        for ( auto& p : pats )
+        {
+            unsigned len = p.pat.size();
+
+            if ( len > (unsigned)(n - i) )
+                continue;
+
+            unsigned j = 0;
+
+            while ( j < len and toupper(T[i + j]) == (uint8_t)p.pat[j] )
+                ++j;
+
+            if ( j < len )
+                continue;
+
+            nfound++;
+
+            if ( match(p.user, p.tree, i + len, context, p.neg_list) > 0 )
+                return nfound;
+        }
+    }
+    return nfound;
+}
+
+//-------------------------------------------------------------------------
+// api
+//-------------------------------------------------------------------------
+
+static Mpse* lit_ctor(
+    SnortConfig* sc, class Module*, bool use_gc, const MpseAgent* agent)
+{
+    return new LiteralMpse(sc, use_gc, agent);
+}
+
+static void lit_dtor(Mpse* p)
+{
+    delete p;
+}
+
+static void lit_init()
+{
+    LiteralMpse::instances = 0;
+    LiteralMpse::patterns = 0;
+}
+
+static void lit_print()
+{
+    LogCount("instances", LiteralMpse::instances);
+    LogCount("patterns", LiteralMpse::patterns);
+}
+
+static const MpseApi lit_api =
+{
+    {
+        PT_SEARCH_ENGINE,
+        sizeof(MpseApi),
+        SEAPI_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        s_name,
+        s_help,
+        nullptr,
+        nullptr
+    },
+    false,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    lit_ctor,
+    lit_dtor,
+    lit_init,
+    lit_print,
+};
+
+const BaseApi* se_literal = &lit_api.base;
+
@@ -31,8 +31,13 @@ struct PatMatQStat
     PegCount tot_inq_flush;
     PegCount tot_inq_inserts;
     PegCount tot_inq_uinserts;
+    PegCount tot_inq_dups;
+    PegCount max_inq_capacity;
     PegCount non_qualified_events;
     PegCount qualified_events;
+    PegCount batched_searches;
+    PegCount batch_flushes;
+    PegCount async_searches;
 };
 
 SO_PUBLIC extern THREAD_LOCAL PatMatQStat pmqs;
@@ -25,6 +25,8 @@
 struct BaseApi;
 
 extern const BaseApi* se_ac_bnfa;
+extern const BaseApi* se_ac_bnfa_simd;
+extern const BaseApi* se_literal;
 
 #ifdef INTEL_SOFT_CPM
 extern const BaseApi* se_intel_cpm;
@@ -45,6 +47,8 @@ extern const BaseApi* se_ac_std;
 const BaseApi* search_engines[] =
 {
     se_ac_bnfa,
+    se_ac_bnfa_simd,
+    se_literal,
 
 #ifdef INTEL_SOFT_CPM
     se_intel_cpm,
@@ -22,7 +22,9 @@
 
 #include <string.h>
 
+#include "flow/flow.h"
 #include "framework/base_api.h"
+#include "framework/module.h"
 #include "framework/mpse.h"
 #include "main/snort_config.h"
 
@@ -50,6 +52,18 @@ int Mpse::search_all(
     return _search(T, n, match, context, current_state);
 }
 
+int Mpse::_search_batch(const SearchItem*, unsigned, MpseMatch)
+{ return 0; }
+
+int Mpse::_search_stream(Flow*, bool, const uint8_t*, int, MpseMatch, void*)
+{ return 0; }
+
+void Mpse::_submit(SearchJob&)
+{ }
+
+bool Mpse::_poll(SearchJob&, bool)
+{ return true; }
+
 uint64_t Mpse::get_pattern_byte_count()
 { return 0; }
 
@@ -71,6 +85,12 @@ void ParseError(const char*, ...)
 void LogCount(char const*, uint64_t, FILE*)
 { }
 
+void WarningMessage(const char*, ...)
+{ }
+
+void sha256(const unsigned char*, size_t, unsigned char*)
+{ }
+
 static int match(
     void* /*user*/, void* /*tree*/, int /*index*/, void* /*context*/, void* /*list*/)
 { ++hits; return 0; }
@@ -117,6 +137,22 @@ static MpseAgent s_agent =
 
 FileIdentifier::~FileIdentifier() { }
 
+Module::Module(const char*, const char*, const Parameter*, bool) { }
+void Module::sum_stats() { }
+void Module::show_interval_stats(IndexVec&, FILE*) { }
+void Module::show_stats() { }
+void Module::reset_stats() { }
+
+unsigned FlowData::flow_id = 0;
+FlowData::FlowData(unsigned, Inspector*) { }
+FlowData::~FlowData() { }
+
+FlowData* Flow::get_application_data(unsigned)
+{ return nullptr; }
+
+int Flow::set_application_data(FlowData*)
+{ return 0; }
+
 FileVerdict FilePolicy::type_lookup(Flow*, FileContext*)
 { return FILE_VERDICT_UNKNOWN; }
 
@@ -151,6 +151,18 @@ int Mpse::search_all(
     return _search(T, n, match, context, current_state);
 }
 
+int Mpse::_search_batch(const SearchItem*, unsigned, MpseMatch)
+{ return 0; }
+
+int Mpse::_search_stream(Flow*, bool, const uint8_t*, int, MpseMatch, void*)
+{ return 0; }
+
+void Mpse::_submit(SearchJob&)
+{ }
+
+bool Mpse::_poll(SearchJob&, bool)
+{ return true; }
+
 uint64_t Mpse::get_pattern_byte_count()
 { return 0; }
 
@@ -1413,6 +1413,22 @@ static DCE2_Ret dce_co_handle_frag(DCE2_SsnData* sd, DCE2_CoTracker* cot,
         DCE2_BufferEmpty(frag_buf);
     }
 
+    /* On a first frag size the buffer from the alloc hint so the stub
+     * doesn't get copied again on every fragment that follows.  The hint
+     * is at the same offset in requests and responses. */
+    if (DceRpcCoFirstFrag(co_hdr) && !DceRpcCoLastFrag(co_hdr))
+    {
+        const DceRpcCoRequest* cor =
+            (const DceRpcCoRequest*)((const uint8_t*)co_hdr + sizeof(DceRpcCoHdr));
+        uint32_t hint = DceRpcNtohl(&cor->alloc_hint, DceRpcCoByteOrder(co_hdr));
+
+        if (hint > max_frag_data)
+            hint = max_frag_data;
+
+        if (hint > frag_len)
+            (void)DCE2_BufferReserve(frag_buf, hint);
+    }
+
     /* Check for potential overflow */
     if (DCE2_GcMaxFrag((dce2CommonProtoConf*)sd->config) && (frag_len > DCE2_GcMaxFragLen(
         (dce2CommonProtoConf*)sd->config)))
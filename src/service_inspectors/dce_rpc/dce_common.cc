@@ -92,6 +92,9 @@ bool dce2_set_common_config(Value& v, dce2CommonProtoConf& common)
 
     else if ( v.is("policy") )
         common.policy = (DCE2_Policy)v.get_long();
+
+    else if ( v.is("memcap") )
+        common.memcap = v.get_long();
     else
         return false;
     return true;
@@ -106,6 +109,8 @@ void print_dce2_common_config(dce2CommonProtoConf& common)
         common.max_frag_len);
     LogMessage("    Policy : %s\n",
         dce2_get_policy_name(common.policy));
+    LogMessage("    Reassembly memcap : " STDi64 "\n",
+        common.memcap);
 }
 
 bool dce2_paf_abort(Flow* flow, DCE2_SsnData* sd)
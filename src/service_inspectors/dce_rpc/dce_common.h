@@ -104,6 +104,7 @@ struct dce2CommonProtoConf
     bool disable_defrag;
     int max_frag_len;
     DCE2_Policy policy;
+    int64_t memcap;
 };
 
 #define DCE2_DEBUG__PAF_END_MSG    "=========================================================="
@@ -3039,6 +3039,7 @@ void Dce2Smb::eval(Packet* p)
         return;
     }
 
+    DCE2_BufferSetMemcap(config.common.memcap);
     dce2_smb_sess = dce2_handle_smb_session(p, &config);
     if (dce2_smb_sess)
     {
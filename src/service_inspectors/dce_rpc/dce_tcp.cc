@@ -200,6 +200,7 @@ void Dce2Tcp::eval(Packet* p)
         return;
     }
 
+    DCE2_BufferSetMemcap(config.common.memcap);
     dce2_tcp_sess = dce2_handle_tcp_session(p, &config);
 
     if (dce2_tcp_sess)
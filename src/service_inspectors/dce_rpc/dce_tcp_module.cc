@@ -32,6 +32,8 @@ static const Parameter s_params[] =
       " Disable DCE/RPC defragmentation" },
     { "max_frag_len", Parameter::PT_INT, "1514:65535", "65535",
       " Maximum fragment size for defragmentation" },
+    { "memcap", Parameter::PT_INT, "0:", "0",
+      " Maximum bytes of reassembly buffers per packet thread (0 is unlimited)" },
     { "reassemble_threshold", Parameter::PT_INT, "0:65535", "0",
       " Minimum bytes received before performing reassembly" },
     { "policy", Parameter::PT_ENUM,
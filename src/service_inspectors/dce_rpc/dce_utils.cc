@@ -19,6 +19,7 @@
 
 #include "dce_utils.h"
 #include "main/snort_debug.h"
+#include "main/thread.h"
 #include "utils/util.h"
 #include "utils/safec.h"
 
@@ -310,14 +311,38 @@ void DCE2_PrintPktData(const uint8_t*, const uint16_t)
 
 #endif // DEBUG_MSGS
 
+// Bytes held by reassembly buffers on this thread and the limit set by the
+// current inspector.  A memcap of 0 means no limit.
+static THREAD_LOCAL uint64_t dce2_buffer_memory = 0;
+static THREAD_LOCAL uint64_t dce2_buffer_memcap = 0;
+
+static inline bool DCE2_BufferMemOk(uint32_t add_size)
+{
+    return (dce2_buffer_memcap == 0) || (dce2_buffer_memory + add_size <= dce2_buffer_memcap);
+}
+
+void DCE2_BufferSetMemcap(uint64_t memcap)
+{
+    dce2_buffer_memcap = memcap;
+}
+
+uint64_t DCE2_BufferMemory()
+{
+    return dce2_buffer_memory;
+}
+
 DCE2_Buffer* DCE2_BufferNew(uint32_t initial_size, uint32_t min_add_size)
 {
     DCE2_Buffer* buf = (DCE2_Buffer*)snort_calloc(sizeof(DCE2_Buffer));
 
-    if (initial_size != 0)
+    // Over the memcap the buffer starts out empty and the first add fails
+    if ((initial_size != 0) && DCE2_BufferMemOk(initial_size))
+    {
         buf->data = (uint8_t*)snort_calloc(initial_size);
+        buf->size = initial_size;
+        dce2_buffer_memory += initial_size;
+    }
 
-    buf->size = initial_size;
     buf->len = 0;
     buf->min_add_size = min_add_size;
     buf->offset = 0;
@@ -327,7 +352,7 @@ DCE2_Buffer* DCE2_BufferNew(uint32_t initial_size, uint32_t min_add_size)
 
 void* DCE2_ReAlloc(void* old_mem, uint32_t old_size, uint32_t new_size)
 {
-    void* new_mem;
+    uint8_t* new_mem;
 
     if (old_mem == nullptr)
     {
@@ -343,15 +368,48 @@ void* DCE2_ReAlloc(void* old_mem, uint32_t old_size, uint32_t new_size)
         return old_mem;
     }
 
-    new_mem = snort_calloc(new_size);
+    // Only the new tail needs clearing; the rest is copied over
+    new_mem = (uint8_t*)snort_alloc(new_size);
 
     memcpy_s(new_mem, new_size, old_mem, old_size);
+    memset(new_mem + old_size, 0, new_size - old_size);
 
     snort_free(old_mem);
 
     return new_mem;
 }
 
+// Make room for at least size bytes.  Used when the total is known up front
+// so the pieces that follow are appended without reallocating.
+DCE2_Ret DCE2_BufferReserve(DCE2_Buffer* buf, uint32_t size)
+{
+    if (buf == nullptr)
+        return DCE2_RET__ERROR;
+
+    if (size <= buf->size)
+        return DCE2_RET__SUCCESS;
+
+    if (!DCE2_BufferMemOk(size - buf->size))
+        return DCE2_RET__MEMCAP;
+
+    if (buf->data == nullptr)
+    {
+        buf->data = (uint8_t*)snort_calloc(size);
+    }
+    else
+    {
+        uint8_t* tmp = (uint8_t*)DCE2_ReAlloc(buf->data, buf->size, size);
+        if (tmp == nullptr)
+            return DCE2_RET__ERROR;
+        buf->data = tmp;
+    }
+
+    dce2_buffer_memory += size - buf->size;
+    buf->size = size;
+
+    return DCE2_RET__SUCCESS;
+}
+
 DCE2_Ret DCE2_BufferAddData(DCE2_Buffer* buf, const uint8_t* data,
     uint32_t data_len, uint32_t data_offset, DCE2_BufferMinAddFlag mflag)
 {
@@ -362,31 +420,29 @@ DCE2_Ret DCE2_BufferAddData(DCE2_Buffer* buf, const uint8_t* data,
     if (data_len == 0)
         return DCE2_RET__SUCCESS;
 
-    if (buf->data == nullptr)
+    if ((data_offset + data_len) > buf->size)
     {
-        uint32_t size = data_offset + data_len;
+        uint32_t new_size = data_offset + data_len;
 
-        if ((size < buf->min_add_size) && (mflag == DCE2_BUFFER_MIN_ADD_FLAG__USE))
-            size = buf->min_add_size;
+        // Grow geometrically so a stream of small pieces is not copied
+        // over and over.  The minimum add flag is ignored when the caller
+        // knows this is the final size.
+        if (mflag == DCE2_BUFFER_MIN_ADD_FLAG__USE)
+        {
+            uint32_t grow = (buf->size > buf->min_add_size) ? buf->size : buf->min_add_size;
 
-        buf->data = (uint8_t*)snort_calloc(size);
-        buf->size = size;
-    }
-    else if ((data_offset + data_len) > buf->size)
-    {
-        uint8_t* tmp;
-        uint32_t new_size = data_offset + data_len;
+            if (new_size - buf->size < grow)
+                new_size = buf->size + grow;
+        }
 
-        if (((new_size - buf->size) < buf->min_add_size) && (mflag ==
-            DCE2_BUFFER_MIN_ADD_FLAG__USE))
-            new_size = buf->size + buf->min_add_size;
+        DCE2_Ret status = DCE2_BufferReserve(buf, new_size);
 
-        tmp = (uint8_t*)DCE2_ReAlloc(buf->data, buf->size, new_size);
-        if (tmp == nullptr)
-            return DCE2_RET__ERROR;
+        // Without the slack, fall back to exactly what is needed
+        if ((status == DCE2_RET__MEMCAP) && (new_size > data_offset + data_len))
+            status = DCE2_BufferReserve(buf, data_offset + data_len);
 
-        buf->data = tmp;
-        buf->size = new_size;
+        if (status != DCE2_RET__SUCCESS)
+            return status;
     }
 
     if (data_len > buf->size - data_offset)
@@ -406,7 +462,10 @@ void DCE2_BufferDestroy(DCE2_Buffer* buf)
         return;
 
     if (buf->data != nullptr)
+    {
         snort_free((void*)buf->data);
+        dce2_buffer_memory -= buf->size;
+    }
 
     snort_free((void*)buf);
 }
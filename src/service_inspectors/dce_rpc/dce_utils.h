@@ -131,9 +131,12 @@ const char* DCE2_UuidToStr(const Uuid*, DceRpcBoFlag);
 void DCE2_PrintPktData(const uint8_t*, const uint16_t);
 DCE2_Buffer* DCE2_BufferNew(uint32_t, uint32_t);
 void* DCE2_ReAlloc(void*, uint32_t, uint32_t);
+DCE2_Ret DCE2_BufferReserve(DCE2_Buffer*, uint32_t);
 DCE2_Ret DCE2_BufferAddData(DCE2_Buffer*, const uint8_t*,
     uint32_t, uint32_t, DCE2_BufferMinAddFlag);
 void DCE2_BufferDestroy(DCE2_Buffer* buf);
+void DCE2_BufferSetMemcap(uint64_t);
+uint64_t DCE2_BufferMemory();
 
 /********************************************************************
  * Function: DCE2_IsSpaceChar()
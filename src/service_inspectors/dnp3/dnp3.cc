@@ -208,6 +208,8 @@ public:
     void show(SnortConfig*) override;
     void eval(Packet*) override;
     bool get_buf(InspectionBuffer::Type, Packet*, InspectionBuffer&) override;
+    bool cacheable(InspectionBuffer::Type) override
+    { return true; }
     void clear(Packet*) override;
 
     StreamSplitter* get_splitter(bool c2s) override
@@ -245,10 +247,12 @@ void Dnp3::eval(Packet* p)
     process_dnp3(config, p);
 }
 
+// the reassembled application data is both the alt buffer searched with
+// raw packet patterns and the body buffer searched for dnp3_data patterns
 bool Dnp3::get_buf(
     InspectionBuffer::Type ibt, Packet* p, InspectionBuffer& b)
 {
-    if ( ibt != InspectionBuffer::IBT_ALT )
+    if ( ibt != InspectionBuffer::IBT_ALT and ibt != InspectionBuffer::IBT_BODY )
         return false;
 
     b.data = dnp3_get_alt_buffer(p,b.len);
@@ -144,7 +144,9 @@ enum dnp3_reassembly_state_t
 
 struct dnp3_reassembly_data_t
 {
-    uint8_t buffer[DNP3_BUFFER_SIZE];
+    // frames are compacted in place after the queued data so there is
+    // room for one more past the end
+    uint8_t buffer[DNP3_BUFFER_SIZE + DNP3_TPDU_MAX];
     uint16_t buflen = 0;
     dnp3_reassembly_state_t state = DNP3_REASSEMBLY_STATE__IDLE;
     uint8_t last_seq = 0;
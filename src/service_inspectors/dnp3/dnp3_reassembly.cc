@@ -64,22 +64,47 @@ static uint16_t crcLookUpTable[256] =
     0x91AF, 0xA7F1, 0xFD13, 0xCB4D, 0x48D7, 0x7E89, 0x246B, 0x1235
 };
 
-/* Append a DNP3 Transport segment to the reassembly buffer.
+/* Tables for computing the CRC 8 bytes at a time (slicing by 8).
+   t[0] is the table above and t[k] is t[k-1] advanced by one more
+   zero byte, so the 8 lookups for a slice can be done independently. */
+struct Dnp3CrcTables
+{
+    uint16_t t[8][256];
+
+    Dnp3CrcTables();
+};
+
+Dnp3CrcTables::Dnp3CrcTables()
+{
+    for ( unsigned i = 0; i < 256; ++i )
+        t[0][i] = crcLookUpTable[i];
+
+    for ( unsigned k = 1; k < 8; ++k )
+        for ( unsigned i = 0; i < 256; ++i )
+            t[k][i] = (t[k-1][i] >> 8) ^ t[0][t[k-1][i] & 0xFF];
+}
+
+static const Dnp3CrcTables crc_tables;
+
+/* Append a DNP3 Transport segment to the reassembly buffer.  The segment
+   was already compacted into the buffer at off; only a first segment that
+   interrupts an assembly has to be moved.
 
    Returns:
     true:    Segment queued successfully.
-    false:  Data copy failed. Segment did not fit in reassembly buffer.
+    false:  Segment did not fit in reassembly buffer.
 */
-static bool dnp3_queue_segment(dnp3_reassembly_data_t* rdata, char* buf, uint16_t buflen)
+static bool dnp3_queue_segment(dnp3_reassembly_data_t* rdata, uint16_t off, uint16_t buflen)
 {
-    if (rdata == NULL || buf == NULL)
+    if (rdata == NULL)
         return false;
 
     /* We checked for DNP3_MAX_TRANSPORT_LEN earlier. */
     if (buflen + rdata->buflen > DNP3_BUFFER_SIZE)
         return false;
 
-    memcpy((rdata->buffer + rdata->buflen), buf, (size_t)buflen);
+    if (off != rdata->buflen)
+        memmove((rdata->buffer + rdata->buflen), (rdata->buffer + off), (size_t)buflen);
 
     rdata->buflen += buflen;
     return true;
@@ -97,28 +122,23 @@ void dnp3_reassembly_reset(dnp3_reassembly_data_t* rdata)
 
    Arguments:
      rdata:     DNP3 reassembly state object.
-     buf:       DNP3 Transport Layer segment
-     buflen:    Length of Transport Layer segment.
+     control:   DNP3 Transport Layer header.
+     off:       Offset of the segment data in the reassembly buffer.
+     buflen:    Length of Transport Layer segment data.
 
    Returns:
     false:     Segment was discarded.
     true:       Segment was queued.
 */
-static bool dnp3_reassemble_transport(dnp3_reassembly_data_t* rdata, char* buf, uint16_t buflen)
+static bool dnp3_reassemble_transport(
+    dnp3_reassembly_data_t* rdata, uint8_t control, uint16_t off, uint16_t buflen)
 {
-    dnp3_transport_header_t* trans_header;
-
-    if (rdata == NULL || buf == NULL || buflen < sizeof(dnp3_transport_header_t) ||
-        (buflen > DNP3_MAX_TRANSPORT_LEN))
+    if (rdata == NULL ||
+        (buflen + sizeof(dnp3_transport_header_t) > DNP3_MAX_TRANSPORT_LEN))
     {
         return false;
     }
 
-    /* Take the first byte as a transport header, cut it off of the buffer. */
-    trans_header = (dnp3_transport_header_t*)buf;
-    buf += sizeof(dnp3_transport_header_t);
-    buflen -= sizeof(dnp3_transport_header_t);
-
     /* If the previously-existing state was DONE, we need to reset it back
        to IDLE. */
     if (rdata->state == DNP3_REASSEMBLY_STATE__DONE)
@@ -128,15 +148,15 @@ static bool dnp3_reassemble_transport(dnp3_reassembly_data_t* rdata, char* buf,
     {
     case DNP3_REASSEMBLY_STATE__IDLE:
         /* Discard any non-first segment. */
-        if ( DNP3_TRANSPORT_FIR(trans_header->control) == 0 )
+        if ( DNP3_TRANSPORT_FIR(control) == 0 )
             return false;
 
         /* Reset the buffer & queue the first segment */
         dnp3_reassembly_reset(rdata);
-        dnp3_queue_segment(rdata, buf, buflen);
-        rdata->last_seq = DNP3_TRANSPORT_SEQ(trans_header->control);
+        dnp3_queue_segment(rdata, off, buflen);
+        rdata->last_seq = DNP3_TRANSPORT_SEQ(control);
 
-        if ( DNP3_TRANSPORT_FIN(trans_header->control) )
+        if ( DNP3_TRANSPORT_FIN(control) )
             rdata->state = DNP3_REASSEMBLY_STATE__DONE;
         else
             rdata->state = DNP3_REASSEMBLY_STATE__ASSEMBLY;
@@ -145,13 +165,13 @@ static bool dnp3_reassemble_transport(dnp3_reassembly_data_t* rdata, char* buf,
 
     case DNP3_REASSEMBLY_STATE__ASSEMBLY:
         /* Reset if the FIR flag is set. */
-        if ( DNP3_TRANSPORT_FIR(trans_header->control) )
+        if ( DNP3_TRANSPORT_FIR(control) )
         {
             dnp3_reassembly_reset(rdata);
-            dnp3_queue_segment(rdata, buf, buflen);
-            rdata->last_seq = DNP3_TRANSPORT_SEQ(trans_header->control);
+            dnp3_queue_segment(rdata, off, buflen);
+            rdata->last_seq = DNP3_TRANSPORT_SEQ(control);
 
-            if (DNP3_TRANSPORT_FIN(trans_header->control))
+            if (DNP3_TRANSPORT_FIN(control))
                 rdata->state = DNP3_REASSEMBLY_STATE__DONE;
 
             /* Raise an alert so it's clear the buffer was reset.
@@ -161,8 +181,8 @@ static bool dnp3_reassemble_transport(dnp3_reassembly_data_t* rdata, char* buf,
         else
         {
             /* Same seq but FIN is set. Discard segment, BUT finish reassembly. */
-            if ((DNP3_TRANSPORT_SEQ(trans_header->control) == rdata->last_seq) &&
-                (DNP3_TRANSPORT_FIN(trans_header->control)))
+            if ((DNP3_TRANSPORT_SEQ(control) == rdata->last_seq) &&
+                (DNP3_TRANSPORT_FIN(control)))
             {
                 SnortEventqAdd(GID_DNP3, DNP3_DROPPED_SEGMENT);
                 rdata->state = DNP3_REASSEMBLY_STATE__DONE;
@@ -170,7 +190,7 @@ static bool dnp3_reassemble_transport(dnp3_reassembly_data_t* rdata, char* buf,
             }
 
             /* Discard any other segments without the correct sequence. */
-            if (DNP3_TRANSPORT_SEQ(trans_header->control) !=
+            if (DNP3_TRANSPORT_SEQ(control) !=
                 ((rdata->last_seq + 1) % 0x40 ))
             {
                 SnortEventqAdd(GID_DNP3, DNP3_DROPPED_SEGMENT);
@@ -178,10 +198,10 @@ static bool dnp3_reassemble_transport(dnp3_reassembly_data_t* rdata, char* buf,
             }
 
             /* Otherwise, queue it up! */
-            dnp3_queue_segment(rdata, buf, buflen);
-            rdata->last_seq = DNP3_TRANSPORT_SEQ(trans_header->control);
+            dnp3_queue_segment(rdata, off, buflen);
+            rdata->last_seq = DNP3_TRANSPORT_SEQ(control);
 
-            if (DNP3_TRANSPORT_FIN(trans_header->control))
+            if (DNP3_TRANSPORT_FIN(control))
                 rdata->state = DNP3_REASSEMBLY_STATE__DONE;
             else
                 rdata->state = DNP3_REASSEMBLY_STATE__ASSEMBLY;
@@ -247,84 +267,112 @@ static bool dnp3_process_application(dnp3_session_data_t* session)
     return true;
 }
 
-/* Check a CRC in a single block.
-   This code is mostly lifted from the example in the DNP3 spec. */
+/* Compute CRCs as in the example in the DNP3 spec but a slice of 8 bytes
+   at a time.  The crc is not inverted here. */
 
-static inline void compute_crc(unsigned char data, uint16_t* crcAccum)
+static inline uint16_t dnp3_crc_byte(uint16_t crc, uint8_t data)
 {
-    *crcAccum =
-        (*crcAccum >> 8) ^ crcLookUpTable[(*crcAccum ^ data) & 0xFF];
+    return (crc >> 8) ^ crc_tables.t[0][(crc ^ data) & 0xFF];
 }
 
-static bool dnp3_check_crc(unsigned char* buf, uint16_t buflen)
+/* Update crc over len bytes of src, copying them to dst if given. */
+static uint16_t dnp3_crc_copy(uint16_t crc, const uint8_t* src, uint8_t* dst, uint16_t len)
 {
-    uint16_t idx;
-    uint16_t crc = 0;
+    const auto& t = crc_tables.t;
+
+    while ( len >= 8 )
+    {
+        if ( dst )
+        {
+            memcpy(dst, src, 8);
+            dst += 8;
+        }
+        uint16_t x = crc ^ (src[0] | (src[1] << 8));
+
+        crc = t[7][x & 0xFF] ^ t[6][x >> 8] ^ t[5][src[2]] ^ t[4][src[3]] ^
+            t[3][src[4]] ^ t[2][src[5]] ^ t[1][src[6]] ^ t[0][src[7]];
+
+        src += 8;
+        len -= 8;
+    }
+    while ( len-- )
+    {
+        if ( dst )
+            *dst++ = *src;
+
+        crc = dnp3_crc_byte(crc, *src++);
+    }
+    return crc;
+}
 
-    /* Compute check code for data in received block */
-    for (idx = 0; idx < buflen-2; idx++)
-        compute_crc(buf[idx], &crc);
+/* Check the CRC at the end of a block. */
+static inline bool dnp3_crc_ok(uint16_t crc, const uint8_t* buf)
+{
     crc = ~crc; /* Invert */
 
-    /* Check CRC at end of block */
-    if (buf[idx++] == (unsigned char)crc &&
-        buf[idx] == (unsigned char)(crc >> 8))
-        return true;
-    else
-        return false;
+    return buf[0] == (uint8_t)crc && buf[1] == (uint8_t)(crc >> 8);
 }
 
-/* Check CRCs in a Link-Layer Frame, then fill a buffer containing just the user data  */
-static bool dnp3_check_remove_crc(dnp3ProtoConf& config, uint8_t* pdu_start,
-    uint16_t pdu_length, char* buf, uint16_t* buflen)
+/* Check CRCs in a Link-Layer Frame while compacting just the user data into
+   dst in the same pass.  The transport header is returned in control and is
+   not copied.  The frame itself is not modified. */
+static bool dnp3_check_remove_crc(dnp3ProtoConf& config, const uint8_t* pdu_start,
+    uint16_t pdu_length, uint8_t* dst, uint8_t& control, uint16_t& buflen)
 {
-    char* cursor;
+    const uint8_t* cursor;
     uint16_t bytes_left;
-    uint16_t curlen = 0;
+    uint16_t skip = sizeof(dnp3_transport_header_t);
 
     /* Check Header CRC */
     if ((config.check_crc) &&
-        (dnp3_check_crc((unsigned char*)pdu_start, sizeof(dnp3_link_header_t)+2) == false))
+        !dnp3_crc_ok(dnp3_crc_copy(0, pdu_start, nullptr, sizeof(dnp3_link_header_t)),
+        pdu_start + sizeof(dnp3_link_header_t)))
     {
         SnortEventqAdd(GID_DNP3, DNP3_BAD_CRC);
         return false;
     }
 
-    cursor = (char*)pdu_start + sizeof(dnp3_link_header_t) + 2;
-    bytes_left = pdu_length - sizeof(dnp3_link_header_t) - 2;
+    cursor = pdu_start + sizeof(dnp3_link_header_t) + DNP3_CRC_SIZE;
+    bytes_left = pdu_length - sizeof(dnp3_link_header_t) - DNP3_CRC_SIZE;
+    buflen = 0;
 
-    /* Process whole 16-byte chunks (plus 2-byte CRC) */
-    while ( (bytes_left > (DNP3_CHUNK_SIZE + DNP3_CRC_SIZE)) &&
-        (curlen + DNP3_CHUNK_SIZE < *buflen) )
+    /* Process 16-byte chunks (plus 2-byte CRC); the last may be shorter */
+    while ( bytes_left > DNP3_CRC_SIZE )
     {
-        if ((config.check_crc) &&
-            (dnp3_check_crc((unsigned char*)cursor, (DNP3_CHUNK_SIZE+DNP3_CRC_SIZE)) == false))
-        {
-            SnortEventqAdd(GID_DNP3, DNP3_BAD_CRC);
-            return false;
-        }
+        uint16_t chunk = bytes_left - DNP3_CRC_SIZE;
 
-        memcpy((buf + curlen), cursor, DNP3_CHUNK_SIZE);
-        curlen += DNP3_CHUNK_SIZE;
-        cursor += (DNP3_CHUNK_SIZE+DNP3_CRC_SIZE);
-        bytes_left -= (DNP3_CHUNK_SIZE+DNP3_CRC_SIZE);
-    }
-    /* Process leftover chunk, under 16 bytes */
-    if ( (bytes_left > DNP3_CRC_SIZE) &&
-        (curlen + bytes_left < *buflen) )
-    {
-        if ((config.check_crc) && (dnp3_check_crc((unsigned char*)cursor, bytes_left) == false))
+        if ( chunk > DNP3_CHUNK_SIZE )
+            chunk = DNP3_CHUNK_SIZE;
+
+        if ( buflen + chunk > DNP3_TPDU_MAX )
+            break;
+
+        if ( skip )
+            control = cursor[0];
+
+        if ( config.check_crc )
         {
-            SnortEventqAdd(GID_DNP3, DNP3_BAD_CRC);
-            return false;
+            uint16_t crc = skip ? dnp3_crc_byte(0, cursor[0]) : 0;
+            crc = dnp3_crc_copy(crc, cursor + skip, dst + buflen, chunk - skip);
+
+            if ( !dnp3_crc_ok(crc, cursor + chunk) )
+            {
+                SnortEventqAdd(GID_DNP3, DNP3_BAD_CRC);
+                return false;
+            }
         }
+        else
+            memcpy(dst + buflen, cursor + skip, chunk - skip);
 
-        memcpy((buf + curlen), cursor, (bytes_left - DNP3_CRC_SIZE));
-        curlen += (bytes_left - DNP3_CRC_SIZE);
+        buflen += chunk - skip;
+        skip = 0;
+
+        cursor += (chunk + DNP3_CRC_SIZE);
+        bytes_left -= (chunk + DNP3_CRC_SIZE);
     }
 
-    *buflen = curlen;
-    return true;
+    /* No transport header */
+    return !skip;
 }
 
 static bool dnp3_check_reserved_addrs(dnp3_link_header_t* link)
@@ -350,8 +398,8 @@ static bool dnp3_check_reserved_addrs(dnp3_link_header_t* link)
 bool dnp3_full_reassembly(dnp3ProtoConf& config, dnp3_session_data_t* session, Packet* packet,
     uint8_t* pdu_start, uint16_t pdu_length)
 {
-    char buf[DNP3_TPDU_MAX];
-    uint16_t buflen = sizeof(buf);
+    uint8_t control;
+    uint16_t buflen;
     dnp3_link_header_t* link;
     dnp3_reassembly_data_t* rdata;
 
@@ -379,17 +427,23 @@ bool dnp3_full_reassembly(dnp3ProtoConf& config, dnp3_session_data_t* session, P
 
     // FIXIT-L need to track separate dnp3 sessions over single tcp session
 
-    /* Step 2: Remove CRCs */
-    if ( dnp3_check_remove_crc(config, pdu_start, pdu_length, buf, &buflen) == false )
-        return false;
-
-    /* Step 3: Queue user data in frame for Transport-Layer reassembly */
     if (session->direction == DNP3_CLIENT)
         rdata = &(session->client_rdata);
     else
         rdata = &(session->server_rdata);
 
-    if (dnp3_reassemble_transport(rdata, buf, buflen) == false)
+    /* Step 2: Remove CRCs, compacting the user data into the reassembly
+       buffer after the data queued so far.  Anything else already there
+       is dropped by the transport layer if this segment is queued. */
+    uint16_t off =
+        (rdata->state == DNP3_REASSEMBLY_STATE__ASSEMBLY) ? rdata->buflen : 0;
+
+    if ( dnp3_check_remove_crc(
+        config, pdu_start, pdu_length, rdata->buffer + off, control, buflen) == false )
+        return false;
+
+    /* Step 3: Queue user data in frame for Transport-Layer reassembly */
+    if (dnp3_reassemble_transport(rdata, control, off, buflen) == false)
         return false;
 
     /* Step 4: Decode Application-Layer  */
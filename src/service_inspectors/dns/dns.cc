@@ -68,46 +68,42 @@ static void snort_dns(Packet* p);
 
 unsigned DnsFlowData::flow_id = 0;
 
-DNSData udpSessionData;
-
-static DNSData* SetNewDNSData(Packet* p)
+// detection buffers for the current packet; set by the udp fast path and
+// reset by clear() when detection is done
+struct DnsBuffers
 {
-    DnsFlowData* fd;
+    uint8_t query[DNS_MAX_NAME];
+    unsigned query_len;
 
-    if (p->is_udp())
-        return NULL;
+    const uint8_t* answers;
+    unsigned answers_len;
+};
 
-    fd = new DnsFlowData;
+static THREAD_LOCAL DnsBuffers dns_bufs;
 
-    p->flow->set_application_data(fd);
-    return &fd->session;
+const uint8_t* get_dns_query(unsigned& len)
+{
+    len = dns_bufs.query_len;
+    return len ? dns_bufs.query : nullptr;
 }
 
-static DNSData* get_dns_session_data(Packet* p, bool from_server)
+const uint8_t* get_dns_answers(unsigned& len)
 {
-    DnsFlowData* fd;
-
-    if (p->is_udp())
-    {
-        if(p->dsize > MAX_UDP_PAYLOAD)
-            return NULL;
-
-        if(!from_server)
-        {
-            if (p->dsize < (sizeof(DNSHdr) + sizeof(DNSQuestion) + 2))
-                return NULL;
-        }
-        else
-        {
-            if (p->dsize < (sizeof(DNSHdr)))
-                return NULL;
-        }
+    len = dns_bufs.answers_len;
+    return len ? dns_bufs.answers : nullptr;
+}
 
-        memset(&udpSessionData, 0, sizeof(udpSessionData));
-        return &udpSessionData;
-    }
+// udp messages are parsed by the fast path and never get flow data
+static DNSData* SetNewDNSData(Packet* p)
+{
+    DnsFlowData* fd = new DnsFlowData;
+    p->flow->set_application_data(fd);
+    return &fd->session;
+}
 
-    fd = (DnsFlowData*)((p->flow)->get_application_data(
+static DNSData* get_dns_session_data(Packet* p)
+{
+    DnsFlowData* fd = (DnsFlowData*)((p->flow)->get_application_data(
         DnsFlowData::flow_id));
 
     return fd ? &fd->session : NULL;
@@ -965,7 +961,7 @@ static void ParseDNSResponseMessage(Packet* p, DNSData* dnsSessionData)
             dnsSessionData->curr_rec = 0;
         /* Fall through */
         case DNS_RESP_STATE_ADD_RR: /* ADDITIONALS section */
-            for (i=dnsSessionData->curr_rec; i<dnsSessionData->hdr.authorities; i++)
+            for (i=dnsSessionData->curr_rec; i<dnsSessionData->hdr.additionals; i++)
             {
                 bytes_unused = ParseDNSAnswer(data, bytes_unused, dnsSessionData);
 
@@ -1021,10 +1017,217 @@ static void ParseDNSResponseMessage(Packet* p, DNSData* dnsSessionData)
     }
 }
 
+//-------------------------------------------------------------------------
+// udp fast path
+//-------------------------------------------------------------------------
+
+// a udp datagram is a whole message so it is parsed in one pass with no
+// state carried between calls.  the checks are the same as above; a short
+// message is simply parsed as far as it goes.
+
+static inline uint16_t get16(const uint8_t* d)
+{ return (uint16_t)((d[0] << 8) | d[1]); }
+
+// skip the name at off; if out is given, also decode it in dotted form,
+// following compression pointers backwards only
+static bool FastDNSName(
+    const uint8_t* msg, unsigned len, unsigned& off, uint8_t* out = nullptr, unsigned* olen = nullptr)
+{
+    unsigned pos = off;
+    unsigned n = 0;
+    bool jumped = false;
+    unsigned hops = 0;
+
+    while ( pos < len )
+    {
+        uint8_t c = msg[pos];
+
+        if ( !c )
+        {
+            if ( !jumped )
+                off = pos + 1;
+
+            if ( olen )
+                *olen = n;
+
+            return true;
+        }
+
+        if ( (c & DNS_RR_PTR) == DNS_RR_PTR )
+        {
+            if ( pos + 1 >= len )
+                return false;
+
+            unsigned to = ((c & ~DNS_RR_PTR) << 8) | msg[pos + 1];
+
+            if ( !jumped )
+                off = pos + 2;
+
+            if ( !out )
+                return true;
+
+            if ( to >= pos or ++hops > 16 )
+            {
+                *olen = n;
+                return true;
+            }
+            jumped = true;
+            pos = to;
+            continue;
+        }
+
+        if ( pos + 1 + c > len )
+            return false;
+
+        if ( out and n + c + 1 <= DNS_MAX_NAME )
+        {
+            if ( n )
+                out[n++] = '.';
+
+            memcpy(out + n, msg + pos + 1, c);
+            n += c;
+        }
+        pos += 1 + c;
+    }
+    return false;
+}
+
+static void FastDNSTxt(const uint8_t* rdata, unsigned rdlen)
+{
+    uint32_t txt_count = 0;
+    uint32_t total_txt_len = 0;
+    unsigned pos = 0;
+
+    while ( pos < rdlen )
+    {
+        uint8_t txt_len = rdata[pos];
+        txt_count++;
+
+        /* include the NULL */
+        total_txt_len += txt_len + 1;
+
+        /* if txt_count * 4 + total_txt_len * 2 + 4 > FFFF, vulnerability! */
+        if ( (txt_count * 4) + (total_txt_len * 2) + 4 > 0xFFFF )
+        {
+            SnortEventqAdd(GID_DNS, DNS_EVENT_RDATA_OVERFLOW);
+            return;
+        }
+        pos += 1 + txt_len;
+    }
+}
+
+// returns false if the type is not one we know, ending the message
+static bool FastDNSRData(uint16_t type, const uint8_t* rdata, unsigned rdlen)
+{
+    switch ( type )
+    {
+    case DNS_RR_TYPE_TXT:
+        FastDNSTxt(rdata, rdlen);
+        break;
+
+    case DNS_RR_TYPE_MD:
+    case DNS_RR_TYPE_MF:
+        SnortEventqAdd(GID_DNS, DNS_EVENT_OBSOLETE_TYPES);
+        break;
+
+    case DNS_RR_TYPE_MB:
+    case DNS_RR_TYPE_MG:
+    case DNS_RR_TYPE_MR:
+    case DNS_RR_TYPE_NULL:
+    case DNS_RR_TYPE_MINFO:
+        SnortEventqAdd(GID_DNS, DNS_EVENT_EXPERIMENTAL_TYPES);
+        break;
+
+    case DNS_RR_TYPE_A:
+    case DNS_RR_TYPE_NS:
+    case DNS_RR_TYPE_CNAME:
+    case DNS_RR_TYPE_SOA:
+    case DNS_RR_TYPE_WKS:
+    case DNS_RR_TYPE_PTR:
+    case DNS_RR_TYPE_HINFO:
+    case DNS_RR_TYPE_MX:
+        break;
+
+    default:
+        return false;
+    }
+    return true;
+}
+
+static void FastDNSMessage(const Packet* p, bool from_server)
+{
+    const uint8_t* msg = p->data;
+    unsigned len = p->dsize;
+
+    if ( len > MAX_UDP_PAYLOAD )
+        return;
+
+    if ( len < (from_server ? sizeof(DNSHdr) : sizeof(DNSHdr) + sizeof(DNSQuestion) + 2) )
+        return;
+
+    uint16_t flags = get16(msg + 2);
+    uint16_t questions = get16(msg + 4);
+    unsigned records = get16(msg + 6) + get16(msg + 8) + get16(msg + 10);
+
+    bool response = (flags & DNS_HDR_FLAG_RESPONSE) != 0;
+
+    if ( from_server )
+    {
+        if ( response )
+            dnsstats.responses++;
+    }
+    else
+        dnsstats.requests++;
+
+    unsigned off = sizeof(DNSHdr);
+
+    for ( unsigned i = 0; i < questions; ++i )
+    {
+        bool ok = i ?
+            FastDNSName(msg, len, off) :
+            FastDNSName(msg, len, off, dns_bufs.query, &dns_bufs.query_len);
+
+        if ( !ok or off + sizeof(DNSQuestion) > len )
+            return;
+
+        off += sizeof(DNSQuestion);
+    }
+
+    if ( !from_server or !response or off >= len )
+        return;
+
+    dns_bufs.answers = msg + off;
+    dns_bufs.answers_len = len - off;
+
+    for ( unsigned i = 0; i < records; ++i )
+    {
+        if ( !FastDNSName(msg, len, off) or off + 10 > len )
+            return;
+
+        uint16_t type = get16(msg + off);
+        unsigned rdlen = get16(msg + off + 8);
+        off += 10;
+
+        if ( off + rdlen > len )
+            rdlen = len - off;
+
+        if ( !FastDNSRData(type, msg + off, rdlen) )
+            return;
+
+        off += rdlen;
+    }
+}
+
 static void snort_dns(Packet* p)
 {
     Profile profile(dnsPerfStats);
 
+    if ( p->is_udp() )
+    {
+        FastDNSMessage(p, p->is_from_server());
+        return;
+    }
+
     // For TCP, do a few extra checks...
     if ( p->has_tcp_data() )
     {
@@ -1053,7 +1256,7 @@ static void snort_dns(Packet* p)
 
 
     // Attempt to get a previously allocated DNS block.
-    DNSData* dnsSessionData = get_dns_session_data(p, from_server);
+    DNSData* dnsSessionData = get_dns_session_data(p);
 
     if (dnsSessionData == NULL)
     {
@@ -1090,6 +1293,12 @@ public:
 
     void show(SnortConfig*) override;
     void eval(Packet*) override;
+    void clear(Packet*) override;
+
+    bool get_buf(InspectionBuffer::Type, Packet*, InspectionBuffer&) override;
+
+    bool cacheable(InspectionBuffer::Type) override
+    { return true; }
 };
 
 Dns::Dns(DnsModule*)
@@ -1110,6 +1319,42 @@ void Dns::eval(Packet* p)
     snort_dns(p);
 }
 
+void Dns::clear(Packet*)
+{
+    dns_bufs.query_len = 0;
+    dns_bufs.answers = nullptr;
+    dns_bufs.answers_len = 0;
+}
+
+// the query name is like a uri and the records like headers for fast
+// patterns
+bool Dns::get_buf(InspectionBuffer::Type ibt, Packet*, InspectionBuffer& b)
+{
+    const uint8_t* data;
+    unsigned len;
+
+    switch ( ibt )
+    {
+    case InspectionBuffer::IBT_KEY:
+        data = get_dns_query(len);
+        break;
+
+    case InspectionBuffer::IBT_HEADER:
+        data = get_dns_answers(len);
+        break;
+
+    default:
+        return false;
+    }
+
+    if ( !data )
+        return false;
+
+    b.data = data;
+    b.len = len;
+    return true;
+}
+
 //-------------------------------------------------------------------------
 // api stuff
 //-------------------------------------------------------------------------
@@ -1165,9 +1410,14 @@ const InspectApi dns_api =
 };
 
 #ifdef BUILDING_SO
+extern const BaseApi* ips_dns_query;
+extern const BaseApi* ips_dns_answer;
+
 SO_PUBLIC const BaseApi* snort_plugins[] =
 {
     &dns_api.base,
+    ips_dns_query,
+    ips_dns_answer,
     nullptr
 };
 #else
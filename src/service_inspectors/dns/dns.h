@@ -150,6 +150,13 @@ struct DNSNameState
 #define DNS_RESP_STATE_AUTH_RR          0x50
 #define DNS_RESP_STATE_ADD_RR           0x60
 
+// longest decoded name kept for the query buffer
+#define DNS_MAX_NAME 255
+
+// buffers from the current udp message for detection; null if none
+const uint8_t* get_dns_query(unsigned& len);
+const uint8_t* get_dns_answers(unsigned& len);
+
 // Per-session data block containing current state
 // of the DNS preprocessor for the session.
 struct DNSData
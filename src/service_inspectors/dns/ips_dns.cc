@@ -0,0 +1,208 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// ips_dns.cc
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <array>
+
+#include "main/snort_types.h"
+#include "protocols/packet.h"
+#include "profiler/profiler.h"
+#include "detection/detection_defines.h"
+#include "framework/ips_option.h"
+#include "framework/cursor.h"
+#include "framework/module.h"
+
+#include "dns.h"
+
+enum DnsIdx
+{
+    DNS_QUERY, DNS_ANSWER, DNS_MAX
+};
+
+static THREAD_LOCAL std::array<ProfileStats, DNS_MAX> dns_ps;
+
+//-------------------------------------------------------------------------
+// module
+//-------------------------------------------------------------------------
+
+class DnsCursorModule : public Module
+{
+public:
+    DnsCursorModule(const char* s, const char* h, DnsIdx psi) :
+        Module(s, h) { idx = psi; }
+
+    ProfileStats* get_profile() const override
+    { return &dns_ps[idx]; }
+
+private:
+    DnsIdx idx;
+};
+
+static void mod_dtor(Module* m)
+{
+    delete m;
+}
+
+static void opt_dtor(IpsOption* p)
+{
+    delete p;
+}
+
+//-------------------------------------------------------------------------
+// generic buffer stuffer
+//-------------------------------------------------------------------------
+
+class DnsIpsOption : public IpsOption
+{
+public:
+    DnsIpsOption(const char* s, DnsIdx psi, CursorActionType c) :
+        IpsOption(s, RULE_OPTION_TYPE_BUFFER_SET)
+    { key = s; cat = c; idx = psi; }
+
+    CursorActionType get_cursor_type() const override
+    { return cat; }
+
+    int eval(Cursor&, Packet*) override;
+
+private:
+    const char* key;
+    CursorActionType cat;
+    DnsIdx idx;
+};
+
+int DnsIpsOption::eval(Cursor& c, Packet* p)
+{
+    Profile profile(dns_ps[idx]);
+
+    if ( !p->is_udp() or !p->dsize )
+        return DETECTION_OPTION_NO_MATCH;
+
+    unsigned len;
+    const uint8_t* data = (idx == DNS_QUERY) ?
+        get_dns_query(len) : get_dns_answers(len);
+
+    if ( !data )
+        return DETECTION_OPTION_NO_MATCH;
+
+    c.set(key, data, len);
+    return DETECTION_OPTION_MATCH;
+}
+
+//-------------------------------------------------------------------------
+// dns_query
+//-------------------------------------------------------------------------
+
+#undef IPS_OPT
+#define IPS_OPT "dns_query"
+
+#define query_help \
+    "rule option to set the detection cursor to the decoded name of the first question"
+
+static Module* query_mod_ctor()
+{
+    return new DnsCursorModule(IPS_OPT, query_help, DNS_QUERY);
+}
+
+static IpsOption* query_opt_ctor(Module*, OptTreeNode*)
+{
+    return new DnsIpsOption(IPS_OPT, DNS_QUERY, CAT_SET_KEY);
+}
+
+static const IpsApi query_api =
+{
+    {
+        PT_IPS_OPTION,
+        sizeof(IpsApi),
+        IPSAPI_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        IPS_OPT,
+        query_help,
+        query_mod_ctor,
+        mod_dtor
+    },
+    OPT_TYPE_DETECTION,
+    0, PROTO_BIT__UDP,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    query_opt_ctor,
+    opt_dtor,
+    nullptr
+};
+
+//-------------------------------------------------------------------------
+// dns_answer
+//-------------------------------------------------------------------------
+
+#undef IPS_OPT
+#define IPS_OPT "dns_answer"
+
+#define answer_help \
+    "rule option to set the detection cursor to the resource records of a response"
+
+static Module* answer_mod_ctor()
+{
+    return new DnsCursorModule(IPS_OPT, answer_help, DNS_ANSWER);
+}
+
+static IpsOption* answer_opt_ctor(Module*, OptTreeNode*)
+{
+    return new DnsIpsOption(IPS_OPT, DNS_ANSWER, CAT_SET_HEADER);
+}
+
+static const IpsApi answer_api =
+{
+    {
+        PT_IPS_OPTION,
+        sizeof(IpsApi),
+        IPSAPI_VERSION,
+        0,
+        API_RESERVED,
+        API_OPTIONS,
+        IPS_OPT,
+        answer_help,
+        answer_mod_ctor,
+        mod_dtor
+    },
+    OPT_TYPE_DETECTION,
+    0, PROTO_BIT__UDP,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    answer_opt_ctor,
+    opt_dtor,
+    nullptr
+};
+
+//-------------------------------------------------------------------------
+// plugins
+//-------------------------------------------------------------------------
+
+// added to snort_plugins in dns.cc
+const BaseApi* ips_dns_query = &query_api.base;
+const BaseApi* ips_dns_answer = &answer_api.base;
+
@@ -218,6 +218,8 @@ public:
     void eval(Packet*) override;
 
     bool get_buf(InspectionBuffer::Type, Packet*, InspectionBuffer&) override;
+    bool cacheable(InspectionBuffer::Type) override
+    { return true; }
     void clear(Packet*) override;
 
 private:
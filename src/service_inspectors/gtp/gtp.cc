@@ -76,6 +76,8 @@ static inline int GTP_Process(Packet* p, GTP_Roptions* pRopts)
     pRopts->gtp_version = gtpMsg.version;
     pRopts->gtp_infoElements = gtpMsg.info_elements;
     pRopts->gtp_header = gtpMsg.gtp_header;
+    pRopts->gtp_header_len = gtpMsg.header_len;
+    pRopts->gtp_ie_len = gtpMsg.info_elements ? p->dsize - gtpMsg.header_len : 0;
     pRopts->msg_id = gtpMsg.msg_id;
 
     DEBUG_WRAP(DebugFormat(DEBUG_GTP, "GTP message version: %d\n", gtpMsg.version));
@@ -60,6 +60,9 @@ public:
     GtpInspect(std::vector<GtpStuff>&);
 
     void eval(Packet*) override;
+    bool get_buf(InspectionBuffer::Type, Packet*, InspectionBuffer&) override;
+    bool cacheable(InspectionBuffer::Type) override
+    { return true; }
 
     int get_message_type(int version, const char* name);
     int get_info_type(int version, const char* name);
@@ -97,6 +100,22 @@ void GtpInspect::eval(Packet* p)
     GTPmain(p);
 }
 
+// the information elements cover every gtp_info buffer
+bool GtpInspect::get_buf(InspectionBuffer::Type ibt, Packet* p, InspectionBuffer& b)
+{
+    if ( ibt != InspectionBuffer::IBT_BODY or !p->flow )
+        return false;
+
+    GtpFlowData* gfd = (GtpFlowData*)p->flow->get_application_data(GtpFlowData::flow_id);
+
+    if ( !gfd or !gfd->ropts.gtp_infoElements or !gfd->ropts.gtp_ie_len )
+        return false;
+
+    b.data = gfd->ropts.gtp_header + gfd->ropts.gtp_header_len;
+    b.len = gfd->ropts.gtp_ie_len;
+    return true;
+}
+
 //-------------------------------------------------------------------------
 // public lookups
 //-------------------------------------------------------------------------
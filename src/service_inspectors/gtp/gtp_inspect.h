@@ -30,6 +30,8 @@ struct GTP_Roptions
     uint8_t gtp_type;
     uint8_t gtp_version;
     uint8_t* gtp_header;
+    uint16_t gtp_header_len;
+    uint16_t gtp_ie_len;  /* all information elements */
     uint32_t msg_id;  /* used to associate to current msg */
     GTP_IEData* gtp_infoElements;
 };
@@ -51,7 +51,7 @@ public:
     GtpInfoOption(uint8_t*);
 
     CursorActionType get_cursor_type() const override
-    { return CAT_SET_OTHER; }
+    { return CAT_SET_BODY; }
 
     uint32_t hash() const override;
     bool operator==(const IpsOption&) const override;
@@ -48,6 +48,9 @@ public:
     uint32_t hash() const override;
     bool operator==(const IpsOption&) const override;
 
+    CursorActionType get_cursor_type() const override
+    { return CAT_SET_BODY; }
+
     int eval(Cursor&, Packet*) override;
 };
 
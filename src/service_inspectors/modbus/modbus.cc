@@ -59,6 +59,7 @@ class Modbus : public Inspector
 public:
     // default ctor / dtor
     void eval(Packet*) override;
+    bool get_buf(InspectionBuffer::Type, Packet*, InspectionBuffer&) override;
 
     int get_message_type(int version, const char* name);
     int get_info_type(int version, const char* name);
@@ -106,6 +107,20 @@ void Modbus::eval(Packet* p)
         mfd->reset();
 }
 
+// same data as the modbus_data rule option
+bool Modbus::get_buf(InspectionBuffer::Type ibt, Packet* p, InspectionBuffer& b)
+{
+    if ( ibt != InspectionBuffer::IBT_BODY )
+        return false;
+
+    if ( !p->flow or !p->is_full_pdu() or p->dsize <= MODBUS_MIN_LEN )
+        return false;
+
+    b.data = p->data + MODBUS_MIN_LEN;
+    b.len = p->dsize - MODBUS_MIN_LEN;
+    return true;
+}
+
 //-------------------------------------------------------------------------
 // plugin stuff
 //-------------------------------------------------------------------------
@@ -26,6 +26,7 @@
 
 #include "nhttp_module.h"
 #include "nhttp_flow_data.h"
+#include "nhttp_object_pool.h"
 
 class NHttpApi
 {
@@ -44,7 +45,7 @@ private:
     static Inspector* nhttp_ctor(Module* mod);
     static void nhttp_dtor(Inspector* p) { delete p; }
     static void nhttp_tinit() { }
-    static void nhttp_tterm() { }
+    static void nhttp_tterm() { NHttpObjectPool::thread_term(); }
 };
 
 #endif
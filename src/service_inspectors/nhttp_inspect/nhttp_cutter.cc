@@ -19,6 +19,8 @@
 
 #include "nhttp_cutter.h"
 
+#include "utils/util_scan.h"
+
 using namespace NHttpEnums;
 
 ScanResult NHttpStartCutter::cut(const uint8_t* buffer, uint32_t length,
@@ -138,6 +140,15 @@ ScanResult NHttpHeaderCutter::cut(const uint8_t* buffer, uint32_t length,
     // discarded during reassemble().
     for (uint32_t k = 0; k < length; k++)
     {
+        // Between line endings nothing changes until the next \r or \n
+        if (num_crlf == 0)
+        {
+            const uint8_t* eol = scan_eol(buffer + k, buffer + length);
+            if (eol == nullptr)
+                break;
+            k = eol - buffer;
+        }
+
         if (buffer[k] == '\n')
         {
             num_crlf++;
@@ -17,6 +17,8 @@
 //--------------------------------------------------------------------------
 // nhttp_flow_data.cc author Tom Peters <thopeter@cisco.com>
 
+#include "decompress/file_decomp.h"
+
 #include "nhttp_enum.h"
 #include "nhttp_test_manager.h"
 #include "nhttp_flow_data.h"
@@ -63,11 +65,7 @@ NHttpFlowData::~NHttpFlowData()
             delete[] section_buffer[k];
         NHttpTransaction::delete_transaction(transaction[k]);
         delete cutter[k];
-        if (compress_stream[k] != nullptr)
-        {
-            inflateEnd(compress_stream[k]);
-            delete compress_stream[k];
-        }
+        File_Decomp_Put_Inflate(compress_stream[k]);
     }
 
     if (mime_state != nullptr)
@@ -89,13 +87,7 @@ void NHttpFlowData::half_reset(SourceId source_id)
     section_size_max[source_id] = 0;
     file_depth_remaining[source_id] = STAT_NOT_PRESENT;
     detect_depth_remaining[source_id] = STAT_NOT_PRESENT;
-    compression[source_id] = CMP_NONE;
-    if (compress_stream[source_id] != nullptr)
-    {
-        inflateEnd(compress_stream[source_id]);
-        delete compress_stream[source_id];
-        compress_stream[source_id] = nullptr;
-    }
+    release_decompression(source_id);
     infractions[source_id].reset();
     events[source_id].reset();
     section_offset[source_id] = 0;
@@ -122,16 +114,19 @@ void NHttpFlowData::half_reset(SourceId source_id)
     }
 }
 
+// The inflate engine goes back to the per-thread cache as soon as the body no longer needs it so
+// that flows sitting past their depth do not hold on to zlib windows
+void NHttpFlowData::release_decompression(SourceId source_id)
+{
+    compression[source_id] = CMP_NONE;
+    File_Decomp_Put_Inflate(compress_stream[source_id]);
+    compress_stream[source_id] = nullptr;
+}
+
 void NHttpFlowData::trailer_prep(SourceId source_id)
 {
     type_expected[source_id] = SEC_TRAILER;
-    compression[source_id] = CMP_NONE;
-    if (compress_stream[source_id] != nullptr)
-    {
-        inflateEnd(compress_stream[source_id]);
-        delete compress_stream[source_id];
-        compress_stream[source_id] = nullptr;
-    }
+    release_decompression(source_id);
     infractions[source_id].reset();
     events[source_id].reset();
 }
@@ -62,6 +62,7 @@ private:
     // Convenience routines
     void half_reset(NHttpEnums::SourceId source_id);
     void trailer_prep(NHttpEnums::SourceId source_id);
+    void release_decompression(NHttpEnums::SourceId source_id);
 
     // 0 element refers to client request, 1 element refers to server response
 
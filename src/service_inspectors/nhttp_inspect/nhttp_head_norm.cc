@@ -58,10 +58,34 @@ int32_t HeaderNormalizer::derive_header_content(const uint8_t* value, int32_t le
     return out_length;
 }
 
-// This method normalizes the header field value for headId.
+// When derive_header_content() would return the value unchanged apart from the leading and
+// trailing white space there is no reason to copy it. This checks for that case and if found sets
+// result_field to point directly into the message buffer.
+bool HeaderNormalizer::find_clean_content(const uint8_t* value, int32_t length,
+    Field& result_field)
+{
+    int32_t first = 0;
+    while ((first < length) && ((value[first] == ' ') || (value[first] == '\t')))
+        first++;
+    int32_t last = length;
+    while ((last > first) && ((value[last-1] == ' ') || (value[last-1] == '\t')))
+        last--;
+    for (int32_t k=first; k < last; k++)
+    {
+        // Tabs, CRs, and runs of spaces all get rewritten
+        if ((value[k] == '\t') || (value[k] == '\r') || ((value[k] == ' ') && (value[k-1] == ' ')))
+            return false;
+    }
+    result_field.set(last - first, value + first);
+    return true;
+}
+
+// This method normalizes the header field value for headId. result_alloc is set when
+// result_field is a new buffer the caller must delete rather than a view of the message.
 void HeaderNormalizer::normalize(const HeaderId head_id, const int count,
     NHttpInfractions& infractions, NHttpEventGen& events, const HeaderId header_name_id[],
-    const Field header_value[], const int32_t num_headers, Field& result_field) const
+    const Field header_value[], const int32_t num_headers, Field& result_field,
+    bool& result_alloc) const
 {
     if (result_field.length != STAT_NOT_COMPUTE)
     {
@@ -95,15 +119,26 @@ void HeaderNormalizer::normalize(const HeaderId head_id, const int count,
             (concatenate_repeats && (num_matches == count)));
     buffer_length += num_matches - 1;    // allow space for concatenation commas
 
+    // A single value that no normalization function will touch can often be used in place
+    if ((num_matches == 1) && (num_normalizers == 0) && find_clean_content(
+        header_value[curr_match].start, header_value[curr_match].length, result_field))
+    {
+        result_alloc = false;
+        return;
+    }
+
     // We are allocating two buffers to store the normalized field value. The raw field value will
     // be copied into one of them. Concatenation and white space normalization happen during this
     // step. Next a series of normalization functions will transform the value into final form.
     // Each normalization copies the value from one buffer to the other. Based on whether the
     // number of normalization functions is odd or even, the initial buffer is chosen so that the
-    // final normalization leaves the normalized header value in norm_value.
+    // final normalization leaves the normalized header value in norm_value. The temporary buffer
+    // is only needed when there are normalization functions and is on the stack when it fits.
 
+    uint8_t temp_stack[TEMP_STACK_SIZE];
     uint8_t* const norm_value = new uint8_t[buffer_length];
-    uint8_t* const temp_space = new uint8_t[buffer_length];
+    uint8_t* const temp_space = (num_normalizers == 0) ? nullptr :
+        (buffer_length <= TEMP_STACK_SIZE) ? temp_stack : new uint8_t[buffer_length];
     uint8_t* working = (num_normalizers%2 == 0) ? norm_value : temp_space;
     int32_t data_length = 0;
     for (int j=0; j < num_matches; j++)
@@ -131,8 +166,10 @@ void HeaderNormalizer::normalize(const HeaderId head_id, const int count,
             data_length = normalizer[i](norm_value, data_length, temp_space, infractions, events);
         }
     }
-    delete[] temp_space;
+    if (temp_space != temp_stack)
+        delete[] temp_space;
     result_field.set(data_length, norm_value);
+    result_alloc = true;
     return;
 }
 
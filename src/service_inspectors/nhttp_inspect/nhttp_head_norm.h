@@ -46,10 +46,14 @@ public:
     void normalize(const NHttpEnums::HeaderId head_id, const int count,
         NHttpInfractions& infractions, NHttpEventGen& events,
         const NHttpEnums::HeaderId header_name_id[], const Field header_value[],
-        const int32_t num_headers, Field& result_field) const;
+        const int32_t num_headers, Field& result_field, bool& result_alloc) const;
 
 private:
     static int32_t derive_header_content(const uint8_t* value, int32_t length, uint8_t* buffer);
+    static bool find_clean_content(const uint8_t* value, int32_t length, Field& result_field);
+
+    // Values this short use a stack buffer for the intermediate normalization step
+    static const int32_t TEMP_STACK_SIZE = 512;
 
     const bool concatenate_repeats;
     NormFunc* const normalizer[3];
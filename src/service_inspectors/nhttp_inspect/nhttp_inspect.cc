@@ -24,6 +24,7 @@
 
 #include "main/snort_types.h"
 #include "stream/stream_api.h"
+#include "time/cpuclock.h"
 
 #include "nhttp_enum.h"
 #include "nhttp_msg_request.h"
@@ -53,6 +54,15 @@ NHttpInspect::NHttpInspect(const NHttpParaList* params_) : params(params_)
     NHttpTestManager::set_print_amount(params->print_amount);
     NHttpTestManager::set_print_hex(params->print_hex);
     NHttpTestManager::set_show_pegs(params->show_pegs);
+    NHttpTestManager::set_bench_passes(params->bench_passes);
+#endif
+}
+
+void NHttpInspect::tterm()
+{
+#ifdef REG_TEST
+    if (NHttpTestManager::use_bench())
+        NHttpTestManager::print_bench(stdout);
 #endif
 }
 
@@ -171,15 +181,30 @@ const Field& NHttpInspect::process(const uint8_t* data, const uint16_t dsize, Fl
         return Field::FIELD_NULL;
     }
 
+#ifdef REG_TEST
+    // update_flow() moves section_type on to the next section
+    const SectionType bench_type = session_data->section_type[source_id];
+    uint64_t start_ticks = 0;
+    if (NHttpTestManager::use_bench())
+        get_clockticks(start_ticks);
+#endif
+
     latest_section->analyze();
     latest_section->update_flow();
 
 #ifdef REG_TEST
+    if (NHttpTestManager::use_bench())
+    {
+        uint64_t end_ticks;
+        get_clockticks(end_ticks);
+        NHttpTestManager::bench_section(bench_type, dsize,
+            end_ticks - start_ticks);
+    }
     if (NHttpTestManager::use_test_output())
     {
         latest_section->print_section(NHttpTestManager::get_output_file());
         fflush(NHttpTestManager::get_output_file());
-        if (NHttpTestManager::use_test_input())
+        if (NHttpTestManager::use_test_input() && !NHttpTestManager::use_bench())
         {
             printf("Finished processing section from test %" PRIi64 "\n",
                 NHttpTestManager::get_test_number());
@@ -46,11 +46,12 @@ public:
     bool nhttp_get_buf(unsigned id, uint64_t sub_id, uint64_t form, Packet*, InspectionBuffer& b);
     bool get_fp_buf(InspectionBuffer::Type ibt, Packet*, InspectionBuffer& b) override;
     bool configure(SnortConfig*) override { return true; }
+    bool can_share() override { return true; }
     void show(SnortConfig*) override { LogMessage("NHttpInspect\n"); }
     void eval(Packet*) override { }
     void clear(Packet* p) override;
     void tinit() override { }
-    void tterm() override { }
+    void tterm() override;
     NHttpStreamSplitter* get_splitter(bool is_client_to_server) override
     {
         return new NHttpStreamSplitter(is_client_to_server, this);
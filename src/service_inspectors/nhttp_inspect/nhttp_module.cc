@@ -68,6 +68,8 @@ const Parameter NHttpModule::nhttp_params[] =
     { "print_hex", Parameter::PT_BOOL, nullptr, "false",
       "nonprinting characters printed in [HH] format instead of using an asterisk" },
     { "show_pegs", Parameter::PT_BOOL, nullptr, "true", "display peg counts with test output" },
+    { "bench_passes", Parameter::PT_INT, "0:1000000", "0",
+      "replay the test_input file this many times and report throughput instead of test output" },
 #endif
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
@@ -176,6 +178,10 @@ bool NHttpModule::set(const char*, Value& val, SnortConfig*)
     {
         params->show_pegs = val.get_bool();
     }
+    else if (val.is("bench_passes"))
+    {
+        params->bench_passes = val.get_long();
+    }
 #endif
     else
     {
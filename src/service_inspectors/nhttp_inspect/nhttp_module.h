@@ -65,6 +65,7 @@ public:
     long print_amount;
     bool print_hex;
     bool show_pegs;
+    long bench_passes;
 #endif
 };
 
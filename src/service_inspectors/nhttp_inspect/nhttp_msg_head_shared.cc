@@ -31,17 +31,13 @@ using namespace NHttpEnums;
 NHttpMsgHeadShared::~NHttpMsgHeadShared()
 {
     delete[] header_line;
-    delete[] header_name;
     delete[] header_name_id;
-    delete[] header_value;
-    NormalizedHeader* list_ptr = norm_heads;
-    while (list_ptr != nullptr)
+    for (NormalizedHeader* list_ptr = norm_heads; list_ptr != nullptr; list_ptr = list_ptr->next)
     {
-        NormalizedHeader* temp_ptr = list_ptr;
-        list_ptr = list_ptr->next;
-        temp_ptr->norm.delete_buffer();
-        delete temp_ptr;
+        if (list_ptr->norm_alloc)
+            list_ptr->norm.delete_buffer();
     }
+    delete[] norm_pool;
     if (classic_raw_header_alloc)
         classic_raw_header.delete_buffer();
     if (classic_norm_header_alloc)
@@ -78,11 +74,13 @@ void NHttpMsgHeadShared::create_norm_head_list()
             else
             {
                 headers_present[header_name_id[j]] = true;
+                assert(norm_pool_used < num_headers);
                 NormalizedHeader* tmp_ptr = norm_heads;
-                norm_heads = new NormalizedHeader;
+                norm_heads = &norm_pool[norm_pool_used++];
                 norm_heads->next = tmp_ptr;
                 norm_heads->id = header_name_id[j];
                 norm_heads->count = 1;
+                norm_heads->norm_alloc = false;
             }
         }
     }
@@ -96,7 +94,11 @@ void NHttpMsgHeadShared::parse_header_block()
     int num_seps;
     // session_data->num_head_lines is computed without consideration of wrapping and may overstate
     // actual number of headers. Rely on num_headers which is calculated correctly.
-    header_line = new Field[session_data->num_head_lines[source_id]];
+    // One allocation holds the line, name, and value Fields for every header.
+    const int32_t max_lines = session_data->num_head_lines[source_id];
+    header_line = new Field[3 * max_lines];
+    header_name = header_line + max_lines;
+    header_value = header_name + max_lines;
     while (bytes_used < msg_text.length)
     {
         assert(num_headers < session_data->num_head_lines[source_id]);
@@ -160,9 +162,8 @@ uint32_t NHttpMsgHeadShared::find_header_end(const uint8_t* buffer, int32_t leng
 // Divide header field lines into field name and field value
 void NHttpMsgHeadShared::parse_header_lines()
 {
-    header_name = new Field[num_headers];
-    header_value = new Field[num_headers];
     header_name_id = new HeaderId[num_headers];
+    norm_pool = new NormalizedHeader[num_headers];
 
     int colon;
     for (int k=0; k < num_headers; k++)
@@ -201,8 +202,9 @@ void NHttpMsgHeadShared::derive_header_name_id(int index)
     }
 
     // Normalize header field name to lower case and remove LWS for matching purposes
+    uint8_t name_stack[NAME_STACK_SIZE];
     int32_t lower_length = 0;
-    uint8_t* lower_name = new uint8_t[length];
+    uint8_t* const lower_name = (length <= NAME_STACK_SIZE) ? name_stack : new uint8_t[length];
     for (int32_t k=0; k < length; k++)
     {
         if (!is_sp_tab[buffer[k]])
@@ -217,7 +219,8 @@ void NHttpMsgHeadShared::derive_header_name_id(int index)
         }
     }
     header_name_id[index] = (HeaderId)str_to_code(lower_name, lower_length, header_list);
-    delete[] lower_name;
+    if (lower_name != name_stack)
+        delete[] lower_name;
 }
 
 NHttpMsgHeadShared::NormalizedHeader* NHttpMsgHeadShared::get_header_node(HeaderId header_id) const
@@ -305,7 +308,7 @@ const Field& NHttpMsgHeadShared::get_header_value_norm(HeaderId header_id)
     if (node == nullptr)
         return Field::FIELD_NULL;
     header_norms[header_id]->normalize(header_id, node->count, infractions, events, header_name_id,
-        header_value, num_headers, node->norm);
+        header_value, num_headers, node->norm, node->norm_alloc);
     return node->norm;
 }
 
@@ -82,6 +82,7 @@ private:
     // All of these are indexed by the relative position of the header field in the message
     static const int MAX_HEADERS = 200;  // I'm an arbitrary number. FIXIT-L
     static const int MAX_HEADER_LENGTH = 4096; // Based on max cookie size of some browsers
+    static const int NAME_STACK_SIZE = 256;    // Longer names are lowercased on the heap
 
     void parse_header_block();
     uint32_t find_header_end(const uint8_t* buffer, int32_t length, int& num_seps);
@@ -91,6 +92,9 @@ private:
 
     std::bitset<MAX> headers_present = 0;
     int32_t num_headers = NHttpEnums::STAT_NOT_COMPUTE;
+
+    // header_line, header_name, and header_value are carved out of a single allocation. All of
+    // them point into msg_text.
     Field* header_line = nullptr;
     Field* header_name = nullptr;
     NHttpEnums::HeaderId* header_name_id = nullptr;
@@ -108,10 +112,14 @@ private:
         NHttpEnums::HeaderId id;
         int count;
         Field norm;
+        bool norm_alloc;
         NormalizedHeader* next;
     };
 
+    // List nodes come from a pool with one entry per header which is always enough
     NormalizedHeader* norm_heads = nullptr;
+    NormalizedHeader* norm_pool = nullptr;
+    int32_t norm_pool_used = 0;
     NormalizedHeader* get_header_node(NHttpEnums::HeaderId k) const;
 };
 
@@ -22,6 +22,7 @@
 #include <sys/types.h>
 
 #include "utils/util.h"
+#include "decompress/file_decomp.h"
 #include "detection/detection_util.h"
 #include "file_api/file_service.h"
 #include "file_api/file_flows.h"
@@ -246,17 +247,12 @@ void NHttpMsgHeader::setup_decompression()
     else
         return;
 
-    session_data->compress_stream[source_id] = new z_stream;
-    session_data->compress_stream[source_id]->zalloc = Z_NULL;
-    session_data->compress_stream[source_id]->zfree = Z_NULL;
-    session_data->compress_stream[source_id]->next_in = Z_NULL;
-    session_data->compress_stream[source_id]->avail_in = 0;
+    // Engines are reused across bodies on this thread rather than initialized for each one
     const int window_bits = (compression == CMP_GZIP) ? GZIP_WINDOW_BITS : DEFLATE_WINDOW_BITS;
-    if (inflateInit2(session_data->compress_stream[source_id], window_bits) != Z_OK)
+    session_data->compress_stream[source_id] = File_Decomp_Get_Inflate(window_bits);
+    if (session_data->compress_stream[source_id] == nullptr)
     {
         session_data->compression[source_id] = CMP_NONE;
-        delete session_data->compress_stream[source_id];
-        session_data->compress_stream[source_id] = nullptr;
     }
 }
 
@@ -72,6 +72,15 @@ void NHttpMsgSection::update_depth() const
       }
     case CMP_GZIP:
     case CMP_DEFLATE:
+        if (depth <= 0)
+        {
+            // Nothing more will be inspected so the rest of the body is discarded still
+            // compressed. Stop inflating and give up the engine now rather than at end of body.
+            session_data->release_decompression(source_id);
+            session_data->section_size_target[source_id] = 0;
+            session_data->section_size_max[source_id] = 0;
+            break;
+        }
         session_data->section_size_target[source_id] = (depth > 0) ? GZIP_BLOCK_SIZE : 0;
         session_data->section_size_max[source_id] = (depth > 0) ? FINAL_GZIP_BLOCK_SIZE : 0;
         break;
@@ -28,6 +28,7 @@
 #include "nhttp_flow_data.h"
 #include "nhttp_transaction.h"
 #include "nhttp_infractions.h"
+#include "nhttp_object_pool.h"
 
 //-------------------------------------------------------------------------
 // NHttpMsgSection class
@@ -54,6 +55,11 @@ public:
 
     NHttpEnums::MethodId get_method_id() const { return method_id; }
 
+    // Every message creates and destroys several sections. Subclasses share these and the
+    // virtual destructor supplies the size of the actual subclass.
+    static void* operator new(size_t size) { return NHttpObjectPool::get(size); }
+    static void operator delete(void* p, size_t size) { NHttpObjectPool::put(p, size); }
+
 #ifdef REG_TEST
     // Test tool prints all derived message parts
     virtual void print_section(FILE* output) = 0;
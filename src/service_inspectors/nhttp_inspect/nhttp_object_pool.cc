@@ -0,0 +1,96 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// nhttp_object_pool.cc
+
+#include <new>
+
+#include "nhttp_object_pool.h"
+
+THREAD_LOCAL NHttpObjectPool::FreeList NHttpObjectPool::free_lists[MAX_SIZES];
+THREAD_LOCAL unsigned NHttpObjectPool::num_sizes = 0;
+THREAD_LOCAL bool NHttpObjectPool::pool_closed = false;
+THREAD_LOCAL uint64_t NHttpObjectPool::pool_hits = 0;
+THREAD_LOCAL uint64_t NHttpObjectPool::pool_misses = 0;
+
+NHttpObjectPool::FreeList* NHttpObjectPool::find_list(size_t size)
+{
+    for (unsigned k=0; k < num_sizes; k++)
+    {
+        if (free_lists[k].size == size)
+            return &free_lists[k];
+    }
+    return nullptr;
+}
+
+void* NHttpObjectPool::get(size_t size)
+{
+    FreeList* list = find_list(size);
+    if ((list != nullptr) && (list->head != nullptr))
+    {
+        FreeObject* const object = list->head;
+        list->head = object->next;
+        list->count--;
+        pool_hits++;
+        return object;
+    }
+    pool_misses++;
+    return ::operator new(size);
+}
+
+void NHttpObjectPool::put(void* object, size_t size)
+{
+    if (object == nullptr)
+        return;
+
+    FreeList* list = find_list(size);
+    if ((list == nullptr) && !pool_closed && (num_sizes < MAX_SIZES) &&
+        (size >= sizeof(FreeObject)))
+    {
+        list = &free_lists[num_sizes++];
+        list->size = size;
+        list->head = nullptr;
+        list->count = 0;
+    }
+
+    if (pool_closed || (list == nullptr) || (list->count >= MAX_CACHED))
+    {
+        ::operator delete(object);
+        return;
+    }
+
+    FreeObject* const free_object = static_cast<FreeObject*>(object);
+    free_object->next = list->head;
+    list->head = free_object;
+    list->count++;
+}
+
+void NHttpObjectPool::thread_term()
+{
+    for (unsigned k=0; k < num_sizes; k++)
+    {
+        while (free_lists[k].head != nullptr)
+        {
+            FreeObject* const object = free_lists[k].head;
+            free_lists[k].head = object->next;
+            ::operator delete(object);
+        }
+        free_lists[k].count = 0;
+    }
+    pool_closed = true;
+}
+
@@ -0,0 +1,76 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// nhttp_object_pool.h
+
+#ifndef NHTTP_OBJECT_POOL_H
+#define NHTTP_OBJECT_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "main/thread.h"
+
+//-------------------------------------------------------------------------
+// NHttpObjectPool class
+// Per-thread free lists for the transaction and message section objects that are created and
+// destroyed for every message. Classes use it through their own operator new and delete. Each
+// object size gets its own free list so the different message section subclasses do not mix.
+//-------------------------------------------------------------------------
+
+class NHttpObjectPool
+{
+public:
+    static void* get(size_t size);
+    static void put(void* object, size_t size);
+
+    // Free everything cached on this thread. Objects released afterward are freed directly.
+    static void thread_term();
+
+    // Objects handed out from the free lists and from the heap on this thread
+    static void get_counts(uint64_t& hits, uint64_t& misses) { hits = pool_hits;
+        misses = pool_misses; }
+
+private:
+    NHttpObjectPool() = delete;
+
+    static const unsigned MAX_SIZES = 16;
+    static const unsigned MAX_CACHED = 64;   // per size
+
+    struct FreeObject
+    {
+        FreeObject* next;
+    };
+
+    struct FreeList
+    {
+        size_t size;
+        FreeObject* head;
+        unsigned count;
+    };
+
+    static FreeList* find_list(size_t size);
+
+    static THREAD_LOCAL FreeList free_lists[MAX_SIZES];
+    static THREAD_LOCAL unsigned num_sizes;
+    static THREAD_LOCAL bool pool_closed;
+    static THREAD_LOCAL uint64_t pool_hits;
+    static THREAD_LOCAL uint64_t pool_misses;
+};
+
+#endif
+
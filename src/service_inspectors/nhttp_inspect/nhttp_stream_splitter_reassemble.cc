@@ -20,6 +20,7 @@
 #include <assert.h>
 #include <sys/types.h>
 
+#include "decompress/file_decomp.h"
 #include "file_api/file_flows.h"
 #include "nhttp_enum.h"
 #include "nhttp_field.h"
@@ -152,8 +153,7 @@ void NHttpStreamSplitter::decompress_copy(uint8_t* buffer, uint32_t& offset, con
                     events.create_event(EVENT_GZIP_OVERRUN);
                 }
                 compression = CMP_NONE;
-                inflateEnd(compress_stream);
-                delete compress_stream;
+                File_Decomp_Put_Inflate(compress_stream);
                 compress_stream = nullptr;
             }
             return;
@@ -179,8 +179,7 @@ void NHttpStreamSplitter::decompress_copy(uint8_t* buffer, uint32_t& offset, con
             infractions += INF_GZIP_FAILURE;
             events.create_event(EVENT_GZIP_FAILURE);
             compression = CMP_NONE;
-            inflateEnd(compress_stream);
-            delete compress_stream;
+            File_Decomp_Put_Inflate(compress_stream);
             compress_stream = nullptr;
             // Since we failed to uncompress the data, fall through
         }
@@ -392,6 +392,16 @@ void NHttpTestInput::scan(uint8_t*& data, uint32_t& length, SourceId source_id,
     if (skip_to_break)
         end_offset = 0;
     length = end_offset - previous_offset;
+
+    // Benchmark passes start the file over. The end of the file acts as a break command so the
+    // next pass begins on a new flow.
+    if ((length == 0) && NHttpTestManager::next_bench_pass())
+    {
+        rewind(test_data_file);
+        reset();
+        if (!skip_to_break)
+            need_break = true;
+    }
     return;
 }
 
@@ -21,8 +21,13 @@
 
 #include <stdexcept>
 
+#include "time/cpuclock.h"
+
 #include "nhttp_test_manager.h"
 #include "nhttp_test_input.h"
+#include "nhttp_object_pool.h"
+
+using namespace NHttpEnums;
 
 bool NHttpTestManager::test_input = false;
 bool NHttpTestManager::test_output = false;
@@ -33,6 +38,11 @@ FILE* NHttpTestManager::test_out = nullptr;
 long NHttpTestManager::print_amount = 1200;
 bool NHttpTestManager::print_hex = false;
 bool NHttpTestManager::show_pegs = true;
+bool NHttpTestManager::bench = false;
+long NHttpTestManager::bench_passes_left = 0;
+uint64_t NHttpTestManager::bench_count[BENCH_TYPES] = { 0 };
+uint64_t NHttpTestManager::bench_octets[BENCH_TYPES] = { 0 };
+uint64_t NHttpTestManager::bench_ticks[BENCH_TYPES] = { 0 };
 
 void NHttpTestManager::update_test_number(int64_t new_test_number)
 {
@@ -41,6 +51,13 @@ void NHttpTestManager::update_test_number(int64_t new_test_number)
         if (test_out != nullptr)
             fclose (test_out);
         test_number = new_test_number;
+        if (bench)
+        {
+            // Formatting still happens but the per-test result files do not
+            if ((test_out = fopen("/dev/null", "w")) == nullptr)
+                throw std::runtime_error("Cannot open test output file");
+            return;
+        }
         char file_name[100];
         snprintf(file_name, sizeof(file_name), "%s%" PRIi64 ".txt", test_output_prefix,
             test_number);
@@ -58,5 +75,65 @@ void NHttpTestManager::activate_test_input()
     }
 }
 
+void NHttpTestManager::set_bench_passes(long bench_passes_)
+{
+    bench = (bench_passes_ > 0);
+    bench_passes_left = bench_passes_ - 1;
+}
+
+bool NHttpTestManager::next_bench_pass()
+{
+    if (bench_passes_left <= 0)
+        return false;
+    bench_passes_left--;
+    return true;
+}
+
+void NHttpTestManager::bench_section(SectionType type, uint32_t octets, uint64_t ticks)
+{
+    if ((type < 0) || (type >= BENCH_TYPES))
+        return;
+    bench_count[type]++;
+    bench_octets[type] += octets;
+    bench_ticks[type] += ticks;
+}
+
+void NHttpTestManager::print_bench(FILE* output)
+{
+    static const char* const type_names[BENCH_TYPES] =
+        { nullptr, nullptr, "request", "status", "header", "body_cl", "body_chunk", "trailer",
+          "body_old" };
+
+    const double ticks_per_usec = get_ticks_per_usec();
+    uint64_t total_count = 0, total_octets = 0, total_ticks = 0;
+
+    fprintf(output, "nhttp benchmark\n");
+    fprintf(output, "%12s %10s %12s %12s %10s\n", "section", "count", "octets", "ticks/section",
+        "MB/sec");
+    for (int k = SEC_REQUEST; k < BENCH_TYPES; k++)
+    {
+        if (bench_count[k] == 0)
+            continue;
+        const double usecs = bench_ticks[k] / ticks_per_usec;
+        fprintf(output, "%12s %10" PRIu64 " %12" PRIu64 " %12" PRIu64 " %10.1f\n", type_names[k],
+            bench_count[k], bench_octets[k], bench_ticks[k] / bench_count[k],
+            (usecs > 0) ? bench_octets[k] / usecs : 0.0);
+        total_count += bench_count[k];
+        total_octets += bench_octets[k];
+        total_ticks += bench_ticks[k];
+    }
+
+    const double usecs = total_ticks / ticks_per_usec;
+    fprintf(output, "%12s %10" PRIu64 " %12" PRIu64 " %12" PRIu64 " %10.1f\n", "total",
+        total_count, total_octets, (total_count > 0) ? total_ticks / total_count : 0,
+        (usecs > 0) ? total_octets / usecs : 0.0);
+
+    uint64_t pool_hits, pool_misses;
+    NHttpObjectPool::get_counts(pool_hits, pool_misses);
+    fprintf(output, "object allocations per section: %.2f (%.2f from the pool)\n",
+        (total_count > 0) ? (double)(pool_hits + pool_misses) / total_count : 0.0,
+        (total_count > 0) ? (double)pool_hits / total_count : 0.0);
+}
+
 #endif
 
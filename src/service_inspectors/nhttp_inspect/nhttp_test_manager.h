@@ -25,6 +25,8 @@
 #include <sys/types.h>
 #include <stdio.h>
 
+#include "nhttp_enum.h"
+
 //-------------------------------------------------------------------------
 // NHttpTestManager class
 //-------------------------------------------------------------------------
@@ -49,6 +51,14 @@ public:
     static void set_show_pegs(bool show_pegs_) { show_pegs = show_pegs_; }
     static bool get_show_pegs() { return show_pegs; }
 
+    // Benchmark mode replays the test input file repeatedly, discards the section printouts, and
+    // accumulates per-section-type timing for print_bench()
+    static void set_bench_passes(long bench_passes_);
+    static bool use_bench() { return bench; }
+    static bool next_bench_pass();
+    static void bench_section(NHttpEnums::SectionType type, uint32_t octets, uint64_t ticks);
+    static void print_bench(FILE* output);
+
 private:
     NHttpTestManager() = delete;
 
@@ -63,6 +73,14 @@ private:
     static long print_amount;
     static bool print_hex;
     static bool show_pegs;
+
+    // Benchmark results indexed by SectionType
+    static const int BENCH_TYPES = NHttpEnums::SEC_BODY_OLD + 1;
+    static bool bench;
+    static long bench_passes_left;
+    static uint64_t bench_count[BENCH_TYPES];
+    static uint64_t bench_octets[BENCH_TYPES];
+    static uint64_t bench_ticks[BENCH_TYPES];
 };
 
 #endif
@@ -22,6 +22,7 @@
 
 #include "nhttp_enum.h"
 #include "nhttp_flow_data.h"
+#include "nhttp_object_pool.h"
 
 class NHttpMsgRequest;
 class NHttpMsgStatus;
@@ -59,6 +60,10 @@ public:
     void second_response_coming() { assert(response_seen); second_response_expected = true; }
     bool final_response() const { return !second_response_expected; }
 
+    // Keep-alive connections go through one of these per message so reuse the memory
+    static void* operator new(size_t size) { return NHttpObjectPool::get(size); }
+    static void operator delete(void* p, size_t size) { NHttpObjectPool::put(p, size); }
+
 private:
     NHttpTransaction() = default;
     ~NHttpTransaction();
@@ -28,8 +28,46 @@
 #include "nhttp_enum.h"
 #include "nhttp_uri_norm.h"
 
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#define URI_NORM_SIMD
+#endif
+
 using namespace NHttpEnums;
 
+// Return the offset of the first character that might need normalization or length if there are
+// none. The only entries in uri_char that are not CHAR_NORMAL or CHAR_EIGHTBIT are the ones for
+// these five characters so anything else can be skipped without consulting the table. Update this
+// if the module ever makes other characters special.
+static int32_t find_uri_special(const uint8_t* buf, int32_t length)
+{
+    int32_t k = 0;
+#ifdef URI_NORM_SIMD
+    for (; k + 16 <= length; k += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(buf + k));
+        const __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('%')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('+')),
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')),
+                    _mm_cmpeq_epi8(v, _mm_set1_epi8('.')))));
+
+        if (const unsigned bits = _mm_movemask_epi8(m))
+            return k + __builtin_ctz(bits);
+    }
+#endif
+    for (; k < length; k++)
+    {
+        switch (buf[k])
+        {
+        case '%': case '\\': case '+': case '/': case '.':
+            return k;
+        }
+    }
+    return length;
+}
+
 void UriNormalizer::normalize(const Field& input, Field& result, bool do_path, uint8_t* buffer,
     const NHttpParaList::UriParam& uri_param, NHttpInfractions& infractions, NHttpEventGen& events)
 {
@@ -72,7 +110,7 @@ bool UriNormalizer::need_norm_no_path(const Field& uri_component,
 {
     const int32_t& length = uri_component.length;
     const uint8_t* const & buf = uri_component.start;
-    for (int32_t k = 0; k < length; k++)
+    for (int32_t k = 0; (k += find_uri_special(buf + k, length - k)) < length; k++)
     {
         if ((uri_param.uri_char[buf[k]] == CHAR_PERCENT) ||
             (uri_param.uri_char[buf[k]] == CHAR_SUBSTIT))
@@ -86,7 +124,7 @@ bool UriNormalizer::need_norm_path(const Field& uri_component,
 {
     const int32_t& length = uri_component.length;
     const uint8_t* const & buf = uri_component.start;
-    for (int32_t k = 0; k < length; k++)
+    for (int32_t k = 0; (k += find_uri_special(buf + k, length - k)) < length; k++)
     {
         switch (uri_param.uri_char[buf[k]])
         {
@@ -36,6 +36,8 @@ FlowData::FlowData(unsigned, Inspector*) {}
 FlowData::~FlowData() {}
 int SnortEventqAdd(unsigned int, unsigned int, RuleType) { return 0; }
 THREAD_LOCAL PegCount NHttpModule::peg_counts[1];
+z_stream* File_Decomp_Get_Inflate(int) { return nullptr; }
+void File_Decomp_Put_Inflate(z_stream*) { }
 
 class NHttpUnitTestSetup
 {
@@ -18,6 +18,7 @@
 
 #include "pop_paf.h"
 
+#include <string.h>
 #include <sys/types.h>
 
 #include "main/snort_types.h"
@@ -289,6 +290,19 @@ static StreamSplitter::Status pop_paf_server(PopPafData* pfdata,
 
         case POP_PAF_SINGLE_LINE_STATE:
         default:
+            // only the end of line matters here
+            if ( ch != '\n' )
+            {
+                const uint8_t* lf = (const uint8_t*)memchr(data + i, '\n', len - i);
+
+                if ( !lf )
+                {
+                    i = len;
+                    break;
+                }
+                i = lf - data;
+                ch = '\n';
+            }
             if ( find_data_end_single_line(pfdata, ch, false) )
             {
                 *fp = i + 1;
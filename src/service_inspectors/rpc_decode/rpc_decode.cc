@@ -67,6 +67,10 @@
 
 static THREAD_LOCAL DataBuffer DecodeBuffer;
 
+// a record that is already contiguous in the packet is exposed in place;
+// otherwise the alt buffer is DecodeBuffer.data
+static THREAD_LOCAL const uint8_t* decode_view = nullptr;
+
 using namespace std;
 
 struct RpcDecodeConfig
@@ -118,6 +122,9 @@ static THREAD_LOCAL const uint32_t flush_size = 28;
 static THREAD_LOCAL const uint32_t rpc_memcap = 1048510;
 static THREAD_LOCAL uint32_t rpc_memory = 0;
 
+// session buffers up to this size are kept for the next record
+#define RPC_BUF_KEEP 4096
+
 #define mod_name "rpc_decode"
 #define mod_help "RPC inspector"
 
@@ -135,12 +142,14 @@ static RpcStatus RpcStatefulInspection(RpcDecodeConfig*, RpcSsnData*, Packet*);
 static inline void RpcPreprocEvent(RpcDecodeConfig*, RpcSsnData*, int);
 static RpcStatus RpcHandleFrag(RpcDecodeConfig*, RpcSsnData*, const uint8_t*);
 static RpcStatus RpcPrepRaw(const uint8_t*, uint32_t, Packet*);
+static uint32_t RpcPrepRecord(RpcDecodeConfig*, RpcSsnData*, const uint8_t*, uint32_t, bool);
 static RpcStatus RpcPrepFrag(RpcSsnData*, Packet*);
 static RpcStatus RpcPrepSeg(RpcSsnData*, Packet*);
 static inline uint32_t RpcBufLen(RpcBuffer*);
 static inline uint8_t* RpcBufData(RpcBuffer*);
 static RpcStatus RpcBufAdd(RpcBuffer*, const uint8_t*, uint32_t);
 static inline void RpcBufClean(RpcBuffer*);
+static inline void RpcBufReset(RpcBuffer*);
 
 static inline void* RpcAlloc(uint32_t);
 static inline void RpcFree(void*, uint32_t);
@@ -265,6 +274,28 @@ static RpcStatus RpcStatefulInspection(RpcDecodeConfig* rconfig,
                 break;
             }
 
+            if (RpcBufLen(&rsdata->frag) == 0)
+            {
+                uint32_t used = RpcPrepRecord(rconfig, rsdata, data, dsize, data == p->data);
+
+                if (used)
+                {
+                    dsize -= used;
+
+                    DebugMessage(DEBUG_RPC,
+                        "STATEFUL: Whole record - calling detect\n");
+
+                    if ((dsize != 0) || (data != p->data))
+                        get_data_bus().publish(PACKET_EVENT_ID, p);
+
+                    if ( (dsize > 0) )
+                        RpcPreprocEvent(rconfig, rsdata, RPC_MULTIPLE_RECORD);
+
+                    data += used;
+                    continue;
+                }
+            }
+
             dsize -= (RPC_FRAG_HDR_SIZE + rsdata->frag_len);
 
             status = RpcHandleFrag(rconfig, rsdata, data);
@@ -277,14 +308,25 @@ static RpcStatus RpcStatefulInspection(RpcDecodeConfig* rconfig,
                 DebugMessage(DEBUG_RPC,
                     "STATEFUL: Last frag - calling detect\n");
 
-                if ((dsize != 0) || (data != p->data))
+                // the earlier fragments came in previous packets
+                if (RpcBufLen(&rsdata->frag) != 0)
+                {
+                    if (RpcPrepFrag(rsdata, p) != RPC_STATUS__SUCCESS)
+                        return RPC_STATUS__ERROR;
+
+                    RpcBufReset(&rsdata->frag);
+
+                    if ((dsize != 0) || (data != p->data))
+                        get_data_bus().publish(PACKET_EVENT_ID, p);
+                }
+                else if ((dsize != 0) || (data != p->data))
                 {
                     /* Only do this if there is more than one fragment in
                      * the data we got */
                     if (RpcPrepRaw(data, rsdata->frag_len, p) != RPC_STATUS__SUCCESS)
                         return RPC_STATUS__ERROR;
 
-                    get_data_bus().publish(PACKET_EVENT, p);
+                    get_data_bus().publish(PACKET_EVENT_ID, p);
                 }
 
                 if ( (dsize > 0) )
@@ -369,11 +411,11 @@ static RpcStatus RpcStatefulInspection(RpcDecodeConfig* rconfig,
                 if ( (dsize > 0) )
                     RpcPreprocEvent(rconfig, rsdata, RPC_MULTIPLE_RECORD);
 
-                get_data_bus().publish(PACKET_EVENT, p);
-                RpcBufClean(&rsdata->frag);
+                get_data_bus().publish(PACKET_EVENT_ID, p);
+                RpcBufReset(&rsdata->frag);
             }
 
-            RpcBufClean(&rsdata->seg);
+            RpcBufReset(&rsdata->seg);
         }
     }
 
@@ -402,18 +444,86 @@ static RpcStatus RpcStatefulInspection(RpcDecodeConfig* rconfig,
     return RPC_STATUS__SUCCESS;
 }
 
+// a single fragment is already a decoded record
 static RpcStatus RpcPrepRaw(const uint8_t* data, uint32_t fraglen, Packet*)
 {
-    if (RPC_FRAG_HDR_SIZE + fraglen > sizeof(DecodeBuffer.data))
-        return RPC_STATUS__ERROR;
-
-    memcpy_s(DecodeBuffer.data, sizeof(DecodeBuffer.data), data, RPC_FRAG_HDR_SIZE + fraglen);
-
+    decode_view = data;
     DecodeBuffer.len = (RPC_FRAG_HDR_SIZE + fraglen);
 
     return RPC_STATUS__SUCCESS;
 }
 
+/* If every fragment of the record starting at data is there, prep it
+ * without the frag buffer: one fragment is exposed in place and several
+ * are copied once with their headers stripped.  Returns the bytes of
+ * data used or 0 if the record must be reassembled. */
+static uint32_t RpcPrepRecord(RpcDecodeConfig* rconfig, RpcSsnData* rsdata,
+    const uint8_t* data, uint32_t dsize, bool at_start)
+{
+    uint32_t off = 0;
+    uint32_t payload = 0;
+    unsigned frags = 0;
+    int last_frag = 0;
+
+    while (!last_frag)
+    {
+        if (dsize - off < RPC_FRAG_HDR_SIZE)
+            return 0;
+
+        uint32_t frag_len = RPC_FRAG_LEN(data + off);
+
+        if (frag_len > dsize - off - RPC_FRAG_HDR_SIZE)
+            return 0;
+
+        last_frag = data[off] & 0x80;
+        off += RPC_FRAG_HDR_SIZE + frag_len;
+        payload += frag_len;
+        ++frags;
+    }
+
+    if (frags > 1 and RPC_FRAG_HDR_SIZE + payload > sizeof(DecodeBuffer.data))
+        return 0;
+
+    // raise what RpcHandleFrag would have for each fragment
+    uint8_t* norm = DecodeBuffer.data + RPC_FRAG_HDR_SIZE;
+
+    for (uint32_t i = 0; i < off; )
+    {
+        uint32_t frag_len = RPC_FRAG_LEN(data + i);
+
+        if (frag_len == 0)
+            RpcPreprocEvent(rconfig, rsdata, RPC_ZERO_LENGTH_FRAGMENT);
+
+        if (!(data[i] & 0x80))
+            RpcPreprocEvent(rconfig, rsdata, RPC_FRAG_TRAFFIC);
+
+        if (frags > 1)
+        {
+            memcpy_s(norm, DecodeBuffer.data + sizeof(DecodeBuffer.data) - norm,
+                data + i + RPC_FRAG_HDR_SIZE, frag_len);
+            norm += frag_len;
+        }
+        i += RPC_FRAG_HDR_SIZE + frag_len;
+    }
+
+    if (frags > 1)
+    {
+        uint32_t fraghdr = htonl(payload);
+        memcpy(DecodeBuffer.data, &fraghdr, sizeof(fraghdr));
+        DecodeBuffer.data[0] |= 0x80;
+        DecodeBuffer.len = RPC_FRAG_HDR_SIZE + payload;
+        decode_view = nullptr;
+    }
+    // a lone record that is the whole packet needs no alt buffer
+    else if (!at_start or off != dsize)
+    {
+        decode_view = data;
+        DecodeBuffer.len = off;
+    }
+
+    return off;
+}
+
 static RpcStatus RpcPrepFrag(RpcSsnData* rsdata, Packet*)
 {
     uint32_t fraghdr = htonl(RpcBufLen(&rsdata->frag));
@@ -438,6 +548,7 @@ static RpcStatus RpcPrepFrag(RpcSsnData* rsdata, Packet*)
         RpcBufClean(&rsdata->frag);
 
     DecodeBuffer.len = RpcBufLen(&rsdata->frag);
+    decode_view = nullptr;
 
     return RPC_STATUS__SUCCESS;
 }
@@ -461,6 +572,7 @@ static RpcStatus RpcPrepSeg(RpcSsnData* rsdata, Packet*)
     }
 
     DecodeBuffer.len = (uint16_t)RpcBufLen(&rsdata->seg);
+    decode_view = nullptr;
 
     return RPC_STATUS__SUCCESS;
 }
@@ -533,8 +645,21 @@ static RpcStatus RpcBufAdd(RpcBuffer* buf, const uint8_t* data, uint32_t dsize)
     }
     else if ((buf->len + dsize) > buf->size)
     {
+        // grow geometrically so a record of many fragments isn't copied
+        // again for each one
         uint32_t new_size = buf->len + alloc_size;
-        uint8_t* tmp = (uint8_t*)RpcAlloc(new_size);
+        uint8_t* tmp = nullptr;
+
+        if (new_size < 2 * buf->size)
+        {
+            tmp = (uint8_t*)RpcAlloc(2 * buf->size);
+
+            if (tmp != NULL)
+                new_size = 2 * buf->size;
+        }
+
+        if (tmp == NULL)
+            tmp = (uint8_t*)RpcAlloc(new_size);
 
         if (tmp == NULL)
         {
@@ -585,6 +710,15 @@ static inline void RpcBufClean(RpcBuffer* buf)
     buf->size = 0;
 }
 
+// start the next record without giving back a small buffer
+static inline void RpcBufReset(RpcBuffer* buf)
+{
+    if (buf->size > RPC_BUF_KEEP)
+        RpcBufClean(buf);
+    else
+        buf->len = 0;
+}
+
 static inline void* RpcAlloc(uint32_t size)
 {
     if ((rpc_memory + size) > rpc_memcap)
@@ -895,6 +1029,7 @@ static int ConvertRPC(RpcDecodeConfig* rconfig, RpcSsnData* rsdata, Packet* p)
     //LogNetData(data, decoded_len, p);
 
     DecodeBuffer.len = (uint16_t)decoded_len;
+    decode_view = nullptr;
     return 0;
 }
 
@@ -939,10 +1074,11 @@ public:
 
     void show(SnortConfig*) override;
     void eval(Packet*) override;
+    // not cacheable; each record of a pdu is published with its own buffer
     bool get_buf(InspectionBuffer::Type, Packet*, InspectionBuffer&) override;
 
     void clear(Packet*) override
-    { DecodeBuffer.len = 0; }
+    { DecodeBuffer.len = 0; decode_view = nullptr; }
 
 
     StreamSplitter* get_splitter(bool c2s) override
@@ -1021,7 +1157,11 @@ bool RpcDecode::get_buf(InspectionBuffer::Type ibt, Packet*, InspectionBuffer& b
         return false;
 
     b.len = DecodeBuffer.len;
-    b.data = (b.len > 0) ? DecodeBuffer.data : nullptr;
+
+    if ( !b.len )
+        b.data = nullptr;
+    else
+        b.data = decode_view ? decode_view : DecodeBuffer.data;
 
     return (b.data != nullptr);
 }
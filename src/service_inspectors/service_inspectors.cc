@@ -40,6 +40,8 @@ extern const BaseApi* ips_dnp3_data;
 extern const BaseApi* ips_dnp3_func;
 extern const BaseApi* ips_dnp3_ind;
 extern const BaseApi* ips_dnp3_obj;
+extern const BaseApi* ips_dns_answer;
+extern const BaseApi* ips_dns_query;
 extern const BaseApi* ips_gtp_info;
 extern const BaseApi* ips_gtp_type;
 extern const BaseApi* ips_gtp_version;
@@ -105,6 +107,8 @@ const BaseApi* service_inspectors[] =
     ips_dnp3_func,
     ips_dnp3_ind,
     ips_dnp3_obj,
+    ips_dns_answer,
+    ips_dns_query,
     ips_gtp_info,
     ips_gtp_type,
     ips_gtp_version,
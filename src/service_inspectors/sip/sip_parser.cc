@@ -30,6 +30,7 @@
 #include "main/snort_debug.h"
 #include "main/snort_config.h"
 #include "sfip/sf_ip.h"
+#include "utils/kw_hash.h"
 
 #include "sip_parser.h"
 #include "sip_config.h"
@@ -101,6 +102,15 @@ typedef struct _SIPbodyField
  * header field name, short form field name, and field processing function
  */
 
+enum SIPheaderIndex
+{
+    SIP_HDR_VIA, SIP_HDR_FROM, SIP_HDR_TO, SIP_HDR_CALL_ID, SIP_HDR_CSEQ,
+    SIP_HDR_CONTACT, SIP_HDR_AUTHORIZATION, SIP_HDR_CONTENT_TYPE,
+    SIP_HDR_CONTENT_LENGTH, SIP_HDR_CONTENT_ENCODING, SIP_HDR_USER_AGENT,
+    SIP_HDR_SERVER
+};
+
+// must match the order of SIPheaderIndex
 SIPheaderField headerFields[] =
 {
     { "Via", 3, "v",  &sip_parse_via },
@@ -130,6 +140,75 @@ SIPbodyField bodyFields[] =
     { NULL, 0, NULL }
 };
 
+/*
+ * Map full and short header names to their headerFields[] index in one
+ * step.  The seed is perfect for these names; a collision after adding
+ * a field shows up as a duplicate case label at build time.
+ */
+#define SIP_HDR_SEED  641
+#define SIP_HDR_SLOTS 32
+
+#define SIP_HDR_CASE(s) case KW_SLOT(s, SIP_HDR_SEED, SIP_HDR_SLOTS)
+
+static int sip_find_headField(const char* name, int len)
+{
+    int findex;
+
+    if (len <= 0)
+        return -1;
+
+    switch ( kw_slot(name, len, SIP_HDR_SEED, SIP_HDR_SLOTS) )
+    {
+    SIP_HDR_CASE("Via"):
+    SIP_HDR_CASE("v"):
+        findex = SIP_HDR_VIA; break;
+    SIP_HDR_CASE("From"):
+    SIP_HDR_CASE("f"):
+        findex = SIP_HDR_FROM; break;
+    SIP_HDR_CASE("To"):
+    SIP_HDR_CASE("t"):
+        findex = SIP_HDR_TO; break;
+    SIP_HDR_CASE("Call-ID"):
+    SIP_HDR_CASE("i"):
+        findex = SIP_HDR_CALL_ID; break;
+    SIP_HDR_CASE("CSeq"):
+        findex = SIP_HDR_CSEQ; break;
+    SIP_HDR_CASE("Contact"):
+    SIP_HDR_CASE("m"):
+        findex = SIP_HDR_CONTACT; break;
+    SIP_HDR_CASE("Authorization"):
+        findex = SIP_HDR_AUTHORIZATION; break;
+    SIP_HDR_CASE("Content-Type"):
+    SIP_HDR_CASE("c"):
+        findex = SIP_HDR_CONTENT_TYPE; break;
+    SIP_HDR_CASE("Content-Length"):
+    SIP_HDR_CASE("l"):
+        findex = SIP_HDR_CONTENT_LENGTH; break;
+    SIP_HDR_CASE("Content-Encoding"):
+    SIP_HDR_CASE("e"):
+        findex = SIP_HDR_CONTENT_ENCODING; break;
+    SIP_HDR_CASE("User-Agent"):
+        findex = SIP_HDR_USER_AGENT; break;
+    SIP_HDR_CASE("Server"):
+        findex = SIP_HDR_SERVER; break;
+    default:
+        return -1;
+    }
+
+    const SIPheaderField& hf = headerFields[findex];
+
+    //Use the full name to check
+    if ((hf.fnameLen == len) && (0 == strncasecmp(hf.fname, name, len)))
+        return findex;
+
+    //Use short name to check
+    if ((NULL != hf.shortName) && (1 == len) &&
+        (0 == strncasecmp(hf.shortName, name, len)))
+        return findex;
+
+    return -1;
+}
+
 /********************************************************************
  * Function: sip_process_headField()
  *
@@ -148,7 +227,7 @@ SIPbodyField bodyFields[] =
 static int sip_process_headField(SIPMsg* msg, const char* start, const char* end,
     int* lastFieldIndex, SIP_PROTO_CONF* config)
 {
-    int findex =0;
+    int findex;
     int length = end -start;
     char* colonIndex;
     char* newStart, * newEnd, newLength;
@@ -175,25 +254,9 @@ static int sip_process_headField(SIPMsg* msg, const char* start, const char* end
     newLength =  newEnd - newStart;
 
     /*Find out whether the field name needs to process*/
-    while (NULL != headerFields[findex].fname)
-    {
-        //Use the full name to check
-        if ((headerFields[findex].fnameLen == newLength)&&
-            (0 == strncasecmp(headerFields[findex].fname, newStart, newLength)))
-        {
-            break;
-        }
-        //Use short name to check
-        else if ((NULL != headerFields[findex].shortName) &&
-            ( 1 == newLength)&&
-            (0 == strncasecmp(headerFields[findex].shortName, newStart, newLength)))
-        {
-            break;
-        }
-        findex++;
-    }
+    findex = sip_find_headField(newStart, newLength);
 
-    if (NULL != headerFields[findex].fname)
+    if (findex >= 0)
     {
         // Found the field name, evaluate the value
         SIP_TrimSP(colonIndex + 1, end, &newStart, &newEnd);
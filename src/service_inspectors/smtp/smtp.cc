@@ -1500,6 +1500,8 @@ public:
     void show(SnortConfig*) override;
     void eval(Packet*) override;
     bool get_buf(InspectionBuffer::Type, Packet*, InspectionBuffer&) override;
+    bool cacheable(InspectionBuffer::Type) override
+    { return true; }
     void clear(Packet*) override;
 
     StreamSplitter* get_splitter(bool c2s) override
@@ -18,6 +18,7 @@
 
 #include "smtp_paf.h"
 
+#include <string.h>
 #include <sys/types.h>
 
 #include "main/snort_types.h"
@@ -293,6 +294,20 @@ static inline StreamSplitter::Status smtp_paf_client(SmtpPafData* pfdata,
         switch (pfdata->smtp_state)
         {
         case SMTP_PAF_CMD_STATE:
+            // skip to EOL when no command is being parsed
+            if ((pfdata->cmd_info.cmd_state == SMTP_PAF_CMD_UNKNOWN) ||
+                (pfdata->cmd_info.cmd_state == SMTP_PAF_CMD_DATA_END_STATE))
+            {
+                const uint8_t* lf = (const uint8_t*)memchr(data + i, '\n', len - i);
+
+                if (!lf)
+                {
+                    i = len;
+                    break;
+                }
+                i = lf - data;
+                ch = '\n';
+            }
             if (process_command(pfdata, ch))
             {
                 DebugFormat(DEBUG_SMTP, "Flush command: %s \n", data);
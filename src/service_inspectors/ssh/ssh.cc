@@ -34,6 +34,7 @@
 #include <stdio.h>
 #include <sys/types.h>
 
+#include "detection/detect.h"
 #include "events/event_queue.h"
 #include "log/messages.h"
 #include "main/snort_types.h"
@@ -45,11 +46,12 @@
 #include "framework/inspector.h"
 #include "utils/sfsnprintfappend.h"
 #include "target_based/snort_protocols.h"
+#include "time/packet_time.h"
 
 #include "ssh_module.h"
 
 THREAD_LOCAL ProfileStats sshPerfStats;
-THREAD_LOCAL SimpleStats sshstats;
+THREAD_LOCAL SshStats sshstats;
 
 /*
  * Function prototype(s)
@@ -65,6 +67,7 @@ static SSHData* SetNewSSHData(Packet* p)
 {
     SshFlowData* fd = new SshFlowData;
     p->flow->set_application_data(fd);
+    ++sshstats.sessions;
     return &fd->session;
 }
 
@@ -99,6 +102,10 @@ static void PrintSshConf(SSH_PROTO_CONF* config)
         == SSH_DEFAULT_MAX_CLIENT_BYTES ?
         "(Default)" : "");
 
+    LogMessage("    Bypass After Key Exchange: %s\n",
+        config->BypassAfterKex == SSH_BYPASS_ALL ? "all" :
+        config->BypassAfterKex == SSH_BYPASS_INSPECTION ? "inspection" : "none");
+
     LogMessage("\n");
 }
 
@@ -132,6 +139,71 @@ static unsigned int SSHPacket_GetLength(SSH2Packet* p, size_t buflen)
     return ssh_length;
 }
 
+// per flow telemetry is updated for every payload we see, before any
+// bypass check, so it remains available for the life of the session
+static inline void SSHUpdateCounts(SSHData* sessp, Packet* p)
+{
+    time_t now = packet_time();
+
+    if ( !sessp->first_seen )
+        sessp->first_seen = now;
+
+    sessp->last_seen = now;
+
+    if ( p->is_from_server() )
+        sessp->server_bytes += p->dsize;
+    else
+        sessp->client_bytes += p->dsize;
+}
+
+// the server NEWKEYS may arrive after the client's NEWKEYS has already put
+// the session in encrypted mode; it is the first server message in the
+// clear so only the first server packet after that is checked
+static void SSHCheckServerNewKeys(SSHData* sessp, Packet* p, unsigned int offset)
+{
+    sessp->state_flags |= SSH_FLG_SERV_ENC_SEEN;
+
+    if ( offset >= p->dsize or p->dsize - offset < SSH2_HEADERLEN + 1 )
+        return;
+
+    SSH2Packet* ssh2p = (SSH2Packet*)(p->data + offset);
+
+    if ( SSHPacket_GetLength(ssh2p, p->dsize - offset) and
+        ssh2p->packet_data[0] == SSH_MSG_NEWKEYS )
+        sessp->state_flags |= SSH_FLG_SERV_NEWKEYS_SEEN;
+}
+
+// once both sides have sent NEWKEYS everything else is encrypted and all
+// that is left to check are the byte count heuristics; if configured, give
+// that up for the cost of inspecting the rest of the session
+static bool SSHCheckBypass(SSH_PROTO_CONF* config, SSHData* sessp, Packet* p)
+{
+    if ( (sessp->state_flags & SSH_FLG_BOTH_NEWKEYS_SEEN) != SSH_FLG_BOTH_NEWKEYS_SEEN )
+        return false;
+
+    if ( sessp->state_flags & SSH_FLG_BYPASSED )
+        return true;
+
+    if ( !(sessp->state_flags & SSH_FLG_KEX_DONE) )
+    {
+        sessp->state_flags |= SSH_FLG_KEX_DONE;
+        ++sshstats.kex_done;
+    }
+
+    if ( config->BypassAfterKex == SSH_BYPASS_NONE )
+        return false;
+
+    sessp->state_flags |= SSH_FLG_BYPASSED;
+    ++sshstats.bypassed;
+
+    if ( config->BypassAfterKex == SSH_BYPASS_ALL )
+    {
+        stream.stop_inspection(p->flow, p, SSN_DIR_BOTH, -1, 0);
+        DisableInspection();
+    }
+    return true;
+}
+
 /* Main runtime entry point for SSH preprocessor.
  * Analyzes SSH packets for anomalies/exploits.
  *
@@ -162,15 +234,17 @@ static void snort_ssh(SSH_PROTO_CONF* config, Packet* p)
 
     }
 
-    // Don't process if we've missed packets
-    if (sessp->state_flags & SSH_FLG_MISSED_PACKETS)
-        return;
-
     // Make sure this preprocessor should run.
     // check if we're waiting on stream reassembly
     if ( p->packet_flags & PKT_STREAM_INSERT )
         return;
 
+    SSHUpdateCounts(sessp, p);
+
+    // Don't process if we've missed packets or bypassed after kex
+    if (sessp->state_flags & (SSH_FLG_MISSED_PACKETS | SSH_FLG_BYPASSED))
+        return;
+
     // If we picked up mid-stream or missed any packets (midstream pick up
     // means we've already missed packets) set missed packets flag and make
     // sure we don't do any more reassembly on this session
@@ -239,6 +313,10 @@ static void snort_ssh(SSH_PROTO_CONF* config, Packet* p)
         // The actual key exchange type was negotiated in the
         // key exchange init msgs. SSH1 won't arrive here.
         offset = ProcessSSHKeyExchange(sessp, p, direction, offset);
+
+        if ( SSHCheckBypass(config, sessp, p) )
+            return;
+
         if (!offset)
             return;
     }
@@ -251,6 +329,15 @@ static void snort_ssh(SSH_PROTO_CONF* config, Packet* p)
         // the encrypted portion of the SSH session. Therefore,
         // the only way to detect these attacks is by examining
         // amounts of data exchanged for anomalies.
+        if ( direction == SSH_DIR_FROM_SERVER and
+            !(sessp->state_flags & SSH_FLG_SERV_ENC_SEEN) )
+        {
+            SSHCheckServerNewKeys(sessp, p, offset);
+
+            if ( SSHCheckBypass(config, sessp, p) )
+                return;
+        }
+
         sessp->num_enc_pkts++;
 
         if ( sessp->num_enc_pkts <= config->MaxEncryptedPackets )
@@ -695,6 +782,11 @@ static unsigned int ProcessSSHKeyExchange(SSHData* sessionp, Packet* p,
             {
                 sessionp->state_flags |= SSH_FLG_NEWKEYS_SEEN;
             }
+            else
+            {
+                // only needed to tell when both sides are done
+                sessionp->state_flags |= SSH_FLG_SERV_NEWKEYS_SEEN;
+            }
             break;
         default:
             /* Unrecognized message type. Possibly encrypted */
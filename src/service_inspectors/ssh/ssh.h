@@ -42,6 +42,12 @@ struct SSHData
     uint16_t num_enc_pkts;     // encrypted packets seen on this session
     uint16_t num_client_bytes; // bytes of encrypted data sent by client without a server response
     uint32_t state_flags;      // Bit vector describing the current state of the session
+
+    // telemetry kept for the life of the flow, including after bypass
+    uint64_t client_bytes;     // payload bytes seen from client
+    uint64_t server_bytes;     // payload bytes seen from server
+    time_t first_seen;         // packet time of first payload
+    time_t last_seen;          // packet time of latest payload
 };
 
 class SshFlowData : public FlowData
@@ -82,6 +88,10 @@ public:
 #define SSH_FLG_MISSED_PACKETS      (0x10000)
 #define SSH_FLG_REASSEMBLY_SET      (0x20000)
 #define SSH_FLG_AUTODETECTED        (0x40000)
+#define SSH_FLG_SERV_NEWKEYS_SEEN   (0x80000)
+#define SSH_FLG_SERV_ENC_SEEN       (0x100000)
+#define SSH_FLG_BYPASSED            (0x200000)
+#define SSH_FLG_KEX_DONE            (0x400000)
 
 // Some convenient combinations of state flags.
 #define SSH_FLG_BOTH_IDSTRING_SEEN \
@@ -108,6 +118,11 @@ public:
     SSH_FLG_GEX_REPLY_SEEN | \
     SSH_FLG_NEWKEYS_SEEN )
 
+// both sides have switched to the negotiated keys
+#define SSH_FLG_BOTH_NEWKEYS_SEEN \
+    (SSH_FLG_NEWKEYS_SEEN | \
+    SSH_FLG_SERV_NEWKEYS_SEEN )
+
 // SSH version values for SSHData::version
 #define SSH_VERSION_UNKNOWN (0x0)
 #define SSH_VERSION_1       (0x1)
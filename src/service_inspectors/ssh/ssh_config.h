@@ -24,15 +24,25 @@
 
 // Configuration for SSH service inspector
 
+// what to stop once both sides have sent NEWKEYS
+enum SshBypass
+{
+    SSH_BYPASS_NONE,        // keep inspecting per max_encrypted_packets
+    SSH_BYPASS_INSPECTION,  // stop ssh inspection only
+    SSH_BYPASS_ALL          // also stop stream reassembly and detection
+};
+
 struct SSH_PROTO_CONF
 {
     uint16_t MaxEncryptedPackets;
     uint16_t MaxClientBytes;
     uint16_t MaxServerVersionLen;
+    SshBypass BypassAfterKex;
 };
 
 #define SSH_DEFAULT_MAX_ENC_PKTS    25
 #define SSH_DEFAULT_MAX_CLIENT_BYTES    19600
 #define SSH_DEFAULT_MAX_SERVER_VERSION_LEN 80
+#define SSH_DEFAULT_BYPASS_AFTER_KEX SSH_BYPASS_NONE
 
 #endif
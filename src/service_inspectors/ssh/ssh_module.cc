@@ -48,9 +48,22 @@ static const Parameter s_params[] =
     { "max_server_version_len", Parameter::PT_INT, "0:255", "80",
       "limit before alerting on secure CRT server version string overflow" },
 
+    { "bypass_after_kex", Parameter::PT_ENUM, "none | inspection | all", "none",
+      "once both sides send NEWKEYS stop ssh inspection, or ssh, stream reassembly, "
+      "and detection; disables the encrypted exploit checks" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
+const PegInfo ssh_pegs[] =
+{
+    { "packets", "total packets" },
+    { "sessions", "total ssh sessions" },
+    { "kex done", "sessions where both sides sent NEWKEYS" },
+    { "bypassed", "sessions bypassed after key exchange" },
+    { nullptr, nullptr }
+};
+
 static const RuleMap ssh_rules[] =
 {
     { SSH_EVENT_RESPOVERFLOW, SSH_EVENT_RESPOVERFLOW_STR },
@@ -82,7 +95,7 @@ const RuleMap* SshModule::get_rules() const
 { return ssh_rules; }
 
 const PegInfo* SshModule::get_pegs() const
-{ return simple_pegs; }
+{ return ssh_pegs; }
 
 PegCount* SshModule::get_counts() const
 { return (PegCount*)&sshstats; }
@@ -101,6 +114,9 @@ bool SshModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("max_server_version_len") )
         conf->MaxServerVersionLen = v.get_long();
 
+    else if ( v.is("bypass_after_kex") )
+        conf->BypassAfterKex = (SshBypass)v.get_long();
+
     else
         return false;
 
@@ -120,6 +136,7 @@ bool SshModule::begin(const char*, int, SnortConfig*)
     conf->MaxClientBytes = SSH_DEFAULT_MAX_CLIENT_BYTES;
     conf->MaxEncryptedPackets = SSH_DEFAULT_MAX_ENC_PKTS;
     conf->MaxServerVersionLen = SSH_DEFAULT_MAX_SERVER_VERSION_LEN;
+    conf->BypassAfterKex = SSH_DEFAULT_BYPASS_AFTER_KEX;
     return true;
 }
 
@@ -43,7 +43,16 @@
 
 struct SnortConfig;
 
-extern THREAD_LOCAL SimpleStats sshstats;
+struct SshStats
+{
+    PegCount total_packets;
+    PegCount sessions;
+    PegCount kex_done;
+    PegCount bypassed;
+};
+
+extern const PegInfo ssh_pegs[];
+extern THREAD_LOCAL SshStats sshstats;
 extern THREAD_LOCAL ProfileStats sshPerfStats;
 
 class SshModule : public Module
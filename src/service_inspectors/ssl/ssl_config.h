@@ -26,6 +26,7 @@
 struct SSL_PROTO_CONF
 {
     bool trustservers;
+    bool stop_after_handshake;
     int max_heartbeat_len;
 };
 
@@ -106,6 +106,9 @@ static void PrintSslConf(SSL_PROTO_CONF* config)
     {
         LogMessage("    Server side data is trusted\n");
     }
+    LogMessage("    Stop after handshake: %s\n",
+        config->stop_after_handshake ? "ENABLED" : "DISABLED");
+    LogMessage("    Max heartbeat length: %d\n", config->max_heartbeat_len);
 
     LogMessage("\n");
 }
@@ -177,6 +180,29 @@ static inline bool SSLPP_is_encrypted(SSL_PROTO_CONF* config, uint32_t ssl_flags
     return false;
 }
 
+/* Once the session is encrypted only the record headers are left to
+ * look at.  Without heartbeat checks the flow is bypassed entirely, which
+ * also whitelists it with the DAQ where supported.  Otherwise ssl keeps
+ * checking heartbeats but everything else skips detection. */
+static inline void SSLPP_stop_encrypted(SSL_PROTO_CONF* config, uint32_t new_flags,
+    Packet* packet)
+{
+    if (!config->stop_after_handshake)
+        return;
+
+    if (!config->max_heartbeat_len)
+    {
+        DebugMessage(DEBUG_SSL, "STOPPING INSPECTION\n");
+        stream.stop_inspection(packet->flow, packet, SSN_DIR_BOTH, -1, 0);
+        sslstats.stopped++;
+    }
+    else if (!(new_flags & SSL_HEARTBEAT_SEEN))
+    {
+        DisableDetect();
+        sslstats.disabled++;
+    }
+}
+
 static inline uint32_t SSLPP_process_alert(
     SSL_PROTO_CONF*, uint32_t ssn_flags, uint32_t new_flags, const Packet* packet)
 {
@@ -233,18 +259,7 @@ static inline uint32_t SSLPP_process_app(SSL_PROTO_CONF* config, uint32_t ssn_fl
     if (SSLPP_is_encrypted(config, ssn_flags | new_flags, packet) )
     {
         ssn_flags |= SSL_ENCRYPTED_FLAG;
-
-        // Heartbleed check is disabled. Stop inspection on this session.
-        if (!config->max_heartbeat_len)
-        {
-            DebugMessage(DEBUG_SSL, "STOPPING INSPECTION (process_app)\n");
-            stream.stop_inspection(packet->flow, packet, SSN_DIR_BOTH, -1, 0);
-            sslstats.stopped++;
-        }
-        else if (!(new_flags & SSL_HEARTBEAT_SEEN))
-        {
-            DisableDetect();
-        }
+        SSLPP_stop_encrypted(config, new_flags, packet);
     }
 
     return ssn_flags | new_flags;
@@ -262,16 +277,7 @@ static inline void SSLPP_process_other(SSL_PROTO_CONF* config, SSLData* sd, uint
         !(new_flags & SSL_HEARTBEAT_SEEN))
     {
         sd->ssn_flags |= SSL_ENCRYPTED_FLAG | new_flags;
-
-        if (!config->max_heartbeat_len)
-        {
-            DebugMessage(DEBUG_SSL, "STOPPING INSPECTION (process_other)\n");
-            stream.stop_inspection(packet->flow, packet, SSN_DIR_BOTH, -1, 0);
-        }
-        else if (!(new_flags & SSL_HEARTBEAT_SEEN))
-        {
-            DisableDetect();
-        }
+        SSLPP_stop_encrypted(config, new_flags, packet);
     }
     else
     {
@@ -349,9 +355,10 @@ static void snort_ssl(SSL_PROTO_CONF* config, Packet* p)
 
         SSL_UpdateCounts(new_flags);
 
-        if (!(new_flags & SSL_HEARTBEAT_SEEN))
+        if (config->stop_after_handshake && !(new_flags & SSL_HEARTBEAT_SEEN))
         {
             DisableDetect();
+            sslstats.disabled++;
         }
 
         sd->ssn_flags |= new_flags;
@@ -41,6 +41,9 @@ static const Parameter s_params[] =
     { "max_heartbeat_length", Parameter::PT_INT, "0:65535", "0",
       "maximum length of heartbeat record allowed" },
 
+    { "stop_after_handshake", Parameter::PT_BOOL, nullptr, "true",
+      "stop inspecting encrypted sessions; with heartbeat checks only heartbeats are inspected" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -91,6 +94,9 @@ bool SslModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("max_heartbeat_length") )
         conf->max_heartbeat_len = v.get_long();
 
+    else if ( v.is("stop_after_handshake") )
+        conf->stop_after_handshake = v.get_bool();
+
     else
         return false;
 
@@ -109,6 +115,7 @@ bool SslModule::begin(const char*, int, SnortConfig*)
     conf = new SSL_PROTO_CONF;
     conf->max_heartbeat_len = 0;
     conf->trustservers = false;
+    conf->stop_after_handshake = true;
     return true;
 }
 
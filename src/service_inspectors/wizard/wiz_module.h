@@ -54,6 +54,9 @@ public:
 
     MagicBook* get_book(bool c2s, bool hex);
 
+    unsigned get_max_search_depth() const
+    { return max_search_depth; }
+
 private:
     void add_spells(MagicBook*, std::string&);
 
@@ -69,6 +72,8 @@ private:
 
     MagicBook* c2s_spells;
     MagicBook* s2c_spells;
+
+    unsigned max_search_depth;
 };
 
 #endif
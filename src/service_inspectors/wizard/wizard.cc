@@ -43,6 +43,8 @@ struct WizStats
     PegCount udp_hits;
     PegCount user_scans;
     PegCount user_hits;
+    PegCount tcp_misses;
+    PegCount udp_misses;
 };
 
 const PegInfo wiz_pegs[] =
@@ -53,6 +55,8 @@ const PegInfo wiz_pegs[] =
     { "udp hits", "udp identifications" },
     { "user scans", "user payload scans" },
     { "user hits", "user identifications" },
+    { "tcp misses", "tcp searches abandoned at max_search_depth" },
+    { "udp misses", "udp searches abandoned at max_search_depth" },
     { nullptr, nullptr }
 };
 
@@ -68,6 +72,23 @@ struct Wand
     const MagicPage* spell;
 };
 
+// udp has no splitter to carry the search depth between packets
+class WizFlowData : public FlowData
+{
+public:
+    WizFlowData() : FlowData(flow_id)
+    { depth = 0; }
+
+    static void init()
+    { flow_id = FlowData::get_flow_id(); }
+
+public:
+    static unsigned flow_id;
+    unsigned depth;
+};
+
+unsigned WizFlowData::flow_id = 0;
+
 class Wizard;
 
 class MagicSplitter : public StreamSplitter
@@ -84,6 +105,7 @@ public:
 private:
     Wizard* wizard;
     Wand wand;
+    unsigned depth;
 };
 
 class Wizard : public Inspector
@@ -104,6 +126,8 @@ public:
     bool spellbind(const MagicPage*&, Flow*, const uint8_t*, unsigned);
 
 public:
+    unsigned max_search_depth;
+
     MagicBook* c2s_hexes;
     MagicBook* s2c_hexes;
 
@@ -123,6 +147,7 @@ MagicSplitter::MagicSplitter(bool c2s, class Wizard* w) :
     wizard = w;
     w->add_ref();
     w->reset(wand, true, c2s);
+    depth = 0;
 }
 
 MagicSplitter::~MagicSplitter()
@@ -130,7 +155,8 @@ MagicSplitter::~MagicSplitter()
     wizard->rem_ref();
 }
 
-// FIXIT-M stop search on hit and failure (no possible match)
+// FIXIT-M stop search on failure (no possible match)
+// giving up at max_search_depth drops this splitter for a plain one
 StreamSplitter::Status MagicSplitter::scan(
     Flow* f, const uint8_t* data, uint32_t len,
     uint32_t, uint32_t*)
@@ -138,7 +164,18 @@ StreamSplitter::Status MagicSplitter::scan(
     ++tstats.tcp_scans;
 
     if ( wizard->cast_spell(wand, f, data, len) )
+    {
         ++tstats.tcp_hits;
+        return SEARCH;
+    }
+
+    depth += len;
+
+    if ( wizard->max_search_depth and depth >= wizard->max_search_depth )
+    {
+        ++tstats.tcp_misses;
+        return ABORT;
+    }
 
     return SEARCH;
 }
@@ -149,6 +186,8 @@ StreamSplitter::Status MagicSplitter::scan(
 
 Wizard::Wizard(WizardModule* m)
 {
+    max_search_depth = m->get_max_search_depth();
+
     c2s_hexes = m->get_book(true, true);
     s2c_hexes = m->get_book(false, true);
 
@@ -189,11 +228,41 @@ void Wizard::eval(Packet* p)
 
     Wand wand;
     reset(wand, false, p->is_from_client());
+    ++tstats.udp_scans;
 
     if ( cast_spell(wand, p->flow, p->data, p->dsize) )
+    {
         ++tstats.udp_hits;
+        return;
+    }
 
-    ++tstats.udp_scans;
+    if ( !max_search_depth )
+        return;
+
+    // only flows that miss on the first packet pay for the flow data
+    WizFlowData* fd = (WizFlowData*)p->flow->get_application_data(WizFlowData::flow_id);
+    unsigned depth = p->dsize;
+
+    if ( fd )
+        depth += fd->depth;
+
+    if ( depth < max_search_depth )
+    {
+        if ( !fd )
+        {
+            fd = new WizFlowData;
+            p->flow->set_application_data(fd);
+        }
+        fd->depth = depth;
+        return;
+    }
+
+    ++tstats.udp_misses;
+
+    if ( fd )
+        p->flow->free_application_data(fd);
+
+    p->flow->clear_clouseau();
 }
 
 StreamSplitter* Wizard::get_splitter(bool c2s)
@@ -251,6 +320,11 @@ static void wiz_dtor(Inspector* p)
     delete p;
 }
 
+static void wiz_init()
+{
+    WizFlowData::init();
+}
+
 static const InspectApi wiz_api =
 {
     {
@@ -269,7 +343,7 @@ static const InspectApi wiz_api =
     (uint16_t)PktType::TCP | (uint16_t)PktType::UDP | (uint16_t)PktType::PDU,
     nullptr, // buffers
     nullptr, // service
-    nullptr, // init
+    wiz_init,
     nullptr, // term
     nullptr, // tinit
     nullptr, // tterm
@@ -25,9 +25,10 @@
  * lookups have been adapted to return a void pointer so any information can
  * be associated with each CIDR block.
  *
- * As of this writing, the two methods used are Stefan Nilsson and Gunnar
- * Karlsson's LC-trie, and a multibit-trie method similar to Gupta et-al.'s
- * DIR-n-m.  Presently, the LC-trie is used primarily for testing purposes as
+ * As of this writing, the methods used are Stefan Nilsson and Gunnar
+ * Karlsson's LC-trie, a multibit-trie method similar to Gupta et-al.'s
+ * DIR-n-m, and a bitmap compressed trie similar to Asai and Ohara's
+ * poptrie.  Presently, the LC-trie is used primarily for testing purposes as
  * the current implementation does not allow for fast dynamic inserts.
  *
  * The intended use is for a user to optionally specify large IP blocks and
@@ -196,6 +197,17 @@ table_t* sfrt_new(char table_type, char ip_type, long data_size, uint32_t mem_ca
 
         break;
 
+    /* Setup bitmap compressed table */
+    case POPTRIE:
+        table->insert = sfrt_poptrie_insert;
+        table->lookup = sfrt_poptrie_lookup;
+        table->free = sfrt_poptrie_free;
+        table->usage = sfrt_poptrie_usage;
+        table->print = sfrt_poptrie_print;
+        table->remove = sfrt_poptrie_remove;
+
+        break;
+
     default:
         snort_free(table->data);
         snort_free(table);
@@ -248,6 +260,10 @@ table_t* sfrt_new(char table_type, char ip_type, long data_size, uint32_t mem_ca
         table->rt6 = sfrt_dir_new(mem_cap, 16,
             8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8);
         break;
+    case POPTRIE:
+        table->rt = sfrt_poptrie_new(mem_cap);
+        table->rt6 = sfrt_poptrie_new(mem_cap);
+        break;
     }
 
     if ((!table->rt) || (!table->rt6))
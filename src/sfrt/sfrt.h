@@ -43,6 +43,7 @@ struct tuple_t
 };
 
 #include "sfrt/sfrt_dir.h"
+#include "sfrt/sfrt_poptrie.h"
 //#define SUPPORT_LCTRIE
 #ifdef SUPPORT_LCTRIE
 #include "sfrt/sfrt_lctrie.h"
@@ -65,7 +66,8 @@ enum types
     DIR_16x8,
     DIR_8x16,
     IPv4,
-    IPv6
+    IPv6,
+    POPTRIE
 };
 
 enum return_codes
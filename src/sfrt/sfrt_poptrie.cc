@@ -0,0 +1,505 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// sfrt_poptrie.cc
+
+// Nodes are updated by spreading them out to one entry per slot, changing
+// the slots, and packing them back down.  That makes inserts and removes
+// slower than with DIR-n-m but they only happen while loading tables and
+// lookups stay a popcount and a load per level.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sfrt.h"  // FIXIT-L these includes are circular
+#include "sfrt_poptrie.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "main/snort_types.h"
+#include "utils/util.h"
+
+#define PT_STRIDE 6
+#define PT_SLOTS (1 << PT_STRIDE)
+
+// a node spread out to one entry per slot
+struct PtExpanded
+{
+    uint64_t vector;
+    poptrie_node_t child[PT_SLOTS];
+    poptrie_leaf_t leaf[PT_SLOTS];
+};
+
+// the address in host order, most significant bits first
+struct PtKey
+{
+    uint64_t hi;
+    uint64_t lo;
+};
+
+static inline void pt_key(const sfip_t* ip, PtKey& k)
+{
+    k.hi = (uint64_t)ntohl(ip->ip32[0]) << 32;
+    k.lo = 0;
+
+    if ( ip->family != AF_INET )
+    {
+        k.hi |= ntohl(ip->ip32[1]);
+        k.lo = ((uint64_t)ntohl(ip->ip32[2]) << 32) | ntohl(ip->ip32[3]);
+    }
+}
+
+// the PT_STRIDE bits starting off bits from the top
+static inline unsigned pt_slot(const PtKey& k, unsigned off)
+{
+    uint64_t w;
+
+    if ( off < 64 )
+    {
+        w = k.hi << off;
+
+        if ( off > 64 - PT_STRIDE )
+            w |= k.lo >> (64 - off);
+    }
+    else if ( off < 128 )
+        w = k.lo << (off - 64);
+    else
+        w = 0;
+
+    return (unsigned)(w >> (64 - PT_STRIDE));
+}
+
+// mask of slots 0 through slot
+static inline uint64_t pt_upto(unsigned slot)
+{ return ((uint64_t)2 << slot) - 1; }
+
+static inline unsigned pt_count(uint64_t bits)
+{ return __builtin_popcountll(bits); }
+
+static inline bool pt_same(const poptrie_leaf_t& a, const poptrie_leaf_t& b)
+{ return a.index == b.index and a.length == b.length; }
+
+static const poptrie_leaf_t pt_empty_leaf = { 0, 0 };
+
+//-------------------------------------------------------------------------
+// nodes
+//-------------------------------------------------------------------------
+
+static void pt_node_init(poptrie_table_t* t, poptrie_node_t* n, const poptrie_leaf_t& leaf)
+{
+    n->vector = 0;
+    n->leafvec = 1;
+    n->children = nullptr;
+    n->leaves = (poptrie_leaf_t*)snort_alloc(sizeof(poptrie_leaf_t));
+    n->leaves[0] = leaf;
+    t->allocated += sizeof(poptrie_leaf_t);
+}
+
+// free everything below n but not n itself
+static void pt_node_free(poptrie_table_t* t, poptrie_node_t* n)
+{
+    unsigned nc = pt_count(n->vector);
+
+    for ( unsigned i = 0; i < nc; ++i )
+        pt_node_free(t, n->children + i);
+
+    if ( n->children )
+        snort_free(n->children);
+
+    if ( n->leaves )
+        snort_free(n->leaves);
+
+    t->allocated -= nc * sizeof(poptrie_node_t) + pt_count(n->leafvec) * sizeof(poptrie_leaf_t);
+    t->cur_num -= nc;
+
+    n->vector = n->leafvec = 0;
+    n->children = nullptr;
+    n->leaves = nullptr;
+}
+
+static inline bool pt_node_empty(const poptrie_node_t* n)
+{ return !n->vector and n->leafvec == 1 and pt_same(n->leaves[0], pt_empty_leaf); }
+
+static void pt_expand(const poptrie_node_t* n, PtExpanded& e)
+{
+    poptrie_leaf_t cur = pt_empty_leaf;
+    unsigned c = 0, l = 0;
+
+    e.vector = n->vector;
+
+    for ( unsigned v = 0; v < PT_SLOTS; ++v )
+    {
+        uint64_t bit = (uint64_t)1 << v;
+
+        if ( n->vector & bit )
+            e.child[v] = n->children[c++];
+
+        else if ( n->leafvec & bit )
+            cur = n->leaves[l++];
+
+        e.leaf[v] = cur;
+    }
+}
+
+static void pt_compress(poptrie_table_t* t, poptrie_node_t* n, const PtExpanded& e)
+{
+    poptrie_leaf_t leaves[PT_SLOTS];
+    uint64_t leafvec = 0;
+    unsigned nl = 0;
+
+    // child slots don't break a run since lookups never count them
+    for ( unsigned v = 0; v < PT_SLOTS; ++v )
+    {
+        uint64_t bit = (uint64_t)1 << v;
+
+        if ( e.vector & bit )
+            continue;
+
+        if ( !nl or !pt_same(leaves[nl - 1], e.leaf[v]) )
+        {
+            leafvec |= bit;
+            leaves[nl++] = e.leaf[v];
+        }
+    }
+
+    // the children themselves were moved into e
+    t->allocated -= pt_count(n->vector) * sizeof(poptrie_node_t) +
+        pt_count(n->leafvec) * sizeof(poptrie_leaf_t);
+
+    if ( n->children )
+        snort_free(n->children);
+
+    if ( n->leaves )
+        snort_free(n->leaves);
+
+    unsigned nc = pt_count(e.vector);
+
+    n->vector = e.vector;
+    n->leafvec = leafvec;
+    n->children = nc ? (poptrie_node_t*)snort_alloc(nc * sizeof(poptrie_node_t)) : nullptr;
+    n->leaves = nl ? (poptrie_leaf_t*)snort_alloc(nl * sizeof(poptrie_leaf_t)) : nullptr;
+
+    for ( unsigned v = 0, c = 0; c < nc; ++v )
+    {
+        if ( e.vector & ((uint64_t)1 << v) )
+            n->children[c++] = e.child[v];
+    }
+
+    if ( nl )
+        memcpy(n->leaves, leaves, nl * sizeof(poptrie_leaf_t));
+
+    t->allocated += nc * sizeof(poptrie_node_t) + nl * sizeof(poptrie_leaf_t);
+}
+
+static void pt_drop_child(poptrie_table_t* t, PtExpanded& e, unsigned v)
+{
+    pt_node_free(t, e.child + v);
+    e.vector &= ~((uint64_t)1 << v);
+    t->cur_num--;
+}
+
+//-------------------------------------------------------------------------
+// insert
+//-------------------------------------------------------------------------
+
+static void pt_fill_less_specific(
+    poptrie_table_t* t, poptrie_node_t* n, const poptrie_leaf_t& leaf)
+{
+    PtExpanded e;
+    pt_expand(n, e);
+
+    for ( unsigned v = 0; v < PT_SLOTS; ++v )
+    {
+        if ( e.vector & ((uint64_t)1 << v) )
+            pt_fill_less_specific(t, e.child + v, leaf);
+
+        else if ( leaf.length >= e.leaf[v].length )
+            e.leaf[v] = leaf;
+    }
+    pt_compress(t, n, e);
+}
+
+static int pt_insert(
+    poptrie_table_t* t, poptrie_node_t* n, const PtKey& k, unsigned off,
+    const poptrie_leaf_t& leaf, int behavior)
+{
+    PtExpanded e;
+    pt_expand(n, e);
+
+    unsigned v = pt_slot(k, off);
+    unsigned rem = leaf.length - off;
+
+    if ( rem > PT_STRIDE )
+    {
+        uint64_t bit = (uint64_t)1 << v;
+
+        if ( !(e.vector & bit) )
+        {
+            if ( t->allocated >= t->mem_cap )
+                return MEM_ALLOC_FAILURE;
+
+            // the new child starts out with what the slot had
+            pt_node_init(t, e.child + v, e.leaf[v]);
+            e.vector |= bit;
+            t->cur_num++;
+        }
+        int rc = pt_insert(t, e.child + v, k, off + PT_STRIDE, leaf, behavior);
+        pt_compress(t, n, e);
+        return rc;
+    }
+
+    unsigned span = 1 << (PT_STRIDE - rem);
+    v &= ~(span - 1);
+
+    for ( unsigned i = v; i < v + span; ++i )
+    {
+        bool child = e.vector & ((uint64_t)1 << i);
+
+        if ( behavior == RT_FAVOR_TIME )
+        {
+            if ( child )
+                pt_drop_child(t, e, i);
+
+            e.leaf[i] = leaf;
+        }
+        else if ( child )
+            pt_fill_less_specific(t, e.child + i, leaf);
+
+        else if ( leaf.length >= e.leaf[i].length )
+            e.leaf[i] = leaf;
+    }
+    pt_compress(t, n, e);
+    return RT_SUCCESS;
+}
+
+//-------------------------------------------------------------------------
+// remove
+//-------------------------------------------------------------------------
+
+static word pt_remove_less_specific(poptrie_table_t* t, poptrie_node_t* n, unsigned len)
+{
+    PtExpanded e;
+    pt_expand(n, e);
+    word ret = 0;
+
+    for ( unsigned v = 0; v < PT_SLOTS; ++v )
+    {
+        if ( e.vector & ((uint64_t)1 << v) )
+        {
+            if ( word r = pt_remove_less_specific(t, e.child + v, len) )
+                ret = r;
+
+            if ( pt_node_empty(e.child + v) )
+            {
+                pt_drop_child(t, e, v);
+                e.leaf[v] = pt_empty_leaf;
+            }
+        }
+        else if ( e.leaf[v].length == len )
+        {
+            if ( e.leaf[v].index )
+                ret = e.leaf[v].index;
+
+            e.leaf[v] = pt_empty_leaf;
+        }
+    }
+    pt_compress(t, n, e);
+    return ret;
+}
+
+static word pt_remove(
+    poptrie_table_t* t, poptrie_node_t* n, const PtKey& k, unsigned off,
+    unsigned len, int behavior)
+{
+    PtExpanded e;
+    pt_expand(n, e);
+
+    unsigned v = pt_slot(k, off);
+    unsigned rem = len - off;
+    word ret = 0;
+
+    if ( rem > PT_STRIDE )
+    {
+        uint64_t bit = (uint64_t)1 << v;
+
+        if ( !(e.vector & bit) )
+        {
+            // favor time clears the whole range so split a covering leaf
+            if ( behavior != RT_FAVOR_TIME or pt_same(e.leaf[v], pt_empty_leaf) )
+                return 0;
+
+            pt_node_init(t, e.child + v, e.leaf[v]);
+            e.vector |= bit;
+            t->cur_num++;
+        }
+        ret = pt_remove(t, e.child + v, k, off + PT_STRIDE, len, behavior);
+
+        if ( pt_node_empty(e.child + v) )
+        {
+            pt_drop_child(t, e, v);
+            e.leaf[v] = pt_empty_leaf;
+        }
+        pt_compress(t, n, e);
+        return ret;
+    }
+
+    unsigned span = 1 << (PT_STRIDE - rem);
+    v &= ~(span - 1);
+
+    for ( unsigned i = v; i < v + span; ++i )
+    {
+        bool child = e.vector & ((uint64_t)1 << i);
+
+        if ( behavior == RT_FAVOR_TIME )
+        {
+            // discard everything including more specific entries
+            if ( child )
+                pt_drop_child(t, e, i);
+
+            else if ( e.leaf[i].length == len )
+                ret = e.leaf[i].index;
+
+            e.leaf[i] = pt_empty_leaf;
+        }
+        else if ( child )
+        {
+            if ( word r = pt_remove_less_specific(t, e.child + i, len) )
+                ret = r;
+
+            if ( pt_node_empty(e.child + i) )
+            {
+                pt_drop_child(t, e, i);
+                e.leaf[i] = pt_empty_leaf;
+            }
+        }
+        else if ( e.leaf[i].length == len )
+        {
+            ret = e.leaf[i].index;
+            e.leaf[i] = pt_empty_leaf;
+        }
+    }
+    pt_compress(t, n, e);
+    return ret;
+}
+
+//-------------------------------------------------------------------------
+// api
+//-------------------------------------------------------------------------
+
+poptrie_table_t* sfrt_poptrie_new(uint32_t mem_cap)
+{
+    poptrie_table_t* t = (poptrie_table_t*)snort_calloc(sizeof(poptrie_table_t));
+
+    t->mem_cap = mem_cap;
+    t->allocated = sizeof(poptrie_table_t);
+    t->cur_num = 1;
+
+    pt_node_init(t, &t->root, pt_empty_leaf);
+    return t;
+}
+
+void sfrt_poptrie_free(void* tbl)
+{
+    poptrie_table_t* t = (poptrie_table_t*)tbl;
+
+    if ( !t )
+        return;
+
+    pt_node_free(t, &t->root);
+    snort_free(t);
+}
+
+tuple_t sfrt_poptrie_lookup(IP ip, void* tbl)
+{
+    const poptrie_table_t* t = (poptrie_table_t*)tbl;
+    tuple_t ret = { 0, 0 };
+
+    if ( !t )
+        return ret;
+
+    PtKey k;
+    pt_key(ip, k);
+
+    const poptrie_node_t* n = &t->root;
+    unsigned off = 0;
+
+    while ( true )
+    {
+        unsigned v = pt_slot(k, off);
+        uint64_t upto = pt_upto(v);
+
+        if ( n->vector & ((uint64_t)1 << v) )
+        {
+            n = n->children + pt_count(n->vector & upto) - 1;
+            off += PT_STRIDE;
+            continue;
+        }
+        const poptrie_leaf_t& leaf = n->leaves[pt_count(n->leafvec & upto) - 1];
+        ret.index = leaf.index;
+        ret.length = leaf.length;
+        return ret;
+    }
+}
+
+int sfrt_poptrie_insert(IP ip, int len, word data_index, int behavior, void* tbl)
+{
+    poptrie_table_t* t = (poptrie_table_t*)tbl;
+
+    if ( !t or len <= 0 or len > 128 )
+        return RT_INSERT_FAILURE;
+
+    PtKey k;
+    pt_key(ip, k);
+
+    poptrie_leaf_t leaf = { data_index, (uint8_t)len };
+    return pt_insert(t, &t->root, k, 0, leaf, behavior);
+}
+
+word sfrt_poptrie_remove(IP ip, int len, int behavior, void* tbl)
+{
+    poptrie_table_t* t = (poptrie_table_t*)tbl;
+
+    if ( !t or len <= 0 or len > 128 )
+        return 0;
+
+    PtKey k;
+    pt_key(ip, k);
+
+    return pt_remove(t, &t->root, k, 0, len, behavior);
+}
+
+uint32_t sfrt_poptrie_usage(void* tbl)
+{
+    if ( !tbl )
+        return 0;
+
+    return ((poptrie_table_t*)tbl)->allocated;
+}
+
+void sfrt_poptrie_print(void* tbl)
+{
+    poptrie_table_t* t = (poptrie_table_t*)tbl;
+
+    if ( !t )
+        return;
+
+    printf("Nodes in use: %u\n", t->cur_num);
+    printf("Bytes in use: %u\n", t->allocated);
+}
+
@@ -0,0 +1,66 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// sfrt_poptrie.h
+
+#ifndef SFRT_POPTRIE_H
+#define SFRT_POPTRIE_H
+
+// A multibit trie with bitmap compressed nodes similar to Asai and
+// Ohara's poptrie.  Each node covers 6 bits of the address.  One bitmap
+// marks the slots that lead to a child and another marks the slots that
+// start a run of identical leaves so children and leaves are stored densely
+// and indexed with a popcount.  Lookups touch one small node per level
+// instead of a wide array.
+
+#include <stdint.h>
+
+struct poptrie_leaf_t
+{
+    word index;
+    uint8_t length;
+};
+
+struct poptrie_node_t
+{
+    uint64_t vector;   // slots with a child
+    uint64_t leafvec;  // slots that start a leaf run
+    poptrie_node_t* children;
+    poptrie_leaf_t* leaves;
+};
+
+struct poptrie_table_t
+{
+    poptrie_node_t root;
+    uint32_t mem_cap;
+    uint32_t allocated;
+    uint32_t cur_num;  // nodes
+};
+
+/******************************************************************
+   poptrie functions, these are not intended to be called directly */
+poptrie_table_t* sfrt_poptrie_new(uint32_t mem_cap);
+void sfrt_poptrie_free(void*);
+tuple_t sfrt_poptrie_lookup(IP ip, void* table);
+int sfrt_poptrie_insert(IP ip, int len, word data_index,
+    int behavior, void* table);
+uint32_t sfrt_poptrie_usage(void* table);
+void sfrt_poptrie_print(void* table);
+word sfrt_poptrie_remove(IP ip, int len, int behavior, void* table);
+
+#endif
+
@@ -62,7 +62,7 @@ static IP_entry ip_lists[] =
 static int s_debug = 0;
 
 /* Add one ip, then delete that IP*/
-static void test_sfrt_remove_after_insert()
+static void test_sfrt_remove_after_insert(char type)
 {
     table_t* dir;
     unsigned num_entries;
@@ -72,7 +72,7 @@ static void test_sfrt_remove_after_insert()
     if ( s_debug )
         printf("Number of entries: %u \n",num_entries);
 
-    dir = sfrt_new(DIR_16_4x4_16x5_4x4, IPv6, num_entries + 1, 200);
+    dir = sfrt_new(type, IPv6, num_entries + 1, 200);
 
     CHECK(dir != NULL); // "sfrt_new()"
 
@@ -152,7 +152,7 @@ static void test_sfrt_remove_after_insert()
 }
 
 /*Add all IPs, then delete all of them*/
-static void test_sfrt_remove_after_insert_all()
+static void test_sfrt_remove_after_insert_all(char type)
 {
     table_t* dir;
     unsigned num_entries;
@@ -163,7 +163,7 @@ static void test_sfrt_remove_after_insert_all()
     if ( s_debug )
         printf("Number of entries: %u \n",num_entries);
 
-    dir = sfrt_new(DIR_16_4x4_16x5_4x4, IPv6, num_entries + 1, 200);
+    dir = sfrt_new(type, IPv6, num_entries + 1, 200);
 
     CHECK(dir != NULL); // "sfrt_new()"
 
@@ -256,11 +256,69 @@ TEST_CASE("sfrt", "[sfrt]")
 {
     SECTION("remove after insert")
     {
-        test_sfrt_remove_after_insert();
+        test_sfrt_remove_after_insert(DIR_16_4x4_16x5_4x4);
     }
     SECTION("remove after insert all")
     {
-        test_sfrt_remove_after_insert_all();
+        test_sfrt_remove_after_insert_all(DIR_16_4x4_16x5_4x4);
     }
+    SECTION("poptrie remove after insert")
+    {
+        test_sfrt_remove_after_insert(POPTRIE);
+    }
+    SECTION("poptrie remove after insert all")
+    {
+        test_sfrt_remove_after_insert_all(POPTRIE);
+    }
+}
+
+TEST_CASE("sfrt poptrie matches dir", "[sfrt]")
+{
+    table_t* dir = sfrt_new(DIR_8x16, IPv6, 1001, 200);
+    table_t* pop = sfrt_new(POPTRIE, IPv6, 1001, 200);
+    static int values[1000];
+
+    REQUIRE(dir != NULL);
+    REQUIRE(pop != NULL);
+
+    srand(1);
+
+    for ( int i = 0; i < 1000; ++i )
+    {
+        sfip_t ip;
+        ip.clear();
+
+        bool v6 = i % 2;
+        ip.family = v6 ? AF_INET6 : AF_INET;
+
+        for ( int j = 0; j < (v6 ? 4 : 1); ++j )
+            ip.ip32[j] = rand() & 0xff0fff0f;
+
+        int len = v6 ? 1 + rand() % 128 : 1 + rand() % 32;
+        values[i] = i;
+
+        CHECK(sfrt_insert(&ip, len, &values[i], RT_FAVOR_SPECIFIC, dir) == RT_SUCCESS);
+        CHECK(sfrt_insert(&ip, len, &values[i], RT_FAVOR_SPECIFIC, pop) == RT_SUCCESS);
+    }
+
+    for ( int i = 0; i < 10000; ++i )
+    {
+        sfip_t ip;
+        ip.clear();
+
+        bool v6 = i % 2;
+        ip.family = v6 ? AF_INET6 : AF_INET;
+
+        for ( int j = 0; j < (v6 ? 4 : 1); ++j )
+            ip.ip32[j] = rand() & 0xff0fff0f;
+
+        CHECK(sfrt_lookup(&ip, dir) == sfrt_lookup(&ip, pop));
+    }
+
+    if ( s_debug )
+        printf("Usage: dir %u bytes, poptrie %u bytes\n", sfrt_usage(dir), sfrt_usage(pop));
+
+    sfrt_free(dir);
+    sfrt_free(pop);
 }
 
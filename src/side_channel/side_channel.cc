@@ -87,6 +87,24 @@ SideChannel::SideChannel()
 SideChannel::~SideChannel()
 {
     DebugMessage(DEBUG_SIDE_CHANNEL,"SideChannel::~SideChannel()\n");
+
+    for ( auto* msg : free_messages )
+        delete msg;
+}
+
+SCMessage* SideChannel::get_message()
+{
+    if ( free_messages.empty() )
+        return new SCMessage;
+
+    SCMessage* msg = free_messages.back();
+    free_messages.pop_back();
+    return msg;
+}
+
+void SideChannel::put_message(SCMessage* msg)
+{
+    free_messages.push_back(msg);
 }
 
 void SideChannel::set_message_port(SCMessage* msg, SCPort port)
@@ -214,17 +232,18 @@ bool SideChannel::process(int max_messages)
             break;
         else
         {
-            SCMessage* msg = new SCMessage;
+            SCMessage* msg = get_message();
             // get the ConnectorMsg from the (at this point) abstract class
             ConnectorMsg* connector_msg = connector_receive->get_connector_msg(handle);
 
+            msg->sc = this;
+            msg->connector = connector_receive;
+            msg->hdr = nullptr;
             msg->content = connector_msg->data;
             msg->content_length = connector_msg->length;
             // if the message is longer than the header, assume we have a header
             if ( connector_msg->length >= sizeof(SCMsgHdr) )
             {
-                msg->sc = this;
-                msg->connector = connector_receive;
                 msg->hdr = (SCMsgHdr*)connector_msg->data;
                 msg->content += sizeof(SCMsgHdr);
                 msg->content_length -= sizeof( SCMsgHdr );
@@ -259,7 +278,7 @@ void SideChannel::unregister_receive_handler()
 SCMessage* SideChannel::alloc_transmit_message(uint32_t content_length)
 {
     DebugMessage(DEBUG_SIDE_CHANNEL,"SideChannelManager::alloc_transmit_message()\n");
-    SCMessage* msg = new SCMessage;
+    SCMessage* msg = get_message();
     msg->handle = connector_transmit->alloc_message((content_length + sizeof(SCMsgHdr)),
         (const uint8_t**)&(msg->hdr));
     assert(msg->handle);
@@ -279,7 +298,7 @@ bool SideChannel::discard_message(SCMessage* msg)
     assert(msg->handle);
 
     msg->connector->discard_message (msg->handle);
-    delete msg;
+    put_message(msg);
     return true;
 }
 
@@ -297,7 +316,7 @@ bool SideChannel::transmit_message(SCMessage* msg)
         msg->hdr->sequence = sequence++;
 
         return_value = connector_transmit->transmit_message(msg->handle);
-        delete msg;
+        put_message(msg);
     }
 
     DebugFormat(DEBUG_SIDE_CHANNEL,"SideChannelManager::transmit_message(): return: %d\n",
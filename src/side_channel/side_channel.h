@@ -81,9 +81,15 @@ public:
     Connector* connector_transmit;
 
 private:
+    SCMessage* get_message();
+    void put_message(SCMessage*);
+
     SCSequence sequence;
     SCPort default_port;
     SCProcessMsgFunc receive_handler = nullptr;
+
+    // messages are recycled instead of allocated for each use
+    std::vector<SCMessage*> free_messages;
 };
 
 // SideChannelManager is primary interface with Snort.
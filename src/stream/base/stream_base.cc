@@ -79,6 +79,14 @@ const PegInfo base_pegs[] =
     PROTO_PEGS("udp"),
     PROTO_PEGS("user"),
     PROTO_PEGS("file"),
+    { "udp stateless", "udp packets inspected without a flow" },
+    { "expect probes", "expected flow lookups that passed the filter" },
+    { "expect misses", "expected flow lookups that passed the filter but found nothing" },
+    { "depth bypasses", "flows that stopped inspection at their binder depth" },
+    { "depth bypassed bytes", "payload bytes not inspected due to binder depth" },
+    { "elephant offloads", "flows whitelisted by the daq at the elephant thresholds" },
+    { "elephant offloaded bytes", "payload bytes of elephant flows when offloaded" },
+    { "elephant leaked bytes", "payload bytes of elephant flows still sent by the daq" },
     { nullptr, nullptr }
 };
 
@@ -94,6 +102,14 @@ void base_sum()
     SET_PROTO_COUNTS(udp, UDP);
     SET_PROTO_COUNTS(user, PDU);
     SET_PROTO_COUNTS(file, FILE);
+    stream_base_stats.udp_stateless = flow_con->get_stateless_udp();
+    stream_base_stats.expect_probes = flow_con->get_expect_probes();
+    stream_base_stats.expect_misses = flow_con->get_expect_misses();
+    stream_base_stats.depth_bypasses = flow_con->get_depth_bypasses();
+    stream_base_stats.depth_bypassed_bytes = flow_con->get_depth_bypassed_bytes();
+    stream_base_stats.elephant_offloads = flow_con->get_elephant_offloads();
+    stream_base_stats.elephant_offloaded_bytes = flow_con->get_elephant_offloaded_bytes();
+    stream_base_stats.elephant_leaked_bytes = flow_con->get_elephant_leaked_bytes();
 
     sum_stats((PegCount*)&g_stats, (PegCount*)&stream_base_stats,
         array_size(base_pegs)-1);
@@ -164,6 +180,16 @@ void StreamBase::tinit()
 
     StreamHAManager::tinit();
 
+    unsigned max_flows = config->max_flows;
+
+    if ( !max_flows )
+    {
+        for ( auto* fc : { &config->ip_cfg, &config->icmp_cfg, &config->tcp_cfg,
+            &config->udp_cfg, &config->user_cfg, &config->file_cfg } )
+            max_flows += fc->max_sessions;
+    }
+    flow_con->init_pool(max_flows);
+
     if ( config->ip_cfg.max_sessions )
     {
         if ( (f = InspectorManager::get_session((uint16_t)PktType::IP)) )
@@ -182,7 +208,12 @@ void StreamBase::tinit()
     if ( config->udp_cfg.max_sessions )
     {
         if ( (f = InspectorManager::get_session((uint16_t)PktType::UDP)) )
+        {
             flow_con->init_udp(config->udp_cfg, f);
+
+            if ( config->udp_stateless.any() )
+                flow_con->set_stateless_udp(&config->udp_stateless);
+        }
     }
     if ( config->user_cfg.max_sessions )
     {
@@ -63,7 +63,7 @@ static bool is_client_lower(Flow* flow)
     if (sfip_fast_lt6(&(flow->server_ip), &(flow->client_ip)))
         return false;
 
-    switch (flow->key->pkt_type)
+    switch (flow->pkt_type)
     {
         case PktType::TCP:
         case PktType::UDP:
@@ -99,17 +99,17 @@ bool StreamHAClient::consume(Flow** flow, FlowKey* key, HAMessage* msg)
         int family = (hac->flags & SessionHAContent::FLAG_IP6) ? AF_INET6 : AF_INET;
         if ( hac->flags & SessionHAContent::FLAG_LOW )
         {
-            sfip_set_raw(&((*flow)->server_ip), (*flow)->key->ip_l, family);
-            sfip_set_raw(&((*flow)->client_ip), (*flow)->key->ip_h, family);
-            (*flow)->server_port = (*flow)->key->port_l;
-            (*flow)->client_port = (*flow)->key->port_h;
+            sfip_set_raw(&((*flow)->server_ip), key->ip_l, family);
+            sfip_set_raw(&((*flow)->client_ip), key->ip_h, family);
+            (*flow)->server_port = key->port_l;
+            (*flow)->client_port = key->port_h;
         }
         else
         {
-            sfip_set_raw(&((*flow)->client_ip), (*flow)->key->ip_l, family);
-            sfip_set_raw(&((*flow)->server_ip), (*flow)->key->ip_h, family);
-            (*flow)->client_port = (*flow)->key->port_l;
-            (*flow)->server_port = (*flow)->key->port_h;
+            sfip_set_raw(&((*flow)->client_ip), key->ip_l, family);
+            sfip_set_raw(&((*flow)->server_ip), key->ip_h, family);
+            (*flow)->client_port = key->port_l;
+            (*flow)->server_port = key->port_h;
         }
     }
 
@@ -144,12 +144,161 @@ bool StreamHAClient::produce(Flow* flow, HAMessage* msg)
             hac->flags |= SessionHAContent::FLAG_LOW;
 
         hac->flags |= SessionHAContent::FLAG_IP6;
+        flow->previous_ssn_state = flow->ssn_state;
         return true;
     }
     else
         return false;
 }
 
+// previous_ssn_state holds the state as of the last update sent
+static uint8_t get_delta_fields(Flow* flow)
+{
+    const LwState& old_state = flow->previous_ssn_state;
+    const LwState& cur_state = flow->ssn_state;
+    uint8_t fields = 0;
+
+    if ( old_state.session_flags != cur_state.session_flags )
+        fields |= SessionHADelta::SESSION_FLAGS;
+
+    if ( old_state.ipprotocol != cur_state.ipprotocol )
+        fields |= SessionHADelta::IP_PROTOCOL;
+
+    if ( old_state.application_protocol != cur_state.application_protocol )
+        fields |= SessionHADelta::APP_PROTOCOL;
+
+    if ( old_state.direction != cur_state.direction )
+        fields |= SessionHADelta::DIRECTION;
+
+    if ( old_state.ignore_direction != cur_state.ignore_direction )
+        fields |= SessionHADelta::IGNORE_DIRECTION;
+
+    return fields;
+}
+
+static unsigned get_delta_length(uint8_t fields)
+{
+    unsigned length = sizeof(fields);
+
+    if ( fields & SessionHADelta::SESSION_FLAGS )
+        length += sizeof(LwState::session_flags);
+
+    if ( fields & SessionHADelta::IP_PROTOCOL )
+        length += sizeof(LwState::ipprotocol);
+
+    if ( fields & SessionHADelta::APP_PROTOCOL )
+        length += sizeof(LwState::application_protocol);
+
+    if ( fields & SessionHADelta::DIRECTION )
+        length += sizeof(LwState::direction);
+
+    if ( fields & SessionHADelta::IGNORE_DIRECTION )
+        length += sizeof(LwState::ignore_direction);
+
+    return length;
+}
+
+uint8_t StreamHAClient::get_delta_size(Flow* flow)
+{
+    assert(flow);
+    unsigned length = get_delta_length(get_delta_fields(flow));
+
+    // not worth it if we aren't saving anything
+    return ( length < sizeof(SessionHAContent) ) ? (uint8_t)length : 0;
+}
+
+bool StreamHAClient::produce_delta(Flow* flow, HAMessage* msg)
+{
+    DebugMessage(DEBUG_HA,"StreamHAClient::produce_delta()\n");
+    assert(flow);
+    assert(msg);
+
+    uint8_t fields = get_delta_fields(flow);
+
+    // Check for buffer overflows
+    if ( (int)(msg->cursor - msg->content()) > (int)(msg->content_length() -
+        get_delta_length(fields)) )
+        return false;
+
+    const LwState& cur_state = flow->ssn_state;
+    *msg->cursor++ = fields;
+
+    if ( fields & SessionHADelta::SESSION_FLAGS )
+    {
+        memcpy(msg->cursor, &cur_state.session_flags, sizeof(cur_state.session_flags));
+        msg->cursor += sizeof(cur_state.session_flags);
+    }
+    if ( fields & SessionHADelta::IP_PROTOCOL )
+    {
+        memcpy(msg->cursor, &cur_state.ipprotocol, sizeof(cur_state.ipprotocol));
+        msg->cursor += sizeof(cur_state.ipprotocol);
+    }
+    if ( fields & SessionHADelta::APP_PROTOCOL )
+    {
+        memcpy(msg->cursor, &cur_state.application_protocol,
+            sizeof(cur_state.application_protocol));
+        msg->cursor += sizeof(cur_state.application_protocol);
+    }
+    if ( fields & SessionHADelta::DIRECTION )
+        *msg->cursor++ = (uint8_t)cur_state.direction;
+
+    if ( fields & SessionHADelta::IGNORE_DIRECTION )
+        *msg->cursor++ = (uint8_t)cur_state.ignore_direction;
+
+    flow->previous_ssn_state = flow->ssn_state;
+    return true;
+}
+
+bool StreamHAClient::consume_delta(Flow* flow, HAMessage* msg)
+{
+    DebugMessage(DEBUG_HA,"StreamHAClient::consume_delta()\n");
+    assert(flow);
+    assert(msg);
+
+    unsigned avail = (unsigned)(msg->content_length()) - (unsigned)(msg->cursor - msg->content());
+
+    if ( !avail )
+        return false;
+
+    uint8_t fields = *msg->cursor;
+
+    if ( avail < get_delta_length(fields) )
+        return false;
+
+    LwState& cur_state = flow->ssn_state;
+    msg->cursor++;
+
+    if ( fields & SessionHADelta::SESSION_FLAGS )
+    {
+        memcpy(&cur_state.session_flags, msg->cursor, sizeof(cur_state.session_flags));
+        msg->cursor += sizeof(cur_state.session_flags);
+    }
+    if ( fields & SessionHADelta::IP_PROTOCOL )
+    {
+        memcpy(&cur_state.ipprotocol, msg->cursor, sizeof(cur_state.ipprotocol));
+        msg->cursor += sizeof(cur_state.ipprotocol);
+    }
+    if ( fields & SessionHADelta::APP_PROTOCOL )
+    {
+        memcpy(&cur_state.application_protocol, msg->cursor,
+            sizeof(cur_state.application_protocol));
+        msg->cursor += sizeof(cur_state.application_protocol);
+    }
+    if ( fields & SessionHADelta::DIRECTION )
+        cur_state.direction = (char)*msg->cursor++;
+
+    if ( fields & SessionHADelta::IGNORE_DIRECTION )
+        cur_state.ignore_direction = (char)*msg->cursor++;
+
+    if ( !flow->ha_state->check_any(FlowHAState::STANDBY) )
+    {
+        protocol_deactivate_session(flow);
+        flow->ha_state->add(FlowHAState::STANDBY);
+    }
+
+    return true;
+}
+
 static void update_flags(Flow* flow)
 {
     /* Session creation for non-TCP sessions is a major change.  TCP sessions
@@ -158,7 +307,7 @@ static void update_flags(Flow* flow)
     {
         flow->ha_state->clear(FlowHAState::NEW_SESSION);
         flow->ha_state->add(FlowHAState::MODIFIED);
-        if (flow->key->pkt_type != PktType::TCP)
+        if (flow->pkt_type != PktType::TCP)
             flow->ha_state->add(FlowHAState::MAJOR);
     }
     else
@@ -172,7 +321,7 @@ static void update_flags(Flow* flow)
         if( session_diff )
         {
             flow->ha_state->add(FlowHAState::MODIFIED);
-            if( flow->key->pkt_type == PktType::TCP &&
+            if( flow->pkt_type == PktType::TCP &&
                 ( session_diff & HA_TCP_MAJOR_SESSION_FLAGS ) )
                 flow->ha_state->add(FlowHAState::MAJOR);
             if( session_diff & HA_CRITICAL_SESSION_FLAGS )
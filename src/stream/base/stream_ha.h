@@ -35,6 +35,18 @@ public:
     static const uint8_t FLAG_IP6 = 0x02; // key addresses are ip6
 };
 
+// A delta is a mask of the changed LwState fields followed by just those
+// fields in declaration order.
+class SessionHADelta
+{
+public:
+    static const uint8_t SESSION_FLAGS = 0x01;
+    static const uint8_t IP_PROTOCOL = 0x02;
+    static const uint8_t APP_PROTOCOL = 0x04;
+    static const uint8_t DIRECTION = 0x08;
+    static const uint8_t IGNORE_DIRECTION = 0x10;
+};
+
 class StreamHAClient : public FlowHAClient
 {
 public:
@@ -44,6 +56,10 @@ public:
     bool is_update_required(Flow*);
     bool is_delete_required(Flow*);
 
+    uint8_t get_delta_size(Flow*);
+    bool produce_delta(Flow*, HAMessage*);
+    bool consume_delta(Flow*, HAMessage*);
+
 private:
 };
 
@@ -20,6 +20,9 @@
 
 #include "stream_module.h"
 
+#include "flow/flow_control.h"
+#include "flow/prune_stats.h"
+#include "memory/prune_handler.h"
 #include "stream/stream.h"
 
 #include <string>
@@ -44,6 +47,18 @@ static const Parameter name[] = \
  \
     { "cleanup_pct", Parameter::PT_INT, "1:100", cleanup, \
       "percent of cache to clean when max_sessions is reached" }, \
+ \
+    { "prune_budget", Parameter::PT_INT, "0:", "0", \
+      "maximum flows pruned while processing one packet (0 is cleanup_pct worth)" }, \
+ \
+    { "hash_buckets", Parameter::PT_BOOL, nullptr, "true", \
+      "index flows with cache line buckets of hash tags instead of chained rows" }, \
+ \
+    { "hash_crc", Parameter::PT_BOOL, nullptr, "false", \
+      "hash flow keys with the crc32c instruction when available" }, \
+ \
+    { "compact_keys", Parameter::PT_BOOL, nullptr, "false", \
+      "store ip4 flows in a separate table by 24 byte keys instead of 48" }, \
 \
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr } \
 }
@@ -68,12 +83,31 @@ static const Parameter s_params[] =
     CACHE_TABLE("user_cache", "user", user_params),
     CACHE_TABLE("file_cache", "file", file_params),
 
+    { "max_flows", Parameter::PT_INT, "0:", "0",
+      "maximum flows allocated per packet thread across all caches (0 is the sum of max_sessions)" },
+
+    { "udp_stateless_ports", Parameter::PT_BIT_LIST, "65535", nullptr,
+      "udp packets to or from these ports are inspected without a flow" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
+// flows are the most expensive state to lose so they are reclaimed last.
+// inside an allocation the flow is released without cleanup.
+static unsigned reclaim_flows(bool in_allocation)
+{
+    if ( !flow_con )
+        return 0;
+
+    PruneReason reason = in_allocation ? PruneReason::MEMCAP : PruneReason::PREEMPTIVE;
+    return flow_con->prune_one(reason, !in_allocation) ? 1 : 0;
+}
+
 StreamModule::StreamModule() :
     Module(MOD_NAME, MOD_HELP, s_params)
-{ }
+{
+    memory::register_reclaimer("flow_cache", memory::RECLAIM_FLOW, 4, reclaim_flows);
+}
 
 const PegInfo* StreamModule::get_pegs() const
 { return base_pegs; }
@@ -93,7 +127,17 @@ bool StreamModule::set(const char* fqn, Value& v, SnortConfig*)
 {
     FlowConfig* fc = nullptr;
 
-    if ( strstr(fqn, "ip_cache") )
+    if ( v.is("max_flows") )
+    {
+        config.max_flows = v.get_long();
+        return true;
+    }
+    else if ( v.is("udp_stateless_ports") )
+    {
+        v.get_bits(config.udp_stateless);
+        return true;
+    }
+    else if ( strstr(fqn, "ip_cache") )
         fc = &config.ip_cfg;
 
     else if ( strstr(fqn, "icmp_cache") )
@@ -126,6 +170,18 @@ bool StreamModule::set(const char* fqn, Value& v, SnortConfig*)
     else if ( v.is("cleanup_pct") )
         fc->cleanup_pct = v.get_long();
 
+    else if ( v.is("prune_budget") )
+        fc->prune_budget = v.get_long();
+
+    else if ( v.is("hash_buckets") )
+        fc->hash_buckets = v.get_bool();
+
+    else if ( v.is("hash_crc") )
+        fc->hash_crc = v.get_bool();
+
+    else if ( v.is("compact_keys") )
+        fc->compact_keys = v.get_bool();
+
     else
         return false;
 
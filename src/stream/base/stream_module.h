@@ -24,6 +24,7 @@
 #include "main/snort_types.h"
 #include "framework/module.h"
 #include "flow/flow_config.h"
+#include "framework/bits.h"
 
 extern THREAD_LOCAL ProfileStats s5PerfStats;
 struct SnortConfig;
@@ -53,6 +54,14 @@ struct BaseStats
     PROTO_FIELDS(udp);
     PROTO_FIELDS(user);
     PROTO_FIELDS(file);
+    PegCount udp_stateless;
+    PegCount expect_probes;
+    PegCount expect_misses;
+    PegCount depth_bypasses;
+    PegCount depth_bypassed_bytes;
+    PegCount elephant_offloads;
+    PegCount elephant_offloaded_bytes;
+    PegCount elephant_leaked_bytes;
 };
 
 extern THREAD_LOCAL BaseStats stream_base_stats;
@@ -65,6 +74,10 @@ struct StreamModuleConfig
     FlowConfig udp_cfg;
     FlowConfig user_cfg;
     FlowConfig file_cfg;
+
+    unsigned max_flows = 0;
+
+    PortBitSet udp_stateless;
 };
 
 class StreamModule : public Module
@@ -79,6 +79,11 @@ int FileSession::process(Packet* p)
 
     FileFlows* file_flows = FileFlows::get_file_flows(p->flow);
 
+    // mapped windows outlive the packet so the file api can keep pointers
+    // instead of copying
+    if ( file_flows )
+        file_flows->set_stable_data(p->ptrs.decode_flags & DECODE_MAPPED);
+
     if (file_flows &&
         file_flows->file_process((uint8_t*)p->data, p->dsize, position(p), c->upload))
     {
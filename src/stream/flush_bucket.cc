@@ -24,7 +24,9 @@
 
 #include <random>
 
+#include "latency/packet_latency.h"
 #include "main/snort_config.h"
+#include "memory/memory_cap.h"
 #include "protocols/packet.h"
 
 //-------------------------------------------------------------------------
@@ -33,7 +35,7 @@
 
 static THREAD_LOCAL FlushBucket* s_flush_bucket = nullptr;
 
-void FlushBucket::set(unsigned sz)
+void FlushBucket::set(unsigned sz, unsigned max_adaptive)
 {
     if ( s_flush_bucket )
         return;
@@ -41,6 +43,9 @@ void FlushBucket::set(unsigned sz)
     if ( sz )
         s_flush_bucket = new ConstFlushBucket(sz);
 
+    else if ( max_adaptive )
+        s_flush_bucket = new AdaptiveFlushBucket(max_adaptive, !SnortConfig::static_hash());
+
     else if ( SnortConfig::static_hash() )
         s_flush_bucket = new StaticFlushBucket;
 
@@ -96,7 +101,7 @@ uint16_t StaticFlushBucket::get_next()
     return flush_points[idx++];
 }
 
-RandomFlushBucket::RandomFlushBucket()
+static void randomize_flush_points()
 {
     std::default_random_engine generator;
     std::uniform_int_distribution<int> distribution(128, 255);
@@ -107,3 +112,32 @@ RandomFlushBucket::RandomFlushBucket()
     }
 }
 
+RandomFlushBucket::RandomFlushBucket()
+{
+    randomize_flush_points();
+}
+
+AdaptiveFlushBucket::AdaptiveFlushBucket(uint16_t m, bool random)
+{
+    max = m;
+
+    if ( random )
+        randomize_flush_points();
+}
+
+uint16_t AdaptiveFlushBucket::get_next()
+{
+    uint16_t fp = StaticFlushBucket::get_next();
+
+    if ( max <= fp )
+        return fp;
+
+    unsigned load = 100 - PacketLatency::headroom();
+    unsigned mem = memory::MemoryCap::pressure();
+
+    if ( mem > load )
+        load = mem;
+
+    return fp + (uint16_t)((max - fp) * load / 100);
+}
+
@@ -30,7 +30,7 @@ public:
     virtual uint16_t get_next() = 0;
 
     static uint16_t get_size();
-    static void set(unsigned sz);
+    static void set(unsigned sz, unsigned max_adaptive = 0);
     static void clear();
 
 protected:
@@ -66,5 +66,18 @@ public:
     RandomFlushBucket();
 };
 
+// scales the static or random flush points up toward max as packet latency
+// headroom shrinks or memory pressure grows; fewer, larger flushes under
+// load and the usual small ones when idle
+class AdaptiveFlushBucket : public StaticFlushBucket
+{
+public:
+    AdaptiveFlushBucket(uint16_t max, bool random);
+    uint16_t get_next();
+
+private:
+    uint16_t max;
+};
+
 #endif
 
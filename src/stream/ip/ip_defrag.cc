@@ -145,6 +145,7 @@ struct Fragment
 
     int ord;
     char last;
+    bool pooled;
 };
 
 /*  G L O B A L S  **************************************************/
@@ -155,6 +156,23 @@ static THREAD_LOCAL unsigned long mem_in_use = 0; /* memory in use, used for sel
 static THREAD_LOCAL uint32_t pkt_snaplen = 0;
 static THREAD_LOCAL Packet** defrag_pkts;  // An array of Packet pointers
 
+// fragments up to a typical mtu are taken from a per thread pool of nodes
+// with the data stored inline.  the pool grows a block at a time up to
+// max_frags nodes; larger fragments and any beyond that come from the heap.
+#define FRAG_POOL_NODE 2048
+#define FRAG_POOL_DATA (FRAG_POOL_NODE - sizeof(Fragment))
+#define FRAG_POOL_BLOCK 64
+
+struct FragBlock
+{
+    FragBlock* next;
+};
+
+static THREAD_LOCAL Fragment* frag_pool = nullptr;
+static THREAD_LOCAL FragBlock* frag_blocks = nullptr;
+static THREAD_LOCAL uint32_t frag_pool_size = 0;
+static THREAD_LOCAL uint32_t frag_pool_max = 0;
+
 /* enum for policy names */
 static const char* const frag_policy_names[] =
 {
@@ -942,6 +960,49 @@ static inline void add_node(FragTracker* ft, Fragment* prev,
     ft->fraglist_count++;
 }
 
+static bool frag_pool_grow()
+{
+    if ( frag_pool_size + FRAG_POOL_BLOCK > frag_pool_max )
+        return false;
+
+    // the block header is padded out to a full node
+    uint8_t* p = (uint8_t*)snort_alloc((FRAG_POOL_BLOCK + 1) * FRAG_POOL_NODE);
+    FragBlock* b = (FragBlock*)p;
+    b->next = frag_blocks;
+    frag_blocks = b;
+
+    for ( unsigned i = 1; i <= FRAG_POOL_BLOCK; ++i )
+    {
+        Fragment* f = (Fragment*)(p + i * FRAG_POOL_NODE);
+        f->next = frag_pool;
+        frag_pool = f;
+    }
+    frag_pool_size += FRAG_POOL_BLOCK;
+    return true;
+}
+
+static Fragment* new_frag(uint16_t len)
+{
+    Fragment* f;
+
+    if ( len <= FRAG_POOL_DATA and (frag_pool or frag_pool_grow()) )
+    {
+        f = frag_pool;
+        frag_pool = f->next;
+        memset(f, 0, sizeof(*f));
+        f->fptr = (uint8_t*)(f + 1);
+        f->pooled = true;
+    }
+    else
+    {
+        f = (Fragment*)snort_calloc(sizeof(Fragment));
+        f->fptr = (uint8_t*)snort_calloc(len);
+    }
+    mem_in_use += sizeof(Fragment) + len;
+    ip_stats.mem_in_use = mem_in_use;
+    return f;
+}
+
 /**
  * Delete a Fragment struct
  *
@@ -954,11 +1015,18 @@ static void delete_frag(Fragment* frag)
     /*
      * delete the fragment either in prealloc or dynamic mode
      */
-    snort_free(frag->fptr);
-    mem_in_use -= frag->flen;
+    mem_in_use -= sizeof(Fragment) + frag->flen;
 
-    snort_free(frag);
-    mem_in_use -= sizeof(Fragment);
+    if ( frag->pooled )
+    {
+        frag->next = frag_pool;
+        frag_pool = frag;
+    }
+    else
+    {
+        snort_free(frag->fptr);
+        snort_free(frag);
+    }
 
     ip_stats.mem_in_use = mem_in_use;
     ip_stats.nodes_released++;
@@ -1064,6 +1132,7 @@ void Defrag::tinit()
 
     defrag_pkts[0] = new Packet();
     pkt_snaplen = SFDAQ::get_snap_len();
+    frag_pool_max = engine.max_frags;
 }
 
 void Defrag::tterm()
@@ -1081,6 +1150,19 @@ void Defrag::tterm()
     defrag_pkts = nullptr;
 }
 
+// must be called after all trackers are released
+void Defrag::clear()
+{
+    while ( frag_blocks )
+    {
+        FragBlock* b = frag_blocks;
+        frag_blocks = b->next;
+        snort_free(b);
+    }
+    frag_pool = nullptr;
+    frag_pool_size = 0;
+}
+
 void Defrag::show(SnortConfig*)
 {
     FragPrintEngineConfig(&engine);
@@ -1463,6 +1545,17 @@ int Defrag::insert(Packet* p, FragTracker* ft, FragEngine* fe)
         "Walking frag list (%d nodes), new frag %d@%d\n",
         ft->fraglist_count, fragLength, frag_offset);
 
+    /*
+     * the usual case is in order with no overlap; a frag that starts
+     * right where the tail ends has no neighbors to resolve
+     */
+    if ( ft->fraglist_tail and ft->fraglist_tail->size and
+        frag_offset == ft->fraglist_tail->offset + ft->fraglist_tail->size )
+    {
+        left = ft->fraglist_tail;
+        goto frag_add;
+    }
+
     /*
      * Need to figure out where in the frag list this frag should go
      * and who its neighbors are
@@ -1664,6 +1757,7 @@ left_overlap_last:
         }
     }
 
+frag_add:
     if ((uint16_t)fragLength > pkt_snaplen)
     {
         DebugFormat(DEBUG_FRAG,
@@ -2087,15 +2181,7 @@ int Defrag::new_tracker(Packet* p, FragTracker* ft)
     /*
      * get our first fragment storage struct
      */
-    {
-        f = (Fragment*)snort_calloc(sizeof(Fragment));
-        mem_in_use += sizeof(Fragment);
-
-        f->fptr = (uint8_t*)snort_calloc(fragLength);
-        mem_in_use += fragLength;
-
-        ip_stats.mem_in_use = mem_in_use;
-    }
+    f = new_frag(fragLength);
 
     /* initialize the fragment list */
     ft->fraglist = NULL;
@@ -2225,21 +2311,7 @@ int Defrag::add_frag_node(
     /*
      * grab/generate a new frag node
      */
-    {
-        /*
-         * build a frag struct to track this particular fragment
-         */
-        newfrag = (Fragment*)snort_calloc(sizeof(Fragment));
-        mem_in_use += sizeof(Fragment);
-
-        /*
-         * allocate some space to hold the actual data
-         */
-        newfrag->fptr = (uint8_t*)snort_calloc(fragLength);
-        mem_in_use += fragLength;
-
-        ip_stats.mem_in_use = mem_in_use;
-    }
+    newfrag = new_frag(fragLength);
 
     ip_stats.nodes_created++;
 
@@ -2306,21 +2378,7 @@ int Defrag::dup_frag_node(
     /*
      * grab/generate a new frag node
      */
-    {
-        /*
-         * build a frag struct to track this particular fragment
-         */
-        newfrag = (Fragment*)snort_calloc(sizeof(Fragment));
-        mem_in_use += sizeof(Fragment);
-
-        /*
-         * allocate some space to hold the actual data
-         */
-        newfrag->fptr = (uint8_t*)snort_calloc(left->flen);
-        mem_in_use += left->flen;
-
-        ip_stats.mem_in_use = mem_in_use;
-    }
+    newfrag = new_frag(left->flen);
 
     ip_stats.nodes_created++;
 
@@ -45,6 +45,7 @@ public:
     void tterm();
 
     static void init();
+    static void clear();
 
 private:
     int insert(Packet*, FragTracker*, FragEngine*);
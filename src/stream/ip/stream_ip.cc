@@ -158,6 +158,7 @@ static void ip_tinit()
 static void ip_tterm()
 {
     IpHAManager::tterm();
+    Defrag::clear();
 }
 
 static Inspector* ip_ctor(Module* m)
@@ -50,6 +50,46 @@ TcpStreamTracker::~TcpStreamTracker()
     // TODO Auto-generated destructor stub
 }
 
+// the events are in sent / recv pairs so only the talker event is kept
+// here for each combination of the flags that matter and whether the
+// segment has data.  the listener event is the next one.
+#define TCP_EVENT_FLAGS (TH_FIN | TH_SYN | TH_RST | TH_PUSH | TH_ACK)
+
+struct TcpEventMap
+{
+    TcpEventMap();
+    uint8_t events[2][TCP_EVENT_FLAGS + 1];
+};
+
+TcpEventMap::TcpEventMap()
+{
+    for ( unsigned data = 0; data < 2; ++data )
+    {
+        for ( unsigned f = 0; f <= TCP_EVENT_FLAGS; ++f )
+        {
+            TcpStreamTracker::TcpEvent e;
+
+            if ( (f & (TH_SYN | TH_ACK)) == TH_SYN )
+                e = TcpStreamTracker::TCP_SYN_SENT_EVENT;
+            else if ( (f & (TH_SYN | TH_ACK)) == (TH_SYN | TH_ACK) )
+                e = TcpStreamTracker::TCP_SYN_ACK_SENT_EVENT;
+            else if ( f & TH_RST )
+                e = TcpStreamTracker::TCP_RST_SENT_EVENT;
+            else if ( f & TH_FIN )
+                e = TcpStreamTracker::TCP_FIN_SENT_EVENT;
+            // FIXIT-H no flags set, how do we handle this?
+            else if ( data )
+                e = TcpStreamTracker::TCP_DATA_SEG_SENT_EVENT;
+            else
+                e = TcpStreamTracker::TCP_ACK_SENT_EVENT;
+
+            events[data][f] = e;
+        }
+    }
+}
+
+static const TcpEventMap tcp_event_map;
+
 TcpStreamTracker::TcpEvent TcpStreamTracker::set_tcp_event(TcpSegmentDescriptor& tsd)
 {
     bool talker;
@@ -60,53 +100,8 @@ TcpStreamTracker::TcpEvent TcpStreamTracker::set_tcp_event(TcpSegmentDescriptor&
     else
         talker = ( client_tracker ) ? false : true;
 
-    // FIXIT-P would a lookup table help perf?  the code would be a little cleaner too.
-    if ( talker )
-    {
-        // talker events
-        if ( tcph->is_syn_only() )
-            tcp_event = TCP_SYN_SENT_EVENT;
-        else if ( tcph->is_syn_ack() )
-            tcp_event = TCP_SYN_ACK_SENT_EVENT;
-        else if ( tcph->is_rst() )
-            tcp_event = TCP_RST_SENT_EVENT;
-       else if ( tcph->is_fin( ) )
-            tcp_event = TCP_FIN_SENT_EVENT;
-        else if ( tcph->is_ack() || tcph->is_psh() )
-        {
-            if ( tsd.get_seg_len() > 0 )
-                tcp_event = TCP_DATA_SEG_SENT_EVENT;
-            else
-                tcp_event = TCP_ACK_SENT_EVENT;
-        }
-        else if ( tsd.get_seg_len() > 0 )   // FIXIT-H no flags set, how do we handle this?
-            tcp_event = TCP_DATA_SEG_SENT_EVENT;
-        else
-            tcp_event = TCP_ACK_SENT_EVENT;
-    }
-    else
-    {
-        // listener events
-        if ( tcph->is_syn_only() )
-            tcp_event = TCP_SYN_RECV_EVENT;
-        else if ( tcph->is_syn_ack() )
-            tcp_event = TCP_SYN_ACK_RECV_EVENT;
-        else if ( tcph->is_rst() )
-            tcp_event = TCP_RST_RECV_EVENT;
-        else if ( tcph->is_fin( ) )
-            tcp_event = TCP_FIN_RECV_EVENT;
-        else if ( tcph->is_ack() || tcph->is_psh() )
-        {
-            if ( tsd.get_seg_len() > 0 )
-                tcp_event = TCP_DATA_SEG_RECV_EVENT;
-            else
-                tcp_event = TCP_ACK_RECV_EVENT;
-        }
-        else if ( tsd.get_seg_len() > 0 )    // FIXIT-H no flags set, how do we handle this?
-            tcp_event = TCP_DATA_SEG_RECV_EVENT;
-        else
-            tcp_event = TCP_ACK_RECV_EVENT;
-    }
+    unsigned e = tcp_event_map.events[tsd.get_seg_len() > 0][tcph->th_flags & TCP_EVENT_FLAGS];
+    tcp_event = (TcpEvent)(talker ? e : e + 1);
 
     return tcp_event;
 }
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "latency/degrade.h"
 #include "main/snort_types.h"
 #include "main/snort_debug.h"
 #include "stream/stream.h"
@@ -50,6 +51,15 @@ typedef enum
     FT_MAX   // flush len when len >= max
 } FlushType;
 
+// under latency pressure pdus are flushed sooner so less is held and
+// scanned at a time
+static inline unsigned paf_max(StreamSplitter* ss, Flow* ssn)
+{
+    unsigned max = ss->max(ssn);
+    unsigned cap = Degrade::max_pdu();
+    return ( cap and cap < max ) ? cap : max;
+}
+
 static THREAD_LOCAL uint64_t prep_calls = 0;
 static THREAD_LOCAL uint64_t prep_bytes = 0;
 
@@ -192,7 +202,7 @@ static inline bool paf_eval (
             ps->paf = StreamSplitter::SEARCH;
             return true;
         }
-        if ( s5_len >= ss->max(ssn) + fuzz )
+        if ( s5_len >= paf_max(ss, ssn) + fuzz )
         {
             *ft = FT_MAX;
             return false;
@@ -201,7 +211,7 @@ static inline bool paf_eval (
 
     case StreamSplitter::LIMIT:
         // if we are within PAF_LIMIT_FUZZ character of paf_max ...
-        if ( s5_len + PAF_LIMIT_FUZZ >= ss->max(ssn) + fuzz)
+        if ( s5_len + PAF_LIMIT_FUZZ >= paf_max(ss, ssn) + fuzz )
         {
             *ft = FT_LIMIT;
             ps->paf = StreamSplitter::LIMITED;
@@ -323,7 +333,7 @@ int32_t paf_check (
     // unflushed data.
     uint16_t fuzz = 0; // FIXIT-L PAF add a little zippedy-do-dah
 
-    if ( total >= MAX_PAF_MAX && total > ss->max(ssn) + fuzz )
+    if ( total >= MAX_PAF_MAX && total > paf_max(ss, ssn) + fuzz )
     {
         s5_len = MAX_PAF_MAX + fuzz;
         len = len + s5_len - total;
@@ -365,7 +375,7 @@ int32_t paf_check (
     if ( ps->paf == StreamSplitter::ABORT )
         *flags = 0;
 
-    else if ( (ps->paf != StreamSplitter::FLUSH) && (s5_len > ss->max(ssn)+fuzz) )
+    else if ( (ps->paf != StreamSplitter::FLUSH) && (s5_len > paf_max(ss, ssn) + fuzz) )
     {
         uint32_t fp = paf_flush(ss, ps, FT_MAX, flags);
         paf_jump(ps, fp);
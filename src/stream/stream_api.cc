@@ -312,7 +312,7 @@ void Stream::drop_session(const Packet* p)
 // misc support
 //-------------------------------------------------------------------------
 
-BitOp* Stream::get_flow_bitop(const Packet* p)
+FlowBitSet* Stream::get_flow_bitop(const Packet* p)
 {
     Flow* flow = p->flow;
 
@@ -164,7 +164,7 @@ public:
         uint32_t eventId, uint32_t eventSecond);
 
     // Get pointer to Flowbits data
-    static BitOp* get_flow_bitop(const Packet*);
+    static FlowBitSet* get_flow_bitop(const Packet*);
 
     // Get reassembly direction for given session
     static char get_reassembly_direction(Flow*);
@@ -40,6 +40,16 @@ const StreamBuffer* StreamSplitter::reassemble(
     Flow*, unsigned, unsigned offset, const uint8_t* p,
     unsigned n, uint32_t flags, unsigned& copied)
 {
+    // a pdu that fits in one segment is used in place; the segment is
+    // held until after the rebuilt packet is inspected
+    if ( !offset and (flags & PKT_PDU_FULL) == PKT_PDU_FULL )
+    {
+        copied = n;
+        str_buf.data = p;
+        str_buf.length = n;
+        return &str_buf;
+    }
+
     assert(offset + n < sizeof(pdu_buf));
     memcpy(pdu_buf+offset, p, n);
     copied = n;
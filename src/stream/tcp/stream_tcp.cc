@@ -25,6 +25,7 @@
 #include "stream_tcp.h"
 #include "tcp_ha.h"
 #include "tcp_module.h"
+#include "tcp_segment_node.h"
 #include "tcp_session.h"
 
 #include "stream/flush_bucket.h"
@@ -76,7 +77,7 @@ bool StreamTcp::configure(SnortConfig*)
 void StreamTcp::tinit()
 {
     TcpHAManager::tinit();
-    FlushBucket::set(config->footprint);
+    FlushBucket::set(config->footprint, config->adaptive_flush);
 }
 
 void StreamTcp::tterm()
@@ -133,6 +134,7 @@ static void tcp_tterm()
 {
     TcpSession::sterm();
     FlushBucket::clear();
+    TcpSegmentNode::clear();
 }
 
 static const InspectApi tcp_api =
@@ -60,6 +60,8 @@ const PegInfo tcp_pegs[] =
     { "rebuilt packets", "total reassembled PDUs" },
     { "rebuilt buffers", "rebuilt PDU sections" },
     { "rebuilt bytes", "total rebuilt bytes" },
+    { "inline pdus", "PDUs inspected from packet payload without queuing" },
+    { "fast path", "in order data segments handled by the established fast path" },
     { "overlaps", "overlapping segments queued" },
     { "gaps", "missing data between PDUs" },
     { "max segs", "number of times the maximum queued segment limit was reached" },
@@ -180,6 +182,9 @@ static const Parameter s_params[] =
     { "footprint", Parameter::PT_INT, "0:", "0",
       "use zero for production, non-zero for testing at given size" },
 
+    { "adaptive_flush", Parameter::PT_INT, "0:65535", "0",
+      "grow flush points up to given size under latency or memory pressure; 0 disables" },
+
     { nullptr, Parameter::PT_MAX, nullptr, nullptr, nullptr }
 };
 
@@ -291,6 +296,9 @@ bool StreamTcpModule::set(const char*, Value& v, SnortConfig*)
     else if ( v.is("footprint") )
         config->footprint = v.get_long();
 
+    else if ( v.is("adaptive_flush") )
+        config->adaptive_flush = v.get_long();
+
     else if ( v.is("ignore_any_rules") )
         config->flags |= STREAM_CONFIG_IGNORE_ANY;
 
@@ -85,6 +85,8 @@ struct TcpStats
     PegCount rebuilt_packets;   //iStreamFlushes
     PegCount rebuilt_buffers;
     PegCount rebuilt_bytes;     //total_rebuilt_bytes
+    PegCount inline_pdus;
+    PegCount fast_path;
     PegCount overlaps;
     PegCount gaps;
     PegCount max_segs;
@@ -140,15 +140,7 @@ int TcpReassembler::delete_reassembly_segment(TcpSegmentNode* tsn)
     DebugFormat(DEBUG_STREAM_STATE, "Dropping segment at seq %X, len %d\n", tsn->seq,
         tsn->payload_size);
 
-    if (tsn->prev)
-        tsn->prev->next = tsn->next;
-    else
-        seglist.head = tsn->next;
-
-    if (tsn->next)
-        tsn->next->prev = tsn->prev;
-    else
-        seglist.tail = tsn->prev;
+    seglist.remove(tsn);
 
     seg_bytes_logical -= tsn->payload_size;
     seg_bytes_total -= tsn->orig_dsize;
@@ -813,7 +805,7 @@ uint32_t TcpReassembler::get_q_sequenced()
     if ( !tsn )
         return 0;
 
-    if ( session->flow->two_way_traffic() && SEQ_LT(tracker->r_win_base, tsn->seq) )
+    if ( session->flow->two_way_traffic() && SEQ_LT(get_queue_base(), tsn->seq) )
         return 0;
 
     while ( tsn->next && ( tsn->next->seq == tsn->seq + tsn->payload_size ) )
@@ -1076,26 +1068,9 @@ int TcpReassembler::flush_on_data_policy(Packet* p)
         {
             if ( !flush_amt )
                 flush_amt = seglist.next->seq - seglist_base_seq;
-#if 0
-// FIXIT-P can't do this with new HI - copy is inevitable
-            // if this payload is exactly one pdu, don't
-            // actually flush, just use the raw packet
-            if ( listener->seglist.next &&
-                ( tsd.seq == listener->seglist.next->seq ) &&
-                ( flush_amt == listener->seglist.next->payload_size ) &&
-                ( flush_amt == p->dsize ) )
-            {
-                this_flush = flush_amt;
-                listener->seglist.next->buffered = true;
-                listener->flush_count++;
-                p->packet_flags |= PKT_PDU_FULL;
-                ShowRebuiltPacket(p);
-            }
-            else
-#endif
-            {
-                this_flush = flush_to_seq(flush_amt, p, flags);
-            }
+
+            this_flush = flush_to_seq(flush_amt, p, flags);
+
             // if we didn't flush as expected, bail
             // (we can flush less than max dsize)
             if (!this_flush)
@@ -1185,6 +1160,122 @@ void TcpReassembler::purge_segment_list()
     flush_count = 0;
     seg_bytes_total = 0;
     seg_bytes_logical = 0;
+    inline_flushed = false;
+}
+
+// data before the returned seq was acked or was inspected inline and
+// must not be queued again
+uint32_t TcpReassembler::get_queue_base()
+{
+    if ( inline_flushed )
+    {
+        if ( SEQ_GT(inline_seq, tracker->r_win_base) )
+            return inline_seq;
+
+        inline_flushed = false;
+    }
+    return tracker->r_win_base;
+}
+
+void TcpReassembler::flush_inline_pdu(
+    Packet* p, const uint8_t* data, uint32_t len, uint32_t pkt_flags)
+{
+    EncodeFlags enc_flags = 0;
+    DAQ_PktHdr_t pkth;
+    session->GetPacketHeaderFoo(&pkth, pkt_flags);
+    PacketManager::format_tcp(enc_flags, p, s5_pkt, PSEUDO_PKT_TCP, &pkth, pkth.opaque);
+
+    prep_s5_pkt(session->flow, p, pkt_flags);
+    ((DAQ_PktHdr_t*)s5_pkt->pkth)->ts = p->pkth->ts;
+    s5_pkt->dsize = 0;
+
+    unsigned copied = 0;
+    const StreamBuffer* sb = tracker->splitter->reassemble(
+        session->flow, len, 0, data, len, PKT_PDU_HEAD | PKT_PDU_TAIL, copied);
+
+    tcpStats.inline_pdus++;
+
+    if ( sb )
+    {
+        s5_pkt->data = sb->data;
+        s5_pkt->dsize = sb->length;
+        assert(sb->length <= s5_pkt->max_dsize);
+
+        if ( p->packet_flags & PKT_PDU_TAIL )
+            s5_pkt->packet_flags |= ( PKT_REBUILT_STREAM | PKT_STREAM_EST | PKT_PDU_TAIL );
+        else
+            s5_pkt->packet_flags |= ( PKT_REBUILT_STREAM | PKT_STREAM_EST );
+
+        show_rebuilt_packet(s5_pkt);
+        tcpStats.rebuilt_packets++;
+        tcpStats.rebuilt_bytes += len;
+
+        ProfileExclude profile_exclude(s5TcpFlushPerfStats);
+        Snort::detect_rebuilt_packet(s5_pkt);
+    }
+    else
+        tcpStats.rebuilt_buffers++;
+
+    if ( tracker->splitter )
+        tracker->splitter->update();
+
+    tracker->clear_tf_flags(TF_MISSING_PREV_PKT);
+}
+
+// an in order segment on an empty queue whose flush point falls within
+// the segment is inspected straight from the packet.  each pdu found is
+// flushed this way and the number of leading bytes consumed is returned
+// so the caller queues only the remainder.
+uint32_t TcpReassembler::flush_inline(TcpSegmentDescriptor& tsd)
+{
+    Packet* p = tsd.get_pkt();
+    uint32_t seq = tsd.get_seg_seq();
+    uint32_t len = tsd.get_seg_len();
+    uint32_t used = 0;
+
+    if ( tsd.get_tcph()->is_syn() or !SEQ_EQ(seq, seglist_base_seq)
+        or len > s5_pkt->max_dsize )
+        return 0;
+
+    // same as get_q_sequenced(); don't get ahead of the queue
+    uint32_t base = get_queue_base();
+
+    if ( SEQ_GT(base, seq) or (session->flow->two_way_traffic() and SEQ_LT(base, seq)) )
+        return 0;
+
+    Profile profile(s5TcpFlushPerfStats);
+
+    // the splitter may be removed by the detection of a rebuilt packet
+    while ( used < len and tracker->flush_policy == STREAM_FLPOLICY_ON_DATA
+        and tracker->splitter and tracker->splitter->is_paf() )
+    {
+        uint32_t flags = get_forward_packet_dir(p);
+        int32_t flush_pt = paf_check(tracker->splitter, &tracker->paf_state, session->flow,
+            p->data + used, len - used, len - used, seq + used, &flags);
+
+        if ( !flags )
+        {
+            fallback();
+            break;
+        }
+
+        if ( flush_pt <= 0 )
+            break;
+
+        tracker->clear_tf_flags(TF_MISSING_PKT | TF_MISSING_PREV_PKT | TF_FIRST_PKT_MISSING);
+        flush_inline_pdu(p, p->data + used, flush_pt, flags);
+
+        used += flush_pt;
+        seglist_base_seq += flush_pt;
+    }
+
+    if ( used )
+    {
+        inline_seq = seq + used;
+        inline_flushed = true;
+        p->packet_flags |= PKT_STREAM_INSERT;
+    }
+    return used;
 }
 
 void TcpReassembler::insert_segment_in_empty_seglist(TcpSegmentDescriptor& tsd)
@@ -1197,10 +1288,12 @@ void TcpReassembler::insert_segment_in_empty_seglist(TcpSegmentDescriptor& tsd)
     if ( tcph->is_syn() )
         seq++;
 
-    if ( SEQ_GT(tracker->r_win_base, seq) )
+    uint32_t base = get_queue_base();
+
+    if ( SEQ_GT(base, seq) )
     {
         DebugMessage(DEBUG_STREAM_STATE, "segment overlaps ack'd data...\n");
-        overlap = tracker->r_win_base - tsd.get_seg_seq();
+        overlap = base - tsd.get_seg_seq();
         if ( overlap >= tsd.get_seg_len() )
         {
             DebugMessage(DEBUG_STREAM_STATE, "full overlap on ack'd data, dropping segment\n");
@@ -1218,78 +1311,8 @@ void TcpReassembler::insert_segment_in_empty_seglist(TcpSegmentDescriptor& tsd)
 
 void TcpReassembler::init_overlap_editor(TcpSegmentDescriptor& tsd)
 {
-    TcpSegmentNode* left = nullptr;
-    TcpSegmentNode* right = nullptr;
-    TcpSegmentNode* tsn = nullptr;
-    int32_t dist_head;
-    int32_t dist_tail;
-    DEBUG_WRAP(
-        TcpSegmentNode *lastptr = NULL;
-        uint32_t base_seq = seglist_base_seq;
-        int last = 0;
-        );
-
-    if ( seglist.head && seglist.tail )
-    {
-        if ( SEQ_GT(tsd.get_seg_seq(), seglist.head->seq) )
-            dist_head = tsd.get_seg_seq() - seglist.head->seq;
-        else
-            dist_head = seglist.head->seq - tsd.get_seg_seq();
-
-        if ( SEQ_GT(tsd.get_seg_seq(), seglist.tail->seq) )
-            dist_tail = tsd.get_seg_seq() - seglist.tail->seq;
-        else
-            dist_tail = seglist.tail->seq - tsd.get_seg_seq();
-    }
-    else
-        dist_head = dist_tail = 0;
-
-    if ( SEQ_LEQ(dist_head, dist_tail) )
-    {
-        for ( tsn = seglist.head; tsn; tsn = tsn->next )
-        {
-            DEBUG_WRAP(
-                DebugFormat(DEBUG_STREAM_STATE, "tsn: %p  seq: 0x%X  size: %hu delta: %u\n",
-                (void*) tsn, tsn->seq, tsn->payload_size, ( tsn->seq - base_seq ) - last);
-                last = tsn->seq - base_seq;
-                lastptr = tsn;
-
-                DebugFormat(DEBUG_STREAM_STATE, "   lastptr: %p tsn->next: %p tsn->prev: %p\n",
-                (void*) lastptr, (void*) tsn->next, (void*) tsn->prev);
-                );
-
-            right = tsn;
-            if ( SEQ_GEQ(right->seq, tsd.get_seg_seq() ) )
-                break;
-            left = right;
-        }
-
-        if ( tsn == nullptr )
-            right = nullptr;
-    }
-    else
-    {
-        for ( tsn = seglist.tail; tsn; tsn = tsn->prev )
-        {
-            DEBUG_WRAP(
-                DebugFormat(DEBUG_STREAM_STATE, "tsn: %p  seq: 0x%X  size: %hu delta: %u\n",
-                (void*) tsn, tsn->seq, tsn->payload_size, ( tsn->seq - base_seq ) - last);
-                last = tsn->seq - base_seq;
-                lastptr = tsn;
-
-                DebugFormat(DEBUG_STREAM_STATE, "   lastptr: %p tsn->next: %p tsn->prev: %p\n",
-                (void*) lastptr, (void*) tsn->next, (void*) tsn->prev);
-                );
-
-            left = tsn;
-            if ( SEQ_LT(left->seq, tsd.get_seg_seq() ) )
-                break;
-            right = left;
-        }
-
-        if (tsn == nullptr)
-            left = nullptr;
-    }
+    TcpSegmentNode* left = seglist.find_left(tsd.get_seg_seq());
+    TcpSegmentNode* right = left ? left->next : seglist.head;
 
     DebugMessage(DEBUG_STREAM_STATE, "!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+\n");
     DebugMessage(DEBUG_STREAM_STATE, "!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+!+\n");
@@ -1358,13 +1381,17 @@ int TcpReassembler::queue_packet_for_reassembly(TcpSegmentDescriptor& tsd)
 
     if ( seg_count == 0 )
     {
-        insert_segment_in_empty_seglist(tsd);
+        if ( flush_inline(tsd) < tsd.get_seg_len() )
+            insert_segment_in_empty_seglist(tsd);
+
         return STREAM_INSERT_OK;
     }
 
-    if ( SEQ_GT(tracker->r_win_base, tsd.get_seg_seq() ) )
+    uint32_t base = get_queue_base();
+
+    if ( SEQ_GT(base, tsd.get_seg_seq() ) )
     {
-        int32_t offset = tracker->r_win_base - tsd.get_seg_seq();
+        int32_t offset = base - tsd.get_seg_seq();
 
         if ( offset < tsd.get_seg_len() )
         {
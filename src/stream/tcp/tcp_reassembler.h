@@ -126,6 +126,7 @@ protected:
         seglist.head = nullptr;
         seglist.tail = nullptr;
         seglist.next = nullptr;
+        seglist.root = nullptr;
     }
 
     int add_reassembly_segment(TcpSegmentDescriptor&, int16_t len, uint32_t slide, uint32_t trunc,
@@ -161,6 +162,9 @@ protected:
     void fallback();
     uint32_t flush_pdu_ackd(uint32_t* flags);
     int purge_to_seq(uint32_t flush_seq);
+    uint32_t get_queue_base();
+    uint32_t flush_inline(TcpSegmentDescriptor&);
+    void flush_inline_pdu(Packet*, const uint8_t* data, uint32_t len, uint32_t pkt_flags);
 
     bool server_side;
     TcpStreamTracker* tracker;
@@ -168,6 +172,8 @@ protected:
     uint8_t packet_dir;
     uint32_t flush_count = 0; /* number of flushed queued segments */
     uint32_t xtradata_mask = 0; /* extra data available to log */
+    uint32_t inline_seq = 0;    /* end of data inspected without queuing */
+    bool inline_flushed = false;
 };
 
 #endif
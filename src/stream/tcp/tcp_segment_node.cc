@@ -21,13 +21,123 @@
 
 #include "tcp_segment_node.h"
 
+#include <assert.h>
+
+#include <new>
+
 #include "flow/flow_control.h"
+#include "main/thread.h"
 #include "protocols/packet.h"
 #include "utils/util.h"
 #include "tcp_module.h"
 
+//-------------------------------------------------------------------------
+// segment slabs
+//
+// each node and its payload share one chunk from a power of 2 size class.
+// chunks are carved from slabs and go back on a per thread free list when
+// the segment is released so queueing a segment doesn't touch the heap
+// after warm up.  mem_in_use is charged a slab at a time.
+//-------------------------------------------------------------------------
+
+#define SEG_MIN_BITS 8      // 256 byte chunks
+#define SEG_CLASSES 10      // up to 128K; enough for any 16 bit dsize
+#define SEG_SLAB_SIZE 65536
+#define SEG_ALIGN 64
+
+struct FreeSeg
+{
+    FreeSeg* next;
+};
+
+struct SegSlab
+{
+    SegSlab* next;
+};
+
+static THREAD_LOCAL FreeSeg* free_segs[SEG_CLASSES] = { };
+static THREAD_LOCAL SegSlab* seg_slabs = nullptr;
+
+static inline unsigned seg_class(unsigned dsize)
+{
+    unsigned len = sizeof(TcpSegmentNode) + dsize - 1;
+    unsigned c = 0;
+
+    while ( (len >> (SEG_MIN_BITS + c)) )
+        ++c;
+
+    assert(c < SEG_CLASSES);
+    return c;
+}
+
+static inline unsigned seg_chunk_size(unsigned c)
+{ return 1 << (SEG_MIN_BITS + c); }
+
+static void seg_refill(unsigned c)
+{
+    unsigned chunk = seg_chunk_size(c);
+    unsigned size = chunk > SEG_SLAB_SIZE ? chunk : SEG_SLAB_SIZE;
+
+    // the slab header goes ahead of the first aligned chunk
+    size_t len = size + sizeof(SegSlab) + SEG_ALIGN;
+    uint8_t* p = (uint8_t*)snort_alloc(len);
+    SegSlab* slab = (SegSlab*)p;
+    slab->next = seg_slabs;
+    seg_slabs = slab;
+
+    uint8_t* base = (uint8_t*)(((uintptr_t)p + sizeof(SegSlab) + SEG_ALIGN - 1) &
+        ~(uintptr_t)(SEG_ALIGN - 1));
+
+    for ( unsigned off = 0; off + chunk <= size; off += chunk )
+    {
+        FreeSeg* fs = (FreeSeg*)(base + off);
+        fs->next = free_segs[c];
+        free_segs[c] = fs;
+    }
+    tcpStats.mem_in_use += len;
+}
+
+static void* seg_alloc(unsigned dsize)
+{
+    unsigned c = seg_class(dsize);
+
+    if ( !free_segs[c] )
+        seg_refill(c);
+
+    FreeSeg* fs = free_segs[c];
+    free_segs[c] = fs->next;
+    return fs;
+}
+
+static void seg_free(void* p, unsigned dsize)
+{
+    unsigned c = seg_class(dsize);
+    FreeSeg* fs = (FreeSeg*)p;
+    fs->next = free_segs[c];
+    free_segs[c] = fs;
+}
+
+void TcpSegmentNode::clear()
+{
+    while ( seg_slabs )
+    {
+        SegSlab* slab = seg_slabs;
+        seg_slabs = slab->next;
+        snort_free(slab);
+    }
+    for ( unsigned c = 0; c < SEG_CLASSES; ++c )
+        free_segs[c] = nullptr;
+
+    tcpStats.mem_in_use = 0;
+}
+
+//-------------------------------------------------------------------------
+// TcpSegmentNode
+//-------------------------------------------------------------------------
+
 TcpSegmentNode::TcpSegmentNode() :
-    prev(nullptr), next(nullptr), tv({ 0, 0 }), ts(0), seq(0), orig_dsize(0),
+    prev(nullptr), next(nullptr), parent(nullptr), lchild(nullptr), rchild(nullptr),
+    prio(0), tv({ 0, 0 }), ts(0), seq(0), orig_dsize(0),
     payload_size(0), urg_offset(0), buffered(false), data(nullptr), payload(nullptr)
 {
 }
@@ -52,23 +162,22 @@ TcpSegmentNode* TcpSegmentNode::init(TcpSegmentNode& tsn)
 
 TcpSegmentNode* TcpSegmentNode::init(const struct timeval& tv, const uint8_t* data, unsigned dsize)
 {
-    TcpSegmentNode* ss = new TcpSegmentNode;
-    ss->data = ( uint8_t* )snort_alloc(dsize);
+    TcpSegmentNode* ss = new (seg_alloc(dsize)) TcpSegmentNode;
+    ss->data = (uint8_t*)(ss + 1);
     ss->payload = ss->data;
     ss->tv = tv;
     memcpy(ss->payload, data, dsize);
     ss->orig_dsize = dsize;
     ss->payload_size = ss->orig_dsize;
-    tcpStats.mem_in_use += dsize;
     return ss;
 }
 
 void TcpSegmentNode::term()
 {
-    snort_free(data);
+    unsigned dsize = orig_dsize;
     tcpStats.segs_released++;
-    tcpStats.mem_in_use -= orig_dsize;
-    delete this;
+    this->~TcpSegmentNode();
+    seg_free(this, dsize);
 }
 
 bool TcpSegmentNode::is_retransmit(const uint8_t* rdata, uint16_t rsize, uint32_t rseq)
@@ -84,3 +193,124 @@ bool TcpSegmentNode::is_retransmit(const uint8_t* rdata, uint16_t rsize, uint32_
     return false;
 }
 
+
+//-------------------------------------------------------------------------
+// TcpSegmentList index
+//-------------------------------------------------------------------------
+
+// priorities must not be predictable from the traffic or the treap
+// could be driven out of balance
+static THREAD_LOCAL uint32_t seg_prio = 2463534242;
+
+static inline uint32_t next_prio()
+{
+    seg_prio ^= seg_prio << 13;
+    seg_prio ^= seg_prio >> 17;
+    seg_prio ^= seg_prio << 5;
+    return seg_prio;
+}
+
+void TcpSegmentList::rotate_up(TcpSegmentNode* x)
+{
+    TcpSegmentNode* p = x->parent;
+    TcpSegmentNode* g = p->parent;
+
+    if ( x == p->lchild )
+    {
+        p->lchild = x->rchild;
+        if ( p->lchild )
+            p->lchild->parent = p;
+        x->rchild = p;
+    }
+    else
+    {
+        p->rchild = x->lchild;
+        if ( p->rchild )
+            p->rchild->parent = p;
+        x->lchild = p;
+    }
+    p->parent = x;
+    x->parent = g;
+
+    if ( !g )
+        root = x;
+    else if ( g->lchild == p )
+        g->lchild = x;
+    else
+        g->rchild = x;
+}
+
+// ss is already linked into the list; put it at the same place in the
+// treap: right of its predecessor or else left of its successor
+void TcpSegmentList::index_insert(TcpSegmentNode* ss)
+{
+    ss->lchild = ss->rchild = nullptr;
+    ss->prio = next_prio();
+
+    if ( !root )
+    {
+        ss->parent = nullptr;
+        root = ss;
+        return;
+    }
+
+    if ( ss->prev and !ss->prev->rchild )
+    {
+        ss->parent = ss->prev;
+        ss->prev->rchild = ss;
+    }
+    else
+    {
+        assert(ss->next and !ss->next->lchild);
+        ss->parent = ss->next;
+        ss->next->lchild = ss;
+    }
+
+    while ( ss->parent and ss->parent->prio < ss->prio )
+        rotate_up(ss);
+}
+
+void TcpSegmentList::index_remove(TcpSegmentNode* ss)
+{
+    while ( ss->lchild or ss->rchild )
+    {
+        TcpSegmentNode* c;
+
+        if ( !ss->lchild )
+            c = ss->rchild;
+        else if ( !ss->rchild )
+            c = ss->lchild;
+        else
+            c = ss->lchild->prio > ss->rchild->prio ? ss->lchild : ss->rchild;
+
+        rotate_up(c);
+    }
+
+    if ( !ss->parent )
+        root = nullptr;
+    else if ( ss->parent->lchild == ss )
+        ss->parent->lchild = nullptr;
+    else
+        ss->parent->rchild = nullptr;
+
+    ss->parent = nullptr;
+}
+
+TcpSegmentNode* TcpSegmentList::find_left(uint32_t seq)
+{
+    TcpSegmentNode* node = root;
+    TcpSegmentNode* left = nullptr;
+
+    while ( node )
+    {
+        if ( SEQ_LT(node->seq, seq) )
+        {
+            left = node;
+            node = node->rchild;
+        }
+        else
+            node = node->lchild;
+    }
+    return left;
+}
+
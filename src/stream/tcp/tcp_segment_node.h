@@ -44,12 +44,21 @@ public:
     static TcpSegmentNode* init(TcpSegmentNode& tsn);
     static TcpSegmentNode* init(const struct timeval&, const uint8_t*, unsigned);
 
+    // per thread segment slabs; clear() must run after all flows are gone
+    static void clear();
+
     void term();
     bool is_retransmit(const uint8_t*, uint16_t size, uint32_t);
 
     TcpSegmentNode* prev;
     TcpSegmentNode* next;
 
+    // seq index; see TcpSegmentList
+    TcpSegmentNode* parent;
+    TcpSegmentNode* lchild;
+    TcpSegmentNode* rchild;
+    uint32_t prio;
+
     struct timeval tv;
     uint32_t ts;
     uint32_t seq;
@@ -62,11 +71,15 @@ public:
     uint8_t* payload;
 };
 
+// the list is in seq order and is indexed by a treap with the same in
+// order so that out of order segments can be placed without walking the
+// list.  nodes are linked into the treap by position, not by key, so
+// trimming a segment in place is fine as long as the list stays ordered.
 class TcpSegmentList
 {
 public:
     TcpSegmentList() :
-        head(nullptr), tail(nullptr), next(nullptr), count(0)
+        head(nullptr), tail(nullptr), next(nullptr), root(nullptr), count(0)
     {
     }
 
@@ -84,6 +97,7 @@ public:
     // up to date.
     TcpSegmentNode* next;
 
+    TcpSegmentNode* root;
     uint32_t count;
 
     uint32_t clear()
@@ -100,7 +114,7 @@ public:
             dump_me->term( );
         }
 
-        head = tail = next = nullptr;
+        head = tail = next = root = nullptr;
         count = 0;
         DebugFormat(DEBUG_STREAM_STATE, "Dropped %d segments\n", i);
         return i;
@@ -121,6 +135,7 @@ public:
         else
         {
             ss->next = head;
+            ss->prev = nullptr;
             if ( ss->next )
                 ss->next->prev = ss;
             else
@@ -128,11 +143,14 @@ public:
             head = ss;
         }
 
+        index_insert(ss);
         count++;
     }
 
     void remove(TcpSegmentNode* ss)
     {
+        index_remove(ss);
+
         if (ss->prev)
             ss->prev->next = ss->next;
         else
@@ -145,6 +163,14 @@ public:
 
         count--;
     }
+
+    // last segment that starts before seq or null if none
+    TcpSegmentNode* find_left(uint32_t seq);
+
+private:
+    void index_insert(TcpSegmentNode*);
+    void index_remove(TcpSegmentNode*);
+    void rotate_up(TcpSegmentNode*);
 };
 
 #endif
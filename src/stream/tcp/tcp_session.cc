@@ -1087,6 +1087,66 @@ bool TcpSession::validate_packet_established_session(TcpSegmentDescriptor& tsd)
     return true;
 }
 
+// predict the common case of in order data on an established session
+// that needs nothing trimmed.  these checks cover what the state machine
+// and handle_data_segment() would otherwise evaluate for such segments.
+inline bool TcpSession::is_fast_path(TcpSegmentDescriptor& tsd)
+{
+    const tcp::TCPHdr* tcph = tsd.get_tcph();
+    uint32_t len = tsd.get_seg_len();
+
+    if ( !len or (tcph->th_flags & ~TH_PUSH) != TH_ACK )
+        return false;
+
+    if ( talker->get_tcp_state() != TcpStreamTracker::TCP_ESTABLISHED
+        or listener->get_tcp_state() != TcpStreamTracker::TCP_ESTABLISHED )
+        return false;
+
+    if ( config->policy == StreamPolicy::OS_PROXY or !flow->two_way_traffic()
+        or (flow->get_session_flags() & SSNFLAG_MIDSTREAM)
+        or (flow->session_state & STREAM_STATE_MIDSTREAM) )
+        return false;
+
+    if ( !SEQ_EQ(tsd.get_seg_seq(), listener->r_nxt_ack) or !listener->get_snd_wnd() )
+        return false;
+
+    // window fits and mss fits so there is nothing to trim
+    if ( SEQ_GT(tsd.get_end_seq(), listener->r_win_base + listener->get_snd_wnd()) )
+        return false;
+
+    return !listener->get_mss() or len <= listener->get_mss();
+}
+
+// the established talker and listener actions for a data segment
+// without the event dispatch or the checks is_fast_path() covered
+inline bool TcpSession::process_fast_path(TcpSegmentDescriptor& tsd)
+{
+    Packet* p = tsd.get_pkt();
+
+    talker->set_tcp_event(TcpStreamTracker::TCP_DATA_SEG_SENT_EVENT);
+    listener->set_tcp_event(TcpStreamTracker::TCP_DATA_SEG_RECV_EVENT);
+
+    if ( !validate_packet_established_session(tsd) )
+        return false;
+
+    tcpStats.fast_path++;
+
+    talker->update_tracker_ack_sent(tsd);
+    listener->update_tracker_ack_recv(tsd);
+
+    listener->r_nxt_ack = tsd.get_end_seq();
+
+    if ( !(flow->get_session_flags() & SSNFLAG_STREAM_ORDER_BAD) )
+        p->packet_flags |= PKT_STREAM_ORDER_OK;
+
+    process_tcp_stream(tsd);
+    listener->reassembler->flush_on_data_policy(p);
+
+    update_paws_timestamps(tsd);
+    check_for_window_slam(tsd);
+    return true;
+}
+
 /*
  * Main entry point for TCP
  */
@@ -1133,7 +1193,10 @@ int TcpSession::process(Packet* p)
     {
         Profile profile(s5TcpStatePerfStats);
 
-        if ( tsm->eval(tsd, *talker, *listener) )
+        bool handled = is_fast_path(tsd) ?
+            process_fast_path(tsd) : tsm->eval(tsd, *talker, *listener);
+
+        if ( handled )
         {
             do_packet_analysis_post_checks(p);
             S5TraceTCP(p, flow, &tsd, 0);
@@ -88,6 +88,8 @@ private:
     void cleanup_session_if_expired(Packet*);
     bool do_packet_analysis_pre_checks(Packet*, TcpSegmentDescriptor&);
     void do_packet_analysis_post_checks(Packet*);
+    bool is_fast_path(TcpSegmentDescriptor&);
+    bool process_fast_path(TcpSegmentDescriptor&);
 
 
     TcpStateMachine* tsm;
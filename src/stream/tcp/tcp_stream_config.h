@@ -67,6 +67,7 @@ public:
 
     int hs_timeout = -1;
     int footprint = 0;
+    uint16_t adaptive_flush = 0;
     uint32_t paf_max = 16384;
 };
 
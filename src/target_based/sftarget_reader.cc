@@ -37,12 +37,17 @@
 #include <unistd.h>
 #include <time.h>
 
+#include <atomic>
+#include <vector>
+
 #include "snort_protocols.h"
 #include "sftarget_hostentry.h"
 #include "sftarget_data.h"
 
 #include "main/snort_config.h"
 #include "main/snort_debug.h"
+#include "main/thread.h"
+#include "main/thread_config.h"
 #include "parser/parser.h"
 #include "hash/sfxhash.h"
 #include "utils/util.h"
@@ -76,7 +81,8 @@ tTargetBasedConfig::tTargetBasedConfig()
     // this is a hack to get it going
     uint32_t max = snort_conf ?
         SnortConfig::get_max_attribute_hosts() : DEFAULT_MAX_ATTRIBUTE_HOSTS;
-    lookupTable = sfrt_new(DIR_8x16, IPv6, max + 1, (max>>6) + 1);
+    char type = (snort_conf and SnortConfig::get_attribute_poptrie()) ? POPTRIE : DIR_8x16;
+    lookupTable = sfrt_new(type, IPv6, max + 1, (max>>6) + 1);
 }
 
 tTargetBasedConfig::~tTargetBasedConfig()
@@ -88,6 +94,109 @@ tTargetBasedConfig::~tTargetBasedConfig()
 static THREAD_LOCAL tTargetBasedConfig* curr_cfg = NULL;
 static tTargetBasedConfig* next_cfg = NULL;
 
+//-------------------------------------------------------------------------
+// snapshot publication
+//
+// the main thread builds next_cfg off the packet path and publishes it with
+// a single pointer store.  packet threads pick up the latest table between
+// bursts and announce the generation they hold in their slot.  a replaced
+// table is freed once every running thread has moved past it so lookups
+// never lock and host updates don't need a swap.
+//-------------------------------------------------------------------------
+
+#define SFAT_NOT_HELD (~0u)
+
+struct RetiredConfig
+{
+    tTargetBasedConfig* cfg;
+    unsigned gen;   // first generation that no longer uses cfg
+};
+
+static std::atomic<tTargetBasedConfig*> pub_cfg { nullptr };
+static std::atomic<unsigned> pub_gen { 0 };
+
+static std::atomic<unsigned>* held_gens = nullptr;  // one per packet thread
+static unsigned num_held = 0;
+static std::vector<RetiredConfig> retired;
+
+static THREAD_LOCAL unsigned held_gen = 0;
+
+static void publish_config(tTargetBasedConfig* p)
+{
+    tTargetBasedConfig* old = pub_cfg.load();
+    unsigned gen = pub_gen.load() + 1;
+
+    pub_cfg.store(p);
+    pub_gen.store(gen);
+    curr_cfg = p;
+
+    if ( old )
+        retired.push_back({ old, gen });
+}
+
+// the slot is stored before the pointer is loaded and the generation is
+// checked again after.  if the main thread missed our slot it must have
+// bumped the generation first so we retry rather than use a table that
+// may be freed.
+void SFAT_Refresh()
+{
+    if ( pub_gen.load(std::memory_order_relaxed) == held_gen or !held_gens )
+        return;
+
+    unsigned id = get_instance_id();
+    assert(id < num_held);
+
+    unsigned gen;
+
+    do
+    {
+        gen = pub_gen.load();
+        held_gens[id].store(gen);
+        curr_cfg = pub_cfg.load();
+    }
+    while ( gen != pub_gen.load() );
+
+    held_gen = gen;
+}
+
+void SFAT_Release()
+{
+    if ( held_gens and get_instance_id() < num_held )
+        held_gens[get_instance_id()].store(SFAT_NOT_HELD);
+
+    curr_cfg = nullptr;
+    held_gen = 0;
+}
+
+void SFAT_Reclaim()
+{
+    if ( retired.empty() )
+        return;
+
+    unsigned oldest = SFAT_NOT_HELD;
+
+    for ( unsigned i = 0; i < num_held; ++i )
+    {
+        unsigned gen = held_gens[i].load();
+
+        if ( gen < oldest )
+            oldest = gen;
+    }
+
+    auto it = retired.begin();
+
+    while ( it != retired.end() )
+    {
+        if ( it->gen <= oldest )
+        {
+            delete it->cfg;
+            it = retired.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
 static bool sfat_grammar_error_printed = false;
 static bool sfat_insufficient_space_logged = false;
 
@@ -316,25 +425,21 @@ HostAttributeEntry* SFAT_LookupHostEntryByDst(Packet* p)
 
 void SFAT_Cleanup()
 {
-    delete curr_cfg;
+    delete pub_cfg.load();
     delete next_cfg;
 
-    FreeProtoocolReferenceTable();
-}
+    for ( auto& r : retired )
+        delete r.cfg;
 
-void SFAT_SetConfig(tTargetBasedConfig* p)
-{
-    curr_cfg = p;
-}
+    retired.clear();
+    pub_cfg.store(nullptr);
+    curr_cfg = next_cfg = nullptr;
 
-tTargetBasedConfig* SFAT_GetConfig()
-{
-    return curr_cfg;
-}
+    delete[] held_gens;
+    held_gens = nullptr;
+    num_held = 0;
 
-void SFAT_Free(tTargetBasedConfig* p)
-{
-    delete p;
+    FreeProtoocolReferenceTable();
 }
 
 void SFAT_Init()
@@ -346,14 +451,21 @@ void SFAT_Init()
 
 void SFAT_Start()
 {
-    curr_cfg = next_cfg;
+    num_held = ThreadConfig::get_instance_max();
+    held_gens = new std::atomic<unsigned>[num_held];
+
+    for ( unsigned i = 0; i < num_held; ++i )
+        held_gens[i].store(SFAT_NOT_HELD, std::memory_order_relaxed);
+
+    publish_config(next_cfg);
     next_cfg = new tTargetBasedConfig;
 }
 
 tTargetBasedConfig* SFAT_Swap()
 {
-    curr_cfg = next_cfg;
+    publish_config(next_cfg);
     next_cfg = new tTargetBasedConfig;
+    SFAT_Reclaim();
 
     proc_stats.attribute_table_hosts = SFAT_NumberOfHosts();
     proc_stats.attribute_table_reloads++;
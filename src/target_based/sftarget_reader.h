@@ -59,11 +59,14 @@ int SFAT_AddApplicationData(HostAttributeEntry*, struct ApplicationEntry*);
 void SFAT_UpdateApplicationProtocol(sfip_t*, uint16_t port, uint16_t protocol, uint16_t id);
 
 // reload functions
+// SFAT_Swap publishes the table just loaded; packet threads pick it up with
+// SFAT_Refresh between bursts and drop it with SFAT_Release on exit.  the
+// main thread calls SFAT_Reclaim to free tables no thread still holds.
 struct tTargetBasedConfig;
 tTargetBasedConfig* SFAT_Swap();
-tTargetBasedConfig* SFAT_GetConfig();
-void SFAT_SetConfig(tTargetBasedConfig*);
-void SFAT_Free(tTargetBasedConfig*);
+void SFAT_Refresh();
+void SFAT_Release();
+void SFAT_Reclaim();
 
 #endif
 
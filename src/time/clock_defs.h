@@ -22,7 +22,10 @@
 
 #include <chrono>
 
-using hr_clock = std::chrono::high_resolution_clock;
+#include "time/tsc_clock.h"
+
+// all latency and profiler timing goes through this
+using hr_clock = TscClock;
 using hr_duration = hr_clock::duration;
 using hr_time = hr_clock::time_point;
 
@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// tsc_clock.cc
+
+#include "tsc_clock.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+bool TscClock::use_tsc = false;
+uint64_t TscClock::mult = 0;
+
+#if defined(__x86_64__)
+static bool tsc_is_invariant()
+{
+    unsigned a, b, c, d;
+
+    if ( !__get_cpuid(0x80000000, &a, &b, &c, &d) or a < 0x80000007 )
+        return false;
+
+    __get_cpuid(0x80000007, &a, &b, &c, &d);
+    return (d & (1 << 8)) != 0;
+}
+#endif
+
+// 20 ms is enough to get within a few ppm
+void TscClock::init()
+{
+    use_tsc = false;
+
+#if defined(__x86_64__)
+    if ( !tsc_is_invariant() )
+        return;
+
+    using steady = std::chrono::steady_clock;
+    const auto span = std::chrono::milliseconds(20);
+
+    uint64_t t0, t1;
+    steady::time_point s0 = steady::now();
+    get_clockticks(t0);
+
+    steady::time_point s1;
+
+    do
+        s1 = steady::now();
+    while ( s1 - s0 < span );
+
+    get_clockticks(t1);
+
+    uint64_t ns = std::chrono::duration_cast<duration>(s1 - s0).count();
+
+    if ( t1 <= t0 )
+        return;
+
+    mult = (uint64_t)(((unsigned __int128)ns << SHIFT) / (t1 - t0));
+    use_tsc = mult != 0;
+#endif
+}
+
+//--------------------------------------------------------------------------
+// tests
+//--------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+TEST_CASE("tsc clock", "[time]")
+{
+    TscClock::init();
+
+    auto c0 = TscClock::now();
+    auto s0 = std::chrono::steady_clock::now();
+
+    auto s1 = s0;
+
+    do
+        s1 = std::chrono::steady_clock::now();
+    while ( s1 - s0 < std::chrono::milliseconds(10) );
+
+    auto c1 = TscClock::now();
+
+    auto tsc_us = std::chrono::duration_cast<std::chrono::microseconds>(c1 - c0).count();
+    auto ref_us = std::chrono::duration_cast<std::chrono::microseconds>(s1 - s0).count();
+
+    CHECK(c1 >= c0);
+    CHECK(tsc_us >= ref_us * 9 / 10);
+    CHECK(tsc_us <= ref_us * 11 / 10 + 1000);
+}
+#endif
+
@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// tsc_clock.h
+
+#ifndef TSC_CLOCK_H
+#define TSC_CLOCK_H
+
+// A steady clock read from the CPU time stamp counter, for code that takes
+// several timestamps per packet.  The TSC is only used when the CPU says it
+// is invariant (constant rate, doesn't stop in idle states) and after it is
+// calibrated against steady_clock; otherwise now() is steady_clock::now().
+// Either way ticks are nanoseconds so durations mix freely with chrono.
+
+#include <chrono>
+#include <cstdint>
+
+#include "main/snort_types.h"
+#include "time/cpuclock.h"
+
+class SO_PUBLIC TscClock
+{
+public:
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<TscClock, duration>;
+
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept
+    {
+#if defined(__x86_64__)
+        if ( use_tsc )
+        {
+            uint64_t t;
+            get_clockticks(t);
+            return time_point(duration((rep)(((unsigned __int128)t * mult) >> SHIFT)));
+        }
+#endif
+        return time_point(std::chrono::duration_cast<duration>(
+            std::chrono::steady_clock::now().time_since_epoch()));
+    }
+
+    // call once from the main thread before any thread takes timestamps;
+    // time points taken before and after are not comparable
+    static void init();
+
+    static bool tsc_enabled()
+    { return use_tsc; }
+
+    // TSC cycles per ns or 0 if the TSC isn't used
+    static double cycles_per_ns()
+    { return use_tsc ? (double)(1ull << SHIFT) / mult : 0.0; }
+
+private:
+    static const unsigned SHIFT = 32;
+
+    static bool use_tsc;
+    static uint64_t mult;  // ns per tick << SHIFT
+};
+
+#endif
+
@@ -42,7 +42,19 @@ public:
 
     size_t size() const;
 
-    // FIXIT-L add operator overloads for [], &=, |=, etc
+    // word at a time ops; sizes must match for the set ops
+    bool any() const;
+    size_t count() const;
+
+    // first set bit at or after the given one; size() if none
+    size_t find_first() const;
+    size_t find_next(size_t bit) const;
+
+    BitOp& operator&=(const BitOp&);
+    BitOp& operator|=(const BitOp&);
+    BitOp& operator^=(const BitOp&);
+
+    // FIXIT-L add operator overload for []
     size_t get_buf_size() const;
     uint8_t& get_buf_element(size_t);
     const uint8_t& get_buf_element(size_t) const;
@@ -50,6 +62,9 @@ public:
 private:
     uint8_t mask(size_t bit) const;
 
+    template<typename Op>
+    void apply(const BitOp&, Op);
+
     uint8_t* bit_buf;
     const size_t buf_size;
 };
@@ -97,6 +112,111 @@ inline void BitOp::clear(unsigned int bit)
 inline size_t BitOp::size() const
 { return buf_size << 3; }
 
+// bits are numbered from the msb of each byte so a big endian load of 8
+// bytes has bit n of the buffer at clz position n of the word
+inline bool BitOp::any() const
+{
+    size_t i = 0;
+
+    for ( ; i + 8 <= buf_size; i += 8 )
+    {
+        uint64_t w;
+        memcpy(&w, bit_buf + i, sizeof(w));
+
+        if ( w )
+            return true;
+    }
+    for ( ; i < buf_size; ++i )
+        if ( bit_buf[i] )
+            return true;
+
+    return false;
+}
+
+inline size_t BitOp::count() const
+{
+    size_t i = 0, n = 0;
+
+    for ( ; i + 8 <= buf_size; i += 8 )
+    {
+        uint64_t w;
+        memcpy(&w, bit_buf + i, sizeof(w));
+        n += __builtin_popcountll(w);
+    }
+    for ( ; i < buf_size; ++i )
+        n += __builtin_popcount(bit_buf[i]);
+
+    return n;
+}
+
+inline size_t BitOp::find_next(size_t bit) const
+{
+    if ( bit >= size() )
+        return size();
+
+    size_t i = bit >> 3;
+
+    // finish the first byte, then go a word at a time
+    uint8_t b = bit_buf[i] & (uint8_t)(0xff >> (bit & 7));
+
+    if ( b )
+        return (i << 3) + __builtin_clz(b) - 24;
+
+    for ( ++i; i + 8 <= buf_size; i += 8 )
+    {
+        uint64_t w;
+        memcpy(&w, bit_buf + i, sizeof(w));
+
+        if ( w )
+            return (i << 3) + __builtin_clzll(__builtin_bswap64(w));
+    }
+    for ( ; i < buf_size; ++i )
+    {
+        if ( bit_buf[i] )
+            return (i << 3) + __builtin_clz(bit_buf[i]) - 24;
+    }
+    return size();
+}
+
+inline size_t BitOp::find_first() const
+{ return find_next(0); }
+
+template<typename Op>
+inline void BitOp::apply(const BitOp& rhs, Op op)
+{
+    assert(buf_size == rhs.buf_size);
+    size_t i = 0;
+
+    for ( ; i + 8 <= buf_size; i += 8 )
+    {
+        uint64_t a, b;
+        memcpy(&a, bit_buf + i, sizeof(a));
+        memcpy(&b, rhs.bit_buf + i, sizeof(b));
+        a = op(a, b);
+        memcpy(bit_buf + i, &a, sizeof(a));
+    }
+    for ( ; i < buf_size; ++i )
+        bit_buf[i] = (uint8_t)op(bit_buf[i], rhs.bit_buf[i]);
+}
+
+inline BitOp& BitOp::operator&=(const BitOp& rhs)
+{
+    apply(rhs, [](uint64_t a, uint64_t b) { return a & b; });
+    return *this;
+}
+
+inline BitOp& BitOp::operator|=(const BitOp& rhs)
+{
+    apply(rhs, [](uint64_t a, uint64_t b) { return a | b; });
+    return *this;
+}
+
+inline BitOp& BitOp::operator^=(const BitOp& rhs)
+{
+    apply(rhs, [](uint64_t a, uint64_t b) { return a ^ b; });
+    return *this;
+}
+
 inline size_t BitOp::get_buf_size() const
 { return buf_size; }
 
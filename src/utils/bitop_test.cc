@@ -47,3 +47,60 @@ TEST_CASE( "bitop", "[bitop]" )
         CHECK( bitop.size() == 24 );
     }
 }
+
+TEST_CASE( "bitop words", "[bitop]" )
+{
+    // 19 bytes covers two full words and a tail
+    BitOp bitop(19);
+
+    CHECK_FALSE( bitop.any() );
+    CHECK( bitop.count() == 0 );
+    CHECK( bitop.find_first() == bitop.size() );
+
+    const unsigned bits[] = { 0, 7, 8, 63, 64, 100, 143, 151 };
+
+    for ( auto b : bits )
+        bitop.set(b);
+
+    SECTION( "any/count" )
+    {
+        CHECK( bitop.any() );
+        CHECK( bitop.count() == 8 );
+    }
+
+    SECTION( "find" )
+    {
+        unsigned i = 0;
+
+        for ( size_t b = bitop.find_first(); b < bitop.size(); b = bitop.find_next(b + 1) )
+        {
+            REQUIRE( i < 8 );
+            CHECK( b == bits[i++] );
+        }
+        CHECK( i == 8 );
+        CHECK( bitop.find_next(152) == bitop.size() );
+    }
+
+    SECTION( "set ops" )
+    {
+        BitOp other(19);
+        other.set(7);
+        other.set(101);
+        other.set(151);
+
+        BitOp both(19);
+        both |= bitop;
+        both &= other;
+        CHECK( both.count() == 2 );
+        CHECK( both.is_set(7) );
+        CHECK( both.is_set(151) );
+
+        bitop ^= other;
+        CHECK( bitop.count() == 7 );
+        CHECK_FALSE( bitop.is_set(7) );
+        CHECK( bitop.is_set(101) );
+
+        bitop |= other;
+        CHECK( bitop.count() == 9 );
+    }
+}
@@ -0,0 +1,316 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// flowbit_set.cc
+
+#include "flowbit_set.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef UNIT_TEST
+#include "catch/catch.hpp"
+#endif
+
+//-------------------------------------------------------------------------
+// mask
+//-------------------------------------------------------------------------
+
+void FlowBitMask::set(unsigned bit)
+{
+    uint32_t w = bit >> 6;
+    uint64_t m = (uint64_t)1 << (bit & 63);
+
+    auto it = std::lower_bound(index.begin(), index.end(), w);
+    unsigned k = it - index.begin();
+
+    if ( it == index.end() or *it != w )
+    {
+        index.insert(it, w);
+        words.insert(words.begin() + k, 0);
+    }
+    if ( !(words[k] & m) )
+    {
+        words[k] |= m;
+        bits++;
+    }
+}
+
+bool FlowBitMask::is_set(unsigned bit) const
+{
+    uint32_t w = bit >> 6;
+    auto it = std::lower_bound(index.begin(), index.end(), w);
+
+    if ( it == index.end() or *it != w )
+        return false;
+
+    return (words[it - index.begin()] >> (bit & 63)) & 1;
+}
+
+//-------------------------------------------------------------------------
+// set
+//-------------------------------------------------------------------------
+
+FlowBitSet::FlowBitSet(unsigned max)
+{
+    dense = nullptr;
+    max_bits = max;
+    num_words = (max + 63) >> 6;
+    num_sparse = 0;
+}
+
+FlowBitSet::~FlowBitSet()
+{
+    delete[] dense;
+}
+
+// a flow that went dense stays dense; flows are recycled and the ones
+// that needed many bits are likely to again
+void FlowBitSet::reset()
+{
+    if ( dense )
+        memset(dense, 0, num_words * sizeof(*dense));
+
+    num_sparse = 0;
+}
+
+bool FlowBitSet::empty() const
+{
+    if ( !dense )
+        return !num_sparse;
+
+    for ( unsigned i = 0; i < num_words; ++i )
+        if ( dense[i] )
+            return false;
+
+    return true;
+}
+
+void FlowBitSet::make_dense()
+{
+    dense = new uint64_t[num_words]();
+
+    for ( unsigned i = 0; i < num_sparse; ++i )
+        dense[sparse[i] >> 6] |= (uint64_t)1 << (sparse[i] & 63);
+
+    num_sparse = 0;
+}
+
+void FlowBitSet::clear(const FlowBitMask& fbm)
+{
+    if ( dense )
+    {
+        for ( unsigned k = 0; k < fbm.index.size() and fbm.index[k] < num_words; ++k )
+            dense[fbm.index[k]] &= ~fbm.words[k];
+        return;
+    }
+    unsigned i = 0;
+
+    while ( i < num_sparse )
+    {
+        if ( fbm.is_set(sparse[i]) )
+            sparse[i] = sparse[--num_sparse];
+        else
+            ++i;
+    }
+}
+
+void FlowBitSet::toggle(const FlowBitMask& fbm)
+{
+    if ( !dense and num_sparse + fbm.bits > FLOWBIT_SPARSE_MAX )
+        make_dense();
+
+    if ( dense )
+    {
+        for ( unsigned k = 0; k < fbm.index.size() and fbm.index[k] < num_words; ++k )
+            dense[fbm.index[k]] ^= fbm.words[k];
+        return;
+    }
+    for ( unsigned k = 0; k < fbm.index.size(); ++k )
+    {
+        uint64_t w = fbm.words[k];
+
+        while ( w )
+        {
+            unsigned bit = (fbm.index[k] << 6) + __builtin_ctzll(w);
+            w &= w - 1;
+
+            int i = find(bit);
+
+            if ( i >= 0 )
+                sparse[i] = sparse[--num_sparse];
+            else
+                sparse[num_sparse++] = bit;
+        }
+    }
+}
+
+bool FlowBitSet::any(const FlowBitMask& fbm) const
+{
+    if ( dense )
+    {
+        for ( unsigned k = 0; k < fbm.index.size() and fbm.index[k] < num_words; ++k )
+            if ( dense[fbm.index[k]] & fbm.words[k] )
+                return true;
+
+        return false;
+    }
+    for ( unsigned i = 0; i < num_sparse; ++i )
+        if ( fbm.is_set(sparse[i]) )
+            return true;
+
+    return false;
+}
+
+bool FlowBitSet::all(const FlowBitMask& fbm) const
+{
+    if ( dense )
+    {
+        for ( unsigned k = 0; k < fbm.index.size(); ++k )
+        {
+            if ( fbm.index[k] >= num_words )
+                return false;
+
+            if ( (dense[fbm.index[k]] & fbm.words[k]) != fbm.words[k] )
+                return false;
+        }
+        return true;
+    }
+    if ( fbm.bits > num_sparse )
+        return false;
+
+    unsigned n = 0;
+
+    for ( unsigned i = 0; i < num_sparse; ++i )
+        if ( fbm.is_set(sparse[i]) )
+            ++n;
+
+    return n == fbm.bits;
+}
+
+//-------------------------------------------------------------------------
+// unit tests
+//-------------------------------------------------------------------------
+
+#ifdef UNIT_TEST
+
+TEST_CASE("flowbit mask", "[flowbit_set]")
+{
+    FlowBitMask fbm;
+
+    fbm.set(3);
+    fbm.set(700);
+    fbm.set(3);
+    fbm.set(64);
+
+    CHECK(fbm.count() == 3);
+    CHECK(fbm.is_set(3));
+    CHECK(fbm.is_set(64));
+    CHECK(fbm.is_set(700));
+    CHECK_FALSE(fbm.is_set(4));
+    CHECK_FALSE(fbm.is_set(1000));
+}
+
+TEST_CASE("flowbit set sparse to dense", "[flowbit_set]")
+{
+    FlowBitSet fbs(2048);
+    CHECK(fbs.empty());
+
+    for ( unsigned i = 0; i < FLOWBIT_SPARSE_MAX; ++i )
+        fbs.set(i * 100);
+
+    CHECK_FALSE(fbs.is_dense());
+    fbs.set(0);
+    CHECK_FALSE(fbs.is_dense());
+
+    fbs.set(2047);
+    CHECK(fbs.is_dense());
+
+    for ( unsigned i = 0; i < FLOWBIT_SPARSE_MAX; ++i )
+        CHECK(fbs.is_set(i * 100));
+
+    CHECK(fbs.is_set(2047));
+    CHECK_FALSE(fbs.is_set(1));
+
+    fbs.clear(2047);
+    CHECK_FALSE(fbs.is_set(2047));
+
+    CHECK_FALSE(fbs.empty());
+    fbs.reset();
+    CHECK_FALSE(fbs.is_set(0));
+    CHECK(fbs.empty());
+}
+
+TEST_CASE("flowbit set groups", "[flowbit_set]")
+{
+    FlowBitMask grp;
+    grp.set(10);
+    grp.set(500);
+
+    for ( int dense = 0; dense < 2; ++dense )
+    {
+        FlowBitSet fbs(1024);
+
+        if ( dense )
+        {
+            for ( unsigned i = 0; i <= FLOWBIT_SPARSE_MAX; ++i )
+                fbs.set(900 + i);
+            REQUIRE(fbs.is_dense());
+        }
+
+        CHECK_FALSE(fbs.any(grp));
+        CHECK_FALSE(fbs.all(grp));
+
+        fbs.set(10);
+        fbs.set(11);
+        CHECK(fbs.any(grp));
+        CHECK_FALSE(fbs.all(grp));
+
+        fbs.set(500);
+        CHECK(fbs.all(grp));
+
+        fbs.clear(grp);
+        CHECK_FALSE(fbs.any(grp));
+        CHECK(fbs.is_set(11));
+
+        fbs.set(10);
+        fbs.toggle(grp);
+        CHECK_FALSE(fbs.is_set(10));
+        CHECK(fbs.is_set(500));
+        CHECK(fbs.is_set(11));
+    }
+}
+
+TEST_CASE("flowbit set toggle overflow", "[flowbit_set]")
+{
+    FlowBitMask grp;
+
+    for ( unsigned i = 0; i < 2 * FLOWBIT_SPARSE_MAX; ++i )
+        grp.set(i);
+
+    FlowBitSet fbs(64);
+    fbs.set(0);
+    fbs.toggle(grp);
+
+    CHECK(fbs.is_dense());
+    CHECK_FALSE(fbs.is_set(0));
+    CHECK(fbs.is_set(1));
+    CHECK(fbs.is_set(2 * FLOWBIT_SPARSE_MAX - 1));
+}
+
+#endif
+
@@ -0,0 +1,157 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// flowbit_set.h
+
+#ifndef FLOWBIT_SET_H
+#define FLOWBIT_SET_H
+
+// Per flow bit vector for flowbits.  Most flows set only a handful of
+// bits out of the thousands a large rule set defines, so the set starts
+// out as a short inline list of ids and only allocates a dense bitmap of
+// 64 bit words once more than FLOWBIT_SPARSE_MAX bits are set.
+//
+// FlowBitMask is the parse time form of a flowbits group: just the non
+// zero words of the group's bitmap, so group operations touch only the
+// words the group actually uses.
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#define FLOWBIT_SPARSE_MAX 6
+
+class FlowBitMask
+{
+public:
+    FlowBitMask()
+    { bits = 0; }
+
+    void set(unsigned bit);
+    bool is_set(unsigned bit) const;
+
+    // number of distinct bits in the group
+    unsigned count() const
+    { return bits; }
+
+private:
+    friend class FlowBitSet;
+
+    std::vector<uint32_t> index;  // word numbers, ascending
+    std::vector<uint64_t> words;  // parallel to index
+    unsigned bits;
+};
+
+class FlowBitSet
+{
+public:
+    FlowBitSet(unsigned max_bits);
+    ~FlowBitSet();
+
+    void reset();
+    void set(unsigned bit);
+    void clear(unsigned bit);
+    bool is_set(unsigned bit) const;
+
+    // true if no bit is set
+    bool empty() const;
+
+    // group operations
+    void clear(const FlowBitMask&);
+    void toggle(const FlowBitMask&);
+    bool any(const FlowBitMask&) const;
+    bool all(const FlowBitMask&) const;
+
+    unsigned size() const
+    { return max_bits; }
+
+    bool is_dense() const
+    { return dense != nullptr; }
+
+private:
+    void make_dense();
+    int find(unsigned bit) const;
+
+    uint64_t* dense;
+    unsigned max_bits;
+    unsigned num_words;
+
+    uint16_t num_sparse;
+    uint16_t sparse[FLOWBIT_SPARSE_MAX];
+};
+
+// -----------------------------------------------------------------------------
+// implementation
+// -----------------------------------------------------------------------------
+
+inline int FlowBitSet::find(unsigned bit) const
+{
+    for ( unsigned i = 0; i < num_sparse; ++i )
+        if ( sparse[i] == bit )
+            return i;
+
+    return -1;
+}
+
+inline void FlowBitSet::set(unsigned bit)
+{
+    assert(size() > bit);
+
+    if ( dense )
+    {
+        dense[bit >> 6] |= (uint64_t)1 << (bit & 63);
+        return;
+    }
+    if ( find(bit) >= 0 )
+        return;
+
+    if ( num_sparse < FLOWBIT_SPARSE_MAX )
+    {
+        sparse[num_sparse++] = bit;
+        return;
+    }
+    make_dense();
+    dense[bit >> 6] |= (uint64_t)1 << (bit & 63);
+}
+
+inline void FlowBitSet::clear(unsigned bit)
+{
+    assert(size() > bit);
+
+    if ( dense )
+    {
+        dense[bit >> 6] &= ~((uint64_t)1 << (bit & 63));
+        return;
+    }
+    int i = find(bit);
+
+    if ( i >= 0 )
+        sparse[i] = sparse[--num_sparse];
+}
+
+inline bool FlowBitSet::is_set(unsigned bit) const
+{
+    assert(size() > bit);
+
+    if ( dense )
+        return (dense[bit >> 6] >> (bit & 63)) & 1;
+
+    return find(bit) >= 0;
+}
+
+#endif
+
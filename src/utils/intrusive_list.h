@@ -0,0 +1,214 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// intrusive_list.h
+
+#ifndef INTRUSIVE_LIST_H
+#define INTRUSIVE_LIST_H
+
+// Lists and queues whose links are embedded in the objects they hold, so
+// adding an element never allocates and walking the list doesn't chase a
+// separate node.  An object can be on one list per link member.  The list
+// doesn't own its objects; use these instead of sflsq on the packet path.
+
+template<typename T>
+struct IntrusiveLink
+{
+    T* next = nullptr;
+    T* prev = nullptr;
+};
+
+// doubly linked; O(1) insert and remove anywhere
+template<typename T, IntrusiveLink<T> T::*link>
+class IntrusiveList
+{
+public:
+    bool empty() const
+    { return !head; }
+
+    unsigned size() const
+    { return count; }
+
+    T* front() const
+    { return head; }
+
+    T* back() const
+    { return tail; }
+
+    // fetch the next before removing the current element
+    static T* next(const T* t)
+    { return (t->*link).next; }
+
+    static T* prev(const T* t)
+    { return (t->*link).prev; }
+
+    void push_front(T* t)
+    {
+        IntrusiveLink<T>& l = t->*link;
+        l.prev = nullptr;
+        l.next = head;
+
+        if ( head )
+            (head->*link).prev = t;
+        else
+            tail = t;
+
+        head = t;
+        ++count;
+    }
+
+    void push_back(T* t)
+    {
+        IntrusiveLink<T>& l = t->*link;
+        l.next = nullptr;
+        l.prev = tail;
+
+        if ( tail )
+            (tail->*link).next = t;
+        else
+            head = t;
+
+        tail = t;
+        ++count;
+    }
+
+    // insert t ahead of pos, which must be on this list
+    void insert_before(T* pos, T* t)
+    {
+        IntrusiveLink<T>& p = pos->*link;
+
+        if ( !p.prev )
+        {
+            push_front(t);
+            return;
+        }
+        IntrusiveLink<T>& l = t->*link;
+        l.prev = p.prev;
+        l.next = pos;
+        (p.prev->*link).next = t;
+        p.prev = t;
+        ++count;
+    }
+
+    // t must be on this list
+    void remove(T* t)
+    {
+        IntrusiveLink<T>& l = t->*link;
+
+        if ( l.prev )
+            (l.prev->*link).next = l.next;
+        else
+            head = l.next;
+
+        if ( l.next )
+            (l.next->*link).prev = l.prev;
+        else
+            tail = l.prev;
+
+        l.next = l.prev = nullptr;
+        --count;
+    }
+
+    T* pop_front()
+    {
+        T* t = head;
+
+        if ( t )
+            remove(t);
+
+        return t;
+    }
+
+    T* pop_back()
+    {
+        T* t = tail;
+
+        if ( t )
+            remove(t);
+
+        return t;
+    }
+
+    // empty the list, handing each element to f (e.g. to delete it)
+    template<typename Func>
+    void clear(Func f)
+    {
+        while ( T* t = pop_front() )
+            f(t);
+    }
+
+    void clear()
+    { head = tail = nullptr; count = 0; }
+
+private:
+    T* head = nullptr;
+    T* tail = nullptr;
+    unsigned count = 0;
+};
+
+// singly linked FIFO; one pointer per element
+template<typename T, T* T::*link>
+class IntrusiveQueue
+{
+public:
+    bool empty() const
+    { return !head; }
+
+    unsigned size() const
+    { return count; }
+
+    T* front() const
+    { return head; }
+
+    void push(T* t)
+    {
+        t->*link = nullptr;
+
+        if ( tail )
+            tail->*link = t;
+        else
+            head = t;
+
+        tail = t;
+        ++count;
+    }
+
+    T* pop()
+    {
+        T* t = head;
+
+        if ( !t )
+            return nullptr;
+
+        head = t->*link;
+
+        if ( !head )
+            tail = nullptr;
+
+        t->*link = nullptr;
+        --count;
+        return t;
+    }
+
+private:
+    T* head = nullptr;
+    T* tail = nullptr;
+    unsigned count = 0;
+};
+
+#endif
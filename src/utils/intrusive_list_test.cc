@@ -0,0 +1,142 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+
+// intrusive_list_test.cc
+
+#ifdef UNIT_TEST
+
+#include "intrusive_list.h"
+
+#include <vector>
+
+#include "catch/catch.hpp"
+
+namespace
+{
+
+struct Item
+{
+    int v;
+    IntrusiveLink<Item> link;
+    IntrusiveLink<Item> other;
+    Item* qnext;
+
+    Item(int i) : v(i) { }
+};
+
+typedef IntrusiveList<Item, &Item::link> ItemList;
+typedef IntrusiveList<Item, &Item::other> OtherList;
+typedef IntrusiveQueue<Item, &Item::qnext> ItemQueue;
+
+std::vector<int> values(const ItemList& list)
+{
+    std::vector<int> vec;
+
+    for ( Item* i = list.front(); i; i = ItemList::next(i) )
+        vec.push_back(i->v);
+
+    return vec;
+}
+
+}
+
+TEST_CASE( "intrusive list", "[intrusive]" )
+{
+    Item a(1), b(2), c(3), d(4);
+    ItemList list;
+
+    CHECK( list.empty() );
+    CHECK( !list.pop_front() );
+
+    list.push_back(&b);
+    list.push_back(&c);
+    list.push_front(&a);
+    list.insert_before(&c, &d);
+
+    CHECK( list.size() == 4 );
+    CHECK( values(list) == std::vector<int>({ 1, 2, 4, 3 }) );
+    CHECK( list.back() == &c );
+
+    SECTION( "remove" )
+    {
+        list.remove(&d);
+        CHECK( values(list) == std::vector<int>({ 1, 2, 3 }) );
+
+        list.remove(&a);
+        list.remove(&c);
+        CHECK( list.front() == &b );
+        CHECK( list.back() == &b );
+
+        list.remove(&b);
+        CHECK( list.empty() );
+        CHECK( list.size() == 0 );
+    }
+
+    SECTION( "pop" )
+    {
+        CHECK( list.pop_back() == &c );
+        CHECK( list.pop_front() == &a );
+        CHECK( values(list) == std::vector<int>({ 2, 4 }) );
+    }
+
+    SECTION( "two lists" )
+    {
+        OtherList other;
+        other.push_back(&c);
+        other.push_back(&a);
+
+        list.remove(&c);
+        CHECK( other.size() == 2 );
+        CHECK( OtherList::next(other.front()) == &a );
+    }
+
+    SECTION( "clear" )
+    {
+        int sum = 0;
+        list.clear([&sum](Item* i) { sum += i->v; });
+
+        CHECK( sum == 10 );
+        CHECK( list.empty() );
+    }
+}
+
+TEST_CASE( "intrusive queue", "[intrusive]" )
+{
+    Item a(1), b(2), c(3);
+    ItemQueue q;
+
+    CHECK( q.empty() );
+    CHECK( !q.pop() );
+
+    q.push(&a);
+    q.push(&b);
+    CHECK( q.pop() == &a );
+
+    q.push(&c);
+    CHECK( q.size() == 2 );
+    CHECK( q.front() == &b );
+    CHECK( q.pop() == &b );
+    CHECK( q.pop() == &c );
+    CHECK( q.empty() );
+
+    q.push(&a);
+    CHECK( q.pop() == &a );
+    CHECK( !q.pop() );
+}
+
+#endif
@@ -0,0 +1,77 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// kw_hash.h
+
+#ifndef KW_HASH_H
+#define KW_HASH_H
+
+// Case insensitive keyword hashing for fixed sets of protocol keywords
+// such as header field names and commands.
+//
+// kw_hash() is constexpr, so the slot of each keyword can be used as a
+// case label:
+//
+//     switch ( kw_slot(name, len, SEED, SLOTS) )
+//     {
+//     case KW_SLOT("Via", SEED, SLOTS): ...
+//     }
+//
+// The compiler rejects duplicate case labels, so a seed that isn't perfect
+// for the keyword set fails to build instead of silently colliding.  Pick
+// the seed offline by trying values until the build is clean.  Slots must
+// be a power of 2; keeping it small lets the switch become a jump table.
+//
+// Case is folded with | 0x20 which also aliases some punctuation, so the
+// matched keyword must still be compared with strncasecmp().
+
+#include <cstdint>
+
+#define KW_HASH_PRIME 16777619u
+
+constexpr uint32_t kw_hash_fold(const char* s, unsigned n, uint32_t h)
+{
+    return n ? kw_hash_fold(s + 1, n - 1, (h ^ (uint8_t)(*s | 0x20)) * KW_HASH_PRIME) : h;
+}
+
+constexpr uint32_t kw_hash_mix3(uint32_t h)
+{ return h ^ (h >> 16); }
+
+constexpr uint32_t kw_hash_mix2(uint32_t h)
+{ return kw_hash_mix3((h ^ (h >> 13)) * 0xc2b2ae35u); }
+
+constexpr uint32_t kw_hash_mix1(uint32_t h)
+{ return kw_hash_mix2((h ^ (h >> 16)) * 0x85ebca6bu); }
+
+constexpr uint32_t kw_hash(const char* s, unsigned n, uint32_t seed)
+{ return kw_hash_mix1(kw_hash_fold(s, n, seed)); }
+
+#define KW_SLOT(s, seed, slots) (kw_hash(s, sizeof(s) - 1, seed) & ((slots) - 1))
+
+// runtime version of the above without the recursion
+inline unsigned kw_slot(const char* s, unsigned n, uint32_t seed, unsigned slots)
+{
+    uint32_t h = seed;
+
+    for ( unsigned i = 0; i < n; ++i )
+        h = (h ^ (uint8_t)(s[i] | 0x20)) * KW_HASH_PRIME;
+
+    return kw_hash_mix1(h) & (slots - 1);
+}
+
+#endif
+
@@ -32,6 +32,7 @@
 // using a void* for data
 
 // FIXIT-M but we are going to delete sflsq and use STL instead
+// packet path users should use the intrusive lists in intrusive_list.h
 
 // Note that NODE_DATA can be redefined with the typedef below
 typedef void* NODE_DATA;
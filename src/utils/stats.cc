@@ -28,6 +28,7 @@
 #include "helpers/process.h"
 #include "packet_io/sfdaq.h"
 #include "packet_io/active.h"
+#include "packet_io/pcap_bench.h"
 #include "packet_io/trough.h"
 #include "target_based/sftarget_reader.h"
 #include "managers/module_manager.h"
@@ -35,6 +36,7 @@
 #include "protocols/packet_manager.h"
 #include "detection/fp_create.h"
 #include "filters/sfthreshold.h"
+#include "hash/hash_stats.h"
 #include "profiler/profiler.h"
 #include "time/timersub.h"
 #include "file_api/file_stats.h"
@@ -183,6 +185,9 @@ const PegInfo daq_names[] =
     { "internal whitelist", "packets whitelisted internally due to lack of DAQ support" },
     { "skipped", "packets skipped at startup" },
     { "idle", "attempts to acquire from DAQ without available packets" },
+    { "response drops", "active response packets not injected due to burst limit" },
+    { "prefiltered", "packets whitelisted by the port prefilter" },
+    { "prefiltered bytes", "bytes whitelisted by the port prefilter" },
     { nullptr, nullptr }
 };
 
@@ -276,6 +281,9 @@ void get_daq_stats(DAQStats& daq_stats)
     daq_stats.internal_whitelist = gaux.internal_whitelist;
     daq_stats.skipped = snort_conf->pkt_skip;
     daq_stats.idle = gaux.idle;
+    daq_stats.response_drops = gaux.response_drops;
+    daq_stats.prefiltered = gaux.prefiltered;
+    daq_stats.prefiltered_bytes = gaux.prefiltered_bytes;
 }
 
 void DropStats()
@@ -319,6 +327,8 @@ void PrintStatistics()
 {
     DropStats();
     timing_stats();
+    PcapBench::show_stats();
+    show_hash_stats();
 
     // FIXIT-L below stats need to be made consistent with above
     fpShowEventStats(snort_conf);
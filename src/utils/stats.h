@@ -76,6 +76,9 @@ struct AuxCount
     PegCount internal_blacklist;
     PegCount internal_whitelist;
     PegCount idle;
+    PegCount response_drops;
+    PegCount prefiltered;
+    PegCount prefiltered_bytes;
 };
 
 //-------------------------------------------------------------------------
@@ -100,6 +103,9 @@ struct DAQStats
     PegCount internal_whitelist;
     PegCount skipped;
     PegCount idle;
+    PegCount response_drops;
+    PegCount prefiltered;
+    PegCount prefiltered_bytes;
 };
 
 extern ProcessCount proc_stats;
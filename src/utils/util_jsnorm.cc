@@ -24,6 +24,11 @@
 #include <string.h>
 #include "main/thread.h"
 
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#define JSNORM_SIMD
+#endif
+
 #define INVALID_HEX_VAL -1
 #define MAX_BUF 8
 #define NON_ASCII_CHAR 0xff
@@ -1213,6 +1218,67 @@ static int JSNorm_scan_fsm(JSNormState* s, int c, char* src, uint16_t srclen, ch
     return(JSNorm_exec(s, (ActionJSNorm)m->action, c, src, srclen, ptr, js));
 }
 
+// in the start state only u, s, d, < and white space do anything but copy
+// themselves, so find the next one and copy the run up to it at once.
+static inline bool JSNormTrigger(char c)
+{
+    switch (toupper(c))
+    {
+    case 'U':
+    case 'S':
+    case 'D':
+    case '<':
+        return true;
+    }
+    return isspace(c) != 0;
+}
+
+static const char* JSNormFindTrigger(const char* p, const char* end)
+{
+#ifdef JSNORM_SIMD
+    const __m128i lower = _mm_set1_epi8(0x20);
+
+    while (end - p >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i l = _mm_or_si128(v, lower);
+
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(l, _mm_set1_epi8('u')),
+                _mm_cmpeq_epi8(l, _mm_set1_epi8('s'))),
+            _mm_or_si128(_mm_cmpeq_epi8(l, _mm_set1_epi8('d')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('<'))));
+
+        // space or \t through \r
+        __m128i w = _mm_sub_epi8(v, _mm_set1_epi8(9));
+        m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+            _mm_cmpeq_epi8(_mm_min_epu8(w, _mm_set1_epi8(4)), w)));
+
+        if (unsigned bits = _mm_movemask_epi8(m))
+            return p + __builtin_ctz(bits);
+
+        p += 16;
+    }
+#endif
+    while ((p < end) && !JSNormTrigger(*p))
+        p++;
+
+    return p;
+}
+
+static void JSNormCopyRun(JSNormState* s, char** ptr, const char* end, JSState* js)
+{
+    const char* run = *ptr;
+    const char* stop = JSNormFindTrigger(run, end);
+
+    if (stop == run)
+        return;
+
+    WriteJSNorm(s, (char*)run, stop - run, js);
+    s->prev_event = stop[-1];
+    *ptr = (char*)stop;
+}
+
 int JSNormalizeDecode(char* src, uint16_t srclen, char* dst, uint16_t destlen, char** ptr,
     int* bytes_copied, JSState* js, uint8_t* iis_unicode_map)
 {
@@ -1239,6 +1305,13 @@ int JSNormalizeDecode(char* src, uint16_t srclen, char* dst, uint16_t destlen, c
 
     while (!outBounds(start, end, *ptr))
     {
+        if (s.fsm == 0)
+        {
+            JSNormCopyRun(&s, ptr, end, js);
+
+            if (outBounds(start, end, *ptr))
+                break;
+        }
         iRet = JSNorm_scan_fsm(&s, **ptr, src, srclen, ptr, js);
         if (iRet != RET_OK)
         {
@@ -0,0 +1,380 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// util_scan.cc
+//
+// sse2 is part of x86_64 so it needs no check; avx2 is picked at first use
+// if the cpu has it.  other targets get the scalar loop.
+
+#include "util_scan.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SCAN_SIMD
+#endif
+
+#ifdef UNIT_TEST
+#include <random>
+#include <string>
+
+#include "catch/catch.hpp"
+#endif
+
+typedef const uint8_t* (* scan_f)(const uint8_t*, const uint8_t*, const char*, unsigned);
+
+static const uint8_t* scan_any_scalar(
+    const uint8_t* p, const uint8_t* end, const char* set, unsigned n)
+{
+    for ( ; p < end; ++p )
+    {
+        for ( unsigned i = 0; i < n; ++i )
+        {
+            if ( *p == (uint8_t)set[i] )
+                return p;
+        }
+    }
+    return nullptr;
+}
+
+#ifdef SCAN_SIMD
+// unused set slots repeat set[0] so they never add a match
+static const uint8_t* scan_any_sse2(
+    const uint8_t* p, const uint8_t* end, const char* set, unsigned n)
+{
+    __m128i c0 = _mm_set1_epi8(set[0]);
+    __m128i c1 = _mm_set1_epi8(set[n > 1 ? 1 : 0]);
+    __m128i c2 = _mm_set1_epi8(set[n > 2 ? 2 : 0]);
+    __m128i c3 = _mm_set1_epi8(set[n > 3 ? 3 : 0]);
+
+    while ( end - p >= 16 )
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, c0), _mm_cmpeq_epi8(v, c1)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, c2), _mm_cmpeq_epi8(v, c3)));
+
+        if ( unsigned bits = _mm_movemask_epi8(m) )
+            return p + __builtin_ctz(bits);
+
+        p += 16;
+    }
+    return scan_any_scalar(p, end, set, n);
+}
+
+__attribute__((target("avx2")))
+static const uint8_t* scan_any_avx2(
+    const uint8_t* p, const uint8_t* end, const char* set, unsigned n)
+{
+    __m256i c0 = _mm256_set1_epi8(set[0]);
+    __m256i c1 = _mm256_set1_epi8(set[n > 1 ? 1 : 0]);
+    __m256i c2 = _mm256_set1_epi8(set[n > 2 ? 2 : 0]);
+    __m256i c3 = _mm256_set1_epi8(set[n > 3 ? 3 : 0]);
+
+    while ( end - p >= 32 )
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        __m256i m = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, c0), _mm256_cmpeq_epi8(v, c1)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, c2), _mm256_cmpeq_epi8(v, c3)));
+
+        if ( unsigned bits = _mm256_movemask_epi8(m) )
+            return p + __builtin_ctz(bits);
+
+        p += 32;
+    }
+    return scan_any_sse2(p, end, set, n);
+}
+#endif
+
+static const uint8_t* scan_any_init(
+    const uint8_t* p, const uint8_t* end, const char* set, unsigned n);
+
+// every thread resolves to the same function so the race is benign
+static scan_f scan_any_impl = scan_any_init;
+
+static const uint8_t* scan_any_init(
+    const uint8_t* p, const uint8_t* end, const char* set, unsigned n)
+{
+#ifdef SCAN_SIMD
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports("avx2") )
+        scan_any_impl = scan_any_avx2;
+    else
+        scan_any_impl = scan_any_sse2;
+#else
+    scan_any_impl = scan_any_scalar;
+#endif
+    return scan_any_impl(p, end, set, n);
+}
+
+const uint8_t* scan_any(const uint8_t* p, const uint8_t* end, const char* set, unsigned n)
+{
+    assert(n >= 1 and n <= 4);
+    return scan_any_impl(p, end, set, n);
+}
+
+const uint8_t* scan_crlfcrlf(const uint8_t* p, const uint8_t* end)
+{
+    while ( end - p >= 4 )
+    {
+        const uint8_t* cr = (const uint8_t*)memchr(p, '\r', end - p - 3);
+
+        if ( !cr )
+            break;
+
+        if ( cr[1] == '\n' and cr[2] == '\r' and cr[3] == '\n' )
+            return cr;
+
+        p = cr + 1;
+    }
+    return nullptr;
+}
+
+//--------------------------------------------------------------------------
+// substring search
+//
+// candidates are the positions where both the first and last pattern bytes
+// match, found a vector at a time; only those are compared in full.  for
+// nocase the filter ors in 0x20 where the pattern byte is a letter, which
+// folds exactly the two cases of that letter.
+//--------------------------------------------------------------------------
+
+typedef const uint8_t* (* find_f)(const uint8_t*, const uint8_t*, const uint8_t*, unsigned, bool);
+
+static inline uint8_t fold_mask(uint8_t c, bool nocase)
+{ return (nocase and isalpha(c)) ? 0x20 : 0; }
+
+static inline bool same(const uint8_t* p, const uint8_t* pat, unsigned n, bool nocase)
+{
+    if ( !nocase )
+        return !memcmp(p, pat, n);
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        if ( toupper(p[i]) != toupper(pat[i]) )
+            return false;
+    }
+    return true;
+}
+
+static const uint8_t* find_scalar(
+    const uint8_t* p, const uint8_t* end, const uint8_t* pat, unsigned n, bool nocase)
+{
+    uint8_t mf = fold_mask(pat[0], nocase);
+    uint8_t first = pat[0] | mf;
+
+    for ( ; end - p >= (long)n; ++p )
+    {
+        if ( (*p | mf) == first and same(p + 1, pat + 1, n - 1, nocase) )
+            return p;
+    }
+    return nullptr;
+}
+
+#ifdef SCAN_SIMD
+static const uint8_t* find_sse2(
+    const uint8_t* p, const uint8_t* end, const uint8_t* pat, unsigned n, bool nocase)
+{
+    uint8_t ff = fold_mask(pat[0], nocase);
+    uint8_t lf = fold_mask(pat[n - 1], nocase);
+
+    __m128i mf = _mm_set1_epi8(ff);
+    __m128i ml = _mm_set1_epi8(lf);
+    __m128i vf = _mm_set1_epi8(pat[0] | ff);
+    __m128i vl = _mm_set1_epi8(pat[n - 1] | lf);
+
+    // the last lane's last byte must be in bounds
+    while ( end - p >= (long)(n + 15) )
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)p);
+        __m128i b = _mm_loadu_si128((const __m128i*)(p + n - 1));
+        __m128i m = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_or_si128(a, mf), vf),
+            _mm_cmpeq_epi8(_mm_or_si128(b, ml), vl));
+
+        unsigned bits = _mm_movemask_epi8(m);
+
+        while ( bits )
+        {
+            unsigned i = __builtin_ctz(bits);
+
+            if ( n <= 2 or same(p + i + 1, pat + 1, n - 2, nocase) )
+                return p + i;
+
+            bits &= bits - 1;
+        }
+        p += 16;
+    }
+    return find_scalar(p, end, pat, n, nocase);
+}
+
+__attribute__((target("avx2")))
+static const uint8_t* find_avx2(
+    const uint8_t* p, const uint8_t* end, const uint8_t* pat, unsigned n, bool nocase)
+{
+    uint8_t ff = fold_mask(pat[0], nocase);
+    uint8_t lf = fold_mask(pat[n - 1], nocase);
+
+    __m256i mf = _mm256_set1_epi8(ff);
+    __m256i ml = _mm256_set1_epi8(lf);
+    __m256i vf = _mm256_set1_epi8(pat[0] | ff);
+    __m256i vl = _mm256_set1_epi8(pat[n - 1] | lf);
+
+    while ( end - p >= (long)(n + 31) )
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)p);
+        __m256i b = _mm256_loadu_si256((const __m256i*)(p + n - 1));
+        __m256i m = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_or_si256(a, mf), vf),
+            _mm256_cmpeq_epi8(_mm256_or_si256(b, ml), vl));
+
+        unsigned bits = _mm256_movemask_epi8(m);
+
+        while ( bits )
+        {
+            unsigned i = __builtin_ctz(bits);
+
+            if ( n <= 2 or same(p + i + 1, pat + 1, n - 2, nocase) )
+                return p + i;
+
+            bits &= bits - 1;
+        }
+        p += 32;
+    }
+    return find_sse2(p, end, pat, n, nocase);
+}
+#endif
+
+static const uint8_t* find_init(
+    const uint8_t* p, const uint8_t* end, const uint8_t* pat, unsigned n, bool nocase);
+
+static find_f find_impl = find_init;
+
+static const uint8_t* find_init(
+    const uint8_t* p, const uint8_t* end, const uint8_t* pat, unsigned n, bool nocase)
+{
+#ifdef SCAN_SIMD
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports("avx2") )
+        find_impl = find_avx2;
+    else
+        find_impl = find_sse2;
+#else
+    find_impl = find_scalar;
+#endif
+    return find_impl(p, end, pat, n, nocase);
+}
+
+const uint8_t* scan_find(
+    const uint8_t* p, const uint8_t* end, const uint8_t* pat, unsigned n, bool nocase)
+{
+    if ( !n or end - p < (long)n )
+        return nullptr;
+
+    if ( n == 1 and !fold_mask(pat[0], nocase) )
+        return (const uint8_t*)memchr(p, pat[0], end - p);
+
+    return find_impl(p, end, pat, n, nocase);
+}
+
+#ifdef UNIT_TEST
+
+static const uint8_t* find_naive(
+    const uint8_t* p, const uint8_t* end, const uint8_t* pat, unsigned n, bool nocase)
+{
+    for ( ; end - p >= (long)n; ++p )
+        if ( same(p, pat, n, nocase) )
+            return p;
+
+    return nullptr;
+}
+
+TEST_CASE( "scan find", "[scan]" )
+{
+    const std::string s = "the Quick brown fox jumps over the lazy dog, QUICKLY";
+    const uint8_t* p = (const uint8_t*)s.c_str();
+    const uint8_t* end = p + s.size();
+
+    SECTION( "case" )
+    {
+        CHECK( scan_find(p, end, (const uint8_t*)"Quick", 5, false) == p + 4 );
+        CHECK( scan_find(p, end, (const uint8_t*)"QUICK", 5, false) == p + 45 );
+        CHECK( scan_find(p, end, (const uint8_t*)"quick", 5, false) == nullptr );
+        CHECK( scan_find(p, end, (const uint8_t*)"t", 1, false) == p );
+        CHECK( scan_find(p, end, (const uint8_t*)"LY", 2, false) == end - 2 );
+        CHECK( scan_find(p, end, (const uint8_t*)"LYX", 3, false) == nullptr );
+    }
+
+    SECTION( "nocase" )
+    {
+        CHECK( scan_find(p, end, (const uint8_t*)"QUICK", 5, true) == p + 4 );
+        CHECK( scan_find(p, end, (const uint8_t*)"DOG,", 4, true) == p + 40 );
+        CHECK( scan_find(p, end, (const uint8_t*)"Q", 1, true) == p + 4 );
+        CHECK( scan_find(p, end, (const uint8_t*)",", 1, true) == p + 43 );
+    }
+
+    SECTION( "bounds" )
+    {
+        CHECK( scan_find(p, p + 3, (const uint8_t*)"the ", 4, false) == nullptr );
+        CHECK( scan_find(p, p, (const uint8_t*)"t", 1, false) == nullptr );
+        CHECK( scan_find(p, end, (const uint8_t*)"", 0, false) == nullptr );
+    }
+
+    SECTION( "random" )
+    {
+        // a small alphabet mixing letters with bytes that fold onto them
+        const uint8_t alpha[] = { 'a', 'A', 'b', 'B', '@', '`', '{', '[', 0, 0xe1 };
+        std::mt19937 gen(7);
+        bool ok = true;
+
+        for ( unsigned t = 0; t < 2000; ++t )
+        {
+            uint8_t buf[200], pat[24];
+            unsigned len = gen() % sizeof(buf);
+            unsigned n = 1 + gen() % sizeof(pat);
+
+            for ( unsigned i = 0; i < len; ++i )
+                buf[i] = alpha[gen() % sizeof(alpha)];
+
+            for ( unsigned i = 0; i < n; ++i )
+                pat[i] = alpha[gen() % 4];
+
+            // plant a copy sometimes
+            if ( len > n and gen() % 2 )
+                memcpy(buf + gen() % (len - n), pat, n);
+
+            for ( bool nocase : { false, true } )
+            {
+                auto x = find_naive(buf, buf + len, pat, n, nocase);
+                ok = ok and scan_find(buf, buf + len, pat, n, nocase) == x;
+                ok = ok and find_scalar(buf, buf + len, pat, n, nocase) == x;
+#ifdef SCAN_SIMD
+                ok = ok and find_sse2(buf, buf + len, pat, n, nocase) == x;
+#endif
+            }
+        }
+        CHECK( ok );
+    }
+}
+
+#endif
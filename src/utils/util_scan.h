@@ -0,0 +1,45 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// util_scan.h
+
+#ifndef UTIL_SCAN_H
+#define UTIL_SCAN_H
+
+// delimiter and substring scanning.  these return a pointer to the first
+// matching byte in [p, end) or nullptr.  for a single byte use memchr().
+
+#include "main/snort_types.h"
+
+// first byte that is any of set[0 .. n-1]; n must be 1 to 4
+SO_PUBLIC const uint8_t* scan_any(const uint8_t* p, const uint8_t* end, const char* set, unsigned n);
+
+// first \r or \n
+inline const uint8_t* scan_eol(const uint8_t* p, const uint8_t* end)
+{ return scan_any(p, end, "\r\n", 2); }
+
+// start of the first \r\n\r\n
+SO_PUBLIC const uint8_t* scan_crlfcrlf(const uint8_t* p, const uint8_t* end);
+
+// start of the first occurrence of pat[0 .. n-1], ignoring ascii case if
+// nocase.  uses a simd first / last byte filter so it is best for short
+// patterns; Boyer-Moore may win for long ones.
+SO_PUBLIC const uint8_t* scan_find(
+    const uint8_t* p, const uint8_t* end, const uint8_t* pat, unsigned n, bool nocase = false);
+
+#endif
+
@@ -23,6 +23,16 @@
 
 #include <stdlib.h>
 
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#define UTF_SIMD
+#endif
+
+#ifdef UNIT_TEST
+#include <string.h>
+#include "catch/catch.hpp"
+#endif
+
 #define DSTATE_FIRST 0
 #define DSTATE_SECOND 1
 #define DSTATE_THIRD 2
@@ -73,6 +83,67 @@ int get_decode_utf_state_charset(decode_utf_state_t* dstate)
     return dstate->charset;
 }
 
+/* Narrow whole code units 16 at a time while there is room in src and dst.
+ * Only called at a unit boundary (DSTATE_FIRST).  keep is the index of the
+ * byte copied out of each unit of width bytes; the others fail the decode
+ * under the same (signed) test as the byte at a time loops below, so a pure
+ * ascii span costs one compare per vector.  The rest is left for the caller.
+ */
+#ifdef UTF_SIMD
+static inline __m128i keep_byte(__m128i v, unsigned width, unsigned keep)
+{
+    if ( width == 2 )
+        return keep ? _mm_srli_epi16(v, 8) : _mm_and_si128(v, _mm_set1_epi16(0x00ff));
+
+    return keep ? _mm_srli_epi32(v, 24) : _mm_and_si128(v, _mm_set1_epi32(0x000000ff));
+}
+
+static inline __m128i other_bytes(__m128i v, unsigned width, unsigned keep)
+{
+    if ( width == 2 )
+        return _mm_and_si128(v, _mm_set1_epi16(keep ? 0x00ff : (short)0xff00));
+
+    return _mm_and_si128(v, _mm_set1_epi32(keep ? 0x00ffffff : (int)0xffffff00));
+}
+#endif
+
+static void narrow(
+    char*& src, char* src_end, char*& dst, char* dst_end,
+    unsigned width, unsigned keep, int& result)
+{
+#ifdef UTF_SIMD
+    const __m128i zero = _mm_setzero_si128();
+    const unsigned src_blk = 16 * width;
+    __m128i bad = zero;
+
+    while ( src_end - src >= (long)src_blk and dst_end - dst >= 16 )
+    {
+        __m128i v[4];
+
+        for ( unsigned i = 0; i < width; ++i )
+        {
+            __m128i in = _mm_loadu_si128((const __m128i*)(src + 16 * i));
+            bad = _mm_or_si128(bad, _mm_cmpgt_epi8(other_bytes(in, width, keep), zero));
+            v[i] = keep_byte(in, width, keep);
+        }
+
+        __m128i out = (width == 2) ?
+            _mm_packus_epi16(v[0], v[1]) :
+            _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+
+        _mm_storeu_si128((__m128i*)dst, out);
+        src += src_blk;
+        dst += 16;
+    }
+
+    if ( _mm_movemask_epi8(bad) )
+        result = DECODE_UTF_FAILURE;
+#else
+    (void)src; (void)src_end; (void)dst; (void)dst_end;
+    (void)width; (void)keep; (void)result;
+#endif
+}
+
 /* Decode UTF-16le from src to dst.
  *
  * src          => buffer containing utf-16le text
@@ -96,6 +167,9 @@ static int DecodeUTF16LE(char* src, unsigned int src_len, char* dst, unsigned in
         dst_len == 0)
         return DECODE_UTF_FAILURE;
 
+    if (dstate->state == DSTATE_FIRST)
+        narrow(src_index, src + src_len, dst_index, dst + dst_len, 2, 0, result);
+
     while ((src_index < (char*)(src + src_len)) &&
         (dst_index < (char*)(dst + dst_len)))
     {
@@ -144,6 +218,9 @@ static int DecodeUTF16BE(char* src, unsigned int src_len, char* dst, unsigned in
         dst_len == 0)
         return DECODE_UTF_FAILURE;
 
+    if (dstate->state == DSTATE_FIRST)
+        narrow(src_index, src + src_len, dst_index, dst + dst_len, 2, 1, result);
+
     while ((src_index < (char*)(src + src_len)) &&
         (dst_index < (char*)(dst + dst_len)))
     {
@@ -192,6 +269,9 @@ static int DecodeUTF32LE(char* src, unsigned int src_len, char* dst, unsigned in
         dst_len == 0)
         return DECODE_UTF_FAILURE;
 
+    if (dstate->state == DSTATE_FIRST)
+        narrow(src_index, src + src_len, dst_index, dst + dst_len, 4, 0, result);
+
     while ((src_index < (char*)(src + src_len)) &&
         (dst_index < (char*)(dst + dst_len)))
     {
@@ -245,6 +325,9 @@ static int DecodeUTF32BE(char* src, unsigned int src_len, char* dst, unsigned in
         dst_len == 0)
         return DECODE_UTF_FAILURE;
 
+    if (dstate->state == DSTATE_FIRST)
+        narrow(src_index, src + src_len, dst_index, dst + dst_len, 4, 3, result);
+
     while ((src_index < (char*)(src + src_len)) &&
         (dst_index < (char*)(dst + dst_len)))
     {
@@ -297,3 +380,79 @@ int DecodeUTF(
     return DECODE_UTF_FAILURE;
 }
 
+
+#ifdef UNIT_TEST
+
+static void check_decode(int charset, unsigned width, unsigned keep, unsigned len, unsigned split)
+{
+    char src[256], dst[256], exp[256];
+    bool ok = true;
+
+    for ( unsigned i = 0; i < len; ++i )
+        src[i] = (i % width == keep) ? (char)('A' + i % 26) : 0;
+
+    // one unit near the end carries a bad byte and another a high (ignored) one
+    if ( len > 100 )
+    {
+        src[(len / width - 3) * width + (keep + 1) % width] = 1;
+        src[5 * width + (keep + 1) % width] = (char)0x80;
+        ok = false;
+    }
+
+    unsigned n = 0;
+    for ( unsigned i = keep; i < len; i += width )
+        exp[n++] = src[i];
+
+    decode_utf_state_t ds;
+    init_decode_utf_state(&ds);
+    set_decode_utf_state_charset(&ds, charset);
+
+    int r = DECODE_UTF_SUCCESS, copied, total = 0;
+
+    for ( unsigned i = 0; i < len; i += split )
+    {
+        unsigned k = (len - i < split) ? len - i : split;
+
+        if ( DecodeUTF(src + i, k, dst + total, sizeof(dst) - total, &copied, &ds) )
+            r = DECODE_UTF_FAILURE;
+
+        total += copied;
+    }
+    CHECK((r == DECODE_UTF_SUCCESS) == ok);
+    CHECK(total == (int)n);
+    CHECK(!memcmp(dst, exp, n));
+}
+
+TEST_CASE("decode utf", "[utf]")
+{
+    const int charsets[] = { CHARSET_UTF16LE, CHARSET_UTF16BE, CHARSET_UTF32LE, CHARSET_UTF32BE };
+    const unsigned widths[] = { 2, 2, 4, 4 };
+    const unsigned keeps[] = { 0, 1, 0, 3 };
+
+    for ( unsigned c = 0; c < 4; ++c )
+    {
+        for ( unsigned split : { 1u, 3u, 17u, 33u, 256u } )
+        {
+            check_decode(charsets[c], widths[c], keeps[c], 60, split);
+            check_decode(charsets[c], widths[c], keeps[c], 256, split);
+        }
+    }
+}
+
+TEST_CASE("decode utf short dst", "[utf]")
+{
+    char src[64] = { }, dst[64];
+    decode_utf_state_t ds;
+
+    init_decode_utf_state(&ds);
+    set_decode_utf_state_charset(&ds, CHARSET_UTF16LE);
+
+    for ( unsigned i = 0; i < sizeof(src); i += 2 )
+        src[i] = 'x';
+
+    int copied;
+    CHECK(DecodeUTF(src, sizeof(src), dst, 20, &copied, &ds) == DECODE_UTF_SUCCESS);
+    CHECK(copied == 20);
+}
+
+#endif
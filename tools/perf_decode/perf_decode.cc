@@ -0,0 +1,243 @@
+//--------------------------------------------------------------------------
+// Copyright (C) 2016-2016 Cisco and/or its affiliates. All rights reserved.
+//
+// This program is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License Version 2 as published
+// by the Free Software Foundation.  You may not use, modify or distribute
+// this program under any other version of the GNU General Public License.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//--------------------------------------------------------------------------
+// perf_decode.cc
+
+// convert perf_monitor binary output to the same CSV that perf_monitor
+// writes with format = 'csv'.  see binary_formatter.h for the layout.
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#define PERF_BIN_MAGIC "SNPERFBN"
+#define PERF_BIN_VERSION 1
+
+// must match FormatterType
+enum FieldType : uint8_t
+{
+    FT_PEG_COUNT,
+    FT_STRING,
+    FT_IDX_PEG_COUNT
+};
+
+struct Field
+{
+    FieldType type;
+    std::string name;
+};
+
+template <typename T>
+static bool get(FILE* fh, T& v)
+{ return fread(&v, sizeof(v), 1, fh) == 1; }
+
+static bool read_schema(FILE* fh, std::vector<Field>& fields)
+{
+    uint32_t version, num;
+
+    if ( !get(fh, version) or !get(fh, num) )
+        return false;
+
+    if ( version != PERF_BIN_VERSION )
+    {
+        fprintf(stderr, "unsupported version %u\n", version);
+        return false;
+    }
+
+    fields.clear();
+
+    for ( uint32_t i = 0; i < num; ++i )
+    {
+        Field f;
+        uint16_t len;
+
+        if ( !get(fh, f.type) or !get(fh, len) )
+            return false;
+
+        f.name.resize(len);
+
+        if ( len and fread(&f.name[0], len, 1, fh) != 1 )
+            return false;
+
+        fields.push_back(f);
+    }
+
+    printf("#timestamp");
+
+    for ( auto& f : fields )
+        printf(",%s", f.name.c_str());
+
+    printf("\n");
+    return true;
+}
+
+template <typename T>
+static bool take(const std::vector<uint8_t>& rec, size_t& off, T& v)
+{
+    if ( off + sizeof(v) > rec.size() )
+        return false;
+
+    memcpy(&v, &rec[off], sizeof(v));
+    off += sizeof(v);
+    return true;
+}
+
+static bool print_record(const std::vector<uint8_t>& rec, const std::vector<Field>& fields)
+{
+    size_t off = 0;
+    uint64_t ts;
+
+    if ( !take(rec, off, ts) )
+        return false;
+
+    // peg counts are up front so get the offset of the variable part
+    size_t var = off;
+
+    for ( auto& f : fields )
+        if ( f.type == FT_PEG_COUNT )
+            var += sizeof(uint64_t);
+
+    if ( var > rec.size() )
+        return false;
+
+    printf("%" PRIu64, ts);
+
+    for ( auto& f : fields )
+    {
+        switch ( f.type )
+        {
+        case FT_PEG_COUNT:
+        {
+            uint64_t pc = 0;
+            take(rec, off, pc);
+            printf(",%" PRIu64, pc);
+            break;
+        }
+        case FT_STRING:
+        {
+            uint16_t len;
+
+            if ( !take(rec, var, len) or var + len > rec.size() )
+                return false;
+
+            printf(",%.*s", (int)len, (const char*)&rec[var]);
+            var += len;
+            break;
+        }
+        case FT_IDX_PEG_COUNT:
+        {
+            uint32_t count;
+
+            if ( !take(rec, var, count) )
+                return false;
+
+            printf(",%u", count);
+
+            for ( uint32_t i = 0; i < count; ++i )
+            {
+                uint32_t idx;
+                uint64_t pc;
+
+                if ( !take(rec, var, idx) or !take(rec, var, pc) )
+                    return false;
+
+                printf(",%" PRIu64, pc);
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    printf("\n");
+    return true;
+}
+
+static int decode(FILE* fh)
+{
+    std::vector<Field> fields;
+    std::vector<uint8_t> rec;
+    bool have_schema = false;
+    char magic[8];
+
+    // a schema is written each time the file is opened, including appends
+    while ( fread(magic, 4, 1, fh) == 1 )
+    {
+        if ( !memcmp(magic, PERF_BIN_MAGIC, 4) )
+        {
+            if ( fread(magic + 4, 4, 1, fh) != 1 or memcmp(magic, PERF_BIN_MAGIC, 8) )
+                break;
+
+            if ( !(have_schema = read_schema(fh, fields)) )
+                break;
+
+            continue;
+        }
+
+        if ( !have_schema )
+            break;
+
+        uint32_t len;
+        memcpy(&len, magic, sizeof(len));
+        rec.resize(len);
+
+        if ( len and fread(&rec[0], len, 1, fh) != 1 )
+        {
+            fprintf(stderr, "truncated record\n");
+            return 1;
+        }
+
+        if ( !print_record(rec, fields) )
+        {
+            fprintf(stderr, "bad record\n");
+            return 1;
+        }
+    }
+
+    if ( !feof(fh) )
+    {
+        fprintf(stderr, "not a perf_monitor binary file\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if ( argc != 2 )
+    {
+        fprintf(stderr, "usage: %s <perf_monitor binary file>\n", argv[0]);
+        return 1;
+    }
+
+    FILE* fh = fopen(argv[1], "rb");
+
+    if ( !fh )
+    {
+        fprintf(stderr, "can't open %s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+
+    int ret = decode(fh);
+    fclose(fh);
+    return ret;
+}
+
@@ -32,6 +32,9 @@
 #include <arpa/inet.h>
 #include <pcap.h>
 
+#include <string>
+#include <thread>
+
 #define FAILURE -1
 #define SUCCESS 0
 
@@ -41,66 +44,72 @@
 #define PCAP_SNAPLEN 65535
 #define ETHERNET 1
 #define PCAP_LINKTYPE ETHERNET
-#define MAX_U2RECORD_DATA_LENGTH 65536
 
-static int GetRecord(FILE* input, u2record* rec);
+/* on disk pcap record header; struct pcap_pkthdr is bigger on 64 bit */
+struct PcapRecordHdr
+{
+    uint32_t sec;
+    uint32_t usec;
+    uint32_t caplen;
+    uint32_t len;
+};
+
 static int PcapInitOutput(FILE* output);
-static int PcapConversion(u2record* rec, FILE* output);
+static void PcapConversion(const u2file*, size_t first, size_t last, std::string& out);
 
-static int ConvertLog(FILE* input, FILE* output, const char* format)
+static int ConvertLog(u2file* input, FILE* output, const char* format, unsigned threads)
 {
-    u2record tmp_record;
-
     /* Determine conversion function */
-    int (* ConvertRecord)(u2record*, FILE*) = NULL;
+    u2convert ConvertRange = NULL;
 
     /* This will become an if/else series once more formats are supported.
      * Callbacks are used so that this comparison only needs to happen once. */
     if (strncasecmp(format, "pcap", 4) == 0)
     {
-        ConvertRecord = PcapConversion;
+        ConvertRange = PcapConversion;
     }
 
-    if (ConvertRecord == NULL)
+    if (ConvertRange == NULL)
     {
         fprintf(stderr, "Error setting conversion routine, aborting...\n");
         return FAILURE;
     }
 
-    /* Initialize the record's data pointer */
-    tmp_record.data = (uint8_t*)malloc(MAX_U2RECORD_DATA_LENGTH * sizeof(uint8_t));
-    if (tmp_record.data == NULL)
+    /* One pass over the record headers; the data isn't touched yet */
+    if ( !u2file_index(input) )
+        fprintf(stderr, "Error: incomplete record.\n");
+
+    const u2index* partial = NULL;
+
+    if ( !input->records.empty() &&
+        input->records.back().length < input->records.back().claimed )
     {
-        fprintf(stderr, "Error allocating memory, aborting...\n");
-        return FAILURE;
+        partial = &input->records.back();
+        input->records.pop_back();
     }
 
-    /* Run through input file and convert records */
-    while ( !(feof(input) || ferror(input) || ferror(output)) )
+    /* Initialize the pcap file if there are any packets */
+    for ( const auto& rec : input->records )
     {
-        if (GetRecord(input, &tmp_record) == FAILURE)
-        {
-            break;
-        }
-        if (ConvertRecord(&tmp_record, output) == FAILURE)
+        if ( rec.type == UNIFIED2_PACKET )
         {
+            if (PcapInitOutput(output) == FAILURE)
+                return FAILURE;
             break;
         }
     }
-    if (tmp_record.data != NULL)
-    {
-        free(tmp_record.data);
-        tmp_record.data = NULL;
-    }
-    if (ferror(input))
+
+    /* Convert ranges of records in parallel and write them in order */
+    if ( !u2file_convert(input, threads, ConvertRange, output) )
     {
-        fprintf(stderr, "Error reading input file, aborting...\n");
+        fprintf(stderr, "Error writing output file, aborting...\n");
         return FAILURE;
     }
-    if (ferror(output))
+
+    if ( partial )
     {
-        fprintf(stderr, "Error reading output file, aborting...\n");
-        return FAILURE;
+        fprintf(stderr, "Error: incomplete record. %u of %u bytes read.\n",
+            partial->length, partial->claimed);
     }
 
     return SUCCESS;
@@ -129,107 +138,38 @@ static int PcapInitOutput(FILE* output)
     return SUCCESS;
 }
 
-/* Convert a unified2 packet record to pcap format, then dump */
-static int PcapConversion(u2record* rec, FILE* output)
+/* Convert unified2 packet records to pcap format */
+static void PcapConversion(const u2file* f, size_t first, size_t last, std::string& out)
 {
-    Serial_Unified2Packet packet;
-    struct pcap_pkthdr pcap_hdr;
-    uint32_t* field;
-    uint8_t* pcap_data;
-    static int packet_found = 0;
-
-    /* Ignore IDS Events. We are only interested in Packets. */
-    if (rec->type != UNIFIED2_PACKET)
-    {
-        return SUCCESS;
-    }
+    const unsigned offset = sizeof(Serial_Unified2Packet) - 4;
 
-    /* Initialize the pcap file if this is the first packet */
-    if (!packet_found)
+    for ( size_t i = first; i < last; ++i )
     {
-        if (PcapInitOutput(output) == FAILURE)
-        {
-            return FAILURE;
-        }
-        packet_found = 1;
-    }
+        const u2index& rec = f->records[i];
 
-    /* Fill out the Serial_Unified2Packet */
-    memcpy(&packet, rec->data, sizeof(Serial_Unified2Packet));
+        /* Ignore IDS Events. We are only interested in Packets. */
+        if ( rec.type != UNIFIED2_PACKET || rec.length < offset )
+            continue;
 
-    /* Unified 2 records are always stored in network order.
-     * Convert all fields except packet data to host order */
-    field = (uint32_t*)&packet;
-    while (field < (uint32_t*)packet.packet_data)
-    {
-        *field = ntohl(*field);
-        field++;
-    }
+        /* Unified 2 records are always stored in network order */
+        Serial_Unified2Packet packet;
+        memcpy(&packet, f->base + rec.offset, offset);
 
-    /* Create a pcap packet header */
-    pcap_hdr.ts.tv_sec = packet.packet_second;
-    pcap_hdr.ts.tv_usec = packet.packet_microsecond;
-    pcap_hdr.caplen = packet.packet_length;
-    pcap_hdr.len = packet.packet_length;
+        /* Create a pcap packet header */
+        PcapRecordHdr pcap_hdr;
+        pcap_hdr.sec = ntohl(packet.packet_second);
+        pcap_hdr.usec = ntohl(packet.packet_microsecond);
+        pcap_hdr.len = ntohl(packet.packet_length);
 
-    /* Write to the pcap file */
-    pcap_data = rec->data + sizeof(Serial_Unified2Packet) - 4;
-    pcap_dump( (u_char*)output, &pcap_hdr, (u_char*)pcap_data);
+        /* never read past the record */
+        pcap_hdr.caplen = pcap_hdr.len;
 
-    return SUCCESS;
-}
+        if ( pcap_hdr.caplen > rec.length - offset )
+            pcap_hdr.caplen = rec.length - offset;
 
-/* Retrieve a single unified2 record from input file */
-static int GetRecord(FILE* input, u2record* rec)
-{
-    uint32_t items_read;
-    static uint32_t buffer_size = MAX_U2RECORD_DATA_LENGTH;
-    uint8_t* tmp;
-
-    if (!input || !rec)
-        return FAILURE;
-
-    items_read = fread(rec, sizeof(uint32_t), 2, input);
-    if (items_read != 2)
-    {
-        if ( !feof(input) ) /* Not really an error if at EOF */
-        {
-            fprintf(stderr, "Error: incomplete record.\n");
-        }
-        return FAILURE;
-    }
-    /* Type and Length are stored in network order */
-    rec->type = ntohl(rec->type);
-    rec->length = ntohl(rec->length);
-
-    /* Read in the data portion of the record */
-    if (rec->length > buffer_size)
-    {
-        tmp = (uint8_t*)malloc(rec->length * sizeof(uint8_t));
-        if (tmp == NULL)
-        {
-            fprintf(stderr, "Error: memory allocation failed.\n");
-            return FAILURE;
-        }
-        else
-        {
-            if (rec->data != NULL)
-            {
-                free(rec->data);
-            }
-            rec->data = tmp;
-            buffer_size = rec->length;
-        }
+        out.append((const char*)&pcap_hdr, sizeof(pcap_hdr));
+        out.append((const char*)f->base + rec.offset + offset, pcap_hdr.caplen);
     }
-    items_read = fread(rec->data, sizeof(uint8_t), rec->length, input);
-    if (items_read != rec->length)
-    {
-        fprintf(stderr, "Error: incomplete record. %u of %u bytes read.\n",
-            items_read, rec->length);
-        return FAILURE;
-    }
-
-    return SUCCESS;
 }
 
 int main(int argc, char* argv[])
@@ -238,22 +178,26 @@ int main(int argc, char* argv[])
     char* output_filename = NULL;
     const char* output_type = NULL;
 
-    FILE* input_file = NULL;
+    u2file input_file;
     FILE* output_file = NULL;
+    unsigned threads = std::thread::hardware_concurrency();
 
     int c, errnum;
     opterr = 0;
 
     /* Use Getopt to parse options */
-    while ((c = getopt (argc, argv, "t:")) != -1)
+    while ((c = getopt (argc, argv, "t:j:")) != -1)
     {
         switch (c)
         {
         case 't':
             output_type = optarg;
             break;
+        case 'j':
+            threads = strtoul(optarg, NULL, 0);
+            break;
         case '?':
-            if (optopt == 't')
+            if (optopt == 't' || optopt == 'j')
                 fprintf(stderr,
                     "Option -%c requires an argument.\n", optopt);
             else if (isprint (optopt))
@@ -267,7 +211,7 @@ int main(int argc, char* argv[])
     /* At this point, there should be two filenames remaining. */
     if (optind != (argc - 2))
     {
-        fprintf(stderr, "Usage: u2boat [-t type] <infile> <outfile>\n");
+        fprintf(stderr, "Usage: u2boat [-t type] [-j threads] <infile> <outfile>\n");
         return FAILURE;
     }
 
@@ -297,9 +241,9 @@ int main(int argc, char* argv[])
     }
 
     /* Open the files */
-    if ((input_file = fopen(input_filename, "r")) == NULL)
+    if ((errnum = u2file_open(&input_file, input_filename)) != 0)
     {
-        fprintf(stderr, "Unable to open file: %s\n", input_filename);
+        fprintf(stderr, "Unable to open file: %s: %s\n", input_filename, strerror(errnum));
         return FAILURE;
     }
     if ((output_file = fopen(output_filename, "w")) == NULL)
@@ -308,13 +252,10 @@ int main(int argc, char* argv[])
         return FAILURE;
     }
 
-    ConvertLog(input_file, output_file, output_type);
+    ConvertLog(&input_file, output_file, output_type, threads);
+
+    u2file_close(&input_file);
 
-    if (fclose(input_file) != 0)
-    {
-        errnum = errno;
-        fprintf(stderr, "Error closing input: %s\n", strerror(errnum));
-    }
     if (fclose(output_file) != 0)
     {
         errnum = errno;
@@ -21,8 +21,20 @@
 #ifndef U2BOAT_H
 #define U2BOAT_H
 
+#include <arpa/inet.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <deque>
+#include <future>
+#include <string>
+#include <vector>
+
 #include "log/unified2.h"
 
 struct u2record
@@ -32,12 +44,176 @@ struct u2record
     uint8_t* data;
 };
 
-struct u2iterator
+//-------------------------------------------------------------------------
+// u2file maps a whole unified2 file read only and indexes its records in
+// one quick pass over the record headers.  The records can then be
+// converted in independent ranges on several threads; the output of each
+// range is written in file order.
+//-------------------------------------------------------------------------
+
+struct u2index
 {
-    FILE* file;
-    char* filename;
-    u2record current;
+    size_t offset;     // of the record data
+    uint32_t type;
+    uint32_t length;   // of the data in the file
+    uint32_t claimed;  // length from the record header
 };
 
+struct u2file
+{
+    const uint8_t* base;
+    size_t size;
+    size_t scanned;    // bytes covered by the index
+    std::vector<u2index> records;
+};
+
+// returns the number of bytes to skip after the record data starts;
+// by default that is the claimed length
+typedef size_t (* u2skip)(const u2file*, const u2index&);
+
+// formats records [first, last) into out
+typedef void (* u2convert)(const u2file*, size_t first, size_t last, std::string& out);
+
+// ranges are about this many bytes of input
+#define U2_RANGE_BYTES (4 * 1024 * 1024)
+
+// returns 0 or errno
+inline int u2file_open(u2file* f, const char* name)
+{
+    f->base = nullptr;
+    f->size = f->scanned = 0;
+
+    int fd = open(name, O_RDONLY);
+
+    if ( fd < 0 )
+        return errno;
+
+    struct stat sb;
+
+    if ( fstat(fd, &sb) )
+    {
+        int err = errno;
+        close(fd);
+        return err;
+    }
+
+    if ( sb.st_size > 0 )
+    {
+        void* p = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if ( p == MAP_FAILED )
+        {
+            int err = errno;
+            close(fd);
+            return err;
+        }
+        madvise(p, sb.st_size, MADV_SEQUENTIAL);
+        f->base = (const uint8_t*)p;
+        f->size = sb.st_size;
+    }
+    close(fd);
+    return 0;
+}
+
+inline void u2file_close(u2file* f)
+{
+    if ( f->base )
+        munmap((void*)f->base, f->size);
+
+    f->base = nullptr;
+    f->size = 0;
+    f->records.clear();
+}
+
+// index all records.  returns false if the file ends in a partial record
+// header; a record with partial data is indexed with length < claimed and
+// ends the index.
+inline bool u2file_index(u2file* f, u2skip skip = nullptr)
+{
+    size_t pos = 0;
+
+    while ( pos < f->size )
+    {
+        f->scanned = pos;
+
+        if ( f->size - pos < 2 * sizeof(uint32_t) )
+            return false;
+
+        uint32_t hdr[2];
+        memcpy(hdr, f->base + pos, sizeof(hdr));
+        pos += sizeof(hdr);
+
+        u2index rec;
+        rec.offset = pos;
+        rec.type = ntohl(hdr[0]);
+        rec.claimed = ntohl(hdr[1]);
+
+        size_t avail = f->size - pos;
+        rec.length = (avail < rec.claimed) ? (uint32_t)avail : rec.claimed;
+
+        f->records.push_back(rec);
+
+        if ( rec.length < rec.claimed )
+        {
+            pos = f->size;
+            break;
+        }
+        pos += skip ? skip(f, rec) : rec.claimed;
+    }
+    f->scanned = pos;
+    return true;
+}
+
+inline std::string u2file_range(const u2file* f, u2convert conv, size_t first, size_t last)
+{
+    std::string out;
+    conv(f, first, last, out);
+    return out;
+}
+
+// convert all indexed records on up to threads threads.  returns false
+// if the output can't be written.
+inline bool u2file_convert(const u2file* f, unsigned threads, u2convert conv, FILE* out)
+{
+    std::deque<std::future<std::string>> pending;
+    size_t n = f->records.size();
+    size_t first = 0;
+
+    if ( !threads )
+        threads = 1;
+
+    while ( first < n or !pending.empty() )
+    {
+        // keep a couple of ranges per thread queued so workers don't wait
+        // on the writer
+        while ( first < n and pending.size() < 2 * threads )
+        {
+            size_t last = first;
+            size_t bytes = 0;
+
+            while ( last < n and bytes < U2_RANGE_BYTES )
+                bytes += f->records[last++].length;
+
+            if ( threads == 1 )
+            {
+                std::promise<std::string> p;
+                p.set_value(u2file_range(f, conv, first, last));
+                pending.push_back(p.get_future());
+            }
+            else
+                pending.push_back(std::async(std::launch::async, u2file_range, f, conv, first, last));
+
+            first = last;
+        }
+
+        std::string s = pending.front().get();
+        pending.pop_front();
+
+        if ( !s.empty() and fwrite(s.data(), s.size(), 1, out) != 1 )
+            return false;
+    }
+    return true;
+}
+
 #endif
 
@@ -26,10 +26,13 @@
 #endif
 
 #include <ctype.h>
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -40,128 +43,44 @@
 #include <uuid/uuid.h>
 #endif
 
-static long s_pos = 0, s_off = 0;
+#include <string>
+#include <thread>
 
 #define TO_IP(x) x >> 24, (x >> 16)& 0xff, (x >> 8)& 0xff, x& 0xff
 
-static u2iterator* new_iterator(char* filename)
-{
-    FILE* f = fopen(filename, "rb");
-    u2iterator* ret;
-
-    if (!f)
-    {
-        printf("ERROR: Failed to open file: %s\n\tErrno: %s\n",
-            filename, strerror(errno));
-        return NULL;
-    }
+// records are dumped in ranges on several threads; each appends to its
+// own range's output which is printed in file order
+static thread_local std::string* s_out = nullptr;
 
-    ret = (u2iterator*)malloc(sizeof(u2iterator));
+static void out(const char* fmt, ...) __attribute__((format (printf, 1, 2)));
 
-    if (!ret)
-    {
-        printf("ERROR: Failed to initialize iterator\n");
-        fclose(f);
-        return NULL;
-    }
-
-    ret->file = f;
-    ret->filename = strdup(filename);
-    if (!ret->filename )
-    {
-        printf("ERROR: Failed to initialize iterator for %s\n", filename);
-        free(ret);
-        fclose(f);
-        return NULL;
-    }
-    return ret;
-}
-
-static inline void free_iterator(u2iterator* it)
-{
-    if (it->file)
-        fclose(it->file);
-    if (it->filename)
-        free(it->filename);
-    if (it)
-        free(it);
-}
-
-static bool get_record(u2iterator* it, u2record* record)
+static void out(const char* fmt, ...)
 {
-    uint32_t bytes_read;
-    uint8_t* tmp;
-
-    if (!it || !it->file)
-        return false;
-
-    /* check if the log was rotated */
-    if (feof(it->file))
-    {
-        /* Get next timestamped file? */
-        puts("Hit the EOF .. and this is not being handled yet.");
-        return false;
-    }
+    char buf[1024];
+    va_list ap;
 
-    if ( s_off )
-    {
-        if ( fseek(it->file, s_pos+s_off, SEEK_SET) )
-        {
-            puts("Unable to SEEK on current file .. and this is not being handled yet.");
-            return false;
-        }
-        s_off = 0;
-    }
-
-    /* read type and length */
-    bytes_read = fread(record, 1, sizeof(uint32_t) * 2, it->file);
-    /* But they're in network order! */
-    record->type= ntohl(record->type);
-    record->length= ntohl(record->length);
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
 
-    //if(record->type == UNIFIED2_PACKET) record->length+=4;
-
-    if (bytes_read == 0)
-        /* EOF */
-        return false;
-
-    if (bytes_read != sizeof(uint32_t)*2)
-    {
-        puts("ERROR: Failed to read record metadata.");
-        printf("\tRead %u of %lu bytes\n", bytes_read, (unsigned long)sizeof(uint32_t)*2);
-        return false;
-    }
-
-    s_pos = ftell(it->file);
-
-    tmp = (uint8_t*)realloc(record->data, record->length);
+    if ( n < 0 )
+        return;
 
-    if (!tmp)
+    if ( n < (int)sizeof(buf) )
     {
-        puts("ERROR: Failed to allocate record memory.");
-        free(record->data);
-        record->data = nullptr;
-        return false;
+        s_out->append(buf, n);
+        return;
     }
 
-    record->data = tmp;
-
-    bytes_read = fread(record->data, 1, record->length, it->file);
+    // long extra data
+    size_t at = s_out->size();
+    s_out->resize(at + n + 1);
 
-    if (bytes_read != record->length)
-    {
-        puts("ERROR: Failed to read all record data.");
-        printf("\tRead %u of %u bytes\n", bytes_read, record->length);
-
-        if ( record->type != UNIFIED2_PACKET ||
-            bytes_read < ntohl(((Serial_Unified2Packet*)record->data)->packet_length)
-            )
-            return false;
-
-        clearerr(it->file);
-    }
+    va_start(ap, fmt);
+    vsnprintf(&(*s_out)[at], n + 1, fmt, ap);
+    va_end(ap);
 
-    return true;
+    s_out->resize(at + n);
 }
 
 static void extradata_dump(u2record* record)
@@ -192,11 +111,11 @@ static void extradata_dump(u2record* record)
         *(uint32_t*)field = ntohl(*(uint32_t*)field);
     }
 
-    printf("\n(ExtraDataHdr)\n"
+    out("\n(ExtraDataHdr)\n"
         "\tevent type: %u\tevent length: %u\n",
         eventHdr.event_type, eventHdr.event_length);
 
-    printf("\n(ExtraData)\n"
+    out("\n(ExtraData)\n"
         "\tsensor id: %u\tevent id: %u\tevent second: %u\n"
         "\ttype: %u\tdatatype: %u\tbloblength: %u\t",
         event.sensor_id, event.event_id,
@@ -211,7 +130,7 @@ static void extradata_dump(u2record* record)
         memcpy(&ip, record->data + sizeof(Unified2ExtraDataHdr) + sizeof(SerialUnified2ExtraData),
             sizeof(uint32_t));
         ip = ntohl(ip);
-        printf("Original Client IP: %u.%u.%u.%u\n",
+        out("Original Client IP: %u.%u.%u.%u\n",
             TO_IP(ip));
         break;
 
@@ -219,63 +138,63 @@ static void extradata_dump(u2record* record)
         memcpy(&ipAddr, record->data + sizeof(Unified2ExtraDataHdr) +
             sizeof(SerialUnified2ExtraData), sizeof(struct in6_addr));
         inet_ntop(AF_INET6, &ipAddr, ip6buf, INET6_ADDRSTRLEN);
-        printf("Original Client IP: %s\n",
+        out("Original Client IP: %s\n",
             ip6buf);
         break;
 
     case EVENT_INFO_GZIP_DATA:
-        printf("GZIP Decompressed Data: %.*s\n",
+        out("GZIP Decompressed Data: %.*s\n",
             len, record->data + sizeof(Unified2ExtraDataHdr) + sizeof(SerialUnified2ExtraData));
         break;
 
     case EVENT_INFO_JSNORM_DATA:
-        printf("Normalized JavaScript Data: %.*s\n",
+        out("Normalized JavaScript Data: %.*s\n",
             len, record->data + sizeof(Unified2ExtraDataHdr) + sizeof(SerialUnified2ExtraData));
         break;
 
     case EVENT_INFO_SMTP_FILENAME:
-        printf("SMTP Attachment Filename: %.*s\n",
+        out("SMTP Attachment Filename: %.*s\n",
             len,record->data + sizeof(Unified2ExtraDataHdr) + sizeof(SerialUnified2ExtraData));
         break;
 
     case EVENT_INFO_SMTP_MAILFROM:
-        printf("SMTP MAIL FROM Addresses: %.*s\n",
+        out("SMTP MAIL FROM Addresses: %.*s\n",
             len,record->data + sizeof(Unified2ExtraDataHdr) + sizeof(SerialUnified2ExtraData));
         break;
 
     case EVENT_INFO_SMTP_RCPTTO:
-        printf("SMTP RCPT TO Addresses: %.*s\n",
+        out("SMTP RCPT TO Addresses: %.*s\n",
             len, record->data + sizeof(Unified2ExtraDataHdr) + sizeof(SerialUnified2ExtraData));
         break;
 
     case EVENT_INFO_SMTP_EMAIL_HDRS:
-        printf("SMTP EMAIL HEADERS: \n%.*s\n",
+        out("SMTP EMAIL HEADERS: \n%.*s\n",
             len, record->data + sizeof(Unified2ExtraDataHdr) + sizeof(SerialUnified2ExtraData));
         break;
 
     case EVENT_INFO_HTTP_URI:
-        printf("HTTP URI: %.*s\n",
+        out("HTTP URI: %.*s\n",
             len, record->data + sizeof(Unified2ExtraDataHdr) + sizeof(SerialUnified2ExtraData));
         break;
 
     case EVENT_INFO_HTTP_HOSTNAME:
-        printf("HTTP Hostname: ");
+        out("HTTP Hostname: ");
         data = record->data + sizeof(Unified2ExtraDataHdr) + sizeof(SerialUnified2ExtraData);
         for (i=0; i < len; i++)
         {
             if (iscntrl(data[i]))
-                printf("%c",'.');
+                out("%c",'.');
             else
-                printf("%c",data[i]);
+                out("%c",data[i]);
         }
-        printf("\n");
+        out("\n");
         break;
 
     case EVENT_INFO_IPV6_SRC:
         memcpy(&ipAddr, record->data + sizeof(Unified2ExtraDataHdr) +
             sizeof(SerialUnified2ExtraData), sizeof(struct in6_addr));
         inet_ntop(AF_INET6, &ipAddr, ip6buf, INET6_ADDRSTRLEN);
-        printf("IPv6 Source Address: %s\n",
+        out("IPv6 Source Address: %s\n",
             ip6buf);
         break;
 
@@ -283,7 +202,7 @@ static void extradata_dump(u2record* record)
         memcpy(&ipAddr, record->data + sizeof(Unified2ExtraDataHdr) +
             sizeof(SerialUnified2ExtraData), sizeof(struct in6_addr));
         inet_ntop(AF_INET6, &ipAddr, ip6buf, INET6_ADDRSTRLEN);
-        printf("IPv6 Destination Address: %s\n",
+        out("IPv6 Destination Address: %s\n",
             ip6buf);
         break;
 
@@ -315,7 +234,7 @@ static void event_dump(u2record* record)
     *(uint16_t*)field = ntohs(*(uint16_t*)field); /* dport_icode */
     /* done changing the network ordering */
 
-    printf("\n(Event)\n"
+    out("\n(Event)\n"
         "\tsensor id: %u\tevent id: %u\tevent second: %u\tevent microsecond: %u\n"
         "\tsig id: %u\tgen id: %u\trevision: %u\t classification: %u\n"
         "\tpriority: %u\tip source: %u.%u.%u.%u\tip destination: %u.%u.%u.%u\n"
@@ -358,7 +277,7 @@ static void event6_dump(u2record* record)
 
     inet_ntop(AF_INET6, &event.ip_source, ip6buf, INET6_ADDRSTRLEN);
 
-    printf("\n(IPv6 Event)\n"
+    out("\n(IPv6 Event)\n"
         "\tsensor id: %u\tevent id: %u\tevent second: %u\tevent microsecond: %u\n"
         "\tsig id: %u\tgen id: %u\trevision: %u\t classification: %u\n"
         "\tpriority: %u\tip source: %s\t",
@@ -369,7 +288,7 @@ static void event6_dump(u2record* record)
         event.priority_id, ip6buf);
 
     inet_ntop(AF_INET6, &event.ip_destination, ip6buf, INET6_ADDRSTRLEN);
-    printf("ip destination: %s\n"
+    out("ip destination: %s\n"
         "\tsrc port: %hu\tdest port: %hu\tip_proto: %hhu\timpact_flag: %hhu\tblocked: %hhu\n",
         ip6buf, event.sport_itype,
         event.dport_icode, to_utype(event.ip_proto),
@@ -408,7 +327,7 @@ static void event2_dump(u2record* record)
     }
     /* done changing the network ordering */
 
-    printf("\n(Event)\n"
+    out("\n(Event)\n"
         "\tsensor id: %u\tevent id: %u\tevent second: %u\tevent microsecond: %u\n"
         "\tsig id: %u\tgen id: %u\trevision: %u\t classification: %u\n"
         "\tpriority: %u\tip source: %u.%u.%u.%u\tip destination: %u.%u.%u.%u\n"
@@ -461,7 +380,7 @@ static void event2_6_dump(u2record* record)
 
     inet_ntop(AF_INET6, &event.ip_source, ip6buf, INET6_ADDRSTRLEN);
 
-    printf("\n(IPv6 Event)\n"
+    out("\n(IPv6 Event)\n"
         "\tsensor id: %u\tevent id: %u\tevent second: %u\tevent microsecond: %u\n"
         "\tsig id: %u\tgen id: %u\trevision: %u\t classification: %u\n"
         "\tpriority: %u\tip source: %s\t",
@@ -472,7 +391,7 @@ static void event2_6_dump(u2record* record)
         event.priority_id, ip6buf);
 
     inet_ntop(AF_INET6, &event.ip_destination, ip6buf, INET6_ADDRSTRLEN);
-    printf("ip destination: %s\n"
+    out("ip destination: %s\n"
         "\tsrc port: %hu\tdest port: %hu\tip_proto: %hhu\timpact_flag: %hhu\tblocked: %hhu\n"
         "\tmpls label: %u\tvland id: %hu\tpolicy id: %hu\n",
         ip6buf, event.sport_itype,
@@ -498,7 +417,7 @@ static void LogBuffer(const uint8_t* p, unsigned n)
         if ( odx == LOG_CHARS )
         {
             txt[odx] = hex[3*odx] = '\0';
-            printf("[%5u] %s %s\n", at, hex, txt);
+            out("[%5u] %s %s\n", at, hex, txt);
             at = idx + 1;
             odx = 0;
         }
@@ -506,7 +425,7 @@ static void LogBuffer(const uint8_t* p, unsigned n)
     if ( odx )
     {
         txt[odx] = hex[3*odx] = '\0';
-        printf("[%5u] %-48.48s %s\n", at, hex, txt);
+        out("[%5u] %-48.48s %s\n", at, hex, txt);
     }
 }
 
@@ -530,7 +449,7 @@ static void packet_dump(u2record* record)
     }
     /* done changing from network ordering */
 
-    printf("\nPacket\n"
+    out("\nPacket\n"
         "\tsensor id: %u\tevent id: %u\tevent second: %u\n"
         "\tpacket second: %u\tpacket microsecond: %u\n"
         "\tlinktype: %u\tpacket_length: %u\n",
@@ -543,62 +462,136 @@ static void packet_dump(u2record* record)
 
     if ( packet.packet_length != reclen )
     {
-        printf("ERROR: logged %u but packet_length = %u\n",
+        out("ERROR: logged %u but packet_length = %u\n",
             record->length-offset, packet.packet_length);
 
+        // the index skips the extra bytes too
         if ( packet.packet_length < reclen )
-        {
             reclen = packet.packet_length;
-            s_off = reclen + offset;
-        }
     }
     LogBuffer(record->data+offset, reclen);
 }
 
-static int u2dump(char* file)
+// packet records may carry more data than packet_length; the next
+// record starts after the packet
+static size_t skip_record(const u2file* f, const u2index& rec)
+{
+    const unsigned offset = sizeof(Serial_Unified2Packet)-4;
+
+    if ( rec.type != UNIFIED2_PACKET or rec.claimed <= offset )
+        return rec.claimed;
+
+    uint32_t len;
+    memcpy(&len, f->base + rec.offset + offsetof(Serial_Unified2Packet, packet_length), 4);
+    len = ntohl(len);
+
+    return (len < rec.claimed - offset) ? offset + len : rec.claimed;
+}
+
+// the dump functions copy whole structs out of short records too
+#define MIN_RECORD_DATA 256
+
+static void dump_record(const u2file* f, const u2index& rec)
 {
+    uint8_t pad[MIN_RECORD_DATA];
     u2record record;
-    u2iterator* it = new_iterator(file);
 
-    memset(&record, 0, sizeof(record));
+    record.type = rec.type;
+    record.length = rec.length;
+    record.data = (uint8_t*)f->base + rec.offset;
 
-    if (!it)
+    if ( rec.length < rec.claimed )
     {
-        printf("u2dump: Failed to create new iterator with file: %s\n", file);
-        return -1;
+        out("ERROR: Failed to read all record data.\n");
+        out("\tRead %u of %u bytes\n", rec.length, rec.claimed);
+
+        if ( rec.type != UNIFIED2_PACKET || rec.length < sizeof(Serial_Unified2Packet)-4 ||
+            rec.length < ntohl(((Serial_Unified2Packet*)record.data)->packet_length) )
+            return;
     }
 
-    while ( get_record(it, &record) )
+    if ( rec.length < sizeof(pad) )
     {
-        if (record.type == UNIFIED2_IDS_EVENT)
-            event_dump(&record);
-        else if (record.type == UNIFIED2_IDS_EVENT_VLAN)
-            event2_dump(&record);
-        else if (record.type == UNIFIED2_PACKET)
-            packet_dump(&record);
-        else if (record.type == UNIFIED2_IDS_EVENT_IPV6)
-            event6_dump(&record);
-        else if (record.type == UNIFIED2_IDS_EVENT_IPV6_VLAN)
-            event2_6_dump(&record);
-        else if (record.type == UNIFIED2_EXTRA_DATA)
-            extradata_dump(&record);
+        memset(pad, 0, sizeof(pad));
+        memcpy(pad, record.data, rec.length);
+        record.data = pad;
     }
 
-    free_iterator(it);
-    if (record.data)
-        free(record.data);
+    if (record.type == UNIFIED2_IDS_EVENT)
+        event_dump(&record);
+    else if (record.type == UNIFIED2_IDS_EVENT_VLAN)
+        event2_dump(&record);
+    else if (record.type == UNIFIED2_PACKET)
+        packet_dump(&record);
+    else if (record.type == UNIFIED2_IDS_EVENT_IPV6)
+        event6_dump(&record);
+    else if (record.type == UNIFIED2_IDS_EVENT_IPV6_VLAN)
+        event2_6_dump(&record);
+    else if (record.type == UNIFIED2_EXTRA_DATA)
+        extradata_dump(&record);
+}
+
+static void dump_range(const u2file* f, size_t first, size_t last, std::string& s)
+{
+    s_out = &s;
+
+    for ( size_t i = first; i < last; ++i )
+        dump_record(f, f->records[i]);
+
+    s_out = nullptr;
+}
+
+static int u2dump(char* file, unsigned threads)
+{
+    u2file f;
+    int err = u2file_open(&f, file);
 
+    if ( err )
+    {
+        printf("ERROR: Failed to open file: %s\n\tErrno: %s\n",
+            file, strerror(err));
+        return -1;
+    }
+
+    bool complete = u2file_index(&f, skip_record);
+
+    if ( !u2file_convert(&f, threads, dump_range, stdout) )
+        printf("ERROR: Failed to write output: %s\n", strerror(errno));
+
+    if ( !complete )
+    {
+        puts("ERROR: Failed to read record metadata.");
+        printf("\tRead %lu of %lu bytes\n", (unsigned long)(f.size - f.scanned),
+            (unsigned long)sizeof(uint32_t)*2);
+    }
+
+    u2file_close(&f);
     return 0;
 }
 
 int main(int argc, char** argv)
 {
-    if (argc != 2)
+    unsigned threads = std::thread::hardware_concurrency();
+    int c;
+
+    while ( (c = getopt(argc, argv, "j:")) != -1 )
     {
-        puts("usage: u2eventdump <file>");
+        switch ( c )
+        {
+        case 'j':
+            threads = strtoul(optarg, nullptr, 0);
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+
+    if ( optind != argc - 1 )
+    {
+        puts("usage: u2spewfoo [-j threads] <file>");
         return 1;
     }
 
-    return u2dump(argv[1]);
+    return u2dump(argv[optind], threads);
 }
-